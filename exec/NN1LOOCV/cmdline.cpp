@@ -0,0 +1,99 @@
+#include "cmdline.hpp"
+
+#include <tclap/CmdLine.h>
+#include <tempo/utils/utils/resources.hpp>
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv) {
+  using namespace std;
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Command line parsing
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  try {
+
+    // --- --- --- Build the cmd parser
+    TCLAP::CmdLine cmd("NN1LOOCV: tune the parameters of elastic distances for the 1NN classifier by leave one out"
+      " cross validation on the train split, then test them, writing one JSON line per dataset", ' ', "0.0.1");
+
+    // --- Datasets
+    TCLAP::ValueArg<string> ucr("", "ucr", "path to the UCR archive", true, "", "string", cmd);
+    TCLAP::MultiArg<string> names("n", "name", "dataset to tune, repeatable; all the datasets of the archive"
+      " (folders with a <name>_TRAIN.ts file) if none", false, "string", cmd);
+
+    // --- Distances and their parameters
+    TCLAP::ValueArg<string> distances("d", "distances", "comma separated distances to tune, among dtw, adtw and lcss",
+      false, "dtw,adtw,lcss", "string", cmd);
+    TCLAP::ValueArg<string> cfes("", "cfe", "comma separated cost function exponents of dtw and adtw; dtw tunes"
+      " 0.5,1,2 in one sweep", false, "0.5,1,2", "string", cmd);
+    TCLAP::ValueArg<int> windows("", "windows", "dtw and lcss windows: n+1 windows evenly spaced from 0 to the"
+      " length of the series", false, 100, "int", cmd);
+    TCLAP::ValueArg<int> penalties("", "penalties", "number of adtw penalties", false, 100, "int", cmd);
+    TCLAP::ValueArg<int> psamples("", "penalty-samples", "number of direct alignments sampled to scale the adtw"
+      " penalties", false, 4000, "int", cmd);
+    TCLAP::ValueArg<int> epsilons("", "epsilons", "number of lcss epsilons, evenly spaced from a fifth of the"
+      " standard deviation of the train split to the standard deviation", false, 10, "int", cmd);
+    TCLAP::ValueArg<int> seed("", "seed", "Seed of the penalty samples and of the ties between neighbours", false, 0,
+      "int", cmd);
+
+    // --- Parallelism
+    TCLAP::ValueArg<int> nbp("p", "nb-threads", "Number of threads - use <=0 for autodetect", false, 1, "int", cmd);
+    TCLAP::ValueArg<int> block("", "block-size", "series per block of the cache blocked search; 0 for the"
+      " incremental search", false, 64, "int", cmd);
+
+    // --- Output
+    TCLAP::ValueArg<string> out("o", "out", "path to the JSON lines output, one line per dataset"
+      " (default: standard output)", false, "", "string", cmd);
+
+    // --- --- --- Parse the argv array.
+    cmd.parse(argc, argv);
+
+    // --- --- --- Get options
+    cmdopt opt{};
+    opt.ucr_dir = fs::path(ucr.getValue());
+    opt.names = names.getValue();
+    {
+      std::istringstream in(distances.getValue());
+      std::string item;
+      while(std::getline(in, item, ',')){
+        if(item!="dtw" && item!="adtw" && item!="lcss"){ return {"--distances: unknown distance '" + item + "'"}; }
+        if(std::find(opt.distances.begin(), opt.distances.end(), item)==opt.distances.end()){
+          opt.distances.push_back(item);
+        }
+      }
+      if(opt.distances.empty()){ return {"--distances expects at least one distance"}; }
+    }
+    {
+      std::istringstream in(cfes.getValue());
+      std::string item;
+      try {
+        while(std::getline(in, item, ',')){
+          const double e = std::stod(item);
+          if(e<=0){ throw std::invalid_argument("cfe"); }
+          opt.cfes.push_back(e);
+        }
+      } catch (std::exception const&) { return {"--cfe expects comma separated positive numbers"}; }
+      if(opt.cfes.empty()){ return {"--cfe expects at least one exponent"}; }
+    }
+    if(windows.getValue()<1){ return {"--windows expects a positive number"}; }
+    opt.nb_windows = (size_t)windows.getValue();
+    if(penalties.getValue()<1){ return {"--penalties expects a positive number"}; }
+    opt.nb_penalties = (size_t)penalties.getValue();
+    if(psamples.getValue()<1){ return {"--penalty-samples expects a positive number"}; }
+    opt.penalty_samples = (size_t)psamples.getValue();
+    if(epsilons.getValue()<1){ return {"--epsilons expects a positive number"}; }
+    opt.nb_epsilons = (size_t)epsilons.getValue();
+    if(seed.getValue()<0){ return {"--seed expects a non negative number"}; }
+    opt.seed = (size_t)seed.getValue();
+    opt.nb_threads = nbp.getValue()<=0 ? (int)tempo::utils::resources::available_cpus() : nbp.getValue();
+    if(block.getValue()<0){ return {"--block-size expects a non negative number"}; }
+    opt.block_size = (size_t)block.getValue();
+    if(out.isSet()){ opt.output = {fs::path(out.getValue())}; }
+
+    return {opt};
+
+  } catch (TCLAP::ArgException& e)  // catch exceptions
+  { return {std::string("error: " + e.error() + " for arg " + e.argId())}; }
+}
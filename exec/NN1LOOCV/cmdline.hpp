@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+struct cmdopt {
+  fs::path ucr_dir;
+  /// Datasets to tune; all the datasets of the archive if empty
+  std::vector<std::string> names;
+  /// Distances to tune, among "dtw", "adtw" and "lcss"
+  std::vector<std::string> distances;
+  /// Cost function exponents of DTW and ADTW
+  std::vector<double> cfes;
+  /// Windows of DTW and LCSS: 'nb_windows'+1 windows evenly spaced in [0, length]
+  size_t nb_windows;
+  /// ADTW: number of penalties, sampled from 'penalty_samples' direct alignments (see ADTWGen::do_sampling)
+  size_t nb_penalties;
+  size_t penalty_samples;
+  /// LCSS: number of epsilons, evenly spaced in [stddev/5, stddev] of the train split
+  size_t nb_epsilons;
+  size_t block_size;
+  size_t seed;
+  int nb_threads;
+  std::optional<fs::path> output;
+};
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv);
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+
+#include <tempo/classifier/loocv/partable/partable.hpp>
+#include <tempo/classifier/loocv/partable/dist_adtw.hpp>
+#include <tempo/classifier/loocv/partable/dist_dtw.hpp>
+#include <tempo/classifier/loocv/partable/dist_lcss.hpp>
+#include <tempo/classifier/TSChief/snode/nn1splitter/nn1_adtw.hpp>
+#include <tempo/dataset/dts.hpp>
+#include <tempo/reader/dts.reader.hpp>
+
+#include <nlohmann/json.hpp>
+#include "cmdline.hpp"
+
+using namespace std;
+using namespace tempo;
+
+namespace fs = std::filesystem;
+namespace loocv = tempo::classifier::nn1loocv;
+
+[[noreturn]] void do_exit(int code, std::optional<std::string> msg = {}) {
+    if (msg) { std::cerr << msg.value() << std::endl; }
+    exit(code);
+}
+
+cmdopt getcmdopt(int argc, char **argv) {
+    cmdopt opt;
+    variant<string, cmdopt> mb_opt = parse_cmd(argc, argv);
+    switch (mb_opt.index()) {
+        case 0: {
+            cerr << "Error: " << std::get<0>(mb_opt) << std::endl;
+            exit(1);
+        }
+        case 1: {
+            opt = std::get<1>(mb_opt);
+        }
+    }
+    return opt;
+}
+
+/// The datasets of 'opt', or all the datasets of the archive (folders with a <name>_TRAIN.ts file), by name
+std::vector<std::string> list_datasets(cmdopt const &opt) {
+    std::vector<std::string> names = opt.names;
+    if (names.empty()) {
+        std::error_code ec;
+        for (auto const &entry: fs::directory_iterator(opt.ucr_dir, ec)) {
+            const std::string name = entry.path().filename().string();
+            if (entry.is_directory() && fs::exists(entry.path() / (name + "_TRAIN.ts"))) { names.push_back(name); }
+        }
+        if (ec) { do_exit(1, "Cannot list " + opt.ucr_dir.string() + ": " + ec.message()); }
+        std::sort(names.begin(), names.end());
+    }
+    return names;
+}
+
+/// 'nb'+1 windows evenly spaced in [0, length], without duplicates
+std::vector<size_t> window_grid(size_t nb, size_t length) {
+    std::set<size_t> windows;
+    for (size_t k = 0; k <= nb; ++k) { windows.insert((k * length + nb / 2) / nb); }
+    return {windows.begin(), windows.end()};
+}
+
+/// JSON record of a tuned distance: its selected parameters, its LOOCV (train) and test results
+nlohmann::json record(std::string const &distance, size_t nb_params, nlohmann::json best,
+                      loocv::result_LOOCVDist train, loocv::result_LOOCVDist test) {
+    nlohmann::json j;
+    j["distance"] = distance;
+    j["nb_params"] = nb_params;
+    j["best"] = std::move(best);
+    j["train"] = train.to_json();
+    j["test"] = test.to_json();
+    return j;
+}
+
+/// Tune the distances of 'opt' on a dataset of the archive, with all the threads
+nlohmann::json tune(std::string const &name, cmdopt const &opt) {
+    const auto nbthreads = (size_t) opt.nb_threads;
+    reader::dataset::ts_ucr ucr{};
+    ucr.ucr_dir = opt.ucr_dir;
+    ucr.name = name;
+    auto read_dataset_result = reader::dataset::load(ucr, nbthreads);
+    if (read_dataset_result.index() == 0) { throw std::runtime_error(std::get<0>(read_dataset_result)); }
+    reader::dataset::TrainTest const &data = std::get<1>(read_dataset_result);
+    DTS const &train = data.train_dataset;
+    DTS const &test = data.test_dataset;
+    DatasetHeader const &train_header = train.header();
+    DatasetHeader const &test_header = test.header();
+
+    // The LOOCV instances work on univariate series without missing values
+    if (train_header.nb_dimensions() != 1) { throw std::runtime_error("multivariate dataset"); }
+    if (train_header.has_missing_value() || test_header.has_missing_value()) {
+        throw std::runtime_error("missing values");
+    }
+    if (train.size() < 2) { throw std::runtime_error("less than two train series"); }
+
+    PRNG prng(opt.seed);
+    nlohmann::json j;
+    j["nb_threads"] = nbthreads;
+    j["load_time_ns"] = data.load_time.count();
+    j["train_size"] = train.size();
+    j["test_size"] = test.size();
+    const auto start = utils::now();
+    nlohmann::json results = nlohmann::json::array();
+    const std::vector<size_t> windows = window_grid(opt.nb_windows, train_header.length_max());
+
+    for (std::string const &distance: opt.distances) {
+        if (distance == "dtw") {
+            // The exponents 0.5, 1 and 2 in one sweep; the others one at a time
+            std::set<F> todo(opt.cfes.begin(), opt.cfes.end());
+            const auto &cfes = loocv::LOOCV_DTW_CFES::cfes;
+            if (std::all_of(cfes.begin(), cfes.end(), [&](F e) { return todo.count(e) == 1; })) {
+                loocv::LOOCV_DTW_CFES instance(train, test, windows);
+                loocv::partable(instance, train.size(), train_header, test.size(), test_header, prng, nbthreads,
+                                opt.block_size == 0 ? 64 : opt.block_size);
+                for (size_t k = 0; k < cfes.size(); ++k) {
+                    nlohmann::json r = record(distance, windows.size(), {{"window", instance.best_window[k]}},
+                                              instance.result_train[k], instance.result_test[k]);
+                    r["cfe"] = cfes[k];
+                    results.push_back(r);
+                    todo.erase(cfes[k]);
+                }
+            }
+            for (const F cfe: todo) {
+                loocv::LOOCV_DTW instance(train, test, cfe, windows);
+                loocv::partable(instance, train.size(), train_header, test.size(), test_header, prng, nbthreads,
+                                opt.block_size);
+                nlohmann::json r = record(distance, windows.size(), {{"window", instance.best_window}},
+                                          instance.result_train, instance.result_test);
+                r["cfe"] = cfe;
+                results.push_back(r);
+            }
+        } else if (distance == "adtw") {
+            namespace nn1s = tempo::classifier::TSChief::snode::nn1splitter;
+            const std::vector<F> cfes(opt.cfes.begin(), opt.cfes.end());
+            const auto penalties = nn1s::ADTWGen::do_sampling(
+              cfes, {"default"}, {{"default", train}}, opt.penalty_samples, prng, opt.nb_penalties,
+              nn1s::ADTWGen::omega_exponent, nbthreads
+            );
+            for (const F cfe: cfes) {
+                loocv::LOOCV_ADTW instance(train, test, cfe, penalties.at({cfe, "default"}));
+                loocv::partable(instance, train.size(), train_header, test.size(), test_header, prng, nbthreads,
+                                opt.block_size);
+                nlohmann::json r = record(distance, instance.nb_params, {{"penalty", instance.best_penalty}},
+                                          instance.result_train, instance.result_test);
+                r["cfe"] = cfe;
+                results.push_back(r);
+            }
+        } else if (distance == "lcss") {
+            // One window sweep per epsilon; the best epsilon is the first one with the most correct train series
+            const F stddev = DTS_Stats(train, nbthreads)._stddev[0];
+            std::unique_ptr<loocv::LOOCV_LCSS> best;
+            nlohmann::json sweeps = nlohmann::json::array();
+            for (size_t k = 0; k < opt.nb_epsilons; ++k) {
+                const F ratio = opt.nb_epsilons == 1 ? 1.0 : 0.2 + 0.8 * (F) k / (F) (opt.nb_epsilons - 1);
+                auto instance = std::make_unique<loocv::LOOCV_LCSS>(train, test, stddev * ratio, windows);
+                loocv::partable(*instance, train.size(), train_header, test.size(), test_header, prng, nbthreads,
+                                opt.block_size);
+                sweeps.push_back({
+                  {"epsilon", instance->epsilon},
+                  {"window", instance->best_window},
+                  {"train", instance->result_train.to_json()},
+                  {"test", instance->result_test.to_json()}
+                });
+                if (!best || instance->result_train.nb_correct > best->result_train.nb_correct) {
+                    best = std::move(instance);
+                }
+            }
+            nlohmann::json r = record(distance, opt.nb_epsilons * windows.size(),
+                                      {{"epsilon", best->epsilon}, {"window", best->best_window}},
+                                      best->result_train, best->result_test);
+            r["epsilons"] = sweeps;
+            results.push_back(r);
+        }
+    }
+
+    j["results"] = results;
+    j["tune_time_ns"] = (utils::now() - start).count();
+    return j;
+}
+
+int main(int argc, char **argv) {
+
+    cmdopt opt = getcmdopt(argc, argv);
+
+    std::ofstream outf;
+    if (opt.output) {
+        outf.open(opt.output.value());
+        if (!outf) { do_exit(1, "Cannot open " + opt.output.value().string()); }
+    }
+    std::ostream &out = opt.output ? outf : std::cout;
+
+    // --- --- --- One dataset at a time, each LOOCV using all the threads
+    const std::vector<std::string> names = list_datasets(opt);
+    size_t nb_failed = 0;
+    for (std::string const &name: names) {
+        nlohmann::json j;
+        try { j = tune(name, opt); }
+        catch (std::exception const &e) { j["error"] = e.what(); }
+        j["dataset"] = name;
+        if (j.contains("error")) { ++nb_failed; }
+        out << j.dump() << std::endl;
+        if (opt.output) {
+            std::cout << name << ": "
+                      << (j.contains("error") ? "error: " + j.at("error").get<std::string>() : "done") << std::endl;
+        }
+    }
+
+    std::cerr << names.size() << " datasets, " << nb_failed << " failed" << std::endl;
+    return nb_failed == 0 ? 0 : 2;
+}
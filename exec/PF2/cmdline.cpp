@@ -1,10 +1,12 @@
 #include "cmdline.hpp"
 
 #include <tclap/CmdLine.h>
+#include <tempo/utils/utils/resources.hpp>
+#include <algorithm>
 #include <cassert>
+#include <sstream>
 #include <string>
 #include <vector>
-#include <thread>
 #include <set>
 #include <regex>
 
@@ -22,29 +24,201 @@ std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv) {
     // The CmdLine object parses the argv array based on the Arg objects that it contains.
     TCLAP::CmdLine cmd("Splitting Forest", ' ', "0.0.1");
 
-    // --- Dataset UCR or CSV
+    // --- Dataset UCR, CSV or binary
     TCLAP::SwitchArg ucr("", "ucr", "use a UCR dataset", false);
     TCLAP::SwitchArg csv("", "csv", "use a CSV dataset", false);
-    cmd.xorAdd(ucr, csv);
-    TCLAP::UnlabeledMultiArg<string> ds("dataset", "<ucr_path ucr_name> or <csv_train csv_test>", true, "strings", cmd);
+    TCLAP::SwitchArg bin("", "bin", "use a binary dataset (see --save-bin)", false);
+    TCLAP::SwitchArg arrow("", "arrow", "use an Arrow IPC dataset (e.g. exported from Parquet files)", false);
+    std::vector<TCLAP::Arg*> input_args{&ucr, &csv, &bin, &arrow};
+    cmd.xorAdd(input_args);
+    TCLAP::UnlabeledMultiArg<string> ds("dataset", "<ucr_path ucr_name> or <csv_train csv_test> or <bin_train bin_test>"
+      " or <arrow_train arrow_test dataset_name>", true, "strings", cmd);
+    TCLAP::ValueArg<string> savebin("", "save-bin", "save the dataset in the binary format, as <prefix>_TRAIN.bin and"
+      " <prefix>_TEST.bin", false, "", "prefix", cmd);
+    TCLAP::SwitchArg bincompress("", "bin-compress", "with --save-bin, write the compressed binary format", cmd,
+      false);
+    TCLAP::SwitchArg binappend("", "bin-append", "with --save-bin, append the series to the files in the appendable"
+      " binary format instead of overwriting them (created if they do not exist)", cmd, false);
 
     // --- Extra CSV
     TCLAP::SwitchArg csv_skip("", "csv-skip-header", "Skip the csv's first line", cmd, false);
     TCLAP::ValueArg<std::string> csv_sep("", "csv-separator", "CSV columns separator", false, ",", "character", cmd);
 
+    // --- Extra Arrow
+    TCLAP::ValueArg<std::string> arrow_series("", "arrow-series", "Arrow column of the series: lists of values, or"
+      " lists of fixed size lists of values for multivariate series", false, "series", "string", cmd);
+    TCLAP::ValueArg<std::string> arrow_label("", "arrow-label", "Arrow column of the labels; empty for unlabelled"
+      " series", false, "label", "string", cmd);
+
     // --- PF version
-    TCLAP::ValueArg<string> pfconfig("", "pfc", "PF Configuration", false, "pf2018", "PF Configuration", cmd);
+    TCLAP::ValueArg<string> pfconfig("", "pfc", "PF Configuration: pf2, pf2018 (PF 1.0), or distances separated by ':'; "
+      "pf2:<option>:... sets the options of PF2: paa<f> (PAA transform), dtwpaa<f>[@<tol>] (coarse to fine DTW), "
+      "dtwproba", false, "pf2", "PF Configuration", cmd);
 
     // --- Tree config
     TCLAP::ValueArg<int> nbt("t", "nb-trees", "Number of trees", true, 100, "int", cmd);
     TCLAP::ValueArg<int> nbc("c", "nb-candidates", "Number of candidates", true, 5, "int", cmd);
+    TCLAP::ValueArg<double> train_budget("", "train-budget", "Wall clock budget of the training in seconds: trees"
+      " are trained while they are expected to complete within it, up to --nb-trees", false, 0, "double", cmd);
+
+    // --- Sub-sampled forest
+    TCLAP::ValueArg<double> sampling("", "sampling", "Train each tree on a stratified sample of the train data"
+      " with this ratio, reporting the out-of-bag accuracy", false, 1, "double", cmd);
+    TCLAP::ValueArg<int> sampling_max("", "sampling-max-per-class", "With --sampling, maximum number of exemplars"
+      " drawn per class for each tree", false, 0, "int", cmd);
+
+    // --- WDTW
+    TCLAP::ValueArg<int> wdtw_tables("", "wdtw-g-tables", "WDTW candidates draw their g among this number of values,"
+      " with weights computed once (default: any g in [0, 1[)", false, 0, "int", cmd);
+
+    // --- ADTW
+    TCLAP::ValueArg<string> adtw_penalties("", "adtw-penalties", "File of the ADTW penalties: loaded if it matches the"
+      " train data, else sampled and saved", false, "", "string", cmd);
+
+    // --- DTW kernels
+    TCLAP::ValueArg<string> autotune("", "autotune", "time the DTW kernels on the train data and cache the fastest per"
+      " length and window bucket in this file; reused by the next runs on the same CPU", false, "", "string", cmd);
+    TCLAP::SwitchArg lazy("", "lazy-transforms", "compute the derived transforms when first used by a splitter"
+      " instead of before training and testing", cmd, false);
+    TCLAP::SwitchArg virtual_d1("", "virtual-test-derivative", "do not store the derivative of the test data: the"
+      " distances derive the test series on the fly", cmd, false);
 
     // --- Parallelism
     TCLAP::ValueArg<int> nbp("p", "nb-threads", "Number of threads - use <=0 for autodetect", false, 1, "int", cmd);
+    TCLAP::SwitchArg pin("", "pin-threads", "pin the worker threads to the CPUs (Linux only)", cmd, false);
+    TCLAP::SwitchArg interleave("", "numa-interleave", "interleave the train data over the NUMA nodes (Linux only)",
+      cmd, false);
+    TCLAP::ValueArg<string> huge_pages("", "huge-pages", "store the series and the large tables on huge pages"
+      " (Linux only): off, thp (transparent huge pages) or hugetlb (reserved huge pages, else thp)", false, "off",
+      "string", cmd);
+    TCLAP::ValueArg<int> memory_limit("", "memory-limit", "memory limit in MiB, shared by the dataset slabs, the"
+      " envelope caches and the distance memos - use <=0 for the limit of the container (cgroup), else of the"
+      " machine", false, 0, "int", cmd);
+
+    // --- Combination of the trees
+    TCLAP::ValueArg<string> combiner("", "combiner", "how the results of the trees are combined: average (weighted"
+      " by the leaves), vote (majority) or logprob (sum of the log probabilities)", false, "average", "string", cmd);
+    TCLAP::SwitchArg treemajor("", "tree-major", "score the test exemplars through each tree together, level by"
+      " level, instead of one exemplar at a time", cmd, false);
+
+    // --- Anytime prediction
+    TCLAP::ValueArg<int> anytime("", "anytime", "evaluate the trees by rounds of this number of trees, and stop"
+      " predicting an exemplar once the remaining trees cannot change its class", false, 0, "int", cmd);
+    TCLAP::ValueArg<double> anytime_conf("", "anytime-confidence", "with --anytime, also stop once the probability"
+      " of the leading class reaches this value (may change the predicted class)", false, 1, "double", cmd);
+
+    // --- Forest prefixes
+    TCLAP::ValueArg<string> prefix_trees("", "prefix-trees", "also report the accuracy of the first <n1>, <n2>, ..."
+      " trees of the forest, in the same prediction (with --prob-out, their probabilities in <prob-out>.<n>trees)",
+      false, "", "n1:n2:...", cmd);
+
+    // --- Tree size
+    TCLAP::ValueArg<int> max_depth("", "max-depth", "nodes at this depth (root at depth 0) are leaves predicting their"
+      " smoothed class distribution: bounds the cost of a prediction per tree", false, 0, "int", cmd);
+    TCLAP::ValueArg<int> min_node_size("", "min-node-size", "nodes with less exemplars are leaves predicting their"
+      " smoothed class distribution", false, 0, "int", cmd);
+    TCLAP::ValueArg<double> min_gini_gain("", "min-gini-gain", "splits reducing the Gini impurity by less than this"
+      " value are replaced by leaves predicting their smoothed class distribution", false, 0, "double", cmd);
+    TCLAP::SwitchArg noprune("", "no-prune", "keep the subtrees that do not change the predictions (single branch"
+      " nodes, nodes whose leaves predict the same result)", cmd, false);
+
+    // --- Node sampling
+    TCLAP::ValueArg<int> node_sample("", "node-sample", "nodes with at least this number of exemplars score their"
+      " candidates on a stratified sample of their exemplars, then split all of them with the chosen candidate",
+      false, 0, "int", cmd);
+    TCLAP::ValueArg<double> node_sample_ratio("", "node-sample-ratio", "with --node-sample, ratio of the sample",
+      false, 0.1, "double", cmd);
+
+    // --- Fan-out
+    TCLAP::ValueArg<int> max_fanout("", "max-fanout", "nodes with more classes split on this number of groups of"
+      " classes (at least 2), one exemplar per group: bounds the distances per query of many classes datasets",
+      false, 0, "int", cmd);
+
+    // --- Chunked routing
+    TCLAP::ValueArg<int> chunked("", "chunked-routing", "NN1 nodes with at least this number of exemplars search and"
+      " route chunks of their queries concurrently, each with its own tie breaks: a single large tree uses all the"
+      " threads", false, 0, "int", cmd);
+
+    // --- Cost budget
+    TCLAP::ValueArg<double> node_budget("", "node-budget", "budget of the estimated distance cost of the candidates"
+      " per node exemplar, in cells of cost matrices (e.g. DTW with window w on series of length L: L*(2w+1) per"
+      " exemplar and per class): a node generates candidates while below its budget, at least one", false, 0,
+      "double", cmd);
+    TCLAP::SwitchArg adaptive("", "adaptive-sampling", "draw the distances of the candidates with weights lowering the"
+      " expensive distances rarely chosen by the nodes already trained (not reproducible with several threads)",
+      cmd, false);
+
+    // --- Test and train time distance memos
+    TCLAP::ValueArg<int> test_memo("", "test-memo", "share the distances computed by the trees between the test and"
+      " train exemplars, in a memo of at most this number of entries", false, 0, "int", cmd);
+    TCLAP::ValueArg<int> train_memo("", "train-memo", "share the distances computed by the trees between the train"
+      " exemplars during the training, in a memo of at most this number of entries (for small train sets)", false, 0,
+      "int", cmd);
 
     // --- Output
     TCLAP::ValueArg<string> out("o", "out", "path to output json file", false, "", "string", cmd);
     TCLAP::ValueArg<string> probout("", "probout", "path to output csv file for result", false, "", "string", cmd);
+    TCLAP::SwitchArg probarrow("", "prob-arrow", "write --probout in the Arrow IPC file format instead of csv: the"
+      " test index, a column of probabilities per class, the weight and the predicted label, in one record batch per"
+      " test block", cmd, false);
+    TCLAP::SwitchArg probleaves("", "prob-leaf-ids", "with --prob-arrow, also write the leaf reached by each test"
+      " series in each tree", cmd, false);
+
+    // --- Progress
+    TCLAP::ValueArg<string> progress("", "progress", "path to output the training progress as json lines", false, "",
+      "string", cmd);
+    TCLAP::ValueArg<int> progress_period("", "progress-period", "time between two progress lines, in milliseconds",
+      false, 1000, "int", cmd);
+    TCLAP::SwitchArg timings("", "timings", "report the time spent in the phases of the training and prediction",
+      cmd, false);
+    TCLAP::ValueArg<string> trace("", "trace", "path to output a Chrome trace (chrome://tracing, ui.perfetto.dev) of the"
+      " trees, nodes, candidates and parallel tasks", false, "", "string", cmd);
+
+    // --- Streamed test
+    TCLAP::ValueArg<int> stream_test("", "stream-test", "read, transform and predict the test set by blocks of this"
+      " number of series, in a pipeline (UCR datasets only)", false, 0, "int", cmd);
+    TCLAP::SwitchArg overlap_test("", "overlap-test", "load the test set and compute its transforms on a thread of its"
+      " own while training, so that the prediction starts as soon as the training ends", cmd, false);
+
+    // --- Variable length and missing values
+    TCLAP::ValueArg<int> resample("", "resample", "resample the series of both splits to this length, filling their"
+      " missing values by interpolation: accepts variable length series and missing values (0: longest train length)",
+      false, 0, "int", cmd);
+
+    // --- Model
+    TCLAP::ValueArg<string> modelout("", "model-out", "path to output the trained model", false, "", "string", cmd);
+    TCLAP::ValueArg<string> modelin("", "model-in", "path to a trained model: skip training", false, "", "string", cmd);
+    TCLAP::ValueArg<string> modelquant("", "model-quantize", "store the exemplars of the model as 16 bits codes:"
+      " int16 or float16", false, "", "string", cmd);
+    TCLAP::SwitchArg modelcompact("", "compact-model", "after training, keep only the train exemplars used by the"
+      " model, releasing the full train transforms", cmd, false);
+    TCLAP::SwitchArg compactpernode("", "compact-per-node", "with --compact-model, copy the exemplars of each node in"
+      " their own aligned block, in evaluation order (exemplars shared by nodes are duplicated)", cmd, false);
+    TCLAP::SwitchArg modelstream("", "stream-model", "with --model-out, write each tree to the model as soon as it is"
+      " trained instead of keeping the forest in memory, then load the model to test", cmd, false);
+    TCLAP::ValueArg<string> storeout("", "store-out", "path to output the train data, with all its transforms, as an"
+      " exemplar store shared by the models trained on it or on subsets of it (see --model-store)", false, "",
+      "string", cmd);
+    TCLAP::ValueArg<string> modelstore("", "model-store", "exemplar store of the models: --model-out references its"
+      " exemplars instead of storing them, --model-in is loaded with it", false, "", "string", cmd);
+    TCLAP::ValueArg<string> checkpoint("", "checkpoint", "append each trained tree to this file; if it exists, resume"
+      " the training it records (same seed, configuration and train data), training only the missing trees", false,
+      "", "string", cmd);
+    TCLAP::ValueArg<int> grow("", "grow", "with --model-in, train this number of new trees on the train data and drop"
+      " the oldest trees of the model, keeping at most --nb-trees trees", false, 0, "int", cmd);
+
+    // --- Distributed training: workers train ranges of trees, the coordinator merges their models
+    TCLAP::ValueArg<string> treerange("", "tree-range", "worker: train only the trees <first>:<count> of the --nb-trees"
+      " trees (same configuration, seed and train data on all the workers)", false, "", "first:count", cmd);
+    TCLAP::MultiArg<string> mergemodel("", "merge-model", "coordinator: merge the models of the workers, given in"
+      " tree order (repeat the option), instead of training", false, "string", cmd);
+
+    // --- Sharded test: workers predict shards of the test set, the coordinator merges their probabilities
+    TCLAP::ValueArg<string> testshard("", "test-shard", "worker, with --model-in: predict only the shard <i>:<n> of the"
+      " test set (contiguous range i of n), writing its probabilities with --prob-out", false, "", "i:n", cmd);
+    TCLAP::MultiArg<string> mergeprob("", "merge-probabilities", "coordinator, with --model-in: merge the"
+      " probabilities of the shards, given in shard order (repeat the option), instead of predicting", false,
+      "string", cmd);
 
     // --- --- --- Parse the argv array.
     cmd.parse(argc, argv);
@@ -63,6 +237,26 @@ std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv) {
       ru.name = remainder[1];
       remainder.erase(remainder.begin(), remainder.begin()+1);
       opt.input = {ru};
+    } else if (bin.isSet()) {
+      // --- --- --- Binary
+      trd::bin rb{};
+      if (remainder.size()<2) { return {"Expects bin <train path> <test path>"}; }
+      rb.path_to_train = fs::path(remainder[0]);
+      rb.path_to_test = fs::path(remainder[1]);
+      remainder.erase(remainder.begin(), remainder.begin()+2);
+      opt.input = {rb};
+    } else if (arrow.isSet()) {
+      // --- --- --- Arrow
+      trd::arrow_ipc ra{};
+      if (remainder.size()<3) { return {"Expects arrow <train path> <test path> <dataset name>"}; }
+      ra.path_to_train = fs::path(remainder[0]);
+      ra.path_to_test = fs::path(remainder[1]);
+      ra.dataset_name = remainder[2];
+      remainder.erase(remainder.begin(), remainder.begin()+3);
+      ra.columns.series = arrow_series.getValue();
+      ra.columns.label.reset();
+      if(!arrow_label.getValue().empty()){ ra.columns.label = arrow_label.getValue(); }
+      opt.input = {ra};
     } else {
       // --- --- --- CSV
       assert(csv.isSet());
@@ -83,9 +277,223 @@ std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv) {
     // --- Other options
     opt.nb_trees = nbt.getValue();
     opt.nb_candidates = nbc.getValue();
-    opt.nb_threads = nbp.getValue()<=0 ? std::thread::hardware_concurrency() : nbp.getValue();
+    if(train_budget.isSet()){
+      if(!(train_budget.getValue()>0)){ return {"--train-budget expects a positive number of seconds"}; }
+      if(modelin.isSet()||mergemodel.isSet()){
+        return {"--train-budget can not be used with --model-in or --merge-model"};
+      }
+      opt.train_budget_s = {train_budget.getValue()};
+    }
+    opt.nb_threads = nbp.getValue()<=0 ? (int)tempo::utils::resources::available_cpus() : nbp.getValue();
+    opt.pin_threads = pin.getValue();
+    opt.numa_interleave = interleave.getValue();
+    {
+      const auto mode = tempo::utils::memory::parse_huge_pages(huge_pages.getValue());
+      if(!mode){ return {"--huge-pages expects off, thp or hugetlb"}; }
+      opt.huge_pages = mode.value();
+    }
+    if(memory_limit.getValue()>0){ opt.memory_limit = {(size_t)memory_limit.getValue() << 20}; }
+    opt.lazy_transforms = lazy.getValue();
+    opt.virtual_test_derivative = virtual_d1.getValue();
     if(out.isSet()){ opt.output = {out.getValue()}; }
     if(probout.isSet()){ opt.prob_output = {probout.getValue()}; }
+    if(probarrow.getValue()&&!probout.isSet()){ return {"--prob-arrow requires --probout"}; }
+    opt.prob_arrow = probarrow.getValue();
+    if(probleaves.getValue()&&!probarrow.getValue()){ return {"--prob-leaf-ids requires --prob-arrow"}; }
+    if(probleaves.getValue()&&mergeprob.isSet()){
+      return {"--prob-leaf-ids can not be used with --merge-probabilities"};
+    }
+    opt.prob_leaf_ids = probleaves.getValue();
+    if(modelout.isSet()){ opt.model_output = {modelout.getValue()}; }
+    if(modelin.isSet()){ opt.model_input = {modelin.getValue()}; }
+    if(modelquant.isSet()){
+      if(!modelout.isSet()){ return {"--model-quantize requires --model-out"}; }
+      if(modelquant.getValue()=="int16"){ opt.model_quantize = {tempo::distance::quantized::QFormat::INT16}; }
+      else if(modelquant.getValue()=="float16"){ opt.model_quantize = {tempo::distance::quantized::QFormat::FLOAT16}; }
+      else { return {"--model-quantize expects int16 or float16"}; }
+    }
+    if(modelstream.getValue()){
+      if(!modelout.isSet()){ return {"--stream-model requires --model-out"}; }
+      if(modelin.isSet()||mergemodel.isSet()){
+        return {"--stream-model can not be used with --model-in or --merge-model"};
+      }
+    }
+    opt.stream_model = modelstream.getValue();
+    if(storeout.isSet()){
+      if(modelin.isSet()||mergemodel.isSet()){
+        return {"--store-out can not be used with --model-in or --merge-model"};
+      }
+      opt.store_output = {storeout.getValue()};
+    }
+    if(modelstore.isSet()){
+      if(!modelout.isSet()&&!modelin.isSet()){ return {"--model-store requires --model-out or --model-in"}; }
+      if(modelquant.isSet()||modelstream.getValue()||mergemodel.isSet()){
+        return {"--model-store can not be used with --model-quantize, --stream-model or --merge-model"};
+      }
+      opt.model_store = {modelstore.getValue()};
+    }
+    if(modelcompact.getValue()&&modelin.isSet()){ return {"--compact-model can not be used with --model-in"}; }
+    opt.compact_model = modelcompact.getValue();
+    if(compactpernode.getValue()&&!opt.compact_model){ return {"--compact-per-node requires --compact-model"}; }
+    opt.compact_per_node = compactpernode.getValue();
+    if(grow.isSet()){
+      if(!modelin.isSet()){ return {"--grow requires --model-in"}; }
+      if(grow.getValue()<=0){ return {"--grow expects a positive number"}; }
+      opt.grow = {(size_t)grow.getValue()};
+    }
+    if(treerange.isSet()){
+      if(modelin.isSet()){ return {"--tree-range can not be used with --model-in"}; }
+      std::smatch m;
+      const std::string& range = treerange.getValue();
+      if(!std::regex_match(range, m, std::regex("([0-9]+):([0-9]+)"))){ return {"--tree-range expects first:count"}; }
+      const size_t first = std::stoul(m[1]);
+      const size_t count = std::stoul(m[2]);
+      if(count==0){ return {"--tree-range expects a positive count"}; }
+      if(first + count>opt.nb_trees){ return {"--tree-range beyond --nb-trees"}; }
+      opt.tree_range = {{first, count}};
+    }
+    if(mergemodel.isSet()){
+      if(modelin.isSet()||treerange.isSet()){ return {"--merge-model can not be used with --model-in or --tree-range"}; }
+      for(const auto& p : mergemodel.getValue()){ opt.merge_models.emplace_back(p); }
+    }
+    if(checkpoint.isSet()){
+      if(modelin.isSet()||mergemodel.isSet()){
+        return {"--checkpoint can not be used with --model-in or --merge-model"};
+      }
+      opt.checkpoint = {checkpoint.getValue()};
+    }
+    if(testshard.isSet()||mergeprob.isSet()){
+      if(!modelin.isSet()||grow.isSet()){ return {"--test-shard and --merge-probabilities require --model-in"}; }
+      if(stream_test.isSet()){ return {"--test-shard and --merge-probabilities can not be used with --stream-test"}; }
+      if(testshard.isSet()&&mergeprob.isSet()){ return {"--test-shard can not be used with --merge-probabilities"}; }
+    }
+    if(testshard.isSet()){
+      std::smatch m;
+      const std::string& shard = testshard.getValue();
+      if(!std::regex_match(shard, m, std::regex("([0-9]+):([0-9]+)"))){ return {"--test-shard expects i:n"}; }
+      const size_t i = std::stoul(m[1]);
+      const size_t n = std::stoul(m[2]);
+      if(i>=n){ return {"--test-shard expects i < n"}; }
+      opt.test_shard = {{i, n}};
+    }
+    for(const auto& p : mergeprob.getValue()){ opt.merge_probabilities.emplace_back(p); }
+    if(savebin.isSet()){ opt.save_bin = {savebin.getValue()}; }
+    if(bincompress.getValue()&&!savebin.isSet()){ return {"--bin-compress requires --save-bin"}; }
+    opt.save_bin_compressed = bincompress.getValue();
+    if(binappend.getValue()&&!savebin.isSet()){ return {"--bin-append requires --save-bin"}; }
+    if(binappend.getValue()&&bincompress.getValue()){ return {"--bin-append cannot be used with --bin-compress"}; }
+    opt.save_bin_append = binappend.getValue();
+    if(progress.isSet()){ opt.progress_output = {progress.getValue()}; }
+    if(progress_period.getValue()<=0){ return {"--progress-period expects a positive number"}; }
+    opt.progress_period_ms = (size_t)progress_period.getValue();
+    opt.timings = timings.getValue();
+    if(trace.isSet()){ opt.trace_output = {trace.getValue()}; }
+    if(sampling.isSet()){
+      if(sampling.getValue()<=0){ return {"--sampling expects a positive ratio"}; }
+      opt.sampling_ratio = {sampling.getValue()};
+    }
+    if(sampling_max.isSet()){
+      if(!sampling.isSet()){ return {"--sampling-max-per-class requires --sampling"}; }
+      if(sampling_max.getValue()<=0){ return {"--sampling-max-per-class expects a positive number"}; }
+      opt.sampling_max_per_class = {(size_t)sampling_max.getValue()};
+    }
+
+    if(wdtw_tables.isSet()){
+      if(wdtw_tables.getValue()<=0){ return {"--wdtw-g-tables expects a positive number"}; }
+      opt.wdtw_nb_tables = (size_t)wdtw_tables.getValue();
+    }
+
+    if(adtw_penalties.isSet()){ opt.adtw_penalties = {adtw_penalties.getValue()}; }
+
+    if(autotune.isSet()){ opt.autotune = {autotune.getValue()}; }
+
+    {
+      auto c = tempo::classifier::TSChief::combiner_from_string(combiner.getValue());
+      if(!c){ return {"--combiner expects average, vote or logprob"}; }
+      opt.combiner = c.value();
+    }
+    opt.tree_major = treemajor.getValue();
+    if(anytime.isSet()){
+      if(anytime.getValue()<=0){ return {"--anytime expects a positive number"}; }
+      opt.anytime_batch = {(size_t)anytime.getValue()};
+    }
+    if(prefix_trees.isSet()){
+      if(anytime.isSet()||stream_test.isSet()){
+        return {"--prefix-trees can not be used with --anytime or --stream-test"};
+      }
+      std::istringstream sizes(prefix_trees.getValue());
+      for(std::string token; std::getline(sizes, token, ':');){
+        if(!std::regex_match(token, std::regex("[0-9]+"))||std::stoul(token)==0){
+          return {"--prefix-trees expects positive numbers separated by ':'"};
+        }
+        opt.prefix_trees.push_back(std::stoul(token));
+      }
+      std::sort(opt.prefix_trees.begin(), opt.prefix_trees.end());
+    }
+    if(anytime_conf.isSet()){
+      if(!anytime.isSet()){ return {"--anytime-confidence requires --anytime"}; }
+      const double c = anytime_conf.getValue();
+      if(!(c>0&&c<=1)){ return {"--anytime-confidence expects a value in ]0, 1]"}; }
+      opt.anytime_confidence = {c};
+    }
+    if(max_depth.isSet()){
+      if(max_depth.getValue()<0){ return {"--max-depth expects a non negative number"}; }
+      opt.max_depth = {(size_t)max_depth.getValue()};
+    }
+    if(min_node_size.getValue()<0){ return {"--min-node-size expects a non negative number"}; }
+    opt.min_node_size = (size_t)min_node_size.getValue();
+    if(!(min_gini_gain.getValue()>=0&&min_gini_gain.getValue()<=1)){
+      return {"--min-gini-gain expects a value in [0, 1]"};
+    }
+    opt.min_gini_gain = min_gini_gain.getValue();
+    opt.prune = !noprune.getValue();
+    if(node_sample.isSet()){
+      if(node_sample.getValue()<=0){ return {"--node-sample expects a positive number"}; }
+      opt.node_sample_min_size = {(size_t)node_sample.getValue()};
+    }
+    if(node_sample_ratio.isSet()&&!node_sample.isSet()){ return {"--node-sample-ratio requires --node-sample"}; }
+    if(!(node_sample_ratio.getValue()>0&&node_sample_ratio.getValue()<=1)){
+      return {"--node-sample-ratio expects a value in ]0, 1]"};
+    }
+    opt.node_sample_ratio = node_sample_ratio.getValue();
+    if(max_fanout.isSet()){
+      if(max_fanout.getValue()<2){ return {"--max-fanout expects a number of at least 2"}; }
+      opt.max_fanout = {(size_t)max_fanout.getValue()};
+    }
+    if(chunked.isSet()){
+      if(chunked.getValue()<=0){ return {"--chunked-routing expects a positive number"}; }
+      opt.chunked_routing = {(size_t)chunked.getValue()};
+    }
+    if(node_budget.isSet()){
+      if(!(node_budget.getValue()>0)){ return {"--node-budget expects a positive number"}; }
+      opt.node_budget = {node_budget.getValue()};
+    }
+    opt.adaptive_sampling = adaptive.getValue();
+    if(test_memo.isSet()){
+      if(test_memo.getValue()<=0){ return {"--test-memo expects a positive number"}; }
+      opt.test_memo = {(size_t)test_memo.getValue()};
+    }
+    if(train_memo.isSet()){
+      if(train_memo.getValue()<=0){ return {"--train-memo expects a positive number"}; }
+      opt.train_memo = {(size_t)train_memo.getValue()};
+    }
+    if(stream_test.isSet()){
+      if(stream_test.getValue()<=0){ return {"--stream-test expects a positive number"}; }
+      if(!ucr.isSet()){ return {"--stream-test requires --ucr"}; }
+      if(savebin.isSet()){ return {"--stream-test cannot be used with --save-bin"}; }
+      opt.stream_test_block = {(size_t)stream_test.getValue()};
+    }
+    if(resample.isSet()){
+      if(resample.getValue()<0||resample.getValue()==1){ return {"--resample expects 0 or a length of at least 2"}; }
+      if(stream_test.isSet()){ return {"--resample cannot be used with --stream-test"}; }
+      opt.resample = {(size_t)resample.getValue()};
+    }
+    if(overlap_test.getValue()){
+      if(stream_test.isSet()||resample.isSet()||savebin.isSet()){
+        return {"--overlap-test can not be used with --stream-test, --resample or --save-bin"};
+      }
+    }
+    opt.overlap_test = overlap_test.getValue();
 
     return {opt};
 
@@ -1,23 +1,86 @@
 #pragma once
 
 #include <tempo/reader/dts.reader.hpp>
+#include <tempo/distance/quantized.hpp>
+#include <tempo/classifier/TSChief/combiner.hpp>
+#include <tempo/utils/utils/memory.hpp>
 
 #include <string>
 #include <optional>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include <filesystem>
 namespace fs = std::filesystem;
 namespace trd = tempo::reader::dataset;
 
 struct cmdopt {
-  std::variant<trd::ts_ucr, trd::csv> input;
+  trd::Config input;
   size_t nb_trees;
   size_t nb_candidates;
+  std::optional<double> train_budget_s;
   int nb_threads;
+  bool pin_threads;
+  bool numa_interleave;
+  tempo::utils::memory::HugePages huge_pages;
+  /// Memory limit of the budget of the caches and of the dataset slabs, in bytes; detected if none
+  std::optional<size_t> memory_limit;
+  bool lazy_transforms;
+  bool virtual_test_derivative;
   std::string pfconfig;
   std::optional<fs::path> output;
   std::optional<fs::path> prob_output;
+  /// Write 'prob_output' in the Arrow IPC file format, with the leaf IDs if 'prob_leaf_ids'
+  bool prob_arrow;
+  bool prob_leaf_ids;
+  std::optional<fs::path> model_output;
+  std::optional<fs::path> model_input;
+  std::optional<tempo::distance::quantized::QFormat> model_quantize;
+  bool compact_model;
+  /// Compact the model with a block of exemplars per node (see TSChief::Forest::ExemplarLayout)
+  bool compact_per_node;
+  bool stream_model;
+  std::optional<fs::path> store_output;
+  std::optional<fs::path> model_store;
+  std::optional<size_t> grow;
+  std::optional<std::pair<size_t, size_t>> tree_range;
+  std::vector<fs::path> merge_models;
+  std::optional<fs::path> checkpoint;
+  std::optional<std::pair<size_t, size_t>> test_shard;
+  std::vector<fs::path> merge_probabilities;
+  std::optional<fs::path> save_bin;
+  bool save_bin_compressed;
+  bool save_bin_append;
+  std::optional<double> sampling_ratio;
+  std::optional<size_t> sampling_max_per_class;
+  size_t wdtw_nb_tables;
+  std::optional<fs::path> adtw_penalties;
+  std::optional<fs::path> autotune;
+  std::optional<fs::path> progress_output;
+  size_t progress_period_ms;
+  bool timings;
+  std::optional<fs::path> trace_output;
+  std::optional<size_t> stream_test_block;
+  bool overlap_test;
+  std::optional<size_t> resample;
+  tempo::classifier::TSChief::Combiner combiner;
+  bool tree_major;
+  std::optional<size_t> anytime_batch;
+  std::optional<double> anytime_confidence;
+  std::vector<size_t> prefix_trees;
+  std::optional<size_t> test_memo;
+  std::optional<size_t> train_memo;
+  std::optional<size_t> max_depth;
+  size_t min_node_size;
+  double min_gini_gain;
+  bool prune;
+  std::optional<size_t> node_sample_min_size;
+  double node_sample_ratio;
+  std::optional<size_t> max_fanout;
+  std::optional<size_t> chunked_routing;
+  std::optional<double> node_budget;
+  bool adaptive_sampling;
 };
 
 std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv);
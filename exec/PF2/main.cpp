@@ -1,11 +1,18 @@
 #include <exception>
+#include <fstream>
+#include <future>
 #include <regex>
+#include <sstream>
 
 #include <tempo/utils/readingtools.hpp>
+#include <tempo/utils/utils/resources.hpp>
 #include <tempo/dataset/dts.hpp>
 #include <tempo/reader/dts.reader.hpp>
+#include <tempo/writer/bin/bin.hpp>
+#include <tempo/writer/arrow/arrow.hpp>
 #include <tempo/transform/tseries.univariate.hpp>
 #include <tempo/classifier/TSChief/forest.hpp>
+#include <tempo/distance/stats.hpp>
 
 #include <nlohmann/json.hpp>
 #include "cmdline.hpp"
@@ -23,6 +30,55 @@ namespace fs = std::filesystem;
     exit(code);
 }
 
+/// Read the probabilities written with --prob-out by a worker of a sharded test (see --test-shard): a header line
+/// with the class names, in the encoding order of 'header', then one row of probabilities per series
+arma::mat read_probabilities(fs::path const &path, DatasetHeader const &header) {
+    std::ifstream in(path);
+    if (!in) { throw std::runtime_error("Cannot open probabilities " + path.string()); }
+    auto split = [](std::string const &line) {
+        std::vector<std::string> cells;
+        std::istringstream iss(line);
+        for (std::string cell; std::getline(iss, cell, ',');) { cells.push_back(cell); }
+        return cells;
+    };
+    std::string line;
+    std::vector<std::string> names = std::getline(in, line) ? split(line) : std::vector<std::string>{};
+    std::vector<std::string> expected;
+    for (size_t c = 0; c < header.nb_classes(); ++c) { expected.push_back(header.decode(c)); }
+    if (names != expected) { throw std::runtime_error("Probabilities " + path.string() + ": unexpected classes"); }
+    std::vector<std::vector<double>> rows;
+    while (std::getline(in, line)) {
+        if (line.empty()) { continue; }
+        std::vector<double> row;
+        for (auto const &cell: split(line)) { row.push_back(std::stod(cell)); }
+        if (row.size() != expected.size()) {
+            throw std::runtime_error("Probabilities " + path.string() + ": row " + std::to_string(rows.size() + 1)
+                                     + " does not have one column per class");
+        }
+        rows.push_back(std::move(row));
+    }
+    arma::mat result(rows.size(), expected.size());
+    for (size_t r = 0; r < rows.size(); ++r) {
+        for (size_t c = 0; c < expected.size(); ++c) { result(r, c) = rows[r][c]; }
+    }
+    return result;
+}
+
+/// Write 'result' with --prob-arrow as one record batch (see writer::arrow::PredictionWriter), the rows being indexed
+/// from 'first_index' in the test set; with the leaf IDs if 'leaves' is given
+void write_probabilities_arrow(fs::path const &path, classifier::ResultN const &result, DatasetHeader const &header,
+                               size_t first_index, classifier::TSChief::Forest::LeafIDs const *leaves) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) { throw std::runtime_error("Cannot open " + path.string()); }
+    std::vector<std::string> labels;
+    for (size_t c = 0; c < header.nb_classes(); ++c) { labels.push_back(header.decode(c)); }
+    writer::arrow::PredictionWriter writer(out, std::move(labels), leaves ? leaves->nb_trees : 0);
+    writer.write(first_index, result.probabilities.n_rows, result.probabilities.memptr(), result.weight.memptr(),
+                 leaves ? leaves->ids.data() : nullptr);
+    writer.close();
+    if (!out) { throw std::runtime_error("Cannot write " + path.string()); }
+}
+
 cmdopt getcmdopt(int argc, char **argv) {
     cmdopt opt;
     variant<string, cmdopt> mb_opt = parse_cmd(argc, argv);
@@ -60,78 +116,508 @@ int main(int argc, char **argv) {
 
     cmdopt opt = getcmdopt(argc, argv);
 
+    // Before reading the data: pages are placed on the NUMA node of the thread touching them first
+    if (opt.pin_threads && !utils::ThreadPool::global().pin_workers()) {
+        std::cerr << "Warning: could not pin the worker threads" << std::endl;
+    }
+    // Before reading the data too: the slabs of the series are allocated by the readers
+    utils::memory::set_huge_pages(opt.huge_pages);
+    // And the budget the slabs are charged on
+    if (opt.memory_limit) {
+        utils::resources::set_budget(utils::resources::MemoryBudget::of(opt.memory_limit.value()));
+    }
+
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
     // Read dataset
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
+    // Record the errors of the sanity checks in the output, and exit
+    auto exit_on_errors = [&](std::vector<std::string> const &errors) {
+        if (errors.empty()) { return; }
+        jv["status"] = "error";
+        jv["status_message"] = utils::cat(errors, "; ");
+        cout << to_string(jv) << endl;
+        if (opt.output) {
+            auto out = ofstream(opt.output.value());
+            out << jv << endl;
+        }
+        exit(1);
+    };
+
     DTS train_dataset;
     DTS test_dataset;
     {
         using namespace tempo::reader::dataset;
-        Result read_dataset_result;
-        read_dataset_result = load(opt.input);
-
-        if (read_dataset_result.index() == 0) { do_exit(1, std::get<0>(read_dataset_result)); }
-        TrainTest traintest = std::get<1>(std::move(read_dataset_result));
-        train_dataset = traintest.train_dataset;
-        test_dataset = traintest.test_dataset;
-
         nlohmann::json dataset;
-        dataset["train"] = train_dataset.header().to_json();
-        dataset["test"] = test_dataset.header().to_json();
-        dataset["load_time_ns"] = traintest.load_time.count();
-        dataset["load_time_str"] = utils::as_string(traintest.load_time);
-        jv["dataset"] = dataset;
-
-        // --- --- --- Sanity check
-        std::vector<std::string> errors = sanity_check(traintest);
-
-        if (!errors.empty()) {
-            jv["status"] = "error";
-            jv["status_message"] = utils::cat(errors, "; ");
-            cout << to_string(jv) << endl;
-            if (opt.output) {
-                auto out = ofstream(opt.output.value());
-                out << jv << endl;
+        std::vector<std::string> errors;
+
+        if (opt.stream_test_block || opt.overlap_test) {
+            // --- --- --- Train split only: the test split is read by blocks while testing (see predict_stream),
+            // or on a thread of its own while training (see --overlap-test)
+            auto start = utils::now();
+            std::variant<std::string, DTS> read_train_result = load_train(opt.input, (size_t) opt.nb_threads);
+            if (read_train_result.index() == 0) { do_exit(1, std::get<0>(read_train_result)); }
+            train_dataset = std::get<1>(std::move(read_train_result));
+            const utils::duration_t load_time = utils::now() - start;
+            dataset["train"] = train_dataset.header().to_json();
+            dataset["load_time_ns"] = load_time.count();
+            dataset["load_time_str"] = utils::as_string(load_time);
+            dataset["train_load_time_ns"] = load_time.count();
+            jv["dataset"] = dataset;
+            errors = sanity_check(train_dataset);
+        } else {
+            Result read_dataset_result;
+            read_dataset_result = load(opt.input, (size_t) opt.nb_threads);
+
+            if (read_dataset_result.index() == 0) { do_exit(1, std::get<0>(read_dataset_result)); }
+            TrainTest traintest = std::get<1>(std::move(read_dataset_result));
+            // --- --- --- Equal length series without missing values, recorded with the headers read from the files
+            if (opt.resample) {
+                dataset["read_train"] = traintest.train_dataset.header().to_json();
+                dataset["read_test"] = traintest.test_dataset.header().to_json();
+                const auto start = utils::now();
+                traintest = resample(traintest, opt.resample.value(), (size_t) opt.nb_threads);
+                const utils::duration_t resample_time = utils::now() - start;
+                dataset["resample_length"] = traintest.train_dataset.header().length_max();
+                dataset["resample_time_ns"] = resample_time.count();
+                dataset["resample_time_str"] = utils::as_string(resample_time);
             }
-            exit(1);
+            train_dataset = traintest.train_dataset;
+            test_dataset = traintest.test_dataset;
+
+            dataset["train"] = train_dataset.header().to_json();
+            dataset["test"] = test_dataset.header().to_json();
+            dataset["load_time_ns"] = traintest.load_time.count();
+            dataset["load_time_str"] = utils::as_string(traintest.load_time);
+            dataset["train_load_time_ns"] = traintest.train_load_time.count();
+            dataset["test_load_time_ns"] = traintest.test_load_time.count();
+            dataset["load_bytes"] = traintest.load_bytes;
+            {
+                const double seconds = std::chrono::duration<double>(traintest.load_time).count();
+                dataset["load_bytes_per_s"] = seconds > 0 ? (double) traintest.load_bytes / seconds : 0.0;
+            }
+            jv["dataset"] = dataset;
+
+            // --- --- --- Binary copy, loaded without parsing by later runs (see --bin), with the PF2 derivative.
+            // With --bin-append, the series are added after the ones of the files (e.g. a daily ingest)
+            if (opt.save_bin) {
+                std::optional<size_t> compress_block;
+                if (opt.save_bin_compressed) { compress_block = tempo::writer::bin::block_values; }
+                auto write_bin = [&compress_block, &opt](DTS const &split, fs::path const &path) {
+                    std::optional<std::string> error;
+                    if (opt.save_bin_append) { error = tempo::writer::bin::append(split, path); }
+                    else {
+                        std::ofstream out(path, std::ios::binary);
+                        if (!out) { do_exit(1, "Cannot open " + path.string()); }
+                        error = tempo::writer::bin::write(split, out, compress_block, (size_t) opt.nb_threads);
+                    }
+                    if (error) { do_exit(1, error.value()); }
+                };
+                const tempo::transform::NamedKernels kernels{{"derivative1", tempo::transform::derivative_kernel(1)}};
+                for (auto const &[split, suffix]: {std::pair{&train_dataset, "_TRAIN.bin"},
+                                                   {&test_dataset, "_TEST.bin"}}) {
+                    const fs::path path = opt.save_bin.value().string() + suffix;
+                    write_bin(*split, path);
+                    auto derived = tempo::transform::transform_all(*split, kernels, (size_t) opt.nb_threads);
+                    write_bin(derived.at("derivative1"), tempo::writer::bin::transform_path(path, "derivative1"));
+                }
+            }
+
+            errors = sanity_check(traintest);
         }
+
+        // --- --- --- Sanity check
+        exit_on_errors(errors);
     } // End of dataset loading
 
     DatasetHeader const &train_header = train_dataset.header();
-    DatasetHeader const &test_header = test_dataset.header();
 
     // --- --- ---
     // --- --- --- STATE
     // --- --- ---
 
+    // --- --- --- Checkpoint: identified by the seed, the train data and the options shaping the trees.
+    // Resuming a training takes the seed of its checkpoint.
+    std::optional<tsc::Checkpoint> checkpoint;
+    if (opt.checkpoint) {
+        try {
+            if (auto key = tsc::read_checkpoint_key(opt.checkpoint.value()); key) {
+                state_seed = nlohmann::json::parse(key.value()).at("seed").get<size_t>();
+            }
+        } catch (std::exception const &e) { do_exit(1, "Checkpoint: " + std::string(e.what())); }
+        nlohmann::json key;
+        key["seed"] = state_seed;
+        key["train"] = train_dataset.header().to_json();
+        key["pfconfig"] = opt.pfconfig;
+        key["nb_trees"] = opt.nb_trees;
+        key["nb_candidates"] = opt.nb_candidates;
+        if (opt.sampling_ratio) { key["sampling_ratio"] = opt.sampling_ratio.value(); }
+        if (opt.sampling_max_per_class) { key["sampling_max_per_class"] = opt.sampling_max_per_class.value(); }
+        if (opt.max_depth) { key["max_depth"] = opt.max_depth.value(); }
+        key["min_node_size"] = opt.min_node_size;
+        key["min_gini_gain"] = opt.min_gini_gain;
+        if (opt.max_fanout) { key["max_fanout"] = opt.max_fanout.value(); }
+        if (opt.chunked_routing) { key["chunked_routing"] = opt.chunked_routing.value(); }
+        if (opt.node_budget) { key["node_budget"] = opt.node_budget.value(); }
+        if (opt.adaptive_sampling) { key["adaptive_sampling"] = true; }
+        if (opt.node_sample_min_size) {
+            key["node_sample_min_size"] = opt.node_sample_min_size.value();
+            key["node_sample_ratio"] = opt.node_sample_ratio;
+        }
+        key["wdtw_nb_tables"] = opt.wdtw_nb_tables;
+        checkpoint = tsc::Checkpoint{opt.checkpoint.value(), key.dump()};
+        jv["checkpoint"] = opt.checkpoint.value().string();
+    }
+
     std::cout << "State seed = " << state_seed << std::endl;
     tsc::TreeState tstate(state_seed, 0);
 
     // --- --- ---
     // --- --- --- Train the tree
     // --- --- ---
+    // "pf2:<option>:..." is the pf2 configuration with options; "pf2018" is PF 1.0 (see classifier::PF2018)
+    const bool pf2_options = opt.pfconfig.starts_with("pf2:");
     tempo::classifier::ProximityForest2 classifier = tempo::classifier::ProximityForest2(
             train_dataset,
             train_header,
             opt.nb_candidates,
             opt.nb_trees,
-            tstate
+            tstate,
+            pf2_options ? "pf2" : opt.pfconfig
     );
-    classifier.train(opt.nb_threads);
+    // --- --- --- Binary datasets: use the derivatives saved with them (see --save-bin), memory mapped as the series.
+    // The train data may then exceed the memory: the nodes page in the series they read.
+    // Not with --resample: they are the derivatives of the series as read.
+    if (opt.input.index() == 2 && !opt.resample) {
+        auto const &conf = std::get<2>(opt.input);
+        auto load_derivative = [&opt](DTS const &split, fs::path const &path, classifier::MDTS &transforms) {
+            const fs::path tpath = tempo::writer::bin::transform_path(path, "derivative1");
+            if (!fs::exists(tpath)) { return; }
+            auto vdts = tempo::reader::load_dataset_bin_transform(split, tpath, "derivative1", opt.nb_threads);
+            if (vdts.index() == 0) { do_exit(1, std::get<0>(vdts)); }
+            transforms.emplace("derivative1", std::get<1>(std::move(vdts)));
+        };
+        load_derivative(train_dataset, conf.path_to_train, classifier.train_transforms);
+        if (!opt.stream_test_block && !opt.overlap_test) {
+            load_derivative(test_dataset, conf.path_to_test, classifier.test_transforms);
+        }
+        classifier.advise_train = true;
+    }
+
+    if (opt.timings) { classifier.timers = std::make_shared<tsc::PhaseTimers>(); }
+    classifier.train_memo_max_entries = opt.train_memo;
+    classifier.numa_interleave = opt.numa_interleave;
+    classifier.lazy_transforms = opt.lazy_transforms;
+    classifier.virtual_test_derivative = opt.virtual_test_derivative;
+    // "pf2:<option>:...": the options of the PF2 configuration (see ProximityForest2::config_options)
+    if (pf2_options) {
+        std::istringstream options(opt.pfconfig.substr(3));
+        for (std::string token; std::getline(options, token, ':');) {
+            if (!token.empty()) { classifier.config_options.push_back(token); }
+        }
+    }
+    classifier.combiner = opt.combiner;
+    classifier.tree_major = opt.tree_major;
+    if (opt.trace_output) { utils::Tracer::global().enable(); }
+
+    // --- --- --- Overlapped test: load the test split and compute its transforms (the PF2 derivative, loaded with
+    // a binary dataset) on a thread of its own, while training or loading the model. One thread: the training keeps
+    // the pool.
+    struct OverlappedTest {
+        std::optional<std::string> error;
+        DTS dataset;
+        classifier::MDTS transforms;
+        utils::duration_t load_time{};
+        utils::duration_t transform_time{};
+    };
+    std::future<OverlappedTest> overlapped_test;
+    if (opt.overlap_test) {
+        overlapped_test = std::async(std::launch::async, [&opt, &classifier]() {
+            OverlappedTest r;
+            const auto start = utils::now();
+            auto vdts = tempo::reader::dataset::load_test(opt.input, 1);
+            r.load_time = utils::now() - start;
+            if (vdts.index() == 0) {
+                r.error = std::get<0>(std::move(vdts));
+                return r;
+            }
+            r.dataset = std::get<1>(std::move(vdts));
+            if (!tempo::reader::dataset::sanity_check_test(r.dataset).empty()) { return r; }
+            const auto transform_start = utils::now();
+            if (opt.input.index() == 2) {
+                const fs::path tpath = tempo::writer::bin::transform_path(std::get<2>(opt.input).path_to_test,
+                                                                          "derivative1");
+                if (fs::exists(tpath)) {
+                    auto vd = tempo::reader::load_dataset_bin_transform(r.dataset, tpath, "derivative1", 1);
+                    if (vd.index() == 0) {
+                        r.error = std::get<0>(std::move(vd));
+                        return r;
+                    }
+                    r.transforms.emplace("derivative1", std::get<1>(std::move(vd)));
+                }
+            }
+            r.transforms.merge(classifier.make_test_transforms(r.dataset, r.transforms, 1));
+            r.transform_time = utils::now() - transform_start;
+            return r;
+        });
+    }
+
+    std::ofstream progress_out;
+    auto setup_training = [&]() {
+        if (opt.sampling_ratio) { classifier.set_sampling(opt.sampling_ratio.value(), opt.sampling_max_per_class); }
+        classifier.wdtw_nb_tables = opt.wdtw_nb_tables;
+        classifier.max_depth = opt.max_depth;
+        classifier.min_node_size = opt.min_node_size;
+        classifier.min_gini_gain = opt.min_gini_gain;
+        classifier.prune_trees = opt.prune;
+        classifier.checkpoint = checkpoint;
+        if (opt.stream_model) {
+            classifier.stream_model = opt.model_output;
+            classifier.stream_model_quantize = opt.model_quantize;
+        }
+        if (opt.train_budget_s) {
+            classifier.train_time_budget = std::chrono::duration_cast<utils::duration_t>(
+                    std::chrono::duration<double>(opt.train_budget_s.value()));
+        }
+        if (opt.max_fanout) { classifier.max_fanout = opt.max_fanout.value(); }
+        if (opt.chunked_routing) { classifier.chunk_min_size = opt.chunked_routing.value(); }
+        if (opt.node_budget) { classifier.cost_budget = opt.node_budget.value(); }
+        if (opt.adaptive_sampling) {
+            classifier.adaptive_sampler = std::make_shared<tsc::snode::meta::AdaptiveSampler>();
+        }
+        if (opt.node_sample_min_size) {
+            classifier.node_sample_min_size = opt.node_sample_min_size.value();
+            classifier.node_sample_ratio = opt.node_sample_ratio;
+        }
+        classifier.adtw_penalties_path = opt.adtw_penalties;
+        classifier.autotune_path = opt.autotune;
+        if (opt.progress_output) {
+            progress_out.open(opt.progress_output.value());
+            if (!progress_out) { do_exit(1, "Cannot open progress output " + opt.progress_output.value().string()); }
+            classifier.set_progress(progress_out, std::chrono::milliseconds(opt.progress_period_ms));
+        }
+    };
+
+    // Exemplar store of the models, loaded once its file exists: it may be written by this run (see --store-out)
+    std::optional<tsc::ExemplarStore> store;
+    auto get_store = [&]() -> tsc::ExemplarStore const * {
+        if (!opt.model_store) { return nullptr; }
+        if (!store) {
+            try { store = tsc::ExemplarStore::load_mapped(opt.model_store.value()); }
+            catch (std::exception const &e) {
+                do_exit(1, "Cannot load exemplar store " + opt.model_store.value().string() + ": " + e.what());
+            }
+        }
+        return &store.value();
+    };
+
+    if (opt.model_input) {
+        try { classifier.load_model(opt.model_input.value(), get_store()); }
+        catch (std::exception const &e) { do_exit(1, e.what()); }
+        if (opt.grow) { // Warm start: add trees trained on the train data, dropping the oldest ones
+            setup_training();
+            try { classifier.grow(opt.nb_threads, opt.grow.value()); }
+            catch (std::exception const &e) { do_exit(1, e.what()); }
+            std::cout << "Grown model: " << opt.grow.value() << " new trees, " << classifier.grow_nb_dropped
+                      << " dropped" << std::endl;
+            jv["grow_nb_new_trees"] = opt.grow.value();
+            jv["grow_nb_dropped_trees"] = classifier.grow_nb_dropped;
+        }
+    } else if (!opt.merge_models.empty()) { // Coordinator of a distributed training: merge the workers' models
+        try { classifier.merge_models(opt.merge_models); }
+        catch (std::exception const &e) { do_exit(1, e.what()); }
+        std::cout << "Merged model: " << opt.merge_models.size() << " models" << std::endl;
+        jv["merged_nb_models"] = opt.merge_models.size();
+    } else {
+        setup_training();
+        if (opt.tree_range) { // Worker of a distributed training
+            const auto [first, count] = opt.tree_range.value();
+            classifier.train_range(opt.nb_threads, first, count);
+            jv["tree_range_first"] = first;
+            jv["tree_range_count"] = count;
+        } else { classifier.train(opt.nb_threads); }
+        if (opt.compact_model) {
+            const size_t nb_exemplars = classifier.compact_model(
+                    opt.compact_per_node ? tsc::Forest::ExemplarLayout::per_node : tsc::Forest::ExemplarLayout::shared
+            );
+            std::cout << "Compact model: " << nb_exemplars << " exemplars" << std::endl;
+            jv["model_nb_exemplars"] = nb_exemplars;
+        }
+    }
+
+    if (opt.store_output) {
+        std::ofstream out(opt.store_output.value(), std::ios::binary);
+        if (!out) { do_exit(1, "Cannot open exemplar store " + opt.store_output.value().string()); }
+        classifier.save_store(out);
+    }
+
+    // A streamed model is written by the training
+    if (opt.model_output && !opt.stream_model) {
+        std::ofstream out(opt.model_output.value(), std::ios::binary);
+        if (!out) { do_exit(1, "Cannot open model " + opt.model_output.value().string()); }
+        try {
+            if (opt.model_store) { classifier.save_model(out, *get_store()); }
+            else { classifier.save_model(out, opt.model_quantize); }
+        } catch (std::exception const &e) { do_exit(1, e.what()); }
+    }
 
     // --- --- --- TEST
 
-    classifier::ResultN result = classifier.predict(test_dataset, opt.nb_threads);
+    // Overlapped test: wait for the test split, recording the time the prediction waited for it
+    if (overlapped_test.valid()) {
+        const auto wait_start = utils::now();
+        OverlappedTest ot = overlapped_test.get();
+        const utils::duration_t wait_time = utils::now() - wait_start;
+        if (ot.error) { do_exit(1, ot.error.value()); }
+        test_dataset = std::move(ot.dataset);
+        nlohmann::json &dataset = jv["dataset"];
+        dataset["test"] = test_dataset.header().to_json();
+        dataset["test_load_time_ns"] = ot.load_time.count();
+        exit_on_errors(tempo::reader::dataset::sanity_check_test(test_dataset));
+        for (auto &[tn, tdts]: ot.transforms) { classifier.test_transforms.insert_or_assign(tn, std::move(tdts)); }
+        nlohmann::json jo;
+        jo["load_time_ns"] = ot.load_time.count();
+        jo["transform_time_ns"] = ot.transform_time.count();
+        jo["wait_time_ns"] = wait_time.count();
+        jv["overlap_test"] = jo;
+    }
 
     PRNG prng(tiebreak_seed);
-    size_t nb_correct = result.nb_correct_01loss(test_header, IndexSet(test_header.size()), prng);
-    double accuracy = (double) nb_correct / (double) test_header.size();
+    size_t nb_correct;
+    double accuracy;
+
+    if (opt.anytime_batch) {
+        classifier.anytime = tsc::Forest::Anytime{opt.anytime_batch.value(), opt.anytime_confidence};
+    }
+    classifier.memo_max_entries = opt.test_memo;
+    classifier.prefix_sizes = opt.prefix_trees;
+
+    if (opt.stream_test_block) {
+        // Pipelined: the probabilities are written while the test set is read
+        fs::path test_path = tempo::reader::dataset::test_path(opt.input);
+        auto vblocks = tempo::reader::TSBlockReader::open(test_path);
+        if (vblocks.index() == 0) {
+            do_exit(1, "Error: test set '" + test_path.string() + "': " + std::get<0>(vblocks));
+        }
+        std::ofstream prob_out;
+        if (opt.prob_output) {
+            prob_out.open(opt.prob_output.value(), opt.prob_arrow ? std::ios::binary : std::ios::out);
+            if (!prob_out) { do_exit(1, "Cannot open " + opt.prob_output.value().string()); }
+        }
+        // With --prob-arrow, one record batch per block, in the order of the blocks
+        std::optional<writer::arrow::PredictionWriter> arrow_out;
+        if (opt.prob_output && opt.prob_arrow) {
+            std::vector<std::string> labels;
+            DatasetHeader const &train_header = classifier.get_train_header();
+            for (size_t c = 0; c < train_header.nb_classes(); ++c) { labels.push_back(train_header.decode(c)); }
+            arrow_out.emplace(prob_out, std::move(labels), opt.prob_leaf_ids ? classifier.forest_size() : 0);
+        }
+        classifier::ProximityForest2::StreamResult sresult;
+        try {
+            sresult = classifier.predict_stream(std::get<1>(vblocks), opt.stream_test_block.value(), opt.nb_threads,
+                                                prng, opt.prob_output && !arrow_out ? &prob_out : nullptr, 2,
+                                                arrow_out ? &arrow_out.value() : nullptr);
+            if (arrow_out) { arrow_out->close(); }
+        } catch (std::exception const &e) { do_exit(1, "Error: test set '" + test_path.string() + "': " + e.what()); }
+        nb_correct = sresult.nb_correct;
+        accuracy = sresult.nb_labelled == 0 ? 0.0 : (double) nb_correct / (double) sresult.nb_labelled;
+        nlohmann::json j;
+        j["block_size"] = opt.stream_test_block.value();
+        j["nb_blocks"] = sresult.nb_blocks;
+        j["nb_series"] = sresult.nb_series;
+        j["nb_labelled"] = sresult.nb_labelled;
+        jv["stream_test"] = j;
+    } else if (!opt.merge_probabilities.empty()) {
+        // Coordinator of a sharded test: gather the probabilities of the workers, in test order
+        DatasetHeader const &test_header = test_dataset.header();
+        std::vector<arma::mat> shards;
+        size_t nb_rows = 0;
+        try {
+            for (auto const &path: opt.merge_probabilities) {
+                shards.push_back(read_probabilities(path, test_header));
+                nb_rows += shards.back().n_rows;
+            }
+        } catch (std::exception const &e) { do_exit(1, e.what()); }
+        if (nb_rows != test_header.size()) {
+            do_exit(1, "Merged probabilities of " + std::to_string(nb_rows) + " series, expects "
+                       + std::to_string(test_header.size()));
+        }
+        // Copy the shards in a preallocated result, rather than joining them one after the other
+        classifier::ResultN result(nb_rows, test_header.nb_classes());
+        for (size_t start = 0; auto const &shard: shards) {
+            if (shard.n_rows == 0) { continue; }
+            result.probabilities.rows(start, start + shard.n_rows - 1) = shard;
+            start += shard.n_rows;
+        }
+        result.weight.ones();
+        jv["merged_nb_shards"] = opt.merge_probabilities.size();
+
+        nb_correct = result.nb_correct_01loss(test_header, IndexSet(test_header.size()), prng);
+        accuracy = test_header.size() == 0 ? 0.0 : (double) nb_correct / (double) test_header.size();
+
+        if (opt.prob_output && opt.prob_arrow) {
+            try {
+                write_probabilities_arrow(opt.prob_output.value(), result, test_header, 0, nullptr);
+            } catch (std::exception const &e) { do_exit(1, e.what()); }
+        } else if (opt.prob_output) {
+            arma::field<std::string> header(test_header.nb_classes());
+            for (size_t i = 0; i < test_header.nb_classes(); ++i) { header(i) = test_header.decode(i); }
+            result.probabilities.save(arma::csv_name(opt.prob_output.value(), header));
+        }
+    } else {
+        // Worker of a sharded test: only the series of the shard, in a contiguous range
+        DTS tested = test_dataset;
+        size_t first_index = 0;
+        if (opt.test_shard) {
+            const auto [shard, nb_shards] = opt.test_shard.value();
+            const size_t n = test_dataset.size();
+            const size_t start = shard * n / nb_shards;
+            const size_t stop = (shard + 1) * n / nb_shards;
+            const IndexSet range(start, stop - start);
+            first_index = start;
+            tested = DTS(test_dataset, test_dataset.get_dataset_name(), range);
+            for (auto &[tn, tdts]: classifier.test_transforms) { tdts = DTS(tdts, tdts.get_dataset_name(), range); }
+            jv["test_shard"] = {{"shard", shard}, {"nb_shards", nb_shards}, {"start", start}, {"stop", stop}};
+        }
+        DatasetHeader const &test_header = test_dataset.header();
+        classifier::ResultN result = classifier.predict(tested, opt.nb_threads);
+
+        nb_correct = result.nb_correct_01loss(test_header, tested.index_set(), prng);
+        accuracy = tested.size() == 0 ? 0.0 : (double) nb_correct / (double) tested.size();
 
-    if (opt.prob_output) {
         arma::field<std::string> header(test_header.nb_classes());
         for (size_t i = 0; i < test_header.nb_classes(); ++i) { header(i) = test_header.decode(i); }
-        result.probabilities.save(arma::csv_name(opt.prob_output.value(), header));
+        if (opt.prob_output && opt.prob_arrow) {
+            try {
+                std::optional<tsc::Forest::LeafIDs> leaves;
+                if (opt.prob_leaf_ids) { leaves = classifier.predict_leaf_ids(tested.size(), opt.nb_threads); }
+                write_probabilities_arrow(opt.prob_output.value(), result, test_header, first_index,
+                                          leaves ? &leaves.value() : nullptr);
+            } catch (std::exception const &e) { do_exit(1, e.what()); }
+        } else if (opt.prob_output) {
+            result.probabilities.save(arma::csv_name(opt.prob_output.value(), header));
+        }
+
+        // Accuracy of the prefixes of the forest, scored in the same pass (see ProximityForest2::prefix_sizes)
+        if (!opt.prefix_trees.empty()) {
+            nlohmann::json jp = nlohmann::json::array();
+            for (auto &[nb_trees, pr]: classifier.prefix_results) {
+                const size_t pc = pr.nb_correct_01loss(test_header, tested.index_set(), prng);
+                const double pa = tested.size() == 0 ? 0.0 : (double) pc / (double) tested.size();
+                std::cout << "Prefix of " << nb_trees << " trees: accuracy " << pa << std::endl;
+                jp.push_back({{"nb_trees", nb_trees}, {"nb_correct", pc}, {"accuracy", pa}});
+                if (opt.prob_output) {
+                    const std::string path = opt.prob_output.value().string() + "." + std::to_string(nb_trees)
+                                             + "trees";
+                    if (opt.prob_arrow) {
+                        try {
+                            write_probabilities_arrow(path, pr, test_header, first_index, nullptr);
+                        } catch (std::exception const &e) { do_exit(1, e.what()); }
+                    } else { pr.probabilities.save(arma::csv_name(path, header)); }
+                }
+            }
+            jv["prefixes"] = jp;
+        }
     }
 
 
@@ -154,9 +640,162 @@ int main(int argc, char **argv) {
         j["prepare_data_human"] = utils::as_string(prepare_data_elapsed);
         //
         jv["classifier"] = opt.pfconfig;
+        j["float_type"] = std::is_same_v<F, float> ? "float" : "double";
+        j["nb_numa_nodes"] = utils::memory::nb_numa_nodes();
+        if (opt.numa_interleave) { j["numa_interleaved_bytes"] = classifier.numa_interleaved_bytes; }
+        j["huge_pages"] = utils::memory::to_string(opt.huge_pages);
+        {
+            nlohmann::json jr;
+            jr["available_cpus"] = utils::resources::available_cpus();
+            if (auto quota = utils::resources::cgroup_cpu_quota()) { jr["cpu_quota"] = quota.value(); }
+            if (auto limit = utils::resources::memory_limit()) { jr["memory_limit"] = limit.value(); }
+            const auto budget = utils::resources::budget();
+            jr["budget_dataset_slabs"] = budget.dataset_slabs;
+            jr["budget_envelope_caches"] = budget.envelope_caches;
+            jr["budget_distance_caches"] = budget.distance_caches;
+            jr["slab_bytes"] = utils::resources::slab_bytes();
+            j["resources"] = jr;
+        }
+        if (opt.autotune) { j["autotune"] = opt.autotune.value().string(); }
+        if (classifier.timers) { j["timings"] = classifier.timers->to_json(); }
+        j["combiner"] = tsc::to_string(classifier.combiner);
+        j["tree_major"] = classifier.tree_major;
+        j["lazy_transforms"] = classifier.lazy_transforms;
+        j["virtual_test_derivative"] = classifier.virtual_test_derivative;
+        j["config_options"] = classifier.config_options;
+        if (classifier.anytime) {
+            nlohmann::json ja;
+            ja["batch_size"] = classifier.anytime->batch_size;
+            if (classifier.anytime->confidence) { ja["confidence"] = classifier.anytime->confidence.value(); }
+            ja["average_nb_trees"] = classifier.anytime_average_nb_trees;
+            j["anytime"] = ja;
+        }
+        if (classifier.max_depth || classifier.min_node_size > 0 || classifier.min_gini_gain > 0) {
+            nlohmann::json jt;
+            if (classifier.max_depth) { jt["max_depth"] = classifier.max_depth.value(); }
+            jt["min_node_size"] = classifier.min_node_size;
+            jt["min_gini_gain"] = classifier.min_gini_gain;
+            j["tree_bounds"] = jt;
+        }
+        if (opt.node_sample_min_size) {
+            nlohmann::json jn;
+            jn["min_size"] = classifier.node_sample_min_size;
+            jn["ratio"] = classifier.node_sample_ratio;
+            j["node_sampling"] = jn;
+        }
+        if (opt.max_fanout) { j["max_fanout"] = classifier.max_fanout; }
+        if (opt.chunked_routing) { j["chunked_routing"] = classifier.chunk_min_size; }
+        if (opt.train_budget_s) { j["train_budget_s"] = opt.train_budget_s.value(); }
+        if (opt.node_budget) { j["node_budget"] = classifier.cost_budget; }
+        if (classifier.adaptive_sampler) {
+            // Statistics of the distances, and cost of the candidates against a uniform draw: compare the accuracy
+            // and the train time with a run without --adaptive-sampling
+            nlohmann::json ja;
+            nlohmann::json jf = nlohmann::json::array();
+            for (const auto &[family, weight]: classifier.adaptive_sampler->snapshot()) {
+                nlohmann::json f;
+                f["name"] = family.name;
+                f["nb_candidates"] = family.nb_candidates;
+                f["nb_wins"] = family.nb_wins;
+                f["mean_cost"] = family.mean_cost();
+                f["weight"] = weight;
+                jf.push_back(f);
+            }
+            ja["families"] = jf;
+            ja["expected_cost_ratio"] = classifier.adaptive_sampler->expected_cost_ratio();
+            j["adaptive_sampling"] = ja;
+        }
+        if (classifier.memo_max_entries) {
+            nlohmann::json jm;
+            jm["max_entries"] = classifier.memo_max_entries.value();
+            jm["lookups"] = classifier.memo_lookups;
+            jm["hits"] = classifier.memo_hits;
+            jm["hit_rate"] = classifier.memo_hit_rate();
+            j["test_memo"] = jm;
+        }
+        if (classifier.train_memo_max_entries) {
+            nlohmann::json jm;
+            jm["max_entries"] = classifier.train_memo_max_entries.value();
+            jm["lookups"] = classifier.train_memo_lookups;
+            jm["hits"] = classifier.train_memo_hits;
+            jm["hit_rate"] = classifier.train_memo_hit_rate();
+            j["train_memo"] = jm;
+        }
+        { // Memory: peak RSS, bytes held by the transforms and by the forest, allocations on training
+            nlohmann::json jm;
+            jm["peak_rss_kib"] = utils::memory::peak_rss_kib();
+            auto transforms_bytes = [](auto const &map) {
+                nlohmann::json jt = nlohmann::json::object();
+                for (const auto &[tn, dts]: map) { jt[tn] = transform_nb_bytes(dts); }
+                return jt;
+            };
+            jm["train_transforms_bytes"] = transforms_bytes(classifier.get_train_map());
+            jm["test_transforms_bytes"] = transforms_bytes(classifier.get_test_map());
+            const tsc::TreeMemory fm = classifier.forest_memory();
+            jm["forest_bytes"] = {
+                    {"nodes",     fm.nodes},
+                    {"splitters", fm.splitters},
+                    {"leaves",    fm.leaves},
+                    {"total",     fm.total()}
+            };
+            if constexpr (utils::memory::counting) { // Built with TEMPO_COUNT_ALLOCATIONS
+                jm["train_allocations"] = classifier.train_allocations.count;
+                jm["train_allocated_bytes"] = classifier.train_allocations.bytes;
+            }
+            j["memory"] = jm;
+        }
+        // CPU time versus wall time, per pool thread
+        if (classifier.train_usage) { j["train_usage"] = classifier.train_usage->to_json(); }
+        if (classifier.test_usage) { j["test_usage"] = classifier.test_usage->to_json(); }
+        {
+            const tsc::TreeStats ts = classifier.forest_stats();
+            nlohmann::json jt;
+            jt["nb_leaves"] = ts.nb_leaves;
+            jt["nb_nodes"] = ts.nb_nodes;
+            jt["max_depth"] = ts.depth;
+            jt["nb_train_exemplars"] = ts.nb_train_exemplars;
+            nlohmann::json js = nlohmann::json::object();
+            for (const auto &[kind, u]: ts.splitters) {
+                js[kind] = {{"nb_nodes", u.nb_nodes}, {"nb_exemplars", u.nb_exemplars}};
+            }
+            jt["splitters"] = js;
+            j["forest_stats"] = jt;
+        }
+        if constexpr (distance::stats::enabled) { // Built with TEMPO_DISTANCE_STATS: train and test, by distance
+            nlohmann::json jd;
+            for (auto const &[name, c]: distance::stats::collect()) {
+                nlohmann::json jc;
+                jc["calls"] = c.calls;
+                jc["cells"] = c.cells;
+                jc["matrix_cells"] = c.matrix;
+                jc["cells_ratio"] = c.cells_ratio();
+                jc["abandoned"] = c.abandoned;
+                jc["abandon_rate"] = c.abandon_rate();
+                jc["lb_tests"] = c.lb_tests;
+                jc["lb_prunes"] = c.lb_prunes;
+                jc["lb_prune_rate"] = c.lb_prune_rate();
+                jd[name] = jc;
+            }
+            j["distance_stats"] = jd;
+        }
         jv["classifier_info"] = j;
     }
 
+    if (classifier.sampling_ratio && (!opt.model_input || opt.grow)) { // Out-of-bag results (of the new trees)
+        nlohmann::json j;
+        j["sampling_ratio"] = classifier.sampling_ratio.value();
+        if (classifier.sampling_max_per_class) {
+            j["sampling_max_per_class"] = classifier.sampling_max_per_class.value();
+        }
+        j["nb_exemplars"] = classifier.oob_nb_exemplars;
+        j["nb_corrects"] = classifier.oob_nb_correct;
+        j["accuracy"] = classifier.oob_nb_exemplars == 0 ? 0.0 :
+                        (double) classifier.oob_nb_correct / (double) classifier.oob_nb_exemplars;
+        j["oob_time_ns"] = classifier.oob_time.count();
+        j["oob_time_human"] = utils::as_string(classifier.oob_time);
+        jv["oob"] = j;
+    }
+
     { // 01 loss results
         nlohmann::json j;
         j["nb_corrects"] = (int) nb_correct;
@@ -164,6 +803,12 @@ int main(int argc, char **argv) {
         jv["01loss"] = j;
     }
 
+    if (opt.trace_output) {
+        utils::Tracer::global().disable();
+        try { utils::Tracer::global().write(opt.trace_output.value()); }
+        catch (std::exception const &e) { do_exit(1, e.what()); }
+    }
+
     cout << jv.dump(2) << endl;
 
     if (opt.output) {
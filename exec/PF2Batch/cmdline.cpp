@@ -0,0 +1,67 @@
+#include "cmdline.hpp"
+
+#include <tclap/CmdLine.h>
+#include <tempo/utils/utils/resources.hpp>
+#include <string>
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv) {
+  using namespace std;
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Command line parsing
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  try {
+
+    // --- --- --- Build the cmd parser
+    TCLAP::CmdLine cmd("PF2 batch runner: train and test PF2 for a list of jobs (UCR dataset, fold, seed, forest"
+      " configuration) in one process, sharing its thread pool, writing one JSON line per job", ' ', "0.0.1");
+
+    // --- Jobs
+    TCLAP::ValueArg<string> ucr("", "ucr", "path to the UCR archive", true, "", "string", cmd);
+    TCLAP::ValueArg<string> jobs("j", "jobs", "JSON lines file, one job per line: {\"dataset\": name, \"fold\": f,"
+      " \"seed\": s, \"nb_trees\": t, \"nb_candidates\": c}; fold 0 is the original split, the others are stratified"
+      " resamples of it; the fields but the dataset are optional", true, "", "string", cmd);
+
+    // --- Default forest config
+    TCLAP::ValueArg<int> nbt("t", "nb-trees", "Default number of trees", false, 100, "int", cmd);
+    TCLAP::ValueArg<int> nbc("c", "nb-candidates", "Default number of candidates", false, 5, "int", cmd);
+    TCLAP::ValueArg<int> seed("", "seed", "Default seed of the forest and of the tie breaks", false, 0, "int", cmd);
+
+    // --- Parallelism
+    TCLAP::ValueArg<int> nbp("p", "nb-threads", "Number of threads - use <=0 for autodetect", false, 1, "int", cmd);
+    TCLAP::SwitchArg pin("", "pin-threads", "pin the worker threads to the CPUs (Linux only)", cmd, false);
+    TCLAP::ValueArg<int> big("", "big-bytes", "jobs whose train file has at least this size use all the threads and"
+      " start first; the smaller ones run concurrently, with one thread each", false, 1 << 20, "int", cmd);
+    TCLAP::ValueArg<int> prefetch("", "prefetch", "number of datasets read and transformed ahead of their jobs by a"
+      " loader thread, while the jobs compute; 0 to load them in the jobs", false, 2, "int", cmd);
+
+    // --- Output
+    TCLAP::ValueArg<string> out("o", "out", "path to the JSON lines output, one line per job in completion order",
+      true, "", "string", cmd);
+
+    // --- --- --- Parse the argv array.
+    cmd.parse(argc, argv);
+
+    // --- --- --- Get options
+    cmdopt opt{};
+    opt.ucr_dir = fs::path(ucr.getValue());
+    opt.jobs = fs::path(jobs.getValue());
+    if(nbt.getValue()<=0){ return {"--nb-trees expects a positive number"}; }
+    opt.nb_trees = (size_t)nbt.getValue();
+    if(nbc.getValue()<=0){ return {"--nb-candidates expects a positive number"}; }
+    opt.nb_candidates = (size_t)nbc.getValue();
+    if(seed.getValue()<0){ return {"--seed expects a non negative number"}; }
+    opt.seed = (size_t)seed.getValue();
+    opt.nb_threads = nbp.getValue()<=0 ? (int)tempo::utils::resources::available_cpus() : nbp.getValue();
+    opt.pin_threads = pin.getValue();
+    if(big.getValue()<0){ return {"--big-bytes expects a non negative number"}; }
+    opt.big_bytes = (size_t)big.getValue();
+    if(prefetch.getValue()<0){ return {"--prefetch expects a non negative number"}; }
+    opt.prefetch = (size_t)prefetch.getValue();
+    opt.output = fs::path(out.getValue());
+
+    return {opt};
+
+  } catch (TCLAP::ArgException& e)  // catch exceptions
+  { return {std::string("error: " + e.error() + " for arg " + e.argId())}; }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <variant>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+struct cmdopt {
+  fs::path ucr_dir;
+  fs::path jobs;
+  size_t nb_trees;
+  size_t nb_candidates;
+  size_t seed;
+  int nb_threads;
+  bool pin_threads;
+  size_t big_bytes;
+  /// Number of datasets loaded ahead of their jobs; 0 to load them in the jobs
+  size_t prefetch;
+  fs::path output;
+};
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv);
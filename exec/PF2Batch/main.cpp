@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <tempo/dataset/dts.hpp>
+#include <tempo/reader/dts.reader.hpp>
+#include <tempo/reader/reader.hpp>
+#include <tempo/transform/pipeline.hpp>
+
+#include <nlohmann/json.hpp>
+#include "cmdline.hpp"
+
+#include "tempo/classifier/ProximityForest2/pf2.hpp"
+
+using namespace std;
+using namespace tempo;
+
+namespace fs = std::filesystem;
+
+[[noreturn]] void do_exit(int code, std::optional<std::string> msg = {}) {
+    if (msg) { std::cerr << msg.value() << std::endl; }
+    exit(code);
+}
+
+cmdopt getcmdopt(int argc, char **argv) {
+    cmdopt opt;
+    variant<string, cmdopt> mb_opt = parse_cmd(argc, argv);
+    switch (mb_opt.index()) {
+        case 0: {
+            cerr << "Error: " << std::get<0>(mb_opt) << std::endl;
+            exit(1);
+        }
+        case 1: {
+            opt = std::get<1>(mb_opt);
+        }
+    }
+    return opt;
+}
+
+/// One train/test run
+struct Job {
+    std::string dataset;
+    size_t fold;
+    size_t seed;
+    size_t nb_trees;
+    size_t nb_candidates;
+    /// Size of the train file: big jobs use all the threads
+    size_t train_bytes;
+};
+
+/// Read the jobs, one JSON object per line, with the defaults of 'opt'
+std::vector<Job> read_jobs(cmdopt const &opt) {
+    std::ifstream in(opt.jobs);
+    if (!in) { do_exit(1, "Cannot open jobs " + opt.jobs.string()); }
+    std::vector<Job> jobs;
+    size_t line_nb = 0;
+    for (std::string line; std::getline(in, line);) {
+        ++line_nb;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) { continue; }
+        const std::string where = opt.jobs.string() + ":" + std::to_string(line_nb) + ": ";
+        nlohmann::json j = nlohmann::json::parse(line, nullptr, false);
+        if (j.is_discarded() || !j.is_object() || !j.contains("dataset") || !j.at("dataset").is_string()) {
+            do_exit(1, where + "expects a JSON object with a \"dataset\"");
+        }
+        Job job;
+        try {
+            job.dataset = j.at("dataset").get<std::string>();
+            job.fold = j.value("fold", (size_t) 0);
+            job.seed = j.value("seed", opt.seed);
+            job.nb_trees = j.value("nb_trees", opt.nb_trees);
+            job.nb_candidates = j.value("nb_candidates", opt.nb_candidates);
+        } catch (std::exception const &e) { do_exit(1, where + e.what()); }
+        if (job.nb_trees == 0 || job.nb_candidates == 0) { do_exit(1, where + "expects positive numbers"); }
+        std::error_code ec;
+        const fs::path train_path = opt.ucr_dir / job.dataset / (job.dataset + "_TRAIN.ts");
+        job.train_bytes = (size_t) fs::file_size(train_path, ec);
+        if (ec) { do_exit(1, where + "cannot read " + train_path.string()); }
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+/// Datasets loaded once for all their jobs, and released after the last one.
+/// With a prefetch depth, a loader thread reads and transforms the datasets ahead, in the order of the jobs, while the
+/// jobs compute: at most 'depth' datasets are loaded ahead of the jobs using them, bounding the memory.
+/// The loader runs on its own thread, with one thread, leaving the pool to the jobs.
+class DatasetCache {
+    struct Entry {
+        enum class State { none, loading, ready };
+        State state{State::none};
+        /// Loaded (or being loaded) by the loader, not yet used by a job
+        bool prefetched{false};
+        std::shared_ptr<reader::dataset::Resamples const> data;
+        std::string error;
+        size_t nb_remaining{0};
+    };
+
+    fs::path ucr_dir;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::map<std::string, Entry> entries;
+    /// Datasets in the order of their first job
+    std::vector<std::string> order;
+    size_t depth;
+    size_t nb_prefetched{0};
+    bool stop{false};
+    std::thread loader;
+
+public:
+
+    DatasetCache(fs::path ucr_dir, std::vector<Job> const &jobs, size_t depth) :
+            ucr_dir(std::move(ucr_dir)), depth(depth) {
+        for (Job const &job: jobs) {
+            if (entries[job.dataset].nb_remaining++ == 0) { order.push_back(job.dataset); }
+        }
+        if (depth > 0) { loader = std::thread([this]() { prefetch(); }); }
+    }
+
+    ~DatasetCache() {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        cv.notify_all();
+        if (loader.joinable()) { loader.join(); }
+    }
+
+    /// The resamples of the dataset of a job, with their transforms: prefetched, or else loaded with 'nb_threads' by
+    /// its first job. Throws std::runtime_error if it can not be loaded. Call 'done' once the job is over.
+    std::shared_ptr<reader::dataset::Resamples const> get(std::string const &name, size_t nb_threads) {
+        std::unique_lock lock(mutex);
+        Entry &entry = entries.at(name);
+        cv.wait(lock, [&entry]() { return entry.state != Entry::State::loading; });
+        if (entry.state == Entry::State::none) {
+            entry.state = Entry::State::loading;
+            lock.unlock();
+            fill(entry, name, nb_threads);
+            lock.lock();
+        }
+        if (entry.prefetched) {
+            entry.prefetched = false;
+            --nb_prefetched;
+            cv.notify_all();
+        }
+        if (!entry.error.empty()) { throw std::runtime_error(entry.error); }
+        return entry.data;
+    }
+
+    void done(std::string const &name) {
+        std::lock_guard lock(mutex);
+        Entry &entry = entries.at(name);
+        if (--entry.nb_remaining == 0) { entry.data.reset(); }
+    }
+
+private:
+
+    /// Load and transform a dataset with 'nb_threads'. Throws std::runtime_error if it can not be loaded.
+    std::shared_ptr<reader::dataset::Resamples const> load(std::string const &name, size_t nb_threads) const {
+        reader::dataset::ts_ucr ucr{};
+        ucr.ucr_dir = ucr_dir;
+        ucr.name = name;
+        auto read_dataset_result = reader::dataset::load(ucr, nb_threads);
+        if (read_dataset_result.index() == 0) { throw std::runtime_error(std::get<0>(read_dataset_result)); }
+        auto data = std::make_shared<reader::dataset::TrainTest>(std::get<1>(std::move(read_dataset_result)));
+        if (auto errors = reader::dataset::sanity_check(*data); !errors.empty()) {
+            throw std::runtime_error(utils::cat(errors, "; "));
+        }
+        // The transforms are computed once on the merged splits, and shared by all the folds
+        auto resamples = std::make_shared<reader::dataset::Resamples>(data);
+        const std::vector<std::string> names{"derivative1"};
+        auto derived = transform::transform_fused(resamples->merged(), names, transform::derived_kernel(names),
+                                                  nb_threads);
+        for (auto &[tname, dts]: derived) {
+            resamples->add_transform(tname, std::move(dts));
+        }
+        return resamples;
+    }
+
+    /// Load an entry marked as loading, outside the lock, then make it ready
+    void fill(Entry &entry, std::string const &name, size_t nb_threads) {
+        std::shared_ptr<reader::dataset::Resamples const> data;
+        std::string error;
+        try { data = load(name, nb_threads); }
+        catch (std::exception const &e) { error = e.what(); }
+        {
+            std::lock_guard lock(mutex);
+            entry.data = std::move(data);
+            entry.error = std::move(error);
+            entry.state = Entry::State::ready;
+        }
+        cv.notify_all();
+    }
+
+    /// Loader thread: load the datasets not yet loaded by their jobs, in order, up to 'depth' ahead
+    void prefetch() {
+        for (std::string const &name: order) {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this]() { return stop || nb_prefetched < depth; });
+            if (stop) { return; }
+            Entry &entry = entries.at(name);
+            if (entry.state != Entry::State::none) { continue; }
+            entry.state = Entry::State::loading;
+            entry.prefetched = true;
+            ++nb_prefetched;
+            lock.unlock();
+            fill(entry, name, 1);
+        }
+    }
+};
+
+/// Train and test PF2 for a job with 'nb_threads' on a fold, with its transforms
+nlohmann::json run(Job const &job, reader::dataset::Resamples::Fold const &fold, int nb_threads) {
+    DTS const &train_dataset = fold.train.at("default");
+    DTS const &test_dataset = fold.test.at("default");
+    DatasetHeader const &train_header = train_dataset.header();
+    DatasetHeader const &test_header = test_dataset.header();
+
+    classifier::TSChief::TreeState tstate(job.seed, 0);
+    classifier::ProximityForest2 classifier(train_dataset, train_header, job.nb_candidates, job.nb_trees, tstate);
+    classifier.train_transforms = fold.train;
+    classifier.test_transforms = fold.test;
+    // Jobs run concurrently: no messages, progress reported in memory, only to count the distances
+    classifier.log = nullptr;
+    std::ostringstream progress_sink;
+    classifier.set_progress(progress_sink, std::chrono::hours(1));
+    classifier.train(nb_threads);
+
+    classifier::ResultN result = classifier.predict(test_dataset, nb_threads);
+    PRNG prng(job.seed);
+    // The test split views the merged dataset: its labels are read through its index set
+    const size_t nb_correct = result.nb_correct_01loss(test_header, test_dataset.index_set(), prng);
+
+    nlohmann::json j;
+    j["nb_threads"] = nb_threads;
+    j["train_time_ns"] = classifier.train_time.count();
+    j["train_time_human"] = utils::as_string(classifier.train_time);
+    j["test_time_ns"] = classifier.test_time.count();
+    j["test_time_human"] = utils::as_string(classifier.test_time);
+    j["train_nb_distances"] = classifier.train_nb_distances;
+    j["nb_corrects"] = nb_correct;
+    j["accuracy"] = test_dataset.size() == 0 ? 0.0 : (double) nb_correct / (double) test_dataset.size();
+    return j;
+}
+
+int main(int argc, char **argv) {
+
+    cmdopt opt = getcmdopt(argc, argv);
+
+    if (opt.pin_threads && !utils::ThreadPool::global().pin_workers()) {
+        std::cerr << "Warning: could not pin the worker threads" << std::endl;
+    }
+
+    // --- --- --- Jobs, biggest first. The big ones run one at a time with all the threads, then the small ones run
+    // concurrently with one thread each.
+    std::vector<Job> jobs = read_jobs(opt);
+    std::stable_sort(jobs.begin(), jobs.end(), [](Job const &a, Job const &b) {
+        return a.train_bytes > b.train_bytes;
+    });
+    const size_t nb_big = (size_t) std::count_if(jobs.begin(), jobs.end(), [&opt](Job const &job) {
+        return job.train_bytes >= opt.big_bytes;
+    });
+    DatasetCache cache(opt.ucr_dir, jobs, opt.prefetch);
+
+    std::ofstream out(opt.output);
+    if (!out) { do_exit(1, "Cannot open " + opt.output.string()); }
+    std::mutex out_mutex;
+    size_t nb_failed = 0;
+
+    // Run a job, writing its JSON line (with an "error" if it fails)
+    auto run_job = [&](Job const &job, int nb_threads) {
+        nlohmann::json j;
+        // Time waiting for the dataset: none when it was prefetched in time
+        utils::duration_t load_wait{0};
+        try {
+            const auto start = utils::now();
+            auto data = cache.get(job.dataset, (size_t) nb_threads);
+            load_wait = utils::now() - start;
+            const reader::dataset::Resamples::Fold fold = data->fold(job.fold);
+            j = run(job, fold, nb_threads);
+        } catch (std::exception const &e) { j["error"] = e.what(); }
+        j["load_wait_ns"] = load_wait.count();
+        cache.done(job.dataset);
+        j["dataset"] = job.dataset;
+        j["fold"] = job.fold;
+        j["seed"] = job.seed;
+        j["nb_trees"] = job.nb_trees;
+        j["nb_candidates"] = job.nb_candidates;
+        std::lock_guard lock(out_mutex);
+        if (j.contains("error")) { ++nb_failed; }
+        out << j.dump() << std::endl;
+        std::cout << job.dataset << " fold " << job.fold << ": "
+                  << (j.contains("error") ? "error: " + j.at("error").get<std::string>()
+                                          : "accuracy " + std::to_string(j.at("accuracy").get<double>()))
+                  << std::endl;
+    };
+
+    for (size_t i = 0; i < nb_big; ++i) { run_job(jobs[i], opt.nb_threads); }
+
+    utils::ParTasks p;
+    p.execute(opt.nb_threads, [&](size_t i) { run_job(jobs[i], 1); }, nb_big, jobs.size());
+
+    std::cout << jobs.size() << " jobs, " << nb_failed << " failed" << std::endl;
+    return nb_failed == 0 ? 0 : 2;
+}
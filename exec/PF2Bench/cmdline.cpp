@@ -0,0 +1,153 @@
+#include "cmdline.hpp"
+
+#include <tclap/CmdLine.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// Comma separated positive numbers
+static std::optional<std::vector<size_t>> parse_sizes(std::string const& str) {
+  std::vector<size_t> result;
+  std::istringstream iss(str);
+  std::string item;
+  while (std::getline(iss, item, ',')) {
+    try {
+      const long long n = std::stoll(item);
+      if(n<=0){ return {}; }
+      result.push_back((size_t)n);
+    } catch (std::exception const&) { return {}; }
+  }
+  if(result.empty()){ return {}; }
+  return {result};
+}
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv) {
+  using namespace std;
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Command line parsing
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  try {
+
+    // --- --- --- Build the cmd parser
+    TCLAP::CmdLine cmd("PF2 benchmark: train and predict UCR datasets, or synthetic ones, with fixed seeds", ' ',
+      "0.0.1");
+
+    // --- Datasets
+    TCLAP::ValueArg<string> ucr("", "ucr", "path to the UCR archive", false, "", "string", cmd);
+    TCLAP::UnlabeledMultiArg<string> ds("datasets", "names of the UCR datasets", false, "strings", cmd);
+
+    // --- Synthetic datasets, for the scaling beyond the UCR sizes
+    TCLAP::ValueArg<string> synth("", "synthetic", "comma separated numbers of train series (e.g. 10000,1000000):"
+      " benchmark synthetic datasets of that sizes, for each length and number of classes, reporting the scaling"
+      " exponent of the times between consecutive sizes", false, "", "string", cmd);
+    TCLAP::ValueArg<string> synth_length("", "synthetic-length", "comma separated lengths of the synthetic series",
+      false, "128", "string", cmd);
+    TCLAP::ValueArg<string> synth_classes("", "synthetic-classes", "comma separated numbers of classes of the"
+      " synthetic datasets", false, "10", "string", cmd);
+    TCLAP::ValueArg<int> synth_test("", "synthetic-test", "number of test series of the synthetic datasets", false,
+      1000, "int", cmd);
+    TCLAP::ValueArg<double> synth_noise("", "synthetic-noise", "noise added to the class prototypes (random walks with"
+      " steps in [-1, 1]) of the synthetic series", false, 1.0, "double", cmd);
+
+    // --- Forest config
+    TCLAP::ValueArg<string> pfconfig("", "pfc", "Classifier configuration: pf2, pf2018, tschief, or distances separated"
+      " by ':' (see classifier::make_classifier)", false, "pf2", "PF Configuration", cmd);
+    TCLAP::ValueArg<int> nbt("t", "nb-trees", "Number of trees", false, 100, "int", cmd);
+    TCLAP::ValueArg<int> nbc("c", "nb-candidates", "Number of candidates", false, 5, "int", cmd);
+    TCLAP::ValueArg<int> seed("", "seed", "Seed of the forest and of the tie breaks", false, 0, "int", cmd);
+
+    // --- Parallelism
+    TCLAP::ValueArg<string> nbp("p", "nb-threads", "Comma separated numbers of threads, each one benchmarked;"
+      " 'a..b' stands for the powers of 2 times 'a' up to 'b' (e.g. 1..128)", false, "1", "string", cmd);
+    TCLAP::SwitchArg pin("", "pin-threads", "pin the worker threads to the CPUs (Linux only)", cmd, false);
+    TCLAP::SwitchArg interleave("", "numa-interleave", "interleave the train data over the NUMA nodes (Linux only)",
+      cmd, false);
+    TCLAP::ValueArg<string> huge_pages("", "huge-pages", "store the series and the large tables on huge pages"
+      " (Linux only): off, thp (transparent huge pages) or hugetlb (reserved huge pages, else thp)", false, "off",
+      "string", cmd);
+
+    // --- Output and baseline
+    TCLAP::ValueArg<string> out("o", "out", "path to output json file, usable as a baseline", false, "", "string",
+      cmd);
+    TCLAP::ValueArg<string> baseline("", "baseline", "path to a previous output: report the differences and fail on"
+      " regressions", false, "", "string", cmd);
+    TCLAP::ValueArg<double> tolerance("", "tolerance", "with --baseline, relative slowdown of the train or test time"
+      " above which a run is a regression", false, 0.1, "double", cmd);
+    TCLAP::ValueArg<double> acc_tolerance("", "accuracy-tolerance", "with --baseline made by a build of the other"
+      " floating point precision (see TEMPO_FLOAT32), drop of the accuracy above which a run is a regression; the"
+      " times are only reported", false, 0.01, "double", cmd);
+
+    // --- --- --- Parse the argv array.
+    cmd.parse(argc, argv);
+
+    // --- --- --- Get options
+    cmdopt opt{};
+    opt.ucr_dir = fs::path(ucr.getValue());
+    opt.datasets = ds.getValue();
+    if(!opt.datasets.empty() && !ucr.isSet()){ return {"UCR datasets require --ucr"}; }
+    if(synth.isSet()){
+      auto sizes = parse_sizes(synth.getValue());
+      if(!sizes){ return {"--synthetic expects comma separated positive numbers"}; }
+      opt.synthetic_sizes = sizes.value();
+      std::sort(opt.synthetic_sizes.begin(), opt.synthetic_sizes.end());
+      auto lengths = parse_sizes(synth_length.getValue());
+      if(!lengths){ return {"--synthetic-length expects comma separated positive numbers"}; }
+      opt.synthetic_lengths = lengths.value();
+      auto classes = parse_sizes(synth_classes.getValue());
+      if(!classes){ return {"--synthetic-classes expects comma separated positive numbers"}; }
+      opt.synthetic_classes = classes.value();
+    }
+    if(opt.datasets.empty() && opt.synthetic_sizes.empty()){ return {"No UCR dataset and no --synthetic"}; }
+    if(synth_test.getValue()<=0){ return {"--synthetic-test expects a positive number"}; }
+    opt.synthetic_test = (size_t)synth_test.getValue();
+    if(synth_noise.getValue()<0){ return {"--synthetic-noise expects a non negative number"}; }
+    opt.synthetic_noise = synth_noise.getValue();
+    opt.classifier = pfconfig.getValue();
+    if(nbt.getValue()<=0){ return {"--nb-trees expects a positive number"}; }
+    opt.nb_trees = (size_t)nbt.getValue();
+    if(nbc.getValue()<=0){ return {"--nb-candidates expects a positive number"}; }
+    opt.nb_candidates = (size_t)nbc.getValue();
+    if(seed.getValue()<0){ return {"--seed expects a non negative number"}; }
+    opt.seed = (size_t)seed.getValue();
+    {
+      std::istringstream iss(nbp.getValue());
+      std::string item;
+      while (std::getline(iss, item, ',')) {
+        try {
+          if (const size_t dots = item.find(".."); dots!=std::string::npos) {
+            const int first = std::stoi(item.substr(0, dots));
+            const int last = std::stoi(item.substr(dots + 2));
+            if(first<=0||last<first){ return {"--nb-threads expects ranges 'a..b' with 0<a<=b"}; }
+            for (int n = first; n<=last; n *= 2) { opt.nb_threads.push_back(n); }
+          } else {
+            const int n = std::stoi(item);
+            if(n<=0){ return {"--nb-threads expects positive numbers"}; }
+            opt.nb_threads.push_back(n);
+          }
+        } catch (std::exception const&) { return {"--nb-threads expects comma separated numbers"}; }
+      }
+      if(opt.nb_threads.empty()){ return {"--nb-threads expects at least one number"}; }
+    }
+    opt.pin_threads = pin.getValue();
+    opt.numa_interleave = interleave.getValue();
+    {
+      const auto mode = tempo::utils::memory::parse_huge_pages(huge_pages.getValue());
+      if(!mode){ return {"--huge-pages expects off, thp or hugetlb"}; }
+      opt.huge_pages = mode.value();
+    }
+    if(out.isSet()){ opt.output = {out.getValue()}; }
+    if(baseline.isSet()){ opt.baseline = {baseline.getValue()}; }
+    if(tolerance.getValue()<0){ return {"--tolerance expects a non negative number"}; }
+    opt.tolerance = tolerance.getValue();
+    if(acc_tolerance.getValue()<0||acc_tolerance.getValue()>1){
+      return {"--accuracy-tolerance expects a number in [0, 1]"};
+    }
+    opt.accuracy_tolerance = acc_tolerance.getValue();
+
+    return {opt};
+
+  } catch (TCLAP::ArgException& e)  // catch exceptions
+  { return {std::string("error: " + e.error() + " for arg " + e.argId())}; }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <tempo/utils/utils/memory.hpp>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+struct cmdopt {
+  fs::path ucr_dir;
+  std::vector<std::string> datasets;
+  /// Synthetic datasets: grid of numbers of train series, lengths and numbers of classes (see mock::Mocker)
+  std::vector<size_t> synthetic_sizes;
+  std::vector<size_t> synthetic_lengths;
+  std::vector<size_t> synthetic_classes;
+  size_t synthetic_test;
+  double synthetic_noise;
+  std::string classifier;
+  size_t nb_trees;
+  size_t nb_candidates;
+  std::vector<int> nb_threads;
+  bool pin_threads;
+  bool numa_interleave;
+  tempo::utils::memory::HugePages huge_pages;
+  size_t seed;
+  std::optional<fs::path> output;
+  std::optional<fs::path> baseline;
+  double tolerance;
+  double accuracy_tolerance;
+};
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv);
@@ -0,0 +1,341 @@
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <sstream>
+
+#include <tempo/dataset/dts.hpp>
+#include <tempo/reader/dts.reader.hpp>
+#include <tempo/reader/reader.hpp>
+#include <tempo/utils/utils/resources.hpp>
+
+#include <mock/mockseries.hpp>
+
+#include <nlohmann/json.hpp>
+#include "cmdline.hpp"
+
+#include "tempo/classifier/make_classifier.hpp"
+
+using namespace std;
+using namespace tempo;
+
+namespace fs = std::filesystem;
+
+[[noreturn]] void do_exit(int code, std::optional<std::string> msg = {}) {
+    if (msg) { std::cerr << msg.value() << std::endl; }
+    exit(code);
+}
+
+cmdopt getcmdopt(int argc, char **argv) {
+    cmdopt opt;
+    variant<string, cmdopt> mb_opt = parse_cmd(argc, argv);
+    switch (mb_opt.index()) {
+        case 0: {
+            cerr << "Error: " << std::get<0>(mb_opt) << std::endl;
+            exit(1);
+        }
+        case 1: {
+            opt = std::get<1>(mb_opt);
+        }
+    }
+    return opt;
+}
+
+/// Synthetic split of 'size' series, of the classes of 'prototypes' in turn (see mock::Mocker::class_randvec).
+/// The series are generated concurrently by chunks, each one with its own seed drawn from 'seed':
+/// the same split for the same arguments, whatever the number of threads.
+DTS synthetic_split(std::vector<std::vector<F>> const &prototypes, size_t size, double noise, size_t seed,
+                    std::string const &split_name, LabelEncoder const &encoder, int nb_threads) {
+    constexpr size_t chunk_size = 4096;
+    const size_t nb_chunks = (size + chunk_size - 1) / chunk_size;
+    std::vector<unsigned int> seeds(nb_chunks);
+    {
+        PRNG seeder(seed);
+        for (auto &s: seeds) { s = (unsigned int) seeder(); }
+    }
+    std::vector<std::vector<TSeries>> chunks(nb_chunks);
+    utils::ParTasks p;
+    p.execute(nb_threads, [&](size_t c) {
+        mock::Mocker<F> mocker(seeds[c]);
+        for (size_t i = c * chunk_size; i < std::min(size, (c + 1) * chunk_size); ++i) {
+            const size_t k = i % prototypes.size();
+            chunks[c].push_back(TSeries::mk_from_rowmajor(
+                    mocker.class_randvec(prototypes[k], noise), 1, {"c" + std::to_string(k)}, {false}
+            ));
+        }
+    }, 0, nb_chunks);
+    reader::TSData tsdata;
+    tsdata.problem_name = {"synthetic"};
+    tsdata.nb_dimensions = 1;
+    tsdata.shortest_length = prototypes.front().size();
+    tsdata.longest_length = prototypes.front().size();
+    tsdata.series.reserve(size);
+    for (auto &chunk: chunks) {
+        for (auto &ts: chunk) { tsdata.series.push_back(std::move(ts)); }
+    }
+    return reader::tsdata_to_dts(std::move(tsdata), split_name, encoder);
+}
+
+/// Train and test the classifier of 'opt' on a dataset with 'nb_threads', with the seeds of 'opt'
+nlohmann::json run(cmdopt const &opt, std::string const &name, DTS const &train_dataset, DTS const &test_dataset,
+                   int nb_threads) {
+    DatasetHeader const &train_header = train_dataset.header();
+    DatasetHeader const &test_header = test_dataset.header();
+
+    // Same seeds for all the runs: same forest whatever the number of threads
+    classifier::TSChief::TreeState tstate(opt.seed, 0);
+    std::unique_ptr<classifier::i_Classifier> classifier = classifier::make_classifier(
+            opt.classifier, train_dataset, train_header, opt.nb_candidates, opt.nb_trees, tstate
+    );
+
+    // Progress reported in memory, only to count the distances
+    std::ostringstream progress_sink;
+    // Options of the PF2 engine, shared by all the configurations
+    if (auto *pf = dynamic_cast<classifier::ProximityForest2 *>(classifier.get()); pf != nullptr) {
+        pf->numa_interleave = opt.numa_interleave;
+        pf->set_progress(progress_sink, std::chrono::hours(1));
+    }
+    // Data TLB misses of the training and the prediction, when the kernel lets us count them.
+    // The workers of the pool being counted, create it first.
+    utils::ThreadPool::global();
+    const utils::memory::DTLBMisses dtlb;
+    // Peak memory of the training alone: from the memory held before it (e.g. the datasets)
+    const bool train_peak = utils::memory::reset_peak_rss();
+    classifier->train(nb_threads);
+    const size_t train_peak_rss_kib = utils::memory::peak_rss_since_reset_kib();
+
+    classifier::ResultN result = classifier->predict_batch(test_dataset, nb_threads);
+    const std::optional<uint64_t> dtlb_misses = dtlb.read();
+    PRNG prng(opt.seed);
+    const size_t nb_correct = result.nb_correct_01loss(test_header, IndexSet(test_header.size()), prng);
+
+    const std::map<std::string, double> stats = classifier->stats();
+    const utils::duration_t train_time((utils::duration_t::rep) stats.at("train_time_ns"));
+    const utils::duration_t test_time((utils::duration_t::rep) stats.at("test_time_ns"));
+    nlohmann::json j;
+    j["dataset"] = name;
+    j["nb_threads"] = nb_threads;
+    j["train_time_ns"] = train_time.count();
+    j["train_time_human"] = utils::as_string(train_time);
+    j["test_time_ns"] = test_time.count();
+    j["test_time_human"] = utils::as_string(test_time);
+    j["train_nb_distances"] = (size_t) stats.at("train_nb_distances");
+    j["memory_footprint"] = classifier->memory_footprint();
+    j["nb_corrects"] = nb_correct;
+    j["accuracy"] = (double) nb_correct / (double) test_header.size();
+    j["peak_rss_kib"] = utils::memory::peak_rss_kib();
+    if (train_peak) { j["train_peak_rss_kib"] = train_peak_rss_kib; }
+    if (dtlb_misses) { j["dtlb_read_misses"] = dtlb_misses.value(); }
+    // Breakdown of the run reported by the classifier (e.g. nodes, depth, memo hit rates)
+    j["stats"] = stats;
+    return j;
+}
+
+/// Compare the runs with the ones of a baseline, by dataset and number of threads.
+/// Record the differences in each run ("baseline" entry) and return the number of regressions:
+/// train or test time slower by more than 'tolerance', or different accuracy (the seeds being fixed).
+/// Against a baseline of the other floating point precision ('accuracy_tolerance' given), the forests may differ:
+/// a regression is an accuracy below the one of the baseline by more than 'accuracy_tolerance', or a run missing from
+/// the baseline; the times are only reported.
+size_t diff_baseline(nlohmann::json &runs, nlohmann::json const &baseline, double tolerance,
+                     std::optional<double> accuracy_tolerance) {
+    size_t nb_regressions = 0;
+    for (auto &r: runs) {
+        const auto b = std::find_if(baseline.begin(), baseline.end(), [&r](nlohmann::json const &br) {
+            return br.at("dataset") == r.at("dataset") && br.at("nb_threads") == r.at("nb_threads");
+        });
+        if (b == baseline.end()) {
+            if (accuracy_tolerance) {
+                ++nb_regressions;
+                std::cout << "Regression: " << r.at("dataset").get<std::string>() << " with " << r.at("nb_threads")
+                          << " threads: not in the baseline" << std::endl;
+            }
+            continue;
+        }
+        nlohmann::json d;
+        bool regression = false;
+        for (const std::string key: {"train_time_ns", "test_time_ns"}) {
+            const double ratio = b->at(key).get<double>() > 0 ?
+                                 r.at(key).get<double>() / b->at(key).get<double>() : 1.0;
+            d[key + "_ratio"] = ratio;
+            if (!accuracy_tolerance) { regression = regression || ratio > 1.0 + tolerance; }
+        }
+        const double accuracy_delta = r.at("accuracy").get<double>() - b->at("accuracy").get<double>();
+        d["accuracy_delta"] = accuracy_delta;
+        if (accuracy_tolerance) { regression = regression || accuracy_delta < -accuracy_tolerance.value(); }
+        else { regression = regression || r.at("nb_corrects") != b->at("nb_corrects"); }
+        // Informative: the number of distances changes with the pruning, not only with the results
+        d["train_nb_distances_delta"] = (int64_t) r.at("train_nb_distances").get<size_t>()
+                                        - (int64_t) b->at("train_nb_distances").get<size_t>();
+        // Informative: e.g. with and without --huge-pages
+        if (r.contains("dtlb_read_misses") && b->contains("dtlb_read_misses")) {
+            const double bm = b->at("dtlb_read_misses").get<double>();
+            d["dtlb_read_misses_ratio"] = bm > 0 ? r.at("dtlb_read_misses").get<double>() / bm : 1.0;
+        }
+        d["regression"] = regression;
+        r["baseline"] = d;
+        if (regression) {
+            ++nb_regressions;
+            std::cout << "Regression: " << r.at("dataset").get<std::string>() << " with " << r.at("nb_threads")
+                      << " threads: " << d.dump() << std::endl;
+        }
+    }
+    return nb_regressions;
+}
+
+int main(int argc, char **argv) {
+
+    cmdopt opt = getcmdopt(argc, argv);
+    utils::memory::set_huge_pages(opt.huge_pages);
+
+    // Before reading the data: pages are placed on the NUMA node of the thread touching them first
+    if (opt.pin_threads && !utils::ThreadPool::global().pin_workers()) {
+        std::cerr << "Warning: could not pin the worker threads" << std::endl;
+    }
+
+    const std::string float_type = std::is_same_v<F, float> ? "float" : "double";
+
+    // --- --- --- Baseline, read first: fail before running anything
+    std::optional<nlohmann::json> baseline;
+    // Set against a baseline of the other floating point precision, e.g. a float build against a double one
+    std::optional<double> accuracy_tolerance;
+    if (opt.baseline) {
+        std::ifstream in(opt.baseline.value());
+        if (!in) { do_exit(1, "Cannot open baseline " + opt.baseline.value().string()); }
+        nlohmann::json j = nlohmann::json::parse(in, nullptr, false);
+        if (j.is_discarded() || !j.contains("runs") || !j.contains("config")) {
+            do_exit(1, "Not a benchmark output: " + opt.baseline.value().string());
+        }
+        baseline = j.at("runs");
+        nlohmann::json const &bconfig = j.at("config");
+        if (bconfig.value("float_type", float_type) != float_type) {
+            // Only the precision may differ: same forests, up to the rounding
+            const nlohmann::json forest{{"classifier",    opt.classifier},
+                                        {"nb_trees",      opt.nb_trees},
+                                        {"nb_candidates", opt.nb_candidates},
+                                        {"seed",          opt.seed}};
+            for (auto const &[key, value]: forest.items()) {
+                if (bconfig.at(key) != value) { do_exit(1, "Baseline of the other precision with another " + key); }
+            }
+            accuracy_tolerance = opt.accuracy_tolerance;
+        }
+    }
+
+    // --- --- --- Runs
+    nlohmann::json runs = nlohmann::json::array();
+    for (std::string const &name: opt.datasets) {
+        tempo::reader::dataset::ts_ucr ucr{};
+        ucr.ucr_dir = opt.ucr_dir;
+        ucr.name = name;
+        auto read_dataset_result = tempo::reader::dataset::load(ucr, (size_t) opt.nb_threads.back());
+        if (read_dataset_result.index() == 0) { do_exit(1, std::get<0>(read_dataset_result)); }
+        tempo::reader::dataset::TrainTest traintest = std::get<1>(std::move(read_dataset_result));
+        if (auto errors = tempo::reader::dataset::sanity_check(traintest); !errors.empty()) {
+            do_exit(1, name + ": " + utils::cat(errors, "; "));
+        }
+
+        std::optional<double> reference_train_ns;
+        for (int nb_threads: opt.nb_threads) {
+            std::cout << name << " with " << nb_threads << " threads" << std::endl;
+            nlohmann::json j = run(opt, name, traintest.train_dataset, traintest.test_dataset, nb_threads);
+            // Scaling over the first number of threads
+            const auto train_ns = j.at("train_time_ns").get<double>();
+            if (!reference_train_ns) { reference_train_ns = train_ns; }
+            j["train_speedup"] = train_ns > 0 ? reference_train_ns.value() / train_ns : 1.0;
+            std::cout << j.dump() << std::endl;
+            runs.push_back(std::move(j));
+        }
+    }
+
+    // --- --- --- Synthetic runs, by increasing number of train series for each length and number of classes.
+    // The scaling exponent of a time between two consecutive sizes N1<N2 is log(t2/t1)/log(N2/N1): above 1, the cost
+    // grows faster than the number of series (the test set being fixed, the test time grows with the depth).
+    for (size_t nb_classes: opt.synthetic_classes) {
+        for (size_t length: opt.synthetic_lengths) {
+            // Same classes and test split for all the sizes
+            mock::Mocker<F> mocker((unsigned int) opt.seed);
+            mocker._fixl = length;
+            const std::vector<std::vector<F>> prototypes = mocker.class_prototypes(nb_classes);
+            std::map<int, nlohmann::json> previous;
+            for (size_t size: opt.synthetic_sizes) {
+                const std::string name = "synthetic_N" + std::to_string(size) + "_L" + std::to_string(length) + "_C"
+                                         + std::to_string(nb_classes);
+                const auto start = utils::now();
+                const DTS train_dataset = synthetic_split(prototypes, size, opt.synthetic_noise, opt.seed + 1,
+                                                          "train", {}, opt.nb_threads.back());
+                const DTS test_dataset = synthetic_split(prototypes, opt.synthetic_test, opt.synthetic_noise,
+                                                         opt.seed + 2, "test", train_dataset.header().label_encoder(),
+                                                         opt.nb_threads.back());
+                const utils::duration_t generate_time = utils::now() - start;
+
+                for (int nb_threads: opt.nb_threads) {
+                    std::cout << name << " with " << nb_threads << " threads" << std::endl;
+                    nlohmann::json j = run(opt, name, train_dataset, test_dataset, nb_threads);
+                    j["synthetic"] = {
+                            {"size",             size},
+                            {"length",           length},
+                            {"nb_classes",       nb_classes},
+                            {"test_size",        opt.synthetic_test},
+                            {"noise",            opt.synthetic_noise},
+                            {"generate_time_ns", generate_time.count()}
+                    };
+                    const auto train_ns = j.at("train_time_ns").get<double>();
+                    j["train_ns_per_series"] = train_ns / (double) size;
+                    if (auto it = previous.find(nb_threads); it != previous.end()) {
+                        const double ratio = std::log((double) size / it->second.at("size").get<double>());
+                        for (const std::string key: {"train_time_ns", "test_time_ns", "train_nb_distances"}) {
+                            const double t0 = it->second.at(key).get<double>();
+                            const double t1 = j.at(key).get<double>();
+                            if (t0 > 0 && t1 > 0 && ratio > 0) {
+                                j["synthetic"][key + "_exponent"] = std::log(t1 / t0) / ratio;
+                            }
+                        }
+                    }
+                    previous[nb_threads] = {{"size",               size},
+                                            {"train_time_ns",      j.at("train_time_ns")},
+                                            {"test_time_ns",       j.at("test_time_ns")},
+                                            {"train_nb_distances", j.at("train_nb_distances")}};
+                    std::cout << j.dump() << std::endl;
+                    runs.push_back(std::move(j));
+                }
+            }
+        }
+    }
+
+    size_t nb_regressions = 0;
+    if (baseline) { nb_regressions = diff_baseline(runs, baseline.value(), opt.tolerance, accuracy_tolerance); }
+
+    // --- --- --- Output
+    nlohmann::json jv;
+    {
+        nlohmann::json config;
+        config["classifier"] = opt.classifier;
+        config["nb_trees"] = opt.nb_trees;
+        config["nb_candidates"] = opt.nb_candidates;
+        config["seed"] = opt.seed;
+        config["float_type"] = float_type;
+        if (accuracy_tolerance) { config["accuracy_tolerance"] = accuracy_tolerance.value(); }
+        config["pin_threads"] = opt.pin_threads;
+        config["numa_interleave"] = opt.numa_interleave;
+        config["huge_pages"] = utils::memory::to_string(opt.huge_pages);
+        config["nb_numa_nodes"] = utils::memory::nb_numa_nodes();
+        config["hardware_concurrency"] = std::thread::hardware_concurrency();
+        config["available_cpus"] = utils::resources::available_cpus();
+        if (auto quota = utils::resources::cgroup_cpu_quota()) { config["cpu_quota"] = quota.value(); }
+        if (auto limit = utils::resources::memory_limit()) { config["memory_limit"] = limit.value(); }
+        if (!opt.synthetic_sizes.empty()) {
+            config["synthetic_sizes"] = opt.synthetic_sizes;
+            config["synthetic_lengths"] = opt.synthetic_lengths;
+            config["synthetic_classes"] = opt.synthetic_classes;
+        }
+        jv["config"] = config;
+    }
+    jv["runs"] = runs;
+    jv["nb_regressions"] = nb_regressions;
+
+    if (opt.output) {
+        auto out = ofstream(opt.output.value());
+        out << jv.dump(2) << endl;
+    }
+
+    return nb_regressions == 0 ? 0 : 2;
+}
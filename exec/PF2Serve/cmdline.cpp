@@ -0,0 +1,109 @@
+#include "cmdline.hpp"
+
+#include <tclap/CmdLine.h>
+#include <tempo/utils/utils/resources.hpp>
+#include <algorithm>
+#include <string>
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv) {
+  using namespace std;
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Command line parsing
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  try {
+
+    // --- --- --- Build the cmd parser
+    TCLAP::CmdLine cmd("PF2 scoring server: load models once, and predict the series read as JSON lines on the"
+      " standard input, answering one JSON line per request on the standard output", ' ', "0.0.1");
+
+    // --- Models
+    TCLAP::MultiArg<string> model("m", "model", "[<name>=]<path> of a trained model (see PF2 --model-out), named after"
+      " its file by default; repeatable, the requests selecting a model by name, the first one by default", true,
+      "string", cmd);
+    TCLAP::ValueArg<string> store("", "store", "exemplar store shared by the models referencing one (see PF2"
+      " --model-store), loaded once", false, "", "string", cmd);
+    TCLAP::ValueArg<int> ready("", "ready-trees", "serve once the first <n> trees of each model are loaded, loading"
+      " the others in the background and answering with the trees loaded so far (partial answers), republished every"
+      " <n> trees (0: load the whole models before serving)", false, 0, "int", cmd);
+
+    // --- Parallelism
+    TCLAP::ValueArg<int> nbp("p", "nb-threads", "Number of threads - use <=0 for autodetect", false, 1, "int", cmd);
+    TCLAP::SwitchArg pin("", "pin-threads", "pin the worker threads to the CPUs (Linux only)", cmd, false);
+    TCLAP::ValueArg<int> spin("", "latency-spin-us", "low latency mode: predict on a persistent pool of -p workers,"
+      " each one always predicting the same part of the trees, spinning <n> microseconds waiting for the next batch"
+      " before blocking (use with few CPU hungry neighbours, and a small --max-batch and --batch-wait-us)", false, 0,
+      "int", cmd);
+
+    // --- Batching
+    TCLAP::ValueArg<int> max_batch("", "max-batch", "maximum number of requests predicted together", false, 64, "int",
+      cmd);
+    TCLAP::ValueArg<int> batch_wait("", "batch-wait-us", "time waited for more requests after the first one of a"
+      " batch, in microseconds", false, 1000, "int", cmd);
+    TCLAP::ValueArg<int> queue("", "queue", "maximum number of requests read ahead of the predictions", false, 1024,
+      "int", cmd);
+
+    // --- Counters and output
+    TCLAP::ValueArg<int> window("", "latency-window", "number of last requests over which the latency percentiles are"
+      " computed", false, 100000, "int", cmd);
+    TCLAP::ValueArg<int> memo("", "memo", "maximum number of distances remembered per batch, shared by the trees"
+      " (0: only count the distances)", false, 0, "int", cmd);
+    TCLAP::ValueArg<int> rcache("", "result-cache", "maximum number of predictions remembered by the content of their"
+      " series and their model, answering the identical series again without predicting them (0: none)", false, 0,
+      "int", cmd);
+    TCLAP::ValueArg<int> seed("", "seed", "Seed of the tie breaks", false, 0, "int", cmd);
+    TCLAP::ValueArg<string> out("o", "out", "path to output the counters as a json file on exit", false, "", "string",
+      cmd);
+    TCLAP::ValueArg<string> metrics("", "metrics-file", "path to periodically write the metrics to, in the Prometheus"
+      " text format", false, "", "string", cmd);
+    TCLAP::ValueArg<int> metrics_period("", "metrics-period-ms", "minimum time between two writes of the metrics"
+      " file, in milliseconds", false, 1000, "int", cmd);
+
+    // --- --- --- Parse the argv array.
+    cmd.parse(argc, argv);
+
+    // --- --- --- Get options
+    cmdopt opt{};
+    for(const auto& m : model.getValue()){
+      const size_t eq = m.find('=');
+      std::string name = eq==std::string::npos ? fs::path(m).stem().string() : m.substr(0, eq);
+      const fs::path path = eq==std::string::npos ? fs::path(m) : fs::path(m.substr(eq + 1));
+      if(name.empty() || path.empty()){ return {"--model expects [<name>=]<path>"}; }
+      if(std::any_of(opt.models.begin(), opt.models.end(), [&](auto const& nm){ return nm.first==name; })){
+        return {"--model: duplicated model name " + name};
+      }
+      opt.models.emplace_back(std::move(name), path);
+    }
+    if(store.isSet()){ opt.store = {fs::path(store.getValue())}; }
+    if(ready.getValue()<0){ return {"--ready-trees expects a non negative number"}; }
+    opt.ready_trees = ready.getValue();
+    opt.nb_threads = nbp.getValue()<=0 ? (int)tempo::utils::resources::available_cpus() : nbp.getValue();
+    opt.pin_threads = pin.getValue();
+    if(spin.isSet()){
+      if(spin.getValue()<0){ return {"--latency-spin-us expects a non negative number"}; }
+      opt.latency_spin_us = {(size_t)spin.getValue()};
+    }
+    if(max_batch.getValue()<=0){ return {"--max-batch expects a positive number"}; }
+    opt.max_batch = max_batch.getValue();
+    if(batch_wait.getValue()<0){ return {"--batch-wait-us expects a non negative number"}; }
+    opt.batch_wait_us = batch_wait.getValue();
+    if(queue.getValue()<=0){ return {"--queue expects a positive number"}; }
+    opt.queue_capacity = queue.getValue();
+    if(window.getValue()<=0){ return {"--latency-window expects a positive number"}; }
+    opt.latency_window = window.getValue();
+    if(seed.getValue()<0){ return {"--seed expects a non negative number"}; }
+    opt.seed = seed.getValue();
+    if(memo.getValue()<0){ return {"--memo expects a non negative number"}; }
+    opt.memo = memo.getValue();
+    if(rcache.getValue()<0){ return {"--result-cache expects a non negative number"}; }
+    opt.result_cache = rcache.getValue();
+    if(out.isSet()){ opt.output = {out.getValue()}; }
+    if(metrics.isSet()){ opt.metrics_file = {metrics.getValue()}; }
+    if(metrics_period.getValue()<0){ return {"--metrics-period-ms expects a non negative number"}; }
+    opt.metrics_period_ms = metrics_period.getValue();
+
+    return {opt};
+
+  } catch (TCLAP::ArgException& e)  // catch exceptions
+  { return {std::string("error: " + e.error() + " for arg " + e.argId())}; }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+struct cmdopt {
+  /// Models by name, the first one answering the requests naming none
+  std::vector<std::pair<std::string, fs::path>> models;
+  /// Exemplar store shared by the models referencing one
+  std::optional<fs::path> store;
+  /// Trees loaded before serving, the others being loaded in the background (see TSChief::ProgressiveLoad); 0: all
+  size_t ready_trees;
+  int nb_threads;
+  bool pin_threads;
+  /// If set, predict on a pool of spinning workers, spinning this long for the next batch (see utils::SpinPool)
+  std::optional<size_t> latency_spin_us;
+  size_t max_batch;
+  size_t batch_wait_us;
+  size_t queue_capacity;
+  size_t latency_window;
+  size_t seed;
+  size_t memo;
+  /// Maximum number of predictions remembered by content (see TSChief::ResultCache); 0 for none
+  size_t result_cache;
+  std::optional<fs::path> output;
+  std::optional<fs::path> metrics_file;
+  size_t metrics_period_ms;
+};
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv);
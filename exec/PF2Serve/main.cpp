@@ -0,0 +1,651 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <tempo/dataset/dts.hpp>
+#include <tempo/reader/dts.reader.hpp>
+#include <tempo/transform/pipeline.hpp>
+#include <tempo/utils/utils/bounded_queue.hpp>
+#include <tempo/utils/utils/spinpool.hpp>
+#include <tempo/classifier/TSChief/forest.hpp>
+#include <tempo/classifier/TSChief/result_cache.hpp>
+
+#include <nlohmann/json.hpp>
+#include "cmdline.hpp"
+
+using namespace std;
+using namespace tempo;
+
+namespace fs = std::filesystem;
+namespace tsc = tempo::classifier::TSChief;
+
+[[noreturn]] void do_exit(int code, std::optional<std::string> msg = {}) {
+    if (msg) { std::cerr << msg.value() << std::endl; }
+    exit(code);
+}
+
+cmdopt getcmdopt(int argc, char **argv) {
+    cmdopt opt;
+    variant<string, cmdopt> mb_opt = parse_cmd(argc, argv);
+    switch (mb_opt.index()) {
+        case 0: {
+            cerr << "Error: " << std::get<0>(mb_opt) << std::endl;
+            exit(1);
+        }
+        case 1: {
+            opt = std::get<1>(mb_opt);
+        }
+    }
+    return opt;
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Protocol: one JSON object per line, answered in order by one JSON object per line.
+//   {"id": <any>, "series": [v0, v1, ...]}         univariate series
+//   {"id": <any>, "series": [[v0, ...], [v0, ...]]} multivariate series, one array per dimension
+//   {"id": <any>, "model": <name>, "series": ...}  series predicted by the model <name>, else by the first model
+//   {"id": <any>, "stats": true}                   counters so far
+//   {"id": <any>, "metrics": true}                 metrics so far, in the Prometheus text format
+// Answers: {"id", "label", "probabilities": {<class>: <p>}}, {"id", "stats"}, {"id", "metrics"} or {"id", "error"}.
+// The "id" is optional, and copied as is in the answer. With several models, the predictions also have a "model".
+// A prediction by a model still loading its trees (see --ready-trees) has "partial": true and the "nb_trees" used.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+/// A request read on the standard input
+struct Request {
+    utils::time_point_t arrival;
+    nlohmann::json id;
+    /// Not empty if the request is invalid
+    std::string error;
+    bool stats{false};
+    bool metrics{false};
+    /// Time spent parsing the request
+    utils::duration_t parse_time{};
+    /// Row major values of the series, one row per dimension
+    std::vector<F> values;
+    size_t nb_dimensions{0};
+    /// Name of the model predicting the series; the first model if empty
+    std::string model_name;
+    /// Index of the model, resolved by the scorer
+    size_t model{0};
+};
+
+Request parse_request(std::string const &line) {
+    Request r{utils::now(), nullptr, {}, false, false, {}, {}, 0, {}, 0};
+    nlohmann::json j = nlohmann::json::parse(line, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) {
+        r.error = "Invalid JSON object";
+        return r;
+    }
+    if (j.contains("id")) { r.id = j["id"]; }
+    if (j.value("stats", false)) {
+        r.stats = true;
+        return r;
+    }
+    if (j.value("metrics", false)) {
+        r.metrics = true;
+        return r;
+    }
+    if (j.contains("model")) {
+        if (!j["model"].is_string()) {
+            r.error = "Invalid \"model\" name";
+            return r;
+        }
+        r.model_name = j["model"].get<std::string>();
+    }
+    if (!j.contains("series") || !j["series"].is_array() || j["series"].empty()) {
+        r.error = "Missing \"series\" array";
+        return r;
+    }
+    nlohmann::json const &series = j["series"];
+    // Univariate series are one row
+    const bool univariate = !series[0].is_array();
+    r.nb_dimensions = univariate ? 1 : series.size();
+    const size_t length = univariate ? series.size() : series[0].size();
+    if (length == 0) {
+        r.error = "Empty series";
+        return r;
+    }
+    r.values.reserve(length * r.nb_dimensions);
+    for (size_t d = 0; d < r.nb_dimensions; ++d) {
+        nlohmann::json const &row = univariate ? series : series[d];
+        if (!row.is_array() || row.size() != length) {
+            r.error = "Dimensions of different lengths";
+            return r;
+        }
+        for (auto const &v: row) {
+            if (!v.is_number()) {
+                r.error = "Non numeric value";
+                return r;
+            }
+            r.values.push_back(v.get<F>());
+        }
+    }
+    return r;
+}
+
+/// Derivative degree of a transform name: 0 for "default", d for "derivative<d>", nothing if not supported
+std::optional<size_t> transform_degree(std::string const &tname) {
+    if (tname == "default") { return {0}; }
+    const std::string prefix = "derivative";
+    if (tname.starts_with(prefix) && tname.size() > prefix.size()) {
+        const std::string deg = tname.substr(prefix.size());
+        if (std::all_of(deg.begin(), deg.end(), [](char c) { return '0' <= c && c <= '9'; })) {
+            return {std::stoul(deg)};
+        }
+    }
+    return {};
+}
+
+/// Histogram of the Prometheus text format: number of observations at most each bound, plus their sum
+struct Histogram {
+    std::vector<double> bounds;
+    /// Observations per bucket (not cumulative), the last one above all the bounds
+    std::vector<size_t> counts;
+    double sum{0};
+    size_t count{0};
+
+    explicit Histogram(std::vector<double> bounds) : bounds(std::move(bounds)), counts(this->bounds.size() + 1, 0) {}
+
+    /// Bounds of the latencies, in seconds: 10us to 10s
+    static Histogram seconds() {
+        return Histogram({1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25,
+                          0.5, 1, 2.5, 5, 10});
+    }
+
+    /// Powers of 2 up to 'max'
+    static Histogram sizes(size_t max) {
+        std::vector<double> b;
+        for (size_t v = 1; v < max; v *= 2) { b.push_back((double) v); }
+        b.push_back((double) max);
+        return Histogram(std::move(b));
+    }
+
+    void observe(double v) {
+        const size_t i = std::lower_bound(bounds.begin(), bounds.end(), v) - bounds.begin();
+        counts[i]++;
+        sum += v;
+        count++;
+    }
+
+    void observe(utils::duration_t d) { observe(std::chrono::duration<double>(d).count()); }
+
+    void write(std::ostream &out, std::string const &name, std::string const &help) const {
+        out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << " histogram\n";
+        size_t cumulative = 0;
+        for (size_t i = 0; i < bounds.size(); ++i) {
+            cumulative += counts[i];
+            out << name << "_bucket{le=\"" << bounds[i] << "\"} " << cumulative << '\n';
+        }
+        out << name << "_bucket{le=\"+Inf\"} " << count << '\n';
+        out << name << "_sum " << sum << '\n' << name << "_count " << count << '\n';
+    }
+};
+
+/// Counters of the server. The latency of a request is measured from its reading to the writing of its answer;
+/// its percentiles are computed over a window of the last requests.
+struct Counters {
+    size_t nb_requests{0};
+    size_t nb_errors{0};
+    size_t nb_batches{0};
+    size_t nb_predicted{0};
+    /// Series predicted by a part of the trees of their model, still loading (see --ready-trees)
+    size_t nb_partial{0};
+    size_t window;
+    /// Latencies in microseconds, circular over the window
+    std::vector<int64_t> latencies{};
+    size_t next{0};
+    // --- Metrics (see to_prometheus)
+    Histogram latency = Histogram::seconds();
+    Histogram parse = Histogram::seconds();
+    Histogram transform = Histogram::seconds();
+    Histogram traversal = Histogram::seconds();
+    Histogram batch_size;
+    /// Distances looked up by the NN1 nodes, and resolved by the memo of the batches
+    size_t nb_lookups{0};
+    size_t nb_hits{0};
+    /// Series predicted per model
+    std::map<std::string, size_t> predicted_per_model{};
+    /// Cache of the predictions answering the identical series again (see --result-cache), if any
+    tsc::ResultCache const *cache{nullptr};
+
+    Counters(size_t window, size_t max_batch) : window(window), batch_size(Histogram::sizes(max_batch)) {}
+
+    void add_latency(utils::duration_t latency) {
+        this->latency.observe(latency);
+        const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        if (latencies.size() < window) { latencies.push_back(us); }
+        else { latencies[next] = us; }
+        next = (next + 1) % window;
+    }
+
+    nlohmann::json to_json() const {
+        nlohmann::json j;
+        j["nb_requests"] = nb_requests;
+        j["nb_errors"] = nb_errors;
+        j["nb_batches"] = nb_batches;
+        j["average_batch_size"] = nb_batches == 0 ? 0.0 : (double) nb_predicted / (double) nb_batches;
+        j["nb_partial"] = nb_partial;
+        nlohmann::json jl;
+        jl["window"] = latencies.size();
+        if (!latencies.empty()) {
+            std::vector<int64_t> sorted = latencies;
+            auto percentile = [&](double p) {
+                const auto k = (size_t) (p * (double) (sorted.size() - 1));
+                std::nth_element(sorted.begin(), sorted.begin() + (long) k, sorted.end());
+                return sorted[k];
+            };
+            jl["p50"] = percentile(0.50);
+            jl["p99"] = percentile(0.99);
+            jl["max"] = *std::max_element(sorted.begin(), sorted.end());
+        }
+        j["latency_us"] = jl;
+        j["predicted_per_model"] = predicted_per_model;
+        if (cache) {
+            const size_t lookups = cache->nb_lookups();
+            const size_t hits = cache->nb_hits();
+            j["result_cache"] = {{"capacity", cache->get_capacity()}, {"size", cache->size()}, {"lookups", lookups},
+                                 {"hits", hits}, {"evictions", cache->nb_evictions()},
+                                 {"hit_ratio", lookups == 0 ? 0.0 : (double) hits / (double) lookups}};
+        }
+        return j;
+    }
+
+    /// Metrics in the Prometheus text format. The stage latencies are per batch, except the parsing (per request).
+    std::string to_prometheus(size_t queue_depth) const {
+        std::ostringstream out;
+        auto metric = [&](std::string const &name, std::string const &type, std::string const &help, auto value) {
+            out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n'
+                << name << ' ' << value << '\n';
+        };
+        metric("pf2serve_requests_total", "counter", "Requests read", nb_requests);
+        metric("pf2serve_errors_total", "counter", "Requests answered with an error", nb_errors);
+        metric("pf2serve_batches_total", "counter", "Batches predicted", nb_batches);
+        metric("pf2serve_predicted_total", "counter", "Series predicted", nb_predicted);
+        metric("pf2serve_partial_total", "counter", "Series predicted by a model still loading its trees", nb_partial);
+        out << "# HELP pf2serve_model_predicted_total Series predicted per model\n"
+            << "# TYPE pf2serve_model_predicted_total counter\n";
+        for (const auto &[name, n]: predicted_per_model) {
+            out << "pf2serve_model_predicted_total{model=\"" << name << "\"} " << n << '\n';
+        }
+        metric("pf2serve_queue_depth", "gauge", "Requests read, waiting for a batch", queue_depth);
+        batch_size.write(out, "pf2serve_batch_size", "Series per batch");
+        latency.write(out, "pf2serve_request_latency_seconds", "Time from the reading to the answer of a request");
+        parse.write(out, "pf2serve_parse_seconds", "Time parsing a request");
+        transform.write(out, "pf2serve_transform_seconds", "Time computing the transforms of a batch");
+        traversal.write(out, "pf2serve_traversal_seconds", "Time predicting a batch with the forest");
+        metric("pf2serve_distance_lookups_total", "counter", "Distances looked up by the NN1 nodes", nb_lookups);
+        metric("pf2serve_distances_total", "counter", "Distances computed by the NN1 nodes (lookups not resolved by"
+               " the memo)", nb_lookups - nb_hits);
+        metric("pf2serve_distances_per_request", "gauge", "Average distances computed per series predicted",
+               nb_predicted == 0 ? 0.0 : (double) (nb_lookups - nb_hits) / (double) nb_predicted);
+        metric("pf2serve_memo_hit_ratio", "gauge", "Ratio of the distance lookups resolved by the memo",
+               nb_lookups == 0 ? 0.0 : (double) nb_hits / (double) nb_lookups);
+        if (cache) {
+            const size_t lookups = cache->nb_lookups();
+            const size_t hits = cache->nb_hits();
+            metric("pf2serve_result_cache_lookups_total", "counter", "Series looked up in the result cache", lookups);
+            metric("pf2serve_result_cache_hits_total", "counter", "Series answered by the result cache", hits);
+            metric("pf2serve_result_cache_evictions_total", "counter", "Predictions evicted from the result cache",
+                   cache->nb_evictions());
+            metric("pf2serve_result_cache_entries", "gauge", "Predictions in the result cache", cache->size());
+            metric("pf2serve_result_cache_hit_ratio", "gauge", "Ratio of the lookups answered by the result cache",
+                   lookups == 0 ? 0.0 : (double) hits / (double) lookups);
+        }
+        return out.str();
+    }
+};
+
+/// A served model, with its registered data and its tie breaks
+struct Model {
+    std::string name;
+    /// Whole forest, or only the train exemplars with a progressive load
+    tsc::Forest::Loaded loaded;
+    std::unique_ptr<tsc::ProgressiveLoad> progressive;
+    tsc::TreeData tdata;
+    tsc::TreeState tstate;
+    PRNG prng;
+    /// Transforms computed on the requests
+    tempo::transform::NamedKernels kernels;
+
+    Model(std::string name, tsc::Forest::Loaded loaded, std::unique_ptr<tsc::ProgressiveLoad> progressive, size_t seed)
+            : name(std::move(name)), loaded(std::move(loaded)), progressive(std::move(progressive)), tstate(seed, 0),
+              prng(seed) {
+        tsc::register_train(tdata, this->loaded.train_exemplars);
+        for (const auto &[tname, dts]: *this->loaded.train_exemplars) {
+            std::optional<size_t> degree = transform_degree(tname);
+            if (!degree) { throw std::runtime_error("Model using an unsupported transform " + tname); }
+            if (degree.value() > 0) {
+                kernels.emplace_back(tname, tempo::transform::derivative_kernel(degree.value()));
+            }
+        }
+    }
+
+    /// Shape of the train series
+    DatasetHeader const &train_header() const { return loaded.train_exemplars->begin()->second.header(); }
+
+    /// Forest predicting the requests: the whole forest, or the last one published by the progressive load
+    std::shared_ptr<const tsc::Forest> forest() const { return progressive ? progressive->forest() : loaded.forest; }
+
+    /// Number of trees of the whole forest
+    size_t nb_trees() const { return progressive ? progressive->nb_trees() : loaded.forest->forest.size(); }
+};
+
+/// Write 'text' to 'path' through a temporary file, so that a scraper never reads a partial file
+void write_atomically(fs::path const &path, std::string const &text) {
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp);
+        if (!out) { return; }
+        out << text;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+}
+
+
+int main(int argc, char **argv) {
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Read args
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    cmdopt opt = getcmdopt(argc, argv);
+
+    if (opt.pin_threads && !utils::ThreadPool::global().pin_workers()) {
+        std::cerr << "Warning: could not pin the worker threads" << std::endl;
+    }
+    // Low latency mode: the forests predict on spinning workers, each one owning a part of the trees
+    std::optional<utils::SpinPool> spin_pool;
+    if (opt.latency_spin_us) {
+        spin_pool.emplace((size_t) std::max(opt.nb_threads, 1), std::chrono::microseconds(opt.latency_spin_us.value()));
+        if (opt.pin_threads && !spin_pool->pin_workers()) {
+            std::cerr << "Warning: could not pin the spinning workers" << std::endl;
+        }
+    }
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Load the models, once. The models referencing the exemplar store share its exemplars.
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    std::optional<tsc::ExemplarStore> store;
+    if (opt.store) {
+        try { store = tsc::ExemplarStore::load_mapped(opt.store.value()); }
+        catch (std::exception const &e) {
+            do_exit(1, "Cannot load exemplar store " + opt.store.value().string() + ": " + e.what());
+        }
+        size_t nb_exemplars = 0;
+        for (const auto &[tname, dts]: *store->exemplars) { nb_exemplars += dts.size(); }
+        std::cerr << "Exemplar store " << opt.store.value() << ": " << store->exemplars->size() << " transform(s), "
+                  << nb_exemplars << " exemplars" << std::endl;
+    }
+
+    std::vector<std::unique_ptr<Model>> models;
+    std::map<std::string, size_t> model_index;
+    for (const auto &[name, path]: opt.models) {
+        tsc::Forest::Loaded loaded;
+        std::unique_ptr<tsc::ProgressiveLoad> progressive;
+        try {
+            if (opt.ready_trees > 0) {
+                progressive = std::make_unique<tsc::ProgressiveLoad>(path, store ? &store.value() : nullptr,
+                                                                     opt.ready_trees, opt.ready_trees);
+                loaded.train_exemplars = progressive->train_exemplars();
+            } else { loaded = tsc::Forest::load_mapped(path, store ? &store.value() : nullptr); }
+        } catch (std::exception const &e) { do_exit(1, "Cannot load model " + path.string() + ": " + e.what()); }
+        if (loaded.train_exemplars->empty()) { do_exit(1, "Model " + name + " without train exemplars"); }
+        const bool shared = store && loaded.train_exemplars == store->exemplars;
+        try { models.push_back(std::make_unique<Model>(name, std::move(loaded), std::move(progressive), opt.seed)); }
+        catch (std::exception const &e) { do_exit(1, "Model " + name + ": " + e.what()); }
+        model_index[name] = models.size() - 1;
+        Model const &m = *models.back();
+        DatasetHeader const &train_header = m.train_header();
+        const size_t nb_ready = m.forest()->forest.size();
+        std::cerr << "Model " << name << " " << path << ": " << m.nb_trees() << " trees"
+                  << (nb_ready < m.nb_trees() ? " (" + std::to_string(nb_ready) + " loaded, the others in the"
+                                                " background)" : "") << ", "
+                  << train_header.nb_classes() << " classes, " << train_header.nb_dimensions()
+                  << " dimension(s), length " << train_header.length_min() << ".." << train_header.length_max()
+                  << (shared ? ", exemplars of the store" : "") << std::endl;
+    }
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Reader: parse the requests as they arrive
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    utils::BoundedQueue<Request> requests(opt.queue_capacity);
+    std::thread reader([&]() {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (std::all_of(line.begin(), line.end(), [](unsigned char c) { return std::isspace(c); })) { continue; }
+            const auto start = utils::now();
+            Request r = parse_request(line);
+            r.parse_time = utils::now() - start;
+            if (!requests.push(std::move(r))) { break; }
+        }
+        requests.close();
+    });
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Scorer: micro-batch the requests, predict them together, answer in order
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    Counters counters(opt.latency_window, opt.max_batch);
+    std::optional<tsc::ResultCache> cache;
+    if (opt.result_cache > 0) {
+        cache.emplace(opt.result_cache);
+        counters.cache = &cache.value();
+    }
+    auto last_metrics = utils::now();
+
+    auto write_metrics = [&](bool force) {
+        if (!opt.metrics_file) { return; }
+        const auto t = utils::now();
+        if (!force && t - last_metrics < std::chrono::milliseconds(opt.metrics_period_ms)) { return; }
+        last_metrics = t;
+        write_atomically(opt.metrics_file.value(), counters.to_prometheus(requests.size()));
+    };
+
+    auto answer = [&](Request const &r, nlohmann::json a) {
+        a["id"] = r.id;
+        std::cout << a.dump() << '\n';
+        counters.add_latency(utils::now() - r.arrival);
+    };
+
+    std::set<std::string> loads_reported;
+    auto serve = [&](std::vector<Request> &batch) {
+        counters.nb_requests += batch.size();
+        for (Request const &r: batch) { counters.parse.observe(r.parse_time); }
+        // --- Route the series to their model, and check them against it
+        for (Request &r: batch) {
+            if (r.stats || r.metrics || !r.error.empty()) { continue; }
+            if (!r.model_name.empty()) {
+                auto it = model_index.find(r.model_name);
+                if (it == model_index.end()) {
+                    r.error = "Unknown model " + r.model_name;
+                    continue;
+                }
+                r.model = it->second;
+            }
+            DatasetHeader const &train_header = models[r.model]->train_header();
+            const size_t length = r.values.size() / r.nb_dimensions;
+            if (r.nb_dimensions != train_header.nb_dimensions()) {
+                r.error = "Expects series of " + std::to_string(train_header.nb_dimensions()) + " dimension(s)";
+            } else if (length < train_header.length_min() || length > train_header.length_max()) {
+                r.error = "Expects series of length " + std::to_string(train_header.length_min()) + ".." +
+                          std::to_string(train_header.length_max());
+            } else if (std::any_of(r.values.begin(), r.values.end(), [](F v) { return std::isnan(v); })) {
+                r.error = "Missing values";
+            }
+        }
+        // --- Answer the series already predicted by their model from the cache; the others are cached once predicted
+        std::vector<std::optional<tsc::ResultCache::Key>> keys(batch.size());
+        std::vector<std::optional<classifier::Result1>> cached(batch.size());
+        if (cache) {
+            for (size_t i = 0; i < batch.size(); ++i) {
+                Request const &r = batch[i];
+                if (r.stats || r.metrics || !r.error.empty()) { continue; }
+                keys[i] = tsc::ResultCache::make_key(r.model, r.values, r.nb_dimensions);
+                cached[i] = cache->get(keys[i].value());
+            }
+        }
+        // --- Predict the valid series of a model together
+        std::vector<size_t> rows(batch.size(), 0);
+        std::vector<classifier::ResultN> results(models.size());
+        std::vector<std::string> batch_errors(models.size());
+        // Trees of the forest predicting the batch of each model, fewer than the model's while it loads
+        std::vector<size_t> used_trees(models.size(), 0);
+        for (size_t m = 0; m < models.size(); ++m) {
+            Model &model = *models[m];
+            reader::TSData tsdata;
+            tsdata.nb_dimensions = model.train_header().nb_dimensions();
+            for (size_t i = 0; i < batch.size(); ++i) {
+                Request &r = batch[i];
+                if (r.stats || r.metrics || !r.error.empty() || r.model != m || cached[i]) { continue; }
+                rows[i] = tsdata.series.size();
+                const size_t length = r.values.size() / r.nb_dimensions;
+                tsdata.shortest_length = std::min(tsdata.shortest_length, length);
+                tsdata.longest_length = std::max(tsdata.longest_length, length);
+                tsdata.series.push_back(TSeries::mk_from_rowmajor(std::move(r.values), r.nb_dimensions, {}, {false}));
+            }
+            if (tsdata.series.empty()) { continue; }
+            const size_t n = tsdata.series.size();
+            const auto nbthreads = (size_t) std::max(opt.nb_threads, 1);
+            try {
+                const auto start = utils::now();
+                DTS dts = reader::tsdata_to_dts(std::move(tsdata), "serve", model.train_header().label_encoder());
+                auto map = std::make_shared<tsc::MDTS>();
+                tsc::MDTS derived = tempo::transform::transform_all(dts, model.kernels, nbthreads);
+                map->emplace("default", dts);
+                for (auto &[tname, tdts]: derived) { map->emplace(tname, std::move(tdts)); }
+                tsc::register_test(model.tdata, map);
+                const auto transformed = utils::now();
+                // One memo per registration, counting the distance lookups of the batch
+                model.tstate.memo = std::make_shared<tsc::DistanceMemo>(opt.memo);
+                const std::shared_ptr<const tsc::Forest> forest = model.forest();
+                used_trees[m] = forest->forest.size();
+                results[m] = spin_pool
+                             ? forest->predict_latency(model.tstate, model.tdata, IndexSet(n), spin_pool.value())
+                             : forest->predict_batch(model.tstate, model.tdata, IndexSet(n), nbthreads);
+                counters.transform.observe(transformed - start);
+                counters.traversal.observe(utils::now() - transformed);
+                counters.batch_size.observe((double) n);
+                counters.nb_lookups += model.tstate.memo->nb_lookups();
+                counters.nb_hits += model.tstate.memo->nb_hits();
+                model.tstate.memo.reset();
+                counters.nb_batches++;
+                counters.nb_predicted += n;
+                counters.predicted_per_model[model.name] += n;
+                // Only the predictions of the whole forest are cached
+                const bool whole = used_trees[m] == model.nb_trees();
+                for (size_t i = 0; cache && whole && i < batch.size(); ++i) {
+                    if (!keys[i] || cached[i] || batch[i].model != m) { continue; }
+                    arma::rowvec p = results[m].probabilities.row(rows[i]);
+                    const double weight = results[m].weight[rows[i]];
+                    cache->put(std::move(keys[i].value()), classifier::Result1(std::move(p), weight));
+                }
+            } catch (std::exception const &e) { batch_errors[m] = e.what(); }
+        }
+        // --- Answer in order
+        for (size_t i = 0; i < batch.size(); ++i) {
+            Request const &r = batch[i];
+            nlohmann::json a;
+            if (r.stats) {
+                a["stats"] = counters.to_json();
+            } else if (r.metrics) {
+                a["metrics"] = counters.to_prometheus(requests.size());
+            } else if (!r.error.empty() || (!cached[i] && !batch_errors[r.model].empty())) {
+                counters.nb_errors++;
+                a["error"] = r.error.empty() ? batch_errors[r.model] : r.error;
+            } else {
+                Model &model = *models[r.model];
+                LabelEncoder const &encoder = model.train_header().label_encoder();
+                const arma::rowvec row = cached[i] ? cached[i]->probabilities
+                                                   : arma::rowvec(results[r.model].probabilities.row(rows[i]));
+                const double maxv = row.max();
+                std::vector<size_t> maxp;
+                nlohmann::json jp;
+                for (size_t c = 0; c < row.n_cols; ++c) {
+                    if (row[c] == maxv) { maxp.push_back(c); }
+                    jp[encoder.index_to_label()[c]] = row[c];
+                }
+                a["label"] = encoder.index_to_label()[utils::pick_one(maxp, model.prng)];
+                a["probabilities"] = jp;
+                if (models.size() > 1) { a["model"] = model.name; }
+                if (!cached[i] && used_trees[r.model] < model.nb_trees()) {
+                    counters.nb_partial++;
+                    a["partial"] = true;
+                    a["nb_trees"] = used_trees[r.model];
+                }
+            }
+            answer(r, std::move(a));
+        }
+        std::cout << std::flush;
+        write_metrics(false);
+        // Report the end of the progressive loads
+        for (auto &model: models) {
+            if (!model->progressive || loads_reported.count(model->name) > 0) { continue; }
+            if (std::exception_ptr error = model->progressive->error()) {
+                loads_reported.insert(model->name);
+                try { std::rethrow_exception(error); }
+                catch (std::exception const &e) {
+                    std::cerr << "Model " << model->name << ": loading stopped after "
+                              << model->forest()->forest.size() << " trees: " << e.what() << std::endl;
+                }
+            } else if (model->progressive->complete()) {
+                loads_reported.insert(model->name);
+                std::cerr << "Model " << model->name << ": all " << model->nb_trees() << " trees loaded" << std::endl;
+            }
+        }
+    };
+
+    while (std::optional<Request> first = requests.pop()) {
+        std::vector<Request> batch;
+        batch.push_back(std::move(first.value()));
+        const auto deadline = utils::now() + std::chrono::microseconds(opt.batch_wait_us);
+        while (batch.size() < opt.max_batch) {
+            std::optional<Request> r = requests.pop_until(deadline);
+            if (!r) { break; }
+            batch.push_back(std::move(r.value()));
+        }
+        serve(batch);
+    }
+    reader.join();
+    write_metrics(true);
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Report the counters and exit
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    nlohmann::json jv = counters.to_json();
+    jv["models"] = nlohmann::json::array();
+    for (size_t m = 0; m < models.size(); ++m) {
+        jv["models"].push_back({{"name", opt.models[m].first}, {"path", opt.models[m].second.string()},
+                                {"nb_trees", models[m]->nb_trees()},
+                                {"nb_loaded_trees", models[m]->forest()->forest.size()}});
+    }
+    if (opt.store) { jv["store"] = opt.store.value().string(); }
+    jv["nb_threads"] = opt.nb_threads;
+    if (opt.latency_spin_us) { jv["latency_spin_us"] = opt.latency_spin_us.value(); }
+    jv["max_batch"] = opt.max_batch;
+    jv["batch_wait_us"] = opt.batch_wait_us;
+    jv["ready_trees"] = opt.ready_trees;
+    jv["result_cache_capacity"] = opt.result_cache;
+    std::cerr << jv.dump(2) << std::endl;
+    if (opt.output) {
+        std::ofstream outf(opt.output.value());
+        if (!outf) { do_exit(1, "Cannot open output " + opt.output.value().string()); }
+        outf << jv.dump(2) << std::endl;
+    }
+
+    return 0;
+}
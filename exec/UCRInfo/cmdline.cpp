@@ -0,0 +1,72 @@
+#include "cmdline.hpp"
+
+#include <tclap/CmdLine.h>
+#include <tempo/utils/utils/resources.hpp>
+#include <sstream>
+#include <string>
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv) {
+  using namespace std;
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Command line parsing
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  try {
+
+    // --- --- --- Build the cmd parser
+    TCLAP::CmdLine cmd("UCRInfo: profile the datasets of a UCR archive (header, statistics per dimension, direct"
+      " alignment samples, duplicated series), writing one JSON line per dataset", ' ', "0.0.1");
+
+    // --- Datasets
+    TCLAP::ValueArg<string> ucr("", "ucr", "path to the UCR archive", true, "", "string", cmd);
+    TCLAP::MultiArg<string> names("n", "name", "dataset to profile, repeatable; all the datasets of the archive"
+      " (folders with a <name>_TRAIN.ts file) if none", false, "string", cmd);
+
+    // --- Direct alignment samples
+    TCLAP::ValueArg<string> sample("", "sample", "<n>:<e0>:...:<ek>: sample n direct alignment distances between"
+      " two different series of each split, per exponent e of the cost function |a-b|^e", false, "", "string", cmd);
+    TCLAP::ValueArg<int> seed("", "seed", "Seed of the samples", false, 0, "int", cmd);
+
+    // --- Parallelism
+    TCLAP::ValueArg<int> nbp("p", "nb-threads", "Number of threads - use <=0 for autodetect", false, 1, "int", cmd);
+    TCLAP::SwitchArg pin("", "pin-threads", "pin the worker threads to the CPUs (Linux only)", cmd, false);
+    TCLAP::ValueArg<int> big("", "big-bytes", "datasets whose train file has at least this size use all the threads"
+      " and start first; the smaller ones are profiled concurrently, with one thread each", false, 1 << 20, "int",
+      cmd);
+
+    // --- Output
+    TCLAP::ValueArg<string> out("o", "out", "path to the JSON lines output, one line per dataset in completion order"
+      " (default: standard output)", false, "", "string", cmd);
+
+    // --- --- --- Parse the argv array.
+    cmd.parse(argc, argv);
+
+    // --- --- --- Get options
+    cmdopt opt{};
+    opt.ucr_dir = fs::path(ucr.getValue());
+    opt.names = names.getValue();
+    opt.nb_samples = 0;
+    if(sample.isSet()){
+      std::istringstream in(sample.getValue());
+      std::string item;
+      std::vector<std::string> items;
+      while(std::getline(in, item, ':')){ items.push_back(item); }
+      try {
+        if(items.size()<2 || std::stol(items[0])<=0){ throw std::invalid_argument("sample"); }
+        opt.nb_samples = (size_t)std::stol(items[0]);
+        for(size_t i=1; i<items.size(); ++i){ opt.exponents.push_back(std::stod(items[i])); }
+      } catch (std::exception const&) { return {"--sample expects <n>:<e0>:...:<ek> with n>0"}; }
+    }
+    if(seed.getValue()<0){ return {"--seed expects a non negative number"}; }
+    opt.seed = (size_t)seed.getValue();
+    opt.nb_threads = nbp.getValue()<=0 ? (int)tempo::utils::resources::available_cpus() : nbp.getValue();
+    opt.pin_threads = pin.getValue();
+    if(big.getValue()<0){ return {"--big-bytes expects a non negative number"}; }
+    opt.big_bytes = (size_t)big.getValue();
+    if(out.isSet()){ opt.output = {fs::path(out.getValue())}; }
+
+    return {opt};
+
+  } catch (TCLAP::ArgException& e)  // catch exceptions
+  { return {std::string("error: " + e.error() + " for arg " + e.argId())}; }
+}
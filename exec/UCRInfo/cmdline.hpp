@@ -0,0 +1,25 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+struct cmdopt {
+  fs::path ucr_dir;
+  /// Datasets to profile; all the datasets of the archive if empty
+  std::vector<std::string> names;
+  /// Direct alignment samples per split and exponents of their cost function; no sampling if 0
+  size_t nb_samples;
+  std::vector<double> exponents;
+  size_t seed;
+  int nb_threads;
+  bool pin_threads;
+  size_t big_bytes;
+  std::optional<fs::path> output;
+};
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv);
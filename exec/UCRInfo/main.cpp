@@ -1,201 +1,230 @@
-#include "pch.h"
-#include <typeinfo>
-#include <tempo/reader/new_reader.hpp>
-
-#include "cli.hpp"
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+
+#include <tempo/dataset/dts.hpp>
+#include <tempo/distance/tseries.multivariate.hpp>
+#include <tempo/reader/dts.reader.hpp>
+
+#include <nlohmann/json.hpp>
+#include "cmdline.hpp"
+
+using namespace std;
+using namespace tempo;
 
 namespace fs = std::filesystem;
 
-struct config {
-  int nbsample{0};
-  std::vector<double> exponents{};
+[[noreturn]] void do_exit(int code, std::optional<std::string> msg = {}) {
+    if (msg) { std::cerr << msg.value() << std::endl; }
+    exit(code);
+}
+
+cmdopt getcmdopt(int argc, char **argv) {
+    cmdopt opt;
+    variant<string, cmdopt> mb_opt = parse_cmd(argc, argv);
+    switch (mb_opt.index()) {
+        case 0: {
+            cerr << "Error: " << std::get<0>(mb_opt) << std::endl;
+            exit(1);
+        }
+        case 1: {
+            opt = std::get<1>(mb_opt);
+        }
+    }
+    return opt;
+}
+
+/// A dataset of the archive
+struct Dataset {
+    std::string name;
+    /// Size of the train file: big datasets use all the threads
+    size_t train_bytes;
 };
 
-// Given a UCR dataset in ts format, compute some information
-Json::Value compute_info(
-  tempo::DatasetHeader const& header,
-  tempo::DTS const& dts,
-  config const& conf,
-  tempo::PRNG& prng
-) {
-  using namespace tempo;
-  // --- Header info
-  Json::Value v = header.to_json();
-  // --- Stats
-  {
-    Json::Value statsv;
-    DTS_Stats stats(dts);
-    statsv["min"] = utils::to_json(stats._min);
-    statsv["max"] = utils::to_json(stats._max);
-    statsv["mean"] = utils::to_json(stats._mean);
-    statsv["stddev"] = utils::to_json(stats._stddev);
-    v["stats"] = std::move(statsv);
-  }
-  // --- Sample
-  if (conf.nbsample>0) {
-    Json::Value mmv;
-    if (header.has_missing_value()) { mmv = Json::Value("error_missing_value"); }
-    else if (header.nb_dimensions()!=1) { mmv = Json::Value("error_multivariate"); }
-    else {
-      mmv["results"] = Json::arrayValue;
-      for (const double exponent : conf.exponents) {
-        Json::Value emmv;
-        emmv["sample_size"] = conf.nbsample;
-        emmv["exponent"] = exponent;
-        auto cf = tempo::distance::univariate::ade<tempo::TSeries>(exponent);
-        utils::StddevWelford welford;
-        size_t j = 0;
-        std::uniform_int_distribution<> distrib(0, (int)dts.size() - 1);
-        for (int i = 0; i<conf.nbsample; ++i) {
-          const auto& q = dts[distrib(prng)];
-          const auto& s = dts[distrib(prng)];
-          const auto& cost = tempo::distance::directa(q, s, cf, tempo::utils::PINF);
-          welford.update(cost);
+/// The datasets of 'opt', or all the datasets of the archive (folders with a <name>_TRAIN.ts file), by name
+std::vector<Dataset> list_datasets(cmdopt const &opt) {
+    std::vector<std::string> names = opt.names;
+    if (names.empty()) {
+        std::error_code ec;
+        for (auto const &entry: fs::directory_iterator(opt.ucr_dir, ec)) {
+            const std::string name = entry.path().filename().string();
+            if (entry.is_directory() && fs::exists(entry.path() / (name + "_TRAIN.ts"))) { names.push_back(name); }
         }
-        emmv["mean"] = welford.get_mean();
-        emmv["stddev"] = welford.get_stddev_s();
-        mmv["results"].append(std::move(emmv));
-      }
+        if (ec) { do_exit(1, "Cannot list " + opt.ucr_dir.string() + ": " + ec.message()); }
+        std::sort(names.begin(), names.end());
+    }
+    std::vector<Dataset> datasets;
+    for (std::string const &name: names) {
+        std::error_code ec;
+        const fs::path train_path = opt.ucr_dir / name / (name + "_TRAIN.ts");
+        const auto train_bytes = (size_t) fs::file_size(train_path, ec);
+        if (ec) { do_exit(1, "Cannot read " + train_path.string()); }
+        datasets.push_back({name, train_bytes});
     }
-    v["direct_alignment_sample"] = std::move(mmv);
-  }
-  // --- Check for duplicated series
-  {
-    std::map<size_t, std::vector<size_t>> same;
-    std::set<size_t> visited;
-    for (size_t i = 0; i<dts.size(); ++i) {
-      TSeries const& ref = dts[i];
-      for (size_t j = i + 1; j<dts.size(); ++j) {
-        if(visited.contains(j)){continue;}
-        TSeries const& other = dts[j];
-        if (arma::norm(ref.data() - other.data())==0) {
-          visited.insert(j);
-          same[i].push_back(j);
+    return datasets;
+}
+
+/// Groups of identical series (same dimensions, length and values) of a split, by increasing first index.
+/// The series are bucketed by a hash of their values, then compared within their bucket: O(n) series comparisons
+/// instead of O(n^2).
+std::vector<std::vector<size_t>> duplicated_series(DTS const &dts) {
+    auto hash = [](TSeries const &s) {
+        std::string_view bytes((char const *) s.data(), s.size() * sizeof(F));
+        return std::hash<std::string_view>{}(bytes) ^ (s.length() * 0x9e3779b97f4a7c15ULL);
+    };
+    auto same = [](TSeries const &a, TSeries const &b) {
+        return a.nb_dimensions() == b.nb_dimensions() && a.length() == b.length() &&
+               std::equal(a.data(), a.data() + a.size(), b.data());
+    };
+    std::unordered_map<size_t, std::vector<std::vector<size_t>>> buckets;
+    for (size_t i = 0; i < dts.size(); ++i) {
+        std::vector<std::vector<size_t>> &groups = buckets[hash(dts[i])];
+        auto it = std::find_if(groups.begin(), groups.end(), [&](std::vector<size_t> const &g) {
+            return same(dts[g.front()], dts[i]);
+        });
+        if (it == groups.end()) { groups.push_back({i}); } else { it->push_back(i); }
+    }
+    std::vector<std::vector<size_t>> result;
+    for (auto &[h, groups]: buckets) {
+        for (auto &g: groups) { if (g.size() > 1) { result.push_back(std::move(g)); }}
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/// Profile of a split, computed with 'nb_threads' threads
+nlohmann::json profile_split(DTS const &dts, cmdopt const &opt, PRNG &prng, size_t nb_threads) {
+    DatasetHeader const &header = dts.header();
+    nlohmann::json j = header.to_json();
+    j.erase("name");
+    // --- Statistics per dimension, from the per series sums (see DTS_Sums)
+    {
+        DTS_Stats stats(dts, nb_threads);
+        nlohmann::json js;
+        js["min"] = utils::to_json(stats._min);
+        js["max"] = utils::to_json(stats._max);
+        js["mean"] = utils::to_json(stats._mean);
+        js["stddev"] = utils::to_json(stats._stddev);
+        j["stats"] = js;
+    }
+    // --- Direct alignment between random pairs of different series
+    if (opt.nb_samples > 0) {
+        nlohmann::json jd;
+        if (header.has_missing_value()) { jd = "error_missing_value"; }
+        else if (header.length_min() != header.length_max()) { jd = "error_variable_length"; }
+        else if (dts.size() < 2) { jd = "error_single_series"; }
+        else {
+            jd = nlohmann::json::array();
+            std::uniform_int_distribution<size_t> first(0, dts.size() - 1);
+            std::uniform_int_distribution<size_t> other(0, dts.size() - 2);
+            for (const double exponent: opt.exponents) {
+                utils::StddevWelford welford;
+                for (size_t k = 0; k < opt.nb_samples; ++k) {
+                    const size_t a = first(prng);
+                    size_t b = other(prng);
+                    if (b >= a) { ++b; }
+                    welford.update(distance::multivariate::directa(dts[a], dts[b], exponent, utils::PINF));
+                }
+                nlohmann::json je;
+                je["sample_size"] = opt.nb_samples;
+                je["exponent"] = exponent;
+                je["mean"] = welford.get_mean();
+                je["stddev"] = welford.get_stddev_s();
+                jd.push_back(je);
+            }
         }
-      }
+        j["direct_alignment_sample"] = jd;
     }
-    Json::Value duplicated = Json::arrayValue;
-    size_t n=0;
-    for (auto [k, vec] : same) {
-      vec.insert(vec.begin(), k);
-      n+=vec.size();
-      duplicated.append(utils::to_json(vec));
+    // --- Duplicated series
+    {
+        const std::vector<std::vector<size_t>> groups = duplicated_series(dts);
+        size_t n = 0;
+        nlohmann::json jg = nlohmann::json::array();
+        for (auto const &g: groups) {
+            n += g.size();
+            jg.push_back(utils::to_json(g));
+        }
+        j["duplicated_nb"] = n;
+        j["duplicated"] = jg;
     }
-    v["duplicated_nb"] = (int)n;
-    v["duplicated"] = duplicated;
+    return j;
+}
 
-  }
-  return v;
+/// Profile of a dataset of the archive, computed with 'nb_threads' threads
+nlohmann::json profile(Dataset const &dataset, cmdopt const &opt, size_t nb_threads) {
+    reader::dataset::ts_ucr ucr{};
+    ucr.ucr_dir = opt.ucr_dir;
+    ucr.name = dataset.name;
+    auto read_dataset_result = reader::dataset::load(ucr, nb_threads);
+    if (read_dataset_result.index() == 0) { throw std::runtime_error(std::get<0>(read_dataset_result)); }
+    reader::dataset::TrainTest const &data = std::get<1>(read_dataset_result);
+
+    const auto start = utils::now();
+    PRNG prng(opt.seed);
+    nlohmann::json j;
+    j["nb_threads"] = nb_threads;
+    j["load_time_ns"] = data.load_time.count();
+    j["load_bytes"] = data.load_bytes;
+    j["train"] = profile_split(data.train_dataset, opt, prng, nb_threads);
+    j["test"] = profile_split(data.test_dataset, opt, prng, nb_threads);
+    j["profile_time_ns"] = (utils::now() - start).count();
+    return j;
 }
 
 int main(int argc, char **argv) {
-  using namespace std;
-  using namespace tempo;
-  using namespace tempo::utils;
-
-  // --- --- --- --- --- ---
-  // Program Arguments
-  string program_name(*argv);
-  vector<string> args(argv + 1, argv + argc);
-  if (args.empty()) { do_exit(0, usage); }
-  config conf;
-
-  // --- --- ---
-  // Optional
-
-  // Random seed for sampling
-  long long seed;
-  {
-    auto p_seed = tempo::scli::get_parameter<long long>(args, "-seed", tempo::scli::extract_int, -1);
-    if (p_seed<0) { seed = std::random_device()(); } else { seed = p_seed; }
-  }
-  tempo::PRNG prng(seed);
-
-  // Output file
-  optional<fs::path> outpath{};
-  {
-    auto p_out = tempo::scli::get_parameter<string>(args, "-out", tempo::scli::extract_string);
-    if (p_out) { outpath = {fs::path{p_out.value()}}; }
-  }
-
-  // Sample with direct alignment
-  {
-    auto parg_dist = tempo::scli::get_parameter<string>(args, "-sample", tempo::scli::extract_string);
-    if (parg_dist) {
-      auto v = tempo::reader::split(parg_dist.value(), ':');
-      bool ok = v.size()>=2;
-      if (ok) {
-        auto on = tempo::reader::as_int(v[0]);
-        ok = (bool)on;
-        if (ok) { conf.nbsample = on.value(); }
-        //
-        for (size_t i = 1; ok&&i<v.size(); ++i) {
-          auto oe = tempo::reader::as_double(v[i]);
-          ok = (bool)oe;
-          if (ok) { conf.exponents.push_back(oe.value()); }
-        }
-      }
-      if (!ok) { do_exit(1, "specify <n>:<e0>:...:<en> after '-sample'"); }
+
+    cmdopt opt = getcmdopt(argc, argv);
+
+    if (opt.pin_threads && !utils::ThreadPool::global().pin_workers()) {
+        std::cerr << "Warning: could not pin the worker threads" << std::endl;
     }
-  }
-
-  // --- --- ---
-  // Mandatory
-
-  // Path to UCR
-  fs::path UCRPATH;
-  {
-    auto parg_UCRPATH = tempo::scli::get_parameter<string>(args, "-p", tempo::scli::extract_string);
-    if (!parg_UCRPATH) { do_exit(1, "specify the UCR path with the -p flag, e.g. -p:/path/to/dataset"); }
-    UCRPATH = fs::path(parg_UCRPATH.value());
-  }
-
-  // Dataset name
-  string dsname;
-  {
-    auto parg_UCRNAME = tempo::scli::get_parameter<string>(args, "-n", tempo::scli::extract_string);
-    if (!parg_UCRNAME) { do_exit(1, "specify the UCR dataset name with the -n flag -n:NAME"); }
-    dsname = std::move(parg_UCRNAME.value());
-  }
-
-  // --- --- --- --- --- ---
-  // Read the dataset TRAIN.ts and TEST.ts files
-  fs::path dspath = UCRPATH/dsname;
-
-  DTS train_split = std::get<1>(tempo::reader::load_dataset_ts(dspath/(dsname + "_TRAIN.ts"), "train"));
-  DatasetHeader const& train_header = train_split.header();
-  size_t train_top = train_header.size();
-
-  DTS test_split =
-    std::get<1>(reader::load_dataset_ts(dspath/(dsname + "_TEST.ts"), "test", train_header.label_encoder()));
-  DatasetHeader const& test_header = test_split.header();
-  size_t test_top = test_header.size();
-
-  // --- --- --- --- --- ---
-  // Json Record
-  Json::Value jv;
-  jv["dataset"] = train_header.name();
-
-  // --- --- --- --- --- ---
-  // Compute Info for train and test
-  {
-    Json::Value train_v = compute_info(train_header, train_split, conf, prng);
-    train_v.removeMember("name");
-    jv["train"] = std::move(train_v);
-  }
-  {
-    Json::Value test_v = compute_info(test_header, test_split, conf, prng);
-    test_v.removeMember("name");
-    jv["test"] = std::move(test_v);
-  }
-
-  // --- --- --- --- --- ---
-  // Print
-  cout << endl << jv.toStyledString() << endl;
-  if (outpath) {
-    auto out = ofstream(outpath.value());
-    out << jv << endl;
-  }
-
-  return 0;
+
+    // --- --- --- Datasets, biggest first. The big ones are profiled one at a time with all the threads, then the
+    // small ones concurrently with one thread each.
+    std::vector<Dataset> datasets = list_datasets(opt);
+    std::stable_sort(datasets.begin(), datasets.end(), [](Dataset const &a, Dataset const &b) {
+        return a.train_bytes > b.train_bytes;
+    });
+    const size_t nb_big = (size_t) std::count_if(datasets.begin(), datasets.end(), [&opt](Dataset const &d) {
+        return d.train_bytes >= opt.big_bytes;
+    });
+
+    std::ofstream outf;
+    if (opt.output) {
+        outf.open(opt.output.value());
+        if (!outf) { do_exit(1, "Cannot open " + opt.output.value().string()); }
+    }
+    std::ostream &out = opt.output ? outf : std::cout;
+    std::mutex out_mutex;
+    size_t nb_failed = 0;
+
+    // Profile a dataset, writing its JSON line (with an "error" if it fails)
+    auto run = [&](Dataset const &dataset, int nb_threads) {
+        nlohmann::json j;
+        try { j = profile(dataset, opt, (size_t) nb_threads); }
+        catch (std::exception const &e) { j["error"] = e.what(); }
+        j["dataset"] = dataset.name;
+        std::lock_guard lock(out_mutex);
+        if (j.contains("error")) { ++nb_failed; }
+        out << j.dump() << std::endl;
+        if (opt.output) {
+            std::cout << dataset.name << ": "
+                      << (j.contains("error") ? "error: " + j.at("error").get<std::string>() : "done") << std::endl;
+        }
+    };
+
+    for (size_t i = 0; i < nb_big; ++i) { run(datasets[i], opt.nb_threads); }
+
+    utils::ParTasks p;
+    p.execute(opt.nb_threads, [&](size_t i) { run(datasets[i], 1); }, nb_big, datasets.size());
+
+    std::cerr << datasets.size() << " datasets, " << nb_failed << " failed" << std::endl;
+    return nb_failed == 0 ? 0 : 2;
 }
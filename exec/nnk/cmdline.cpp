@@ -0,0 +1,117 @@
+#include "cmdline.hpp"
+
+#include <tclap/CmdLine.h>
+#include <tempo/utils/utils/resources.hpp>
+#include <cassert>
+#include <sstream>
+#include <string>
+#include <vector>
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv) {
+  using namespace std;
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Command line parsing
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  try {
+
+    // --- --- --- Build the cmd parser
+    TCLAP::CmdLine cmd("k nearest neighbours classifier with elastic distances", ' ', "0.0.1");
+
+    // --- Dataset UCR, CSV or binary
+    TCLAP::SwitchArg ucr("", "ucr", "use a UCR dataset", false);
+    TCLAP::SwitchArg csv("", "csv", "use a CSV dataset", false);
+    TCLAP::SwitchArg bin("", "bin", "use a binary dataset (see pf2 --save-bin)", false);
+    TCLAP::SwitchArg arrow("", "arrow", "use an Arrow IPC dataset (e.g. exported from Parquet files)", false);
+    std::vector<TCLAP::Arg*> input_args{&ucr, &csv, &bin, &arrow};
+    cmd.xorAdd(input_args);
+    TCLAP::UnlabeledMultiArg<string> ds("dataset", "<ucr_path ucr_name> or <csv_train csv_test> or <bin_train bin_test>"
+      " or <arrow_train arrow_test dataset_name>", true, "strings", cmd);
+
+    // --- Extra CSV
+    TCLAP::SwitchArg csv_skip("", "csv-skip-header", "Skip the csv's first line", cmd, false);
+    TCLAP::ValueArg<std::string> csv_sep("", "csv-separator", "CSV columns separator", false, ",", "character", cmd);
+
+    // --- Extra Arrow
+    TCLAP::ValueArg<std::string> arrow_series("", "arrow-series", "Arrow column of the series: lists of values, or"
+      " lists of fixed size lists of values for multivariate series", false, "series", "string", cmd);
+    TCLAP::ValueArg<std::string> arrow_label("", "arrow-label", "Arrow column of the labels; empty for unlabelled"
+      " series", false, "label", "string", cmd);
+
+    // --- Classifier
+    TCLAP::ValueArg<string> distance("d", "distance", "Distance and its parameters separated by ':': directa:<cfe>,"
+      " dtw:<cfe>:<window ratio>, adtw:<cfe>:<penalty>, erp:<cfe>:<gap value>:<window ratio>,"
+      " lcss:<epsilon>:<window ratio>, msm:<cost>, twe:<nu>:<lambda>", false, "dtw:2:1", "string", cmd);
+    TCLAP::ValueArg<int> k("k", "nb-neighbours", "Number of neighbours", false, 1, "int", cmd);
+
+    // --- Parallelism
+    TCLAP::ValueArg<int> nbp("p", "nb-threads", "Number of threads - use <=0 for autodetect", false, 1, "int", cmd);
+
+    // --- Output
+    TCLAP::ValueArg<string> out("o", "out", "path to output json file", false, "", "string", cmd);
+
+    // --- --- --- Parse the argv array.
+    cmd.parse(argc, argv);
+
+    // --- --- --- Get options
+    cmdopt opt{};
+
+    std::vector<std::string> remainder = ds.getValue();
+
+    // --- Input
+    if (ucr.isSet()) {
+      // --- --- --- UCR
+      trd::ts_ucr ru{};
+      if (remainder.size()<2) { return {"Expects ucr <path to ucr> <ucr dataset name>"}; }
+      ru.ucr_dir = fs::path(remainder[0]);
+      ru.name = remainder[1];
+      opt.input = {ru};
+    } else if (bin.isSet()) {
+      // --- --- --- Binary
+      trd::bin rb{};
+      if (remainder.size()<2) { return {"Expects bin <train path> <test path>"}; }
+      rb.path_to_train = fs::path(remainder[0]);
+      rb.path_to_test = fs::path(remainder[1]);
+      opt.input = {rb};
+    } else if (arrow.isSet()) {
+      // --- --- --- Arrow
+      trd::arrow_ipc ra{};
+      if (remainder.size()<3) { return {"Expects arrow <train path> <test path> <dataset name>"}; }
+      ra.path_to_train = fs::path(remainder[0]);
+      ra.path_to_test = fs::path(remainder[1]);
+      ra.dataset_name = remainder[2];
+      ra.columns.series = arrow_series.getValue();
+      ra.columns.label.reset();
+      if(!arrow_label.getValue().empty()){ ra.columns.label = arrow_label.getValue(); }
+      opt.input = {ra};
+    } else {
+      // --- --- --- CSV
+      assert(csv.isSet());
+      trd::csv rc{};
+      if (remainder.size()<3) { return {"Expects csv <train path> <test path> <dataset name>"}; }
+      rc.path_to_train = fs::path(remainder[0]);
+      rc.path_to_test = fs::path(remainder[1]);
+      rc.dataset_name = fs::path(remainder[2]);
+      rc.csv_skip_header = csv_skip.getValue();
+      rc.csv_separator = csv_sep.getValue().at(0);
+      opt.input = {rc};
+    }
+
+    // --- Classifier
+    {
+      std::istringstream iss(distance.getValue());
+      for (std::string item; std::getline(iss, item, ':');) { opt.distance.push_back(item); }
+      if(opt.distance.empty()){ return {"--distance expects a distance name"}; }
+    }
+    if(k.getValue()<=0){ return {"--nb-neighbours expects a positive number"}; }
+    opt.k = (size_t)k.getValue();
+
+    // --- Other options
+    opt.nb_threads = nbp.getValue()<=0 ? (int)tempo::utils::resources::available_cpus() : nbp.getValue();
+    if(out.isSet()){ opt.output = {out.getValue()}; }
+
+    return {opt};
+
+  } catch (TCLAP::ArgException& e)  // catch exceptions
+  { return {std::string("error: " + e.error() + " for arg " + e.argId())}; }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <tempo/reader/dts.reader.hpp>
+
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+namespace trd = tempo::reader::dataset;
+
+struct cmdopt {
+  trd::Config input;
+  /// Distance name followed by its parameters, separated by ':' (see tempo::distance::DistanceSpec::parse)
+  std::vector<std::string> distance;
+  size_t k;
+  int nb_threads;
+  std::optional<fs::path> output;
+};
+
+std::variant<std::string, cmdopt> parse_cmd(int argc, char **argv);
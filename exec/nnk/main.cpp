@@ -0,0 +1,188 @@
+#include <fstream>
+#include <map>
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/dataset/dts.hpp>
+#include <tempo/reader/dts.reader.hpp>
+#include <tempo/distance/matrix.hpp>
+#include <tempo/distance/univariate.hpp>
+
+#include <nlohmann/json.hpp>
+#include "cmdline.hpp"
+
+using namespace std;
+using namespace tempo;
+
+namespace fs = std::filesystem;
+
+[[noreturn]] void do_exit(int code, std::optional<std::string> msg = {}) {
+    if (msg) { std::cerr << msg.value() << std::endl; }
+    exit(code);
+}
+
+cmdopt getcmdopt(int argc, char **argv) {
+    cmdopt opt;
+    variant<string, cmdopt> mb_opt = parse_cmd(argc, argv);
+    switch (mb_opt.index()) {
+        case 0: {
+            cerr << "Error: " << std::get<0>(mb_opt) << std::endl;
+            exit(1);
+        }
+        case 1: {
+            opt = std::get<1>(mb_opt);
+        }
+    }
+    return opt;
+}
+
+/// Majority label of the neighbours (by increasing distance), ties broken by the nearest neighbour
+std::string vote(DTS const &train, std::vector<std::pair<F, size_t>> const &neighbours) {
+    std::map<std::string, size_t> counts;
+    for (auto const &[d, j]: neighbours) { counts[train.original_label(j).value()]++; }
+    std::string best;
+    size_t best_count = 0;
+    for (auto const &[d, j]: neighbours) {
+        const std::string l = train.original_label(j).value();
+        if (counts[l] > best_count) {
+            best = l;
+            best_count = counts[l];
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+
+    // --- --- --- Prepare JSon record for output
+    nlohmann::json jv;
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Read args
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    cmdopt opt = getcmdopt(argc, argv);
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Read dataset
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    DTS train_dataset;
+    DTS test_dataset;
+    {
+        using namespace tempo::reader::dataset;
+        Result read_dataset_result = load(opt.input, (size_t) opt.nb_threads);
+        if (read_dataset_result.index() == 0) { do_exit(1, std::get<0>(read_dataset_result)); }
+        TrainTest traintest = std::get<1>(std::move(read_dataset_result));
+        train_dataset = traintest.train_dataset;
+        test_dataset = traintest.test_dataset;
+
+        nlohmann::json dataset;
+        dataset["train"] = train_dataset.header().to_json();
+        dataset["test"] = test_dataset.header().to_json();
+        dataset["load_time_ns"] = traintest.load_time.count();
+        dataset["load_time_str"] = utils::as_string(traintest.load_time);
+        jv["dataset"] = dataset;
+
+        std::vector<std::string> errors = sanity_check(traintest);
+        if (train_dataset.header().nb_dimensions() > 1) { errors.emplace_back("Only univariate series are supported"); }
+        if (!errors.empty()) {
+            jv["status"] = "error";
+            jv["status_message"] = utils::cat(errors, "; ");
+            cout << to_string(jv) << endl;
+            if (opt.output) {
+                auto out = ofstream(opt.output.value());
+                out << jv << endl;
+            }
+            exit(1);
+        }
+    } // End of dataset loading
+
+    DatasetHeader const &train_header = train_dataset.header();
+    DatasetHeader const &test_header = test_dataset.header();
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Train: envelopes of the train exemplars (DTW)
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    tempo::distance::DistanceSpec distance;
+    try { distance = tempo::distance::DistanceSpec::parse(opt.distance, train_header.length_max()); }
+    catch (std::invalid_argument const &e) { do_exit(1, e.what()); }
+
+    const auto train_start = utils::now();
+    std::vector<tempo::distance::KeoghEnvelopes> train_envelopes;
+    if (distance.dtw_lb) {
+        train_envelopes = tempo::distance::keogh_envelopes(train_dataset, distance.dtw_lb->second, opt.nb_threads);
+    }
+    const utils::duration_t train_time = utils::now() - train_start;
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Test: one search per test exemplar, in parallel
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    const auto test_start = utils::now();
+    std::vector<std::string> predictions(test_dataset.size());
+    tempo::distance::SearchCounters counters;
+    {
+        std::vector<tempo::distance::KeoghEnvelopes> const *lb_env = distance.dtw_lb ? &train_envelopes : nullptr;
+        auto task = [&](size_t i) {
+            TSeries const &query = test_dataset[i];
+            thread_local tempo::distance::KeoghEnvelopes query_env;
+            if (lb_env != nullptr) {
+                tempo::distance::univariate::get_keogh_envelopes(query.data(), query.length(), query_env.upper,
+                                                                 query_env.lower, distance.dtw_lb->second);
+            }
+            auto neighbours = tempo::distance::knn_search(distance, train_dataset, lb_env, query, query_env, opt.k,
+                                                          counters);
+            predictions[i] = vote(train_dataset, neighbours);
+        };
+        utils::ParTasks().execute(opt.nb_threads, task, 0, test_dataset.size());
+    }
+    const utils::duration_t test_time = utils::now() - test_start;
+
+    size_t nb_correct = 0;
+    size_t nb_labelled = 0;
+    for (size_t i = 0; i < test_dataset.size(); ++i) {
+        std::optional<std::string> const &l = test_dataset.original_label(i);
+        if (!l) { continue; }
+        ++nb_labelled;
+        if (l.value() == predictions[i]) { ++nb_correct; }
+    }
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Generate output and exit
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    jv["status"] = "success";
+
+    { // Classifier information
+        nlohmann::json j;
+        j["k"] = opt.k;
+        j["distance"] = distance.config;
+        j["train_time_ns"] = train_time.count();
+        j["train_time_human"] = utils::as_string(train_time);
+        j["test_time_ns"] = test_time.count();
+        j["test_time_human"] = utils::as_string(test_time);
+        j["nb_distances"] = counters.nb_distances.load();
+        j["nb_lb_pruned"] = counters.nb_lb_pruned.load();
+        j["float_type"] = std::is_same_v<F, float> ? "float" : "double";
+        j["nb_threads"] = opt.nb_threads;
+        jv["classifier_info"] = j;
+    }
+
+    { // Results
+        nlohmann::json j;
+        j["nb_test"] = test_header.size();
+        j["nb_correct"] = nb_correct;
+        j["accuracy"] = nb_labelled == 0 ? 0.0 : (double) nb_correct / (double) nb_labelled;
+        jv["results"] = j;
+    }
+
+    std::cout << jv.dump(2) << std::endl;
+
+    if (opt.output) {
+        auto out = ofstream(opt.output.value());
+        out << jv.dump(2) << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "tempo_pf2.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <tempo/reader/reader.hpp>
+#include <tempo/transform/pipeline.hpp>
+#include <tempo/utils/utils/resources.hpp>
+#include <tempo/classifier/TSChief/forest.hpp>
+
+namespace tsc = tempo::classifier::TSChief;
+using tempo::F;
+using tempo::PRNG;
+
+struct pf2_model {
+  tsc::Forest::Loaded loaded;
+  tsc::TreeData tdata;
+  tsc::TreeState tstate;
+  PRNG prng;
+  size_t nb_threads;
+  /// Derivatives computed on the series, for the transforms used by the forest other than "default"
+  tempo::transform::NamedKernels kernels;
+  /// Shape and classes of the train data
+  tempo::DatasetHeader const *header;
+  /// Serialize the predictions: the test data is registered in 'tdata'
+  std::mutex mutex;
+
+  pf2_model(tsc::Forest::Loaded&& l, size_t nb_threads, size_t seed) :
+    loaded(std::move(l)), tstate(seed, 0), prng(seed), nb_threads(nb_threads) {
+    if (loaded.train_exemplars->empty()) { throw std::runtime_error("Model without train exemplars"); }
+    tsc::register_train(tdata, loaded.train_exemplars);
+    header = &loaded.train_exemplars->begin()->second.header();
+    for (const auto& [tname, dts] : *loaded.train_exemplars) {
+      if (tname=="default") { continue; }
+      const std::string prefix = "derivative";
+      const std::string deg = tname.starts_with(prefix) ? tname.substr(prefix.size()) : "";
+      if (deg.empty()||!std::all_of(deg.begin(), deg.end(), [](char c) { return '0'<=c&&c<='9'; })) {
+        throw std::runtime_error("Model using an unsupported transform " + tname);
+      }
+      kernels.emplace_back(tname, tempo::transform::derivative_kernel(std::stoul(deg)));
+    }
+  }
+};
+
+namespace {
+
+  thread_local std::string last_error;
+
+  /// Run 'f', returning 0, or -1 after recording the error if it throws
+  template<typename Fun>
+  int guarded(Fun&& f) {
+    try {
+      last_error.clear();
+      f();
+      return 0;
+    } catch (std::exception const& e) {
+      last_error = e.what();
+    } catch (...) {
+      last_error = "Unknown error";
+    }
+    return -1;
+  }
+
+  /// Register series of the library floating point type, viewed in place, as the test data of the model.
+  /// Return false if there is no series.
+  bool register_series(pf2_model& model, F const *series, size_t nb_series, size_t length, size_t nb_dimensions) {
+    tempo::DatasetHeader const& header = *model.header;
+    if (nb_dimensions!=header.nb_dimensions()) {
+      throw std::invalid_argument("Expects series of " + std::to_string(header.nb_dimensions()) + " dimension(s)");
+    }
+    if (length<header.length_min()||length>header.length_max()) {
+      throw std::invalid_argument("Expects series of length " + std::to_string(header.length_min()) + ".."
+                                  + std::to_string(header.length_max()));
+    }
+    if (nb_series==0) { return false; }
+
+    // --- Test data viewing the buffer: [nb_series][length][nb_dimensions] is column major per series
+    tempo::reader::TSData tsdata;
+    tsdata.nb_dimensions = nb_dimensions;
+    tsdata.shortest_length = length;
+    tsdata.longest_length = length;
+    tsdata.series.reserve(nb_series);
+    const size_t stride = length*nb_dimensions;
+    for (size_t i = 0; i<nb_series; ++i) {
+      F const *data = series + i*stride;
+      if (std::any_of(data, data + stride, [](F v) { return std::isnan(v); })) {
+        throw std::invalid_argument("Missing values in series " + std::to_string(i));
+      }
+      tsdata.series.push_back(tempo::TSeries::mk_view({}, data, nb_dimensions, length, {}, {false}));
+    }
+    tempo::DTS dts = tempo::reader::tsdata_to_dts(std::move(tsdata), "capi", header.label_encoder());
+    auto map = std::make_shared<tsc::MDTS>();
+    tsc::MDTS derived = tempo::transform::transform_all(dts, model.kernels, model.nb_threads);
+    map->emplace("default", dts);
+    for (auto& [tname, tdts] : derived) { map->emplace(tname, std::move(tdts)); }
+    tsc::register_test(model.tdata, map);
+    return true;
+  }
+
+  /// Release the views of the caller's buffer
+  void release_series(pf2_model& model) { tsc::register_test(model.tdata, std::make_shared<tsc::MDTS>()); }
+
+  /// Predict series of the library floating point type, viewed in place
+  void predict(pf2_model& model, F const *series, size_t nb_series, size_t length, size_t nb_dimensions,
+               double *probabilities, size_t *predicted) {
+    if (series==nullptr||probabilities==nullptr) { throw std::invalid_argument("Null buffer"); }
+    if (!register_series(model, series, nb_series, length, nb_dimensions)) { return; }
+    tempo::DatasetHeader const& header = *model.header;
+
+    // --- Predict, then release the views of the buffer
+    tempo::classifier::ResultN result =
+      model.loaded.forest->predict_batch(model.tstate, model.tdata, tempo::IndexSet(nb_series), model.nb_threads);
+    release_series(model);
+
+    // --- Output
+    const size_t nb_classes = header.nb_classes();
+    std::vector<size_t> maxp;
+    for (size_t i = 0; i<nb_series; ++i) {
+      auto row = result.probabilities.row(i);
+      std::copy(row.begin(), row.end(), probabilities + i*nb_classes);
+      if (predicted!=nullptr) {
+        const double maxv = row.max();
+        maxp.clear();
+        for (size_t c = 0; c<nb_classes; ++c) { if (row[c]==maxv) { maxp.push_back(c); }}
+        predicted[i] = tempo::utils::pick_one(maxp, model.prng);
+      }
+    }
+  }
+
+  /// Leaf reached by series of the library floating point type, viewed in place, in each tree
+  void predict_leaves(pf2_model& model, F const *series, size_t nb_series, size_t length, size_t nb_dimensions,
+                      uint32_t *leaves) {
+    if (series==nullptr||leaves==nullptr) { throw std::invalid_argument("Null buffer"); }
+    if (!register_series(model, series, nb_series, length, nb_dimensions)) { return; }
+    const tsc::Forest::LeafIDs ids =
+      model.loaded.forest->predict_leaf_ids(model.tstate, model.tdata, tempo::IndexSet(nb_series), model.nb_threads);
+    release_series(model);
+    std::copy(ids.ids.begin(), ids.ids.end(), leaves);
+  }
+
+  /// Call 'f' on the series of type 'T': viewed in place if 'T' is the library floating point type, else converted
+  template<typename T, typename Fun>
+  int with_series(pf2_model *model, T const *series, size_t nb_series, size_t length, size_t nb_dimensions, Fun&& f) {
+    return guarded([&]() {
+      if (model==nullptr) { throw std::invalid_argument("Null model"); }
+      std::lock_guard lock(model->mutex);
+      if constexpr (std::is_same_v<T, F>) { f(series); }
+      else {
+        if (series==nullptr) { throw std::invalid_argument("Null buffer"); }
+        const std::vector<F> converted(series, series + nb_series*length*nb_dimensions);
+        f(converted.data());
+      }
+    });
+  }
+
+  /// Predict series of type 'T' (see with_series)
+  template<typename T>
+  int predict_batch(pf2_model *model, T const *series, size_t nb_series, size_t length, size_t nb_dimensions,
+                    double *probabilities, size_t *predicted) {
+    return with_series(model, series, nb_series, length, nb_dimensions, [&](F const *s) {
+      predict(*model, s, nb_series, length, nb_dimensions, probabilities, predicted);
+    });
+  }
+
+  /// Leaves of series of type 'T' (see with_series)
+  template<typename T>
+  int predict_leaves_batch(pf2_model *model, T const *series, size_t nb_series, size_t length, size_t nb_dimensions,
+                           uint32_t *leaves) {
+    return with_series(model, series, nb_series, length, nb_dimensions, [&](F const *s) {
+      predict_leaves(*model, s, nb_series, length, nb_dimensions, leaves);
+    });
+  }
+
+} // End of anonymous namespace
+
+extern "C" {
+
+const char *pf2_last_error(void) { return last_error.c_str(); }
+
+pf2_model *pf2_model_load(const char *path, int nb_threads, unsigned long long seed) {
+  pf2_model *model = nullptr;
+  guarded([&]() {
+    if (path==nullptr) { throw std::invalid_argument("Null path"); }
+    const size_t nbt = nb_threads<=0 ? tempo::utils::resources::available_cpus() : (size_t)nb_threads;
+    model = new pf2_model(tsc::Forest::load_mapped(path), nbt, (size_t)seed);
+  });
+  return model;
+}
+
+void pf2_model_free(pf2_model *model) { delete model; }
+
+size_t pf2_model_nb_classes(const pf2_model *model) { return model->header->nb_classes(); }
+
+const char *pf2_model_class_name(const pf2_model *model, size_t c) {
+  auto const& labels = model->header->label_encoder().index_to_label();
+  return c<labels.size() ? labels[c].c_str() : nullptr;
+}
+
+size_t pf2_model_nb_dimensions(const pf2_model *model) { return model->header->nb_dimensions(); }
+
+size_t pf2_model_length_min(const pf2_model *model) { return model->header->length_min(); }
+
+size_t pf2_model_length_max(const pf2_model *model) { return model->header->length_max(); }
+
+int pf2_predict_batch_f64(pf2_model *model, const double *series, size_t nb_series, size_t length,
+                          size_t nb_dimensions, double *probabilities, size_t *predicted) {
+  return predict_batch(model, series, nb_series, length, nb_dimensions, probabilities, predicted);
+}
+
+int pf2_predict_batch_f32(pf2_model *model, const float *series, size_t nb_series, size_t length,
+                          size_t nb_dimensions, double *probabilities, size_t *predicted) {
+  return predict_batch(model, series, nb_series, length, nb_dimensions, probabilities, predicted);
+}
+
+size_t pf2_model_nb_trees(const pf2_model *model) { return model->loaded.forest->forest.size(); }
+
+int pf2_predict_leaves_f64(pf2_model *model, const double *series, size_t nb_series, size_t length,
+                           size_t nb_dimensions, uint32_t *leaves) {
+  return predict_leaves_batch(model, series, nb_series, length, nb_dimensions, leaves);
+}
+
+int pf2_predict_leaves_f32(pf2_model *model, const float *series, size_t nb_series, size_t length,
+                           size_t nb_dimensions, uint32_t *leaves) {
+  return predict_leaves_batch(model, series, nb_series, length, nb_dimensions, leaves);
+}
+
+int pf2_float_bits(void) { return (int)(8*sizeof(F)); }
+
+} // extern "C"
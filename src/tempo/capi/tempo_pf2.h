@@ -0,0 +1,81 @@
+#ifndef TEMPO_PF2_H
+#define TEMPO_PF2_H
+
+/* C API of the PF2 scorer, usable from any language with a C foreign function interface (ctypes, cffi, JNA...).
+ * A model is a forest written by PF2 --model-out, loaded once, and predicting batches of series read in place
+ * from the caller's buffers.
+ * Functions returning an int return 0 on success and -1 on failure; functions returning a pointer return NULL on
+ * failure. The reason of the last failure on the calling thread is given by pf2_last_error.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(TEMPO_PF2_BUILD)
+#    define TEMPO_PF2_API __declspec(dllexport)
+#  else
+#    define TEMPO_PF2_API __declspec(dllimport)
+#  endif
+#else
+#  define TEMPO_PF2_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque loaded model */
+typedef struct pf2_model pf2_model;
+
+/* Reason of the last failure on the calling thread, "" if none. Valid until the next call on the thread. */
+TEMPO_PF2_API const char *pf2_last_error(void);
+
+/* Load a model file, memory mapped, predicting with 'nb_threads' threads (<=0: all the hardware threads), and
+ * breaking the ties with 'seed'. */
+TEMPO_PF2_API pf2_model *pf2_model_load(const char *path, int nb_threads, unsigned long long seed);
+
+/* Release a model. Does nothing on NULL. */
+TEMPO_PF2_API void pf2_model_free(pf2_model *model);
+
+/* Number of classes, and name of the class 'c' (valid for the lifetime of the model, NULL if out of range).
+ * Columns of the probabilities are in this order. */
+TEMPO_PF2_API size_t pf2_model_nb_classes(const pf2_model *model);
+TEMPO_PF2_API const char *pf2_model_class_name(const pf2_model *model, size_t c);
+
+/* Shape of the series expected by the model: number of dimensions, and range of lengths */
+TEMPO_PF2_API size_t pf2_model_nb_dimensions(const pf2_model *model);
+TEMPO_PF2_API size_t pf2_model_length_min(const pf2_model *model);
+TEMPO_PF2_API size_t pf2_model_length_max(const pf2_model *model);
+
+/* Predict 'nb_series' series of 'length' timestamps of 'nb_dimensions' values.
+ * 'series' is a contiguous row major array [nb_series][length][nb_dimensions] (for univariate series, simply
+ * [nb_series][length]), read in place (not copied) when its type is the floating point type of the library
+ * (see pf2_float_bits), else converted. It is not retained after the call.
+ * 'probabilities' receives a row major array [nb_series][nb_classes]. If not NULL, 'predicted' receives the index
+ * of the most probable class of each series, ties broken at random. Series must not contain NaN.
+ * Calls on the same model are serialized: use several models to predict concurrently. */
+TEMPO_PF2_API int pf2_predict_batch_f64(pf2_model *model, const double *series, size_t nb_series, size_t length,
+                                        size_t nb_dimensions, double *probabilities, size_t *predicted);
+TEMPO_PF2_API int pf2_predict_batch_f32(pf2_model *model, const float *series, size_t nb_series, size_t length,
+                                        size_t nb_dimensions, double *probabilities, size_t *predicted);
+
+/* Number of trees of the model */
+TEMPO_PF2_API size_t pf2_model_nb_trees(const pf2_model *model);
+
+/* Leaf reached by each series in each tree, e.g. to compute forest proximities: series as in pf2_predict_batch_f64.
+ * 'leaves' receives a row major array [nb_series][nb_trees]; two series reach the same leaf of a tree if they get
+ * the same value in its column. Leaf identifiers are stable for a model file, and below 2^32. */
+TEMPO_PF2_API int pf2_predict_leaves_f64(pf2_model *model, const double *series, size_t nb_series, size_t length,
+                                         size_t nb_dimensions, uint32_t *leaves);
+TEMPO_PF2_API int pf2_predict_leaves_f32(pf2_model *model, const float *series, size_t nb_series, size_t length,
+                                         size_t nb_dimensions, uint32_t *leaves);
+
+/* Size in bits of the floating point type of the library: 64, or 32 when built with TEMPO_FLOAT32 */
+TEMPO_PF2_API int pf2_float_bits(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TEMPO_PF2_H */
@@ -0,0 +1,13 @@
+#include "pf2018.hpp"
+
+namespace tempo::classifier {
+
+    PF2018::PF2018(
+            DTS const &train_dataset,
+            DatasetHeader const &train_header,
+            size_t nb_candidates,
+            size_t nb_trees,
+            tsc::TreeState &tstate
+    ) : ProximityForest2(train_dataset, train_header, nb_candidates, nb_trees, tstate, "pf2018") {}
+
+} // End of namespace tempo::classifier
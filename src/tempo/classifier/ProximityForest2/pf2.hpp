@@ -1,9 +1,17 @@
 #pragma once
 
+#include <exception>
+#include <iomanip>
 #include <regex>
+#include <thread>
 #include <tempo/dataset/dts.hpp>
+#include <tempo/distance/autotune.hpp>
 #include <tempo/reader/dts.reader.hpp>
 #include <tempo/transform/tseries.univariate.hpp>
+#include <tempo/transform/pipeline.hpp>
+#include <tempo/utils/utils/bounded_queue.hpp>
+#include <tempo/utils/utils/usage.hpp>
+#include <tempo/writer/arrow/arrow.hpp>
 #include <tempo/classifier/TSChief/splitter_interface.hpp>
 #include <tempo/classifier/TSChief/snode/nn1splitter/nn1dist_interface.hpp>
 #include <tempo/classifier/TSChief/snode/nn1splitter/nn1splitter.hpp>
@@ -12,6 +20,8 @@
 
 #include "tempo/classifier/TSChief/tree.hpp"
 #include "tempo/classifier/TSChief/forest.hpp"
+#include "tempo/classifier/TSChief/progress.hpp"
+#include "tempo/classifier/TSChief/stream_scorer.hpp"
 #include "tempo/classifier/TSChief/sleaf/pure_leaf.hpp"
 #include "tempo/classifier/TSChief/sleaf/pure_leaf_smoothp.hpp"
 #include "tempo/classifier/TSChief/snode/meta/chooser.hpp"
@@ -27,6 +37,7 @@
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1_twe.hpp"
 
 #include "tempo/classifier/TSChief/pfsplitters.hpp"
+#include "tempo/classifier/classifier.hpp"
 
 namespace tempo::classifier {
 
@@ -39,7 +50,7 @@ namespace tempo::classifier {
 
     namespace ttu = tempo::transform::univariate;
 
-    class ProximityForest2 {
+    class ProximityForest2 : public i_Classifier {
 
         // --- From constructor
         DTS const &train_dataset;
@@ -48,19 +59,31 @@ namespace tempo::classifier {
         const size_t nb_candidates;
         const size_t nb_trees;
 
-        const std::string str = "pf2";
+        /// Configuration: "pf2", "pf2018" (see PF2018), or distance names separated by ':'
+        /// (see pf::splitters::make_node_splitter)
+        const std::string str;
 
         const std::string tr_default = "default";
         const std::string tr_d1 = "derivative1";
 
-        const std::vector<std::string> transforms{tr_default, tr_d1};
-
         const std::vector<F> exponents{0.5, 1, 2};
 
+        /// Nodes with at least this number of exemplars generate their candidates concurrently (with forked states)
+        const size_t fork_min_size = 256;
+
+        /// Branches with at least this number of exemplars are trained as independent tasks (with forked states)
+        const size_t branch_fork_min_size = 1024;
+
+        /// Nodes with at least this number of exemplars search the nearest neighbours of their queries concurrently
+        const size_t batch_min_size = 4096;
+
         shared_ptr<MDTS> train_map = make_shared<MDTS>();
         shared_ptr<MDTS> test_map = make_shared<MDTS>();
 
         std::shared_ptr<tsc::Forest> forest;
+        /// PAA transforms used by the loaded forest (see set_model): computed for the test data along the ones of
+        /// config_options. Empty for a trained forest.
+        std::vector<std::string> model_paa_transforms;
         tsc::TreeData tdata;
         tsc::TreeState &tstate;
 
@@ -70,120 +93,984 @@ namespace tempo::classifier {
                 DatasetHeader const &train_header,
                 size_t nb_candidates,
                 size_t nb_trees,
-                tsc::TreeState &tstate
+                tsc::TreeState &tstate,
+                std::string configuration_name = "pf2"
         ) : train_dataset(train_dataset), train_header(train_header),
             nb_candidates(nb_candidates),
-            nb_trees(nb_trees), tstate(tstate) {}
+            nb_trees(nb_trees), str(std::move(configuration_name)), tstate(tstate) {}
+
+        /// Name of the configuration, as given to the constructor
+        std::string const &name() const override { return str; }
+
+
+        utils::duration_t prepare_train_data_time{};
+        utils::duration_t prepare_test_data_time{};
+        utils::duration_t train_time{};
+        utils::duration_t test_time{};
+        /// CPU time versus wall time of the last training and prediction, per thread (see utils::usage::Phase)
+        std::optional<utils::usage::PhaseUsage> train_usage{};
+        std::optional<utils::usage::PhaseUsage> test_usage{};
+
+        // --- --- --- SAMPLING
+
+        /// Per tree stratified sample ratio of the train data (see ByClassMap::stratified_sampling); none by default
+        std::optional<double> sampling_ratio{};
+
+        /// When sampling, cap on the number of train exemplars drawn per class for each tree
+        std::optional<size_t> sampling_max_per_class{};
+
+        // --- --- --- TREE SIZE
+
+        /// Bounds on the trees (see pf::splitters::make_bounded_leaf): nodes at this depth (the root is at depth 0),
+        /// with less than 'min_node_size' exemplars, or whose split reduces the Gini impurity by less than
+        /// 'min_gini_gain', are leaves predicting their smoothed class distribution. No bound by default.
+        std::optional<size_t> max_depth{};
+        size_t min_node_size{0};
+        double min_gini_gain{0};
+
+        /// Prune the trained trees (see TSChief::Forest::prune): same predictions, with less nodes
+        bool prune_trees{true};
+
+        // --- --- --- NODE SAMPLING
+
+        /// Nodes with at least 'node_sample_min_size' exemplars score their candidates on a stratified sample of
+        /// 'node_sample_ratio' of their exemplars, then split all of them with the chosen candidate
+        /// (see pf::splitters::make_node_splitter). Off by default.
+        size_t node_sample_min_size{std::numeric_limits<size_t>::max()};
+        double node_sample_ratio{1};
+
+        // --- --- --- FAN-OUT
+
+        /// If at least 2, the NN1 nodes with more classes split on this number of groups of classes, bounding their
+        /// distances per query and their number of branches (see pf::splitters::make_node_splitter); 0 by default
+        size_t max_fanout{0};
+
+        // --- --- --- CHUNKED ROUTING
+
+        /// NN1 nodes with at least this number of exemplars search and route chunks of their queries concurrently,
+        /// with their own tie breaks (see pf::splitters::make_node_splitter): a single large tree uses all the
+        /// threads. Off by default.
+        size_t chunk_min_size{std::numeric_limits<size_t>::max()};
+
+        // --- --- --- COST BUDGET
+
+        /// If finite, budget of the estimated distance cost of the candidates per node exemplar: a node generates
+        /// candidates while their cost is below its budget (see pf::splitters::make_node_splitter). Off by default.
+        double cost_budget{std::numeric_limits<double>::infinity()};
+
+        // --- --- --- ADAPTIVE SAMPLING
+
+        /// When set, the nodes draw their distances with the weights of this sampler, lowering the draws of the
+        /// expensive distances rarely chosen by the nodes already trained (see pf::splitters::make_node_splitter).
+        /// Holds the statistics of the last training. None by default: uniform draw.
+        std::shared_ptr<tsc::snode::meta::AdaptiveSampler> adaptive_sampler{};
+
+        // --- --- --- WDTW
+
+        /// If not 0, WDTW candidates draw their 'g' among this number of precomputed weight tables
+        /// (see pf::splitters::make_node_splitter); 0 by default: any 'g' in [0, 1[
+        size_t wdtw_nb_tables{0};
+
+        // --- --- --- ADTW
+
+        /// If set, file of the ADTW penalties: loaded if it matches the train data and the seed, else sampled and saved
+        /// (see pf::splitters::make_adtw_penalties)
+        std::optional<std::filesystem::path> adtw_penalties_path{};
+
+        // --- --- --- DTW KERNELS
+
+        /// If set, cache file of the DTW kernels tuned on this CPU: loaded, then the entries missing for the train
+        /// data are tuned on a sample of it (see distance::autotune), and the file is saved if some were
+        std::optional<std::filesystem::path> autotune_path{};
+
+        /// Number of train series timed by the autotuning
+        static constexpr size_t autotune_sample_size = 32;
+
+        /// Out-of-bag results, computed by train when sampling: number of train exemplars left out by at least one
+        /// tree, number of them correctly predicted by the trees they were left out of, and timing
+        size_t oob_nb_exemplars{0};
+        size_t oob_nb_correct{0};
+        utils::duration_t oob_time{};
+
+        // --- --- --- COMBINER
+
+        /// How predict, predict_stream and the out-of-bag accuracy combine the results of the trees
+        /// (see TSChief::Combiner)
+        tsc::Combiner combiner{tsc::Combiner::WEIGHTED_AVERAGE};
+
+        /// Tree-major scoring (see TSChief::Forest::tree_major)
+        bool tree_major{false};
+
+        // --- --- --- ANYTIME PREDICTION
+
+        /// When set, predict and predict_stream evaluate the trees by rounds, and stop evaluating an exemplar once
+        /// its vote is decided (see TSChief::Forest::predict_anytime)
+        std::optional<tsc::Forest::Anytime> anytime{};
+
+        /// Average number of trees evaluated per test exemplar by the last prediction
+        double anytime_average_nb_trees{0};
+
+        // --- --- --- FOREST PREFIXES
+
+        /// When not empty (and without anytime), predict also gives the results of the prefixes of the forest with
+        /// these numbers of trees, non decreasing (see TSChief::Forest::predict_prefixes), in 'prefix_results' with
+        /// their number of trees: sizes beyond the size of the forest give the forest.
+        /// For predict only: predict_stream scores by blocks.
+        std::vector<size_t> prefix_sizes{};
+        std::vector<std::pair<size_t, classifier::ResultN>> prefix_results{};
+
+        // --- --- --- TEST TIME DISTANCE MEMO
+
+        /// When set, the trees of a prediction share the distances they compute between the test and train exemplars,
+        /// in a memo of at most this number of entries (see TSChief::DistanceMemo)
+        std::optional<size_t> memo_max_entries{};
+
+        /// Lookups in the memo of the last prediction, and lookups resolved by it (hits)
+        size_t memo_lookups{0};
+        size_t memo_hits{0};
+
+        double memo_hit_rate() const { return memo_lookups == 0 ? 0.0 : (double) memo_hits / (double) memo_lookups; }
+
+        // --- --- --- TRAIN TIME DISTANCE MEMO
+
+        /// When set, the trees of a training share the distances their NN1 nodes compute between train exemplars, in
+        /// a memo of at most this number of entries (see TSChief::TreeState::train_memo). Meant for small train sets,
+        /// where the trees often compare the same pairs with the same distance parameters.
+        std::optional<size_t> train_memo_max_entries{};
+
+        /// Lookups in the train memo of the last training, and lookups resolved by it (hits)
+        size_t train_memo_lookups{0};
+        size_t train_memo_hits{0};
+
+        double train_memo_hit_rate() const {
+            return train_memo_lookups == 0 ? 0.0 : (double) train_memo_hits / (double) train_memo_lookups;
+        }
+
+        // --- --- --- PROGRESS
+
+        /// When set, train reports its progress as JSON lines on this sink (see TSChief::ProgressReporter),
+        /// instead of printing one line per tree on the standard output
+        std::ostream *progress_sink{nullptr};
+
+        /// Messages and per tree progress of train and predict, when set (e.g. not with several classifiers running
+        /// concurrently)
+        std::ostream *log{&std::cout};
+
+        /// Time between two progress lines
+        std::chrono::milliseconds progress_period{std::chrono::seconds(1)};
+
+        /// Number of distances computed by the node splitters of the last training (see TrainingProgress).
+        /// Only counted when reporting the progress (see set_progress).
+        size_t train_nb_distances{0};
+
+        /// When set, train and predict record the time spent in their phases (see TSChief::PhaseTimers)
+        std::shared_ptr<tsc::PhaseTimers> timers{};
+
+        // --- --- --- MEMORY
+
+        /// Allocations made during the last training (TSChief::ForestTrainer::train), by all the threads.
+        /// Zeros unless built with TEMPO_COUNT_ALLOCATIONS (see utils::memory::allocations).
+        utils::memory::Allocations train_allocations{};
 
+        /// Train and test transforms used by the last training and prediction, by name
+        MDTS const &get_train_map() const { return *train_map; }
+        MDTS const &get_test_map() const { return *test_map; }
 
-        utils::duration_t prepare_train_data_time;
-        utils::duration_t prepare_test_data_time;
-        utils::duration_t train_time;
-        utils::duration_t test_time;
+        /// Memory held by the trained (or loaded) forest; zeros without a forest
+        tsc::TreeMemory forest_memory() const { return forest ? forest->memory() : tsc::TreeMemory{}; }
+
+        /// Statistics of the trained (or loaded) forest (see TSChief::Forest::stats); zeros without a forest
+        tsc::TreeStats forest_stats() const { return forest ? forest->stats() : tsc::TreeStats{}; }
+
+        /// Number of trees of the trained (or loaded) forest; 0 without a forest
+        size_t forest_size() const { return forest ? forest->forest.size() : 0; }
+
+        /// Header of the train set of the trained (or loaded) forest, encoding the classes of the probabilities
+        DatasetHeader const &get_train_header() const { return train_header; }
+
+        // --- --- --- PRECOMPUTED TRANSFORMS
+
+        /// Transforms of the train and test data already computed, by name, used instead of computing them.
+        /// E.g. memory mapped from binary files (see reader::load_dataset_bin_transform), for train data larger than
+        /// the memory: then also set 'advise_train', so that the nodes page in their series (see TreeData).
+        MDTS train_transforms{};
+        MDTS test_transforms{};
+        bool advise_train{false};
+
+        /// Compute the transforms other than the default one (and not precomputed) on first use by a splitter or a
+        /// tree, instead of before training and predicting (see TSChief::register_train): the ones never picked are
+        /// never computed. They are computed by one thread. Then, get_train_map and get_test_map only hold the
+        /// transforms computed before training and predicting.
+        bool lazy_transforms{false};
+
+        /// Keep only the raw test data for the first derivative: the NN1 splitters derive the test series on the fly
+        /// (see TSChief::set_virtual_test_derivative), the ADTW, DTW and LCSS ones inside their kernels. Saves one copy
+        /// of the test data when predicting large test sets. The train derivative is still computed.
+        bool virtual_test_derivative{false};
+
+        // --- --- --- CONFIGURATION
+
+        /// Options added to the "pf2" configuration, validated by train:
+        ///  * "paa<f>" (f>=2): the PAA transform of this name (see transform::transform_paa) joins the transforms
+        ///    drawn by the distances, e.g. "paa4", "paa8". The windows stay relative to the full length.
+        ///  * "dtwpaa<f>" or "dtwpaa<f>@<tol>": coarse to fine DTW (see pf::splitters::coarse_dtw_option)
+        ///  * "dtwproba": DTW windows drawn as with pf::splitters::make_proba_window
+        /// A loaded model predicts with the PAA transforms it was trained with, whatever these options.
+        std::vector<std::string> config_options{};
+
+        // --- --- --- NUMA
+
+        /// Interleave the pages of the train transforms over the NUMA nodes before training (see
+        /// tempo::interleave_storage): without it, the pages live on the node of the thread that prepared them.
+        bool numa_interleave{false};
+
+        /// Bytes of train transforms interleaved by the last training
+        size_t numa_interleaved_bytes{0};
 
         // --- --- --- TRAIN
 
-        void train(int nb_threads) {
+        void train(int nb_threads) override { train_trees(nb_threads, nb_trees, 0); }
+
+        /// Append the trees to this checkpoint as they are trained, resuming from the trees it holds
+        /// (see TSChief::Checkpoint); none by default.
+        std::optional<tsc::Checkpoint> checkpoint{};
+
+        /// When set, train writes the model to this file as the trees complete, holding only the trees in training
+        /// (see TSChief::ForestTrainer::train_streaming), then loads it memory mapped, as load_model. No out-of-bag
+        /// results. The exemplars are stored as 'stream_model_quantize' (see save_model).
+        std::optional<std::filesystem::path> stream_model{};
+        std::optional<distance::quantized::QFormat> stream_model_quantize{};
+
+        /// Wall clock budget of the training: 'nb_trees' is then a maximum (see TSChief::ForestTrainer::time_budget).
+        /// None by default.
+        std::optional<utils::duration_t> train_time_budget{};
+
+        /// Number of trees of the loaded forest dropped by the last call to grow
+        size_t grow_nb_dropped{0};
+
+        /** Warm start: grow the loaded forest (see load_model) with 'nb_new_trees' trees trained on the train data,
+         *  dropping its oldest trees to keep at most 'nb_trees' trees (see TSChief::Forest::merge).
+         *  Trees are kept in age order, oldest first. The new trees draw from the streams of the tree indexes
+         *  following the ones of all the trees trained for the loaded forest, dropped ones included (see
+         *  TSChief::Forest::next_tree_index): a forest grown again gets new trees, with the same seed.
+         *  The model must have been trained with the same label encoding as 'train_header'.
+         */
+        void grow(int nb_threads, size_t nb_new_trees) {
+            if (!forest) { throw std::logic_error("No loaded forest to grow"); }
+            if (nb_new_trees == 0) { throw std::invalid_argument("No tree to grow"); }
+            // Keep the loaded forest and its data aside while training the new trees
+            std::shared_ptr<tsc::Forest> loaded = std::move(forest);
+            tsc::TreeData loaded_tdata = std::move(tdata);
+            tdata = {};
+            train_map = make_shared<MDTS>();
+            train_trees(nb_threads, nb_new_trees, loaded->next_tree_index);
+            // Keep the newest trees of the loaded forest
+            auto merge_start_time = utils::now();
+            const size_t nb_kept = std::min(loaded->forest.size(), nb_trees - std::min(nb_trees, nb_new_trees));
+            grow_nb_dropped = loaded->forest.size() - nb_kept;
+            tsc::Forest kept(std::vector<tsc::Forest::TREE>(loaded->forest.end() - (long) nb_kept, loaded->forest.end()),
+                             loaded->trainclass_cardinality);
+            tsc::Forest::Loaded merged = tsc::Forest::merge({{&kept, &loaded_tdata}, {forest.get(), &tdata}});
+            tdata = {};
+            set_model(std::move(merged));
+            train_time += utils::now() - merge_start_time;
+        }
+
+        /** Worker of a distributed training: train only the trees [first_tree, first_tree+nb_range_trees[ of the
+         *  forest of 'nb_trees' trees, with the streams of their tree indexes (see TSChief::TreeState). Workers using
+         *  the same configuration, seed and train data train the trees a single training would: the models of the
+         *  ranges can then be merged in one (see merge_models).
+         */
+        void train_range(int nb_threads, size_t first_tree, size_t nb_range_trees) {
+            if (nb_range_trees == 0) { throw std::invalid_argument("No tree to train"); }
+            if (first_tree + nb_range_trees > nb_trees) {
+                throw std::invalid_argument("Tree range beyond the " + std::to_string(nb_trees) + " trees");
+            }
+            train_trees(nb_threads, nb_range_trees, first_tree);
+        }
+
+        /** Coordinator of a distributed training: merge the models written by the workers (see train_range) in one,
+         *  instead of training. The trees are gathered in the order of 'paths': give the ranges in tree order.
+         *  The models must have been trained with the same label encoding as 'train_header'.
+         */
+        void merge_models(std::vector<std::filesystem::path> const &paths) {
+            if (paths.empty()) { throw std::invalid_argument("No model to merge"); }
+            auto merge_start_time = utils::now();
+            std::vector<tsc::Forest::Loaded> loaded;
+            std::vector<tsc::TreeData> loaded_tdata(paths.size());
+            std::vector<std::pair<tsc::Forest const *, tsc::TreeData const *>> parts;
+            for (size_t i = 0; i < paths.size(); ++i) {
+                loaded.push_back(tsc::Forest::load_mapped(paths[i]));
+                tsc::register_train(loaded_tdata[i], loaded.back().train_exemplars);
+                parts.emplace_back(loaded.back().forest.get(), &loaded_tdata[i]);
+            }
+            // Note: the merged exemplars are copies, the mapped models are released after the merge
+            set_model(tsc::Forest::merge(parts));
+            train_time += utils::now() - merge_start_time;
+        }
+
+    private:
+
+        /// Train 'nb_train_trees' trees, with the streams of the tree indexes from 'first_tree_index'
+        /// Tune the DTW kernels on a sample of the univariate train series, spread over the train data
+        void autotune_dtw(std::filesystem::path const &path) {
+            namespace at = tempo::distance::autotune;
+            at::load(path);
+            std::vector<std::vector<F>> sample;
+            auto it = train_map->find(tr_default);
+            if (it != train_map->end()) {
+                DTS const &dts = it->second;
+                const size_t step = std::max<size_t>(1, dts.size() / autotune_sample_size);
+                for (size_t i = 0; i < dts.size() && sample.size() < autotune_sample_size; i += step) {
+                    TSeries const &s = dts[i];
+                    if (s.nb_dimensions() == 1) { sample.emplace_back(s.data(), s.data() + s.length()); }
+                }
+            }
+            if (at::tune_dtw<F>(sample, log) > 0) { at::save(path); }
+        }
+
+        void train_trees(int nb_threads, size_t nb_train_trees, size_t first_tree_index) {
             auto [train_bcm, train_bcm_remains] = train_dataset.get_BCM();
 
             // --- --- --- Prepare the data
 
             auto prepare_data_start_time = utils::now();
-            {
-                auto train_derive_t1 = train_dataset.transform().map_shptr<TSeries>(
-                        [](TSeries const &t) { return ttu::derive(t); }, tr_d1);
-
-                DTS train_derive_1("train", train_derive_t1);
-                train_map->emplace(tr_default, train_dataset);
-                train_map->emplace(tr_d1, train_derive_1);
+            tsc::LazyMDTS train_lazy;
+            const std::set<std::string> distances = configuration();
+            fill_map(train_dataset, train_transforms, *train_map, train_lazy, nb_threads, derived_transforms());
+            if (numa_interleave) {
+                numa_interleaved_bytes = 0;
+                for (const auto &[tn, dts]: *train_map) { numa_interleaved_bytes += interleave_storage(dts); }
             }
             prepare_train_data_time = utils::now() - prepare_data_start_time;
 
-            tsc::register_train(tdata, train_map);
+            tdata.advise_train = advise_train;
+            tsc::register_train(tdata, train_map, (size_t) std::max(nb_threads, 1), train_lazy);
+            if (autotune_path) { autotune_dtw(autotune_path.value()); }
 
 
             // --- --- --- Build the leaf generator
-            std::shared_ptr<tsc::i_GenLeaf> leaf_gen = pf::splitters::make_pure_leaf(train_header);
-
-            regex r(":");
-            std::set<std::string> distances(
-                    sregex_token_iterator(str.begin(), str.end(), r, -1),
-                    sregex_token_iterator()
-            );
-            if (distances.empty()) { throw std::invalid_argument("No distances registered (" + str + ")"); }
+            std::shared_ptr<tsc::i_GenLeaf> leaf_gen = pf::splitters::make_bounded_leaf(train_header, max_depth,
+                                                                                        min_node_size, min_gini_gain);
 
             // --- --- --- Build the node generator
+            // Threads not used by the trees generate the candidates of large nodes
+            const size_t candidate_threads = std::max<size_t>(1, (size_t) std::max(nb_threads, 1) / nb_train_trees);
             std::shared_ptr<tsc::i_GenNode> node_gen = pf::splitters::make_node_splitter(
-                    exponents, transforms, distances, nb_candidates,
+                    exponents, transforms(), distances, nb_candidates,
                     train_header.length_max(),
-                    *train_map,
-                    tstate
+                    tdata,
+                    tstate,
+                    candidate_threads,
+                    fork_min_size,
+                    wdtw_nb_tables,
+                    adtw_penalties_path,
+                    (size_t) std::max(nb_threads, 1),
+                    batch_min_size,
+                    node_sample_min_size,
+                    node_sample_ratio,
+                    max_fanout,
+                    cost_budget,
+                    adaptive_sampler,
+                    chunk_min_size
             );
 
             // --- --- --- Make the tree trainer
-            std::shared_ptr<tsc::TreeTrainer> tree_trainer = std::make_shared<tsc::TreeTrainer>(leaf_gen, node_gen);
+            // Large branches are trained concurrently, so that a few deep trees can use all the threads
+            std::shared_ptr<tsc::TreeTrainer> tree_trainer = std::make_shared<tsc::TreeTrainer>(
+                    leaf_gen, node_gen, candidate_threads, branch_fork_min_size
+            );
 
             // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
             // Use the forest
             // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
-            tsc::ForestTrainer forest_trainer(train_header, tree_trainer, nb_trees);
+            tsc::ForestTrainer forest_trainer(train_header, tree_trainer, nb_train_trees);
+            forest_trainer.first_tree_index = first_tree_index;
 
-            std::optional<double> ratio = std::nullopt;
+            forest_trainer.sampling_max_per_class = sampling_max_per_class;
+            forest_trainer.prune = prune_trees;
+            forest_trainer.checkpoint = checkpoint;
+            forest_trainer.time_budget = train_time_budget;
 
+            // Progress counters, shared by all the states forked from tstate during the training
+            std::optional<tsc::ProgressReporter> reporter;
+            if (progress_sink != nullptr) {
+                tstate.progress = std::make_shared<tsc::TrainingProgress>(nb_train_trees);
+                reporter.emplace(tstate.progress, *progress_sink, progress_period);
+            }
+
+            tstate.timers = timers;
+            if (train_memo_max_entries) {
+                tstate.train_memo = std::make_shared<tsc::DistanceMemo>(train_memo_max_entries.value());
+            }
+            const auto train_start_allocations = utils::memory::allocations();
+            const utils::usage::Phase train_phase((size_t) nb_threads);
             auto train_start_time = utils::now();
-            forest = forest_trainer.train(
-                    tstate,
-                    tdata,
-                    train_bcm,
-                    nb_threads,
-                    ratio,
-                    &std::cout
-            );
+            model_paa_transforms.clear();
+            if (stream_model) {
+                forest_trainer.train_streaming(
+                        tstate,
+                        tdata,
+                        train_bcm,
+                        nb_threads,
+                        stream_model.value(),
+                        sampling_ratio,
+                        stream_model_quantize,
+                        progress_sink == nullptr ? log : nullptr
+                );
+            } else {
+                forest = forest_trainer.train(
+                        tstate,
+                        tdata,
+                        train_bcm,
+                        nb_threads,
+                        sampling_ratio,
+                        progress_sink == nullptr ? log : nullptr
+                );
+            }
             train_time = utils::now() - train_start_time;
+            train_usage = train_phase.stop();
+            train_allocations = utils::memory::allocations() - train_start_allocations;
+
+            if (reporter) {
+                reporter->stop();
+                train_nb_distances = tstate.progress->total(tsc::TrainingProgress::DISTANCES);
+                tstate.progress.reset();
+            }
+
+            if (tstate.train_memo) {
+                train_memo_lookups = tstate.train_memo->nb_lookups();
+                train_memo_hits = tstate.train_memo->nb_hits();
+                if (log != nullptr) {
+                    *log << "Train memo: " << train_memo_hits << " / " << train_memo_lookups << " hits ("
+                         << train_memo_hit_rate() << "), " << tstate.train_memo->size() << " entries" << std::endl;
+                }
+                tstate.train_memo.reset();
+            }
+
+            if (stream_model) { load_model(stream_model.value()); }
+            else if (sampling_ratio) { compute_oob(train_bcm, nb_threads); }
+
+            // Hit rate of the per node distance caches, merged in the state by the trainer
+            for (const auto &substate: tstate.states) {
+                auto *states = dynamic_cast<pf::splitters::NodeSplitterStates *>(substate.get());
+                if (states != nullptr && log != nullptr) {
+                    auto const &nn1_state = states->get<tsc_nn1::GenSplitterNN1_State>();
+                    *log << "Distance cache: " << nn1_state.cache_hits << " / " << nn1_state.cache_lookups
+                              << " hits (" << nn1_state.cache_hit_rate() << ")" << std::endl;
+                }
+            }
         }
 
-        classifier::ResultN predict(DTS const &test_dataset, int nb_threads) {
-            auto prepare_data_start_time = utils::now();
-            {
-                auto test_derive_t1 = test_dataset.transform().map_shptr<TSeries>(
-                        [](TSeries const &t) { return ttu::derive(t); }, tr_d1);
-                DTS test_derive_1("test", test_derive_t1);
-                test_map->emplace(tr_default, test_dataset);
-                test_map->emplace(tr_d1, test_derive_1);
+    public:
+
+        // --- --- --- MODEL
+
+        /// Write the trained forest, with the train exemplars it requires, in the binary model format.
+        /// With 'quantize', the exemplars are stored as 16 bits codes (see TSChief::Forest::save).
+        void save_model(std::ostream &out, std::optional<distance::quantized::QFormat> quantize = {}) const {
+            if (!forest) { throw std::logic_error("No trained forest to save"); }
+            forest->save(out, tdata, quantize);
+        }
+
+        /// Write the trained forest in the binary model format, referencing its train exemplars in 'store' instead of
+        /// storing them (see TSChief::Forest::save). Load it with the same store.
+        void save_model(std::ostream &out, tsc::ExemplarStore const &store) const {
+            if (!forest) { throw std::logic_error("No trained forest to save"); }
+            forest->save(out, tdata, store);
+        }
+
+        /// Write the train data with all its transforms, computing the lazy ones, as an exemplar store shared by the
+        /// models trained on it or on subsets of it (see TSChief::ExemplarStore)
+        void save_store(std::ostream &out) const {
+            MDTS train = tsc::at_train(tdata);
+            for (const auto &[tn, id]: tdata.transform_ids) {
+                if (auto const &lazy = tdata.lazy_train_by_id[id]) { train.emplace(tn, lazy->get()); }
             }
-            prepare_test_data_time = utils::now() - prepare_data_start_time;
+            tsc::ExemplarStore::save(out, train);
+        }
+
+        /// Keep only the train exemplars referenced by the trained forest in a compact table, each one once or each
+        /// node its own block (see TSChief::Forest::compact): the full train transforms are released.
+        /// Return the number of exemplars kept. A loaded model is already compact.
+        size_t compact_model(tsc::Forest::ExemplarLayout layout = tsc::Forest::ExemplarLayout::shared) {
+            if (!forest) { throw std::logic_error("No trained forest to compact"); }
+            train_map = forest->compact(tdata, layout);
+            tsc::register_train(tdata, train_map);
+            train_transforms.clear();
+            size_t nb_exemplars = 0;
+            for (const auto &[tn, dts]: *train_map) { nb_exemplars += dts.size(); }
+            return nb_exemplars;
+        }
+
+        /// Load a forest written by save_model instead of training one.
+        /// The model must have been trained with the same label encoding as 'train_header'.
+        void load_model(std::istream &in) { set_model(tsc::Forest::load(in)); }
+
+        /// Load a forest written by save_model in a file, memory mapping it (train exemplars are not copied).
+        /// The model must have been trained with the same label encoding as 'train_header'.
+        /// A model referencing an exemplar store requires 'store' (see save_model).
+        void load_model(std::filesystem::path const &path, tsc::ExemplarStore const *store = nullptr) {
+            set_model(tsc::Forest::load_mapped(path, store));
+        }
+
+        /// Scorer classifying a sliding window of 'window_length' values over a stream with the trained (or loaded)
+        /// forest, without building a test DTS (see TSChief::StreamScorer)
+        tsc::StreamScorer make_stream_scorer(size_t window_length) const {
+            if (!forest) { throw std::logic_error("No trained forest to score with"); }
+            return tsc::StreamScorer(forest, tdata, window_length, tstate);
+        }
+
+        // --- --- --- CLASSIFIER INTERFACE
+
+        classifier::ResultN predict_batch(DTS const &test_dataset, int nb_threads) override {
+            return predict(test_dataset, nb_threads);
+        }
+
+        void save(std::ostream &out) const override { save_model(out); }
+
+        void load(std::istream &in) override { load_model(in); }
+
+        size_t memory_footprint() const override { return forest_memory().total(); }
+
+        std::map<std::string, double> stats() const override {
+            std::map<std::string, double> s{
+                    {"train_time_ns",            (double) train_time.count()},
+                    {"test_time_ns",             (double) test_time.count()},
+                    {"train_nb_distances",       (double) train_nb_distances},
+                    {"anytime_average_nb_trees", anytime_average_nb_trees},
+                    {"memo_hit_rate",            memo_hit_rate()},
+                    {"train_memo_hit_rate",      train_memo_hit_rate()}
+            };
+            if (forest) {
+                const tsc::TreeStats ts = forest->stats();
+                s["nb_trees"] = (double) forest->forest.size();
+                s["nb_leaves"] = (double) ts.nb_leaves;
+                s["nb_nodes"] = (double) ts.nb_nodes;
+                s["max_depth"] = (double) ts.depth;
+            }
+            if (adaptive_sampler) { s["adaptive_expected_cost_ratio"] = adaptive_sampler->expected_cost_ratio(); }
+            if (oob_nb_exemplars > 0) { s["oob_accuracy"] = (double) oob_nb_correct / (double) oob_nb_exemplars; }
+            return s;
+        }
+
+    private:
+
+        /// Distances and options of the configuration: the tokens of 'str' and the options other than the PAA
+        /// transforms. Throws std::invalid_argument on unknown options.
+        std::set<std::string> configuration() const {
+            regex r(":");
+            std::set<std::string> distances(
+                    sregex_token_iterator(str.begin(), str.end(), r, -1),
+                    sregex_token_iterator()
+            );
+            if (distances.empty()) { throw std::invalid_argument("No distances registered (" + str + ")"); }
+            if (distances.contains("pf2018") && !config_options.empty()) {
+                throw std::invalid_argument("The pf2018 configuration takes no option");
+            }
+            for (std::string const &opt: config_options) {
+                if (tempo::transform::paa_factor(opt)) { continue; }
+                if (opt != "dtwproba" && !opt.starts_with("dtwpaa")) {
+                    throw std::invalid_argument("Unknown option " + opt + " (" + str + ")");
+                }
+                distances.insert(opt);
+            }
+            pf::splitters::coarse_dtw_option(distances);
+            return distances;
+        }
+
+        /// Transforms other than the default one: the first derivative, then the PAA transforms of config_options
+        std::vector<std::string> derived_transforms() const {
+            std::vector<std::string> names{tr_d1};
+            for (std::string const &opt: config_options) {
+                if (tempo::transform::paa_factor(opt) && std::find(names.begin(), names.end(), opt) == names.end()) {
+                    names.push_back(opt);
+                }
+            }
+            return names;
+        }
+
+        /// Derived transforms computed for the test data, with the PAA transforms of a loaded forest: without the first
+        /// derivative if virtual_test_derivative
+        std::vector<std::string> test_derived_transforms() const {
+            std::vector<std::string> names = derived_transforms();
+            for (std::string const &tname: model_paa_transforms) {
+                if (std::find(names.begin(), names.end(), tname) == names.end()) { names.push_back(tname); }
+            }
+            if (virtual_test_derivative) { std::erase(names, tr_d1); }
+            return names;
+        }
+
+        /// Transforms drawn by the distances
+        std::vector<std::string> transforms() const {
+            std::vector<std::string> names{tr_default};
+            for (std::string &tname: derived_transforms()) { names.push_back(std::move(tname)); }
+            return names;
+        }
+
+        /// Compute the transforms 'names' (other than the default one) of a dataset, in one pass into one buffer per
+        /// transform: the derivatives with one fused kernel (see transform::transform_fused), the PAA transforms
+        /// together (see transform::transform_paa)
+        MDTS make_transforms(DTS const &dataset, int nb_threads, std::vector<std::string> const &names) const {
+            const auto nbt = (size_t) std::max(nb_threads, 1);
+            std::vector<std::string> derived;
+            std::vector<size_t> factors;
+            for (std::string const &tname: names) {
+                if (auto f = tempo::transform::paa_factor(tname)) { factors.push_back(*f); }
+                else { derived.push_back(tname); }
+            }
+            MDTS result;
+            if (!derived.empty()) {
+                result = tempo::transform::transform_fused(dataset, derived, tempo::transform::derived_kernel(derived),
+                                                           nbt);
+            }
+            if (!factors.empty()) { result.merge(tempo::transform::transform_paa(dataset, factors, nbt)); }
+            return result;
+        }
 
-            tsc::register_test(tdata, test_map);
+        /// Factory of the transform 'tname' of a dataset, computed on one thread (see lazy_transforms)
+        std::function<DTS()> lazy_transform(DTS const &dataset, std::string const &tname) const {
+            return [this, dataset, tname]() { return make_transforms(dataset, 1, {tname}).at(tname); };
+        }
 
+        /// Add the default and derived transforms of 'dataset' to 'map': precomputed if in 'precomputed', else
+        /// registered in 'lazy' as factories if lazy_transforms is set, else computed together.
+        /// Only the derived transforms in 'names' are added.
+        void fill_map(DTS const &dataset, MDTS const &precomputed, MDTS &map, tsc::LazyMDTS &lazy, int nb_threads,
+                      std::vector<std::string> const &names) {
+            map.emplace(tr_default, dataset);
+            std::vector<std::string> to_compute;
+            for (std::string const &tname: names) {
+                if (precomputed.contains(tname)) { map.emplace(tname, precomputed.at(tname)); }
+                else if (lazy_transforms) { lazy.emplace(tname, lazy_transform(dataset, tname)); }
+                else { to_compute.push_back(tname); }
+            }
+            if (!to_compute.empty()) { map.merge(make_transforms(dataset, nb_threads, to_compute)); }
+        }
+
+        /// Predict the 'n' registered test exemplars, anytime if set, adding the number of trees evaluated per
+        /// exemplar to 'nb_tree_evaluations'. With a memo (see memo_max_entries), one per call: the test exemplars are
+        /// identified by their index in the registered data.
+        classifier::ResultN predict_registered(size_t n, int nb_threads, std::ostream *out,
+                                               size_t &nb_tree_evaluations) {
+            forest->combiner = combiner;
+            forest->tree_major = tree_major;
+            if (memo_max_entries) { tstate.memo = std::make_shared<tsc::DistanceMemo>(memo_max_entries.value()); }
             classifier::ResultN result;
+            if (!anytime && !prefix_sizes.empty()) {
+                // One pass for the prefixes and the whole forest, the last prefix
+                const size_t nb_forest = forest->forest.size();
+                std::vector<size_t> sizes;
+                for (size_t s: prefix_sizes) { sizes.push_back(std::min(s, nb_forest)); }
+                sizes.push_back(nb_forest);
+                nb_tree_evaluations += n * nb_forest;
+                std::vector<classifier::ResultN> results = forest->predict_prefixes(tstate, tdata, IndexSet(n),
+                                                                                    nb_threads, sizes, 256, out);
+                result = std::move(results.back());
+                prefix_results.clear();
+                for (size_t k = 0; k + 1 < sizes.size(); ++k) {
+                    prefix_results.emplace_back(sizes[k], std::move(results[k]));
+                }
+            } else if (!anytime) {
+                nb_tree_evaluations += n * forest->forest.size();
+                result = forest->predict_batch(tstate, tdata, IndexSet(n), nb_threads, 256, out);
+            } else {
+                tsc::Forest::AnytimeResult ar = forest->predict_anytime(tstate, tdata, IndexSet(n), nb_threads,
+                                                                        anytime.value(), 256, out);
+                for (size_t t: ar.nb_trees) { nb_tree_evaluations += t; }
+                result = std::move(ar.result);
+            }
+            if (tstate.memo) {
+                memo_lookups += tstate.memo->nb_lookups();
+                memo_hits += tstate.memo->nb_hits();
+                tstate.memo.reset();
+            }
+            return result;
+        }
 
-            auto test_start_time = utils::now();
-            const size_t test_size = test_dataset.size();
-            tempo::utils::ProgressMonitor pm(test_size);
+        void set_model(tsc::Forest::Loaded loaded) {
+            if (loaded.forest->trainclass_cardinality != train_header.nb_classes()) {
+                throw std::runtime_error("Model trained with a different number of classes");
+            }
+            for (const auto &[tn, dts]: *loaded.train_exemplars) {
+                if (dts.header().label_encoder().index_to_label() != train_header.label_encoder().index_to_label()) {
+                    throw std::runtime_error("Model trained with a different label encoding");
+                }
+            }
+            forest = std::move(loaded.forest);
+            train_map = std::move(loaded.train_exemplars);
+            // The PAA transforms of the trees, rebuilt from their names for the test data
+            model_paa_transforms.clear();
+            const auto add_paa = [&](std::string const &tname) {
+                if (tempo::transform::paa_factor(tname) &&
+                    std::find(model_paa_transforms.begin(), model_paa_transforms.end(), tname) ==
+                    model_paa_transforms.end()) { model_paa_transforms.push_back(tname); }
+            };
+            for (const auto &ct: forest->compiled) {
+                for (std::string const &tname: ct->transforms) { add_paa(tname); }
+            }
+            // Uncompiled: the transforms of the exemplars referenced by the trees
+            if (forest->compiled.empty()) {
+                for (const auto &[tname, dts]: *train_map) { add_paa(tname); }
+            }
+            tsc::register_train(tdata, train_map);
+        }
 
-            for (size_t test_idx = 0; test_idx < test_size; ++test_idx) {
-                // Get the prediction per tree
-                std::vector<classifier::Result1> vecr = forest->predict(
-                        tstate, tdata, test_idx, nb_threads
-                );
-                // Merge prediction as we want. Here, arithmetic average weighted by number of leafs
-                // Result1 must be initialised with the number of classes!
-                classifier::Result1 r1(train_header.nb_classes());
-                for (const auto &r: vecr) {
-                    r1.probabilities += r.probabilities * r.weight;
-                    r1.weight += r.weight;
+        /// Out-of-bag accuracy over the labelled train exemplars, predicting the train data as test data
+        void compute_oob(ByClassMap const &train_bcm, int nb_threads) {
+            auto oob_start_time = utils::now();
+            // The lazy train transforms used by the trees are computed by now
+            tsc::register_test(tdata, std::make_shared<MDTS>(tsc::materialized_train(tdata)));
+            const IndexSet train_is = train_bcm.to_IndexSet();
+            forest->combiner = combiner;
+            forest->tree_major = tree_major;
+            classifier::ResultN oob = forest->predict_oob(tstate, tdata, train_is, (size_t) std::max(nb_threads, 1));
+            // Only the exemplars left out by at least one tree
+            std::vector<size_t> covered_rows;
+            for (size_t r = 0; r < train_is.size(); ++r) { if (oob.weight[r] > 0) { covered_rows.push_back(r); } }
+            classifier::ResultN covered(covered_rows.size(), oob.probabilities.n_cols);
+            std::vector<size_t> covered_indexes;
+            for (size_t i = 0; i < covered_rows.size(); ++i) {
+                covered.probabilities.row(i) = oob.probabilities.row(covered_rows[i]);
+                covered.weight[i] = oob.weight[covered_rows[i]];
+                // Index of the exemplar in the train header (the train split may be a view over a larger dataset)
+                covered_indexes.push_back(train_dataset.index_set()[train_is[covered_rows[i]]]);
+            }
+            oob_nb_exemplars = covered_indexes.size();
+            oob_nb_correct = covered.nb_correct_01loss(train_header, IndexSet(std::move(covered_indexes)), tstate.prng);
+            oob_time = utils::now() - oob_start_time;
+            if (log != nullptr) {
+                *log << "Out-of-bag: " << oob_nb_correct << " / " << oob_nb_exemplars << " correct" << std::endl;
+            }
+        }
+
+    public:
+
+        /// Train each tree on a stratified sample of the train data, and compute the out-of-bag accuracy
+        void set_sampling(double ratio, std::optional<size_t> max_per_class = std::nullopt) {
+            if (!(ratio > 0)) { throw std::invalid_argument("Sampling ratio must be positive"); }
+            sampling_ratio = ratio;
+            sampling_max_per_class = max_per_class;
+        }
+
+        /// Report the progress of train as JSON lines on 'sink', every 'period'
+        void set_progress(std::ostream &sink, std::chrono::milliseconds period = std::chrono::seconds(1)) {
+            progress_sink = &sink;
+            progress_period = period;
+        }
+
+        /** Derived transforms of a test set computed by predict, but not in 'precomputed' nor lazy: to add to
+         *  test_transforms before predicting, e.g. computed on a thread of its own while training.
+         *  Only reads the configuration (config_options, lazy_transforms and virtual_test_derivative) and the PAA
+         *  transforms of a loaded forest.
+         */
+        MDTS make_test_transforms(DTS const &test_dataset, MDTS const &precomputed, int nb_threads) const {
+            if (lazy_transforms) { return {}; }
+            std::vector<std::string> names;
+            for (std::string const &tname: test_derived_transforms()) {
+                if (!precomputed.contains(tname)) { names.push_back(tname); }
+            }
+            return names.empty() ? MDTS{} : make_transforms(test_dataset, nb_threads, names);
+        }
+
+        classifier::ResultN predict(DTS const &test_dataset, int nb_threads) {
+            auto prepare_data_start_time = utils::now();
+            tsc::LazyMDTS test_lazy;
+            fill_map(test_dataset, test_transforms, *test_map, test_lazy, nb_threads, test_derived_transforms());
+            prepare_test_data_time = utils::now() - prepare_data_start_time;
+
+            tsc::set_virtual_test_derivative(tdata, virtual_test_derivative);
+            tsc::register_test(tdata, test_map, test_lazy);
+
+            tstate.timers = timers;
+            const utils::usage::Phase test_phase((size_t) nb_threads);
+            auto test_start_time = utils::now();
+            // Test-major batch prediction: merge prediction per tree with an arithmetic average weighted by the
+            // number of leafs
+            size_t nb_tree_evaluations = 0;
+            memo_lookups = 0;
+            memo_hits = 0;
+            classifier::ResultN result = predict_registered(test_dataset.size(), nb_threads, log,
+                                                            nb_tree_evaluations);
+            if (log != nullptr) {
+                *log << std::endl;
+                if (memo_max_entries) {
+                    *log << "Distance memo: " << memo_hits << " / " << memo_lookups << " hits (" << memo_hit_rate()
+                         << ")" << std::endl;
                 }
-                r1.probabilities /= r1.weight;
-                //
-                result.append(r1);
-                //
-                pm.print_progress(std::cout, test_idx);
             }
-            std::cout << std::endl;
+            anytime_average_nb_trees = test_dataset.size() == 0 ? 0.0
+                    : (double) nb_tree_evaluations / (double) test_dataset.size();
             test_time = utils::now() - test_start_time;
+            test_usage = test_phase.stop();
 
             return result;
         }
+
+        /// Leaf reached by each test exemplar of the last predict in each tree (see Forest::predict_leaf_ids),
+        /// e.g. to write them with the probabilities (see writer::arrow::PredictionWriter)
+        tsc::Forest::LeafIDs predict_leaf_ids(size_t nb_test, int nb_threads) {
+            if (!forest) { throw std::logic_error("No trained forest to predict with"); }
+            return forest->predict_leaf_ids(tstate, tdata, IndexSet(nb_test), (size_t) nb_threads);
+        }
+
+        // --- --- --- STREAMED TEST
+
+        /// Result of predict_stream
+        struct StreamResult {
+            size_t nb_blocks{0};
+            size_t nb_series{0};
+            /// Series in blocks without unlabelled series, and how many of them are correctly predicted
+            size_t nb_labelled{0};
+            size_t nb_correct{0};
+        };
+
+        /** Predict a TS test file too large to be loaded, with a pipeline of stages running concurrently:
+         *  a reader parsing blocks of 'block_size' series (see reader::TSBlockReader), a transform stage deriving them,
+         *  a scoring stage predicting them with 'nb_threads' threads (as predict), and a writer streaming the
+         *  probability rows as CSV on 'prob_out' (if not null), after a header line with the train class names,
+         *  and one record batch per block on 'arrow_out' (if not null; with the leaf IDs of the block if it takes
+         *  them).
+         *  The stages exchange blocks through queues of 'queue_capacity' blocks: the memory is bounded to a few blocks.
+         *  The test labels are encoded with the train label encoder; ties are broken with 'prng' (see ResultN).
+         *  Throws if a block cannot be read; the rows of the blocks before it have been written.
+         */
+        StreamResult predict_stream(reader::TSBlockReader &blocks, size_t block_size, int nb_threads, PRNG &prng,
+                                    std::ostream *prob_out = nullptr, size_t queue_capacity = 2,
+                                    writer::arrow::PredictionWriter *arrow_out = nullptr) {
+            if (!forest) { throw std::logic_error("No trained forest to predict with"); }
+            using Scored = std::tuple<std::shared_ptr<MDTS>, classifier::ResultN, tsc::Forest::LeafIDs>;
+            utils::BoundedQueue<DTS> read_queue(queue_capacity);
+            utils::BoundedQueue<std::shared_ptr<MDTS>> derived_queue(queue_capacity);
+            utils::BoundedQueue<Scored> scored_queue(queue_capacity);
+
+            // First error of a stage: stop all the stages
+            std::mutex error_mutex;
+            std::exception_ptr error;
+            auto fail = [&](std::exception_ptr e) {
+                {
+                    std::lock_guard lock(error_mutex);
+                    if (!error) { error = std::move(e); }
+                }
+                read_queue.close();
+                derived_queue.close();
+                scored_queue.close();
+            };
+
+            StreamResult sresult;
+            size_t nb_tree_evaluations = 0;
+            memo_lookups = 0;
+            memo_hits = 0;
+            utils::duration_t transform_time{};
+            const utils::usage::Phase test_phase((size_t) nb_threads);
+            auto test_start_time = utils::now();
+
+            // --- --- --- Reader stage, checking the test series as sanity_check does
+            std::thread reader_stage([&]() {
+                try {
+                    std::optional<size_t> length;
+                    while (true) {
+                        auto vblock = blocks.next(block_size);
+                        if (vblock.index() == 0) { throw std::runtime_error(std::get<0>(vblock)); }
+                        reader::TSData &block = std::get<1>(vblock);
+                        if (block.series.empty()) { break; }
+                        if (!block.series_with_missing_values.empty()) {
+                            throw std::runtime_error("Test set: missing data");
+                        }
+                        if (block.shortest_length != block.longest_length ||
+                            block.shortest_length != length.value_or(block.shortest_length)) {
+                            throw std::runtime_error("Test set: variable length");
+                        }
+                        length = block.shortest_length;
+                        DTS dts = reader::tsdata_to_dts(std::move(block), "test", train_header.label_encoder());
+                        if (!read_queue.push(std::move(dts))) { break; }
+                    }
+                } catch (...) { fail(std::current_exception()); }
+                read_queue.close();
+            });
+
+            // --- --- --- Transform stage
+            std::thread transform_stage([&]() {
+                try {
+                    while (std::optional<DTS> block = read_queue.pop()) {
+                        auto start = utils::now();
+                        auto map = std::make_shared<MDTS>();
+                        MDTS derived = make_transforms(block.value(), 1, test_derived_transforms());
+                        map->emplace(tr_default, block.value());
+                        for (auto &[tname, dts]: derived) { map->emplace(tname, std::move(dts)); }
+                        transform_time += utils::now() - start;
+                        if (!derived_queue.push(std::move(map))) { break; }
+                    }
+                } catch (...) { fail(std::current_exception()); }
+                derived_queue.close();
+            });
+
+            // --- --- --- Writer stage
+            std::thread writer_stage([&]() {
+                try {
+                    if (prob_out != nullptr) {
+                        for (size_t c = 0; c < train_header.nb_classes(); ++c) {
+                            *prob_out << (c == 0 ? "" : ",") << train_header.decode(c);
+                        }
+                        *prob_out << '\n' << std::scientific << std::setprecision(16);
+                    }
+                    while (std::optional<Scored> scored = scored_queue.pop()) {
+                        auto &[map, res, leaves] = scored.value();
+                        DatasetHeader const &block_header = map->at(tr_default).header();
+                        if (arrow_out != nullptr) {
+                            arrow_out->write(sresult.nb_series, res.probabilities.n_rows, res.probabilities.memptr(),
+                                             res.weight.memptr(), leaves.ids.data());
+                        }
+                        sresult.nb_blocks++;
+                        sresult.nb_series += block_header.size();
+                        if (block_header.nb_unlabelled() == 0) {
+                            sresult.nb_labelled += block_header.size();
+                            sresult.nb_correct += res.nb_correct_01loss(block_header, IndexSet(block_header.size()),
+                                                                        prng);
+                        }
+                        if (prob_out != nullptr) {
+                            for (size_t r = 0; r < res.probabilities.n_rows; ++r) {
+                                for (size_t c = 0; c < res.probabilities.n_cols; ++c) {
+                                    *prob_out << (c == 0 ? "" : ",") << res.probabilities(r, c);
+                                }
+                                *prob_out << '\n';
+                            }
+                            if (!*prob_out) { throw std::runtime_error("Error while writing the probabilities"); }
+                        }
+                    }
+                    if (prob_out != nullptr) { prob_out->flush(); }
+                } catch (...) { fail(std::current_exception()); }
+                scored_queue.close();
+            });
+
+            // --- --- --- Scoring stage, in this thread
+            tstate.timers = timers;
+            tsc::set_virtual_test_derivative(tdata, virtual_test_derivative);
+            try {
+                while (std::optional<std::shared_ptr<MDTS>> map = derived_queue.pop()) {
+                    tsc::register_test(tdata, map.value());
+                    const size_t n = map.value()->at(tr_default).size();
+                    classifier::ResultN res = predict_registered(n, nb_threads, nullptr, nb_tree_evaluations);
+                    tsc::Forest::LeafIDs leaves;
+                    if (arrow_out != nullptr && arrow_out->with_leaf_ids()) {
+                        leaves = forest->predict_leaf_ids(tstate, tdata, IndexSet(n), (size_t) nb_threads);
+                    }
+                    if (!scored_queue.push({std::move(map.value()), std::move(res), std::move(leaves)})) { break; }
+                }
+            } catch (...) { fail(std::current_exception()); }
+            scored_queue.close();
+
+            reader_stage.join();
+            transform_stage.join();
+            writer_stage.join();
+            prepare_test_data_time = transform_time;
+            test_time = utils::now() - test_start_time;
+            test_usage = test_phase.stop();
+            anytime_average_nb_trees = sresult.nb_series == 0 ? 0.0
+                    : (double) nb_tree_evaluations / (double) sresult.nb_series;
+            if (error) { std::rethrow_exception(error); }
+            return sresult;
+        }
     }; // End of struct PF2
 
 
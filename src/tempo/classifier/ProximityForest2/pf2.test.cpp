@@ -0,0 +1,186 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pf2.hpp"
+
+#include <mock/mockseries.hpp>
+#include <nlohmann/json.hpp>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace tempo;
+using namespace tempo::classifier;
+
+namespace {
+
+  constexpr size_t length = 16;
+  constexpr size_t seed = 42;
+
+  /// Dataset of 'nbtrain' random univariate series of 3 classes, shifted by class. The values are rounded so that
+  /// the nodes have ties to break.
+  DTS mk_dts(size_t nbtrain) {
+    mock::Mocker<F> mocker(0);
+    mocker._fixl = length;
+    std::vector<TSeries> series;
+    std::vector<std::optional<std::string>> labels;
+    for (size_t i = 0; i<nbtrain; ++i) {
+      std::vector<F> v = mocker.randvec();
+      for (F& x : v) { x = std::round(x + (F)(i%3)); }
+      labels.emplace_back(std::to_string(i%3));
+      series.push_back(TSeries::mk_from_rowmajor(std::move(v), 1, labels.back(), false));
+    }
+    auto header = std::make_shared<DatasetHeader>("mock", length, length, 1, std::move(labels), std::vector<size_t>{});
+    auto transform = std::make_shared<DatasetTransform<TSeries>>(header, "default", std::move(series));
+    return DTS("mock", transform);
+  }
+
+  /// Model of a forest trained on 'nb_threads' threads, as saved
+  template<typename Setup>
+  std::string train_model(DTS const& train, size_t nbtrees, int nb_threads, Setup const& setup) {
+    TSChief::TreeState tstate(seed, 0);
+    ProximityForest2 pf(train, train.header(), 4, nbtrees, tstate);
+    pf.log = nullptr;
+    setup(pf);
+    pf.train(nb_threads);
+    std::ostringstream out;
+    pf.save_model(out);
+    return out.str();
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// The trees only depend on the seed and on their index: the same forest is trained whatever the number of threads.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("PF2 chunked routing, 1 and N threads", "[pf2][chunk]") {
+  // More queries than a chunk at the root
+  const DTS train = mk_dts(TSChief::snode::nn1splitter::GenSplitterNN1::chunk_queries + 300);
+  // One large tree: its candidates and chunks use the threads
+  const auto chunked = [](ProximityForest2& pf) { pf.chunk_min_size = 256; };
+  const std::string sequential = train_model(train, 1, 1, chunked);
+  for (const int nbt : {2, 8}) { REQUIRE(train_model(train, 1, nbt, chunked)==sequential); }
+  // Chunked with a single thread, not the unchunked routing
+  REQUIRE(train_model(train, 1, 1, [](ProximityForest2&) {})!=sequential);
+}
+
+TEST_CASE("PF2 forked candidates, 1 and N threads", "[pf2][chooser]") {
+  const DTS train = mk_dts(600);
+  // The nodes draw their sample before choosing, with candidates forked at the root (see ProximityForest2)
+  const auto sampled = [](ProximityForest2& pf) {
+    pf.node_sample_min_size = 64;
+    pf.node_sample_ratio = 0.5;
+  };
+  const std::string sequential = train_model(train, 3, 1, sampled);
+  for (const int nbt : {2, 3, 8}) { REQUIRE(train_model(train, 3, nbt, sampled)==sequential); }
+}
+
+TEST_CASE("PF2 grow, next tree index", "[pf2][grow]") {
+  const DTS train = mk_dts(90);
+  TSChief::TreeState tstate(seed, 0);
+  ProximityForest2 pf(train, train.header(), 2, 3, tstate);
+  pf.log = nullptr;
+  const auto next_tree_index = [&]() {
+    std::stringstream model;
+    pf.save_model(model);
+    const TSChief::Forest::Loaded loaded = TSChief::Forest::load(model);
+    REQUIRE(loaded.forest->forest.size()==3);
+    return loaded.forest->next_tree_index;
+  };
+  pf.train(1);
+  REQUIRE(next_tree_index()==3);
+  // The trees dropped by a grow keep their indexes: growing again trains new trees
+  pf.grow(1, 2);
+  REQUIRE(pf.grow_nb_dropped==2);
+  REQUIRE(next_tree_index()==5);
+  pf.grow(1, 2);
+  REQUIRE(next_tree_index()==7);
+}
+
+TEST_CASE("PF2 model round trip", "[pf2][model]") {
+  const DTS train = mk_dts(90);
+  TSChief::TreeState tstate(seed, 0);
+  ProximityForest2 pf(train, train.header(), 4, 4, tstate);
+  pf.log = nullptr;
+  pf.train(1);
+  std::stringstream model;
+  pf.save_model(model);
+  // The exemplars of a model are numbered per transform: the loaded splitters find their labels in their transform
+  TSChief::TreeState loaded_state(seed, 0);
+  ProximityForest2 loaded(train, train.header(), 4, 4, loaded_state);
+  loaded.log = nullptr;
+  loaded.load_model(model);
+  const ResultN expected = pf.predict_batch(train, 1);
+  const ResultN result = loaded.predict_batch(train, 1);
+  const std::vector<double> pexpected(expected.probabilities.begin(), expected.probabilities.end());
+  REQUIRE(std::vector<double>(result.probabilities.begin(), result.probabilities.end())==pexpected);
+}
+
+TEST_CASE("PF2 ADTW penalties file", "[pf2][adtw]") {
+  const DTS train = mk_dts(90);
+  const std::filesystem::path path = std::filesystem::temp_directory_path()/"pf2_test_adtw_penalties.json";
+  std::filesystem::remove(path);
+  const auto with_file = [&](ProximityForest2& pf) { pf.adtw_penalties_path = path; };
+  const std::string sampled = train_model(train, 3, 1, [](ProximityForest2&) {});
+  // Sampled and saved, then loaded: the trees draw the same values as without a file
+  REQUIRE(train_model(train, 3, 1, with_file)==sampled);
+  REQUIRE(std::filesystem::exists(path));
+  REQUIRE(train_model(train, 3, 1, with_file)==sampled);
+  // Another seed does not load the penalties of the file
+  std::ifstream in(path);
+  const nlohmann::json saved = nlohmann::json::parse(in);
+  in.close();
+  TSChief::TreeState tstate(seed + 1, 0);
+  ProximityForest2 pf(train, train.header(), 4, 3, tstate);
+  pf.log = nullptr;
+  with_file(pf);
+  pf.train(1);
+  std::ifstream resampled(path);
+  REQUIRE(nlohmann::json::parse(resampled).at("key").at("seed")!=saved.at("key").at("seed"));
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("PF2 model round trip, PAA transforms", "[pf2][model][paa]") {
+  const DTS train = mk_dts(90);
+  TSChief::TreeState tstate(seed, 0);
+  ProximityForest2 pf(train, train.header(), 4, 4, tstate);
+  pf.log = nullptr;
+  pf.config_options = {"paa4", "dtwpaa2"};
+  pf.train(1);
+  std::stringstream model;
+  pf.save_model(model);
+  // Loaded without the options: the PAA transforms of the test data are the ones of the trees
+  TSChief::TreeState loaded_state(seed, 0);
+  ProximityForest2 loaded(train, train.header(), 4, 4, loaded_state);
+  loaded.log = nullptr;
+  loaded.load_model(model);
+  const ResultN expected = pf.predict_batch(train, 1);
+  const ResultN result = loaded.predict_batch(train, 1);
+  const std::vector<double> pexpected(expected.probabilities.begin(), expected.probabilities.end());
+  REQUIRE(std::vector<double>(result.probabilities.begin(), result.probabilities.end())==pexpected);
+}
+
+TEST_CASE("PF2 checkpoint, resumed training", "[pf2][checkpoint]") {
+  const DTS train = mk_dts(90);
+  const std::filesystem::path path = std::filesystem::temp_directory_path()/"pf2_test_checkpoint.bin";
+  std::filesystem::remove(path);
+  const TSChief::Checkpoint checkpoint{path, "pf2 test " + std::to_string(seed)};
+  const auto with_checkpoint = [&](ProximityForest2& pf) { pf.checkpoint = checkpoint; };
+  const std::string uninterrupted = train_model(train, 5, 1, [](ProximityForest2&) {});
+  // Interrupted after 3 trees, in the middle of the record of the third one
+  train_model(train, 3, 1, with_checkpoint);
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 16);
+  // The first 2 trees are loaded, the others trained with the streams of their index
+  REQUIRE(train_model(train, 5, 2, with_checkpoint)==uninterrupted);
+  // All the trees are in the checkpoint now
+  REQUIRE(train_model(train, 5, 1, with_checkpoint)==uninterrupted);
+  // Another training does not resume from the checkpoint
+  const auto other = [&](ProximityForest2& pf) { pf.checkpoint = TSChief::Checkpoint{path, "another training"}; };
+  REQUIRE_THROWS_AS(train_model(train, 5, 1, other), std::runtime_error);
+  std::filesystem::remove(path);
+}
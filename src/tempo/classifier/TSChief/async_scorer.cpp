@@ -0,0 +1,122 @@
+#include "async_scorer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <tempo/reader/reader.hpp>
+#include <tempo/transform/pipeline.hpp>
+
+namespace tempo::classifier::TSChief {
+
+  AsyncScorer::AsyncScorer(std::shared_ptr<const Forest> forest, TreeData const& data, TreeState const& state,
+                           size_t nb_threads, size_t max_batch, std::chrono::microseconds batch_wait,
+                           size_t queue_capacity) :
+    forest(std::move(forest)),
+    data(data),
+    state(std::move(state.forest_fork_vec(1).front())),
+    nb_threads(std::max<size_t>(nb_threads, 1)),
+    max_batch(std::max<size_t>(max_batch, 1)),
+    batch_wait(batch_wait),
+    requests(queue_capacity) {
+    if (!this->forest) { throw std::invalid_argument("AsyncScorer: no forest"); }
+    MDTS const& train = at_train(this->data);
+    if (!train.contains("default")) { throw std::invalid_argument("AsyncScorer: no train data"); }
+    train_header = &train.at("default").header();
+    for (const auto& [tname, dts] : train) {
+      if (tname=="default") { continue; }
+      if (auto f = tempo::transform::paa_factor(tname)) { paa_factors.push_back(*f); }
+      else { derived.push_back(tname); }
+    }
+    // Check the names now rather than on the first batch
+    if (!derived.empty()) { tempo::transform::derived_kernel(derived); }
+    dispatcher = std::thread([this]() { dispatch(); });
+  }
+
+  AsyncScorer::~AsyncScorer() {
+    requests.close();
+    if (dispatcher.joinable()) { dispatcher.join(); }
+  }
+
+  void AsyncScorer::check(TSeries const& series) const {
+    if (series.nb_dimensions()!=train_header->nb_dimensions()) {
+      throw std::invalid_argument("AsyncScorer: expects series of " + std::to_string(train_header->nb_dimensions())
+                                  + " dimension(s)");
+    }
+    if (series.length()<train_header->length_min()||series.length()>train_header->length_max()) {
+      throw std::invalid_argument("AsyncScorer: expects series of length " + std::to_string(train_header->length_min())
+                                  + ".." + std::to_string(train_header->length_max()));
+    }
+    F const *values = series.data();
+    const size_t n = series.length()*series.nb_dimensions();
+    if (series.missing()||std::any_of(values, values + n, [](F v) { return std::isnan(v); })) {
+      throw std::invalid_argument("AsyncScorer: missing values");
+    }
+  }
+
+  std::future<classifier::Result1> AsyncScorer::predict_async(TSeries series) {
+    auto promise = std::make_shared<std::promise<classifier::Result1>>();
+    std::future<classifier::Result1> future = promise->get_future();
+    predict_async(std::move(series), [promise](classifier::Result1&& result, std::exception_ptr error) {
+      if (error) { promise->set_exception(error); } else { promise->set_value(std::move(result)); }
+    });
+    return future;
+  }
+
+  void AsyncScorer::predict_async(TSeries series, Callback callback) {
+    check(series);
+    if (!requests.push(Request{std::move(series), std::move(callback)})) {
+      throw std::logic_error("AsyncScorer: stopped");
+    }
+  }
+
+  void AsyncScorer::dispatch() {
+    while (std::optional<Request> first = requests.pop()) {
+      std::vector<Request> batch;
+      batch.push_back(std::move(first.value()));
+      const auto deadline = utils::now() + batch_wait;
+      while (batch.size()<max_batch) {
+        std::optional<Request> r = requests.pop_until(deadline);
+        if (!r) { break; }
+        batch.push_back(std::move(r.value()));
+      }
+      serve(batch);
+    }
+  }
+
+  void AsyncScorer::serve(std::vector<Request>& batch) {
+    const size_t n = batch.size();
+    classifier::ResultN result;
+    std::exception_ptr error;
+    try {
+      reader::TSData tsdata;
+      tsdata.nb_dimensions = train_header->nb_dimensions();
+      for (Request& r : batch) {
+        tsdata.shortest_length = std::min(tsdata.shortest_length, r.series.length());
+        tsdata.longest_length = std::max(tsdata.longest_length, r.series.length());
+        tsdata.series.push_back(std::move(r.series));
+      }
+      DTS dts = reader::tsdata_to_dts(std::move(tsdata), "async", train_header->label_encoder());
+      auto map = std::make_shared<MDTS>();
+      if (!derived.empty()) {
+        map->merge(tempo::transform::transform_fused(dts, derived, tempo::transform::derived_kernel(derived),
+                                                     nb_threads));
+      }
+      if (!paa_factors.empty()) { map->merge(tempo::transform::transform_paa(dts, paa_factors, nb_threads)); }
+      map->emplace("default", std::move(dts));
+      register_test(data, map);
+      result = forest->predict_batch(*state, data, IndexSet(n), nb_threads);
+      batches.fetch_add(1, std::memory_order_relaxed);
+      predicted.fetch_add(n, std::memory_order_relaxed);
+    } catch (...) { error = std::current_exception(); }
+    // Complete in order
+    for (size_t i = 0; i<n; ++i) {
+      if (error) { batch[i].callback({}, error); }
+      else {
+        arma::rowvec p = result.probabilities.row(i);
+        batch[i].callback(classifier::Result1(std::move(p), result.weight[i]), nullptr);
+      }
+    }
+  }
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tempo/utils/utils/bounded_queue.hpp>
+
+#include "tempo/classifier/utils.hpp"
+#include "treedata.hpp"
+#include "treestate.hpp"
+#include "forest.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Asynchronous scoring
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Asynchronous prediction of single series with a trained (or loaded) forest, for an embedding service: the
+   *  callers do not block, and the concurrent requests are predicted together (see Forest::predict_batch).
+   *  One dispatcher thread gathers the requests: after the first one of a batch, it waits at most 'batch_wait' for
+   *  more, up to 'max_batch'. It then computes the transforms of the batch, predicts it with 'nb_threads' threads
+   *  of the shared pool, and completes the requests in order. Thousands of requests can be in flight without a
+   *  thread each: up to 'queue_capacity' wait in the queue (predict_async blocks beyond), the others being batched.
+   *  The transforms of the requests are the train transforms of the forest other than "default", computed as the
+   *  derived transforms of PF2 (see transform::derived_kernel and transform::transform_paa).
+   *  The batches share one state, forked from the state given at construction: the predictions are the ones of
+   *  predict_batch on the same series, up to the draws breaking the ties.
+   */
+  class AsyncScorer {
+  public:
+
+    /// Called by the dispatcher thread with the result of a request, or with the exception of its batch
+    using Callback = std::function<void(classifier::Result1&& result, std::exception_ptr error)>;
+
+    // --- --- --- Constructors/Destructors
+
+    /** Start the dispatcher thread.
+     *  Throws std::invalid_argument if the train data is not registered in 'data'.
+     * @param forest          Trained (or loaded) forest
+     * @param data            Data the forest was trained on (or loaded with): only the train data is used
+     * @param state           Testing state, forked for the batches
+     * @param nb_threads      Threads predicting a batch
+     * @param max_batch       Maximum number of requests predicted together (at least 1)
+     * @param batch_wait      Time waited for more requests after the first one of a batch
+     * @param queue_capacity  Maximum number of requests waiting for a batch
+     */
+    AsyncScorer(std::shared_ptr<const Forest> forest, TreeData const& data, TreeState const& state,
+                size_t nb_threads = 1, size_t max_batch = 64,
+                std::chrono::microseconds batch_wait = std::chrono::microseconds(1000),
+                size_t queue_capacity = 4096);
+
+    AsyncScorer(AsyncScorer const&) = delete;
+    AsyncScorer& operator=(AsyncScorer const&) = delete;
+
+    /// Complete the requests already submitted, then stop the dispatcher thread
+    ~AsyncScorer();
+
+    // --- --- --- Methods
+
+    /** Submit a series, completed through a future. Throws std::invalid_argument, without submitting it, if the
+     *  series does not have the dimensions and a length within the lengths of the train data, or has missing values.
+     *  The future holds the exception of the batch if its prediction failed.
+     */
+    std::future<classifier::Result1> predict_async(TSeries series);
+
+    /// Submit a series, completed by calling 'callback' from the dispatcher thread (see predict_async).
+    /// The callback must not block: it delays the next batches.
+    void predict_async(TSeries series, Callback callback);
+
+    /// Number of batches predicted, and of series predicted in them
+    size_t nb_batches() const { return batches.load(std::memory_order_relaxed); }
+
+    size_t nb_predicted() const { return predicted.load(std::memory_order_relaxed); }
+
+  private:
+
+    struct Request {
+      TSeries series;
+      Callback callback;
+    };
+
+    // --- --- --- Fields
+
+    std::shared_ptr<const Forest> forest;
+
+    /// Copy of the data given at construction, where the batches register their test data
+    TreeData data;
+
+    std::unique_ptr<TreeState> state;
+
+    size_t nb_threads;
+
+    size_t max_batch;
+
+    std::chrono::microseconds batch_wait;
+
+    /// Derived train transforms, computed on the batches
+    std::vector<std::string> derived;
+    std::vector<size_t> paa_factors;
+
+    DatasetHeader const *train_header;
+
+    utils::BoundedQueue<Request> requests;
+
+    std::atomic<size_t> batches{0};
+    std::atomic<size_t> predicted{0};
+
+    std::thread dispatcher;
+
+    /// Check a series against the train data (see predict_async)
+    void check(TSeries const& series) const;
+
+    /// Gather and predict the batches until the queue is closed
+    void dispatch();
+
+    /// Predict a batch, and complete its requests
+    void serve(std::vector<Request>& batch);
+  };
+
+} // End of tempo::classifier::TSChief
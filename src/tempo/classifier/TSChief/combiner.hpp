@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <string>
+
+#include "tempo/classifier/utils.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Combining the results of the trees
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** How the per tree results of an exemplar are combined into its prediction (see Forest::combiner).
+   *  The results are accumulated in place, in tree order, into the row of the exemplar (see combine_add), and the
+   *  row is turned into probabilities once all the trees are added (see combine_finish): no per tree result is kept.
+   */
+  enum class Combiner {
+    /// Average of the probabilities weighted by the leaves' weight. The weight of the row is the sum of the weights.
+    WEIGHTED_AVERAGE,
+    /// One vote per tree for its most probable class (the first one on ties); the probabilities are the shares of
+    /// the votes. The weight of the row is the number of votes.
+    MAJORITY_VOTE,
+    /// Sum of the log probabilities (floored at log_prob_floor), normalised (softmax). The weight of the row is the
+    /// sum of the leaves' weight.
+    LOG_PROB_SUM,
+  };
+
+  /// Probabilities below this value count as this value for Combiner::LOG_PROB_SUM, avoiding log(0)
+  inline constexpr double log_prob_floor = 1e-6;
+
+  /// Name of a combiner, as parsed by combiner_from_string: "average", "vote" or "logprob"
+  inline std::string to_string(Combiner c) {
+    switch (c) {
+      case Combiner::WEIGHTED_AVERAGE: return "average";
+      case Combiner::MAJORITY_VOTE: return "vote";
+      case Combiner::LOG_PROB_SUM: return "logprob";
+    }
+    return "";
+  }
+
+  /// Combiner named by 'name' (see to_string), nothing if unknown
+  inline std::optional<Combiner> combiner_from_string(std::string const& name) {
+    if (name=="average") { return Combiner::WEIGHTED_AVERAGE; }
+    if (name=="vote") { return Combiner::MAJORITY_VOTE; }
+    if (name=="logprob") { return Combiner::LOG_PROB_SUM; }
+    return {};
+  }
+
+  /// Maximal increase of the lead of a class over another one that a tree of maximal leaf weight 'max_weight' can
+  /// bring to an accumulated row (see Forest::predict_anytime). Infinite if not bounded.
+  inline double combine_bound(Combiner c, double max_weight) {
+    switch (c) {
+      case Combiner::WEIGHTED_AVERAGE: return max_weight;
+      case Combiner::MAJORITY_VOTE: return 1;
+      case Combiner::LOG_PROB_SUM: return std::numeric_limits<double>::infinity();
+    }
+    return std::numeric_limits<double>::infinity();
+  }
+
+  /// Add the result of a tree ('proba' with weight 'w') into the accumulated row 'acc' of weight 'acc_w'.
+  /// 'Acc' and 'Proba' are Armadillo row vectors or row views.
+  template<typename Acc, typename Proba>
+  inline void combine_add(Combiner c, Acc&& acc, double& acc_w, Proba const& proba, double w) {
+    switch (c) {
+      case Combiner::WEIGHTED_AVERAGE: {
+        acc += proba*w;
+        acc_w += w;
+        break;
+      }
+      case Combiner::MAJORITY_VOTE: {
+        size_t top = 0;
+        for (size_t k = 1; k<proba.n_elem; ++k) { if (proba[k]>proba[top]) { top = k; }}
+        acc[top] += 1;
+        acc_w += 1;
+        break;
+      }
+      case Combiner::LOG_PROB_SUM: {
+        for (size_t k = 0; k<proba.n_elem; ++k) { acc[k] += std::log(std::max<double>(proba[k], log_prob_floor)); }
+        acc_w += w;
+        break;
+      }
+    }
+  }
+
+  /// Turn an accumulated row of weight 'acc_w' into probabilities. Rows of weight 0 (no tree) are left as is.
+  template<typename Acc>
+  inline void combine_finish(Combiner c, Acc&& acc, double acc_w) {
+    if (!(acc_w>0)) { return; }
+    switch (c) {
+      case Combiner::WEIGHTED_AVERAGE:
+      case Combiner::MAJORITY_VOTE: {
+        acc /= acc_w;
+        break;
+      }
+      case Combiner::LOG_PROB_SUM: {
+        const double maxv = acc.max();
+        double total = 0;
+        for (size_t k = 0; k<acc.n_elem; ++k) {
+          acc[k] = std::exp(acc[k] - maxv);
+          total += acc[k];
+        }
+        acc /= total;
+        break;
+      }
+    }
+  }
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,260 @@
+#include "compiled_tree.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <tuple>
+
+#include "snode/nn1splitter/nn1dist_interface.hpp"
+#include "snode/nn1splitter/nn1splitter.private.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  using snode::nn1splitter::SplitterNN1;
+  using snode::nn1splitter::distance_phase;
+  using snode::nn1splitter::memo_eval_many;
+
+  CompiledTree::Bound CompiledTree::bind(TreeData const& data) const {
+    Bound bound;
+    bound.reserve(transforms.size());
+    for (const auto& tname : transforms) {
+      const size_t id = transform_id(data, tname);
+      const std::optional<size_t> source_id = virtual_test_source(data, id);
+      bound.push_back({&at_train(data, id), &at_test(data, source_id.value_or(id)), source_id.has_value()});
+    }
+    return bound;
+  }
+
+  namespace {
+
+    /// NN1 ties, as (label, branch)
+    using Ties = std::vector<std::pair<EL, uint32_t>>;
+
+    /// The train exemplars of a NN1 node, in 'candidates'
+    void nn1_candidates(CompiledTree const& ct, CompiledTree::Node const& node, DTS const& train_dataset,
+                        std::vector<TSeries const *>& candidates) {
+      const size_t begin = node.exemplar_begin;
+      const size_t stop = begin + node.nb_exemplars;
+      candidates.clear();
+      for (size_t k = begin; k<stop; ++k) { candidates.push_back(&train_dataset[ct.exemplar_index[k]]); }
+    }
+
+    /// Branch of a NN1 node for 'query', given the node's candidates - see SplitterNN1::get_branch_index.
+    /// Through the memo of 'state' when 'query' is the exemplar 'test_idx' of the test data registered in 'data'
+    /// (see memo_eval_many). With 'derive_query', 'query' is raw (see CompiledTree::BoundTransform).
+    size_t nn1_branch(CompiledTree const& ct, CompiledTree::Node const& node, TreeState& state, TreeData const *data,
+                      TSeries const& query, std::optional<size_t> test_idx,
+                      std::vector<TSeries const *> const& candidates, Ties& ties, bool derive_query = false) {
+      const distance::stats::Scope stats_scope([&]() {
+        return distance::stats::family(node.distance->get_distance_name());
+      });
+      const auto time_scope = state.time(distance_phase(state, "predict/distance/", *node.distance));
+      const size_t begin = node.exemplar_begin;
+      const std::span<size_t const> train_indexes(ct.exemplar_index.data() + begin, node.nb_exemplars);
+      const auto nn = test_idx
+                      ? memo_eval_many(state, *data, *node.distance, node.distance_memo_key, test_idx.value(), query,
+                                       candidates, train_indexes, derive_query)
+                      : derive_query ? node.distance->eval_many_derivative(query, candidates, utils::PINF)
+                                     : node.distance->eval_many(query, candidates, utils::PINF);
+      ties.clear();
+      for (size_t i : nn.ties) { ties.emplace_back(ct.exemplar_label[begin + i], ct.exemplar_branch[begin + i]); }
+      assert(!ties.empty());
+      // Sample over the sorted, unique labels, as SplitterNN1 does over a std::set: same draw
+      std::sort(ties.begin(), ties.end());
+      ties.erase(std::unique(ties.begin(), ties.end()), ties.end());
+      std::pair<EL, uint32_t> predicted;
+      std::sample(ties.begin(), ties.end(), &predicted, 1, state.prng);
+      return predicted.second;
+    }
+
+    /// Iterative traversal of a compiled tree. 'query_at(t)' gives the train data, the query series for the transform
+    /// t, and whether the query is raw for a virtual test transform (see BoundTransform), and 'node_branch(splitter)'
+    /// the branch of a NODE. 'test_idx': index of the query in the test data registered in 'data', if any.
+    template<typename QueryAt, typename NodeBranch>
+    size_t walk(CompiledTree const& ct, TreeState& state, TreeData const *data, std::optional<size_t> test_idx,
+                QueryAt&& query_at, NodeBranch&& node_branch) {
+      using Node = CompiledTree::Node;
+      // NN1 candidates and ties: reused across the nodes
+      std::vector<TSeries const *> candidates;
+      Ties ties;
+      size_t n = 0;
+      for (;;) {
+        Node const& node = ct.nodes[n];
+        size_t branch_idx;
+        switch (node.kind) {
+          case CompiledTree::LEAF: { return node.leaf; }
+          case CompiledTree::NN1: {
+            const auto [train_dataset, test_exemplar, derive] = query_at(node.transform);
+            nn1_candidates(ct, node, *train_dataset, candidates);
+            branch_idx = nn1_branch(ct, node, state, data, *test_exemplar, test_idx, candidates, ties, derive);
+            break;
+          }
+          case CompiledTree::NODE: {
+            branch_idx = node_branch(*node.splitter);
+            if (branch_idx>=node.nb_branches) { throw std::out_of_range("CompiledTree: invalid branch index"); }
+            break;
+          }
+          default: utils::should_not_happen();
+        }
+        n = ct.branches[node.branch_begin + branch_idx];
+      }
+    }
+
+  } // End of anonymous namespace
+
+  size_t CompiledTree::predict_leaf(TreeState& state, TreeData const& data, Bound const& bound, size_t index) const {
+    return walk(*this, state, &data, index,
+                [&](size_t t) {
+                  const BoundTransform& b = bound[t];
+                  return std::tuple<DTS const *, TSeries const *, bool>(b.train, &(*b.test)[index], b.derive_test);
+                },
+                [&](i_SplitterNode& splitter) { return splitter.get_branch_index(state, data, index); });
+  }
+
+  size_t CompiledTree::predict_leaf(TreeState& state, Query const& query) const {
+    return walk(*this, state, nullptr, std::nullopt,
+                [&](size_t t) {
+                  return std::tuple<DTS const *, TSeries const *, bool>(query[t].first, query[t].second, false);
+                },
+                [](i_SplitterNode& /* splitter */) -> size_t {
+                  throw std::logic_error("CompiledTree: only NN1 nodes can predict a query without test data");
+                });
+  }
+
+  void CompiledTree::predict_leaves(TreeState& state, TreeData const& data, Bound const& bound,
+                                    std::vector<size_t> const& indexes, std::vector<size_t>& leaves) const {
+    leaves.assign(indexes.size(), 0);
+    if (indexes.empty()) { return; }
+    // Positions in 'indexes', partitioned per node: the positions reaching a node are contiguous in 'order'
+    std::vector<size_t> order(indexes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<size_t> partitioned(indexes.size());
+    std::vector<uint32_t> branch_of(indexes.size());
+    std::vector<size_t> counts;
+    std::vector<TSeries const *> candidates;
+    Ties ties;
+    // Ranges [begin, end[ of 'order' reaching a node, in breadth first order: level by level
+    struct Range {
+      size_t node;
+      size_t begin;
+      size_t end;
+    };
+    std::vector<Range> queue{{0, 0, indexes.size()}};
+    for (size_t q = 0; q<queue.size(); ++q) {
+      const Range r = queue[q];
+      Node const& node = nodes[r.node];
+      switch (node.kind) {
+        case LEAF: {
+          for (size_t k = r.begin; k<r.end; ++k) { leaves[order[k]] = node.leaf; }
+          continue;
+        }
+        case NN1: {
+          // The candidates of the node are gathered once, and stay in cache for all the test exemplars
+          const BoundTransform& b = bound[node.transform];
+          nn1_candidates(*this, node, *b.train, candidates);
+          for (size_t k = r.begin; k<r.end; ++k) {
+            TSeries const& query = (*b.test)[indexes[order[k]]];
+            branch_of[k] = (uint32_t)nn1_branch(*this, node, state, &data, query, indexes[order[k]], candidates,
+                                                ties, b.derive_test);
+          }
+          break;
+        }
+        case NODE: {
+          for (size_t k = r.begin; k<r.end; ++k) {
+            const size_t b = node.splitter->get_branch_index(state, data, indexes[order[k]]);
+            if (b>=node.nb_branches) { throw std::out_of_range("CompiledTree: invalid branch index"); }
+            branch_of[k] = (uint32_t)b;
+          }
+          break;
+        }
+        default: utils::should_not_happen();
+      }
+      // Stable partition of the range per branch (counting sort), queuing the non empty branches
+      counts.assign(node.nb_branches + 1, 0);
+      for (size_t k = r.begin; k<r.end; ++k) { counts[branch_of[k] + 1]++; }
+      for (size_t b = 0; b<node.nb_branches; ++b) { counts[b + 1] += counts[b]; }
+      for (size_t b = 0; b<node.nb_branches; ++b) {
+        if (counts[b]<counts[b + 1]) {
+          queue.push_back({branches[node.branch_begin + b], r.begin + counts[b], r.begin + counts[b + 1]});
+        }
+      }
+      for (size_t k = r.begin; k<r.end; ++k) { partitioned[r.begin + counts[branch_of[k]]++] = order[k]; }
+      std::copy(partitioned.begin() + (long)r.begin, partitioned.begin() + (long)r.end, order.begin() + (long)r.begin);
+    }
+  }
+
+  classifier::Result1 CompiledTree::predict(TreeState& state, TreeData const& data, Bound const& bound,
+                                            size_t index) const {
+    const size_t leaf = predict_leaf(state, data, bound, index);
+    return classifier::Result1(arma::rowvec(leaf_probabilities.row(leaf)), leaf_weights[leaf]);
+  }
+
+  std::optional<CompiledTree> CompiledTree::compile(std::shared_ptr<TreeNode> const& tree, TreeData const& data) {
+    CompiledTree ct;
+    ct.source = tree;
+
+    // --- Breadth first order: the children of a node are contiguous, after their parent
+    std::vector<TreeNode const *> order{tree.get()};
+    std::vector<classifier::Result1> leaves;
+    for (size_t i = 0; i<order.size(); ++i) {
+      TreeNode const& tn = *order[i];
+      Node node{};
+      if (tn.node_kind==TreeNode::LEAF) {
+        std::optional<classifier::Result1> r = tn.as_leaf.splitter->constant_result();
+        if (!r) { return {}; }
+        node.kind = LEAF;
+        node.leaf = (uint32_t)leaves.size();
+        leaves.push_back(std::move(r.value()));
+      } else {
+        // Children
+        node.branch_begin = (uint32_t)ct.branches.size();
+        node.nb_branches = (uint32_t)tn.as_node.branches.size();
+        for (const auto& b : tn.as_node.branches) {
+          ct.branches.push_back((uint32_t)order.size());
+          order.push_back(b.get());
+        }
+        // Splitter
+        auto *nn1 = dynamic_cast<SplitterNN1 *>(tn.as_node.splitter.get());
+        if (nn1!=nullptr) {
+          node.kind = NN1;
+          node.distance = nn1->distance.get();
+          node.distance_memo_key = nn1->distance_memo_key;
+          const std::string tname = nn1->distance->get_transformation_name();
+          auto it = std::find(ct.transforms.begin(), ct.transforms.end(), tname);
+          node.transform = (uint32_t)(it - ct.transforms.begin());
+          if (it==ct.transforms.end()) { ct.transforms.push_back(tname); }
+          DTS const& train_dataset = at_train(data, transform_id(data, tname));
+          node.exemplar_begin = (uint32_t)ct.exemplar_index.size();
+          node.nb_exemplars = (uint32_t)nn1->train_indexset.size();
+          // In the evaluation order of the splitter: the same exemplars are abandoned early, and the ties are found
+          // in the same order
+          for (size_t k = 0; k<nn1->train_indexset.size(); ++k) {
+            const size_t pos = nn1->eval_order.empty() ? k : nn1->eval_order[k];
+            const size_t idx = nn1->train_indexset[pos];
+            ct.exemplar_index.push_back(idx);
+            ct.exemplar_label.push_back(train_dataset.label(idx).value());
+            ct.exemplar_branch.push_back((uint32_t)nn1->exemplar_branches[pos]);
+          }
+        } else {
+          node.kind = NODE;
+          node.splitter = tn.as_node.splitter.get();
+        }
+      }
+      ct.nodes.push_back(node);
+    }
+
+    // --- Leaf results
+    const size_t nb_classes = leaves.empty() ? 0 : leaves[0].probabilities.n_elem;
+    ct.leaf_probabilities.set_size(leaves.size(), nb_classes);
+    ct.leaf_weights.set_size(leaves.size());
+    for (size_t l = 0; l<leaves.size(); ++l) {
+      if (leaves[l].probabilities.n_elem!=nb_classes) { return {}; }
+      ct.leaf_probabilities.row(l) = leaves[l].probabilities;
+      ct.leaf_weights[l] = leaves[l].weight;
+    }
+
+    return ct;
+  }
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tempo/classifier/utils.hpp"
+#include "treedata.hpp"
+#include "treestate.hpp"
+#include "tree.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  namespace snode::nn1splitter { struct i_Dist; }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Inference form of a trained tree
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Flattened, read only form of a trained tree, used for inference.
+   *  Nodes are stored in a contiguous array in breadth first order (the root is at index 0); the children of a node
+   *  are listed in a branch offset table. NN1 splitters are unpacked: their exemplars (index, label and branch) are
+   *  packed per node in contiguous arrays, and evaluated with their distance directly. Other node splitters are called
+   *  through their interface. The leaf results are stored in one matrix (one row per leaf).
+   *  Traversal is iterative. A tree can only be compiled if all its leaves have a constant result.
+   *  The compiled tree refers to the splitters of the source tree, which it keeps alive.
+   *  The prediction is the same as with TreeNode::predict, including the use of the state's PRNG to break ties.
+   */
+  struct CompiledTree {
+
+    // --- --- --- Types
+
+    enum Kind : uint8_t { LEAF, NN1, NODE };
+
+    struct Node {
+      Kind kind;
+      /// LEAF: row in leaf_probabilities/leaf_weights
+      uint32_t leaf{0};
+      /// NN1, NODE: children in 'branches'
+      uint32_t branch_begin{0};
+      uint32_t nb_branches{0};
+      /// NN1: exemplars in exemplar_index/exemplar_label/exemplar_branch
+      uint32_t exemplar_begin{0};
+      uint32_t nb_exemplars{0};
+      /// NN1: index in 'transforms'
+      uint32_t transform{0};
+      /// NN1: distance (owned by the source tree)
+      snode::nn1splitter::i_Dist *distance{nullptr};
+      /// NN1: key of the distance in the test time memo (see TreeState::memo)
+      uint64_t distance_memo_key{0};
+      /// NODE: splitter (owned by the source tree)
+      i_SplitterNode *splitter{nullptr};
+    };
+
+    /// Train and test data of a transform resolved from a TreeData (see bind). The test data of a virtual test
+    /// transform is its source, derived on the fly (see virtual_test_source).
+    struct BoundTransform {
+      DTS const *train;
+      DTS const *test;
+      bool derive_test;
+    };
+
+    /// Per transform, train and test data resolved from a TreeData (see bind)
+    using Bound = std::vector<BoundTransform>;
+
+    /// Per transform, train data and query series (see predict_leaf on a query)
+    using Query = std::vector<std::pair<DTS const *, TSeries const *>>;
+
+    // --- --- --- Fields
+
+    /// Nodes in breadth first order
+    std::vector<Node> nodes;
+
+    /// Branch offset table: index in 'nodes' of the children
+    std::vector<uint32_t> branches;
+
+    /// Exemplars of the NN1 nodes, packed per node in the evaluation order of their splitter
+    /// (see SplitterNN1::eval_order)
+    std::vector<size_t> exemplar_index;
+    std::vector<EL> exemplar_label;
+    std::vector<uint32_t> exemplar_branch;
+
+    /// Names of the transforms used by the NN1 nodes
+    std::vector<std::string> transforms;
+
+    /// Leaf results, one row per leaf
+    arma::mat leaf_probabilities;
+    arma::vec leaf_weights;
+
+    /// Source tree, owning the splitters
+    std::shared_ptr<TreeNode> source;
+
+    // --- --- --- Methods
+
+    /// Resolve the train and test data of the transforms used by the tree. The test data must be registered.
+    Bound bind(TreeData const& data) const;
+
+    /// Given a testing state and bound data, return the leaf (row in leaf_probabilities) reached by
+    /// the exemplar 'index'
+    size_t predict_leaf(TreeState& state, TreeData const& data, Bound const& bound, size_t index) const;
+
+    /** Tree-major prediction of a batch: the leaves reached by the exemplars 'indexes' in 'leaves' (same positions).
+     *  The batch goes down the tree level by level, partitioned per branch at each node: the exemplars reaching a
+     *  node are evaluated together, keeping the node's train exemplars in cache, instead of walking each exemplar from
+     *  the root to its leaf. The draws of the state's PRNG breaking the ties are made in another order than with
+     *  predict_leaf per exemplar: the leaves are the same, but for the exemplars with ties.
+     */
+    void predict_leaves(TreeState& state, TreeData const& data, Bound const& bound, std::vector<size_t> const& indexes,
+                        std::vector<size_t>& leaves) const;
+
+    /// Same as TreeNode::predict
+    classifier::Result1 predict(TreeState& state, TreeData const& data, Bound const& bound, size_t index) const;
+
+    /// Given a testing state, return the leaf reached by a query given per transform (in the order of 'transforms'),
+    /// without registered test data. Throws std::logic_error if the tree contains a NODE: only NN1 nodes can be used.
+    size_t predict_leaf(TreeState& state, Query const& query) const;
+
+    // --- --- --- Static functions
+
+    /// Compile a tree trained on (or loaded with) the train data in 'data'.
+    /// Return the empty option if the tree contains a leaf without a constant result.
+    static std::optional<CompiledTree> compile(std::shared_ptr<TreeNode> const& tree, TreeData const& data);
+  };
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,26 @@
+#include "distance_memo.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  void DistanceMemo::set_exact(Locked& locked, Key const& k, F value) {
+    Table& table = locked.table();
+    auto it = table.find(k);
+    if (it!=table.end()) { it->second = Entry{value, true}; }
+    else if (!full()) {
+      table.emplace(k, Entry{value, true});
+      nb_entries.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void DistanceMemo::set_bound(Locked& locked, Key const& k, F bound) {
+    Table& table = locked.table();
+    auto it = table.find(k);
+    if (it!=table.end()) {
+      if (!it->second.exact&&it->second.value<bound) { it->second.value = bound; }
+    } else if (!full()) {
+      table.emplace(k, Entry{bound, false});
+      nb_entries.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/utils/utils/resources.hpp>
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Test time distance memo
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Distances between the registered test exemplars and train exemplars, shared by the trees of a prediction
+   *  (see TreeState::memo): trees often compare a test exemplar with the same train exemplar under the same distance.
+   *  A distance is identified by a hash of its serialized form (type, transform and exact parameters).
+   *  As DistanceCache, an entry is either the exact distance, or a strict lower bound.
+   *  Test exemplars are given by their index in the registered test data: use one memo per registration.
+   *  The entries of a test exemplar are in one of several tables, each with its own lock: a NN1 node locks its table
+   *  once to read the entries of all its exemplars, and once to record them.
+   *  Entries are only added while the memo holds less than 'max_entries', bounded by the memory budget of the
+   *  distance caches (see utils::resources::budget).
+   *  Also shared by the trees of a training (see TreeState::train_memo), the "test" exemplars being then the queries
+   *  of the NN1 nodes, i.e. train exemplars.
+   */
+  struct DistanceMemo {
+
+    struct Entry {
+      F value;
+      bool exact;
+    };
+
+    /// Key of the distance of hash 'distance' between the test exemplar 'test_idx' and the train exemplar 'train_idx'
+    struct Key {
+      uint64_t distance;
+      uint64_t exemplars;
+
+      bool operator==(Key const&) const = default;
+    };
+
+    struct KeyHash {
+      size_t operator()(Key const& k) const noexcept {
+        return (size_t)(k.distance ^ (k.exemplars*0x9e3779b97f4a7c15ULL));
+      }
+    };
+
+    using Table = std::unordered_map<Key, Entry, KeyHash>;
+
+    static constexpr size_t nb_tables = 64;
+
+    /// Table of a test exemplar, locked while in scope
+    class Locked {
+      std::unique_lock<std::mutex> lock;
+      Table& table_;
+
+    public:
+      Locked(std::mutex& mutex, Table& table) : lock(mutex), table_(table) {}
+
+      Table& table() { return table_; }
+    };
+
+    // --- --- --- Constructors/Destructors
+
+    /// Approximate size of an entry in its table (key, value, and the node and bucket of the hash table)
+    static constexpr size_t entry_bytes = sizeof(Key) + sizeof(Entry) + 3*sizeof(void *);
+
+    explicit DistanceMemo(size_t max_entries) :
+      max_entries(std::min(max_entries, utils::resources::budget().distance_caches/entry_bytes)) {}
+
+    DistanceMemo(DistanceMemo const&) = delete;
+    DistanceMemo& operator=(DistanceMemo const&) = delete;
+
+    // --- --- --- Methods
+
+    static Key key(uint64_t distance, size_t test_idx, size_t train_idx) {
+      return {distance, ((uint64_t)test_idx << 32) | (uint64_t)(uint32_t)train_idx};
+    }
+
+    /// Lock the table of the test exemplar 'test_idx'
+    Locked lock(size_t test_idx) {
+      Shard& s = shards[test_idx%nb_tables];
+      return {s.mutex, s.table};
+    }
+
+    bool full() const { return nb_entries.load(std::memory_order_relaxed)>=max_entries; }
+
+    /// Record an exact distance in a locked table
+    void set_exact(Locked& locked, Key const& k, F value);
+
+    /// Record a strict lower bound in a locked table, unless an exact distance or a greater bound is known
+    void set_bound(Locked& locked, Key const& k, F bound);
+
+    /// Count 'nb_lookups' lookups, 'nb_hits' of them resolved by the memo
+    void count(size_t nb_lookups, size_t nb_hits) {
+      lookups.fetch_add(nb_lookups, std::memory_order_relaxed);
+      hits.fetch_add(nb_hits, std::memory_order_relaxed);
+    }
+
+    size_t size() const { return nb_entries.load(std::memory_order_relaxed); }
+
+    size_t nb_lookups() const { return lookups.load(std::memory_order_relaxed); }
+
+    size_t nb_hits() const { return hits.load(std::memory_order_relaxed); }
+
+    /// Ratio of the lookups resolved by the memo
+    double hit_rate() const {
+      const size_t l = nb_lookups();
+      return l==0 ? 0 : (double)nb_hits()/(double)l;
+    }
+
+  private:
+
+    struct alignas(64) Shard {
+      std::mutex mutex;
+      Table table;
+    };
+
+    size_t max_entries;
+    std::array<Shard, nb_tables> shards{};
+    std::atomic<size_t> nb_entries{0};
+    std::atomic<size_t> lookups{0};
+    std::atomic<size_t> hits{0};
+  };
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,74 @@
+#include "envelopes.hpp"
+
+#include <tempo/distance/univariate.hpp>
+#include <tempo/utils/utils/resources.hpp>
+
+#include <algorithm>
+
+namespace tempo::classifier::TSChief {
+
+  std::shared_ptr<const std::vector<F>>
+  DifferencesCache::get(DTS const& train, std::string const& tname, size_t idx) const {
+    Key key{tname, idx};
+    {
+      std::lock_guard lock(mtx);
+      if (auto it = entries.find(key); it!=entries.end()) { return it->second; }
+    }
+    // Miss: compute outside of the lock. Insert, unless another thread did it in the meantime
+    const TSeries& s = train[idx];
+    auto diff = std::make_shared<std::vector<F>>(s.length());
+    distance::univariate::first_differences(s.data(), s.length(), diff->data());
+    std::lock_guard lock(mtx);
+    return entries.try_emplace(std::move(key), std::move(diff)).first->second;
+  }
+
+  std::shared_ptr<const Envelopes>
+  EnvelopesCache::get(DTS const& train, std::string const& tname, size_t idx, size_t w) const {
+    Key key{tname, idx, w};
+    // Hit: move in front
+    {
+      std::lock_guard lock(mtx);
+      if (auto it = index.find(key); it!=index.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        return it->second->second;
+      }
+    }
+    // Miss: compute outside of the lock
+    auto env = std::make_shared<Envelopes>();
+    const TSeries& s = train[idx];
+    distance::univariate::get_keogh_envelopes(s.data(), s.length(), env->upper, env->lower, w);
+    // Insert, unless another thread did it in the meantime
+    std::lock_guard lock(mtx);
+    if (auto it = index.find(key); it!=index.end()) {
+      lru.splice(lru.begin(), lru, it->second);
+      return it->second->second;
+    }
+    lru.emplace_front(key, env);
+    index.emplace(std::move(key), lru.begin());
+    nb_points += env->upper.size();
+    // Evict the least recently used entries, keeping at least the new one
+    while (nb_points>capacity&&lru.size()>1) {
+      const Entry& last = lru.back();
+      nb_points -= last.second->upper.size();
+      index.erase(last.first);
+      lru.pop_back();
+    }
+    return env;
+  }
+
+  size_t EnvelopesCache::default_capacity() {
+    const size_t points = utils::resources::budget().envelope_caches/2/(2*sizeof(F));
+    return std::min(DEFAULT_CAPACITY, points);
+  }
+
+  size_t EnvelopesCache::size() const {
+    std::lock_guard lock(mtx);
+    return lru.size();
+  }
+
+  size_t EnvelopesCache::points() const {
+    std::lock_guard lock(mtx);
+    return nb_points;
+  }
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/dataset/dts.hpp>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Envelopes cache
+
+  /// Upper and lower Keogh envelopes of a series for a warping window
+  struct Envelopes {
+    std::vector<F> upper;
+    std::vector<F> lower;
+  };
+
+  /** Shared, thread safe, least recently used cache of the envelopes of the train series, or of the test series
+   *  (see at_train_envelopes, at_test_envelopes). Entries are keyed by (transform name, series index, window), so that
+   *  the envelopes needed by a node are reused by the other nodes and trees using the same series and window.
+   *  The capacity is given in number of points: an entry counts the length of its series, for two values per point
+   *  (upper and lower), i.e. 2*sizeof(F) bytes per point.
+   *  Entries are shared pointers: an evicted entry remains valid for its current users.
+   */
+  class EnvelopesCache : private utils::Uncopyable {
+  public:
+    using Key = std::tuple<std::string, size_t, size_t>;
+
+    /// Default capacity: 2^25 points (512MiB of double)
+    static constexpr size_t DEFAULT_CAPACITY = size_t(1) << 25;
+
+  private:
+    using Entry = std::pair<Key, std::shared_ptr<const Envelopes>>;
+
+    /// Most recently used first
+    mutable std::list<Entry> lru;
+    mutable std::map<Key, std::list<Entry>::iterator> index;
+    /// Sum of the lengths of the envelopes in 'lru'
+    mutable size_t nb_points{0};
+    mutable std::mutex mtx;
+    size_t capacity;
+
+  public:
+
+    explicit EnvelopesCache(size_t capacity = default_capacity()) : capacity(capacity) {}
+
+    /// DEFAULT_CAPACITY, bounded by half the memory budget of the envelope caches, shared by a train and a test cache
+    /// (see utils::resources::budget)
+    static size_t default_capacity();
+
+    /// Envelopes of the series 'idx' of the 'train' data (the test data for a test cache), for the transform 'tname'
+    /// and the window 'w'. Computed on a miss, outside of the lock.
+    std::shared_ptr<const Envelopes> get(DTS const& train, std::string const& tname, size_t idx, size_t w) const;
+
+    /// Number of cached entries
+    size_t size() const;
+
+    /// Number of cached points, the sum of the lengths of the series of the entries (at most the capacity, unless a
+    /// single entry is larger)
+    size_t points() const;
+  };
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // First differences cache
+
+  /** Shared, thread safe cache of the first differences of the train series (see univariate::first_differences),
+   *  used by MSM and TWE. Entries are keyed by (transform name, series index), computed once and never evicted:
+   *  at most one difference per train point.
+   */
+  class DifferencesCache : private utils::Uncopyable {
+  public:
+    using Key = std::pair<std::string, size_t>;
+
+  private:
+    mutable std::map<Key, std::shared_ptr<const std::vector<F>>> entries;
+    mutable std::mutex mtx;
+
+  public:
+
+    /// First differences of the series 'idx' of the 'train' data, for the transform 'tname'.
+    /// Computed on a miss, outside of the lock.
+    std::shared_ptr<const std::vector<F>> get(DTS const& train, std::string const& tname, size_t idx) const;
+  };
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,78 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "envelopes.hpp"
+
+#include <tempo/distance/univariate.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace tempo;
+using namespace tempo::classifier::TSChief;
+
+namespace {
+
+  /// Dataset of univariate series of the given lengths, the value j of a series being j
+  DTS mk_dts(std::vector<size_t> const& lengths) {
+    std::vector<TSeries> series;
+    std::vector<std::optional<std::string>> labels;
+    for (const size_t l : lengths) {
+      std::vector<F> v(l);
+      for (size_t j = 0; j<l; ++j) { v[j] = (F)j; }
+      series.push_back(TSeries::mk_from_rowmajor(std::move(v), 1, {"0"}, false));
+      labels.emplace_back("0");
+    }
+    const auto [minl, maxl] = std::minmax_element(lengths.begin(), lengths.end());
+    auto header = std::make_shared<DatasetHeader>("mock", *minl, *maxl, 1, std::move(labels), std::vector<size_t>{});
+    auto transform = std::make_shared<DatasetTransform<TSeries>>(header, "default", std::move(series));
+    return DTS("mock", transform);
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// An entry counts the length of its series against the capacity; the least recently used entries are evicted.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Envelopes cache", "[envelopes]") {
+  const DTS train = mk_dts({10, 7, 5, 8, 30});
+  EnvelopesCache cache(25);
+
+  SECTION("Counted points and eviction") {
+    cache.get(train, "default", 0, 2);
+    REQUIRE(cache.points()==10);
+    cache.get(train, "default", 1, 2);
+    cache.get(train, "default", 2, 2);
+    REQUIRE(cache.size()==3);
+    REQUIRE(cache.points()==22);
+    // Same series, other window: another entry. 22+10 > 25: evict the least recently used (series 0)
+    cache.get(train, "default", 0, 3);
+    REQUIRE(cache.size()==3);
+    REQUIRE(cache.points()==22);
+    // Hit on series 1 (window 2): most recently used, series 2 is evicted next. 22+8 > 25
+    cache.get(train, "default", 1, 2);
+    cache.get(train, "default", 3, 2);
+    REQUIRE(cache.size()==3);
+    REQUIRE(cache.points()==25);
+    REQUIRE(cache.get(train, "default", 1, 2)!=nullptr);
+    REQUIRE(cache.points()==25);
+    // A series larger than the capacity is kept alone
+    cache.get(train, "default", 4, 2);
+    REQUIRE(cache.size()==1);
+    REQUIRE(cache.points()==30);
+  }
+
+  SECTION("Cached envelopes") {
+    const auto env = cache.get(train, "default", 1, 2);
+    std::vector<F> upper;
+    std::vector<F> lower;
+    TSeries const& s = train[1];
+    distance::univariate::get_keogh_envelopes(s.data(), s.length(), upper, lower, 2);
+    REQUIRE(env->upper==upper);
+    REQUIRE(env->lower==lower);
+    // Hit: the same entry
+    REQUIRE(cache.get(train, "default", 1, 2)==env);
+    REQUIRE(cache.points()==7);
+  }
+}
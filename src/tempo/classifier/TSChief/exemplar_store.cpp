@@ -0,0 +1,192 @@
+#include "exemplar_store.hpp"
+#include "serialize.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string_view>
+
+#include <tempo/utils/utils/mapped_file.hpp>
+
+namespace tempo::classifier::TSChief {
+
+  namespace {
+    const std::string store_magic{"tempo::TSChief::ExemplarStore"};
+    constexpr uint32_t store_version = 1;
+
+    /// FNV-1a, 64 bits
+    struct Fnv1a {
+      uint64_t h = 0xcbf29ce484222325ULL;
+
+      void bytes(void const *ptr, size_t nbbytes) {
+        auto const *p = static_cast<unsigned char const *>(ptr);
+        for (size_t i = 0; i<nbbytes; ++i) {
+          h ^= p[i];
+          h *= 0x100000001b3ULL;
+        }
+      }
+
+      template<typename T>
+      void value(T const& v) { bytes(&v, sizeof(T)); }
+
+      void string(std::string const& s) {
+        value<uint64_t>(s.size());
+        bytes(s.data(), s.size());
+      }
+    };
+
+    /// Hash of the shape and values of a series
+    uint64_t content_hash(TSeries const& ts) {
+      const std::string_view bytes((char const *)ts.data(), ts.size()*sizeof(F));
+      return std::hash<std::string_view>{}(bytes)^(ts.length()*0x9e3779b97f4a7c15ULL)^ts.nb_dimensions();
+    }
+
+    /// Load a store. If 'r' reads from a mapping, the exemplars are views into it, kept alive by 'mapping'.
+    ExemplarStore load_store(BinReader& r, utils::Capsule const& mapping) {
+      r.expect(store_magic);
+      if (r.read<uint32_t>()!=store_version) {
+        throw std::runtime_error("Exemplar store deserialization: unsupported version");
+      }
+      if (r.read<uint8_t>()!=sizeof(F)) {
+        throw std::runtime_error("Exemplar store deserialization: saved with a different floating point precision");
+      }
+      ExemplarStore store;
+      store.fingerprint = r.read<uint64_t>();
+      std::vector<L> index_to_label(r.read_size());
+      for (auto& l : index_to_label) { l = r.read_string(); }
+      // Rebuild the encoder one label at a time, preserving the encoding
+      LabelEncoder encoder;
+      for (const auto& l : index_to_label) { encoder = LabelEncoder(std::move(encoder), std::vector<L>{l}); }
+
+      store.exemplars = std::make_shared<MDTS>();
+      const size_t nb_transforms = r.read_size();
+      for (size_t t = 0; t<nb_transforms; ++t) {
+        std::string tname = r.read_string();
+        const size_t nb_exemplars = r.read_size();
+        std::vector<TSeries> series;
+        series.reserve(nb_exemplars);
+        std::vector<std::optional<L>> labels;
+        labels.reserve(nb_exemplars);
+        std::vector<size_t> instances_with_missing;
+        size_t minl = nb_exemplars==0 ? 0 : std::numeric_limits<size_t>::max();
+        size_t maxl = 0;
+        size_t nbdim = 1;
+        for (size_t i = 0; i<nb_exemplars; ++i) {
+          const auto el = r.read<int64_t>();
+          if (el>=(int64_t)index_to_label.size()) {
+            throw std::runtime_error("Exemplar store deserialization: invalid label");
+          }
+          std::optional<L> ol;
+          if (el>=0) { ol = index_to_label[el]; }
+          nbdim = r.read_size();
+          const size_t length = r.read_size();
+          const bool missing = r.read<uint8_t>()!=0;
+          r.align();
+          if (r.mapping!=nullptr) {
+            auto const *data = reinterpret_cast<F const *>(r.view(nbdim*length*sizeof(F)));
+            series.push_back(TSeries::mk_view(mapping, data, nbdim, length, ol, missing));
+          } else {
+            arma::Mat<F> m(nbdim, length);
+            r.read_bytes(m.memptr(), m.n_elem*sizeof(F));
+            series.push_back(TSeries::mk_from_colmajor(std::move(m), ol, missing));
+          }
+          labels.push_back(std::move(ol));
+          if (missing) { instances_with_missing.push_back(i); }
+          minl = std::min(minl, length);
+          maxl = std::max(maxl, length);
+        }
+        auto header = std::make_shared<DatasetHeader>(
+          "store", minl, maxl, nbdim, std::move(labels), std::move(instances_with_missing), encoder
+        );
+        auto transform = std::make_shared<DatasetTransform<TSeries>>(header, tname, std::move(series));
+        store.exemplars->emplace(tname, DTS("train", transform));
+      }
+      return store;
+    }
+
+  } // End of anonymous namespace
+
+  void ExemplarStore::save(std::ostream& out, MDTS const& train) {
+    if (train.empty()) { throw std::invalid_argument("Exemplar store serialization: no train data"); }
+    LabelEncoder const& encoder = train.begin()->second.header().label_encoder();
+    BinWriter w(out);
+    w.write_string(store_magic);
+    w.write<uint32_t>(store_version);
+    w.write<uint8_t>(sizeof(F));
+    w.write<uint64_t>(fingerprint_of(train));
+    w.write<uint64_t>(encoder.index_to_label().size());
+    for (const auto& l : encoder.index_to_label()) { w.write_string(l); }
+    w.write<uint64_t>(train.size());
+    for (const auto& [tname, dts] : train) {
+      w.write_string(tname);
+      w.write<uint64_t>(dts.size());
+      for (size_t i = 0; i<dts.size(); ++i) {
+        TSeries const& ts = dts[i];
+        const std::optional<EL> ol = dts.label(i);
+        w.write<int64_t>(ol ? (int64_t)ol.value() : -1);
+        w.write<uint64_t>(ts.nb_dimensions());
+        w.write<uint64_t>(ts.length());
+        w.write<uint8_t>(ts.missing() ? 1 : 0);
+        w.align();
+        w.write_bytes(ts.data(), ts.size()*sizeof(F));
+      }
+    }
+  }
+
+  ExemplarStore ExemplarStore::load(std::istream& in) {
+    BinReader r(in);
+    return load_store(r, {});
+  }
+
+  ExemplarStore ExemplarStore::load_mapped(std::filesystem::path const& path) {
+    auto file = std::make_shared<utils::MappedFile>(path);
+    MemoryBuf buffer(file->data(), file->size());
+    std::istream in(&buffer);
+    BinReader r(in, file->data(), file->size());
+    return load_store(r, utils::make_capsule<std::shared_ptr<utils::MappedFile>>(file));
+  }
+
+  uint64_t ExemplarStore::fingerprint_of(MDTS const& train) {
+    Fnv1a h;
+    if (!train.empty()) {
+      for (const auto& l : train.begin()->second.header().label_encoder().index_to_label()) { h.string(l); }
+    }
+    for (const auto& [tname, dts] : train) {
+      h.string(tname);
+      h.value<uint64_t>(dts.size());
+      for (size_t i = 0; i<dts.size(); ++i) {
+        TSeries const& ts = dts[i];
+        const std::optional<EL> ol = dts.label(i);
+        h.value<int64_t>(ol ? (int64_t)ol.value() : -1);
+        h.value<uint64_t>(ts.nb_dimensions());
+        h.value<uint64_t>(ts.length());
+        h.bytes(ts.data(), ts.size()*sizeof(F));
+      }
+    }
+    return h.h;
+  }
+
+  ExemplarStore::Index::Index(ExemplarStore const& store) : store(store) {
+    for (const auto& [tname, dts] : *store.exemplars) {
+      auto& m = by_hash[tname];
+      m.reserve(dts.size());
+      for (size_t i = 0; i<dts.size(); ++i) { m.emplace(content_hash(dts[i]), i); }
+    }
+  }
+
+  std::optional<size_t>
+  ExemplarStore::Index::find(std::string const& tname, TSeries const& ts, std::optional<L> const& label) const {
+    auto it = by_hash.find(tname);
+    if (it==by_hash.end()) { return {}; }
+    DTS const& dts = store.exemplars->at(tname);
+    auto [begin, end] = it->second.equal_range(content_hash(ts));
+    for (auto c = begin; c!=end; ++c) {
+      TSeries const& s = dts[c->second];
+      if (s.nb_dimensions()==ts.nb_dimensions()&&s.length()==ts.length()&&dts.original_label(c->second)==label&&
+          std::equal(s.data(), s.data() + s.size(), ts.data())) {
+        return {c->second};
+      }
+    }
+    return {};
+  }
+
+} // End of namespace tempo::classifier::TSChief
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "treedata.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  /** Train exemplars shared by several models, per transform, e.g. the global training pool of per region models.
+   *  A model saved against a store (see Forest::save) references its exemplars by their index in the store instead of
+   *  carrying them. The models loaded with the same store (see Forest::load_mapped) share its exemplars: memory
+   *  scales with the data rather than with the number of models.
+   *  The format is the one of the model exemplars, stored as they are (see Forest::save), and is identified by a
+   *  fingerprint of the exemplars recorded by the models referencing it.
+   */
+  struct ExemplarStore {
+
+    /// The exemplars, per transform. Their headers carry the label encoding of the store.
+    std::shared_ptr<MDTS> exemplars;
+
+    /// Fingerprint of the exemplars (see fingerprint_of)
+    uint64_t fingerprint{0};
+
+    /// Write all the exemplars of 'train', per transform, in the store format. 'train' must not be empty.
+    static void save(std::ostream& out, MDTS const& train);
+
+    /** Load a store written by save. Throws std::runtime_error on invalid input. */
+    static ExemplarStore load(std::istream& in);
+
+    /** Load a store written by save in a file, memory mapping the file: the exemplars are views into the mapping,
+     *  with pages shared between the processes loading the same store (see Forest::load_mapped).
+     *  Throws std::runtime_error on invalid input.
+     */
+    static ExemplarStore load_mapped(std::filesystem::path const& path);
+
+    /// Fingerprint of train data: a hash of its label encoding, and of the transform names, labels, shapes and values
+    /// of its exemplars
+    static uint64_t fingerprint_of(MDTS const& train);
+
+    /// Index of the exemplars of the store by content, finding the store index of the exemplars of a model
+    struct Index {
+      ExemplarStore const& store;
+      /// Per transform, store indexes by hash of their values
+      std::map<std::string, std::unordered_multimap<uint64_t, size_t>> by_hash;
+
+      explicit Index(ExemplarStore const& store);
+
+      /// Index in the store of an exemplar of the transform 'tname' with the label 'label', and the same shape and
+      /// values as 'ts'
+      std::optional<size_t> find(std::string const& tname, TSeries const& ts, std::optional<L> const& label) const;
+    };
+  };
+
+} // End of namespace tempo::classifier::TSChief
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <tempo/utils/utils.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Features cache
+
+  /** Shared, thread safe cache of the features of a whole dataset (e.g. the BOSS histograms or the RISE intervals
+   *  features of all the train series), keyed by a string identifying the feature transform and its parameters.
+   *  Each entry is computed once, by the first thread asking for it, and never evicted: the other threads asking for
+   *  it meanwhile wait. As for LazyDTS, 'make' runs on the calling thread and must not wait for the thread pool tasks.
+   *  The train and test data have their own cache (see register_train, register_test), shared by all the trees.
+   */
+  class FeatureCache : private utils::Uncopyable {
+
+    struct Entry {
+      std::once_flag once{};
+      std::shared_ptr<const void> value{};
+    };
+
+    mutable std::map<std::string, std::shared_ptr<Entry>> entries;
+    mutable std::mutex mtx;
+
+  public:
+
+    /// Features of 'key', computed by 'make' on a miss. All the calls for a same key must ask for the same type.
+    template<typename T>
+    std::shared_ptr<const T> get(std::string const& key, std::function<T()> const& make) const {
+      std::shared_ptr<Entry> entry;
+      {
+        std::lock_guard lock(mtx);
+        auto& slot = entries[key];
+        if (!slot) { slot = std::make_shared<Entry>(); }
+        entry = slot;
+      }
+      std::call_once(entry->once, [&]() { entry->value = std::make_shared<const T>(make()); });
+      return std::static_pointer_cast<const T>(entry->value);
+    }
+
+    /// Number of keys asked for
+    size_t size() const {
+      std::lock_guard lock(mtx);
+      return entries.size();
+    }
+  };
+
+} // End of tempo::classifier::TSChief
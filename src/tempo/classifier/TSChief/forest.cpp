@@ -1,8 +1,58 @@
 #include "forest.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <tempo/utils/utils/mapped_file.hpp>
+
 namespace tempo::classifier::TSChief {
 
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  TreeMemory Forest::memory() const {
+    TreeMemory m;
+    for (const auto& tree : forest) { m += tree->memory(); }
+    return m;
+  }
+
+  TreeStats Forest::stats() const {
+    TreeStats s;
+    for (const auto& tree : forest) { if (tree->stats) { s += *tree->stats; }}
+    return s;
+  }
+
+  size_t Forest::prune() {
+    compiled.clear();
+    size_t nb_removed = 0;
+    for (const auto& tree : forest) { nb_removed += tree->prune(); }
+    return nb_removed;
+  }
+
+  void Forest::compile(TreeData const& data) {
+    compiled.clear();
+    compiled.reserve(forest.size());
+    for (const auto& tree : forest) {
+      std::optional<CompiledTree> ct = CompiledTree::compile(tree, data);
+      if (!ct) {
+        compiled.clear();
+        return;
+      }
+      compiled.push_back(std::make_shared<const CompiledTree>(std::move(ct.value())));
+    }
+  }
+
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
@@ -16,9 +66,15 @@ namespace tempo::classifier::TSChief {
     // --- Multithreaded task
     // Note: each state/result slot is pre-allocated - no shared memory, no need for sync
     std::vector<classifier::Result1> result(nb_trees);
+    const bool is_compiled = !compiled.empty();
     auto test_task = [&](size_t tree_index) {
-      classifier::Result1 r = forest[tree_index]->predict(*local_states[tree_index], data, test_index);
-      result[tree_index] = std::move(r);
+      const utils::TraceScope trace("tree", "predict", "tree", (int64_t)tree_index);
+      if (is_compiled) {
+        CompiledTree const& ct = *compiled[tree_index];
+        result[tree_index] = ct.predict(*local_states[tree_index], data, ct.bind(data), test_index);
+      } else {
+        result[tree_index] = forest[tree_index]->predict(*local_states[tree_index], data, test_index);
+      }
     };
 
     tempo::utils::ParTasks p;
@@ -32,43 +88,1222 @@ namespace tempo::classifier::TSChief {
     return result;
   }
 
+  classifier::ResultN Forest::predict_latency(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                              utils::SpinPool& pool) const {
+    const size_t nb_trees = forest.size();
+    const size_t nb_test = test_is.size();
+    const size_t nb_workers = std::min(pool.size(), std::max<size_t>(nb_trees, 1));
+
+    // --- Fork states
+    std::vector<std::unique_ptr<TreeState>> local_states = state.forest_fork_vec(nb_trees);
+
+    // --- Each worker accumulates its range of trees in its own rows, allocated by the worker
+    std::vector<classifier::ResultN> partial(nb_workers);
+    const bool is_compiled = !compiled.empty();
+    auto job = [&](size_t worker) {
+      if (worker>=nb_workers) { return; }
+      classifier::ResultN& r = partial[worker];
+      r = classifier::ResultN(nb_test, trainclass_cardinality);
+      const size_t first = worker*nb_trees/nb_workers;
+      const size_t last = (worker + 1)*nb_trees/nb_workers;
+      for (size_t tree_index = first; tree_index<last; ++tree_index) {
+        TreeState& local_state = *local_states[tree_index];
+        if (is_compiled) {
+          CompiledTree const& ct = *compiled[tree_index];
+          const CompiledTree::Bound bound = ct.bind(data);
+          for (size_t i = 0; i<nb_test; ++i) {
+            const size_t leaf = ct.predict_leaf(local_state, data, bound, test_is[i]);
+            combine_add(combiner, r.probabilities.row(i), r.weight[i], ct.leaf_probabilities.row(leaf),
+                        ct.leaf_weights[leaf]);
+          }
+        } else {
+          for (size_t i = 0; i<nb_test; ++i) {
+            const classifier::Result1 res = forest[tree_index]->predict(local_state, data, test_is[i]);
+            combine_add(combiner, r.probabilities.row(i), r.weight[i], res.probabilities, res.weight);
+          }
+        }
+      }
+    };
+    pool.run(job);
+
+    // --- Merge states
+    state.forest_merge_in_vec(std::move(local_states));
+
+    // --- Sum the rows of the workers, in worker order, then turn them into probabilities (see combine_finish)
+    classifier::ResultN result(nb_test, trainclass_cardinality);
+    for (const auto& r : partial) {
+      result.probabilities += r.probabilities;
+      result.weight += r.weight;
+    }
+    for (size_t i = 0; i<nb_test; ++i) { combine_finish(combiner, result.probabilities.row(i), result.weight[i]); }
+    return result;
+  }
+
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
-  std::shared_ptr<Forest> ForestTrainer::train(
+  namespace {
+
+    /// Sorted, unique indexes of a (sampled) BCM
+    std::vector<size_t> inbag_indexes(ByClassMap const& bcm) {
+      std::vector<size_t> v = bcm.to_IndexSet().vector();
+      v.erase(std::unique(v.begin(), v.end()), v.end());
+      return v;
+    }
+
+    /// Leaf marking an exemplar skipped by a tree (out-of-bag prediction)
+    constexpr size_t skipped_leaf = std::numeric_limits<size_t>::max();
+
+  } // End of anonymous namespace
+
+  classifier::ResultN Forest::predict_batch(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                            size_t nb_threads, size_t chunk_size, std::ostream *out) const {
+    return predict_chunks(state, data, test_is, nb_threads, chunk_size, out, false, nullptr).result;
+  }
+
+  classifier::ResultN Forest::predict_oob(TreeState& state, TreeData const& data, IndexSet const& train_is,
+                                          size_t nb_threads) const {
+    if (inbag.size()!=forest.size()) { throw std::logic_error("Out-of-bag prediction: forest not trained on samples"); }
+    return predict_chunks(state, data, train_is, nb_threads, 1024, nullptr, true, nullptr).result;
+  }
+
+  std::vector<classifier::ResultN> Forest::predict_prefixes(TreeState& state, TreeData const& data,
+                                                            IndexSet const& test_is, size_t nb_threads,
+                                                            std::vector<size_t> const& prefix_sizes,
+                                                            size_t chunk_size, std::ostream *out) const {
+    for (size_t k = 0; k<prefix_sizes.size(); ++k) {
+      if (prefix_sizes[k]==0||prefix_sizes[k]>forest.size()||(k>0&&prefix_sizes[k]<prefix_sizes[k - 1])) {
+        throw std::invalid_argument("Prefix prediction: sizes must be non decreasing in [1, number of trees]");
+      }
+    }
+    Prefixes prefixes{prefix_sizes, {}};
+    for (size_t k = 0; k<prefix_sizes.size(); ++k) {
+      prefixes.results.emplace_back(test_is.size(), trainclass_cardinality);
+    }
+    predict_chunks(state, data, test_is, nb_threads, chunk_size, out, false, nullptr, &prefixes);
+    return std::move(prefixes.results);
+  }
+
+  Forest::AnytimeResult Forest::predict_anytime(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                                size_t nb_threads, Anytime const& anytime, size_t chunk_size,
+                                                std::ostream *out) const {
+    return predict_chunks(state, data, test_is, nb_threads, chunk_size, out, false, &anytime);
+  }
+
+  Forest::LeafIDs Forest::predict_leaf_ids(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                           size_t nb_threads) const {
+    const size_t nb_trees = forest.size();
+    LeafIDs result{test_is.size(), nb_trees, std::vector<uint32_t>(test_is.size()*nb_trees)};
+    std::vector<std::unique_ptr<TreeState>> local_states = state.forest_fork_vec(nb_trees);
+    const std::vector<size_t>& indexes = test_is.vector();
+    auto task = [&](size_t tree_index) {
+      const utils::TraceScope trace("tree", "leaves", "tree", (int64_t)tree_index);
+      std::vector<size_t> leaves;
+      if (compiled.empty()) { forest[tree_index]->route_batch(*local_states[tree_index], data, indexes, leaves); }
+      else {
+        CompiledTree const& ct = *compiled[tree_index];
+        ct.predict_leaves(*local_states[tree_index], data, ct.bind(data), indexes, leaves);
+      }
+      for (size_t i = 0; i<leaves.size(); ++i) { result.ids[i*nb_trees + tree_index] = (uint32_t)leaves[i]; }
+    };
+    tempo::utils::ParTasks p;
+    for (size_t i = 0; i<nb_trees; ++i) { p.push_task_args(task, i); }
+    p.execute((int)nb_threads);
+    state.forest_merge_in_vec(std::move(local_states));
+    return result;
+  }
+
+  Forest::SparseProximities Forest::proximities(LeafIDs const& a, LeafIDs const& b, size_t nb_threads) {
+    if (a.nb_trees!=b.nb_trees) { throw std::invalid_argument("Proximities: leaf IDs of different forests"); }
+    const size_t nb_trees = a.nb_trees;
+
+    // --- Per tree, the rows of 'b' grouped by leaf (counting sort): tree t, leaf l at
+    // [leaf_offsets[t][l], leaf_offsets[t][l+1][ of by_leaf[t]
+    std::vector<std::vector<size_t>> leaf_offsets(nb_trees);
+    std::vector<std::vector<uint32_t>> by_leaf(nb_trees);
+    for (size_t t = 0; t<nb_trees; ++t) {
+      uint32_t max_leaf = 0;
+      for (size_t j = 0; j<b.nb_rows; ++j) { max_leaf = std::max(max_leaf, b.at(j, t)); }
+      std::vector<size_t>& offsets = leaf_offsets[t];
+      offsets.assign(b.nb_rows==0 ? 1 : (size_t)max_leaf + 2, 0);
+      for (size_t j = 0; j<b.nb_rows; ++j) { ++offsets[b.at(j, t) + 1]; }
+      for (size_t l = 1; l<offsets.size(); ++l) { offsets[l] += offsets[l - 1]; }
+      std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+      by_leaf[t].resize(b.nb_rows);
+      for (size_t j = 0; j<b.nb_rows; ++j) { by_leaf[t][cursor[b.at(j, t)]++] = (uint32_t)j; }
+    }
+
+    // --- Per row of 'a', count the trees sharing a leaf with each row of 'b' in a dense accumulator, resetting only
+    // the touched columns. Rows are computed by blocks, one per task, then concatenated.
+    std::vector<std::vector<uint32_t>> row_columns(a.nb_rows);
+    std::vector<std::vector<double>> row_values(a.nb_rows);
+    const size_t block = 64;
+    auto task = [&](size_t block_start) {
+      std::vector<uint32_t> counts(b.nb_rows, 0);
+      std::vector<uint32_t> touched;
+      for (size_t i = block_start; i<std::min(a.nb_rows, block_start + block); ++i) {
+        touched.clear();
+        for (size_t t = 0; t<nb_trees; ++t) {
+          const uint32_t leaf = a.at(i, t);
+          std::vector<size_t> const& offsets = leaf_offsets[t];
+          if ((size_t)leaf + 1>=offsets.size()) { continue; }
+          for (size_t k = offsets[leaf]; k<offsets[leaf + 1]; ++k) {
+            const uint32_t j = by_leaf[t][k];
+            if (counts[j]++==0) { touched.push_back(j); }
+          }
+        }
+        std::sort(touched.begin(), touched.end());
+        row_columns[i] = touched;
+        row_values[i].reserve(touched.size());
+        for (uint32_t j : touched) {
+          row_values[i].push_back((double)counts[j]/(double)nb_trees);
+          counts[j] = 0;
+        }
+      }
+    };
+    tempo::utils::ParTasks p;
+    for (size_t i = 0; i<a.nb_rows; i += block) { p.push_task_args(task, i); }
+    p.execute((int)nb_threads);
+
+    SparseProximities result{a.nb_rows, b.nb_rows, {0}, {}, {}};
+    for (size_t i = 0; i<a.nb_rows; ++i) {
+      result.columns.insert(result.columns.end(), row_columns[i].begin(), row_columns[i].end());
+      result.values.insert(result.values.end(), row_values[i].begin(), row_values[i].end());
+      result.row_offsets.push_back(result.columns.size());
+    }
+    return result;
+  }
+
+  Forest::AnytimeResult Forest::predict_chunks(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                               size_t nb_threads, size_t chunk_size, std::ostream *out, bool oob,
+                                               Anytime const *anytime, Prefixes *prefixes) const {
+    const size_t nb_trees = forest.size();
+    const size_t nb_test = test_is.size();
+    if (chunk_size==0) { chunk_size = 1; }
+    const size_t round_size = std::max<size_t>(anytime==nullptr ? nb_trees : anytime->batch_size, 1);
+
+    // --- Pre-allocate the result
+    AnytimeResult aresult{classifier::ResultN(nb_test, trainclass_cardinality), {}};
+    classifier::ResultN& result = aresult.result;
+    aresult.nb_trees.assign(nb_test, nb_trees);
+
+    // --- Fork states, once for the whole batch
+    std::vector<std::unique_ptr<TreeState>> local_states = state.forest_fork_vec(nb_trees);
+
+    // --- Per tree reached leaves for one round of one chunk, indexed by [(tree_index - round start)*chunk_size +
+    // position in chunk]. When compiled, the results are read from the compiled trees when merging; else, the leaf
+    // splitters accumulate their result when merging (see i_SplitterLeaf::accumulate_into), without building it.
+    // Note: each state/result slot is pre-allocated - no shared memory, no need for sync
+    const bool is_compiled = !compiled.empty();
+    const bool batch_routing = tree_major||oob;
+    const size_t nb_slots = std::min(round_size, nb_trees)*chunk_size;
+    std::vector<i_SplitterLeaf *> chunk_reached(is_compiled ? 0 : nb_slots);
+    std::vector<size_t> chunk_leaf(is_compiled ? nb_slots : 0);
+    arma::rowvec acc(trainclass_cardinality);
+    std::vector<CompiledTree::Bound> bound;
+    if (is_compiled) { for (const auto& ct : compiled) { bound.push_back(ct->bind(data)); }}
+    // Uncompiled tree-major routing: per tree, the leaf splitters by leaf ID (see TreeNode::route_batch)
+    std::vector<std::vector<i_SplitterLeaf *>> leaf_orders;
+    if (!is_compiled&&batch_routing) { for (const auto& tree : forest) { leaf_orders.push_back(tree->leaf_order()); }}
+    tempo::utils::ProgressMonitor pm(nb_test);
+
+    // Anytime: maximal lead the trees from 'tree_index' onward can give to a class (see combine_bound)
+    std::vector<double> remaining_weight(nb_trees + 1, 0);
+    if (anytime!=nullptr) {
+      for (size_t tree_index = nb_trees; tree_index-->0;) {
+        double mw;
+        if (is_compiled) {
+          arma::vec const& lw = compiled[tree_index]->leaf_weights;
+          mw = lw.n_elem==0 ? 0 : lw.max();
+        } else { mw = forest[tree_index]->max_leaf_weight(); }
+        remaining_weight[tree_index] = remaining_weight[tree_index + 1] + combine_bound(combiner, mw);
+      }
+    }
+
+    // Anytime: the vote of the exemplar at row 'i' is decided after the trees before 'next_tree'
+    auto decided = [&](size_t i, size_t next_tree) {
+      auto row = result.probabilities.row(i);
+      double first = 0;
+      double second = 0;
+      for (double v : row) {
+        if (v>first) {
+          second = first;
+          first = v;
+        } else if (v>second) { second = v; }
+      }
+      if (first - second>remaining_weight[next_tree]) { return true; }
+      // Probability of the leading class: not known before finishing the sum of log probabilities
+      const double w = result.weight[i];
+      return combiner!=Combiner::LOG_PROB_SUM&&anytime->confidence&&w>0&&first/w>=anytime->confidence.value();
+    };
+
+    // Out-of-bag: skip the exemplars a tree was trained on
+    auto skip = [&](size_t tree_index, size_t index) {
+      return oob&&std::binary_search(inbag[tree_index].begin(), inbag[tree_index].end(), index);
+    };
+
+    // Prefixes: copy the row 'i' of the result in the results of the prefixes of 'nb' trees, with 'acc' if the
+    // leaves accumulate in it
+    auto copy_prefixes = [&](size_t i, size_t nb, bool with_acc) {
+      if (prefixes==nullptr) { return; }
+      const auto [first, last] = std::equal_range(prefixes->sizes.begin(), prefixes->sizes.end(), nb);
+      for (auto it = first; it!=last; ++it) {
+        classifier::ResultN& pr = prefixes->results[it - prefixes->sizes.begin()];
+        pr.probabilities.row(i) = result.probabilities.row(i);
+        if (with_acc) { pr.probabilities.row(i) += acc; }
+        pr.weight[i] = result.weight[i];
+      }
+    };
+
+    // Rows of the chunk still evaluated
+    std::vector<size_t> active;
+    active.reserve(chunk_size);
+
+    for (size_t chunk_start = 0; chunk_start<nb_test; chunk_start += chunk_size) {
+      const size_t chunk_stop = std::min(nb_test, chunk_start + chunk_size);
+      active.resize(chunk_stop - chunk_start);
+      std::iota(active.begin(), active.end(), chunk_start);
+
+      for (size_t round_start = 0; round_start<nb_trees&&!active.empty(); round_start += round_size) {
+        const size_t round_stop = std::min(nb_trees, round_start + round_size);
+
+        // --- Multithreaded task: one tree over the active exemplars of the chunk
+        auto test_task = [&](size_t tree_index) {
+          const utils::TraceScope trace("tree", "predict", "tree", (int64_t)tree_index);
+          TreeState& local_state = *local_states[tree_index];
+          const size_t offset = (tree_index - round_start)*chunk_size;
+          if (batch_routing) {
+            std::vector<size_t> positions;
+            std::vector<size_t> indexes;
+            std::vector<size_t> leaves;
+            for (size_t i : active) {
+              if (!skip(tree_index, test_is[i])) {
+                positions.push_back(i);
+                indexes.push_back(test_is[i]);
+              } else if (is_compiled) { chunk_leaf[offset + i - chunk_start] = skipped_leaf; }
+              else { chunk_reached[offset + i - chunk_start] = nullptr; }
+            }
+            if (is_compiled) {
+              compiled[tree_index]->predict_leaves(local_state, data, bound[tree_index], indexes, leaves);
+              for (size_t k = 0; k<positions.size(); ++k) {
+                chunk_leaf[offset + positions[k] - chunk_start] = leaves[k];
+              }
+            } else {
+              forest[tree_index]->route_batch(local_state, data, indexes, leaves);
+              std::vector<i_SplitterLeaf *> const& leaf_order = leaf_orders[tree_index];
+              for (size_t k = 0; k<positions.size(); ++k) {
+                chunk_reached[offset + positions[k] - chunk_start] = leaf_order[leaves[k]];
+              }
+            }
+          } else if (is_compiled) {
+            CompiledTree const& ct = *compiled[tree_index];
+            for (size_t i : active) {
+              size_t& leaf = chunk_leaf[offset + i - chunk_start];
+              if (skip(tree_index, test_is[i])) { leaf = skipped_leaf; }
+              else { leaf = ct.predict_leaf(local_state, data, bound[tree_index], test_is[i]); }
+            }
+          } else {
+            TreeNode const& tree = *forest[tree_index];
+            for (size_t i : active) {
+              i_SplitterLeaf *& reached = chunk_reached[offset + i - chunk_start];
+              if (skip(tree_index, test_is[i])) { reached = nullptr; }
+              else { reached = &tree.reach_leaf(local_state, data, test_is[i]); }
+            }
+          }
+        };
+
+        tempo::utils::ParTasks p;
+        for (size_t i = round_start; i<round_stop; ++i) { p.push_task_args(test_task, i); }
+        p.execute((int)nb_threads);
+
+        // --- Accumulate per tree results in the row of the exemplar, in tree order (see combine_add)
+        // When averaging an uncompiled forest, the leaves accumulate their result themselves.
+        const bool leaf_accumulate = !is_compiled&&combiner==Combiner::WEIGHTED_AVERAGE;
+        for (size_t i : active) {
+          auto row = result.probabilities.row(i);
+          double& w = result.weight[i];
+          if (leaf_accumulate) { acc.zeros(); }
+          for (size_t tree_index = round_start; tree_index<round_stop; ++tree_index) {
+            copy_prefixes(i, tree_index, leaf_accumulate);
+            const size_t slot = (tree_index - round_start)*chunk_size + i - chunk_start;
+            if (is_compiled) {
+              CompiledTree const& ct = *compiled[tree_index];
+              const size_t leaf = chunk_leaf[slot];
+              if (leaf==skipped_leaf) { continue; }
+              combine_add(combiner, row, w, ct.leaf_probabilities.row(leaf), ct.leaf_weights[leaf]);
+            } else {
+              i_SplitterLeaf *reached = chunk_reached[slot];
+              if (reached==nullptr) { continue; }
+              if (leaf_accumulate) {
+                reached->accumulate_into(*local_states[tree_index], data, test_is[i], acc, w);
+              } else {
+                const classifier::Result1 r = reached->predict(*local_states[tree_index], data, test_is[i]);
+                combine_add(combiner, row, w, r.probabilities, r.weight);
+              }
+            }
+          }
+          copy_prefixes(i, round_stop, leaf_accumulate);
+          if (leaf_accumulate) { row += acc; }
+        }
+
+        // --- Anytime: stop evaluating the decided exemplars
+        if (anytime!=nullptr&&round_stop<nb_trees) {
+          std::erase_if(active, [&](size_t i) {
+            if (!decided(i, round_stop)) { return false; }
+            aresult.nb_trees[i] = round_stop;
+            return true;
+          });
+        }
+      }
+
+      // --- Probabilities (see combine_finish)
+      for (size_t i = chunk_start; i<chunk_stop; ++i) {
+        combine_finish(combiner, result.probabilities.row(i), result.weight[i]);
+        if (prefixes!=nullptr) {
+          for (classifier::ResultN& pr : prefixes->results) {
+            combine_finish(combiner, pr.probabilities.row(i), pr.weight[i]);
+          }
+        }
+        pm.print_progress(out, i + 1);
+      }
+    }
+
+    // --- Merge states
+    state.forest_merge_in_vec(std::move(local_states));
+
+    // --- Return
+    return aresult;
+  }
+
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Compaction
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  namespace {
+    /// Exemplars to copy in a compact train data, per transform, in table order: their train data and index in it
+    using ExemplarSources = std::map<std::string, std::vector<std::pair<DTS const *, size_t>>>;
+
+    /// Per transform, sorted positions in ExemplarSources starting a block aligned on SeriesSlab::alignment
+    using ExemplarBlocks = std::map<std::string, std::vector<size_t>>;
+
+    /// Copy the exemplars of each transform in one slab, with the train label encoding (see Forest::compact).
+    /// If 'blocks' is given, the slab is padded so that each block starts on an aligned offset.
+    std::shared_ptr<MDTS> copy_exemplars(ExemplarSources const& sources, ExemplarBlocks const *blocks = nullptr) {
+      constexpr size_t align_values = std::max<size_t>(SeriesSlab::alignment/sizeof(F), 1);
+      auto compact_mdts = std::make_shared<MDTS>();
+      for (const auto& [tname, exemplars] : sources) {
+        std::vector<size_t> const *starts = nullptr;
+        if (blocks!=nullptr) {
+          if (auto it = blocks->find(tname); it!=blocks->end()) { starts = &it->second; }
+        }
+        // Offset of each exemplar in the slab
+        std::vector<size_t> offsets;
+        offsets.reserve(exemplars.size());
+        size_t nb_values = 0;
+        size_t next_block = 0;
+        for (size_t i = 0; i<exemplars.size(); ++i) {
+          if (starts!=nullptr&&next_block<starts->size()&&(*starts)[next_block]==i) {
+            nb_values = (nb_values + align_values - 1)/align_values*align_values;
+            ++next_block;
+          }
+          offsets.push_back(nb_values);
+          nb_values += (*exemplars[i].first)[exemplars[i].second].size();
+        }
+        const SeriesSlab slab(nb_values);
+        std::vector<TSeries> series;
+        series.reserve(exemplars.size());
+        std::vector<std::optional<L>> labels;
+        labels.reserve(exemplars.size());
+        std::vector<size_t> instances_with_missing;
+        size_t minl = exemplars.empty() ? 0 : std::numeric_limits<size_t>::max();
+        size_t maxl = 0;
+        for (size_t i = 0; i<exemplars.size(); ++i) {
+          TSeries const& ts = (*exemplars[i].first)[exemplars[i].second];
+          std::copy(ts.data(), ts.data() + ts.size(), slab.data + offsets[i]);
+          if (ts.missing()) { instances_with_missing.push_back(series.size()); }
+          series.push_back(slab.view(offsets[i], ts));
+          labels.push_back(ts.label());
+          minl = std::min(minl, ts.length());
+          maxl = std::max(maxl, ts.length());
+        }
+        DatasetHeader const& first = exemplars.front().first->header();
+        auto header = std::make_shared<DatasetHeader>(
+          first.name(), minl, maxl, first.nb_dimensions(), std::move(labels),
+          std::move(instances_with_missing), first.label_encoder()
+        );
+        auto transform = std::make_shared<DatasetTransform<TSeries>>(header, tname, std::move(series));
+        compact_mdts->emplace(tname, DTS("train", transform));
+      }
+      return compact_mdts;
+    }
+
+    /// Append the exemplars of 'table', drawn from 'train_mdts', to 'sources'.
+    /// Return the table renumbered to their index in 'sources'.
+    ExemplarTable append_exemplars(ExemplarSources& sources, ExemplarTable const& table, MDTS const& train_mdts) {
+      ExemplarTable renumbered;
+      for (const auto& [tname, index_map] : table) {
+        auto& exemplars = sources[tname];
+        const size_t offset = exemplars.size();
+        exemplars.resize(offset + index_map.size());
+        auto& renumbered_map = renumbered[tname];
+        for (const auto& [train_idx, table_idx] : index_map) {
+          exemplars[offset + table_idx] = {&train_mdts.at(tname), train_idx};
+          renumbered_map.emplace(train_idx, offset + table_idx);
+        }
+      }
+      return renumbered;
+    }
+
+    /// Table of the exemplars of each internal node of the tree rooted at 'node', in depth first order.
+    /// A node shared by several trees is listed once.
+    void collect_node_exemplars(TreeNode& node, std::set<TreeNode const *>& visited,
+                                std::vector<std::pair<TreeNode *, ExemplarTable>>& nodes) {
+      if (node.node_kind!=TreeNode::NODE||!visited.insert(&node).second) { return; }
+      ExemplarTable table;
+      node.as_node.splitter->collect_exemplars(table);
+      nodes.emplace_back(&node, std::move(table));
+      for (const auto& branch : node.as_node.branches) { collect_node_exemplars(*branch, visited, nodes); }
+    }
+  }
+
+  std::shared_ptr<MDTS> Forest::compact(TreeData const& data, ExemplarLayout layout) {
+    ExemplarSources sources;
+    const MDTS train_mdts = materialized_train(data);
+    TreeData compact_data;
+
+    if (layout==ExemplarLayout::per_node) {
+      // One table per node, appended in its own aligned block
+      std::vector<std::pair<TreeNode *, ExemplarTable>> nodes;
+      std::set<TreeNode const *> visited;
+      for (const auto& tree : forest) { collect_node_exemplars(*tree, visited, nodes); }
+      ExemplarBlocks blocks;
+      for (auto& [node, table] : nodes) {
+        for (const auto& [tname, index_map] : table) { blocks[tname].push_back(sources[tname].size()); }
+        table = append_exemplars(sources, table, train_mdts);
+      }
+      std::shared_ptr<MDTS> compact_mdts = copy_exemplars(sources, &blocks);
+
+      // --- Renumber each splitter to its block
+      register_train(compact_data, compact_mdts);
+      for (const auto& [node, table] : nodes) { node->as_node.splitter->remap_exemplars(table, compact_data); }
+      compile(compact_data);
+      return compact_mdts;
+    }
+
+    ExemplarTable table;
+    for (const auto& tree : forest) { tree->collect_exemplars(table); }
+    table = append_exemplars(sources, table, train_mdts);
+    std::shared_ptr<MDTS> compact_mdts = copy_exemplars(sources);
+
+    // --- Renumber the splitters
+    register_train(compact_data, compact_mdts);
+    for (const auto& tree : forest) { tree->remap_exemplars(table, compact_data); }
+    compile(compact_data);
+    return compact_mdts;
+  }
+
+  Forest::Loaded Forest::merge(std::vector<std::pair<Forest const *, TreeData const *>> const& parts) {
+    if (parts.empty()) { throw std::invalid_argument("Forest merge: no forest to merge"); }
+    const size_t cardinality = parts.front().first->trainclass_cardinality;
+    LabelEncoder const *encoder = nullptr;
+    ExemplarSources sources;
+    std::vector<ExemplarTable> tables;
+    // The transforms of the parts, viewed by 'sources' until the exemplars are copied
+    std::vector<MDTS> parts_mdts;
+    parts_mdts.reserve(parts.size());
+    for (const auto& [part, data] : parts) {
+      if (part->trainclass_cardinality!=cardinality) {
+        throw std::invalid_argument("Forest merge: forests trained with different numbers of classes");
+      }
+      MDTS const& train_mdts = parts_mdts.emplace_back(materialized_train(*data));
+      for (const auto& [tname, dts] : train_mdts) {
+        if (encoder==nullptr) { encoder = &dts.header().label_encoder(); }
+        else if (dts.header().label_encoder().index_to_label()!=encoder->index_to_label()) {
+          throw std::invalid_argument("Forest merge: forests trained with different label encodings");
+        }
+      }
+      ExemplarTable table;
+      for (const auto& tree : part->forest) { tree->collect_exemplars(table); }
+      tables.push_back(append_exemplars(sources, table, train_mdts));
+    }
+    std::shared_ptr<MDTS> merged_mdts = copy_exemplars(sources);
+
+    // --- Renumber the splitters of each part, and gather the trees in part order
+    TreeData merged_data;
+    register_train(merged_data, merged_mdts);
+    std::vector<TREE> trees;
+    size_t next_tree_index = 0;
+    for (size_t p = 0; p<parts.size(); ++p) {
+      next_tree_index = std::max(next_tree_index, parts[p].first->next_tree_index);
+      for (const auto& tree : parts[p].first->forest) {
+        tree->remap_exemplars(tables[p], merged_data);
+        trees.push_back(tree);
+      }
+    }
+    auto merged = std::make_shared<Forest>(std::move(trees), cardinality);
+    merged->next_tree_index = next_tree_index;
+    merged->compile(merged_data);
+    return {std::move(merged), std::move(merged_mdts)};
+  }
+
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Serialization
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  namespace {
+    const std::string model_magic{"tempo::TSChief::Forest"};
+    constexpr uint32_t model_version = 5;
+    /// Version 2 models store all their exemplars as they are, without an encoding tag
+    constexpr uint32_t model_version_raw = 2;
+    /// Encoding tag of an exemplar stored as it is; else, the tag is a distance::quantized::QFormat
+    constexpr uint8_t exemplar_raw = 0;
+    /// Version 6 models reference the exemplars of an exemplar store (see ExemplarStore) instead of storing them
+    constexpr uint32_t model_version_store = 6;
+    /// Versions 3 and 4: versions 5 and 6 without the next tree index (see Forest::next_tree_index)
+    constexpr uint32_t model_version_unindexed = 3;
+    constexpr uint32_t model_version_store_unindexed = 4;
+
+    /// Write the header of a model: format, class cardinality and label encoding
+    void write_header(BinWriter& w, uint32_t version, size_t trainclass_cardinality, LabelEncoder const& encoder) {
+      w.write_string(model_magic);
+      w.write<uint32_t>(version);
+      w.write<uint8_t>(sizeof(F));
+      w.write<uint64_t>(trainclass_cardinality);
+      w.write<uint64_t>(encoder.index_to_label().size());
+      for (const auto& l : encoder.index_to_label()) { w.write_string(l); }
+    }
+
+    /** Write a model (see Forest::save) of 'nb_trees' trees, already written by 'tw' in 'trees': the header, the
+     *  exemplars collected by 'tw', drawn from 'data', the next tree index, then the trees.
+     */
+    void write_model(std::ostream& out, TreeData const& data, size_t trainclass_cardinality, BinWriter const& tw,
+                     std::string_view trees, size_t nb_trees, size_t next_tree_index,
+                     std::optional<distance::quantized::QFormat> quantize) {
+      const MDTS train_mdts = materialized_train(data);
+      if (train_mdts.empty()) { throw std::invalid_argument("Model serialization: no train data"); }
+      LabelEncoder const& encoder = train_mdts.begin()->second.header().label_encoder();
+
+      // --- Header
+      BinWriter w(out);
+      write_header(w, model_version, trainclass_cardinality, encoder);
+
+      // --- Exemplars, per transform, in model order
+      w.write<uint64_t>(tw.exemplars.size());
+      std::vector<uint16_t> codes;
+      for (const auto& [tname, index_map] : tw.exemplars) {
+        DTS const& dts = train_mdts.at(tname);
+        std::vector<size_t> model_to_train(index_map.size());
+        for (const auto& [train_idx, model_idx] : index_map) { model_to_train[model_idx] = train_idx; }
+        w.write_string(tname);
+        w.write<uint64_t>(model_to_train.size());
+        for (size_t train_idx : model_to_train) {
+          TSeries const& ts = dts[train_idx];
+          const std::optional<EL> ol = dts.label(train_idx);
+          w.write<int64_t>(ol ? (int64_t)ol.value() : -1);
+          w.write<uint64_t>(ts.nb_dimensions());
+          w.write<uint64_t>(ts.length());
+          w.write<uint8_t>(ts.missing() ? 1 : 0);
+          // Column major data, aligned from the start of the model. Missing values can not be quantized.
+          if (quantize&&!ts.missing()) {
+            codes.resize(ts.size());
+            const auto qv = distance::quantized::quantize(ts.data(), ts.size(), quantize.value(), codes.data());
+            w.write<uint8_t>((uint8_t)quantize.value());
+            w.write<F>(qv.scale);
+            w.write<F>(qv.offset);
+            w.align();
+            w.write_bytes(codes.data(), codes.size()*sizeof(uint16_t));
+          } else {
+            w.write<uint8_t>(exemplar_raw);
+            w.align();
+            w.write_bytes(ts.data(), ts.size()*sizeof(F));
+          }
+        }
+      }
+
+      // --- Trees
+      w.write<uint64_t>(next_tree_index);
+      w.write<uint64_t>(nb_trees);
+      w.write_bytes(trees.data(), trees.size());
+    }
+
+  } // End of anonymous namespace
+
+  void Forest::save(std::ostream& out, TreeData const& data,
+                    std::optional<distance::quantized::QFormat> quantize) const {
+    // Write the trees in a buffer first, collecting the referenced exemplars
+    std::ostringstream tree_buffer;
+    BinWriter tw(tree_buffer);
+    for (const auto& tree : forest) { tree->save(tw); }
+    write_model(out, data, trainclass_cardinality, tw, tree_buffer.view(), forest.size(), next_tree_index, quantize);
+  }
+
+  void Forest::save(std::ostream& out, TreeData const& data, ExemplarStore const& store) const {
+    const MDTS train_mdts = materialized_train(data);
+    if (train_mdts.empty()) { throw std::invalid_argument("Model serialization: no train data"); }
+    LabelEncoder const& encoder = train_mdts.begin()->second.header().label_encoder();
+    for (const auto& [tname, dts] : *store.exemplars) {
+      if (dts.header().label_encoder().index_to_label()!=encoder.index_to_label()) {
+        throw std::invalid_argument("Model serialization: exemplar store with a different label encoding");
+      }
+    }
+    // Write the trees in a buffer first, referencing the exemplars by their index in the store
+    const ExemplarStore::Index index(store);
+    std::ostringstream tree_buffer;
+    BinWriter tw(tree_buffer);
+    tw.store_index = [&](std::string const& tname, size_t train_idx) {
+      DTS const& dts = train_mdts.at(tname);
+      std::optional<size_t> store_idx = index.find(tname, dts[train_idx], dts.original_label(train_idx));
+      if (!store_idx) {
+        throw std::invalid_argument("Model serialization: exemplar " + std::to_string(train_idx) + " of " + tname +
+                                    " not in the exemplar store");
+      }
+      return store_idx.value();
+    };
+    for (const auto& tree : forest) { tree->save(tw); }
+
+    BinWriter w(out);
+    write_header(w, model_version_store, trainclass_cardinality, encoder);
+    w.write<uint64_t>(store.fingerprint);
+    w.write<uint64_t>(next_tree_index);
+    w.write<uint64_t>(forest.size());
+    w.write_bytes(tree_buffer.view().data(), tree_buffer.view().size());
+  }
+
+  namespace {
+
+    /// Model read up to its trees: its train exemplars, registered in 'data', and the number of trees that follow
+    struct ModelHead {
+      size_t cardinality{0};
+      std::shared_ptr<MDTS> train_exemplars;
+      TreeData data;
+      size_t next_tree_index{0};
+      size_t nb_trees{0};
+    };
+
+    /// Load a model up to its trees. If 'r' reads from a mapping, the exemplars are views into it, kept alive by
+    /// 'mapping'. A model referencing an exemplar store uses the exemplars of 'store'.
+    ModelHead load_model_head(BinReader& r, utils::Capsule const& mapping, ExemplarStore const *store) {
+      // --- Header
+      r.expect(model_magic);
+      const auto version = r.read<uint32_t>();
+      if (version!=model_version&&version!=model_version_raw&&version!=model_version_store&&
+          version!=model_version_unindexed&&version!=model_version_store_unindexed) {
+        throw std::runtime_error("Model deserialization: unsupported version");
+      }
+      const bool with_store = version==model_version_store||version==model_version_store_unindexed;
+      const bool indexed = version==model_version||version==model_version_store;
+      if (r.read<uint8_t>()!=sizeof(F)) {
+        throw std::runtime_error("Model deserialization: model saved with a different floating point precision");
+      }
+      const size_t cardinality = r.read_size();
+      std::vector<L> index_to_label(r.read_size());
+      for (auto& l : index_to_label) { l = r.read_string(); }
+      // Rebuild the encoder one label at a time, preserving the encoding
+      LabelEncoder encoder;
+      for (const auto& l : index_to_label) { encoder = LabelEncoder(std::move(encoder), std::vector<L>{l}); }
+
+      // --- Exemplars
+      auto train_exemplars = std::make_shared<MDTS>();
+      auto quantized = std::make_shared<QuantizedExemplars>();
+      quantized->mapping = mapping;
+      // A model referencing an exemplar store has no exemplar section
+      if (with_store) {
+        if (store==nullptr) {
+          throw std::runtime_error("Model deserialization: the model requires its exemplar store");
+        }
+        if (r.read<uint64_t>()!=store->fingerprint) {
+          throw std::runtime_error("Model deserialization: the model references another exemplar store");
+        }
+        for (const auto& [tname, dts] : *store->exemplars) {
+          if (dts.header().label_encoder().index_to_label()!=index_to_label) {
+            throw std::runtime_error("Model deserialization: exemplar store with a different label encoding");
+          }
+        }
+        train_exemplars = store->exemplars;
+      }
+      const size_t nb_transforms = with_store ? 0 : r.read_size();
+      for (size_t t = 0; t<nb_transforms; ++t) {
+        std::string tname = r.read_string();
+        const size_t nb_exemplars = r.read_size();
+        // Exemplars in model order; the quantized ones are only created once all of them are read (see below)
+        std::vector<std::optional<TSeries>> slots(nb_exemplars);
+        std::vector<std::optional<L>> labels;
+        labels.reserve(nb_exemplars);
+        std::vector<size_t> instances_with_missing;
+        size_t minl = nb_exemplars==0 ? 0 : std::numeric_limits<size_t>::max();
+        size_t maxl = 0;
+        size_t nbdim = 1;
+        // Quantized exemplars, dequantized in one slab once all of them are read
+        struct Pending {
+          size_t index;
+          distance::quantized::QView<F> view;
+          size_t nbdim;
+          size_t length;
+          bool missing;
+        };
+        std::vector<Pending> pending;
+        size_t nb_quantized_values = 0;
+        for (size_t i = 0; i<nb_exemplars; ++i) {
+          const auto el = r.read<int64_t>();
+          if (el>=(int64_t)index_to_label.size()) { throw std::runtime_error("Model deserialization: invalid label"); }
+          std::optional<L> ol;
+          if (el>=0) { ol = index_to_label[el]; }
+          nbdim = r.read_size();
+          const size_t length = r.read_size();
+          const bool missing = r.read<uint8_t>()!=0;
+          const uint8_t encoding = version==model_version_raw ? exemplar_raw : r.read<uint8_t>();
+          if (encoding!=exemplar_raw) {
+            using distance::quantized::QFormat;
+            if (encoding!=(uint8_t)QFormat::INT16&&encoding!=(uint8_t)QFormat::FLOAT16) {
+              throw std::runtime_error("Model deserialization: invalid exemplar encoding");
+            }
+            distance::quantized::QView<F> qv{(QFormat)encoding, nullptr, nbdim*length, 0, 0};
+            qv.scale = r.read<F>();
+            qv.offset = r.read<F>();
+            r.align();
+            if (r.mapping!=nullptr) {
+              qv.codes = reinterpret_cast<uint16_t const *>(r.view(qv.length*sizeof(uint16_t)));
+            } else {
+              auto& codes = quantized->codes.emplace_back(qv.length);
+              r.read_bytes(codes.data(), codes.size()*sizeof(uint16_t));
+              qv.codes = codes.data();
+            }
+            pending.push_back({i, qv, nbdim, length, missing});
+            nb_quantized_values += qv.length;
+          } else if (r.mapping!=nullptr) {
+            r.align();
+            // View into the mapping: aligned for F as the mapping is page aligned
+            auto const *data = reinterpret_cast<F const *>(r.view(nbdim*length*sizeof(F)));
+            slots[i].emplace(TSeries::mk_view(mapping, data, nbdim, length, ol, missing));
+          } else {
+            r.align();
+            arma::Mat<F> m(nbdim, length);
+            r.read_bytes(m.memptr(), m.n_elem*sizeof(F));
+            slots[i].emplace(TSeries::mk_from_colmajor(std::move(m), ol, missing));
+          }
+          labels.push_back(std::move(ol));
+          if (missing) { instances_with_missing.push_back(i); }
+          minl = std::min(minl, length);
+          maxl = std::max(maxl, length);
+        }
+        // The dequantized exemplars are views in the slab: their data pointers are stable keys of their codes
+        if (!pending.empty()) {
+          const SeriesSlab slab(nb_quantized_values);
+          size_t offset = 0;
+          for (const Pending& p : pending) {
+            F *data = slab.data + offset;
+            distance::quantized::dequantize(p.view, data);
+            slots[p.index].emplace(
+              TSeries::mk_view(slab.capsule, data, p.nbdim, p.length, labels[p.index], {p.missing})
+            );
+            quantized->views.emplace(data, p.view);
+            offset += p.view.length;
+          }
+        }
+        std::vector<TSeries> series;
+        series.reserve(nb_exemplars);
+        for (auto& slot : slots) { series.push_back(std::move(slot.value())); }
+        auto header = std::make_shared<DatasetHeader>(
+          "model", minl, maxl, nbdim, std::move(labels), std::move(instances_with_missing), encoder
+        );
+        auto transform = std::make_shared<DatasetTransform<TSeries>>(header, tname, std::move(series));
+        train_exemplars->emplace(tname, DTS("train", transform));
+      }
+
+      ModelHead head;
+      head.cardinality = cardinality;
+      register_train(head.data, train_exemplars);
+      if (!quantized->views.empty()) { register_quantized(head.data, std::move(quantized)); }
+      head.train_exemplars = std::move(train_exemplars);
+      const size_t next_tree_index = indexed ? r.read_size() : 0;
+      head.nb_trees = r.read_size();
+      head.next_tree_index = indexed ? next_tree_index : head.nb_trees;
+      return head;
+    }
+
+    /// Load a model (see load_model_head)
+    Forest::Loaded load_model(BinReader& r, utils::Capsule const& mapping, ExemplarStore const *store) {
+      ModelHead head = load_model_head(r, mapping, store);
+      std::vector<Forest::TREE> trees;
+      trees.reserve(head.nb_trees);
+      for (size_t i = 0; i<head.nb_trees; ++i) { trees.push_back(TreeNode::load(r, head.data)); }
+      auto forest = std::make_shared<Forest>(std::move(trees), head.cardinality);
+      forest->next_tree_index = head.next_tree_index;
+      forest->compile(head.data);
+
+      return Forest::Loaded{
+        .forest = std::move(forest),
+        .train_exemplars = std::move(head.train_exemplars)
+      };
+    }
+
+  } // End of anonymous namespace
+
+  Forest::Loaded Forest::load(std::istream& in, ExemplarStore const *store) {
+    BinReader r(in);
+    return load_model(r, {}, store);
+  }
+
+  Forest::Loaded Forest::load_mapped(std::filesystem::path const& path, ExemplarStore const *store) {
+    auto file = std::make_shared<utils::MappedFile>(path);
+    MemoryBuf buffer(file->data(), file->size());
+    std::istream in(&buffer);
+    BinReader r(in, file->data(), file->size());
+    return load_model(r, utils::make_capsule<std::shared_ptr<utils::MappedFile>>(file), store);
+  }
+
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Progressive load
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  struct ProgressiveLoad::State {
+    std::shared_ptr<utils::MappedFile> file;
+    MemoryBuf buffer;
+    std::istream in;
+    BinReader reader;
+    ModelHead head;
+    size_t step;
+    /// Trees loaded so far, and their compiled form while all of them compile (see Forest::compile)
+    std::vector<Forest::TREE> trees;
+    std::vector<std::shared_ptr<const CompiledTree>> compiled;
+    bool compilable{true};
+    // --- Shared with the background thread
+    mutable std::mutex mtx;
+    mutable std::condition_variable cv;
+    std::shared_ptr<const Forest> published;
+    bool done{false};
+    std::exception_ptr error;
+    std::atomic<bool> stop{false};
+    std::thread loader;
+
+    explicit State(std::filesystem::path const& path, size_t step) :
+      file(std::make_shared<utils::MappedFile>(path)),
+      buffer(file->data(), file->size()),
+      in(&buffer),
+      reader(in, file->data(), file->size()),
+      step(step) {}
+
+    void load_tree() {
+      trees.push_back(TreeNode::load(reader, head.data));
+      if (compilable) {
+        std::optional<CompiledTree> ct = CompiledTree::compile(trees.back(), head.data);
+        if (ct) { compiled.push_back(std::make_shared<const CompiledTree>(std::move(ct.value()))); }
+        else {
+          compilable = false;
+          compiled.clear();
+        }
+      }
+    }
+
+    void publish() {
+      auto forest = std::make_shared<Forest>(std::vector<Forest::TREE>(trees), head.cardinality);
+      forest->next_tree_index = head.next_tree_index;
+      forest->compiled = compiled;
+      std::lock_guard lock(mtx);
+      published = std::move(forest);
+    }
+
+    void run() {
+      try {
+        while (trees.size()<head.nb_trees&&!stop.load(std::memory_order_relaxed)) {
+          load_tree();
+          if (trees.size()==head.nb_trees||(step>0&&trees.size()%step==0)) { publish(); }
+        }
+      } catch (...) {
+        std::lock_guard lock(mtx);
+        error = std::current_exception();
+      }
+      {
+        std::lock_guard lock(mtx);
+        done = true;
+      }
+      cv.notify_all();
+    }
+  };
+
+  ProgressiveLoad::ProgressiveLoad(std::filesystem::path const& path, ExemplarStore const *store,
+                                   size_t ready_trees, size_t step) :
+    state(std::make_unique<State>(path, step)) {
+    State& st = *state;
+    st.head = load_model_head(st.reader, utils::make_capsule<std::shared_ptr<utils::MappedFile>>(st.file), store);
+    st.trees.reserve(st.head.nb_trees);
+    const size_t first = std::min(std::max<size_t>(ready_trees, 1), st.head.nb_trees);
+    while (st.trees.size()<first) { st.load_tree(); }
+    st.publish();
+    if (st.trees.size()==st.head.nb_trees) { st.done = true; }
+    else { st.loader = std::thread([&st]() { st.run(); }); }
+  }
+
+  ProgressiveLoad::~ProgressiveLoad() {
+    state->stop.store(true, std::memory_order_relaxed);
+    if (state->loader.joinable()) { state->loader.join(); }
+  }
+
+  std::shared_ptr<const Forest> ProgressiveLoad::forest() const {
+    std::lock_guard lock(state->mtx);
+    return state->published;
+  }
+
+  std::shared_ptr<MDTS> const& ProgressiveLoad::train_exemplars() const { return state->head.train_exemplars; }
+
+  size_t ProgressiveLoad::nb_trees() const { return state->head.nb_trees; }
+
+  bool ProgressiveLoad::complete() const {
+    std::lock_guard lock(state->mtx);
+    return state->published->forest.size()==state->head.nb_trees;
+  }
+
+  void ProgressiveLoad::wait() const {
+    std::unique_lock lock(state->mtx);
+    state->cv.wait(lock, [this]() { return state->done; });
+    if (state->error) { std::rethrow_exception(state->error); }
+  }
+
+  std::exception_ptr ProgressiveLoad::error() const {
+    std::lock_guard lock(state->mtx);
+    return state->error;
+  }
+
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Checkpoints
+  // A header (magic, version, sizeof(F), key), then one record per tree: its size in bytes, then the tree index, the
+  // number of train exemplars reaching its root, its sample, per transform the train index of its exemplars in model
+  // order, and the tree itself (see TreeNode::save). A record is written in one go and flushed.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  namespace {
+    const std::string checkpoint_magic{"tempo::TSChief::Checkpoint"};
+    constexpr uint32_t checkpoint_version = 1;
+
+    /// A tree read from a checkpoint
+    struct CheckpointTree {
+      Forest::TREE tree;
+      size_t nb_train_exemplars;
+      std::vector<size_t> inbag;
+    };
+
+    /// Read the header of a checkpoint, returning its key
+    std::string read_checkpoint_header(BinReader& r) {
+      r.expect(checkpoint_magic);
+      if (r.read<uint32_t>()!=checkpoint_version) {
+        throw std::runtime_error("Checkpoint: unsupported version");
+      }
+      if (r.read<uint8_t>()!=sizeof(F)) {
+        throw std::runtime_error("Checkpoint: saved with a different floating point precision");
+      }
+      return r.read_string();
+    }
+
+    /// Tree index of a tree record, without loading the tree
+    size_t read_checkpoint_index(std::string const& record) {
+      std::istringstream in(record);
+      BinReader r(in);
+      return r.read_size(std::numeric_limits<uint64_t>::max());
+    }
+
+    /// Read a tree record. Its exemplars are loaded in a compact train data, then renumbered to 'data'.
+    std::pair<size_t, CheckpointTree> read_checkpoint_tree(std::string const& record, TreeData const& data) {
+      std::istringstream in(record);
+      BinReader r(in);
+      const size_t tree_index = r.read_size(std::numeric_limits<uint64_t>::max());
+      CheckpointTree ct;
+      ct.nb_train_exemplars = r.read_size(std::numeric_limits<uint64_t>::max());
+      for (uint64_t idx : r.read_vector<uint64_t>()) { ct.inbag.push_back((size_t)idx); }
+      ExemplarSources sources;
+      ExemplarTable table;
+      const size_t nb_transforms = r.read_size();
+      for (size_t t = 0; t<nb_transforms; ++t) {
+        std::string tname = r.read_string();
+        DTS const& dts = at_train(data, transform_id(data, tname));
+        auto& exemplars = sources[tname];
+        auto& index_map = table[tname];
+        for (uint64_t train_idx : r.read_vector<uint64_t>()) {
+          if (train_idx>=dts.size()) { throw std::runtime_error("Checkpoint: exemplar beyond the train data"); }
+          index_map.emplace(exemplars.size(), (size_t)train_idx);
+          exemplars.emplace_back(&dts, (size_t)train_idx);
+        }
+      }
+      TreeData compact_data;
+      register_train(compact_data, copy_exemplars(sources));
+      ct.tree = TreeNode::load(r, compact_data);
+      ct.tree->remap_exemplars(table, data);
+      return {tree_index, std::move(ct)};
+    }
+
+    /// Write a tree record
+    void write_checkpoint_tree(std::ostream& out, size_t tree_index, TreeNode const& tree,
+                               size_t nb_train_exemplars, std::vector<size_t> const& inbag) {
+      std::ostringstream tree_buffer;
+      BinWriter tw(tree_buffer);
+      tree.save(tw);
+      std::ostringstream record;
+      BinWriter w(record);
+      w.write<uint64_t>(tree_index);
+      w.write<uint64_t>(nb_train_exemplars);
+      w.write_vector(std::vector<uint64_t>(inbag.begin(), inbag.end()));
+      w.write<uint64_t>(tw.exemplars.size());
+      for (const auto& [tname, index_map] : tw.exemplars) {
+        std::vector<uint64_t> model_to_train(index_map.size());
+        for (const auto& [train_idx, model_idx] : index_map) { model_to_train[model_idx] = train_idx; }
+        w.write_string(tname);
+        w.write_vector(model_to_train);
+      }
+      const std::string tree_bytes = tree_buffer.str();
+      w.write_bytes(tree_bytes.data(), tree_bytes.size());
+      const std::string bytes = record.str();
+      BinWriter fw(out);
+      fw.write<uint64_t>(bytes.size());
+      fw.write_bytes(bytes.data(), bytes.size());
+      out.flush();
+      if (!out) { throw std::runtime_error("Checkpoint: write failed"); }
+    }
+
+    /** Open a checkpoint for appending, creating it if needed, and return the trees it holds by tree index.
+     *  A record cut by a crash ends the file: it is truncated after the last complete record.
+     *  Without 'load_trees', only the tree indexes are read: the trees are null.
+     */
+    std::map<size_t, CheckpointTree> open_checkpoint(Checkpoint const& checkpoint, TreeData const& data,
+                                                     std::ofstream& out, bool load_trees = true) {
+      std::map<size_t, CheckpointTree> trees;
+      size_t valid_size = 0;
+      if (std::filesystem::exists(checkpoint.path)&&std::filesystem::file_size(checkpoint.path)>0) {
+        std::ifstream in(checkpoint.path, std::ios::binary);
+        BinReader r(in);
+        if (read_checkpoint_header(r)!=checkpoint.key) {
+          throw std::runtime_error("Checkpoint " + checkpoint.path.string() + ": written by another training");
+        }
+        valid_size = r.position;
+        while (true) {
+          std::string record;
+          try {
+            record.resize(r.read_size(std::numeric_limits<uint64_t>::max()));
+            r.read_bytes(record.data(), record.size());
+          } catch (std::runtime_error const&) { break; }
+          if (load_trees) {
+            auto [tree_index, ct] = read_checkpoint_tree(record, data);
+            trees.insert_or_assign(tree_index, std::move(ct));
+          } else { trees.insert_or_assign(read_checkpoint_index(record), CheckpointTree{}); }
+          valid_size = r.position;
+        }
+        in.close();
+        std::filesystem::resize_file(checkpoint.path, valid_size);
+      }
+      out.open(checkpoint.path, std::ios::binary|std::ios::app);
+      if (!out) { throw std::runtime_error("Checkpoint: cannot open " + checkpoint.path.string()); }
+      if (valid_size==0) {
+        BinWriter w(out);
+        w.write_string(checkpoint_magic);
+        w.write<uint32_t>(checkpoint_version);
+        w.write<uint8_t>(sizeof(F));
+        w.write_string(checkpoint.key);
+        out.flush();
+      }
+      return trees;
+    }
+  }
+
+  std::optional<std::string> read_checkpoint_key(std::filesystem::path const& path) {
+    if (!std::filesystem::exists(path)||std::filesystem::file_size(path)==0) { return {}; }
+    std::ifstream in(path, std::ios::binary);
+    BinReader r(in);
+    return read_checkpoint_header(r);
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  std::vector<Forest::TREE> ForestTrainer::train_trees(
     TreeState& state,
     TreeData const& data,
     ByClassMap const& bcm,
     size_t nb_threads,
     std::optional<double> opt_sampling,
-    std::ostream *out
+    std::ostream *out,
+    std::optional<Checkpoint> const& spill_to,
+    std::vector<std::vector<size_t>>& inbag,
+    std::vector<uint8_t>& completed
   ) const {
 
     // --- Fork states
-    std::vector<std::unique_ptr<TreeState>> local_states = state.forest_fork_vec(nb_trees);
+    std::vector<std::unique_ptr<TreeState>> local_states = state.forest_fork_vec(nb_trees, first_tree_index);
 
     // --- Multithreaded task
     // Note: each state/result slot is pre-allocated; Mutex still required for output
     std::vector<Forest::TREE> result(nb_trees);
+    inbag.assign(opt_sampling ? nb_trees : 0, {});
+    completed.assign(nb_trees, false);
     std::mutex mutex;
 
+    // --- Checkpoint: the trees it holds are not trained again. When spilling, they stay in the file.
+    std::optional<Checkpoint> const& records = spill_to ? spill_to : checkpoint;
+    const bool spill = spill_to.has_value();
+    std::ofstream checkpoint_out;
+    std::map<size_t, CheckpointTree> checkpointed;
+    if (records) {
+      checkpointed = open_checkpoint(records.value(), data, checkpoint_out, !spill);
+      size_t nb_loaded = 0;
+      for (auto& [index, ct] : checkpointed) {
+        if (index<first_tree_index||index - first_tree_index>=nb_trees) { continue; }
+        const size_t tree_index = index - first_tree_index;
+        completed[tree_index] = true;
+        local_states[tree_index]->count(TrainingProgress::TREES);
+        ++nb_loaded;
+        if (spill) { continue; }
+        ct.tree->stats->nb_train_exemplars = ct.nb_train_exemplars;
+        if (opt_sampling) { inbag[tree_index] = std::move(ct.inbag); }
+        result[tree_index] = std::move(ct.tree);
+      }
+      if (out!=nullptr&&checkpoint) { *out << "Checkpoint: " << nb_loaded << " trees loaded" << std::endl; }
+    }
+
+    // --- Time budget: the mean time of the trees trained so far estimates the time of the next ones
+    const auto train_start = tempo::utils::now();
+    utils::duration_t trees_time{};
+    size_t nb_timed = 0;
+
     auto test_task = [&](size_t tree_index) {
+      if (time_budget) {
+        std::lock_guard lock(mutex);
+        if (nb_timed>0&&tempo::utils::now() - train_start + trees_time/(long)nb_timed>time_budget.value()) { return; }
+      }
       if (out!=nullptr) {
         std::lock_guard lock(mutex);
         *out << "Start tree " << tree_index << std::endl;
       }
       //
+      const utils::TraceScope trace("tree", "train", "tree", (int64_t)tree_index);
       auto start = tempo::utils::now();
       ByClassMap const* my_bcm = &bcm;
       ByClassMap local_bcm;
       if(opt_sampling.has_value()){
-        local_bcm = bcm.stratified_sampling(opt_sampling.value(), local_states[tree_index]->prng);
+        local_bcm = bcm.stratified_sampling(opt_sampling.value(), local_states[tree_index]->prng,
+                                            sampling_max_per_class);
         my_bcm = &local_bcm;
+        inbag[tree_index] = inbag_indexes(local_bcm);
       }
 
-      Forest::TREE tree = tree_trainer->train(*local_states[tree_index], data, *my_bcm);
+      // The root node draws from the stream of the tree, as in train_levelwise
+      local_states[tree_index]->enter_stream(local_states[tree_index]->stream);
+      // A sample is given to the tree, released as soon as its root is split
+      const size_t nb_train_exemplars = my_bcm->size();
+      Forest::TREE tree = opt_sampling ? tree_trainer->train(*local_states[tree_index], data, std::move(local_bcm))
+                                       : tree_trainer->train(*local_states[tree_index], data, bcm);
+      tree->stats->nb_train_exemplars = nb_train_exemplars;
       auto delta = tempo::utils::now() - start;
+      local_states[tree_index]->count(TrainingProgress::TREES);
+      if (time_budget) {
+        std::lock_guard lock(mutex);
+        trees_time += delta;
+        ++nb_timed;
+      }
 
       //
       if (out!=nullptr) {
@@ -76,28 +1311,289 @@ namespace tempo::classifier::TSChief {
         // --- Printing
         auto& cout = *out;
         auto cf = cout.fill();
-        const auto [nbleaf, nbnode] = tree->nb_nodes();
+        TreeStats const& ts = *tree->stats;
         cout << std::setfill('0');
         cout << std::setw(3) << tree_index + 1 << " / " << nb_trees << "   ";
-        cout << std::setw(3) << "Depth = " << tree->depth() << "   ";
-        cout << std::setw(3) << "Nb nodes = " << nbnode << "   ";
-        cout << std::setw(3) << "Nb leaves = " << nbleaf << "   ";
+        cout << std::setw(3) << "Depth = " << ts.depth << "   ";
+        cout << std::setw(3) << "Nb nodes = " << ts.nb_nodes << "   ";
+        cout << std::setw(3) << "Nb leaves = " << ts.nb_leaves << "   ";
         cout.fill(cf);
         cout << " timing: " << tempo::utils::as_string(delta) << std::endl;
       }
+      if (records) {
+        std::lock_guard lock(mutex);
+        write_checkpoint_tree(checkpoint_out, first_tree_index + tree_index, *tree, tree->stats->nb_train_exemplars,
+                              opt_sampling ? inbag[tree_index] : std::vector<size_t>{});
+      }
       //
-      result[tree_index] = std::move(tree);
+      completed[tree_index] = true;
+      if (spill) {
+        // Dropped with its sample, both in the spill file
+        if (opt_sampling) { std::vector<size_t>().swap(inbag[tree_index]); }
+      } else { result[tree_index] = std::move(tree); }
     };
 
     tempo::utils::ParTasks p;
-    for (size_t i = 0; i<nb_trees; ++i) { p.push_task_args(test_task, i); }
+    for (size_t i = 0; i<nb_trees; ++i) { if (!completed[i]) { p.push_task_args(test_task, i); }}
     p.execute(nb_threads);
 
+    // --- Merge states
+    state.forest_merge_in_vec(std::move(local_states));
+    return result;
+  }
+
+  std::shared_ptr<Forest> ForestTrainer::train(
+    TreeState& state,
+    TreeData const& data,
+    ByClassMap const& bcm,
+    size_t nb_threads,
+    std::optional<double> opt_sampling,
+    std::ostream *out
+  ) const {
+    std::vector<std::vector<size_t>> inbag;
+    std::vector<uint8_t> completed;
+    std::vector<Forest::TREE> result = train_trees(state, data, bcm, nb_threads, opt_sampling, out, {}, inbag,
+                                                   completed);
+
+    // --- Keep the trees completed within the time budget
+    if (time_budget) {
+      size_t nb_completed = 0;
+      for (size_t i = 0; i<nb_trees; ++i) {
+        if (!completed[i]) { continue; }
+        result[nb_completed] = std::move(result[i]);
+        if (opt_sampling) { inbag[nb_completed] = std::move(inbag[i]); }
+        ++nb_completed;
+      }
+      result.resize(nb_completed);
+      if (opt_sampling) { inbag.resize(nb_completed); }
+      if (out!=nullptr) { *out << "Time budget: " << nb_completed << " / " << nb_trees << " trees" << std::endl; }
+    }
+
+    // Build result & return
+    auto forest = std::make_shared<Forest>(std::move(result), train_header.nb_classes());
+    forest->next_tree_index = first_tree_index + nb_trees;
+    forest->inbag = std::move(inbag);
+    if (prune) {
+      const size_t nb_pruned = forest->prune();
+      if (out!=nullptr) { *out << "Pruned " << nb_pruned << " nodes" << std::endl; }
+    }
+    forest->compile(data);
+    return forest;
+  }
+
+  size_t ForestTrainer::train_streaming(
+    TreeState& state,
+    TreeData const& data,
+    ByClassMap const& bcm,
+    size_t nb_threads,
+    std::filesystem::path const& model_path,
+    std::optional<double> opt_sampling,
+    std::optional<distance::quantized::QFormat> quantize,
+    std::ostream *out
+  ) const {
+    // --- Spill file: the checkpoint if any, else a fresh file next to the model
+    Checkpoint spill_to;
+    if (checkpoint) { spill_to = checkpoint.value(); }
+    else {
+      spill_to.path = model_path;
+      spill_to.path += ".spill";
+      spill_to.key = "spill";
+      std::filesystem::remove(spill_to.path);
+    }
+    std::vector<std::vector<size_t>> inbag;
+    std::vector<uint8_t> completed;
+    train_trees(state, data, bcm, nb_threads, opt_sampling, out, spill_to, inbag, completed);
+
+    // --- Write the trees of the model one at a time, in tree index order, from their last record in the spill file
+    std::map<size_t, std::pair<size_t, size_t>> records;
+    {
+      std::ifstream in(spill_to.path, std::ios::binary);
+      BinReader r(in);
+      read_checkpoint_header(r);
+      while (true) {
+        std::string record;
+        try {
+          record.resize(r.read_size(std::numeric_limits<uint64_t>::max()));
+          const size_t position = r.position;
+          r.read_bytes(record.data(), record.size());
+          records.insert_or_assign(read_checkpoint_index(record), std::pair{position, record.size()});
+        } catch (std::runtime_error const&) { break; }
+      }
+    }
+    std::ifstream in(spill_to.path, std::ios::binary);
+    std::ostringstream tree_buffer;
+    BinWriter tw(tree_buffer);
+    size_t nb_written = 0;
+    size_t nb_pruned = 0;
+    for (size_t i = 0; i<nb_trees; ++i) {
+      if (!completed[i]) { continue; }
+      const auto [position, size] = records.at(first_tree_index + i);
+      std::string record(size, '\0');
+      in.seekg((std::streamoff)position);
+      if (!in.read(record.data(), (std::streamsize)size)) {
+        throw std::runtime_error("Streaming training: cannot read back " + spill_to.path.string());
+      }
+      Forest::TREE tree = read_checkpoint_tree(record, data).second.tree;
+      if (prune) { nb_pruned += tree->prune(); }
+      tree->save(tw);
+      ++nb_written;
+    }
+    in.close();
+    if (out!=nullptr) {
+      if (prune) { *out << "Pruned " << nb_pruned << " nodes" << std::endl; }
+      if (time_budget) { *out << "Time budget: " << nb_written << " / " << nb_trees << " trees" << std::endl; }
+    }
+    std::ofstream model_out(model_path, std::ios::binary);
+    if (!model_out) { throw std::runtime_error("Streaming training: cannot open " + model_path.string()); }
+    write_model(model_out, data, train_header.nb_classes(), tw, tree_buffer.view(), nb_written,
+                first_tree_index + nb_trees, quantize);
+    model_out.close();
+    if (!model_out) { throw std::runtime_error("Streaming training: cannot write " + model_path.string()); }
+    if (!checkpoint) { std::filesystem::remove(spill_to.path); }
+    return nb_written;
+  }
+
+  std::shared_ptr<Forest> ForestTrainer::train_levelwise(
+    TreeState& state,
+    TreeData const& data,
+    ByClassMap const& bcm,
+    size_t nb_threads,
+    std::optional<double> opt_sampling,
+    std::ostream *out
+  ) const {
+
+    // An open node of the current level: its result is written in 'slot' (the root of a tree, or a branch of its
+    // parent), with its own state. 'branch_idx' is the branch index in its parent (none for a root).
+    struct Open {
+      size_t tree_index;
+      std::optional<size_t> branch_idx;
+      ByClassMap bcm;
+      std::unique_ptr<TreeState> state;
+      Forest::TREE *slot;
+      // Generation results
+      typename i_GenLeaf::Result leaf{};
+      i_GenNode::Result node{};
+    };
+
+    // --- Fork states
+    std::vector<std::unique_ptr<TreeState>> local_states = state.forest_fork_vec(nb_trees, first_tree_index);
+
+    // --- Open the roots
+    std::vector<Forest::TREE> result(nb_trees);
+    std::vector<std::vector<size_t>> inbag(opt_sampling ? nb_trees : 0);
+    std::vector<Open> level;
+    for (size_t tree_index = 0; tree_index<nb_trees; ++tree_index) {
+      TreeState& tstate = *local_states[tree_index];
+      ByClassMap root_bcm = bcm;
+      if (opt_sampling) {
+        root_bcm = bcm.stratified_sampling(opt_sampling.value(), tstate.prng, sampling_max_per_class);
+        inbag[tree_index] = inbag_indexes(root_bcm);
+      }
+      std::unique_ptr<TreeState> root_state = tstate.node_fork(tstate.stream);
+      level.push_back(Open{tree_index, {}, std::move(root_bcm), std::move(root_state), &result[tree_index]});
+    }
+
+    // Number of open nodes per tree: a tree is done when it has none
+    std::vector<size_t> nb_open(nb_trees, 1);
+
+    // Statistics per tree, counted as the nodes are built: the nodes are built top down, before their branches
+    std::vector<TreeStats> tree_stats(nb_trees);
+    for (size_t tree_index = 0; tree_index<nb_trees; ++tree_index) {
+      tree_stats[tree_index].nb_train_exemplars = level[tree_index].bcm.size();
+    }
+
+    // --- Level loop
+    auto start = tempo::utils::now();
+    size_t depth = 0;
+    while (!level.empty()) {
+      ++depth;
+      if (out!=nullptr) { *out << "Level " << depth << ": " << level.size() << " node(s)" << std::endl; }
+
+      // Generate all the nodes of the level, larger first.
+      // Note: each node has its own state and result slot - no shared memory, no need for sync
+      std::vector<size_t> order(level.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return level[a].bcm.size()>level[b].bcm.size();
+      });
+      auto generate_task = [&](size_t i) {
+        Open& o = level[order[i]];
+        assert(o.bcm.nb_classes()>0);
+        const utils::TraceScope trace("node", "train", "size", (int64_t)o.bcm.size());
+        o.leaf = tree_trainer->leaf_generator->generate(*o.state, data, o.bcm);
+        if (!o.leaf) {
+          o.node = tree_trainer->node_generator->generate(*o.state, data, o.bcm);
+          o.leaf = tree_trainer->leaf_generator->generate_after_split(*o.state, data, o.bcm, o.node.branch_splits);
+        }
+        // Not held until the end of the level: the branches get their own split
+        o.state->end_node();
+        o.bcm = ByClassMap();
+      };
+      tempo::utils::ParTasks().execute((int)nb_threads, generate_task, 0, level.size());
+
+      // Build the nodes and open their branches, in level order
+      std::vector<Open> next;
+      for (Open& o : level) {
+        TreeStats& ts = tree_stats[o.tree_index];
+        ts.depth = std::max(ts.depth, depth);
+        if (o.leaf) {
+          *o.slot = TreeNode::make_leaf(std::move(o.leaf.value()));
+          ++ts.nb_leaves;
+        } else {
+          const size_t nb_branches = o.node.branch_splits.size();
+          ts.add_node(*o.node.splitter);
+          *o.slot = TreeNode::make_node(std::move(o.node.splitter), std::vector<TreeNode::BRANCH>(nb_branches));
+          std::vector<TreeNode::BRANCH>& branches = (*o.slot)->as_node.branches;
+          nb_open[o.tree_index] += nb_branches;
+          for (size_t idx = 0; idx<nb_branches; ++idx) {
+            std::unique_ptr<TreeState> bstate = o.state->branch_fork(idx);
+            next.push_back(Open{o.tree_index, idx, std::move(o.node.branch_splits[idx]), std::move(bstate),
+                                &branches[idx]});
+          }
+        }
+        // Counted in tree_stats: the statistics of the node would only be its own
+        (*o.slot)->stats.reset();
+        // The node is done: merge its state in the state of its tree
+        TreeState& tstate = *local_states[o.tree_index];
+        tstate.count(TrainingProgress::NODES);
+        if (o.branch_idx) { tstate.branch_merge_in(o.branch_idx.value(), std::move(o.state)); }
+        else { tstate.forest_merge_in(std::move(o.state)); }
+        if (--nb_open[o.tree_index]==0) { tstate.count(TrainingProgress::TREES); }
+      }
+      level = std::move(next);
+    }
+    for (size_t tree_index = 0; tree_index<nb_trees; ++tree_index) {
+      result[tree_index]->stats = std::make_unique<TreeStats>(std::move(tree_stats[tree_index]));
+    }
+
+    if (out!=nullptr) {
+      auto& cout = *out;
+      auto cf = cout.fill();
+      cout << std::setfill('0');
+      for (size_t tree_index = 0; tree_index<nb_trees; ++tree_index) {
+        TreeStats const& ts = *result[tree_index]->stats;
+        cout << std::setw(3) << tree_index + 1 << " / " << nb_trees << "   ";
+        cout << std::setw(3) << "Depth = " << ts.depth << "   ";
+        cout << std::setw(3) << "Nb nodes = " << ts.nb_nodes << "   ";
+        cout << std::setw(3) << "Nb leaves = " << ts.nb_leaves << std::endl;
+      }
+      cout.fill(cf);
+      cout << "Forest timing: " << tempo::utils::as_string(tempo::utils::now() - start) << std::endl;
+    }
+
     // --- Merge states
     state.forest_merge_in_vec(std::move(local_states));
 
     // Build result & return
-    return std::make_shared<Forest>(std::move(result), train_header.nb_classes());
+    auto forest = std::make_shared<Forest>(std::move(result), train_header.nb_classes());
+    forest->next_tree_index = first_tree_index + nb_trees;
+    forest->inbag = std::move(inbag);
+    if (prune) {
+      const size_t nb_pruned = forest->prune();
+      if (out!=nullptr) { *out << "Pruned " << nb_pruned << " nodes" << std::endl; }
+    }
+    forest->compile(data);
+    return forest;
   }
 
 } // End of tempo::classifier::PF2
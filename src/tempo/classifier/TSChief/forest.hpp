@@ -1,13 +1,25 @@
 #pragma once
 
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <istream>
 #include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
 #include <vector>
 #include <ostream>
 
 #include "tempo/classifier/utils.hpp"
+#include "tempo/utils/utils/spinpool.hpp"
+#include "exemplar_store.hpp"
+#include "serialize.hpp"
 #include "treedata.hpp"
 #include "treestate.hpp"
 #include "tree.hpp"
+#include "compiled_tree.hpp"
+#include "combiner.hpp"
 
 namespace tempo::classifier::TSChief {
 
@@ -29,6 +41,26 @@ namespace tempo::classifier::TSChief {
     /// Number of train class for which this forest has been trained
     size_t trainclass_cardinality{};
 
+    /// Index of the stream of the next tree trained for this forest (see ForestTrainer::first_tree_index): past the
+    /// streams of all the trees trained for it, including the ones it dropped (time budget, ProximityForest2::grow).
+    /// Saved with the model; the number of trees for the models saved without it.
+    size_t next_tree_index{};
+
+    /// How the results of the trees are combined by the predictions (see Combiner); not saved with the model
+    Combiner combiner{Combiner::WEIGHTED_AVERAGE};
+
+    /// Push the exemplars of a chunk through each tree together, level by level (tree-major order, see
+    /// CompiledTree::predict_leaves and TreeNode::route_batch) instead of one exemplar at a time.
+    /// Not saved with the model.
+    bool tree_major{false};
+
+    /// Compiled form of the trees used for inference, empty if the forest is not compiled (see compile)
+    std::vector<std::shared_ptr<const CompiledTree>> compiled{};
+
+    /// Per tree, sorted train indexes the tree was trained on, when trained on a sample (see ForestTrainer::train);
+    /// empty otherwise. Used for the out-of-bag predictions (see predict_oob); not saved with the model.
+    std::vector<std::vector<size_t>> inbag{};
+
 
     // --- --- --- Constructors/Destructors
 
@@ -44,10 +76,27 @@ namespace tempo::classifier::TSChief {
 
     //
     Forest(std::vector<TREE>&& forest, size_t trainclass_cardinality) :
-      forest(std::move(forest)), trainclass_cardinality(trainclass_cardinality) {}
+      forest(std::move(forest)), trainclass_cardinality(trainclass_cardinality),
+      next_tree_index(this->forest.size()) {}
 
     // --- --- --- Methods
 
+    /** Compile the trees for inference (see CompiledTree). Done by ForestTrainer::train and Forest::load.
+     *  If a tree cannot be compiled, the forest is left uncompiled and predicts with the trees directly.
+     * @param data  Data the forest was trained on (or loaded with): only the train data is used
+     */
+    void compile(TreeData const& data);
+
+    /// Memory held by the trees (see TreeNode::memory), without their compiled form
+    TreeMemory memory() const;
+
+    /// Statistics of the trees (see TreeNode::stats): counts summed over the trees, maximal depth
+    TreeStats stats() const;
+
+    /// Prune the trees (see TreeNode::prune), without changing the predictions. Drop the compiled form of the trees:
+    /// compile again. Return the number of internal nodes removed.
+    size_t prune();
+
     /** Given a testing state and testing data, do a prediction for one exemplar at 'index'
      *  Returns the prediction per tree - we do so as assembling this prediction can be done in different ways.
      * @param state
@@ -58,6 +107,293 @@ namespace tempo::classifier::TSChief {
      */
     std::vector<classifier::Result1> predict(TreeState& state, TreeData const& data, size_t test_index,
                                              size_t nb_threads) const;
+
+    /** Given a testing state and testing data, do a prediction for all the exemplars in 'test_is'.
+     *  States are forked once for the whole batch. The exemplars are processed by chunks of 'chunk_size':
+     *  within a chunk, each tree predicts all the exemplars with its own state, then the per-tree results are
+     *  combined (see combiner; by default, arithmetic average weighted by the leaves' weight) in place in the row of
+     *  each exemplar, in tree order, keeping the result deterministic.
+     * @param state
+     * @param data
+     * @param test_is       Indexes of the test exemplars. Row i of the result corresponds to test_is[i]
+     * @param nb_threads
+     * @param chunk_size    Number of exemplars per chunk (bound the number of per-tree results kept in memory)
+     * @param out           Print progress (per chunk) on 'out' if not nullptr
+     * @return ResultN for all exemplars in test_is
+     */
+    classifier::ResultN predict_batch(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                      size_t nb_threads, size_t chunk_size = 256, std::ostream* out = nullptr) const;
+
+    /** Low latency prediction of a few test exemplars (e.g. one series per request) by the workers of 'pool'.
+     *  The trees are partitioned in contiguous ranges, one per worker, always the same for a given pool size: a
+     *  worker keeps predicting the same trees, whose nodes and exemplars stay in its caches. Each worker combines
+     *  its trees in its own rows (see combine_add), summed in worker order once the job is done: no synchronisation
+     *  between the workers. The result is the one of predict_batch, up to the rounding of the sums.
+     * @param test_is       Indexes of the test exemplars. Row i of the result corresponds to test_is[i]
+     */
+    classifier::ResultN predict_latency(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                        utils::SpinPool& pool) const;
+
+    /** Out-of-bag prediction of train exemplars: each exemplar is predicted by the trees not trained on it (see
+     *  inbag), merged as in predict_batch. Rows of exemplars used by all the trees have a weight of 0.
+     *  Always tree-major (see tree_major): the out-of-bag exemplars of a tree are routed together, sharing the
+     *  gathering of the exemplars of each node.
+     *  The train data must also be registered as the test data (see register_test).
+     *  Throws std::logic_error if the forest was not trained on samples.
+     * @param state
+     * @param data
+     * @param train_is      Indexes of the train exemplars. Row i of the result corresponds to train_is[i]
+     * @param nb_threads
+     * @return ResultN for all exemplars in train_is
+     */
+    classifier::ResultN predict_oob(TreeState& state, TreeData const& data, IndexSet const& train_is,
+                                    size_t nb_threads) const;
+
+    /** Prediction by the prefixes of the forest, in one pass: the result k is the one predict_batch would give with
+     *  a forest of the first 'prefix_sizes[k]' trees, e.g. to choose a number of trees from one training.
+     *  The results of the prefixes are copied from the rows of the exemplars as the trees are accumulated in them,
+     *  in tree order, and finished as predict_batch does (see combine_finish).
+     *  Throws std::invalid_argument if the sizes are not non decreasing in [1, number of trees].
+     * @param test_is       Indexes of the test exemplars. Row i of a result corresponds to test_is[i]
+     * @param prefix_sizes  Numbers of trees of the prefixes, non decreasing
+     * @param chunk_size    Number of exemplars per chunk (see predict_batch)
+     * @return One ResultN per prefix, in the order of 'prefix_sizes'
+     */
+    std::vector<classifier::ResultN> predict_prefixes(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                                      size_t nb_threads, std::vector<size_t> const& prefix_sizes,
+                                                      size_t chunk_size = 256, std::ostream* out = nullptr) const;
+
+    // --- --- --- Anytime prediction
+
+    /// Stopping rule of predict_anytime
+    struct Anytime {
+      /// Number of trees evaluated per round: the stopping rule is checked between the rounds.
+      /// Trees of a round are evaluated concurrently: use at least as many trees as threads.
+      size_t batch_size{8};
+      /// If set, also stop once the probability of the leading class reaches this value.
+      /// Else, only stop once the remaining trees cannot change the leading class, i.e. the prediction.
+      std::optional<double> confidence{};
+    };
+
+    /// Result of predict_anytime
+    struct AnytimeResult {
+      classifier::ResultN result;
+      /// Number of trees evaluated per exemplar (per row of the result)
+      std::vector<size_t> nb_trees;
+
+      double average_nb_trees() const {
+        if (nb_trees.empty()) { return 0; }
+        return (double)std::accumulate(nb_trees.begin(), nb_trees.end(), size_t{0})/(double)nb_trees.size();
+      }
+    };
+
+    /** Anytime prediction: as predict_batch, but the trees are evaluated by rounds, and an exemplar stops being
+     *  evaluated once its leading class cannot be overturned by the remaining trees: the lead over the second class
+     *  (in weighted votes, before averaging) exceeds the sum of the maximal leaf weight of remaining trees
+     *  (see TreeNode::max_leaf_weight; one vote per tree with Combiner::MAJORITY_VOTE). The predicted class is then
+     *  the one of predict_batch, with the same tie breaking, but the probabilities are combined over the evaluated
+     *  trees only. With a 'confidence' threshold, the predicted class may differ from predict_batch.
+     *  With Combiner::LOG_PROB_SUM, the lead is not bounded: all the trees are evaluated.
+     * @param state
+     * @param data
+     * @param test_is       Indexes of the test exemplars. Row i of the result corresponds to test_is[i]
+     * @param nb_threads
+     * @param anytime       Stopping rule
+     * @param chunk_size    Number of exemplars per chunk (see predict_batch)
+     * @param out           Print progress (per chunk) on 'out' if not nullptr
+     * @return ResultN for all exemplars in test_is, with the number of trees evaluated per exemplar
+     */
+    AnytimeResult predict_anytime(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                  size_t nb_threads, Anytime const& anytime, size_t chunk_size = 256,
+                                  std::ostream* out = nullptr) const;
+
+    // --- --- --- Leaves and proximities
+
+    /// Leaves reached by a batch of test exemplars in each tree (see predict_leaf_ids)
+    struct LeafIDs {
+      size_t nb_rows{0};
+      size_t nb_trees{0};
+      /// Row major [nb_rows][nb_trees]: leaf ID (see TreeNode::leaf_order) reached by the exemplar of the row
+      std::vector<uint32_t> ids;
+
+      uint32_t at(size_t row, size_t tree) const { return ids[row*nb_trees + tree]; }
+    };
+
+    /** Leaf ID reached by each test exemplar in each tree. Each tree routes all the exemplars together (tree-major
+     *  order, see TreeNode::route_batch and CompiledTree::predict_leaves), the trees on 'nb_threads' with their own
+     *  state. Leaf IDs are the same whether the forest is compiled or not.
+     * @param test_is       Indexes of the test exemplars. Row i of the result corresponds to test_is[i]
+     */
+    LeafIDs predict_leaf_ids(TreeState& state, TreeData const& data, IndexSet const& test_is, size_t nb_threads) const;
+
+    /// Sparse matrix in compressed sparse row form
+    struct SparseProximities {
+      size_t nb_rows{0};
+      size_t nb_cols{0};
+      /// Entries of the row r: positions [row_offsets[r], row_offsets[r+1][ of 'columns' and 'values', by column
+      std::vector<size_t> row_offsets;
+      std::vector<uint32_t> columns;
+      std::vector<double> values;
+    };
+
+    /** Forest proximities between two batches given by their leaf IDs (see predict_leaf_ids): the entry (i, j) is
+     *  the fraction of the trees in which the row i of 'a' and the row j of 'b' reach the same leaf. Pairs never in
+     *  the same leaf are not stored. Costs the number of (row, row, tree) leaf matches, the rows of 'a' on
+     *  'nb_threads'. Throws std::invalid_argument if 'a' and 'b' do not have the same number of trees.
+     */
+    static SparseProximities proximities(LeafIDs const& a, LeafIDs const& b, size_t nb_threads = 1);
+
+  private:
+
+    /// Results of the prefixes of predict_prefixes
+    struct Prefixes {
+      std::vector<size_t> sizes;
+      std::vector<classifier::ResultN> results;
+    };
+
+    /// Implementation of predict_batch, predict_oob, predict_anytime (all the trees in one round if no 'anytime') and
+    /// predict_prefixes (with 'prefixes', whose results are allocated)
+    AnytimeResult predict_chunks(TreeState& state, TreeData const& data, IndexSet const& test_is,
+                                 size_t nb_threads, size_t chunk_size, std::ostream* out, bool oob,
+                                 Anytime const* anytime, Prefixes* prefixes = nullptr) const;
+
+  public:
+
+    // --- --- --- Compaction
+
+    /// Layout of the compact train exemplars (see compact)
+    enum class ExemplarLayout {
+      /// Each exemplar once, whatever the number of splitters referencing it
+      shared,
+      /// Each node its own copy of its exemplars, in evaluation order, in a block aligned on SeriesSlab::alignment:
+      /// a node visit streams one block instead of gathering exemplars scattered in the train data. Exemplars
+      /// referenced by several nodes are duplicated: the compact data is larger.
+      per_node
+    };
+
+    /** Compact the train exemplars: collect the exemplars referenced by the splitters of all the trees, copy them in a
+     *  compact train data following 'layout', and renumber the splitters to it. The forest then only needs the compact
+     *  data: register it as the train data (see register_train) instead of the full train data, which can be
+     *  released. The predictions are unchanged.
+     *  The forest is compiled again (see compile).
+     * @param data    Data the forest was trained on: only the train data is used
+     * @param layout  Layout of the exemplars: each one once by default
+     * @return The compact train data, per transform, with the train label encoding. The exemplars of a transform
+     *         are stored in one slab (see SeriesSlab).
+     */
+    std::shared_ptr<MDTS> compact(TreeData const& data, ExemplarLayout layout = ExemplarLayout::shared);
+
+    // --- --- --- Serialization
+
+    /// Result of Forest::load and Forest::merge
+    struct Loaded {
+      /// The loaded forest
+      std::shared_ptr<Forest> forest;
+      /// The train exemplars referenced by the forest, per transform. Must be registered as the train data
+      /// (see register_train) before predicting with the forest.
+      std::shared_ptr<MDTS> train_exemplars;
+    };
+
+    /** Merge forests trained on different train data in one forest, e.g. to grow a forest with trees trained on
+     *  updated data (see ProximityForest2::grow). The trees of the parts are gathered in part order; the train
+     *  exemplars referenced by each part are copied from its own train data in one compact train data, as with
+     *  compact. The trees are renumbered in place: a part must not be used with its own data afterward.
+     *  The merged forest is compiled; the sampling information (inbag) is not kept. Its next tree index is the
+     *  largest one of the parts.
+     *  Throws std::invalid_argument if the parts disagree on the classes or their encoding.
+     * @param parts Each forest with the data it was trained (or loaded) with: only the train data is used
+     * @return The merged forest and its train exemplars
+     */
+    static Loaded merge(std::vector<std::pair<Forest const *, TreeData const *>> const& parts);
+
+    /** Write the forest in a binary model format: the class encoding, the train exemplars referenced by the
+     *  splitters (only those, renumbered), followed by the trees.
+     *  The format is meant to be read back on the same kind of machine (native byte order),
+     *  by a build using the same floating point type (see TEMPO_FLOAT32).
+     *  With 'quantize', the exemplars are stored as 16 bits codes with a per series scale (see distance::quantized),
+     *  except the ones with missing values: the model is about 4 times smaller in double precision, at the cost of
+     *  the quantization error. Loading such a model dequantizes the exemplars, the DTW and ADTW distances computing
+     *  on the codes (see QuantizedExemplars).
+     * @param out       Output stream, opened in binary mode
+     * @param data      Data the forest was trained on: only the train data is used
+     * @param quantize  Format of the quantized exemplars; store them as they are by default
+     */
+    void save(std::ostream& out, TreeData const& data,
+              std::optional<distance::quantized::QFormat> quantize = {}) const;
+
+    /** Write the forest in the binary model format, referencing its train exemplars by their index in 'store'
+     *  instead of storing them: the model can only be loaded with the same store (see load_mapped).
+     *  The exemplars are found in the store by label and values, whatever their train index.
+     *  Throws std::invalid_argument if the store has a different label encoding, or lacks an exemplar.
+     */
+    void save(std::ostream& out, TreeData const& data, ExemplarStore const& store) const;
+
+    /** Load a forest written by save.
+     *  Throws std::runtime_error on invalid input.
+     * @param in    Input stream, opened in binary mode
+     * @param store Exemplar store of a model referencing one (see save); ignored by the other models
+     * @return The forest and its train exemplars. The exemplars' headers carry the train label encoding.
+     */
+    static Loaded load(std::istream& in, ExemplarStore const *store = nullptr);
+
+    /** Load a forest written by save in a file, memory mapping the file.
+     *  The train exemplars are views into the mapping: their data is neither read nor copied and pages are shared
+     *  between the processes loading the same model. The mapping lives as long as any of the exemplars.
+     *  A model referencing an exemplar store uses the exemplars of 'store', shared with the other models loaded
+     *  with it.
+     *  Throws std::runtime_error on invalid input, or if the model references another store.
+     * @param path  Path to the model file
+     * @param store Exemplar store of a model referencing one (see save); ignored by the other models
+     * @return The forest and its train exemplars. The exemplars' headers carry the train label encoding.
+     */
+    static Loaded load_mapped(std::filesystem::path const& path, ExemplarStore const *store = nullptr);
+  };
+
+  /** Progressive load of a model file written by Forest::save, for a scorer to serve before a large forest is
+   *  resident. The constructor returns once the train exemplars and the first 'ready_trees' trees are loaded; the
+   *  other trees are loaded by a background thread, which publishes a forest of the trees loaded so far every 'step'
+   *  trees (a prefix of the forest, as predicted by Forest::predict_prefixes), and the whole forest at the end: the
+   *  forest load_mapped gives. The published forests share the trees and the train exemplars: a forest taken with
+   *  'forest' remains valid after the next publication. The file is memory mapped as with load_mapped.
+   */
+  class ProgressiveLoad : private utils::Uncopyable {
+  public:
+
+    /** Load the exemplars and the first trees of the model 'path' (see Forest::load_mapped), and start the background
+     *  load of the remaining trees, if any.
+     *  Throws std::runtime_error on invalid input up to the first trees; the errors of the background load are
+     *  reported by 'wait'.
+     * @param path          Path to the model file
+     * @param store         Exemplar store of a model referencing one (see Forest::save)
+     * @param ready_trees   Number of trees loaded before returning (at least 1)
+     * @param step          Number of trees loaded between two publications; 0 to only publish the whole forest
+     */
+    ProgressiveLoad(std::filesystem::path const& path, ExemplarStore const *store, size_t ready_trees, size_t step);
+
+    /// Stop the background load, if still running
+    ~ProgressiveLoad();
+
+    /// Last published forest
+    std::shared_ptr<const Forest> forest() const;
+
+    /// The train exemplars referenced by the forest (see Forest::Loaded)
+    std::shared_ptr<MDTS> const& train_exemplars() const;
+
+    /// Number of trees of the model
+    size_t nb_trees() const;
+
+    /// True once the whole forest is published
+    bool complete() const;
+
+    /// Wait for the end of the background load; rethrow its error, if any
+    void wait() const;
+
+    /// Error of the background load, null if none (so far); the last published forest then stays a prefix
+    std::exception_ptr error() const;
+
+  private:
+    struct State;
+    std::unique_ptr<State> state;
   };
 
 
@@ -65,6 +401,21 @@ namespace tempo::classifier::TSChief {
   // Training a Forest
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
+  /** Checkpoint of a training (see ForestTrainer::checkpoint): a file to which each tree is appended as soon as it is
+   *  trained, with the train exemplars it references (by train index) and its sample. A training resumed from it
+   *  loads the trees it holds instead of training them again: the trees of a forest do not depend on each other
+   *  (see TreeState), so the forest is the one of an uninterrupted training. A tree cut by a crash is dropped.
+   */
+  struct Checkpoint {
+    /// File of the checkpoint, created if it does not exist
+    std::filesystem::path path;
+    /// Identify the training: e.g. its seed, configuration and train data. A file with another key is rejected.
+    std::string key;
+  };
+
+  /// Key of the checkpoint file 'path' (see Checkpoint::key), or nothing if the file does not exist or is empty
+  std::optional<std::string> read_checkpoint_key(std::filesystem::path const& path);
+
   struct ForestTrainer {
 
     // --- --- --- Type/Shorthand
@@ -79,6 +430,25 @@ namespace tempo::classifier::TSChief {
     /// Number of trees to train
     size_t nb_trees;
 
+    /// When training on samples (see train), cap on the number of exemplars drawn per class for each tree
+    std::optional<size_t> sampling_max_per_class{};
+
+    /// Index of the first tree, giving the random streams of the trees (see TreeState): trees grown to be added to
+    /// an existing forest (see Forest::merge) get streams of their own.
+    size_t first_tree_index{0};
+
+    /// Prune the trained trees before compiling them (see Forest::prune)
+    bool prune{true};
+
+    /// Checkpoint of train (not train_levelwise, whose trees all complete at the end); none by default
+    std::optional<Checkpoint> checkpoint{};
+
+    /// Wall clock budget of train (not train_levelwise): 'nb_trees' is then a maximum. A tree is only started if,
+    /// at the mean time of the trees trained so far, it completes within the budget (the trees started before the
+    /// first one completes are always trained). The forest holds the trees completed, in tree index order: their
+    /// number depends on the machine and its load. No budget by default.
+    std::optional<utils::duration_t> time_budget{};
+
     // --- --- --- Constructors/Destructors
 
     ForestTrainer(
@@ -93,13 +463,60 @@ namespace tempo::classifier::TSChief {
 
     // --- --- ---- Methods
 
-    /// Training a forest by training each tree individually
+    /// Training a forest by training each tree individually.
+    /// With 'opt_sampling', each tree is trained on a stratified sample of 'bcm' (see ByClassMap::stratified_sampling
+    /// and sampling_max_per_class), recorded in Forest::inbag.
+    /// With a checkpoint, the trees it holds are loaded instead of being trained, and the others are appended to it.
     std::shared_ptr<Forest> train(TreeState& state, TreeData const& data, ByClassMap const& bcm,
                                   size_t nb_threads,
                                   std::optional<double> opt_sampling = std::nullopt,
                                   std::ostream* out=nullptr
                                   ) const;
 
+    /** Streaming training: as train, but each tree is appended to a spill file as soon as it is trained, then
+     *  dropped, so that the training only holds the trees in training (one per thread) instead of the forest.
+     *  The model (see Forest::save) is then written to 'model_path' from the spill file, one tree at a time (pruned
+     *  if 'prune'), in tree index order. The spill file is the checkpoint if any, kept to resume or grow the
+     *  training; else, 'model_path' with the extension ".spill", removed once the model is written.
+     *  Load the model to use the forest (see Forest::load_mapped). The samples (Forest::inbag) are not kept.
+     *  Throws std::runtime_error if the spill file or the model can not be written.
+     * @return Number of trees of the model
+     */
+    size_t train_streaming(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                           size_t nb_threads,
+                           std::filesystem::path const& model_path,
+                           std::optional<double> opt_sampling = std::nullopt,
+                           std::optional<distance::quantized::QFormat> quantize = {},
+                           std::ostream* out=nullptr
+                           ) const;
+
+    /** Training a forest level by level: all the open nodes of a depth, across all the trees, are generated in one
+     *  parallel batch (larger nodes first), before their branches are opened for the next depth.
+     *  This balances the work when the trees have very different sizes, and keeps all the threads busy until the
+     *  last level. Each node is generated with its own state, forked from its parent's state on the stream of its
+     *  branch (see TreeState::branch_fork): the forest is the one of 'train', whatever the number of threads.
+     *  Uses the leaf and node generators of the tree trainer; its own threading options are not used.
+     *  Samples as train.
+     */
+    std::shared_ptr<Forest> train_levelwise(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                            size_t nb_threads,
+                                            std::optional<double> opt_sampling = std::nullopt,
+                                            std::ostream* out=nullptr
+                                            ) const;
+
+  private:
+
+    /// Train the trees of train and train_streaming, flagged in 'completed' (the samples in 'inbag').
+    /// With 'spill_to', instead of the checkpoint, the trees are only appended to it: the returned trees are null.
+    std::vector<Forest::TREE> train_trees(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                          size_t nb_threads,
+                                          std::optional<double> opt_sampling,
+                                          std::ostream* out,
+                                          std::optional<Checkpoint> const& spill_to,
+                                          std::vector<std::vector<size_t>>& inbag,
+                                          std::vector<uint8_t>& completed
+                                          ) const;
+
   };
 
 } // End of tempo::classifier::PF2
@@ -0,0 +1,89 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "pfsplitters.hpp"
+
+#include <tempo/classifier/TSChief/snode/nn1splitter/nn1_dtw.hpp>
+
+#include <mock/mockseries.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Micro benchmarks of the generation of the distance candidates of a node (see pf::splitters::make_node_splitter).
+// A candidate is generated through the std::function getters of its generator, into a heap allocated i_Dist, then
+// searches the nearest exemplars of the series of the node. Compare, per candidate:
+//  - generate: the generator built from the compiled DistanceSpec, as in make_node_splitter
+//  - flat:     the same draws read directly from the DistanceSpec tables, into a DTW on the stack (no getter call,
+//              no allocation): the cost a per candidate sampler over the flat specification would have
+//  - search:   the nearest neighbour search of one candidate over a node (one exemplar per class), without the lower
+//              bounds, i.e. less than a candidate does in the trees
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+using namespace tempo;
+namespace tsc = tempo::classifier::TSChief;
+namespace tsc_nn1 = tempo::classifier::TSChief::snode::nn1splitter;
+
+namespace {
+
+  constexpr size_t nbclasses = 3;
+  const std::vector<size_t> lengths{64, 256};
+  const std::vector<size_t> node_sizes{64, 256};
+
+  /// Random univariate series of fixed length, same series for a given length and size
+  std::vector<TSeries> make_node(size_t length, size_t size) {
+    mock::Mocker<F> mocker(0);
+    mocker._fixl = length;
+    std::vector<TSeries> series;
+    for (size_t i = 0; i<size; ++i) { series.push_back(TSeries::mk_from_rowmajor(mocker.randvec(), 1, {}, false)); }
+    return series;
+  }
+
+}
+
+TEST_CASE("Benchmark distance candidates", "[bench][pfsplitters][dtw]") {
+  const std::vector<pf::splitters::DistanceSpec> specs =
+    pf::splitters::compile_distances({"pf2"}, {0.5, 1.0, 2.0}, {"default", "derivative1"}, false);
+  pf::splitters::DistanceSpec const& spec = specs.at(1);
+  REQUIRE(spec.kind==pf::splitters::DistanceKind::DTW);
+  const tsc::TreeData data;
+  const ByClassMap bcm;
+
+  for (size_t length : lengths) {
+    const std::string plength = " length=" + std::to_string(length);
+
+    tsc_nn1::DTWGen gen(pf::splitters::make_get_transform(spec.transforms),
+                        pf::splitters::make_get_vcfe(spec.exponents),
+                        pf::splitters::make_get_window(length));
+    tsc::TreeState state(0, 0);
+    BENCHMARK("dtw generate" + plength) { return gen.generate(state, data, bcm)->cost(length); };
+
+    // Same draws as the getters of make_node_splitter
+    const size_t win_top = std::floor(((double)length + 1)/4.0);
+    BENCHMARK("dtw flat" + plength) {
+      std::string tn = utils::pick_one(spec.transforms, state.prng);
+      const F e = utils::pick_one(spec.exponents, state.prng);
+      const size_t w = std::uniform_int_distribution<size_t>(0, win_top)(state.prng);
+      const tsc_nn1::DTW dtw(std::move(tn), e, w);
+      return dtw.cost(length);
+    };
+
+    for (size_t size : node_sizes) {
+      const std::vector<TSeries> node = make_node(length, size);
+      tsc_nn1::DTW dtw("default", 2, length/10);
+      BENCHMARK("dtw search" + plength + " node=" + std::to_string(size)) {
+        F r = 0;
+        for (TSeries const& query : node) {
+          F bsf = utils::PINF;
+          for (size_t k = 0; k<nbclasses; ++k) { bsf = std::min(bsf, dtw.eval(node[k], query, bsf)); }
+          r += bsf;
+        }
+        return r;
+      };
+    }
+  }
+}
@@ -1,11 +1,16 @@
+#include <cmath>
 #include <exception>
+#include <fstream>
 
 #include "pfsplitters.hpp"
+#include "tempo/classifier/TSChief/exemplar_store.hpp"
 
 #include "tempo/classifier/TSChief/tree.hpp"
 #include "tempo/classifier/TSChief/forest.hpp"
+#include "tempo/classifier/TSChief/sleaf/bounded_leaf.hpp"
 #include "tempo/classifier/TSChief/sleaf/pure_leaf.hpp"
 #include "tempo/classifier/TSChief/sleaf/pure_leaf_smoothp.hpp"
+#include "tempo/classifier/TSChief/snode/boss/boss.hpp"
 #include "tempo/classifier/TSChief/snode/meta/chooser.hpp"
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1splitter.hpp"
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1_directa.hpp"
@@ -15,12 +20,15 @@
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1_wdtw.hpp"
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1_erp.hpp"
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1_lcss.hpp"
+#include "tempo/classifier/TSChief/snode/nn1splitter/nn1_softdtw.hpp"
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1_msm.hpp"
+#include "tempo/classifier/TSChief/snode/nn1splitter/nn1_sbd.hpp"
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1_twe.hpp"
+#include "tempo/classifier/TSChief/snode/rise/rise.hpp"
 
 namespace pf::splitters {
 
-    using F = double;
+    using F = tempo::F;
     namespace tsc = tempo::classifier::TSChief;
     namespace tsc_nn1 = tempo::classifier::TSChief::snode::nn1splitter;
 
@@ -95,20 +103,18 @@ namespace pf::splitters {
 
     // --- --- --- ERP Gap Value *AND* LCSS epsilon.
 
-    tsc_nn1::StatGetter make_get_frac_stddev() {
+    tsc_nn1::StatGetter make_get_frac_stddev(std::shared_ptr<tsc::i_GetState<tsc_nn1::GenSplitterNN1_State>> get_state) {
         return [=](tsc::TreeState &s, tsc::TreeData const &data, tempo::ByClassMap const &bcm,
                    std::string const &tr_name) {
-            const tempo::DTS &train_dataset = tempo::classifier::TSChief::at_train(data).at(tr_name);
-            auto stddev_ = stddev(train_dataset, bcm.to_IndexSet());
+            auto stddev_ = get_state->at(s).get_stddev(data, bcm, tr_name);
             return std::uniform_real_distribution<F>(stddev_ / 5.0, stddev_)(s.prng);
         };
     }
 
-    tsc_nn1::StatGetter make_get_frac_stddev_0_stddev() {
+    tsc_nn1::StatGetter make_get_frac_stddev_0_stddev(std::shared_ptr<tsc::i_GetState<tsc_nn1::GenSplitterNN1_State>> get_state) {
         return [=](tsc::TreeState &s, tsc::TreeData const &data, tempo::ByClassMap const &bcm,
                    std::string const &tr_name) {
-            const tempo::DTS &train_dataset = tempo::classifier::TSChief::at_train(data).at(tr_name);
-            auto stddev_ = stddev(train_dataset, bcm.to_IndexSet());
+            auto stddev_ = get_state->at(s).get_stddev(data, bcm, tr_name);
             return std::uniform_real_distribution<F>(stddev_ / 5.0, stddev_)(s.prng);
         };
     }
@@ -152,6 +158,204 @@ namespace pf::splitters {
     }
 
 
+    // --- --- --- Soft-DTW smoothing parameter
+
+    tsc_nn1::T_GetterState<F> make_get_softdtw_gamma() {
+        return [](tsc::TreeState &state) {
+            constexpr size_t N = 10;
+            constexpr F gammas[N]{0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5};
+            return tempo::utils::pick_one(gammas, N, state.prng);
+        };
+    }
+
+    // --- --- --- Coarse to fine DTW
+
+    CoarseDTW coarse_dtw_option(std::set<std::string> const &distances) {
+        const std::string prefix = "dtwpaa";
+        CoarseDTW result;
+        for (std::string const &token: distances) {
+            if (!token.starts_with(prefix)) { continue; }
+            if (result.factor != 0) { throw std::invalid_argument("Repeated coarse to fine DTW option " + token); }
+            const std::string spec = token.substr(prefix.size());
+            const size_t at = spec.find('@');
+            const std::string factor = spec.substr(0, at);
+            try {
+                size_t pos = 0;
+                result.factor = factor.empty() ? 0 : std::stoul(factor, &pos);
+                if (pos != factor.size()) { result.factor = 0; }
+                if (at != std::string::npos) {
+                    const std::string tol = spec.substr(at + 1);
+                    result.tolerance = std::stod(tol, &pos);
+                    if (pos != tol.size()) { result.tolerance = 0; }
+                }
+            } catch (std::exception const &) { result.factor = 0; }
+            if (result.factor < 2 || !(result.tolerance > 0) || std::isinf(result.tolerance)) {
+                throw std::invalid_argument("Malformed coarse to fine DTW option " + token +
+                                            " (expects dtwpaa<f> or dtwpaa<f>@<tol>, with f>=2 and tol>0)");
+            }
+        }
+        return result;
+    }
+
+    // --- --- --- ADTW penalties
+
+    std::map<std::tuple<F, std::string>, std::vector<F>> make_adtw_penalties(
+            std::vector<F> const &exponents,
+            std::vector<std::string> const &transforms,
+            tsc::TreeData const &train_data,
+            tempo::PRNG &prng,
+            size_t nb_threads,
+            std::optional<std::filesystem::path> const &path
+    ) {
+        constexpr size_t SAMPLE_SIZE = 4000;
+        constexpr size_t NUMBER_PENALTY = 100;
+        // A single draw of 'prng' seeds the sampling, whether the penalties are sampled or loaded: the draws following
+        // do not depend on the file
+        const uint64_t sampling_seed = prng();
+        // All the transforms have the size of the train data: read it from an eager one, not computing a lazy one
+        tsc::MDTS const &eager = tsc::at_train(train_data);
+        const size_t nb_train = eager.empty() ? 0 : eager.begin()->second.size();
+
+        // Key of the sampling: the train data (its eager transforms, from which the others derive), the transforms
+        // and exponents, the seed and the parameters of the sampling
+        nlohmann::json key;
+        key["train"] = tsc::ExemplarStore::fingerprint_of(eager);
+        key["nb_train"] = nb_train;
+        key["transforms"] = transforms;
+        key["exponents"] = exponents;
+        key["seed"] = sampling_seed;
+        key["sample_size"] = SAMPLE_SIZE;
+        key["number_penalty"] = NUMBER_PENALTY;
+        key["omega_exponent"] = tsc_nn1::ADTWGen::omega_exponent;
+
+        // --- Try to load
+        if (path && std::filesystem::exists(path.value())) {
+            std::ifstream in(path.value());
+            const nlohmann::json j = nlohmann::json::parse(in, nullptr, false);
+            try {
+                if (!j.is_discarded() && j.at("key") == key) {
+                    auto penalties = tsc_nn1::ADTWGen::penalties_from_json(j.at("penalties"));
+                    bool complete = true;
+                    for (auto const &tn: transforms) {
+                        for (auto const &e: exponents) { complete = complete && penalties.contains({e, tn}); }
+                    }
+                    if (complete) { return penalties; }
+                }
+            } catch (nlohmann::json::exception const &) {
+                // Not a penalty file: sample again
+            }
+        }
+
+        // --- Sample
+        tsc::MDTS sampled;
+        for (auto const &tn: transforms) {
+            sampled.emplace(tn, tsc::at_train(train_data, tsc::transform_id(train_data, tn)));
+        }
+        tempo::PRNG sampling_prng(sampling_seed);
+        auto penalties = tsc_nn1::ADTWGen::do_sampling(exponents, transforms, sampled, SAMPLE_SIZE, sampling_prng,
+                                                       NUMBER_PENALTY, tsc_nn1::ADTWGen::omega_exponent, nb_threads);
+
+        // --- Save
+        if (path) {
+            nlohmann::json j;
+            j["key"] = key;
+            j["penalties"] = tsc_nn1::ADTWGen::penalties_to_json(penalties);
+            std::ofstream out(path.value());
+            if (!out) { throw std::runtime_error("Cannot open ADTW penalties file " + path.value().string()); }
+            out << j.dump(2) << std::endl;
+        }
+
+        return penalties;
+    }
+
+    // --- --- --- Compiled configuration
+
+    std::string to_string(DistanceKind kind) {
+        switch (kind) {
+            case DistanceKind::DA: return "DA";
+            case DistanceKind::ADTW: return "ADTW";
+            case DistanceKind::DTW: return "DTW";
+            case DistanceKind::DTWFull: return "DTWFull";
+            case DistanceKind::WDTW: return "WDTW";
+            case DistanceKind::ERP: return "ERP";
+            case DistanceKind::LCSS: return "LCSS";
+            case DistanceKind::MSM: return "MSM";
+            case DistanceKind::TWE: return "TWE";
+            case DistanceKind::SoftDTW: return "SoftDTW";
+            case DistanceKind::SBD: return "SBD";
+        }
+        tempo::utils::should_not_happen();
+    }
+
+    std::vector<DistanceSpec> compile_distances(
+            std::set<std::string> const &distances,
+            std::vector<F> const &exponents,
+            std::vector<std::string> const &transforms,
+            bool multivariate
+    ) {
+        using enum DistanceKind;
+        if (distances.empty()) { throw std::invalid_argument("Empty set of distances"); }
+        const auto check_univariate_only = [multivariate](std::string const &sname) {
+            if (multivariate) {
+                throw std::invalid_argument("Distance " + sname + " only supports univariate series");
+            }
+        };
+
+        std::vector<DistanceSpec> specs;
+        if (*distances.begin() == "pf2018") {
+            // --- --- --- PF2018: cost function exponent 2, default and first derivative
+            check_univariate_only("pf2018");
+            const std::vector<std::string> def{"default"};
+            const std::vector<std::string> dr1{"derivative1"};
+            const std::vector<F> cfe2{2.0};
+            specs = {
+                    {DA, def, cfe2},
+                    {DTW, def, cfe2}, {DTW, dr1, cfe2},
+                    {DTWFull, def, cfe2}, {DTWFull, dr1, cfe2},
+                    {WDTW, def, cfe2}, {WDTW, dr1, cfe2},
+                    {ERP, def, cfe2},
+                    {LCSS, def, cfe2},
+                    {MSM, def, cfe2},
+                    {TWE, def, cfe2}
+            };
+        } else if (distances.contains("pf2")) {
+            // --- --- --- PF2.0
+            specs = {
+                    {ADTW, transforms, exponents},
+                    {DTW, transforms, exponents, distances.contains("dtwproba")},
+                    {LCSS, transforms, exponents}
+            };
+        } else {
+            // --- --- --- Any other combination, by name
+            for (std::string const &sname: distances) {
+                std::optional<DistanceKind> kind;
+                if (sname.starts_with("DA")) { kind = DA; }
+                else if (sname.starts_with("ADTW")) { kind = ADTW; }
+                else if (sname.starts_with("DTW") && !sname.starts_with("DTWFull")) { kind = DTW; }
+                else if (sname.starts_with("WDTW")) { kind = WDTW; }
+                else if (sname.starts_with("DTWFull")) { kind = DTWFull; }
+                else if (sname.starts_with("ERP")) { kind = ERP; }
+                else if (sname.starts_with("LCSS")) { kind = LCSS; }
+                else if (sname.starts_with("MSM")) { kind = MSM; }
+                else if (sname.starts_with("TWE")) { kind = TWE; }
+                else if (sname.starts_with("SoftDTW")) { kind = SoftDTW; }
+                else if (sname.starts_with("SBD")) { kind = SBD; }
+                if (!kind) { continue; }
+                switch (kind.value()) {
+                    case WDTW:
+                    case ERP:
+                    case MSM:
+                    case TWE:
+                    case SoftDTW:
+                    case SBD: check_univariate_only(sname); break;
+                    default: break;
+                }
+                specs.push_back({kind.value(), transforms, kind==ERP ? std::vector<F>{2.0} : exponents});
+            }
+        }
+        return specs;
+    }
+
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
     // Splitters
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -166,145 +370,138 @@ namespace pf::splitters {
         return std::make_shared<tsc::sleaf::GenLeaf_PureSmoothP>(train_header);
     }
 
+    std::shared_ptr<tsc::i_GenLeaf> make_bounded_leaf(tempo::DatasetHeader const &train_header,
+                                                      std::optional<size_t> max_depth, size_t min_size,
+                                                      double min_gain) {
+        std::shared_ptr<tsc::i_GenLeaf> pure = make_pure_leaf(train_header);
+        if (!max_depth && min_size == 0 && !(min_gain > 0)) { return pure; }
+        auto bounded = std::make_shared<tsc::sleaf::GenLeaf_Bounded>(std::move(pure), train_header);
+        if (max_depth) { bounded->max_depth = max_depth.value(); }
+        bounded->min_size = min_size;
+        bounded->min_gain = min_gain;
+        return bounded;
+    }
+
     std::shared_ptr<tsc::i_GenNode> make_node_splitter(
             std::vector<F> const &exponents,
             std::vector<std::string> const &transforms,
             std::set<std::string> const &distances,
             size_t nbc,
             size_t series_max_length,
-            std::map<std::string, tempo::DTS> const &train_data,
-            tsc::TreeState &tstate
+            tsc::TreeData const &train_data,
+            tsc::TreeState &tstate,
+            size_t nb_threads,
+            size_t fork_min_size,
+            size_t wdtw_nb_tables,
+            std::optional<std::filesystem::path> const &adtw_penalties_path,
+            size_t sampling_threads,
+            size_t batch_min_size,
+            size_t node_sample_min_size,
+            double node_sample_ratio,
+            size_t max_fanout,
+            double cost_budget,
+            std::shared_ptr<tsc::snode::meta::AdaptiveSampler> const &adaptive,
+            size_t chunk_min_size
     ) {
 
         // --- --- --- State
-        // 1NN distance splitters - cache the indexset
+        // 1NN distance splitters - cache the indexset and the stddev. Composed at compile time (see StaticStates):
+        // its callbacks run at every node of every tree.
         using GS1NNState = tsc_nn1::GenSplitterNN1_State;
-        std::shared_ptr<tsc::i_GetState<GS1NNState>> get_GenSplitterNN1_State =
-                tstate.register_state<GS1NNState>(std::make_unique<GS1NNState>());
+        auto get_GenSplitterNN1_State = std::get<0>(tstate.register_static(GS1NNState()));
 
         // --- --- --- Getters
 
-        // --- --- --- Build distance generators
-
-        // List of distance generators (this is specific to our collection of NN1 Splitter generators)
-        std::vector<std::shared_ptr<tsc_nn1::i_GenDist>> gendist;
-
-        if (distances.empty()) { throw std::invalid_argument("Empty set of distances"); }
-
-        // --- --- --- PF2018
-        if (*distances.begin() == "pf2018") {
-
-            auto getter_cfe_2 = make_get_cfe2();
-            auto getter_tr_def = make_get_default();
-            auto getter_tr_dr1 = make_get_derivative(1);
-            auto getter_window = make_get_window(series_max_length);
-            auto frac_stddev = make_get_frac_stddev();
-            auto getter_msm_cost = make_get_msm_cost();
-            auto getter_twe_nu = make_get_twe_nu();
-            auto getter_twe_lambda = make_get_twe_lambda();
-
-            // default ED
-            gendist.push_back(make_shared<tsc_nn1::DAGen>(getter_tr_def, getter_cfe_2));
-
-            // default DTW
-            gendist.push_back(make_shared<tsc_nn1::DTWGen>(getter_tr_def, getter_cfe_2, getter_window));
-            // derivative 1 DTW
-            gendist.push_back(make_shared<tsc_nn1::DTWGen>(getter_tr_dr1, getter_cfe_2, getter_window));
-
-            // default DTWFull
-            gendist.push_back(make_shared<tsc_nn1::DTWFullGen>(getter_tr_def, getter_cfe_2));
-            // derivative 1 DTWFull
-            gendist.push_back(make_shared<tsc_nn1::DTWFullGen>(getter_tr_dr1, getter_cfe_2));
-
-            // default WDTW
-            gendist.push_back(make_shared<tsc_nn1::WDTWGen>(getter_tr_def, getter_cfe_2, series_max_length));
-            // derivative 1 WDTW
-            gendist.push_back(make_shared<tsc_nn1::WDTWGen>(getter_tr_dr1, getter_cfe_2, series_max_length));
-
-            // ERP
-            gendist.push_back(make_shared<tsc_nn1::ERPGen>(getter_tr_def, getter_cfe_2, frac_stddev, getter_window));
-
-            // LCSS
-            gendist.push_back(make_shared<tsc_nn1::LCSSGen>(getter_tr_def, frac_stddev, getter_window));
-
-            // MSM
-            gendist.push_back(make_shared<tsc_nn1::MSMGen>(getter_tr_def, getter_msm_cost));
+        // WDTW weights, shared by all the WDTW generators
+        std::shared_ptr<tsc_nn1::WDTWTables const> wdtw_tables;
+        if (wdtw_nb_tables > 0 && (distances.contains("pf2018") ||
+                                   std::any_of(distances.begin(), distances.end(),
+                                               [](std::string const &s) { return s.starts_with("WDTW"); }))) {
+            wdtw_tables = std::make_shared<tsc_nn1::WDTWTables const>(wdtw_nb_tables, series_max_length);
+        }
 
-            // TWE
-            gendist.push_back(make_shared<tsc_nn1::TWEGen>(getter_tr_def, getter_twe_nu, getter_twe_lambda));
-        } else if (distances.contains("pf2")) {
-            // --- --- --- PF2.0
-            auto getter_cfe_set = make_get_vcfe(exponents);
-            auto getter_tr_set = make_get_transform(transforms);
-            auto getter_window = make_get_window(series_max_length);
-            auto frac_stddev = make_get_frac_stddev();
-
-            // ADTW
-            // Sample train data
-            constexpr size_t SAMPLE_SIZE = 4000;
-            auto samples = tsc_nn1::ADTWGen::do_sampling(exponents, transforms, train_data, SAMPLE_SIZE, tstate.prng);
-            // Create distance
-            gendist.push_back(make_shared<tsc_nn1::ADTWGen>(getter_tr_set, getter_cfe_set, samples));
-
-            // DTW
-            if (distances.contains("dtwproba")) {
-                // Proba way
-                auto getter_window_proba = make_proba_window(series_max_length);
-                gendist.push_back(make_shared<tsc_nn1::DTWGen>(getter_tr_set, getter_cfe_set, getter_window_proba));
-            } else {
-                // Classic way
-                gendist.push_back(make_shared<tsc_nn1::DTWGen>(getter_tr_set, getter_cfe_set, getter_window));
+        // ADTW penalties, sampled (or loaded) once and shared by all the ADTW generators
+        std::optional<std::map<std::tuple<F, std::string>, std::vector<F>>> adtw_penalties;
+        const auto get_adtw_penalties = [&]() -> auto const & {
+            if (!adtw_penalties) {
+                const size_t nbt = sampling_threads == 0 ? nb_threads : sampling_threads;
+                adtw_penalties = make_adtw_penalties(exponents, transforms, train_data, tstate.prng, nbt,
+                                                     adtw_penalties_path);
             }
+            return adtw_penalties.value();
+        };
 
-            // LCSS
-            gendist.push_back(make_shared<tsc_nn1::LCSSGen>(getter_tr_set, frac_stddev, getter_window));
+        // Coarse to fine DTW, for all the DTW generators
+        const CoarseDTW coarse_dtw = coarse_dtw_option(distances);
 
-        } else {
-            // --- --- --- Any other combination with cost function 2
-            auto getter_cfe_set = make_get_vcfe(exponents);
-            auto getter_cfe_2 = make_get_cfe2();
-            auto getter_tr_set = make_get_transform(transforms);
-            auto getter_window = make_get_window(series_max_length);
-            auto frac_stddev = make_get_frac_stddev();
-            auto getter_msm_cost = make_get_msm_cost();
-            auto getter_twe_nu = make_get_twe_nu();
-            auto getter_twe_lambda = make_get_twe_lambda();
+        // --- --- --- Build distance generators
 
-            for (std::string const &sname: distances) {
+        // Multivariate data: only DA, DTW, DTWFull, ADTW and LCSS have a (dependent) multivariate version
+        tsc::MDTS const &eager = tsc::at_train(train_data);
+        const bool multivariate = !eager.empty() && eager.begin()->second.header().nb_dimensions()>1;
+        const std::vector<DistanceSpec> specs = compile_distances(distances, exponents, transforms, multivariate);
 
-                if (sname.starts_with("DA")) {
-                    // --- --- --- Direct Alignment
-                    gendist.push_back(make_shared<tsc_nn1::DAGen>(getter_tr_set, getter_cfe_set));
-                } else if (sname.starts_with("ADTW")) {
-                    // --- --- --- ADTW
-                    // Sample train data
-                    constexpr size_t SAMPLE_SIZE = 4000;
-                    auto samples = tsc_nn1::ADTWGen::do_sampling(exponents, transforms, train_data, SAMPLE_SIZE,
-                                                                 tstate.prng);
-                    // Create distance
-                    gendist.push_back(make_shared<tsc_nn1::ADTWGen>(getter_tr_set, getter_cfe_set, samples));
-                } else if (sname.starts_with("DTW") && !sname.starts_with("DTWFull")) {
-                    // --- --- --- DTW
-                    gendist.push_back(make_shared<tsc_nn1::DTWGen>(getter_tr_set, getter_cfe_set, getter_window));
-                } else if (sname.starts_with("WDTW")) {
-                    // --- --- --- WDTW
-                    gendist.push_back(make_shared<tsc_nn1::WDTWGen>(getter_tr_set, getter_cfe_set, series_max_length));
-                } else if (sname.starts_with("DTWFull")) {
-                    // --- --- --- DTWFull
-                    gendist.push_back(make_shared<tsc_nn1::DTWFullGen>(getter_tr_set, getter_cfe_set));
-                } else if (sname.starts_with("ERP")) {
-                    // --- --- --- ERP
-                    gendist.push_back(
-                            make_shared<tsc_nn1::ERPGen>(getter_tr_set, getter_cfe_2, frac_stddev, getter_window));
-                } else if (sname.starts_with("LCSS")) {
-                    // --- --- --- LCSS
-                    gendist.push_back(make_shared<tsc_nn1::LCSSGen>(getter_tr_set, frac_stddev, getter_window));
-                } else if (sname.starts_with("MSM")) {
-                    // --- --- --- MSM
-                    gendist.push_back(make_shared<tsc_nn1::MSMGen>(getter_tr_set, getter_msm_cost));
-                } else if (sname.starts_with("TWE")) {
-                    // --- --- --- TWE
-                    gendist.push_back(make_shared<tsc_nn1::TWEGen>(getter_tr_set, getter_twe_nu, getter_twe_lambda));
+        // Getters shared by all the generators
+        auto getter_window = make_get_window(series_max_length);
+        auto frac_stddev = make_get_frac_stddev(get_GenSplitterNN1_State);
+        auto getter_msm_cost = make_get_msm_cost();
+        auto getter_twe_nu = make_get_twe_nu();
+        auto getter_twe_lambda = make_get_twe_lambda();
+        auto getter_softdtw_gamma = make_get_softdtw_gamma();
+
+        // List of distance generators (this is specific to our collection of NN1 Splitter generators)
+        std::vector<std::shared_ptr<tsc_nn1::i_GenDist>> gendist;
+        for (DistanceSpec const &spec: specs) {
+            auto getter_tr = make_get_transform(spec.transforms);
+            auto getter_cfe = make_get_vcfe(spec.exponents);
+            switch (spec.kind) {
+                case DistanceKind::DA: {
+                    gendist.push_back(make_shared<tsc_nn1::DAGen>(getter_tr, getter_cfe));
+                    break;
+                }
+                case DistanceKind::ADTW: {
+                    gendist.push_back(make_shared<tsc_nn1::ADTWGen>(getter_tr, getter_cfe, get_adtw_penalties()));
+                    break;
+                }
+                case DistanceKind::DTW: {
+                    auto getter_w = spec.proba_window ? make_proba_window(series_max_length) : getter_window;
+                    gendist.push_back(make_shared<tsc_nn1::DTWGen>(getter_tr, getter_cfe, getter_w, true,
+                                                                   coarse_dtw.factor, coarse_dtw.tolerance));
+                    break;
+                }
+                case DistanceKind::DTWFull: {
+                    gendist.push_back(make_shared<tsc_nn1::DTWFullGen>(getter_tr, getter_cfe));
+                    break;
+                }
+                case DistanceKind::WDTW: {
+                    gendist.push_back(make_shared<tsc_nn1::WDTWGen>(getter_tr, getter_cfe, series_max_length,
+                                                                    wdtw_tables));
+                    break;
+                }
+                case DistanceKind::ERP: {
+                    gendist.push_back(make_shared<tsc_nn1::ERPGen>(getter_tr, getter_cfe, frac_stddev, getter_window));
+                    break;
+                }
+                case DistanceKind::LCSS: {
+                    gendist.push_back(make_shared<tsc_nn1::LCSSGen>(getter_tr, frac_stddev, getter_window));
+                    break;
+                }
+                case DistanceKind::MSM: {
+                    gendist.push_back(make_shared<tsc_nn1::MSMGen>(getter_tr, getter_msm_cost));
+                    break;
+                }
+                case DistanceKind::TWE: {
+                    gendist.push_back(make_shared<tsc_nn1::TWEGen>(getter_tr, getter_twe_nu, getter_twe_lambda));
+                    break;
+                }
+                case DistanceKind::SoftDTW: {
+                    gendist.push_back(make_shared<tsc_nn1::SoftDTWGen>(getter_tr, getter_cfe, getter_softdtw_gamma,
+                                                                       getter_window));
+                    break;
+                }
+                case DistanceKind::SBD: {
+                    gendist.push_back(make_shared<tsc_nn1::SBDGen>(getter_tr));
+                    break;
                 }
             }
         }
@@ -313,15 +510,64 @@ namespace pf::splitters {
         std::vector<std::shared_ptr<tsc::i_GenNode>> generators;
 
         // Wrap each distance generator in GenSplitter1NN (which is a i_GenNode) and push in generators
+        // Large nodes search their nearest neighbours with the threads left by the concurrent candidates
         for (auto const &gd: gendist) {
-            generators.push_back(
-                    make_shared<tsc_nn1::GenSplitterNN1>(gd,
-                                                         get_GenSplitterNN1_State) //, get_train_data, get_test_data)
-            );
+            auto gen = make_shared<tsc_nn1::GenSplitterNN1>(gd, get_GenSplitterNN1_State);
+            gen->batch_min_size = batch_min_size;
+            gen->chunk_min_size = chunk_min_size;
+            gen->batch_nb_threads = std::max<size_t>(1, nb_threads / std::max<size_t>(1, nbc));
+            gen->max_fanout = max_fanout;
+            generators.push_back(std::move(gen));
         }
 
-        // --- Put a node chooser over all generators
-        return make_shared<tsc::snode::meta::SplitterChooserGen>(std::move(generators), nbc);
+        // Node choosers, scoring their candidates on samples of the large nodes, within the cost budget
+        const auto make_chooser = [&](std::vector<std::shared_ptr<tsc::i_GenNode>> &&gens) {
+            auto chooser = make_shared<tsc::snode::meta::SplitterChooserGen>(std::move(gens), nbc, nb_threads,
+                                                                             fork_min_size);
+            chooser->node_sample_min_size = node_sample_min_size;
+            chooser->node_sample_ratio = node_sample_ratio;
+            chooser->cost_budget = cost_budget;
+            return chooser;
+        };
+
+        // --- TS-CHIEF dictionary and interval splitters
+        const bool with_boss = distances.contains("BOSS");
+        const bool with_rise = distances.contains("RISE");
+        // Adaptive draw of the distance generators
+        std::shared_ptr<tsc::snode::meta::SplitterChooserGen> distance_chooser;
+        if (!generators.empty()) {
+            distance_chooser = make_chooser(std::move(generators));
+            if (adaptive) {
+                std::vector<std::string> names;
+                for (DistanceSpec const &spec: specs) { names.push_back(to_string(spec.kind)); }
+                adaptive->set_families(names);
+                distance_chooser->adaptive = adaptive;
+            }
+        }
+        if (!with_boss && !with_rise) {
+            // --- Put a node chooser over all generators
+            if (!distance_chooser) { throw std::invalid_argument("Empty set of generators to choose from"); }
+            return distance_chooser;
+        }
+        if (multivariate) { throw std::invalid_argument("BOSS and RISE only support univariate series"); }
+
+        // As TS-CHIEF: 'nbc' candidates of each family, keeping the best of the families.
+        // The transforms are drawn once, here: their train data is computed on first use and shared by all the trees.
+        tempo::DTS const &train_default = tsc::at_train(train_data, tsc::transform_id(train_data, "default"));
+        const size_t series_min_length = train_default.header().length_min();
+        std::vector<std::shared_ptr<tsc::i_GenNode>> families;
+        if (distance_chooser) { families.push_back(std::move(distance_chooser)); }
+        if (with_boss) {
+            std::vector<std::shared_ptr<tsc::i_GenNode>> boss{make_shared<tsc::snode::boss::GenSplitterBOSS>(
+                    "default", tsc::snode::boss::make_boss_pool(boss_pool_size, series_min_length, tstate.prng))};
+            families.push_back(make_chooser(std::move(boss)));
+        }
+        if (with_rise) {
+            std::vector<std::shared_ptr<tsc::i_GenNode>> rise{make_shared<tsc::snode::rise::GenSplitterRISE>(
+                    "default", tsc::snode::rise::make_rise_pool(rise_pool_size, series_min_length, tstate.prng))};
+            families.push_back(make_chooser(std::move(rise)));
+        }
+        return make_shared<tsc::snode::meta::SplitterTryAllGen>(std::move(families));
     }
 
 }; // End of namespace pf::splitters
\ No newline at end of file
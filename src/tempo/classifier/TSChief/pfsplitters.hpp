@@ -1,5 +1,8 @@
 #pragma once
 
+#include <filesystem>
+#include <limits>
+#include <optional>
 #include <vector>
 #include <string>
 #include <memory>
@@ -8,12 +11,13 @@
 #include "tempo/classifier/TSChief/splitter_interface.hpp"
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1dist_interface.hpp"
 #include "tempo/classifier/TSChief/snode/nn1splitter/nn1splitter.hpp"
+#include "tempo/classifier/TSChief/snode/meta/chooser.hpp"
 
 #include "tempo/classifier/TSChief/sleaf/pure_leaf.hpp"
 
 namespace pf::splitters {
 
-    using F = double;
+    using F = tempo::F;
     namespace tsc = tempo::classifier::TSChief;
     namespace tsc_nn1 = tempo::classifier::TSChief::snode::nn1splitter;
 
@@ -51,8 +55,8 @@ namespace pf::splitters {
     // --- --- --- ERP Gap Value *AND* LCSS epsilon.
 
     /// Random fraction of the incoming data standard deviation, within [stddev/5, stddev[
-    /// Must be able to access the dataset to compute the stddev at the node
-    tsc_nn1::StatGetter make_get_frac_stddev();
+    /// Must be able to access the dataset to compute the stddev at the node; the stddev is cached in the state.
+    tsc_nn1::StatGetter make_get_frac_stddev(std::shared_ptr<tsc::i_GetState<tsc_nn1::GenSplitterNN1_State>> get_state);
 
     // --- --- --- MSM Cost
 
@@ -64,6 +68,74 @@ namespace pf::splitters {
 
     tsc_nn1::T_GetterState<F> make_get_twe_lambda();
 
+    // --- --- --- Coarse to fine DTW
+
+    /// PAA factor and tolerance of the coarse to fine DTW (see tsc_nn1::DTW::paa_factor), 0: off
+    struct CoarseDTW {
+        size_t factor{0};
+        F tolerance{1};
+    };
+
+    /** Coarse to fine DTW requested by a token "dtwpaa<f>" or "dtwpaa<f>@<tol>" of 'distances' (f at least 2, tol
+     *  positive, 1 if omitted), off if there is none. Throws std::invalid_argument on malformed or repeated tokens.
+     */
+    CoarseDTW coarse_dtw_option(std::set<std::string> const &distances);
+
+    // --- --- --- ADTW penalties
+
+    /** ADTW penalties per (cost function exponent, transform), see tsc_nn1::ADTWGen::do_sampling.
+     * @param prng  One value is drawn, seeding the sampling, whether the penalties are sampled or loaded.
+     * @param path  If set and keyed by the same sampling (a fingerprint of the train data, the transforms, the
+     *              exponents, the seed drawn from 'prng' and the sampling parameters), the penalties are loaded from
+     *              it, skipping the sampling. Else, the penalties are sampled and saved in it with their key.
+     *              The file is meant to live alongside its dataset.
+     *              Sampling computes the lazy train transforms of 'transforms' (see tsc::register_train).
+     */
+    std::map<std::tuple<F, std::string>, std::vector<F>> make_adtw_penalties(
+            std::vector<F> const &exponents,
+            std::vector<std::string> const &transforms,
+            tsc::TreeData const &train_data,
+            tempo::PRNG &prng,
+            size_t nb_threads = 1,
+            std::optional<std::filesystem::path> const &path = {}
+    );
+
+    // --- --- --- Compiled configuration
+
+    /// Distances of the node splitters
+    enum class DistanceKind { DA, ADTW, DTW, DTWFull, WDTW, ERP, LCSS, MSM, TWE, SoftDTW, SBD };
+
+    /// Name of a distance, as in a configuration (e.g. "DTWFull")
+    std::string to_string(DistanceKind kind);
+
+    /// One distance generator of the node splitters: its distance and the tables its parameters are drawn from.
+    /// The other parameters (windows, ERP gap values and LCSS epsilons, MSM, TWE and Soft-DTW tables, ADTW penalties)
+    /// are drawn as in make_node_splitter.
+    struct DistanceSpec {
+        DistanceKind kind;
+        /// Transforms, uniformly drawn (no draw if there is one)
+        std::vector<std::string> transforms;
+        /// Cost function exponents, uniformly drawn (no draw if there is one). Unused by LCSS, MSM and TWE.
+        std::vector<F> exponents;
+        /// DTW: windows drawn as with make_proba_window instead of make_get_window
+        bool proba_window{false};
+    };
+
+    /** Compile the distances of a configuration into the flat list of the distance generators of make_node_splitter,
+     *  in their order: "pf2018" (alone), "pf2" (with "dtwproba"), or any set of distance names (tokens not naming a
+     *  distance, e.g. options, are ignored). The transforms and exponents are the ones of make_node_splitter; ERP
+     *  always uses the exponent 2, as pf2018 does for all its distances.
+     *  Throws std::invalid_argument for an empty set, or a univariate only distance on multivariate data.
+     *  The generators built from the list keep their getters and heap allocated distances: a few tens of nanoseconds
+     *  per candidate, against the microseconds of its nearest neighbour search (see pfsplitters.bench.cpp).
+     */
+    std::vector<DistanceSpec> compile_distances(
+            std::set<std::string> const &distances,
+            std::vector<F> const &exponents,
+            std::vector<std::string> const &transforms,
+            bool multivariate
+    );
+
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
     // Splitters
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -74,14 +146,57 @@ namespace pf::splitters {
 
     std::shared_ptr<tsc::i_GenLeaf> make_pure_leaf_smoothp(tempo::DatasetHeader const &train_header);
 
+    /// Pure leaves, and smoothed class distribution leaves bounding the trees (see tsc::sleaf::GenLeaf_Bounded):
+    /// at depth 'max_depth', below 'min_size' exemplars, or for splits reducing the Gini impurity by less than
+    /// 'min_gain'. Without any bound, same as make_pure_leaf.
+    std::shared_ptr<tsc::i_GenLeaf> make_bounded_leaf(tempo::DatasetHeader const &train_header,
+                                                      std::optional<size_t> max_depth, size_t min_size,
+                                                      double min_gain);
+
+    /// Number of BOSS transforms (resp. RISE intervals) drawn per forest by make_node_splitter
+    inline constexpr size_t boss_pool_size = 100;
+    inline constexpr size_t rise_pool_size = 100;
+
+    /// States registered in 'tstate' by make_node_splitter, composed at compile time (see tsc::StaticStates)
+    using NodeSplitterStates = tsc::StaticStates<tsc_nn1::GenSplitterNN1_State>;
+
     /** Generate node splitters for PF (distance splitters)
      * @param exponents           List of exponents for the DTW (including DA) family (uniform choice)
      * @param transforms          List of transforms, for all distances (uniform choice)
-     * @param distances           List of distance name (DA, ADTW, DTW, DTWFull, WDTW, ERP, LCSS, MSM, TWE)
+     * @param distances           List of distance name (DA, ADTW, DTW, DTWFull, WDTW, ERP, LCSS, MSM, TWE, SoftDTW,
+     *                            SBD),
+     *                            with options: "dtwproba" (pf2 only), "dtwpaa<f>[@<tol>]" (see coarse_dtw_option),
+     *                            and the TS-CHIEF splitters "BOSS" (dictionary) and "RISE" (interval), univariate
+     *                            only: 'nbc' candidates of each family, the best family's candidate being kept.
+     *                            Their transforms (boss_pool_size, rise_pool_size) are drawn from tstate's prng.
      * @param nbc                 Number of distance candidates per node
      * @param series_max_length   Maximum length of the series
-     * @param train_data          Train data
-     * @param tstate              TrainState that will be used - updated
+     * @param train_data          Registered train data (see tsc::register_train)
+     * @param tstate              TrainState that will be used - updated with NodeSplitterStates
+     * @param nb_threads          Number of threads generating the candidates of large nodes
+     * @param fork_min_size       Nodes with at least 'fork_min_size' exemplars generate their candidates concurrently,
+     *                            with deterministic forked states (see tsc::snode::meta::SplitterChooserGen)
+     * @param wdtw_nb_tables      If not 0, WDTW candidates draw their 'g' among this number of values, with weights
+     *                            computed once and shared (see tsc_nn1::WDTWTables), instead of any value in [0, 1[
+     * @param adtw_penalties_path File of the ADTW penalties, sampled once and shared by all the ADTW generators
+     *                            (see make_adtw_penalties)
+     * @param sampling_threads    Number of threads sampling the ADTW penalties, before any training (0: nb_threads)
+     * @param batch_min_size      Nodes with at least 'batch_min_size' exemplars search the nearest neighbours of their
+     *                            queries concurrently, with the threads left by their candidates (nb_threads/nbc),
+     *                            for the same result (see tsc_nn1::GenSplitterNN1::batch_min_size)
+     * @param node_sample_min_size Nodes with at least 'node_sample_min_size' exemplars score their candidates on a
+     *                            stratified sample of 'node_sample_ratio' of their exemplars, only splitting all of
+     *                            them with the chosen one (see tsc::snode::meta::SplitterChooserGen::node_sample_ratio)
+     * @param node_sample_ratio   Ratio of the sample, in ]0, 1]; 1: off
+     * @param max_fanout          If at least 2, NN1 nodes with more classes split on 'max_fanout' groups of classes
+     *                            (see tsc_nn1::GenSplitterNN1::max_fanout); 0: one branch per class
+     * @param cost_budget         Budget of the estimated cost of the candidates per node exemplar
+     *                            (see tsc::snode::meta::SplitterChooserGen::cost_budget); infinite: off
+     * @param adaptive            If set, the distance generators are drawn with its weights, one family per
+     *                            distance generator, named after its distance (see tsc::snode::meta::AdaptiveSampler)
+     * @param chunk_min_size      Nodes with at least 'chunk_min_size' exemplars search and route chunks of their
+     *                            queries concurrently, with the threads left by their candidates, each chunk with its
+     *                            own tie breaks (see tsc_nn1::GenSplitterNN1::chunk_min_size)
      * @return A node splitter generator
      */
     std::shared_ptr<tsc::i_GenNode> make_node_splitter(
@@ -90,8 +205,20 @@ namespace pf::splitters {
             std::set<std::string> const &distances,
             size_t nbc,
             size_t series_max_length,
-            std::map<std::string, tempo::DTS> const &train_data,
-            tsc::TreeState &tstate
+            tsc::TreeData const &train_data,
+            tsc::TreeState &tstate,
+            size_t nb_threads = 1,
+            size_t fork_min_size = std::numeric_limits<size_t>::max(),
+            size_t wdtw_nb_tables = 0,
+            std::optional<std::filesystem::path> const &adtw_penalties_path = {},
+            size_t sampling_threads = 0,
+            size_t batch_min_size = std::numeric_limits<size_t>::max(),
+            size_t node_sample_min_size = std::numeric_limits<size_t>::max(),
+            double node_sample_ratio = 1,
+            size_t max_fanout = 0,
+            double cost_budget = std::numeric_limits<double>::infinity(),
+            std::shared_ptr<tsc::snode::meta::AdaptiveSampler> const &adaptive = {},
+            size_t chunk_min_size = std::numeric_limits<size_t>::max()
     );
 
 }; // End of namespace pf::splitters
@@ -0,0 +1,40 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pfsplitters.hpp"
+
+#include <set>
+#include <stdexcept>
+#include <string>
+
+using namespace tempo;
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// The coarse to fine DTW option is read from a "dtwpaa<f>[@<tol>]" token among the distances, off without one.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Coarse to fine DTW option", "[pfsplitters][paa]") {
+  using pf::splitters::coarse_dtw_option;
+
+  SECTION("Off without token") {
+    REQUIRE(coarse_dtw_option({"pf2", "dtwproba"}).factor==0);
+    REQUIRE(coarse_dtw_option({}).factor==0);
+  }
+
+  SECTION("Factor and tolerance") {
+    const auto option = coarse_dtw_option({"pf2", "dtwpaa4"});
+    REQUIRE(option.factor==4);
+    REQUIRE(option.tolerance==1);
+    const auto tolerant = coarse_dtw_option({"pf2", "dtwpaa8@1.5"});
+    REQUIRE(tolerant.factor==8);
+    REQUIRE(tolerant.tolerance==(F)1.5);
+  }
+
+  SECTION("Malformed or repeated") {
+    for (const char *token : {"dtwpaa", "dtwpaa1", "dtwpaa4x", "dtwpaa4@", "dtwpaa4@0", "dtwpaa4@-1",
+                              "dtwpaa4@inf", "dtwpaa4@1x", "dtwpaax"}) {
+      REQUIRE_THROWS_AS(coarse_dtw_option({"pf2", token}), std::invalid_argument);
+    }
+    REQUIRE_THROWS_AS(coarse_dtw_option({"dtwpaa4", "dtwpaa8"}), std::invalid_argument);
+  }
+}
@@ -0,0 +1,60 @@
+#include "progress.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  size_t TrainingProgress::total(Counter c) const noexcept {
+    size_t sum = 0;
+    for (const auto& slot : slots) { sum += slot.counters[c].load(std::memory_order_relaxed); }
+    return sum;
+  }
+
+  nlohmann::json TrainingProgress::snapshot() const {
+    const double elapsed = std::chrono::duration<double>(utils::now() - start).count();
+    const size_t trees_done = total(TREES);
+    nlohmann::json j;
+    j["elapsed_s"] = elapsed;
+    j["trees_done"] = trees_done;
+    j["nb_trees"] = nb_trees;
+    j["nodes"] = total(NODES);
+    j["distances"] = total(DISTANCES);
+    if (trees_done==0) { j["eta_s"] = nullptr; }
+    else if (trees_done>=nb_trees) { j["eta_s"] = 0.0; }
+    else { j["eta_s"] = elapsed*(double)(nb_trees - trees_done)/(double)trees_done; }
+    return j;
+  }
+
+  size_t TrainingProgress::thread_slot() noexcept {
+    static std::atomic<size_t> next{0};
+    thread_local const size_t slot = next.fetch_add(1, std::memory_order_relaxed)%nb_slots;
+    return slot;
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  ProgressReporter::ProgressReporter(std::shared_ptr<const TrainingProgress> progress, std::ostream& sink,
+                                     std::chrono::milliseconds period) :
+    progress(std::move(progress)), sink(sink), period(period) {
+    thread = std::thread([this]() { run(); });
+  }
+
+  ProgressReporter::~ProgressReporter() { stop(); }
+
+  void ProgressReporter::stop() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    cv.notify_one();
+    if (thread.joinable()) { thread.join(); }
+  }
+
+  void ProgressReporter::run() {
+    std::unique_lock lock(mutex);
+    while (!cv.wait_for(lock, period, [this]() { return stopping; })) {
+      sink << progress->snapshot().dump() << std::endl;
+    }
+    sink << progress->snapshot().dump() << std::endl;
+  }
+
+} // End of tempo::classifier::TSChief
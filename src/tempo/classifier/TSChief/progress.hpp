@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+#include <tempo/utils/utils.hpp>
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Training progress
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Counters of a forest training, updated by all the training threads (see TreeState::progress).
+   *  A thread counts in its own slot (a cache line, picked once per thread), and the totals are the sums over the
+   *  slots: counting never locks and seldom shares a cache line, even with many threads.
+   *  The totals read during the training are a snapshot: they may lag behind the counting threads.
+   */
+  struct TrainingProgress {
+
+    // --- --- --- Types
+
+    enum Counter : size_t {
+      TREES = 0,  ///< Trees done
+      NODES,      ///< Nodes (leaves included) built
+      DISTANCES,  ///< Distances computed by the nodes splitters
+      NB_COUNTERS
+    };
+
+    // --- --- --- Fields
+
+    /// Number of trees to train, for the ETA
+    size_t nb_trees;
+
+    /// Start of the training, for the elapsed time and the ETA
+    utils::time_point_t start;
+
+    // --- --- --- Constructors/Destructors
+
+    explicit TrainingProgress(size_t nb_trees) : nb_trees(nb_trees), start(utils::now()) {}
+
+    // --- --- --- Methods
+
+    /// Add 'n' to the counter 'c' of the calling thread
+    void add(Counter c, size_t n = 1) noexcept {
+      slots[thread_slot()].counters[c].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /// Total of the counter 'c' over all the threads
+    size_t total(Counter c) const noexcept;
+
+    /// Snapshot of the counters as a JSON object:
+    /// {"elapsed_s", "trees_done", "nb_trees", "nodes", "distances", "eta_s"}.
+    /// The ETA extrapolates the time per tree done so far, and is null until a tree is done.
+    nlohmann::json snapshot() const;
+
+  private:
+
+    static constexpr size_t nb_slots = 64;
+
+    struct alignas(64) Slot {
+      std::array<std::atomic<size_t>, NB_COUNTERS> counters{};
+    };
+
+    std::array<Slot, nb_slots> slots{};
+
+    /// Slot of the calling thread: threads are given the slots in turn
+    static size_t thread_slot() noexcept;
+  };
+
+  /** Emit the progress of a training as JSON lines (see TrainingProgress::snapshot) on a sink, from its own thread:
+   *  one line every 'period', and a last line when stopped.
+   *  Only the reporter writes on the sink, and the training threads never wait for it.
+   *  The sink should not be used by anything else while the reporter runs.
+   */
+  class ProgressReporter {
+  public:
+
+    ProgressReporter(std::shared_ptr<const TrainingProgress> progress, std::ostream& sink,
+                     std::chrono::milliseconds period = std::chrono::seconds(1));
+
+    ProgressReporter(ProgressReporter const&) = delete;
+
+    ProgressReporter& operator=(ProgressReporter const&) = delete;
+
+    /// Stop the reporter (see stop)
+    ~ProgressReporter();
+
+    /// Stop the reporting thread, after it wrote a last line. Does nothing if already stopped.
+    void stop();
+
+  private:
+
+    std::shared_ptr<const TrainingProgress> progress;
+    std::ostream& sink;
+    std::chrono::milliseconds period;
+
+    // Only used to wake the reporter up when stopping
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping{false};
+
+    std::thread thread;
+
+    void run();
+  };
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,102 @@
+#include "result_cache.hpp"
+
+#include <cstring>
+#include <iterator>
+
+namespace tempo::classifier::TSChief {
+
+  namespace {
+
+    /// 64 bits finalizer of MurmurHash3
+    inline uint64_t mix(uint64_t h) {
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+      return h;
+    }
+
+  } // End of anonymous namespace
+
+  bool ResultCache::Key::operator==(Key const& other) const {
+    return hash==other.hash&&model==other.model&&nb_dimensions==other.nb_dimensions
+           &&values.size()==other.values.size()
+           &&std::memcmp(values.data(), other.values.data(), values.size()*sizeof(F))==0;
+  }
+
+  ResultCache::Key ResultCache::make_key(size_t model, std::vector<F> values, size_t nb_dimensions) {
+    // Hash the bit patterns of the values (as the comparison), one word at a time
+    uint64_t h = mix(model ^ (uint64_t(nb_dimensions) << 32) ^ values.size());
+    for (F v : values) {
+      uint64_t bits{0};
+      std::memcpy(&bits, &v, sizeof(F));
+      h = mix(h ^ bits) + 0x9e3779b97f4a7c15ULL;
+    }
+    return Key{model, nb_dimensions, std::move(values), h};
+  }
+
+  std::optional<classifier::Result1> ResultCache::get(Key const& key) const {
+    std::lock_guard lock(mtx);
+    lookups++;
+    auto [begin, end] = index.equal_range(key.hash);
+    for (auto it = begin; it!=end; ++it) {
+      if (it->second->key==key) {
+        lru.splice(lru.begin(), lru, it->second);
+        hits++;
+        return it->second->result;
+      }
+    }
+    return {};
+  }
+
+  void ResultCache::put(Key key, classifier::Result1 result) {
+    std::lock_guard lock(mtx);
+    // Already cached (e.g. twice in a batch): refresh
+    auto [begin, end] = index.equal_range(key.hash);
+    for (auto it = begin; it!=end; ++it) {
+      if (it->second->key==key) {
+        it->second->result = std::move(result);
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+      }
+    }
+    const uint64_t hash = key.hash;
+    lru.push_front(Entry{std::move(key), std::move(result)});
+    index.emplace(hash, lru.begin());
+    // Evict the least recently used entries
+    while (lru.size()>capacity) {
+      auto last = std::prev(lru.end());
+      auto [lbegin, lend] = index.equal_range(last->key.hash);
+      for (auto it = lbegin; it!=lend; ++it) {
+        if (it->second==last) {
+          index.erase(it);
+          break;
+        }
+      }
+      lru.pop_back();
+      evictions++;
+    }
+  }
+
+  size_t ResultCache::size() const {
+    std::lock_guard lock(mtx);
+    return lru.size();
+  }
+
+  size_t ResultCache::nb_lookups() const {
+    std::lock_guard lock(mtx);
+    return lookups;
+  }
+
+  size_t ResultCache::nb_hits() const {
+    std::lock_guard lock(mtx);
+    return hits;
+  }
+
+  size_t ResultCache::nb_evictions() const {
+    std::lock_guard lock(mtx);
+    return evictions;
+  }
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/classifier/utils.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Result cache
+
+  /** Shared, thread safe, least recently used cache of the predictions of series, for a scoring service receiving
+   *  the same series again (retries, overlapping consumers). Entries are keyed by the content of a series, hashed,
+   *  and by the id of the model predicting it, so that one cache serves several models.
+   *  A hit compares the values bit by bit with the cached ones: a hash collision is a miss, never a wrong result.
+   *  The capacity is given in number of entries.
+   */
+  class ResultCache : private utils::Uncopyable {
+  public:
+
+    /// Series predicted by a model: its row major values (one row per dimension), and their hash
+    struct Key {
+      size_t model{0};
+      size_t nb_dimensions{1};
+      std::vector<F> values;
+      uint64_t hash{0};
+
+      /// Same model, same shape, and bitwise equal values
+      bool operator==(Key const& other) const;
+    };
+
+    /// Key of the series of 'nb_dimensions' dimensions with the row major 'values', predicted by the model 'model'
+    static Key make_key(size_t model, std::vector<F> values, size_t nb_dimensions);
+
+  private:
+    struct Entry {
+      Key key;
+      classifier::Result1 result;
+    };
+
+    /// Most recently used first
+    mutable std::list<Entry> lru;
+    /// Entries by hash
+    mutable std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index;
+    mutable std::mutex mtx;
+    size_t capacity;
+    mutable size_t lookups{0};
+    mutable size_t hits{0};
+    size_t evictions{0};
+
+  public:
+
+    explicit ResultCache(size_t capacity) : capacity(std::max<size_t>(capacity, 1)) {}
+
+    /// Result cached for 'key', moved in front; count a lookup, and a hit if found
+    std::optional<classifier::Result1> get(Key const& key) const;
+
+    /// Cache the result predicted for 'key', evicting the least recently used entries beyond the capacity
+    void put(Key key, classifier::Result1 result);
+
+    /// Number of cached entries
+    size_t size() const;
+
+    size_t get_capacity() const { return capacity; }
+
+    /// Lookups (see get), the ones finding a cached result, and the entries evicted so far
+    size_t nb_lookups() const;
+
+    size_t nb_hits() const;
+
+    size_t nb_evictions() const;
+  };
+
+} // End of tempo::classifier::TSChief
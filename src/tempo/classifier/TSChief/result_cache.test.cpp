@@ -0,0 +1,100 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "result_cache.hpp"
+
+#include <vector>
+
+using namespace tempo;
+using namespace tempo::classifier::TSChief;
+
+namespace {
+
+  /// Result of 2 classes identified by its weight
+  classifier::Result1 mk_result(double weight) {
+    classifier::Result1 r(2);
+    r.weight = weight;
+    return r;
+  }
+
+  /// Key of the univariate series (v, v+1, v+2) for the model 'model'
+  ResultCache::Key mk_key(size_t model, F v) { return ResultCache::make_key(model, {v, v + 1, v + 2}, 1); }
+
+  /// Weight of the result cached for 'key', or -1 on a miss
+  double cached(ResultCache const& cache, ResultCache::Key const& key) {
+    const auto r = cache.get(key);
+    return r ? r->weight : -1;
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// A hit requires the same model and the same values; the least recently used entries are evicted first.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Result cache", "[resultcache]") {
+
+  SECTION("Hit and miss") {
+    ResultCache cache(4);
+    REQUIRE(cached(cache, mk_key(0, 1))==-1);
+    cache.put(mk_key(0, 1), mk_result(1));
+    REQUIRE(cached(cache, mk_key(0, 1))==1);
+    REQUIRE(cached(cache, mk_key(0, 2))==-1);
+    // Putting again refreshes the result without adding an entry
+    cache.put(mk_key(0, 1), mk_result(10));
+    REQUIRE(cached(cache, mk_key(0, 1))==10);
+    REQUIRE(cache.size()==1);
+    REQUIRE(cache.nb_lookups()==4);
+    REQUIRE(cache.nb_hits()==2);
+    REQUIRE(cache.nb_evictions()==0);
+  }
+
+  SECTION("LRU eviction order") {
+    ResultCache cache(3);
+    for (size_t i = 0; i<3; ++i) { cache.put(mk_key(0, (F)i), mk_result((double)i)); }
+    // Use 0: 1 becomes the least recently used, evicted by 3, then 2 by 4
+    REQUIRE(cached(cache, mk_key(0, 0))==0);
+    cache.put(mk_key(0, 3), mk_result(3));
+    REQUIRE(cache.nb_evictions()==1);
+    cache.put(mk_key(0, 4), mk_result(4));
+    REQUIRE(cache.nb_evictions()==2);
+    REQUIRE(cache.size()==3);
+    REQUIRE(cached(cache, mk_key(0, 1))==-1);
+    REQUIRE(cached(cache, mk_key(0, 2))==-1);
+    REQUIRE(cached(cache, mk_key(0, 0))==0);
+    REQUIRE(cached(cache, mk_key(0, 3))==3);
+    REQUIRE(cached(cache, mk_key(0, 4))==4);
+  }
+
+  SECTION("Equal hash, different values: miss") {
+    ResultCache cache(4);
+    const ResultCache::Key key = mk_key(0, 1);
+    // Forged collision: same hash, other values
+    const ResultCache::Key other{key.model, key.nb_dimensions, {5, 6, 7}, key.hash};
+    cache.put(key, mk_result(1));
+    REQUIRE(cached(cache, other)==-1);
+    // Both are cached side by side
+    cache.put(other, mk_result(2));
+    REQUIRE(cache.size()==2);
+    REQUIRE(cached(cache, key)==1);
+    REQUIRE(cached(cache, other)==2);
+    // Same values, other shape
+    const ResultCache::Key reshaped{key.model, 3, key.values, key.hash};
+    REQUIRE(cached(cache, reshaped)==-1);
+  }
+
+  SECTION("Different models do not collide") {
+    ResultCache cache(4);
+    cache.put(mk_key(0, 1), mk_result(1));
+    cache.put(mk_key(1, 1), mk_result(2));
+    REQUIRE(mk_key(0, 1).hash!=mk_key(1, 1).hash);
+    REQUIRE(cache.size()==2);
+    REQUIRE(cached(cache, mk_key(0, 1))==1);
+    REQUIRE(cached(cache, mk_key(1, 1))==2);
+    REQUIRE(cached(cache, mk_key(2, 1))==-1);
+    // Even with a forged equal hash
+    const ResultCache::Key key = mk_key(0, 1);
+    const ResultCache::Key other_model{3, key.nb_dimensions, key.values, key.hash};
+    REQUIRE(cached(cache, other_model)==-1);
+  }
+}
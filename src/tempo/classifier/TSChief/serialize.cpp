@@ -0,0 +1,34 @@
+#include "serialize.hpp"
+#include "splitter_interface.hpp"
+
+#include "sleaf/bounded_leaf.hpp"
+#include "sleaf/pure_leaf.hpp"
+#include "sleaf/pure_leaf_smoothp.hpp"
+#include "snode/boss/boss.hpp"
+#include "snode/nn1splitter/nn1splitter.hpp"
+#include "snode/rise/rise.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Splitters dispatch on their tag
+  // Note: new splitters must be registered here to be loadable
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  std::unique_ptr<i_SplitterLeaf> load_splitter_leaf(BinReader& in) {
+    const std::string tag = in.read_string();
+    if (tag==sleaf::SplitterLeaf_Pure::tag) { return sleaf::SplitterLeaf_Pure::load(in); }
+    else if (tag==sleaf::SplitterLeaf_Pure_SmoothP::tag) { return sleaf::SplitterLeaf_Pure_SmoothP::load(in); }
+    else if (tag==sleaf::SplitterLeaf_Distribution::tag) { return sleaf::SplitterLeaf_Distribution::load(in); }
+    else { throw std::runtime_error("Model deserialization: unknown leaf splitter '" + tag + "'"); }
+  }
+
+  std::unique_ptr<i_SplitterNode> load_splitter_node(BinReader& in, TreeData const& data) {
+    const std::string tag = in.read_string();
+    if (tag==snode::nn1splitter::splitter_nn1_tag) { return snode::nn1splitter::load_splitter_nn1(in, data); }
+    else if (tag==snode::boss::SplitterBOSS::tag) { return snode::boss::SplitterBOSS::load(in, data); }
+    else if (tag==snode::rise::SplitterRISE::tag) { return snode::rise::SplitterRISE::load(in, data); }
+    else { throw std::runtime_error("Model deserialization: unknown node splitter '" + tag + "'"); }
+  }
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "tempo/classifier/utils.hpp"
+#include "treedata.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Binary model format helpers
+  // All values are written in the native byte order: a model file is meant to be read on the same kind of machine.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Alignment (in bytes, from the start of the model) of the raw series data in a model file
+  constexpr size_t MODEL_DATA_ALIGN = 64;
+
+  /// Per transform name, map the index of train exemplars to their index in a compact table of exemplars, numbered in
+  /// registration order (see register_exemplar): the exemplars of a model (see BinWriter) or of a compacted forest
+  /// (see Forest::compact)
+  using ExemplarTable = std::map<std::string, std::map<size_t, size_t>>;
+
+  /// Register the train exemplar 'index' from the transform 'tname', returning its index in the table.
+  /// Calling several times with the same arguments returns the same index.
+  inline size_t register_exemplar(ExemplarTable& table, std::string const& tname, size_t index) {
+    auto& m = table[tname];
+    auto [it, inserted] = m.try_emplace(index, m.size());
+    return it->second;
+  }
+
+  /// Binary writer. Also collects the train exemplars referenced by the splitters while they are written.
+  struct BinWriter {
+
+    // --- --- --- Fields
+
+    std::ostream& out;
+
+    /// Number of bytes written so far
+    size_t position{0};
+
+    /// Referenced train exemplars, with their index in the model
+    ExemplarTable exemplars{};
+
+    /// If set, the train exemplars are referenced by their index in an exemplar store (see ExemplarStore) instead of
+    /// being collected in 'exemplars'
+    std::function<size_t(std::string const& tname, size_t index)> store_index{};
+
+    // --- --- --- Constructors/Destructors
+
+    explicit BinWriter(std::ostream& out) : out(out) {}
+
+    // --- --- --- Methods
+
+    /// Write raw bytes
+    void write_bytes(void const *ptr, size_t nbbytes) {
+      out.write(static_cast<char const *>(ptr), (std::streamsize)nbbytes);
+      if (!out) { throw std::runtime_error("Model serialization: write failed"); }
+      position += nbbytes;
+    }
+
+    /// Write a trivially copyable value
+    template<typename T>
+    requires std::is_trivially_copyable_v<T>
+    void write(T const& v) { write_bytes(&v, sizeof(T)); }
+
+    /// Write a string, prefixed by its size
+    void write_string(std::string const& s) {
+      write<uint64_t>(s.size());
+      write_bytes(s.data(), s.size());
+    }
+
+    /// Write a vector of trivially copyable values, prefixed by its size
+    template<typename T>
+    requires std::is_trivially_copyable_v<T>
+    void write_vector(std::vector<T> const& v) {
+      write<uint64_t>(v.size());
+      write_bytes(v.data(), v.size()*sizeof(T));
+    }
+
+    /// Write a result (probabilities and weight)
+    void write_result1(classifier::Result1 const& r) {
+      write<uint64_t>(r.probabilities.n_elem);
+      write_bytes(r.probabilities.memptr(), r.probabilities.n_elem*sizeof(double));
+      write<double>(r.weight);
+    }
+
+    /// Write zeros up to the next multiple of 'alignment'
+    void align(size_t alignment = MODEL_DATA_ALIGN) {
+      static const char zeros[MODEL_DATA_ALIGN]{};
+      const size_t rem = position%alignment;
+      if (rem!=0) { write_bytes(zeros, alignment - rem); }
+    }
+
+    /// Register the train exemplar 'index' from the transform 'tname', returning its index in the model.
+    /// Calling several times with the same arguments returns the same index.
+    size_t exemplar(std::string const& tname, size_t index) {
+      if (store_index) { return store_index(tname, index); }
+      return register_exemplar(exemplars, tname, index);
+    }
+  };
+
+  /// Read only stream buffer over memory, e.g. over a memory mapped model (see BinReader::view)
+  struct MemoryBuf : public std::streambuf {
+    MemoryBuf(char const *data, size_t size) {
+      char *p = const_cast<char *>(data); // Only used through the get area
+      setg(p, p, p + size);
+    }
+  };
+
+  /// Binary reader, throwing std::runtime_error on truncated or corrupted input
+  struct BinReader {
+
+    // --- --- --- Fields
+
+    std::istream& in;
+
+    /// Number of bytes read so far
+    size_t position{0};
+
+    /// If not null, 'in' reads the 'mapping_size' bytes starting at 'mapping' (see MemoryBuf), allowing views
+    char const *mapping{nullptr};
+    size_t mapping_size{0};
+
+    // --- --- --- Constructors/Destructors
+
+    explicit BinReader(std::istream& in) : in(in) {}
+
+    BinReader(std::istream& in, char const *mapping, size_t mapping_size) :
+      in(in), mapping(mapping), mapping_size(mapping_size) {}
+
+    // --- --- --- Methods
+
+    /// Read raw bytes
+    void read_bytes(void *ptr, size_t nbbytes) {
+      in.read(static_cast<char *>(ptr), (std::streamsize)nbbytes);
+      if (!in) { throw std::runtime_error("Model deserialization: unexpected end of input"); }
+      position += nbbytes;
+    }
+
+    /// Read a trivially copyable value
+    template<typename T>
+    requires std::is_trivially_copyable_v<T>
+    T read() {
+      T v;
+      read_bytes(&v, sizeof(T));
+      return v;
+    }
+
+    /// Read a size, checking it against 'max'
+    size_t read_size(size_t max = std::numeric_limits<uint32_t>::max()) {
+      const auto s = read<uint64_t>();
+      if (s>max) { throw std::runtime_error("Model deserialization: invalid size"); }
+      return (size_t)s;
+    }
+
+    /// Read a string written by BinWriter::write_string
+    std::string read_string() {
+      std::string s(read_size(), '\0');
+      read_bytes(s.data(), s.size());
+      return s;
+    }
+
+    /// Read a vector written by BinWriter::write_vector
+    template<typename T>
+    requires std::is_trivially_copyable_v<T>
+    std::vector<T> read_vector() {
+      std::vector<T> v(read_size());
+      read_bytes(v.data(), v.size()*sizeof(T));
+      return v;
+    }
+
+    /// Read a result written by BinWriter::write_result1
+    classifier::Result1 read_result1() {
+      arma::rowvec p(read_size());
+      read_bytes(p.memptr(), p.n_elem*sizeof(double));
+      const auto w = read<double>();
+      return classifier::Result1(std::move(p), w);
+    }
+
+    /// Only when reading from a mapping: return a pointer on the next 'nbbytes' and skip them (no copy)
+    char const *view(size_t nbbytes) {
+      if (mapping==nullptr) { throw std::logic_error("BinReader::view requires a mapping"); }
+      if (position + nbbytes>mapping_size) {
+        throw std::runtime_error("Model deserialization: unexpected end of input");
+      }
+      char const *p = mapping + position;
+      in.ignore((std::streamsize)nbbytes);
+      if (!in) { throw std::runtime_error("Model deserialization: unexpected end of input"); }
+      position += nbbytes;
+      return p;
+    }
+
+    /// Skip the padding written by BinWriter::align
+    void align(size_t alignment = MODEL_DATA_ALIGN) {
+      char buffer[MODEL_DATA_ALIGN];
+      const size_t rem = position%alignment;
+      if (rem!=0) { read_bytes(buffer, alignment - rem); }
+    }
+
+    /// Check a tag
+    void expect(std::string const& tag) {
+      if (read_string()!=tag) { throw std::runtime_error("Model deserialization: expected '" + tag + "'"); }
+    }
+  };
+
+} // End of tempo::classifier::TSChief
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <optional>
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/dataset/dts.hpp>
+
+#include <tempo/classifier/utils.hpp>
+#include <tempo/classifier/TSChief/tree.hpp>
+
+namespace tempo::classifier::TSChief::sleaf {
+
+  /// Leaf predicting the smoothed class distribution of the train exemplars reaching it
+  /// (see Result1::make_smooth_distribution)
+  struct SplitterLeaf_Distribution : public i_SplitterLeaf {
+
+    // --- --- --- Fields
+    /// Result computed at train time
+    classifier::Result1 result;
+
+    // --- --- --- Constructor / Destructors
+    /// Construction with already built result
+    explicit SplitterLeaf_Distribution(classifier::Result1&& r) : result(std::move(r)) {}
+
+    // --- --- --- Methods
+    /// Simply return a copy of the stored result
+    classifier::Result1 predict(TreeState& /* state */, TreeData const& /* data */, size_t /* index */) override {
+      return result;
+    }
+
+    /// Add the stored result, without allocation
+    void accumulate_into(TreeState& /* state */, TreeData const& /* data */, size_t /* index */, arma::rowvec& acc,
+                         double& w) override {
+      acc += result.probabilities*result.weight;
+      w += result.weight;
+    }
+
+    std::optional<classifier::Result1> constant_result() const override { return result; }
+
+    size_t nb_bytes() const override {
+      return sizeof(SplitterLeaf_Distribution) + result.probabilities.n_elem*sizeof(double);
+    }
+
+    /// Tag used in the model format
+    inline static const std::string tag{"distribution"};
+
+    void save(BinWriter& out) const override {
+      out.write_string(tag);
+      out.write_result1(result);
+    }
+
+    static std::unique_ptr<i_SplitterLeaf> load(BinReader& in) {
+      return std::make_unique<SplitterLeaf_Distribution>(in.read_result1());
+    }
+
+  };
+
+  /** Leaf generator bounding the size of the trees: the leaves of 'pure' (e.g. GenLeaf_Pure), and a
+   *  SplitterLeaf_Distribution at the nodes at depth 'max_depth', with less than 'min_size' exemplars, or whose
+   *  split reduces the Gini impurity by less than 'min_gain' (weighted by the size of the branches).
+   *  A maximal depth bounds the number of nodes an exemplar goes through, i.e. the cost of a prediction per tree.
+   */
+  struct GenLeaf_Bounded : public i_GenLeaf {
+
+    // --- --- --- Fields
+
+    std::shared_ptr<i_GenLeaf> pure;
+
+    DatasetHeader const& train_header;
+
+    /// Depth of the deepest nodes (the root is at depth 0), no limit by default
+    size_t max_depth{std::numeric_limits<size_t>::max()};
+
+    /// Nodes with less exemplars are leaves
+    size_t min_size{0};
+
+    /// Splits that do not reduce the Gini impurity by this value are replaced by a leaf
+    double min_gain{0};
+
+    // --- --- --- Constructors/Destructors
+
+    GenLeaf_Bounded(std::shared_ptr<i_GenLeaf> pure, DatasetHeader const& train_header) :
+      pure(std::move(pure)), train_header(train_header) {}
+
+    // --- --- --- Methods
+
+    i_GenLeaf::Result generate(TreeState& state, TreeData const& data, ByClassMap const& bcm) override {
+      i_GenLeaf::Result result = pure->generate(state, data, bcm);
+      if (result) { return result; }
+      if (state.depth>=max_depth||bcm.size()<min_size) { return distribution_leaf(bcm); }
+      return {};
+    }
+
+    i_GenLeaf::Result generate_after_split(TreeState& /* state */, TreeData const& /* data */, ByClassMap const& bcm,
+                                           std::vector<ByClassMap> const& branch_splits) override {
+      if (!(min_gain>0)||bcm.empty()) { return {}; }
+      double wgini{0};
+      for (const auto& branch : branch_splits) { wgini += (double)branch.size()*branch.gini_impurity(); }
+      const double gain = bcm.gini_impurity() - wgini/(double)bcm.size();
+      if (gain<min_gain) { return distribution_leaf(bcm); }
+      return {};
+    }
+
+  private:
+
+    i_GenLeaf::Result distribution_leaf(ByClassMap const& bcm) {
+      arma::rowvec counts(train_header.nb_classes(), arma::fill::zeros);
+      for (const auto& [label, is] : bcm) { counts[label] = (double)is.size(); }
+      return {std::make_unique<SplitterLeaf_Distribution>(classifier::Result1::make_smooth_distribution(counts))};
+    }
+
+  };
+
+} // End of namespace tempo::classifier::TSChief::sleaf
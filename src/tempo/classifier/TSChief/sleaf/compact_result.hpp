@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/classifier/utils.hpp>
+
+namespace tempo::classifier::TSChief::sleaf {
+
+  /** Compact form of a Result1 whose probabilities mostly share a same value 'base' (0 for a pure leaf, the
+   *  smoothing for a smoothed one): the other probabilities are stored with their class, in increasing class order.
+   *  A leaf of a problem with many classes then holds a few values instead of one per class.
+   *  to_result1 gives back the exact result, and accumulate_into adds exactly what adding the result would.
+   */
+  struct CompactResult {
+    size_t nb_classes{0};
+    double base{0};
+    std::vector<std::pair<uint32_t, double>> entries{};
+    double weight{0};
+
+    CompactResult() = default;
+
+    /// Probability 'p' for the class 'c', 'base' for the others
+    CompactResult(size_t nb_classes, double base, EL c, double p, double weight) :
+      nb_classes(nb_classes), base(base), entries{{(uint32_t)c, p}}, weight(weight) {}
+
+    /// Compact 'r', with its smallest probability as the base
+    explicit CompactResult(classifier::Result1 const& r) : nb_classes(r.probabilities.n_elem), weight(r.weight) {
+      if (nb_classes==0) { return; }
+      base = *std::min_element(r.probabilities.begin(), r.probabilities.end());
+      for (size_t c = 0; c<nb_classes; ++c) {
+        if (r.probabilities[c]!=base) { entries.emplace_back((uint32_t)c, r.probabilities[c]); }
+      }
+    }
+
+    /// Same as Result1::make_probabilities_one
+    static CompactResult probabilities_one(size_t cardinality, EL proba_at_one, double weight) {
+      return {cardinality, 0, proba_at_one, 1.0, weight};
+    }
+
+    /// Same as Result1::make_smooth_probabilities
+    static CompactResult smooth_probabilities(size_t cardinality, EL top_proba, double weight) {
+      const double total = (double)cardinality + weight;
+      return {cardinality, 1.0/total, top_proba, (1.0 + weight)/total, total};
+    }
+
+    classifier::Result1 to_result1() const {
+      arma::rowvec p(nb_classes);
+      p.fill(base);
+      for (auto const& [c, v] : entries) { p[c] = v; }
+      return classifier::Result1(std::move(p), weight);
+    }
+
+    /// Add the probabilities times the weight to 'acc', and the weight to 'w'.
+    /// Only the entries are visited when the base is 0, e.g. a single class for a pure leaf.
+    void accumulate_into(arma::rowvec& acc, double& w) const {
+      if (base==0) {
+        for (auto const& [c, v] : entries) { acc[c] += v*weight; }
+      } else {
+        const double bw = base*weight;
+        auto it = entries.begin();
+        for (size_t c = 0; c<nb_classes; ++c) {
+          if (it!=entries.end()&&it->first==c) {
+            acc[c] += it->second*weight;
+            ++it;
+          } else { acc[c] += bw; }
+        }
+      }
+      w += weight;
+    }
+
+    /// Memory held by the entries, in bytes
+    size_t nb_bytes() const { return entries.capacity()*sizeof(std::pair<uint32_t, double>); }
+  };
+
+} // End of namespace tempo::classifier::TSChief::sleaf
@@ -6,23 +6,49 @@
 #include <tempo/classifier/utils.hpp>
 #include <tempo/classifier/TSChief/tree.hpp>
 
+#include "compact_result.hpp"
+
 namespace tempo::classifier::TSChief::sleaf {
 
   /// Pure sleaf snode
   struct SplitterLeaf_Pure : public i_SplitterLeaf {
 
     // --- --- --- Fields
-    /// Pure sleaf result is computed at train time
-    classifier::Result1 result;
+    /// Pure sleaf result is computed at train time, stored as its class of probability one (see CompactResult)
+    CompactResult result;
 
     // --- --- --- Constructor / Destructors
     /// Construction with already built result
-    explicit SplitterLeaf_Pure(classifier::Result1&& r) : result(std::move(r)) {}
+    explicit SplitterLeaf_Pure(CompactResult&& r) : result(std::move(r)) {}
+
+    explicit SplitterLeaf_Pure(classifier::Result1 const& r) : result(r) {}
 
     // --- --- --- Methods
-    /// Simply return a copy of the stored result
+    /// Return the stored result
     classifier::Result1 predict(TreeState& /* state */, TreeData const& /* data */, size_t /* index */) override {
-      return result;
+      return result.to_result1();
+    }
+
+    /// Add the weight to the class of the leaf, without allocation
+    void accumulate_into(TreeState& /* state */, TreeData const& /* data */, size_t /* index */, arma::rowvec& acc,
+                         double& w) override {
+      result.accumulate_into(acc, w);
+    }
+
+    std::optional<classifier::Result1> constant_result() const override { return result.to_result1(); }
+
+    size_t nb_bytes() const override { return sizeof(SplitterLeaf_Pure) + result.nb_bytes(); }
+
+    /// Tag used in the model format
+    inline static const std::string tag{"pure"};
+
+    void save(BinWriter& out) const override {
+      out.write_string(tag);
+      out.write_result1(result.to_result1());
+    }
+
+    static std::unique_ptr<i_SplitterLeaf> load(BinReader& in) {
+      return std::make_unique<SplitterLeaf_Pure>(in.read_result1());
     }
 
   };
@@ -49,9 +75,7 @@ namespace tempo::classifier::TSChief::sleaf {
         size_t nb_class = train_header.nb_classes();
         EL elabel = *bcm.classes().begin();       // Get the encoded label
         return {
-          std::make_unique<SplitterLeaf_Pure>(
-            classifier::Result1::make_probabilities_one(nb_class, elabel, 1.0)
-          )
+          std::make_unique<SplitterLeaf_Pure>(CompactResult::probabilities_one(nb_class, elabel, 1.0))
         };
       } else { return {}; } // Else, return the empty option
     }
@@ -6,23 +6,50 @@
 #include <tempo/classifier/utils.hpp>
 #include <tempo/classifier/TSChief/tree.hpp>
 
+#include "compact_result.hpp"
+
 namespace tempo::classifier::TSChief::sleaf {
 
   /// Pure sleaf snode
   struct SplitterLeaf_Pure_SmoothP : public i_SplitterLeaf {
 
     // --- --- --- Fields
-    /// Pure sleaf result is computed at train time
-    classifier::Result1 result;
+    /// Pure sleaf result is computed at train time, stored as the smoothing and the probability of its class
+    /// (see CompactResult)
+    CompactResult result;
 
     // --- --- --- Constructor / Destructors
     /// Construction with already built result
-    explicit SplitterLeaf_Pure_SmoothP(classifier::Result1&& r) : result(std::move(r)) {}
+    explicit SplitterLeaf_Pure_SmoothP(CompactResult&& r) : result(std::move(r)) {}
+
+    explicit SplitterLeaf_Pure_SmoothP(classifier::Result1 const& r) : result(r) {}
 
     // --- --- --- Methods
-    /// Simply return a copy of the stored result
+    /// Return the stored result
     classifier::Result1 predict(TreeState& /* state */, TreeData const& /* data */, size_t /* index */) override {
-      return result;
+      return result.to_result1();
+    }
+
+    /// Add the stored result, without allocation
+    void accumulate_into(TreeState& /* state */, TreeData const& /* data */, size_t /* index */, arma::rowvec& acc,
+                         double& w) override {
+      result.accumulate_into(acc, w);
+    }
+
+    std::optional<classifier::Result1> constant_result() const override { return result.to_result1(); }
+
+    size_t nb_bytes() const override { return sizeof(SplitterLeaf_Pure_SmoothP) + result.nb_bytes(); }
+
+    /// Tag used in the model format
+    inline static const std::string tag{"pure_smoothp"};
+
+    void save(BinWriter& out) const override {
+      out.write_string(tag);
+      out.write_result1(result.to_result1());
+    }
+
+    static std::unique_ptr<i_SplitterLeaf> load(BinReader& in) {
+      return std::make_unique<SplitterLeaf_Pure_SmoothP>(in.read_result1());
     }
 
   };
@@ -50,7 +77,7 @@ namespace tempo::classifier::TSChief::sleaf {
         EL elabel = *bcm.classes().begin();  // Get the encoded label
         return {
           std::make_unique<SplitterLeaf_Pure_SmoothP>(
-            classifier::Result1::make_smooth_probabilities(cardinality, elabel, bcm.size())
+            CompactResult::smooth_probabilities(cardinality, elabel, (double)bcm.size())
           )
         };
       } else { return {}; } // Else, return the empty option
@@ -0,0 +1,267 @@
+#include "boss.hpp"
+
+#include <tempo/transform/core/univariate.sfa.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tempo::classifier::TSChief::snode::boss {
+
+  namespace sfa = tempo::transform::core::univariate;
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // BOSS transform
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  std::string boss_key(std::string const& tname, BOSSParams const& params) {
+    return "boss:" + tname + ":" + std::to_string(params.window) + ":" + std::to_string(params.word_length) + ":"
+      + (params.norm ? "1" : "0");
+  }
+
+  namespace {
+
+    /// Histogram of the SFA values of the windows of a series
+    Histogram histogram_of(std::vector<F> const& values, BOSSParams const& params, std::vector<F> const& bins) {
+      const size_t nbv = params.word_length;
+      const size_t nbw = nbv==0 ? 0 : values.size()/nbv;
+      std::vector<uint32_t> words;
+      words.reserve(nbw);
+      for (size_t w = 0; w<nbw; ++w) {
+        const uint32_t word = sfa::sfa_word(values.data() + w*nbv, nbv, bins.data(), boss_alphabet, boss_bits);
+        // Numerosity reduction
+        if (words.empty()||words.back()!=word) { words.push_back(word); }
+      }
+      std::sort(words.begin(), words.end());
+      Histogram result;
+      for (uint32_t word : words) {
+        if (!result.empty()&&result.back().word==word) { ++result.back().count; }
+        else { result.push_back({word, 1}); }
+      }
+      return result;
+    }
+
+    /// SFA values of the windows of a series
+    void sfa_values(TSeries const& series, BOSSParams const& params, std::vector<F>& out) {
+      out.resize(sfa::nb_windows(series.length(), params.window)*params.word_length);
+      sfa::sfa_dft<F>(series.data(), series.length(), params.window, params.word_length, params.norm, out.data());
+    }
+
+  }
+
+  Histogram boss_histogram(TSeries const& series, BOSSParams const& params, std::vector<F> const& bins) {
+    std::vector<F> values;
+    sfa_values(series, params, values);
+    return histogram_of(values, params, bins);
+  }
+
+  std::vector<Histogram> boss_histograms(DTS const& dts, BOSSParams const& params, std::vector<F> const& bins) {
+    std::vector<Histogram> result;
+    result.reserve(dts.size());
+    std::vector<F> values;
+    for (size_t i = 0; i<dts.size(); ++i) {
+      sfa_values(dts[i], params, values);
+      result.push_back(histogram_of(values, params, bins));
+    }
+    return result;
+  }
+
+  BOSSTransform boss_fit(DTS const& train, BOSSParams const& params) {
+    // Breakpoints learned from the windows of all the series
+    std::vector<F> all_values;
+    std::vector<F> values;
+    for (size_t i = 0; i<train.size(); ++i) {
+      sfa_values(train[i], params, values);
+      all_values.insert(all_values.end(), values.begin(), values.end());
+    }
+    BOSSTransform result;
+    result.bins = sfa::sfa_bins(all_values, params.word_length, boss_alphabet);
+    // Histograms, from the values already computed
+    result.histograms.reserve(train.size());
+    size_t offset = 0;
+    for (size_t i = 0; i<train.size(); ++i) {
+      const size_t size = sfa::nb_windows(train[i].length(), params.window)*params.word_length;
+      values.assign(all_values.begin() + (long)offset, all_values.begin() + (long)(offset + size));
+      offset += size;
+      result.histograms.push_back(histogram_of(values, params, result.bins));
+    }
+    return result;
+  }
+
+  F boss_distance(Histogram const& query, Histogram const& exemplar, F cutoff) {
+    F result = 0;
+    auto it = exemplar.begin();
+    for (const auto& [word, count] : query) {
+      while (it!=exemplar.end()&&it->word<word) { ++it; }
+      const F other = (it!=exemplar.end()&&it->word==word) ? (F)it->count : 0;
+      const F diff = (F)count - other;
+      result += diff*diff;
+      if (result>cutoff) { return result; }
+    }
+    return result;
+  }
+
+  std::vector<BOSSParams> make_boss_pool(size_t nb, size_t min_length, PRNG& prng) {
+    if (min_length==0) { throw std::invalid_argument("BOSS transforms of empty series"); }
+    const size_t min_window = std::min<size_t>(10, min_length);
+    std::uniform_int_distribution<size_t> window_dist(min_window, min_length);
+    std::bernoulli_distribution norm_dist(0.5);
+    std::vector<BOSSParams> pool;
+    pool.reserve(nb);
+    for (size_t i = 0; i<nb; ++i) {
+      const size_t window = window_dist(prng);
+      const size_t word_length = utils::pick_one(boss_word_lengths, prng);
+      pool.push_back({window, word_length, norm_dist(prng)});
+    }
+    return pool;
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // BOSS splitter
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  SplitterBOSS::SplitterBOSS(std::string transform_name, size_t transform_id, BOSSParams params,
+                             std::vector<F> bins, std::vector<Histogram> exemplars, std::vector<size_t> branches) :
+    transform_name(std::move(transform_name)),
+    transform_id(transform_id),
+    params(params),
+    bins(std::move(bins)),
+    exemplars(std::move(exemplars)),
+    branches(std::move(branches)),
+    key(boss_key(this->transform_name, params)) {}
+
+  size_t SplitterBOSS::route(Histogram const& query, PRNG& prng) const {
+    thread_local std::vector<size_t> ties;
+    ties.clear();
+    F bsf = utils::PINF;
+    for (size_t e = 0; e<exemplars.size(); ++e) {
+      const F d = boss_distance(query, exemplars[e], bsf);
+      if (d<bsf) {
+        bsf = d;
+        ties.assign(1, branches[e]);
+      } else if (d==bsf) { ties.push_back(branches[e]); }
+    }
+    return ties.size()==1 ? ties.front() : utils::pick_one(ties, prng);
+  }
+
+  size_t SplitterBOSS::get_branch_index(TreeState& state, TreeData const& data, size_t index) {
+    const auto histograms = at_test_features(data).get<std::vector<Histogram>>(key, [&]() {
+      return boss_histograms(at_test(data, transform_id), params, bins);
+    });
+    return route((*histograms)[index], state.prng);
+  }
+
+  void SplitterBOSS::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transform_name);
+    out.write<uint64_t>(params.window);
+    out.write<uint64_t>(params.word_length);
+    out.write<uint8_t>(params.norm ? 1 : 0);
+    out.write_vector(bins);
+    out.write<uint64_t>(exemplars.size());
+    for (size_t e = 0; e<exemplars.size(); ++e) {
+      out.write<uint64_t>(branches[e]);
+      out.write_vector(exemplars[e]);
+    }
+  }
+
+  std::unique_ptr<i_SplitterNode> SplitterBOSS::load(BinReader& in, TreeData const& data) {
+    std::string tname = in.read_string();
+    BOSSParams params{};
+    params.window = in.read_size();
+    params.word_length = in.read_size(16);
+    params.norm = in.read<uint8_t>()!=0;
+    std::vector<F> bins = in.read_vector<F>();
+    if (bins.size()!=params.word_length*(boss_alphabet - 1)) {
+      throw std::runtime_error("Model deserialization: invalid BOSS breakpoints");
+    }
+    const size_t nb_exemplars = in.read_size();
+    std::vector<Histogram> exemplars;
+    std::vector<size_t> branches;
+    for (size_t e = 0; e<nb_exemplars; ++e) {
+      branches.push_back(in.read_size());
+      exemplars.push_back(in.read_vector<WordCount>());
+    }
+    const size_t tid = TSChief::transform_id(data, tname);
+    return std::make_unique<SplitterBOSS>(std::move(tname), tid, params, std::move(bins), std::move(exemplars),
+                                          std::move(branches));
+  }
+
+  void SplitterBOSS::remap_exemplars(ExemplarTable const& /* table */, TreeData const& data) {
+    transform_id = TSChief::transform_id(data, transform_name);
+  }
+
+  size_t SplitterBOSS::nb_bytes() const {
+    size_t result = sizeof(SplitterBOSS) + transform_name.size() + key.size() + bins.size()*sizeof(F)
+      + branches.size()*sizeof(size_t);
+    for (const auto& h : exemplars) { result += sizeof(Histogram) + h.size()*sizeof(WordCount); }
+    return result;
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // BOSS splitter generator
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  namespace {
+
+    /// Split 'bcm' with 'splitter', routing the train histograms.
+    /// Each branch gets the label of its class, so that no BCM is empty.
+    i_GenNode::Result split(TreeState& state, ByClassMap const& bcm, std::unique_ptr<SplitterBOSS>&& splitter,
+                            std::vector<Histogram> const& histograms) {
+      const std::map<EL, size_t>& label_to_branch = bcm.labels_to_index();
+      std::vector<ByClassMap::BCMvec_t> splits(bcm.nb_classes());
+      for (const auto& [label, branch] : label_to_branch) { splits[branch][label]; }
+      for (const auto& [label, is] : bcm) {
+        for (size_t idx : is) { splits[splitter->route(histograms[idx], state.prng)][label].push_back(idx); }
+      }
+      std::vector<ByClassMap> branch_splits;
+      branch_splits.reserve(splits.size());
+      for (auto& s : splits) { branch_splits.emplace_back(std::move(s)); }
+      return i_GenNode::Result{.splitter = std::move(splitter), .branch_splits = std::move(branch_splits)};
+    }
+
+    /// BOSS transform of the train data, computed once for all the trees
+    std::shared_ptr<const BOSSTransform> train_transform(TreeData const& data, std::string const& tname, size_t tid,
+                                                         BOSSParams const& params) {
+      return at_train_features(data).get<BOSSTransform>(boss_key(tname, params), [&]() {
+        return boss_fit(at_train(data, tid), params);
+      });
+    }
+
+  }
+
+  GenSplitterBOSS::GenSplitterBOSS(std::string transform_name, std::vector<BOSSParams> pool) :
+    transform_name(std::move(transform_name)), pool(std::move(pool)) {
+    if (this->pool.empty()) { throw std::invalid_argument("Empty pool of BOSS transforms"); }
+  }
+
+  i_GenNode::Result GenSplitterBOSS::generate(TreeState& state, TreeData const& data, ByClassMap const& bcm) {
+    const auto scope = state.time("train/node/boss");
+    const BOSSParams& params = utils::pick_one(pool, state.prng);
+    const size_t tid = transform_id(data, transform_name);
+    const auto transform = train_transform(data, transform_name, tid, params);
+    const std::vector<Histogram>& histograms = transform->histograms;
+
+    // One exemplar per class, a branch per class
+    const std::map<EL, size_t>& label_to_branch = bcm.labels_to_index();
+    std::vector<Histogram> exemplars;
+    std::vector<size_t> branches;
+    for (const auto& [label, is] : bcm.pick_one_by_class(state.prng)) {
+      for (size_t idx : is) {
+        exemplars.push_back(histograms[idx]);
+        branches.push_back(label_to_branch.at(label));
+      }
+    }
+    auto splitter = std::make_unique<SplitterBOSS>(transform_name, tid, params, transform->bins,
+                                                   std::move(exemplars), std::move(branches));
+    return split(state, bcm, std::move(splitter), histograms);
+  }
+
+  i_GenNode::Result GenSplitterBOSS::split_with(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                                std::unique_ptr<i_SplitterNode>&& splitter) {
+    if (dynamic_cast<SplitterBOSS *>(splitter.get())==nullptr) { return {}; }
+    std::unique_ptr<SplitterBOSS> owned(static_cast<SplitterBOSS *>(splitter.release()));
+    const auto transform = train_transform(data, owned->transform_name, owned->transform_id, owned->params);
+    return split(state, bcm, std::move(owned), transform->histograms);
+  }
+
+} // End of namespace tempo::classifier::TSChief::snode::boss
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/dataset/dts.hpp>
+
+#include <tempo/classifier/TSChief/treedata.hpp>
+#include <tempo/classifier/TSChief/treestate.hpp>
+#include <tempo/classifier/TSChief/splitter_interface.hpp>
+
+namespace tempo::classifier::TSChief::snode::boss {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // BOSS transform (Schäfer, 2015), as in the dictionary splitters of TS-CHIEF (Shifaz et al., 2020)
+
+  /// Size of the SFA alphabet, and bits per symbol in a word
+  inline constexpr size_t boss_alphabet = 4;
+  inline constexpr size_t boss_bits = 2;
+
+  /// Word lengths drawn by make_boss_pool
+  inline const std::vector<size_t> boss_word_lengths{6, 8, 10, 12, 14, 16};
+
+  /// Parameters of a BOSS transform
+  struct BOSSParams {
+    /// Length of the sliding windows
+    size_t window;
+    /// Number of SFA values (symbols) per word, at most 16
+    size_t word_length;
+    /// z-normalise the windows
+    bool norm;
+  };
+
+  /// Number of occurrences of a word in a series
+  struct WordCount {
+    uint32_t word;
+    uint32_t count;
+  };
+
+  /// Bag of SFA words of a series, sorted by word
+  using Histogram = std::vector<WordCount>;
+
+  /// BOSS transform of the train data: the SFA breakpoints learned from all the train series, and their histograms
+  struct BOSSTransform {
+    std::vector<F> bins;
+    std::vector<Histogram> histograms;
+  };
+
+  /// Key of a BOSS transform of the transform 'tname' in a FeatureCache
+  std::string boss_key(std::string const& tname, BOSSParams const& params);
+
+  /// Histogram of the words of a series, with numerosity reduction: a word repeated by consecutive windows is counted
+  /// once. Series shorter than the window have an empty histogram.
+  Histogram boss_histogram(TSeries const& series, BOSSParams const& params, std::vector<F> const& bins);
+
+  /// Histograms of all the series of 'dts'
+  std::vector<Histogram> boss_histograms(DTS const& dts, BOSSParams const& params, std::vector<F> const& bins);
+
+  /// Fit the SFA breakpoints on all the windows of the series of 'train', and compute their histograms
+  BOSSTransform boss_fit(DTS const& train, BOSSParams const& params);
+
+  /// Non symmetric BOSS distance: sum of the squared differences of the counts of the words of the query.
+  /// Abandon the computation as soon as it exceeds 'cutoff', returning a value above 'cutoff'.
+  F boss_distance(Histogram const& query, Histogram const& exemplar, F cutoff = utils::PINF);
+
+  /// Pool of 'nb' BOSS transforms, with windows drawn in [min(10, min_length), min_length], the word lengths among
+  /// boss_word_lengths, with or without normalisation. Throws std::invalid_argument if 'min_length' is 0.
+  std::vector<BOSSParams> make_boss_pool(size_t nb, size_t min_length, PRNG& prng);
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // BOSS splitter: one exemplar per class, a branch per class, routing each series to its nearest exemplar
+
+  struct SplitterBOSS : public i_SplitterNode {
+
+    // --- --- --- Fields
+
+    /// Name and ID of the transform the words are computed on (see TreeData::transform_ids)
+    std::string transform_name;
+    size_t transform_id;
+
+    BOSSParams params;
+
+    /// SFA breakpoints learned from the train series (see BOSSTransform)
+    std::vector<F> bins;
+
+    /// Histograms of the exemplars, and their branch
+    std::vector<Histogram> exemplars;
+    std::vector<size_t> branches;
+
+    /// Key of the test histograms in the test features cache (see at_test_features)
+    std::string key;
+
+    // --- --- --- Constructors/Destructors
+
+    SplitterBOSS(std::string transform_name, size_t transform_id, BOSSParams params, std::vector<F> bins,
+                 std::vector<Histogram> exemplars, std::vector<size_t> branches);
+
+    // --- --- --- Methods
+
+    /// Branch of the nearest exemplar of 'query', ties being broken at random
+    size_t route(Histogram const& query, PRNG& prng) const;
+
+    /// Route the test series 'index', its histogram being computed with all the test histograms of the same transform
+    /// on first use
+    size_t get_branch_index(TreeState& state, TreeData const& data, size_t index) override;
+
+    /// Tag used in the model format
+    inline static const std::string tag{"boss"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_SplitterNode> load(BinReader& in, TreeData const& data);
+
+    /// The splitter holds the histograms of its exemplars, not the series: only refresh the transform ID
+    void remap_exemplars(ExemplarTable const& /* table */, TreeData const& data) override;
+
+    size_t nb_bytes() const override;
+
+    std::string kind() const override { return "BOSS"; }
+
+  };
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // BOSS splitter generator
+
+  /** Draw a BOSS transform of the pool at each node. The transforms of the train data are computed once, on first
+   *  use, and shared by all the nodes and trees (see at_train_features).
+   */
+  struct GenSplitterBOSS : public i_GenNode {
+
+    // --- --- --- Fields
+
+    /// Transform the words are computed on
+    std::string transform_name;
+
+    /// BOSS transforms drawn from, e.g. by make_boss_pool
+    std::vector<BOSSParams> pool;
+
+    // --- --- --- Constructors/Destructors
+
+    GenSplitterBOSS(std::string transform_name, std::vector<BOSSParams> pool);
+
+    // --- --- --- Methods
+
+    i_GenNode::Result generate(TreeState& state, TreeData const& data, ByClassMap const& bcm) override;
+
+    /// Route all the train series of 'bcm' with 'splitter', a SplitterBOSS
+    i_GenNode::Result split_with(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                 std::unique_ptr<i_SplitterNode>&& splitter) override;
+
+  };
+
+} // End of namespace tempo::classifier::TSChief::snode::boss
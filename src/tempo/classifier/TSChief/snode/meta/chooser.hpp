@@ -1,5 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
 #include <tempo/utils/utils.hpp>
 #include <tempo/dataset/dataset.hpp>
 
@@ -8,24 +19,130 @@
 
 namespace tempo::classifier::TSChief::snode::meta {
 
-  namespace {
-    //// Compute the weighted (ratio of series per branch) gini impurity of a split.
-    inline double weighted_gini_impurity(std::vector<ByClassMap> const& branch_split) {
-      double wgini{0};
-      double total_size{0};
-      for (const auto& bcm : branch_split) {
-        double g = bcm.gini_impurity();
-        // Weighted part: multiply gini score by the total number of item in this branch
-        auto bcm_size = (double)bcm.size();
-        wgini += bcm_size*g;
-        // Accumulate total size for final division
-        total_size += bcm_size;
+  /** Adaptive choice of the generators of a SplitterChooserGen ("families", e.g. one per distance), shared by all
+   *  the trees of a training. Each node records the family of its candidates, their estimated cost
+   *  (see i_GenNode::Result::cost), and the family of the chosen one (its win). Once a family has at least
+   *  'min_candidates' candidates, its weight is its win rate relative to the mean win rate, divided by its cost
+   *  relative to the mean cost: at most 1, at least 'min_weight'. Expensive families rarely winning are then drawn
+   *  less often by the nodes trained after them; the others keep a weight of 1.
+   *  The weights depend on the nodes already trained: with several threads, the training is not reproducible.
+   */
+  struct AdaptiveSampler {
+
+    struct Family {
+      std::string name;
+      size_t nb_candidates{0};
+      size_t nb_wins{0};
+      double cost{0};
+
+      double mean_cost() const { return nb_candidates==0 ? 0 : cost/(double)nb_candidates; }
+
+      /// Win rate, with one win in two candidates a priori
+      double win_rate() const { return ((double)nb_wins + 1)/((double)nb_candidates + 2); }
+    };
+
+    /// Candidates of a family before its weight adapts, and smallest weight
+    size_t min_candidates{64};
+    double min_weight{0.05};
+
+    /// Families of the generators, in their order. Reset the statistics.
+    void set_families(std::vector<std::string> const& names) {
+      std::lock_guard lock(mutex);
+      families.clear();
+      for (auto const& name : names) { families.push_back(Family{name}); }
+    }
+
+    /// Record the candidates of a node: 'picked[i]' is the family of the candidate i, of cost 'costs[i]', from which
+    /// the candidate 'winner' (if below picked.size()) was chosen
+    void record(std::vector<size_t> const& picked, std::vector<double> const& costs, size_t winner) {
+      std::lock_guard lock(mutex);
+      for (size_t i = 0; i<picked.size(); ++i) {
+        Family& f = families[picked[i]];
+        ++f.nb_candidates;
+        f.cost += costs[i];
       }
-      // Finish weighted computation by scaling to [0, 1]
-      assert(total_size!=0);
-      return wgini/total_size;
+      if (winner<picked.size()) { ++families[picked[winner]].nb_wins; }
+    }
+
+    /// Weights of the families (see above). Empty while they are all 1: the generators are then drawn uniformly.
+    std::vector<double> weights() const {
+      std::lock_guard lock(mutex);
+      return weights_unlocked();
     }
-  }
+
+    /// Copy of the statistics of the families, with their current weight
+    std::vector<std::pair<Family, double>> snapshot() const {
+      std::lock_guard lock(mutex);
+      std::vector<double> w = weights_unlocked();
+      std::vector<std::pair<Family, double>> result;
+      for (size_t i = 0; i<families.size(); ++i) { result.emplace_back(families[i], w.empty() ? 1.0 : w[i]); }
+      return result;
+    }
+
+    /// Mean cost of a candidate drawn with the current weights, relative to a uniform draw (1 without adaptation)
+    double expected_cost_ratio() const {
+      const auto families_weights = snapshot();
+      double uniform = 0;
+      double weighted = 0;
+      double total = 0;
+      for (auto const& [f, w] : families_weights) {
+        uniform += f.mean_cost();
+        weighted += w*f.mean_cost();
+        total += w;
+      }
+      if (!(uniform>0)||!(total>0)) { return 1; }
+      return (weighted/total)/(uniform/(double)families_weights.size());
+    }
+
+    /// Index of a generator among 'nb' drawn with 'weights' (uniformly if empty)
+    template<typename PRNG>
+    static size_t pick(std::vector<double> const& weights, size_t nb, PRNG& prng) {
+      if (nb==1) { return 0; }
+      if (weights.empty()) { return std::uniform_int_distribution<size_t>(0, nb - 1)(prng); }
+      double total = 0;
+      for (double w : weights) { total += w; }
+      double r = std::uniform_real_distribution<double>(0, total)(prng);
+      for (size_t i = 0; i + 1<nb; ++i) {
+        if (r<weights[i]) { return i; }
+        r -= weights[i];
+      }
+      return nb - 1;
+    }
+
+  private:
+
+    std::vector<double> weights_unlocked() const {
+      double sum_rate = 0;
+      double sum_cost = 0;
+      size_t nb = 0;
+      for (Family const& f : families) {
+        if (f.nb_candidates==0) { continue; }
+        sum_rate += f.win_rate();
+        sum_cost += f.mean_cost();
+        ++nb;
+      }
+      std::vector<double> w(families.size(), 1.0);
+      bool adapted = false;
+      if (nb>1&&sum_rate>0&&sum_cost>0) {
+        const double mean_rate = sum_rate/(double)nb;
+        const double mean_cost = sum_cost/(double)nb;
+        for (size_t i = 0; i<families.size(); ++i) {
+          Family const& f = families[i];
+          if (f.nb_candidates<min_candidates||!(f.mean_cost()>0)) { continue; }
+          const double value = (f.win_rate()/mean_rate)/(f.mean_cost()/mean_cost);
+          if (value<1) {
+            w[i] = std::max(min_weight, value);
+            adapted = true;
+          }
+        }
+      }
+      if (!adapted) { w.clear(); }
+      return w;
+    }
+
+    mutable std::mutex mutex;
+    std::vector<Family> families;
+  };
 
   /// Splitter generator chooser: choose between several other node generators
   struct SplitterChooserGen : public i_GenNode {
@@ -37,11 +154,44 @@ namespace tempo::classifier::TSChief::snode::meta {
     /// How many splitter candidate to generate
     size_t nb_candidates;
 
+    /// Number of threads used to generate the candidates of a node with at least 'fork_min_size' exemplars
+    size_t nb_threads;
+
+    /// Nodes with at least 'fork_min_size' exemplars generate their candidates with forked states (see generate)
+    size_t fork_min_size;
+
+    /// Nodes with at least 'node_sample_min_size' exemplars score their candidates on a stratified sample of
+    /// ceil(node_sample_ratio*size) exemplars per class (at least one), then only split all their exemplars with the
+    /// chosen candidate (see i_GenNode::split_with). Candidates cost about 'node_sample_ratio' times as much, the
+    /// final split is exact. Off by default (ratio 1).
+    size_t node_sample_min_size{std::numeric_limits<size_t>::max()};
+    double node_sample_ratio{1};
+
+    /// If finite, budget of the estimated cost of the candidates (see i_GenNode::Result::cost) per exemplar of the
+    /// node: the candidates are generated in order while their total cost is below the budget of the node, and at
+    /// least one. Candidates with a large cost (e.g. wide windows on long series) use the budget of several cheaper
+    /// ones, bounding the training time of a node. Unbounded by default.
+    double cost_budget{std::numeric_limits<double>::infinity()};
+
+    /// If set, the generators are drawn with its weights, updated with the candidates of each node
+    /// (families in the order of the generators). Uniform draw by default.
+    std::shared_ptr<AdaptiveSampler> adaptive{};
+
     // --- --- --- Constructor/Destructor
 
-    SplitterChooserGen(std::vector<std::shared_ptr<i_GenNode>>&& sgvec, size_t nb_candidates) :
+    /** Choose the best of 'nb_candidates' splitters, picked at random from 'sgvec'.
+     *  By default, candidates are generated sequentially with the tree state.
+     * @param sgvec           Splitter generators
+     * @param nb_candidates   Number of candidates per node
+     * @param nb_threads      Number of threads generating the candidates of nodes with forked states
+     * @param fork_min_size   Minimum number of exemplars at a node to generate its candidates with forked states
+     */
+    SplitterChooserGen(std::vector<std::shared_ptr<i_GenNode>>&& sgvec, size_t nb_candidates,
+                       size_t nb_threads = 1, size_t fork_min_size = std::numeric_limits<size_t>::max()) :
       generators(std::move(sgvec)),
-      nb_candidates(nb_candidates) {
+      nb_candidates(nb_candidates),
+      nb_threads(nb_threads),
+      fork_min_size(fork_min_size) {
       if (generators.empty()) { throw std::invalid_argument("Empty set of generators to choose from"); }
     }
 
@@ -50,19 +200,154 @@ namespace tempo::classifier::TSChief::snode::meta {
     /// Implementation fo the generate function
     /// Randomly generate 'nb_candidates', evaluate them, keep the best (the lowest score is best)
     i_GenNode::Result generate(TreeState& state, TreeData const& data, const ByClassMap& bcm) override {
+      if (node_sample_ratio<1&&nb_candidates>1&&bcm.size()>=node_sample_min_size) {
+        i_GenNode::Result result = generate_sampled(state, data, bcm);
+        if (!result.dominated()) { return result; }
+      }
+      // Only the chosen candidate builds its branch splits
+      i_GenNode::Result result = choose(state, data, bcm).first;
+      result.materialize(bcm);
+      return result;
+    }
+
+    /// Choose the best candidate on a stratified sample of 'bcm' (see node_sample_ratio), and split all of 'bcm' with
+    /// it. Dominated if its generator cannot split with it (see i_GenNode::split_with).
+    i_GenNode::Result generate_sampled(TreeState& state, TreeData const& data, const ByClassMap& bcm) {
+      std::map<EL, size_t> nb_per_class;
+      for (const auto& [label, is] : bcm) {
+        nb_per_class[label] = std::max<size_t>(1, (size_t)std::ceil(node_sample_ratio*(double)is.size()));
+      }
+      const ByClassMap sample = bcm.stratified_draw(nb_per_class, state.prng);
+      auto [result, generator] = choose(state, data, sample);
+      if (result.dominated()) { return {}; }
+      return generator->split_with(state, data, bcm, std::move(result.splitter));
+    }
+
+    /// The best candidate, and the generator it comes from. The node then draws from a fresh stream below its own
+    /// (see TreeState::CHOSEN): not the numbers it drew before choosing (e.g. the sample of generate_sampled) again,
+    /// and the same ones whether its candidates were forked or not.
+    std::pair<i_GenNode::Result, i_GenNode *> choose(TreeState& state, TreeData const& data, const ByClassMap& bcm) {
+      const uint64_t node_stream = state.stream;
+      auto chosen = (nb_candidates>1&&bcm.size()>=fork_min_size) ? generate_forked(state, data, bcm)
+                                                                  : generate_sequential(state, data, bcm);
+      state.enter_stream(TreeState::derive_stream(node_stream, TreeState::CHOSEN, 0));
+      return chosen;
+    }
+
+    /// Generate the candidates one after the other with 'state', each on its own stream
+    std::pair<i_GenNode::Result, i_GenNode *> generate_sequential(TreeState& state, TreeData const& data,
+                                                                  const ByClassMap& bcm) {
       i_GenNode::Result best_result{};
-      double best_score = utils::PINF;
-      for (size_t i = 0; i<nb_candidates; ++i) {
-        // Pick a splitter and call it
-        i_GenNode::Result result = utils::pick_one(generators, state.prng)->generate(state, data, bcm);
-        double score = weighted_gini_impurity(result.branch_splits);
+      i_GenNode *best_generator = nullptr;
+      std::atomic<double> best_score = utils::PINF;
+      const uint64_t node_stream = state.stream;
+      const double budget = cost_budget*(double)bcm.size();
+      double spent = 0;
+      const std::vector<double> weights = adaptive ? adaptive->weights() : std::vector<double>{};
+      std::vector<size_t> picked;
+      std::vector<double> costs;
+      size_t winner = nb_candidates;
+      for (size_t i = 0; i<nb_candidates&&spent<budget; ++i) {
+        // Pick a splitter and call it. Candidates that cannot beat the best one are abandoned.
+        // Each candidate draws from its own stream, entered before it is evaluated (as a forked one): an abandoned
+        // candidate draws fewer random numbers, but does not shift the ones of the next candidates, nor the ones of
+        // the node (see choose). The chosen splitter and the tree only depend on the seed.
+        const utils::TraceScope trace("candidate", "train", "candidate", (int64_t)i);
+        state.enter_candidate(i, node_stream);
+        const size_t g = AdaptiveSampler::pick(weights, generators.size(), state.prng);
+        i_GenNode& generator = *generators[g];
+        i_GenNode::Result result = generator.generate_bounded(state, data, bcm, best_score);
+        spent += result.cost;
+        if (adaptive) {
+          picked.push_back(g);
+          costs.push_back(result.cost);
+        }
+        if (result.dominated()) { continue; }
+        const auto scope = state.time("train/node/gini");
+        double score = result.weighted_gini_impurity();
         if (score<best_score) {
           best_score = score;
           best_result = std::move(result);
+          best_generator = &generator;
+          winner = i;
         }
       }
+      if (adaptive) { adaptive->record(picked, costs, winner); }
       // Put the state back into the result
-      return best_result;
+      return {std::move(best_result), best_generator};
+    }
+
+    /// Generate each candidate with its own state, forked from 'state' on the stream of the candidate (the stream
+    /// 'generate' enters for it). Results are compared in candidate order: the chosen splitter is the one 'generate'
+    /// chooses without forking, whatever the number of threads.
+    /// The best score is shared between the candidates: a candidate is only abandoned when its score is greater
+    /// than the score of another one, so it could not have been chosen.
+    /// With a cost budget, the candidates are generated by waves of 'nb_threads', until the candidates 'generate'
+    /// would generate are done; the ones beyond are dropped. The best score then only shares the scores of the
+    /// previous waves: a dropped candidate must not abandon a kept one.
+    std::pair<i_GenNode::Result, i_GenNode *> generate_forked(TreeState& state, TreeData const& data,
+                                                              const ByClassMap& bcm) {
+      std::vector<std::unique_ptr<TreeState>> states;
+      states.reserve(nb_candidates);
+      for (size_t i = 0; i<nb_candidates; ++i) { states.push_back(state.candidate_fork(i)); }
+
+      // Note: each state/result slot is pre-allocated - no shared memory, no need for sync
+      std::vector<i_GenNode::Result> results(nb_candidates);
+      std::vector<size_t> candidate_generators(nb_candidates, 0);
+      std::vector<double> scores(nb_candidates, utils::PINF);
+      std::vector<double> costs(nb_candidates, 0);
+      std::atomic<double> best_score = utils::PINF;
+      const double budget = cost_budget*(double)bcm.size();
+      const bool bounded_cost = budget<std::numeric_limits<double>::infinity();
+      const std::vector<double> weights = adaptive ? adaptive->weights() : std::vector<double>{};
+      auto candidate_task = [&](size_t i) {
+        const utils::TraceScope trace("candidate", "train", "candidate", (int64_t)i);
+        TreeState& local_state = *states[i];
+        candidate_generators[i] = AdaptiveSampler::pick(weights, generators.size(), local_state.prng);
+        i_GenNode& generator = *generators[candidate_generators[i]];
+        results[i] = generator.generate_bounded(local_state, data, bcm, best_score);
+        costs[i] = results[i].cost;
+        if (results[i].dominated()) { return; }
+        const auto scope = local_state.time("train/node/gini");
+        scores[i] = results[i].weighted_gini_impurity();
+        if (bounded_cost) { return; }
+        // Atomic min
+        double current = best_score.load();
+        while (scores[i]<current&&!best_score.compare_exchange_weak(current, scores[i])) {}
+      };
+
+      const size_t wave_size = bounded_cost ? std::max<size_t>(nb_threads, 1) : nb_candidates;
+      size_t nb_kept = 0;
+      double spent = 0;
+      for (size_t wave_start = 0; wave_start<nb_candidates&&spent<budget; wave_start += wave_size) {
+        const size_t wave_stop = std::min(nb_candidates, wave_start + wave_size);
+        if (nb_threads<=1) {
+          for (size_t i = wave_start; i<wave_stop; ++i) { candidate_task(i); }
+        } else {
+          utils::ParTasks p;
+          for (size_t i = wave_start; i<wave_stop; ++i) { p.push_task_args(candidate_task, i); }
+          p.execute((int)std::min(nb_threads, wave_stop - wave_start));
+        }
+        // Keep the candidates started below the budget, sharing their best score with the next wave
+        double wave_best = best_score.load();
+        for (size_t i = wave_start; i<wave_stop&&spent<budget; ++i) {
+          spent += costs[i];
+          wave_best = std::min(wave_best, scores[i]);
+          nb_kept = i + 1;
+        }
+        best_score.store(wave_best);
+      }
+
+      // Merge the states back, and keep the first best among the kept candidates (as in the sequential version)
+      state.forest_merge_in_vec(std::move(states));
+      size_t best = 0;
+      for (size_t i = 1; i<nb_kept; ++i) { if (scores[i]<scores[best]) { best = i; } }
+      if (adaptive) {
+        candidate_generators.resize(nb_kept);
+        costs.resize(nb_kept);
+        adaptive->record(candidate_generators, costs, scores[best]<utils::PINF ? best : nb_kept);
+      }
+      return {std::move(results[best]), generators[candidate_generators[best]].get()};
     }
 
   };
@@ -90,7 +375,7 @@ namespace tempo::classifier::TSChief::snode::meta {
 
       for (const auto& candidate : generators) {
         i_GenNode::Result result = candidate->generate(state, data, bcm);
-        double score = weighted_gini_impurity(result.branch_splits);
+        double score = result.weighted_gini_impurity();
         if (score<best_score) {
           best_score = score;
           best_results.clear();
@@ -1,6 +1,10 @@
 #include "nn1_adtw.hpp"
 
 #include <tempo/distance/tseries.univariate.hpp>
+#include <tempo/distance/tseries.multivariate.hpp>
+#include <tempo/distance/stats.hpp>
+
+#include <numeric>
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
@@ -9,14 +13,122 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
   ADTW::ADTW(std::string tname, tempo::F cfe, tempo::F penalty)
-    : BaseDist(std::move(tname)), cfe(cfe), penalty(penalty) {}
+    : BaseDist(std::move(tname)), cfe(cfe), penalty(penalty), adtwfun(distance::univariate::adtw_for(cfe)) {}
+
+  bool ADTW::lb_prunable(size_t length, F cutoff) const {
+    if (!(penalty>0)||std::isinf(cutoff)||length==0) { return false; }
+    return distance::univariate::adtw_lb_window(length, penalty, cutoff)<length - 1;
+  }
 
   F ADTW::eval(const TSeries& t1, const TSeries& t2, F bsf) {
-    return distance::univariate::adtw(t1, t2, cfe, penalty, bsf);
+    if (!t1.is_univariate()) { return distance::multivariate::adtw(t1, t2, cfe, penalty, bsf); }
+    // A lower bound strictly above bsf implies ADTW > bsf: early abandon (ties are still computed)
+    if (t1.length()==t2.length()&&lb_prunable(t1.length(), bsf)) {
+      const F lb = distance::univariate::lb_ADTW(t2.data(), t1.data(), t1.length(), cfe, penalty, bsf);
+      if (distance::stats::lb(std::isinf(lb))) { return utils::PINF; }
+    }
+    if (auto const *qv = quantized_view(quantized.get(), t1)) {
+      return distance::univariate::adtw(*qv, t2.data(), t2.length(), cfe, penalty, bsf);
+    }
+    return adtwfun(t1.data(), t1.length(), t2.data(), t2.length(), cfe, penalty, bsf);
+  }
+
+  NNResult ADTW::eval_many(const TSeries& query, std::span<TSeries const *const> candidates, F bsf) {
+    const size_t length = query.length();
+    const bool same_length = std::all_of(candidates.begin(), candidates.end(),
+                                         [length](TSeries const *c) { return c->length()==length; });
+    if (length==0||!same_length||!query.is_univariate()) { return i_Dist::eval_many(query, candidates, bsf); }
+
+    // Per thread buffers, reused across the calls (the ADTW buffer is also per thread, see univariate::adtw)
+    thread_local std::vector<F> estimates;
+    thread_local std::vector<size_t> order;
+
+    // The diagonal cost is an upper bound of ADTW: close candidates have a small one
+    estimates.resize(candidates.size());
+    for (size_t i = 0; i<candidates.size(); ++i) {
+      estimates[i] = distance::univariate::directa(*candidates[i], query, cfe, utils::PINF);
+    }
+    order.resize(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [](size_t a, size_t b) { return estimates[a]<estimates[b]; });
+
+    // Lower bound of the candidates (see distance::univariate::lb_ADTW), with the envelopes of the query computed at
+    // the window of the cutoff, and again each time a smaller cutoff narrows the window
+    thread_local Envelopes query_env;
+    size_t env_window = length;
+    auto lb_pruned = [&](const TSeries& c, F cutoff) {
+      if (!lb_prunable(length, cutoff)) { return false; }
+      if (const size_t w = distance::univariate::adtw_lb_window(length, penalty, cutoff); w<env_window) {
+        distance::univariate::get_keogh_envelopes(query.data(), length, query_env.upper, query_env.lower, w);
+        env_window = w;
+      }
+      const F lb = distance::univariate::lb_Keogh(c, query_env.upper, query_env.lower, cfe, cutoff);
+      return distance::stats::lb(std::isinf(lb));
+    };
+
+    // Computed by batches of nb_lanes (see adtw_lanes)
+    const size_t lanes = distance::univariate::nb_lanes(cfe);
+    thread_local std::vector<F const *> batch_data;
+    thread_local std::vector<size_t> batch_pos;
+    thread_local std::vector<F> batch_cutoffs;
+    thread_local std::vector<F> batch_results;
+    return eval_in_order(candidates, order, lanes, bsf, [&](size_t const *idx, size_t nb, F cutoff, F *results) {
+      batch_data.clear();
+      batch_pos.clear();
+      for (size_t k = 0; k<nb; ++k) {
+        const TSeries& c = *candidates[idx[k]];
+        results[k] = utils::PINF;
+        if (lb_pruned(c, cutoff)) { continue; }
+        // Quantized candidates are computed on their codes, one at a time
+        if (auto const *qv = quantized_view(quantized.get(), c)) {
+          results[k] = distance::univariate::adtw(*qv, query.data(), length, cfe, penalty, cutoff);
+          continue;
+        }
+        batch_data.push_back(c.data());
+        batch_pos.push_back(k);
+      }
+      if (batch_data.size()==1) {
+        results[batch_pos[0]] = adtwfun(batch_data[0], length, query.data(), length, cfe, penalty, cutoff);
+      } else if (!batch_data.empty()) {
+        batch_cutoffs.assign(batch_data.size(), cutoff);
+        batch_results.resize(batch_data.size());
+        distance::univariate::adtw_lanes(query.data(), batch_data.data(), batch_data.size(), length, cfe, penalty,
+                                         batch_cutoffs.data(), batch_results.data());
+        for (size_t k = 0; k<batch_pos.size(); ++k) { results[batch_pos[k]] = batch_results[k]; }
+      }
+    });
+  }
+
+  NNResult ADTW::eval_many_derivative(TSeries const& raw_query, std::span<TSeries const *const> candidates, F bsf) {
+    if (!raw_query.is_univariate()) { return i_Dist::eval_many_derivative(raw_query, candidates, bsf); }
+    return eval_each(candidates, bsf, [&](size_t i, F cutoff) {
+      TSeries const& c = *candidates[i];
+      return distance::univariate::adtw_derived(c.data(), c.length(), raw_query.data(), raw_query.length(), cfe,
+                                                penalty, cutoff);
+    });
+  }
+
+  void ADTW::prepare(TreeData const& data, IndexSet const& /* train_is */) {
+    quantized = at_train_quantized(data);
+    adtwfun = distance::univariate::adtw_for(cfe, train_equal_length(data));
   }
 
   std::string ADTW::get_distance_name() { return "ADTW:" + std::to_string(cfe) + ":" + std::to_string(penalty); }
 
+  void ADTW::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(cfe);
+    out.write<F>(penalty);
+  }
+
+  std::unique_ptr<i_Dist> ADTW::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto cfe = in.read<F>();
+    const auto penalty = in.read<F>();
+    return std::make_unique<ADTW>(std::move(tname), cfe, penalty);
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // ADTW Splitter Generator
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -40,47 +152,99 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     size_t SAMPLE_SIZE,
     PRNG& prng,
     size_t NUMBER_PENALTY,
-    F OMEGA_EXPONENT
+    F OMEGA_EXPONENT,
+    size_t nb_threads
   ) {
     const F NBP = (F)NUMBER_PENALTY;
 
-    // Function's result accumulator
-    std::map<std::tuple<F, std::string>, std::vector<F>> result;
-
-    // For each transform
+    // Samples of one (cost function exponent, transform)
+    struct Sampling {
+      F e;
+      std::string const *tn;
+      DTS const *dts;
+      std::vector<std::pair<size_t, size_t>> pairs;
+      std::vector<F> costs;
+    };
+
+    // --- Draw all the samples, in order
+    std::vector<Sampling> samplings;
     for (auto const& tn : transforms) {
       auto const& dts = train_data.at(tn);
       if (dts.size()<=1) { throw std::invalid_argument("DataSplit transform " + tn + " as less than 2 values"); }
-
-      // For each cost function exponent
       for (auto const& e : exponent) {
-
-        // --- Sample
-        tempo::utils::StddevWelford welford;
+        Sampling sampling{e, &tn, &dts, {}, std::vector<F>(SAMPLE_SIZE)};
+        sampling.pairs.reserve(SAMPLE_SIZE);
         std::uniform_int_distribution<> distrib(0, (int)dts.size() - 1);
         for (size_t i = 0; i<SAMPLE_SIZE; ++i) {
-          const auto& q = dts[distrib(prng)];
-          const auto& s = dts[distrib(prng)];
-          const F cost = distance::univariate::directa(q, s, e, utils::PINF);
-          welford.update(cost);
-        }
-        F max_penalties = welford.get_mean();
-
-        // --- Compute and store penalties
-        std::vector<F> penalties;
-        penalties.reserve(NUMBER_PENALTY);
-        penalties.push_back(0.0);
-        for (size_t i = 1; i<NUMBER_PENALTY; ++i) {
-          const F penalty = std::pow((F)(F)i/NBP, OMEGA_EXPONENT)*max_penalties;
-          penalties.push_back(penalty);
+          const size_t q = distrib(prng);
+          const size_t s = distrib(prng);
+          sampling.pairs.emplace_back(q, s);
         }
+        samplings.push_back(std::move(sampling));
+      }
+    }
+
+    // --- Compute the costs in parallel, by chunks of samples
+    constexpr size_t CHUNK = 500;
+    tempo::utils::ParTasks ptasks;
+    for (auto& sampling : samplings) {
+      for (size_t start = 0; start<SAMPLE_SIZE; start += CHUNK) {
+        ptasks.push_task([&sampling, start, SAMPLE_SIZE]() {
+          const size_t stop = std::min(start + CHUNK, SAMPLE_SIZE);
+          DTS const& dts = *sampling.dts;
+          for (size_t i = start; i<stop; ++i) {
+            const auto [q, s] = sampling.pairs[i];
+            sampling.costs[i] = distance::multivariate::directa(dts[q], dts[s], sampling.e, utils::PINF);
+          }
+        });
+      }
+    }
+    ptasks.execute((int)nb_threads);
+
+    // Function's result accumulator
+    std::map<std::tuple<F, std::string>, std::vector<F>> result;
 
-        // --- Store mapping
-        result[std::tuple(e, tn)] = std::move(penalties);
+    for (auto const& sampling : samplings) {
+      tempo::utils::StddevWelford welford;
+      for (F cost : sampling.costs) { welford.update(cost); }
+      F max_penalties = welford.get_mean();
+
+      // --- Compute and store penalties
+      std::vector<F> penalties;
+      penalties.reserve(NUMBER_PENALTY);
+      penalties.push_back(0.0);
+      for (size_t i = 1; i<NUMBER_PENALTY; ++i) {
+        const F penalty = std::pow((F)(F)i/NBP, OMEGA_EXPONENT)*max_penalties;
+        penalties.push_back(penalty);
       }
+
+      // --- Store mapping
+      result[std::tuple(sampling.e, *sampling.tn)] = std::move(penalties);
     }
 
     return result;
   }
 
+  nlohmann::json ADTWGen::penalties_to_json(std::map<std::tuple<F, std::string>, std::vector<F>> const& penalties) {
+    nlohmann::json j = nlohmann::json::array();
+    for (auto const& [key, values] : penalties) {
+      nlohmann::json jp;
+      jp["exponent"] = std::get<0>(key);
+      jp["transform"] = std::get<1>(key);
+      jp["penalties"] = values;
+      j.push_back(std::move(jp));
+    }
+    return j;
+  }
+
+  std::map<std::tuple<F, std::string>, std::vector<F>> ADTWGen::penalties_from_json(nlohmann::json const& j) {
+    std::map<std::tuple<F, std::string>, std::vector<F>> result;
+    for (auto const& jp : j) {
+      const F e = jp.at("exponent").get<F>();
+      const std::string tn = jp.at("transform").get<std::string>();
+      result[std::tuple(e, tn)] = jp.at("penalties").get<std::vector<F>>();
+    }
+    return result;
+  }
+
 } // End of namespace tempo::classifier::PF2::snode::nn1splitter
@@ -2,6 +2,8 @@
 
 #include "nn1dist_base.hpp"
 
+#include <tempo/distance/univariate.hpp>
+
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
   /** BaseDist ADTW wrapper
@@ -11,11 +13,43 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     F cfe;
     F penalty;
 
+    /// ADTW specialised for 'cfe', selected at construction.
+    /// 'prepare' selects the equal length ADTW for train data without variable length (see train_equal_length).
+    distance::univariate::ADTWFun<F> adtwfun;
+
+    /// Quantized train exemplars obtained by 'prepare' (see at_train_quantized), null if none:
+    /// ADTW is then computed on their codes
+    std::shared_ptr<QuantizedExemplars const> quantized;
+
     ADTW(std::string tname, F cfe, F penalty);
 
+    /// Univariate same length series are first checked against the ADTW lower bound (see lb_prunable)
     F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
 
+    /// Visit the candidates by increasing diagonal (direct alignment) cost, an estimate of ADTW.
+    /// Candidates passing the ADTW lower bound are computed by batches, in SIMD lanes when possible
+    /// (see distance::univariate::adtw_lanes)
+    NNResult eval_many(const TSeries& query, std::span<TSeries const *const> candidates, F bsf) override;
+
+    /// Univariate queries: ADTW with the derivative computed in the cost function (see univariate::adtw_derived),
+    /// without the lower bounds, which need the derived query
+    NNResult eval_many_derivative(TSeries const& raw_query, std::span<TSeries const *const> candidates,
+                                  F bsf) override;
+
+    void prepare(TreeData const& data, IndexSet const& train_is) override;
+
+    /// The ADTW lower bound (LB Keogh at the window distance::univariate::adtw_lb_window) is only tried with a
+    /// penalty and a cutoff narrowing the window below the length of the series: else no warping is excluded
+    bool lb_prunable(size_t length, F cutoff) const;
+
     std::string get_distance_name() override;
+
+    /// Tag used in the model format
+    inline static const std::string tag{"ADTW"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
   };
 
 
@@ -46,8 +80,10 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
      * @param prng              source of randomness for sampling
      * @param NUMBER_PENALTY    how many penalties (parameters) to generate per (cost function exponent, transform)
      * @param OMEGA_EXPONENT    omega used when generating penalties
+     * @param nb_threads        number of threads computing the sampled costs
      * Given a sampled max penalty S, penalties are generated with
      *  S*(i/NUMBER_PENALTY)^OMEGA_EXPONENT for i in [0, NUMBER_PENALTY[
+     * The samples are drawn from prng before any cost computation: the result does not depend on nb_threads.
      * @return a mapping (cost function exponent, transform)-> vec<penalties>
      */
     static std::map<std::tuple<F, std::string>, std::vector<F>> do_sampling(
@@ -57,9 +93,16 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
       size_t SAMPLE_SIZE,
       PRNG& prng,
       size_t NUMBER_PENALTY = 100,
-      F OMEGA_EXPONENT = 5.0
+      F OMEGA_EXPONENT = 5.0,
+      size_t nb_threads = 1
     );
 
+    /// Penalties as a JSON array of {"exponent", "transform", "penalties"} objects, e.g. to save a sampling
+    static nlohmann::json penalties_to_json(std::map<std::tuple<F, std::string>, std::vector<F>> const& penalties);
+
+    /// Penalties from a JSON array produced by penalties_to_json. Throw nlohmann::json::exception on bad format.
+    static std::map<std::tuple<F, std::string>, std::vector<F>> penalties_from_json(nlohmann::json const& j);
+
   };
 
 } // End of namespace tempo::classifier::PF2::snode::nn1splitter
\ No newline at end of file
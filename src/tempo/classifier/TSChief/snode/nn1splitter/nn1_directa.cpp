@@ -1,6 +1,6 @@
 #include "nn1_directa.hpp"
 
-#include <tempo/distance/tseries.univariate.hpp>
+#include <tempo/distance/tseries.multivariate.hpp>
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
@@ -11,13 +11,25 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
   DA::DA(std::string tname, F cfe) : BaseDist(std::move(tname)), cfe(cfe) {}
 
   F DA::eval(const TSeries& t1, const TSeries& t2, F bsf) {
-    return distance::univariate::directa(t1, t2, cfe, bsf);
+    return distance::multivariate::directa(t1, t2, cfe, bsf);
   }
 
   std::string DA::get_distance_name() {
     return "DA:" + std::to_string(cfe);
   }
 
+  void DA::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(cfe);
+  }
+
+  std::unique_ptr<i_Dist> DA::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto cfe = in.read<F>();
+    return std::make_unique<DA>(std::move(tname), cfe);
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // DA splitter Generator
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -12,6 +12,15 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
 
     std::string get_distance_name() override;
+
+    double cost(size_t length) const override { return (double)length; }
+
+    /// Tag used in the model format
+    inline static const std::string tag{"DA"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
   };
 
   struct DAGen : public i_GenDist {
@@ -1,34 +1,303 @@
 #include "nn1_dtw.hpp"
+#include <tempo/distance/cost_functions.hpp>
 #include <tempo/distance/tseries.univariate.hpp>
+#include <tempo/distance/tseries.multivariate.hpp>
+#include <tempo/distance/stats.hpp>
+#include <tempo/transform/core/univariate.paa.hpp>
+
+#include <numeric>
+#include <sstream>
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
+  namespace {
+
+    /// Number of bands used by LB Enhanced (speed/tightness trade-off)
+    constexpr size_t LB_ENHANCED_V = 5;
+
+    /// LB Enhanced only tightens LB Keogh near the ends of the series: from windows of a quarter of the length,
+    /// the cascade uses LB Improved or LB Petitjean instead, when they are lower bounds (cfe of at least 1)
+    bool large_window(size_t w, size_t length, F cfe) { return cfe>=1&&w>=length/4; }
+
+  } // End of anonymous namespace
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // DTW Wrapper
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
-  DTW::DTW(std::string tname, F cfe, size_t w) : BaseDist(std::move(tname)), cfe(cfe), w(w) {}
+  DTW::DTW(std::string tname, F cfe, size_t w, bool lb_cascade, size_t paa_factor, F paa_tolerance) :
+    BaseDist(std::move(tname)), cfe(cfe), w(w),
+    dtwfun(distance::univariate::dtw_for(cfe)),
+    costfun(distance::univariate::adc_for(cfe)),
+    lb_cascade(lb_cascade),
+    paa_factor(paa_factor),
+    paa_tolerance(paa_tolerance) {}
+
+  std::vector<F> const *DTW::coarse_exemplar(F const *data) const {
+    if (paa_factor<2) { return nullptr; }
+    auto it = paa_exemplars.find(data);
+    return it==paa_exemplars.end() ? nullptr : &it->second;
+  }
+
+  bool DTW::coarse_pruned(std::vector<F> const& exemplar_paa, std::vector<F> const& query_paa, F cutoff) const {
+    if (std::isinf(cutoff)||exemplar_paa.size()!=query_paa.size()) { return false; }
+    const size_t wc = transform::core::univariate::paa_length(w, paa_factor);
+    const F coarse_cutoff = paa_tolerance*cutoff/(F)paa_factor;
+    const size_t l = query_paa.size();
+    return std::isinf(dtwfun(exemplar_paa.data(), l, query_paa.data(), l, cfe, wc, coarse_cutoff));
+  }
 
   F DTW::eval(const TSeries& t1, const TSeries& t2, F bsf) {
-    return distance::univariate::dtw(t1, t2, cfe, w, bsf);
+    namespace tdu = distance::univariate;
+    namespace stats = distance::stats;
+    // Dependent multivariate DTW: no lower bound
+    if (!t1.is_univariate()) { return distance::multivariate::dtw(t1, t2, cfe, w, bsf); }
+    // Lower bound cascade: only with a cutoff, for same length series, and if t1 is a prepared train exemplar.
+    // A lower bound strictly above bsf implies DTW > bsf: early abandon (ties are still computed)
+    // The cumulative bound of LB Keogh then tightens the pruning of the DTW, with t2 as the lines (see dtw_cb)
+    thread_local std::vector<F> cb;
+    bool has_cb = false;
+    if (lb_cascade&&!std::isinf(bsf)&&t1.length()==t2.length()&&t1.length()>0) {
+      if (auto it = envelopes.find(t1.data()); it!=envelopes.end()) {
+        const size_t last = t1.length() - 1;
+        // LB Kim: first and last alignments
+        F lb = costfun(t1[0], t2[0], cfe);
+        if (last>0) { lb += costfun(t1[last], t2[last], cfe); }
+        if (stats::lb(lb>bsf)) { return utils::PINF; }
+        // LB Keogh, then LB Enhanced, with t2 as the query
+        const Envelopes& env = *it->second;
+        cb.resize(t2.length() + 1);
+        const F lbk = tdu::lb_Keogh_cumulative(t2.data(), t2.length(), env.upper.data(), env.lower.data(), cfe,
+                                               cb.data());
+        if (stats::lb(lbk>bsf)) { return utils::PINF; }
+        has_cb = true;
+        if (large_window(w, t2.length(), cfe)) {
+          const F lbi = tdu::lb_Improved(t2.data(), t2.length(), t1.data(), env.upper.data(), env.lower.data(), cfe,
+                                         w, bsf);
+          if (stats::lb(std::isinf(lbi))) { return utils::PINF; }
+        } else if (stats::lb(std::isinf(tdu::lb_Enhanced(t2, t1, env.upper, env.lower, cfe, LB_ENHANCED_V, w, bsf)))) {
+          return utils::PINF;
+        }
+      }
+    }
+    // Coarse to fine: t2, the query, is reduced at each call
+    if (auto const *cpaa = coarse_exemplar(t1.data()); cpaa!=nullptr&&!std::isinf(bsf)&&t1.length()==t2.length()) {
+      thread_local std::vector<F> query_paa;
+      query_paa.resize(transform::core::univariate::paa_length(t2.length(), paa_factor));
+      transform::core::univariate::paa<F>(t2.data(), t2.length(), paa_factor, query_paa.data());
+      if (stats::lb(coarse_pruned(*cpaa, query_paa, bsf))) { return utils::PINF; }
+    }
+    if (auto const *qv = quantized_view(quantized.get(), t1)) {
+      return tdu::dtw(*qv, t2.data(), t2.length(), cfe, w, bsf);
+    }
+    // DTW is symmetric
+    if (has_cb) { return tdu::dtw_cb(t2.data(), t2.length(), t1.data(), t1.length(), cfe, w, bsf, cb.data()); }
+    return dtwfun(t1.data(), t1.length(), t2.data(), t2.length(), cfe, w, bsf);
+  }
+
+  bool DTW::lb_searchable(TSeries const& query, std::span<TSeries const *const> candidates) const {
+    const size_t length = query.length();
+    const bool same_length = std::all_of(candidates.begin(), candidates.end(),
+                                         [length](TSeries const *c) { return c->length()==length; });
+    return lb_cascade&&length>0&&same_length&&query.is_univariate();
+  }
+
+  NNResult DTW::eval_many(const TSeries& query, std::span<TSeries const *const> candidates, F bsf) {
+    if (!lb_searchable(query, candidates)) { return i_Dist::eval_many(query, candidates, bsf); }
+    // Envelopes of the query, computed once for all the candidates
+    thread_local Envelopes query_env;
+    distance::univariate::get_keogh_envelopes(query.data(), query.length(), query_env.upper, query_env.lower, w);
+    return eval_many_impl(query, query_env, candidates, bsf);
+  }
+
+  NNResult DTW::eval_many_test(TreeData const& data, size_t test_idx, TSeries const& query,
+                               std::span<TSeries const *const> candidates, F bsf) {
+    if (!lb_searchable(query, candidates)) { return i_Dist::eval_many(query, candidates, bsf); }
+    const DTS& test_dataset = at_test(data, transform_id(data, transformation_name));
+    const auto query_env = at_test_envelopes(data).get(test_dataset, transformation_name, test_idx, w);
+    return eval_many_impl(query, *query_env, candidates, bsf);
+  }
+
+  NNResult DTW::eval_many_impl(TSeries const& query, Envelopes const& query_env,
+                               std::span<TSeries const *const> candidates, F bsf) {
+    namespace tdu = distance::univariate;
+    namespace stats = distance::stats;
+    const size_t length = query.length();
+
+    // Per thread buffers, reused across the calls (the DTW buffer is also per thread, see univariate::dtw)
+    thread_local std::vector<F> lbs;
+    thread_local std::vector<Envelopes const *> cand_env;
+    thread_local std::vector<size_t> order;
+    thread_local std::vector<F> cb;
+
+    // PAA of the query for the coarse to fine filter, computed once for all the candidates
+    thread_local std::vector<F> query_paa;
+    if (paa_factor>1) {
+      query_paa.resize(transform::core::univariate::paa_length(length, paa_factor));
+      transform::core::univariate::paa<F>(query.data(), length, paa_factor, query_paa.data());
+    }
+
+    // Lower bound per candidate: LB Kim, and LB Keogh in both directions when the candidate is prepared
+    const size_t last = length - 1;
+    lbs.resize(candidates.size());
+    cand_env.resize(candidates.size());
+    for (size_t i = 0; i<candidates.size(); ++i) {
+      const TSeries& c = *candidates[i];
+      F lb = costfun(c[0], query[0], cfe);
+      if (last>0) { lb += costfun(c[last], query[last], cfe); }
+      lb = std::max(lb, tdu::lb_Keogh(c, query_env.upper, query_env.lower, cfe, utils::PINF));
+      cand_env[i] = nullptr;
+      if (auto it = envelopes.find(c.data()); it!=envelopes.end()) {
+        cand_env[i] = it->second.get();
+        lb = std::max(lb, tdu::lb_Keogh(query, cand_env[i]->upper, cand_env[i]->lower, cfe, utils::PINF));
+      }
+      lbs[i] = lb;
+    }
+
+    // Visit the candidates by increasing lower bound: the nearest ones usually come first
+    order.resize(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [](size_t a, size_t b) { return lbs[a]<lbs[b]; });
+
+    // Candidates passing the lower bounds are computed together, by batches of nb_lanes (see dtw_lanes)
+    const size_t lanes = tdu::nb_lanes(cfe);
+    thread_local std::vector<F const *> batch_data;
+    thread_local std::vector<size_t> batch_pos;
+    thread_local std::vector<F> batch_cutoffs;
+    thread_local std::vector<F> batch_results;
+    return eval_in_order(candidates, order, lanes, bsf, [&](size_t const *idx, size_t nb, F cutoff, F *results) {
+      batch_data.clear();
+      batch_pos.clear();
+      for (size_t k = 0; k<nb; ++k) {
+        const size_t i = idx[k];
+        results[k] = utils::PINF;
+        // A lower bound strictly above the cutoff implies DTW > cutoff (ties are still computed)
+        if (stats::lb(lbs[i]>cutoff)) { continue; }
+        const TSeries& c = *candidates[i];
+        if (cand_env[i]!=nullptr&&!std::isinf(cutoff)) {
+          const Envelopes& env = *cand_env[i];
+          const F lbe = large_window(w, length, cfe)
+                        ? tdu::lb_Petitjean(query.data(), length, query_env.upper.data(), query_env.lower.data(),
+                                            c.data(), env.upper.data(), env.lower.data(), cfe, w, cutoff)
+                        : tdu::lb_Enhanced(query, c, env.upper, env.lower, cfe, LB_ENHANCED_V, w, cutoff);
+          if (stats::lb(std::isinf(lbe))) { continue; }
+        }
+        if (auto const *cpaa = coarse_exemplar(c.data()); cpaa!=nullptr) {
+          if (stats::lb(coarse_pruned(*cpaa, query_paa, cutoff))) { continue; }
+        }
+        if (auto const *qv = quantized_view(quantized.get(), c)) {
+          results[k] = tdu::dtw(*qv, query.data(), length, cfe, w, cutoff);
+          continue;
+        }
+        batch_data.push_back(c.data());
+        batch_pos.push_back(k);
+      }
+      if (batch_data.size()==1) {
+        // Alone: the cumulative bound of LB Keogh of the candidate tightens the pruning of its lines (see dtw_cb)
+        F const *cd = batch_data[0];
+        cb.resize(length + 1);
+        tdu::lb_Keogh_cumulative(cd, length, query_env.upper.data(), query_env.lower.data(), cfe, cb.data());
+        results[batch_pos[0]] = tdu::dtw_cb(cd, length, query.data(), length, cfe, w, cutoff, cb.data());
+      } else if (!batch_data.empty()) {
+        batch_cutoffs.assign(batch_data.size(), cutoff);
+        batch_results.resize(batch_data.size());
+        tdu::dtw_lanes(query.data(), batch_data.data(), batch_data.size(), length, cfe, w,
+                       batch_cutoffs.data(), batch_results.data());
+        for (size_t k = 0; k<batch_pos.size(); ++k) { results[batch_pos[k]] = batch_results[k]; }
+      }
+    });
+  }
+
+  NNResult DTW::eval_many_derivative(TSeries const& raw_query, std::span<TSeries const *const> candidates, F bsf) {
+    if (!raw_query.is_univariate()) { return i_Dist::eval_many_derivative(raw_query, candidates, bsf); }
+    return eval_each(candidates, bsf, [&](size_t i, F cutoff) {
+      TSeries const& c = *candidates[i];
+      return distance::univariate::dtw_derived(c.data(), c.length(), raw_query.data(), raw_query.length(), cfe,
+                                               w, cutoff);
+    });
+  }
+
+  void DTW::prepare(TreeData const& data, IndexSet const& train_is) {
+    quantized = at_train_quantized(data);
+    dtwfun = distance::univariate::dtw_for(cfe, train_equal_length(data));
+    envelopes.clear();
+    paa_exemplars.clear();
+    if (!lb_cascade&&paa_factor<2) { return; }
+    const DTS& train_dataset = at_train(data, transform_id(data, transformation_name));
+    // The envelopes and the PAA are univariate (see eval)
+    if (train_dataset.header().nb_dimensions()>1) { return; }
+    if (paa_factor>1) {
+      for (size_t idx : train_is) {
+        TSeries const& s = train_dataset[idx];
+        std::vector<F>& p = paa_exemplars[s.data()];
+        p.resize(transform::core::univariate::paa_length(s.length(), paa_factor));
+        transform::core::univariate::paa<F>(s.data(), s.length(), paa_factor, p.data());
+      }
+    }
+    if (!lb_cascade) { return; }
+    const EnvelopesCache& cache = at_train_envelopes(data);
+    for (size_t idx : train_is) {
+      envelopes[train_dataset[idx].data()] = cache.get(train_dataset, transformation_name, idx, w);
+    }
   }
 
   std::string DTW::get_distance_name() {
     return "DTW:" + std::to_string(cfe) + ":" + std::to_string(w);
   }
 
+  std::optional<WindowFamily> DTW::window_family() const {
+    if (paa_factor>1) { return {}; }
+    std::ostringstream oss;
+    BinWriter writer(oss);
+    writer.write_string(tag);
+    writer.write_string(transformation_name);
+    writer.write<F>(cfe);
+    return WindowFamily{oss.str(), w};
+  }
+
+  void DTW::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(cfe);
+    out.write<size_t>(w);
+    // Bit 0: lb_cascade; bit 1: coarse to fine parameters follow (older models only have bit 0)
+    const bool coarse = paa_factor>1;
+    out.write<uint8_t>((lb_cascade ? 1 : 0) | (coarse ? 2 : 0));
+    if (coarse) {
+      out.write<size_t>(paa_factor);
+      out.write<F>(paa_tolerance);
+    }
+  }
+
+  std::unique_ptr<i_Dist> DTW::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto cfe = in.read<F>();
+    const auto w = in.read<size_t>();
+    const auto flags = in.read<uint8_t>();
+    const bool lb_cascade = (flags & 1)!=0;
+    size_t paa_factor = 0;
+    F paa_tolerance = 1;
+    if ((flags & 2)!=0) {
+      paa_factor = in.read<size_t>();
+      paa_tolerance = in.read<F>();
+    }
+    return std::make_unique<DTW>(std::move(tname), cfe, w, lb_cascade, paa_factor, paa_tolerance);
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // DTW splitter Generator
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
-  DTWGen::DTWGen(TransformGetter gt, ExponentGetter get_cfe, WindowGetter get_win) :
-    get_transform(std::move(gt)), get_cfe(std::move(get_cfe)), get_win(std::move(get_win)) {}
+  DTWGen::DTWGen(TransformGetter gt, ExponentGetter get_cfe, WindowGetter get_win, bool lb_cascade,
+                 size_t paa_factor, F paa_tolerance) :
+    get_transform(std::move(gt)), get_cfe(std::move(get_cfe)), get_win(std::move(get_win)), lb_cascade(lb_cascade),
+    paa_factor(paa_factor), paa_tolerance(paa_tolerance) {}
 
   std::unique_ptr<i_Dist> DTWGen::generate(TreeState& state, TreeData const& data, const ByClassMap& /* bcm */) {
     const std::string tn = get_transform(state);
     const F e = get_cfe(state);
     const size_t w = get_win(state, data);
-    return std::make_unique<DTW>(tn, e, w);
+    return std::make_unique<DTW>(tn, e, w, lb_cascade, paa_factor, paa_tolerance);
   }
 
 } // End of namespace tempo::classifier::PF2::snode::nn1splitter
@@ -2,25 +2,105 @@
 
 #include "nn1dist_base.hpp"
 
+#include <tempo/distance/univariate.hpp>
+
+#include <map>
+#include <vector>
+
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
   struct DTW : public BaseDist {
     F cfe;
     size_t w;
 
-    DTW(std::string tname, F cfe, size_t w);
+    /// DTW and cost function specialised for 'cfe', selected at construction.
+    /// 'prepare' selects the equal length DTW for train data without variable length (see train_equal_length).
+    distance::univariate::DTWFun<F> dtwfun;
+    F (*costfun)(F, F, F);
+
+    /// Use the LB_Kim -> LB_Keogh -> LB_Enhanced cascade before computing DTW
+    bool lb_cascade;
+
+    /// Envelopes of the train exemplars for 'w', obtained by 'prepare' from the shared cache (see at_train_envelopes),
+    /// indexed by the exemplars' raw data pointer
+    std::map<F const *, std::shared_ptr<const Envelopes>> envelopes;
+
+    /// Quantized train exemplars obtained by 'prepare' (see at_train_quantized), null if none:
+    /// DTW is then computed on their codes
+    std::shared_ptr<QuantizedExemplars const> quantized;
+
+    /// If not 0, coarse to fine DTW: a candidate is first compared to the query on their PAA by segments of
+    /// 'paa_factor' values (see transform::core::univariate::paa), with the window ceil(w/paa_factor). It is pruned
+    /// if this coarse DTW, scaled by 'paa_factor', is above paa_tolerance*cutoff; else DTW is computed at full
+    /// resolution. A heuristic, not a lower bound: a higher tolerance prunes less, for a result closer to plain DTW.
+    size_t paa_factor{0};
+    F paa_tolerance{1};
+
+    /// PAA of the train exemplars obtained by 'prepare' when paa_factor is not 0, indexed by their raw data pointer
+    std::map<F const *, std::vector<F>> paa_exemplars;
+
+    /// True if the coarse DTW between the PAA of an exemplar and of the query prunes the exemplar for 'cutoff'.
+    /// Never prunes without cutoff, or for PAA of different lengths.
+    bool coarse_pruned(std::vector<F> const& exemplar_paa, std::vector<F> const& query_paa, F cutoff) const;
+
+    DTW(std::string tname, F cfe, size_t w, bool lb_cascade = true, size_t paa_factor = 0, F paa_tolerance = 1);
 
     F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
 
+    /// Lower bound all the candidates first (reusing the query's envelopes), then visit them by increasing bound.
+    /// The candidates are computed by batches, in SIMD lanes when possible (see distance::univariate::dtw_lanes)
+    NNResult eval_many(const TSeries& query, std::span<TSeries const *const> candidates, F bsf) override;
+
+    /// The envelopes of the query are taken from the shared test cache (see at_test_envelopes): computed once per test
+    /// series and window for all the nodes and trees
+    NNResult eval_many_test(TreeData const& data, size_t test_idx, TSeries const& query,
+                            std::span<TSeries const *const> candidates, F bsf) override;
+
+    /// Univariate queries: DTW with the derivative computed in the cost function (see univariate::dtw_derived),
+    /// without the lower bounds, which need the derived query
+    NNResult eval_many_derivative(TSeries const& raw_query, std::span<TSeries const *const> candidates,
+                                  F bsf) override;
+
+    void prepare(TreeData const& data, IndexSet const& train_is) override;
+
     std::string get_distance_name() override;
+
+    double cost(size_t length) const override { return windowed_cost(length, w); }
+
+    /// DTW is non increasing with its window, except with the coarse to fine heuristic
+    std::optional<WindowFamily> window_family() const override;
+
+    /// Tag used in the model format
+    inline static const std::string tag{"DTW"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
+
+  private:
+
+    /// True if the lower bounds apply to the search of 'query' in 'candidates' (see eval_many)
+    bool lb_searchable(TSeries const& query, std::span<TSeries const *const> candidates) const;
+
+    /// eval_many with the envelopes of the query for 'w'
+    NNResult eval_many_impl(TSeries const& query, Envelopes const& query_env,
+                            std::span<TSeries const *const> candidates, F bsf);
+
+    /// PAA of the prepared train exemplar 'data', null if none or if the coarse to fine filter is off
+    std::vector<F> const *coarse_exemplar(F const *data) const;
   };
 
   struct DTWGen : public i_GenDist {
     TransformGetter get_transform;
     ExponentGetter get_cfe;
     WindowGetter get_win;
+    bool lb_cascade;
+    /// Coarse to fine parameters of the generated DTW (see DTW::paa_factor)
+    size_t paa_factor;
+    F paa_tolerance;
 
-    DTWGen(TransformGetter gt, ExponentGetter get_cfe, WindowGetter get_win);
+    DTWGen(TransformGetter gt, ExponentGetter get_cfe, WindowGetter get_win, bool lb_cascade = true,
+           size_t paa_factor = 0, F paa_tolerance = 1);
 
     std::unique_ptr<i_Dist> generate(TreeState& state, TreeData const& data, const ByClassMap& /* bcm */) override;
   };
@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "nn1_dtw.hpp"
+
+#include <tempo/transform/core/univariate.paa.hpp>
+
+#include <vector>
+
+using namespace tempo;
+using namespace tempo::classifier::TSChief::snode::nn1splitter;
+namespace tcu = tempo::transform::core::univariate;
+
+namespace {
+
+  constexpr F PINF = tempo::utils::PINF;
+
+  /// PAA by segments of 'factor' of a series of 'length' values all equal to 'v'
+  std::vector<F> constant_paa(size_t length, size_t factor, F v) {
+    const std::vector<F> series(length, v);
+    std::vector<F> paa(tcu::paa_length(length, factor));
+    tcu::paa<F>(series.data(), length, factor, paa.data());
+    return paa;
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// The coarse DTW, scaled by the PAA factor, prunes a candidate when it is above the tolerance times the cutoff.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("DTW coarse to fine pruning", "[nn1][dtw][paa]") {
+  constexpr size_t length = 16;
+  constexpr size_t factor = 4;
+  // Series of 0 and of 1, squared cost: the coarse DTW (4 segments, window 0) is 4, i.e. 16 once scaled by the factor
+  const std::vector<F> zeros = constant_paa(length, factor, 0);
+  const std::vector<F> ones = constant_paa(length, factor, 1);
+  const DTW dtw("default", 2, 0, true, factor, 1);
+
+  SECTION("Pruned above the cutoff") {
+    REQUIRE(dtw.coarse_pruned(zeros, ones, 8));
+    REQUIRE(dtw.coarse_pruned(zeros, ones, 15));
+    REQUIRE_FALSE(dtw.coarse_pruned(zeros, ones, 16));
+    REQUIRE_FALSE(dtw.coarse_pruned(zeros, zeros, 1));
+  }
+
+  SECTION("The tolerance scales the cutoff") {
+    const DTW tolerant("default", 2, 0, true, factor, 2);
+    REQUIRE_FALSE(tolerant.coarse_pruned(zeros, ones, 8));
+    REQUIRE(tolerant.coarse_pruned(zeros, ones, 7));
+  }
+
+  SECTION("Never pruned without cutoff or for different lengths") {
+    REQUIRE_FALSE(dtw.coarse_pruned(zeros, ones, PINF));
+    REQUIRE_FALSE(dtw.coarse_pruned(zeros, constant_paa(2*length, factor, 1), 1));
+  }
+}
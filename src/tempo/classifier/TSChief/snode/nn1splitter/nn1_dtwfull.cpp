@@ -1,6 +1,7 @@
 #include "nn1_dtwfull.hpp"
 
 #include <tempo/distance/tseries.univariate.hpp>
+#include <tempo/distance/tseries.multivariate.hpp>
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
@@ -8,14 +9,28 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
   // DTWFull Wrapper
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
-  DTWFull::DTWFull(std::string tname, F cfe) : BaseDist(std::move(tname)), cfe(cfe) {}
+  DTWFull::DTWFull(std::string tname, F cfe) :
+    BaseDist(std::move(tname)), cfe(cfe), dtwfun(distance::univariate::dtw_for(cfe)) {}
 
   F DTWFull::eval(const TSeries& t1, const TSeries& t2, F bsf) {
-    return distance::univariate::dtw(t1, t2, cfe, utils::NO_WINDOW, bsf);
+    if (!t1.is_univariate()) { return distance::multivariate::dtw(t1, t2, cfe, utils::NO_WINDOW, bsf); }
+    return dtwfun(t1.data(), t1.length(), t2.data(), t2.length(), cfe, utils::NO_WINDOW, bsf);
   }
 
   std::string DTWFull::get_distance_name() { return "DTWFull:" + std::to_string(cfe); }
 
+  void DTWFull::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(cfe);
+  }
+
+  std::unique_ptr<i_Dist> DTWFull::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto cfe = in.read<F>();
+    return std::make_unique<DTWFull>(std::move(tname), cfe);
+  }
+
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // DTWFull splitter Generator
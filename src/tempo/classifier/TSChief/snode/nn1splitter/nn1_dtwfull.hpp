@@ -2,16 +2,28 @@
 
 #include "nn1dist_base.hpp"
 
+#include <tempo/distance/univariate.hpp>
+
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
   struct DTWFull : public BaseDist {
     F cfe;
 
+    /// DTW specialised for 'cfe', selected at construction
+    distance::univariate::DTWFun<F> dtwfun;
+
     DTWFull(std::string tname, F cfe);
 
     F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
 
     std::string get_distance_name() override;
+
+    /// Tag used in the model format
+    inline static const std::string tag{"DTWFull"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
   };
 
   struct DTWFullGen : public i_GenDist {
@@ -1,6 +1,7 @@
 #include "nn1_erp.hpp"
 
 #include <tempo/distance/tseries.univariate.hpp>
+#include <tempo/distance/stats.hpp>
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
@@ -8,16 +9,83 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
   // ERP Wrapper
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
-  ERP::ERP(std::string tname, F cfe, F gv, size_t w) : BaseDist(std::move(tname)), cfe(cfe), gv(gv), w(w) {}
+  ERP::ERP(std::string tname, F cfe, F gv, size_t w) :
+    BaseDist(std::move(tname)), cfe(cfe), gv(gv), w(w), erpfun(distance::univariate::erp_gaps_for(cfe)) {}
 
   F ERP::eval(const TSeries& t1, const TSeries& t2, F bsf) {
-    return distance::univariate::erp(t1, t2, cfe, gv, w, bsf);
+    thread_local std::vector<F> buffer1, buffer2;
+    return eval_gaps(t1, get_gaps(t1, buffer1), t2, get_gaps(t2, buffer2), bsf);
+  }
+
+  NNResult ERP::eval_many(TSeries const& query, std::span<TSeries const *const> candidates, F bsf) {
+    thread_local std::vector<F> qbuffer, cbuffer;
+    F const *qgaps = get_gaps(query, qbuffer);
+    return eval_each(candidates, bsf, [&](size_t i, F cutoff) {
+      TSeries const& c = *candidates[i];
+      return eval_gaps(c, get_gaps(c, cbuffer), query, qgaps, cutoff);
+    });
+  }
+
+  F const *ERP::get_gaps(TSeries const& t, std::vector<F>& buffer) const {
+    if (auto it = gap_costs.find(t.data()); it!=gap_costs.end()) { return it->second.data(); }
+    buffer.resize(t.length());
+    distance::univariate::erp_gap_costs(t.data(), t.length(), cfe, gv, buffer.data());
+    return buffer.data();
+  }
+
+  F ERP::eval_gaps(const TSeries& t1, F const *gaps1, const TSeries& t2, F const *gaps2, F bsf) {
+    namespace tdu = distance::univariate;
+    namespace stats = distance::stats;
+    // Lower bounds strictly above bsf imply ERP > bsf: early abandon (ties are still computed)
+    if (!std::isinf(bsf)) {
+      if (cfe==1&&stats::lb(std::isinf(tdu::lb_ERP_sums(t1.data(), t1.length(), t2.data(), t2.length(), gv, bsf)))) {
+        return utils::PINF;
+      }
+      if (auto it = envelopes.find(t1.data()); it!=envelopes.end()&&t1.length()==t2.length()) {
+        const Envelopes& env = *it->second;
+        const F lb = tdu::lb_ERP(t2.data(), t2.length(), env.upper.data(), env.lower.data(), cfe, gv, bsf);
+        if (stats::lb(std::isinf(lb))) { return utils::PINF; }
+      }
+    }
+    return erpfun(t1.data(), gaps1, t1.length(), t2.data(), gaps2, t2.length(), cfe, w, bsf);
+  }
+
+  void ERP::prepare(TreeData const& data, IndexSet const& train_is) {
+    envelopes.clear();
+    gap_costs.clear();
+    const DTS& train_dataset = at_train(data, transform_id(data, transformation_name));
+    // The envelopes are univariate (see eval)
+    if (train_dataset.header().nb_dimensions()>1) { return; }
+    const EnvelopesCache& cache = at_train_envelopes(data);
+    for (size_t idx : train_is) {
+      const TSeries& t = train_dataset[idx];
+      envelopes[t.data()] = cache.get(train_dataset, transformation_name, idx, w);
+      std::vector<F>& gaps = gap_costs[t.data()];
+      gaps.resize(t.length());
+      distance::univariate::erp_gap_costs(t.data(), t.length(), cfe, gv, gaps.data());
+    }
   }
 
   std::string ERP::get_distance_name() {
     return "ERP:" + std::to_string(cfe) + ":" + std::to_string(gv) + ":" + std::to_string(w);
   }
 
+  void ERP::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(cfe);
+    out.write<F>(gv);
+    out.write<size_t>(w);
+  }
+
+  std::unique_ptr<i_Dist> ERP::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto cfe = in.read<F>();
+    const auto gv = in.read<F>();
+    const auto w = in.read<size_t>();
+    return std::make_unique<ERP>(std::move(tname), cfe, gv, w);
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // ERP splitter Generator
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
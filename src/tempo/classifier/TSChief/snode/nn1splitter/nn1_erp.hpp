@@ -2,6 +2,12 @@
 
 #include "nn1dist_base.hpp"
 
+#include <tempo/distance/univariate.hpp>
+
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
   struct ERP : public BaseDist {
@@ -9,11 +15,48 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     F gv;
     size_t w;
 
+    /// ERP specialised for 'cfe' on precomputed gap costs (see distance::univariate::erp_gap_costs), selected at
+    /// construction
+    distance::univariate::ERPGapsFun<F> erpfun;
+
+    /// Gap costs of the train exemplars for 'cfe' and 'gv', computed by 'prepare', indexed by the exemplars' raw data
+    /// pointer. The gap costs of a query are computed once for all the candidates (see eval_many).
+    std::map<F const *, std::vector<F>> gap_costs;
+
+    /// Envelopes of the univariate train exemplars for 'w', obtained by 'prepare' from the shared cache
+    /// (see at_train_envelopes), indexed by the exemplars' raw data pointer
+    std::map<F const *, std::shared_ptr<const Envelopes>> envelopes;
+
     ERP(std::string tname, F cfe, F gv, size_t w);
 
+    /// With a cutoff, first check LB_ERP on the sums of the series (cfe 1 only), then, for a prepared exemplar t1
+    /// and a query t2 of the same length, the envelope bound (see distance::univariate::lb_ERP)
     F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
 
+    /// Compute the gap costs of the query once for all the candidates
+    NNResult eval_many(TSeries const& query, std::span<TSeries const *const> candidates, F bsf) override;
+
+    /// Get the envelopes of the exemplars, and compute their gap costs
+    void prepare(TreeData const& data, IndexSet const& train_is) override;
+
     std::string get_distance_name() override;
+
+    double cost(size_t length) const override { return windowed_cost(length, w); }
+
+    /// Tag used in the model format
+    inline static const std::string tag{"ERP"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
+
+  private:
+
+    /// Gap costs of the series 't': from the exemplars, else computed in 'buffer'
+    F const *get_gaps(TSeries const& t, std::vector<F>& buffer) const;
+
+    /// eval with the gap costs of t1 and t2
+    F eval_gaps(const TSeries& t1, F const *gaps1, const TSeries& t2, F const *gaps2, F bsf);
   };
 
   struct ERPGen : public i_GenDist {
@@ -1,6 +1,8 @@
 #include "nn1_lcss.hpp"
 
 #include <tempo/distance/tseries.univariate.hpp>
+#include <tempo/distance/tseries.multivariate.hpp>
+#include <tempo/distance/stats.hpp>
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
@@ -8,14 +10,60 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
   // LCSS Wrapper
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
-  LCSS::LCSS(std::string tname, F epsilon, size_t w) : BaseDist(std::move(tname)), epsilon(epsilon), w(w) {}
+  LCSS::LCSS(std::string tname, F epsilon, size_t w) :
+    BaseDist(std::move(tname)), epsilon(epsilon), w(w), lcssfun(distance::univariate::lcss_for<F>(false)) {}
 
   F LCSS::eval(const TSeries& t1, const TSeries& t2, F bsf) {
-    return distance::univariate::lcss(t1, t2, epsilon, w, bsf);
+    if (!t1.is_univariate()) { return distance::multivariate::lcss(t1, t2, epsilon, w, bsf); }
+    // A bound strictly above bsf implies LCSS > bsf: early abandon (ties are still computed)
+    if (!std::isinf(bsf)&&t1.length()==t2.length()&&t1.length()>0) {
+      if (auto it = envelopes.find(t1.data()); it!=envelopes.end()) {
+        const Envelopes& env = *it->second;
+        const F lb = distance::univariate::lb_LCSS(t2.data(), t2.length(), env.upper.data(), env.lower.data(),
+                                                   epsilon, bsf);
+        if (distance::stats::lb(std::isinf(lb))) { return utils::PINF; }
+      }
+    }
+    return lcssfun(t1.data(), t1.length(), t2.data(), t2.length(), epsilon, w, bsf);
+  }
+
+  NNResult LCSS::eval_many_derivative(TSeries const& raw_query, std::span<TSeries const *const> candidates, F bsf) {
+    if (!raw_query.is_univariate()) { return i_Dist::eval_many_derivative(raw_query, candidates, bsf); }
+    return eval_each(candidates, bsf, [&](size_t i, F cutoff) {
+      TSeries const& c = *candidates[i];
+      return distance::univariate::lcss_derived(c.data(), c.length(), raw_query.data(), raw_query.length(), epsilon,
+                                                w, cutoff);
+    });
+  }
+
+  void LCSS::prepare(TreeData const& data, IndexSet const& train_is) {
+    lcssfun = distance::univariate::lcss_for<F>(train_equal_length(data));
+    envelopes.clear();
+    const DTS& train_dataset = at_train(data, transform_id(data, transformation_name));
+    // The envelopes are univariate (see eval)
+    if (train_dataset.header().nb_dimensions()>1) { return; }
+    const EnvelopesCache& cache = at_train_envelopes(data);
+    for (size_t idx : train_is) {
+      envelopes[train_dataset[idx].data()] = cache.get(train_dataset, transformation_name, idx, w);
+    }
   }
 
   std::string LCSS::get_distance_name() { return "LCSS:" + std::to_string(epsilon) + ":" + std::to_string(w); }
 
+  void LCSS::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(epsilon);
+    out.write<size_t>(w);
+  }
+
+  std::unique_ptr<i_Dist> LCSS::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto epsilon = in.read<F>();
+    const auto w = in.read<size_t>();
+    return std::make_unique<LCSS>(std::move(tname), epsilon, w);
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // LCSS splitter Generator
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
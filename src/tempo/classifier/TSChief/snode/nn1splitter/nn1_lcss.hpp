@@ -6,17 +6,46 @@
 
 #include "nn1dist_base.hpp"
 
+#include <map>
+#include <memory>
+
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
   struct LCSS : public BaseDist {
     F epsilon;
     size_t w;
 
+    /// Univariate LCSS, the equal length one once prepared on train data without variable length
+    /// (see train_equal_length)
+    distance::univariate::LCSSFun<F> lcssfun;
+
+    /// Envelopes of the univariate train exemplars for 'w', obtained by 'prepare' from the shared cache
+    /// (see at_train_envelopes), indexed by the exemplars' raw data pointer
+    std::map<F const *, std::shared_ptr<const Envelopes>> envelopes;
+
     LCSS(std::string tname, F epsilon, size_t w);
 
+    /// With a cutoff, a prepared exemplar t1 and a query t2 of the same length are first checked against the bound
+    /// on their number of matches (see distance::univariate::lb_LCSS)
     F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
 
+    /// Univariate queries: LCSS with the derivative computed in the cost function (see univariate::lcss_derived),
+    /// without the lower bounds, which need the derived query
+    NNResult eval_many_derivative(TSeries const& raw_query, std::span<TSeries const *const> candidates,
+                                  F bsf) override;
+
+    void prepare(TreeData const& data, IndexSet const& train_is) override;
+
     std::string get_distance_name() override;
+
+    double cost(size_t length) const override { return windowed_cost(length, w); }
+
+    /// Tag used in the model format
+    inline static const std::string tag{"LCSS"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
   };
 
   struct LCSSGen : public i_GenDist {
@@ -1,6 +1,7 @@
 #include "nn1_msm.hpp"
 
 #include <tempo/distance/tseries.univariate.hpp>
+#include <tempo/distance/stats.hpp>
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
@@ -10,14 +11,50 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
 
   MSM::MSM(std::string tname, F cost) : BaseDist(std::move(tname)), cost(cost) {}
 
+  bool MSM::lb_pruned(const TSeries& t1, const TSeries& t2, F cutoff) const {
+    if (std::isinf(cutoff)) { return false; }
+    const F lb = distance::univariate::lb_MSM(t2.data(), t2.length(), t1.data(), t1.length(), cost, cutoff);
+    return distance::stats::lb(std::isinf(lb));
+  }
+
   F MSM::eval(const TSeries& t1, const TSeries& t2, F bsf) {
-    return distance::univariate::msm(t1, t2, cost, bsf);
+    if (lb_pruned(t1, t2, bsf)) { return utils::PINF; }
+    thread_local std::vector<F> buffer1, buffer2;
+    return distance::univariate::msm(t1.data(), differences.get(t1, buffer1), t1.length(),
+                                     t2.data(), differences.get(t2, buffer2), t2.length(), cost, bsf);
+  }
+
+  NNResult MSM::eval_many(TSeries const& query, std::span<TSeries const *const> candidates, F bsf) {
+    thread_local std::vector<F> qbuffer, cbuffer;
+    F const *qdiff = differences.get(query, qbuffer);
+    return eval_each(candidates, bsf, [&](size_t i, F cutoff) {
+      TSeries const& c = *candidates[i];
+      if (lb_pruned(c, query, cutoff)) { return utils::PINF; }
+      return distance::univariate::msm(c.data(), differences.get(c, cbuffer), c.length(),
+                                       query.data(), qdiff, query.length(), cost, cutoff);
+    });
+  }
+
+  void MSM::prepare(TreeData const& data, IndexSet const& train_is) {
+    differences.prepare(data, transformation_name, train_is);
   }
 
   std::string MSM::get_distance_name() {
     return "MSM:" + std::to_string(cost);
   }
 
+  void MSM::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(cost);
+  }
+
+  std::unique_ptr<i_Dist> MSM::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto cost = in.read<F>();
+    return std::make_unique<MSM>(std::move(tname), cost);
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // MSM splitter Generator
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
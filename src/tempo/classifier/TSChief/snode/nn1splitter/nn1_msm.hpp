@@ -9,9 +9,29 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
 
     MSM(std::string tname, F cost);
 
+    /// First differences of the exemplars (see prepare)
+    ExemplarDifferences differences;
+
+    /// With a cutoff, the bound on the range of t1 (see distance::univariate::lb_MSM) is checked first
     F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
 
+    /// Compute the first differences of the query once for all the candidates
+    NNResult eval_many(TSeries const& query, std::span<TSeries const *const> candidates, F bsf) override;
+
+    /// Get the first differences of the exemplars
+    void prepare(TreeData const& data, IndexSet const& train_is) override;
+
     std::string get_distance_name() override;
+
+    /// MSM between an exemplar t1 and a query t2 is above the cutoff according to its lower bound
+    bool lb_pruned(const TSeries& t1, const TSeries& t2, F cutoff) const;
+
+    /// Tag used in the model format
+    inline static const std::string tag{"MSM"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
   };
 
   struct MSMGen : public i_GenDist {
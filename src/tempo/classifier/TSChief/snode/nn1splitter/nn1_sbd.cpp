@@ -0,0 +1,85 @@
+#include "nn1_sbd.hpp"
+
+namespace tempo::classifier::TSChief::snode::nn1splitter {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // SBD Wrapper
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  SBD::SBD(std::string tname) : BaseDist(std::move(tname)) {}
+
+  std::vector<F> const *SBD::exemplar_spectrum(F const *data) const {
+    auto it = spectra.find(data);
+    return it==spectra.end() ? nullptr : &it->second;
+  }
+
+  F const *SBD::spectrum(const TSeries& s, std::vector<F>& buffer) const {
+    if (auto const *sp = exemplar_spectrum(s.data()); sp!=nullptr) { return sp->data(); }
+    buffer.resize(distance::univariate::sbd_spectrum_size(max_length));
+    distance::univariate::sbd_spectrum(s.data(), s.length(), max_length, buffer.data());
+    return buffer.data();
+  }
+
+  F SBD::eval(const TSeries& t1, const TSeries& t2, F /* bsf */) {
+    namespace tdu = distance::univariate;
+    if (spectra.empty()||t1.length()>max_length||t2.length()>max_length) {
+      return tdu::sbd(t1.data(), t1.length(), t2.data(), t2.length());
+    }
+    // Same FFT length as eval_many, so that both give the same results to the last bit
+    thread_local std::vector<F> buffer1;
+    thread_local std::vector<F> buffer2;
+    return tdu::sbd_spectra(spectrum(t1, buffer1), spectrum(t2, buffer2), tdu::sbd_spectrum_size(max_length));
+  }
+
+  NNResult SBD::eval_many(const TSeries& query, std::span<TSeries const *const> candidates, F bsf) {
+    namespace tdu = distance::univariate;
+    if (spectra.empty()||query.length()>max_length) { return i_Dist::eval_many(query, candidates, bsf); }
+    // Spectrum of the query, computed once for all the candidates
+    thread_local std::vector<F> query_buffer;
+    thread_local std::vector<F> candidate_buffer;
+    F const *query_spectrum = spectrum(query, query_buffer);
+    const size_t size = tdu::sbd_spectrum_size(max_length);
+    return eval_each(candidates, bsf, [&](size_t i, F /* bsf */) {
+      const TSeries& c = *candidates[i];
+      if (c.length()>max_length) { return eval(c, query, utils::PINF); }
+      return tdu::sbd_spectra(spectrum(c, candidate_buffer), query_spectrum, size);
+    });
+  }
+
+  void SBD::prepare(TreeData const& data, IndexSet const& train_is) {
+    namespace tdu = distance::univariate;
+    spectra.clear();
+    const DTS& train_dataset = at_train(data, transform_id(data, transformation_name));
+    max_length = train_dataset.header().length_max();
+    const size_t size = tdu::sbd_spectrum_size(max_length);
+    for (size_t idx : train_is) {
+      TSeries const& s = train_dataset[idx];
+      std::vector<F>& sp = spectra[s.data()];
+      sp.resize(size);
+      tdu::sbd_spectrum(s.data(), s.length(), max_length, sp.data());
+    }
+  }
+
+  std::string SBD::get_distance_name() { return "SBD"; }
+
+  void SBD::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+  }
+
+  std::unique_ptr<i_Dist> SBD::load(BinReader& in) {
+    std::string tname = in.read_string();
+    return std::make_unique<SBD>(std::move(tname));
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // SBD splitter Generator
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  SBDGen::SBDGen(TransformGetter get_transform) : get_transform(std::move(get_transform)) {}
+
+  std::unique_ptr<i_Dist> SBDGen::generate(TreeState& state, TreeData const& /* data */, const ByClassMap& /* bcm */) {
+    return std::make_unique<SBD>(get_transform(state));
+  }
+
+} // End of namespace tempo::classifier::PF2::snode::nn1splitter
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "nn1dist_base.hpp"
+
+#include <tempo/distance/univariate.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace tempo::classifier::TSChief::snode::nn1splitter {
+
+  /** BaseDist SBD (shape-based distance) wrapper, univariate only.
+   *  SBD has no cutoff: the bsf is not used. 'prepare' computes the SBD spectra of the train exemplars (see
+   *  distance::univariate::sbd_spectrum), and 'eval_many' the spectrum of the query once for all the candidates:
+   *  each candidate then only costs the pointwise products and one inverse FFT.
+   *  Once prepared, 'eval' also goes through the spectra, at the same FFT length: 'eval' and 'eval_many' give the same
+   *  results to the last bit. Series longer than the train series use the plain SBD in both.
+   */
+  struct SBD : public BaseDist {
+
+    /// Maximal length of the spectra, the maximal length of the train series: longer queries use the plain SBD
+    size_t max_length{0};
+
+    /// SBD spectra of the train exemplars obtained by 'prepare', indexed by their raw data pointer
+    std::map<F const *, std::vector<F>> spectra;
+
+    explicit SBD(std::string tname);
+
+    F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
+
+    NNResult eval_many(const TSeries& query, std::span<TSeries const *const> candidates, F bsf) override;
+
+    void prepare(TreeData const& data, IndexSet const& train_is) override;
+
+    std::string get_distance_name() override;
+
+    /// Cross-correlation by FFT
+    double cost(size_t length) const override {
+      return (double)length*std::log2((double)std::max<size_t>(length, 2));
+    }
+
+    /// Tag used in the model format
+    inline static const std::string tag{"SBD"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
+
+  private:
+
+    /// Spectrum of the prepared train exemplar 'data', null if none
+    std::vector<F> const *exemplar_spectrum(F const *data) const;
+
+    /// Spectrum of 's' of length at most max_length: the prepared one, else computed in 'buffer'
+    F const *spectrum(const TSeries& s, std::vector<F>& buffer) const;
+  };
+
+  struct SBDGen : public i_GenDist {
+    TransformGetter get_transform;
+
+    explicit SBDGen(TransformGetter get_transform);
+
+    std::unique_ptr<i_Dist> generate(TreeState& state, TreeData const& data, const ByClassMap& /* bcm */) override;
+  };
+
+} // End of namespace tempo::classifier::PF2::snode::nn1splitter
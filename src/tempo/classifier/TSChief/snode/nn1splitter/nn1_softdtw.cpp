@@ -0,0 +1,55 @@
+#include "nn1_softdtw.hpp"
+
+namespace tempo::classifier::TSChief::snode::nn1splitter {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Soft-DTW Wrapper
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  SoftDTW::SoftDTW(std::string tname, F cfe, F gamma, size_t w) :
+    BaseDist(std::move(tname)), cfe(cfe), gamma(gamma), w(w) {}
+
+  F SoftDTW::eval(const TSeries& t1, const TSeries& t2, F /* bsf */) {
+    return distance::univariate::softdtw(t1.data(), t1.length(), t2.data(), t2.length(), cfe, gamma, w);
+  }
+
+  std::string SoftDTW::get_distance_name() {
+    return "SoftDTW:" + std::to_string(cfe) + ":" + std::to_string(gamma) + ":" + std::to_string(w);
+  }
+
+  void SoftDTW::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(cfe);
+    out.write<F>(gamma);
+    out.write<size_t>(w);
+  }
+
+  std::unique_ptr<i_Dist> SoftDTW::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto cfe = in.read<F>();
+    const auto gamma = in.read<F>();
+    const auto w = in.read<size_t>();
+    return std::make_unique<SoftDTW>(std::move(tname), cfe, gamma, w);
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Soft-DTW splitter Generator
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  SoftDTWGen::SoftDTWGen(TransformGetter get_transform, ExponentGetter get_cfe, T_GetterState<F> get_gamma,
+                         WindowGetter get_win) :
+    get_transform(std::move(get_transform)),
+    get_cfe(std::move(get_cfe)),
+    get_gamma(std::move(get_gamma)),
+    get_win(std::move(get_win)) {}
+
+  std::unique_ptr<i_Dist> SoftDTWGen::generate(TreeState& state, TreeData const& data, const ByClassMap& /* bcm */) {
+    const std::string tn = get_transform(state);
+    const F e = get_cfe(state);
+    const F gamma = get_gamma(state);
+    const size_t w = get_win(state, data);
+    return std::make_unique<SoftDTW>(tn, e, gamma, w);
+  }
+
+} // End of namespace tempo::classifier::PF2::snode::nn1splitter
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "nn1dist_base.hpp"
+
+#include <tempo/distance/univariate.hpp>
+
+namespace tempo::classifier::TSChief::snode::nn1splitter {
+
+  /** BaseDist Soft-DTW wrapper
+   *  Soft-DTW has no cutoff (it may be negative): the bsf is not used.
+   */
+  struct SoftDTW : public BaseDist {
+    F cfe;
+    F gamma;
+    size_t w;
+
+    SoftDTW(std::string tname, F cfe, F gamma, size_t w);
+
+    F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
+
+    std::string get_distance_name() override;
+
+    double cost(size_t length) const override { return windowed_cost(length, w); }
+
+    /// Tag used in the model format
+    inline static const std::string tag{"SoftDTW"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
+  };
+
+  struct SoftDTWGen : public i_GenDist {
+    TransformGetter get_transform;
+    ExponentGetter get_cfe;
+    T_GetterState<F> get_gamma;
+    WindowGetter get_win;
+
+    SoftDTWGen(TransformGetter get_transform, ExponentGetter get_cfe, T_GetterState<F> get_gamma,
+               WindowGetter get_win);
+
+    std::unique_ptr<i_Dist> generate(TreeState& state, TreeData const& data, const ByClassMap& /* bcm */) override;
+  };
+
+} // End of namespace tempo::classifier::PF2::snode::nn1splitter
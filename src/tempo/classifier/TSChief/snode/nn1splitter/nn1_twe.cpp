@@ -1,6 +1,7 @@
 #include "nn1_twe.hpp"
 
 #include <tempo/distance/tseries.univariate.hpp>
+#include <tempo/distance/stats.hpp>
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
@@ -10,14 +11,52 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
 
   TWE::TWE(std::string tname, F nu, F lambda) : BaseDist(std::move(tname)), nu(nu), lambda(lambda) {}
 
+  bool TWE::lb_pruned(const TSeries& t1, const TSeries& t2, F cutoff) const {
+    if (std::isinf(cutoff)||t1.length()!=t2.length()) { return false; }
+    const F lb = distance::univariate::lb_TWE(t2.data(), t1.data(), t1.length(), nu, lambda, cutoff);
+    return distance::stats::lb(std::isinf(lb));
+  }
+
   F TWE::eval(const TSeries& t1, const TSeries& t2, F bsf) {
-    return distance::univariate::twe(t1, t2, nu, lambda, bsf);
+    if (lb_pruned(t1, t2, bsf)) { return utils::PINF; }
+    thread_local std::vector<F> buffer1, buffer2;
+    return distance::univariate::twe(t1.data(), differences.get(t1, buffer1), t1.length(),
+                                     t2.data(), differences.get(t2, buffer2), t2.length(), nu, lambda, bsf);
+  }
+
+  NNResult TWE::eval_many(TSeries const& query, std::span<TSeries const *const> candidates, F bsf) {
+    thread_local std::vector<F> qbuffer, cbuffer;
+    F const *qdiff = differences.get(query, qbuffer);
+    return eval_each(candidates, bsf, [&](size_t i, F cutoff) {
+      TSeries const& c = *candidates[i];
+      if (lb_pruned(c, query, cutoff)) { return utils::PINF; }
+      return distance::univariate::twe(c.data(), differences.get(c, cbuffer), c.length(),
+                                       query.data(), qdiff, query.length(), nu, lambda, cutoff);
+    });
+  }
+
+  void TWE::prepare(TreeData const& data, IndexSet const& train_is) {
+    differences.prepare(data, transformation_name, train_is);
   }
 
   std::string TWE::get_distance_name() {
     return "TWE:" + std::to_string(nu) + ":" + std::to_string(lambda);
   }
 
+  void TWE::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(nu);
+    out.write<F>(lambda);
+  }
+
+  std::unique_ptr<i_Dist> TWE::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto nu = in.read<F>();
+    const auto lambda = in.read<F>();
+    return std::make_unique<TWE>(std::move(tname), nu, lambda);
+  }
+
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // TWE splitter Generator
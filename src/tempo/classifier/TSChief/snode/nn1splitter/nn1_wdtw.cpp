@@ -8,29 +8,64 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
   // WDTW Wrapper
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
-  WDTW::WDTW(std::string tname, F cfe, F g, std::vector<F>&& weights) :
-    BaseDist(std::move(tname)), cfe(cfe), g(g), weights(std::move(weights)) {}
+  WDTWWeights::WDTWWeights(F g, std::vector<F>&& weights) :
+    g(g), weights(std::move(weights)),
+    mirrored(distance::univariate::wdtw_mirror_weights(this->weights.data(), this->weights.size())) {}
+
+  WDTWTables::WDTWTables(size_t nb, size_t maxl) {
+    tables.reserve(nb);
+    for (size_t k = 0; k<nb; ++k) {
+      const F g = ((F)k + F(0.5))/(F)nb;
+      tables.push_back(std::make_shared<WDTWWeights const>(g, distance::univariate::wdtw_weights(g, maxl)));
+    }
+  }
+
+  WDTW::WDTW(std::string tname, F cfe, std::shared_ptr<WDTWWeights const> weights) :
+    BaseDist(std::move(tname)), cfe(cfe), weights(std::move(weights)),
+    wdtwfun(distance::univariate::wdtw_mirrored_for(cfe)) {}
 
   F WDTW::eval(const TSeries& t1, const TSeries& t2, F bsf) {
-    return distance::univariate::wdtw(t1, t2, cfe, weights.data(), bsf);
+    return wdtwfun(t1.data(), t1.length(), t2.data(), t2.length(), cfe, weights->mirrored.data(), weights->center(),
+                   bsf);
   }
 
   std::string WDTW::get_distance_name() {
-    return "WDTW:" + std::to_string(cfe) + ":" + std::to_string(g);
+    return "WDTW:" + std::to_string(cfe) + ":" + std::to_string(weights->g);
+  }
+
+  void WDTW::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transformation_name);
+    out.write<F>(cfe);
+    out.write<F>(weights->g);
+    out.write_vector(weights->weights);
+  }
+
+  std::unique_ptr<i_Dist> WDTW::load(BinReader& in) {
+    std::string tname = in.read_string();
+    const auto cfe = in.read<F>();
+    const auto g = in.read<F>();
+    auto weights = in.read_vector<F>();
+    return std::make_unique<WDTW>(std::move(tname), cfe, std::make_shared<WDTWWeights const>(g, std::move(weights)));
   }
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // WDTW splitter Generator
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
-  WDTWGen::WDTWGen(TransformGetter gt, ExponentGetter get_cfe, size_t maxl) :
-    get_transform(std::move(gt)), get_cfe(std::move(get_cfe)), maxl(maxl) {}
+  WDTWGen::WDTWGen(TransformGetter gt, ExponentGetter get_cfe, size_t maxl, std::shared_ptr<WDTWTables const> tables) :
+    get_transform(std::move(gt)), get_cfe(std::move(get_cfe)), maxl(maxl), tables(std::move(tables)) {}
 
   std::unique_ptr<i_Dist> WDTWGen::generate(TreeState& state, TreeData const& /*data*/, const ByClassMap& /*bcm*/) {
     const std::string tn = get_transform(state);
     const F cfe = get_cfe(state);
+    if (tables&&!tables->tables.empty()) {
+      const size_t k = std::uniform_int_distribution<size_t>(0, tables->tables.size() - 1)(state.prng);
+      return std::make_unique<WDTW>(tn, cfe, tables->tables[k]);
+    }
     const F g = std::uniform_real_distribution<F>(0, 1)(state.prng);
-    return std::make_unique<WDTW>(tn, cfe, g, distance::univariate::wdtw_weights(g, maxl));
+    auto weights = std::make_shared<WDTWWeights const>(g, distance::univariate::wdtw_weights(g, maxl));
+    return std::make_unique<WDTW>(tn, cfe, std::move(weights));
   }
 
 } // End of namespace tempo::classifier::PF2::snode::nn1splitter
@@ -2,26 +2,60 @@
 
 #include "nn1dist_base.hpp"
 
+#include <tempo/distance/univariate.hpp>
+
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
-  struct WDTW : public BaseDist {
-    F cfe;
+  /// WDTW weights for a 'g', with their mirrored copy (see distance::univariate::wdtw_mirrored).
+  /// Read only: shared by all the distances using this 'g'.
+  struct WDTWWeights {
     F g;
     std::vector<F> weights;
+    std::vector<F> mirrored;
+
+    WDTWWeights(F g, std::vector<F>&& weights);
+
+    /// Index of the weight 0 in 'mirrored'
+    [[nodiscard]] size_t center() const { return weights.empty() ? 0 : weights.size() - 1; }
+  };
+
+  /// Weights for 'nb' values of 'g' regularly spread over [0, 1[ (the middles of nb intervals of same size),
+  /// computed once for series of length up to 'maxl', and drawn by WDTWGen instead of computing weights per candidate.
+  struct WDTWTables {
+    std::vector<std::shared_ptr<WDTWWeights const>> tables;
+
+    WDTWTables(size_t nb, size_t maxl);
+  };
+
+  struct WDTW : public BaseDist {
+    F cfe;
+    std::shared_ptr<WDTWWeights const> weights;
 
-    WDTW(std::string tname, F cfe, F g, std::vector<F>&& weights);
+    /// WDTW specialised for 'cfe', selected at construction
+    distance::univariate::WDTWMirroredFun<F> wdtwfun;
+
+    WDTW(std::string tname, F cfe, std::shared_ptr<WDTWWeights const> weights);
 
     F eval(const TSeries& t1, const TSeries& t2, F bsf) override;
 
     std::string get_distance_name() override;
+
+    /// Tag used in the model format
+    inline static const std::string tag{"WDTW"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_Dist> load(BinReader& in);
   };
 
   struct WDTWGen : public i_GenDist {
     TransformGetter get_transform;
     ExponentGetter get_cfe;
     size_t maxl;
+    /// If not null, draw 'g' among the precomputed tables, else draw 'g' in [0, 1[ and compute its weights
+    std::shared_ptr<WDTWTables const> tables;
 
-    WDTWGen(TransformGetter gt, ExponentGetter get_cfe, size_t maxl);
+    WDTWGen(TransformGetter gt, ExponentGetter get_cfe, size_t maxl, std::shared_ptr<WDTWTables const> tables = {});
 
     std::unique_ptr<i_Dist> generate(TreeState& state, TreeData const& /*data*/, const ByClassMap& /*bcm*/) override;
   };
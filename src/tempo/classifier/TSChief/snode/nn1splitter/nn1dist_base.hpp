@@ -2,7 +2,13 @@
 
 #include "nn1dist_interface.hpp"
 
+#include <tempo/distance/univariate.hpp>
+
+#include <algorithm>
+#include <map>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
@@ -24,4 +30,85 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     std::string get_transformation_name() override { return transformation_name; }
   };
 
+  /// Quantized version of the train exemplar 't' (see QuantizedExemplars), or nullptr if 'quantized' is null or does
+  /// not contain 't'
+  inline distance::quantized::QView<F> const *quantized_view(QuantizedExemplars const *quantized, TSeries const& t) {
+    if (quantized==nullptr) { return nullptr; }
+    auto it = quantized->views.find(t.data());
+    return it==quantized->views.end() ? nullptr : &it->second;
+  }
+
+  /// True if the registered train series all have the same length (see DatasetHeader::variable_length): the
+  /// distances then select their equal length kernels in 'prepare' (see distance::univariate::dtw_equal_length)
+  inline bool train_equal_length(TreeData const& data) {
+    MDTS const& eager = at_train(data);
+    return !eager.empty()&&!eager.begin()->second.header().variable_length();
+  }
+
+  /// First differences of the train exemplars of a node, by data pointer (see DifferencesCache), for MSM and TWE
+  struct ExemplarDifferences {
+    std::map<F const *, std::shared_ptr<const std::vector<F>>> by_data;
+
+    /// Get the differences of the exemplars 'train_is' of the transform 'tname' from the cache of 'data'
+    void prepare(TreeData const& data, std::string const& tname, IndexSet const& train_is) {
+      by_data.clear();
+      const DTS& train_dataset = at_train(data, transform_id(data, tname));
+      const DifferencesCache& cache = at_train_differences(data);
+      for (size_t idx : train_is) { by_data[train_dataset[idx].data()] = cache.get(train_dataset, tname, idx); }
+    }
+
+    /// Differences of the univariate series 't': from the exemplars, else computed in 'buffer'
+    F const *get(TSeries const& t, std::vector<F>& buffer) const {
+      if (auto it = by_data.find(t.data()); it!=by_data.end()) { return it->second->data(); }
+      buffer.resize(t.length());
+      distance::univariate::first_differences(t.data(), t.length(), buffer.data());
+      return buffer.data();
+    }
+  };
+
+  /// Helper for the implementations of i_Dist::eval_many: nearest neighbours search over the candidates in order,
+  /// tightening the bsf as i_Dist::eval_many. 'fun(i, bsf)' computes the distance to the candidate i, while the next
+  /// one is prefetched.
+  template<typename Fun>
+  NNResult eval_each(std::span<TSeries const *const> candidates, F bsf, Fun&& fun) {
+    NNResult result{bsf, {}};
+    for (size_t i = 0; i<candidates.size(); ++i) {
+      if (i + 1<candidates.size()) { prefetch_series(*candidates[i + 1]); }
+      const F d = fun(i, result.distance);
+      if (d<result.distance) {
+        result.ties.clear();
+        result.ties.push_back(i);
+        result.distance = d;
+      } else if (d==result.distance) { result.ties.push_back(i); }
+    }
+    return result;
+  }
+
+  /// Helper for the implementations of i_Dist::eval_many: nearest neighbours search over the candidates visited in
+  /// 'order', by batches of up to 'batch' candidates. 'fun(indexes, nb, bsf, results)' computes the distances to the
+  /// candidates indexes[0..nb[ with early abandoning, writing them in results[0..nb[.
+  /// Visiting the closest candidates first tightens the bsf sooner; the result does not depend on the order.
+  /// The candidates of the next batch are prefetched while computing a batch.
+  template<typename Fun>
+  NNResult eval_in_order(std::span<TSeries const *const> candidates, std::vector<size_t> const& order, size_t batch,
+                         F bsf, Fun&& fun) {
+    NNResult result{bsf, {}};
+    std::vector<F> dists(batch);
+    for (size_t b = 0; b<order.size(); b += batch) {
+      const size_t nb = std::min(batch, order.size() - b);
+      for (size_t k = b + nb; k<std::min(order.size(), b + nb + batch); ++k) { prefetch_series(*candidates[order[k]]); }
+      fun(order.data() + b, nb, result.distance, dists.data());
+      for (size_t k = 0; k<nb; ++k) {
+        const F d = dists[k];
+        if (d<result.distance) {
+          result.ties.clear();
+          result.ties.push_back(order[b + k]);
+          result.distance = d;
+        } else if (d==result.distance) { result.ties.push_back(order[b + k]); }
+      }
+    }
+    std::sort(result.ties.begin(), result.ties.end());
+    return result;
+  }
+
 } // End of namespace tempo::classifier::PF2::snode::nn1splitter
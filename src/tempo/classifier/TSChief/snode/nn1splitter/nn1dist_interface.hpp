@@ -1,11 +1,18 @@
 #pragma once
 
+#include <algorithm>
 #include <string>
 #include <functional>
+#include <optional>
+#include <span>
+#include <vector>
 
 #include <tempo/utils/utils.hpp>
 #include <tempo/dataset/dts.hpp>
 
+#include <tempo/transform/core/univariate.derivative.hpp>
+
+#include <tempo/classifier/TSChief/serialize.hpp>
 #include <tempo/classifier/TSChief/treedata.hpp>
 #include <tempo/classifier/TSChief/treestate.hpp>
 
@@ -14,6 +21,36 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // NN1 Splitter: Interface for distance between two time series
 
+  /// Number of cache lines of a series fetched ahead by prefetch_series
+  constexpr size_t prefetch_lines = 4;
+
+  /// Prefetch the first cache lines of 's', e.g. the next candidate of a nearest neighbour search while computing the
+  /// distance to the current one: the hardware prefetcher follows the rest of the series once the kernel streams it.
+  inline void prefetch_series(TSeries const& s) {
+#if defined(__GNUC__)
+    const auto *p = reinterpret_cast<char const *>(s.data());
+    const size_t bytes = s.size()*sizeof(F);
+    for (size_t b = 0; b<std::min(bytes, prefetch_lines*64); b += 64) { __builtin_prefetch(p + b, 0, 3); }
+#else
+    (void)s;
+#endif
+  }
+
+  /// Result of a nearest neighbour search (see i_Dist::eval_many)
+  struct NNResult {
+    /// Distance to the nearest neighbours. Unchanged initial 'bsf' if no candidate is within it.
+    F distance;
+    /// Index of the nearest neighbours (ties) in the candidates, in increasing order
+    std::vector<size_t> ties;
+  };
+
+  /// Family of distances ordered by a window (see i_Dist::window_family)
+  struct WindowFamily {
+    /// Identify the family: type, transform and all the parameters but the window
+    std::string key;
+    size_t window;
+  };
+
   /// Interface for the distance component
   struct i_Dist {
 
@@ -25,12 +62,80 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     /// 'bsf' ('Best so far') allows early abandoning and pruning in a NN1 classifier (upper bound on the whole process)
     virtual F eval(TSeries const& t1, TSeries const& t2, F bsf) = 0;
 
+    /// Nearest neighbours of 'query' in 'candidates', with an upper bound 'bsf' on their distance.
+    /// Candidates at distance 'bsf' are ties. The candidates are given as the first argument of 'eval'.
+    /// The default implementation calls 'eval' on the candidates in order, tightening the bsf.
+    /// Overriding implementations may evaluate the candidates in any order, but must return the same result.
+    virtual NNResult eval_many(TSeries const& query, std::span<TSeries const *const> candidates, F bsf) {
+      NNResult result{bsf, {}};
+      for (size_t i = 0; i<candidates.size(); ++i) {
+        if (i + 1<candidates.size()) { prefetch_series(*candidates[i + 1]); }
+        const F d = eval(*candidates[i], query, result.distance);
+        if (d<result.distance) {
+          result.ties.clear();
+          result.ties.push_back(i);
+          result.distance = d;
+        } else if (d==result.distance) { result.ties.push_back(i); }
+      }
+      return result;
+    }
+
+    /// eval_many with 'query' being the series 'test_idx' of the test data registered in 'data' (see register_test),
+    /// for the transform of the distance. Allow distances to reuse per test series data shared by all the nodes and
+    /// trees (e.g. the envelopes, see at_test_envelopes). The default implementation calls eval_many.
+    virtual NNResult eval_many_test(TreeData const& /* data */, size_t /* test_idx */, TSeries const& query,
+                                    std::span<TSeries const *const> candidates, F bsf) {
+      return eval_many(query, candidates, bsf);
+    }
+
+    /// eval_many with the first derivative of 'raw_query' (see transform::univariate::derive), for the virtual test
+    /// transform "derivative1" (see set_virtual_test_derivative).
+    /// The default implementation derives the query once in a per thread buffer, then calls eval_many.
+    virtual NNResult eval_many_derivative(TSeries const& raw_query, std::span<TSeries const *const> candidates,
+                                          F bsf) {
+      thread_local std::vector<F> buffer;
+      const size_t ndim = raw_query.nb_dimensions();
+      buffer.resize(raw_query.size());
+      for (size_t k = 0; k<ndim; ++k) {
+        transform::core::univariate::derive_strided<F>(raw_query.data() + k, raw_query.length(), ndim,
+                                                       buffer.data() + k);
+      }
+      const TSeries query = TSeries::mk_view({}, buffer.data(), ndim, raw_query.length(), {}, {raw_query.missing()});
+      return eval_many(query, candidates, bsf);
+    }
+
+    /// Called once the train exemplars used by a node are selected, before any call to 'eval'.
+    /// In 'eval', these exemplars are always given as the first argument 't1'.
+    /// Allow distances to precompute per exemplar data (e.g. envelopes). Do nothing by default.
+    virtual void prepare(TreeData const& /* data */, IndexSet const& /* train_is */) {}
+
+    /// Family of the distance if it is non increasing with its window: a distance of the family with a larger window
+    /// is a lower bound of this one, and one with a smaller window an upper bound (e.g. DTW). Nothing by default.
+    /// Allows the candidates of a node to share their results (see GenSplitterNN1::generate).
+    virtual std::optional<WindowFamily> window_family() const { return {}; }
+
+    /// Estimated cost of one evaluation between series of 'length' timestamps, in cells of the cost matrix (values
+    /// for the lock-step distances), without early abandoning or lower bounds. A full cost matrix by default.
+    /// Used to bound the cost of the candidates of a node (see snode::meta::SplitterChooserGen::cost_budget).
+    virtual double cost(size_t length) const { return (double)length*(double)length; }
+
     /// Name of the transformation to draw the data from
     virtual std::string get_transformation_name() = 0;
 
     virtual std::string get_distance_name() = 0;
+
+    /// Write the distance, starting with a tag identifying its type (see load_distance)
+    virtual void save(BinWriter& out) const = 0;
   };
 
+  /// Cost of a distance computing the cells of a cost matrix within a window 'w' (see i_Dist::cost)
+  inline double windowed_cost(size_t length, size_t w) {
+    return (double)length*(double)std::min(length, 2*w + 1);
+  }
+
+  /// Load a distance written by i_Dist::save
+  std::unique_ptr<i_Dist> load_distance(BinReader& in);
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Time series distance generator interface
 
@@ -1,87 +1,938 @@
 #include <algorithm>
-#include <set>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <sstream>
 #include <vector>
 
 #include "nn1splitter.hpp"
 #include "nn1splitter.private.hpp"
 
+#include "nn1_adtw.hpp"
+#include "nn1_directa.hpp"
+#include "nn1_dtw.hpp"
+#include "nn1_dtwfull.hpp"
+#include "nn1_erp.hpp"
+#include "nn1_lcss.hpp"
+#include "nn1_msm.hpp"
+#include "nn1_sbd.hpp"
+#include "nn1_softdtw.hpp"
+#include "nn1_twe.hpp"
+#include "nn1_wdtw.hpp"
+
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
+  namespace {
+
+    /// Nearest neighbours search of a query in GenSplitterNN1::generate, with its buffers.
+    /// Candidates are given by their position in the node's candidates.
+    struct NNSearch {
+      /// Initial bsf, from the cached exact distances
+      F bsf;
+      /// Positions of the candidates at 'bsf' in the cache
+      std::vector<size_t> cached_ties;
+      /// Positions of the evaluated candidates, and the candidates themselves
+      std::vector<size_t> evaluated_positions;
+      std::vector<TSeries const *> evaluated;
+      /// Candidates with a cached lower bound
+      std::vector<std::pair<size_t, F>> bounded;
+      /// Candidates to evaluate before the bounds of the window family (see i_Dist::window_family), with their bound
+      std::vector<std::pair<size_t, F>> unresolved;
+      /// Candidates resolved by the cache
+      size_t cache_hits;
+      /// Initial bsf of the evaluation: 'bsf', or the upper bound of the window family if tighter
+      F eval_bsf;
+      /// Result over the evaluated candidates (indexes in 'evaluated')
+      NNResult nn;
+      /// Evaluated candidates of a tile (see GenSplitterNN1::tile_bytes), and their indexes in 'evaluated'
+      std::vector<TSeries const *> tile;
+      std::vector<size_t> tile_indexes;
+    };
+
+    /// Routing of queries in GenSplitterNN1::generate: the wins of the candidates, and the partition of the queries in
+    /// flat arrays (branch and class position per query) with its Gini mass (see the Gini bound).
+    /// One for the node, or one per chunk of its queries (see GenSplitterNN1::chunk_min_size).
+    struct Routing {
+      TieTracker ties;
+      /// Number of queries won by each candidate (as a nearest neighbour or a tie), and the candidates' positions by
+      /// decreasing number of wins (see GenSplitterNN1::generate)
+      std::vector<size_t> candidate_wins;
+      std::vector<size_t> candidate_order;
+      std::vector<uint32_t> query_indexes;
+      std::vector<uint32_t> query_classes;
+      std::vector<uint32_t> query_branches;
+      std::vector<size_t> cell_sizes;
+      std::vector<double> branch_size;
+      std::vector<double> branch_sumsq;
+      double gini_mass{0};
+      /// A chunk defers its updates of the node's cache and counters: recorded after the routing of all the chunks
+      bool deferred{false};
+      std::vector<std::pair<uint64_t, DistanceCache::Entry>> records;
+      size_t cache_hits{0};
+      size_t cache_lookups{0};
+
+      /// Reset for a node with 'nb_branches' branches, 'nb_classes' classes and 'nb_candidates' candidates
+      void reset(size_t nb_branches, size_t nb_classes, size_t nb_candidates) {
+        candidate_wins.assign(nb_candidates, 0);
+        candidate_order.clear();
+        for (size_t i = 0; i<nb_candidates; ++i) { candidate_order.push_back(i); }
+        query_indexes.clear();
+        query_classes.clear();
+        query_branches.clear();
+        cell_sizes.assign(nb_branches*nb_classes, 0);
+        branch_size.assign(nb_branches, 0);
+        branch_sumsq.assign(nb_branches, 0);
+        gini_mass = 0;
+        records.clear();
+        cache_hits = 0;
+        cache_lookups = 0;
+      }
+    };
+
+    /// A chunk of the queries of a node, searched and routed concurrently with the others
+    /// (see GenSplitterNN1::chunk_min_size)
+    struct RouteChunk {
+      PRNG prng;
+      NNSearch search;
+      Routing routing;
+    };
+
+    /// Per-thread scratch of GenSplitterNN1::generate, reused across the candidates and the nodes trained by a thread.
+    /// Cleared (not released) at the start of each generation: after the largest node, the routing is allocation free.
+    /// Note: generate does not start other tasks, so it is never re-entered on a thread while using the scratch.
+    /// The batched nodes (see GenSplitterNN1::batch_min_size) start tasks: they use their own scratch instead.
+    struct NodeScratch {
+      std::vector<TSeries const *> candidates;
+      std::vector<size_t> candidate_indexes;
+      std::vector<size_t> candidate_branches;
+      /// Start of each tile of candidates (see GenSplitterNN1::tile_bytes), and the tile of each candidate
+      std::vector<size_t> tile_starts;
+      std::vector<size_t> candidate_tiles;
+      /// Per encoded label (see TrainLabels), its class position in the node, and the position of its candidate
+      /// (nb_candidates if none): the queries are resolved without map lookup
+      std::vector<uint32_t> label_classes;
+      std::vector<size_t> label_candidates;
+      /// One search per query of a block (see GenSplitterNN1::batch_min_size), else one reused by all the queries
+      std::vector<NNSearch> searches;
+      Routing routing;
+
+      /// Reset for a node with 'nb_branches' branches, 'nb_classes' classes and 'nb_candidates' candidates, among
+      /// 'nb_labels' encoded labels
+      void reset(size_t nb_branches, size_t nb_classes, size_t nb_candidates, size_t nb_labels) {
+        candidates.clear();
+        candidate_indexes.clear();
+        candidate_branches.clear();
+        tile_starts.clear();
+        candidate_tiles.clear();
+        label_classes.assign(nb_labels, 0);
+        routing.reset(nb_branches, nb_classes, nb_candidates);
+      }
+    };
+
+    inline NodeScratch& thread_scratch() {
+      thread_local NodeScratch scratch;
+      return scratch;
+    }
+
+    /** Exemplars of a node grouping its classes in 'k' branches (see GenSplitterNN1::max_fanout), among the class
+     *  representatives 'reps': the first one is drawn at random, each next one is the representative farthest from the
+     *  ones already chosen (farthest first traversal). A branch then gathers the classes whose series are nearest to
+     *  its exemplar. Costs |reps|*k distances, when routing the node with all the representatives costs |node|*|reps|.
+     */
+    IndexSet group_exemplars(TreeState& state, TreeData const& data, i_Dist& distance, DTS const& train_dataset,
+                             IndexSet const& reps, size_t k) {
+      const std::vector<size_t>& rv = reps.vector();
+      distance.prepare(data, reps);
+      std::vector<F> nearest(rv.size(), utils::PINF);
+      std::vector<size_t> chosen;
+      size_t next = std::uniform_int_distribution<size_t>(0, rv.size() - 1)(state.prng);
+      while (chosen.size()<k) {
+        chosen.push_back(rv[next]);
+        nearest[next] = utils::NINF;
+        TSeries const& exemplar = train_dataset[rv[next]];
+        size_t farthest = 0;
+        for (size_t r = 0; r<rv.size(); ++r) {
+          if (nearest[r]==utils::NINF) { continue; }
+          nearest[r] = std::min(nearest[r], distance.eval(train_dataset[rv[r]], exemplar, nearest[r]));
+          if (nearest[farthest]==utils::NINF||nearest[r]>nearest[farthest]) { farthest = r; }
+        }
+        state.count(TrainingProgress::DISTANCES, rv.size() - chosen.size());
+        next = farthest;
+      }
+      std::sort(chosen.begin(), chosen.end());
+      return IndexSet(std::move(chosen));
+    }
+
+  } // End of anonymous namespace
+
+  std::string distance_key(i_Dist const& distance) {
+    std::ostringstream oss;
+    BinWriter w(oss);
+    distance.save(w);
+    return oss.str();
+  }
+
+  uint64_t memo_key(i_Dist const& distance) { return std::hash<std::string>{}(distance_key(distance)); }
+
+  NNResult memo_eval_many(TreeState const& state, TreeData const& data, i_Dist& distance, uint64_t key,
+                          size_t test_idx, TSeries const& query, std::span<TSeries const *const> candidates,
+                          std::span<size_t const> train_indexes, bool derive_query) {
+    const auto search = [&](std::span<TSeries const *const> cs, F bsf) {
+      return derive_query ? distance.eval_many_derivative(query, cs, bsf)
+                          : distance.eval_many_test(data, test_idx, query, cs, bsf);
+    };
+    DistanceMemo *memo = state.memo.get();
+    if (memo==nullptr) { return search(candidates, utils::PINF); }
+
+    // --- Entries of the candidates: the smallest exact distance bounds the nearest neighbours
+    thread_local std::vector<std::pair<size_t, F>> exact;
+    thread_local std::vector<std::pair<size_t, F>> bounded;
+    thread_local std::vector<size_t> positions;
+    thread_local std::vector<TSeries const *> evaluated;
+    exact.clear();
+    bounded.clear();
+    positions.clear();
+    evaluated.clear();
+    F ub = utils::PINF;
+    {
+      auto locked = memo->lock(test_idx);
+      DistanceMemo::Table const& table = locked.table();
+      for (size_t i = 0; i<candidates.size(); ++i) {
+        auto it = table.find(DistanceMemo::key(key, test_idx, train_indexes[i]));
+        if (it==table.end()) { positions.push_back(i); }
+        else if (it->second.exact) {
+          exact.emplace_back(i, it->second.value);
+          ub = std::min(ub, it->second.value);
+        } else { bounded.emplace_back(i, it->second.value); }
+      }
+    }
+    // A strict lower bound at or above 'ub' is not a nearest neighbour (nor a tie). Evaluate the others in the order
+    // of the candidates.
+    for (const auto& [i, lb] : bounded) { if (!(lb>=ub)) { positions.push_back(i); }}
+    std::sort(positions.begin(), positions.end());
+    memo->count(candidates.size(), candidates.size() - positions.size());
+
+    // --- Search the remaining candidates, keeping the ties at 'ub'
+    const F bsf = ub<utils::PINF ? std::nextafter(ub, utils::PINF) : utils::PINF;
+    for (size_t i : positions) { evaluated.push_back(candidates[i]); }
+    const NNResult nn = evaluated.empty() ? NNResult{bsf, {}} : search(evaluated, bsf);
+
+    // --- Merge
+    NNResult result{nn.ties.empty() ? ub : std::min(ub, nn.distance), {}};
+    for (const auto& [i, d] : exact) { if (d==result.distance) { result.ties.push_back(i); }}
+    if (!nn.ties.empty()&&nn.distance==result.distance) {
+      for (size_t k : nn.ties) { result.ties.push_back(positions[k]); }
+    }
+    std::sort(result.ties.begin(), result.ties.end());
+
+    // --- Record: the ties of the search are at their exact distance, the other evaluated candidates above it
+    // (or above 'bsf' without ties)
+    if (!evaluated.empty()) {
+      const F lower = nn.ties.empty() ? bsf : nn.distance;
+      auto locked = memo->lock(test_idx);
+      size_t t = 0;
+      for (size_t k = 0; k<positions.size(); ++k) {
+        const DistanceMemo::Key mk = DistanceMemo::key(key, test_idx, train_indexes[positions[k]]);
+        if (t<nn.ties.size()&&nn.ties[t]==k) {
+          memo->set_exact(locked, mk, nn.distance);
+          ++t;
+        } else if (lower<utils::PINF) { memo->set_bound(locked, mk, lower); }
+      }
+    }
+
+    return result;
+  }
+
   /// Generate a snode based on the distance generator specifed at build time
   i_GenNode::Result GenSplitterNN1::generate(TreeState& state, TreeData const& data, ByClassMap const& bcm) {
-    using MDTS = std::map<std::string, DTS>;
+    return generate_impl(state, data, bcm, nullptr);
+  }
 
-    // --- --- --- Generate a distance
-    auto distance = distance_generator->generate(state, data, bcm);
+  i_GenNode::Result GenSplitterNN1::generate_bounded(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                                     std::atomic<double> const& best_score) {
+    return generate_impl(state, data, bcm, &best_score);
+  }
+
+  i_GenNode::Result GenSplitterNN1::split_with(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                               std::unique_ptr<i_SplitterNode>&& splitter) {
+    auto *nn1 = dynamic_cast<SplitterNN1 *>(splitter.get());
+    if (nn1==nullptr) { return {}; }
+    return generate_impl(state, data, bcm, nullptr, nn1);
+  }
+
+  i_GenNode::Result GenSplitterNN1::generate_impl(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                                  std::atomic<double> const *best_score, SplitterNN1 *fixed) {
+
+    // --- --- --- Generate a distance (drawing its parameters)
+    auto distance = [&]() {
+      if (fixed!=nullptr) { return std::move(fixed->distance); }
+      const auto scope = state.time("train/node/nn1/params");
+      return distance_generator->generate(state, data, bcm);
+    }();
     std::string transform_name = distance->get_transformation_name();
 
     // --- --- --- Access State
     // Get/Compute the index set matching 'bcm'
-    const IndexSet& all_indexset = get_train_state->at(state).get_index_set(bcm);
+    GenSplitterNN1_State& nn1_state = get_train_state->at(state);
+    const IndexSet& all_indexset = nn1_state.get_index_set(bcm);
 
     // --- --- --- Data access
-    const DTS& train_dataset = at<MDTS>(data, "train_mdts").at(transform_name);
+    const size_t tid = transform_id(data, transform_name);
+    const DTS& train_dataset = at_train(data, tid);
+    const TrainLabels& train_labels = at_train_labels(data);
+    advise_train_series(data, tid, all_indexset);
 
     // --- --- --- Splitter training algorithm
-    // Pick on exemplar per class using the pseudo random number generator from the state
-    ByClassMap train_bcm = bcm.pick_one_by_class(state.prng);
-    IndexSet train_idxset = train_bcm.to_IndexSet();
-
+    // Pick on exemplar per class using the pseudo random number generator from the state, and group the classes if
+    // there are more than 'max_fanout' (a fixed splitter's distance is already prepared for its exemplars).
     // Build return:
-    //  Number of branches == number of classes
-    //  We maintain mapping from labels to branch index
-    //  We build the "by branch BCM" vector resulting from this snode
-    const std::map<EL, size_t>& label_to_branchIdx = bcm.labels_to_index();
-    std::vector<ByClassMap::BCMvec_t> result_bcm_vec(bcm.nb_classes());
+    //  Number of branches == number of classes, or of groups of classes
+    //  We maintain mapping from the labels of the exemplars to branch index, and from the labels to class position
+    //  (dense tables indexed by encoded label for the queries, see NodeScratch::label_classes)
+    //  The queries are routed in flat arrays (branch and class position per query), then partitioned in one pass
+    //  (see FlatBCM::partition) into the "by branch BCM" vector resulting from this snode
+    IndexSet train_idxset;
+    std::map<EL, size_t> label_to_branchIdx;
+    if (fixed!=nullptr) {
+      train_idxset = fixed->train_indexset;
+      label_to_branchIdx = fixed->labels_to_branch_idx;
+    } else {
+      train_idxset = bcm.pick_one_by_class(state.prng).to_IndexSet();
+      if (max_fanout>1&&bcm.nb_classes()>max_fanout) {
+        train_idxset = group_exemplars(state, data, *distance, train_dataset, train_idxset, max_fanout);
+        for (size_t idx : train_idxset) {
+          label_to_branchIdx.emplace(train_labels[idx], label_to_branchIdx.size());
+        }
+      } else { label_to_branchIdx = bcm.labels_to_index(); }
+      distance->prepare(data, train_idxset);
+    }
+    const size_t nb_classes = bcm.nb_classes();
+    const size_t nb_branches = label_to_branchIdx.size();
+    const size_t nb_queries = all_indexset.size();
+    const size_t nb_candidates = train_idxset.size();
+    // A thread waiting for the searches of a batched or chunked node may run another generation: the node has its own
+    // scratch
+    const bool chunked = nb_queries>=chunk_min_size;
+    const bool batched = !chunked&&nb_queries>=batch_min_size&&batch_nb_threads>1;
+    NodeScratch own_scratch;
+    NodeScratch& scratch = (batched||chunked) ? own_scratch : thread_scratch();
+    scratch.reset(nb_branches, nb_classes, nb_candidates, train_labels.nb_classes);
+    Routing& routing = scratch.routing;
+    if (!chunked) {
+      routing.query_indexes.reserve(nb_queries);
+      routing.query_classes.reserve(nb_queries);
+      routing.query_branches.reserve(nb_queries);
+    }
+
+    // Candidates, with their branches, and the per label tables
+    std::vector<TSeries const *>& candidates = scratch.candidates;
+    std::vector<size_t>& candidate_indexes = scratch.candidate_indexes;
+    std::vector<size_t>& candidate_branches = scratch.candidate_branches;
+    std::vector<uint32_t>& label_classes = scratch.label_classes;
+    std::vector<size_t>& label_candidates = scratch.label_candidates;
+    // Estimated cost: every query against every candidate, plus the grouping of the classes (see group_exemplars)
+    const double distance_cost = distance->cost(train_dataset.header().length_max());
+    double candidate_cost = (double)nb_queries*(double)nb_candidates*distance_cost;
+    if (fixed==nullptr&&nb_candidates<bcm.nb_classes()) {
+      candidate_cost += (double)bcm.nb_classes()*(double)nb_candidates*distance_cost;
+    }
+    const auto abandoned = [&]() {
+      i_GenNode::Result result{};
+      result.cost = candidate_cost;
+      return result;
+    };
+    {
+      size_t c = 0;
+      for (EL label : bcm.classes()) { label_classes[label] = (uint32_t)(c++); }
+    }
+    label_candidates.assign(train_labels.nb_classes, nb_candidates);
+    for (size_t candidate_idx : train_idxset) {
+      const TrainLabels::code_t label = train_labels[candidate_idx];
+      label_candidates[label] = candidates.size();
+      candidates.push_back(&train_dataset[candidate_idx]);
+      candidate_indexes.push_back(candidate_idx);
+      candidate_branches.push_back(label_to_branchIdx.at(label));
+    }
+
+    // The candidates winning the most queries so far are evaluated first (after the one of the query's class): the
+    // sooner the nearest neighbour is found, the tighter the cutoff of the others. The final order is kept by the
+    // splitter for the test queries (see Routing::candidate_order).
+
+    // Distances already computed in this node by candidates with the same distance (see DistanceCache).
+    // Cached exact distances give the initial bsf; candidates with a bound not below it are skipped;
+    // the others are evaluated, and their results are recorded.
+    DistanceCache& cache = nn1_state.cache_distances;
+    const std::string dkey = distance_key(*distance);
+    auto [table_it, new_table] = cache.tables.try_emplace(dkey);
+    DistanceCache::Table& table = table_it->second;
+
+    // Distances computed by the other nodes of the training, of any tree (see TreeState::train_memo): a new table
+    // starts with their entries for the queries and candidates of the node. The evaluated ones are recorded by route.
+    DistanceMemo *train_memo = state.train_memo.get();
+    const uint64_t train_memo_key = train_memo==nullptr ? 0 : std::hash<std::string>{}(dkey);
+    if (train_memo!=nullptr&&new_table) {
+      for (size_t query_idx : all_indexset) {
+        if (cache.full()) { break; }
+        size_t nb_hits = 0;
+        auto locked = train_memo->lock(query_idx);
+        DistanceMemo::Table const& mtable = locked.table();
+        for (size_t candidate_idx : candidate_indexes) {
+          auto it = mtable.find(DistanceMemo::key(train_memo_key, query_idx, candidate_idx));
+          if (it==mtable.end()) { continue; }
+          ++nb_hits;
+          const uint64_t k = DistanceCache::key(query_idx, candidate_idx);
+          if (it->second.exact) { cache.set_exact(table, k, it->second.value); }
+          else { cache.set_bound(table, k, it->second.value); }
+        }
+        train_memo->count(nb_candidates, nb_hits);
+      }
+    }
+
+    // Tables of the same family with another window (see i_Dist::window_family), flagged if their window is larger.
+    // A larger window gives a lower bound of the distance, a smaller one an upper bound.
+    std::vector<std::pair<DistanceCache::Table const *, bool>> family_tables;
+    if (const auto family = distance->window_family(); family) {
+      auto& by_window = cache.families[family->key];
+      for (const auto& [window, ftable] : by_window) {
+        if (ftable!=&table) { family_tables.emplace_back(ftable, window>family->window); }
+      }
+      by_window.insert_or_assign(family->window, &table);
+    }
+
+    // Gini bound: a branch of size n with nc series of class c has a Gini "mass" n*gini = n - sum(nc^2)/n, which
+    // never decreases when a series is added to it. Hence, the sum of the masses of the already routed queries,
+    // divided by the total number of queries, is a lower bound of the final weighted Gini impurity.
+    // The mass of a union of queries is at least the sum of their masses: the masses of the chunks of a chunked node
+    // (one slot per chunk) give the bound while they are routed.
+    const auto total_size = (double)nb_queries;
+    std::vector<std::atomic<double>> chunk_masses;
 
     // For each incoming series (including selected train exemplars - will eventually form pure leaves)
     // Do 1NN classification, managing ties
-    for (auto query_idx : all_indexset) {
-      const auto& query = train_dataset[query_idx];
-      EL query_label = train_dataset.label(query_idx).value();
+    // Time of the distances, recorded once for the node (see PhaseTimers)
+    utils::duration_t distance_time{};
+    const auto record_distance_time = [&]() {
+      if (state.timers) {
+        state.timers->add(distance_phase(state, "train/node/nn1/distance/", *distance), distance_time);
+      }
+    };
+
+    // Candidates of a query to evaluate, reading (not updating) the cache, in the order 'candidate_order' (see
+    // Routing). Only uses 'search' buffers: the searches of several queries can run concurrently.
+    const auto resolve_nn = [&](size_t query_idx, NNSearch& search, std::vector<size_t> const& candidate_order) {
+      // Start with same class: better chance to have a tight cutoff (one candidate per class).
+      // With grouped classes, the class may have no candidate: start with the most winning one.
+      size_t first_pos = label_candidates[train_labels[query_idx]];
+      if (first_pos==nb_candidates) { first_pos = candidate_order.front(); }
+      // Resolve the candidates from the cache
+      F bsf = utils::PINF;
+      search.cache_hits = 0;
+      search.cached_ties.clear();
+      search.evaluated_positions.clear();
+      search.bounded.clear();
+      for (size_t k = 0, o = 0; k<nb_candidates; ++k) {
+        size_t i = first_pos;
+        if (k>0) {
+          if (candidate_order[o]==first_pos) { ++o; }
+          i = candidate_order[o++];
+        }
+        auto it = table.find(DistanceCache::key(query_idx, candidate_indexes[i]));
+        if (it==table.end()) { search.evaluated_positions.push_back(i); }
+        else if (!it->second.exact) { search.bounded.emplace_back(i, it->second.value); }
+        else {
+          const F d = it->second.value;
+          ++search.cache_hits;
+          if (d<bsf) {
+            bsf = d;
+            search.cached_ties.assign(1, i);
+          } else if (d==bsf) { search.cached_ties.push_back(i); }
+        }
+      }
+      // Strict lower bound not below the bsf: neither a nearest neighbour nor a tie
+      for (const auto& [i, bound] : search.bounded) {
+        if (distance::stats::lb(bound>=bsf)) { ++search.cache_hits; } else { search.evaluated_positions.push_back(i); }
+      }
+      // With the other windows of the family: the smallest exact distance of a smaller window is an upper bound of the
+      // nearest neighbours (the candidate giving it is always evaluated); the entries of the larger windows are lower
+      // bounds of their candidate, strict for the bounds, not for the exact distances (made strict below).
+      F ub = utils::PINF;
+      if (!family_tables.empty()) {
+        size_t ub_pos = nb_candidates;
+        search.unresolved.clear();
+        for (size_t i : search.evaluated_positions) {
+          const uint64_t k = DistanceCache::key(query_idx, candidate_indexes[i]);
+          F lb = utils::NINF;
+          for (const auto& [ftable, larger] : family_tables) {
+            auto it = ftable->find(k);
+            if (it==ftable->end()) { continue; }
+            const DistanceCache::Entry& e = it->second;
+            if (larger) { lb = std::max(lb, e.exact ? std::nextafter(e.value, utils::NINF) : e.value); }
+            else if (e.exact&&e.value<ub) {
+              ub = e.value;
+              ub_pos = i;
+            }
+          }
+          search.unresolved.emplace_back(i, lb);
+        }
+        search.evaluated_positions.clear();
+        const F limit = std::min(bsf, ub);
+        for (const auto& [i, lb] : search.unresolved) {
+          if (i!=ub_pos&&lb>utils::NINF&&distance::stats::lb(lb>=limit)) { ++search.cache_hits; }
+          else { search.evaluated_positions.push_back(i); }
+        }
+      }
+      // Evaluate the other candidates, with the cached bsf, or the upper bound of the family if tighter.
+      // The upper bound is taken just above its value: the candidate giving it is at this distance or below.
+      search.evaluated.clear();
+      for (size_t i : search.evaluated_positions) { search.evaluated.push_back(candidates[i]); }
+      search.bsf = bsf;
+      search.eval_bsf = ub<bsf ? std::min(bsf, std::nextafter(ub, utils::PINF)) : bsf;
+    };
+
+    // Nearest neighbours search of a query (see resolve_nn)
+    const auto search_nn = [&](size_t query_idx, NNSearch& search, std::vector<size_t> const& candidate_order) {
+      resolve_nn(query_idx, search, candidate_order);
+      search.nn = search.evaluated.empty()
+                  ? NNResult{search.bsf, {}}
+                  : distance->eval_many(train_dataset[query_idx], search.evaluated, search.eval_bsf);
+    };
 
-      // 1NN variables, use a set to manage ties
-      // Start with same class: better chance to have a tight cutoff
-      std::set<EL> labels = {query_label};
-      const size_t first_idx = train_bcm[query_label][0];
-      F bsf = distance->eval(train_dataset[first_idx], query, utils::PINF);
+    // Evaluate the candidates 'search.tile' of a query, of indexes 'search.tile_indexes' in 'search.evaluated', with
+    // the current bsf of the query, merging their nearest neighbours in 'search.nn'
+    const auto search_tile = [&](size_t query_idx, NNSearch& search) {
+      if (search.tile.empty()) { return; }
+      const NNResult nn = distance->eval_many(train_dataset[query_idx], search.tile, search.nn.distance);
+      if (nn.distance<search.nn.distance) {
+        search.nn.distance = nn.distance;
+        search.nn.ties.clear();
+      }
+      if (nn.distance==search.nn.distance) {
+        for (size_t t : nn.ties) { search.nn.ties.push_back(search.tile_indexes[t]); }
+      }
+    };
+
+    // Route a query given its search, in the order of the queries of 'rt': updates the cache (or records its updates,
+    // see Routing::deferred), draws the ties from 'prng', and checks the Gini bound, 'rt' being the chunk 'chunk' of a
+    // chunked node. Return false if the generation is abandoned.
+    const auto route = [&](Routing& rt, PRNG& prng, size_t chunk, size_t query_idx, NNSearch const& search) -> bool {
+      NNResult const& nn = search.nn;
+      std::vector<size_t> const& evaluated_positions = search.evaluated_positions;
+      std::vector<size_t>& candidate_wins = rt.candidate_wins;
+      std::vector<size_t>& candidate_order = rt.candidate_order;
+      TieTracker& ties = rt.ties;
+      if (rt.deferred) {
+        rt.cache_hits += search.cache_hits;
+        rt.cache_lookups += nb_candidates;
+      } else {
+        nn1_state.cache_hits += search.cache_hits;
+        nn1_state.cache_lookups += nb_candidates;
+      }
+      state.count(TrainingProgress::DISTANCES, evaluated_positions.size());
+      ties.clear(nb_branches);
+      if (nn.distance==search.bsf) {
+        for (size_t i : search.cached_ties) { ties.insert(candidate_branches[i]); }
+      }
+      for (size_t j : nn.ties) { ties.insert(candidate_branches[evaluated_positions[j]]); }
+
+      // Count the wins, keeping the candidates sorted by decreasing wins (stable: a win moves one position up at most
+      // past the candidates it now exceeds)
+      const auto win = [&](size_t pos) {
+        const size_t nb_wins = ++candidate_wins[pos];
+        size_t o = std::find(candidate_order.begin(), candidate_order.end(), pos) - candidate_order.begin();
+        while (o>0&&candidate_wins[candidate_order[o - 1]]<nb_wins) {
+          std::swap(candidate_order[o - 1], candidate_order[o]);
+          --o;
+        }
+      };
+      if (nn.distance==search.bsf) { for (size_t i : search.cached_ties) { win(i); }}
+      for (size_t j : nn.ties) { win(evaluated_positions[j]); }
 
-      // Continue with other classes
-      for (size_t candidate_idx : train_idxset) {
-        if (candidate_idx!=first_idx) {
-          const auto& candidate = train_dataset[candidate_idx];
-          auto dist = distance->eval(candidate, query, bsf);
-          if (dist<bsf) {
-            labels.clear();
-            labels.insert(train_dataset.label(candidate_idx).value());
-            bsf = dist;
-          } else if (bsf==dist) { labels.insert(train_dataset.label(candidate_idx).value()); }
+      // Record the evaluated candidates: the ties are exact, the others are strictly above the nearest neighbours
+      if (!cache.full()&&nn.distance<utils::PINF) {
+        size_t t = 0;
+        for (size_t j = 0; j<evaluated_positions.size(); ++j) {
+          const uint64_t k = DistanceCache::key(query_idx, candidate_indexes[evaluated_positions[j]]);
+          const bool exact = t<nn.ties.size()&&nn.ties[t]==j;
+          if (exact) { ++t; }
+          if (rt.deferred) { rt.records.emplace_back(k, DistanceCache::Entry{nn.distance, exact}); }
+          else if (exact) { cache.set_exact(table, k, nn.distance); }
+          else { cache.set_bound(table, k, nn.distance); }
+        }
+      }
+      if (train_memo!=nullptr&&!train_memo->full()&&nn.distance<utils::PINF&&!evaluated_positions.empty()) {
+        auto locked = train_memo->lock(query_idx);
+        size_t t = 0;
+        for (size_t j = 0; j<evaluated_positions.size(); ++j) {
+          const auto mk = DistanceMemo::key(train_memo_key, query_idx, candidate_indexes[evaluated_positions[j]]);
+          if (t<nn.ties.size()&&nn.ties[t]==j) {
+            train_memo->set_exact(locked, mk, nn.distance);
+            ++t;
+          } else { train_memo->set_bound(locked, mk, nn.distance); }
         }
       }
 
       // Break ties and choose the branch according to the predicted label
-      tempo::EL predicted_label;
-      std::sample(labels.begin(), labels.end(), &predicted_label, 1, state.prng);
-      size_t predicted_index = label_to_branchIdx.at(predicted_label);
+      const size_t predicted_index = ties.pick(prng);
       // The predicted label gives us the branch, but the BCM at the branch must contain the real label
-      result_bcm_vec[predicted_index][query_label].push_back(query_idx);
+      const size_t query_class = label_classes[train_labels[query_idx]];
+      rt.query_indexes.push_back((uint32_t)query_idx);
+      rt.query_classes.push_back((uint32_t)query_class);
+      rt.query_branches.push_back((uint32_t)predicted_index);
+      const size_t cell_size = ++rt.cell_sizes[predicted_index*nb_classes + query_class];
+
+      if (best_score!=nullptr) {
+        double& n = rt.branch_size[predicted_index];
+        double& sq = rt.branch_sumsq[predicted_index];
+        if (n>0) { rt.gini_mass -= n - sq/n; }
+        n += 1;
+        sq += 2*(double)cell_size - 1;
+        rt.gini_mass += n - sq/n;
+        double gini_mass = rt.gini_mass;
+        if (!chunk_masses.empty()) {
+          chunk_masses[chunk].store(rt.gini_mass, std::memory_order_relaxed);
+          gini_mass = 0;
+          for (auto const& m : chunk_masses) { gini_mass += m.load(std::memory_order_relaxed); }
+        }
+        // Note: small margin for the rounding errors of the incremental mass (scores differ by at least 1/size^2)
+        const double bound = best_score->load(std::memory_order_relaxed);
+        if (gini_mass/total_size>bound + 1e-12) { return false; }
+      }
+      return true;
+    };
+
+    // Tiles of candidates of at most 'tile_bytes' bytes (a candidate at least), in the order of the candidates
+    std::vector<size_t>& tile_starts = scratch.tile_starts;
+    std::vector<size_t>& candidate_tiles = scratch.candidate_tiles;
+    if (!batched) {
+      size_t tile_size = 0;
+      for (size_t i = 0; i<nb_candidates; ++i) {
+        const size_t size = candidates[i]->size()*sizeof(F);
+        if (tile_starts.empty()||tile_size + size>tile_bytes) {
+          tile_starts.push_back(i);
+          tile_size = 0;
+        }
+        tile_size += size;
+        candidate_tiles.push_back(tile_starts.size() - 1);
+      }
+    }
+    const size_t nb_tiles = tile_starts.size();
+
+    if (!batched&&nb_tiles>1&&nb_queries>1) {
+      // Tiled: the candidates of a node do not fit in the cache. A block of queries is evaluated against a tile of
+      // candidates before the next tile, each tile being loaded once per block instead of once per query. Each query
+      // first evaluates its first candidate (the one of its class, or the most winning one) for a tight cutoff, then
+      // the others tile after tile with its current bsf: same nearest neighbours as above (see i_Dist::eval_many).
+      // As for the batched nodes, up to a block of searches may be done in vain with a Gini bound.
+      const distance::stats::Scope stats_scope([&]() {
+        return distance::stats::family(distance->get_distance_name());
+      });
+      std::vector<NNSearch>& searches = scratch.searches;
+      searches.resize(std::max(searches.size(), std::min(tile_queries, nb_queries)));
+      const std::vector<size_t>& queries = all_indexset.vector();
+      for (size_t block_start = 0; block_start<nb_queries; block_start += tile_queries) {
+        const size_t block_stop = std::min(nb_queries, block_start + tile_queries);
+        const auto distance_start = state.timers ? utils::now() : utils::time_point_t{};
+        for (size_t q = block_start; q<block_stop; ++q) {
+          NNSearch& search = searches[q - block_start];
+          resolve_nn(queries[q], search, routing.candidate_order);
+          search.nn = NNResult{search.eval_bsf, {}};
+          search.tile.assign(search.evaluated.begin(), search.evaluated.begin() + (search.evaluated.empty() ? 0 : 1));
+          search.tile_indexes.assign(search.tile.size(), 0);
+          search_tile(queries[q], search);
+        }
+        for (size_t tile = 0; tile<nb_tiles; ++tile) {
+          for (size_t q = block_start; q<block_stop; ++q) {
+            // The queries of a block are read once per tile: fetch the next one ahead
+            if (q + 1<block_stop) { prefetch_series(train_dataset[queries[q + 1]]); }
+            NNSearch& search = searches[q - block_start];
+            search.tile.clear();
+            search.tile_indexes.clear();
+            for (size_t j = 1; j<search.evaluated_positions.size(); ++j) {
+              if (candidate_tiles[search.evaluated_positions[j]]==tile) {
+                search.tile.push_back(search.evaluated[j]);
+                search.tile_indexes.push_back(j);
+              }
+            }
+            search_tile(queries[q], search);
+          }
+        }
+        for (size_t q = block_start; q<block_stop; ++q) {
+          std::vector<size_t>& qties = searches[q - block_start].nn.ties;
+          std::sort(qties.begin(), qties.end());
+        }
+        if (state.timers) { distance_time += utils::now() - distance_start; }
+        for (size_t q = block_start; q<block_stop; ++q) {
+          if (!route(routing, state.prng, 0, queries[q], searches[q - block_start])) {
+            record_distance_time();
+            return abandoned();
+          }
+        }
+      }
+    } else if (!batched&&!chunked) {
+      const distance::stats::Scope stats_scope([&]() {
+        return distance::stats::family(distance->get_distance_name());
+      });
+      if (scratch.searches.empty()) { scratch.searches.resize(1); }
+      NNSearch& search = scratch.searches.front();
+      for (auto query_idx : all_indexset) {
+        const auto distance_start = state.timers ? utils::now() : utils::time_point_t{};
+        search_nn(query_idx, search, routing.candidate_order);
+        if (state.timers) { distance_time += utils::now() - distance_start; }
+        if (!route(routing, state.prng, 0, query_idx, search)) {
+          record_distance_time();
+          return abandoned();
+        }
+      }
+    } else if (batched) {
+      // Batched: the searches of a block of queries run concurrently, then the block is routed in order.
+      // Same result as above: the searches of a block do not depend on each other (the cache is keyed by query).
+      const size_t block_size = batch_block_per_thread*batch_nb_threads;
+      std::vector<NNSearch>& searches = scratch.searches;
+      searches.resize(std::min(block_size, nb_queries));
+      const std::vector<size_t>& queries = all_indexset.vector();
+      for (size_t block_start = 0; block_start<nb_queries; block_start += block_size) {
+        const size_t block_stop = std::min(nb_queries, block_start + block_size);
+        const auto distance_start = state.timers ? utils::now() : utils::time_point_t{};
+        utils::ParTasks p;
+        p.execute((int)batch_nb_threads, [&](size_t q) {
+          const distance::stats::Scope stats_scope([&]() {
+            return distance::stats::family(distance->get_distance_name());
+          });
+          search_nn(queries[q], searches[q - block_start], routing.candidate_order);
+        }, block_start, block_stop);
+        if (state.timers) { distance_time += utils::now() - distance_start; }
+        for (size_t q = block_start; q<block_stop; ++q) {
+          if (!route(routing, state.prng, 0, queries[q], searches[q - block_start])) {
+            record_distance_time();
+            return abandoned();
+          }
+        }
+      }
+    } else {
+      // Chunked: the queries are split in chunks of 'chunk_queries', searched and routed concurrently, each with its
+      // own routing and its own PRNG (derived from the state's PRNG and the chunk index), then merged in the order of
+      // the chunks: the queries are partitioned in order, and the result does not depend on the number of threads
+      // (with one thread, the chunks run in order).
+      // Unlike the other modes, the ties are not drawn from the state's PRNG, and the candidates are evaluated in the
+      // order of the wins of their chunk. The updates of the cache are recorded after the routing.
+      const size_t nb_chunks = (nb_queries + chunk_queries - 1)/chunk_queries;
+      const uint64_t chunks_key = state.prng();
+      std::vector<RouteChunk> chunks(nb_chunks);
+      for (size_t c = 0; c<nb_chunks; ++c) {
+        chunks[c].prng.seed(TreeState::derive_stream(chunks_key, TreeState::ROUTE, c));
+        chunks[c].routing.reset(nb_branches, nb_classes, nb_candidates);
+        chunks[c].routing.deferred = true;
+      }
+      if (best_score!=nullptr) { chunk_masses = std::vector<std::atomic<double>>(nb_chunks); }
+      std::atomic<bool> stop{false};
+      const std::vector<size_t>& queries = all_indexset.vector();
+      const auto distance_start = state.timers ? utils::now() : utils::time_point_t{};
+      utils::ParTasks p;
+      p.execute((int)batch_nb_threads, [&](size_t c) {
+        const distance::stats::Scope stats_scope([&]() {
+          return distance::stats::family(distance->get_distance_name());
+        });
+        RouteChunk& chunk = chunks[c];
+        const size_t chunk_stop = std::min(nb_queries, (c + 1)*chunk_queries);
+        for (size_t q = c*chunk_queries; q<chunk_stop&&!stop.load(std::memory_order_relaxed); ++q) {
+          search_nn(queries[q], chunk.search, chunk.routing.candidate_order);
+          if (!route(chunk.routing, chunk.prng, c, queries[q], chunk.search)) {
+            stop.store(true, std::memory_order_relaxed);
+          }
+        }
+      }, 0, nb_chunks);
+      if (state.timers) { distance_time += utils::now() - distance_start; }
+      // Merge the counters and the cache updates, also when abandoned
+      for (RouteChunk& chunk : chunks) {
+        nn1_state.cache_hits += chunk.routing.cache_hits;
+        nn1_state.cache_lookups += chunk.routing.cache_lookups;
+        for (const auto& [k, e] : chunk.routing.records) {
+          if (cache.full()) { break; }
+          if (e.exact) { cache.set_exact(table, k, e.value); } else { cache.set_bound(table, k, e.value); }
+        }
+      }
+      if (stop.load()) {
+        record_distance_time();
+        return abandoned();
+      }
+      // Merge the partitions in the order of the chunks, and the wins: the candidates by decreasing total wins
+      routing.query_indexes.reserve(nb_queries);
+      routing.query_classes.reserve(nb_queries);
+      routing.query_branches.reserve(nb_queries);
+      for (RouteChunk const& chunk : chunks) {
+        Routing const& rt = chunk.routing;
+        routing.query_indexes.insert(routing.query_indexes.end(), rt.query_indexes.begin(), rt.query_indexes.end());
+        routing.query_classes.insert(routing.query_classes.end(), rt.query_classes.begin(), rt.query_classes.end());
+        routing.query_branches.insert(routing.query_branches.end(), rt.query_branches.begin(), rt.query_branches.end());
+        for (size_t i = 0; i<routing.cell_sizes.size(); ++i) { routing.cell_sizes[i] += rt.cell_sizes[i]; }
+        for (size_t i = 0; i<nb_candidates; ++i) { routing.candidate_wins[i] += rt.candidate_wins[i]; }
+      }
+      std::stable_sort(routing.candidate_order.begin(), routing.candidate_order.end(), [&](size_t a, size_t b) {
+        return routing.candidate_wins[a]>routing.candidate_wins[b];
+      });
     }
 
-    // Convert the vector of ByClassMap::BCMvec_t in a vector of ByClassMap.
+    record_distance_time();
+    const auto bcm_scope = state.time("train/node/nn1/bcm");
+
+    // Partition the queries in a vector of ByClassMap, indexed by branch.
     // IMPORTANT: ensure that no empty BCM is generated
-    // If we get an empty map, we have to add the  mapping (label for this index -> empty vector)
+    // If we get an empty branch, we have to add the  mapping (label for this index -> empty vector)
     // This ensures that no empty BCM is ever created. This is also why we iterate over the label: so we have them!
-    std::vector<ByClassMap> v_bcm;
-    for (EL label : bcm.classes()) {
-      size_t idx = label_to_branchIdx.at(label);
-      if (result_bcm_vec[idx].empty()) { result_bcm_vec[idx][label] = {}; }
-      v_bcm.emplace_back(std::move(result_bcm_vec[idx]));
+    // An empty branch gets the label of its exemplar.
+    std::vector<EL> branch_labels(nb_branches);
+    for (const auto& [label, branch] : label_to_branchIdx) { branch_labels[branch] = label; }
+    auto splitter = std::make_unique<SplitterNN1>(train_idxset, label_to_branchIdx, std::move(distance), tid,
+                                                  train_labels, routing.candidate_order);
+    // Candidate of a chooser: score-only, the chooser only builds the branch splits of the chosen candidate.
+    // The queries were routed in the order of the node's index set, as expected by Result::materialize.
+    if (best_score!=nullptr&&nb_branches<=std::numeric_limits<uint16_t>::max()) {
+      return i_GenNode::Result{
+        .splitter = std::move(splitter),
+        .branch_splits = {},
+        .cost = candidate_cost,
+        .score_only = i_GenNode::Result::ScoreOnly{
+          .branches = std::vector<uint16_t>(routing.query_branches.begin(), routing.query_branches.end()),
+          .counts = routing.cell_sizes,
+          .branch_labels = std::move(branch_labels)
+        }
+      };
     }
+    const std::vector<EL> class_labels(bcm.classes().begin(), bcm.classes().end());
+    const std::vector<FlatBCM> flat = FlatBCM::partition(class_labels, nb_branches,
+                                                         routing.query_indexes, routing.query_classes,
+                                                         routing.query_branches);
+    std::vector<ByClassMap> v_bcm;
+    v_bcm.reserve(nb_branches);
+    for (size_t b = 0; b<nb_branches; ++b) { v_bcm.push_back(flat[b].to_BCM(branch_labels[b])); }
 
     return i_GenNode::Result{
-      .splitter = std::make_unique<SplitterNN1>(train_idxset, label_to_branchIdx, std::move(distance)),
-      .branch_splits = std::move(v_bcm)
+      .splitter = std::move(splitter),
+      .branch_splits = std::move(v_bcm),
+      .cost = candidate_cost
     };
   } // End of generate function
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Test time routing
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  void SplitterNN1::get_branch_indexes(TreeState& tstate, TreeData const& tdata, std::span<size_t const> indexes,
+                                       std::span<size_t> branches) {
+    // Data access, resolved by transform ID. A virtual test transform is derived from its source on the fly.
+    const DTS& train_dataset = at_train(tdata, transform_id);
+    const std::optional<size_t> source_id = virtual_test_source(tdata, transform_id);
+    const DTS& test_dataset = at_test(tdata, source_id.value_or(transform_id));
+
+    // Candidates in evaluation order, with their branch
+    thread_local std::vector<TSeries const *> candidates;
+    thread_local std::vector<size_t> candidate_indexes;
+    thread_local std::vector<size_t> candidate_branches;
+    candidates.clear();
+    candidate_indexes.clear();
+    candidate_branches.clear();
+    for (size_t k = 0; k<train_indexset.size(); ++k) {
+      const size_t pos = eval_order.empty() ? k : eval_order[k];
+      candidate_indexes.push_back(train_indexset[pos]);
+      candidates.push_back(&train_dataset[train_indexset[pos]]);
+      candidate_branches.push_back(exemplar_branches[pos]);
+    }
+
+    // NN1 test of each exemplar, returning the branch matching the predicted label
+    const distance::stats::Scope stats_scope([&]() {
+      return distance::stats::family(distance->get_distance_name());
+    });
+    const auto scope = tstate.time(distance_phase(tstate, "predict/distance/", *distance));
+    thread_local TieTracker ties;
+    for (size_t k = 0; k<indexes.size(); ++k) {
+      const size_t index = indexes[k];
+      const NNResult nn = memo_eval_many(tstate, tdata, *distance, distance_memo_key, index, test_dataset[index],
+                                         candidates, candidate_indexes, source_id.has_value());
+      ties.clear(labels_to_branch_idx.size());
+      for (size_t i : nn.ties) { ties.insert(candidate_branches[i]); }
+      branches[k] = ties.pick(tstate.prng);
+    }
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Serialization
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  void SplitterNN1::save(BinWriter& out) const {
+    const std::string tname = distance->get_transformation_name();
+    out.write_string(splitter_nn1_tag);
+    // Exemplars, referenced by their index in the model
+    out.write<uint64_t>(train_indexset.size());
+    for (size_t idx : train_indexset) { out.write<uint64_t>(out.exemplar(tname, idx)); }
+    // Label to branch mapping
+    out.write<uint64_t>(labels_to_branch_idx.size());
+    for (const auto& [label, branch] : labels_to_branch_idx) {
+      out.write<uint64_t>(label);
+      out.write<uint64_t>(branch);
+    }
+    // Distance
+    distance->save(out);
+  }
+
+  void SplitterNN1::collect_exemplars(ExemplarTable& table) const {
+    // In evaluation order: a per node compact layout stores them in the order they are visited
+    const std::string tname = distance->get_transformation_name();
+    for (size_t k = 0; k<train_indexset.size(); ++k) {
+      register_exemplar(table, tname, train_indexset[eval_order.empty() ? k : eval_order[k]]);
+    }
+  }
+
+  void SplitterNN1::remap_exemplars(ExemplarTable const& table, TreeData const& data) {
+    const std::string tname = distance->get_transformation_name();
+    std::map<size_t, size_t> const& index_map = table.at(tname);
+    std::vector<size_t> indexes;
+    indexes.reserve(train_indexset.size());
+    for (size_t idx : train_indexset) { indexes.push_back(index_map.at(idx)); }
+    train_indexset = IndexSet(std::move(indexes));
+    transform_id = TSChief::transform_id(data, tname);
+    set_exemplar_branches(at_train(data, transform_id));
+    distance->prepare(data, train_indexset);
+  }
+
+  std::unique_ptr<i_SplitterNode> load_splitter_nn1(BinReader& in, TreeData const& data) {
+    // Exemplars
+    std::vector<size_t> indexes(in.read_size());
+    for (size_t& idx : indexes) { idx = in.read_size(); }
+    IndexSet is(std::move(indexes));
+    // Label to branch mapping
+    std::map<EL, size_t> labels_to_branch_idx;
+    const size_t nb_labels = in.read_size();
+    for (size_t i = 0; i<nb_labels; ++i) {
+      const EL label = in.read_size();
+      labels_to_branch_idx[label] = in.read_size();
+    }
+    // Distance
+    std::unique_ptr<i_Dist> distance = load_distance(in);
+    const size_t tid = transform_id(data, distance->get_transformation_name());
+    const DTS& train_dataset = at_train(data, tid);
+    for (size_t idx : is) {
+      if (idx>=train_dataset.size()) { throw std::runtime_error("Model deserialization: invalid exemplar index"); }
+    }
+    distance->prepare(data, is);
+    return std::make_unique<SplitterNN1>(std::move(is), std::move(labels_to_branch_idx), std::move(distance), tid,
+                                         train_dataset);
+  }
+
+  std::unique_ptr<i_Dist> load_distance(BinReader& in) {
+    const std::string tag = in.read_string();
+    if (tag==DA::tag) { return DA::load(in); }
+    else if (tag==ADTW::tag) { return ADTW::load(in); }
+    else if (tag==DTW::tag) { return DTW::load(in); }
+    else if (tag==DTWFull::tag) { return DTWFull::load(in); }
+    else if (tag==WDTW::tag) { return WDTW::load(in); }
+    else if (tag==ERP::tag) { return ERP::load(in); }
+    else if (tag==LCSS::tag) { return LCSS::load(in); }
+    else if (tag==MSM::tag) { return MSM::load(in); }
+    else if (tag==SBD::tag) { return SBD::load(in); }
+    else if (tag==SoftDTW::tag) { return SoftDTW::load(in); }
+    else if (tag==TWE::tag) { return TWE::load(in); }
+    else { throw std::runtime_error("Model deserialization: unknown distance '" + tag + "'"); }
+  }
+
 } // End of namespace tempo::classifier::PF2::snode::nn1splitter
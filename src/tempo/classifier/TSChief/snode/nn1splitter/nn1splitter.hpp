@@ -1,9 +1,11 @@
 #pragma once
 
+#include <limits>
 #include <map>
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 
 #include <tempo/utils/utils.hpp>
 #include <tempo/dataset/dts.hpp>
@@ -16,6 +18,59 @@
 
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Distances between the queries and the exemplars of a node
+
+  /** Per distance (identified by its serialized form: type, transform and parameters), memoize the distances between
+   *  a query and an exemplar, given by their index in the train data.
+   *  An entry is either the exact distance, or a strict lower bound: the exemplar was not a nearest neighbour of the
+   *  query, with nearest neighbours at this distance.
+   *  Entries are only added while the cache holds less than 'max_entries'.
+   *  The tables of the distances of a same family ordered by their window (see i_Dist::window_family) are also
+   *  indexed by family: the entries of a table bound the distances of the other windows.
+   */
+  struct DistanceCache {
+    struct Entry {
+      F value;
+      bool exact;
+    };
+
+    using Table = std::unordered_map<uint64_t, Entry>;
+
+    static constexpr size_t max_entries = size_t(1) << 18;
+
+    std::map<std::string, Table> tables{};
+    size_t nb_entries{0};
+
+    /// Per family key, the tables of the family by window
+    std::map<std::string, std::map<size_t, Table const *>> families{};
+
+    static uint64_t key(size_t query_idx, size_t exemplar_idx) {
+      return ((uint64_t)query_idx << 32) | (uint64_t)(uint32_t)exemplar_idx;
+    }
+
+    bool full() const { return nb_entries>=max_entries; }
+
+    /// Record an exact distance
+    void set_exact(Table& table, uint64_t k, F value) {
+      auto [it, inserted] = table.try_emplace(k, Entry{value, true});
+      if (inserted) { ++nb_entries; } else { it->second = Entry{value, true}; }
+    }
+
+    /// Record a strict lower bound, unless an exact distance or a greater bound is known
+    void set_bound(Table& table, uint64_t k, F bound) {
+      auto [it, inserted] = table.try_emplace(k, Entry{bound, false});
+      if (inserted) { ++nb_entries; }
+      else if (!it->second.exact&&it->second.value<bound) { it->second.value = bound; }
+    }
+
+    void clear() {
+      tables.clear();
+      families.clear();
+      nb_entries = 0;
+    }
+  };
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Specific state for NN1 snode generator
 
@@ -26,6 +81,17 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     /// Per node IndexSet cache
     std::optional<IndexSet> cache_index_set{};
 
+    /// Per node, per transform standard deviation cache
+    std::map<std::string, F> cache_stddev{};
+
+    /// Per node cache of the distances computed by the candidates (see GenSplitterNN1::generate)
+    DistanceCache cache_distances{};
+
+    /// Query/exemplar pairs looked up in cache_distances, and pairs resolved by it (hits).
+    /// Accumulated over the nodes, and merged from the forked states: read them in the state given to the trainer.
+    size_t cache_lookups{0};
+    size_t cache_hits{0};
+
     // --- --- --- Constructors/Constructors
 
     GenSplitterNN1_State() = default;
@@ -40,26 +106,72 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
 
     // --- --- --- Methods
 
-    /// Helper for the index set
+    /// Helper for the index set.
+    /// A node may generate candidates on a subset of its data (see SplitterChooserGen::node_sample_ratio) before
+    /// splitting all of it: the subsets of a node being nested, the caches are reset when the size changes.
     const IndexSet& get_index_set(const ByClassMap& bcm) {
+      if (cache_index_set&&cache_index_set->size()!=bcm.size()) {
+        cache_index_set = {};
+        cache_stddev.clear();
+      }
       if (!cache_index_set) { cache_index_set = std::make_optional<IndexSet>(bcm.to_IndexSet()); }
       return cache_index_set.value();
     }
 
-    std::unique_ptr<i_TreeState> forest_fork(size_t /* tree_idx */) const override {
-      return std::unique_ptr<i_TreeState>(new GenSplitterNN1_State());
+    /// Helper for the standard deviation of the train data of the transform 'tn' reaching the node.
+    /// For multivariate data, norm of the per dimension standard deviations (see stddev_norm).
+    F get_stddev(const TreeData& data, const ByClassMap& bcm, const std::string& tn) {
+      const IndexSet& is = get_index_set(bcm);
+      auto it = cache_stddev.find(tn);
+      if (it==cache_stddev.end()) {
+        const F sd = stddev_norm(at_train_sums(data, transform_id(data, tn)), is);
+        it = cache_stddev.emplace(tn, sd).first;
+      }
+      return it->second;
     }
 
-    void forest_merge_in(std::unique_ptr<i_TreeState>&& /* other */ ) override { /* nothing */ }
+    /// Fork by value (see StaticStates): the caches are per node, a fork starts empty
+    GenSplitterNN1_State fork(size_t /* tree_idx */) const { return {}; }
 
-    void start_branch(size_t /* branch_idx */) override { cache_index_set = {}; }
+    /// Merge by value (see StaticStates)
+    void merge_in(GenSplitterNN1_State&& other) {
+      cache_lookups += other.cache_lookups;
+      cache_hits += other.cache_hits;
+    }
+
+    std::unique_ptr<i_TreeState> forest_fork(size_t tree_idx) const override {
+      return std::make_unique<GenSplitterNN1_State>(fork(tree_idx));
+    }
+
+    void forest_merge_in(std::unique_ptr<i_TreeState>&& other) override {
+      auto *other_state = dynamic_cast<GenSplitterNN1_State *>(other.get());
+      if (other_state==nullptr) { tempo::utils::should_not_happen("Dynamic cast to GenSplitterNN1_State failed"); }
+      merge_in(std::move(*other_state));
+    }
+
+    /// Ratio of the lookups resolved by the distance cache
+    double cache_hit_rate() const { return cache_lookups==0 ? 0 : (double)cache_hits/(double)cache_lookups; }
+
+    /// Release the per node caches
+    void clear_caches() {
+      cache_index_set = {};
+      cache_stddev.clear();
+      cache_distances.clear();
+    }
+
+    void start_branch(size_t /* branch_idx */) override { clear_caches(); }
 
     void end_branch(size_t /* branch_idx */) override { /* nothing */ }
+
+    /// Not kept while the branches of the node are trained
+    void end_node() override { clear_caches(); }
   };
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // NN1 Time Series Distance Splitter Generator
 
+  struct SplitterNN1;
+
   struct GenSplitterNN1 : public i_GenNode {
 
     // --- --- --- Types
@@ -72,6 +184,36 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     /// Train State access
     std::shared_ptr<i_GetState<GenSplitterNN1_State>> get_train_state;
 
+    /// Nodes with at least this number of exemplars search the nearest neighbours of their queries by blocks, using
+    /// 'batch_nb_threads' threads. The queries of a block are then routed in order: same result as the sequential
+    /// search, but, with a Gini bound (see generate_bounded), up to a block of searches may be done in vain.
+    size_t batch_min_size{std::numeric_limits<size_t>::max()};
+
+    /// Number of threads of the batched nodes (see batch_min_size). No batching if <= 1.
+    size_t batch_nb_threads{1};
+
+    /// Number of queries per thread in a block of a batched node
+    static constexpr size_t batch_block_per_thread = 64;
+
+    /// Nodes with at least this number of exemplars split their queries in chunks of 'chunk_queries', searched and
+    /// routed concurrently on 'batch_nb_threads' threads (in order with one thread), instead of batched (where the
+    /// routing is sequential). Each chunk draws its ties from its own PRNG, derived from the state's PRNG: the result
+    /// does not depend on the number of threads, but differs from the unchunked one when there are ties.
+    /// A chunk abandons as soon as the Gini masses of all the chunks exceed the bound (see generate_bounded).
+    size_t chunk_min_size{std::numeric_limits<size_t>::max()};
+    static constexpr size_t chunk_queries = 1024;
+
+    /// The nodes not batched whose candidates take more than 'tile_bytes' bytes (about a L2 cache) evaluate their
+    /// queries by blocks of 'tile_queries', against tiles of candidates of at most 'tile_bytes': each tile is read from
+    /// memory once per block rather than once per query. Same result, each query keeping its own bsf.
+    size_t tile_bytes{size_t(1) << 18};
+    static constexpr size_t tile_queries = 64;
+
+    /// Nodes with more than 'max_fanout' classes (if at least 2) group them in 'max_fanout' branches: instead of one
+    /// exemplar per class, one per group, spread among the class exemplars (see generate). The upper levels of the
+    /// trees split on groups of classes, bounding the distances per query and the branches per node. 0: off.
+    size_t max_fanout{0};
+
     // --- --- --- Constructors/Destructors
 
     /// Construction with a distance generator
@@ -88,6 +230,28 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     /// Generate a snode based on the distance generator specified at build time
     i_GenNode::Result generate(TreeState& state, TreeData const& data, ByClassMap const& bcm) override;
 
+    /// Abandon when the weighted Gini impurity of the queries already routed exceeds 'best_score':
+    /// routing more queries can only increase it.
+    i_GenNode::Result generate_bounded(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                       std::atomic<double> const& best_score) override;
+
+    /// Route all the queries of 'bcm' with the distance and the exemplars of 'splitter', a SplitterNN1
+    i_GenNode::Result split_with(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                 std::unique_ptr<i_SplitterNode>&& splitter) override;
+
+  private:
+
+    /// With 'fixed', take its distance and exemplars instead of generating them
+    i_GenNode::Result generate_impl(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                    std::atomic<double> const *best_score, SplitterNN1 *fixed = nullptr);
+
   };
 
+  /// Tag of the NN1 splitter in the model format
+  inline const std::string splitter_nn1_tag{"nn1"};
+
+  /// Load a NN1 splitter written by its save method (tag already read).
+  /// Exemplars are drawn from the train data in 'data', which must be the exemplars saved with the model.
+  std::unique_ptr<i_SplitterNode> load_splitter_nn1(BinReader& in, TreeData const& data);
+
 } // End of namespace tempo::classifier::PF2::snode::nn1splitter
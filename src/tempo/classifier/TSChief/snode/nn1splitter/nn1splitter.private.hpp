@@ -2,18 +2,87 @@
 
 #include <map>
 #include <memory>
+#include <span>
 #include <string>
+#include <vector>
 
 #include <tempo/utils/utils.hpp>
 #include <tempo/dataset/dts.hpp>
+#include <tempo/distance/stats.hpp>
 
 #include <tempo/classifier/TSChief/treedata.hpp>
 #include <tempo/classifier/TSChief/treestate.hpp>
 #include <tempo/classifier/TSChief/splitter_interface.hpp>
 
+#include "nn1dist_interface.hpp"
+
 namespace tempo::classifier::TSChief::snode::nn1splitter {
 
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Ties between the labels of nearest neighbours
+
+  /// Set of the labels of the nearest neighbours of a query, represented by their branch index in [0, nb_classes[.
+  /// A flag per branch and the list of inserted branches: clearing it only resets the inserted flags,
+  /// reusing it across queries does not allocate.
+  struct TieTracker {
+    std::vector<uint8_t> inserted{};
+    std::vector<size_t> branches{};
+
+    /// Empty the set, for labels in [0, nb_classes[
+    void clear(size_t nb_classes) {
+      for (size_t b : branches) { inserted[b] = 0; }
+      branches.clear();
+      if (inserted.size()<nb_classes) { inserted.resize(nb_classes, 0); }
+    }
+
+    void insert(size_t branch) {
+      if (inserted[branch]==0) {
+        inserted[branch] = 1;
+        branches.push_back(branch);
+      }
+    }
+
+    bool empty() const { return branches.empty(); }
+
+    /// Pick one branch at random. Branch indexes follow the labels order:
+    /// the draw is the same as sampling from the std::set of the labels.
+    size_t pick(PRNG& prng) {
+      assert(!empty());
+      std::sort(branches.begin(), branches.end());
+      size_t result;
+      std::sample(branches.begin(), branches.end(), &result, 1, prng);
+      return result;
+    }
+  };
+
+  /// Phase timing the evaluations of 'distance': 'prefix' followed by the distance family (e.g. "DTW").
+  /// Empty when 'state' has no timers, without computing the name of the distance.
+  inline std::string distance_phase(TreeState const& state, std::string_view prefix, i_Dist& distance) {
+    if (!state.timers) { return {}; }
+    return std::string(prefix) + distance::stats::family(distance.get_distance_name());
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Test time distance memo
+
+  /// Identify a distance by its serialized form (type, transform and exact parameters)
+  std::string distance_key(i_Dist const& distance);
+
+  /// Hash of the distance_key of 'distance', identifying it in a DistanceMemo
+  uint64_t memo_key(i_Dist const& distance);
+
+  /// Nearest neighbours of the registered test exemplar 'test_idx' (the series 'query') in 'candidates', as
+  /// distance.eval_many_test on the test data of 'data' with an infinite bsf, through the memo of 'state' if any
+  /// (see TreeState::memo).
+  /// The candidates resolved by the memo are not evaluated, and the distances found are recorded in it.
+  /// 'key' identifies the distance (see memo_key), and 'train_indexes' gives the train index of each candidate.
+  /// With 'derive_query', 'query' is raw, and the search is done with its derivative
+  /// (see i_Dist::eval_many_derivative).
+  NNResult memo_eval_many(TreeState const& state, TreeData const& data, i_Dist& distance, uint64_t key,
+                          size_t test_idx, TSeries const& query, std::span<TSeries const *const> candidates,
+                          std::span<size_t const> train_indexes, bool derive_query = false);
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // NN1 Time Series Distance Splitter
 
@@ -30,49 +99,96 @@ namespace tempo::classifier::TSChief::snode::nn1splitter {
     /// Distance function
     std::unique_ptr<i_Dist> distance;
 
+    /// ID of the distance's transform in the TreeData the splitter was built with (see TreeData::transform_ids)
+    size_t transform_id;
+
+    /// Order in which the exemplars are evaluated, as positions in train_indexset (most frequent nearest neighbour
+    /// of the train queries first, see GenSplitterNN1::generate). Empty: train_indexset order (e.g. loaded models).
+    /// Does not change the result, only how early the other exemplars are abandoned.
+    std::vector<size_t> eval_order;
+
+    /// Identify the distance in the test time memo (see memo_key)
+    uint64_t distance_memo_key;
+
+    /// Branch of each exemplar, by position in train_indexset: labels_to_branch_idx resolved once, the test queries
+    /// are routed without label lookup
+    std::vector<size_t> exemplar_branches;
+
     // --- --- --- Constructors/Destructors
 
+    /// The labels of the exemplars are read from 'labels' (see exemplar_branches): the TrainLabels of the training,
+    /// or the train data of the distance's transform
+    template<typename Labels>
     SplitterNN1(
       IndexSet is,
       std::map<EL, size_t> labels_to_branch_idx,
-      std::unique_ptr<i_Dist> dist
+      std::unique_ptr<i_Dist> dist,
+      size_t transform_id,
+      Labels const& labels,
+      std::vector<size_t> eval_order = {}
     ) :
       train_indexset(std::move(is)),
       labels_to_branch_idx(std::move(labels_to_branch_idx)),
-      distance(std::move(dist))
-    {}
+      distance(std::move(dist)),
+      transform_id(transform_id),
+      eval_order(std::move(eval_order)),
+      distance_memo_key(memo_key(*distance)) {
+      set_exemplar_branches(labels);
+    }
 
     // --- --- --- Methods
 
-    size_t get_branch_index(TreeState& tstate, TreeData const& tdata, size_t index) override {
-      // Distance info access
-      std::string tname = distance->get_transformation_name();
-
-      // Data access
-      const DTS& train_dataset = at_train(tdata).at(tname);
-      const DTS& test_dataset = at_test(tdata).at(tname);
-      const TSeries& test_exemplar = test_dataset[index];
-
-      // NN1 test loop
-      F bsf = utils::PINF;
-      std::set<EL> labels;
-      for (size_t candidate_idx : train_indexset) {
-        const auto& candidate = train_dataset[candidate_idx];
-        F d = distance->eval(candidate, test_exemplar, bsf);
-        if (d<bsf) {
-          labels.clear();
-          labels.insert(train_dataset.label(candidate_idx).value());
-          bsf = d;
-        } else if (bsf==d) { labels.insert(train_dataset.label(candidate_idx).value()); }
+    /// Resolve the branch of each exemplar, after a change of exemplars, with the dense labels of the training
+    void set_exemplar_branches(TrainLabels const& labels) {
+      exemplar_branches.clear();
+      exemplar_branches.reserve(train_indexset.size());
+      for (size_t idx : train_indexset) { exemplar_branches.push_back(labels_to_branch_idx.at(labels[idx])); }
+    }
+
+    /// Resolve the branch of each exemplar with the labels of 'train_dataset', the train data of the distance's
+    /// transform: the exemplars of a loaded or merged model are numbered per transform (see ExemplarTable), unlike
+    /// the TrainLabels of its data.
+    void set_exemplar_branches(DTS const& train_dataset) {
+      exemplar_branches.clear();
+      exemplar_branches.reserve(train_indexset.size());
+      for (size_t idx : train_indexset) {
+        const std::optional<EL> label = train_dataset.label(idx);
+        if (!label) { throw std::runtime_error("NN1 splitter: unlabelled exemplar"); }
+        exemplar_branches.push_back(labels_to_branch_idx.at(label.value()));
       }
-      assert(!labels.empty());
+    }
+
+    size_t get_branch_index(TreeState& tstate, TreeData const& tdata, size_t index) override {
+      size_t branch;
+      get_branch_indexes(tstate, tdata, std::span<size_t const>(&index, 1), std::span<size_t>(&branch, 1));
+      return branch;
+    }
+
+    /// The exemplars are gathered once, in evaluation order, and stay in cache for all the test exemplars
+    void get_branch_indexes(TreeState& tstate, TreeData const& tdata, std::span<size_t const> indexes,
+                            std::span<size_t> branches) override;
+
+    /// Write the exemplars (as indexes in the model), the label to branch mapping, and the distance
+    void save(BinWriter& out) const override;
+
+    void collect_exemplars(ExemplarTable& table) const override;
+
+    /// Also prepare the distance for the renumbered exemplars
+    void remap_exemplars(ExemplarTable const& table, TreeData const& data) override;
+
+    /// The splitter, its exemplar indexes and branches, and its label mapping
+    /// (std::map nodes counted as 4 pointers and a value).
+    /// Data cached by the distance (e.g. envelopes or weights), shared with other splitters, is not counted.
+    size_t nb_bytes() const override {
+      using value_type = decltype(labels_to_branch_idx)::value_type;
+      return sizeof(SplitterNN1) + (2*train_indexset.size() + eval_order.size())*sizeof(size_t)
+        + labels_to_branch_idx.size()*(sizeof(value_type) + 4*sizeof(void *));
+    }
 
-      // Return the branch matching the predicted label
-      EL predicted_label;
-      std::sample(labels.begin(), labels.end(), &predicted_label, 1, tstate.prng);
-      return labels_to_branch_idx.at(predicted_label);
+    /// Family of the distance, e.g. "DTW"
+    std::string kind() const override { return distance::stats::family(distance->get_distance_name()); }
 
-    } // End of function get_branch_index
+    size_t nb_exemplars() const override { return train_indexset.size(); }
   };
 
 } // End of namespace tempo::classifier::PF2::snode::nn1splitter
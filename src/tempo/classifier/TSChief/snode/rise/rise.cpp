@@ -0,0 +1,219 @@
+#include "rise.hpp"
+
+#include <tempo/transform/core/univariate.spectral.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace tempo::classifier::TSChief::snode::rise {
+
+  namespace spectral = tempo::transform::core::univariate;
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Interval features
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  std::string rise_key(std::string const& tname, Interval interval, RISEFeature feature) {
+    return "rise:" + tname + ":" + std::to_string(interval.start) + ":" + std::to_string(interval.length) + ":"
+      + (feature==RISEFeature::ACF ? "acf" : "ps");
+  }
+
+  size_t rise_nb_features(Interval interval, RISEFeature feature) {
+    const size_t nb = feature==RISEFeature::ACF ? std::min<size_t>(100, interval.length/4) : interval.length/2;
+    return std::max<size_t>(1, nb);
+  }
+
+  IntervalFeatures rise_features(DTS const& dts, Interval interval, RISEFeature feature) {
+    const size_t nbf = rise_nb_features(interval, feature);
+    IntervalFeatures result{nbf, std::vector<F>(dts.size()*nbf, 0)};
+    for (size_t i = 0; i<dts.size(); ++i) {
+      TSeries const& s = dts[i];
+      if (interval.start>=s.length()) { continue; }
+      const size_t length = std::min(interval.length, s.length() - interval.start);
+      F *out = result.values.data() + i*nbf;
+      if (feature==RISEFeature::ACF) { spectral::acf<F>(s.data() + interval.start, length, nbf, out); }
+      else { spectral::power_spectrum<F>(s.data() + interval.start, length, nbf, out); }
+    }
+    return result;
+  }
+
+  std::vector<Interval> make_rise_pool(size_t nb, size_t min_length, PRNG& prng) {
+    if (min_length==0) { throw std::invalid_argument("RISE intervals of empty series"); }
+    std::uniform_int_distribution<size_t> length_dist(std::min<size_t>(16, min_length), min_length);
+    std::vector<Interval> pool;
+    pool.reserve(nb);
+    for (size_t i = 0; i<nb; ++i) {
+      const size_t length = length_dist(prng);
+      std::uniform_int_distribution<size_t> start_dist(0, min_length - length);
+      pool.push_back({start_dist(prng), length});
+    }
+    return pool;
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // RISE splitter
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  SplitterRISE::SplitterRISE(std::string transform_name, size_t transform_id, Interval interval, RISEFeature feature,
+                             size_t attribute, F threshold) :
+    transform_name(std::move(transform_name)),
+    transform_id(transform_id),
+    interval(interval),
+    feature(feature),
+    attribute(attribute),
+    threshold(threshold),
+    key(rise_key(this->transform_name, interval, feature)) {}
+
+  size_t SplitterRISE::get_branch_index(TreeState& /* state */, TreeData const& data, size_t index) {
+    const auto features = at_test_features(data).get<IntervalFeatures>(key, [&]() {
+      return rise_features(at_test(data, transform_id), interval, feature);
+    });
+    return features->at(index, attribute)<=threshold ? 0 : 1;
+  }
+
+  void SplitterRISE::save(BinWriter& out) const {
+    out.write_string(tag);
+    out.write_string(transform_name);
+    out.write<uint64_t>(interval.start);
+    out.write<uint64_t>(interval.length);
+    out.write<uint8_t>((uint8_t)feature);
+    out.write<uint64_t>(attribute);
+    out.write<F>(threshold);
+  }
+
+  std::unique_ptr<i_SplitterNode> SplitterRISE::load(BinReader& in, TreeData const& data) {
+    std::string tname = in.read_string();
+    Interval interval{};
+    interval.start = in.read_size();
+    interval.length = in.read_size();
+    const auto feature_code = in.read<uint8_t>();
+    if (feature_code>(uint8_t)RISEFeature::PS) {
+      throw std::runtime_error("Model deserialization: invalid RISE feature");
+    }
+    const auto feature = (RISEFeature)feature_code;
+    const size_t attribute = in.read_size();
+    if (attribute>=rise_nb_features(interval, feature)) {
+      throw std::runtime_error("Model deserialization: invalid RISE attribute");
+    }
+    const F threshold = in.read<F>();
+    const size_t tid = TSChief::transform_id(data, tname);
+    return std::make_unique<SplitterRISE>(std::move(tname), tid, interval, feature, attribute, threshold);
+  }
+
+  void SplitterRISE::remap_exemplars(ExemplarTable const& /* table */, TreeData const& data) {
+    transform_id = TSChief::transform_id(data, transform_name);
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // RISE splitter generator
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  namespace {
+
+    /// Split 'bcm' with 'splitter' on the train features. An empty branch (no attribute separates the queries) gets
+    /// a label, so that no BCM is empty.
+    i_GenNode::Result split(ByClassMap const& bcm, std::unique_ptr<SplitterRISE>&& splitter,
+                            IntervalFeatures const& features) {
+      std::vector<ByClassMap::BCMvec_t> splits(2);
+      for (const auto& [label, is] : bcm) {
+        for (size_t idx : is) {
+          splits[features.at(idx, splitter->attribute)<=splitter->threshold ? 0 : 1][label].push_back(idx);
+        }
+      }
+      for (auto& s : splits) { if (s.empty()) { s[*bcm.classes().begin()]; }}
+      std::vector<ByClassMap> branch_splits;
+      branch_splits.reserve(2);
+      for (auto& s : splits) { branch_splits.emplace_back(std::move(s)); }
+      return i_GenNode::Result{.splitter = std::move(splitter), .branch_splits = std::move(branch_splits)};
+    }
+
+    /// Features of the train data, computed once for all the trees
+    std::shared_ptr<const IntervalFeatures> train_features(TreeData const& data, std::string const& tname, size_t tid,
+                                                           Interval interval, RISEFeature feature) {
+      return at_train_features(data).get<IntervalFeatures>(rise_key(tname, interval, feature), [&]() {
+        return rise_features(at_train(data, tid), interval, feature);
+      });
+    }
+
+  }
+
+  GenSplitterRISE::GenSplitterRISE(std::string transform_name, std::vector<Interval> pool) :
+    transform_name(std::move(transform_name)), pool(std::move(pool)) {
+    if (this->pool.empty()) { throw std::invalid_argument("Empty pool of RISE intervals"); }
+  }
+
+  i_GenNode::Result GenSplitterRISE::generate(TreeState& state, TreeData const& data, ByClassMap const& bcm) {
+    const auto scope = state.time("train/node/rise");
+    const Interval interval = utils::pick_one(pool, state.prng);
+    const RISEFeature feature = std::bernoulli_distribution(0.5)(state.prng) ? RISEFeature::ACF : RISEFeature::PS;
+    const size_t tid = transform_id(data, transform_name);
+    const auto features = train_features(data, transform_name, tid, interval, feature);
+
+    // Candidate attributes
+    const size_t nbf = features->nb_features;
+    std::vector<size_t> all_attributes(nbf);
+    for (size_t a = 0; a<nbf; ++a) { all_attributes[a] = a; }
+    std::vector<size_t> attributes;
+    std::sample(all_attributes.begin(), all_attributes.end(), std::back_inserter(attributes),
+                (size_t)std::ceil(std::sqrt((double)nbf)), state.prng);
+
+    // Queries, with their class position
+    const std::map<EL, size_t>& label_to_index = bcm.labels_to_index();
+    const size_t nb_classes = bcm.nb_classes();
+    std::vector<std::pair<size_t, size_t>> queries;
+    queries.reserve(bcm.size());
+    for (const auto& [label, is] : bcm) {
+      for (size_t idx : is) { queries.emplace_back(idx, label_to_index.at(label)); }
+    }
+    const auto total = (double)queries.size();
+
+    // Best Gini split of each attribute: sweep the queries by value, moving them from the right to the left branch.
+    // The Gini "mass" of a branch of size n with nc series of class c is n - sum(nc^2)/n.
+    size_t best_attribute = attributes.front();
+    F best_threshold = utils::PINF;
+    double best_score = utils::PINF;
+    std::vector<std::pair<F, size_t>> sorted(queries.size());
+    std::vector<double> left(nb_classes), right(nb_classes);
+    for (size_t a : attributes) {
+      for (size_t q = 0; q<queries.size(); ++q) { sorted[q] = {features->at(queries[q].first, a), queries[q].second}; }
+      std::sort(sorted.begin(), sorted.end());
+      std::fill(left.begin(), left.end(), 0);
+      std::fill(right.begin(), right.end(), 0);
+      double left_sq = 0;
+      double right_sq = 0;
+      for (const auto& [v, c] : sorted) { right[c] += 1; }
+      for (double n : right) { right_sq += n*n; }
+      for (size_t q = 0; q + 1<sorted.size(); ++q) {
+        const size_t c = sorted[q].second;
+        left_sq += 2*left[c] + 1;
+        left[c] += 1;
+        right_sq -= 2*right[c] - 1;
+        right[c] -= 1;
+        if (sorted[q].first==sorted[q + 1].first) { continue; }
+        const auto nl = (double)(q + 1);
+        const double nr = total - nl;
+        const double score = (nl - left_sq/nl + nr - right_sq/nr)/total;
+        if (score<best_score) {
+          best_score = score;
+          best_attribute = a;
+          best_threshold = (sorted[q].first + sorted[q + 1].first)/2;
+        }
+      }
+    }
+
+    auto splitter = std::make_unique<SplitterRISE>(transform_name, tid, interval, feature, best_attribute,
+                                                   best_threshold);
+    return split(bcm, std::move(splitter), *features);
+  }
+
+  i_GenNode::Result GenSplitterRISE::split_with(TreeState& /* state */, TreeData const& data, ByClassMap const& bcm,
+                                                std::unique_ptr<i_SplitterNode>&& splitter) {
+    if (dynamic_cast<SplitterRISE *>(splitter.get())==nullptr) { return {}; }
+    std::unique_ptr<SplitterRISE> owned(static_cast<SplitterRISE *>(splitter.release()));
+    const auto features = train_features(data, owned->transform_name, owned->transform_id, owned->interval,
+                                         owned->feature);
+    return split(bcm, std::move(owned), *features);
+  }
+
+} // End of namespace tempo::classifier::TSChief::snode::rise
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/dataset/dts.hpp>
+
+#include <tempo/classifier/TSChief/treedata.hpp>
+#include <tempo/classifier/TSChief/treestate.hpp>
+#include <tempo/classifier/TSChief/splitter_interface.hpp>
+
+namespace tempo::classifier::TSChief::snode::rise {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Interval spectral features (RISE, Lines et al., 2018), as in the interval splitters of TS-CHIEF
+
+  /// Features computed on an interval
+  enum class RISEFeature : uint8_t { ACF = 0, PS = 1 };
+
+  /// An interval of the series
+  struct Interval {
+    size_t start;
+    size_t length;
+  };
+
+  /// Features of all the series of a dataset on an interval: 'nb_features' values per series, series after series
+  struct IntervalFeatures {
+    size_t nb_features;
+    std::vector<F> values;
+
+    F at(size_t series, size_t feature) const { return values[series*nb_features + feature]; }
+  };
+
+  /// Key of the features of an interval of the transform 'tname' in a FeatureCache
+  std::string rise_key(std::string const& tname, Interval interval, RISEFeature feature);
+
+  /// Number of features of an interval: its first min(100, length/4) autocorrelation lags (ACF), or its first
+  /// length/2 power spectrum coefficients (PS), at least one
+  size_t rise_nb_features(Interval interval, RISEFeature feature);
+
+  /// Features of all the series of 'dts' on 'interval'.
+  /// The series shorter than the interval get the features of the available part of the interval.
+  IntervalFeatures rise_features(DTS const& dts, Interval interval, RISEFeature feature);
+
+  /// Pool of 'nb' intervals of a series of length 'min_length', of length in [min(16, min_length), min_length].
+  /// Throws std::invalid_argument if 'min_length' is 0.
+  std::vector<Interval> make_rise_pool(size_t nb, size_t min_length, PRNG& prng);
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // RISE splitter: threshold on one feature of an interval, two branches
+
+  struct SplitterRISE : public i_SplitterNode {
+
+    // --- --- --- Fields
+
+    /// Name and ID of the transform the features are computed on (see TreeData::transform_ids)
+    std::string transform_name;
+    size_t transform_id;
+
+    Interval interval;
+    RISEFeature feature;
+
+    /// Index of the feature in the features of the interval, and its threshold: branch 0 if at most the threshold
+    size_t attribute;
+    F threshold;
+
+    /// Key of the test features in the test features cache (see at_test_features)
+    std::string key;
+
+    // --- --- --- Constructors/Destructors
+
+    SplitterRISE(std::string transform_name, size_t transform_id, Interval interval, RISEFeature feature,
+                 size_t attribute, F threshold);
+
+    // --- --- --- Methods
+
+    /// Route the test series 'index', its features being computed with all the test features of the same interval
+    /// on first use
+    size_t get_branch_index(TreeState& state, TreeData const& data, size_t index) override;
+
+    /// Tag used in the model format
+    inline static const std::string tag{"rise"};
+
+    void save(BinWriter& out) const override;
+
+    static std::unique_ptr<i_SplitterNode> load(BinReader& in, TreeData const& data);
+
+    /// No train exemplar: only refresh the transform ID
+    void remap_exemplars(ExemplarTable const& /* table */, TreeData const& data) override;
+
+    size_t nb_bytes() const override { return sizeof(SplitterRISE) + transform_name.size() + key.size(); }
+
+    std::string kind() const override { return "RISE"; }
+
+  };
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // RISE splitter generator
+
+  /** Draw an interval of the pool and a feature at each node, then the best Gini split among sqrt(nb_features) of its
+   *  features. The features of the train data are computed once per interval, on first use, and shared by all the
+   *  nodes and trees (see at_train_features).
+   */
+  struct GenSplitterRISE : public i_GenNode {
+
+    // --- --- --- Fields
+
+    /// Transform the features are computed on
+    std::string transform_name;
+
+    /// Intervals drawn from, e.g. by make_rise_pool
+    std::vector<Interval> pool;
+
+    // --- --- --- Constructors/Destructors
+
+    GenSplitterRISE(std::string transform_name, std::vector<Interval> pool);
+
+    // --- --- --- Methods
+
+    i_GenNode::Result generate(TreeState& state, TreeData const& data, ByClassMap const& bcm) override;
+
+    /// Route all the train series of 'bcm' with 'splitter', a SplitterRISE
+    i_GenNode::Result split_with(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                 std::unique_ptr<i_SplitterNode>&& splitter) override;
+
+  };
+
+} // End of namespace tempo::classifier::TSChief::snode::rise
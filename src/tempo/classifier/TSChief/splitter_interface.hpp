@@ -1,11 +1,18 @@
 #pragma once
 
 #include <any>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <span>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "tempo/classifier/utils.hpp"
+#include "serialize.hpp"
 #include "treedata.hpp"
 #include "treestate.hpp"
 
@@ -21,6 +28,24 @@ namespace tempo::classifier::TSChief {
     /// The Leaf Splitter predicts a result using a (mutable) state, the test data,
     /// and an index used to identify the test exemplar within the test data.
     virtual classifier::Result1 predict(TreeState& state, TreeData const& data, size_t index) = 0;
+
+    /// Add the prediction for 'index' to 'acc' (probabilities times weight) and its weight to 'w', as merged by
+    /// Forest::predict_batch. By default, add the result of predict: override to avoid building the result.
+    virtual void accumulate_into(TreeState& state, TreeData const& data, size_t index, arma::rowvec& acc, double& w) {
+      const classifier::Result1 r = predict(state, data, index);
+      acc += r.probabilities*r.weight;
+      w += r.weight;
+    }
+
+    /// Write the leaf splitter, starting with a tag identifying its type (see load_splitter_leaf)
+    virtual void save(BinWriter& out) const = 0;
+
+    /// If the leaf always predicts the same result, whatever the state and the test data, return it.
+    /// Allows to compile the tree (see CompiledTree). Not constant by default.
+    virtual std::optional<classifier::Result1> constant_result() const { return {}; }
+
+    /// Memory held by the leaf splitter, results included, in bytes (see TreeNode::memory)
+    virtual size_t nb_bytes() const = 0;
   };
 
   struct i_SplitterNode {
@@ -30,8 +55,43 @@ namespace tempo::classifier::TSChief {
     /// The Node Splitter finds which branch to follow using a (mutable) state, the test data,
     /// and an index used to identify the test exemplar within the test data.
     virtual size_t get_branch_index(TreeState& state, TreeData const& data, size_t index) = 0;
+
+    /// Branches of the test exemplars 'indexes' in 'branches' (same positions), as get_branch_index on each of them
+    /// in order (see TreeNode::route_batch). Override to share work between the exemplars, e.g. gathering the
+    /// splitter's data once.
+    virtual void get_branch_indexes(TreeState& state, TreeData const& data, std::span<size_t const> indexes,
+                                    std::span<size_t> branches) {
+      for (size_t k = 0; k<indexes.size(); ++k) { branches[k] = get_branch_index(state, data, indexes[k]); }
+    }
+
+    /// Write the node splitter, starting with a tag identifying its type (see load_splitter_node).
+    /// Train exemplars must be referenced through BinWriter::exemplar.
+    virtual void save(BinWriter& out) const = 0;
+
+    /// Register the train exemplars referenced by the splitter in 'table' (see Forest::compact). None by default.
+    virtual void collect_exemplars(ExemplarTable& /* table */) const {}
+
+    /// Reference the train exemplars by their index in 'table', drawing them from 'data' whose train data is the
+    /// table of exemplars (see Forest::compact). Nothing to do by default.
+    virtual void remap_exemplars(ExemplarTable const& /* table */, TreeData const& /* data */) {}
+
+    /// Memory held by the node splitter, in bytes (see TreeNode::memory)
+    virtual size_t nb_bytes() const = 0;
+
+    /// Kind of the splitter, counted by TreeStats (e.g. the distance family of a NN1 splitter)
+    virtual std::string kind() const { return "node"; }
+
+    /// Number of train exemplars held by the splitter, counted by TreeStats. None by default.
+    virtual size_t nb_exemplars() const { return 0; }
   };
 
+  /// Load a leaf splitter written by i_SplitterLeaf::save
+  std::unique_ptr<i_SplitterLeaf> load_splitter_leaf(BinReader& in);
+
+  /// Load a node splitter written by i_SplitterNode::save.
+  /// 'data' must contain the train exemplars saved with the model, in the order given by BinWriter::exemplar.
+  std::unique_ptr<i_SplitterNode> load_splitter_node(BinReader& in, TreeData const& data);
+
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Training tree and generating splitters
@@ -46,6 +106,13 @@ namespace tempo::classifier::TSChief {
     // --- --- --- Methods
     /// Given a training state, training data, and a set of index (in a ByClassMap), try to generate a sleaf
     virtual Result generate(TreeState& state, TreeData const& data, ByClassMap const& bcm) = 0;
+
+    /// Called when 'generate' gave no leaf, with the split 'branch_splits' of 'bcm' then generated for the node:
+    /// try to generate a leaf replacing the node (e.g. when the split does not reduce the impurity enough).
+    /// No leaf by default.
+    virtual Result generate_after_split(TreeState& /* state */, TreeData const& /* data */,
+                                        ByClassMap const& /* bcm */,
+                                        std::vector<ByClassMap> const& /* branch_splits */) { return {}; }
   };
 
   struct i_GenNode {
@@ -58,9 +125,91 @@ namespace tempo::classifier::TSChief {
     /// For each branch, the associated ByClassMap can contain no index, but **cannot** contain no label.
     /// If a branch is required, but no train actually data reaches it,
     /// the BCM must contains at least one label mapping to an empty set of index.
+    /// A result without splitter is "dominated" (see generate_bounded).
     struct Result {
       std::unique_ptr<i_SplitterNode> splitter;
       std::vector<ByClassMap> branch_splits;
+
+      /// Estimated cost of the generation, also given by dominated results (see
+      /// snode::meta::SplitterChooserGen::cost_budget). 0 if not estimated.
+      double cost{0};
+
+      /// Score-only split, given by generate_bounded instead of 'branch_splits' (then empty): the branch of each
+      /// exemplar of the node, in the order of ByClassMap::to_IndexSet, and the number of exemplars per branch and
+      /// class (branch*nb_classes + class, the classes in increasing label order). A chooser scores its candidates
+      /// with the counts, and only builds the branch splits of the chosen one (see materialize).
+      struct ScoreOnly {
+        std::vector<uint16_t> branches;
+        std::vector<size_t> counts;
+        /// Label of the empty BCM of each branch (see above)
+        std::vector<EL> branch_labels;
+      };
+      std::optional<ScoreOnly> score_only{};
+
+      /// Check if the generation was abandoned by generate_bounded
+      bool dominated() const { return !splitter; }
+
+      /// Weighted (ratio of exemplars per branch) Gini impurity of the split, from the counts of a score-only
+      /// result, else from the branch splits. Same value (and rounding) for both.
+      double weighted_gini_impurity() const {
+        double wgini{0};
+        double total_size{0};
+        if (score_only) {
+          const size_t nb_branches = score_only->branch_labels.size();
+          const size_t nb_classes = nb_branches==0 ? 0 : score_only->counts.size()/nb_branches;
+          for (size_t b = 0; b<nb_branches; ++b) {
+            size_t const *counts = score_only->counts.data() + b*nb_classes;
+            size_t size = 0;
+            for (size_t c = 0; c<nb_classes; ++c) { size += counts[c]; }
+            double g{0};
+            if (size>1) {
+              const auto bsize = (double)size;
+              double sum{0};
+              for (size_t c = 0; c<nb_classes; ++c) {
+                if (counts[c]==0) { continue; }
+                double p = (double)counts[c]/bsize;
+                sum += p*p;
+              }
+              g = 1 - sum;
+            }
+            wgini += (double)size*g;
+            total_size += (double)size;
+          }
+        } else {
+          for (const auto& bcm : branch_splits) {
+            const auto bcm_size = (double)bcm.size();
+            wgini += bcm_size*bcm.gini_impurity();
+            total_size += bcm_size;
+          }
+        }
+        assert(total_size!=0);
+        return wgini/total_size;
+      }
+
+      /// Build the branch splits of a score-only result generated for 'bcm'. Nothing to do for a full result.
+      void materialize(ByClassMap const& bcm) {
+        if (!score_only) { return; }
+        const IndexSet all = bcm.to_IndexSet();
+        const std::vector<size_t>& sorted = all.vector();
+        assert(sorted.size()==score_only->branches.size());
+        // Class position of each exemplar, in the order of 'sorted'
+        const std::vector<EL> class_labels(bcm.classes().begin(), bcm.classes().end());
+        std::vector<uint32_t> indexes(sorted.begin(), sorted.end());
+        std::vector<uint32_t> classes(sorted.size());
+        std::vector<uint32_t> parts(score_only->branches.begin(), score_only->branches.end());
+        uint32_t c = 0;
+        for (const auto& [label, is] : bcm) {
+          for (size_t idx : is) { classes[std::lower_bound(sorted.begin(), sorted.end(), idx) - sorted.begin()] = c; }
+          ++c;
+        }
+        const std::vector<EL>& branch_labels = score_only->branch_labels;
+        const std::vector<FlatBCM> flat = FlatBCM::partition(class_labels, branch_labels.size(),
+                                                             indexes, classes, parts);
+        branch_splits.clear();
+        branch_splits.reserve(branch_labels.size());
+        for (size_t b = 0; b<branch_labels.size(); ++b) { branch_splits.push_back(flat[b].to_BCM(branch_labels[b])); }
+        score_only.reset();
+      }
     };
 
     // --- --- --- Constructor/Destructor
@@ -72,6 +221,21 @@ namespace tempo::classifier::TSChief {
     /// Given a training state, training data, and a set of index (in a ByClassMap), try to generate a sleaf
     virtual Result generate(TreeState& state, TreeData const& data, ByClassMap const& bcm) = 0;
 
+    /// As generate, but the generator may abandon as soon as the weighted Gini impurity of its split is known to be
+    /// greater than 'best_score', returning a dominated result (no splitter, no branch). 'best_score' may decrease
+    /// during the call (e.g. updated by concurrent generations). The default implementation never abandons.
+    /// The result may be score-only (see Result::score_only): Result::materialize then builds its branch splits.
+    virtual Result generate_bounded(TreeState& state, TreeData const& data, ByClassMap const& bcm,
+                                    std::atomic<double> const& /* best_score */) {
+      return generate(state, data, bcm);
+    }
+
+    /// Split all of 'bcm' with 'splitter', generated by this generator on a subset of 'bcm' with all its classes
+    /// (see snode::meta::SplitterChooserGen::node_sample_ratio): the split is exact for the given splitter.
+    /// The default implementation cannot, returning a dominated result.
+    virtual Result split_with(TreeState& /* state */, TreeData const& /* data */, ByClassMap const& /* bcm */,
+                              std::unique_ptr<i_SplitterNode>&& /* splitter */) { return {}; }
+
   };
 
 } // End of tempo::classifier::PF2
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "stream_scorer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <tempo/transform/core/univariate.derivative.hpp>
+
+namespace tempo::classifier::TSChief {
+
+  namespace {
+
+    namespace tcu = tempo::transform::core::univariate;
+
+    /// Derivative degree of a transform name: 0 for "default", d for "derivative<d>"
+    size_t transform_degree(std::string const& tname) {
+      if (tname=="default") { return 0; }
+      const std::string prefix = "derivative";
+      if (tname.starts_with(prefix)&&tname.size()>prefix.size()) {
+        const std::string deg = tname.substr(prefix.size());
+        if (std::all_of(deg.begin(), deg.end(), [](char c) { return '0'<=c&&c<='9'; })) { return std::stoul(deg); }
+      }
+      throw std::invalid_argument("StreamScorer: unsupported transform " + tname);
+    }
+
+  } // End of anonymous namespace
+
+  StreamScorer::StreamScorer(std::shared_ptr<const Forest> forest, TreeData const& data, size_t window_length,
+                             TreeState const& state) :
+    forest(std::move(forest)), window_length(window_length) {
+    if (!this->forest||this->forest->compiled.empty()) {
+      throw std::invalid_argument("StreamScorer: the forest must be compiled");
+    }
+    if (window_length==0) { throw std::invalid_argument("StreamScorer: empty window"); }
+
+    // --- Resolve the transforms of each tree
+    size_t max_degree = 0;
+    for (const auto& ct : this->forest->compiled) {
+      std::vector<std::pair<DTS const *, size_t>> transforms;
+      for (const auto& tname : ct->transforms) {
+        DTS const& dts = at_train(data, transform_id(data, tname));
+        if (dts.header().nb_dimensions()>1) {
+          throw std::invalid_argument("StreamScorer: only univariate series are supported");
+        }
+        const size_t degree = transform_degree(tname);
+        max_degree = std::max(max_degree, degree);
+        transforms.emplace_back(&dts, degree);
+      }
+      tree_transforms.push_back(std::move(transforms));
+    }
+
+    // --- Buffers: never resized, the series built in predict view them
+    levels.assign(max_degree + 1, std::vector<F>(window_length));
+
+    // --- Fork the states, once for all the predictions
+    local_states = state.forest_fork_vec(this->forest->compiled.size());
+  }
+
+  bool StreamScorer::push(F value) {
+    std::vector<F>& raw = levels[0];
+    if (count<window_length) {
+      raw[count++] = value;
+      if (count==window_length) { derive_all(); }
+    } else {
+      std::copy(raw.begin() + 1, raw.end(), raw.begin());
+      raw.back() = value;
+      derive_slide();
+    }
+    return ready();
+  }
+
+  void StreamScorer::set_window(F const *window) {
+    std::copy(window, window + window_length, levels[0].begin());
+    count = window_length;
+    derive_all();
+  }
+
+  void StreamScorer::derive_all() {
+    for (size_t d = 1; d<levels.size(); ++d) {
+      F const *in = levels[d - 1].data();
+      F *out = levels[d].data();
+      tcu::derive<F, F const *, F *>(in, window_length, out);
+    }
+  }
+
+  void StreamScorer::derive_slide() {
+    const size_t L = window_length;
+    // Short windows are copied (see derive)
+    if (L<=2) {
+      derive_all();
+      return;
+    }
+    // After sliding by one, the level d-1 only changed around its ends. At the level d, the interior values change
+    // on [1, d-1] (from the first value of level d-1) and on [L-1-d, L-2] (from the new value), the others shift.
+    for (size_t d = 1; d<levels.size(); ++d) {
+      F const *in = levels[d - 1].data();
+      std::vector<F>& out = levels[d];
+      std::copy(out.begin() + 1, out.end(), out.begin());
+      const size_t head_stop = std::min(d, L - 1);
+      for (size_t i = 1; i<head_stop; ++i) { out[i] = tcu::derive_at<F>(in, i); }
+      for (size_t i = std::max<size_t>(head_stop, L - 1 - std::min(d, L - 2)); i<L - 1; ++i) {
+        out[i] = tcu::derive_at<F>(in, i);
+      }
+      out[0] = out[1];
+      out[L - 1] = out[L - 2];
+    }
+  }
+
+  classifier::Result1 StreamScorer::predict() {
+    if (!ready()) { throw std::logic_error("StreamScorer: the window is not full"); }
+
+    // --- Series viewing the buffers: no copy
+    std::vector<TSeries> series;
+    series.reserve(levels.size());
+    for (const auto& level : levels) { series.push_back(TSeries::mk_view({}, level.data(), 1, window_length, {}, {})); }
+
+    // --- Walk the trees, merging their results as Forest::predict_batch does
+    const size_t nb_trees = forest->compiled.size();
+    classifier::Result1 result(forest->trainclass_cardinality);
+    CompiledTree::Query query;
+    for (size_t tree_index = 0; tree_index<nb_trees; ++tree_index) {
+      CompiledTree const& ct = *forest->compiled[tree_index];
+      query.clear();
+      for (const auto& [train_dataset, degree] : tree_transforms[tree_index]) {
+        query.emplace_back(train_dataset, &series[degree]);
+      }
+      const size_t leaf = ct.predict_leaf(*local_states[tree_index], query);
+      combine_add(forest->combiner, result.probabilities, result.weight, ct.leaf_probabilities.row(leaf),
+                  ct.leaf_weights[leaf]);
+    }
+    combine_finish(forest->combiner, result.probabilities, result.weight);
+    return result;
+  }
+
+} // End of tempo::classifier::TSChief
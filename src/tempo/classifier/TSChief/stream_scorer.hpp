@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tempo/classifier/utils.hpp"
+#include "treedata.hpp"
+#include "treestate.hpp"
+#include "forest.hpp"
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Online scoring of a stream
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Classify a sliding window over an univariate stream with a compiled forest (see Forest::compile),
+   *  without building a DTS or registering test data.
+   *  The transforms used by the forest are computed on the window by the scorer: "default" (the raw window) and
+   *  "derivative<d>" (the d-th derivative, see transform::univariate::derive). When the window slides by one value
+   *  (see push), the derivatives are updated only where they change, giving the same values as recomputing them.
+   *  The trees are merged as in Forest::predict_batch, giving the same prediction for a series equal to the window
+   *  (up to the draws breaking the ties). A scorer uses its own states, forked once from the state given at
+   *  construction, for all its predictions; it is not thread safe.
+   */
+  struct StreamScorer {
+
+    // --- --- --- Constructors/Destructors
+
+    /** Build a scorer for windows of 'window_length' values.
+     *  Throws std::invalid_argument if the forest is not compiled, if it uses another transform than "default" and
+     *  "derivative<d>", or if its train data is multivariate.
+     * @param forest        Trained (or loaded) forest
+     * @param data          Data the forest was trained on (or loaded with): only the train data is used
+     * @param window_length Length of the windows
+     * @param state         Testing state, forked once per tree
+     */
+    StreamScorer(std::shared_ptr<const Forest> forest, TreeData const& data, size_t window_length,
+                 TreeState const& state);
+
+    // --- --- --- Methods
+
+    /// Append a value to the stream, dropping the oldest one when the window is full.
+    /// Return true when the window is full, i.e. when predict can be called.
+    bool push(F value);
+
+    /// Replace the window by 'window_length' values
+    void set_window(F const *window);
+
+    /// Check if the window is full
+    bool ready() const { return count==window_length; }
+
+    /// Length of the windows
+    size_t length() const { return window_length; }
+
+    /// Predict the current window. Throws std::logic_error if the window is not full.
+    classifier::Result1 predict();
+
+    /// Shorthand for set_window followed by predict
+    classifier::Result1 score(F const *window) {
+      set_window(window);
+      return predict();
+    }
+
+  private:
+
+    // --- --- --- Fields
+
+    std::shared_ptr<const Forest> forest;
+
+    size_t window_length;
+
+    /// Number of values in the window, up to window_length
+    size_t count{0};
+
+    /// Window per derivative degree: levels[0] is the raw window, levels[d] its d-th derivative
+    std::vector<std::vector<F>> levels;
+
+    /// Per tree, per transform of the compiled tree: train data and derivative degree
+    std::vector<std::vector<std::pair<DTS const *, size_t>>> tree_transforms;
+
+    /// Per tree forked state
+    std::vector<std::unique_ptr<TreeState>> local_states;
+
+    /// Compute all the derivatives of the window
+    void derive_all();
+
+    /// Update the derivatives after the window slid by one value
+    void derive_slide();
+  };
+
+} // End of tempo::classifier::TSChief
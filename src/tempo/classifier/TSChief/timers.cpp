@@ -0,0 +1,52 @@
+#include "timers.hpp"
+
+#include <atomic>
+
+namespace tempo::classifier::TSChief {
+
+  void PhaseTimers::add(std::string const& phase, utils::duration_t time, size_t count) {
+    Slot& slot = slots[thread_slot()];
+    std::lock_guard lock(slot.mutex);
+    Entry& e = slot.entries[phase];
+    e.time += time;
+    e.count += count;
+  }
+
+  std::map<std::string, PhaseTimers::Entry> PhaseTimers::totals() const {
+    std::map<std::string, Entry> result;
+    for (const auto& slot : slots) {
+      std::lock_guard lock(slot.mutex);
+      for (const auto& [phase, e] : slot.entries) {
+        Entry& r = result[phase];
+        r.time += e.time;
+        r.count += e.count;
+      }
+    }
+    return result;
+  }
+
+  nlohmann::json PhaseTimers::to_json() const {
+    nlohmann::json j = nlohmann::json::object();
+    for (const auto& [phase, e] : totals()) {
+      // Walk down the path, creating the parent phases not timed themselves
+      nlohmann::json *node = &j;
+      size_t begin = 0;
+      for (size_t end = phase.find('/'); end!=std::string::npos; end = phase.find('/', begin)) {
+        node = &(*node)[phase.substr(begin, end - begin)];
+        begin = end + 1;
+      }
+      nlohmann::json& leaf = (*node)[phase.substr(begin)];
+      leaf["time_ns"] = std::chrono::duration_cast<std::chrono::nanoseconds>(e.time).count();
+      leaf["time_human"] = utils::as_string(e.time);
+      leaf["count"] = e.count;
+    }
+    return j;
+  }
+
+  size_t PhaseTimers::thread_slot() noexcept {
+    static std::atomic<size_t> next{0};
+    thread_local const size_t slot = next.fetch_add(1, std::memory_order_relaxed)%nb_slots;
+    return slot;
+  }
+
+} // End of tempo::classifier::TSChief
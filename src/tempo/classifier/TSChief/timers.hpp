@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <tempo/utils/utils.hpp>
+
+namespace tempo::classifier::TSChief {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Phase timers
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Time spent in the phases of a forest training and prediction, accumulated by all the threads
+   *  (see TreeState::timers). Phases are named by paths, e.g. "train/node/nn1/distance/DTW": the time of a phase
+   *  includes the time of the phases below it when they are timed within it, and is summed over the threads
+   *  (it can exceed the elapsed time). As TrainingProgress, a thread records in its own slot.
+   */
+  struct PhaseTimers {
+
+    /// Accumulated time and number of records of a phase
+    struct Entry {
+      utils::duration_t time{};
+      size_t count{0};
+    };
+
+    /// Time a phase while in scope, if 'timers' is not null
+    class Scope {
+      PhaseTimers *timers;
+      std::string phase;
+      utils::time_point_t start;
+
+    public:
+      Scope(PhaseTimers *timers, std::string_view phase) : timers(timers) {
+        if (timers!=nullptr) {
+          this->phase = phase;
+          start = utils::now();
+        }
+      }
+
+      ~Scope() { if (timers!=nullptr) { timers->add(phase, utils::now() - start); }}
+
+      Scope(Scope const&) = delete;
+      Scope& operator=(Scope const&) = delete;
+    };
+
+    /// Add 'time' to the phase 'phase' on the slot of the calling thread, counting 'count' records
+    void add(std::string const& phase, utils::duration_t time, size_t count = 1);
+
+    /// Totals by phase over all the threads
+    std::map<std::string, Entry> totals() const;
+
+    /// Totals as a JSON tree following the paths of the phases: each phase is an object with its
+    /// "time_ns", "time_human" and "count", and an object per sub phase.
+    nlohmann::json to_json() const;
+
+  private:
+
+    static constexpr size_t nb_slots = 64;
+
+    struct alignas(64) Slot {
+      mutable std::mutex mutex;
+      std::map<std::string, Entry> entries;
+    };
+
+    std::array<Slot, nb_slots> slots{};
+
+    /// Slot of the calling thread: threads are given the slots in turn
+    static size_t thread_slot() noexcept;
+  };
+
+} // End of tempo::classifier::TSChief
@@ -1,5 +1,8 @@
 #include "tree.hpp"
 
+#include <algorithm>
+#include <numeric>
+
 namespace tempo::classifier::TSChief {
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -17,6 +20,77 @@ namespace tempo::classifier::TSChief {
     }
   }
 
+  i_SplitterLeaf& TreeNode::reach_leaf(TreeState& state, TreeData const& data, size_t index) const {
+    TreeNode const *node = this;
+    while (node->node_kind==NODE) {
+      const size_t branch_idx = node->as_node.splitter->get_branch_index(state, data, index);
+      node = node->as_node.branches.at(branch_idx).get();
+    }
+    return *node->as_leaf.splitter;
+  }
+
+  void TreeNode::route_batch(TreeState& state, TreeData const& data, std::vector<size_t> const& indexes,
+                             std::vector<size_t>& leaves) const {
+    leaves.assign(indexes.size(), 0);
+    // Positions in 'indexes', partitioned per node: the positions reaching a node are contiguous in 'order'
+    std::vector<size_t> order(indexes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<size_t> partitioned(indexes.size());
+    std::vector<size_t> node_indexes;
+    std::vector<size_t> branch_of;
+    std::vector<size_t> counts;
+    // Ranges [begin, end[ of 'order' reaching a node, in breadth first order. All the nodes are queued, including
+    // the ones reached by no exemplar, to number the leaves as leaf_order.
+    struct Range {
+      TreeNode const *node;
+      size_t begin;
+      size_t end;
+    };
+    std::vector<Range> queue{{this, 0, indexes.size()}};
+    size_t leaf_id = 0;
+    for (size_t q = 0; q<queue.size(); ++q) {
+      const Range r = queue[q];
+      TreeNode const& tn = *r.node;
+      if (tn.node_kind==LEAF) {
+        for (size_t k = r.begin; k<r.end; ++k) { leaves[order[k]] = leaf_id; }
+        ++leaf_id;
+        continue;
+      }
+      const size_t nb_branches = tn.as_node.branches.size();
+      counts.assign(nb_branches + 1, 0);
+      if (r.begin<r.end) {
+        node_indexes.clear();
+        for (size_t k = r.begin; k<r.end; ++k) { node_indexes.push_back(indexes[order[k]]); }
+        branch_of.resize(node_indexes.size());
+        tn.as_node.splitter->get_branch_indexes(state, data, node_indexes, branch_of);
+        for (size_t b : branch_of) {
+          if (b>=nb_branches) { throw std::out_of_range("TreeNode: invalid branch index"); }
+          counts[b + 1]++;
+        }
+        for (size_t b = 0; b<nb_branches; ++b) { counts[b + 1] += counts[b]; }
+      }
+      for (size_t b = 0; b<nb_branches; ++b) {
+        queue.push_back({tn.as_node.branches[b].get(), r.begin + counts[b], r.begin + counts[b + 1]});
+      }
+      // Stable partition of the range per branch (counting sort)
+      for (size_t k = r.begin; k<r.end; ++k) {
+        partitioned[r.begin + counts[branch_of[k - r.begin]]++] = order[k];
+      }
+      std::copy(partitioned.begin() + (long)r.begin, partitioned.begin() + (long)r.end, order.begin() + (long)r.begin);
+    }
+  }
+
+  std::vector<i_SplitterLeaf *> TreeNode::leaf_order() const {
+    std::vector<i_SplitterLeaf *> result;
+    std::vector<TreeNode const *> queue{this};
+    for (size_t q = 0; q<queue.size(); ++q) {
+      TreeNode const& tn = *queue[q];
+      if (tn.node_kind==LEAF) { result.push_back(tn.as_leaf.splitter.get()); }
+      else { for (const auto& b : tn.as_node.branches) { queue.push_back(b.get()); }}
+    }
+    return result;
+  }
+
 
   std::tuple<size_t, size_t> TreeNode::nb_nodes() const {
     if (node_kind==LEAF) {
@@ -46,59 +120,259 @@ namespace tempo::classifier::TSChief {
     }
   }
 
+  double TreeNode::max_leaf_weight() const {
+    if (node_kind==LEAF) {
+      std::optional<classifier::Result1> r = as_leaf.splitter->constant_result();
+      return r ? r->weight : std::numeric_limits<double>::infinity();
+    } else {
+      double w = 0;
+      for (const auto& b : as_node.branches) { w = std::max(w, b->max_leaf_weight()); }
+      return w;
+    }
+  }
+
+  TreeMemory TreeNode::memory() const {
+    TreeMemory m;
+    m.nodes = sizeof(TreeNode);
+    if (node_kind==LEAF) {
+      m.leaves = as_leaf.splitter->nb_bytes();
+    } else {
+      m.nodes += as_node.branches.capacity()*sizeof(BRANCH);
+      m.splitters = as_node.splitter->nb_bytes();
+      for (const auto& branch : as_node.branches) { m += branch->memory(); }
+    }
+    return m;
+  }
+
+  namespace {
+
+    /// Constant result of a leaf node; none for an internal node or a leaf without constant result
+    std::optional<classifier::Result1> constant_leaf_result(TreeNode const& tn) {
+      if (tn.node_kind!=TreeNode::LEAF) { return {}; }
+      return tn.as_leaf.splitter->constant_result();
+    }
+
+    /// Exact equality of two results: leaves are only merged if no combiner can tell them apart
+    bool same_result(classifier::Result1 const& a, classifier::Result1 const& b) {
+      return a.weight==b.weight&&a.probabilities.n_elem==b.probabilities.n_elem&&
+             std::equal(a.probabilities.begin(), a.probabilities.end(), b.probabilities.begin());
+    }
+
+    /// Prune the tree rooted at 'tn' (see TreeNode::prune), writing the statistics of the pruned tree in 'stats'
+    size_t prune_subtree(TreeNode& tn, TreeStats& stats) {
+      if (tn.node_kind==TreeNode::LEAF) {
+        stats = TreeStats::leaf();
+        return 0;
+      }
+      std::vector<TreeNode::BRANCH>& branches = tn.as_node.branches;
+      size_t nb_removed = 0;
+      std::vector<TreeStats> branch_stats(branches.size());
+      for (size_t i = 0; i<branches.size(); ++i) { nb_removed += prune_subtree(*branches[i], branch_stats[i]); }
+
+      // All the exemplars reach the single branch: take its place. 'child' keeps it alive while moving from it.
+      if (branches.size()==1) {
+        const TreeNode::BRANCH child = branches.front();
+        tn.node_kind = child->node_kind;
+        tn.as_leaf = std::move(child->as_leaf);
+        tn.as_node = std::move(child->as_node);
+        stats = std::move(branch_stats.front());
+        return nb_removed + 1;
+      }
+
+      // Branches all predicting the same constant result: replace by the first leaf
+      bool same = !branches.empty();
+      const std::optional<classifier::Result1> r = same ? constant_leaf_result(*branches.front()) : std::nullopt;
+      same = same&&r.has_value();
+      for (size_t i = 1; same&&i<branches.size(); ++i) {
+        const std::optional<classifier::Result1> ri = constant_leaf_result(*branches[i]);
+        same = ri&&same_result(r.value(), ri.value());
+      }
+      if (same) {
+        const TreeNode::BRANCH first = branches.front();
+        tn.node_kind = TreeNode::LEAF;
+        tn.as_leaf = std::move(first->as_leaf);
+        tn.as_node = TreeNode::Node{};
+        stats = TreeStats::leaf();
+        return nb_removed + 1;
+      }
+
+      stats = TreeStats{};
+      for (const TreeStats& bs : branch_stats) { stats += bs; }
+      ++stats.depth;
+      stats.add_node(*tn.as_node.splitter);
+      return nb_removed;
+    }
+
+  } // End of anonymous namespace
+
+  size_t TreeNode::prune() {
+    TreeStats pruned;
+    const size_t nb_removed = prune_subtree(*this, pruned);
+    if (stats) { pruned.nb_train_exemplars = stats->nb_train_exemplars; }
+    stats = std::make_unique<TreeStats>(std::move(pruned));
+    return nb_removed;
+  }
+
+  void TreeNode::save(BinWriter& out) const {
+    if (node_kind==LEAF) {
+      out.write<uint8_t>(LEAF);
+      as_leaf.splitter->save(out);
+    } else {
+      out.write<uint8_t>(NODE);
+      as_node.splitter->save(out);
+      out.write<uint64_t>(as_node.branches.size());
+      for (const auto& branch : as_node.branches) { branch->save(out); }
+    }
+  }
+
+  void TreeNode::collect_exemplars(ExemplarTable& table) const {
+    if (node_kind==NODE) {
+      as_node.splitter->collect_exemplars(table);
+      for (const auto& branch : as_node.branches) { branch->collect_exemplars(table); }
+    }
+  }
+
+  void TreeNode::remap_exemplars(ExemplarTable const& table, TreeData const& data) {
+    if (node_kind==NODE) {
+      as_node.splitter->remap_exemplars(table, data);
+      for (const auto& branch : as_node.branches) { branch->remap_exemplars(table, data); }
+    }
+  }
+
   // --- --- --- Static functions
 
   std::shared_ptr<TreeNode> TreeNode::make_leaf(std::unique_ptr<i_SplitterLeaf> sleaf) {
     return std::shared_ptr<TreeNode>(
-      new TreeNode{.node_kind = LEAF, .as_leaf = Leaf{std::move(sleaf)}}
+      new TreeNode{.node_kind = LEAF, .as_leaf = Leaf{std::move(sleaf)},
+                   .stats = std::make_unique<TreeStats>(TreeStats::leaf())}
     );
   }
 
   std::shared_ptr<TreeNode> TreeNode::make_node(std::unique_ptr<i_SplitterNode> snode,
                                                 std::vector<BRANCH>&& branches) {
+    // Gather the statistics of the branches built so far (e.g. not the empty slots of ForestTrainer::train_levelwise)
+    auto s = std::make_unique<TreeStats>();
+    for (const auto& branch : branches) {
+      if (branch&&branch->stats) {
+        *s += *branch->stats;
+        branch->stats.reset();
+      }
+    }
+    ++s->depth;
+    s->add_node(*snode);
     return std::shared_ptr<TreeNode>(
-      new TreeNode{.node_kind = NODE, .as_node = Node{std::move(snode), std::move(branches)}}
+      new TreeNode{.node_kind = NODE, .as_node = Node{std::move(snode), std::move(branches)}, .stats = std::move(s)}
     );
   }
 
 
+  std::shared_ptr<TreeNode> TreeNode::load(BinReader& in, TreeData const& data) {
+    const auto kind = in.read<uint8_t>();
+    if (kind==LEAF) {
+      return make_leaf(load_splitter_leaf(in));
+    } else if (kind==NODE) {
+      std::unique_ptr<i_SplitterNode> snode = load_splitter_node(in, data);
+      const size_t nb_branches = in.read_size();
+      std::vector<BRANCH> branches;
+      branches.reserve(nb_branches);
+      for (size_t i = 0; i<nb_branches; ++i) { branches.push_back(load(in, data)); }
+      return make_node(std::move(snode), std::move(branches));
+    } else { throw std::runtime_error("Model deserialization: invalid node kind"); }
+  }
+
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Training a tree
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
   std::shared_ptr<TreeNode> TreeTrainer::train(TreeState& state, const TreeData& data, ByClassMap const& bcm) const {
+    return train_node(state, data, bcm, nullptr);
+  }
+
+  std::shared_ptr<TreeNode> TreeTrainer::train(TreeState& state, const TreeData& data, ByClassMap&& bcm) const {
+    return train_node(state, data, bcm, &bcm);
+  }
+
+  std::shared_ptr<TreeNode> TreeTrainer::train_node(TreeState& state, const TreeData& data, ByClassMap const& bcm,
+                                                    ByClassMap *release) const {
     // Ensure that we have at least one class reaching this node!
     // Note: there may be no data point associated to the class.
     assert(bcm.nb_classes()>0);
 
     // Try to generate a sleaf; if successful, make a sleaf node
-    typename i_GenLeaf::Result opt_leaf = leaf_generator->generate(state, data, bcm);
+    typename i_GenLeaf::Result opt_leaf = [&]() {
+      const auto scope = state.time("train/leaf");
+      const utils::TraceScope trace("leaf", "train", "size", (int64_t)bcm.size());
+      return leaf_generator->generate(state, data, bcm);
+    }();
 
     if (opt_leaf) {
       // --- --- --- LEAF
+      state.count(TrainingProgress::NODES);
+      state.end_node();
+      if (release!=nullptr) { *release = ByClassMap(); }
       return TreeNode::make_leaf(std::move(opt_leaf.value()));
     } else {
       // --- --- --- NODE
       // If we could not generate a sleaf, make a node.
       // Recursively build each branches, then build the current node
-      i_GenNode::Result rnode = node_generator->generate(state, data, bcm);
+      i_GenNode::Result rnode = [&]() {
+        const auto scope = state.time("train/node");
+        const utils::TraceScope trace("node", "train", "size", (int64_t)bcm.size());
+        return node_generator->generate(state, data, bcm);
+      }();
+      state.count(TrainingProgress::NODES);
+
+      // The leaf generator may still prefer a leaf, given the split
+      typename i_GenLeaf::Result late_leaf =
+        leaf_generator->generate_after_split(state, data, bcm, rnode.branch_splits);
+      state.end_node();
+      // The node's data is not used anymore: 'bcm' must not be read from here (see train)
+      if (release!=nullptr) { *release = ByClassMap(); }
+      if (late_leaf) { return TreeNode::make_leaf(std::move(late_leaf.value())); }
+
       const size_t nb_branches = rnode.branch_splits.size();
-      std::vector<TreeNode::BRANCH> branches;
-      branches.reserve(nb_branches);
 
-      // Building loop
+      // Branches large enough are trained as independent tasks, each with its own state forked from 'state'.
+      // A branch draws from its own stream, forked or not; the forks are merged back in branch order.
+      std::vector<std::unique_ptr<TreeState>> forks(nb_branches);
       for (size_t idx = 0; idx<nb_branches; ++idx) {
-        ByClassMap const& branch_bcm = rnode.branch_splits.at(idx);
+        if (rnode.branch_splits[idx].size()>=fork_min_size) { forks[idx] = state.branch_fork(idx); }
+      }
+
+      // Note: each branch slot is pre-allocated - no shared memory, no need for sync
+      std::vector<TreeNode::BRANCH> branches(nb_branches);
+      auto forked_task = [&](size_t idx) {
+        branches[idx] = train(*forks[idx], data, std::move(rnode.branch_splits[idx]));
+      };
 
-        // Signal the state that we are going down a new branch
-        state.start_branch(idx);
+      // Building loop for the branches kept in the current state, depth first
+      auto inline_task = [&]() {
+        for (size_t idx = 0; idx<nb_branches; ++idx) {
+          if (forks[idx]) { continue; }
+          // Signal the state that we are going down a new branch
+          state.start_branch(idx);
+          // Build the branch, giving it its split
+          branches[idx] = train(state, data, std::move(rnode.branch_splits.at(idx)));
+          // Signal the state that we are done with this branch
+          state.end_branch(idx);
+        }
+      };
 
-        // Build the branch
-        std::shared_ptr<TreeNode> branch = train(state, data, branch_bcm);
-        branches.push_back(std::move(branch));
+      const size_t nb_forks = std::count_if(forks.begin(), forks.end(), [](auto const& f) { return (bool)f; });
+      if (nb_forks==0||nb_threads<=1) {
+        for (size_t idx = 0; idx<nb_branches; ++idx) { if (forks[idx]) { forked_task(idx); }}
+        inline_task();
+      } else {
+        utils::ParTasks p;
+        for (size_t idx = 0; idx<nb_branches; ++idx) { if (forks[idx]) { p.push_task_args(forked_task, idx); }}
+        p.push_task(inline_task);
+        p.execute((int)std::min(nb_threads, nb_forks + 1));
+      }
 
-        // Signal the state that we are done with this branch
-        state.end_branch(idx);
+      // Merge the forks back
+      for (size_t idx = 0; idx<nb_branches; ++idx) {
+        if (forks[idx]) { state.branch_merge_in(idx, std::move(forks[idx])); }
       }
 
       // Result
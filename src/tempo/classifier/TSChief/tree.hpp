@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <any>
+#include <limits>
+#include <map>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -16,6 +20,65 @@ namespace tempo::classifier::TSChief {
   // Result of a trained tree
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
+  /// Memory held by trees, in bytes (see TreeNode::memory).
+  /// Approximate: counts the objects and their buffers, not the overhead of the allocator.
+  struct TreeMemory {
+    size_t nodes{0};      ///< Tree nodes and their vectors of branches
+    size_t splitters{0};  ///< Node splitters
+    size_t leaves{0};     ///< Leaf splitters, with their results
+
+    size_t total() const { return nodes + splitters + leaves; }
+
+    TreeMemory& operator+=(TreeMemory const& other) {
+      nodes += other.nodes;
+      splitters += other.splitters;
+      leaves += other.leaves;
+      return *this;
+    }
+  };
+
+  /// Statistics of a tree, recorded while the tree is built (see TreeNode::stats): reported without traversing it
+  struct TreeStats {
+
+    /// Per kind of node splitter (see i_SplitterNode::kind)
+    struct Usage {
+      size_t nb_nodes{0};       ///< Internal nodes with a splitter of this kind
+      size_t nb_exemplars{0};   ///< Train exemplars held by their splitters (see i_SplitterNode::nb_exemplars)
+    };
+
+    size_t nb_leaves{0};
+    size_t nb_nodes{0};             ///< Internal nodes
+    size_t depth{0};                ///< As TreeNode::depth
+    size_t nb_train_exemplars{0};   ///< Train exemplars reaching the root; 0 for a loaded tree
+    std::map<std::string, Usage> splitters{};
+
+    /// Statistics of a single leaf
+    static TreeStats leaf() { return TreeStats{.nb_leaves = 1, .depth = 1}; }
+
+    /// Count an internal node with the splitter 'splitter'. The depth is left to the caller.
+    void add_node(i_SplitterNode const& splitter) {
+      ++nb_nodes;
+      Usage& u = splitters[splitter.kind()];
+      ++u.nb_nodes;
+      u.nb_exemplars += splitter.nb_exemplars();
+    }
+
+    /// Add the statistics of another tree (e.g. a branch, or the other trees of a forest): sum of the counts,
+    /// maximal depth
+    TreeStats& operator+=(TreeStats const& other) {
+      nb_leaves += other.nb_leaves;
+      nb_nodes += other.nb_nodes;
+      depth = std::max(depth, other.depth);
+      nb_train_exemplars += other.nb_train_exemplars;
+      for (const auto& [k, u] : other.splitters) {
+        Usage& mine = splitters[k];
+        mine.nb_nodes += u.nb_nodes;
+        mine.nb_exemplars += u.nb_exemplars;
+      }
+      return *this;
+    }
+  };
+
   struct TreeNode {
     // --- --- --- Types
     using BRANCH = std::shared_ptr<TreeNode>;
@@ -40,20 +103,67 @@ namespace tempo::classifier::TSChief {
     Leaf as_leaf{};
     Node as_node{};
 
+    /// Statistics of the tree rooted at this node. Only kept by the roots: make_node gathers the statistics of the
+    /// branches and releases them. Null for the other nodes.
+    std::unique_ptr<TreeStats> stats{};
+
     // --- --- --- Methods
 
     /// Given a testing state and testing data, do a prediction for the exemplar 'index'
     classifier::Result1 predict(TreeState& state, TreeData const& data, size_t index) const;
 
+    /// Given a testing state and testing data, find the leaf splitter reached by the exemplar 'index'
+    i_SplitterLeaf& reach_leaf(TreeState& state, TreeData const& data, size_t index) const;
+
+    /** Tree-major routing of a batch: the leaves reached by the test exemplars 'indexes' in 'leaves' (same positions),
+     *  as leaf IDs, i.e. positions in leaf_order(). The exemplars reaching a node are routed together (see
+     *  i_SplitterNode::get_branch_indexes), level by level, instead of walking each exemplar from the root to its
+     *  leaf. As with CompiledTree::predict_leaves, the leaves are the same as with reach_leaf, but for the exemplars
+     *  with ties: the draws of the state's PRNG are made in another order.
+     */
+    void route_batch(TreeState& state, TreeData const& data, std::vector<size_t> const& indexes,
+                     std::vector<size_t>& leaves) const;
+
+    /// The leaf splitters of the tree, indexed by leaf ID (see route_batch): breadth first order, as the rows of the
+    /// compiled tree (see CompiledTree::compile)
+    std::vector<i_SplitterLeaf *> leaf_order() const;
+
     /// Count the number of nodes (number of leaf, number of internal node)
     std::tuple<size_t, size_t> nb_nodes() const;
 
     /// Get the maximal depth
     size_t depth() const;
 
+    /// Maximal weight of the results of the leaves (see i_SplitterLeaf::constant_result),
+    /// infinite if a leaf result is not constant
+    double max_leaf_weight() const;
+
+    /// Memory held by the tree rooted at this node
+    TreeMemory memory() const;
+
+    /** Collapse, bottom up, the subtrees that do not change the predictions: a node with a single branch is replaced
+     *  by its branch, and a node whose branches are all leaves with the same constant result (see
+     *  i_SplitterLeaf::constant_result) is replaced by one of them. Done in place: the trees sharing these nodes are
+     *  pruned too. The statistics of this node are recomputed in the same pass. Return the number of internal nodes
+     *  removed.
+     */
+    size_t prune();
+
+    /// Write the tree topology and its splitters
+    void save(BinWriter& out) const;
+
+    /// Register the train exemplars referenced by the splitters of the tree (see i_SplitterNode::collect_exemplars)
+    void collect_exemplars(ExemplarTable& table) const;
+
+    /// Renumber the train exemplars referenced by the splitters of the tree (see i_SplitterNode::remap_exemplars)
+    void remap_exemplars(ExemplarTable const& table, TreeData const& data);
+
     // --- --- --- Static functions
     static std::shared_ptr<TreeNode> make_leaf(std::unique_ptr<i_SplitterLeaf> sleaf);
     static std::shared_ptr<TreeNode> make_node(std::unique_ptr<i_SplitterNode> snode, std::vector<BRANCH>&& branches);
+
+    /// Load a tree written by save. See load_splitter_node for the requirements on 'data'.
+    static std::shared_ptr<TreeNode> load(BinReader& in, TreeData const& data);
   };
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -67,16 +177,38 @@ namespace tempo::classifier::TSChief {
     std::shared_ptr<i_GenLeaf> leaf_generator;
     std::shared_ptr<i_GenNode> node_generator;
 
+    /// Maximum number of threads training the branches of a node concurrently
+    size_t nb_threads;
+
+    /// Branches with at least 'fork_min_size' exemplars are trained as independent tasks, with their own forked
+    /// state (see TreeState::branch_fork). Other branches are trained with the state of the node, in order.
+    size_t fork_min_size;
+
     // --- --- --- Constructors/Destructors
 
-    /// Build a Splitting Tree with a sleaf generator and a node generator
-    TreeTrainer(std::shared_ptr<i_GenLeaf> leaf_generator, std::shared_ptr<i_GenNode> node_generator) :
-      leaf_generator(std::move(leaf_generator)), node_generator(std::move(node_generator)) {}
+    /// Build a Splitting Tree with a sleaf generator and a node generator.
+    /// By default, the branches are trained sequentially, depth first.
+    TreeTrainer(std::shared_ptr<i_GenLeaf> leaf_generator, std::shared_ptr<i_GenNode> node_generator,
+                size_t nb_threads = 1, size_t fork_min_size = std::numeric_limits<size_t>::max()) :
+      leaf_generator(std::move(leaf_generator)), node_generator(std::move(node_generator)),
+      nb_threads(nb_threads), fork_min_size(fork_min_size) {}
 
     // --- --- --- Methods
 
-    /// Train a splitting tree
+    /// Train a splitting tree.
+    /// Forked branches only depend on 'state' and on 'fork_min_size': the tree does not depend on 'nb_threads'.
     std::shared_ptr<TreeNode> train(TreeState& state, const TreeData& data, ByClassMap const& bcm) const;
+
+    /// As train, taking 'bcm': it is released as soon as the node is split. The branches are trained the same way,
+    /// each one taking its split: the data of a node is not held while its subtrees are trained (nor the one of its
+    /// branches already trained), and the memory of a training does not grow with its depth times the node sizes.
+    std::shared_ptr<TreeNode> train(TreeState& state, const TreeData& data, ByClassMap&& bcm) const;
+
+  private:
+
+    /// Train a splitting tree on 'bcm', released by 'release' (if any) once the node is split
+    std::shared_ptr<TreeNode> train_node(TreeState& state, const TreeData& data, ByClassMap const& bcm,
+                                         ByClassMap *release) const;
   };
 
 } // End of tempo::classifier::PF2
\ No newline at end of file
@@ -2,9 +2,24 @@
 
 #include <tempo/classifier/utils.hpp>
 #include <tempo/dataset/dts.hpp>
+#include <tempo/distance/quantized.hpp>
+
+#include <tempo/utils/utils/mapped_file.hpp>
+
+#include "envelopes.hpp"
+#include "features.hpp"
 
 #include <any>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -13,9 +28,67 @@ namespace tempo::classifier::TSChief {
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Data management
 
+  /// Named transforms computed on first use, e.g. the ones the splitters may never pick (see register_train)
+  using LazyMDTS = std::map<std::string, std::function<DTS()>>;
+
+  /** A transform computed once, on first use, by whichever thread asks for it first (see at_train and at_test).
+   *  The other threads asking for it meanwhile wait. 'make' runs on the calling thread, and must not wait for tasks
+   *  of the thread pool: a waiting thread may run a task asking for the same transform (see utils::ParTasks).
+   */
+  struct LazyDTS {
+    std::function<DTS()> make;
+    /// Train transforms also get their per series sums (see at_train_sums)
+    bool with_sums{false};
+
+    std::once_flag once{};
+    std::atomic<bool> done{false};
+    DTS dts{};
+    std::optional<DTS_Sums> sums{};
+
+    LazyDTS(std::function<DTS()> make, bool with_sums) : make(std::move(make)), with_sums(with_sums) {}
+
+    /// The transform, computed by the first call
+    DTS const& get() {
+      std::call_once(once, [this]() {
+        dts = make();
+        if (with_sums) { sums.emplace(dts, 1); }
+        make = nullptr;
+        done.store(true, std::memory_order_release);
+      });
+      return dts;
+    }
+
+    /// Already computed
+    bool materialized() const { return done.load(std::memory_order_acquire); }
+  };
+
   struct TreeData {
     std::map<std::string, std::shared_ptr<void>> storage;
 
+    /// Transform IDs: the train transforms are numbered in name order by register_train.
+    /// The train and test data of each ID are resolved by register_train and register_test, so that the splitters
+    /// holding an ID access their data without string work (see at_train(td, id) and at_test(td, id)).
+    std::map<std::string, size_t> transform_ids;
+    std::vector<DTS const *> train_by_id;
+    std::vector<DTS const *> test_by_id;
+
+    /// Lazy transforms of the IDs without data in train_by_id (resp. test_by_id), else nullptr
+    std::vector<std::shared_ptr<LazyDTS>> lazy_train_by_id;
+    std::vector<std::shared_ptr<LazyDTS>> lazy_test_by_id;
+    /// Sums of the train transforms of train_by_id (see at_train_sums), else nullptr
+    std::vector<DTS_Sums const *> train_sums_by_id;
+    /// Lazy test transforms of the last register_test, bound to the IDs by name
+    std::map<std::string, std::shared_ptr<LazyDTS>> lazy_test;
+
+    /// The test data of "derivative1" is virtual (see set_virtual_test_derivative): per ID, the ID whose test data
+    /// is derived on the fly, resolved by register_test, or nothing
+    bool virtual_test_derivative{false};
+    std::vector<std::optional<size_t>> virtual_test_source_by_id;
+
+    /// The train data is memory mapped (e.g. loaded from binary files, see reader::load_dataset_bin) and may not fit
+    /// in memory: the nodes tell the kernel which series they are about to read (see advise_train_series)
+    bool advise_train{false};
+
     template<typename Data>
     void register_data(std::shared_ptr<Data> sptr, std::string const& key) {
       storage[key] = std::move(sptr);
@@ -31,16 +104,249 @@ namespace tempo::classifier::TSChief {
 
   using MDTS = std::map<std::string, tempo::DTS>;
 
-  inline void register_train(TreeData& td, std::shared_ptr<MDTS> sptr){
+  namespace internal {
+    /// Resolve the test data of the transform IDs, eager or lazy; IDs without test data are resolved to nullptr.
+    inline void bind_test(TreeData& td, MDTS const& test){
+      td.test_by_id.assign(td.train_by_id.size(), nullptr);
+      td.lazy_test_by_id.assign(td.train_by_id.size(), nullptr);
+      for (auto const& [tn, dts] : test) {
+        if (auto it = td.transform_ids.find(tn); it!=td.transform_ids.end()) { td.test_by_id[it->second] = &dts; }
+      }
+      for (auto const& [tn, lazy] : td.lazy_test) {
+        if (auto it = td.transform_ids.find(tn); it!=td.transform_ids.end()) { td.lazy_test_by_id[it->second] = lazy; }
+      }
+      td.virtual_test_source_by_id.assign(td.train_by_id.size(), std::nullopt);
+      if (td.virtual_test_derivative) {
+        auto it = td.transform_ids.find("derivative1");
+        auto src = td.transform_ids.find("default");
+        if (it!=td.transform_ids.end()&&src!=td.transform_ids.end()&&td.test_by_id[it->second]==nullptr
+            &&!td.lazy_test_by_id[it->second]) {
+          td.virtual_test_source_by_id[it->second] = src->second;
+        }
+      }
+    }
+  }
+
+  /** Encoded labels of the train series, indexed by train index, in a dense array: DatasetHeader::label encodes the
+   *  original label at each call, through the label encoder's map. The loops over the queries of a node read them
+   *  here instead. The labels are the same for all the transforms.
+   */
+  struct TrainLabels {
+    using code_t = uint16_t;
+
+    /// Code of the series without label
+    static constexpr code_t unlabelled = std::numeric_limits<code_t>::max();
+
+    /// Per train index, the encoded label or 'unlabelled'
+    std::vector<code_t> codes;
+
+    /// Number of classes of the train header: the codes of the labelled series are in [0, nb_classes[
+    size_t nb_classes{0};
+
+    TrainLabels() = default;
+
+    /// Throws std::invalid_argument if the header has 'unlabelled' classes or more
+    explicit TrainLabels(DatasetHeader const& header) : nb_classes(header.nb_classes()) {
+      if (nb_classes>=unlabelled) {
+        throw std::invalid_argument("Too many classes: " + std::to_string(nb_classes));
+      }
+      codes.reserve(header.size());
+      for (size_t i = 0; i<header.size(); ++i) {
+        const std::optional<EL> ol = header.label(i);
+        codes.push_back(ol ? (code_t)ol.value() : unlabelled);
+      }
+    }
+
+    code_t operator [](size_t idx) const { return codes[idx]; }
+  };
+
+  /// Register the train data, also precomputing per series sums used by statistics over node subsets (at_train_sums)
+  /// and the dense train labels (at_train_labels), and creating empty envelopes, first differences and features caches
+  /// shared by all the trees using 'td' (at_train_envelopes, at_train_differences, at_train_features).
+  /// The labels are read from the first eager transform, or, without eager transform, from the first lazy one.
+  /// Number the transforms of 'sptr' and 'lazy' together, in name order (see TreeData::transform_ids).
+  /// The transforms of 'lazy' are only computed, with their sums, when first accessed (see at_train and LazyDTS), on
+  /// the accessing thread; the ones never accessed are never computed. The sums of the other transforms are computed
+  /// on 'nb_threads'. Throws std::invalid_argument if a transform is both in 'sptr' and 'lazy'.
+  inline void register_train(TreeData& td, std::shared_ptr<MDTS> sptr, size_t nb_threads = 1,
+                             LazyMDTS const& lazy = {}){
+    auto sums = std::make_shared<DTSSumsMap>();
+    for (auto const& [tn, dts] : *sptr) { sums->emplace(tn, DTS_Sums(dts, nb_threads)); }
+    std::map<std::string, std::function<DTS()> const *> names;
+    for (auto const& [tn, _] : *sptr) { names.emplace(tn, nullptr); }
+    for (auto const& [tn, make] : lazy) {
+      if (!names.emplace(tn, &make).second) {
+        throw std::invalid_argument("Transform " + tn + " registered both as eager and lazy");
+      }
+    }
+    td.transform_ids.clear();
+    td.train_by_id.clear();
+    td.lazy_train_by_id.clear();
+    td.train_sums_by_id.clear();
+    for (auto const& [tn, make] : names) {
+      td.transform_ids.emplace(tn, td.train_by_id.size());
+      if (make==nullptr) {
+        td.train_by_id.push_back(&sptr->at(tn));
+        td.lazy_train_by_id.push_back(nullptr);
+        td.train_sums_by_id.push_back(&sums->at(tn));
+      } else {
+        td.train_by_id.push_back(nullptr);
+        td.lazy_train_by_id.push_back(std::make_shared<LazyDTS>(*make, true));
+        td.train_sums_by_id.push_back(nullptr);
+      }
+    }
+    if (auto it = td.storage.find("test_mdts"); it!=td.storage.end()) {
+      internal::bind_test(td, *std::static_pointer_cast<MDTS>(it->second));
+    }
+    if (!td.train_by_id.empty()) {
+      td.register_data<TrainLabels>(std::make_shared<TrainLabels>(
+        sptr->empty() ? td.lazy_train_by_id.front()->get().header() : sptr->begin()->second.header()), "train_labels");
+    }
+    td.register_data<DTSSumsMap>(std::move(sums), "train_mdts_sums");
+    td.register_data<EnvelopesCache>(std::make_shared<EnvelopesCache>(), "train_envelopes");
+    td.register_data<DifferencesCache>(std::make_shared<DifferencesCache>(), "train_differences");
+    td.register_data<FeatureCache>(std::make_shared<FeatureCache>(), "train_features");
     td.register_data<MDTS>(std::move(sptr), "train_mdts");
   }
 
-  inline void register_test(TreeData& td, std::shared_ptr<MDTS> sptr){
+  /// Register the test data, resolving the test data of the transform IDs.
+  /// The transforms of 'lazy' (other than the ones of 'sptr') are only computed when first accessed (see at_test).
+  /// The test envelopes and features caches start empty (see at_test_envelopes, at_test_features).
+  inline void register_test(TreeData& td, std::shared_ptr<MDTS> sptr, LazyMDTS const& lazy = {}){
+    td.lazy_test.clear();
+    for (auto const& [tn, make] : lazy) {
+      if (!sptr->contains(tn)) { td.lazy_test.emplace(tn, std::make_shared<LazyDTS>(make, false)); }
+    }
+    internal::bind_test(td, *sptr);
     td.register_data<MDTS>(std::move(sptr), "test_mdts");
+    td.register_data<EnvelopesCache>(std::make_shared<EnvelopesCache>(), "test_envelopes");
+    td.register_data<FeatureCache>(std::make_shared<FeatureCache>(), "test_features");
+  }
+
+  /** Make the test transform "derivative1" virtual: when the test data registered by register_test does not
+   *  provide it, its splitters read the test data of "default" and derive the queries on the fly (see
+   *  virtual_test_source), instead of storing a second copy of the test data.
+   */
+  inline void set_virtual_test_derivative(TreeData& td, bool virtual_derivative = true){
+    td.virtual_test_derivative = virtual_derivative;
+  }
+
+  /// ID whose test data is derived on the fly for the transform ID 'id' (see set_virtual_test_derivative), or nothing
+  inline std::optional<size_t> virtual_test_source(TreeData const& td, size_t id){
+    return id<td.virtual_test_source_by_id.size() ? td.virtual_test_source_by_id[id] : std::nullopt;
+  }
+
+  /// ID of a train transform. Throws std::out_of_range if the transform is not registered.
+  inline size_t transform_id(TreeData const& td, std::string const& tname){ return td.transform_ids.at(tname); }
+
+  /// Train data of a transform ID, computing it if it is lazy and not computed yet
+  inline DTS const& at_train(TreeData const& td, size_t id){
+    if (DTS const *dts = td.train_by_id[id]; dts!=nullptr) { return *dts; }
+    return td.lazy_train_by_id[id]->get();
+  }
+
+  /// Test data of a transform ID, computing it if it is lazy and not computed yet.
+  /// Throws std::out_of_range if the transform has no test data.
+  inline DTS const& at_test(TreeData const& td, size_t id){
+    DTS const *dts = id<td.test_by_id.size() ? td.test_by_id[id] : nullptr;
+    if (dts!=nullptr) { return *dts; }
+    if (id<td.lazy_test_by_id.size()&&td.lazy_test_by_id[id]) { return td.lazy_test_by_id[id]->get(); }
+    throw std::out_of_range("No test data for the transform ID " + std::to_string(id));
+  }
+
+  /// Per series sums of the train data of a transform ID (see register_train), computing it if it is lazy
+  inline DTS_Sums const& at_train_sums(TreeData const& td, size_t id){
+    if (DTS_Sums const *sums = td.train_sums_by_id[id]; sums!=nullptr) { return *sums; }
+    LazyDTS& lazy = *td.lazy_train_by_id[id];
+    lazy.get();
+    return lazy.sums.value();
+  }
+
+  /// With TreeData::advise_train, advise the kernel about the access to the train series 'is' of a transform ID:
+  /// a node covering the whole train data scans it (SEQUENTIAL), smaller nodes page their series in (WILLNEED).
+  /// The series of a transform being usually stored in order in one slab, contiguous series are advised at once.
+  inline void advise_train_series(TreeData const& td, size_t id, IndexSet const& is){
+    if (!td.advise_train||is.size()==0) { return; }
+    DTS const& dts = at_train(td, id);
+    const utils::Advice advice = is.size()==dts.size() ? utils::Advice::SEQUENTIAL : utils::Advice::WILLNEED;
+    char const *range_begin = nullptr;
+    char const *range_end = nullptr;
+    for (size_t i : is) {
+      TSeries const& s = dts[i];
+      auto const *begin = reinterpret_cast<char const *>(s.data());
+      auto const *end = begin + s.length()*s.nb_dimensions()*sizeof(F);
+      if (begin!=range_end) {
+        utils::advise(range_begin, range_end - range_begin, advice);
+        range_begin = begin;
+      }
+      range_end = end;
+    }
+    utils::advise(range_begin, range_end - range_begin, advice);
+  }
+
+  /// Quantized train exemplars (see distance::quantized), loaded from a model storing them (see Forest::save).
+  /// The exemplars themselves are the dequantized series, used by all the distances; the DTW and ADTW distances read
+  /// the 16 bits codes instead (see register_quantized).
+  struct QuantizedExemplars {
+    /// Quantized version of the exemplars indexed by their raw data pointer
+    std::map<F const *, distance::quantized::QView<F>> views;
+    /// The codes, when read from a stream...
+    std::vector<std::vector<uint16_t>> codes;
+    /// ... or keep alive the mapping they are read from
+    utils::Capsule mapping;
+  };
+
+  /// Register the quantized train exemplars, looked up by the distances' 'prepare' (see at_train_quantized)
+  inline void register_quantized(TreeData& td, std::shared_ptr<QuantizedExemplars> sptr){
+    td.register_data<QuantizedExemplars>(std::move(sptr), "train_quantized");
+  }
+
+  /// Quantized train exemplars, or nullptr if none are registered
+  inline std::shared_ptr<QuantizedExemplars const> at_train_quantized(TreeData const& td){
+    auto it = td.storage.find("train_quantized");
+    if (it==td.storage.end()) { return nullptr; }
+    return std::static_pointer_cast<QuantizedExemplars const>(it->second);
   }
 
+  /// The eager train transforms (see register_train)
   inline MDTS const& at_train(TreeData const& td){ return at<MDTS>(td, "train_mdts"); }
 
+  /// The eager train transforms and the lazy ones already computed, e.g. the ones used by a trained forest.
+  /// Not thread safe with respect to a concurrent computation of a lazy transform.
+  inline MDTS materialized_train(TreeData const& td){
+    MDTS result = at_train(td);
+    for (auto const& [tn, id] : td.transform_ids) {
+      auto const& lazy = td.lazy_train_by_id[id];
+      if (lazy&&lazy->materialized()) { result.emplace(tn, lazy->dts); }
+    }
+    return result;
+  }
+
+  /// Sums of the eager train transforms (see at_train_sums(td, id) for all of them)
+  inline DTSSumsMap const& at_train_sums(TreeData const& td){ return at<DTSSumsMap>(td, "train_mdts_sums"); }
+
+  inline EnvelopesCache const& at_train_envelopes(TreeData const& td){
+    return at<EnvelopesCache>(td, "train_envelopes");
+  }
+
+  inline DifferencesCache const& at_train_differences(TreeData const& td){
+    return at<DifferencesCache>(td, "train_differences");
+  }
+
+  /// Dense encoded labels of the train data (see TrainLabels)
+  inline TrainLabels const& at_train_labels(TreeData const& td){ return at<TrainLabels>(td, "train_labels"); }
+
+  /// Features of the train data (see FeatureCache)
+  inline FeatureCache const& at_train_features(TreeData const& td){ return at<FeatureCache>(td, "train_features"); }
+
+  /// Envelopes of the test data of the last register_test, shared by the trees predicting it (see EnvelopesCache)
+  inline EnvelopesCache const& at_test_envelopes(TreeData const& td){
+    return at<EnvelopesCache>(td, "test_envelopes");
+  }
+
+  /// Features of the test data of the last register_test (see FeatureCache)
+  inline FeatureCache const& at_test_features(TreeData const& td){ return at<FeatureCache>(td, "test_features"); }
+
   inline MDTS const& at_test(TreeData const& td){ return at<MDTS>(td, "test_mdts"); }
 
 } // End of tempo::classifier::PF2
\ No newline at end of file
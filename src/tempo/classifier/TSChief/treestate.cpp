@@ -4,13 +4,19 @@ namespace tempo::classifier::TSChief {
 
   std::unique_ptr<i_TreeState> TreeState::forest_fork(size_t tree_idx) const {
     // Create the other state and fork substates 1 for 1
+    const auto scope = time("state/fork");
     auto fork = std::make_unique<TreeState>(seed, tree_idx);
+    fork->progress = progress;
+    fork->timers = timers;
+    fork->memo = memo;
+    fork->train_memo = train_memo;
     for (auto const& substate : states) { fork->states.push_back(substate->forest_fork(tree_idx)); }
     return fork;
   }
 
   void TreeState::forest_merge_in(std::unique_ptr<i_TreeState>&& other) {
     // Get pointer of the good type
+    const auto scope = time("state/merge");
     auto *other_state = dynamic_cast<TreeState *>(other.get());
     if (other_state==nullptr) { tempo::utils::should_not_happen("Dynamic cast to TreeState failed"); }
     // Merge in the substates in a 1 to 1 index matching
@@ -20,15 +26,49 @@ namespace tempo::classifier::TSChief {
     }
   }
 
+  std::unique_ptr<TreeState> TreeState::node_fork(uint64_t key) const {
+    const auto scope = time("state/fork");
+    auto fork = std::make_unique<TreeState>(seed, tree_index);
+    fork->progress = progress;
+    fork->timers = timers;
+    fork->memo = memo;
+    fork->train_memo = train_memo;
+    fork->depth = depth;
+    fork->enter_stream(key);
+    for (auto const& substate : states) { fork->states.push_back(substate->forest_fork(tree_index)); }
+    return fork;
+  }
+
+  std::unique_ptr<TreeState> TreeState::branch_fork(size_t branch_idx) const {
+    std::unique_ptr<TreeState> fork = node_fork(stream);
+    fork->start_branch(branch_idx);
+    return fork;
+  }
+
+  void TreeState::branch_merge_in(size_t branch_idx, std::unique_ptr<TreeState>&& fork) {
+    fork->end_branch(branch_idx);
+    forest_merge_in(std::move(fork));
+  }
+
   void TreeState::start_branch(size_t branch_idx) {
+    ++depth;
+    stream_stack.push_back(stream);
+    enter_stream(derive_stream(stream, BRANCH, branch_idx));
     for (auto& substate : states) { substate->start_branch(branch_idx); }
   }
 
   void TreeState::end_branch(size_t branch_idx) {
     for (auto& substate : states) { substate->end_branch(branch_idx); }
+    enter_stream(stream_stack.back());
+    stream_stack.pop_back();
+    --depth;
+  }
+
+  void TreeState::end_node() {
+    for (auto& substate : states) { substate->end_node(); }
   }
 
-  std::vector<std::unique_ptr<TreeState>> TreeState::forest_fork_vec(size_t nb_trees) const {
+  std::vector<std::unique_ptr<TreeState>> TreeState::forest_fork_vec(size_t nb_trees, size_t first_tree_index) const {
     // Note: override covariant not supported when using smart pointer - use raw pointer cast instead
     //       If it were supported, we could have a std::unique_ptr<TreeState> forest_fork method, avoiding the cast.
     //       This is the case with raw pointer, but not with the "smart" one.
@@ -36,7 +76,7 @@ namespace tempo::classifier::TSChief {
     std::vector<std::unique_ptr<TreeState>> local_states;
     for (size_t i = 0; i<nb_trees; ++i) {
       std::unique_ptr<TreeState> uptr;
-      uptr.reset((TreeState *)(forest_fork(i).release()));
+      uptr.reset((TreeState *)(forest_fork(first_tree_index + i).release()));
       local_states.push_back(std::move(uptr));
     }
     return local_states;
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <any>
+#include <cstdint>
 #include <memory>
+#include <tuple>
 #include <utility>
 #include <vector>
 #include "tempo/classifier/utils.hpp"
+#include "distance_memo.hpp"
+#include "progress.hpp"
+#include "timers.hpp"
 
 namespace tempo::classifier::TSChief {
 
@@ -24,11 +29,19 @@ namespace tempo::classifier::TSChief {
     // TODO: think about the callbacks, to be updated (e.g. on leaf)
 
     /// Method called when a new branch is started - will be called before calling the "train" function for this branch.
-    /// Branches are created in a "deep first" fashion.
+    /// Called on the state training the branch: either the state of the node, the branches being created in a
+    /// "deep first" fashion, or a state forked for this branch only (see TreeState::branch_fork).
+    /// A state must not assume that the branches of a node are trained in order, only that the calls on one state
+    /// are in a deep first order.
     virtual void start_branch(size_t branch_idx) = 0;
 
-    /// Method called when a branch is done - will be called after calling the "train" function for this branch.
+    /// Method called when a branch is done - will be called after calling the "train" function for this branch,
+    /// on the state that trained it. A forked state is merged back with 'forest_merge_in' after this call.
     virtual void end_branch(size_t branch_idx) = 0;
+
+    /// Method called once a node is split (or made a leaf), before its branches are trained: release the data kept
+    /// for the node (e.g. per node caches), not to hold it while its subtrees are trained. Nothing by default.
+    virtual void end_node() {}
   };
 
   struct TreeState;
@@ -39,10 +52,59 @@ namespace tempo::classifier::TSChief {
     virtual State& at(TreeState& td) = 0;
   };
 
+  /// A state that can be composed at compile time in StaticStates: forked and merged by value, without allocation
+  template<typename State>
+  concept ComposableState = std::derived_from<State, i_TreeState>&&std::move_constructible<State>&&
+    requires(State const& cstate, State& state, size_t tree_idx) {
+      { cstate.fork(tree_idx) } -> std::same_as<State>;
+      state.merge_in(std::move(state));
+    };
+
+  /** States known at compile time, registered in a TreeState as one state (see TreeState::register_static).
+   *  The states live in one allocation, forked and merged by value. The callbacks are broadcast to them with
+   *  non virtual calls, which the compiler can inline: a tree pays one virtual call per callback for all of them.
+   */
+  template<ComposableState... States>
+  struct StaticStates final : public i_TreeState {
+
+    std::tuple<States...> states;
+
+    explicit StaticStates(States&& ... s) : states(std::move(s)...) {}
+
+    template<typename State>
+    State& get() { return std::get<State>(states); }
+
+    std::unique_ptr<i_TreeState> forest_fork(size_t tree_idx) const override {
+      return std::apply([tree_idx](States const& ... s) {
+        return std::unique_ptr<i_TreeState>(new StaticStates(s.fork(tree_idx)...));
+      }, states);
+    }
+
+    void forest_merge_in(std::unique_ptr<i_TreeState>&& other) override {
+      auto *other_states = dynamic_cast<StaticStates *>(other.get());
+      if (other_states==nullptr) { tempo::utils::should_not_happen("Dynamic cast to StaticStates failed"); }
+      (std::get<States>(states).merge_in(std::move(std::get<States>(other_states->states))), ...);
+    }
+
+    void start_branch(size_t branch_idx) override {
+      (std::get<States>(states).States::start_branch(branch_idx), ...);
+    }
+
+    void end_branch(size_t branch_idx) override { (std::get<States>(states).States::end_branch(branch_idx), ...); }
+
+    void end_node() override { (std::get<States>(states).States::end_node(), ...); }
+  };
+
   /** Maintain a collection of states used in a tree and provide random numbers.
    *  States are represented by unique_ptr<T> where T must subclass i_TreeState.
    *  TreeState itself subclass i_TreeState: all the operation are broadcasted to the states.
    *  Add a state with the 'register_state' method; access the state through the returned object GetState.
+   *  States known at compile time can be registered together with 'register_static' (see StaticStates).
+   *
+   *  Random streams: each node of a tree, and each candidate of a node, draws its random numbers from its own
+   *  stream, whose key is derived from the seed, the tree index, and the path of branch and candidate indexes
+   *  leading to it (see derive_stream). The random numbers of a node do not depend on the order in which the nodes
+   *  are trained, nor on which nodes or candidates are trained by forked states: a forest only depends on its seed.
    */
   struct TreeState : public i_TreeState {
 
@@ -51,24 +113,87 @@ namespace tempo::classifier::TSChief {
     struct GetState : public i_GetState<State> {
       size_t index{};
       explicit GetState(size_t index) : index(index) {}
-      State& at(TreeState& ts) override { return *((State *)ts.states[index].get()); }
+      State& at(TreeState& ts) override { return *static_cast<State *>(ts.states[index].get()); }
     };
 
+    /// Access to the state 'State' of the StaticStates 'Composite'
+    template<typename State, typename Composite>
+    struct GetStaticState : public i_GetState<State> {
+      size_t index{};
+      explicit GetStaticState(size_t index) : index(index) {}
+      State& at(TreeState& ts) override {
+        return static_cast<Composite *>(ts.states[index].get())->template get<State>();
+      }
+    };
+
+    /// Kinds of derived random streams (see derive_stream). ROUTE: chunks of the queries of a node (see
+    /// snode::nn1splitter::GenSplitterNN1::chunk_min_size). CHOSEN: a node once its candidates are generated (see
+    /// snode::meta::SplitterChooserGen::choose)
+    enum Stream : uint64_t { TREE, BRANCH, CANDIDATE, ROUTE, CHOSEN };
+
     // --- --- --- Fields
     std::vector<std::unique_ptr<i_TreeState>> states{};
     size_t seed;
     PRNG prng;
     size_t tree_index;
 
+    /// Key of the random stream of the current node (see enter_stream)
+    uint64_t stream;
+
+    /// Keys of the streams of the nodes above the current one (see start_branch)
+    std::vector<uint64_t> stream_stack{};
+
+    /// Depth of the current node, 0 at the root: counted by start_branch and end_branch, kept by the node forks
+    size_t depth{0};
+
+    /// Counters of the training, shared by all the forks (see TrainingProgress); none by default
+    std::shared_ptr<TrainingProgress> progress{};
+
+    /// Time spent in the phases of the training and prediction, shared by all the forks (see PhaseTimers);
+    /// none by default
+    std::shared_ptr<PhaseTimers> timers{};
+
+    /// Distances between the registered test exemplars and the train exemplars, shared by the trees of a prediction
+    /// and by all the forks (see DistanceMemo); none by default
+    std::shared_ptr<DistanceMemo> memo{};
+
+    /// Distances between the train exemplars computed by the NN1 nodes, shared by all the trees of a training and by
+    /// all the forks (see DistanceMemo, the queries being train exemplars); none by default
+    std::shared_ptr<DistanceMemo> train_memo{};
+
     // --- --- --- Constructor/Destructor
 
     /// Build a new tree state
     /// Note: internal seed = seed+tree_index
     explicit TreeState(size_t seed, size_t tree_index) :
-      seed(seed), prng(seed + tree_index), tree_index(tree_index) {}
+      seed(seed), prng(seed + tree_index), tree_index(tree_index),
+      stream(derive_stream(seed, TREE, tree_index)) {}
 
     // --- --- --- Methods
 
+    /// Key of the stream 'index' of kind 'kind' below the stream 'key'.
+    /// Counter based (a SplitMix64 finaliser over the key, kind and index): no state, no order of derivation.
+    static uint64_t derive_stream(uint64_t key, Stream kind, uint64_t index) noexcept {
+      auto mix = [](uint64_t z) {
+        z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+      };
+      return mix(mix(mix(key + 0x9e3779b97f4a7c15ULL) ^ kind) ^ index);
+    }
+
+    /// Make 'key' the stream of the current node, seeding the PRNG from it
+    void enter_stream(uint64_t key) {
+      stream = key;
+      prng.seed(key);
+    }
+
+    /// Add 'n' to the counter 'c' of the training progress, if any
+    void count(TrainingProgress::Counter c, size_t n = 1) const { if (progress) { progress->add(c, n); }}
+
+    /// Time the phase 'phase' while the returned scope is alive, if there are timers
+    [[nodiscard]] PhaseTimers::Scope time(std::string_view phase) const { return {timers.get(), phase}; }
+
     template<typename State>
     std::shared_ptr<i_GetState<State>> register_state(std::unique_ptr<State>&& uptr) {
       size_t idx = states.size();
@@ -83,16 +208,53 @@ namespace tempo::classifier::TSChief {
       return std::make_shared<GetState<State>>(idx);
     }
 
+    /// Register states known at compile time as one StaticStates; access each state through the returned GetState,
+    /// in the order of the arguments
+    template<ComposableState... States>
+    std::tuple<std::shared_ptr<i_GetState<States>>...> register_static(States&& ... s) {
+      using Composite = StaticStates<States...>;
+      size_t idx = states.size();
+      states.push_back(std::make_unique<Composite>(std::move(s)...));
+      return {std::make_shared<GetStaticState<States, Composite>>(idx)...};
+    }
+
     std::unique_ptr<i_TreeState> forest_fork(size_t tree_idx) const override;
 
     void forest_merge_in(std::unique_ptr<i_TreeState>&& other) override;
 
+    /// Fork for a concurrent evaluation within the current node: substates are forked as with 'forest_fork',
+    /// and the fork enters 'key' (see enter_stream). Merge back with 'forest_merge_in'.
+    std::unique_ptr<TreeState> node_fork(uint64_t key) const;
+
+    /// Fork for the candidate 'candidate_idx' of the current node: a 'node_fork' entering the stream of the
+    /// candidate (see enter_candidate). Merge back with 'forest_merge_in'.
+    std::unique_ptr<TreeState> candidate_fork(size_t candidate_idx) const {
+      return node_fork(derive_stream(stream, CANDIDATE, candidate_idx));
+    }
+
+    /// Enter the stream of the candidate 'candidate_idx' of the node of stream 'node_stream': the same stream as
+    /// the one of a candidate_fork, for the candidates evaluated without forking.
+    void enter_candidate(size_t candidate_idx, uint64_t node_stream) {
+      enter_stream(derive_stream(node_stream, CANDIDATE, candidate_idx));
+    }
+
+    /// Fork for a concurrent training of the branch 'branch_idx': a 'node_fork' on the current stream, then
+    /// 'start_branch' is called on the fork. Merge back with 'branch_merge_in'.
+    std::unique_ptr<TreeState> branch_fork(size_t branch_idx) const;
+
+    /// Call 'end_branch' on a state forked by 'branch_fork', and merge it in.
+    void branch_merge_in(size_t branch_idx, std::unique_ptr<TreeState>&& fork);
+
+    /// Also enter the stream of the branch
     void start_branch(size_t branch_idx) override;
 
+    /// Also enter back the stream of the parent node
     void end_branch(size_t branch_idx) override;
 
-    /// Self-Fork 'nb_trees' time, putting the forked in a vector
-    std::vector<std::unique_ptr<TreeState>> forest_fork_vec(size_t nb_trees) const;
+    void end_node() override;
+
+    /// Self-Fork 'nb_trees' time, for the trees of indexes 'first_tree_index' onward, putting the forked in a vector
+    std::vector<std::unique_ptr<TreeState>> forest_fork_vec(size_t nb_trees, size_t first_tree_index = 0) const;
 
     /// Merge-in a vector of state
     void forest_merge_in_vec(std::vector<std::unique_ptr<TreeState>>&& vec);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+
+#include <tempo/dataset/dts.hpp>
+
+#include "utils.hpp"
+
+namespace tempo::classifier {
+
+  /** Common interface of the forest classifiers (see make_classifier), for the tools running several of them the
+   *  same way (batch runner, benchmarks, server). A classifier is built with its train dataset, and predicts the
+   *  exemplars of test datasets with the same label encoding.
+   */
+  struct i_Classifier {
+
+    virtual ~i_Classifier() = default;
+
+    /// Configuration of the classifier (see make_classifier)
+    virtual std::string const& name() const = 0;
+
+    /// Train on the train dataset given at construction
+    virtual void train(int nb_threads) = 0;
+
+    /// Predict all the exemplars of 'test_dataset': row i of the result is the exemplar i
+    virtual ResultN predict_batch(DTS const& test_dataset, int nb_threads) = 0;
+
+    /// Write the trained model; throws std::logic_error without one
+    virtual void save(std::ostream& out) const = 0;
+
+    /// Load a model written by save, instead of training
+    virtual void load(std::istream& in) = 0;
+
+    /// Bytes held by the trained (or loaded) model, 0 without one
+    virtual size_t memory_footprint() const = 0;
+
+    /// Figures of the last training and prediction, by name (e.g. "train_time_ns", "nb_trees")
+    virtual std::map<std::string, double> stats() const = 0;
+
+  };
+
+} // End of namespace tempo::classifier
@@ -0,0 +1,38 @@
+#include "dist_adtw.hpp"
+
+#include <tempo/distance/tseries.univariate.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tempo::classifier::nn1loocv {
+
+  LOOCV_ADTW::LOOCV_ADTW(DTS train, DTS test, F cfe, std::vector<F> penalties) :
+    i_LOOCVDist(penalties.size()), train(std::move(train)), test(std::move(test)), cfe(cfe),
+    penalties(std::move(penalties)) {
+    if (this->penalties.empty()) { throw std::invalid_argument("LOOCV ADTW: no penalty"); }
+    std::sort(this->penalties.begin(), this->penalties.end());
+  }
+
+  F LOOCV_ADTW::distance_param(size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf) {
+    return distance::univariate::adtw(train[train_idx1], train[train_idx2], cfe, penalties[param_idx], bsf);
+  }
+
+  F LOOCV_ADTW::distance_UB(size_t train_idx1, size_t train_idx2, size_t /* param_idx */) {
+    TSeries const& s1 = train[train_idx1];
+    TSeries const& s2 = train[train_idx2];
+    // Diagonal, summed in the order of the diagonal of ADTW, i.e. DTW with a window of 0 (see LOOCV_DTW::distance_UB)
+    if (s1.length()!=s2.length()) { return utils::PINF; }
+    return distance::univariate::dtw(s1, s2, cfe, 0, utils::PINF);
+  }
+
+  void LOOCV_ADTW::set_loocv_result(std::vector<size_t> bestp) {
+    // bestp is sorted by increasing index, i.e. increasing penalty
+    best_penalty = penalties[bestp[bestp.size()/2]];
+  }
+
+  F LOOCV_ADTW::distance_test(size_t test_idx, size_t train_idx, F bsf) {
+    return distance::univariate::adtw(test[test_idx], train[train_idx], cfe, best_penalty, bsf);
+  }
+
+} // End of namespace tempo::classifier::nn1loocv
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "dist_interface.hpp"
+
+#include <vector>
+
+namespace tempo::classifier::nn1loocv {
+
+  /** LOOCV of the ADTW penalty, for a fixed cost function exponent.
+   *  The penalties are sorted by increasing value (see partable): a larger penalty gives a larger distance.
+   *  The direct alignment, i.e. ADTW with an infinite penalty, is the upper bound of the series of same length.
+   */
+  struct LOOCV_ADTW : public i_LOOCVDist {
+    DTS train;
+    DTS test;
+    F cfe;
+
+    /// Penalties by increasing value
+    std::vector<F> penalties;
+
+    /// Penalty selected by set_loocv_result
+    F best_penalty{0};
+
+    LOOCV_ADTW(DTS train, DTS test, F cfe, std::vector<F> penalties);
+
+    F distance_param(size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf) override;
+
+    F distance_UB(size_t train_idx1, size_t train_idx2, size_t param_idx) override;
+
+    /// Select the median penalty among the best ones
+    void set_loocv_result(std::vector<size_t> bestp) override;
+
+    F distance_test(size_t test_idx, size_t train_idx, F bsf) override;
+  };
+
+} // End of namespace tempo::classifier::nn1loocv
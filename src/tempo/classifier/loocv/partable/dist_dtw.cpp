@@ -0,0 +1,183 @@
+#include "dist_dtw.hpp"
+
+#include <tempo/distance/tseries.univariate.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+namespace tempo::classifier::nn1loocv {
+
+  namespace {
+
+    /// Number of bands used by LB Enhanced (speed/tightness trade-off)
+    constexpr size_t LB_ENHANCED_V = 5;
+
+  } // End of anonymous namespace
+
+  LOOCV_DTW::LOOCV_DTW(DTS train, DTS test, F cfe, std::vector<size_t> windows) :
+    i_LOOCVDist(windows.size()), train(std::move(train)), test(std::move(test)), cfe(cfe),
+    windows(std::move(windows)) {
+    if (this->windows.empty()) { throw std::invalid_argument("LOOCV DTW: no window"); }
+    std::sort(this->windows.begin(), this->windows.end(), std::greater<>());
+    // Envelopes of the train series
+    const size_t nbtrain = this->train.size();
+    upper.resize(nbtrain*nb_params);
+    lower.resize(nbtrain*nb_params);
+    for (size_t i = 0; i<nbtrain; ++i) {
+      TSeries const& s = this->train[i];
+      if (s.length()==0) { continue; }
+      for (size_t p = 0; p<nb_params; ++p) {
+        const size_t idx = i*nb_params + p;
+        distance::univariate::get_keogh_envelopes(s.data(), s.length(), upper[idx], lower[idx], this->windows[p]);
+      }
+    }
+  }
+
+  F LOOCV_DTW::distance_param(size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf) {
+    TSeries const& s1 = train[train_idx1];
+    TSeries const& s2 = train[train_idx2];
+    const size_t length = std::max(s1.length(), s2.length());
+    return cache.get({train_idx1, train_idx2}, length, windows[param_idx], bsf,
+                     [&](size_t w, F cutoff, size_t& max_deviation) {
+                       return distance::univariate::dtw_wr(s1.data(), s1.length(), s2.data(), s2.length(),
+                                                           cfe, w, cutoff, max_deviation);
+                     });
+  }
+
+  F LOOCV_DTW::distance_UB(size_t train_idx1, size_t train_idx2, size_t /* param_idx */) {
+    TSeries const& s1 = train[train_idx1];
+    TSeries const& s2 = train[train_idx2];
+    // Diagonal for series of same length, else let DTW use the diagonal.
+    // Computed by DTW with a window of 0, summing the costs in the order of the diagonal of any window: directa (SIMD
+    // kernels) sums them in another order, and may be below the distances in the last bits.
+    if (s1.length()!=s2.length()) { return utils::PINF; }
+    return distance::univariate::dtw(s1, s2, cfe, 0, utils::PINF);
+  }
+
+  F LOOCV_DTW::distance_LB(size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf) {
+    namespace tdu = distance::univariate;
+    TSeries const& s1 = train[train_idx1];
+    TSeries const& s2 = train[train_idx2];
+    // The lower bounds require series of same length
+    if (s1.length()!=s2.length()||s1.length()==0) { return utils::NINF; }
+    const size_t idx = train_idx2*nb_params + param_idx;
+    const F lbk = tdu::lb_Keogh(s1, upper[idx], lower[idx], cfe, bsf);
+    if (std::isinf(lbk)) { return utils::PINF; }
+    const F lbe = tdu::lb_Enhanced(s1, s2, upper[idx], lower[idx], cfe, LB_ENHANCED_V, windows[param_idx], bsf);
+    return std::max(lbk, lbe);
+  }
+
+  void LOOCV_DTW::set_loocv_result(std::vector<size_t> bestp) {
+    // Largest index: smallest window
+    best_window = windows[*std::max_element(bestp.begin(), bestp.end())];
+    cache.clear();
+  }
+
+  F LOOCV_DTW::distance_test(size_t test_idx, size_t train_idx, F bsf) {
+    TSeries const& q = test[test_idx];
+    TSeries const& s = train[train_idx];
+    return distance::univariate::dtw(q.data(), q.length(), s.data(), s.length(), cfe, best_window, bsf);
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Three exponents at once
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  LOOCV_DTW_CFES::LOOCV_DTW_CFES(DTS train, DTS test, std::vector<size_t> windows) :
+    train(std::move(train)), test(std::move(test)), windows(std::move(windows)) {
+    if (this->windows.empty()) { throw std::invalid_argument("LOOCV DTW: no window"); }
+    std::sort(this->windows.begin(), this->windows.end(), std::greater<>());
+    const size_t nbtrain = this->train.size();
+    const size_t nbp = nb_params();
+    upper.resize(nbtrain*nbp);
+    lower.resize(nbtrain*nbp);
+    for (size_t i = 0; i<nbtrain; ++i) {
+      TSeries const& s = this->train[i];
+      if (s.length()==0) { continue; }
+      for (size_t p = 0; p<nbp; ++p) {
+        const size_t idx = i*nbp + p;
+        distance::univariate::get_keogh_envelopes(s.data(), s.length(), upper[idx], lower[idx], this->windows[p]);
+      }
+    }
+  }
+
+  void LOOCV_DTW_CFES::distance_param(size_t train_idx1, size_t train_idx2, size_t param_idx,
+                                      F const *cutoffs, F *results) {
+    TSeries const& s1 = train[train_idx1];
+    TSeries const& s2 = train[train_idx2];
+    const size_t length = std::max(s1.length(), s2.length());
+    const size_t w = windows[param_idx];
+    const std::pair<size_t, size_t> key{train_idx1, train_idx2};
+    // The exponents answered by their cache are not computed
+    F todo[nb_cfes];
+    bool any = false;
+    for (size_t k = 0; k<nb_cfes; ++k) {
+      todo[k] = utils::NINF;
+      if (cutoffs[k]<0) { continue; }
+      if (auto r = caches[k].find(key, length, w, cutoffs[k])) { results[k] = r.value(); }
+      else {
+        todo[k] = cutoffs[k];
+        any = true;
+      }
+    }
+    if (!any) { return; }
+    F computed[nb_cfes];
+    size_t deviations[nb_cfes];
+    bool shared = false;
+    if constexpr (std::is_same_v<F, double>) {
+      if (s1.length()==s2.length()) {
+        thread_local std::vector<double> buffer;
+        distance::core::simd::dtw_cfes(s1.data(), s2.data(), length, w, todo, computed, deviations, buffer);
+        shared = true;
+      }
+    }
+    if (!shared) {
+      for (size_t k = 0; k<nb_cfes; ++k) {
+        if (todo[k]<0) { continue; }
+        computed[k] = distance::univariate::dtw_wr(s1.data(), s1.length(), s2.data(), s2.length(),
+                                                   cfes[k], w, todo[k], deviations[k]);
+      }
+    }
+    for (size_t k = 0; k<nb_cfes; ++k) {
+      if (todo[k]<0) { continue; }
+      caches[k].store(key, length, w, todo[k], computed[k], deviations[k]);
+      results[k] = computed[k];
+    }
+  }
+
+  F LOOCV_DTW_CFES::distance_UB(size_t train_idx1, size_t train_idx2, size_t /* param_idx */, size_t cfe_idx) {
+    TSeries const& s1 = train[train_idx1];
+    TSeries const& s2 = train[train_idx2];
+    // Diagonal, summed in the order of DTW (see LOOCV_DTW::distance_UB)
+    if (s1.length()!=s2.length()) { return utils::PINF; }
+    return distance::univariate::dtw(s1, s2, cfes[cfe_idx], 0, utils::PINF);
+  }
+
+  F LOOCV_DTW_CFES::distance_LB(size_t train_idx1, size_t train_idx2, size_t param_idx, size_t cfe_idx, F bsf) {
+    namespace tdu = distance::univariate;
+    TSeries const& s1 = train[train_idx1];
+    TSeries const& s2 = train[train_idx2];
+    if (s1.length()!=s2.length()||s1.length()==0) { return utils::NINF; }
+    const F cfe = cfes[cfe_idx];
+    const size_t idx = train_idx2*nb_params() + param_idx;
+    const F lbk = tdu::lb_Keogh(s1, upper[idx], lower[idx], cfe, bsf);
+    if (std::isinf(lbk)) { return utils::PINF; }
+    const F lbe = tdu::lb_Enhanced(s1, s2, upper[idx], lower[idx], cfe, LB_ENHANCED_V, windows[param_idx], bsf);
+    return std::max(lbk, lbe);
+  }
+
+  void LOOCV_DTW_CFES::set_loocv_result(size_t cfe_idx, std::vector<size_t> bestp) {
+    best_window[cfe_idx] = windows[*std::max_element(bestp.begin(), bestp.end())];
+    caches[cfe_idx].clear();
+  }
+
+  F LOOCV_DTW_CFES::distance_test(size_t cfe_idx, size_t test_idx, size_t train_idx, F bsf) {
+    TSeries const& q = test[test_idx];
+    TSeries const& s = train[train_idx];
+    return distance::univariate::dtw(q.data(), q.length(), s.data(), s.length(), cfes[cfe_idx],
+                                     best_window[cfe_idx], bsf);
+  }
+
+} // End of namespace tempo::classifier::nn1loocv
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "dist_interface.hpp"
+
+#include <tempo/distance/warping_cache.hpp>
+#include <tempo/distance/core/elastic/dtw.simd.hpp>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace tempo::classifier::nn1loocv {
+
+  /** LOOCV of the DTW window, for a fixed cost function exponent.
+   *  The windows are sorted by decreasing value (see partable): the same pair of series is evaluated at several
+   *  windows. A DTW computed at a window is also the DTW at all the smaller windows down to the max deviation of its
+   *  warping path: the results are kept in a WarpingCache, answering most of the DTW computations of the sweep.
+   *  The envelopes of the train series are computed for each window, providing LB Keogh and LB Enhanced
+   *  lower bounds for the series of same length (see distance_LB).
+   */
+  struct LOOCV_DTW : public i_LOOCVDist {
+    DTS train;
+    DTS test;
+    F cfe;
+
+    /// Windows by decreasing value
+    std::vector<size_t> windows;
+
+    /// Window selected by set_loocv_result
+    size_t best_window{0};
+
+    /// Envelopes of the train series, per window: upper[train_idx*nb_params + param_idx].
+    /// Empty for the empty series.
+    std::vector<std::vector<F>> upper;
+    std::vector<std::vector<F>> lower;
+
+    /// DTW results between train series, keyed by pair of train indexes
+    distance::WarpingCache<F, std::pair<size_t, size_t>> cache;
+
+    LOOCV_DTW(DTS train, DTS test, F cfe, std::vector<size_t> windows);
+
+    F distance_param(size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf) override;
+
+    F distance_UB(size_t train_idx1, size_t train_idx2, size_t param_idx) override;
+
+    /// LB Keogh then LB Enhanced of train_idx1 against the envelopes of train_idx2, for series of same length.
+    F distance_LB(size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf) override;
+
+    /// Select the smallest window among the best ones (the fastest)
+    void set_loocv_result(std::vector<size_t> bestp) override;
+
+    F distance_test(size_t test_idx, size_t train_idx, F bsf) override;
+  };
+
+  /** LOOCV of the DTW window under the cost function exponents 0.5, 1 and 2 at once (see partable_multi).
+   *  The three exponents evaluate the same pairs at the same windows: a pair is computed in one pass for the
+   *  exponents needing it, sharing the costs |a-b| (see distance::core::simd::dtw_cfes), instead of one LOOCV_DTW
+   *  sweep per exponent. The caches and the lower bounds are the ones of LOOCV_DTW, per exponent; the envelopes do not
+   *  depend on the exponent. Pairs of series of different lengths use one DTW per exponent.
+   */
+  struct LOOCV_DTW_CFES {
+    static constexpr size_t nb_cfes = distance::core::simd::NB_CFES;
+
+    /// Exponents, in the order of the results
+    static constexpr std::array<F, nb_cfes> cfes{0.5, 1, 2};
+
+    DTS train;
+    DTS test;
+
+    /// Windows by decreasing value
+    std::vector<size_t> windows;
+
+    /// Per exponent: train (LOOCV) and test results, updated by partable, and window selected by set_loocv_result
+    std::array<result_LOOCVDist, nb_cfes> result_train{};
+    std::array<result_LOOCVDist, nb_cfes> result_test{};
+    std::array<size_t, nb_cfes> best_window{};
+
+    /// Envelopes of the train series, per window (see LOOCV_DTW)
+    std::vector<std::vector<F>> upper;
+    std::vector<std::vector<F>> lower;
+
+    /// DTW results between train series, per exponent
+    std::array<distance::WarpingCache<F, std::pair<size_t, size_t>>, nb_cfes> caches;
+
+    LOOCV_DTW_CFES(DTS train, DTS test, std::vector<size_t> windows);
+
+    size_t nb_params() const { return windows.size(); }
+
+    /// DTW at a window under the exponents with a non negative cutoff (see distParamMulti_ft)
+    void distance_param(size_t train_idx1, size_t train_idx2, size_t param_idx, F const *cutoffs, F *results);
+
+    F distance_UB(size_t train_idx1, size_t train_idx2, size_t param_idx, size_t cfe_idx);
+
+    F distance_LB(size_t train_idx1, size_t train_idx2, size_t param_idx, size_t cfe_idx, F bsf);
+
+    /// Select the smallest window among the best ones of an exponent
+    void set_loocv_result(size_t cfe_idx, std::vector<size_t> bestp);
+
+    F distance_test(size_t cfe_idx, size_t test_idx, size_t train_idx, F bsf);
+  };
+
+} // End of namespace tempo::classifier::nn1loocv
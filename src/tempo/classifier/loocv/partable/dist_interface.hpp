@@ -15,6 +15,23 @@ namespace tempo::classifier::nn1loocv {
   /// i.e. a form of direct alignment (eventually completed along the last line/column for disparate lengths)
   using distUB_ft = std::function<F(size_t train_idx1, size_t train_idx2, size_t param_idx)>;
 
+  /// Same as above, but must produce a Lower Bound (LB) of the distance, e.g. LB Keogh for DTW.
+  /// Can be early abandoned with 'bsf': return +INF if the lower bound is above it.
+  using distLB_ft = std::function<F(size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf)>;
+
+  /// Several families of distances sharing their parameters (e.g. DTW under several cost function exponents),
+  /// computed at once for a pair and a parameter index: results[f] is the distance of the family f, or +INF if above
+  /// cutoffs[f]. A family with a negative cutoff is not needed: its result is ignored.
+  using distParamMulti_ft = std::function<void(size_t train_idx1, size_t train_idx2, size_t param_idx,
+                                               F const *cutoffs, F *results)>;
+
+  /// Upper bound of the distance of a family (see distUB_ft)
+  using distFamilyUB_ft = std::function<F(size_t train_idx1, size_t train_idx2, size_t param_idx, size_t family)>;
+
+  /// Lower bound of the distance of a family (see distLB_ft)
+  using distFamilyLB_ft = std::function<F(size_t train_idx1, size_t train_idx2, size_t param_idx, size_t family,
+                                          F bsf)>;
+
   /// Test function - must capture the best parameterization found by LOOCV
   using distTest_ft = std::function<F(size_t tst_idx, size_t train_idx, F bsf)>;
 
@@ -71,6 +88,14 @@ namespace tempo::classifier::nn1loocv {
     /// Operate on train indexes.
     virtual F distance_UB(size_t train_idx1, size_t train_idx2, size_t param_idx) = 0;
 
+    /// Optional Lower Bound (LB) of the distance, allowing to skip the pairs that cannot be NN.
+    /// Can be early abandoned with 'bsf': return +INF if the lower bound is above it.
+    /// The default does not bound anything.
+    /// Operate on train indexes.
+    virtual F distance_LB(size_t /* train_idx1 */, size_t /* train_idx2 */, size_t /* param_idx */, F /* bsf */) {
+      return utils::NINF;
+    }
+
     /// The LOOCV process will produce a collection of best parameter ids (more than one due to ties),
     /// and the number of correctly classified instance.
     /// Also record the time taken.
@@ -0,0 +1,35 @@
+#include "dist_lcss.hpp"
+
+#include <tempo/distance/tseries.univariate.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace tempo::classifier::nn1loocv {
+
+  LOOCV_LCSS::LOOCV_LCSS(DTS train, DTS test, F epsilon, std::vector<size_t> windows) :
+    i_LOOCVDist(windows.size()), train(std::move(train)), test(std::move(test)), epsilon(epsilon),
+    windows(std::move(windows)) {
+    if (this->windows.empty()) { throw std::invalid_argument("LOOCV LCSS: no window"); }
+    std::sort(this->windows.begin(), this->windows.end(), std::greater<>());
+  }
+
+  F LOOCV_LCSS::distance_param(size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf) {
+    return distance::univariate::lcss(train[train_idx1], train[train_idx2], epsilon, windows[param_idx], bsf);
+  }
+
+  F LOOCV_LCSS::distance_UB(size_t /* train_idx1 */, size_t /* train_idx2 */, size_t /* param_idx */) {
+    return utils::PINF;
+  }
+
+  void LOOCV_LCSS::set_loocv_result(std::vector<size_t> bestp) {
+    // Largest index: smallest window
+    best_window = windows[*std::max_element(bestp.begin(), bestp.end())];
+  }
+
+  F LOOCV_LCSS::distance_test(size_t test_idx, size_t train_idx, F bsf) {
+    return distance::univariate::lcss(test[test_idx], train[train_idx], epsilon, best_window, bsf);
+  }
+
+} // End of namespace tempo::classifier::nn1loocv
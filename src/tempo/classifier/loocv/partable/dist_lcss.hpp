@@ -0,0 +1,37 @@
+#pragma once
+
+#include "dist_interface.hpp"
+
+#include <vector>
+
+namespace tempo::classifier::nn1loocv {
+
+  /** LOOCV of the LCSS window, for a fixed epsilon.
+   *  The windows are sorted by decreasing value (see partable): a smaller window matches fewer points, giving a
+   *  larger distance. Epsilon is not ordered with the window: tune it with one instance per epsilon.
+   */
+  struct LOOCV_LCSS : public i_LOOCVDist {
+    DTS train;
+    DTS test;
+    F epsilon;
+
+    /// Windows by decreasing value
+    std::vector<size_t> windows;
+
+    /// Window selected by set_loocv_result
+    size_t best_window{0};
+
+    LOOCV_LCSS(DTS train, DTS test, F epsilon, std::vector<size_t> windows);
+
+    F distance_param(size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf) override;
+
+    /// No upper bound: the first distance computed by partable is not early abandoned
+    F distance_UB(size_t train_idx1, size_t train_idx2, size_t param_idx) override;
+
+    /// Select the smallest window among the best ones (the fastest)
+    void set_loocv_result(std::vector<size_t> bestp) override;
+
+    F distance_test(size_t test_idx, size_t train_idx, F bsf) override;
+  };
+
+} // End of namespace tempo::classifier::nn1loocv
@@ -0,0 +1,176 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "partable.hpp"
+
+#include <tempo/distance/univariate.hpp>
+#include <tempo/utils/utils.hpp>
+
+#include <mock/mockseries.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Thread scaling of the LOOCV table (partable), for 1 to 64 threads.
+// When a series S is added to the table, one task per series Ti already in the table computes the distances of the
+// pair (S, Ti) for all the parameters, and updates both rows: the row of Ti is only written by its task, the row of S
+// by all of them. The row of S used to be protected by a mutex per cell; it is now updated with a compare-and-swap.
+//  - Shared row: the table updates alone, with cheap synthetic distances, i.e. the worst contention on the row of S,
+//    for a cell with a mutex (baseline) and for the atomic cell of partable.
+//  - DTW: the full partable search over windows, as run by the NN1 LOOCV.
+// Compare the results across the thread counts; run with e.g. 'libtempo-bench "[partable]"'.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+using namespace tempo;
+using namespace tempo::classifier::nn1loocv;
+namespace tdu = tempo::distance::univariate;
+
+namespace {
+
+  const std::vector<size_t> nbthreads_list{1, 2, 4, 8, 16, 32, 64};
+
+  /// Cell of the table before the compare-and-swap: the row of S is updated under the lock of the cell
+  struct MutexNNC {
+    F NNdistance{tempo::utils::PINF};
+    size_t NNindex{};
+    std::mutex mutex;
+  };
+
+  /// Cheap deterministic "distance" of the pair (S, Ti) at the parameter Pi, increasing with Pi.
+  /// Without ties between the Ti<256 of a cell, so that the NN of a cell does not depend on the thread timings.
+  F synthetic_distance(size_t S, size_t Ti, size_t Pi) {
+    size_t h = (S*0x9E3779B97F4A7C15ull) ^ (Ti*0xC2B2AE3D27D4EB4Full);
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return (F)(((h%64) << 8) | (Ti%256)) + (F)(Pi << 14);
+  }
+
+  /// Fill the table with the mutex cell; return the sum of the NN indexes so that the work is not discarded
+  size_t shared_row_mutex(size_t nbline, size_t nbcol, size_t nbthreads) {
+    std::vector<MutexNNC> table(nbline*nbcol);
+    tempo::utils::ParTasks ptask;
+    for (size_t S = 1; S<nbline; ++S) {
+      for (size_t Ti = 0; Ti<S; ++Ti) {
+        ptask.push_task([&, S, Ti]() {
+          for (size_t Pi = 0; Pi<nbcol; ++Pi) {
+            const F d = synthetic_distance(S, Ti, Pi);
+            {
+              auto& nn = table[S*nbcol + Pi];
+              std::lock_guard lock(nn.mutex);
+              if (d<nn.NNdistance) {
+                nn.NNindex = Ti;
+                nn.NNdistance = d;
+              }
+            }
+            auto& nn = table[Ti*nbcol + Pi];
+            if (d<nn.NNdistance) {
+              nn.NNindex = S;
+              nn.NNdistance = d;
+            }
+          }
+        });
+      }
+      ptask.execute((int)nbthreads);
+    }
+    size_t r = 0;
+    for (auto const& nn : table) { r += nn.NNindex; }
+    return r;
+  }
+
+  /// Fill the table with the atomic cell, as partable does: compare-and-swap on the row of S, the indexes of S being
+  /// set once the tasks are done from the distances they computed.
+  size_t shared_row_cas(size_t nbline, size_t nbcol, size_t nbthreads) {
+    std::vector<NNC> table(nbline*nbcol);
+    for (auto& nn : table) { nn.NNdistance.store(tempo::utils::PINF, std::memory_order_relaxed); }
+    std::vector<F> results;
+    tempo::utils::ParTasks ptask;
+    for (size_t S = 1; S<nbline; ++S) {
+      results.assign(S*nbcol, tempo::utils::PINF);
+      for (size_t Ti = 0; Ti<S; ++Ti) {
+        ptask.push_task([&, S, Ti]() {
+          for (size_t Pi = 0; Pi<nbcol; ++Pi) {
+            const F d = synthetic_distance(S, Ti, Pi);
+            results[Ti*nbcol + Pi] = d;
+            auto& a = table[S*nbcol + Pi].NNdistance;
+            F current = a.load(std::memory_order_relaxed);
+            while (d<current&&!a.compare_exchange_weak(current, d, std::memory_order_relaxed)) {}
+            auto& nn = table[Ti*nbcol + Pi];
+            if (d<nn.NNdistance.load(std::memory_order_relaxed)) {
+              nn.NNindex = S;
+              nn.NNdistance.store(d, std::memory_order_relaxed);
+            }
+          }
+        });
+      }
+      ptask.execute((int)nbthreads);
+      for (size_t Pi = 0; Pi<nbcol; ++Pi) {
+        const F d = table[S*nbcol + Pi].NNdistance.load(std::memory_order_relaxed);
+        for (size_t Ti = 0; Ti<S; ++Ti) {
+          if (results[Ti*nbcol + Pi]==d) {
+            table[S*nbcol + Pi].NNindex = Ti;
+            break;
+          }
+        }
+      }
+    }
+    size_t r = 0;
+    for (auto const& nn : table) { r += nn.NNindex; }
+    return r;
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Shared row of S: mutex per cell vs compare-and-swap
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Benchmark partable shared row", "[bench][partable]") {
+  constexpr size_t nbline = 256;
+  constexpr size_t nbcol = 100;
+  // Both cells find the same NNs
+  REQUIRE(shared_row_mutex(nbline, nbcol, 4)==shared_row_cas(nbline, nbcol, 4));
+  for (size_t nbt : nbthreads_list) {
+    BENCHMARK("mutex threads=" + std::to_string(nbt)) { return shared_row_mutex(nbline, nbcol, nbt); };
+    BENCHMARK("cas threads=" + std::to_string(nbt)) { return shared_row_cas(nbline, nbcol, nbt); };
+  }
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Full search: DTW over windows
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Benchmark partable DTW", "[bench][partable][dtw]") {
+  constexpr size_t nbtrain = 128;
+  constexpr size_t length = 128;
+  constexpr F cfe = 2.0;
+  mock::Mocker<F> mocker(0);
+  mocker._fixl = length;
+  std::vector<std::vector<F>> dset;
+  std::vector<std::optional<std::string>> labels;
+  for (size_t i = 0; i<nbtrain; ++i) {
+    dset.push_back(mocker.randvec());
+    labels.emplace_back(std::to_string(i%4));
+  }
+  const DatasetHeader header("mock", length, length, 1, std::move(labels), std::vector<size_t>{});
+
+  // Windows in decreasing order (see partable): the distance increases with the parameter index
+  std::vector<size_t> windows;
+  for (size_t w = length/4 + 1; w-->0;) { windows.push_back(w); }
+
+  distParam_ft distance = [&](size_t i, size_t j, size_t p, F bsf) {
+    return tdu::dtw<F>(dset[i].data(), length, dset[j].data(), length, cfe, windows[p], bsf);
+  };
+  distUB_ft distanceUB = [&](size_t i, size_t j, size_t) {
+    return tdu::directa<F>(dset[i].data(), length, dset[j].data(), length, cfe, tempo::utils::PINF);
+  };
+
+  for (size_t nbt : nbthreads_list) {
+    BENCHMARK("dtw threads=" + std::to_string(nbt)) {
+      return std::get<1>(partable(distance, distanceUB, {}, nbtrain, header, windows.size(), nbt));
+    };
+  }
+}
@@ -1,44 +1,266 @@
 #include "partable.hpp"
+#include "dist_dtw.hpp"
 
 #include <tempo/utils/utils.hpp>
+#include <tempo/utils/utils/aligned_allocator.hpp>
+
+#include <algorithm>
+#include <numeric>
 
 namespace tempo::classifier::nn1loocv {
 
+  namespace {
+
+    /// NNTable storage: NBLINE*NBCOL cells, read at random, on huge pages if enabled (see utils::memory::huge_pages)
+    using Table = std::vector<NNC, tempo::utils::HugePageAllocator<NNC, 64>>;
+
+    /// Lower bound used when none is provided
+    F no_LB(size_t, size_t, size_t, F) { return tempo::utils::NINF; }
+
+    /// NNTable is full: find the params with the fewest error. Return (params, number of correct)
+    std::tuple<std::vector<size_t>, size_t> best_params(
+      Table const& NNTable, size_t NBLINE, size_t NBCOL, DatasetHeader const& train_header
+    ) {
+      std::vector<size_t> result;
+      size_t bestError = std::numeric_limits<size_t>::max();
+      for (size_t pidx = 0; pidx<NBCOL; ++pidx) {
+        size_t nError = 0;
+        for (size_t Ti = 0; Ti<NBLINE; Ti++) {
+          if (train_header.label(Ti).value()!=train_header.label(NNTable[Ti*NBCOL + pidx].NNindex).value()) {
+            nError++;
+          }
+        }
+        //
+        if (nError<bestError) {
+          result.clear();
+          result.push_back(pidx);
+          bestError = nError;
+        } else if (nError==bestError) { result.push_back(pidx); }
+      }
+      return {result, NBLINE - bestError};
+    }
+
+    /// Round robin schedule of the pairs of blocks: in each round, every block appears at most once.
+    /// The first round is made of the diagonal pairs (b, b).
+    std::vector<std::vector<std::pair<size_t, size_t>>> block_rounds(size_t nb_blocks) {
+      std::vector<std::vector<std::pair<size_t, size_t>>> rounds;
+      rounds.emplace_back();
+      for (size_t b = 0; b<nb_blocks; ++b) { rounds.back().emplace_back(b, b); }
+      // Circle method: the block 0 is fixed, the others rotate. An odd number of blocks gets a dummy one.
+      const size_t n = nb_blocks + (nb_blocks%2);
+      std::vector<size_t> circle(n);
+      std::iota(circle.begin(), circle.end(), 0);
+      for (size_t r = 0; r + 1<n; ++r) {
+        rounds.emplace_back();
+        for (size_t k = 0; k<n/2; ++k) {
+          const size_t a = circle[k];
+          const size_t b = circle[n - 1 - k];
+          if (a<nb_blocks&&b<nb_blocks) { rounds.back().emplace_back(std::min(a, b), std::max(a, b)); }
+        }
+        std::rotate(circle.begin() + 1, circle.end() - 1, circle.end());
+      }
+      std::erase_if(rounds, [](auto const& round) { return round.empty(); });
+      return rounds;
+    }
+
+    /// NN1 test of a parameterization captured by 'distanceTest', with tie management
+    result_LOOCVDist nn1_test(
+      distTest_ft const& distanceTest,
+      DatasetHeader const& train_header,
+      size_t nbtest,
+      DatasetHeader const& test_header,
+      PRNG& prng,
+      size_t nbthreads,
+      std::ostream *out
+    ) {
+      const size_t train_size = train_header.size();
+      const size_t test_size = test_header.size();
+      size_t test_nb_correct = 0;
+
+      // --- Progress reporting
+      tempo::utils::ProgressMonitor pm(test_size);    // How many to do, both train and test accuracy
+      size_t nb_done = 0;                             // How many done up to "now"
+
+      // --- Multithreading control
+      std::mutex mutex;
+
+      // --- NN1 test task with tie management
+      auto nn1_test_task = [&](size_t test_idx) mutable {
+        double bsf = tempo::utils::PINF;
+        std::set<tempo::EL> labels{};       // manage ties
+        for (size_t train_idx{0}; train_idx<train_size; train_idx++) {
+          double d = distanceTest(test_idx, train_idx, bsf);
+          if (d<bsf) { // Best: clear labels and insert new
+            labels.clear();
+            labels.insert(train_header.label(train_idx).value());
+            bsf = d;
+          } else if (d==bsf) { // Same: add label in
+            labels.insert(train_header.label(train_idx).value());
+          }
+        }
+        // --- Update accuracy
+        {
+          std::lock_guard lock(mutex);
+          tempo::EL result = -1;
+          std::sample(labels.begin(), labels.end(), &result, 1, prng);
+          assert(result<train_header.nb_classes());
+          if (result==test_header.label(test_idx).value()) { ++test_nb_correct; }
+          nb_done++;
+          pm.print_progress(out, nb_done);
+        }
+      };
+
+      // --- Create the tasks per tree. Note that we clone the state.
+      tempo::utils::ParTasks p;
+      auto test_start = tempo::utils::now();
+      p.execute(nbthreads, nn1_test_task, 0, test_size, 1);
+      tempo::utils::duration_t test_time = tempo::utils::now() - test_start;
+
+      // --- Write result
+      result_LOOCVDist result_test{};
+      result_test.size = nbtest;
+      result_test.nb_correct = test_nb_correct;
+      result_test.accuracy = (double)test_nb_correct/(double)nbtest;
+      result_test.time = test_time;
+      return result_test;
+    }
+
+    /// Copy of a NNTable
+    std::vector<NNCell> to_cells(Table const& NNTable) {
+      std::vector<NNCell> cells;
+      cells.reserve(NNTable.size());
+      for (auto const& nn : NNTable) { cells.emplace_back(nn.NNdistance.load(std::memory_order_relaxed), nn.NNindex); }
+      return cells;
+    }
+
+    /// NNTable of partable
+    Table fill_partable(
+      distParam_ft distance,
+      distUB_ft distanceUB,
+      distLB_ft distanceLB,
+      size_t nbtrain,
+      size_t nbparams,
+      size_t nbthreads,
+      std::ostream *out
+    );
+
+    /// NNTable of partable_blocked
+    Table fill_partable_blocked(
+      distParam_ft distance,
+      distUB_ft distanceUB,
+      distLB_ft distanceLB,
+      size_t nbtrain,
+      size_t nbparams,
+      size_t nbthreads,
+      size_t block_size,
+      std::ostream *out
+    );
+
+  } // End of anonymous namespace
+
   std::tuple<std::vector<size_t>, size_t> partable(
     distParam_ft distance,
     distUB_ft distanceUB,
+    distLB_ft distanceLB,
     size_t nbtrain,
     DatasetHeader const& train_header,
     size_t nbparams,
     size_t nbthreads,
     std::ostream *out
+  ) {
+    const Table NNTable = fill_partable(std::move(distance), std::move(distanceUB), std::move(distanceLB), nbtrain,
+                                        nbparams, nbthreads, out);
+    return best_params(NNTable, nbtrain, nbparams, train_header);
+  }
+
+  std::vector<NNCell> partable_table(
+    distParam_ft distance,
+    distUB_ft distanceUB,
+    distLB_ft distanceLB,
+    size_t nbtrain,
+    size_t nbparams,
+    size_t nbthreads
+  ) {
+    return to_cells(fill_partable(std::move(distance), std::move(distanceUB), std::move(distanceLB), nbtrain,
+                                  nbparams, nbthreads, nullptr));
+  }
+
+  std::tuple<std::vector<size_t>, size_t> partable_blocked(
+    distParam_ft distance,
+    distUB_ft distanceUB,
+    distLB_ft distanceLB,
+    size_t nbtrain,
+    DatasetHeader const& train_header,
+    size_t nbparams,
+    size_t nbthreads,
+    size_t block_size,
+    std::ostream *out
+  ) {
+    const Table NNTable = fill_partable_blocked(std::move(distance), std::move(distanceUB), std::move(distanceLB),
+                                                nbtrain, nbparams, nbthreads, block_size, out);
+    return best_params(NNTable, nbtrain, nbparams, train_header);
+  }
+
+  std::vector<NNCell> partable_blocked_table(
+    distParam_ft distance,
+    distUB_ft distanceUB,
+    distLB_ft distanceLB,
+    size_t nbtrain,
+    size_t nbparams,
+    size_t nbthreads,
+    size_t block_size
+  ) {
+    return to_cells(fill_partable_blocked(std::move(distance), std::move(distanceUB), std::move(distanceLB), nbtrain,
+                                          nbparams, nbthreads, block_size, nullptr));
+  }
+
+  namespace {
+
+  Table fill_partable(
+    distParam_ft distance,
+    distUB_ft distanceUB,
+    distLB_ft distanceLB,
+    size_t nbtrain,
+    size_t nbparams,
+    size_t nbthreads,
+    std::ostream *out
   ) {
     const size_t NBLINE = nbtrain;
     const size_t NBCOL = nbparams;
     const size_t NBCELL = NBLINE*NBCOL;
+    if (!distanceLB) { distanceLB = no_LB; }
 
     // NNTable: one line per series, |params| column.
     // At each column, register the closest NN ID and the associated distance
-    std::vector<NNC> NNTable(NBCELL);
+    Table NNTable(NBCELL);
     for (size_t i = 0; i<NBCELL; ++i) {
       NNTable[i].NNindex = NBLINE;
-      NNTable[i].NNdistance = tempo::utils::PINF;
+      NNTable[i].NNdistance.store(tempo::utils::PINF, std::memory_order_relaxed);
     }
 
-    // Ordered set of added series, sorted by their (approximated) descending NN distance in NNTable[T, last]
-    // i.e. the first series has a large distance to its NN, and the last one has a small distance to its NN.
-    std::vector<size_t> intable;
-    intable.reserve(NBLINE);
+    auto nndist = [&](size_t table_idx) { return NNTable[table_idx].NNdistance.load(std::memory_order_relaxed); };
 
-    auto update = [&](size_t table_idx, size_t nnindex, double nndist) {
+    // Update of a cell only written by the calling thread
+    auto update = [&](size_t table_idx, size_t nnindex, F d) {
       auto& nn = NNTable[table_idx];
-      std::lock_guard lock(nn.mutex);
-      if (nndist<nn.NNdistance) {
+      if (d<nn.NNdistance.load(std::memory_order_relaxed)) {
         nn.NNindex = nnindex;
-        nn.NNdistance = nndist;
+        nn.NNdistance.store(d, std::memory_order_relaxed);
       }
     };
 
+    // Lock-free update of the distance of a cell written concurrently: keep the minimum
+    auto update_min = [&](size_t table_idx, F d) {
+      auto& a = NNTable[table_idx].NNdistance;
+      F current = a.load(std::memory_order_relaxed);
+      while (d<current&&!a.compare_exchange_weak(current, d, std::memory_order_relaxed)) {}
+    };
+
+    // Ordered set of added series, sorted by their (approximated) descending NN distance in NNTable[T, last]
+    // i.e. the first series has a large distance to its NN, and the last one has a small distance to its NN.
+    std::vector<size_t> intable;
+    intable.reserve(NBLINE);
+
     // --- --- --- Add the first pair
     {
       // Start with the upper bound
@@ -51,7 +273,7 @@ namespace tempo::classifier::nn1loocv {
       }
       // Complete the table cutting with the UB (we are not going to EA anything here)
       for (int pidx = (int)NBCOL - 2; pidx>=0; --pidx) {
-        F UB = NNTable[0*NBCOL + pidx + 1].NNdistance;
+        F UB = nndist(0*NBCOL + pidx + 1);
         F d = distance(0, 1, pidx, UB);
         update(0*NBCOL + pidx, 1, d);
         update(1*NBCOL + pidx, 0, d);
@@ -62,31 +284,46 @@ namespace tempo::classifier::nn1loocv {
 
     tempo::utils::ParTasks ptask;
 
+    // Distances computed by the task of the k-th series of intable, in results[k*NBCOL + Pi] (+INF if not computed)
+    std::vector<F> results;
+
     // --- --- --- Add the other series
     for (size_t S = 2; S<NBLINE; ++S) {
       auto start = tempo::utils::now();
+      results.assign(intable.size()*NBCOL, tempo::utils::PINF);
 
       // --- Complete with other series already in the table
-      // This loop generates a set of task (one per Ti)
-      for (size_t Ti : intable) {
+      // This loop generates a set of task (one per Ti).
+      // The row of Ti is only written by its task, the row of S by all of them: its distances are updated without
+      // lock, the lowest distance of the tasks being visible to all. Its indexes are set once the tasks are done.
+      for (size_t k = 0; k<intable.size(); ++k) {
+        const size_t Ti = intable[k];
         // --- Define the tasks
-        auto task = [&, Ti]() {
+        auto task = [&, Ti, k]() {
+          F *res = results.data() + k*NBCOL;
           // Max bound: if above this, S and T cannot be each other NN
-          const F dmax = std::max(NNTable[S*NBCOL + NBCOL - 1].NNdistance, NNTable[Ti*NBCOL + NBCOL - 1].NNdistance);
+          const F dmax = std::max(nndist(S*NBCOL + NBCOL - 1), nndist(Ti*NBCOL + NBCOL - 1));
           // Start the process with the first parameters, and no lower bound
           size_t Pi = 0;
           F LB = 0;
           do {
-            const F d_S = NNTable[S*NBCOL + Pi].NNdistance;
-            const F d_Ti = NNTable[Ti*NBCOL + Pi].NNdistance;
+            const F d_S = nndist(S*NBCOL + Pi);
+            const F d_Ti = nndist(Ti*NBCOL + Pi);
             const F d_nn = std::max(d_S, d_Ti);
             if (LB<d_nn) {
-              const F cutoff = std::min(dmax, distanceUB(S, Ti, Pi));
-              const F di = distance(S, Ti, Pi, cutoff);
-              update(S*NBCOL + Pi, Ti, di);
-              update(Ti*NBCOL + Pi, S, di);
-              if (di==tempo::utils::PINF) { Pi = NBCOL; }
-              else { LB = di; }
+              // Skip the parameter if its lower bound is not below the NN distances (they would not be updated);
+              // as the distance increases with the parameters, the lower bound also holds for the next ones.
+              const F lb = distanceLB(S, Ti, Pi, d_nn);
+              if (lb<d_nn) {
+                LB = std::max(LB, lb);
+                const F cutoff = std::min(dmax, distanceUB(S, Ti, Pi));
+                const F di = distance(S, Ti, Pi, cutoff);
+                res[Pi] = di;
+                update_min(S*NBCOL + Pi, di);
+                update(Ti*NBCOL + Pi, S, di);
+                if (di==tempo::utils::PINF) { Pi = NBCOL; }
+                else { LB = di; }
+              }
             }
             Pi++;
           } while (Pi<NBCOL);
@@ -98,12 +335,26 @@ namespace tempo::classifier::nn1loocv {
       // --- Execute the tasks in parallel
       ptask.execute(nbthreads);
 
+      // --- Index of the NN of S per parameter: the first series of intable whose distance reaches the minimum.
+      // The minimum does not depend on the threads, but a series at the same distance may not have been computed
+      // (pruned by the bound of another task): among ties, the index may depend on the thread timings.
+      for (size_t Pi = 0; Pi<NBCOL; ++Pi) {
+        const F d = nndist(S*NBCOL + Pi);
+        if (d==tempo::utils::PINF) { continue; }
+        for (size_t k = 0; k<intable.size(); ++k) {
+          if (results[k*NBCOL + Pi]==d) {
+            NNTable[S*NBCOL + Pi].NNindex = intable[k];
+            break;
+          }
+        }
+      }
+
       // --- Put S in intable, maintaining approximate descending order on NNTable[S*NBCOL+NBCOL-1]
       intable.push_back(S);
       for (size_t Tidx = intable.size() - 1; Tidx>=1; --Tidx) {
         const size_t Ti = intable[Tidx];
         const size_t Tiprev = intable[Tidx - 1];
-        if (NNTable[Ti*NBCOL + NBCOL - 1].NNdistance>NNTable[Tiprev*NBCOL + NBCOL - 1].NNdistance) {
+        if (nndist(Ti*NBCOL + NBCOL - 1)>nndist(Tiprev*NBCOL + NBCOL - 1)) {
           std::swap(intable[Ti], intable[Tiprev]);
         }
       }
@@ -116,28 +367,251 @@ namespace tempo::classifier::nn1loocv {
 
     }// End of Table filling
 
+    return NNTable;
+  }
 
-    // --- --- --- NNTable is full: find the param with the fewest error
-    std::vector<size_t> result;
-    size_t bestError = std::numeric_limits<size_t>::max();
-    {
-      for (size_t pidx = 0; pidx<NBCOL; ++pidx) {
-        size_t nError = 0;
-        for (size_t Ti = 0; Ti<NBLINE; Ti++) {
-          if (train_header.label(Ti).value()!=train_header.label(NNTable[Ti*NBCOL + pidx].NNindex).value()) {
-            nError++;
+  Table fill_partable_blocked(
+    distParam_ft distance,
+    distUB_ft distanceUB,
+    distLB_ft distanceLB,
+    size_t nbtrain,
+    size_t nbparams,
+    size_t nbthreads,
+    size_t block_size,
+    std::ostream *out
+  ) {
+    const size_t NBLINE = nbtrain;
+    const size_t NBCOL = nbparams;
+    block_size = std::max<size_t>(block_size, 1);
+    if (!distanceLB) { distanceLB = no_LB; }
+
+    Table NNTable(NBLINE*NBCOL);
+    for (auto& nn : NNTable) {
+      nn.NNindex = NBLINE;
+      nn.NNdistance.store(tempo::utils::PINF, std::memory_order_relaxed);
+    }
+
+    // The blocks of a round being disjoint, the rows of the series of a block are only accessed by its task
+    auto nndist = [&](size_t table_idx) { return NNTable[table_idx].NNdistance.load(std::memory_order_relaxed); };
+    auto update = [&](size_t table_idx, size_t nnindex, F d) {
+      auto& nn = NNTable[table_idx];
+      if (d<nn.NNdistance.load(std::memory_order_relaxed)) {
+        nn.NNindex = nnindex;
+        nn.NNdistance.store(d, std::memory_order_relaxed);
+      }
+    };
+
+    // All the parameters of a pair, by increasing parameter index (see partable)
+    auto sweep = [&](size_t S, size_t T) {
+      const F dmax = std::max(nndist(S*NBCOL + NBCOL - 1), nndist(T*NBCOL + NBCOL - 1));
+      F LB = 0;
+      for (size_t Pi = 0; Pi<NBCOL; ++Pi) {
+        const F d_nn = std::max(nndist(S*NBCOL + Pi), nndist(T*NBCOL + Pi));
+        if (LB<d_nn) {
+          const F lb = distanceLB(S, T, Pi, d_nn);
+          if (lb>=d_nn) { continue; }
+          const F cutoff = std::min(dmax, distanceUB(S, T, Pi));
+          const F d = distance(S, T, Pi, cutoff);
+          update(S*NBCOL + Pi, T, d);
+          update(T*NBCOL + Pi, S, d);
+          if (d==tempo::utils::PINF) { break; }
+          LB = d;
+        }
+      }
+    };
+
+    // --- --- --- Rounds of disjoint blocks, the blocks of a round being computed in parallel
+    const size_t nb_blocks = (NBLINE + block_size - 1)/block_size;
+    const auto rounds = block_rounds(nb_blocks);
+    tempo::utils::ParTasks ptask;
+    for (size_t r = 0; r<rounds.size(); ++r) {
+      auto start = tempo::utils::now();
+      for (auto [bi, bj] : rounds[r]) {
+        ptask.push_task([&, bi, bj]() {
+          const size_t istart = bi*block_size;
+          const size_t istop = std::min(istart + block_size, NBLINE);
+          const size_t jstart = bj*block_size;
+          const size_t jstop = std::min(jstart + block_size, NBLINE);
+          for (size_t S = istart; S<istop; ++S) {
+            for (size_t T = (bi==bj ? S + 1 : jstart); T<jstop; ++T) { sweep(S, T); }
           }
+        });
+      }
+      ptask.execute((int)nbthreads);
+      tempo::utils::duration_t duration = tempo::utils::now() - start;
+      if (out!=nullptr) {
+        std::ostream& o = *out;
+        o << r + 1 << "/" << rounds.size() << " " << tempo::utils::as_string(duration) << std::endl;
+      }
+    }
+
+    return NNTable;
+  }
+
+  } // End of anonymous namespace
+
+  std::vector<std::tuple<std::vector<size_t>, size_t>> partable_multi(
+    distParamMulti_ft distance,
+    distFamilyUB_ft distanceUB,
+    distFamilyLB_ft distanceLB,
+    size_t nbtrain,
+    DatasetHeader const& train_header,
+    size_t nbparams,
+    size_t nbfamilies,
+    size_t nbthreads,
+    size_t block_size,
+    std::ostream *out
+  ) {
+    const size_t NBLINE = nbtrain;
+    const size_t NBCOL = nbparams;
+    const size_t NBFAM = nbfamilies;
+    block_size = std::max<size_t>(block_size, 1);
+    if (!distanceLB) { distanceLB = [](size_t, size_t, size_t, size_t, F) { return tempo::utils::NINF; }; }
+
+    // One table per family
+    std::vector<Table> NNTables;
+    NNTables.reserve(NBFAM);
+    for (size_t f = 0; f<NBFAM; ++f) {
+      Table& table = NNTables.emplace_back(NBLINE*NBCOL);
+      for (auto& nn : table) {
+        nn.NNindex = NBLINE;
+        nn.NNdistance.store(tempo::utils::PINF, std::memory_order_relaxed);
+      }
+    }
+
+    // The blocks of a round being disjoint, the rows of the series of a block are only accessed by its task
+    auto nndist = [&](size_t f, size_t table_idx) {
+      return NNTables[f][table_idx].NNdistance.load(std::memory_order_relaxed);
+    };
+    auto update = [&](size_t f, size_t table_idx, size_t nnindex, F d) {
+      auto& nn = NNTables[f][table_idx];
+      if (d<nn.NNdistance.load(std::memory_order_relaxed)) {
+        nn.NNindex = nnindex;
+        nn.NNdistance.store(d, std::memory_order_relaxed);
+      }
+    };
+
+    // Per family state of the sweep of a pair
+    struct Scratch {
+      std::vector<F> dmax, LB, cutoffs, results;
+      std::vector<char> done;
+    };
+
+    // All the parameters of a pair, by increasing parameter index, for all the families (see partable_blocked).
+    // At each parameter, the families still needing a distance are computed together.
+    auto sweep = [&](size_t S, size_t T, Scratch& sc) {
+      for (size_t f = 0; f<NBFAM; ++f) {
+        sc.dmax[f] = std::max(nndist(f, S*NBCOL + NBCOL - 1), nndist(f, T*NBCOL + NBCOL - 1));
+        sc.LB[f] = 0;
+        sc.done[f] = 0;
+      }
+      size_t nb_done = 0;
+      for (size_t Pi = 0; Pi<NBCOL&&nb_done<NBFAM; ++Pi) {
+        bool any = false;
+        for (size_t f = 0; f<NBFAM; ++f) {
+          sc.cutoffs[f] = tempo::utils::NINF;
+          if (sc.done[f]) { continue; }
+          const F d_nn = std::max(nndist(f, S*NBCOL + Pi), nndist(f, T*NBCOL + Pi));
+          if (sc.LB[f]>=d_nn) { continue; }
+          if (distanceLB(S, T, Pi, f, d_nn)>=d_nn) { continue; }
+          sc.cutoffs[f] = std::min(sc.dmax[f], distanceUB(S, T, Pi, f));
+          any = true;
+        }
+        if (!any) { continue; }
+        distance(S, T, Pi, sc.cutoffs.data(), sc.results.data());
+        for (size_t f = 0; f<NBFAM; ++f) {
+          if (sc.cutoffs[f]<0) { continue; }
+          const F d = sc.results[f];
+          update(f, S*NBCOL + Pi, T, d);
+          update(f, T*NBCOL + Pi, S, d);
+          if (d==tempo::utils::PINF) {
+            sc.done[f] = 1;
+            ++nb_done;
+          } else { sc.LB[f] = d; }
         }
-        //
-        if (nError<bestError) {
-          result.clear();
-          result.push_back(pidx);
-          bestError = nError;
-        } else if (nError==bestError) { result.push_back(pidx); }
+      }
+    };
+
+    // --- --- --- Rounds of disjoint blocks, the blocks of a round being computed in parallel
+    const size_t nb_blocks = (NBLINE + block_size - 1)/block_size;
+    const auto rounds = block_rounds(nb_blocks);
+    tempo::utils::ParTasks ptask;
+    for (size_t r = 0; r<rounds.size(); ++r) {
+      auto start = tempo::utils::now();
+      for (auto [bi, bj] : rounds[r]) {
+        ptask.push_task([&, bi, bj]() {
+          Scratch sc{std::vector<F>(NBFAM), std::vector<F>(NBFAM), std::vector<F>(NBFAM), std::vector<F>(NBFAM),
+                     std::vector<char>(NBFAM)};
+          const size_t istart = bi*block_size;
+          const size_t istop = std::min(istart + block_size, NBLINE);
+          const size_t jstart = bj*block_size;
+          const size_t jstop = std::min(jstart + block_size, NBLINE);
+          for (size_t S = istart; S<istop; ++S) {
+            for (size_t T = (bi==bj ? S + 1 : jstart); T<jstop; ++T) { sweep(S, T, sc); }
+          }
+        });
+      }
+      ptask.execute((int)nbthreads);
+      tempo::utils::duration_t duration = tempo::utils::now() - start;
+      if (out!=nullptr) {
+        std::ostream& o = *out;
+        o << r + 1 << "/" << rounds.size() << " " << tempo::utils::as_string(duration) << std::endl;
       }
     }
 
-    return {result, NBLINE - bestError};
+    std::vector<std::tuple<std::vector<size_t>, size_t>> result;
+    for (size_t f = 0; f<NBFAM; ++f) { result.push_back(best_params(NNTables[f], NBLINE, NBCOL, train_header)); }
+    return result;
+  }
+
+  void partable(
+    LOOCV_DTW_CFES& instance,
+    size_t nbtrain, // May be smaller than train_header.size() for a subset
+    DatasetHeader const& train_header,
+    size_t nbtest,  // May be smaller than test_header.size() for a subset
+    DatasetHeader const& test_header,
+    PRNG& prng,
+    size_t nbthreads,
+    size_t block_size,
+    std::ostream *out
+  ) {
+    constexpr size_t K = LOOCV_DTW_CFES::nb_cfes;
+
+    // --- --- --- LOOCV process, the exponents in one sweep
+    {
+      auto start = tempo::utils::now();
+      auto results = partable_multi(
+        [&instance](size_t i1, size_t i2, size_t p, F const *cutoffs, F *res) {
+          instance.distance_param(i1, i2, p, cutoffs, res);
+        },
+        [&instance](size_t i1, size_t i2, size_t p, size_t k) { return instance.distance_UB(i1, i2, p, k); },
+        [&instance](size_t i1, size_t i2, size_t p, size_t k, F bsf) {
+          return instance.distance_LB(i1, i2, p, k, bsf);
+        },
+        nbtrain, train_header, instance.nb_params(), K, nbthreads, block_size, out
+      );
+      tempo::utils::duration_t loocv_time = tempo::utils::now() - start;
+
+      // Write result: the time of the sweep is shared by the exponents
+      for (size_t k = 0; k<K; ++k) {
+        auto& [loocv_params, loocv_nbcorrect] = results[k];
+        result_LOOCVDist result_train{};
+        result_train.size = nbtrain;
+        result_train.nb_correct = loocv_nbcorrect;
+        result_train.accuracy = (double)loocv_nbcorrect/(double)nbtrain;
+        result_train.time = loocv_time;
+        instance.result_train[k] = result_train;
+        instance.set_loocv_result(k, loocv_params);
+      }
+    }
+
+    // --- --- --- Test parameterizations
+    for (size_t k = 0; k<K; ++k) {
+      distTest_ft distanceTest = [&instance, k](size_t test_idx, size_t train_idx, F bsf) {
+        return instance.distance_test(k, test_idx, train_idx, bsf);
+      };
+      instance.result_test[k] = nn1_test(distanceTest, train_header, nbtest, test_header, prng, nbthreads, out);
+    }
   }
 
   void partable(
@@ -148,6 +622,7 @@ namespace tempo::classifier::nn1loocv {
     DatasetHeader const& test_header,
     PRNG& prng,
     size_t nbthreads,
+    size_t block_size,
     std::ostream *out
   ) {
 
@@ -160,6 +635,10 @@ namespace tempo::classifier::nn1loocv {
       return instance.distance_UB(train_idx1, train_idx2, param_idx);
     };
 
+    distLB_ft distanceLB = [&instance](size_t train_idx1, size_t train_idx2, size_t param_idx, F bsf) {
+      return instance.distance_LB(train_idx1, train_idx2, param_idx, bsf);
+    };
+
     distTest_ft distanceTest = [&instance](size_t train_idx1, size_t train_idx2, F bsf) {
       return instance.distance_test(train_idx1, train_idx2, bsf);
     };
@@ -167,8 +646,11 @@ namespace tempo::classifier::nn1loocv {
     // --- --- --- LOOCV process
     {
       auto start = tempo::utils::now();
-      auto [loocv_params, loocv_nbcorrect] =
-        partable(distance, distanceUB, nbtrain, train_header, instance.nb_params, nbthreads, out);
+      auto [loocv_params, loocv_nbcorrect] = (block_size==0)
+        ? partable(distance, distanceUB, distanceLB, nbtrain, train_header, instance.nb_params, nbthreads, out)
+        : partable_blocked(
+          distance, distanceUB, distanceLB, nbtrain, train_header, instance.nb_params, nbthreads, block_size, out
+        );
       tempo::utils::duration_t loocv_time = tempo::utils::now() - start;
 
       // Write result
@@ -182,59 +664,7 @@ namespace tempo::classifier::nn1loocv {
     }
 
     // --- --- --- Test parameterization
-    {
-      const size_t train_size = train_header.size();
-      const size_t test_size = test_header.size();
-      size_t test_nb_correct = 0;
-
-      // --- Progress reporting
-      tempo::utils::ProgressMonitor pm(test_size);    // How many to do, both train and test accuracy
-      size_t nb_done = 0;                             // How many done up to "now"
-
-      // --- Multithreading control
-      tempo::utils::ParTasks ptasks;
-      std::mutex mutex;
-
-      // --- NN1 test task with tie management
-      auto nn1_test_task = [&](size_t test_idx) mutable {
-        double bsf = tempo::utils::PINF;
-        std::set<tempo::EL> labels{};       // manage ties
-        for (size_t train_idx{0}; train_idx<train_size; train_idx++) {
-          double d = distanceTest(test_idx, train_idx, bsf);
-          if (d<bsf) { // Best: clear labels and insert new
-            labels.clear();
-            labels.insert(train_header.label(train_idx).value());
-            bsf = d;
-          } else if (d==bsf) { // Same: add label in
-            labels.insert(train_header.label(train_idx).value());
-          }
-        }
-        // --- Update accuracy
-        {
-          std::lock_guard lock(mutex);
-          tempo::EL result = -1;
-          std::sample(labels.begin(), labels.end(), &result, 1, prng);
-          assert(result<train_header.nb_classes());
-          if (result==test_header.label(test_idx).value()) { ++test_nb_correct; }
-          nb_done++;
-          pm.print_progress(out, nb_done);
-        }
-      };
-
-      // --- Create the tasks per tree. Note that we clone the state.
-      tempo::utils::ParTasks p;
-      auto test_start = tempo::utils::now();
-      p.execute(nbthreads, nn1_test_task, 0, test_size, 1);
-      tempo::utils::duration_t test_time = tempo::utils::now() - test_start;
-
-      // --- Write result
-      result_LOOCVDist result_test{};
-      result_test.size = nbtest;
-      result_test.nb_correct = test_nb_correct;
-      result_test.accuracy = (double)test_nb_correct/(double)nbtest;
-      result_test.time = test_time;
-      instance.result_test = result_test;
-    }
+    instance.result_test = nn1_test(distanceTest, train_header, nbtest, test_header, prng, nbthreads, out);
 
   } // End of function partable
 
@@ -4,20 +4,27 @@
 
 #include <tempo/dataset/dts.hpp>
 
+#include <atomic>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 namespace tempo::classifier::nn1loocv {
 
   /// Nearest Neighbour Cell
-  /// A cell of our table, with its own mutex
+  /// A cell of our table. The distance is updated concurrently with a lock-free compare-and-swap (see partable);
+  /// the index is only written by one thread at a time.
   struct NNC {
-    std::mutex mutex{};   // Lock/unlock for multithreading
-    size_t NNindex{};     // Index of the NN
-    F NNdistance{};       // Distance to the NN
+    std::atomic<F> NNdistance{};  // Distance to the NN
+    size_t NNindex{};             // Index of the NN
   };
 
   /// Search for the best parameter through LOOCV
   /// @param distance A distance computation function of type 'dist_fb'.
   ///     Must capture the series, the actual distance, and the parameters, so that it can be called with indexes.
   /// @param distanceUB Simular as above, of type 'distUB_fb', producing an upper bound.
+  /// @param distanceLB Simular as above, of type 'distLB_fb', producing a lower bound: the pairs with a lower bound
+  ///     above their NN distances are skipped. May be empty (no lower bound).
   /// @param nbtrain Number of train exemplars: the distances will be call with distance(i, j, p) with
   ///     0<=i<nbtrain, 0<=j<nbtrain, i!=j, and p a parameter index
   /// @param nbparams Number of parameters
@@ -32,15 +39,95 @@ namespace tempo::classifier::nn1loocv {
   ///
   ///     Example with ADTW: adtw(a, b, SMALL PENALTY) <= dist(a, b, LARGE PENALTY)
   ///     Hence, the penalties must be ordered in increasing parameter order, i.e. p[0]  =<  p[1]
-  /// @param nbthreads parallelize the process on nbthreads -
-  ///     Note that if nbthreads<2, this is not the best method as we spend time taking/realising mutexes!
+  /// @param nbthreads parallelize the process on nbthreads.
+  ///     The NN distances do not depend on nbthreads; among series at the same distance, the NN index may.
   /// @return (vector of best parameters' index, bestError)
   std::tuple<std::vector<size_t>, size_t> partable(
     distParam_ft distance,
     distUB_ft distanceUB,
+    distLB_ft distanceLB,
+    size_t nbtrain,
+    DatasetHeader const& train_header,
+    size_t nbparams,
+    size_t nbthreads,
+    std::ostream *out = nullptr
+  );
+
+  /// Nearest Neighbour of a series at a parameter: (distance, index)
+  using NNCell = std::pair<F, size_t>;
+
+  /// Table computed by partable, row major: nbtrain rows of nbparams cells
+  std::vector<NNCell> partable_table(
+    distParam_ft distance,
+    distUB_ft distanceUB,
+    distLB_ft distanceLB,
+    size_t nbtrain,
+    size_t nbparams,
+    size_t nbthreads
+  );
+
+  /// Same search as partable, with a cache blocked schedule of the pairs of train exemplars.
+  /// The pairs are tiled into blocks of block_size x block_size series; a block computes all the parameters of its
+  /// pairs in a row, while their series are in cache. The blocks are scheduled in rounds (round robin tournament) in
+  /// which no two blocks share a series: the blocks of a round run in parallel without any synchronisation on the
+  /// table, and the result does not depend on nbthreads.
+  /// A good block_size keeps 2*block_size series in the L2 cache (e.g. 64).
+  std::tuple<std::vector<size_t>, size_t> partable_blocked(
+    distParam_ft distance,
+    distUB_ft distanceUB,
+    distLB_ft distanceLB,
+    size_t nbtrain,
+    DatasetHeader const& train_header,
+    size_t nbparams,
+    size_t nbthreads,
+    size_t block_size,
+    std::ostream *out = nullptr
+  );
+
+  /// Table computed by partable_blocked, row major: nbtrain rows of nbparams cells
+  std::vector<NNCell> partable_blocked_table(
+    distParam_ft distance,
+    distUB_ft distanceUB,
+    distLB_ft distanceLB,
+    size_t nbtrain,
+    size_t nbparams,
+    size_t nbthreads,
+    size_t block_size
+  );
+
+  /// Same search as partable_blocked for 'nbfamilies' families of distances sharing their parameters, with one table
+  /// per family. The distances of a pair at a parameter are computed at once for all the families still needing them
+  /// (see distParamMulti_ft), e.g. the DTW under several cost function exponents sharing the costs |a-b|.
+  /// The order of the parameters must hold within each family (see partable).
+  /// @param distanceLB May be empty (no lower bound).
+  /// @return per family, (vector of best parameters' index, number of correct)
+  std::vector<std::tuple<std::vector<size_t>, size_t>> partable_multi(
+    distParamMulti_ft distance,
+    distFamilyUB_ft distanceUB,
+    distFamilyLB_ft distanceLB,
+    size_t nbtrain,
     DatasetHeader const& train_header,
     size_t nbparams,
+    size_t nbfamilies,
+    size_t nbthreads,
+    size_t block_size,
+    std::ostream *out = nullptr
+  );
+
+  struct LOOCV_DTW_CFES;
+
+  /// Given a LOOCV_DTW_CFES, search for the best window of each cost function exponent in one sweep
+  /// (see partable_multi), and test them.
+  /// Note: set the results on the incoming instance
+  void partable(
+    LOOCV_DTW_CFES& instance,
+    size_t nbtrain, // May be smaller than train_header.size() for a subset
+    DatasetHeader const& train_header,
+    size_t nbtest,  // May be smaller than test_header.size() for a subset
+    DatasetHeader const& test_header,
+    PRNG& prng,
     size_t nbthreads,
+    size_t block_size = 64,
     std::ostream *out = nullptr
   );
 
@@ -54,6 +141,7 @@ namespace tempo::classifier::nn1loocv {
     DatasetHeader const& test_header,
     PRNG& prng,
     size_t nbthreads,
+    size_t block_size = 0, // 0: incremental search (partable), else cache blocked search (partable_blocked)
     std::ostream *out = nullptr
   );
 
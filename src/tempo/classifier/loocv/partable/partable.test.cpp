@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "partable.hpp"
+#include "dist_dtw.hpp"
+
+#include <tempo/distance/tseries.univariate.hpp>
+
+#include <mock/mockseries.hpp>
+
+#include <vector>
+
+using namespace tempo;
+using namespace tempo::classifier::nn1loocv;
+namespace tdu = tempo::distance::univariate;
+
+namespace {
+
+  constexpr size_t nbtrain = 50;
+  constexpr size_t length = 30;
+  constexpr F cfe = 2.0;
+  constexpr F PINF = tempo::utils::PINF;
+
+  /// Dataset of random univariate series: no two pairs at the same distance
+  DTS mk_dts() {
+    mock::Mocker<F> mocker(0);
+    mocker._fixl = length;
+    std::vector<TSeries> series;
+    std::vector<std::optional<std::string>> labels;
+    for (size_t i = 0; i<nbtrain; ++i) {
+      series.push_back(TSeries::mk_from_rowmajor(mocker.randvec(), 1, {"0"}, false));
+      labels.emplace_back(std::to_string(i%3));
+    }
+    auto header = std::make_shared<DatasetHeader>("mock", length, length, 1, std::move(labels), std::vector<size_t>{});
+    auto transform = std::make_shared<DatasetTransform<TSeries>>(header, "default", std::move(series));
+    return DTS("mock", transform);
+  }
+
+  /// LOOCV table by brute force: all the pairs, without bound
+  std::vector<NNCell> brute_force(DTS const& train, std::vector<size_t> const& windows) {
+    const size_t nbparams = windows.size();
+    std::vector<NNCell> table(nbtrain*nbparams, {PINF, nbtrain});
+    for (size_t i = 0; i<nbtrain; ++i) {
+      for (size_t p = 0; p<nbparams; ++p) {
+        for (size_t j = 0; j<nbtrain; ++j) {
+          if (j==i) { continue; }
+          const F d = tdu::dtw(train[i], train[j], cfe, windows[p], PINF);
+          if (d<table[i*nbparams + p].first) { table[i*nbparams + p] = {d, j}; }
+        }
+      }
+    }
+    return table;
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// Without ties, the tables of the LOOCV searches are the one of the brute force, whatever the threads and blocks.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("LOOCV table", "[partable]") {
+  const DTS train = mk_dts();
+  // The distances, bounds and warping cache of the DTW LOOCV, windows sorted by decreasing value
+  LOOCV_DTW loocv(train, train, cfe, {0, 1, 2, 3, 5, 8, 13, length});
+  const size_t nbparams = loocv.windows.size();
+  const std::vector<NNCell> expected = brute_force(train, loocv.windows);
+
+  distParam_ft distance = [&](size_t i, size_t j, size_t p, F bsf) { return loocv.distance_param(i, j, p, bsf); };
+  distUB_ft distanceUB = [&](size_t i, size_t j, size_t p) { return loocv.distance_UB(i, j, p); };
+  distLB_ft distanceLB = [&](size_t i, size_t j, size_t p, F bsf) { return loocv.distance_LB(i, j, p, bsf); };
+
+  SECTION("partable, 1 and N threads") {
+    for (auto const& lb : {distLB_ft{}, distanceLB}) {
+      const std::vector<NNCell> sequential = partable_table(distance, distanceUB, lb, nbtrain, nbparams, 1);
+      REQUIRE(sequential==expected);
+      for (const size_t nbt : {2, 4, 7}) {
+        REQUIRE(partable_table(distance, distanceUB, lb, nbtrain, nbparams, nbt)==sequential);
+      }
+    }
+  }
+
+  SECTION("partable_blocked, brute force") {
+    for (auto const& lb : {distLB_ft{}, distanceLB}) {
+      for (const size_t block_size : {1, 7, 64}) {
+        for (const size_t nbt : {1, 3}) {
+          REQUIRE(partable_blocked_table(distance, distanceUB, lb, nbtrain, nbparams, nbt, block_size)==expected);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <tempo/classifier/classifier.hpp>
+#include <tempo/classifier/ProximityForest2/pf2.hpp>
+#include <tempo/classifier/PF2018/pf2018.hpp>
+
+namespace tempo::classifier {
+
+  /// Splitters of the "tschief" configuration: the Elastic Ensemble distances of the TS-CHIEF similarity splitters,
+  /// then its dictionary (BOSS) and interval (RISE) splitters
+  inline const std::string tschief_distances{"DA:DTWFull:DTW:WDTW:ERP:LCSS:MSM:TWE:BOSS:RISE"};
+
+  /** Build the classifier of configuration 'name', trained on 'train_dataset' (see i_Classifier):
+   *   * "pf2": ProximityForest2
+   *   * "pf2018": Proximity Forest 1.0 (see PF2018)
+   *   * "tschief": TS-CHIEF (Shifaz et al., 2020), as a ProximityForest2 drawing its similarity splitters among
+   *     tschief_distances with its transforms and exponents, and its BOSS and RISE splitters on the default
+   *     transform (see pf::splitters::make_node_splitter). Univariate only.
+   *   * distance names separated by ':', e.g. "DTW:MSM" (see pf::splitters::make_node_splitter)
+   *  Tokens not naming a distance are ignored (see pf::splitters::compile_distances). The classifier keeps references
+   *  on its arguments.
+   */
+  inline std::unique_ptr<i_Classifier> make_classifier(
+    std::string const& name,
+    DTS const& train_dataset,
+    DatasetHeader const& train_header,
+    size_t nb_candidates,
+    size_t nb_trees,
+    TSChief::TreeState& tstate
+  ) {
+    if (name=="pf2018") {
+      return std::make_unique<PF2018>(train_dataset, train_header, nb_candidates, nb_trees, tstate);
+    }
+    const std::string& configuration = name=="tschief" ? tschief_distances : name;
+    return std::make_unique<ProximityForest2>(train_dataset, train_header, nb_candidates, nb_trees, tstate,
+                                              configuration);
+  }
+
+} // End of namespace tempo::classifier
@@ -51,6 +51,15 @@ namespace tempo::classifier {
       return Result1(std::move(p), total);
     }
 
+    /// Create a Result from the number of exemplars per class 'counts', with smooth cardinality:
+    /// count 'one' for each class, add the counts (see make_smooth_probabilities, with all the classes counted)
+    static inline Result1 make_smooth_distribution(arma::rowvec const& counts) {
+      arma::rowvec p = counts + 1.0;
+      double total = arma::accu(p);
+      p = p/total;
+      return Result1(std::move(p), total);
+    }
+
     /// Obtain the classes with the max probability
     inline std::tuple<std::vector<EL>, double> most_probable_classes(){
       double maxv = probabilities.max();
@@ -84,6 +93,20 @@ namespace tempo::classifier {
 
     ResultN& operator =(ResultN&&) = default;
 
+    /// Preallocated result for 'nb_exemplars' test exemplars over 'nb_classes' classes, with null rows:
+    /// fill it with set_row, rather than growing it with append.
+    inline ResultN(size_t nb_exemplars, size_t nb_classes) :
+      probabilities(nb_exemplars, nb_classes, arma::fill::zeros),
+      weight(nb_exemplars, arma::fill::zeros) {}
+
+    /// Set the row 'i' (must be within the preallocated rows, and have as many classes).
+    /// Writes to distinct rows do not share memory: they can be done concurrently from several threads.
+    inline void set_row(size_t i, Result1 const& res1) {
+      probabilities.row(i) = res1.probabilities;
+      weight[i] = res1.weight;
+    }
+
+    /// Append a row: copies the whole matrix, prefer a preallocated result (see set_row) when the size is known.
     inline void append(Result1 const& res1) {
       size_t n_rows = probabilities.n_rows;
       probabilities.insert_rows(n_rows, res1.probabilities);
@@ -56,6 +56,9 @@ namespace tempo {
     /// Series with missing data
     std::vector<size_t> _missing{};
 
+    /// Number of instances without label
+    size_t _nb_unlabelled{0};
+
     /// Label Encoder
     LabelEncoder _label_encoder;
 
@@ -89,7 +92,7 @@ namespace tempo {
       // Build the set and the encoder
       std::set<L> labelset;
       for (std::optional<L> const& ol : _labels) {
-        if (ol) { labelset.insert(ol.value()); }
+        if (ol) { labelset.insert(ol.value()); } else { ++_nb_unlabelled; }
       }
       // Build a new encoder
       _label_encoder = LabelEncoder(std::move(encoder), labelset);
@@ -129,6 +132,9 @@ namespace tempo {
     // --- --- --- --- --- ---
     // Label access
 
+    /// Number of instances without label
+    inline size_t nb_unlabelled() const { return _nb_unlabelled; }
+
     /// Access the original label of an instance
     inline std::optional<L> const& original_label(size_t idx) const { return _labels[idx]; }
 
@@ -226,19 +232,26 @@ namespace tempo {
     /// New transform resulting of applying a transform function per series
     template<typename R>
     DatasetTransform<R> map(typename std::function<R(T const& in)> fun, std::string n) const {
-      std::vector<R> new_storage;
-      new_storage.reserve(_storage.size());
-      for (const T& item : _storage) { new_storage.emplace_back(fun(item)); }
-      return DatasetTransform<R>(*this, std::move(n), std::move(new_storage));
+      return DatasetTransform<R>(*this, std::move(n), map_storage<R>(fun));
     }
 
     /// New transform resulting of applying a transform function per series
     template<typename R>
     std::shared_ptr<DatasetTransform<R>> map_shptr(typename std::function<R(T const& in)> fun, std::string n) const {
+      return std::make_shared<DatasetTransform<R>>(*this, std::move(n), map_storage<R>(fun));
+    }
+
+  private:
+
+    /// Apply 'fun' per series. If R provides a 'compact_storage(std::vector<R>&)' (found by ADL, see TSeries),
+    /// the new storage is compacted with it.
+    template<typename R>
+    std::vector<R> map_storage(typename std::function<R(T const& in)> const& fun) const {
       std::vector<R> new_storage;
       new_storage.reserve(_storage.size());
       for (const T& item : _storage) { new_storage.emplace_back(fun(item)); }
-      return std::make_shared<DatasetTransform<R>>(*this, std::move(n), std::move(new_storage));
+      if constexpr (requires { compact_storage(new_storage); }) { compact_storage(new_storage); }
+      return new_storage;
     }
   };
 
@@ -332,6 +345,8 @@ namespace tempo {
     size_t _size{0};
     std::map<EL, size_t> _map_index;
     std::set<EL> _classes;
+    /// All the indexes, sorted, when known at construction (see to_IndexSet)
+    std::optional<IndexSet> _flat{};
 
     /// Populate _indexes, _map_index and _classes
     inline void populate_indexes() {
@@ -357,6 +372,13 @@ namespace tempo {
     /// The map is then used as provided.
     inline explicit ByClassMap(BCM_t&& bcm) : _bcm(std::move(bcm)) { populate_indexes(); }
 
+    /// Constructor taking ownership of a map<std::string, IndexSet> and of the IndexSet 'flat' of all its indexes,
+    /// sorted (low to high), then returned by to_IndexSet.
+    inline ByClassMap(BCM_t&& bcm, IndexSet flat) : _bcm(std::move(bcm)), _flat(std::move(flat)) {
+      populate_indexes();
+      assert(_flat->size()==_size);
+    }
+
     /// Constructor taking ownership of a map of <std::string, std::vector<size_t>>
     /// The vectors represent sets of index, and must be sorted (low to high)
     inline explicit ByClassMap(BCMvec_t&& bcm) {
@@ -456,24 +478,46 @@ namespace tempo {
     /// for the n labels present in this BCM
     inline const std::map<EL, size_t>& labels_to_index() const { return _map_index; }
 
-    /// Convert this BCM into an IndexSet
+    /// Convert this BCM into a sorted IndexSet.
+    /// Shares the flat IndexSet given at construction if any. Else, the classes are concatenated, and merged if they
+    /// are all sorted (O(n log(nb classes))), else sorted.
     inline IndexSet to_IndexSet() const {
-      // Reserve size for our vector, then, copy from BCM, sort, and build a new IndexSet
+      if (_flat) { return _flat.value(); }
       std::vector<size_t> v;
       v.reserve(size());
-      for (const auto& [_, is] : *this) { v.insert(v.end(), is.begin(), is.end()); }
-      std::sort(v.begin(), v.end());
+      std::vector<size_t> bounds{0};   // Class k is in [bounds[k], bounds[k+1][
+      bool sorted = true;
+      for (const auto& [_, is] : *this) {
+        v.insert(v.end(), is.begin(), is.end());
+        bounds.push_back(v.size());
+        sorted = sorted&&std::is_sorted(is.begin(), is.end());
+      }
+      if (!sorted) { std::sort(v.begin(), v.end()); }
+      else {
+        // Bottom-up merge of the classes, doubling the width of the merged runs at each pass
+        const size_t nb_runs = bounds.size() - 1;
+        for (size_t width = 1; width<nb_runs; width *= 2) {
+          for (size_t k = 0; k + width<nb_runs; k += 2*width) {
+            const size_t stop = std::min(k + 2*width, nb_runs);
+            std::inplace_merge(v.begin() + (long)bounds[k], v.begin() + (long)bounds[k + width],
+                               v.begin() + (long)bounds[stop]);
+          }
+        }
+      }
       return IndexSet(std::move(v));
     }
 
-    /// Stratified sampling
-    ByClassMap stratified_sampling(const double ratio, PRNG& prng) const {
+    /// Stratified sampling: draw ceil(ratio*size) indexes per class (at least one), without replacement up to the
+    /// size of the class. With 'max_per_class', at most max(1, max_per_class) indexes are drawn per class.
+    ByClassMap stratified_sampling(const double ratio, PRNG& prng,
+                                   std::optional<size_t> max_per_class = std::nullopt) const {
       BCM_t result;
       for (const auto& [label, is] : _bcm) {
         // ---
         auto const& isv = is.vector();
         const size_t isv_size = isv.size();
         size_t nb = std::ceil(ratio*(double)isv_size); // Up rounding, ensure we have at least one item...
+        if (max_per_class) { nb = std::min(nb, std::max<size_t>(1, max_per_class.value())); }
         // ---
         std::vector<size_t> idx{};
         // ---
@@ -502,6 +546,141 @@ namespace tempo {
       }
       return ByClassMap(std::move(result));
     }
+
+    /// Stratified draw without replacement: min(nb, size) indexes of each class given by 'nb_per_class'.
+    /// The other classes are not drawn. The drawn indexes are sorted (low to high) per class.
+    ByClassMap stratified_draw(std::map<EL, size_t> const& nb_per_class, PRNG& prng) const {
+      BCMvec_t result;
+      for (const auto& [label, is] : _bcm) {
+        auto it = nb_per_class.find(label);
+        if (it==nb_per_class.end()||it->second==0) { continue; }
+        std::vector<size_t> idx = is.vector();
+        std::shuffle(idx.begin(), idx.end(), prng);
+        idx.resize(std::min(it->second, idx.size()));
+        std::sort(idx.begin(), idx.end());
+        result[label] = std::move(idx);
+      }
+      return ByClassMap(std::move(result));
+    }
+  };
+
+  /** Flat ByClassMap: the indexes of a BCM in a single array, partitioned by class, with an offset table.
+   *  The indexes of the class at position c (in increasing label order) are in [offset(c), offset(c+1)[.
+   *  A class may have no index. Indexes must fit on 32 bits.
+   *  Used to build the BCMs of large nodes without allocating per class (see partition).
+   */
+  class FlatBCM {
+    std::vector<EL> _labels{};
+    std::vector<size_t> _offsets{0};
+    std::vector<uint32_t> _indexes{};
+    /// All the indexes, sorted, when known from the partition (see partition and to_BCM)
+    std::vector<uint32_t> _sorted{};
+
+    static uint32_t check_index(size_t idx) {
+      if (idx>std::numeric_limits<uint32_t>::max()) { throw std::overflow_error("FlatBCM: index over 32 bits"); }
+      return (uint32_t)idx;
+    }
+
+  public:
+
+    FlatBCM() = default;
+
+    /// Flatten a BCM
+    explicit FlatBCM(ByClassMap const& bcm) {
+      _labels.reserve(bcm.nb_classes());
+      _offsets.reserve(bcm.nb_classes() + 1);
+      _indexes.reserve(bcm.size());
+      for (const auto& [label, is] : bcm) {
+        _labels.push_back(label);
+        for (size_t idx : is) { _indexes.push_back(check_index(idx)); }
+        _offsets.push_back(_indexes.size());
+      }
+    }
+
+    /** Partition 'indexes' in 'nb_parts' flat BCMs over the classes 'labels' (in increasing order), with a counting
+     *  sort: indexes[i] goes in the part parts[i], in the class at position classes[i] in 'labels'.
+     *  Indexes keep their relative order within a class: sorted indexes give sorted classes. Sorted indexes also
+     *  give each part its sorted flat index set, passed on to the BCM built by to_BCM (see ByClassMap::to_IndexSet).
+     */
+    static std::vector<FlatBCM> partition(std::vector<EL> const& labels, size_t nb_parts,
+                                          std::vector<uint32_t> const& indexes,
+                                          std::vector<uint32_t> const& classes,
+                                          std::vector<uint32_t> const& parts) {
+      assert(indexes.size()==classes.size()&&indexes.size()==parts.size());
+      const size_t nb_classes = labels.size();
+      std::vector<FlatBCM> result(nb_parts);
+      std::vector<size_t> cursor(nb_parts*nb_classes, 0);
+      for (size_t i = 0; i<indexes.size(); ++i) { ++cursor[parts[i]*nb_classes + classes[i]]; }
+      for (size_t p = 0; p<nb_parts; ++p) {
+        FlatBCM& f = result[p];
+        f._labels = labels;
+        f._offsets.resize(nb_classes + 1);
+        for (size_t c = 0; c<nb_classes; ++c) {
+          size_t& cell = cursor[p*nb_classes + c];
+          f._offsets[c + 1] = f._offsets[c] + cell;
+          cell = f._offsets[c];
+        }
+        f._indexes.resize(f._offsets[nb_classes]);
+      }
+      for (size_t i = 0; i<indexes.size(); ++i) {
+        result[parts[i]]._indexes[cursor[parts[i]*nb_classes + classes[i]]++] = indexes[i];
+      }
+      if (std::is_sorted(indexes.begin(), indexes.end())) {
+        for (FlatBCM& f : result) { f._sorted.reserve(f.size()); }
+        for (size_t i = 0; i<indexes.size(); ++i) { result[parts[i]]._sorted.push_back(indexes[i]); }
+      }
+      return result;
+    }
+
+    /// Number of indexes contained
+    inline size_t size() const { return _indexes.size(); }
+
+    /// Check if no index is contained
+    inline bool empty() const { return _indexes.empty(); }
+
+    /// Number of classes, including the classes without index
+    inline size_t nb_classes() const { return _labels.size(); }
+
+    /// Label of the class at position c
+    inline EL label(size_t c) const { return _labels[c]; }
+
+    /// Offset of the class at position c in 'indexes'; offset(nb_classes()) is size()
+    inline size_t offset(size_t c) const { return _offsets[c]; }
+
+    /// Number of indexes of the class at position c
+    inline size_t class_size(size_t c) const { return _offsets[c + 1] - _offsets[c]; }
+
+    /// All the indexes, partitioned by class
+    inline const std::vector<uint32_t>& indexes() const { return _indexes; }
+
+    /// Gini impurity, as ByClassMap::gini_impurity
+    inline double gini_impurity() const {
+      if (size()<=1) { return 0; }
+      const auto total_size = (double)size();
+      double sum{0};
+      for (size_t c = 0; c<nb_classes(); ++c) {
+        double p = (double)class_size(c)/total_size;
+        sum += p*p;
+      }
+      return 1 - sum;
+    }
+
+    /// Convert into a ByClassMap, with one exactly sized IndexSet per class with indexes.
+    /// Classes without index are dropped: if no class has an index, the BCM maps 'empty_label' to an empty set.
+    inline ByClassMap to_BCM(EL empty_label) const {
+      ByClassMap::BCM_t bcm;
+      for (size_t c = 0; c<nb_classes(); ++c) {
+        if (class_size(c)>0) {
+          bcm.emplace(_labels[c], IndexSet(std::vector<size_t>(_indexes.begin() + (long)_offsets[c],
+                                                               _indexes.begin() + (long)_offsets[c + 1])));
+        }
+      }
+      if (bcm.empty()) { bcm.emplace(empty_label, IndexSet(std::vector<size_t>{})); }
+      if (_sorted.size()==size()) {
+        return ByClassMap(std::move(bcm), IndexSet(std::vector<size_t>(_sorted.begin(), _sorted.end())));
+      }
+      return ByClassMap(std::move(bcm));
+    }
   };
 
   /// Manage a split: a combination of a dataset header with some stored data (transform) agreeing on their indexes,
@@ -639,8 +818,16 @@ namespace tempo {
     // --- --- --- --- --- ---
     // BCM helper
 
+    /// BCM of the split, indexing the split (i.e. in [0, size()[, as 'operator[]'), and the indexes without label
     inline std::tuple<ByClassMap, std::vector<size_t>> get_BCM() const {
-      return ByClassMap::make(header(), _index_set);
+      typename ByClassMap::BCMvec_t m;
+      std::vector<size_t> v;
+      for (size_t i = 0; i<size(); ++i) {
+        const auto& olabel = label(i);
+        if (olabel.has_value()) { m[olabel.value()].push_back(i); }
+        else { v.push_back(i); }
+      }
+      return {ByClassMap(std::move(m)), std::move(v)};
     }
 
   }; // End of DataSplit
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include <tempo/utils/utils.hpp>
 #include "tseries.hpp"
 #include "dataset.hpp"
@@ -12,6 +14,108 @@ namespace tempo {
   /// Map of named DTS
   using DTSMap = std::map<std::string, DTS>;
 
+  /// Per series, per dimension accumulated values of a DTS.
+  /// Allows to compute statistics over any subset by going over the series of the subset, instead of their points.
+  /// Each series is summarised by its mean and sum of squared differences to the mean per dimension,
+  /// which are then combined (Chan et al.) - avoiding the cancellation of the naive sum/sum of squares formula.
+  struct DTS_Sums {
+    /// Number of points, per series
+    std::vector<size_t> _count;
+    /// Mean per dimension, one column per series
+    arma::Mat<double> _mean;
+    /// Sum of squared differences to the mean per dimension, one column per series
+    arma::Mat<double> _m2;
+    /// Minimum and maximum per dimension, one column per series
+    arma::Mat<F> _min;
+    arma::Mat<F> _max;
+
+    /// Summarise the series of 'subset' only, the other ones being left empty (no point).
+    /// The series are independent: they are summarised in parallel on 'nb_threads'.
+    DTS_Sums(const DTS& dts, const IndexSet& subset, size_t nb_threads = 1) {
+      const size_t nbdim = dts.size()>0 ? dts[0].nb_dimensions() : 1;
+      _count.assign(dts.size(), 0);
+      _mean.zeros(nbdim, dts.size());
+      _m2.zeros(nbdim, dts.size());
+      _min.zeros(nbdim, dts.size());
+      _max.zeros(nbdim, dts.size());
+      // Chunks of series, written by one task
+      constexpr size_t CHUNK = 64;
+      const std::vector<size_t>& indexes = subset.vector();
+      utils::ParTasks ptasks;
+      for (size_t start = 0; start<indexes.size(); start += CHUNK) {
+        ptasks.push_task([this, &dts, &indexes, nbdim, start]() {
+          const size_t stop = std::min(start + CHUNK, indexes.size());
+          for (size_t k = start; k<stop; ++k) { summarise(dts[indexes[k]], indexes[k], nbdim); }
+        });
+      }
+      ptasks.execute((int)nb_threads);
+    }
+
+    /// Summarise all the series of the DTS
+    explicit DTS_Sums(const DTS& dts, size_t nb_threads = 1) : DTS_Sums(dts, IndexSet(dts.size()), nb_threads) {}
+
+    /// Merge the summaries of a subset into the per dimension number of points 'n', 'mean', sum of squared
+    /// differences to the mean 'm2', 'min' and 'max'. O(|subset|).
+    void merge(const IndexSet& subset, size_t& n, arma::Col<double>& mean, arma::Col<double>& m2,
+               arma::Col<F>& min, arma::Col<F>& max) const {
+      const size_t nbdim = _mean.n_rows;
+      mean.zeros(nbdim);
+      m2.zeros(nbdim);
+      min.zeros(nbdim);
+      max.zeros(nbdim);
+      n = 0;
+      for (const auto i : subset) {
+        const size_t ni = _count[i];
+        if (ni==0) { continue; }
+        const size_t nn = n + ni;
+        for (size_t d = 0; d<nbdim; ++d) {
+          const double delta = _mean(d, i) - mean[d];
+          mean[d] += delta*(double)ni/(double)nn;
+          m2[d] += _m2(d, i) + delta*delta*(double)n*(double)ni/(double)nn;
+          min[d] = n==0 ? _min(d, i) : std::min(min[d], _min(d, i));
+          max[d] = n==0 ? _max(d, i) : std::max(max[d], _max(d, i));
+        }
+        n = nn;
+      }
+    }
+
+    /// Standard deviation per dimension over a subset. Normalisation using N-1, as DTS_Stats.
+    arma::Col<F> stddev(const IndexSet& subset) const {
+      size_t n;
+      arma::Col<double> mean;
+      arma::Col<double> m2;
+      arma::Col<F> min;
+      arma::Col<F> max;
+      merge(subset, n, mean, m2, min, max);
+      return stddev(n, m2);
+    }
+
+    /// Standard deviation from a number of points and sums of squared differences to the mean (see merge)
+    static arma::Col<F> stddev(size_t n, arma::Col<double> const& m2) {
+      arma::Col<F> result(m2.n_rows, arma::fill::zeros);
+      if (n>1) { for (size_t d = 0; d<m2.n_rows; ++d) { result[d] = (F)std::sqrt(m2[d]/(double)(n - 1)); } }
+      return result;
+    }
+
+  private:
+
+    /// Welford's update over the points of the series 's', stored at 'idx'
+    void summarise(const TSeries& s, size_t idx, size_t nbdim) {
+      const arma::Mat<F>& mat = s.matrix();
+      _count[idx] = mat.n_cols;
+      for (size_t c = 0; c<mat.n_cols; ++c) {
+        for (size_t d = 0; d<nbdim; ++d) {
+          const double x = mat(d, c);
+          const double delta = x - _mean(d, idx);
+          _mean(d, idx) += delta/(double)(c + 1);
+          _m2(d, idx) += delta*(x - _mean(d, idx));
+          _min(d, idx) = c==0 ? mat(d, c) : std::min(_min(d, idx), mat(d, c));
+          _max(d, idx) = c==0 ? mat(d, c) : std::max(_max(d, idx), mat(d, c));
+        }
+      }
+    }
+  };
+
   /// Helper for a DTS (Dataset of Time Series), computing statistics per dimension
   struct DTS_Stats {
     arma::Col<F> _min;
@@ -19,26 +123,23 @@ namespace tempo {
     arma::Col<F> _mean;
     arma::Col<F> _stddev;
 
-    /// Compute statistic on a split subset
-    DTS_Stats(const DTS& dts, const IndexSet& subset) {
-
-      arma::running_stat_vec<arma::Col<F>> stat;
-      for (const auto i : subset) {
-        const TSeries& s = dts[i];
-        const arma::Mat<F>& mat = s.matrix();
-        for (size_t c = 0; c<mat.n_cols; ++c) {
-          stat(mat.col(c));
-        }
-      }
-
-      _min = stat.min();
-      _max = stat.max();
-      _mean = stat.mean();
-      _stddev = stat.stddev(0); // norm_type=0 performs normalisation using N-1 (N=number of samples)
+    /// Compute statistics on a split subset from its per series sums, in O(|subset|)
+    DTS_Stats(const DTS_Sums& sums, const IndexSet& subset) {
+      size_t n;
+      arma::Col<double> mean;
+      arma::Col<double> m2;
+      sums.merge(subset, n, mean, m2, _min, _max);
+      _mean.zeros(mean.n_rows);
+      for (size_t d = 0; d<mean.n_rows; ++d) { _mean[d] = (F)mean[d]; }
+      _stddev = DTS_Sums::stddev(n, m2); // Normalisation using N-1 (N=number of samples)
     }
 
+    /// Compute statistic on a split subset, summarising its series on 'nb_threads'
+    DTS_Stats(const DTS& dts, const IndexSet& subset, size_t nb_threads = 1) :
+      DTS_Stats(DTS_Sums(dts, subset, nb_threads), subset) {}
+
     /// Compute statistics on a full split
-    explicit DTS_Stats(const DTS& dts) : DTS_Stats(dts, IndexSet(dts.size())) {}
+    explicit DTS_Stats(const DTS& dts, size_t nb_threads = 1) : DTS_Stats(dts, IndexSet(dts.size()), nb_threads) {}
 
   };
 
@@ -48,4 +149,47 @@ namespace tempo {
     return stat._stddev[0];
   }
 
+  /// Helper for univariate DTS
+  inline F stddev(const DTS_Sums& sums, const IndexSet& is) { return sums.stddev(is)[0]; }
+
+  /// Norm of the per dimension standard deviations: sqrt of the sum of the variances.
+  /// Standard deviation of the Euclidean distance between points, the same as stddev for univariate DTS.
+  inline F stddev_norm(const DTS_Sums& sums, const IndexSet& is) { return arma::norm(sums.stddev(is), 2); }
+
+  /// Map of named DTS_Sums
+  using DTSSumsMap = std::map<std::string, DTS_Sums>;
+
+  /// Bytes held by the series of the transform of 'dts' (all of them, not only the ones of the split):
+  /// the series objects and their values. Approximate: lazily computed statistics are not counted.
+  inline size_t transform_nb_bytes(const DTS& dts) {
+    size_t total = 0;
+    for (const TSeries& s : dts.transform()) { total += sizeof(TSeries) + s.size()*sizeof(F); }
+    return total;
+  }
+
+  /// Interleave the values of the series of the transform of 'dts' over the NUMA nodes (see
+  /// utils::memory::interleave), by runs of contiguous series (e.g. the series of a SeriesSlab).
+  /// Return the number of bytes interleaved, 0 if the platform or the machine does not allow it.
+  inline size_t interleave_storage(const DTS& dts) {
+    std::vector<std::pair<F const *, F const *>> runs;
+    for (const TSeries& s : dts.transform()) { if (s.size()>0) { runs.emplace_back(s.data(), s.data() + s.size()); }}
+    std::sort(runs.begin(), runs.end());
+    size_t total = 0;
+    auto flush = [&total](std::pair<F const *, F const *> const& run) {
+      const size_t nb_bytes = (size_t)(run.second - run.first)*sizeof(F);
+      if (utils::memory::interleave(run.first, nb_bytes)) { total += nb_bytes; }
+    };
+    if (runs.empty()) { return 0; }
+    auto current = runs[0];
+    for (size_t i = 1; i<runs.size(); ++i) {
+      if (runs[i].first<=current.second) { current.second = std::max(current.second, runs[i].second); }
+      else {
+        flush(current);
+        current = runs[i];
+      }
+    }
+    flush(current);
+    return total;
+  }
+
 } // End of namespace tempo
\ No newline at end of file
@@ -1,69 +1,165 @@
 #pragma once
 
 #include <tempo/utils/utils.hpp>
+#include <tempo/utils/utils/aligned_allocator.hpp>
+#include <tempo/utils/utils/resources.hpp>
 
 #include <armadillo>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
 namespace tempo {
 
   namespace { // Unnamed namespace: visibility local to the file (when in header, do not declare variable here!)
     namespace lu = tempo::utils;
   }
 
-  class TSeries {
-    /// Missing data in the time series? We use a floating point type, so should be represented by "nan"
-    bool _missing{false};
+  /// Intern a label: all the series with the same label (e.g. the series of a class) point on the same string,
+  /// instead of each holding a copy. Interned labels are kept until the end of the program.
+  inline std::string const *intern_label(std::optional<std::string> const& olabel) {
+    if (!olabel) { return nullptr; }
+    static std::mutex mutex;
+    static std::unordered_set<std::string> pool; // Node based: the addresses of the labels are stable
+    std::lock_guard lock(mutex);
+    return &*pool.insert(olabel.value()).first;
+  }
 
-    /// Optional label
-    std::optional<std::string> _olabel{};
+  class TSeries {
+    /// Raw Data pointer, column major. Owned by the capsule, or external (see mk_view).
+    F const *_rawdata{nullptr};
 
-    /// Capsule: used when we own the data
+    /// Capsule: keeps the data alive
     lu::Capsule _capsule;
 
-    /// Raw Data pointer: the matrix must be built on top of that. Must be Column Major.
-    F const *_rawdata{nullptr};
+    /// Optional label, interned (see intern_label): nullptr if no label
+    std::string const *_label{nullptr};
+
+    /// Shape - by default, 1 line (univariate), 0 cols (empty)
+    size_t _length{0};
+    uint32_t _nb_dimensions{1};
 
-    /// Representation of the matrix - by default, 1 line (univariate), 0 cols (empty)
-    arma::Mat<F> _matrix{1, 0};
+    /// Missing data in the time series? We use a floating point type, so should be represented by "nan"
+    bool _missing{false};
 
     // --- Statistics
-    arma::Col<F> _min;        /// Min value per dimension
-    arma::Col<F> _max;        /// Max value per dimension
-    arma::Col<F> _mean;       /// Mean value per dimension
-    arma::Col<F> _median;     /// Median value per dimension
-    arma::Col<F> _stddev;     /// Standard deviation per dimension
-
-    /// Private "moving-in" constructor
-    TSeries(
-      // Column major data
-      lu::Capsule&& c,
-      F const *p,
-      arma::Mat<F>&& m,
-      // Other
-      std::optional<std::string> olabel,
-      bool has_missing
-    ) :
-      _missing(has_missing),
-      _olabel(std::move(olabel)),
-      _capsule(std::move(c)),
-      _rawdata(p),
-      _matrix(std::move(m)) {
+    // Computed on first access: most series (e.g. transformed ones) never use them.
+
+    /// Value of type T computed on first access, see get.
+    /// Thread safe: concurrent first accesses may compute it more than once, only one result is kept.
+    template<typename T>
+    class Lazy {
+      mutable std::atomic<T const *> _ptr{nullptr};
+    public:
+      Lazy() = default;
+      Lazy(Lazy&& other) noexcept : _ptr(other._ptr.exchange(nullptr)) {}
+      Lazy& operator =(Lazy&&) = delete;
+      ~Lazy() { delete _ptr.load(); }
+
+      template<typename Fun>
+      T const& get(Fun&& compute) const {
+        T const *p = _ptr.load(std::memory_order_acquire);
+        if (p==nullptr) {
+          auto *v = new T(compute());
+          if (_ptr.compare_exchange_strong(p, v, std::memory_order_acq_rel, std::memory_order_acquire)) { p = v; }
+          else { delete v; }
+        }
+        return *p;
+      }
+    };
 
-      // Pointer fixup
-      if(_rawdata ==nullptr){ _rawdata = _matrix.memptr(); }
+    /// Reductions computed together
+    struct Stats {
+      arma::Col<F> min;       /// Min value per dimension
+      arma::Col<F> max;       /// Max value per dimension
+      arma::Col<F> mean;      /// Mean value per dimension
+      arma::Col<F> stddev;    /// Standard deviation per dimension
 
       // Statistics (matrix, 1==along the row)
       // Doing the statistics along the rows restul in a column vector, with statistics per dimension.
-      _min = arma::min(_matrix, 1);
-      _max = arma::max(_matrix, 1);
-      _mean = arma::mean(_matrix, 1);
-      _median = arma::median(_matrix, 1);
-      // Note:  Second argument is norm_type = 0: performs normalisation using N-1 (signal sampled in the "population")
-      //        Third argument means "along the row"
-      _stddev = arma::stddev(_matrix, 0, 1);
-      //
+      explicit Stats(arma::Mat<F> const& matrix) :
+        min(arma::min(matrix, 1)),
+        max(arma::max(matrix, 1)),
+        mean(arma::mean(matrix, 1)),
+        // Note:  Second argument is norm_type = 0: normalisation using N-1 (signal sampled in the "population")
+        //        Third argument means "along the row"
+        stddev(arma::stddev(matrix, 0, 1)) {}
+    };
+
+    Lazy<Stats> _stats{};
+
+    /// Median value per dimension: requires a copy and a partial sort, computed on its own
+    Lazy<arma::Col<F>> _median{};
+
+    Stats const& stats() const { return _stats.get([this] { return Stats(matrix()); }); }
+
+    /// Private "moving-in" constructor, 'p' pointing in the capsule or in external memory kept alive by it
+    TSeries(lu::Capsule&& c, F const *p, size_t nbvar, size_t length, std::string const *label, bool has_missing) :
+      _rawdata(p),
+      _capsule(std::move(c)),
+      _label(label),
+      _length(length),
+      _nb_dimensions((uint32_t)nbvar),
+      _missing(has_missing) {}
+
+    /// Take ownership of a matrix with one line per dimension
+    static TSeries from_matrix(arma::Mat<F>&& m, std::string const *label, bool has_missing) {
+      const size_t nbvar = m.n_rows;
+      const size_t length = m.n_cols;
+      auto capsule = lu::make_capsule<arma::Mat<F>>(std::move(m));
+      F const *p = lu::get_capsule_ptr<arma::Mat<F>>(capsule)->memptr();
+      return TSeries(std::move(capsule), p, nbvar, length, label, has_missing);
     }
 
+    /// Take ownership of a column major vector
+    static TSeries from_colmajor(std::vector<F>&& v, size_t nbvar, std::string const *label, bool has_missing) {
+      const size_t length = v.size()/nbvar;
+      auto capsule = lu::make_capsule<std::vector<F>>(std::move(v));
+      F const *p = lu::get_capsule_ptr<std::vector<F>>(capsule)->data();
+      return TSeries(std::move(capsule), p, nbvar, length, label, has_missing);
+    }
+
+    /// Take ownership of a row major vector, transposed in place
+    static TSeries from_rowmajor(std::vector<F>&& v, size_t nbvar, std::string const *label,
+                                 std::optional<bool> omissing) {
+      using namespace std;
+
+      // --- Checking
+      size_t vsize = v.size();
+      if (nbvar<1) { throw domain_error("Number of variable can't be < 1"); }
+      if (vsize%nbvar!=0) { throw domain_error("Vector size is not a multiple of 'nbvar'"); }
+
+      // --- Transposition
+      // Armadillo works with column major data, but we are given a row major one.
+      // View the data as its transposed, and proceed with an "in place" transposition
+      // This transposition **will** change the underlying vector, which is fine.
+      const size_t nb_cols = vsize/nbvar;
+      {
+        arma::Mat<F> matrix(v.data(), nb_cols, nbvar,
+                            false,   // copy_aux_mem = false: use the auxiliary memory (i.e. no copying)
+                            true     // strict = true: matrix bounds to the auxiliary memory for its lifetime
+        );
+        inplace_trans(matrix);
+        assert(nbvar==matrix.n_rows);
+        assert(nb_cols==matrix.n_cols);
+      }
+
+      // Check missing data (NAN)
+      bool has_missing;
+      if (omissing.has_value()) { has_missing = omissing.value(); }
+      else { has_missing = std::any_of(v.begin(), v.end(), [](F x) { return std::isnan(x); }); }
+
+      return from_colmajor(std::move(v), nbvar, label, has_missing);
+    }
+
+    friend struct SeriesSlab;
+
   public:
 
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -81,14 +177,12 @@ namespace tempo {
 
     /// Build a new univariate series from an arma::Row<F>
     static TSeries mk_from(arma::Row<F>&& v, std::optional<std::string> olabel, std::optional<bool> omissing) {
-      // Build matrix from incoming row vector
-      arma::Mat<F> matrix(std::move(v));
       // Check missing data (NAN)
       bool has_missing;
       if (omissing.has_value()) { has_missing = omissing.value(); }
-      else { has_missing = matrix.has_nan(); }
-      //
-      return TSeries({}, nullptr, std::move(matrix), olabel, has_missing);
+      else { has_missing = v.has_nan(); }
+      // Build matrix from incoming row vector
+      return from_matrix(arma::Mat<F>(std::move(v)), intern_label(olabel), has_missing);
     }
 
     /// Build a new univariate series copying its info from an existing TSeries,
@@ -96,7 +190,7 @@ namespace tempo {
     /// Usefull when transforming series into other series (e.g. normalisation)
     /// Does not check if the info from other actually match v.
     static TSeries mk_from(TSeries const& other, arma::Row<F>&& v) {
-      return mk_from(std::move(v), other.label(), {other.missing()});
+      return from_matrix(arma::Mat<F>(std::move(v)), other._label, other.missing());
     }
 
     /// Build a new series from a row major vector
@@ -104,48 +198,47 @@ namespace tempo {
                                     size_t nbvar,
                                     std::optional<std::string> olabel,
                                     std::optional<bool> omissing) {
-      using namespace std;
-
-      // --- Checking
-      size_t vsize = v.size();
-      if (nbvar<1) { throw domain_error("Number of variable can't be < 1"); }
-      if (vsize%nbvar!=0) { throw domain_error("Vector size is not a multiple of 'nbvar'"); }
-
-      // --- lico
-      const size_t nb_lines = nbvar;
-      const size_t nb_cols = vsize/nbvar;
-
-      // --- Take ownership of the incoming vector
-      auto capsule = lu::make_capsule<vector<F>>(std::move(v));
-
-      // --- Build Armadillo matrix
-      // Armadillo works with column major data, but we are given a row major one.
-      // Build the data, and proceed with an "in place" transposition
-      // This transposition **will** change the underlying vector, which is fine.
-      F *rawptr = lu::get_capsule_ptr<vector<F>>(capsule)->data();
-      // Invert line/column here: we get the "right" matrix after transposition
-      arma::Mat<F> matrix(rawptr, nb_cols, nb_lines,
-                          false,   // copy_aux_mem = false: use the auxiliary memory (i.e. no copying)
-                          true     // struct = true: matrix bounds to the auxiliary memory for its lifetime; can't be resized
-      );
+      return from_rowmajor(std::move(v), nbvar, intern_label(olabel), omissing);
+    }
 
-      // Transpose
-      inplace_trans(matrix);
-      assert(nb_lines==matrix.n_rows);
-      assert(nb_cols==matrix.n_cols);
+    /// Copy data from other, except for the actual data. Allow to easily do transforms. No checking done.
+    static TSeries mk_from_rowmajor(TSeries const& other, std::vector<F>&& v) {
+      return from_rowmajor(std::move(v), other.nb_dimensions(), other._label, {other.missing()});
+    }
 
+    /// Build a new series from a matrix with one line per dimension (i.e. column major data)
+    static TSeries mk_from_colmajor(arma::Mat<F>&& matrix,
+                                    std::optional<std::string> olabel,
+                                    std::optional<bool> omissing) {
+      if (matrix.n_rows<1) { throw std::domain_error("Number of variable can't be < 1"); }
       // Check missing data (NAN)
       bool has_missing;
       if (omissing.has_value()) { has_missing = omissing.value(); }
       else { has_missing = matrix.has_nan(); }
-
-      // Build the TSeries
-      return TSeries(std::move(capsule), rawptr, std::move(matrix), olabel, has_missing);
+      //
+      return from_matrix(std::move(matrix), intern_label(olabel), has_missing);
     }
 
-    /// Copy data from other, except for the actual data. Allow to easily do transforms. No checking done.
-    static TSeries mk_from_rowmajor(TSeries const& other, std::vector<F>&& v) {
-      return mk_from_rowmajor(std::move(v), other.nb_dimensions(), other.label(), {other.missing()});
+    /** Build a new series viewing external column major data, without copying it.
+     * @param capsule  Keeps the external data alive for the lifetime of the series
+     * @param data     Column major data: 'nbvar' values for the 1st timestamp, then for the 2nd, etc.
+     *                 Never written through the series.
+     * @param nbvar    Number of variables
+     * @param length   Number of timestamps
+     */
+    static TSeries mk_view(lu::Capsule capsule,
+                           F const *data,
+                           size_t nbvar,
+                           size_t length,
+                           std::optional<std::string> olabel,
+                           std::optional<bool> omissing) {
+      if (nbvar<1) { throw std::domain_error("Number of variable can't be < 1"); }
+      // Check missing data (NAN)
+      bool has_missing;
+      if (omissing.has_value()) { has_missing = omissing.value(); }
+      else { has_missing = std::any_of(data, data + nbvar*length, [](F x) { return std::isnan(x); }); }
+      //
+      return TSeries(std::move(capsule), data, nbvar, length, intern_label(olabel), has_missing);
     }
 
 
@@ -155,35 +248,44 @@ namespace tempo {
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
     /// Access number of variable
-    size_t nb_dimensions() const { return _matrix.n_rows; }
+    size_t nb_dimensions() const { return _nb_dimensions; }
 
     /// Check if a series is univariate
     bool is_univariate() const { return nb_dimensions() == 1;}
 
     /// Access the length
-    size_t length() const { return _matrix.n_cols; }
+    size_t length() const { return _length; }
 
     /// Access the size of the data == ndim*length
-    size_t size() const { return _matrix.n_elem; }
+    size_t size() const { return _length*_nb_dimensions; }
 
     /// Check if has missing values
     bool missing() const { return _missing; }
 
     /// Get the label (perform a copy)
-    std::optional<std::string> label() const { return _olabel; }
+    std::optional<std::string> label() const {
+      if (_label==nullptr) { return {}; }
+      return {*_label};
+    }
 
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
     // Data access
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
     /// Column major access over all the points AND dimensions
-    F operator [](size_t idx) const { return _matrix(idx); }
+    F operator [](size_t idx) const { return _rawdata[idx]; }
 
     /// Column major access to the raw pointer
     const F *data() const { return _rawdata; }
 
-    /// Matrix access (li, co)
-    const arma::Mat<F>& matrix() const { return _matrix; }
+    /// Matrix access (li, co): read only view on the data, built on each call (the series does not keep a matrix)
+    arma::Mat<F> matrix() const {
+      if (size()==0) { return arma::Mat<F>(nb_dimensions(), 0); }
+      return arma::Mat<F>(const_cast<F *>(_rawdata), nb_dimensions(), length(),
+                          false,   // copy_aux_mem = false: use the auxiliary memory (i.e. no copying)
+                          true     // strict = true: matrix bounds to the auxiliary memory for its lifetime
+      );
+    }
 
     /// As row vector, only for univariate
     arma::Row<F> rowvec() const {
@@ -195,23 +297,28 @@ namespace tempo {
     // Statistic access
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
+    // Computed on first access
+
     /// Minimum value per dimension
-    const arma::Col<F>& min() const { return _min; };
+    const arma::Col<F>& min() const { return stats().min; };
 
     /// Maximum value per dimension
-    const arma::Col<F>& max() const { return _max; };
+    const arma::Col<F>& max() const { return stats().max; };
 
     /// Mean value per dimension
     const arma::Col<F>& mean() const {
-      assert(_mean.size()>0);
-      return _mean;
+      const arma::Col<F>& mean = stats().mean;
+      assert(mean.size()>0);
+      return mean;
     };
 
     /// Median value per dimension
-    const arma::Col<F>& median() const { return _median; };
+    const arma::Col<F>& median() const {
+      return _median.get([this] { return arma::Col<F>(arma::median(matrix(), 1)); });
+    };
 
     /// Standard deviation per dimension
-    const arma::Col<F>& stddev() const { return _stddev; };
+    const arma::Col<F>& stddev() const { return stats().stddev; };
 
 
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -246,4 +353,62 @@ namespace tempo {
 
   }; // End of class TSeries
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Contiguous storage
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** One buffer for the values of many series, starting on a cache line.
+   *  The series of a transform are views in the slab (see TSeries::mk_view), in index order: a loop over the series
+   *  streams over one block of memory. The capsule keeps the slab alive as long as a series views it.
+   *  The slabs are charged on the memory budget of the dataset slabs (see utils::resources::budget): a slab beyond it
+   *  throws std::runtime_error before being allocated.
+   */
+  struct SeriesSlab {
+    static constexpr size_t alignment = 64;
+
+    /// Large slabs live on huge pages if enabled (see utils::memory::huge_pages)
+    using Buffer = std::vector<F, lu::HugePageAllocator<F, alignment>>;
+
+    /// Buffer with its charge, taken first and released last
+    struct Charged {
+      std::shared_ptr<lu::resources::SlabCharge> charge;
+      Buffer buffer;
+
+      explicit Charged(size_t nb_values) :
+        charge(std::make_shared<lu::resources::SlabCharge>(nb_values*sizeof(F))), buffer(nb_values) {}
+    };
+
+    lu::Capsule capsule;
+
+    F *data;
+
+    /// Slab of 'nb_values' values, set to 0
+    explicit SeriesSlab(size_t nb_values) :
+      capsule(lu::make_capsule<Charged>(nb_values)),
+      data(lu::get_capsule_ptr<Charged>(capsule)->buffer.data()) {}
+
+    /// View in the slab, starting at 'offset', with the shape, label and missing flag of 'like'
+    TSeries view(size_t offset, TSeries const& like) const {
+      return TSeries(lu::Capsule(capsule), data + offset, like.nb_dimensions(), like.length(), like._label,
+                     like.missing());
+    }
+  };
+
+  /// Move the values of 'series' in one slab, replacing the series by views in the slab (keeping their order,
+  /// shapes, labels and missing flags). Called by DatasetTransform::map and map_shptr on their new series.
+  inline void compact_storage(std::vector<TSeries>& series) {
+    size_t total = 0;
+    for (const auto& s : series) { total += s.size(); }
+    SeriesSlab slab(total);
+    std::vector<TSeries> views;
+    views.reserve(series.size());
+    size_t offset = 0;
+    for (const auto& s : series) {
+      std::copy(s.data(), s.data() + s.size(), slab.data + offset);
+      views.push_back(slab.view(offset, s));
+      offset += s.size();
+    }
+    series = std::move(views);
+  }
+
 } // End of namespace tempo
\ No newline at end of file
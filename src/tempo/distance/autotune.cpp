@@ -0,0 +1,196 @@
+#include "autotune.hpp"
+#include "univariate.hpp"
+#include "core/simd.private.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+
+namespace tempo::distance::autotune {
+
+  namespace {
+
+    /// Exponents of the table, by index (see internal::cfe_index)
+    constexpr std::array<double, NB_CFES> exponents{0.5, 1.0, 2.0};
+
+    /// Maximum number of series timed per length bucket, and number of timings of a kernel (the best one is kept)
+    constexpr size_t NB_SERIES = 8;
+    constexpr size_t NB_REPEATS = 2;
+
+    std::array<DTWKernel, 4> all_kernels{DTWKernel::DEFAULT, DTWKernel::ROW, DTWKernel::BAND, DTWKernel::WAVEFRONT};
+
+    std::optional<DTWKernel> from_string(std::string const& name) {
+      for (DTWKernel k : all_kernels) { if (to_string(k)==name) { return k; }}
+      return {};
+    }
+
+    /// Representative window of a window bucket for the length 'length', if the bucket exists for this length
+    std::optional<size_t> window_of(size_t wbucket, size_t length) {
+      constexpr size_t above_band = core::BAND_MAX_WINDOW + 1;
+      size_t w;
+      switch (wbucket) {
+        case 0: w = core::BAND_MAX_WINDOW/2; break;
+        case 1: w = std::max(above_band, length/16); break;
+        case 2: w = std::max(above_band, length/4); break;
+        default: w = std::max(above_band, length); break;
+      }
+      if (window_bucket(length, w)!=wbucket) { return {}; }
+      return w;
+    }
+
+    /// Seconds taken by the nearest neighbour search of the first half of 'series' among the second half.
+    /// The cutoff of a query is its best so far, as in the NN1 splitters. Best of NB_REPEATS timings.
+    template<typename F>
+    double time_nn1(std::vector<std::vector<F>> const& series, univariate::DTWFun<F> fun, F cfe, size_t w) {
+      const size_t half = series.size()/2;
+      double best = utils::PINF<double>;
+      for (size_t r = 0; r<NB_REPEATS; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t q = 0; q<half; ++q) {
+          F bsf = utils::PINF<F>;
+          for (size_t c = half; c<series.size(); ++c) {
+            auto const& sq = series[q];
+            auto const& sc = series[c];
+            bsf = std::min(bsf, fun(sq.data(), sq.size(), sc.data(), sc.size(), cfe, w, bsf));
+          }
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      }
+      return best;
+    }
+
+  } // End of anonymous namespace
+
+  std::string to_string(DTWKernel kernel) {
+    switch (kernel) {
+      case DTWKernel::ROW: return "row";
+      case DTWKernel::BAND: return "band";
+      case DTWKernel::WAVEFRONT: return "wavefront";
+      default: return "default";
+    }
+  }
+
+  void reset() {
+    internal::dtw_table.fill(DTWKernel::DEFAULT);
+    internal::dtw_tuned = false;
+  }
+
+  template<typename F>
+  size_t tune_dtw(std::vector<std::vector<F>> const& series, std::ostream *log) {
+    namespace simd = core::simd;
+    // The SIMD wavefront kernel is only used in double, with an instruction set
+    constexpr bool is_double = std::is_same_v<F, double>;
+    const bool has_wavefront = is_double&&simd::detected_isa()!=simd::ISA::SCALAR;
+    // Group the series by length bucket
+    std::array<std::vector<std::vector<F>>, NB_LENGTH_BUCKETS> by_bucket;
+    for (auto const& s : series) {
+      auto& group = by_bucket[length_bucket(s.size())];
+      if (!s.empty()&&group.size()<NB_SERIES) { group.push_back(s); }
+    }
+    internal::dtw_tuned = true;
+    size_t nb_tuned = 0;
+    for (size_t lb = 0; lb<NB_LENGTH_BUCKETS; ++lb) {
+      auto const& group = by_bucket[lb];
+      if (group.size()<2) { continue; }
+      bool equal_length = true;
+      for (auto const& s : group) { equal_length = equal_length&&s.size()==group.front().size(); }
+      const size_t length = group.front().size();
+      for (size_t ci = 0; ci<NB_CFES; ++ci) {
+        const F cfe = (F)exponents[ci];
+        const univariate::DTWFun<F> fun = univariate::dtw_for<F>(cfe, equal_length);
+        for (size_t wb = 0; wb<NB_WINDOW_BUCKETS; ++wb) {
+          DTWKernel& entry = internal::dtw_table[internal::index(ci, lb, wb)];
+          const auto w = window_of(wb, length);
+          if (entry!=DTWKernel::DEFAULT||!w) { continue; }
+          std::vector<DTWKernel> candidates{DTWKernel::ROW};
+          if (wb==0) { candidates.push_back(DTWKernel::BAND); }
+          if (has_wavefront) { candidates.push_back(DTWKernel::WAVEFRONT); }
+          DTWKernel best = DTWKernel::DEFAULT;
+          double best_time = utils::PINF<double>;
+          for (DTWKernel k : candidates) {
+            entry = k;
+            const double t = time_nn1<F>(group, fun, cfe, w.value());
+            if (t<best_time) {
+              best_time = t;
+              best = k;
+            }
+          }
+          entry = best;
+          ++nb_tuned;
+          if (log!=nullptr) {
+            *log << "Autotune: DTW cfe=" << exponents[ci] << " length=" << length << " w=" << w.value()
+                 << ": " << to_string(best) << std::endl;
+          }
+        }
+      }
+    }
+    return nb_tuned;
+  }
+
+  template size_t tune_dtw<double>(std::vector<std::vector<double>> const& series, std::ostream *log);
+
+  template size_t tune_dtw<float>(std::vector<std::vector<float>> const& series, std::ostream *log);
+
+  std::string cpu_key() {
+    namespace simd = core::simd;
+    std::string isa;
+    switch (simd::detected_isa()) {
+      case simd::ISA::AVX512: isa = "avx512"; break;
+      case simd::ISA::AVX2: isa = "avx2"; break;
+      case simd::ISA::NEON: isa = "neon"; break;
+      default: isa = "scalar"; break;
+    }
+    return isa + "/" + std::to_string(std::thread::hardware_concurrency());
+  }
+
+  bool load(std::filesystem::path const& path) {
+    if (!std::filesystem::exists(path)) { return false; }
+    std::ifstream in(path);
+    const nlohmann::json j = nlohmann::json::parse(in, nullptr, false);
+    try {
+      if (j.is_discarded()||j.at("cpu").get<std::string>()!=cpu_key()) { return false; }
+      for (auto const& e : j.at("dtw")) {
+        const size_t ci = e.at("cfe_index").get<size_t>();
+        const size_t lb = e.at("length_bucket").get<size_t>();
+        const size_t wb = e.at("window_bucket").get<size_t>();
+        const auto kernel = from_string(e.at("kernel").get<std::string>());
+        if (ci>=NB_CFES||lb>=NB_LENGTH_BUCKETS||wb>=NB_WINDOW_BUCKETS||!kernel) { continue; }
+        internal::dtw_table[internal::index(ci, lb, wb)] = kernel.value();
+        internal::dtw_tuned = true;
+      }
+    } catch (nlohmann::json::exception const&) {
+      // Not a cache file: tune again
+      return false;
+    }
+    return true;
+  }
+
+  void save(std::filesystem::path const& path) {
+    nlohmann::json j;
+    j["cpu"] = cpu_key();
+    nlohmann::json entries = nlohmann::json::array();
+    for (size_t ci = 0; ci<NB_CFES; ++ci) {
+      for (size_t lb = 0; lb<NB_LENGTH_BUCKETS; ++lb) {
+        for (size_t wb = 0; wb<NB_WINDOW_BUCKETS; ++wb) {
+          const DTWKernel k = internal::dtw_table[internal::index(ci, lb, wb)];
+          if (k==DTWKernel::DEFAULT) { continue; }
+          entries.push_back({
+            {"cfe_index", ci}, {"cfe", exponents[ci]}, {"length_bucket", lb}, {"window_bucket", wb},
+            {"kernel", to_string(k)}
+          });
+        }
+      }
+    }
+    j["dtw"] = std::move(entries);
+    std::ofstream out(path);
+    if (!out) { throw std::runtime_error("Cannot open autotune cache file " + path.string()); }
+    out << j.dump(2) << std::endl;
+  }
+
+} // End of namespace tempo::distance::autotune
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "utils.hpp"
+#include "cost_functions.hpp"
+#include "core/elastic/dtw.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace tempo::distance::autotune {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Runtime selection of the kernels of the univariate DTW (see univariate::dtw and univariate::dtw_equal_length).
+  // The DTW has several kernels computing the same result: the row EAP kernel, the band kernel of the small windows
+  // (see core::BAND_MAX_WINDOW) and the SIMD wavefront kernel of the long series (see simd::WAVEFRONT_MIN_LENGTH).
+  // By default, the kernel is chosen with these fixed thresholds. 'tune_dtw' instead times the kernels on a sample
+  // of series, searching nearest neighbours as the NN1 splitters do, and records the fastest one per cost function
+  // exponent (0.5, 1 and 2, the others keep the default), length bucket and window bucket.
+  // The table can be saved in a cache file, loaded by the next runs on the same CPU to skip the tuning.
+  // The table is written by tune_dtw, load and reset, which must not run concurrently with the distances.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Kernels of the univariate DTW. DEFAULT: choice by the fixed thresholds.
+  enum class DTWKernel : uint8_t { DEFAULT, ROW, BAND, WAVEFRONT };
+
+  /// Name of a kernel, as written in the cache file
+  std::string to_string(DTWKernel kernel);
+
+  constexpr size_t NB_CFES = 3;
+  constexpr size_t NB_LENGTH_BUCKETS = 33;
+  constexpr size_t NB_WINDOW_BUCKETS = 4;
+
+  /// Length bucket: the bit width of the length, i.e. the buckets [2^(b-1), 2^b[
+  inline size_t length_bucket(size_t length) {
+    return std::min<size_t>(std::bit_width(length), NB_LENGTH_BUCKETS - 1);
+  }
+
+  /// Window bucket: 0 for the windows of the band kernel, then by ratio of the length: below 1/8, below 1/2, above
+  inline size_t window_bucket(size_t length, size_t w) {
+    if (w<=core::BAND_MAX_WINDOW) { return 0; }
+    else if (w*8<length) { return 1; }
+    else if (w*2<length) { return 2; }
+    else { return 3; }
+  }
+
+  namespace internal {
+
+    inline std::array<DTWKernel, NB_CFES*NB_LENGTH_BUCKETS*NB_WINDOW_BUCKETS> dtw_table{};
+
+    /// False while the table only holds DEFAULT: the lookup is then skipped
+    inline bool dtw_tuned{false};
+
+    inline size_t index(size_t cfe_idx, size_t lbucket, size_t wbucket) {
+      return (cfe_idx*NB_LENGTH_BUCKETS + lbucket)*NB_WINDOW_BUCKETS + wbucket;
+    }
+
+    /// Index of the cost functions with an entry in the table, NB_CFES for the others
+    template<univariate::CFE c>
+    constexpr size_t cfe_index() {
+      if constexpr (c==univariate::CFE::SQRT) { return 0; }
+      else if constexpr (c==univariate::CFE::AD1) { return 1; }
+      else if constexpr (c==univariate::CFE::AD2) { return 2; }
+      else { return NB_CFES; }
+    }
+
+  } // End of namespace internal
+
+  /// Kernel of the DTW with the cost function c, between series of length 'length' (the shortest one) and window 'w'
+  template<univariate::CFE c>
+  inline DTWKernel dtw_kernel(size_t length, size_t w) {
+    constexpr size_t ci = internal::cfe_index<c>();
+    if constexpr (ci==NB_CFES) { return DTWKernel::DEFAULT; }
+    else {
+      if (!internal::dtw_tuned) { return DTWKernel::DEFAULT; }
+      return internal::dtw_table[internal::index(ci, length_bucket(length), window_bucket(length, w))];
+    }
+  }
+
+  /// Forget the tuned kernels: back to the default choice
+  void reset();
+
+  /** Time the DTW kernels on 'series' for the cost function exponents 0.5, 1 and 2 and all the window buckets, and
+   *  record the fastest kernel of each length bucket holding at least 2 series. Each bucket is timed on up to 8 of
+   *  its series, the first half being the queries of a nearest neighbour search among the second half.
+   *  Entries already tuned (e.g. loaded from a cache file) are kept.
+   * @param series  Sample of the series the distances will be computed on, e.g. the train series
+   * @param log     If not null, report the tuned entries
+   * @return Number of entries tuned
+   */
+  template<typename F>
+  size_t tune_dtw(std::vector<std::vector<F>> const& series, std::ostream *log = nullptr);
+
+  /// Identification of the CPU the entries are tuned for: its instruction set and its number of hardware threads
+  std::string cpu_key();
+
+  /// Load the entries of a cache file written by 'save' on a CPU with the same cpu_key.
+  /// Return false if the file does not exist, is not a cache file, or is for another CPU.
+  bool load(std::filesystem::path const& path);
+
+  /// Save the tuned entries in a cache file. Throw a std::runtime_error if the file can not be written.
+  void save(std::filesystem::path const& path);
+
+} // End of namespace tempo::distance::autotune
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../utils.private.hpp"
+#include "dtw_lb_keogh.hpp"
 
 namespace tempo::distance::core {
 
@@ -8,6 +9,7 @@ namespace tempo::distance::core {
 
     /** Amerced Dynamic Time Warping (ADTW), Early Abandoned and Pruned (EAP).
      * @tparam F            Floating type used for the computation
+     * @tparam EqualLength  Series of the same length: also prune the cells too far from the diagonal (see below)
      * @param nblines       Length of the line series.
      * @param nbcols        Length of the column series.
      * @param cfun          Indexed Cost function between two points
@@ -17,7 +19,7 @@ namespace tempo::distance::core {
      * @param buffers_v     Buffer used to perform the computation. Will reallocate if required.
      * @return ADTW between the two series or +PINF if early abandoned.
      */
-    template<typename F>
+    template<typename F, bool EqualLength = false>
     F adtw(const size_t nblines,
            const size_t nbcols,
            utils::ICFun<F> auto cfun,
@@ -40,6 +42,16 @@ namespace tempo::distance::core {
       // Then, subtract the cost of the last alignment.
       const F ub = nextafter(cutoff, PINF) - cfun(nblines - 1, nbcols - 1);
 
+      // With series of the same length, an alignment going through the cell (i, j) must still make |i-j| warping steps
+      // to come back to the diagonal, each one costing 'penalty': the cell can be pruned if cost+|i-j|*penalty > ub.
+      // As the steps are accumulated in floating point, allow for their rounding errors (at most one ulp of the cutoff
+      // per step) before pruning: the cells of an alignment <= cutoff are never pruned. Requires a finite penalty.
+      const F ub_band = ub + (F)(4*nblines)*std::numeric_limits<F>::epsilon()*cutoff;
+      const auto alive = [&](const F cell, const size_t li, const size_t cj) -> bool {
+        if constexpr (EqualLength) { return cell + (F)(li>cj ? li - cj : cj - li)*penalty<=ub_band; }
+        else { return cell<=ub; }
+      };
+
       // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
       // Double buffer allocation, no initialisation required (border condition manage in the code).
       // Base indices for the 'c'urrent row and the 'p'revious row.
@@ -71,7 +83,7 @@ namespace tempo::distance::core {
         for (j = 1; j==curr_pp&&j<nbcols; ++j) {
           cost = cost + cfun(0, j) + penalty; // Left: penalty
           buffer[c + j] = cost;
-          if (cost<=ub) { ++curr_pp; }
+          if (alive(cost, 0, j)) { ++curr_pp; }
         }
         ++i;
         prev_pp = curr_pp;
@@ -88,7 +100,7 @@ namespace tempo::distance::core {
         {
           cost = buffer[p + j] + cfun(i, j) + penalty; // Top: penalty
           buffer[c + j] = cost;
-          if (cost<=ub) { curr_pp = j + 1; } else { ++next_start; }
+          if (alive(cost, i, j)) { curr_pp = j + 1; } else { ++next_start; }
           ++j;
         }
         // --- --- --- Stage 1: Up to the previous pruning point while advancing next_start: diag and top
@@ -99,7 +111,7 @@ namespace tempo::distance::core {
             buffer[p + j] + d + penalty     // Top: penalty
           );
           buffer[c + j] = cost;
-          if (cost<=ub) { curr_pp = j + 1; } else { ++next_start; }
+          if (alive(cost, i, j)) { curr_pp = j + 1; } else { ++next_start; }
         }
         // --- --- --- Stage 2: Up to the previous pruning point without advancing next_start: left, diag and top
         for (; j<prev_pp; ++j) {
@@ -109,7 +121,7 @@ namespace tempo::distance::core {
             buffer[p + j] + d + penalty
           );   // Top: penalty
           buffer[c + j] = cost;
-          if (cost<=ub) { curr_pp = j + 1; }
+          if (alive(cost, i, j)) { curr_pp = j + 1; }
         }
         // --- --- --- Stage 3: At the previous pruning point. Check if we are within bounds.
         if (j<nbcols) { // If so, two cases.
@@ -117,7 +129,7 @@ namespace tempo::distance::core {
           if (j==next_start) { // Case 1: Advancing next start: only diag (no penalty)
             cost = buffer[p + j - 1] + d;
             buffer[c + j] = cost;
-            if (cost<=ub) { curr_pp = j + 1; }
+            if (alive(cost, i, j)) { curr_pp = j + 1; }
             else {
               // Special case if we are on the last alignment: return the actual cost if we are <= cutoff
               if (i==nblines - 1&&j==nbcols - 1&&cost<=cutoff) { return cost; }
@@ -128,7 +140,7 @@ namespace tempo::distance::core {
           } else { // Case 2: Not advancing next start: possible path in previous cells: left (penalty) and diag.
             cost = std::min(cost + d + penalty, buffer[p + j - 1] + d);
             buffer[c + j] = cost;
-            if (cost<=ub) { curr_pp = j + 1; }
+            if (alive(cost, i, j)) { curr_pp = j + 1; }
           }
           ++j;
         } else { // Previous pruning point is out of bound: exit if we extended next start up to here.
@@ -146,7 +158,7 @@ namespace tempo::distance::core {
           const auto d = cfun(i, j);
           cost = cost + d + penalty; // Left: penalty
           buffer[c + j] = cost;
-          if (cost<=ub) { ++curr_pp; }
+          if (alive(cost, i, j)) { ++curr_pp; }
         }
         // --- --- ---
         prev_pp = curr_pp;
@@ -205,6 +217,22 @@ namespace tempo::distance::core {
     }
   }
 
+  /// ADTW EAP for two series of the same length 'length': same result as adtw(length, length, ...),
+  /// the initial cutoff only covering the diagonal. When the window of the alignments <= cutoff (see adtw_lb_window)
+  /// does not cover the full matrix, also prunes the cells out of the window, i.e. the cells (i, j) with a cost
+  /// cost + |i-j|*penalty > cutoff. Else, runs the general kernel, which does not pay for the extra check.
+  template<typename F>
+  inline F adtw_equal_length(size_t length, utils::ICFun<F> auto cfun, F penalty, F cutoff, std::vector<F>& buffer_v) {
+    if (length==0) { return 0; }
+    if (std::isinf(cutoff)) {
+      cutoff = 0;
+      for (size_t i{0}; i<length; ++i) { cutoff = cutoff + cfun(i, i); }
+    } else if (std::isnan(cutoff)) { cutoff = utils::PINF<F>; }
+    if (penalty>0&&std::isfinite(penalty)&&cutoff<2*penalty*(F)(length - 1)) {
+      return internal::adtw<F, true>(length, length, cfun, penalty, cutoff, buffer_v);
+    } else { return internal::adtw<F>(length, length, cfun, penalty, cutoff, buffer_v); }
+  }
+
   /// Helper for the above without having to provide a buffer
   template<typename F>
   inline F adtw(size_t length1, size_t length2, utils::ICFun<F> auto cfun, F penalty, F cutoff) {
@@ -212,4 +240,49 @@ namespace tempo::distance::core {
     return adtw<F>(length1, length2, cfun, penalty, cutoff, v);
   }
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Lower bound
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Window of the ADTW alignments of cost at most 'cutoff', for two series of the same length.
+   *  An alignment going through the cell (i, j) makes at least |i-j| steps to the left and |i-j| steps to the top,
+   *  each one costing 'penalty': alignments of cost <= cutoff stay within a window of cutoff/(2*penalty).
+   *  Without penalty or cutoff (+INF or QNAN), the window covers the full series (length-1).
+   */
+  template<typename F>
+  size_t adtw_lb_window(size_t length, F penalty, F cutoff) {
+    if (length==0) { return 0; }
+    const F ratio = cutoff/(2*penalty);
+    if (!(penalty>0)||!(ratio<(F)(length - 1))) { return length - 1; }
+    return ratio>0 ? (size_t)ratio : 0;
+  }
+
+  /** LB Keogh for ADTW - only applicable for same-length series.
+   *  Alignments of cost <= cutoff stay within the window adtw_lb_window(length, penalty, cutoff), where they cost at
+   *  least LB Keogh with the envelopes of the candidate at that window. The result is a lower bound of ADTW in all
+   *  cases: if ADTW > cutoff, the bound is either above the cutoff (early abandoned) or below ADTW.
+   *  The bound tightens with the cutoff: use the best so far.
+   * @tparam F            Floating type used for the computation
+   * @param query         Query series
+   * @param candidate     Candidate series, whose envelopes are computed
+   * @param length        Length of both series
+   * @param cfun          Cost Function utils::CFun<F>
+   * @param penalty       Fixed cost penalty for warping steps; must be >=0
+   * @param cutoff        Cut-off value (strictly) above which we early abandon ("best so far")
+   * @param upper         Buffer for the upper envelope of the candidate. Will reallocate if required.
+   * @param lower         Buffer for the lower envelope of the candidate. Will reallocate if required.
+   * @return +INF if early abandoned, or the lower bound value
+   */
+  template<typename F>
+  F lb_adtw_Keogh(F const *query, F const *candidate, size_t length, utils::CFun<F> auto cfun, F penalty, F cutoff,
+                  std::vector<F>& upper, std::vector<F>& lower) {
+    if (length==0) { return 0; }
+    if (std::isnan(cutoff)) { cutoff = utils::PINF<F>; }
+    const size_t w = adtw_lb_window(length, penalty, cutoff);
+    upper.resize(length);
+    lower.resize(length);
+    univariate::get_keogh_envelopes(candidate, length, upper.data(), lower.data(), w);
+    return univariate::lb_Keogh(query, length, upper.data(), lower.data(), cfun, cutoff);
+  }
+
 } // End of namespace tempo::distance::core
\ No newline at end of file
@@ -229,3 +229,67 @@ TEST_CASE("Univariate ADTW Variable length", "[adtw][univariate]") {
     }// End query loop
   }// End section
 }
+
+TEST_CASE("Univariate ADTW Equal length kernel", "[adtw][univariate]") {
+  mock::Mocker mocker;
+  const auto& penalties = mocker.adtw_penalties;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t l = mocker._fixl;
+  std::vector<F> buffer;
+
+  SECTION("Same as ADTW") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (F p : penalties) {
+        INFO("Same cells in the same order. Expect exact floating point equality.");
+        const F v = adtw(l, l, cfun(s1, s2), p, PINF);
+        REQUIRE(adtw_equal_length(l, cfun(s1, s2), p, PINF, buffer)==v);
+        // The equal length kernel prunes more cells: also test at one ulp around the result
+        for (F cutoff : {v*0.5, v*0.9, std::nextafter(v, F(0)), v, std::nextafter(v, PINF), v*1.1, v*2}) {
+          REQUIRE(adtw_equal_length(l, cfun(s1, s2), p, cutoff, buffer)==adtw(l, l, cfun(s1, s2), p, cutoff));
+        }
+      }
+    }
+  }
+
+}
+
+TEST_CASE("Univariate ADTW LB Keogh", "[adtw][univariate][lb]") {
+  mock::Mocker mocker;
+  const auto& penalties = mocker.adtw_penalties;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t l = mocker._fixl;
+  constexpr auto ad2 = tempo::distance::univariate::ad2<F>;
+  std::vector<F> upper;
+  std::vector<F> lower;
+
+  SECTION("Lower bound") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (F p : penalties) {
+        const F v = adtw(l, l, cfun(s1, s2), p, PINF);
+        // Without cutoff, the window covers the full series
+        REQUIRE(lb_adtw_Keogh(s1.data(), s2.data(), l, ad2, p, PINF, upper, lower)<=v);
+        // With a cutoff, either abandoned (then ADTW > cutoff) or a lower bound
+        for (F cutoff : {v*0.5, v*0.9, v, v*1.1, v*2}) {
+          const F lb = lb_adtw_Keogh(s1.data(), s2.data(), l, ad2, p, cutoff, upper, lower);
+          if (lb==PINF) { REQUIRE(v>cutoff); } else { REQUIRE(lb<=v); }
+        }
+        // At the exact cutoff, the alignment is never abandoned
+        REQUIRE(lb_adtw_Keogh(s1.data(), s2.data(), l, ad2, p, v, upper, lower)<=v);
+      }
+    }
+  }
+
+  SECTION("Window") {
+    REQUIRE(adtw_lb_window<F>(l, 0, 1)==l - 1);
+    REQUIRE(adtw_lb_window<F>(l, 1, PINF)==l - 1);
+    REQUIRE(adtw_lb_window<F>(l, 1, utils::QNAN<F>)==l - 1);
+    REQUIRE(adtw_lb_window<F>(l, 1, 0)==0);
+    REQUIRE(adtw_lb_window<F>(l, 1, 5)==2);
+    REQUIRE(adtw_lb_window<F>(0, 1, 5)==0);
+  }
+
+}
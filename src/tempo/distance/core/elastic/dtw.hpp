@@ -2,10 +2,27 @@
 
 #include "../utils.private.hpp"
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+
 namespace tempo::distance::core {
 
+  /// Largest window of the band DTW kernel (see internal::dtw_band), selected by dtw for windows up to it
+  constexpr size_t BAND_MAX_WINDOW = 16;
+
   namespace internal {
 
+    /** Slack added to the cutoff when pruning with a cumulative lower bound of the lines (see the 'cb' parameter of
+     *  the kernels). The bound and the DTW sum in different orders: with a slack above the rounding errors of the sums,
+     *  a tie or a near tie with the cutoff is not pruned because of the rounding of the bound.
+     */
+    template<typename F>
+    F cb_slack(size_t nblines, size_t nbcols, F cutoff) {
+      return (F)(2*(nblines + nbcols))*std::numeric_limits<F>::epsilon()*cutoff;
+    }
+
     /** Unconstrained (no window) Dynamic Time Warping, Early Abandoned and Pruned (EAP).
      * @tparam F            Floating type used for the computation
      * @param nblines       Length of the line series.
@@ -13,7 +30,10 @@ namespace tempo::distance::core {
      * @param cfun          Indexed Cost function between two points
      * @param cutoff        Attempt to prune computation of alignments with cost > cutoff.
      *                      May lead to early abandoning.
-     * @param buffer_v      The buffer used to carry the computation.
+     * @param buffer        The buffer used to carry the computation, of at least nbcols*2 cells (not initialised).
+     * @param cb            If not null, cumulative lower bound of the lines, of nblines+1 values: cb[i] bounds the cost
+     *                      of the alignments of the lines i and after, cb[nblines]=0 (see lb_Keogh_cumulative).
+     *                      The cells of a line i whose cost plus cb[i+1] is above the cutoff are pruned.
      * @return DTW between the two series or +INF if early abandoned.
      */
     template<typename F>
@@ -21,7 +41,8 @@ namespace tempo::distance::core {
           const size_t nbcols,
           utils::ICFun<F> auto cfun,
           const F cutoff,
-          std::vector<F> buffer_v
+          F *buffer,
+          F const *cb = nullptr
     ) {
       // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
       // in debug mode, check preconditions
@@ -37,13 +58,15 @@ namespace tempo::distance::core {
       // Create a new tighter upper bounds (most commonly used in the code).
       // First, take the "next float" after "cutoff" to deal with numerical instability.
       // Then, subtract the cost of the last alignment.
-      const F ub = nextafter(cutoff, PINF) - cfun(nblines - 1, nbcols - 1);
+      // With a cumulative bound, the bound of a line also subtracts the bound of the following lines, if larger.
+      const F next_cutoff = nextafter(cutoff, PINF);
+      const F ub_last = next_cutoff - cfun(nblines - 1, nbcols - 1);
+      const F cb_cutoff = (cb==nullptr) ? 0 : next_cutoff + cb_slack<F>(nblines, nbcols, cutoff);
+      F ub = (cb==nullptr) ? ub_last : std::min(ub_last, cb_cutoff - cb[1]);
 
       // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
-      // Double buffer allocation, no initialisation required (border condition manage in the code).
+      // Double buffer, no initialisation required (border condition manage in the code).
       // Base indices for the 'c'urrent row and the 'p'revious row.
-      buffer_v.assign(nbcols*2, 0);
-      auto *buffer = buffer_v.data();
       size_t c{0}, p{nbcols};
 
       // Line & column counters
@@ -81,6 +104,7 @@ namespace tempo::distance::core {
       for (; i<nblines; ++i) {
         // --- --- --- Swap and variables init
         std::swap(c, p);
+        if (cb!=nullptr) { ub = std::min(ub_last, cb_cutoff - cb[i + 1]); }
         size_t curr_pp = next_start; // Next pruning point init at the start of the line
         j = next_start;
         // --- --- --- Stage 0: Special case for the first column. Can only look up (border on the left)
@@ -143,24 +167,36 @@ namespace tempo::distance::core {
       if (j==nbcols&&cost<=cutoff) { return cost; } else { return PINF; }
     }
 
+    /// Unconstrained DTW EAP as above, with a buffer allocated as required
+    template<typename F>
+    F dtw(size_t nblines, size_t nbcols, utils::ICFun<F> auto cfun, F cutoff, std::vector<F>& buffer_v,
+          F const *cb = nullptr) {
+      buffer_v.assign(nbcols*2, 0);
+      return dtw<F>(nblines, nbcols, cfun, cutoff, buffer_v.data(), cb);
+    }
+
     /** Dynamic Time Warping with warping window, Early Abandoned and Pruned (EAP).
      * @tparam F            Floating type used for the computation
+     * @tparam EqualLength  If true, the series have the same length and window<=nblines-2 (see core::dtw):
+     *                      the end of the window on a line is computed without the unsigned overflow checks
      * @param nblines       Length of the line series.
      * @param nbcols        Length of the column series.
      * @param cfun          Indexed Cost function between two points
      * @param window        Warping window
      * @param cutoff        Attempt to prune computation of alignments with cost > cutoff.
      *                      May lead to early abandoning.
-     * @param buffer_v      The buffer used to carry the computation.
+     * @param buffer        The buffer used to carry the computation, of at least (1+nbcols)*2 cells (initialised here).
+     * @param cb            If not null, cumulative lower bound of the lines, as for the unconstrained kernel
      * @return DTW between the two series or +INF if early abandoned.
      */
-    template<typename F>
+    template<typename F, bool EqualLength = false>
     F dtw(const size_t nblines,
           const size_t nbcols,
           utils::ICFun<F> auto cfun,
           const size_t window,
           const F cutoff,
-          std::vector<F>& buffer_v
+          F *buffer,
+          F const *cb = nullptr
     ) {
       // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
       // In debug mode, check preconditions
@@ -175,14 +211,16 @@ namespace tempo::distance::core {
       // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
       // Create a new tighter upper bounds (most commonly used in the code).
       // First, take the "next float" after "cutoff" to deal with numerical instability.
-      // Then, subtract the cost of the last alignment.
-      const F ub = nextafter(cutoff, PINF) - cfun(nblines - 1, nbcols - 1);
+      // Then, subtract the cost of the last alignment, or the cumulative bound of the following lines if larger.
+      const F next_cutoff = nextafter(cutoff, PINF);
+      const F ub_last = next_cutoff - cfun(nblines - 1, nbcols - 1);
+      F ub = ub_last;
+      const F cb_cutoff = (cb==nullptr) ? 0 : next_cutoff + cb_slack<F>(nblines, nbcols, cutoff);
 
       // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
-      // Double buffer allocation, init to +INF.
+      // Double buffer init to +INF.
       // Base indices for the 'c'urrent row and the 'p'revious row. Account for the extra cell (+1 and +2)
-      buffer_v.assign((1 + nbcols)*2, PINF);
-      auto *buffer = buffer_v.data();
+      std::fill_n(buffer, (1 + nbcols)*2, PINF);
       size_t c{0 + 1}, p{nbcols + 2};
 
       // Line & column counters
@@ -204,8 +242,11 @@ namespace tempo::distance::core {
       for (; i<nblines; ++i) {
         // --- --- --- Swap and variables init
         std::swap(c, p);
+        if (cb!=nullptr) { ub = std::min(ub_last, cb_cutoff - cb[i + 1]); }
         const size_t jStart = std::max(cap_start_index_to_window(i, window), next_start);
-        const size_t jStop = cap_stop_index_to_window_or_end(i, window, nbcols);
+        size_t jStop;
+        if constexpr (EqualLength) { jStop = std::min(nbcols, i + window + 1); } // i+window+1 < 2*nbcols
+        else { jStop = cap_stop_index_to_window_or_end(i, window, nbcols); }
         next_start = jStart;
         size_t curr_pp = next_start; // Next pruning point init at the start of the line
         j = next_start;
@@ -272,6 +313,129 @@ namespace tempo::distance::core {
       if (j==nbcols&&cost<=cutoff) { return cost; } else { return PINF; }
     }
 
+    /// DTW EAP with warping window as above, with a buffer allocated as required
+    template<typename F, bool EqualLength = false>
+    F dtw(size_t nblines, size_t nbcols, utils::ICFun<F> auto cfun, size_t window, F cutoff, std::vector<F>& buffer_v,
+          F const *cb = nullptr) {
+      buffer_v.resize((1 + nbcols)*2);
+      return dtw<F, EqualLength>(nblines, nbcols, cfun, window, cutoff, buffer_v.data(), cb);
+    }
+
+    /** DTW with a small warping window (window <= BAND_MAX_WINDOW), computed on the band only.
+     *  The 2*window+1 cells of a line around the diagonal are kept in two small arrays, the cell (i, j) being at
+     *  the offset j-i+window+1 (+INF borders on both sides): the diagonal, top and left neighbours of a cell are at
+     *  the same offset in the previous line, the next one in the previous line, and the previous one in the line.
+     *  No pruning: a line has at most 2*window+1 cells, too few for the EAP bookkeeping to pay off.
+     *  Early abandoned when the minimum of a line is above the cutoff (any alignment crosses all the lines).
+     *  The cells are combined as in the EAP kernels: same result.
+     * @param nblines       Length of the line series, not 0.
+     * @param nbcols        Length of the column series, not 0, within the window of nblines.
+     * @param cfun          Indexed Cost function between two points
+     * @param window        Warping window, at most BAND_MAX_WINDOW
+     * @param cutoff        Early abandoning cutoff - PINF or QNAN for no early abandoning
+     * @param cb            If not null, cumulative lower bound of the lines, as for the EAP kernels: also early
+     *                      abandoned when the minimum of a line plus the bound of the next lines is above the cutoff
+     * @return DTW between the two series or +INF if early abandoned.
+     */
+    template<typename F>
+    F dtw_band(const size_t nblines, const size_t nbcols, utils::ICFun<F> auto cfun, const size_t window,
+               const F cutoff, F const *cb = nullptr) {
+      assert(nblines!=0);
+      assert(nbcols!=0);
+      assert(window<=BAND_MAX_WINDOW);
+      assert(utils::absdiff(nblines, nbcols)<=window);
+      using utils::min;
+      constexpr F PINF = utils::PINF<F>;
+      const F cb_cutoff = (cb==nullptr) ? 0 : cutoff + cb_slack<F>(nblines, nbcols, cutoff);
+      constexpr size_t S = 2*BAND_MAX_WINDOW + 3;
+      // The top left corner (-1, -1) is at the offset window+1 of the line -1
+      std::array<F, S> band_a, band_b;
+      band_a.fill(PINF);
+      band_b.fill(PINF);
+      F *prev = band_a.data();
+      F *curr = band_b.data();
+      prev[window + 1] = 0;
+      // The offsets of the first and last cells of the lines never increase: the cells on the left of a line are
+      // +INF from the initialisation, only the one after the last cell of a line needs to be reset.
+      size_t k{0};
+      for (size_t i{0}; i<nblines; ++i) {
+        const size_t jStart = utils::cap_start_index_to_window(i, window);
+        const size_t jStop = utils::cap_stop_index_to_window_or_end(i, window, nbcols);
+        const size_t kStart = jStart + window + 1 - i;
+        const size_t kStop = jStop + window + 1 - i;
+        F rowmin = PINF;
+        for (k = kStart; k<kStop; ++k) {
+          const F cost = min(curr[k - 1], prev[k], prev[k + 1]) + cfun(i, k + i - window - 1);
+          curr[k] = cost;
+          rowmin = std::min(rowmin, cost);
+        }
+        curr[kStop] = PINF;
+        if (rowmin>cutoff||(cb!=nullptr&&rowmin + cb[i + 1]>cb_cutoff)) { return PINF; }
+        std::swap(prev, curr);
+      }
+      // Last cell of the last line, now in 'prev'
+      const F cost = prev[k - 1];
+      return (cost>cutoff) ? PINF : cost;
+    }
+
+    /** dtw_band for two series of the same length, with the window W known at compile time: the lines away from the
+     *  start and the end of the series have their 2*W+1 cells at the constant offsets [1, 2*W+2[ of the band, a loop
+     *  of constant trip count the compiler unrolls over arrays sized for W. Same cells combined in the same order as
+     *  dtw_band: same result. Selected by dtw_band_equal_length.
+     * @param length        Length of both series, not 0.
+     */
+    template<typename F, size_t W>
+    F dtw_band_fixed(const size_t length, utils::ICFun<F> auto cfun, const F cutoff) {
+      static_assert(W<=BAND_MAX_WINDOW);
+      assert(length!=0);
+      using utils::min;
+      constexpr F PINF = utils::PINF<F>;
+      constexpr size_t S = 2*W + 3;
+      std::array<F, S> band_a, band_b;
+      band_a.fill(PINF);
+      band_b.fill(PINF);
+      F *prev = band_a.data();
+      F *curr = band_b.data();
+      prev[W + 1] = 0;
+      size_t k{0};
+      for (size_t i{0}; i<length; ++i) {
+        F rowmin = PINF;
+        if (i>=W&&i + W<length) {
+          for (k = 1; k<2*W + 2; ++k) {
+            const F cost = min(curr[k - 1], prev[k], prev[k + 1]) + cfun(i, k + i - W - 1);
+            curr[k] = cost;
+            rowmin = std::min(rowmin, cost);
+          }
+        } else {
+          // First and last W lines: truncated by the start and the end of the column series
+          const size_t kStart = (i<W) ? W + 1 - i : 1;
+          const size_t kStop = (i + W<length) ? 2*W + 2 : length + W + 1 - i;
+          for (k = kStart; k<kStop; ++k) {
+            const F cost = min(curr[k - 1], prev[k], prev[k + 1]) + cfun(i, k + i - W - 1);
+            curr[k] = cost;
+            rowmin = std::min(rowmin, cost);
+          }
+        }
+        curr[k] = PINF;
+        if (rowmin>cutoff) { return PINF; }
+        std::swap(prev, curr);
+      }
+      const F cost = prev[k - 1];
+      return (cost>cutoff) ? PINF : cost;
+    }
+
+    /// dtw_band for two series of the same length 'length', not 0, dispatched on the window to the kernel with that
+    /// window baked in (see dtw_band_fixed)
+    template<typename F>
+    F dtw_band_equal_length(const size_t length, utils::ICFun<F> auto cfun, const size_t window, const F cutoff) {
+      assert(window<=BAND_MAX_WINDOW);
+      return [&]<size_t... W>(std::index_sequence<W...>) {
+        F result = utils::PINF<F>;
+        ((window==W ? (result = dtw_band_fixed<F, W>(length, cfun, cutoff), true) : false)||...);
+        return result;
+      }(std::make_index_sequence<BAND_MAX_WINDOW + 1>{});
+    }
+
   } // End of namespace internal
 
   /** Dynamic Time Warping (DTW), Early Abandoned and Pruned (EAP)
@@ -286,15 +450,20 @@ namespace tempo::distance::core {
    *                    ub = QNAN: No cutoff: no pruning nor early abandoning
    *                    ub = other value: use for pruning and early abandoning
    * @param buffers_v   Buffer used to perform the computation. Will reallocate if required.
+   * @param cb          If not null, cumulative lower bound of the lines (the first series), of length1+1 values,
+   *                    tightening the pruning line by line (see internal::dtw). Same result.
+   * @tparam Band       Use the band kernel for the windows <= BAND_MAX_WINDOW (see internal::dtw_band).
+   *                    Same result either way: false forces the EAP kernel, e.g. to time both (see autotune).
    * @return DTW between the two series or +INF if early abandoned.
    */
-  template<typename F>
+  template<typename F, bool Band = true>
   inline F dtw(size_t length1,
                size_t length2,
                utils::ICFun<F> auto cfun,
                size_t window,
                F cutoff,
-               std::vector<F>& buffer_v
+               std::vector<F>& buffer_v,
+               F const *cb = nullptr
   ) {
     constexpr F PINF = utils::PINF<F>;
     if (length1==0&&length2==0) { return 0; }
@@ -304,6 +473,10 @@ namespace tempo::distance::core {
       const auto m = std::min(length1, length2);
       const auto M = std::max(length1, length2);
       if (M - m>window) { return PINF; }
+      // Small windows: band only kernel, without pruning
+      if constexpr (Band) {
+        if (window<=BAND_MAX_WINDOW) { return internal::dtw_band<F>(length1, length2, cfun, window, cutoff, cb); }
+      }
       // Compute a cutoff point using the diagonal - window is valid is large enough to take side steps
       if (std::isinf(cutoff)) {
         cutoff = 0;
@@ -315,9 +488,50 @@ namespace tempo::distance::core {
         else if (length2<length1) { for (size_t i{length2}; i<length1; ++i) { cutoff = cutoff + cfun(i, length2 - 1); }}
       } else if (std::isnan(cutoff)) { cutoff = PINF; }
       // ub computed: choose the version to call
-      if (window>M - 2) { return internal::dtw(length1, length2, cfun, cutoff, buffer_v); }
-      else { return internal::dtw(length1, length2, cfun, window, cutoff, buffer_v); }
+      if (window>M - 2) { return internal::dtw(length1, length2, cfun, cutoff, buffer_v, cb); }
+      else { return internal::dtw(length1, length2, cfun, window, cutoff, buffer_v, cb); }
+    }
+  }
+
+  /** DTW EAP for two series of the same length 'length': same result as dtw(length, length, ...).
+   *  The window always allows an alignment, the initial cutoff only covers the diagonal, and the windowed kernel
+   *  computes the end of the window of a line without overflow checks (see internal::dtw EqualLength).
+   *  Band as for dtw, the band kernel having the window baked in (see internal::dtw_band_equal_length).
+   */
+  template<typename F, bool Band = true>
+  inline F dtw_equal_length(size_t length, utils::ICFun<F> auto cfun, size_t window, F cutoff,
+                            std::vector<F>& buffer_v) {
+    if (length==0) { return 0; }
+    if constexpr (Band) {
+      if (window<=BAND_MAX_WINDOW) { return internal::dtw_band_equal_length<F>(length, cfun, window, cutoff); }
+    }
+    if (std::isinf(cutoff)) {
+      cutoff = 0;
+      for (size_t i{0}; i<length; ++i) { cutoff = cutoff + cfun(i, i); }
+    } else if (std::isnan(cutoff)) { cutoff = utils::PINF<F>; }
+    if (length<2||window>length - 2) { return internal::dtw(length, length, cfun, cutoff, buffer_v); }
+    else { return internal::dtw<F, true>(length, length, cfun, window, cutoff, buffer_v); }
+  }
+
+  /** DTW EAP for two series of the same length 'length' <= N (not checked): same result as dtw_equal_length.
+   *  The double buffer, of a size known at compile time, lives on the stack: no buffer to look up or to resize,
+   *  and the unconstrained kernel does not even initialise it. At most 2*(N+1) cells, i.e. 8KB for N=512 in double.
+   *  Callers dispatch on the runtime length to a few buckets N (see univariate::dtw_equal_length). Band as for dtw.
+   */
+  template<typename F, size_t N, bool Band = true>
+  inline F dtw_fixed_length(size_t length, utils::ICFun<F> auto cfun, size_t window, F cutoff) {
+    assert(length<=N);
+    if (length==0) { return 0; }
+    if constexpr (Band) {
+      if (window<=BAND_MAX_WINDOW) { return internal::dtw_band_equal_length<F>(length, cfun, window, cutoff); }
     }
+    if (std::isinf(cutoff)) {
+      cutoff = 0;
+      for (size_t i{0}; i<length; ++i) { cutoff = cutoff + cfun(i, i); }
+    } else if (std::isnan(cutoff)) { cutoff = utils::PINF<F>; }
+    std::array<F, (N + 1)*2> buffer;
+    if (length<2||window>length - 2) { return internal::dtw<F>(length, length, cfun, cutoff, buffer.data()); }
+    else { return internal::dtw<F, true>(length, length, cfun, window, cutoff, buffer.data()); }
   }
 
   /// Helper for the above without having to provide a buffer
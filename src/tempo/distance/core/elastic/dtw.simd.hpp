@@ -0,0 +1,507 @@
+#pragma once
+
+#include "../simd.private.hpp"
+#include "../../stats.hpp"
+#include "dtw.hpp"
+#include "adtw.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace tempo::distance::core::simd {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Lane parallel DTW and ADTW
+  // The EAP kernels are sequential along a row: they can't be vectorised for one pair of series.
+  // Instead, these kernels compute the cost matrices of one query against several candidates of the same length,
+  // one candidate per SIMD lane. The lanes share the query: the recurrence is the same, lane by lane.
+  // A lane is abandoned when the minimum of a row is above its cutoff (any path crosses all the rows);
+  // the computation stops when all the lanes are abandoned.
+  // A lane gives the same result as the scalar kernel, to the last bit: the callers compare the distances of
+  // candidates evaluated together or one by one (e.g. ties of nearest neighbour searches).
+  //  - The additions are done in the order of the scalar recurrences: the cost is added before the penalty.
+  //    Rounding being monotonic, min(l+d+p, t+d+p) == min(l, t)+d+p for the rounded additions.
+  //  - No floating point contraction (see -ffp-contract=off in the compiler options): an FMA of the square of
+  //    AD2 and the next addition would round differently here and in the scalar kernel.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Maximum number of lanes of the lane parallel kernels
+  constexpr size_t MAX_LANES = 8;
+
+  /// Number of lanes of the lane parallel kernels for an instruction set
+  inline size_t nb_lanes(ISA isa = detected_isa()) {
+    switch (isa) {
+      case ISA::AVX512: return 8;
+      case ISA::AVX2: return 4;
+      case ISA::NEON: return 2;
+      default: return 1;
+    }
+  }
+
+  namespace internal {
+
+    /// Interleave the 'nb' candidates in buffer: buffer[j*lanes + k] = candidates[k][j].
+    /// Unused lanes (k>=nb) repeat the first candidate.
+    inline void interleave(double const *const *candidates, size_t nb, size_t length, size_t lanes, double *buffer) {
+      for (size_t j = 0; j<length; ++j) {
+        double *out = buffer + j*lanes;
+        for (size_t k = 0; k<lanes; ++k) { out[k] = candidates[k<nb ? k : 0][j]; }
+      }
+    }
+
+    /// Scalar fall back: use the reference implementations, one candidate at a time.
+    /// 'penalty' < 0 means DTW with window 'w', else ADTW with 'penalty'.
+    template<CFE e>
+    void lanes_scalar(double const *query, double const *const *candidates, size_t nb, size_t length,
+                      size_t w, double penalty, double const *cutoffs, double *results, std::vector<double>& buffer) {
+      for (size_t k = 0; k<nb; ++k) {
+        double const *c = candidates[k];
+        const auto cfun = stats::counted([c, query](size_t i, size_t j) { return cost<e>(c[i] - query[j]); });
+        if (penalty<0) { results[k] = core::dtw<double>(length, length, cfun, w, cutoffs[k], buffer); }
+        else { results[k] = core::adtw<double>(length, length, cfun, penalty, cutoffs[k], buffer); }
+      }
+    }
+
+    #if defined(TEMPO_SIMD_X86)
+
+    /** Lane parallel DTW or ADTW, AVX2 (4 lanes). Same parameters as lanes_scalar, with interleaved candidates.
+     *  The buffer holds two rows of (length+1) cells of 4 lanes; the first cell of a row is its left border.
+     *  DTW: cell = min(diag, left, top) + d. ADTW: cell = min(diag + d, min(left, top) + d + penalty).
+     *  Cells outside the window stay at +INF.
+     */
+    template<CFE e, bool adtw>
+    __attribute__((target("avx2,fma")))
+    void lanes_avx2(double const *query, double const *cols, size_t nb, size_t length,
+                    size_t w, double penalty, double const *cutoffs, double *results, double *buffer) {
+      constexpr size_t L = 4;
+      constexpr double PINF = utils::PINF<double>;
+      const __m256d vinf = _mm256_set1_pd(PINF);
+      const __m256d vpen = _mm256_set1_pd(penalty);
+      double tmp[L];
+      for (size_t k = 0; k<L; ++k) { tmp[k] = cutoffs[k<nb ? k : 0]; }
+      const __m256d vcut = _mm256_loadu_pd(tmp);
+      // Rows init: +INF, and the top left corner at 0
+      double *prev = buffer;
+      double *curr = buffer + (length + 1)*L;
+      for (size_t n = 0; n<(length + 1)*2; ++n) { _mm256_storeu_pd(buffer + n*L, vinf); }
+      _mm256_storeu_pd(prev, _mm256_setzero_pd());
+      // Rows
+      for (size_t i = 0; i<length; ++i) {
+        const size_t jStart = utils::cap_start_index_to_window(i, w);
+        const size_t jStop = utils::cap_stop_index_to_window_or_end(i, w, length);
+        const __m256d q = _mm256_set1_pd(query[i]);
+        stats::cells((jStop - jStart)*nb);
+        __m256d left = vinf;
+        __m256d rowmin = vinf;
+        _mm256_storeu_pd(curr + jStart*L, vinf);
+        for (size_t j = jStart; j<jStop; ++j) {
+          const __m256d d = cost_avx2<e>(_mm256_sub_pd(_mm256_loadu_pd(cols + j*L), q));
+          const __m256d diag = _mm256_loadu_pd(prev + j*L);
+          const __m256d top = _mm256_loadu_pd(prev + (j + 1)*L);
+          if constexpr (adtw) {
+            const __m256d warp = _mm256_add_pd(_mm256_add_pd(_mm256_min_pd(left, top), d), vpen);
+            left = _mm256_min_pd(_mm256_add_pd(diag, d), warp);
+          } else {
+            left = _mm256_add_pd(_mm256_min_pd(_mm256_min_pd(diag, top), left), d);
+          }
+          _mm256_storeu_pd(curr + (j + 1)*L, left);
+          rowmin = _mm256_min_pd(rowmin, left);
+        }
+        // Stop when all the lanes are above their cutoff
+        if (_mm256_movemask_pd(_mm256_cmp_pd(rowmin, vcut, _CMP_GT_OQ))==0xF) {
+          for (size_t k = 0; k<nb; ++k) { results[k] = PINF; }
+          return;
+        }
+        std::swap(prev, curr);
+      }
+      _mm256_storeu_pd(tmp, _mm256_loadu_pd(prev + length*L));
+      for (size_t k = 0; k<nb; ++k) { results[k] = (tmp[k]>cutoffs[k]) ? PINF : tmp[k]; }
+    }
+
+    /// Lane parallel DTW or ADTW, AVX-512 (8 lanes). See lanes_avx2.
+    template<CFE e, bool adtw>
+    __attribute__((target("avx512f")))
+    void lanes_avx512(double const *query, double const *cols, size_t nb, size_t length,
+                      size_t w, double penalty, double const *cutoffs, double *results, double *buffer) {
+      constexpr size_t L = 8;
+      constexpr double PINF = utils::PINF<double>;
+      const __m512d vinf = _mm512_set1_pd(PINF);
+      const __m512d vpen = _mm512_set1_pd(penalty);
+      double tmp[L];
+      for (size_t k = 0; k<L; ++k) { tmp[k] = cutoffs[k<nb ? k : 0]; }
+      const __m512d vcut = _mm512_loadu_pd(tmp);
+      // Rows init: +INF, and the top left corner at 0
+      double *prev = buffer;
+      double *curr = buffer + (length + 1)*L;
+      for (size_t n = 0; n<(length + 1)*2; ++n) { _mm512_storeu_pd(buffer + n*L, vinf); }
+      _mm512_storeu_pd(prev, _mm512_setzero_pd());
+      // Rows
+      for (size_t i = 0; i<length; ++i) {
+        const size_t jStart = utils::cap_start_index_to_window(i, w);
+        const size_t jStop = utils::cap_stop_index_to_window_or_end(i, w, length);
+        const __m512d q = _mm512_set1_pd(query[i]);
+        stats::cells((jStop - jStart)*nb);
+        __m512d left = vinf;
+        __m512d rowmin = vinf;
+        _mm512_storeu_pd(curr + jStart*L, vinf);
+        for (size_t j = jStart; j<jStop; ++j) {
+          const __m512d d = cost_avx512<e>(_mm512_sub_pd(_mm512_loadu_pd(cols + j*L), q));
+          const __m512d diag = _mm512_loadu_pd(prev + j*L);
+          const __m512d top = _mm512_loadu_pd(prev + (j + 1)*L);
+          if constexpr (adtw) {
+            const __m512d warp = _mm512_add_pd(_mm512_add_pd(_mm512_min_pd(left, top), d), vpen);
+            left = _mm512_min_pd(_mm512_add_pd(diag, d), warp);
+          } else {
+            left = _mm512_add_pd(_mm512_min_pd(_mm512_min_pd(diag, top), left), d);
+          }
+          _mm512_storeu_pd(curr + (j + 1)*L, left);
+          rowmin = _mm512_min_pd(rowmin, left);
+        }
+        // Stop when all the lanes are above their cutoff
+        if (_mm512_cmp_pd_mask(rowmin, vcut, _CMP_GT_OQ)==0xFF) {
+          for (size_t k = 0; k<nb; ++k) { results[k] = PINF; }
+          return;
+        }
+        std::swap(prev, curr);
+      }
+      _mm512_storeu_pd(tmp, _mm512_loadu_pd(prev + length*L));
+      for (size_t k = 0; k<nb; ++k) { results[k] = (tmp[k]>cutoffs[k]) ? PINF : tmp[k]; }
+    }
+
+    #endif
+
+    #if defined(TEMPO_SIMD_ARM)
+
+    /// Lane parallel DTW or ADTW, NEON (2 lanes). See lanes_avx2.
+    template<CFE e, bool adtw>
+    void lanes_neon(double const *query, double const *cols, size_t nb, size_t length,
+                    size_t w, double penalty, double const *cutoffs, double *results, double *buffer) {
+      constexpr size_t L = 2;
+      constexpr double PINF = utils::PINF<double>;
+      const float64x2_t vinf = vdupq_n_f64(PINF);
+      const float64x2_t vpen = vdupq_n_f64(penalty);
+      double tmp[L];
+      for (size_t k = 0; k<L; ++k) { tmp[k] = cutoffs[k<nb ? k : 0]; }
+      const float64x2_t vcut = vld1q_f64(tmp);
+      // Rows init: +INF, and the top left corner at 0
+      double *prev = buffer;
+      double *curr = buffer + (length + 1)*L;
+      for (size_t n = 0; n<(length + 1)*2; ++n) { vst1q_f64(buffer + n*L, vinf); }
+      vst1q_f64(prev, vdupq_n_f64(0));
+      // Rows
+      for (size_t i = 0; i<length; ++i) {
+        const size_t jStart = utils::cap_start_index_to_window(i, w);
+        const size_t jStop = utils::cap_stop_index_to_window_or_end(i, w, length);
+        const float64x2_t q = vdupq_n_f64(query[i]);
+        stats::cells((jStop - jStart)*nb);
+        float64x2_t left = vinf;
+        float64x2_t rowmin = vinf;
+        vst1q_f64(curr + jStart*L, vinf);
+        for (size_t j = jStart; j<jStop; ++j) {
+          const float64x2_t d = cost_neon<e>(vsubq_f64(vld1q_f64(cols + j*L), q));
+          const float64x2_t diag = vld1q_f64(prev + j*L);
+          const float64x2_t top = vld1q_f64(prev + (j + 1)*L);
+          if constexpr (adtw) {
+            const float64x2_t warp = vaddq_f64(vaddq_f64(vminq_f64(left, top), d), vpen);
+            left = vminq_f64(vaddq_f64(diag, d), warp);
+          } else {
+            left = vaddq_f64(vminq_f64(vminq_f64(diag, top), left), d);
+          }
+          vst1q_f64(curr + (j + 1)*L, left);
+          rowmin = vminq_f64(rowmin, left);
+        }
+        // Stop when all the lanes are above their cutoff
+        const uint64x2_t above = vcgtq_f64(rowmin, vcut);
+        if ((vgetq_lane_u64(above, 0)&vgetq_lane_u64(above, 1))!=0) {
+          for (size_t k = 0; k<nb; ++k) { results[k] = PINF; }
+          return;
+        }
+        std::swap(prev, curr);
+      }
+      vst1q_f64(tmp, vld1q_f64(prev + length*L));
+      for (size_t k = 0; k<nb; ++k) { results[k] = (tmp[k]>cutoffs[k]) ? PINF : tmp[k]; }
+    }
+
+    #endif
+
+    template<CFE e, bool adtw>
+    void lanes(ISA isa, double const *query, double const *const *candidates, size_t nb, size_t length,
+               size_t w, double penalty, double const *cutoffs, double *results, std::vector<double>& buffer) {
+      #if defined(TEMPO_SIMD_X86)
+      if (isa==ISA::AVX2||isa==ISA::AVX512) {
+        // Buffer: interleaved candidates, then two rows
+        const size_t L = nb_lanes(isa);
+        buffer.resize(length*L + (length + 1)*L*2);
+        interleave(candidates, nb, length, L, buffer.data());
+        double const *cols = buffer.data();
+        double *rows = buffer.data() + length*L;
+        if (isa==ISA::AVX512) { lanes_avx512<e, adtw>(query, cols, nb, length, w, penalty, cutoffs, results, rows); }
+        else { lanes_avx2<e, adtw>(query, cols, nb, length, w, penalty, cutoffs, results, rows); }
+        return;
+      }
+      #endif
+      #if defined(TEMPO_SIMD_ARM)
+      if (isa==ISA::NEON) {
+        constexpr size_t L = 2;
+        buffer.resize(length*L + (length + 1)*L*2);
+        interleave(candidates, nb, length, L, buffer.data());
+        lanes_neon<e, adtw>(query, buffer.data(), nb, length, w, penalty, cutoffs, results, buffer.data() + length*L);
+        return;
+      }
+      #endif
+      lanes_scalar<e>(query, candidates, nb, length, w, adtw ? penalty : -1, cutoffs, results, buffer);
+    }
+
+  } // End of namespace internal
+
+  /** DTW between a query and 'nb' candidates of the same length, computed in lockstep in SIMD lanes.
+   * @param query       Pointer to the query
+   * @param candidates  Pointers to the candidates
+   * @param nb          Number of candidates, at most nb_lanes(isa)
+   * @param length      Length of the query and of all the candidates
+   * @param e           Cost function exponent
+   * @param w           Warping window
+   * @param cutoffs     Per candidate early abandoning cutoff - PINF for no early abandoning
+   * @param results     Output: results[k] is the DTW between candidates[k] and the query, or +INF if above cutoffs[k]
+   * @param buffer      Buffer used to carry the computation
+   * @param isa         Instruction set to use, default to the detected one. Must be supported by the CPU (not checked).
+   * The order of the operations follows the recurrence: for a lane, the result is the same as core::dtw.
+   */
+  inline void dtw_lanes(double const *query, double const *const *candidates, size_t nb, size_t length,
+                        CFE e, size_t w, double const *cutoffs, double *results, std::vector<double>& buffer,
+                        ISA isa = detected_isa()) {
+    assert(nb<=nb_lanes(isa));
+    if (nb==0) { return; }
+    if (length==0) {
+      for (size_t k = 0; k<nb; ++k) { results[k] = 0; }
+      return;
+    }
+    const auto run = [&]<CFE c>() {
+      internal::lanes<c, false>(isa, query, candidates, nb, length, w, 0, cutoffs, results, buffer);
+    };
+    switch (e) {
+      case CFE::AD1: return run.template operator()<CFE::AD1>();
+      case CFE::AD2: return run.template operator()<CFE::AD2>();
+      default: return run.template operator()<CFE::SQRT>();
+    }
+  }
+
+  /** ADTW between a query and 'nb' candidates of the same length, computed in lockstep in SIMD lanes.
+   *  Same parameters as dtw_lanes, with the warping 'penalty' (>=0) instead of a window.
+   *  As core::adtw, the cost is added before the penalty: for a lane, the result is the same as core::adtw.
+   */
+  inline void adtw_lanes(double const *query, double const *const *candidates, size_t nb, size_t length,
+                         CFE e, double penalty, double const *cutoffs, double *results, std::vector<double>& buffer,
+                         ISA isa = detected_isa()) {
+    assert(nb<=nb_lanes(isa));
+    assert(penalty>=0);
+    if (nb==0) { return; }
+    if (length==0) {
+      for (size_t k = 0; k<nb; ++k) { results[k] = 0; }
+      return;
+    }
+    const auto run = [&]<CFE c>() {
+      internal::lanes<c, true>(isa, query, candidates, nb, length, utils::NO_WINDOW, penalty, cutoffs, results, buffer);
+    };
+    switch (e) {
+      case CFE::AD1: return run.template operator()<CFE::AD1>();
+      case CFE::AD2: return run.template operator()<CFE::AD2>();
+      default: return run.template operator()<CFE::SQRT>();
+    }
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // DTW under the three cost function exponents
+  // The costs of a cell under the exponents 0.5, 1 and 2 derive from the same difference |a_i-b_j|: dtw_cfes
+  // computes the differences of a row once, vectorised along the row, derives the three cost rows, then advances
+  // the three recurrences in the same pass over the row (three independent dependency chains).
+  // A recurrence is abandoned when the minimum of its row is above its cutoff; the computation stops when the three
+  // are abandoned.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Number of exponents of dtw_cfes, in the order of CFE: SQRT (0.5), AD1 (1), AD2 (2)
+  constexpr size_t NB_CFES = 3;
+
+  namespace internal {
+
+    /// Cost rows of a_i against b[start..stop[, one per exponent
+    inline void cost_rows_scalar(double ai, double const *b, size_t start, size_t stop,
+                                 double *c_sqrt, double *c_ad1, double *c_ad2) {
+      for (size_t j = start; j<stop; ++j) {
+        const double d = std::abs(b[j] - ai);
+        c_ad1[j] = d;
+        c_ad2[j] = d*d;
+        c_sqrt[j] = std::sqrt(d);
+      }
+    }
+
+    #if defined(TEMPO_SIMD_X86)
+
+    /// Cost rows, AVX2 (see cost_rows_scalar)
+    __attribute__((target("avx2,fma")))
+    inline void cost_rows_avx2(double ai, double const *b, size_t start, size_t stop,
+                               double *c_sqrt, double *c_ad1, double *c_ad2) {
+      const __m256d va = _mm256_set1_pd(ai);
+      const __m256d sign = _mm256_set1_pd(-0.0);
+      size_t j = start;
+      for (; j + 4<=stop; j += 4) {
+        const __m256d d = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(b + j), va));
+        _mm256_storeu_pd(c_ad1 + j, d);
+        _mm256_storeu_pd(c_ad2 + j, _mm256_mul_pd(d, d));
+        _mm256_storeu_pd(c_sqrt + j, _mm256_sqrt_pd(d));
+      }
+      cost_rows_scalar(ai, b, j, stop, c_sqrt, c_ad1, c_ad2);
+    }
+
+    /// Cost rows, AVX-512 (see cost_rows_scalar)
+    __attribute__((target("avx512f")))
+    inline void cost_rows_avx512(double ai, double const *b, size_t start, size_t stop,
+                                 double *c_sqrt, double *c_ad1, double *c_ad2) {
+      const __m512d va = _mm512_set1_pd(ai);
+      size_t j = start;
+      for (; j + 8<=stop; j += 8) {
+        const __m512d d = _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(b + j), va));
+        _mm512_storeu_pd(c_ad1 + j, d);
+        _mm512_storeu_pd(c_ad2 + j, _mm512_mul_pd(d, d));
+        _mm512_storeu_pd(c_sqrt + j, _mm512_sqrt_pd(d));
+      }
+      cost_rows_scalar(ai, b, j, stop, c_sqrt, c_ad1, c_ad2);
+    }
+
+    #endif
+
+    #if defined(TEMPO_SIMD_ARM)
+
+    /// Cost rows, NEON (see cost_rows_scalar)
+    inline void cost_rows_neon(double ai, double const *b, size_t start, size_t stop,
+                               double *c_sqrt, double *c_ad1, double *c_ad2) {
+      const float64x2_t va = vdupq_n_f64(ai);
+      size_t j = start;
+      for (; j + 2<=stop; j += 2) {
+        const float64x2_t d = vabsq_f64(vsubq_f64(vld1q_f64(b + j), va));
+        vst1q_f64(c_ad1 + j, d);
+        vst1q_f64(c_ad2 + j, vmulq_f64(d, d));
+        vst1q_f64(c_sqrt + j, vsqrtq_f64(d));
+      }
+      cost_rows_scalar(ai, b, j, stop, c_sqrt, c_ad1, c_ad2);
+    }
+
+    #endif
+
+    inline void cost_rows(ISA isa, double ai, double const *b, size_t start, size_t stop,
+                          double *c_sqrt, double *c_ad1, double *c_ad2) {
+      #if defined(TEMPO_SIMD_X86)
+      if (isa==ISA::AVX512) { return cost_rows_avx512(ai, b, start, stop, c_sqrt, c_ad1, c_ad2); }
+      if (isa==ISA::AVX2) { return cost_rows_avx2(ai, b, start, stop, c_sqrt, c_ad1, c_ad2); }
+      #endif
+      #if defined(TEMPO_SIMD_ARM)
+      if (isa==ISA::NEON) { return cost_rows_neon(ai, b, start, stop, c_sqrt, c_ad1, c_ad2); }
+      #endif
+      cost_rows_scalar(ai, b, start, stop, c_sqrt, c_ad1, c_ad2);
+    }
+
+  } // End of namespace internal
+
+  /** DTW between two series of the same length under the exponents 0.5, 1 and 2 of the cost function, in one pass.
+   * @param a               Pointer to the first series
+   * @param b               Pointer to the second series
+   * @param length          Length of both series
+   * @param w               Warping window
+   * @param cutoffs         Per exponent early abandoning cutoff (in the order of CFE) - PINF for no early abandoning.
+   *                        A negative cutoff (e.g. -INF) skips the exponent.
+   * @param results         Output: results[k] is the DTW under the k-th exponent, or +INF if above cutoffs[k]
+   * @param max_deviations  Optional output: max deviation from the diagonal of the warping path of each result
+   *                        (see univariate::dtw_wr), meaningless if the result is +INF
+   * @param buffer          Buffer used to carry the computation
+   * @param isa             Instruction set of the cost rows, default to the detected one.
+   *                        Must be supported by the CPU (not checked).
+   * The results are the ones of core::dtw for each exponent: the recurrences are the same, only the costs are shared.
+   */
+  inline void dtw_cfes(double const *a, double const *b, size_t length, size_t w, double const *cutoffs,
+                       double *results, size_t *max_deviations, std::vector<double>& buffer,
+                       ISA isa = detected_isa()) {
+    constexpr size_t K = NB_CFES;
+    constexpr double PINF = utils::PINF<double>;
+    if (length==0) {
+      for (size_t k = 0; k<K; ++k) {
+        results[k] = cutoffs[k]<0 ? PINF : 0;
+        if (max_deviations!=nullptr) { max_deviations[k] = 0; }
+      }
+      return;
+    }
+    // Buffer: the cost rows, then per exponent two rows of costs and two rows of max deviations (as double),
+    // of (length+1) cells; the first cell of a row is its left border.
+    const size_t R = length + 1;
+    buffer.resize(K*length + K*4*R);
+    double *costs = buffer.data();
+    double *prev[K], *curr[K], *prevd[K], *currd[K];
+    bool active[K];
+    size_t nb_active = 0;
+    for (size_t k = 0; k<K; ++k) {
+      prev[k] = costs + K*length + k*4*R;
+      curr[k] = prev[k] + R;
+      prevd[k] = curr[k] + R;
+      currd[k] = prevd[k] + R;
+      std::fill(prev[k], prev[k] + 2*R, PINF);
+      std::fill(prevd[k], prevd[k] + 2*R, 0.0);
+      prev[k][0] = 0;
+      active[k] = !(cutoffs[k]<0);
+      results[k] = PINF;
+      nb_active += active[k];
+    }
+    // Rows
+    for (size_t i = 0; i<length && nb_active>0; ++i) {
+      const size_t jStart = utils::cap_start_index_to_window(i, w);
+      const size_t jStop = utils::cap_stop_index_to_window_or_end(i, w, length);
+      internal::cost_rows(isa, a[i], b, jStart, jStop, costs, costs + length, costs + 2*length);
+      stats::cells((jStop - jStart)*nb_active);
+      double left[K], leftd[K], rowmin[K];
+      for (size_t k = 0; k<K; ++k) {
+        left[k] = PINF;
+        leftd[k] = 0;
+        rowmin[k] = PINF;
+        curr[k][jStart] = PINF;
+      }
+      for (size_t j = jStart; j<jStop; ++j) {
+        const double deviation = (double)(i>j ? i - j : j - i);
+        for (size_t k = 0; k<K; ++k) {
+          if (!active[k]) { continue; }
+          // Best of diag, top and left, with the max deviation of its path
+          double m = prev[k][j];
+          double md = prevd[k][j];
+          if (prev[k][j + 1]<m) {
+            m = prev[k][j + 1];
+            md = prevd[k][j + 1];
+          }
+          if (left[k]<m) {
+            m = left[k];
+            md = leftd[k];
+          }
+          left[k] = m + costs[k*length + j];
+          leftd[k] = std::max(md, deviation);
+          curr[k][j + 1] = left[k];
+          currd[k][j + 1] = leftd[k];
+          rowmin[k] = std::min(rowmin[k], left[k]);
+        }
+      }
+      for (size_t k = 0; k<K; ++k) {
+        if (!active[k]) { continue; }
+        if (rowmin[k]>cutoffs[k]) {
+          active[k] = false;
+          --nb_active;
+        } else {
+          std::swap(prev[k], curr[k]);
+          std::swap(prevd[k], currd[k]);
+        }
+      }
+    }
+    for (size_t k = 0; k<K; ++k) {
+      if (!active[k]) { continue; }
+      const double r = prev[k][length];
+      results[k] = (r>cutoffs[k]) ? PINF : r;
+      if (max_deviations!=nullptr) { max_deviations[k] = (size_t)prevd[k][length]; }
+    }
+  }
+
+} // End of namespace tempo::distance::core::simd
@@ -0,0 +1,184 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "dtw.simd.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <vector>
+
+using namespace tempo::distance;
+using namespace tempo::distance::core;
+
+using F = double;
+
+constexpr size_t nbitems = 300;
+constexpr F PINF = utils::PINF<F>;
+
+namespace {
+
+  /// All the instruction sets usable on this CPU
+  std::vector<simd::ISA> available_isa() {
+    std::vector<simd::ISA> result{simd::ISA::SCALAR};
+    const auto detected = simd::detected_isa();
+    if (detected==simd::ISA::AVX2||detected==simd::ISA::AVX512) { result.push_back(simd::ISA::AVX2); }
+    if (detected==simd::ISA::AVX512) { result.push_back(simd::ISA::AVX512); }
+    if (detected==simd::ISA::NEON) { result.push_back(simd::ISA::NEON); }
+    return result;
+  }
+
+  const std::vector<F> exponents{0.5, 1, 2};
+
+  /// Reference cost function
+  template<typename V>
+  auto cfun(F e, V const& s1, V const& s2) {
+    return [e, &s1, &s2](size_t i, size_t j) { return std::pow(std::abs(s1[i] - s2[j]), e); };
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+TEST_CASE("Univariate SIMD lane parallel DTW and ADTW", "[dtw][adtw][simd][univariate]") {
+  // Setup univariate with fixed length
+  mock::Mocker mocker(0);
+  mocker._fixl = 53;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t length = mocker._fixl;
+  std::vector<F> buffer;
+  std::vector<F> ref_buffer;
+
+  SECTION("dtw_lanes and adtw_lanes, no cutoff") {
+    for (const auto isa : available_isa()) {
+      const size_t L = simd::nb_lanes(isa);
+      for (const F e : exponents) {
+        simd::CFE cfe;
+        REQUIRE(simd::to_cfe(e, cfe));
+        for (const size_t w : {size_t(0), size_t(5), utils::NO_WINDOW}) {
+          for (size_t q = 0; q + L<nbitems; q += 7) {
+            // Candidates q+1 ... q+nb, with nb in [1, L]
+            const size_t nb = 1 + q%L;
+            std::vector<F const *> cands;
+            for (size_t k = 0; k<nb; ++k) { cands.push_back(fset[q + 1 + k].data()); }
+            std::vector<F> cutoffs(nb, PINF);
+            std::vector<F> results(nb);
+            std::vector<F> scalar(nb);
+            simd::dtw_lanes(fset[q].data(), cands.data(), nb, length, cfe, w, cutoffs.data(), results.data(),
+                            buffer, isa);
+            for (size_t k = 0; k<nb; ++k) {
+              simd::dtw_lanes(fset[q].data(), &cands[k], 1, length, cfe, w, &cutoffs[k], &scalar[k], buffer,
+                              simd::ISA::SCALAR);
+            }
+            for (size_t k = 0; k<nb; ++k) {
+              const auto& c = fset[q + 1 + k];
+              const F ref = dtw<F>(length, length, cfun(e, c, fset[q]), w, PINF, ref_buffer);
+              REQUIRE(results[k]==Catch::Approx(ref));
+              // Same as the scalar kernel, to the last bit
+              REQUIRE(results[k]==scalar[k]);
+            }
+            const F penalty = 0.1*(F)(q%5);
+            simd::adtw_lanes(fset[q].data(), cands.data(), nb, length, cfe, penalty, cutoffs.data(),
+                             results.data(), buffer, isa);
+            for (size_t k = 0; k<nb; ++k) {
+              simd::adtw_lanes(fset[q].data(), &cands[k], 1, length, cfe, penalty, &cutoffs[k], &scalar[k], buffer,
+                               simd::ISA::SCALAR);
+            }
+            for (size_t k = 0; k<nb; ++k) {
+              const auto& c = fset[q + 1 + k];
+              const F ref = adtw<F>(length, length, cfun(e, c, fset[q]), penalty, PINF, ref_buffer);
+              REQUIRE(results[k]==Catch::Approx(ref));
+              REQUIRE(results[k]==scalar[k]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  SECTION("dtw_lanes per lane cutoff") {
+    for (const auto isa : available_isa()) {
+      const size_t L = simd::nb_lanes(isa);
+      for (const F e : exponents) {
+        simd::CFE cfe;
+        REQUIRE(simd::to_cfe(e, cfe));
+        const size_t w = 5;
+        for (size_t q = 0; q + L<nbitems; q += 11) {
+          std::vector<F const *> cands;
+          std::vector<F> refs;
+          std::vector<F> cutoffs;
+          for (size_t k = 0; k<L; ++k) {
+            const auto& c = fset[q + 1 + k];
+            cands.push_back(c.data());
+            refs.push_back(dtw<F>(length, length, cfun(e, c, fset[q]), w, PINF, ref_buffer));
+            // Half of the lanes are below their cutoff
+            cutoffs.push_back(k%2==0 ? refs.back()*1.01 : refs.back()*0.9);
+          }
+          std::vector<F> results(L);
+          simd::dtw_lanes(fset[q].data(), cands.data(), L, length, cfe, w, cutoffs.data(), results.data(),
+                          buffer, isa);
+          for (size_t k = 0; k<L; ++k) {
+            if (k%2==0) { REQUIRE(results[k]==Catch::Approx(refs[k])); }
+            else { REQUIRE(results[k]==PINF); }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Univariate DTW under the three cost function exponents", "[dtw][simd][univariate]") {
+  // Setup univariate with fixed length
+  mock::Mocker mocker(0);
+  mocker._fixl = 53;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t length = mocker._fixl;
+  std::vector<F> buffer;
+  std::vector<F> ref_buffer;
+
+  SECTION("dtw_cfes, no cutoff") {
+    for (const auto isa : available_isa()) {
+      for (const size_t w : {size_t(0), size_t(5), utils::NO_WINDOW}) {
+        for (size_t q = 0; q + 1<nbitems; q += 3) {
+          const auto& a = fset[q];
+          const auto& b = fset[q + 1];
+          const F cutoffs[simd::NB_CFES]{PINF, PINF, PINF};
+          F results[simd::NB_CFES];
+          size_t deviations[simd::NB_CFES];
+          simd::dtw_cfes(a.data(), b.data(), length, w, cutoffs, results, deviations, buffer, isa);
+          for (size_t k = 0; k<simd::NB_CFES; ++k) {
+            const F ref = dtw<F>(length, length, cfun(exponents[k], a, b), w, PINF, ref_buffer);
+            REQUIRE(results[k]==Catch::Approx(ref));
+            // Same DTW at the max deviation of the warping path
+            const F at_deviation = dtw<F>(length, length, cfun(exponents[k], a, b), deviations[k], PINF, ref_buffer);
+            REQUIRE(at_deviation==Catch::Approx(ref));
+          }
+        }
+      }
+    }
+  }
+
+  SECTION("dtw_cfes per exponent cutoff") {
+    for (const auto isa : available_isa()) {
+      const size_t w = 5;
+      for (size_t q = 0; q + 1<nbitems; q += 11) {
+        const auto& a = fset[q];
+        const auto& b = fset[q + 1];
+        F refs[simd::NB_CFES];
+        F cutoffs[simd::NB_CFES];
+        for (size_t k = 0; k<simd::NB_CFES; ++k) {
+          refs[k] = dtw<F>(length, length, cfun(exponents[k], a, b), w, PINF, ref_buffer);
+          // One exponent below its cutoff, one above, one skipped, in turn
+          const size_t mode = (k + q)%3;
+          cutoffs[k] = mode==0 ? refs[k]*1.01 : (mode==1 ? refs[k]*0.9 : -PINF);
+        }
+        F results[simd::NB_CFES];
+        simd::dtw_cfes(a.data(), b.data(), length, w, cutoffs, results, nullptr, buffer, isa);
+        for (size_t k = 0; k<simd::NB_CFES; ++k) {
+          if ((k + q)%3==0) { REQUIRE(results[k]==Catch::Approx(refs[k])); }
+          else { REQUIRE(results[k]==PINF); }
+        }
+      }
+    }
+  }
+}
@@ -1,6 +1,8 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "dtw.hpp"
+#include "dtw_lb_keogh.hpp"
+#include "dtw_lb_improved.hpp"
 
 #include <mock/mockseries.hpp>
 
@@ -12,7 +14,7 @@ using namespace tempo::distance::core;
 using F = double;
 
 constexpr size_t nbitems = 500;
-constexpr auto cfun = univariate::idx_ad2<F, std::vector<F>>;
+constexpr auto cfun = tempo::distance::univariate::idx_ad2<F, std::vector<F>>;
 constexpr F PINF = utils::PINF<F>;
 
 
@@ -289,4 +291,227 @@ TEST_CASE("Univariate DTW Variable length", "[dtw][univariate]") {
     }// End query loop
   }// End section
 
-}
\ No newline at end of file
+}
+TEST_CASE("Univariate DTW Equal length kernel", "[dtw][univariate]") {
+  mock::Mocker mocker;
+  const size_t l = 20;
+  mocker._fixl = l;
+  const auto& wratios = mocker.wratios;
+  const auto fset = mocker.vec_randvec(nbitems);
+  std::vector<F> buffer;
+
+  SECTION("Same as DTW") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (double wr : wratios) {
+        const auto w = (size_t)(wr*l);
+        INFO("Same cells in the same order. Expect exact floating point equality.");
+        const F v = dtw(l, l, cfun(s1, s2), w, PINF);
+        REQUIRE(dtw_equal_length(l, cfun(s1, s2), w, PINF, buffer)==v);
+        REQUIRE(dtw_equal_length(l, cfun(s1, s2), utils::NO_WINDOW, PINF, buffer)
+                ==dtw(l, l, cfun(s1, s2), utils::NO_WINDOW, PINF));
+        // Same early abandoning decisions, with the cutoff on both sides of the result
+        for (F cutoff : {v*0.9, v, v*1.1}) {
+          REQUIRE(dtw_equal_length(l, cfun(s1, s2), w, cutoff, buffer)==dtw(l, l, cfun(s1, s2), w, cutoff));
+        }
+      }
+    }
+  }
+
+  SECTION("Fixed length kernel same as the equal length one") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (double wr : wratios) {
+        const auto w = (size_t)(wr*l);
+        const F v = dtw_equal_length(l, cfun(s1, s2), w, PINF, buffer);
+        REQUIRE(dtw_fixed_length<F, 64>(l, cfun(s1, s2), w, PINF)==v);
+        REQUIRE(dtw_fixed_length<F, 64>(l, cfun(s1, s2), utils::NO_WINDOW, PINF)
+                ==dtw_equal_length(l, cfun(s1, s2), utils::NO_WINDOW, PINF, buffer));
+        for (F cutoff : {v*0.9, v, v*1.1}) {
+          REQUIRE(dtw_fixed_length<F, 64>(l, cfun(s1, s2), w, cutoff)
+                  ==dtw_equal_length(l, cfun(s1, s2), w, cutoff, buffer));
+        }
+      }
+    }
+    // Any length up to the bucket
+    mocker._fixl = 64;
+    const auto fset64 = mocker.vec_randvec(2);
+    for (size_t len : {1, 2, 33, 64}) {
+      const F v = dtw_equal_length(len, cfun(fset64[0], fset64[1]), 5, PINF, buffer);
+      REQUIRE(dtw_fixed_length<F, 64>(len, cfun(fset64[0], fset64[1]), 5, PINF)==v);
+    }
+  }
+
+}
+
+TEST_CASE("Univariate DTW Band kernel", "[dtw][univariate]") {
+  mock::Mocker mocker;
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+  std::vector<F> buffer;
+
+  SECTION("Same as the EAP kernel") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (size_t w = 0; w<=BAND_MAX_WINDOW; ++w) {
+        if (utils::absdiff(s1.size(), s2.size())>w) { continue; }
+        INFO("Same cells combined in the same order. Expect exact floating point equality.");
+        const F v = internal::dtw<F>(s1.size(), s2.size(), cfun(s1, s2), w, PINF, buffer);
+        REQUIRE(internal::dtw_band<F>(s1.size(), s2.size(), cfun(s1, s2), w, PINF)==v);
+        REQUIRE(dtw(s1.size(), s2.size(), cfun(s1, s2), w, PINF)==ref::cdtw_matrix(s1, s2, (long)w));
+        // Same early abandoning decisions, with the cutoff on both sides of the result
+        for (F cutoff : {v*0.9, v, v*1.1}) {
+          REQUIRE(internal::dtw_band<F>(s1.size(), s2.size(), cfun(s1, s2), w, cutoff)
+                  ==internal::dtw<F>(s1.size(), s2.size(), cfun(s1, s2), w, cutoff, buffer));
+        }
+      }
+    }
+  }
+
+  SECTION("Fixed window kernel same as the band kernel") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      // Equal length, including the lengths shorter than the window
+      const size_t l = std::min(s1.size(), s2.size());
+      for (size_t len : {size_t(1), size_t(2), l/2, l}) {
+        for (size_t w = 0; w<=BAND_MAX_WINDOW; ++w) {
+          INFO("Same cells combined in the same order. Expect exact floating point equality.");
+          const F v = internal::dtw_band<F>(len, len, cfun(s1, s2), w, PINF);
+          REQUIRE(internal::dtw_band_equal_length<F>(len, cfun(s1, s2), w, PINF)==v);
+          for (F cutoff : {v*0.9, v, v*1.1}) {
+            REQUIRE(internal::dtw_band_equal_length<F>(len, cfun(s1, s2), w, cutoff)
+                    ==internal::dtw_band<F>(len, len, cfun(s1, s2), w, cutoff));
+          }
+        }
+      }
+    }
+  }
+
+  SECTION("Same with the band kernel turned off") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      const std::vector<F> r1(s1.rbegin(), s1.rend());
+      for (size_t w = 0; w<=BAND_MAX_WINDOW; ++w) {
+        const F v = dtw<F>(s1.size(), s2.size(), cfun(s1, s2), w, PINF, buffer);
+        REQUIRE(dtw<F, false>(s1.size(), s2.size(), cfun(s1, s2), w, PINF, buffer)==v);
+        REQUIRE(dtw_equal_length<F, false>(s1.size(), cfun(s1, r1), w, PINF, buffer)
+                ==dtw_equal_length<F>(s1.size(), cfun(s1, r1), w, PINF, buffer));
+      }
+    }
+  }
+
+}
+
+TEST_CASE("Univariate DTW Cumulative lower bound", "[dtw][univariate]") {
+  mock::Mocker mocker;
+  mocker._fixl = 40;
+  const auto& wratios = mocker.wratios;
+  const auto fset = mocker.vec_randvec(nbitems);
+  constexpr auto cf = tempo::distance::univariate::ad2<F>;
+  std::vector<F> buffer;
+  std::vector<F> upper(mocker._fixl);
+  std::vector<F> lower(mocker._fixl);
+  std::vector<F> cb(mocker._fixl + 1);
+
+  SECTION("Same as without the bound") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (double wr : wratios) {
+        const auto w = (size_t)(wr*mocker._fixl);
+        core::univariate::get_keogh_envelopes(s2.data(), s2.size(), upper.data(), lower.data(), w);
+        const F lb = core::univariate::lb_Keogh_cumulative(s1.data(), s1.size(), upper.data(), lower.data(), cf,
+                                                           cb.data());
+        REQUIRE(cb[s1.size()]==0);
+        REQUIRE(lb==cb[0]);
+        const F v = dtw(s1.size(), s2.size(), cfun(s1, s2), w, PINF, buffer);
+        REQUIRE(dtw(s1.size(), s2.size(), cfun(s1, s2), w, PINF, buffer, cb.data())==v);
+        REQUIRE(dtw<F, false>(s1.size(), s2.size(), cfun(s1, s2), w, PINF, buffer, cb.data())==v);
+        // Same early abandoning decisions, with the cutoff on both sides of the result: ties are still computed
+        for (F cutoff : {v*0.9, v, v*1.1}) {
+          REQUIRE(dtw(s1.size(), s2.size(), cfun(s1, s2), w, cutoff, buffer, cb.data())
+                  ==dtw(s1.size(), s2.size(), cfun(s1, s2), w, cutoff, buffer));
+        }
+      }
+    }
+  }
+
+  SECTION("NN1 CDTW") {
+    for (size_t i = 0; i<nbitems; i += 3) {
+      const auto& s1 = fset[i];
+      for (double wr : wratios) {
+        const auto w = (size_t)(wr*mocker._fixl);
+        size_t idx = 0;
+        F bsf = PINF;
+        size_t idx_cb = 0;
+        F bsf_cb = PINF;
+        for (size_t j = 0; j<nbitems; j += 5) {
+          if (i==j) { continue; }
+          const auto& s2 = fset[j];
+          const F v = dtw(s1.size(), s2.size(), cfun(s1, s2), w, bsf, buffer);
+          if (v<bsf) {
+            idx = j;
+            bsf = v;
+          }
+          core::univariate::get_keogh_envelopes(s2.data(), s2.size(), upper.data(), lower.data(), w);
+          core::univariate::lb_Keogh_cumulative(s1.data(), s1.size(), upper.data(), lower.data(), cf, cb.data());
+          const F v_cb = dtw(s1.size(), s2.size(), cfun(s1, s2), w, bsf_cb, buffer, cb.data());
+          if (v_cb<bsf_cb) {
+            idx_cb = j;
+            bsf_cb = v_cb;
+          }
+          REQUIRE(idx==idx_cb);
+          REQUIRE(bsf==bsf_cb);
+        }
+      }
+    }
+  }
+
+}
+
+TEST_CASE("Univariate DTW LB Improved and LB Petitjean", "[dtw][univariate]") {
+  mock::Mocker mocker;
+  mocker._fixl = 40;
+  const auto& wratios = mocker.wratios;
+  const auto fset = mocker.vec_randvec(nbitems);
+  constexpr auto cf = tempo::distance::univariate::ad2<F>;
+  const size_t l = mocker._fixl;
+  std::vector<F> buffer;
+  std::vector<F> upper1(l), lower1(l), upper2(l), lower2(l), lb_buffer(3*l);
+
+  SECTION("LB Keogh <= LB Improved <= LB Petitjean <= DTW") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (double wr : wratios) {
+        const auto w = (size_t)(wr*l);
+        core::univariate::get_keogh_envelopes(s1.data(), l, upper1.data(), lower1.data(), w);
+        core::univariate::get_keogh_envelopes(s2.data(), l, upper2.data(), lower2.data(), w);
+        const F v = dtw(l, l, cfun(s1, s2), w, PINF, buffer);
+        const F lbk = core::univariate::lb_Keogh(s1.data(), l, upper2.data(), lower2.data(), cf, PINF);
+        const F lbi = core::univariate::lb_Improved(s1.data(), l, s2.data(), upper2.data(), lower2.data(), cf, w,
+                                                    PINF, lb_buffer.data());
+        const F lbp = core::univariate::lb_Petitjean(s1.data(), l, upper1.data(), lower1.data(),
+                                                     s2.data(), upper2.data(), lower2.data(), cf, w,
+                                                     PINF, lb_buffer.data());
+        INFO("Different summation orders: allow for rounding errors");
+        const F eps = 1e-9*v;
+        REQUIRE(lbk<=lbi);
+        REQUIRE(lbi<=lbp + eps);
+        REQUIRE(lbp<=v + eps);
+        // Early abandoned strictly above the cutoff
+        if (lbp>0) {
+          const F abandoned = core::univariate::lb_Petitjean(s1.data(), l, upper1.data(), lower1.data(),
+                                                             s2.data(), upper2.data(), lower2.data(), cf, w,
+                                                             lbp*0.5, lb_buffer.data());
+          REQUIRE(abandoned==PINF);
+        }
+      }
+    }
+  }
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../utils.private.hpp"
+#include "dtw_lb_keogh.hpp"
+
+namespace tempo::distance::core {
+
+  namespace univariate {
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Projection of a series on envelopes
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    namespace internal {
+
+      /** LB Keogh of the query against the envelopes of the candidate, also writing the projection of the query on
+       *  the envelopes (the query clamped between the lower and upper envelopes) and the envelopes of the projection.
+       *  The envelopes are not computed if early abandoned.
+       * @param buffer  Buffer of at least 3*length cells: projection, upper and lower envelopes of the projection
+       * @return +INF if early abandoned, or LB Keogh
+       */
+      template<typename F>
+      F lb_Keogh_projection(
+        F const *query, size_t length, F const *upper, F const *lower,
+        utils::CFun<F> auto cfun, size_t w, F cutoff, F *buffer
+      ) {
+        F *proj = buffer;
+        F lb{0};
+        for (size_t i = 0; i<length&&lb<=cutoff; ++i) {
+          const F qi{query[i]};
+          if (const auto ui{upper[i]}; qi>ui) {
+            lb += cfun(qi, ui);
+            proj[i] = ui;
+          } else if (const auto li{lower[i]}; qi<li) {
+            lb += cfun(qi, li);
+            proj[i] = li;
+          } else { proj[i] = qi; }
+        }
+        if (lb>cutoff) { return utils::PINF<F>; }
+        get_keogh_envelopes(proj, length, buffer + length, buffer + 2*length, w);
+        return lb;
+      }
+
+    } // End of namespace internal
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // LB Improved
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    /**  LB Improved - only applicable for same-length series.
+     *   From the paper Lemire D (2009) Faster retrieval with a two-pass dynamic-time-warping lower bound.
+     *   Pattern Recognition 42:2169–2180. https://doi.org/10.1016/j.patcog.2008.11.030
+     *   LB Keogh of the query against the envelopes of the candidate, plus LB Keogh of the candidate against the
+     *   envelopes of the projection of the query on the envelopes of the candidate.
+     *   NOTE: only a lower bound for the cost functions |a-b|^e with e>=1 (superadditive), e.g. not for e=0.5.
+     * @param query           Query series
+     * @param length          Length of the query and of the candidate
+     * @param candidate       Candidate series
+     * @param upper           Upper envelope of the candidate
+     * @param lower           Lower envelope of the candidate
+     * @param cfun            Cost Function utils::CFun<F>
+     * @param w               Warping window
+     * @param cutoff          Cut-off value (strictly) above which we early abandon ("best so far")
+     * @param buffer          Buffer of at least 3*length cells (not initialised)
+     * @return +INF if early abandoned, or the lower bound value
+     */
+    template<typename F>
+    F lb_Improved(
+      F const *query, size_t length,
+      F const *candidate, F const *upper, F const *lower,
+      utils::CFun<F> auto cfun, size_t w, F cutoff, F *buffer
+    ) {
+      F lb = internal::lb_Keogh_projection(query, length, upper, lower, cfun, w, cutoff, buffer);
+      F const *proj_upper = buffer + length;
+      F const *proj_lower = buffer + 2*length;
+      for (size_t i = 0; i<length&&lb<=cutoff; ++i) {
+        const F ci{candidate[i]};
+        if (const auto ui{proj_upper[i]}; ci>ui) { lb += cfun(ci, ui); }
+        else if (const auto li{proj_lower[i]}; ci<li) { lb += cfun(ci, li); }
+      }
+      return (lb>cutoff) ? utils::PINF<F> : lb;
+    }
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // LB Petitjean
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    /**  LB Petitjean - only applicable for same-length series.
+     *   From the paper Webb GI, Petitjean F (2021) Tight lower bounds for Dynamic Time Warping.
+     *   Pattern Recognition.
+     *   LB Improved, where the second pass also uses the envelopes of the query: when a point of the candidate is
+     *   above the upper envelope U of the query and the upper envelope P of the projection, with P > U, the part of
+     *   its cost already counted by the first pass is at most cfun(P, U), giving cfun(c, U) - cfun(P, U) instead of
+     *   cfun(c, P) (and the same below the lower envelopes). At least LB Improved.
+     *   The "free" points of the paper (see lb_Webb) are not used.
+     *   NOTE: only a lower bound for the cost functions |a-b|^e with e>=1 (superadditive), e.g. not for e=0.5.
+     * @param query           Query series
+     * @param length          Length of the query and of the candidate
+     * @param query_upper     Upper envelope of the query
+     * @param query_lower     Lower envelope of the query
+     * @param candidate       Candidate series
+     * @param upper           Upper envelope of the candidate
+     * @param lower           Lower envelope of the candidate
+     * @param cfun            Cost Function utils::CFun<F>
+     * @param w               Warping window
+     * @param cutoff          Cut-off value (strictly) above which we early abandon ("best so far")
+     * @param buffer          Buffer of at least 3*length cells (not initialised)
+     * @return +INF if early abandoned, or the lower bound value
+     */
+    template<typename F>
+    F lb_Petitjean(
+      F const *query, size_t length, F const *query_upper, F const *query_lower,
+      F const *candidate, F const *upper, F const *lower,
+      utils::CFun<F> auto cfun, size_t w, F cutoff, F *buffer
+    ) {
+      F lb = internal::lb_Keogh_projection(query, length, upper, lower, cfun, w, cutoff, buffer);
+      F const *proj_upper = buffer + length;
+      F const *proj_lower = buffer + 2*length;
+      for (size_t i = 0; i<length&&lb<=cutoff; ++i) {
+        const F ci{candidate[i]};
+        if (const auto pui{proj_upper[i]}; ci>pui) {
+          const auto qui{query_upper[i]};
+          lb += (pui>qui) ? cfun(ci, qui) - cfun(pui, qui) : cfun(ci, pui);
+        } else if (const auto pli{proj_lower[i]}; ci<pli) {
+          const auto qli{query_lower[i]};
+          lb += (pli<qli) ? cfun(ci, qli) - cfun(pli, qli) : cfun(ci, pli);
+        }
+      }
+      return (lb>cutoff) ? utils::PINF<F> : lb;
+    }
+
+  } // End of namespace univariate
+
+} // End of namespace tempo::distance::core
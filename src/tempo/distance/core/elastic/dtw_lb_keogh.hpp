@@ -34,6 +34,27 @@ namespace tempo::distance::core {
       return (lb>cutoff) ? utils::PINF<F> : lb;
     }
 
+    /** LB Keogh with its cumulative bound, as in the UCR suite (Rakthanmanon et al., 2012):
+     *  cb[i] is the part of the bound of the points i and after, i.e. a lower bound of the cost of the lines i and
+     *  after of the DTW between the query (the lines) and the candidate. cb[query_length]=0.
+     *  Given to the DTW (see core::dtw), it tightens the pruning of each line. No early abandoning.
+     * @param cb  Output array of query_length+1 values
+     * @return The lower bound value, i.e. cb[0]
+     */
+    template<typename F>
+    F lb_Keogh_cumulative(F const *query, size_t query_length, F const *upper, F const *lower,
+                          utils::CFun<F> auto cfun, F *cb) {
+      cb[query_length] = 0;
+      for (size_t i = query_length; i-->0;) {
+        F qi{query[i]};
+        F lbi{0};
+        if (const auto ui{upper[i]}; qi>ui) { lbi = cfun(qi, ui); }
+        else if (const auto li{lower[i]}; qi<li) { lbi = cfun(qi, li); }
+        cb[i] = cb[i + 1] + lbi;
+      }
+      return cb[0];
+    }
+
     /** LB Keogh 2 ways 'joined' - only applicable for same-length series.
      * LB Keogh is not symmetric: for two series s1 and s2, lb_keogh(s1,s2) != lb_keogh(s2, s1).
      * One result is usually tighter than the other, and it is usual to take the maximum of the two computations.
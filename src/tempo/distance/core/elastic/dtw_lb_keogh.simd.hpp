@@ -0,0 +1,178 @@
+#pragma once
+
+#include "../simd.private.hpp"
+#include "dtw_lb_keogh.hpp"
+
+namespace tempo::distance::core::simd {
+
+  namespace internal {
+
+    /// LB Keogh, scalar fall back: use the reference implementation tempo::distance::core::univariate::lb_Keogh
+    template<CFE e>
+    double lb_Keogh_scalar(double const *query, size_t length, double const *upper, double const *lower, double cutoff) {
+      const auto cfun = [](double a, double b) { return cost<e>(a - b); };
+      return core::univariate::lb_Keogh<double>(query, length, upper, lower, cfun, cutoff);
+    }
+
+    #if defined(TEMPO_SIMD_X86)
+
+    /// Cost between q[0..3] and the envelope u[0..3], l[0..3]
+    template<CFE e>
+    __attribute__((target("avx2,fma"))) inline __m256d dist_avx2(double const *q, double const *u, double const *l) {
+      const __m256d zero = _mm256_setzero_pd();
+      const __m256d vq = _mm256_loadu_pd(q);
+      const __m256d above = _mm256_max_pd(_mm256_sub_pd(vq, _mm256_loadu_pd(u)), zero);
+      const __m256d below = _mm256_max_pd(_mm256_sub_pd(_mm256_loadu_pd(l), vq), zero);
+      return cost_avx2<e>(_mm256_add_pd(above, below));
+    }
+
+    /// Cost between q[0..7] and the envelope u[0..7], l[0..7]
+    template<CFE e>
+    __attribute__((target("avx512f"))) inline __m512d dist_avx512(double const *q, double const *u, double const *l) {
+      const __m512d zero = _mm512_setzero_pd();
+      const __m512d vq = _mm512_loadu_pd(q);
+      const __m512d above = _mm512_max_pd(_mm512_sub_pd(vq, _mm512_loadu_pd(u)), zero);
+      const __m512d below = _mm512_max_pd(_mm512_sub_pd(_mm512_loadu_pd(l), vq), zero);
+      return cost_avx512<e>(_mm512_add_pd(above, below));
+    }
+
+    /** LB Keogh, AVX2, early abandoned every EA_BLOCK elements.
+     *  For each point, the distance to the envelope is max(q-u, 0) + max(l-q, 0) (at most one term is not 0).
+     *  Summation order differs from the scalar version: results may differ in the last bits.
+     */
+    template<CFE e>
+    __attribute__((target("avx2,fma")))
+    double lb_Keogh_avx2(double const *query, size_t length, double const *upper, double const *lower, double cutoff) {
+      const __m256d zero = _mm256_setzero_pd();
+      __m256d acc0 = zero;
+      __m256d acc1 = zero;
+      __m256d acc2 = zero;
+      __m256d acc3 = zero;
+      size_t i{0};
+      for (; i + EA_BLOCK<=length; i += EA_BLOCK) {
+        acc0 = _mm256_add_pd(acc0, dist_avx2<e>(query + i, upper + i, lower + i));
+        acc1 = _mm256_add_pd(acc1, dist_avx2<e>(query + i + 4, upper + i + 4, lower + i + 4));
+        acc2 = _mm256_add_pd(acc2, dist_avx2<e>(query + i + 8, upper + i + 8, lower + i + 8));
+        acc3 = _mm256_add_pd(acc3, dist_avx2<e>(query + i + 12, upper + i + 12, lower + i + 12));
+        const double partial = hsum_avx2(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+        if (partial>cutoff) { return utils::PINF<double>; }
+      }
+      double lb = hsum_avx2(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+      for (; i<length; ++i) {
+        const double qi = query[i];
+        if (qi>upper[i]) { lb += cost<e>(qi - upper[i]); }
+        else if (qi<lower[i]) { lb += cost<e>(lower[i] - qi); }
+      }
+      return (lb>cutoff) ? utils::PINF<double> : lb;
+    }
+
+    /** LB Keogh, AVX-512, early abandoned every EA_BLOCK elements.
+     *  See lb_Keogh_avx2.
+     */
+    template<CFE e>
+    __attribute__((target("avx512f")))
+    double lb_Keogh_avx512(double const *query, size_t length, double const *upper, double const *lower, double cutoff) {
+      const __m512d zero = _mm512_setzero_pd();
+      __m512d acc0 = zero;
+      __m512d acc1 = zero;
+      size_t i{0};
+      for (; i + EA_BLOCK<=length; i += EA_BLOCK) {
+        acc0 = _mm512_add_pd(acc0, dist_avx512<e>(query + i, upper + i, lower + i));
+        acc1 = _mm512_add_pd(acc1, dist_avx512<e>(query + i + 8, upper + i + 8, lower + i + 8));
+        const double partial = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+        if (partial>cutoff) { return utils::PINF<double>; }
+      }
+      double lb = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+      for (; i<length; ++i) {
+        const double qi = query[i];
+        if (qi>upper[i]) { lb += cost<e>(qi - upper[i]); }
+        else if (qi<lower[i]) { lb += cost<e>(lower[i] - qi); }
+      }
+      return (lb>cutoff) ? utils::PINF<double> : lb;
+    }
+
+    #endif
+
+    #if defined(TEMPO_SIMD_ARM)
+
+    /// Cost between q[0..1] and the envelope u[0..1], l[0..1]
+    template<CFE e>
+    inline float64x2_t dist_neon(double const *q, double const *u, double const *l) {
+      const float64x2_t zero = vdupq_n_f64(0);
+      const float64x2_t vq = vld1q_f64(q);
+      const float64x2_t above = vmaxq_f64(vsubq_f64(vq, vld1q_f64(u)), zero);
+      const float64x2_t below = vmaxq_f64(vsubq_f64(vld1q_f64(l), vq), zero);
+      return cost_neon<e>(vaddq_f64(above, below));
+    }
+
+    /** LB Keogh, NEON, early abandoned every EA_BLOCK elements.
+     *  See lb_Keogh_avx2, with 4 accumulators of 2 lanes, each taking 2 vectors per block.
+     */
+    template<CFE e>
+    double lb_Keogh_neon(double const *query, size_t length, double const *upper, double const *lower, double cutoff) {
+      float64x2_t acc0 = vdupq_n_f64(0);
+      float64x2_t acc1 = acc0;
+      float64x2_t acc2 = acc0;
+      float64x2_t acc3 = acc0;
+      size_t i{0};
+      for (; i + EA_BLOCK<=length; i += EA_BLOCK) {
+        acc0 = vaddq_f64(acc0, dist_neon<e>(query + i, upper + i, lower + i));
+        acc1 = vaddq_f64(acc1, dist_neon<e>(query + i + 2, upper + i + 2, lower + i + 2));
+        acc2 = vaddq_f64(acc2, dist_neon<e>(query + i + 4, upper + i + 4, lower + i + 4));
+        acc3 = vaddq_f64(acc3, dist_neon<e>(query + i + 6, upper + i + 6, lower + i + 6));
+        acc0 = vaddq_f64(acc0, dist_neon<e>(query + i + 8, upper + i + 8, lower + i + 8));
+        acc1 = vaddq_f64(acc1, dist_neon<e>(query + i + 10, upper + i + 10, lower + i + 10));
+        acc2 = vaddq_f64(acc2, dist_neon<e>(query + i + 12, upper + i + 12, lower + i + 12));
+        acc3 = vaddq_f64(acc3, dist_neon<e>(query + i + 14, upper + i + 14, lower + i + 14));
+        const double partial = hsum_neon(vaddq_f64(vaddq_f64(acc0, acc1), vaddq_f64(acc2, acc3)));
+        if (partial>cutoff) { return utils::PINF<double>; }
+      }
+      double lb = hsum_neon(vaddq_f64(vaddq_f64(acc0, acc1), vaddq_f64(acc2, acc3)));
+      for (; i<length; ++i) {
+        const double qi = query[i];
+        if (qi>upper[i]) { lb += cost<e>(qi - upper[i]); }
+        else if (qi<lower[i]) { lb += cost<e>(lower[i] - qi); }
+      }
+      return (lb>cutoff) ? utils::PINF<double> : lb;
+    }
+
+    #endif
+
+    template<CFE e>
+    double lb_Keogh(ISA isa, double const *query, size_t length, double const *upper, double const *lower,
+                    double cutoff) {
+      switch (isa) {
+        #if defined(TEMPO_SIMD_X86)
+        case ISA::AVX512: return lb_Keogh_avx512<e>(query, length, upper, lower, cutoff);
+        case ISA::AVX2: return lb_Keogh_avx2<e>(query, length, upper, lower, cutoff);
+        #endif
+        #if defined(TEMPO_SIMD_ARM)
+        case ISA::NEON: return lb_Keogh_neon<e>(query, length, upper, lower, cutoff);
+        #endif
+        default: return lb_Keogh_scalar<e>(query, length, upper, lower, cutoff);
+      }
+    }
+
+  } // End of namespace internal
+
+  /** LB Keogh with a specialised cost function - only applicable for same-length series.
+   *  Same semantic as tempo::distance::core::univariate::lb_Keogh, but using the best instruction set available.
+   * @param query   Query series
+   * @param length  Length of the query
+   * @param upper   Upper envelope of the candidate series - of length 'length' (not checked)
+   * @param lower   Lower envelope of the candidate series - of length 'length' (not checked)
+   * @param e       Cost function exponent
+   * @param cutoff  Cut-off value (strictly) above which we early abandon ("best so far")
+   * @param isa     Instruction set to use, default to the detected one. Must be supported by the CPU (not checked).
+   * @return +INF if early abandoned, or the lower bound value
+   */
+  inline double lb_Keogh(double const *query, size_t length, double const *upper, double const *lower,
+                         CFE e, double cutoff, ISA isa = detected_isa()) {
+    switch (e) {
+      case CFE::AD1: return internal::lb_Keogh<CFE::AD1>(isa, query, length, upper, lower, cutoff);
+      case CFE::AD2: return internal::lb_Keogh<CFE::AD2>(isa, query, length, upper, lower, cutoff);
+      default: return internal::lb_Keogh<CFE::SQRT>(isa, query, length, upper, lower, cutoff);
+    }
+  }
+
+} // End of namespace tempo::distance::core::simd
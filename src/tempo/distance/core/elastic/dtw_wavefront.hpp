@@ -0,0 +1,170 @@
+#pragma once
+
+#include "../utils.private.hpp"
+#include "../../stats.hpp"
+
+#include <algorithm>
+#include <barrier>
+#include <thread>
+
+namespace tempo::distance::core {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Anti-diagonal (wavefront) DTW
+  // The cells of an anti-diagonal k (i+j=k) only depend on the anti-diagonals k-1 and k-2: they are independent,
+  // and can be computed with SIMD instructions or split across threads. This only pays off for long series:
+  // the EAP row kernel (see dtw.hpp) prunes cells, the wavefront kernel does not.
+  // An anti-diagonal is indexed by the line index i; three anti-diagonals are kept, with one sentinel on each side.
+  // Any path crosses at least one of two consecutive anti-diagonals (a step increases i+j by 1 or 2):
+  // the computation is abandoned when the minimums of two consecutive anti-diagonals are above the cutoff.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  namespace internal {
+
+    /// Range [lo, hi] of the line indices of the anti-diagonal k, within the window w. Empty when lo = hi+1.
+    inline void wavefront_range(size_t k, size_t nblines, size_t nbcols, size_t w, size_t& lo, size_t& hi) {
+      lo = std::max<size_t>(k + 1>nbcols ? k + 1 - nbcols : 0, k>w ? (k - w + 1)/2 : 0);
+      hi = std::min<size_t>(std::min(nblines - 1, k), (k + w)/2);
+    }
+
+    /** Scalar anti-diagonal chunk: compute the cells (i, k-i) for i in [lo, hi].
+     *  d2, d1 and out are the anti-diagonals k-2, k-1 and k, indexed by the line index (index -1 is valid):
+     *  cell(i, k-i) = min(d2[i-1], d1[i-1], d1[i]) + cfun(i, k-i)
+     *  Return the minimum of the computed cells.
+     */
+    template<typename F>
+    F wavefront_chunk(utils::ICFun<F> auto& cfun, size_t k, size_t lo, size_t hi, F const *d2, F const *d1, F *out) {
+      F m = utils::PINF<F>;
+      for (size_t i = lo; i<=hi; ++i) {
+        const F v = std::min(std::min(d2[i - 1], d1[i - 1]), d1[i]) + cfun(i, k - i);
+        out[i] = v;
+        m = std::min(m, v);
+      }
+      return m;
+    }
+
+    /** Wavefront driver, with a cutoff already computed, and lengths compatible with the window.
+     * @param chunk  chunk(k, lo, hi, d2, d1, out) -> min; see wavefront_chunk. Called concurrently when nb_threads>1,
+     *               on disjoint ranges of the same anti-diagonal.
+     * @param nb_threads  Number of threads computing an anti-diagonal (including the calling thread).
+     *                    The threads synchronise after each anti-diagonal: only use for very long series.
+     */
+    template<typename F>
+    F wavefront(size_t nblines, size_t nbcols, size_t w, F cutoff, size_t nb_threads,
+                std::vector<F>& buffer_v, auto chunk) {
+      constexpr F PINF = utils::PINF<F>;
+      // Three anti-diagonals of nblines+2 cells (with the sentinels), all +INF but the top left corner
+      const size_t N = nblines + 2;
+      buffer_v.assign(3*N, PINF);
+      F *d2 = buffer_v.data() + 1;
+      F *d1 = d2 + N;
+      F *out = d1 + N;
+      d2[-1] = 0;
+      const size_t nbdiags = nblines + nbcols - 1;
+      // Finish anti-diagonal k: sentinels (covering the reads of the next two anti-diagonals), abandoning, rotation.
+      // Return true if the computation stops.
+      F prev_min = PINF;
+      F result = PINF;
+      // Computed cells, recorded by the calling thread (see stats.hpp)
+      uint64_t nb_cells = 0;
+      const auto finish = [&](size_t k, size_t lo, size_t hi, F m) {
+        if constexpr (stats::enabled) { nb_cells += (lo<=hi) ? hi + 1 - lo : 0; }
+        out[(std::ptrdiff_t)lo - 1] = PINF;
+        out[hi + 1] = PINF;
+        if (k + 1==nbdiags) {
+          result = (out[nblines - 1]<=cutoff) ? out[nblines - 1] : PINF;
+          return true;
+        }
+        if (m>cutoff&&prev_min>cutoff) { return true; }
+        prev_min = m;
+        F *tmp = d2;
+        d2 = d1;
+        d1 = out;
+        out = tmp;
+        return false;
+      };
+      // --- --- --- Sequential
+      if (nb_threads<=1) {
+        for (size_t k = 0; k<nbdiags; ++k) {
+          size_t lo, hi;
+          wavefront_range(k, nblines, nbcols, w, lo, hi);
+          const F m = (lo<=hi) ? chunk(k, lo, hi, d2, d1, out) : PINF;
+          if (finish(k, lo, hi, m)) { break; }
+        }
+        stats::cells(nb_cells);
+        return result;
+      }
+      // --- --- --- Parallel: split each anti-diagonal in nb_threads contiguous chunks.
+      // The completion step of the barrier runs once per anti-diagonal, when all the chunks are done.
+      std::vector<F> mins(nb_threads, PINF);
+      size_t k = 0;
+      size_t lo, hi;
+      bool done = false;
+      wavefront_range(k, nblines, nbcols, w, lo, hi);
+      const auto completion = [&]() noexcept {
+        F m = PINF;
+        for (const F v : mins) { m = std::min(m, v); }
+        done = finish(k, lo, hi, m);
+        if (!done) { wavefront_range(++k, nblines, nbcols, w, lo, hi); }
+      };
+      std::barrier sync((std::ptrdiff_t)nb_threads, completion);
+      const auto work = [&](size_t t) {
+        while (!done) {
+          const size_t size = hi + 1 - lo;
+          const size_t tlo = lo + size*t/nb_threads;
+          const size_t thi = lo + size*(t + 1)/nb_threads;
+          mins[t] = (tlo<thi) ? chunk(k, tlo, thi - 1, d2, d1, out) : PINF;
+          sync.arrive_and_wait();
+        }
+      };
+      {
+        std::vector<std::jthread> threads;
+        for (size_t t = 1; t<nb_threads; ++t) { threads.emplace_back(work, t); }
+        work(0);
+      }
+      stats::cells(nb_cells);
+      return result;
+    }
+
+    /// Wavefront DTW with the same checks and cutoff as core::dtw, using 'chunk' to compute the anti-diagonals.
+    template<typename F>
+    F dtw_wavefront(size_t length1, size_t length2, utils::ICFun<F> auto cfun, size_t window, F cutoff,
+                    std::vector<F>& buffer_v, size_t nb_threads, auto chunk) {
+      constexpr F PINF = utils::PINF<F>;
+      if (length1==0&&length2==0) { return 0; }
+      else if ((length1==0)!=(length2==0)) { return PINF; }
+      const auto m = std::min(length1, length2);
+      const auto M = std::max(length1, length2);
+      if (M - m>window) { return PINF; }
+      if (std::isinf(cutoff)) {
+        cutoff = 0;
+        for (size_t i{0}; i<m; ++i) { cutoff = cutoff + cfun(i, i); }
+        if (length1<length2) { for (size_t i{length1}; i<length2; ++i) { cutoff = cutoff + cfun(length1 - 1, i); }}
+        else if (length2<length1) { for (size_t i{length2}; i<length1; ++i) { cutoff = cutoff + cfun(i, length2 - 1); }}
+      } else if (std::isnan(cutoff)) { cutoff = PINF; }
+      return wavefront<F>(length1, length2, std::min(window, M), cutoff, nb_threads, buffer_v, chunk);
+    }
+
+  } // End of namespace internal
+
+  /** Dynamic Time Warping (DTW), computed by anti-diagonals. Same semantic as core::dtw:
+   *  return the DTW between the two series or +INF if above the cutoff (no pruning, but early abandoning).
+   * @tparam F          Floating type used for the computation
+   * @param length1     Length of the first series.
+   * @param length2     Length of the second series.
+   * @param cfun        Indexed Cost function between two points
+   * @param window      Warping window length
+   * @param cutoff      Early abandoning cutoff; PINF: use the cost of the diagonal; QNAN: no early abandoning
+   * @param buffer_v    Buffer used to perform the computation. Will reallocate if required.
+   * @param nb_threads  Number of threads computing an anti-diagonal; cfun must be thread safe if nb_threads>1.
+   */
+  template<typename F>
+  inline F dtw_wavefront(size_t length1, size_t length2, utils::ICFun<F> auto cfun, size_t window, F cutoff,
+                         std::vector<F>& buffer_v, size_t nb_threads = 1) {
+    const auto chunk = [&cfun](size_t k, size_t lo, size_t hi, F const *d2, F const *d1, F *out) {
+      return internal::wavefront_chunk<F>(cfun, k, lo, hi, d2, d1, out);
+    };
+    return internal::dtw_wavefront<F>(length1, length2, cfun, window, cutoff, buffer_v, nb_threads, chunk);
+  }
+
+} // End of namespace tempo::distance::core
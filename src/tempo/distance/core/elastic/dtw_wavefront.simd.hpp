@@ -0,0 +1,173 @@
+#pragma once
+
+#include "../simd.private.hpp"
+#include "dtw_wavefront.hpp"
+
+#include <vector>
+
+namespace tempo::distance::core::simd {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // SIMD wavefront DTW
+  // Along an anti-diagonal, the line index i increases while the column index k-i decreases:
+  // the column series is reversed so that both series are read contiguously.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Minimum length of the series from which univariate::dtw uses the wavefront kernel.
+  /// Below, the pruning of the row kernel and the lower bounds of the callers do better.
+  constexpr size_t WAVEFRONT_MIN_LENGTH = 1024;
+
+  namespace internal {
+
+    /// Scalar anti-diagonal chunk, see core::internal::wavefront_chunk.
+    /// 'rcols' is the reversed column series: column j is at rcols[nbcols-1-j].
+    template<CFE e>
+    double wavefront_scalar(double const *lines, double const *rcols, size_t nbcols, size_t k, size_t lo, size_t hi,
+                            double const *d2, double const *d1, double *out) {
+      double m = utils::PINF<double>;
+      // Unsigned arithmetic: i + off = i + nbcols-1-k, which is valid as i >= k-(nbcols-1)
+      const size_t off = nbcols - 1 - k;
+      for (size_t i = lo; i<=hi; ++i) {
+        const double v = std::min(std::min(d2[i - 1], d1[i - 1]), d1[i]) + cost<e>(lines[i] - rcols[i + off]);
+        out[i] = v;
+        m = std::min(m, v);
+      }
+      return m;
+    }
+
+    #if defined(TEMPO_SIMD_X86)
+
+    /// AVX2 anti-diagonal chunk, see wavefront_scalar
+    template<CFE e>
+    __attribute__((target("avx2,fma")))
+    double wavefront_avx2(double const *lines, double const *rcols, size_t nbcols, size_t k, size_t lo, size_t hi,
+                          double const *d2, double const *d1, double *out) {
+      constexpr size_t L = 4;
+      const size_t off = nbcols - 1 - k;
+      __m256d vmin = _mm256_set1_pd(utils::PINF<double>);
+      size_t i = lo;
+      for (; i + L<=hi + 1; i += L) {
+        const __m256d d = cost_avx2<e>(lines + i, rcols + (i + off));
+        const __m256d diag = _mm256_loadu_pd(d2 + i - 1);
+        const __m256d top = _mm256_loadu_pd(d1 + i - 1);
+        const __m256d left = _mm256_loadu_pd(d1 + i);
+        const __m256d v = _mm256_add_pd(_mm256_min_pd(_mm256_min_pd(diag, top), left), d);
+        _mm256_storeu_pd(out + i, v);
+        vmin = _mm256_min_pd(vmin, v);
+      }
+      double tmp[L];
+      _mm256_storeu_pd(tmp, vmin);
+      double m = std::min(std::min(tmp[0], tmp[1]), std::min(tmp[2], tmp[3]));
+      if (i<=hi) { m = std::min(m, wavefront_scalar<e>(lines, rcols, nbcols, k, i, hi, d2, d1, out)); }
+      return m;
+    }
+
+    /// AVX-512 anti-diagonal chunk, see wavefront_scalar
+    template<CFE e>
+    __attribute__((target("avx512f")))
+    double wavefront_avx512(double const *lines, double const *rcols, size_t nbcols, size_t k, size_t lo, size_t hi,
+                            double const *d2, double const *d1, double *out) {
+      constexpr size_t L = 8;
+      const size_t off = nbcols - 1 - k;
+      __m512d vmin = _mm512_set1_pd(utils::PINF<double>);
+      size_t i = lo;
+      for (; i + L<=hi + 1; i += L) {
+        const __m512d d = cost_avx512<e>(lines + i, rcols + (i + off));
+        const __m512d diag = _mm512_loadu_pd(d2 + i - 1);
+        const __m512d top = _mm512_loadu_pd(d1 + i - 1);
+        const __m512d left = _mm512_loadu_pd(d1 + i);
+        const __m512d v = _mm512_add_pd(_mm512_min_pd(_mm512_min_pd(diag, top), left), d);
+        _mm512_storeu_pd(out + i, v);
+        vmin = _mm512_min_pd(vmin, v);
+      }
+      double m = _mm512_reduce_min_pd(vmin);
+      if (i<=hi) { m = std::min(m, wavefront_scalar<e>(lines, rcols, nbcols, k, i, hi, d2, d1, out)); }
+      return m;
+    }
+
+    #endif
+
+    #if defined(TEMPO_SIMD_ARM)
+
+    /// NEON anti-diagonal chunk, see wavefront_scalar
+    template<CFE e>
+    double wavefront_neon(double const *lines, double const *rcols, size_t nbcols, size_t k, size_t lo, size_t hi,
+                          double const *d2, double const *d1, double *out) {
+      constexpr size_t L = 2;
+      const size_t off = nbcols - 1 - k;
+      float64x2_t vmin = vdupq_n_f64(utils::PINF<double>);
+      size_t i = lo;
+      for (; i + L<=hi + 1; i += L) {
+        const float64x2_t d = cost_neon<e>(lines + i, rcols + (i + off));
+        const float64x2_t diag = vld1q_f64(d2 + i - 1);
+        const float64x2_t top = vld1q_f64(d1 + i - 1);
+        const float64x2_t left = vld1q_f64(d1 + i);
+        const float64x2_t v = vaddq_f64(vminq_f64(vminq_f64(diag, top), left), d);
+        vst1q_f64(out + i, v);
+        vmin = vminq_f64(vmin, v);
+      }
+      double m = vminvq_f64(vmin);
+      if (i<=hi) { m = std::min(m, wavefront_scalar<e>(lines, rcols, nbcols, k, i, hi, d2, d1, out)); }
+      return m;
+    }
+
+    #endif
+
+    template<CFE e>
+    double dtw_wavefront(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t w,
+                         double cutoff, std::vector<double>& buffer, size_t nb_threads, ISA isa) {
+      const auto cfun = [lines, cols](size_t i, size_t j) { return cost<e>(lines[i] - cols[j]); };
+      std::vector<double> rcols(cols, cols + nbcols);
+      std::reverse(rcols.begin(), rcols.end());
+      double const *rc = rcols.data();
+      #if defined(TEMPO_SIMD_X86)
+      if (isa==ISA::AVX512) {
+        return core::internal::dtw_wavefront<double>(nblines, nbcols, cfun, w, cutoff, buffer, nb_threads,
+          [=](size_t k, size_t lo, size_t hi, double const *d2, double const *d1, double *out) {
+            return wavefront_avx512<e>(lines, rc, nbcols, k, lo, hi, d2, d1, out);
+          });
+      } else if (isa==ISA::AVX2) {
+        return core::internal::dtw_wavefront<double>(nblines, nbcols, cfun, w, cutoff, buffer, nb_threads,
+          [=](size_t k, size_t lo, size_t hi, double const *d2, double const *d1, double *out) {
+            return wavefront_avx2<e>(lines, rc, nbcols, k, lo, hi, d2, d1, out);
+          });
+      }
+      #endif
+      #if defined(TEMPO_SIMD_ARM)
+      if (isa==ISA::NEON) {
+        return core::internal::dtw_wavefront<double>(nblines, nbcols, cfun, w, cutoff, buffer, nb_threads,
+          [=](size_t k, size_t lo, size_t hi, double const *d2, double const *d1, double *out) {
+            return wavefront_neon<e>(lines, rc, nbcols, k, lo, hi, d2, d1, out);
+          });
+      }
+      #endif
+      return core::internal::dtw_wavefront<double>(nblines, nbcols, cfun, w, cutoff, buffer, nb_threads,
+        [=](size_t k, size_t lo, size_t hi, double const *d2, double const *d1, double *out) {
+          return wavefront_scalar<e>(lines, rc, nbcols, k, lo, hi, d2, d1, out);
+        });
+    }
+
+  } // End of namespace internal
+
+  /** Wavefront DTW between 'lines' and 'cols', vectorised along the anti-diagonals.
+   *  Same semantic as core::dtw with the cost function |lines[i]-cols[j]|^e.
+   * @param w           Warping window
+   * @param cutoff      Early abandoning cutoff, see core::dtw_wavefront
+   * @param buffer      Buffer used to carry the computation
+   * @param nb_threads  Number of threads computing an anti-diagonal (including the calling thread)
+   * @param isa         Instruction set to use, default to the detected one. Must be supported by the CPU (not checked).
+   */
+  inline double dtw_wavefront(double const *lines, size_t nblines, double const *cols, size_t nbcols,
+                              CFE e, size_t w, double cutoff, std::vector<double>& buffer,
+                              size_t nb_threads = 1, ISA isa = detected_isa()) {
+    const auto run = [&]<CFE c>() {
+      return internal::dtw_wavefront<c>(lines, nblines, cols, nbcols, w, cutoff, buffer, nb_threads, isa);
+    };
+    switch (e) {
+      case CFE::AD1: return run.template operator()<CFE::AD1>();
+      case CFE::AD2: return run.template operator()<CFE::AD2>();
+      default: return run.template operator()<CFE::SQRT>();
+    }
+  }
+
+} // End of namespace tempo::distance::core::simd
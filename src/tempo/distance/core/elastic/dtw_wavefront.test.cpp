@@ -0,0 +1,105 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "dtw.hpp"
+#include "dtw_wavefront.hpp"
+#include "dtw_wavefront.simd.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <vector>
+
+using namespace tempo::distance;
+using namespace tempo::distance::core;
+
+using F = double;
+
+constexpr size_t nbitems = 200;
+constexpr F PINF = utils::PINF<F>;
+constexpr F QNAN = utils::QNAN<F>;
+
+namespace {
+
+  /// All the instruction sets usable on this CPU
+  std::vector<simd::ISA> available_isa() {
+    std::vector<simd::ISA> result{simd::ISA::SCALAR};
+    const auto detected = simd::detected_isa();
+    if (detected==simd::ISA::AVX2||detected==simd::ISA::AVX512) { result.push_back(simd::ISA::AVX2); }
+    if (detected==simd::ISA::AVX512) { result.push_back(simd::ISA::AVX512); }
+    if (detected==simd::ISA::NEON) { result.push_back(simd::ISA::NEON); }
+    return result;
+  }
+
+  template<typename V>
+  auto cfun(V const& s1, V const& s2) {
+    return [&s1, &s2](size_t i, size_t j) { const F d = s1[i] - s2[j]; return d*d; };
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+TEST_CASE("Univariate wavefront DTW", "[dtw][wavefront][univariate]") {
+  // Setup univariate with variable length
+  mock::Mocker mocker(0);
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+  std::vector<F> buffer;
+  std::vector<F> ref_buffer;
+
+  SECTION("Same as dtw, no cutoff") {
+    for (const size_t w : {size_t(0), size_t(1), size_t(7), utils::NO_WINDOW}) {
+      for (size_t i = 0; i + 1<nbitems; ++i) {
+        const auto& s1 = fset[i];
+        const auto& s2 = fset[i + 1];
+        const F ref = dtw<F>(s1.size(), s2.size(), cfun(s1, s2), w, QNAN, ref_buffer);
+        const F v = dtw_wavefront<F>(s1.size(), s2.size(), cfun(s1, s2), w, QNAN, buffer);
+        REQUIRE(v==Catch::Approx(ref));
+        for (const auto isa : available_isa()) {
+          const F vs = simd::dtw_wavefront(s1.data(), s1.size(), s2.data(), s2.size(), simd::CFE::AD2, w, QNAN,
+                                           buffer, 1, isa);
+          REQUIRE(vs==Catch::Approx(ref));
+        }
+      }
+    }
+  }
+
+  SECTION("Same as dtw, with cutoff") {
+    for (size_t i = 0; i + 2<nbitems; ++i) {
+      const auto& s1 = fset[i];
+      const size_t w = std::max<size_t>(3, s1.size()/10);
+      // Cutoff: distance to the next series
+      const auto& s2 = fset[i + 1];
+      const F cutoff = dtw<F>(s1.size(), s2.size(), cfun(s1, s2), w, PINF, ref_buffer);
+      const auto& s3 = fset[i + 2];
+      const F ref = dtw<F>(s1.size(), s3.size(), cfun(s1, s3), w, cutoff, ref_buffer);
+      const F v = dtw_wavefront<F>(s1.size(), s3.size(), cfun(s1, s3), w, cutoff, buffer);
+      if (ref==PINF) { REQUIRE(v==PINF); } else { REQUIRE(v==Catch::Approx(ref)); }
+      for (const auto isa : available_isa()) {
+        const F vs = simd::dtw_wavefront(s1.data(), s1.size(), s3.data(), s3.size(), simd::CFE::AD2, w, cutoff,
+                                         buffer, 1, isa);
+        if (ref==PINF) { REQUIRE(vs==PINF); } else { REQUIRE(vs==Catch::Approx(ref)); }
+      }
+    }
+  }
+
+  SECTION("Split across threads") {
+    mocker._fixl = 1500;
+    const auto lset = mocker.vec_randvec(4);
+    for (const size_t w : {size_t(50), utils::NO_WINDOW}) {
+      const auto& s1 = lset[0];
+      const auto& s2 = lset[1];
+      const F ref = dtw<F>(s1.size(), s2.size(), cfun(s1, s2), w, QNAN, ref_buffer);
+      for (const size_t nbt : {2, 3, 4}) {
+        const F v = dtw_wavefront<F>(s1.size(), s2.size(), cfun(s1, s2), w, QNAN, buffer, nbt);
+        REQUIRE(v==Catch::Approx(ref));
+        const F vs = simd::dtw_wavefront(s1.data(), s1.size(), s2.data(), s2.size(), simd::CFE::AD2, w, QNAN,
+                                         buffer, nbt);
+        REQUIRE(vs==Catch::Approx(ref));
+        // Early abandoned
+        REQUIRE(simd::dtw_wavefront(s1.data(), s1.size(), s2.data(), s2.size(), simd::CFE::AD2, w, ref*0.5,
+                                    buffer, nbt)==PINF);
+      }
+    }
+  }
+}
@@ -288,6 +288,54 @@ namespace tempo::distance::core {
     return erp<F>(nblines, nbcols, cfun_gv_lines, cfun_gv_cols, cfun, window, cutoff, v);
   }
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Lower bounds
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** ERP lower bound from the envelopes of the candidate (LB Keogh like) - only applicable for same-length series.
+   *  Every point of the query is aligned once: either with a point of the candidate within the window, costing at
+   *  least its LB Keogh cost, or with the gap value. The smallest of the two bounds the cost of the point.
+   * @tparam F          Floating type used for the computation
+   * @param query       Query series
+   * @param length      Length of the query and of the candidate
+   * @param upper       Upper envelope of the candidate for the window of ERP (see get_keogh_envelopes)
+   * @param lower       Lower envelope of the candidate for the window of ERP
+   * @param cfun        Cost Function utils::CFun<F>, also used with the gap value
+   * @param gv          Gap value
+   * @param cutoff      Cut-off value (strictly) above which we early abandon ("best so far")
+   * @return +INF if early abandoned, or the lower bound value
+   */
+  template<typename F>
+  F lb_erp(F const *query, size_t length, F const *upper, F const *lower, utils::CFun<F> auto cfun, F gv, F cutoff) {
+    if (std::isnan(cutoff)) { cutoff = utils::PINF<F>; }
+    F lb{0};
+    for (size_t i = 0; i<length&&lb<=cutoff; ++i) {
+      const F qi{query[i]};
+      F d{0};
+      if (const auto ui{upper[i]}; qi>ui) { d = cfun(qi, ui); }
+      else if (const auto li{lower[i]}; qi<li) { d = cfun(qi, li); }
+      if (d>0) { lb += std::min<F>(d, cfun(qi, gv)); }
+    }
+    return (lb>cutoff) ? utils::PINF<F> : lb;
+  }
+
+  /** LB_ERP of Chen and Ng (2004), only valid with the absolute difference cost function (cfe 1), for any lengths
+   *  and windows. Relative to the gap value, a match costs |(x-gv)-(y-gv)| and a gap |x-gv| or |y-gv|: by the
+   *  triangle inequality, ERP is at least the difference of the sums of the series relative to the gap value.
+   *  The bound is reached when all the differences have the same sign: it is lowered by a relative slack covering
+   *  the rounding errors of both sums, so that ERP values equal to the cutoff are never abandoned.
+   * @return +INF if the bound is (strictly) above the cutoff, else the lower bound value
+   */
+  template<typename F>
+  F lb_erp_sums(F const *series1, size_t length1, F const *series2, size_t length2, F gv, F cutoff) {
+    F sum{0};
+    for (size_t i = 0; i<length1; ++i) { sum += series1[i] - gv; }
+    for (size_t j = 0; j<length2; ++j) { sum -= series2[j] - gv; }
+    const F slack = 2*(F)(length1 + length2)*std::numeric_limits<F>::epsilon();
+    const F lb = std::abs(sum)*std::max<F>(0, 1 - slack);
+    return (lb>cutoff) ? utils::PINF<F> : lb;
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Specific cost functions
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
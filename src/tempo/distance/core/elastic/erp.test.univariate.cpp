@@ -1,6 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "erp.hpp"
+#include "dtw_lb_keogh.hpp"
 
 #include <mock/mockseries.hpp>
 #include <vector>
@@ -282,3 +283,52 @@ TEST_CASE("Univariate ERP Variable length", "[erp][univariate]") {
     }// End query loop
   }// End section
 }
+
+TEST_CASE("Univariate ERP lower bounds", "[erp][univariate][lb]") {
+  mock::Mocker mocker;
+  const auto& wratios = mocker.wratios;
+  const auto& gvalues = mocker.gvalues;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t l = mocker._fixl;
+  constexpr auto cfun1 = idx_ad1<F, std::vector<F>>;
+  constexpr auto gvcfun1 = tempo::distance::core::univariate::idx_gvad1<F, std::vector<F>>;
+  std::vector<F> upper(l);
+  std::vector<F> lower(l);
+
+  SECTION("Envelopes") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (double wr : wratios) {
+        const auto w = (size_t)(wr*(double)l);
+        core::univariate::get_keogh_envelopes(s2.data(), l, upper.data(), lower.data(), w);
+        for (auto gv : gvalues) {
+          const auto v = erp(l, l, gvcfun(s1, gv), gvcfun(s2, gv), cfun(s1, s2), w, QNAN);
+          REQUIRE(lb_erp(s1.data(), l, upper.data(), lower.data(), ad2<F>, gv, PINF)<=v);
+          // Abandoned only if ERP is above the cutoff
+          for (double cutoff : {0.0, v*0.9, v, v*1.1}) {
+            const F lb = lb_erp(s1.data(), l, upper.data(), lower.data(), ad2<F>, gv, cutoff);
+            if (lb==PINF) { REQUIRE(v>cutoff); } else { REQUIRE(lb<=v); }
+          }
+        }
+      }
+    }
+  }
+
+  SECTION("Sums, cfe 1") {
+    const auto rs_set = mocker.vec_rs_randvec(nbitems);
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = rs_set[i];
+      const auto& s2 = rs_set[i + 1];
+      const size_t w = std::max(s1.size(), s2.size());
+      for (auto gv : gvalues) {
+        const auto v = erp(s1.size(), s2.size(), gvcfun1(s1, gv), gvcfun1(s2, gv), cfun1(s1, s2), w, QNAN);
+        for (double cutoff : {0.0, v*0.9, v, v*1.1, PINF}) {
+          const F lb = lb_erp_sums(s1.data(), s1.size(), s2.data(), s2.size(), gv, cutoff);
+          if (lb==PINF) { REQUIRE(v>cutoff); } else { REQUIRE(lb<=v); }
+        }
+      }
+    }
+  }
+
+}
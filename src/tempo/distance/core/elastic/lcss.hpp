@@ -2,6 +2,10 @@
 
 #include "../utils.private.hpp"
 
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
 namespace tempo::distance::core {
 
   /** Longest Common SubSequence (LCSS), Early Abandoned and Pruned (EAP).
@@ -103,6 +107,126 @@ namespace tempo::distance::core {
     return lcss<F>(length1, length2, cfun_sim, w, cutoff, v);
   }
 
+  /** Bit-parallel Longest Common SubSequence (LCSS), Early Abandoned.
+   *  Same result as 'lcss' (same parameter), computed on the rows of the LCS matrix encoded as bit vectors:
+   *  the bit j of a row is 0 iff the LCS increases at column j (see Hyyro, "Bit-parallel LCS-length computation
+   *  revisited", 2004). A row is updated from the previous one, 64 columns at a time, by
+   *    U = V & M;  V = (V + U) | (V - U)
+   *  where M is the bit vector of the similar cells of the row. Cells outside of the window are never similar:
+   *  the words entirely outside of the window are left unchanged (all ones on the right of the window), so only
+   *  the (2w+1)/64 + 1 words covering the window are updated per row.
+   *  The LCS so far is the number of 0 bits: the EAP cutoff becomes an early abandon on the number of achievable
+   *  matches (LCS so far plus the number of remaining lines), as in 'lcss'.
+   * @tparam EqualLength  If true, length1==length2: the window always allows an alignment, and the end of the
+   *                      window on a line is computed without the unsigned overflow checks
+   * @param buffer_v    Buffer used to perform the computation. Will reallocate if required.
+   */
+  template<typename F, bool EqualLength = false>
+  F lcss_bitparallel(const size_t length1,
+                     const size_t length2,
+                     utils::ICFun<bool> auto cfun_sim,
+                     const size_t w,
+                     F cutoff,
+                     std::vector<uint64_t>& buffer_v
+  ) {
+    constexpr F PINF = utils::PINF<F>;
+    if (length1==0&&length2==0) { return 0; }
+    else if ((length1==0)!=(length2==0)) { return PINF; }
+    else {
+      assert(!EqualLength||length1==length2);
+      const auto m = std::min(length1, length2);
+      if constexpr (!EqualLength) {
+        const auto M = std::max(length1, length2);
+        if (M - m>w) { return PINF; }
+      }
+      // Window capped to the length: i+wl+1 does not overflow
+      [[maybe_unused]] const size_t wl = std::min(w, length2);
+      // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+      // One bit per column, init to 1 (no match). The bits past length2 stay at 1.
+      buffer_v.assign((length2 + 63)/64, ~uint64_t{0});
+      uint64_t *V = buffer_v.data();
+      // Do we need to EA? Target the same number of matches as 'lcss'
+      const bool do_ea = !(cutoff>1||std::isnan(cutoff)||std::isinf(cutoff));
+      size_t to_reach = 0;
+      if (do_ea) { to_reach = std::ceil((1 - std::max<F>(0.0, cutoff))*m); }
+      size_t nb_matches = 0; // Number of 0 bits in V
+      for (size_t i{0}; i<length1; ++i) {
+        // --- --- --- Stop if not enough remaining lines to reach the target (by taking the diagonal)
+        if (do_ea&&nb_matches + (length1 - i)<to_reach) { return PINF; }
+        // --- --- --- Words covering the window. The checked window ensures jStart<jStop.
+        const size_t jStart = utils::cap_start_index_to_window(i, w);
+        size_t jStop;
+        if constexpr (EqualLength) { jStop = std::min(length2, i + wl + 1); }
+        else { jStop = utils::cap_stop_index_to_window_or_end(i, w, length2); }
+        const size_t kStop = (jStop - 1)/64 + 1;
+        uint64_t carry = 0;
+        for (size_t k{jStart/64}; k<kStop; ++k) {
+          // Similar cells of the word, within the window
+          const size_t base = k*64;
+          const size_t jb = std::max(jStart, base);
+          const size_t je = std::min(jStop, base + 64);
+          uint64_t mask = 0;
+          for (size_t j{jb}; j<je; ++j) { mask |= uint64_t{cfun_sim(i, j)} << (j - base); }
+          // U is a subset of V: V - U never borrows, and is V & ~U. Only the addition carries over words.
+          const uint64_t v = V[k];
+          const uint64_t u = v & mask;
+          const uint64_t s1 = v + u;
+          const uint64_t s2 = s1 + carry;
+          carry = (s1<v)|(s2<s1);
+          const uint64_t nv = s2 | (v & ~u);
+          // A 0 bit may move to the next word: the count is only exact at the end of the row (unsigned wrap is ok)
+          nb_matches += (size_t)std::popcount(v);
+          nb_matches -= (size_t)std::popcount(nv);
+          V[k] = nv;
+        }
+        // The last carry is absorbed by the all ones words on the right of the window
+      }
+      // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+      // Finalisation: put the result on a [0 - 1] range - normalize by the minimum value (max +1 we can do)
+      return 1.0 - (F(nb_matches)/(F)m);
+    }
+  }
+
+  /// Helper without having to provide a buffer
+  template<typename F>
+  inline F lcss_bitparallel(size_t length1, size_t length2, utils::ICFun<bool> auto cfun_sim, const size_t w,
+                            F cutoff) {
+    std::vector<uint64_t> v;
+    return lcss_bitparallel<F>(length1, length2, cfun_sim, w, cutoff, v);
+  }
+
+
+  /** LCSS lower bound from the envelopes of the candidate - only applicable for same-length series.
+   *  A point of the query can only match a point of the candidate within the window, i.e. falling strictly within
+   *  epsilon of the window envelopes of the candidate: the number of such points bounds the number of matches.
+   *  Early abandon when the achievable matches fall clearly below the target of 'lcss' (one match of slack
+   *  absorbs the rounding of the target), the final bound being compared to the cutoff.
+   * @tparam F          Floating type used for the computation
+   * @param query       Query series
+   * @param length      Length of the query and of the candidate
+   * @param upper       Upper envelope of the candidate for the window of the LCSS (see get_keogh_envelopes)
+   * @param lower       Lower envelope of the candidate for the window of the LCSS
+   * @param epsilon     Matching threshold of the LCSS
+   * @param cutoff      EAP cutoff of the LCSS. No early abandoning above 1, with +INF or QNAN.
+   * @return +INF if early abandoned, or the lower bound value, in [0, 1]
+   */
+  template<typename F>
+  F lb_lcss(F const *query, size_t length, F const *upper, F const *lower, F epsilon, F cutoff) {
+    if (length==0) { return 0; }
+    const bool do_ea = !(cutoff>1||std::isnan(cutoff)||std::isinf(cutoff));
+    size_t to_reach = 0;
+    if (do_ea) { to_reach = std::ceil((1 - std::max<F>(0.0, cutoff))*length); }
+    // Decrease the achievable matches, comparing as the similarity function (see univariate::idx_simdiff)
+    size_t achievable = length;
+    for (size_t i{0}; i<length&&achievable + 1>=to_reach; ++i) {
+      const F qi = query[i];
+      const bool out = qi>upper[i] ? !(qi - upper[i]<epsilon) : (qi<lower[i]&&!(lower[i] - qi<epsilon));
+      if (out) { --achievable; }
+    }
+    const F lb = 1.0 - (F(achievable)/(F)length);
+    return lb>cutoff ? utils::PINF<F> : lb;
+  }
+
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Specific cost functions
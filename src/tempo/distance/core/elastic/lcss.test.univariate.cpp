@@ -1,6 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "lcss.hpp"
+#include "dtw_lb_keogh.hpp"
 
 #include <mock/mockseries.hpp>
 
@@ -253,3 +254,97 @@ TEST_CASE("Univariate LCSS Variable length", "[lcss][univariate]") {
   }// End section
 
 }
+
+TEST_CASE("Univariate bit-parallel LCSS", "[lcss][univariate]") {
+  // Series long enough to span several words
+  mock::Mocker mocker;
+  mocker._minl = 60;
+  mocker._maxl = 200;
+  const auto& wratios = mocker.wratios;
+  const auto& epsilons = mocker.epsilons;
+  const auto fset = mocker.vec_rs_randvec(100);
+
+  SECTION("Same as LCSS") {
+    for (size_t i = 0; i<fset.size() - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (double e : epsilons) {
+        for (double wr : wratios) {
+          const auto w = (size_t)(wr*(std::max(s1.size(), s2.size())));
+          INFO("Same number of matches. Expect exact floating point equality.");
+          const auto v = lcss(s1.size(), s2.size(), cfun(e)(s1, s2), w, QNAN);
+          REQUIRE(lcss_bitparallel(s1.size(), s2.size(), cfun(e)(s1, s2), w, QNAN)==v);
+          REQUIRE(lcss_bitparallel(s1.size(), s2.size(), cfun(e)(s1, s2), w, PINF)==v);
+          REQUIRE(lcss_bitparallel(s1.size(), s2.size(), cfun(e)(s1, s2), utils::NO_WINDOW, PINF)
+                  ==lcss(s1.size(), s2.size(), cfun(e)(s1, s2), utils::NO_WINDOW, PINF));
+          // Same early abandoning decisions, with the cutoff on both sides of the result
+          for (double cutoff : {0.0, v*0.9, v, v*1.1, 1.0}) {
+            REQUIRE(lcss_bitparallel(s1.size(), s2.size(), cfun(e)(s1, s2), w, cutoff)
+                    ==lcss(s1.size(), s2.size(), cfun(e)(s1, s2), w, cutoff));
+          }
+        }
+      }
+    }
+  }
+
+}
+
+TEST_CASE("Univariate bit-parallel LCSS Equal length kernel", "[lcss][univariate]") {
+  // Series long enough to span several words
+  mock::Mocker mocker;
+  mocker._fixl = 150;
+  const auto& wratios = mocker.wratios;
+  const auto& epsilons = mocker.epsilons;
+  const auto fset = mocker.vec_randvec(100);
+  const size_t l = mocker._fixl;
+  std::vector<uint64_t> buffer;
+
+  SECTION("Same as bit-parallel LCSS") {
+    for (size_t i = 0; i<fset.size() - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (double e : epsilons) {
+        for (size_t w : {(size_t)(wratios.front()*l), (size_t)(wratios.back()*l), utils::NO_WINDOW}) {
+          const auto v = lcss_bitparallel(l, l, cfun(e)(s1, s2), w, PINF);
+          REQUIRE((lcss_bitparallel<F, true>(l, l, cfun(e)(s1, s2), w, PINF, buffer)==v));
+          for (double cutoff : {0.0, v*0.9, v, v*1.1, 1.0}) {
+            REQUIRE((lcss_bitparallel<F, true>(l, l, cfun(e)(s1, s2), w, cutoff, buffer)
+                     ==lcss_bitparallel(l, l, cfun(e)(s1, s2), w, cutoff)));
+          }
+        }
+      }
+    }
+  }
+
+}
+
+TEST_CASE("Univariate LCSS lower bound", "[lcss][univariate][lb]") {
+  mock::Mocker mocker;
+  const auto& wratios = mocker.wratios;
+  const auto& epsilons = mocker.epsilons;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t l = mocker._fixl;
+  std::vector<F> upper(l);
+  std::vector<F> lower(l);
+
+  SECTION("Lower bound") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (double wr : wratios) {
+        const auto w = (size_t)(wr*l);
+        core::univariate::get_keogh_envelopes(s2.data(), l, upper.data(), lower.data(), w);
+        for (double e : epsilons) {
+          const auto v = lcss(l, l, cfun(e)(s1, s2), w, QNAN);
+          REQUIRE(lb_lcss(s1.data(), l, upper.data(), lower.data(), e, QNAN)<=v);
+          // Abandoned only if LCSS is above the cutoff
+          for (double cutoff : {0.0, v*0.9, v, v*1.1, 1.0}) {
+            const F lb = lb_lcss(s1.data(), l, upper.data(), lower.data(), e, cutoff);
+            if (lb==PINF) { REQUIRE(v>cutoff); } else { REQUIRE(lb<=v); }
+          }
+        }
+      }
+    }
+  }
+
+}
@@ -2,6 +2,8 @@
 
 #include "../utils.private.hpp"
 
+#include <algorithm>
+
 namespace tempo::distance::core {
 
   namespace internal {
@@ -242,6 +244,46 @@ namespace tempo::distance::core {
     return msm(length1, length2, cfun_lines, cfun_cols, cfun_diag, cutoff, v);
   }
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Lower bounds
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** MSM lower bound from the range of the candidate - applicable for series of any lengths.
+   *  The first points are always aligned together. Every other point of the query enters the alignment once: either
+   *  by a move, costing at least its distance to the range [min, max] of the candidate, or by a split/merge, costing
+   *  at least 'cost'. A point outside of the range and moving away from the previous one is never between the
+   *  previous point and a point of the candidate: a split/merge then also costs the smallest of the two distances.
+   * @tparam F          Floating type used for the computation
+   * @param query       Query series
+   * @param length1     Length of the query
+   * @param candidate   Candidate series
+   * @param length2     Length of the candidate
+   * @param cost        Cost of the split and merge operations
+   * @param cutoff      Cut-off value (strictly) above which we early abandon ("best so far")
+   * @return +INF if early abandoned, or the lower bound value
+   */
+  template<typename F>
+  F lb_msm(F const *query, size_t length1, F const *candidate, size_t length2, F cost, F cutoff) {
+    if (length1==0||length2==0) { return 0; }
+    if (std::isnan(cutoff)) { cutoff = utils::PINF<F>; }
+    const auto [it_min, it_max] = std::minmax_element(candidate, candidate + length2);
+    const F cmin{*it_min};
+    const F cmax{*it_max};
+    F lb = std::abs(query[0] - candidate[0]);
+    for (size_t i = 1; i<length1&&lb<=cutoff; ++i) {
+      const F qi{query[i]};
+      const F qp{query[i - 1]};
+      if (qi>cmax) {
+        const F d = qi - cmax;
+        lb += std::min<F>(d, qi>qp ? cost + std::min<F>(qi - qp, d) : cost);
+      } else if (qi<cmin) {
+        const F d = cmin - qi;
+        lb += std::min<F>(d, qi<qp ? cost + std::min<F>(qp - qi, d) : cost);
+      }
+    }
+    return (lb>cutoff) ? utils::PINF<F> : lb;
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Specific cost functions
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -284,6 +326,27 @@ namespace tempo::distance::core {
       };
     }
 
+    /** Same as _msm_cost, with the first difference dx = xnew - xi precomputed (see utils::first_differences).
+     *  Same result: for finite values, xi<=xnew is dx>=0. Per cell, |xnew - xi| is not recomputed, and xi not read.
+     */
+    template<typename F>
+    inline F _msm_cost_diff(F xnew, F dx, F yj, F cost) {
+      if (((dx>=0)&&(xnew<=yj))||((yj<=xnew)&&(dx<=0))) { return cost; }
+      else { return cost + std::min(std::abs(dx), std::abs(xnew - yj)); }
+    }
+
+    /// MSM lines Indexed Cost Function Builder, with the first differences of the lines
+    template<typename F, utils::Subscriptable D>
+    inline utils::ICFun<F> auto idx_msm_lines_diff(const D& lines, const D& dlines, const D& cols, const F c) {
+      return [&, c](size_t i, size_t j) { return _msm_cost_diff<F>(lines[i], dlines[i], cols[j], c); };
+    }
+
+    /// MSM columns Indexed Cost Function Builder, with the first differences of the columns
+    template<typename F, utils::Subscriptable D>
+    inline utils::ICFun<F> auto idx_msm_cols_diff(const D& lines, const D& cols, const D& dcols, const F c) {
+      return [&, c](size_t i, size_t j) { return _msm_cost_diff<F>(cols[j], dcols[j], lines[i], c); };
+    }
+
     /// MSM diagonal Indexed Cost Function Builder
     template<typename F, utils::Subscriptable D>
     constexpr inline utils::ICFun<F> auto idx_msm_diag(const D& lines, const D& cols) {
@@ -241,3 +241,52 @@ TEST_CASE("Univariate MSM Variable length", "[msm][univariate]") {
   }// End section
 
 }
+
+TEST_CASE("Univariate MSM with first differences", "[msm][univariate]") {
+  mock::Mocker mocker;
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+  constexpr auto cfline_diff = tempo::distance::core::univariate::idx_msm_lines_diff<F, std::vector<F>>;
+  constexpr auto cfcol_diff = tempo::distance::core::univariate::idx_msm_cols_diff<F, std::vector<F>>;
+
+  // Exact same result as without the differences, with or without cutoff
+  std::vector<std::vector<F>> diffs;
+  for (const auto& s : fset) {
+    diffs.emplace_back(s.size());
+    utils::first_differences(s.data(), s.size(), diffs.back().data());
+  }
+  for (size_t i = 0; i<nbitems - 1; ++i) {
+    const auto& s1 = fset[i];
+    const auto& s2 = fset[i + 1];
+    for (auto c : mocker.msm_costs) {
+      const F v = msm(s1, s2, c, PINF);
+      for (const F cutoff : {PINF, v, v*0.9}) {
+        const F vd = msm(s1.size(), s2.size(), cfline_diff(s1, diffs[i], s2, c), cfcol_diff(s1, s2, diffs[i + 1], c),
+                         cfdiag(s1, s2), cutoff);
+        REQUIRE(vd==msm(s1, s2, c, cutoff));
+      }
+    }
+  }
+}
+
+TEST_CASE("Univariate MSM lower bound", "[msm][univariate][lb]") {
+  mock::Mocker mocker;
+  const auto& msm_costs = mocker.msm_costs;
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+
+  SECTION("Lower bound") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (auto c : msm_costs) {
+        const auto v = msm(s1, s2, c, QNAN);
+        REQUIRE(lb_msm(s1.data(), s1.size(), s2.data(), s2.size(), c, PINF)<=v);
+        // Abandoned only if MSM is above the cutoff
+        for (double cutoff : {0.0, v*0.9, v, v*1.1}) {
+          const F lb = lb_msm(s1.data(), s1.size(), s2.data(), s2.size(), c, cutoff);
+          if (lb==PINF) { REQUIRE(v>cutoff); } else { REQUIRE(lb<=v); }
+        }
+      }
+    }
+  }
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "../simd.private.hpp"
+#include "adtw.hpp"
+#include "dtw.hpp"
+#include "lcss.hpp"
+
+#include <vector>
+
+namespace tempo::distance::core::simd {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Dependent multivariate DTW, ADTW and LCSS, vectorised over the dimensions
+  // The series are column major: the 'ndim' values of a timestamp are contiguous, and the cost between two
+  // timestamps is computed with one (or a few) SIMD vectors (see sum_cost_avx2).
+  // The EAP kernels (see dtw.hpp, adtw.hpp and lcss.hpp) are flattened in the target specific functions:
+  // the cost function is inlined in the kernel, with the kernel compiled for the instruction set.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  namespace internal {
+
+    #if defined(TEMPO_SIMD_X86)
+
+    template<CFE e>
+    __attribute__((target("avx2,fma"), flatten))
+    double mdtw_avx2(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t ndim,
+                     size_t w, double cutoff, std::vector<double>& buffer) {
+      const auto cfun = [=](size_t i, size_t j) { return sum_cost_avx2<e>(lines + i*ndim, cols + j*ndim, ndim); };
+      return core::dtw<double>(nblines, nbcols, cfun, w, cutoff, buffer);
+    }
+
+    template<CFE e>
+    __attribute__((target("avx512f"), flatten))
+    double mdtw_avx512(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t ndim,
+                       size_t w, double cutoff, std::vector<double>& buffer) {
+      const auto cfun = [=](size_t i, size_t j) { return sum_cost_avx512<e>(lines + i*ndim, cols + j*ndim, ndim); };
+      return core::dtw<double>(nblines, nbcols, cfun, w, cutoff, buffer);
+    }
+
+    template<CFE e>
+    __attribute__((target("avx2,fma"), flatten))
+    double madtw_avx2(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t ndim,
+                      double penalty, double cutoff, std::vector<double>& buffer) {
+      const auto cfun = [=](size_t i, size_t j) { return sum_cost_avx2<e>(lines + i*ndim, cols + j*ndim, ndim); };
+      return core::adtw<double>(nblines, nbcols, cfun, penalty, cutoff, buffer);
+    }
+
+    template<CFE e>
+    __attribute__((target("avx512f"), flatten))
+    double madtw_avx512(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t ndim,
+                        double penalty, double cutoff, std::vector<double>& buffer) {
+      const auto cfun = [=](size_t i, size_t j) { return sum_cost_avx512<e>(lines + i*ndim, cols + j*ndim, ndim); };
+      return core::adtw<double>(nblines, nbcols, cfun, penalty, cutoff, buffer);
+    }
+
+    __attribute__((target("avx2,fma"), flatten))
+    inline double mlcss_avx2(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t ndim,
+                             double epsilon, size_t w, double cutoff, std::vector<size_t>& buffer) {
+      const double e2 = epsilon*epsilon;
+      const auto sim = [=](size_t i, size_t j) {
+        return sum_cost_avx2<CFE::AD2>(lines + i*ndim, cols + j*ndim, ndim)<e2;
+      };
+      return core::lcss<double>(nblines, nbcols, sim, w, cutoff, buffer);
+    }
+
+    __attribute__((target("avx512f"), flatten))
+    inline double mlcss_avx512(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t ndim,
+                               double epsilon, size_t w, double cutoff, std::vector<size_t>& buffer) {
+      const double e2 = epsilon*epsilon;
+      const auto sim = [=](size_t i, size_t j) {
+        return sum_cost_avx512<CFE::AD2>(lines + i*ndim, cols + j*ndim, ndim)<e2;
+      };
+      return core::lcss<double>(nblines, nbcols, sim, w, cutoff, buffer);
+    }
+
+    #endif
+
+  } // End of namespace internal
+
+  /// The SIMD multivariate kernels are only available with AVX2 or AVX-512.
+  inline bool has_multivariate_kernels(ISA isa = detected_isa()) { return isa==ISA::AVX2||isa==ISA::AVX512; }
+
+  #if defined(TEMPO_SIMD_X86)
+
+  /** Dependent multivariate DTW between two column major series of 'ndim' dimensions.
+   *  Same semantic as core::dtw with the cost function sum over the dimensions of |lines[i,d]-cols[j,d]|^e.
+   *  Requires has_multivariate_kernels(isa).
+   */
+  inline double mdtw(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t ndim,
+                     CFE e, size_t w, double cutoff, std::vector<double>& buffer, ISA isa = detected_isa()) {
+    const auto run = [&]<CFE c>() {
+      if (isa==ISA::AVX512) {
+        return internal::mdtw_avx512<c>(lines, nblines, cols, nbcols, ndim, w, cutoff, buffer);
+      } else { return internal::mdtw_avx2<c>(lines, nblines, cols, nbcols, ndim, w, cutoff, buffer); }
+    };
+    switch (e) {
+      case CFE::AD1: return run.template operator()<CFE::AD1>();
+      case CFE::AD2: return run.template operator()<CFE::AD2>();
+      default: return run.template operator()<CFE::SQRT>();
+    }
+  }
+
+  /// Dependent multivariate ADTW, see mdtw
+  inline double madtw(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t ndim,
+                      CFE e, double penalty, double cutoff, std::vector<double>& buffer, ISA isa = detected_isa()) {
+    const auto run = [&]<CFE c>() {
+      if (isa==ISA::AVX512) {
+        return internal::madtw_avx512<c>(lines, nblines, cols, nbcols, ndim, penalty, cutoff, buffer);
+      } else { return internal::madtw_avx2<c>(lines, nblines, cols, nbcols, ndim, penalty, cutoff, buffer); }
+    };
+    switch (e) {
+      case CFE::AD1: return run.template operator()<CFE::AD1>();
+      case CFE::AD2: return run.template operator()<CFE::AD2>();
+      default: return run.template operator()<CFE::SQRT>();
+    }
+  }
+
+  /// Dependent multivariate LCSS: two timestamps match when their Euclidean distance is below epsilon.
+  /// Requires has_multivariate_kernels(isa).
+  inline double mlcss(double const *lines, size_t nblines, double const *cols, size_t nbcols, size_t ndim,
+                      double epsilon, size_t w, double cutoff, std::vector<size_t>& buffer, ISA isa = detected_isa()) {
+    if (isa==ISA::AVX512) {
+      return internal::mlcss_avx512(lines, nblines, cols, nbcols, ndim, epsilon, w, cutoff, buffer);
+    } else { return internal::mlcss_avx2(lines, nblines, cols, nbcols, ndim, epsilon, w, cutoff, buffer); }
+  }
+
+  #endif
+
+} // End of namespace tempo::distance::core::simd
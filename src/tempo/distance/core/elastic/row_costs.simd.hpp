@@ -0,0 +1,149 @@
+#pragma once
+
+#include "../simd.private.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace tempo::distance::core {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Row cost stage
+  // The elastic kernels call their indexed cost function inside the dependency chain of the recurrence, one cell at a
+  // time. RowCosts is an indexed cost function computing the costs of a line within the window all at once, in a
+  // buffer, by a 'fill' function that can be vectorised (see simd::row_costs), the recurrence then reading them.
+  // Any kernel calling its cost function along the lines can use it: the kernels are unchanged, only their costs are
+  // computed ahead. The costs are the ones of the cost function computing 'fill': same results.
+  // A line is filled at its second access: the initial cutoffs of the kernels (along the diagonal) read one cell per
+  // line, computed alone, and do not fill the lines again computed by the recurrence.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Indexed cost function reading the costs of a line from a buffer filled one line at a time.
+   * @tparam F      Floating type used for the computation
+   * @tparam Fill   fill(i, start, stop, out) sets out[j-start] to the cost of the cell (i, j) for j in [start, stop[
+   */
+  template<typename F, typename Fill>
+  class RowCosts {
+    static constexpr size_t NO_LINE = std::numeric_limits<size_t>::max();
+
+    Fill fill;
+    F *costs;
+    size_t nbcols;
+    size_t window;
+    // Line in the buffer, with its window [start, start+width[, and last line accessed outside of the buffer
+    size_t line{NO_LINE};
+    size_t start{0};
+    size_t width{0};
+    size_t pending{NO_LINE};
+
+    F miss(size_t i, size_t j) {
+      if (i==pending) {
+        line = i;
+        start = utils::cap_start_index_to_window(i, window);
+        width = utils::cap_stop_index_to_window_or_end(i, window, nbcols) - start;
+        fill(i, start, start + width, costs);
+        if (j - start<width) { return costs[j - start]; }
+      } else { pending = i; }
+      F c;
+      fill(i, j, j + 1, &c);
+      return c;
+    }
+
+  public:
+
+    /** Row cost stage of the cost function computed by 'fill'.
+     * @param fill      See Fill
+     * @param costs     Buffer of at least min(nbcols, 2*window+1) cells
+     * @param nbcols    Length of the column series
+     * @param window    Warping window, NO_WINDOW for the whole lines. The cells out of the window are still
+     *                  computed, one by one (e.g. by the initial cutoffs of the kernels).
+     */
+    RowCosts(Fill fill, F *costs, size_t nbcols, size_t window) :
+      fill(fill), costs(costs), nbcols(nbcols), window(window) {}
+
+    RowCosts(RowCosts const&) = delete;
+    RowCosts& operator=(RowCosts const&) = delete;
+
+    F operator()(size_t i, size_t j) {
+      // Unsigned arithmetic: j<start wraps above width
+      if (i==line&&j - start<width) { return costs[j - start]; }
+      return miss(i, j);
+    }
+
+    /// Indexed cost function for the kernels, referring to this object (which must outlive it)
+    auto cfun() { return [this](size_t i, size_t j) { return (*this)(i, j); }; }
+  };
+
+} // End of namespace tempo::distance::core
+
+namespace tempo::distance::core::simd {
+
+  namespace internal {
+
+    /// Costs of a_i against b[start..stop[ in out[0..stop-start[
+    template<CFE e>
+    void row_costs_scalar(double ai, double const *b, size_t start, size_t stop, double *out) {
+      for (size_t j = start; j<stop; ++j) { out[j - start] = cost<e>(b[j] - ai); }
+    }
+
+    #if defined(TEMPO_SIMD_X86)
+
+    /// Costs of a line, AVX2 (see row_costs_scalar)
+    template<CFE e>
+    __attribute__((target("avx2,fma")))
+    void row_costs_avx2(double ai, double const *b, size_t start, size_t stop, double *out) {
+      const __m256d va = _mm256_set1_pd(ai);
+      size_t j = start;
+      for (; j + 4<=stop; j += 4) {
+        _mm256_storeu_pd(out + (j - start), cost_avx2<e>(_mm256_sub_pd(_mm256_loadu_pd(b + j), va)));
+      }
+      row_costs_scalar<e>(ai, b, j, stop, out + (j - start));
+    }
+
+    /// Costs of a line, AVX-512 (see row_costs_scalar)
+    template<CFE e>
+    __attribute__((target("avx512f")))
+    void row_costs_avx512(double ai, double const *b, size_t start, size_t stop, double *out) {
+      const __m512d va = _mm512_set1_pd(ai);
+      size_t j = start;
+      for (; j + 8<=stop; j += 8) {
+        _mm512_storeu_pd(out + (j - start), cost_avx512<e>(_mm512_sub_pd(_mm512_loadu_pd(b + j), va)));
+      }
+      row_costs_scalar<e>(ai, b, j, stop, out + (j - start));
+    }
+
+    #endif
+
+    #if defined(TEMPO_SIMD_ARM)
+
+    /// Costs of a line, NEON (see row_costs_scalar)
+    template<CFE e>
+    void row_costs_neon(double ai, double const *b, size_t start, size_t stop, double *out) {
+      const float64x2_t va = vdupq_n_f64(ai);
+      size_t j = start;
+      for (; j + 2<=stop; j += 2) { vst1q_f64(out + (j - start), cost_neon<e>(vsubq_f64(vld1q_f64(b + j), va))); }
+      row_costs_scalar<e>(ai, b, j, stop, out + (j - start));
+    }
+
+    #endif
+
+  } // End of namespace internal
+
+  /** Costs between the point 'ai' of the line series and the points b[start..stop[ of the column series, in
+   *  out[0..stop-start[, e.g. as the 'fill' function of RowCosts. The cost of a difference is computed as by the
+   *  scalar cost functions (|a-b|, (a-b)^2, sqrt(|a-b|)): same values, to the last bit.
+   * @param isa   Instruction set to use. Must be supported by the CPU (not checked).
+   */
+  template<CFE e>
+  inline void row_costs(ISA isa, double ai, double const *b, size_t start, size_t stop, double *out) {
+    #if defined(TEMPO_SIMD_X86)
+    if (isa==ISA::AVX512) { return internal::row_costs_avx512<e>(ai, b, start, stop, out); }
+    if (isa==ISA::AVX2) { return internal::row_costs_avx2<e>(ai, b, start, stop, out); }
+    #endif
+    #if defined(TEMPO_SIMD_ARM)
+    if (isa==ISA::NEON) { return internal::row_costs_neon<e>(ai, b, start, stop, out); }
+    #endif
+    internal::row_costs_scalar<e>(ai, b, start, stop, out);
+  }
+
+} // End of namespace tempo::distance::core::simd
@@ -0,0 +1,112 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "row_costs.simd.hpp"
+#include "dtw.hpp"
+#include "adtw.hpp"
+#include "wdtw.hpp"
+#include "erp.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <vector>
+
+using namespace tempo::distance;
+using namespace tempo::distance::core;
+
+using F = double;
+
+constexpr size_t nbitems = 120;
+constexpr F PINF = utils::PINF<F>;
+
+namespace {
+
+  /// All the instruction sets usable on this CPU
+  std::vector<simd::ISA> available_isa() {
+    std::vector<simd::ISA> result{simd::ISA::SCALAR};
+    const auto detected = simd::detected_isa();
+    if (detected==simd::ISA::AVX2||detected==simd::ISA::AVX512) { result.push_back(simd::ISA::AVX2); }
+    if (detected==simd::ISA::AVX512) { result.push_back(simd::ISA::AVX512); }
+    if (detected==simd::ISA::NEON) { result.push_back(simd::ISA::NEON); }
+    return result;
+  }
+
+  /// Check the kernel run by 'kernel(cfun, cutoff)' with the row costs of (s1, s2) against the per cell costs,
+  /// without cutoff, with a cutoff above the distance and with one below
+  template<simd::CFE e, typename Kernel>
+  void check_kernel(simd::ISA isa, std::vector<F> const& s1, std::vector<F> const& s2, size_t w, Kernel kernel) {
+    const auto cfun = [&](size_t i, size_t j) { return simd::cost<e>(s1[i] - s2[j]); };
+    std::vector<F> costs(s2.size());
+    const auto fill = [&](size_t i, size_t start, size_t stop, F *out) {
+      simd::row_costs<e>(isa, s1[i], s2.data(), start, stop, out);
+    };
+    const F ref = kernel(cfun, PINF);
+    for (const F cutoff : {PINF, ref*1.1, ref*0.9}) {
+      RowCosts<F, decltype(fill)> rc(fill, costs.data(), s2.size(), w);
+      // Same costs: same result, to the last bit
+      REQUIRE(kernel(rc.cfun(), cutoff)==kernel(cfun, cutoff));
+    }
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// The kernels give the same results with the costs of the row cost stage as with the costs computed cell by cell.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+TEST_CASE("Univariate row cost stage", "[dtw][adtw][wdtw][erp][simd][univariate]") {
+  // Setup univariate with variable lengths
+  mock::Mocker mocker(0);
+  mocker._minl = 20;
+  mocker._maxl = 60;
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+  std::vector<F> buffer;
+  std::vector<F> weights(mocker._maxl);
+  wdtw_weights<F>(0.05, weights.data(), weights.size());
+
+  const auto check_all = [&]<simd::CFE e>() {
+    for (const auto isa : available_isa()) {
+      for (size_t q = 0; q + 1<nbitems; q += 3) {
+        const auto& a = fset[q];
+        const auto& b = fset[q + 1];
+        for (const size_t w : {size_t(3), size_t(25), utils::NO_WINDOW}) {
+          check_kernel<e>(isa, a, b, w, [&](auto cfun, F cutoff) {
+            return dtw<F>(a.size(), b.size(), cfun, w, cutoff, buffer);
+          });
+        }
+        const F penalty = 0.1*(F)(q%5);
+        check_kernel<e>(isa, a, b, utils::NO_WINDOW, [&](auto cfun, F cutoff) {
+          return adtw<F>(a.size(), b.size(), cfun, penalty, cutoff, buffer);
+        });
+        check_kernel<e>(isa, a, b, utils::NO_WINDOW, [&](auto cfun, F cutoff) {
+          return wdtw<F>(a.size(), b.size(), cfun, weights, cutoff, buffer);
+        });
+        // Gap value 0.5
+        const auto gvf1 = [&](size_t i) { return simd::cost<e>(a[i] - 0.5); };
+        const auto gvf2 = [&](size_t j) { return simd::cost<e>(b[j] - 0.5); };
+        for (const size_t w : {size_t(3), size_t(25), utils::NO_WINDOW}) {
+          check_kernel<e>(isa, a, b, w, [&](auto cfun, F cutoff) {
+            return erp<F>(a.size(), b.size(), gvf1, gvf2, cfun, w, cutoff, buffer);
+          });
+        }
+      }
+    }
+  };
+
+  SECTION("cfe=0.5") { check_all.template operator()<simd::CFE::SQRT>(); }
+  SECTION("cfe=1") { check_all.template operator()<simd::CFE::AD1>(); }
+  SECTION("cfe=2") { check_all.template operator()<simd::CFE::AD2>(); }
+
+  SECTION("Cells out of the window") {
+    // Computed one by one, e.g. by a kernel without window, or by the completion of the initial cutoff
+    const auto& a = fset[0];
+    const auto& b = fset[1];
+    std::vector<F> costs(b.size());
+    const auto fill = [&](size_t i, size_t start, size_t stop, F *out) {
+      simd::row_costs<simd::CFE::AD1>(simd::ISA::SCALAR, a[i], b.data(), start, stop, out);
+    };
+    RowCosts<F, decltype(fill)> rc(fill, costs.data(), b.size(), 2);
+    for (size_t i = 0; i<a.size(); ++i) {
+      for (size_t j = 0; j<b.size(); ++j) { REQUIRE(rc(i, j)==std::abs(a[i] - b[j])); }
+    }
+  }
+}
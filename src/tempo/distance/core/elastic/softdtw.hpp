@@ -1,13 +1,96 @@
 #pragma once
 
 #include "../utils.private.hpp"
+#include "dtw_wavefront.hpp"
+
+#include <cmath>
 
 namespace tempo::distance::core {
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Soft-DTW (Cuturi and Blondel, "Soft-DTW: a differentiable loss function for time-series", 2017)
+  // DTW where the minimum of the three predecessors is replaced by the soft minimum
+  //   softmin(a, b, c) = -gamma*log(exp(-a/gamma) + exp(-b/gamma) + exp(-c/gamma))
+  // computed in its stable form, shifted by the minimum m of a, b and c (one of the exponentials is 1):
+  //   softmin(a, b, c) = m - gamma*log(exp((m-a)/gamma) + exp((m-b)/gamma) + exp((m-c)/gamma))
+  // The soft minimum is below the minimum: soft-DTW can be negative, and there is no early abandoning.
+  // The cells of an anti-diagonal are independent (see dtw_wavefront.hpp): the soft minimums of an anti-diagonal are
+  // computed in a branch free loop over contiguous arrays, vectorised by the compiler, including the exponentials and
+  // logarithms when a vector math library is available (e.g. glibc's libmvec).
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
   namespace internal {
 
+    /// Stable soft minimum of a, b and c, with the 'invgamma'=1/gamma. +INF if a, b and c are +INF.
+    template<typename F>
+    inline F softmin(F a, F b, F c, F gamma, F invgamma) {
+      const F m = std::min(std::min(a, b), c);
+      // All +INF: shift by 0 instead, the sum of the exponentials being 0 and its log -INF
+      const F s = std::isinf(m) ? F(0) : m;
+      const F sum = std::exp((s - a)*invgamma) + std::exp((s - b)*invgamma) + std::exp((s - c)*invgamma);
+      return s - gamma*std::log(sum);
+    }
+
+    /** Soft-DTW anti-diagonal chunk: compute the cells (i, k-i) for i in [lo, hi], see wavefront_chunk.
+     *  cell(i, k-i) = softmin(d2[i-1], d1[i-1], d1[i]) + cfun(i, k-i)
+     *  Return the minimum of the computed cells.
+     */
+    template<typename F>
+    F softdtw_chunk(utils::ICFun<F> auto& cfun, F gamma, size_t k, size_t lo, size_t hi,
+                    F const *d2, F const *d1, F *out) {
+      const F invgamma = F(1)/gamma;
+      // Costs first, so that the soft minimum loop only reads contiguous arrays
+      for (size_t i = lo; i<=hi; ++i) { out[i] = cfun(i, k - i); }
+      F m = utils::PINF<F>;
+      for (size_t i = lo; i<=hi; ++i) {
+        const F v = softmin<F>(d2[i - 1], d1[i - 1], d1[i], gamma, invgamma) + out[i];
+        out[i] = v;
+        m = std::min(m, v);
+      }
+      return m;
+    }
 
+  } // End of namespace internal
+
+  /** Soft-DTW with a warping window.
+   * @tparam F          Floating type used for the computation
+   * @param length1     Length of the first series.
+   * @param length2     Length of the second series.
+   * @param cfun        Indexed Cost function between two points
+   * @param gamma       Smoothing parameter: soft-DTW tends to DTW when gamma tends to 0. DTW if gamma<=0.
+   * @param window      Warping window length, as for DTW
+   * @param buffer_v    Buffer used to perform the computation. Will reallocate if required.
+   * @param nb_threads  Number of threads computing an anti-diagonal; cfun must be thread safe if nb_threads>1.
+   * @return Soft-DTW between the two series (may be negative), +INF if no alignment is possible given the window
+   *         and the length of the series.
+   */
+  template<typename F>
+  F softdtw(size_t length1, size_t length2, utils::ICFun<F> auto cfun, F gamma, size_t window,
+            std::vector<F>& buffer_v, size_t nb_threads = 1) {
+    constexpr F PINF = utils::PINF<F>;
+    if (length1==0&&length2==0) { return 0; }
+    else if ((length1==0)!=(length2==0)) { return PINF; }
+    const auto m = std::min(length1, length2);
+    const auto M = std::max(length1, length2);
+    if (M - m>window) { return PINF; }
+    const size_t w = std::min(window, M);
+    if (gamma<=0) {
+      return internal::wavefront<F>(length1, length2, w, PINF, nb_threads, buffer_v,
+        [&cfun](size_t k, size_t lo, size_t hi, F const *d2, F const *d1, F *out) {
+          return internal::wavefront_chunk<F>(cfun, k, lo, hi, d2, d1, out);
+        });
+    }
+    return internal::wavefront<F>(length1, length2, w, PINF, nb_threads, buffer_v,
+      [&cfun, gamma](size_t k, size_t lo, size_t hi, F const *d2, F const *d1, F *out) {
+        return internal::softdtw_chunk<F>(cfun, gamma, k, lo, hi, d2, d1, out);
+      });
+  }
 
+  /// Helper without having to provide a buffer
+  template<typename F>
+  inline F softdtw(size_t length1, size_t length2, utils::ICFun<F> auto cfun, F gamma, size_t window) {
+    std::vector<F> v;
+    return softdtw<F>(length1, length2, cfun, gamma, window, v);
   }
 
-}
\ No newline at end of file
+} // End of namespace tempo::distance::core
@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "dtw.hpp"
+#include "softdtw.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <vector>
+
+using namespace tempo::distance;
+using namespace tempo::distance::core;
+
+using F = double;
+
+constexpr size_t nbitems = 200;
+constexpr F PINF = utils::PINF<F>;
+constexpr auto cfun = tempo::distance::univariate::idx_ad2<F, std::vector<F>>;
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Reference
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+namespace ref {
+
+  /// Naive soft-DTW with a window 'w' on the full matrix, with the unshifted soft minimum. Reference code.
+  double softdtw_matrix(const std::vector<double>& series1, const std::vector<double>& series2, double gamma,
+                        size_t w) {
+    const size_t length1 = series1.size();
+    const size_t length2 = series2.size();
+    if (length1==0&&length2==0) { return 0; }
+    if (length1==0||length2==0) { return PINF; }
+    std::vector<std::vector<double>> matrix(length1 + 1, std::vector<double>(length2 + 1, PINF));
+    matrix[0][0] = 0;
+    for (size_t i = 1; i<=length1; ++i) {
+      for (size_t j = 1; j<=length2; ++j) {
+        if ((i>j ? i - j : j - i)>w) { continue; }
+        const double sum = std::exp(-matrix[i - 1][j - 1]/gamma) + std::exp(-matrix[i - 1][j]/gamma)
+                           + std::exp(-matrix[i][j - 1]/gamma);
+        const double d = series1[i - 1] - series2[j - 1];
+        matrix[i][j] = d*d - gamma*std::log(sum);
+      }
+    }
+    return matrix[length1][length2];
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Univariate Soft-DTW", "[softdtw][univariate]") {
+  mock::Mocker mocker;
+  // Small values: the unshifted exponentials of the reference do not underflow
+  mocker._minv = -0.5;
+  mocker._maxv = 0.5;
+  const auto& wratios = mocker.wratios;
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+  std::vector<F> buffer;
+
+  SECTION("Soft-DTW(s1, s2)") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (double gamma : {0.01, 0.1, 1.0}) {
+        for (double wr : wratios) {
+          const auto w = (size_t)(wr*(std::max(s1.size(), s2.size())));
+          const double v_ref = ref::softdtw_matrix(s1, s2, gamma, w);
+          const double v = softdtw<F>(s1.size(), s2.size(), cfun(s1, s2), gamma, w, buffer);
+          if (std::isinf(v_ref)) { REQUIRE(v==PINF); } else { REQUIRE(v==Catch::Approx(v_ref)); }
+          // Same result with several threads on the anti-diagonals
+          REQUIRE(softdtw<F>(s1.size(), s2.size(), cfun(s1, s2), gamma, w, buffer, 3)==v);
+        }
+      }
+    }
+  }
+
+  SECTION("Soft-DTW below DTW, and tending to DTW") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      const double v_dtw = dtw<F>(s1.size(), s2.size(), cfun(s1, s2), utils::NO_WINDOW, utils::QNAN<F>);
+      REQUIRE(softdtw<F>(s1.size(), s2.size(), cfun(s1, s2), 0.0, utils::NO_WINDOW)==Catch::Approx(v_dtw));
+      REQUIRE(softdtw<F>(s1.size(), s2.size(), cfun(s1, s2), 0.1, utils::NO_WINDOW)<=v_dtw);
+      REQUIRE(softdtw<F>(s1.size(), s2.size(), cfun(s1, s2), 1e-6, utils::NO_WINDOW)
+              ==Catch::Approx(v_dtw).margin(1e-3));
+    }
+  }
+
+  SECTION("Large costs") {
+    // The shifted soft minimum does not underflow
+    std::vector<F> s1(50, 0.0);
+    std::vector<F> s2(50, 100.0);
+    const double v = softdtw<F>(s1.size(), s2.size(), cfun(s1, s2), 0.01, utils::NO_WINDOW);
+    REQUIRE(std::isfinite(v));
+    REQUIRE(v<=50*100.0*100.0);
+  }
+
+}
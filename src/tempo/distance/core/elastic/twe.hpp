@@ -255,6 +255,59 @@ namespace tempo::distance::core {
   }
 
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Lower bounds
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Window of lb_twe for a cutoff: matching two points further apart costs more than the cutoff (2*nu per step
+   *  away from the diagonal). Without stiffness or cutoff (+INF or QNAN), the full series (length-1).
+   */
+  template<typename F>
+  size_t twe_lb_window(size_t length, F nu, F cutoff) {
+    if (length==0) { return 0; }
+    const F ratio = cutoff/(2*nu);
+    if (!(nu>0)||!(ratio<(F)(length - 1))) { return length - 1; }
+    return ratio>0 ? (size_t)ratio : 0;
+  }
+
+  /** TWE lower bound from the envelopes of the candidate (LB Keogh like) - only applicable for same-length series.
+   *  Every point of the query but the first enters the alignment once: either by a delete, costing its warping cost,
+   *  or by a match. Within the window, a match costs at least the LB Keogh costs of the point and of the previous
+   *  one; further away, at least the stiffness cost 2*nu*(w+1).
+   * @tparam F          Floating type used for the computation
+   * @param query       Query series
+   * @param length      Length of the query and of the candidate
+   * @param upper       Upper envelope of the candidate for the window 'w' (see get_keogh_envelopes)
+   * @param lower       Lower envelope of the candidate for the window 'w'
+   * @param w           Window of the envelopes, any value (see twe_lb_window for the tightest one)
+   * @param nu          Stiffness parameter
+   * @param lambda      Penalty parameter
+   * @param cutoff      Cut-off value (strictly) above which we early abandon ("best so far")
+   * @return +INF if early abandoned, or the lower bound value
+   */
+  template<typename F>
+  F lb_twe(F const *query, size_t length, F const *upper, F const *lower, size_t w, F nu, F lambda, F cutoff) {
+    using tempo::distance::univariate::ad2;
+    if (length==0) { return 0; }
+    if (std::isnan(cutoff)) { cutoff = utils::PINF<F>; }
+    const F far = (w + 1<length) ? 2*nu*(F)(w + 1) : utils::PINF<F>;
+    const F nl = nu + lambda;
+    const auto keogh = [&](size_t i) -> F {
+      const F qi{query[i]};
+      if (qi>upper[i]) { return ad2<F>(qi, upper[i]); }
+      if (qi<lower[i]) { return ad2<F>(qi, lower[i]); }
+      return 0;
+    };
+    F prev = keogh(0);
+    F lb{0};
+    for (size_t i = 1; i<length&&lb<=cutoff; ++i) {
+      const F k = keogh(i);
+      lb += utils::min<F>(ad2<F>(query[i], query[i - 1]) + nl, k + prev, far);
+      prev = k;
+    }
+    return (lb>cutoff) ? utils::PINF<F> : lb;
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Specific cost functions
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -272,6 +325,13 @@ namespace tempo::distance::core {
       return [&, nl](size_t i) { return tempo::distance::univariate::ad2(s[i], s[i - 1]) + nl; };
     }
 
+    /// Same as idx_twe_warp, with the first differences of the series precomputed (see utils::first_differences)
+    template<typename F, utils::Subscriptable D>
+    inline utils::ICFunOne<F> auto idx_twe_warp_diff(D const& ds, const F nu, const F lambda) {
+      const F nl = nu + lambda;
+      return [&, nl](size_t i) { return ds[i]*ds[i] + nl; };
+    }
+
     /// Default TWE diagonal step cost function (ad2) - Indexed Cost Function Builder
     /// Note: Consider timestamp spaced by a const unit of 1.
     ///       Match case: we always have nu*(|i-j|+|(i-1)-(j-1)|) == 2*nu*|i-j|
@@ -2,6 +2,7 @@
 #include <catch2/catch_approx.hpp>
 
 #include "twe.hpp"
+#include "dtw_lb_keogh.hpp"
 
 #include <mock/mockseries.hpp>
 
@@ -366,4 +367,67 @@ TEST_CASE("Univariate TWE Variable length", "[twe][univariate]") {
     }// End query loop
   }// End section
 
-}
\ No newline at end of file
+}
+TEST_CASE("Univariate TWE with first differences", "[twe][univariate]") {
+  mock::Mocker mocker;
+  const auto& nus = mocker.twe_nus;
+  const auto& lambdas = mocker.twe_lambdas;
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+  constexpr auto cfwarp_diff = tempo::distance::core::univariate::idx_twe_warp_diff<F, std::vector<F>>;
+
+  // Exact same result as without the differences, with or without cutoff
+  std::vector<std::vector<F>> diffs;
+  for (const auto& s : fset) {
+    diffs.emplace_back(s.size());
+    utils::first_differences(s.data(), s.size(), diffs.back().data());
+  }
+  for (size_t i = 0; i<nbitems - 1; ++i) {
+    const auto& s1 = fset[i];
+    const auto& s2 = fset[i + 1];
+    for (auto nu : nus) {
+      for (auto la : lambdas) {
+        const F v = twe(s1, s2, nu, la, PINF);
+        for (const F cutoff : {PINF, v, v*0.9}) {
+          const F vd = twe(s1.size(), s2.size(), cfwarp_diff(diffs[i], nu, la), cfwarp_diff(diffs[i + 1], nu, la),
+                           cfmatch(s1, s2, nu), cutoff);
+          REQUIRE(vd==twe(s1, s2, nu, la, cutoff));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Univariate TWE lower bound", "[twe][univariate][lb]") {
+  mock::Mocker mocker;
+  const auto& nus = mocker.twe_nus;
+  const auto& lambdas = mocker.twe_lambdas;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t l = mocker._fixl;
+  std::vector<F> upper(l);
+  std::vector<F> lower(l);
+
+  SECTION("Lower bound") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      for (auto nu : nus) {
+        for (auto la : lambdas) {
+          const auto v = twe(s1, s2, nu, la, QNAN);
+          // Any window gives a lower bound
+          for (size_t w : {size_t(0), l/4, l}) {
+            core::univariate::get_keogh_envelopes(s2.data(), l, upper.data(), lower.data(), w);
+            REQUIRE(lb_twe(s1.data(), l, upper.data(), lower.data(), w, nu, la, PINF)<=v);
+          }
+          // Abandoned only if TWE is above the cutoff
+          for (double cutoff : {0.0, v*0.9, v, v*1.1}) {
+            const size_t w = twe_lb_window(l, nu, cutoff);
+            core::univariate::get_keogh_envelopes(s2.data(), l, upper.data(), lower.data(), w);
+            const F lb = lb_twe(s1.data(), l, upper.data(), lower.data(), w, nu, la, cutoff);
+            if (lb==PINF) { REQUIRE(v>cutoff); } else { REQUIRE(lb<=v); }
+          }
+        }
+      }
+    }
+  }
+
+}
@@ -11,7 +11,7 @@ namespace tempo::distance::core {
      * @param nblines       Length of the line series.
      * @param nbcols        Length of the column series.
      * @param cfun          Indexed Cost function between two points
-     * @param weights       Multiplicative weights. Must be at least as long as the longest series (not checked).
+     * @param wfun          Indexed multiplicative weight of the alignment of two points, depending on |i-j| only
      * @param cutoff        EAP cutoff; Attempt to prune computation of alignments with cost > cutoff.
      *                      May lead to early abandoning.
      * @param buffers_v     Buffer used to perform the computation. Will reallocate if required.
@@ -21,7 +21,7 @@ namespace tempo::distance::core {
     F wdtw(const size_t nblines,
            const size_t nbcols,
            utils::ICFun<F> auto cfun,
-           const utils::Subscriptable auto& weights,
+           utils::ICFun<F> auto wfun,
            F cutoff,
            std::vector<F>& buffers_v
     ) {
@@ -39,7 +39,7 @@ namespace tempo::distance::core {
       // Create a new tighter upper bounds (most commonly used in the code).
       // First, take the "next float" after "cutoff" to deal with numerical instability.
       // Then, subtract the cost of the last alignment.
-      const F ub = nextafter(cutoff, PINF) - cfun(nblines - 1, nbcols - 1)*weights[0];
+      const F ub = nextafter(cutoff, PINF) - cfun(nblines - 1, nbcols - 1)*wfun(nblines - 1, nbcols - 1);
 
       // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
       // Double buffer allocation, init to +INF.
@@ -76,7 +76,7 @@ namespace tempo::distance::core {
         }
         // --- --- --- Stage 1: Up to the previous pruning point while advancing next_start: diag and top
         for (; j==next_start&&j<prev_pp; ++j) {
-          const auto d = cfun(i, j)*weights[utils::absdiff(i, j)];
+          const auto d = cfun(i, j)*wfun(i, j);
           cost = std::min(buffers[p + j - 1], buffers[p + j]) + d;
           buffers[c + j] = cost;
           if (cost<=ub) { curr_pp = j + 1; }
@@ -84,14 +84,14 @@ namespace tempo::distance::core {
         }
         // --- --- --- Stage 2: Up to the previous pruning point without advancing next_start: left, diag and top
         for (; j<prev_pp; ++j) {
-          const auto d = cfun(i, j)*weights[utils::absdiff(i, j)];
+          const auto d = cfun(i, j)*wfun(i, j);
           cost = min(cost, buffers[p + j - 1], buffers[p + j]) + d;
           buffers[c + j] = cost;
           if (cost<=ub) { curr_pp = j + 1; }
         }
         // --- --- --- Stage 3: At the previous pruning point. Check if we are within bounds.
         if (j<nbcols) { // If so, two cases.
-          const auto d = cfun(i, j)*weights[utils::absdiff(i, j)];
+          const auto d = cfun(i, j)*wfun(i, j);
           if (j==next_start) { // Case 1: Advancing next start: only diag.
             cost = buffers[p + j - 1] + d;
             buffers[c + j] = cost;
@@ -118,7 +118,7 @@ namespace tempo::distance::core {
         // --- --- --- Stage 4: After the previous pruning point: only prev.
         // Go on while we advance the curr_pp; if it did not advance, the rest of the line is guaranteed to be > ub.
         for (; j==curr_pp&&j<nbcols; ++j) {
-          const auto d = cfun(i, j)*weights[utils::absdiff(i, j)];
+          const auto d = cfun(i, j)*wfun(i, j);
           cost = cost + d;
           buffers[c + j] = cost;
           if (cost<=ub) { ++curr_pp; }
@@ -134,6 +134,39 @@ namespace tempo::distance::core {
       else { return PINF; }
     }
 
+    /// WDTW with the cutoff conventions of core::wdtw, with an indexed weight function
+    template<typename F>
+    inline F wdtw_cutoff(size_t nblines,
+                         size_t nbcols,
+                         utils::ICFun<F> auto cfun,
+                         utils::ICFun<F> auto wfun,
+                         F cutoff,
+                         std::vector<F>& buffer_v
+    ) {
+      constexpr F PINF = utils::PINF<F>;
+
+      if (nblines==0&&nbcols==0) { return 0; }
+      else if ((nblines==0)!=(nbcols==0)) { return PINF; }
+      else {
+        // Compute a cutoff point using the diagonal
+        if (std::isinf(cutoff)) {
+          cutoff = 0;
+          // Cover diagonal
+          const auto m = std::min(nblines, nbcols);
+          for (size_t i{0}; i<m; ++i) { cutoff = cutoff + cfun(i, i)*wfun(i, i); }
+          // Fewer line than columns: complete the last line (advance in the columns)
+          if (nblines<nbcols) {
+            for (size_t j{nblines}; j<nbcols; ++j) { cutoff = cutoff + cfun(nblines - 1, j)*wfun(nblines - 1, j); }
+          } // Fewer columns than lines: complete the last column (advance in the lines)
+          else if (nbcols<nblines) {
+            for (size_t i{nbcols}; i<nblines; ++i) { cutoff = cutoff + cfun(i, nbcols - 1)*wfun(i, nbcols - 1); }
+          }
+        } else if (std::isnan(cutoff)) { cutoff = PINF; }
+        // ub computed
+        return wdtw(nblines, nbcols, cfun, wfun, cutoff, buffer_v);
+      }
+    }
+
   } // End of namespace internal
 
   /** Weighted Dynamic Time Warping (WDTW) Early Abandoned and Pruned (EAP).
@@ -157,32 +190,29 @@ namespace tempo::distance::core {
                 F cutoff,
                 std::vector<F>& buffer_v
   ) {
-    constexpr F PINF = utils::PINF<F>;
-
-    if (nblines==0&&nbcols==0) { return 0; }
-    else if ((nblines==0)!=(nbcols==0)) { return PINF; }
-    else {
-      // Compute a cutoff point using the diagonal
-      if (std::isinf(cutoff)) {
-        cutoff = 0;
-        // Cover diagonal
-        const auto m = std::min(nblines, nbcols);
-        for (size_t i{0}; i<m; ++i) { cutoff = cutoff + cfun(i, i)*weights[0]; }
-        // Fewer line than columns: complete the last line (advance in the columns)
-        if (nblines<nbcols) {
-          for (size_t j{nblines}; j<nbcols; ++j) {
-            cutoff = cutoff + cfun(nblines - 1, j)*weights[utils::absdiff(nblines - 1, j)];
-          }
-        } // Fewer columns than lines: complete the last column (advance in the lines)
-        else if (nbcols<nblines) {
-          for (size_t i{nbcols}; i<nblines; ++i) {
-            cutoff = cutoff + cfun(i, nbcols - 1)*weights[utils::absdiff(i, nbcols - 1)];
-          }
-        }
-      } else if (std::isnan(cutoff)) { cutoff = PINF; }
-      // ub computed
-      return internal::wdtw(nblines, nbcols, cfun, weights, cutoff, buffer_v);
-    }
+    const auto wfun = [&weights](size_t i, size_t j) -> F { return weights[utils::absdiff(i, j)]; };
+    return internal::wdtw_cutoff<F>(nblines, nbcols, cfun, wfun, cutoff, buffer_v);
+  }
+
+  /** WDTW EAP with mirrored weights (see wdtw_mirror_weights): the weight of the alignment (i, j) is
+   *  mirrored[center + j - i], read without computing |i-j|. Same result as wdtw with the weights of the mirror.
+   * @param mirrored      Mirrored weights, of size 2*center+1
+   * @param center        Index of the weight 0 in 'mirrored': must be at least the length of the longest series minus 1
+   *                      (not checked)
+   * Other parameters as wdtw.
+   */
+  template<typename F>
+  inline F wdtw_mirrored(size_t nblines,
+                         size_t nbcols,
+                         utils::ICFun<F> auto cfun,
+                         F const *mirrored,
+                         size_t center,
+                         F cutoff,
+                         std::vector<F>& buffer_v
+  ) {
+    F const *const base = mirrored + center;
+    const auto wfun = [base](size_t i, size_t j) -> F { return *(base + j - i); };
+    return internal::wdtw_cutoff<F>(nblines, nbcols, cfun, wfun, cutoff, buffer_v);
   }
 
   /// Helper for the above without having to provide a buffer
@@ -231,4 +261,15 @@ namespace tempo::distance::core {
     }
   }
 
+  /// Mirror the 'length' weights (indexed by |i-j|) in 'mirrored', of size 2*length-1, indexed by (length-1)+j-i
+  /// (see wdtw_mirrored, with center = length-1)
+  template<typename F>
+  void wdtw_mirror_weights(F const *weights, size_t length, F *mirrored) {
+    if (length==0) { return; }
+    for (size_t d{0}; d<length; ++d) {
+      mirrored[length - 1 + d] = weights[d];
+      mirrored[length - 1 - d] = weights[d];
+    }
+  }
+
 } // End of namespace tempo::distance::core
@@ -297,3 +297,31 @@ TEST_CASE("Univariate WDTW Variable length", "[wdtw][univariate]") {
   }// End section
 
 }
+
+TEST_CASE("Univariate WDTW mirrored weights", "[wdtw][univariate]") {
+  mock::Mocker mocker;
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+  const auto weight_factors = mocker.randvec(nbweights, 0, 1);
+  // Weights for the longest series: the mirror covers every |i-j|
+  size_t lmax = 0;
+  for (const auto& s : fset) { lmax = std::max(lmax, s.size()); }
+
+  for (double g : weight_factors) {
+    std::vector<F> weights(lmax);
+    wdtw_weights(g, weights.data(), lmax);
+    std::vector<F> mirrored(2*lmax - 1);
+    wdtw_mirror_weights(weights.data(), lmax, mirrored.data());
+    std::vector<F> buffer;
+
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      INFO("Same operations as wdtw. Expect exact floating point equality.");
+      const F v = wdtw(s1, s2, weights, PINF);
+      REQUIRE(wdtw_mirrored<F>(s1.size(), s2.size(), cfun(s1, s2), mirrored.data(), lmax - 1, PINF, buffer)==v);
+      // Cutoff above and below the distance
+      REQUIRE(wdtw_mirrored<F>(s1.size(), s2.size(), cfun(s1, s2), mirrored.data(), lmax - 1, v*1.1, buffer)==v);
+      REQUIRE(wdtw_mirrored<F>(s1.size(), s2.size(), cfun(s1, s2), mirrored.data(), lmax - 1, v*0.9, buffer)==PINF);
+    }
+  }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "../simd.private.hpp"
+#include "direct.hpp"
+
+namespace tempo::distance::core::simd {
+
+  namespace internal {
+
+    /// Direct Alignment cost, scalar fall back: use the reference implementation tempo::distance::core::directa
+    template<CFE e>
+    double directa_scalar(double const *a, double const *b, size_t length, double cutoff) {
+      const auto cfun = [a, b](size_t i, size_t j) { return cost<e>(a[i] - b[j]); };
+      return core::directa<double>(length, length, cfun, cutoff);
+    }
+
+    #if defined(TEMPO_SIMD_X86)
+
+    /** Direct Alignment cost, AVX2, early abandoned every EA_BLOCK elements.
+     *  Uses 4 accumulators of 4 lanes, hence the summation order differs from the scalar version:
+     *  results may differ in the last bits.
+     */
+    template<CFE e>
+    __attribute__((target("avx2,fma")))
+    double directa_avx2(double const *a, double const *b, size_t length, double cutoff) {
+      __m256d acc0 = _mm256_setzero_pd();
+      __m256d acc1 = _mm256_setzero_pd();
+      __m256d acc2 = _mm256_setzero_pd();
+      __m256d acc3 = _mm256_setzero_pd();
+      size_t i{0};
+      for (; i + EA_BLOCK<=length; i += EA_BLOCK) {
+        acc0 = _mm256_add_pd(acc0, cost_avx2<e>(a + i, b + i));
+        acc1 = _mm256_add_pd(acc1, cost_avx2<e>(a + i + 4, b + i + 4));
+        acc2 = _mm256_add_pd(acc2, cost_avx2<e>(a + i + 8, b + i + 8));
+        acc3 = _mm256_add_pd(acc3, cost_avx2<e>(a + i + 12, b + i + 12));
+        const double partial = hsum_avx2(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+        if (partial>cutoff) { return utils::PINF<double>; }
+      }
+      double total = hsum_avx2(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+      for (; i<length; ++i) { total += cost<e>(a[i] - b[i]); }
+      return (total>cutoff) ? utils::PINF<double> : total;
+    }
+
+    /** Direct Alignment cost, AVX-512, early abandoned every EA_BLOCK elements.
+     *  Uses 2 accumulators of 8 lanes, hence the summation order differs from the scalar version:
+     *  results may differ in the last bits.
+     */
+    template<CFE e>
+    __attribute__((target("avx512f")))
+    double directa_avx512(double const *a, double const *b, size_t length, double cutoff) {
+      __m512d acc0 = _mm512_setzero_pd();
+      __m512d acc1 = _mm512_setzero_pd();
+      size_t i{0};
+      for (; i + EA_BLOCK<=length; i += EA_BLOCK) {
+        acc0 = _mm512_add_pd(acc0, cost_avx512<e>(a + i, b + i));
+        acc1 = _mm512_add_pd(acc1, cost_avx512<e>(a + i + 8, b + i + 8));
+        const double partial = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+        if (partial>cutoff) { return utils::PINF<double>; }
+      }
+      double total = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+      for (; i<length; ++i) { total += cost<e>(a[i] - b[i]); }
+      return (total>cutoff) ? utils::PINF<double> : total;
+    }
+
+    #endif
+
+    #if defined(TEMPO_SIMD_ARM)
+
+    /** Direct Alignment cost, NEON, early abandoned every EA_BLOCK elements.
+     *  Uses 4 accumulators of 2 lanes, each taking 2 vectors per block (see directa_avx2).
+     */
+    template<CFE e>
+    double directa_neon(double const *a, double const *b, size_t length, double cutoff) {
+      float64x2_t acc0 = vdupq_n_f64(0);
+      float64x2_t acc1 = acc0;
+      float64x2_t acc2 = acc0;
+      float64x2_t acc3 = acc0;
+      size_t i{0};
+      for (; i + EA_BLOCK<=length; i += EA_BLOCK) {
+        acc0 = vaddq_f64(acc0, cost_neon<e>(a + i, b + i));
+        acc1 = vaddq_f64(acc1, cost_neon<e>(a + i + 2, b + i + 2));
+        acc2 = vaddq_f64(acc2, cost_neon<e>(a + i + 4, b + i + 4));
+        acc3 = vaddq_f64(acc3, cost_neon<e>(a + i + 6, b + i + 6));
+        acc0 = vaddq_f64(acc0, cost_neon<e>(a + i + 8, b + i + 8));
+        acc1 = vaddq_f64(acc1, cost_neon<e>(a + i + 10, b + i + 10));
+        acc2 = vaddq_f64(acc2, cost_neon<e>(a + i + 12, b + i + 12));
+        acc3 = vaddq_f64(acc3, cost_neon<e>(a + i + 14, b + i + 14));
+        const double partial = hsum_neon(vaddq_f64(vaddq_f64(acc0, acc1), vaddq_f64(acc2, acc3)));
+        if (partial>cutoff) { return utils::PINF<double>; }
+      }
+      double total = hsum_neon(vaddq_f64(vaddq_f64(acc0, acc1), vaddq_f64(acc2, acc3)));
+      for (; i<length; ++i) { total += cost<e>(a[i] - b[i]); }
+      return (total>cutoff) ? utils::PINF<double> : total;
+    }
+
+    #endif
+
+    template<CFE e>
+    double directa(ISA isa, double const *a, double const *b, size_t length, double cutoff) {
+      switch (isa) {
+        #if defined(TEMPO_SIMD_X86)
+        case ISA::AVX512: return directa_avx512<e>(a, b, length, cutoff);
+        case ISA::AVX2: return directa_avx2<e>(a, b, length, cutoff);
+        #endif
+        #if defined(TEMPO_SIMD_ARM)
+        case ISA::NEON: return directa_neon<e>(a, b, length, cutoff);
+        #endif
+        default: return directa_scalar<e>(a, b, length, cutoff);
+      }
+    }
+
+  } // End of namespace internal
+
+  /** Direct Alignment cost with a specialised cost function, Early Abandoned.
+   *  Same semantic as tempo::distance::core::directa, but using the best instruction set available.
+   * @param data1   Pointer to the first series
+   * @param length1 Length of the first series
+   * @param data2   Pointer to the second series
+   * @param length2 Length of the second series
+   * @param e       Cost function exponent
+   * @param cutoff  Early abandoning cutoff - PINF or QNAN for no early abandoning
+   * @param isa     Instruction set to use, default to the detected one. Must be supported by the CPU (not checked).
+   * @return Direct Alignment cost, or +INF if early abandoned or if the lengths differ.
+   */
+  inline double directa(double const *data1, size_t length1, double const *data2, size_t length2,
+                        CFE e, double cutoff, ISA isa = detected_isa()) {
+    if (length1!=length2) { return utils::PINF<double>; }
+    else if (length1==0) { return 0; }
+    switch (e) {
+      case CFE::AD1: return internal::directa<CFE::AD1>(isa, data1, data2, length1, cutoff);
+      case CFE::AD2: return internal::directa<CFE::AD2>(isa, data1, data2, length1, cutoff);
+      default: return internal::directa<CFE::SQRT>(isa, data1, data2, length1, cutoff);
+    }
+  }
+
+} // End of namespace tempo::distance::core::simd
@@ -0,0 +1,173 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "direct.simd.hpp"
+#include "../elastic/dtw_lb_keogh.simd.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <vector>
+
+using namespace tempo::distance;
+using namespace tempo::distance::core;
+
+using F = double;
+
+constexpr size_t nbitems = 500;
+constexpr F PINF = utils::PINF<F>;
+constexpr F QNAN = utils::QNAN<F>;
+
+namespace {
+
+  /// All the instruction sets usable on this CPU
+  std::vector<simd::ISA> available_isa() {
+    std::vector<simd::ISA> result{simd::ISA::SCALAR};
+    const auto detected = simd::detected_isa();
+    if (detected==simd::ISA::AVX2||detected==simd::ISA::AVX512) { result.push_back(simd::ISA::AVX2); }
+    if (detected==simd::ISA::AVX512) { result.push_back(simd::ISA::AVX512); }
+    if (detected==simd::ISA::NEON) { result.push_back(simd::ISA::NEON); }
+    return result;
+  }
+
+  const std::vector<F> exponents{0.5, 1, 2};
+
+}
+
+namespace ref {
+
+  /// Reference cost function
+  template<typename V>
+  auto cfun(F e, V const& s1, V const& s2) {
+    return [e, &s1, &s2](size_t i, size_t j) { return std::pow(std::abs(s1[i] - s2[j]), e); };
+  }
+
+  /// Reference LB Keogh
+  template<typename V>
+  F lb_Keogh(F e, V const& q, V const& up, V const& lo) {
+    const auto cf = [e](F a, F b) { return std::pow(std::abs(a - b), e); };
+    return core::univariate::lb_Keogh<F>(q.data(), q.size(), up.data(), lo.data(), cf, PINF);
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+TEST_CASE("Univariate SIMD directa Fixed length", "[directa][simd][univariate]") {
+  // Setup univariate with fixed length, not a multiple of the SIMD block
+  mock::Mocker mocker(0);
+  mocker._fixl = 101;
+
+  const auto fset = mocker.vec_randvec(nbitems);
+
+  SECTION("directa(s,s) == 0") {
+    for (const auto isa : available_isa()) {
+      for (const F e : exponents) {
+        simd::CFE cfe;
+        REQUIRE(simd::to_cfe(e, cfe));
+        for (const auto& s : fset) {
+          REQUIRE(simd::directa(s.data(), s.size(), s.data(), s.size(), cfe, PINF, isa)==0);
+        }
+      }
+    }
+  }
+
+  SECTION("directa(s1, s2)") {
+    for (const auto isa : available_isa()) {
+      for (const F e : exponents) {
+        simd::CFE cfe;
+        REQUIRE(simd::to_cfe(e, cfe));
+        for (size_t i = 0; i<nbitems - 1; ++i) {
+          const auto& s1 = fset[i];
+          const auto& s2 = fset[i + 1];
+          const F v_ref = directa<F>(s1.size(), s2.size(), ref::cfun(e, s1, s2), QNAN);
+          const F v = simd::directa(s1.data(), s1.size(), s2.data(), s2.size(), cfe, QNAN, isa);
+          INFO("Summation order may change with the instruction set.");
+          REQUIRE(v_ref==Catch::Approx(v));
+        }
+      }
+    }
+  }
+
+  SECTION("NN1 directa") {
+    for (const auto isa : available_isa()) {
+      for (const F e : exponents) {
+        simd::CFE cfe;
+        REQUIRE(simd::to_cfe(e, cfe));
+        // Query loop
+        for (size_t i = 0; i<nbitems; i += 3) {
+          const auto& s1 = fset[i];
+          // Ref Variables
+          size_t idx_ref = 0;
+          double bsf_ref = PINF;
+          // SIMD Variables
+          size_t idx = 0;
+          double bsf = PINF;
+          // NN1 loop
+          for (size_t j = 0; j<nbitems; j += 5) {
+            if (i==j) { continue; }
+            const auto& s2 = fset[j];
+            const F v_ref = directa<F>(s1.size(), s2.size(), ref::cfun(e, s1, s2), QNAN);
+            if (v_ref<bsf_ref) {
+              idx_ref = j;
+              bsf_ref = v_ref;
+            }
+            const F v = simd::directa(s1.data(), s1.size(), s2.data(), s2.size(), cfe, bsf, isa);
+            if (v<bsf) {
+              idx = j;
+              bsf = v;
+            }
+            REQUIRE(idx_ref==idx);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Univariate SIMD LB Keogh Fixed length", "[lb_Keogh][simd][univariate]") {
+  mock::Mocker mocker(0);
+  mocker._fixl = 101;
+
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t w = 10;
+
+  // Envelopes
+  std::vector<std::vector<F>> ups(nbitems, std::vector<F>(mocker._fixl));
+  std::vector<std::vector<F>> los(nbitems, std::vector<F>(mocker._fixl));
+  for (size_t i = 0; i<nbitems; ++i) {
+    core::univariate::get_keogh_envelopes(fset[i].data(), fset[i].size(), ups[i].data(), los[i].data(), w);
+  }
+
+  SECTION("lb_Keogh(s1, s2)") {
+    for (const auto isa : available_isa()) {
+      for (const F e : exponents) {
+        simd::CFE cfe;
+        REQUIRE(simd::to_cfe(e, cfe));
+        for (size_t i = 0; i<nbitems - 1; ++i) {
+          const auto& q = fset[i];
+          const F v_ref = ref::lb_Keogh(e, q, ups[i + 1], los[i + 1]);
+          const F v = simd::lb_Keogh(q.data(), q.size(), ups[i + 1].data(), los[i + 1].data(), cfe, PINF, isa);
+          INFO("Summation order may change with the instruction set.");
+          REQUIRE(v_ref==Catch::Approx(v));
+        }
+      }
+    }
+  }
+
+  SECTION("lb_Keogh early abandoning") {
+    for (const auto isa : available_isa()) {
+      for (const F e : exponents) {
+        simd::CFE cfe;
+        REQUIRE(simd::to_cfe(e, cfe));
+        for (size_t i = 0; i<nbitems - 1; ++i) {
+          const auto& q = fset[i];
+          const F v_ref = ref::lb_Keogh(e, q, ups[i + 1], los[i + 1]);
+          // Cutoff under the bound: must early abandon
+          const F v = simd::lb_Keogh(q.data(), q.size(), ups[i + 1].data(), los[i + 1].data(), cfe, v_ref*0.9, isa);
+          if (v_ref>0) { REQUIRE(v==PINF); }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "utils.private.hpp"
+
+#if defined(__GNUC__)&&(defined(__x86_64__)||defined(__i386__))
+#define TEMPO_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)&&defined(__aarch64__)
+#define TEMPO_SIMD_ARM 1
+#include <arm_neon.h>
+#endif
+
+namespace tempo::distance::core::simd {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Instruction set detection
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Instruction sets for which we provide kernels
+  enum class ISA { SCALAR, AVX2, AVX512, NEON };
+
+  /// Best instruction set available on the running CPU. Detected once.
+  /// NEON (Advanced SIMD) is part of the AArch64 base architecture: always available there.
+  inline ISA detected_isa() {
+    static const ISA isa = []() {
+      #if defined(TEMPO_SIMD_X86)
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f")) { return ISA::AVX512; }
+      if (__builtin_cpu_supports("avx2")&&__builtin_cpu_supports("fma")) { return ISA::AVX2; }
+      #elif defined(TEMPO_SIMD_ARM)
+      return ISA::NEON;
+      #endif
+      return ISA::SCALAR;
+    }();
+    return isa;
+  }
+
+  /// Cost function exponent with a specialised kernel: |a-b|^0.5, |a-b| and |a-b|^2.
+  enum class CFE { SQRT, AD1, AD2 };
+
+  /// Convert an exponent in a CFE. Return false if the exponent has no specialised kernel.
+  inline bool to_cfe(double e, CFE& cfe) {
+    if (e==1.0) { cfe = CFE::AD1; }
+    else if (e==2.0) { cfe = CFE::AD2; }
+    else if (e==0.5) { cfe = CFE::SQRT; }
+    else { return false; }
+    return true;
+  }
+
+  /// Number of elements processed between two early abandoning checks.
+  /// Checking requires an horizontal sum: doing it for every element would defeat the vectorisation.
+  constexpr size_t EA_BLOCK = 16;
+
+  /// Scalar cost of a difference d=a-b
+  template<CFE e>
+  inline double cost(double d) {
+    if constexpr (e==CFE::AD2) { return d*d; }
+    else if constexpr (e==CFE::AD1) { return std::abs(d); }
+    else { return std::sqrt(std::abs(d)); }
+  }
+
+  #if defined(TEMPO_SIMD_X86)
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // AVX2 helpers: 4 doubles
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Cost of a vector of differences
+  template<CFE e>
+  __attribute__((target("avx2,fma"))) inline __m256d cost_avx2(__m256d d) {
+    if constexpr (e==CFE::AD2) { return _mm256_mul_pd(d, d); }
+    else {
+      const __m256d ad = _mm256_andnot_pd(_mm256_set1_pd(-0.0), d);
+      if constexpr (e==CFE::AD1) { return ad; } else { return _mm256_sqrt_pd(ad); }
+    }
+  }
+
+  /// Cost of the differences a[0..3]-b[0..3]
+  template<CFE e>
+  __attribute__((target("avx2,fma"))) inline __m256d cost_avx2(double const *a, double const *b) {
+    return cost_avx2<e>(_mm256_sub_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+  }
+
+  /// Horizontal sum
+  __attribute__((target("avx2,fma"))) inline double hsum_avx2(__m256d v) {
+    const __m128d lo = _mm256_castpd256_pd128(v);
+    const __m128d hi = _mm256_extractf128_pd(v, 1);
+    const __m128d s = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+  }
+
+  /// Sum of the costs of the differences a[0..n[-b[0..n[, e.g. the cost between two multivariate points.
+  /// The last (partial) vector is read with a masked load.
+  template<CFE e>
+  __attribute__((target("avx2,fma"))) inline double sum_cost_avx2(double const *a, double const *b, size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t d = 0;
+    for (; d + 4<=n; d += 4) { acc = _mm256_add_pd(acc, cost_avx2<e>(a + d, b + d)); }
+    if (d<n) {
+      const __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x((long long)(n - d)), _mm256_setr_epi64x(0, 1, 2, 3));
+      const __m256d x = _mm256_sub_pd(_mm256_maskload_pd(a + d, mask), _mm256_maskload_pd(b + d, mask));
+      acc = _mm256_add_pd(acc, cost_avx2<e>(x));
+    }
+    return hsum_avx2(acc);
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // AVX-512 helpers: 8 doubles
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Cost of a vector of differences
+  template<CFE e>
+  __attribute__((target("avx512f"))) inline __m512d cost_avx512(__m512d d) {
+    if constexpr (e==CFE::AD2) { return _mm512_mul_pd(d, d); }
+    else {
+      const __m512d ad = _mm512_abs_pd(d);
+      if constexpr (e==CFE::AD1) { return ad; } else { return _mm512_sqrt_pd(ad); }
+    }
+  }
+
+  /// Cost of the differences a[0..7]-b[0..7]
+  template<CFE e>
+  __attribute__((target("avx512f"))) inline __m512d cost_avx512(double const *a, double const *b) {
+    return cost_avx512<e>(_mm512_sub_pd(_mm512_loadu_pd(a), _mm512_loadu_pd(b)));
+  }
+
+  /// Sum of the costs of the differences a[0..n[-b[0..n[, see sum_cost_avx2
+  template<CFE e>
+  __attribute__((target("avx512f"))) inline double sum_cost_avx512(double const *a, double const *b, size_t n) {
+    __m512d acc = _mm512_setzero_pd();
+    size_t d = 0;
+    for (; d + 8<=n; d += 8) { acc = _mm512_add_pd(acc, cost_avx512<e>(a + d, b + d)); }
+    if (d<n) {
+      const auto mask = (__mmask8)((1u<<(n - d)) - 1);
+      const __m512d x = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + d), _mm512_maskz_loadu_pd(mask, b + d));
+      acc = _mm512_add_pd(acc, cost_avx512<e>(x));
+    }
+    return _mm512_reduce_add_pd(acc);
+  }
+
+  #endif
+
+  #if defined(TEMPO_SIMD_ARM)
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // NEON helpers: 2 doubles
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Cost of a vector of differences
+  template<CFE e>
+  inline float64x2_t cost_neon(float64x2_t d) {
+    if constexpr (e==CFE::AD2) { return vmulq_f64(d, d); }
+    else {
+      const float64x2_t ad = vabsq_f64(d);
+      if constexpr (e==CFE::AD1) { return ad; } else { return vsqrtq_f64(ad); }
+    }
+  }
+
+  /// Cost of the differences a[0..1]-b[0..1]
+  template<CFE e>
+  inline float64x2_t cost_neon(double const *a, double const *b) {
+    return cost_neon<e>(vsubq_f64(vld1q_f64(a), vld1q_f64(b)));
+  }
+
+  /// Horizontal sum
+  inline double hsum_neon(float64x2_t v) { return vaddvq_f64(v); }
+
+  #endif
+
+} // End of namespace tempo::distance::core::simd
@@ -0,0 +1,54 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "cross_correlation.univariate.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace tempo::distance::core::univariate;
+
+using F = double;
+
+constexpr size_t nbitems = 200;
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Univariate SBD from spectra", "[sbd][univariate]") {
+  mock::Mocker mocker;
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+  size_t max_length = 0;
+  for (const auto& s : fset) { max_length = std::max(max_length, s.size()); }
+  const size_t size = sbd_spectrum_size(max_length);
+
+  // Spectra of all the series, with the same maximal length
+  std::vector<std::vector<F>> spectra;
+  for (const auto& s : fset) {
+    const arma::Row<F> r(const_cast<F *>(s.data()), s.size(), false, true);
+    spectra.emplace_back(size);
+    sbd_spectrum<F>(r, max_length, spectra.back().data());
+  }
+
+  SECTION("sbd_spectra(s1, s2) == sbd(s1, s2)") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = fset[i];
+      const auto& s2 = fset[i + 1];
+      const F v_ref = sbd<F>(s1.data(), s1.size(), s2.data(), s2.size());
+      const F v = sbd_spectra<F>(spectra[i].data(), spectra[i + 1].data(), size);
+      REQUIRE(v==Catch::Approx(v_ref).margin(1e-9));
+    }
+  }
+
+  SECTION("Constant 0 series at the max distance") {
+    const std::vector<F> zero(max_length, 0.0);
+    const arma::Row<F> r(const_cast<F *>(zero.data()), zero.size(), false, true);
+    std::vector<F> sz(size);
+    sbd_spectrum<F>(r, max_length, sz.data());
+    REQUIRE(sbd_spectra<F>(sz.data(), spectra[0].data(), size)==2.0);
+  }
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <complex>
+
 #include <tempo/utils/utils.hpp>
 #include <tempo/dataset/tseries.hpp>
 
@@ -8,12 +10,17 @@ namespace tempo::distance::core::univariate {
   namespace cross_correlation {
     // Warning: when used in nearest neighbour search: higher score = more similarity (we want the furthest neighbour!)
 
+    /// Length of the FFT of the cross correlation sequence of series of length at most 'len' (see cc_seq)
+    inline size_t fft_length(size_t len) {
+      return 1 << ::tempo::utils::nextpow2<size_t>(2*len - 1); // 1<<p  == 2^p for unsigned integral
+    }
+
     /// Cross Correlation sequence computation using FFT with a length adjusted to a power of 2 for efficiency.
     /// Based on https://github.com/johnpaparrizos/TSDistEval/blob/master/slidingmeasures/NCC.m
     template<typename F>
     arma::Row<F> cc_seq(arma::Row<F> const& A, arma::Row<F> const& B) {
       size_t len = std::max(A.n_elem, B.n_elem);
-      size_t fftlenght = 1 << ::tempo::utils::nextpow2<size_t>(2*len - 1); // 1<<p  == 2^p for unsigned integral
+      size_t fftlenght = fft_length(len);
       arma::Row<F> r = arma::real(arma::ifft(arma::fft(A, fftlenght)%arma::conj(arma::fft(B, fftlenght))));
       return arma::join_rows(r.cols(fftlenght - len + 1, fftlenght - 1), r.cols(0, len - 1));
     }
@@ -63,4 +70,45 @@ namespace tempo::distance::core::univariate {
     return sbd<F>(ra, rb);
   }
 
+  /// Number of values of the SBD spectrum (see sbd_spectrum) of a series of length at most 'max_length'
+  inline size_t sbd_spectrum_size(size_t max_length) { return 2 + 2*cross_correlation::fft_length(max_length); }
+
+  /** SBD spectrum of a series A of length at most 'max_length', written in 'out' (sbd_spectrum_size(max_length)
+   *  values): the length of A, its norm, then the FFT of A padded to cross_correlation::fft_length(max_length), as
+   *  interleaved real and imaginary parts. Computed once per series, e.g. for the exemplars of a nearest neighbour
+   *  search: sbd_spectra then only does the pointwise products and one inverse FFT.
+   */
+  template<typename F>
+  void sbd_spectrum(arma::Row<F> const& A, size_t max_length, F *out) {
+    const size_t n = cross_correlation::fft_length(max_length);
+    const arma::Row<std::complex<F>> S = arma::fft(A, n);
+    out[0] = (F)A.n_elem;
+    out[1] = arma::norm(A);
+    for (size_t k = 0; k<n; ++k) {
+      out[2 + 2*k] = S[k].real();
+      out[3 + 2*k] = S[k].imag();
+    }
+  }
+
+  /// sbd of two series from their SBD spectra SA and SB (see sbd_spectrum), of 'size' values each:
+  /// the spectra must be computed with the same maximal length.
+  template<typename F>
+  F sbd_spectra(F const *SA, F const *SB, size_t size) {
+    using C = std::complex<F>;
+    const size_t n = (size - 2)/2;
+    const auto len = (size_t)std::max(SA[0], SB[0]);
+    arma::Row<C> p(n);
+    for (size_t k = 0; k<n; ++k) {
+      p[k] = C(SA[2 + 2*k], SA[3 + 2*k])*std::conj(C(SB[2 + 2*k], SB[3 + 2*k]));
+    }
+    const arma::Row<F> r = arma::real(arma::ifft(p));
+    // Maximum over the lags of cc_seq, without building the sequence
+    F m = r[0];
+    for (size_t i = n - len + 1; i<n; ++i) { m = std::max(m, r[i]); }
+    for (size_t i = 1; i<len; ++i) { m = std::max(m, r[i]); }
+    const double cc = m/(SA[1]*SB[1]);
+    if (std::isnan(cc)) { return 2.0; }
+    return ((F)1) - cc;
+  }
+
 } // End of namespace tempo::distance
\ No newline at end of file
@@ -69,6 +69,15 @@ namespace tempo::distance {
       return (SIType)ui;
     }
 
+    /// First differences of a series: diff[i] = series[i] - series[i-1], and diff[0] = 0.
+    /// Precomputed once per series for the MSM and TWE cost functions using them (see idx_msm_lines_diff).
+    template<typename F>
+    inline void first_differences(F const *series, size_t length, F *diff) {
+      if (length==0) { return; }
+      diff[0] = 0;
+      for (size_t i = 1; i<length; ++i) { diff[i] = series[i] - series[i - 1]; }
+    }
+
   } // End of namespace utils
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -2,6 +2,7 @@
 
 #include "utils.hpp"
 #include <cmath>
+#include <type_traits>
 
 namespace tempo::distance {
 
@@ -44,6 +45,112 @@ namespace tempo::distance {
       return [e](F a, F b) -> F { return ade(a, b, e); };
     }
 
+    /// Parameterized Cost function - Absolute Difference with a cfe e multiple of 1/4 (see is_quarter), without pow.
+    /// |a-b|^e is computed as |a-b|^(integer part of e) times a combination of sqrt for the fractional part.
+    template<std::floating_point F>
+    inline F ad_quarter(F a, F b, F e) {
+      const F d = std::abs(a - b);
+      const auto k = (unsigned)(e*4);
+      F r = 1;
+      for (unsigned i = 0; i<k/4; ++i) { r *= d; }
+      switch (k%4) {
+        case 1: { r *= std::sqrt(std::sqrt(d)); break; }
+        case 2: { r *= std::sqrt(d); break; }
+        case 3: {
+          const F s = std::sqrt(d);
+          r *= s*std::sqrt(s);
+          break;
+        }
+        default: break;
+      }
+      return r;
+    }
+
+    /// Largest cfe handled by ad_quarter: the integer part is computed by repeated multiplications
+    constexpr unsigned AD_QUARTER_MAX = 8;
+
+    /// Check if the cfe e can be computed by ad_quarter
+    template<std::floating_point F>
+    inline bool is_quarter(F e) {
+      const F k = e*4;
+      return e>0&&e<=AD_QUARTER_MAX&&k==std::floor(k);
+    }
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Compile time cost function selection
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    /// Kind of cost function for a cfe. Used as a template parameter, the cost function is selected at compile time
+    /// instead of being tested for every call (see the univariate distances taking a CFE).
+    enum class CFE {
+      AD1,      // cfe 1
+      AD2,      // cfe 2
+      SQRT,     // cfe 0.5
+      QUARTER,  // cfe multiple of 1/4 up to AD_QUARTER_MAX (pow free, see ad_quarter)
+      ANY       // any other cfe (uses pow)
+    };
+
+    /// Kind of cost function to use for the cfe e
+    template<std::floating_point F>
+    inline CFE to_cfe(F e) {
+      if (e==1.0) { return CFE::AD1; }
+      else if (e==2.0) { return CFE::AD2; }
+      else if (e==0.5) { return CFE::SQRT; }
+      else if (is_quarter(e)) { return CFE::QUARTER; }
+      else { return CFE::ANY; }
+    }
+
+    /// Call 'fun' with the kind of cost function for the cfe e, as a std::integral_constant.
+    /// Allows to dispatch once on the cfe, and then use a distance specialised for it.
+    template<std::floating_point F, typename Fun>
+    inline decltype(auto) with_cfe(F e, Fun&& fun) {
+      switch (to_cfe(e)) {
+        case CFE::AD1: return fun(std::integral_constant<CFE, CFE::AD1>{});
+        case CFE::AD2: return fun(std::integral_constant<CFE, CFE::AD2>{});
+        case CFE::SQRT: return fun(std::integral_constant<CFE, CFE::SQRT>{});
+        case CFE::QUARTER: return fun(std::integral_constant<CFE, CFE::QUARTER>{});
+        default: return fun(std::integral_constant<CFE, CFE::ANY>{});
+      }
+    }
+
+    /// Cost function |a-b|^e of kind c. The cfe e is only used by CFE::QUARTER and CFE::ANY.
+    template<CFE c, std::floating_point F>
+    inline F adc(F a, F b, [[maybe_unused]] F e) {
+      if constexpr (c==CFE::AD1) { return ad1(a, b); }
+      else if constexpr (c==CFE::AD2) { return ad2(a, b); }
+      else if constexpr (c==CFE::SQRT) { return ad_sqrt(a, b); }
+      else if constexpr (c==CFE::QUARTER) { return ad_quarter(a, b, e); }
+      else { return ade(a, b, e); }
+    }
+
+    /// Pointer on the cost function adc for the cfe e
+    template<std::floating_point F>
+    inline auto adc_for(F e) -> F (*)(F, F, F) {
+      return with_cfe(e, [](auto c) -> F (*)(F, F, F) { return &adc<decltype(c)::value, F>; });
+    }
+
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Derived series
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    /// First derivative at the index i of a series of size 'length', computed on the fly from its values:
+    /// same value as transform::core::univariate::derive (Keogh and Pazzani), the borders copying their neighbour.
+    template<std::floating_point F>
+    inline F derivative_at(F const *series, size_t length, size_t i) {
+      if (length<=2) { return series[i]; }
+      const size_t k = i==0 ? 1 : (i==length - 1 ? length - 2 : i);
+      return ((series[k] - series[k - 1]) + ((series[k + 1] - series[k - 1])/2.0))/2.0;
+    }
+
+    /// Subscriptable first derivative of a raw series (see derivative_at), e.g. for the indexed cost functions below
+    template<std::floating_point F>
+    struct DerivedValues {
+      F const *series;
+      size_t length;
+
+      F operator [](size_t i) const { return derivative_at<F>(series, length, i); }
+    };
 
     // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
     // Indexed Cost function builder
@@ -88,10 +195,95 @@ namespace tempo::distance {
       };
     }
 
+    /// Parameterized Indexed Cost function builder - return a Cost function builder
+    /// Absolute Difference with a cost function of kind c (see adc)
+    template<CFE c, std::floating_point F, utils::Subscriptable D>
+    inline auto idx_adc(F e) {
+      return [e](D const& lines, D const& cols) -> utils::ICFun<F> auto {
+        return [&, e](size_t i, size_t j) {
+          return adc<c, F>(lines[i], cols[j], e);
+        };
+      };
+    }
+
   } // End of namespace univariate
 
   namespace multivariate {
 
+    using univariate::CFE;
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Dependent cost function
+    // A multivariate point is made of 'ndim' contiguous values (column major series, see TSeries).
+    // The cost between two points is the sum, over the dimensions, of the univariate cost function.
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    /// Cost function between two points of 'ndim' dimensions: sum of |a[d]-b[d]|^e, computed with a cost function
+    /// of kind c (see univariate::adc). With CFE::AD2, this is the squared Euclidean distance.
+    template<CFE c, std::floating_point F>
+    inline F adc(F const *a, F const *b, size_t ndim, [[maybe_unused]] F e) {
+      F r = 0;
+      for (size_t d = 0; d<ndim; ++d) { r += univariate::adc<c, F>(a[d], b[d], e); }
+      return r;
+    }
+
+    /// Squared Euclidean distance between two points of 'ndim' dimensions
+    template<std::floating_point F>
+    inline F sqed(F const *a, F const *b, size_t ndim) { return adc<CFE::AD2, F>(a, b, ndim, 2); }
+
+    /// Parameterized Indexed Cost function builder - return a Cost function builder
+    /// Dependent cost function of kind c (see adc) between the points i and j of two column major series
+    template<CFE c, std::floating_point F>
+    inline auto idx_adc(F e, size_t ndim) {
+      return [e, ndim](F const *lines, F const *cols) -> utils::ICFun<F> auto {
+        return [=](size_t i, size_t j) {
+          return adc<c, F>(lines + i*ndim, cols + j*ndim, ndim, e);
+        };
+      };
+    }
+
+    /// Parameterized Indexed Cost function builder - return a Cost function builder
+    /// Check if the points i and j of two column major series are within an Euclidean distance epsilon.
+    /// Use by, e.g., LCSS
+    template<std::floating_point F>
+    inline auto idx_simdiff(F epsilon, size_t ndim) {
+      return [e2 = epsilon*epsilon, ndim](F const *lines, F const *cols) -> utils::ICFun<bool> auto {
+        return [=](size_t i, size_t j) {
+          return sqed<F>(lines + i*ndim, cols + j*ndim, ndim)<e2;
+        };
+      };
+    }
+
+    /// As idx_adc, between two planar series of 'len_lines' and 'len_cols' timestamps: the values of a dimension are
+    /// contiguous (see multivariate::Layout)
+    template<CFE c, std::floating_point F>
+    inline auto idx_adc_planar(F e, size_t ndim, size_t len_lines, size_t len_cols) {
+      return [=](F const *lines, F const *cols) -> utils::ICFun<F> auto {
+        return [=](size_t i, size_t j) {
+          F r = 0;
+          for (size_t d = 0; d<ndim; ++d) {
+            r += univariate::adc<c, F>(lines[d*len_lines + i], cols[d*len_cols + j], e);
+          }
+          return r;
+        };
+      };
+    }
+
+    /// As idx_simdiff, between two planar series of 'len_lines' and 'len_cols' timestamps
+    template<std::floating_point F>
+    inline auto idx_simdiff_planar(F epsilon, size_t ndim, size_t len_lines, size_t len_cols) {
+      return [=, e2 = epsilon*epsilon](F const *lines, F const *cols) -> utils::ICFun<bool> auto {
+        return [=](size_t i, size_t j) {
+          F r = 0;
+          for (size_t d = 0; d<ndim; ++d) {
+            const F diff = lines[d*len_lines + i] - cols[d*len_cols + j];
+            r += diff*diff;
+          }
+          return r<e2;
+        };
+      };
+    }
+
   } // End of namespace multivariate
 
 } // End of namespace tempo::distance
@@ -0,0 +1,125 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "univariate.hpp"
+#include "core/elastic/dtw.hpp"
+
+#include <tempo/transform/core/univariate.derivative.hpp>
+
+#include <mock/mockseries.hpp>
+#include <cmath>
+#include <vector>
+
+using namespace tempo::distance;
+
+using F = double;
+
+constexpr size_t nbitems = 200;
+constexpr F PINF = utils::PINF<F>;
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Cost function kind", "[cost_function]") {
+  REQUIRE(univariate::to_cfe<F>(1.0)==univariate::CFE::AD1);
+  REQUIRE(univariate::to_cfe<F>(2.0)==univariate::CFE::AD2);
+  REQUIRE(univariate::to_cfe<F>(0.5)==univariate::CFE::SQRT);
+  for (const F e : {0.25, 0.75, 1.25, 1.5, 3.0, 4.75, 8.0}) {
+    REQUIRE(univariate::to_cfe<F>(e)==univariate::CFE::QUARTER);
+  }
+  for (const F e : {0.0, 0.1, 1.1, 8.25, 10.0}) {
+    REQUIRE(univariate::to_cfe<F>(e)==univariate::CFE::ANY);
+  }
+}
+
+TEST_CASE("Pow free cost function", "[cost_function]") {
+  mock::Mocker mocker(0);
+  const auto set = mocker.vec_rs_randvec(nbitems);
+  for (const F e : {0.25, 0.75, 1.25, 1.5, 3.0, 4.75, 8.0}) {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = set[i];
+      const auto& s2 = set[i + 1];
+      for (size_t j = 0; j<std::min(s1.size(), s2.size()); ++j) {
+        const F ref = std::pow(std::abs(s1[j] - s2[j]), e);
+        REQUIRE(univariate::ad_quarter(s1[j], s2[j], e)==Catch::Approx(ref).epsilon(1e-12));
+      }
+    }
+  }
+}
+
+TEST_CASE("Compile time cost function", "[cost_function][univariate]") {
+  mock::Mocker mocker(0);
+  const auto set = mocker.vec_rs_randvec(nbitems);
+  std::vector<F> buffer;
+
+  for (const F e : {0.5, 1.0, 2.0, 1.5, 0.3}) {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = set[i];
+      const auto& s2 = set[i + 1];
+      // Reference: pow based cost function
+      const F ref = core::dtw<F>(s1.size(), s2.size(), univariate::idx_ade<F, std::vector<F>>(e)(s1, s2),
+                                 utils::NO_WINDOW, PINF, buffer);
+      // Runtime dispatch
+      const F v = univariate::dtw<F>(s1.data(), s1.size(), s2.data(), s2.size(), e, utils::NO_WINDOW, PINF);
+      REQUIRE(v==Catch::Approx(ref).epsilon(1e-10));
+      // Compile time dispatch
+      const F vc = univariate::with_cfe(e, [&](auto c) {
+        return univariate::dtw<decltype(c)::value, F>(s1.data(), s1.size(), s2.data(), s2.size(), e,
+                                                      utils::NO_WINDOW, PINF);
+      });
+      REQUIRE(vc==v);
+    }
+  }
+}
+
+TEST_CASE("ERP with gap costs", "[cost_function][univariate][erp]") {
+  mock::Mocker mocker(0);
+  const auto set = mocker.vec_rs_randvec(nbitems);
+  std::vector<F> gaps1, gaps2;
+
+  for (const F e : {0.5, 1.0, 2.0, 1.5, 0.3}) {
+    for (const F gv : {0.0, 0.5, -1.0}) {
+      for (size_t i = 0; i<nbitems - 1; ++i) {
+        const auto& s1 = set[i];
+        const auto& s2 = set[i + 1];
+        gaps1.resize(s1.size());
+        gaps2.resize(s2.size());
+        univariate::erp_gap_costs(s1.data(), s1.size(), e, gv, gaps1.data());
+        univariate::erp_gap_costs(s2.data(), s2.size(), e, gv, gaps2.data());
+        const size_t w = std::max(s1.size(), s2.size())/4;
+        const F ref = univariate::erp<F>(s1.data(), s1.size(), s2.data(), s2.size(), e, gv, w, PINF);
+        const F v = univariate::erp<F>(s1.data(), gaps1.data(), s1.size(), s2.data(), gaps2.data(), s2.size(), e, w,
+                                       PINF);
+        REQUIRE(v==ref);
+        const F vf = univariate::erp_gaps_for(e)(s1.data(), gaps1.data(), s1.size(), s2.data(), gaps2.data(),
+                                                 s2.size(), e, w, PINF);
+        REQUIRE(vf==ref);
+      }
+    }
+  }
+}
+
+TEST_CASE("Distances with a derived series", "[cost_function][univariate][derivative]") {
+  mock::Mocker mocker(0);
+  const auto set = mocker.vec_rs_randvec(nbitems);
+  std::vector<F> derived;
+
+  for (size_t i = 0; i<nbitems - 1; ++i) {
+    const auto& s1 = set[i];
+    const auto& s2 = set[i + 1];
+    derived.resize(s2.size());
+    F *out = derived.data();
+    tempo::transform::core::univariate::derive<F>(s2.data(), s2.size(), out);
+    for (size_t j = 0; j<s2.size(); ++j) { REQUIRE(univariate::derivative_at(s2.data(), s2.size(), j)==derived[j]); }
+    const size_t w = std::max(s1.size(), s2.size())/4;
+    for (const F e : {0.5, 1.0, 2.0, 1.5}) {
+      const F dtw = univariate::dtw<F>(s1.data(), s1.size(), derived.data(), derived.size(), e, w, PINF);
+      REQUIRE(univariate::dtw_derived<F>(s1.data(), s1.size(), s2.data(), s2.size(), e, w, PINF)==dtw);
+      const F adtw = univariate::adtw<F>(s1.data(), s1.size(), derived.data(), derived.size(), e, 0.1, PINF);
+      REQUIRE(univariate::adtw_derived<F>(s1.data(), s1.size(), s2.data(), s2.size(), e, 0.1, PINF)==adtw);
+    }
+    const F lcss = univariate::lcss<F>(s1.data(), s1.size(), derived.data(), derived.size(), 0.1, w, PINF);
+    REQUIRE(univariate::lcss_derived<F>(s1.data(), s1.size(), s2.data(), s2.size(), 0.1, w, PINF)==lcss);
+  }
+}
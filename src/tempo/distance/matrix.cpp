@@ -0,0 +1,343 @@
+#include "matrix.hpp"
+#include "univariate.hpp"
+
+#include <tempo/utils/utils/mapped_file.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+
+namespace tempo::distance {
+
+  namespace {
+
+    /// Number of bands used by LB Enhanced (speed/tightness trade-off)
+    constexpr size_t LB_ENHANCED_V = 5;
+
+    /// Bytes of the series of a tile: its rows and its columns (see tile_size)
+    constexpr size_t TILE_BYTES = 256*1024;
+
+    constexpr char MATRIX_MAGIC[8] = {'T', 'D', 'I', 'S', 'T', 'M', 'A', 'T'};
+    constexpr uint32_t MATRIX_VERSION = 1;
+
+    /// Series per side of a tile: 'tile' if set, else as many series of 'max_length' values as fit in TILE_BYTES,
+    /// counting both sides
+    size_t tile_size(size_t tile, size_t max_length) {
+      if (tile>0) { return tile; }
+      const size_t bytes = 2*std::max<size_t>(max_length, 1)*sizeof(F);
+      return std::clamp<size_t>(TILE_BYTES/bytes, 4, 256);
+    }
+
+    /// Distances between 'rows' and 'cols' (the same dataset if 'symmetric'), tile by tile (see distance_matrix)
+    DistanceMatrix compute_matrix(DTS const& rows, DTS const& cols, bool symmetric, DistanceSpec const& distance,
+                                  size_t nb_threads, MatrixOptions const& options) {
+      const size_t nb_rows = rows.size();
+      const size_t nb_cols = cols.size();
+      DistanceMatrix m = options.output ? DistanceMatrix::create(options.output.value(), nb_rows, nb_cols)
+                                        : DistanceMatrix(nb_rows, nb_cols);
+      if (nb_rows==0||nb_cols==0) { return m; }
+      const F threshold = options.threshold;
+
+      // --- Lower bounds: only pruning something below a threshold
+      const bool use_lb = distance.dtw_lb.has_value()&&!std::isinf(threshold);
+      std::vector<KeoghEnvelopes> rows_env;
+      std::vector<KeoghEnvelopes> cols_env;
+      if (use_lb) {
+        rows_env = keogh_envelopes(rows, distance.dtw_lb->second, nb_threads);
+        if (!symmetric) { cols_env = keogh_envelopes(cols, distance.dtw_lb->second, nb_threads); }
+      }
+      std::vector<KeoghEnvelopes> const& cenv = symmetric ? rows_env : cols_env;
+
+      // --- Tiles, row major: consecutive tiles share their rows. Symmetric: on and above the diagonal only.
+      const size_t max_length = std::max(rows.header().length_max(), cols.header().length_max());
+      const size_t tile = tile_size(options.tile, max_length);
+      const size_t nb_row_tiles = (nb_rows + tile - 1)/tile;
+      const size_t nb_col_tiles = (nb_cols + tile - 1)/tile;
+      std::vector<std::pair<size_t, size_t>> tiles;
+      for (size_t bi = 0; bi<nb_row_tiles; ++bi) {
+        for (size_t bj = symmetric ? bi : 0; bj<nb_col_tiles; ++bj) { tiles.emplace_back(bi, bj); }
+      }
+
+      auto task = [&](size_t t) {
+        const auto [bi, bj] = tiles[t];
+        const size_t r0 = bi*tile;
+        const size_t r1 = std::min(nb_rows, r0 + tile);
+        const size_t c0 = bj*tile;
+        const size_t c1 = std::min(nb_cols, c0 + tile);
+        for (size_t i = r0; i<r1; ++i) {
+          TSeries const& a = rows[i];
+          for (size_t j = symmetric ? std::max(c0, i) : c0; j<c1; ++j) {
+            TSeries const& b = cols[j];
+            F d = tempo::utils::PINF;
+            if (!use_lb||!dtw_lb_prune(distance.dtw_lb.value(), a, rows_env[i], b, cenv[j], threshold)) {
+              d = distance.eval(a, b, threshold);
+            }
+            m.at(i, j) = d;
+            // The transposed tile, written by the same task while the tile is in cache
+            if (symmetric&&i!=j) { m.at(j, i) = d; }
+          }
+        }
+      };
+      tempo::utils::ParTasks().execute((int)nb_threads, task, 0, tiles.size());
+      m.sync();
+      return m;
+    }
+
+  } // End of anonymous namespace
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Distance specification
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  DistanceSpec DistanceSpec::parse(std::vector<std::string> const& spec, size_t max_length) {
+    namespace tdu = tempo::distance::univariate;
+    if (spec.empty()) { throw std::invalid_argument("Distance: no name"); }
+    const std::string& name = spec[0];
+    std::vector<F> p;
+    for (size_t i = 1; i<spec.size(); ++i) {
+      try { p.push_back(std::stod(spec[i])); }
+      catch (std::exception const&) {
+        throw std::invalid_argument("Distance " + name + ": invalid parameter " + spec[i]);
+      }
+    }
+    auto expects = [&](size_t nb) {
+      if (p.size()!=nb) {
+        throw std::invalid_argument("Distance " + name + " expects " + std::to_string(nb) + " parameters");
+      }
+    };
+    auto window = [max_length](F ratio) {
+      if (ratio<0) { throw std::invalid_argument("Window ratios must be non negative"); }
+      return ratio>=1 ? max_length : (size_t)(ratio*(F)max_length);
+    };
+
+    DistanceSpec result;
+    result.config["name"] = name;
+    if (name=="directa") {
+      expects(1);
+      const F cfe = p[0];
+      result.config["cfe"] = cfe;
+      result.eval = [cfe](TSeries const& t, TSeries const& q, F cutoff) {
+        return tdu::directa<F>(t.data(), t.length(), q.data(), q.length(), cfe, cutoff);
+      };
+    } else if (name=="dtw") {
+      expects(2);
+      const F cfe = p[0];
+      const size_t w = window(p[1]);
+      const tdu::DTWFun<F> dtwfun = tdu::dtw_for(cfe);
+      result.config["cfe"] = cfe;
+      result.config["window"] = w;
+      result.eval = [=](TSeries const& t, TSeries const& q, F cutoff) {
+        return dtwfun(t.data(), t.length(), q.data(), q.length(), cfe, w, cutoff);
+      };
+      result.dtw_lb = {{cfe, w}};
+    } else if (name=="adtw") {
+      expects(2);
+      const F cfe = p[0];
+      const F penalty = p[1];
+      const tdu::ADTWFun<F> adtwfun = tdu::adtw_for(cfe);
+      result.config["cfe"] = cfe;
+      result.config["penalty"] = penalty;
+      result.eval = [=](TSeries const& t, TSeries const& q, F cutoff) {
+        return adtwfun(t.data(), t.length(), q.data(), q.length(), cfe, penalty, cutoff);
+      };
+    } else if (name=="erp") {
+      expects(3);
+      const F cfe = p[0];
+      const F gap = p[1];
+      const size_t w = window(p[2]);
+      const tdu::ERPFun<F> erpfun = tdu::erp_for(cfe);
+      result.config["cfe"] = cfe;
+      result.config["gap_value"] = gap;
+      result.config["window"] = w;
+      result.eval = [=](TSeries const& t, TSeries const& q, F cutoff) {
+        return erpfun(t.data(), t.length(), q.data(), q.length(), cfe, gap, w, cutoff);
+      };
+    } else if (name=="lcss") {
+      expects(2);
+      const F epsilon = p[0];
+      const size_t w = window(p[1]);
+      result.config["epsilon"] = epsilon;
+      result.config["window"] = w;
+      result.eval = [=](TSeries const& t, TSeries const& q, F cutoff) {
+        return tdu::lcss<F>(t.data(), t.length(), q.data(), q.length(), epsilon, w, cutoff);
+      };
+    } else if (name=="msm") {
+      expects(1);
+      const F cost = p[0];
+      result.config["cost"] = cost;
+      result.eval = [=](TSeries const& t, TSeries const& q, F cutoff) {
+        return tdu::msm<F>(t.data(), t.length(), q.data(), q.length(), cost, cutoff);
+      };
+    } else if (name=="twe") {
+      expects(2);
+      const F nu = p[0];
+      const F lambda = p[1];
+      result.config["nu"] = nu;
+      result.config["lambda"] = lambda;
+      result.eval = [=](TSeries const& t, TSeries const& q, F cutoff) {
+        return tdu::twe<F>(t.data(), t.length(), q.data(), q.length(), nu, lambda, cutoff);
+      };
+    } else { throw std::invalid_argument("Unknown distance " + name); }
+    return result;
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Lower bounds
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  std::vector<KeoghEnvelopes> keogh_envelopes(DTS const& dts, size_t w, size_t nb_threads) {
+    std::vector<KeoghEnvelopes> envelopes(dts.size());
+    auto task = [&](size_t j) {
+      TSeries const& t = dts[j];
+      univariate::get_keogh_envelopes(t.data(), t.length(), envelopes[j].upper, envelopes[j].lower, w);
+    };
+    tempo::utils::ParTasks().execute((int)nb_threads, task, 0, dts.size());
+    return envelopes;
+  }
+
+  bool dtw_lb_prune(std::pair<F, size_t> const& dtw_lb, TSeries const& a, KeoghEnvelopes const& env_a,
+                    TSeries const& b, KeoghEnvelopes const& env_b, F cutoff) {
+    namespace tdu = tempo::distance::univariate;
+    if (std::isinf(cutoff)||a.length()!=b.length()||a.length()==0) { return false; }
+    const auto [cfe, w] = dtw_lb;
+    const auto costfun = tdu::adc_for(cfe);
+    // A lower bound strictly above the cutoff implies a distance above it
+    const size_t last = a.length() - 1;
+    F lb = costfun(a[0], b[0], cfe);
+    if (last>0) { lb += costfun(a[last], b[last], cfe); }
+    return lb>cutoff
+           ||std::isinf(tdu::lb_Keogh(b.data(), b.length(), env_a.upper, env_a.lower, cfe, cutoff))
+           ||std::isinf(tdu::lb_Keogh(a.data(), a.length(), env_b.upper, env_b.lower, cfe, cutoff))
+           ||std::isinf(tdu::lb_Enhanced(b.data(), b.length(), a.data(), a.length(), env_a.upper, env_a.lower,
+                                         cfe, LB_ENHANCED_V, w, cutoff));
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Distance matrix
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  static_assert(sizeof(DistanceMatrix::FileHeader)==64);
+
+  DistanceMatrix::DistanceMatrix(size_t nb_rows, size_t nb_cols) :
+    _nb_rows(nb_rows), _nb_cols(nb_cols),
+    storage(tempo::utils::make_capsule<std::vector<F>>(nb_rows*nb_cols, tempo::utils::PINF)) {
+    _data = tempo::utils::get_capsule_ptr<std::vector<F>>(storage)->data();
+  }
+
+  DistanceMatrix DistanceMatrix::create(std::filesystem::path const& path, size_t nb_rows, size_t nb_cols) {
+    auto file = std::make_shared<tempo::utils::WritableMappedFile>(
+      path, sizeof(FileHeader) + nb_rows*nb_cols*sizeof(F)
+    );
+    FileHeader header{};
+    std::memcpy(header.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC));
+    header.version = MATRIX_VERSION;
+    header.value_size = sizeof(F);
+    header.nb_rows = nb_rows;
+    header.nb_cols = nb_cols;
+    std::memcpy(file->data(), &header, sizeof(FileHeader));
+    DistanceMatrix m;
+    m._nb_rows = nb_rows;
+    m._nb_cols = nb_cols;
+    m._data = reinterpret_cast<F *>(file->data() + sizeof(FileHeader));
+    std::fill(m._data, m._data + nb_rows*nb_cols, tempo::utils::PINF);
+    m.storage = tempo::utils::make_capsule<std::shared_ptr<tempo::utils::WritableMappedFile>>(file);
+    m._sync = [file]() { file->sync(); };
+    return m;
+  }
+
+  DistanceMatrix DistanceMatrix::open(std::filesystem::path const& path) {
+    auto file = std::make_shared<tempo::utils::WritableMappedFile>(path);
+    FileHeader header{};
+    if (file->size()<sizeof(FileHeader)) { throw std::runtime_error("Not a distance matrix: " + path.string()); }
+    std::memcpy(&header, file->data(), sizeof(FileHeader));
+    if (std::memcmp(header.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC))!=0||header.version!=MATRIX_VERSION) {
+      throw std::runtime_error("Not a distance matrix: " + path.string());
+    }
+    if (header.value_size!=sizeof(F)) {
+      throw std::runtime_error("Distance matrix of another floating point type: " + path.string());
+    }
+    if (file->size()!=sizeof(FileHeader) + header.nb_rows*header.nb_cols*sizeof(F)) {
+      throw std::runtime_error("Truncated distance matrix: " + path.string());
+    }
+    DistanceMatrix m;
+    m._nb_rows = header.nb_rows;
+    m._nb_cols = header.nb_cols;
+    m._data = reinterpret_cast<F *>(file->data() + sizeof(FileHeader));
+    m.storage = tempo::utils::make_capsule<std::shared_ptr<tempo::utils::WritableMappedFile>>(file);
+    m._sync = [file]() { file->sync(); };
+    return m;
+  }
+
+  DistanceMatrix distance_matrix(DTS const& dts, DistanceSpec const& distance, size_t nb_threads,
+                                 MatrixOptions const& options) {
+    return compute_matrix(dts, dts, true, distance, nb_threads, options);
+  }
+
+  DistanceMatrix distance_matrix(DTS const& rows, DTS const& cols, DistanceSpec const& distance, size_t nb_threads,
+                                 MatrixOptions const& options) {
+    return compute_matrix(rows, cols, false, distance, nb_threads, options);
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Nearest neighbours
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  std::vector<std::pair<F, size_t>> knn_search(DistanceSpec const& distance, DTS const& candidates,
+                                               std::vector<KeoghEnvelopes> const *candidates_env,
+                                               TSeries const& query, KeoghEnvelopes const& query_env, size_t k,
+                                               SearchCounters& counters) {
+    std::vector<std::pair<F, size_t>> heap;
+    heap.reserve(k + 1);
+    size_t nb_pruned = 0;
+    size_t nb_distances = 0;
+    for (size_t j = 0; j<candidates.size(); ++j) {
+      TSeries const& t = candidates[j];
+      const F cutoff = heap.size()<k ? tempo::utils::PINF : heap.front().first;
+      if (candidates_env!=nullptr
+          &&dtw_lb_prune(distance.dtw_lb.value(), t, (*candidates_env)[j], query, query_env, cutoff)) {
+        ++nb_pruned;
+        continue;
+      }
+      const F d = distance.eval(t, query, cutoff);
+      ++nb_distances;
+      if (heap.size()<k) {
+        heap.emplace_back(d, j);
+        std::push_heap(heap.begin(), heap.end());
+      } else if (d<heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = {d, j};
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+    counters.nb_lb_pruned.fetch_add(nb_pruned, std::memory_order_relaxed);
+    counters.nb_distances.fetch_add(nb_distances, std::memory_order_relaxed);
+    std::sort_heap(heap.begin(), heap.end());
+    return heap;
+  }
+
+  std::vector<std::vector<std::pair<F, size_t>>> knn(DTS const& queries, DTS const& candidates,
+                                                     DistanceSpec const& distance, size_t k, size_t nb_threads,
+                                                     SearchCounters *counters) {
+    SearchCounters local_counters;
+    SearchCounters& c = counters==nullptr ? local_counters : *counters;
+    std::vector<KeoghEnvelopes> candidates_env;
+    if (distance.dtw_lb) { candidates_env = keogh_envelopes(candidates, distance.dtw_lb->second, nb_threads); }
+    std::vector<KeoghEnvelopes> const *env = distance.dtw_lb ? &candidates_env : nullptr;
+    std::vector<std::vector<std::pair<F, size_t>>> result(queries.size());
+    auto task = [&](size_t i) {
+      TSeries const& query = queries[i];
+      thread_local KeoghEnvelopes query_env;
+      if (env!=nullptr) {
+        univariate::get_keogh_envelopes(query.data(), query.length(), query_env.upper, query_env.lower,
+                                        distance.dtw_lb->second);
+      }
+      result[i] = knn_search(distance, candidates, env, query, query_env, k, c);
+    };
+    tempo::utils::ParTasks().execute((int)nb_threads, task, 0, queries.size());
+    return result;
+  }
+
+} // End of namespace tempo::distance
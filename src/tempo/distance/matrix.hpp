@@ -0,0 +1,158 @@
+#pragma once
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/dataset/dts.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tempo::distance {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Distance matrices and nearest neighbours under the univariate distances, given by their specification (see
+  // DistanceSpec), e.g. for clustering, proximity analysis or caching the distances of a small dataset.
+  // The pair space is cut in square tiles of series computed in parallel: the series of a tile stay in cache while
+  // all its pairs are computed. The distances being symmetric, the matrix of a dataset against itself only computes
+  // the tiles on and above the diagonal, each one also written transposed. The distance kernels reuse their buffers
+  // per thread. With a threshold, the distances above it are abandoned early, and for DTW pruned by lower bounds.
+  // A matrix larger than the memory can be written in a mapped file (see DistanceMatrix::create).
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Distance between two series, with an early abandoning cutoff: returns +inf if the distance is strictly above it
+  using SeriesDistance = std::function<F(TSeries const&, TSeries const&, F)>;
+
+  /// Univariate distance built from its specification (see parse)
+  struct DistanceSpec {
+    SeriesDistance eval;
+    /// DTW only: cost function exponent and window of the lower bounds (see dtw_lb_prune)
+    std::optional<std::pair<F, size_t>> dtw_lb;
+    /// Name and parameters
+    nlohmann::json config;
+
+    /** Distance 'spec', its name then its parameters, for series of at most 'max_length' values: directa:<cfe>,
+     *  dtw:<cfe>:<window ratio>, adtw:<cfe>:<penalty>, erp:<cfe>:<gap value>:<window ratio>,
+     *  lcss:<epsilon>:<window ratio>, msm:<cost>, twe:<nu>:<lambda>. A window ratio of 1 or more is unconstrained.
+     *  Throws std::invalid_argument on an unknown distance or invalid parameters.
+     */
+    static DistanceSpec parse(std::vector<std::string> const& spec, size_t max_length);
+  };
+
+  /// Keogh envelopes of a series (see univariate::get_keogh_envelopes)
+  struct KeoghEnvelopes {
+    std::vector<F> upper;
+    std::vector<F> lower;
+  };
+
+  /// Keogh envelopes of the series of 'dts' for the window 'w', on 'nb_threads'
+  std::vector<KeoghEnvelopes> keogh_envelopes(DTS const& dts, size_t w, size_t nb_threads);
+
+  /** True if the DTW 'dtw_lb' (cost function exponent, window) between the same length series 'a' and 'b', with
+   *  their envelopes, is strictly above 'cutoff' by the LB Kim, LB Keogh (both ways) and LB Enhanced cascade.
+   *  False if the series have different lengths.
+   */
+  bool dtw_lb_prune(std::pair<F, size_t> const& dtw_lb, TSeries const& a, KeoghEnvelopes const& env_a,
+                    TSeries const& b, KeoghEnvelopes const& env_b, F cutoff);
+
+  // --- --- --- Distance matrix
+
+  /// Dense row major matrix of distances, in memory or in a mapped file.
+  /// Copies share the values (e.g. the mapping), which live as long as one of them.
+  class DistanceMatrix {
+    size_t _nb_rows{0};
+    size_t _nb_cols{0};
+    F *_data{nullptr};
+    tempo::utils::Capsule storage{};
+    /// Mapped file, if any
+    std::function<void()> _sync{};
+
+  public:
+
+    /// File format: this header (native byte order), followed by the row major values
+    struct FileHeader {
+      char magic[8];
+      uint32_t version;
+      uint32_t value_size;
+      uint64_t nb_rows;
+      uint64_t nb_cols;
+      /// Pad to the alignment of the values
+      uint8_t reserved[32];
+    };
+
+    DistanceMatrix() = default;
+
+    /// In memory matrix of 'nb_rows' x 'nb_cols' distances, set to +inf
+    DistanceMatrix(size_t nb_rows, size_t nb_cols);
+
+    /// Matrix of 'nb_rows' x 'nb_cols' distances set to +inf, in the file 'path' (created or truncated) mapped in
+    /// memory. Throws std::runtime_error if the file cannot be created.
+    static DistanceMatrix create(std::filesystem::path const& path, size_t nb_rows, size_t nb_cols);
+
+    /// Matrix written by create, mapped in memory (written to the file if modified).
+    /// Throws std::runtime_error if the file cannot be mapped, or is not such a matrix.
+    static DistanceMatrix open(std::filesystem::path const& path);
+
+    size_t nb_rows() const { return _nb_rows; }
+
+    size_t nb_cols() const { return _nb_cols; }
+
+    F *data() const { return _data; }
+
+    F& at(size_t row, size_t col) const { return _data[row*_nb_cols + col]; }
+
+    /// Write a mapped matrix to its file, waiting for the writes. Nothing to do in memory.
+    void sync() const { if (_sync) { _sync(); }}
+  };
+
+  /// Options of distance_matrix
+  struct MatrixOptions {
+    /// Distances strictly above are not computed, and stored as +inf; none by default
+    F threshold{tempo::utils::PINF};
+    /// Number of series per side of a tile; 0: the series of a tile fit in 256KiB
+    size_t tile{0};
+    /// If set, write the matrix in this file (see DistanceMatrix::create) instead of memory
+    std::optional<std::filesystem::path> output{};
+  };
+
+  /// Matrix of the distances between the series of 'dts', on 'nb_threads': the entry (i, j) is d(dts[i], dts[j])
+  DistanceMatrix distance_matrix(DTS const& dts, DistanceSpec const& distance, size_t nb_threads,
+                                 MatrixOptions const& options = {});
+
+  /// Matrix of the distances between the series of 'rows' (e.g. train) and the ones of 'cols' (e.g. test), on
+  /// 'nb_threads': the entry (i, j) is d(rows[i], cols[j])
+  DistanceMatrix distance_matrix(DTS const& rows, DTS const& cols, DistanceSpec const& distance, size_t nb_threads,
+                                 MatrixOptions const& options = {});
+
+  // --- --- --- Nearest neighbours
+
+  /// Counters of the nearest neighbours searches, shared by the threads
+  struct SearchCounters {
+    std::atomic<size_t> nb_lb_pruned{0};
+    std::atomic<size_t> nb_distances{0};
+  };
+
+  /** k nearest neighbours of 'query' in 'candidates', in a bounded max-heap of (distance, index): once k neighbours
+   *  are found, the distance of the k-th is the early abandoning cutoff of the next candidates (ties are ignored).
+   *  With 'candidates_env' (DTW), the candidates first go through the lower bound cascade (see dtw_lb_prune),
+   *  'query_env' being the envelopes of the query.
+   *  Return the neighbours by increasing distance.
+   */
+  std::vector<std::pair<F, size_t>> knn_search(DistanceSpec const& distance, DTS const& candidates,
+                                               std::vector<KeoghEnvelopes> const *candidates_env,
+                                               TSeries const& query, KeoghEnvelopes const& query_env, size_t k,
+                                               SearchCounters& counters);
+
+  /// k nearest neighbours in 'candidates' of each series of 'queries' (see knn_search), on 'nb_threads'
+  std::vector<std::vector<std::pair<F, size_t>>> knn(DTS const& queries, DTS const& candidates,
+                                                     DistanceSpec const& distance, size_t k, size_t nb_threads,
+                                                     SearchCounters *counters = nullptr);
+
+} // End of namespace tempo::distance
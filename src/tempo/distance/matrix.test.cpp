@@ -0,0 +1,131 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "matrix.hpp"
+#include "univariate.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+using namespace tempo;
+using namespace tempo::distance;
+
+constexpr size_t nbitems = 60;
+constexpr F PINF = tempo::utils::PINF;
+
+namespace {
+
+  /// Dataset of univariate series built from 'vecs' (mock series, in double)
+  DTS mk_dts(std::vector<std::vector<double>> const& vecs) {
+    std::vector<TSeries> series;
+    std::vector<std::optional<std::string>> labels;
+    size_t minl = std::numeric_limits<size_t>::max();
+    size_t maxl = 0;
+    for (auto const& v : vecs) {
+      minl = std::min(minl, v.size());
+      maxl = std::max(maxl, v.size());
+      series.push_back(TSeries::mk_from_rowmajor(std::vector<F>(v.begin(), v.end()), 1, {"0"}, false));
+      labels.emplace_back("0");
+    }
+    auto header = std::make_shared<DatasetHeader>("mock", minl, maxl, 1, std::move(labels), std::vector<size_t>{});
+    auto transform = std::make_shared<DatasetTransform<TSeries>>(header, "default", std::move(series));
+    return DTS("mock", transform);
+  }
+
+  /// Brute force matrix of the distances between 'rows' and 'cols'
+  std::vector<F> brute_force(DistanceSpec const& distance, DTS const& rows, DTS const& cols) {
+    std::vector<F> result;
+    for (size_t i = 0; i<rows.size(); ++i) {
+      for (size_t j = 0; j<cols.size(); ++j) { result.push_back(distance.eval(rows[i], cols[j], PINF)); }
+    }
+    return result;
+  }
+
+  bool same_matrix(DistanceMatrix const& m, std::vector<F> const& expected) {
+    return std::equal(m.data(), m.data() + m.nb_rows()*m.nb_cols(), expected.begin(), expected.end());
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// The tiled matrices must give the same values as the brute force computation, whatever the tiles and threads.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Distance matrix", "[matrix]") {
+  mock::Mocker mocker(0);
+  const DTS fixed = mk_dts(mocker.vec_randvec(nbitems));
+  const DTS variable = mk_dts(mocker.vec_rs_randvec(nbitems/2));
+  const size_t maxl = std::max(fixed.header().length_max(), variable.header().length_max());
+
+  SECTION("Symmetric and cross matrices") {
+    for (auto const& spec : std::vector<std::vector<std::string>>{
+      {"dtw", "2", "0.1"}, {"adtw", "1", "0.5"}, {"erp", "2", "0.5", "0.2"}, {"msm", "0.5"}, {"twe", "0.01", "0.1"}
+    }) {
+      const DistanceSpec distance = DistanceSpec::parse(spec, maxl);
+      const std::vector<F> expected = brute_force(distance, fixed, fixed);
+      for (const size_t tile : {0, 1, 7, 100}) {
+        for (const size_t nbt : {1, 3}) {
+          const DistanceMatrix m = distance_matrix(fixed, distance, nbt, {.tile=tile});
+          REQUIRE(m.nb_rows()==nbitems);
+          REQUIRE(m.nb_cols()==nbitems);
+          REQUIRE(same_matrix(m, expected));
+        }
+      }
+      const DistanceMatrix c = distance_matrix(fixed, variable, distance, 2, {.tile=5});
+      REQUIRE(c.nb_rows()==fixed.size());
+      REQUIRE(c.nb_cols()==variable.size());
+      REQUIRE(same_matrix(c, brute_force(distance, fixed, variable)));
+    }
+  }
+
+  SECTION("Threshold, with the DTW lower bounds") {
+    const DistanceSpec distance = DistanceSpec::parse({"dtw", "2", "0.2"}, maxl);
+    std::vector<F> expected = brute_force(distance, fixed, fixed);
+    std::vector<F> sorted = expected;
+    std::sort(sorted.begin(), sorted.end());
+    const F threshold = sorted[sorted.size()/4];
+    for (F& d : expected) { if (d>threshold) { d = PINF; }}
+    const DistanceMatrix m = distance_matrix(fixed, distance, 2, {.threshold=threshold, .tile=8});
+    REQUIRE(same_matrix(m, expected));
+  }
+
+  SECTION("Mapped file") {
+    const DistanceSpec distance = DistanceSpec::parse({"msm", "1"}, maxl);
+    const auto path = std::filesystem::temp_directory_path()/"tempo_matrix.test.bin";
+    const std::vector<F> expected = brute_force(distance, fixed, variable);
+    {
+      const DistanceMatrix m = distance_matrix(fixed, variable, distance, 2, {.output=path});
+      REQUIRE(same_matrix(m, expected));
+    }
+    const DistanceMatrix m = DistanceMatrix::open(path);
+    REQUIRE(m.nb_rows()==fixed.size());
+    REQUIRE(m.nb_cols()==variable.size());
+    REQUIRE(same_matrix(m, expected));
+    std::filesystem::remove(path);
+  }
+}
+
+TEST_CASE("k nearest neighbours", "[matrix][knn]") {
+  mock::Mocker mocker(0);
+  const DTS candidates = mk_dts(mocker.vec_randvec(nbitems));
+  const DTS queries = mk_dts(mocker.vec_randvec(nbitems/3));
+  const size_t k = 5;
+
+  for (auto const& spec : std::vector<std::vector<std::string>>{{"dtw", "2", "0.1"}, {"lcss", "0.2", "0.1"}}) {
+    const DistanceSpec distance = DistanceSpec::parse(spec, candidates.header().length_max());
+    const std::vector<F> all = brute_force(distance, queries, candidates);
+    SearchCounters counters;
+    const auto result = knn(queries, candidates, distance, k, 2, &counters);
+    REQUIRE(result.size()==queries.size());
+    for (size_t i = 0; i<queries.size(); ++i) {
+      std::vector<F> row(all.begin() + i*candidates.size(), all.begin() + (i + 1)*candidates.size());
+      std::sort(row.begin(), row.end());
+      REQUIRE(result[i].size()==k);
+      for (size_t n = 0; n<k; ++n) { REQUIRE(result[i][n].first==row[n]); }
+    }
+    REQUIRE(counters.nb_lb_pruned + counters.nb_distances==queries.size()*candidates.size());
+  }
+}
@@ -0,0 +1,77 @@
+#include "multivariate.private.hpp"
+
+namespace tempo::distance::multivariate {
+
+  // Implementation through template explicit instantiation
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Double implementation
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  using F = double;
+
+  // --- --- --- Elastic distances --- --- ---
+
+  template F adtw(F const *data1, size_t length1, F const *data2, size_t length2, size_t ndim,
+                  F cfe, F penalty, F cutoff);
+
+  template F dtw(F const *data1, size_t length1, F const *data2, size_t length2, size_t ndim,
+                 F cfe, size_t window, F cutoff);
+
+  template F lcss(F const *data1, size_t length1, F const *data2, size_t length2, size_t ndim,
+                  F epsilon, size_t window, F cutoff);
+
+  // --- --- --- Lockstep distances --- --- ---
+
+  template F directa(F const *data1, size_t length1, F const *data2, size_t length2, size_t ndim, F cfe, F cutoff);
+
+  // --- --- --- Layouts --- --- ---
+
+  template F adtw(F const *data1, size_t length1, F const *data2, size_t length2, size_t ndim, Layout layout,
+                  F cfe, F penalty, F cutoff);
+
+  template F dtw(F const *data1, size_t length1, F const *data2, size_t length2, size_t ndim, Layout layout,
+                 F cfe, size_t window, F cutoff);
+
+  template F lcss(F const *data1, size_t length1, F const *data2, size_t length2, size_t ndim, Layout layout,
+                  F epsilon, size_t window, F cutoff);
+
+  template F dtw_independent(F const *data1, size_t length1, F const *data2, size_t length2, size_t ndim,
+                             Layout layout, F cfe, size_t window, F cutoff);
+
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Float implementation
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  using Ff = float;
+
+  // --- --- --- Elastic distances --- --- ---
+
+  template Ff adtw(Ff const *data1, size_t length1, Ff const *data2, size_t length2, size_t ndim,
+                   Ff cfe, Ff penalty, Ff cutoff);
+
+  template Ff dtw(Ff const *data1, size_t length1, Ff const *data2, size_t length2, size_t ndim,
+                  Ff cfe, size_t window, Ff cutoff);
+
+  template Ff lcss(Ff const *data1, size_t length1, Ff const *data2, size_t length2, size_t ndim,
+                   Ff epsilon, size_t window, Ff cutoff);
+
+  // --- --- --- Lockstep distances --- --- ---
+
+  template Ff directa(Ff const *data1, size_t length1, Ff const *data2, size_t length2, size_t ndim,
+                      Ff cfe, Ff cutoff);
+
+  // --- --- --- Layouts --- --- ---
+
+  template Ff adtw(Ff const *data1, size_t length1, Ff const *data2, size_t length2, size_t ndim, Layout layout,
+                   Ff cfe, Ff penalty, Ff cutoff);
+
+  template Ff dtw(Ff const *data1, size_t length1, Ff const *data2, size_t length2, size_t ndim, Layout layout,
+                  Ff cfe, size_t window, Ff cutoff);
+
+  template Ff lcss(Ff const *data1, size_t length1, Ff const *data2, size_t length2, size_t ndim, Layout layout,
+                   Ff epsilon, size_t window, Ff cutoff);
+
+  template Ff dtw_independent(Ff const *data1, size_t length1, Ff const *data2, size_t length2, size_t ndim,
+                              Layout layout, Ff cfe, size_t window, Ff cutoff);
+
+} // End of namespace tempo::distance::multivariate
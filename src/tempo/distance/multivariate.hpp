@@ -0,0 +1,133 @@
+#pragma once
+
+#include "utils.hpp"
+#include "cost_functions.hpp"
+#include <vector>
+
+namespace tempo::distance::multivariate {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Dependent multivariate distances
+  // The series are column major: the 'ndim' values of a timestamp are contiguous (as in TSeries).
+  // The lengths are numbers of timestamps. The cost between two timestamps is the sum over the dimensions of the
+  // univariate cost function (see multivariate::adc), e.g. the squared Euclidean distance for cfe=2.
+  // With ndim=1, these are the univariate distances.
+  // For double with the cfe 0.5, 1 and 2, the cost is vectorised over the dimensions when possible.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// ADTW with cost function cfe, penalty, and EAP cutoff.
+  template<typename F>
+  F adtw(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    size_t ndim,
+    F cfe,
+    F penalty,
+    F cutoff
+  );
+
+  /// DTW with cost function cfe, warping window length, and EAP cutoff.
+  /// Use window=NO_WINDOW to use unconstrained DTW.
+  template<typename F>
+  F dtw(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    size_t ndim,
+    F cfe,
+    size_t window,
+    F cutoff
+  );
+
+  /// LCSS with epsilon, warping window, and EAP cutoff.
+  /// Two timestamps match when their Euclidean distance is below epsilon.
+  /// Use window=NO_WINDOW to use unconstrained LCSS.
+  template<typename F>
+  F lcss(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    size_t ndim,
+    F epsilon,
+    size_t window,
+    F cutoff
+  );
+
+  /// Direct alignment with cost function cfe, and early abandoning cutoff.
+  /// The timestamps being aligned one to one, same result with both series planar (see Layout).
+  template<typename F>
+  F directa(F const *data1, size_t length1, F const *data2, size_t length2, size_t ndim, F cfe, F cutoff);
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Layouts of the values of a multivariate series
+  // The dependent distances read all the dimensions of two timestamps for each cost: they suit the interleaved
+  // layout, the one of TSeries, with vectorised kernels. The independent distances compute one univariate distance
+  // per dimension: they suit the planar layout, where each dimension is a contiguous univariate series.
+  // The distances below take both layouts, the two series being in the same one.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// INTERLEAVED: column major, the 'ndim' values of a timestamp are contiguous (value (d, t) at t*ndim+d).
+  /// PLANAR: row major, the 'length' values of a dimension are contiguous (value (d, t) at d*length+t).
+  enum class Layout { INTERLEAVED, PLANAR };
+
+  /// Layout suiting a distance family: planar for the independent distances, else interleaved
+  inline Layout layout_for(bool independent) { return independent ? Layout::PLANAR : Layout::INTERLEAVED; }
+
+  /// Copy the interleaved series 'data' of 'length' timestamps in 'out', planar
+  template<typename F>
+  inline void to_planar(F const *data, size_t length, size_t ndim, F *out) {
+    for (size_t t = 0; t<length; ++t) { for (size_t d = 0; d<ndim; ++d) { out[d*length + t] = data[t*ndim + d]; }}
+  }
+
+  /// Copy the planar series 'data' of 'length' timestamps in 'out', interleaved
+  template<typename F>
+  inline void to_interleaved(F const *data, size_t length, size_t ndim, F *out) {
+    for (size_t t = 0; t<length; ++t) { for (size_t d = 0; d<ndim; ++d) { out[t*ndim + d] = data[d*length + t]; }}
+  }
+
+  /// Dependent ADTW of two series in 'layout'. The vectorised kernels need the interleaved layout.
+  template<typename F>
+  F adtw(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    size_t ndim, Layout layout,
+    F cfe,
+    F penalty,
+    F cutoff
+  );
+
+  /// Dependent DTW of two series in 'layout'. The vectorised kernels need the interleaved layout.
+  template<typename F>
+  F dtw(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    size_t ndim, Layout layout,
+    F cfe,
+    size_t window,
+    F cutoff
+  );
+
+  /// Dependent LCSS of two series in 'layout'. The vectorised kernels need the interleaved layout.
+  template<typename F>
+  F lcss(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    size_t ndim, Layout layout,
+    F epsilon,
+    size_t window,
+    F cutoff
+  );
+
+  /** Independent DTW: sum over the dimensions of the univariate DTW between the dimensions of the two series, with
+   *  cost function cfe and warping window. The cutoff applies to the sum: each dimension gets what is left of it.
+   *  Planar series are computed in place; the dimensions of the interleaved ones are first copied in buffers.
+   */
+  template<typename F>
+  F dtw_independent(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    size_t ndim, Layout layout,
+    F cfe,
+    size_t window,
+    F cutoff
+  );
+
+} // End of namespace tempo::distance::multivariate
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "multivariate.hpp"
+#include "univariate.hpp"
+
+// --- --- --- Elastic distances --- --- ---
+#include "core/elastic/adtw.hpp"
+#include "core/elastic/dtw.hpp"
+#include "core/elastic/lcss.hpp"
+#include "core/elastic/multivariate.simd.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace tempo::distance::multivariate {
+
+  namespace {
+    // Hide shorthand in local anonymous namespace to avoid polluting the file including this one
+    namespace tdc = tempo::distance::core;
+
+    /// Per-thread reusable buffer for the elastic distances (see univariate.private.hpp)
+    template<typename T>
+    inline std::vector<T>& thread_buffer() {
+      thread_local std::vector<T> buffer;
+      return buffer;
+    }
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Elastic distances
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<typename F>
+  F adtw(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    size_t ndim,
+    F cfe,
+    F penalty,
+    F cutoff
+  ) {
+    if (ndim==1) { return univariate::adtw<F>(dat1, len1, dat2, len2, cfe, penalty, cutoff); }
+    #if defined(TEMPO_SIMD_X86)
+    // SIMD kernels: only for double, with the cfe 0.5, 1 or 2, on a CPU with AVX2 or AVX-512
+    if constexpr (std::is_same_v<F, double>) {
+      if (tdc::simd::CFE e; tdc::simd::has_multivariate_kernels()&&tdc::simd::to_cfe(cfe, e)) {
+        return tdc::simd::madtw(dat1, len1, dat2, len2, ndim, e, penalty, cutoff, thread_buffer<double>());
+      }
+    }
+    #endif
+    return univariate::with_cfe(cfe, [&](auto c) {
+      const auto cfun = idx_adc<decltype(c)::value, F>(cfe, ndim)(dat1, dat2);
+      return tdc::adtw<F>(len1, len2, cfun, penalty, cutoff, thread_buffer<F>());
+    });
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<typename F>
+  F dtw(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    size_t ndim,
+    F cfe,
+    size_t w,
+    F cutoff
+  ) {
+    if (ndim==1) { return univariate::dtw<F>(dat1, len1, dat2, len2, cfe, w, cutoff); }
+    #if defined(TEMPO_SIMD_X86)
+    // SIMD kernels: only for double, with the cfe 0.5, 1 or 2, on a CPU with AVX2 or AVX-512
+    if constexpr (std::is_same_v<F, double>) {
+      if (tdc::simd::CFE e; tdc::simd::has_multivariate_kernels()&&tdc::simd::to_cfe(cfe, e)) {
+        return tdc::simd::mdtw(dat1, len1, dat2, len2, ndim, e, w, cutoff, thread_buffer<double>());
+      }
+    }
+    #endif
+    return univariate::with_cfe(cfe, [&](auto c) {
+      const auto cfun = idx_adc<decltype(c)::value, F>(cfe, ndim)(dat1, dat2);
+      return tdc::dtw<F>(len1, len2, cfun, w, cutoff, thread_buffer<F>());
+    });
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<typename F>
+  F lcss(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    size_t ndim,
+    F epsilon,
+    size_t w,
+    F cutoff
+  ) {
+    if (ndim==1) { return univariate::lcss<F>(dat1, len1, dat2, len2, epsilon, w, cutoff); }
+    #if defined(TEMPO_SIMD_X86)
+    if constexpr (std::is_same_v<F, double>) {
+      if (tdc::simd::has_multivariate_kernels()) {
+        return tdc::simd::mlcss(dat1, len1, dat2, len2, ndim, epsilon, w, cutoff, thread_buffer<size_t>());
+      }
+    }
+    #endif
+    return tdc::lcss<F>(len1, len2, idx_simdiff<F>(epsilon, ndim)(dat1, dat2), w, cutoff, thread_buffer<size_t>());
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Lockstep distances
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  template<typename F>
+  F directa(F const *dat1, size_t len1, F const *dat2, size_t len2, size_t ndim, F cfe, F cutoff) {
+    // Timestamps are aligned one to one: the sum over the timestamps of the sum over the dimensions is the sum over
+    // all the values of the column major series.
+    return univariate::directa<F>(dat1, len1*ndim, dat2, len2*ndim, cfe, cutoff);
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Layouts
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  template<typename F>
+  F adtw(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    size_t ndim, Layout layout,
+    F cfe,
+    F penalty,
+    F cutoff
+  ) {
+    if (layout==Layout::INTERLEAVED||ndim==1) { return adtw<F>(dat1, len1, dat2, len2, ndim, cfe, penalty, cutoff); }
+    return univariate::with_cfe(cfe, [&](auto c) {
+      const auto cfun = idx_adc_planar<decltype(c)::value, F>(cfe, ndim, len1, len2)(dat1, dat2);
+      return tdc::adtw<F>(len1, len2, cfun, penalty, cutoff, thread_buffer<F>());
+    });
+  }
+
+  template<typename F>
+  F dtw(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    size_t ndim, Layout layout,
+    F cfe,
+    size_t w,
+    F cutoff
+  ) {
+    if (layout==Layout::INTERLEAVED||ndim==1) { return dtw<F>(dat1, len1, dat2, len2, ndim, cfe, w, cutoff); }
+    return univariate::with_cfe(cfe, [&](auto c) {
+      const auto cfun = idx_adc_planar<decltype(c)::value, F>(cfe, ndim, len1, len2)(dat1, dat2);
+      return tdc::dtw<F>(len1, len2, cfun, w, cutoff, thread_buffer<F>());
+    });
+  }
+
+  template<typename F>
+  F lcss(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    size_t ndim, Layout layout,
+    F epsilon,
+    size_t w,
+    F cutoff
+  ) {
+    if (layout==Layout::INTERLEAVED||ndim==1) { return lcss<F>(dat1, len1, dat2, len2, ndim, epsilon, w, cutoff); }
+    const auto sim = idx_simdiff_planar<F>(epsilon, ndim, len1, len2)(dat1, dat2);
+    return tdc::lcss<F>(len1, len2, sim, w, cutoff, thread_buffer<size_t>());
+  }
+
+  template<typename F>
+  F dtw_independent(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    size_t ndim, Layout layout,
+    F cfe,
+    size_t w,
+    F cutoff
+  ) {
+    // Dimensions of the interleaved series, copied one at a time (the DTW buffer is the one of univariate::dtw)
+    thread_local std::vector<F> dim1;
+    thread_local std::vector<F> dim2;
+    const bool planar = layout==Layout::PLANAR||ndim==1;
+    if (!planar) {
+      dim1.resize(len1);
+      dim2.resize(len2);
+    }
+    const bool no_cutoff = std::isnan(cutoff);
+    F total = 0;
+    for (size_t d = 0; d<ndim; ++d) {
+      F const *s1 = dat1 + d*len1;
+      F const *s2 = dat2 + d*len2;
+      if (!planar) {
+        for (size_t t = 0; t<len1; ++t) { dim1[t] = dat1[t*ndim + d]; }
+        for (size_t t = 0; t<len2; ++t) { dim2[t] = dat2[t*ndim + d]; }
+        s1 = dim1.data();
+        s2 = dim2.data();
+      }
+      // What is left of the cutoff for this dimension; an infinite cutoff stays one (see univariate::dtw)
+      const F left = no_cutoff||std::isinf(cutoff) ? cutoff : cutoff - total;
+      if (left<0) { return utils::PINF<F>; }
+      const F v = univariate::dtw<F>(s1, len1, s2, len2, cfe, w, left);
+      if (std::isinf(v)) { return utils::PINF<F>; }
+      total += v;
+    }
+    return total;
+  }
+
+} // End of namespace tempo::distance::multivariate
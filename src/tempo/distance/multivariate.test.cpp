@@ -0,0 +1,241 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "multivariate.hpp"
+#include "univariate.hpp"
+#include "core/elastic/adtw.hpp"
+#include "core/elastic/dtw.hpp"
+#include "core/elastic/lcss.hpp"
+#include "core/elastic/multivariate.simd.hpp"
+
+#include <mock/mockseries.hpp>
+#include <vector>
+
+using namespace tempo::distance;
+
+using F = double;
+
+constexpr size_t nbitems = 100;
+constexpr F PINF = utils::PINF<F>;
+constexpr F QNAN = utils::QNAN<F>;
+
+namespace {
+
+  /// Length in number of timestamps of a column major series of 'ndim' dimensions
+  size_t length(std::vector<F> const& s, size_t ndim) { return s.size()/ndim; }
+
+  /// Scalar reference: generic core kernels with the dependent cost function
+  F ref_dtw(std::vector<F> const& s1, std::vector<F> const& s2, size_t ndim, size_t w, F cutoff) {
+    std::vector<F> buffer;
+    const auto cfun = multivariate::idx_adc<univariate::CFE::AD2, F>(2, ndim)(s1.data(), s2.data());
+    return core::dtw<F>(length(s1, ndim), length(s2, ndim), cfun, w, cutoff, buffer);
+  }
+
+  F ref_adtw(std::vector<F> const& s1, std::vector<F> const& s2, size_t ndim, F penalty, F cutoff) {
+    std::vector<F> buffer;
+    const auto cfun = multivariate::idx_adc<univariate::CFE::AD1, F>(1, ndim)(s1.data(), s2.data());
+    return core::adtw<F>(length(s1, ndim), length(s2, ndim), cfun, penalty, cutoff, buffer);
+  }
+
+  F ref_lcss(std::vector<F> const& s1, std::vector<F> const& s2, size_t ndim, F epsilon, size_t w, F cutoff) {
+    std::vector<size_t> buffer;
+    const auto sim = multivariate::idx_simdiff<F>(epsilon, ndim)(s1.data(), s2.data());
+    return core::lcss<F>(length(s1, ndim), length(s2, ndim), sim, w, cutoff, buffer);
+  }
+
+  void require_same(F v, F ref) {
+    if (ref==PINF) { REQUIRE(v==PINF); } else { REQUIRE(v==Catch::Approx(ref)); }
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// The multivariate distances (vectorised over the dimensions when possible) must give the same results as the
+// generic kernels with the dependent cost function.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Multivariate one dimension is univariate", "[multivariate]") {
+  mock::Mocker mocker(0);
+  const auto fset = mocker.vec_rs_randvec(nbitems);
+  for (size_t i = 0; i + 1<nbitems; ++i) {
+    const auto& s1 = fset[i];
+    const auto& s2 = fset[i + 1];
+    REQUIRE(multivariate::dtw<F>(s1.data(), s1.size(), s2.data(), s2.size(), 1, 2, 3, PINF)
+            ==univariate::dtw<F>(s1.data(), s1.size(), s2.data(), s2.size(), 2, 3, PINF));
+    REQUIRE(multivariate::lcss<F>(s1.data(), s1.size(), s2.data(), s2.size(), 1, 0.2, 3, PINF)
+            ==univariate::lcss<F>(s1.data(), s1.size(), s2.data(), s2.size(), 0.2, 3, PINF));
+  }
+}
+
+TEST_CASE("Multivariate elastic distances", "[multivariate][dtw][adtw][lcss]") {
+  for (const size_t ndim : {2, 3, 4, 5, 8, 9, 12}) {
+    mock::Mocker mocker(ndim);
+    mocker._dim = ndim;
+    const auto fset = mocker.vec_rs_randvec(nbitems);
+
+    SECTION("DTW, ndim " + std::to_string(ndim)) {
+      for (const size_t w : {size_t(0), size_t(3), utils::NO_WINDOW}) {
+        for (size_t i = 0; i + 2<nbitems; ++i) {
+          const auto& s1 = fset[i];
+          const auto& s2 = fset[i + 1];
+          const auto& s3 = fset[i + 2];
+          const size_t l1 = length(s1, ndim);
+          const F ref = ref_dtw(s1, s2, ndim, w, QNAN);
+          require_same(multivariate::dtw<F>(s1.data(), l1, s2.data(), length(s2, ndim), ndim, 2, w, QNAN), ref);
+          // With cutoff
+          const F refc = ref_dtw(s1, s3, ndim, w, ref);
+          require_same(multivariate::dtw<F>(s1.data(), l1, s3.data(), length(s3, ndim), ndim, 2, w, ref), refc);
+        }
+      }
+    }
+
+    SECTION("ADTW, ndim " + std::to_string(ndim)) {
+      for (const F penalty : {0.0, 0.1, 1.0, 10.0}) {
+        for (size_t i = 0; i + 2<nbitems; ++i) {
+          const auto& s1 = fset[i];
+          const auto& s2 = fset[i + 1];
+          const auto& s3 = fset[i + 2];
+          const size_t l1 = length(s1, ndim);
+          const F ref = ref_adtw(s1, s2, ndim, penalty, QNAN);
+          require_same(multivariate::adtw<F>(s1.data(), l1, s2.data(), length(s2, ndim), ndim, 1, penalty, QNAN),
+                       ref);
+          const F refc = ref_adtw(s1, s3, ndim, penalty, ref);
+          require_same(multivariate::adtw<F>(s1.data(), l1, s3.data(), length(s3, ndim), ndim, 1, penalty, ref),
+                       refc);
+        }
+      }
+    }
+
+    SECTION("LCSS, ndim " + std::to_string(ndim)) {
+      for (const F epsilon : {0.1, 0.5, 1.0, 2.0}) {
+        for (size_t i = 0; i + 2<nbitems; ++i) {
+          const auto& s1 = fset[i];
+          const auto& s2 = fset[i + 1];
+          const auto& s3 = fset[i + 2];
+          const size_t l1 = length(s1, ndim);
+          const F ref = ref_lcss(s1, s2, ndim, epsilon, 3, QNAN);
+          require_same(multivariate::lcss<F>(s1.data(), l1, s2.data(), length(s2, ndim), ndim, epsilon, 3, QNAN),
+                       ref);
+          const F refc = ref_lcss(s1, s3, ndim, epsilon, 3, ref);
+          require_same(multivariate::lcss<F>(s1.data(), l1, s3.data(), length(s3, ndim), ndim, epsilon, 3, ref),
+                       refc);
+        }
+      }
+    }
+
+    #if defined(TEMPO_SIMD_X86)
+    SECTION("SIMD kernels, ndim " + std::to_string(ndim)) {
+      namespace simd = core::simd;
+      std::vector<simd::ISA> isas;
+      const auto detected = simd::detected_isa();
+      if (detected==simd::ISA::AVX2||detected==simd::ISA::AVX512) { isas.push_back(simd::ISA::AVX2); }
+      if (detected==simd::ISA::AVX512) { isas.push_back(simd::ISA::AVX512); }
+      std::vector<F> buffer;
+      for (const auto isa : isas) {
+        for (size_t i = 0; i + 1<nbitems; ++i) {
+          const auto& s1 = fset[i];
+          const auto& s2 = fset[i + 1];
+          const size_t l1 = length(s1, ndim);
+          const size_t l2 = length(s2, ndim);
+          require_same(simd::mdtw(s1.data(), l1, s2.data(), l2, ndim, simd::CFE::AD2, 5, QNAN, buffer, isa),
+                       ref_dtw(s1, s2, ndim, 5, QNAN));
+          require_same(simd::madtw(s1.data(), l1, s2.data(), l2, ndim, simd::CFE::AD1, 0.5, QNAN, buffer, isa),
+                       ref_adtw(s1, s2, ndim, 0.5, QNAN));
+        }
+      }
+    }
+    #endif
+  }
+}
+
+TEST_CASE("Multivariate direct alignment", "[multivariate][directa]") {
+  mock::Mocker mocker(0);
+  mocker._dim = 3;
+  mocker._minl = mocker._fixl;
+  mocker._maxl = mocker._fixl;
+  const auto fset = mocker.vec_randvec(nbitems);
+  for (size_t i = 0; i + 1<nbitems; ++i) {
+    const auto& s1 = fset[i];
+    const auto& s2 = fset[i + 1];
+    F ref = 0;
+    for (size_t k = 0; k<s1.size(); ++k) { ref += (s1[k] - s2[k])*(s1[k] - s2[k]); }
+    REQUIRE(multivariate::directa<F>(s1.data(), mocker._fixl, s2.data(), mocker._fixl, 3, 2, PINF)
+            ==Catch::Approx(ref));
+  }
+}
+
+TEST_CASE("Multivariate layouts", "[multivariate][dtw][adtw][lcss]") {
+  for (const size_t ndim : {2, 3, 5}) {
+    mock::Mocker mocker(ndim);
+    mocker._dim = ndim;
+    const auto fset = mocker.vec_rs_randvec(nbitems);
+    // Planar copies of the series
+    std::vector<std::vector<F>> planar;
+    for (const auto& s : fset) {
+      std::vector<F> p(s.size());
+      multivariate::to_planar(s.data(), length(s, ndim), ndim, p.data());
+      planar.push_back(std::move(p));
+    }
+    const auto P = multivariate::Layout::PLANAR;
+    const auto I = multivariate::Layout::INTERLEAVED;
+
+    SECTION("Round trip, ndim " + std::to_string(ndim)) {
+      for (size_t i = 0; i<nbitems; ++i) {
+        std::vector<F> back(fset[i].size());
+        multivariate::to_interleaved(planar[i].data(), length(fset[i], ndim), ndim, back.data());
+        REQUIRE(back==fset[i]);
+      }
+    }
+
+    SECTION("Dependent distances on planar series, ndim " + std::to_string(ndim)) {
+      for (size_t i = 0; i + 1<nbitems; ++i) {
+        const auto& s1 = fset[i];
+        const auto& s2 = fset[i + 1];
+        const size_t l1 = length(s1, ndim);
+        const size_t l2 = length(s2, ndim);
+        const F* p1 = planar[i].data();
+        const F* p2 = planar[i + 1].data();
+        require_same(multivariate::dtw<F>(p1, l1, p2, l2, ndim, P, 2, 3, QNAN), ref_dtw(s1, s2, ndim, 3, QNAN));
+        require_same(multivariate::adtw<F>(p1, l1, p2, l2, ndim, P, 1, 0.1, QNAN),
+                     ref_adtw(s1, s2, ndim, 0.1, QNAN));
+        require_same(multivariate::lcss<F>(p1, l1, p2, l2, ndim, P, 0.5, 3, QNAN),
+                     ref_lcss(s1, s2, ndim, 0.5, 3, QNAN));
+        require_same(multivariate::dtw<F>(s1.data(), l1, s2.data(), l2, ndim, I, 2, 3, QNAN),
+                     ref_dtw(s1, s2, ndim, 3, QNAN));
+      }
+    }
+
+    SECTION("Independent DTW, ndim " + std::to_string(ndim)) {
+      for (const size_t w : {size_t(0), size_t(3), utils::NO_WINDOW}) {
+        for (size_t i = 0; i + 1<nbitems; ++i) {
+          const auto& s1 = fset[i];
+          const auto& s2 = fset[i + 1];
+          const size_t l1 = length(s1, ndim);
+          const size_t l2 = length(s2, ndim);
+          // Reference: sum of the univariate DTW of the dimensions
+          F ref = 0;
+          for (size_t d = 0; d<ndim; ++d) {
+            std::vector<F> buffer;
+            F const *d1 = planar[i].data() + d*l1;
+            F const *d2 = planar[i + 1].data() + d*l2;
+            const auto cfun = univariate::idx_ad2<F, F const *>(d1, d2);
+            ref += core::dtw<F>(l1, l2, cfun, w, QNAN, buffer);
+          }
+          if (std::isinf(ref)) { ref = PINF; }
+          const F vp = multivariate::dtw_independent<F>(planar[i].data(), l1, planar[i + 1].data(), l2, ndim, P, 2,
+                                                        w, QNAN);
+          const F vi = multivariate::dtw_independent<F>(s1.data(), l1, s2.data(), l2, ndim, I, 2, w, QNAN);
+          require_same(vp, ref);
+          REQUIRE(vi==vp);
+          // Early abandoned below the result, same result above it
+          if (!std::isinf(ref)&&ref>0) {
+            REQUIRE(multivariate::dtw_independent<F>(s1.data(), l1, s2.data(), l2, ndim, I, 2, w, ref*0.5)==PINF);
+            require_same(multivariate::dtw_independent<F>(s1.data(), l1, s2.data(), l2, ndim, I, 2, w, ref*1.01),
+                         ref);
+          }
+        }
+      }
+    }
+  }
+}
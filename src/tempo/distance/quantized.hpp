@@ -0,0 +1,146 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace tempo::distance::quantized {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Quantized series
+  // A series is stored as 16 bits codes with a per series scale and offset: the value i is offset + scale*code(i).
+  //  - INT16: the code is a signed integer. The offset is the middle of the range of the series, and the scale
+  //    spreads the range over [-32767, 32767]: the error is at most scale/2, uniform over the range.
+  //  - FLOAT16: the code is an IEEE half precision float, with a zero offset and the largest absolute value as the
+  //    scale: the relative error is at most 2^-11, better for series with values of very different magnitudes.
+  // Only finite values can be quantized.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  enum class QFormat : uint8_t {
+    INT16 = 1,
+    FLOAT16 = 2
+  };
+
+  /// Call fun(std::integral_constant<QFormat, q>{}) for the format q (see univariate::with_cfe)
+  template<typename Fun>
+  inline decltype(auto) with_format(QFormat q, Fun&& fun) {
+    switch (q) {
+      case QFormat::INT16: return fun(std::integral_constant<QFormat, QFormat::INT16>{});
+      case QFormat::FLOAT16: return fun(std::integral_constant<QFormat, QFormat::FLOAT16>{});
+      default: throw std::invalid_argument("Unknown quantization format");
+    }
+  }
+
+  /// IEEE half precision bits of a float, rounded to the nearest (ties to even). Too large values become infinite.
+  inline uint16_t float_to_half(float f) {
+    const auto x = std::bit_cast<uint32_t>(f);
+    const auto sign = (uint16_t)((x >> 16) & 0x8000u);
+    const uint32_t e = (x >> 23) & 0xFFu;
+    uint32_t mant = x & 0x7FFFFFu;
+    if (e==0xFF) { return sign | 0x7C00u | (mant!=0 ? 0x200u : 0u); }
+    const int exp = (int)e - 127 + 15;
+    if (exp>=31) { return sign | 0x7C00u; }
+    if (exp<=0) {
+      // Subnormal half (or zero)
+      if (exp<-10) { return sign; }
+      mant |= 0x800000u;
+      const auto shift = (uint32_t)(14 - exp);
+      uint32_t h = mant >> shift;
+      const uint32_t rem = mant & ((1u << shift) - 1);
+      const uint32_t half = 1u << (shift - 1);
+      if (rem>half||(rem==half&&(h & 1u))) { ++h; }
+      return sign | (uint16_t)h;
+    }
+    // Normal half: a carry of the mantissa rounding correctly increments the exponent (up to infinity)
+    uint32_t h = ((uint32_t)exp << 10) | (mant >> 13);
+    const uint32_t rem = mant & 0x1FFFu;
+    if (rem>0x1000u||(rem==0x1000u&&(h & 1u))) { ++h; }
+    return sign | (uint16_t)h;
+  }
+
+  /// Float value of IEEE half precision bits (exact)
+  inline float half_to_float(uint16_t h) {
+    const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    const uint32_t e = (h >> 10) & 0x1Fu;
+    const uint32_t mant = h & 0x3FFu;
+    if (e==0) {
+      const float f = std::ldexp((float)mant, -24);
+      return sign!=0 ? -f : f;
+    }
+    if (e==31) { return std::bit_cast<float>(sign | 0x7F800000u | (mant << 13)); }
+    return std::bit_cast<float>(sign | ((e + 112) << 23) | (mant << 13));
+  }
+
+  /// Code of a value already divided by the scale (see QFormat)
+  template<QFormat q>
+  inline uint16_t encode(double normalized) {
+    if constexpr (q==QFormat::INT16) {
+      const double r = std::clamp(std::round(normalized), -32767.0, 32767.0);
+      return (uint16_t)(int16_t)r;
+    } else { return float_to_half((float)normalized); }
+  }
+
+  /// Normalized value of a code (see QFormat)
+  template<QFormat q, typename F>
+  inline F decode(uint16_t code) {
+    if constexpr (q==QFormat::INT16) { return (F)(int16_t)code; }
+    else { return (F)half_to_float(code); }
+  }
+
+  /// Quantized series: 'length' codes with their scale and offset. Does not own the codes.
+  template<typename F>
+  struct QView {
+    QFormat format;
+    uint16_t const *codes;
+    size_t length;
+    F scale;
+    F offset;
+  };
+
+  /// Random access to the values of a quantized series of format q: decode the codes as they are read
+  template<QFormat q, typename F>
+  struct QValues {
+    uint16_t const *codes;
+    F scale;
+    F offset;
+
+    explicit QValues(QView<F> const& v) : codes(v.codes), scale(v.scale), offset(v.offset) {}
+
+    F operator[](size_t i) const { return offset + scale*decode<q, F>(codes[i]); }
+  };
+
+  /// Quantize the 'length' finite values of 'series' in 'codes' (of size 'length'), returning the view on the codes
+  template<typename F>
+  QView<F> quantize(F const *series, size_t length, QFormat format, uint16_t *codes) {
+    QView<F> v{format, codes, length, 1, 0};
+    if (length==0) { return v; }
+    const auto [pmin, pmax] = std::minmax_element(series, series + length);
+    with_format(format, [&](auto qc) {
+      constexpr QFormat q = decltype(qc)::value;
+      if constexpr (q==QFormat::INT16) {
+        v.offset = *pmin + (*pmax - *pmin)/2;
+        v.scale = (*pmax - *pmin)/32767/2;
+      } else { v.scale = std::max(std::abs(*pmin), std::abs(*pmax)); }
+      // Constant (INT16) or null (FLOAT16) series: every code is 0
+      if (v.scale==0||!std::isfinite(v.scale)) { v.scale = 1; }
+      for (size_t i = 0; i<length; ++i) { codes[i] = encode<q>(((double)series[i] - v.offset)/v.scale); }
+    });
+    return v;
+  }
+
+  /// Decode a quantized series in 'out' (of size v.length)
+  template<typename F>
+  void dequantize(QView<F> const& v, F *out) {
+    with_format(v.format, [&](auto qc) {
+      const QValues<decltype(qc)::value, F> values(v);
+      for (size_t i = 0; i<v.length; ++i) { out[i] = values[i]; }
+    });
+  }
+
+} // End of namespace tempo::distance::quantized
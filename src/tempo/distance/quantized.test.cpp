@@ -0,0 +1,122 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "quantized.hpp"
+#include "univariate.hpp"
+
+#include <mock/mockseries.hpp>
+#include <vector>
+
+using namespace tempo::distance;
+using quantized::QFormat;
+
+constexpr size_t nbitems = 200;
+constexpr double PINF = utils::PINF<double>;
+
+namespace {
+
+  /// Quantized copy of a series: the codes and the view on them
+  struct Quantized {
+    std::vector<uint16_t> codes;
+    quantized::QView<double> view;
+
+    Quantized(std::vector<double> const& s, QFormat format) : codes(s.size()) {
+      view = quantized::quantize(s.data(), s.size(), format, codes.data());
+    }
+
+    [[nodiscard]] std::vector<double> dequantized() const {
+      std::vector<double> result(view.length);
+      quantized::dequantize(view, result.data());
+      return result;
+    }
+  };
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Half precision conversion", "[quantized]") {
+  SECTION("Known values") {
+    REQUIRE(quantized::float_to_half(0.0f)==0x0000);
+    REQUIRE(quantized::float_to_half(-0.0f)==0x8000);
+    REQUIRE(quantized::float_to_half(1.0f)==0x3C00);
+    REQUIRE(quantized::float_to_half(-2.0f)==0xC000);
+    REQUIRE(quantized::float_to_half(65504.0f)==0x7BFF);
+    REQUIRE(quantized::float_to_half(65520.0f)==0x7C00); // Rounded up to infinity
+    REQUIRE(quantized::float_to_half(std::ldexp(1.0f, -24))==0x0001); // Smallest subnormal
+    REQUIRE(quantized::float_to_half(std::ldexp(1.0f, -26))==0x0000); // Rounded down to zero
+    REQUIRE(quantized::half_to_float(0x3555)==Catch::Approx(1.0/3).epsilon(1e-3));
+  }
+
+  SECTION("Round trip of all the finite halves") {
+    for (uint32_t h = 0; h<=0xFFFF; ++h) {
+      if ((h & 0x7C00u)==0x7C00u) { continue; } // Infinities and NaN
+      REQUIRE(quantized::float_to_half(quantized::half_to_float((uint16_t)h))==h);
+    }
+  }
+
+  SECTION("Rounding to nearest") {
+    mock::Mocker mocker(0);
+    for (float f : mocker.randvec(1000, -1000.0, 1000.0)) {
+      const float r = quantized::half_to_float(quantized::float_to_half(f));
+      REQUIRE(std::abs(r - f)<=std::abs(f)*std::ldexp(1.0f, -11));
+    }
+  }
+}
+
+TEST_CASE("Quantization", "[quantized]") {
+  mock::Mocker mocker(0);
+  const auto dset = mocker.vec_rs_randvec(nbitems);
+
+  SECTION("INT16 error bounded by half the scale") {
+    for (const auto& s : dset) {
+      const Quantized q(s, QFormat::INT16);
+      const auto d = q.dequantized();
+      for (size_t i = 0; i<s.size(); ++i) { REQUIRE(std::abs(d[i] - s[i])<=q.view.scale*0.5000001); }
+    }
+  }
+
+  SECTION("FLOAT16 relative error") {
+    for (const auto& s : dset) {
+      const Quantized q(s, QFormat::FLOAT16);
+      const auto d = q.dequantized();
+      for (size_t i = 0; i<s.size(); ++i) { REQUIRE(std::abs(d[i] - s[i])<=std::abs(s[i])*1e-3 + 1e-12); }
+    }
+  }
+
+  SECTION("Constant series") {
+    for (const QFormat format : {QFormat::INT16, QFormat::FLOAT16}) {
+      for (const double v : {0.0, 3.5}) {
+        const Quantized q(std::vector<double>(10, v), format);
+        for (double d : q.dequantized()) { REQUIRE(d==Catch::Approx(v)); }
+      }
+    }
+  }
+}
+
+TEST_CASE("Quantized DTW and ADTW", "[quantized][univariate]") {
+  mock::Mocker mocker(0);
+  const auto dset = mocker.vec_rs_randvec(nbitems);
+  const size_t w = 5;
+
+  // Same result as the distance on the dequantized series, with or without a cutoff
+  for (const QFormat format : {QFormat::INT16, QFormat::FLOAT16}) {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const Quantized q1(dset[i], format);
+      const auto d1 = q1.dequantized();
+      const auto& d2 = dset[i + 1];
+      const size_t ww = std::max<size_t>(w, std::max(d1.size(), d2.size()) - std::min(d1.size(), d2.size()));
+      for (const double e : {0.5, 1.0, 2.0}) {
+        const double dtw_ref = univariate::dtw<double>(d1.data(), d1.size(), d2.data(), d2.size(), e, ww, PINF);
+        const double adtw_ref = univariate::adtw<double>(d1.data(), d1.size(), d2.data(), d2.size(), e, 0.5, PINF);
+        REQUIRE(univariate::dtw<double>(q1.view, d2.data(), d2.size(), e, ww, PINF)==Catch::Approx(dtw_ref));
+        REQUIRE(univariate::adtw<double>(q1.view, d2.data(), d2.size(), e, 0.5, PINF)==Catch::Approx(adtw_ref));
+        // Cutoff below the distance: early abandoned
+        REQUIRE(univariate::dtw<double>(q1.view, d2.data(), d2.size(), e, ww, dtw_ref*0.9)==PINF);
+        REQUIRE(univariate::adtw<double>(q1.view, d2.data(), d2.size(), e, 0.5, adtw_ref*0.9)==PINF);
+      }
+    }
+  }
+}
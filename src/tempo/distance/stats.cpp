@@ -0,0 +1,54 @@
+#include "stats.hpp"
+
+#include <mutex>
+
+namespace tempo::distance::stats {
+
+  namespace {
+
+    /// Counters of the exited threads (and merged by 'collect'), by distance name
+    std::mutex global_mtx;
+    std::map<std::string, Counters> global_counters;
+
+    void merge(std::map<std::string, Counters>& into, std::map<std::string, Counters> const& from) {
+      for (auto const& [name, c] : from) { into[name] += c; }
+    }
+
+  } // End of anonymous namespace
+
+  namespace internal {
+
+    ThreadCounters::~ThreadCounters() {
+      if (current.calls>0||current.cells>0||current.lb_tests>0) { by_name[UNSCOPED] += current; }
+      std::lock_guard lock(global_mtx);
+      merge(global_counters, by_name);
+    }
+
+    void attribute(std::string const& name) {
+      ThreadCounters& tc = thread_counters;
+      if (tc.current.calls>0||tc.current.cells>0||tc.current.lb_tests>0) {
+        tc.by_name[name] += tc.current;
+        tc.current = Counters{};
+      }
+    }
+
+  } // End of namespace internal
+
+  std::map<std::string, Counters> collect() {
+    internal::attribute(UNSCOPED);
+    internal::ThreadCounters& tc = internal::thread_counters;
+    std::lock_guard lock(global_mtx);
+    merge(global_counters, tc.by_name);
+    tc.by_name.clear();
+    return global_counters;
+  }
+
+  void reset() {
+    internal::ThreadCounters& tc = internal::thread_counters;
+    tc.current = Counters{};
+    tc.by_name.clear();
+    std::lock_guard lock(global_mtx);
+    global_counters.clear();
+  }
+
+} // End of namespace tempo::distance::stats
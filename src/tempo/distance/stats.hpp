@@ -0,0 +1,154 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace tempo::distance::stats {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Distance instrumentation, compiled only with TEMPO_DISTANCE_STATS (CMake option of the same name).
+  // Without it, everything here is a no-op, and 'collect' returns an empty map.
+  //
+  // Counts are recorded in per-thread counters, without synchronisation:
+  //  - the univariate distances (see univariate.hpp) record their calls, the cells they compute, the size of
+  //    their cost matrix (length1*length2), and the calls early abandoned (+INF with a finite cutoff);
+  //  - the lower bounds record their tests, and the tests pruning a computation;
+  //  - a 'Scope' attributes the counts of its thread, while alive, to a distance name.
+  // The counts of a thread are merged in a global table when the thread exits, or by 'collect' for its caller.
+  // Counts made outside of any scope are attributed to UNSCOPED (e.g. the threads of a parallel soft-DTW).
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+#ifdef TEMPO_DISTANCE_STATS
+  constexpr bool enabled = true;
+#else
+  constexpr bool enabled = false;
+#endif
+
+  /// Name of the counts made outside of any scope
+  inline const std::string UNSCOPED = "unscoped";
+
+  /// Counters of a distance
+  struct Counters {
+    uint64_t calls{0};      ///< Distance computations
+    uint64_t cells{0};      ///< Cells of the cost matrices actually computed
+    uint64_t matrix{0};     ///< Cells of the full cost matrices (length1*length2 per call)
+    uint64_t abandoned{0};  ///< Computations early abandoned
+    uint64_t lb_tests{0};   ///< Lower bounds checked against a cutoff
+    uint64_t lb_prunes{0};  ///< Lower bounds above their cutoff, avoiding a computation
+
+    Counters& operator+=(Counters const& other) {
+      calls += other.calls;
+      cells += other.cells;
+      matrix += other.matrix;
+      abandoned += other.abandoned;
+      lb_tests += other.lb_tests;
+      lb_prunes += other.lb_prunes;
+      return *this;
+    }
+
+    /// Ratio of the computed cells over the cells of the full cost matrices (0 without calls)
+    double cells_ratio() const { return matrix==0 ? 0.0 : (double)cells/(double)matrix; }
+
+    /// Ratio of the computations early abandoned (0 without calls)
+    double abandon_rate() const { return calls==0 ? 0.0 : (double)abandoned/(double)calls; }
+
+    /// Ratio of the lower bounds tests pruning a computation (0 without tests)
+    double lb_prune_rate() const { return lb_tests==0 ? 0.0 : (double)lb_prunes/(double)lb_tests; }
+  };
+
+  namespace internal {
+
+    /// Counters of a thread: the 'current' ones, not yet attributed, and the ones attributed to distance names.
+    /// Merged in the global table when the thread exits.
+    struct ThreadCounters {
+      Counters current;
+      std::map<std::string, Counters> by_name;
+      ~ThreadCounters();
+    };
+
+    inline thread_local ThreadCounters thread_counters;
+
+    /// Counters of the current thread, not yet attributed to a distance name
+    inline Counters& current() { return thread_counters.current; }
+
+    /// Attribute the current counters of the thread to 'name', and reset them
+    void attribute(std::string const& name);
+
+  } // End of namespace internal
+
+  /// Record 'n' computed cells
+  inline void cells(uint64_t n) {
+    if constexpr (enabled) { internal::current().cells += n; }
+  }
+
+  /// Indexed cost function counting its calls as computed cells (the cost function itself when disabled)
+  template<typename CFun>
+  inline auto counted(CFun cfun) {
+    if constexpr (enabled) {
+      return [cfun](size_t i, size_t j) {
+        ++internal::current().cells;
+        return cfun(i, j);
+      };
+    } else { return cfun; }
+  }
+
+  /// Record a distance computation between series of lengths 'length1' and 'length2' with 'cutoff'.
+  /// Return 'result' (the cells must be recorded separately, see 'cells' and 'counted').
+  template<typename F>
+  inline F call(size_t length1, size_t length2, F cutoff, F result) {
+    if constexpr (enabled) {
+      Counters& c = internal::current();
+      ++c.calls;
+      c.matrix += (uint64_t)length1*(uint64_t)length2;
+      if (std::isinf(result)&&!std::isinf(cutoff)&&!std::isnan(cutoff)) { ++c.abandoned; }
+    }
+    return result;
+  }
+
+  /// Record a lower bound test, 'pruned' if the lower bound is above its cutoff. Return 'pruned'.
+  inline bool lb(bool pruned) {
+    if constexpr (enabled) {
+      Counters& c = internal::current();
+      ++c.lb_tests;
+      c.lb_prunes += pruned ? 1 : 0;
+    }
+    return pruned;
+  }
+
+  /// While alive, attribute the counts of the thread to a distance name.
+  /// The name is only computed (by calling 'get_name') when the instrumentation is enabled.
+  class Scope {
+    std::string name;
+
+  public:
+    template<typename Fun>
+    explicit Scope(Fun&& get_name) {
+      if constexpr (enabled) {
+        internal::attribute(UNSCOPED);
+        name = get_name();
+      }
+    }
+
+    ~Scope() { if constexpr (enabled) { internal::attribute(name); }}
+
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+  };
+
+  /// Family of a distance name, i.e. its prefix before the first ':' (e.g. "DTW" for "DTW:2.000000:12")
+  inline std::string family(std::string const& distance_name) {
+    return distance_name.substr(0, distance_name.find(':'));
+  }
+
+  /// Counters by distance name, of the exited threads and of the calling thread.
+  /// The other running threads must not be computing distances.
+  std::map<std::string, Counters> collect();
+
+  /// Reset all the counters. The other running threads must not be computing distances.
+  void reset();
+
+} // End of namespace tempo::distance::stats
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <tempo/dataset/tseries.hpp>
+#include "multivariate.hpp"
+
+// Specialised implementation for TSeries: the number of dimensions is taken from the series
+
+namespace tempo::distance::multivariate {
+
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Elastic Distances
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Dependent ADTW with cost function cfe, penalty, and EAP cutoff.
+  inline F adtw(TSeries const& series1, TSeries const& series2, F cfe, F penalty, F cutoff) {
+    return adtw(series1.data(), series1.length(), series2.data(), series2.length(), series1.nb_dimensions(),
+                cfe, penalty, cutoff);
+  }
+
+  /// Dependent DTW with cost function cfe, warping window length, and EAP cutoff.
+  /// Use window=NO_WINDOW to use unconstrained DTW.
+  inline F dtw(TSeries const& series1, TSeries const& series2, F cfe, size_t window, F cutoff) {
+    return dtw(series1.data(), series1.length(), series2.data(), series2.length(), series1.nb_dimensions(),
+               cfe, window, cutoff);
+  }
+
+  /// Dependent LCSS with epsilon, warping window, and EAP cutoff.
+  /// Use window=NO_WINDOW to use unconstrained LCSS.
+  inline F lcss(TSeries const& series1, TSeries const& series2, F epsilon, size_t window, F cutoff) {
+    return lcss(series1.data(), series1.length(), series2.data(), series2.length(), series1.nb_dimensions(),
+                epsilon, window, cutoff);
+  }
+
+
+  /// Independent DTW with cost function cfe, warping window length, and EAP cutoff.
+  /// The series being interleaved, their dimensions are copied in buffers (see multivariate::dtw_independent).
+  inline F dtw_independent(TSeries const& series1, TSeries const& series2, F cfe, size_t window, F cutoff) {
+    return dtw_independent(series1.data(), series1.length(), series2.data(), series2.length(),
+                           series1.nb_dimensions(), Layout::INTERLEAVED, cfe, window, cutoff);
+  }
+
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Lockstep Distances
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Direct alignment with cost function cfe, and early abandoning cutoff.
+  inline F directa(TSeries const& series1, TSeries const& series2, F cfe, F cutoff) {
+    return directa<F>(series1.data(), series1.length(), series2.data(), series2.length(), series1.nb_dimensions(),
+                      cfe, cutoff);
+  }
+
+} // End of namespace tempo::distance::multivariate
@@ -3,6 +3,8 @@
 #include <tempo/dataset/tseries.hpp>
 #include "univariate.hpp"
 
+#include <stdexcept>
+
 // Specialised implementation for TSeries
 
 namespace tempo::distance::univariate {
@@ -132,30 +134,40 @@ namespace tempo::distance::univariate {
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
 
+  /// The Armadillo metrics below view the series as rows: univariate only, as TSeries::rowvec
+  inline void check_univariate(TSeries const& series1, TSeries const& series2) {
+    if (!series1.is_univariate()||!series2.is_univariate()) {
+      throw std::logic_error("Lockstep and sliding metrics can only be used with univariate series");
+    }
+  }
+
   /// Direct alignment with cost function cfe, and early abandoning cutoff.
   inline F directa(TSeries const& series1, TSeries const& series2, F cfe, F cutoff) {
     return directa<F>(series1.data(), series1.length(), series2.data(), series2.length(), cfe, cutoff);
   }
 
-  /// Lorentzian metric, Armadillo vectorized, pointer interface
+  /// Lorentzian metric, Armadillo vectorized, over non owning views of the series (no copy)
   inline F lorentzian(TSeries const& series1, TSeries const& series2) {
-    return lorentzian(series1.rowvec(), series2.rowvec());
+    check_univariate(series1, series2);
+    return lorentzian<F>(series1.data(), series1.length(), series2.data(), series2.length());
   }
 
-  /// Minkowski metric, Armadillo vectorized, pointer interface
+  /// Minkowski metric, Armadillo vectorized, over non owning views of the series (no copy)
   ///  - Equal to the Manhattan distance with p=1
   ///  - Equal to the Euclidean Distance distance with p=2
   ///  - Also see the direct alignment function, which does the same without taking the root.
   ///    With exponent 0.5, 1, and 2, the direct alignment uses specialised cost function,
   ///    which may be faster, in particular for NN search.
   inline F minkowski(TSeries const& series1, TSeries const& series2, F p) {
-    return minkowski(series1.rowvec(), series2.rowvec(), p);
+    check_univariate(series1, series2);
+    return minkowski<F>(series1.data(), series1.length(), series2.data(), series2.length(), p);
   }
 
-  /// Manhattan metric, Armadillo vectorized, pointer interface
+  /// Manhattan metric, Armadillo vectorized, over non owning views of the series (no copy)
   /// Special case for Minkowski with p=1
   inline F manhattan(TSeries const& series1, TSeries const& series2) {
-    return manhattan(series1.rowvec(), series2.rowvec());
+    check_univariate(series1, series2);
+    return manhattan<F>(series1.data(), series1.length(), series2.data(), series2.length());
   }
 
 
@@ -164,9 +176,10 @@ namespace tempo::distance::univariate {
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
 
-  /// SBD, Armadillo vectorized, pointer interface
+  /// SBD, Armadillo vectorized, over non owning views of the series (no copy)
   inline F sbd(TSeries const& series1, TSeries const& series2) {
-    return sbd(series1.rowvec(), series2.rowvec());
+    check_univariate(series1, series2);
+    return sbd<F>(series1.data(), series1.length(), series2.data(), series2.length());
   }
 
 } // End of namespace tempo::distance::univariate
@@ -0,0 +1,368 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "univariate.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Micro benchmarks of the univariate distances, i.e. of the elastic and lock step kernels as called by the classifiers
+// (cost function exponent dispatch included). Each benchmark computes the distances between consecutive series of a
+// mock dataset, for several series lengths, cost function exponents, windows, and cutoffs:
+//  - none:  +INF, no early abandoning (EAP still prunes the cells above +INF)
+//  - loose: above the distance, pruning without abandoning
+//  - tight: below the distance, early abandoning
+// Run with e.g. 'libtempo-bench --reporter JSON::out=bench.json' to track the results over time.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+using namespace tempo::distance;
+
+using F = double;
+
+namespace {
+
+  constexpr size_t nbitems = 32;
+  constexpr F PINF = utils::PINF<F>;
+  const std::vector<size_t> lengths{64, 256, 1024};
+  const std::vector<F> cfes{0.5, 1.0, 2.0};
+  const std::vector<F> wratios{0.1, 1.0};
+
+  /// Distance between the series i and i+1 of a dataset with a cutoff
+  using dist_ft = std::function<F(size_t i, F cutoff)>;
+
+  /// Fixed length series with values in [0, 2[, same dataset for a given length
+  std::vector<std::vector<F>> make_dataset(size_t length) {
+    mock::Mocker mocker(0);
+    mocker._fixl = length;
+    return mocker.vec_randvec(nbitems);
+  }
+
+  /// Name of a benchmark made of its parameters
+  std::string bench_name(std::string const& dist, size_t length, std::string const& params, std::string const& cut) {
+    return dist + " length=" + std::to_string(length) + " " + params + " cutoff=" + cut;
+  }
+
+  /// Benchmark 'dist' without cutoff
+  void bench_nocutoff(std::string const& dist, size_t length, std::string const& params, dist_ft const& fun) {
+    BENCHMARK(bench_name(dist, length, params, "none")) {
+      F r = 0;
+      for (size_t i = 0; i + 1<nbitems; ++i) { r += fun(i, PINF); }
+      return r;
+    };
+  }
+
+  /// Benchmark 'dist' without cutoff, with a loose cutoff and with a tight cutoff
+  void bench_cutoffs(std::string const& dist, size_t length, std::string const& params, dist_ft const& fun) {
+    bench_nocutoff(dist, length, params, fun);
+    std::vector<F> loose;
+    std::vector<F> tight;
+    for (size_t i = 0; i + 1<nbitems; ++i) {
+      const F d = fun(i, PINF);
+      loose.push_back(d*1.25);
+      tight.push_back(d*0.8);
+    }
+    BENCHMARK(bench_name(dist, length, params, "loose")) {
+      F r = 0;
+      for (size_t i = 0; i + 1<nbitems; ++i) { r += fun(i, loose[i]); }
+      return r;
+    };
+    BENCHMARK(bench_name(dist, length, params, "tight")) {
+      size_t nb_abandoned = 0;
+      for (size_t i = 0; i + 1<nbitems; ++i) { nb_abandoned += (fun(i, tight[i])==PINF); }
+      return nb_abandoned;
+    };
+  }
+
+  /// Window of a ratio of the length
+  size_t to_window(F wratio, size_t length) { return (size_t)(wratio*(F)length); }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Elastic distances
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Benchmark DTW", "[bench][dtw]") {
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F cfe : cfes) {
+      for (F wr : wratios) {
+        const size_t w = to_window(wr, length);
+        bench_cutoffs("dtw", length, "cfe=" + std::to_string(cfe) + " wr=" + std::to_string(wr),
+                      [&](size_t i, F cutoff) {
+                        auto const& s1 = dset[i];
+                        auto const& s2 = dset[i + 1];
+                        return univariate::dtw<F>(s1.data(), s1.size(), s2.data(), s2.size(), cfe, w, cutoff);
+                      });
+      }
+    }
+  }
+}
+
+TEST_CASE("Benchmark ADTW", "[bench][adtw]") {
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F cfe : cfes) {
+      for (F penalty : {0.01, 1.0}) {
+        bench_cutoffs("adtw", length, "cfe=" + std::to_string(cfe) + " penalty=" + std::to_string(penalty),
+                      [&](size_t i, F cutoff) {
+                        auto const& s1 = dset[i];
+                        auto const& s2 = dset[i + 1];
+                        return univariate::adtw<F>(s1.data(), s1.size(), s2.data(), s2.size(), cfe, penalty, cutoff);
+                      });
+      }
+    }
+  }
+}
+
+TEST_CASE("Benchmark DTW and ADTW kernels per cfe", "[bench][dtw][adtw][cfe]") {
+  // Kernels selected once per cfe, as called by the NN1 splitters on equal length series (see dtw_for, adtw_for).
+  // Compares the cost functions inside the recurrence: the square root (cfe=0.5) of a cell is independent of the
+  // dependency chain of the recurrence, and mostly overlaps with it.
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F cfe : cfes) {
+      const size_t w = to_window(0.1, length);
+      const univariate::DTWFun<F> dtwfun = univariate::dtw_for<F>(cfe, true);
+      bench_cutoffs("dtw_kernel", length, "cfe=" + std::to_string(cfe) + " wr=0.1",
+                    [&](size_t i, F cutoff) {
+                      auto const& s1 = dset[i];
+                      auto const& s2 = dset[i + 1];
+                      return dtwfun(s1.data(), s1.size(), s2.data(), s2.size(), cfe, w, cutoff);
+                    });
+      const univariate::ADTWFun<F> adtwfun = univariate::adtw_for<F>(cfe, true);
+      bench_cutoffs("adtw_kernel", length, "cfe=" + std::to_string(cfe) + " penalty=0.01",
+                    [&](size_t i, F cutoff) {
+                      auto const& s1 = dset[i];
+                      auto const& s2 = dset[i + 1];
+                      return adtwfun(s1.data(), s1.size(), s2.data(), s2.size(), cfe, 0.01, cutoff);
+                    });
+    }
+  }
+}
+
+TEST_CASE("Benchmark DTW and ADTW row cost stage", "[bench][dtw][adtw][cfe][rowcost]") {
+  // Kernels selected by dtw_for and adtw_for, without and with the row cost stage (see set_row_costs): the costs of a
+  // line are computed ahead of the recurrence, vectorised, instead of in its dependency chain (e.g. the square root
+  // of cfe=0.5). Compare each cfe to cfe=1, with and without the stage.
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F cfe : cfes) {
+      for (bool row_costs : {false, true}) {
+        univariate::set_row_costs(row_costs);
+        const univariate::DTWFun<F> dtwfun = univariate::dtw_for<F>(cfe);
+        const univariate::ADTWFun<F> adtwfun = univariate::adtw_for<F>(cfe);
+        univariate::set_row_costs(false);
+        for (F wr : wratios) {
+          const size_t w = to_window(wr, length);
+          const std::string params = "cfe=" + std::to_string(cfe) + " wr=" + std::to_string(wr);
+          bench_cutoffs(row_costs ? "dtw_rowcost" : "dtw", length, params,
+                        [&](size_t i, F cutoff) {
+                          auto const& s1 = dset[i];
+                          auto const& s2 = dset[i + 1];
+                          return dtwfun(s1.data(), s1.size(), s2.data(), s2.size(), cfe, w, cutoff);
+                        });
+        }
+        bench_cutoffs(row_costs ? "adtw_rowcost" : "adtw", length, "cfe=" + std::to_string(cfe) + " penalty=0.01",
+                      [&](size_t i, F cutoff) {
+                        auto const& s1 = dset[i];
+                        auto const& s2 = dset[i + 1];
+                        return adtwfun(s1.data(), s1.size(), s2.data(), s2.size(), cfe, 0.01, cutoff);
+                      });
+      }
+    }
+  }
+}
+
+TEST_CASE("Benchmark equal length kernels", "[bench][dtw][adtw][equal]") {
+  // General vs equal length kernels on series of the same length (see adtw_equal_length, dtw_equal_length).
+  // ADTW: the equal length kernel also prunes the cells out of the window of the alignments <= cutoff, which only
+  // helps when the penalty is large enough for the window to cut the matrix (penalty=1), else it runs the general one.
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F cfe : cfes) {
+      const std::string pcfe = "cfe=" + std::to_string(cfe);
+      for (F penalty : {0.01, 1.0}) {
+        const std::string params = pcfe + " penalty=" + std::to_string(penalty);
+        for (bool equal_length : {false, true}) {
+          const univariate::ADTWFun<F> adtwfun = univariate::adtw_for<F>(cfe, equal_length);
+          bench_cutoffs(equal_length ? "adtw_equal_length" : "adtw_general", length, params,
+                        [&](size_t i, F cutoff) {
+                          auto const& s1 = dset[i];
+                          auto const& s2 = dset[i + 1];
+                          return adtwfun(s1.data(), s1.size(), s2.data(), s2.size(), cfe, penalty, cutoff);
+                        });
+        }
+      }
+      const size_t w = to_window(0.1, length);
+      for (bool equal_length : {false, true}) {
+        const univariate::DTWFun<F> dtwfun = univariate::dtw_for<F>(cfe, equal_length);
+        bench_cutoffs(equal_length ? "dtw_equal_length" : "dtw_general", length, pcfe + " wr=0.1",
+                      [&](size_t i, F cutoff) {
+                        auto const& s1 = dset[i];
+                        auto const& s2 = dset[i + 1];
+                        return dtwfun(s1.data(), s1.size(), s2.data(), s2.size(), cfe, w, cutoff);
+                      });
+      }
+    }
+  }
+}
+
+TEST_CASE("Benchmark WDTW", "[bench][wdtw]") {
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    const auto weights = univariate::wdtw_weights<F>(0.05, length);
+    for (F cfe : cfes) {
+      bench_cutoffs("wdtw", length, "cfe=" + std::to_string(cfe) + " g=0.05",
+                    [&](size_t i, F cutoff) {
+                      auto const& s1 = dset[i];
+                      auto const& s2 = dset[i + 1];
+                      return univariate::wdtw<F>(s1.data(), s1.size(), s2.data(), s2.size(), cfe, weights.data(),
+                                                 cutoff);
+                    });
+    }
+  }
+}
+
+TEST_CASE("Benchmark ERP", "[bench][erp]") {
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F cfe : cfes) {
+      for (F wr : wratios) {
+        const size_t w = to_window(wr, length);
+        bench_cutoffs("erp", length, "cfe=" + std::to_string(cfe) + " wr=" + std::to_string(wr),
+                      [&](size_t i, F cutoff) {
+                        auto const& s1 = dset[i];
+                        auto const& s2 = dset[i + 1];
+                        return univariate::erp<F>(s1.data(), s1.size(), s2.data(), s2.size(), cfe, 0.5, w, cutoff);
+                      });
+      }
+    }
+  }
+}
+
+TEST_CASE("Benchmark WDTW and ERP row cost stage", "[bench][wdtw][erp][cfe][rowcost]") {
+  // Kernels selected by wdtw_for and erp_for, without and with the row cost stage (see set_row_costs)
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    const auto weights = univariate::wdtw_weights<F>(0.05, length);
+    for (F cfe : cfes) {
+      for (bool row_costs : {false, true}) {
+        univariate::set_row_costs(row_costs);
+        const univariate::WDTWFun<F> wdtwfun = univariate::wdtw_for<F>(cfe);
+        const univariate::ERPFun<F> erpfun = univariate::erp_for<F>(cfe);
+        univariate::set_row_costs(false);
+        bench_cutoffs(row_costs ? "wdtw_rowcost" : "wdtw", length, "cfe=" + std::to_string(cfe) + " g=0.05",
+                      [&](size_t i, F cutoff) {
+                        auto const& s1 = dset[i];
+                        auto const& s2 = dset[i + 1];
+                        return wdtwfun(s1.data(), s1.size(), s2.data(), s2.size(), cfe, weights.data(), cutoff);
+                      });
+        for (F wr : wratios) {
+          const size_t w = to_window(wr, length);
+          const std::string params = "cfe=" + std::to_string(cfe) + " wr=" + std::to_string(wr);
+          bench_cutoffs(row_costs ? "erp_rowcost" : "erp", length, params,
+                        [&](size_t i, F cutoff) {
+                          auto const& s1 = dset[i];
+                          auto const& s2 = dset[i + 1];
+                          return erpfun(s1.data(), s1.size(), s2.data(), s2.size(), cfe, 0.5, w, cutoff);
+                        });
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Benchmark LCSS", "[bench][lcss]") {
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F wr : wratios) {
+      const size_t w = to_window(wr, length);
+      bench_cutoffs("lcss", length, "epsilon=0.2 wr=" + std::to_string(wr),
+                    [&](size_t i, F cutoff) {
+                      auto const& s1 = dset[i];
+                      auto const& s2 = dset[i + 1];
+                      return univariate::lcss<F>(s1.data(), s1.size(), s2.data(), s2.size(), 0.2, w, cutoff);
+                    });
+    }
+  }
+}
+
+TEST_CASE("Benchmark MSM", "[bench][msm]") {
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F cost : {0.1, 1.0}) {
+      bench_cutoffs("msm", length, "cost=" + std::to_string(cost),
+                    [&](size_t i, F cutoff) {
+                      auto const& s1 = dset[i];
+                      auto const& s2 = dset[i + 1];
+                      return univariate::msm<F>(s1.data(), s1.size(), s2.data(), s2.size(), cost, cutoff);
+                    });
+    }
+  }
+}
+
+TEST_CASE("Benchmark TWE", "[bench][twe]") {
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    bench_cutoffs("twe", length, "nu=0.001 lambda=0.05",
+                  [&](size_t i, F cutoff) {
+                    auto const& s1 = dset[i];
+                    auto const& s2 = dset[i + 1];
+                    return univariate::twe<F>(s1.data(), s1.size(), s2.data(), s2.size(), 0.001, 0.05, cutoff);
+                  });
+  }
+}
+
+TEST_CASE("Benchmark Soft-DTW", "[bench][softdtw]") {
+  // No cutoff
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F wr : wratios) {
+      const size_t w = to_window(wr, length);
+      bench_nocutoff("softdtw", length, "cfe=2 gamma=0.1 wr=" + std::to_string(wr),
+                     [&](size_t i, F /* cutoff */) {
+                       auto const& s1 = dset[i];
+                       auto const& s2 = dset[i + 1];
+                       return univariate::softdtw<F>(s1.data(), s1.size(), s2.data(), s2.size(), 2.0, 0.1, w);
+                     });
+    }
+  }
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Lock step distances
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Benchmark Direct Alignment", "[bench][directa]") {
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    for (F cfe : cfes) {
+      bench_cutoffs("directa", length, "cfe=" + std::to_string(cfe),
+                    [&](size_t i, F cutoff) {
+                      auto const& s1 = dset[i];
+                      auto const& s2 = dset[i + 1];
+                      return univariate::directa<F>(s1.data(), s1.size(), s2.data(), s2.size(), cfe, cutoff);
+                    });
+    }
+  }
+}
+
+TEST_CASE("Benchmark lock step", "[bench][lockstep]") {
+  for (size_t length : lengths) {
+    const auto dset = make_dataset(length);
+    bench_nocutoff("lorentzian", length, "", [&](size_t i, F /* cutoff */) {
+      return univariate::lorentzian<F>(dset[i].data(), length, dset[i + 1].data(), length);
+    });
+    bench_nocutoff("manhattan", length, "", [&](size_t i, F /* cutoff */) {
+      return univariate::manhattan<F>(dset[i].data(), length, dset[i + 1].data(), length);
+    });
+    bench_nocutoff("minkowski", length, "p=3", [&](size_t i, F /* cutoff */) {
+      return univariate::minkowski<F>(dset[i].data(), length, dset[i + 1].data(), length, 3.0);
+    });
+  }
+}
@@ -2,8 +2,37 @@
 
 namespace tempo::distance::univariate {
 
+  size_t sbd_spectrum_size(size_t max_length) { return tdcu::sbd_spectrum_size(max_length); }
+
+  namespace {
+    bool use_row_costs{false};
+  }
+
+  void set_row_costs(bool enabled) { use_row_costs = enabled; }
+
+  bool row_costs() { return use_row_costs; }
+
   // Implementation through template explicit instantiation
 
+  /// Instantiate the elastic distances with a compile time cost function, for the floating type T and the CFE C
+  #define TEMPO_DISTANCE_INSTANTIATE_CFE(T, C)                                                                    \
+    template T adtw<C, T>(T const *, size_t, T const *, size_t, T cfe, T penalty, T cutoff);                     \
+    template T dtw<C, T>(T const *, size_t, T const *, size_t, T cfe, size_t window, T cutoff);                  \
+    template T wdtw<C, T>(T const *, size_t, T const *, size_t, T cfe, T const *weights, T cutoff);              \
+    template T wdtw_mirrored<C, T>(T const *, size_t, T const *, size_t, T cfe, T const *, size_t, T cutoff);    \
+    template T erp<C, T>(T const *, size_t, T const *, size_t, T cfe, T gap_value, size_t window, T cutoff);     \
+    template T erp<C, T>(T const *, T const *, size_t, T const *, T const *, size_t, T cfe, size_t window,        \
+                         T cutoff);                                                                             \
+    template T adtw_equal_length<C, T>(T const *, size_t, T const *, size_t, T cfe, T penalty, T cutoff);        \
+    template T dtw_equal_length<C, T>(T const *, size_t, T const *, size_t, T cfe, size_t window, T cutoff);     \
+    template T adtw_rowcost<C, T>(T const *, size_t, T const *, size_t, T cfe, T penalty, T cutoff);             \
+    template T dtw_rowcost<C, T>(T const *, size_t, T const *, size_t, T cfe, size_t window, T cutoff);          \
+    template T wdtw_rowcost<C, T>(T const *, size_t, T const *, size_t, T cfe, T const *weights, T cutoff);      \
+    template T erp_rowcost<C, T>(T const *, size_t, T const *, size_t, T cfe, T gap_value, size_t window,        \
+                                 T cutoff);                                                                     \
+    template T erp_rowcost<C, T>(T const *, T const *, size_t, T const *, T const *, size_t, T cfe,              \
+                                 size_t window, T cutoff);
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // Double implementation
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -14,21 +43,64 @@ namespace tempo::distance::univariate {
   template F adtw(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, F penalty, F cutoff);
 
   template F dtw(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, size_t window, F cutoff);
+  template F dtw_cb(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, size_t window,
+                   F cutoff, F const *cb);
+  template F dtw_wr(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, size_t window,
+                  F cutoff, size_t& max_deviation);
+  template F dtw_wavefront(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, size_t window,
+                           F cutoff, size_t nb_threads);
+
+  template F softdtw(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, F gamma, size_t window);
 
   template F wdtw(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, F const *weights, F cutoff);
   template void wdtw_weights(F g, F *weights_array, size_t length, F wmax);
   template void wdtw_weights(F g, std::vector<F>& weights, size_t length, F wmax);
   template std::vector<F> wdtw_weights(F g, size_t length, F wmax);
+  template std::vector<F> wdtw_mirror_weights(F const *weights, size_t length);
+  template F wdtw_mirrored(F const *data1, size_t length1, F const *data2, size_t length2,
+                           F cfe, F const *mirrored_weights, size_t center, F cutoff);
 
   template F erp(F const *data1, size_t length1, F const *data2, size_t length2,
                  F cfe, F gap_value, size_t window, F cutoff);
+  template void erp_gap_costs(F const *series, size_t length, F cfe, F gap_value, F *gaps);
+  template F erp(F const *data1, F const *gaps1, size_t length1, F const *data2, F const *gaps2, size_t length2,
+                 F cfe, size_t window, F cutoff);
 
   template F lcss(F const *data1, size_t length1, F const *data2, size_t length2, F epsilon, size_t window, F cutoff);
+  template F lcss_equal_length(F const *data1, size_t length1, F const *data2, size_t length2, F epsilon,
+                               size_t window, F cutoff);
 
   template F msm(F const *data1, size_t length1, F const *data2, size_t length2, F cost, F cutoff);
 
   template F twe(F const *data1, size_t length1, F const *data2, size_t length2, F nu, F lambda, F cutoff);
 
+  template void first_differences(F const *series, size_t length, F *diff);
+  template F msm(F const *data1, F const *diff1, size_t length1, F const *data2, F const *diff2, size_t length2,
+                 F cost, F cutoff);
+  template F twe(F const *data1, F const *diff1, size_t length1, F const *data2, F const *diff2, size_t length2,
+                  F nu, F lambda, F cutoff);
+
+  template size_t nb_lanes(F cfe);
+  template void dtw_lanes(F const *query, F const *const *candidates, size_t nb, size_t length,
+                          F cfe, size_t window, F const *cutoffs, F *results);
+  template void adtw_lanes(F const *query, F const *const *candidates, size_t nb, size_t length,
+                           F cfe, F penalty, F const *cutoffs, F *results);
+
+  template F dtw(quantized::QView<F> const& q1, F const *data2, size_t length2, F cfe, size_t window, F cutoff);
+  template F adtw(quantized::QView<F> const& q1, F const *data2, size_t length2, F cfe, F penalty, F cutoff);
+
+  template F dtw_derived(F const *data1, size_t length1, F const *raw2, size_t length2, F cfe, size_t window,
+                         F cutoff);
+  template F adtw_derived(F const *data1, size_t length1, F const *raw2, size_t length2, F cfe, F penalty, F cutoff);
+  template F lcss_derived(F const *data1, size_t length1, F const *raw2, size_t length2, F epsilon, size_t window,
+                          F cutoff);
+
+  TEMPO_DISTANCE_INSTANTIATE_CFE(F, CFE::AD1)
+  TEMPO_DISTANCE_INSTANTIATE_CFE(F, CFE::AD2)
+  TEMPO_DISTANCE_INSTANTIATE_CFE(F, CFE::SQRT)
+  TEMPO_DISTANCE_INSTANTIATE_CFE(F, CFE::QUARTER)
+  TEMPO_DISTANCE_INSTANTIATE_CFE(F, CFE::ANY)
+
 
   // --- --- --- DTW Lower bounds --- --- ---
 
@@ -64,6 +136,8 @@ namespace tempo::distance::univariate {
 
   template F lb_Keogh(F const *query, size_t lquery, std::vector<F> const& upper, std::vector<F> const& lower,
                       F cfe, F cutoff);
+  template F lb_Keogh_cumulative(F const *query, size_t query_length, F const *upper, F const *lower, F cfe,
+                                 F *cb);
 
   //
 
@@ -132,6 +206,33 @@ namespace tempo::distance::univariate {
     F cfe, size_t w, F cutoff
   );
 
+  template F lb_Improved(F const *query, size_t length, F const *candidate, F const *upper, F const *lower,
+                         F cfe, size_t w, F cutoff);
+
+  template F lb_Petitjean(F const *query, size_t length, F const *query_upper, F const *query_lower,
+                          F const *candidate, F const *upper, F const *lower,
+                          F cfe, size_t w, F cutoff);
+
+  //
+
+  template size_t adtw_lb_window(size_t length, F penalty, F cutoff);
+
+  template F lb_ADTW(F const *query, F const *candidate, size_t length, F cfe, F penalty, F cutoff);
+
+  //
+
+  template F lb_LCSS(F const *query, size_t length, F const *upper, F const *lower, F epsilon, F cutoff);
+
+  //
+
+  template F lb_ERP(F const *query, size_t length, F const *upper, F const *lower, F cfe, F gv, F cutoff);
+
+  template F lb_ERP_sums(F const *series1, size_t length1, F const *series2, size_t length2, F gv, F cutoff);
+
+  template F lb_MSM(F const *query, size_t length1, F const *candidate, size_t length2, F cost, F cutoff);
+
+  template F lb_TWE(F const *query, F const *candidate, size_t length, F nu, F lambda, F cutoff);
+
 
   // --- --- --- Lockstep distances --- --- ---
 
@@ -156,4 +257,241 @@ namespace tempo::distance::univariate {
 
   template F sbd(arma::Row<F> const& A, arma::Row<F> const& B);
 
+  template void sbd_spectrum(F const *A, size_t lA, size_t max_length, F *out);
+
+  template F sbd_spectra(F const *SA, F const *SB, size_t size);
+
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Float implementation
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  using Ff = float;
+
+  // --- --- --- Elastic distances --- --- ---
+
+  template Ff adtw(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff cfe, Ff penalty, Ff cutoff);
+
+  template Ff dtw(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff cfe, size_t window, Ff cutoff);
+  template Ff dtw_cb(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff cfe, size_t window,
+                    Ff cutoff, Ff const *cb);
+  template Ff dtw_wr(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff cfe, size_t window,
+                   Ff cutoff, size_t& max_deviation);
+  template Ff dtw_wavefront(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff cfe, size_t window,
+                            Ff cutoff, size_t nb_threads);
+
+  template Ff softdtw(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff cfe, Ff gamma,
+                      size_t window);
+
+  template Ff wdtw(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff cfe, Ff const *weights, Ff cutoff);
+  template void wdtw_weights(Ff g, Ff *weights_array, size_t length, Ff wmax);
+  template void wdtw_weights(Ff g, std::vector<Ff>& weights, size_t length, Ff wmax);
+  template std::vector<Ff> wdtw_weights(Ff g, size_t length, Ff wmax);
+  template std::vector<Ff> wdtw_mirror_weights(Ff const *weights, size_t length);
+  template Ff wdtw_mirrored(Ff const *data1, size_t length1, Ff const *data2, size_t length2,
+                            Ff cfe, Ff const *mirrored_weights, size_t center, Ff cutoff);
+
+  template Ff erp(Ff const *data1, size_t length1, Ff const *data2, size_t length2,
+                 Ff cfe, Ff gap_value, size_t window, Ff cutoff);
+  template void erp_gap_costs(Ff const *series, size_t length, Ff cfe, Ff gap_value, Ff *gaps);
+  template Ff erp(Ff const *data1, Ff const *gaps1, size_t length1, Ff const *data2, Ff const *gaps2, size_t length2,
+                  Ff cfe, size_t window, Ff cutoff);
+
+  template Ff lcss(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff epsilon, size_t window, Ff cutoff);
+  template Ff lcss_equal_length(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff epsilon,
+                                size_t window, Ff cutoff);
+
+  template Ff msm(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff cost, Ff cutoff);
+
+  template Ff twe(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff nu, Ff lambda, Ff cutoff);
+
+  template void first_differences(Ff const *series, size_t length, Ff *diff);
+  template Ff msm(Ff const *data1, Ff const *diff1, size_t length1, Ff const *data2, Ff const *diff2, size_t length2,
+                  Ff cost, Ff cutoff);
+  template Ff twe(Ff const *data1, Ff const *diff1, size_t length1, Ff const *data2, Ff const *diff2, size_t length2,
+                  Ff nu, Ff lambda, Ff cutoff);
+
+  template size_t nb_lanes(Ff cfe);
+  template void dtw_lanes(Ff const *query, Ff const *const *candidates, size_t nb, size_t length,
+                          Ff cfe, size_t window, Ff const *cutoffs, Ff *results);
+  template void adtw_lanes(Ff const *query, Ff const *const *candidates, size_t nb, size_t length,
+                           Ff cfe, Ff penalty, Ff const *cutoffs, Ff *results);
+
+  template Ff dtw(quantized::QView<Ff> const& q1, Ff const *data2, size_t length2, Ff cfe, size_t window, Ff cutoff);
+  template Ff adtw(quantized::QView<Ff> const& q1, Ff const *data2, size_t length2, Ff cfe, Ff penalty, Ff cutoff);
+
+  template Ff dtw_derived(Ff const *data1, size_t length1, Ff const *raw2, size_t length2, Ff cfe, size_t window,
+                          Ff cutoff);
+  template Ff adtw_derived(Ff const *data1, size_t length1, Ff const *raw2, size_t length2, Ff cfe, Ff penalty,
+                           Ff cutoff);
+  template Ff lcss_derived(Ff const *data1, size_t length1, Ff const *raw2, size_t length2, Ff epsilon, size_t window,
+                           Ff cutoff);
+
+  TEMPO_DISTANCE_INSTANTIATE_CFE(Ff, CFE::AD1)
+  TEMPO_DISTANCE_INSTANTIATE_CFE(Ff, CFE::AD2)
+  TEMPO_DISTANCE_INSTANTIATE_CFE(Ff, CFE::SQRT)
+  TEMPO_DISTANCE_INSTANTIATE_CFE(Ff, CFE::QUARTER)
+  TEMPO_DISTANCE_INSTANTIATE_CFE(Ff, CFE::ANY)
+
+
+  // --- --- --- DTW Lower bounds --- --- ---
+
+  // --- --- --- --- --- --- Envelopes
+
+  template void get_keogh_envelopes<Ff>(Ff const *series, size_t length, Ff *upper, Ff *lower, size_t w);
+
+  template void get_keogh_envelopes<Ff>(Ff const *series, size_t length,
+                                       std::vector<Ff>& upper, std::vector<Ff>& lower,
+                                       size_t w);
+
+  template void get_keogh_up_envelope(Ff const *series, size_t length, Ff *upper, size_t w);
+
+  template void get_keogh_up_envelope(Ff const *series, size_t length, std::vector<Ff>& upper, size_t w);
+
+  template void get_keogh_lo_envelope(Ff const *series, size_t length, Ff *lower, size_t w);
+
+  template void get_keogh_lo_envelope(Ff const *series, size_t length, std::vector<Ff>& lower, size_t w);
+
+  template void get_keogh_envelopes_Webb(
+    Ff const *series, size_t length, Ff *upper, Ff *lower, Ff *lower_upper, Ff *upper_lower, size_t w
+  );
+
+  template void get_keogh_envelopes_Webb(Ff const *series, size_t length,
+                                         std::vector<Ff>& upper, std::vector<Ff>& lower,
+                                         std::vector<Ff>& lower_upper, std::vector<Ff>& upper_lower,
+                                         size_t w);
+
+
+  // --- --- --- --- --- --- Lower bounds
+
+  template Ff lb_Keogh(Ff const *query, size_t query_length, Ff const *upper, Ff const *lower, Ff cfe, Ff cutoff);
+
+  template Ff lb_Keogh(Ff const *query, size_t lquery, std::vector<Ff> const& upper, std::vector<Ff> const& lower,
+                      Ff cfe, Ff cutoff);
+  template Ff lb_Keogh_cumulative(Ff const *query, size_t query_length, Ff const *upper, Ff const *lower, Ff cfe,
+                                  Ff *cb);
+
+  //
+
+  template Ff lb_Keogh2j(
+    Ff const *series1, size_t length1, Ff const *upper1, Ff const *lower1,
+    Ff const *series2, size_t length2, Ff const *upper2, Ff const *lower2,
+    Ff cfe, Ff cutoff
+  );
+
+  template Ff lb_Keogh2j(
+    Ff const *series1, size_t length1, std::vector<Ff> const& upper1, std::vector<Ff> const& lower1,
+    Ff const *series2, size_t length2, std::vector<Ff> const& upper2, std::vector<Ff> const& lower2,
+    Ff cfe, Ff cutoff
+  );
+
+  //
+
+  template Ff lb_Enhanced(const Ff *query, size_t lquery,
+                         const Ff *candidate, size_t lcandidate, const Ff *candidate_upper, const Ff *candidate_lower,
+                         Ff cfe, size_t v, size_t w, Ff cutoff);
+
+  template Ff lb_Enhanced(const Ff *query, size_t lquery,
+                         const Ff *candidate, size_t lcandidate,
+                         std::vector<Ff> const& candidate_up, std::vector<Ff> const& candidate_lo,
+                         Ff cfe, size_t v, size_t w, Ff cutoff);
+
+  //
+
+  template Ff lb_Enhanced2j(
+    const Ff *series1, size_t length1, const Ff *upper1, const Ff *lower1,
+    const Ff *series2, size_t length2, const Ff *upper2, const Ff *lower2,
+    Ff cfe, size_t v, size_t w, Ff cutoff
+  );
+
+  template Ff lb_Enhanced2j(
+    const Ff *series1, size_t length1, std::vector<Ff> const& upper1, std::vector<Ff> const& lower1,
+    const Ff *series2, size_t length2, std::vector<Ff> const& upper2, std::vector<Ff> const& lower2,
+    Ff cfe, size_t v, size_t w, Ff cutoff
+  );
+
+  //
+
+  template Ff lb_Webb(
+    // Series A
+    Ff const *sa, size_t length_sa,
+    Ff const *upper_sa, Ff const *lower_sa,
+    Ff const *lower_upper_sa, Ff const *upper_lower_sa,
+    // Series B
+    Ff const *sb, size_t length_sb,
+    Ff const *upper_sb, Ff const *lower_sb,
+    Ff const *lower_upper_sb, Ff const *upper_lower_sb,
+    // Others
+    Ff cfe, size_t w, Ff cf
+  );
+
+  template Ff lb_Webb(
+    // Series A
+    Ff const *a, size_t a_len,
+    std::vector<Ff> const& a_up, std::vector<Ff> const& a_lo,
+    std::vector<Ff> const& a_lo_up, std::vector<Ff> const& a_up_lo,
+    // Series B
+    Ff const *b, size_t b_len,
+    std::vector<Ff> const& b_up, std::vector<Ff> const& b_lo,
+    std::vector<Ff> const& b_lo_up, std::vector<Ff> const& b_up_lo,
+    // Others
+    Ff cfe, size_t w, Ff cutoff
+  );
+
+  template Ff lb_Improved(Ff const *query, size_t length, Ff const *candidate, Ff const *upper, Ff const *lower,
+                          Ff cfe, size_t w, Ff cutoff);
+
+  template Ff lb_Petitjean(Ff const *query, size_t length, Ff const *query_upper, Ff const *query_lower,
+                           Ff const *candidate, Ff const *upper, Ff const *lower,
+                           Ff cfe, size_t w, Ff cutoff);
+
+  //
+
+  template size_t adtw_lb_window(size_t length, Ff penalty, Ff cutoff);
+
+  template Ff lb_ADTW(Ff const *query, Ff const *candidate, size_t length, Ff cfe, Ff penalty, Ff cutoff);
+
+  //
+
+  template Ff lb_LCSS(Ff const *query, size_t length, Ff const *upper, Ff const *lower, Ff epsilon, Ff cutoff);
+
+  //
+
+  template Ff lb_ERP(Ff const *query, size_t length, Ff const *upper, Ff const *lower, Ff cfe, Ff gv, Ff cutoff);
+
+  template Ff lb_ERP_sums(Ff const *series1, size_t length1, Ff const *series2, size_t length2, Ff gv, Ff cutoff);
+
+  template Ff lb_MSM(Ff const *query, size_t length1, Ff const *candidate, size_t length2, Ff cost, Ff cutoff);
+
+  template Ff lb_TWE(Ff const *query, Ff const *candidate, size_t length, Ff nu, Ff lambda, Ff cutoff);
+
+
+  // --- --- --- Lockstep distances --- --- ---
+
+  template Ff directa(Ff const *data1, size_t length1, Ff const *data2, size_t length2, Ff cfe, Ff cutoff);
+
+  template Ff lorentzian(Ff const *A, size_t lA, Ff const *B, size_t lB);
+
+  template Ff lorentzian(arma::Row<Ff> const& A, arma::Row<Ff> const& B);
+
+  template Ff minkowski(Ff const *A, size_t lA, Ff const *B, size_t lB, Ff p);
+
+  template Ff minkowski(arma::Row<Ff> const& A, arma::Row<Ff> const& B, Ff p);
+
+  template Ff manhattan(Ff const *A, size_t lA, Ff const *B, size_t lB);
+
+  template Ff manhattan(arma::Row<Ff> const& A, arma::Row<Ff> const& B);
+
+
+  // --- --- --- Sliding distances --- --- ---
+
+  template Ff sbd(Ff const *A, size_t lA, Ff const *B, size_t lB);
+
+  template Ff sbd(arma::Row<Ff> const& A, arma::Row<Ff> const& B);
+
+  template void sbd_spectrum(Ff const *A, size_t lA, size_t max_length, Ff *out);
+
+  template Ff sbd_spectra(Ff const *SA, Ff const *SB, size_t size);
+
+  #undef TEMPO_DISTANCE_INSTANTIATE_CFE
+
 } // End of namespace tempo::distance:univariate
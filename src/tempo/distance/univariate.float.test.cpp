@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "univariate.hpp"
+
+#include <mock/mockseries.hpp>
+#include <vector>
+
+using namespace tempo::distance;
+
+constexpr size_t nbitems = 200;
+constexpr double PINF = utils::PINF<double>;
+constexpr float PINFf = utils::PINF<float>;
+
+// Relative tolerance of the single precision distances: values are accumulated over the series length
+constexpr double fepsilon = 1e-4;
+
+namespace {
+
+  std::vector<std::vector<float>> to_float(std::vector<std::vector<double>> const& set) {
+    std::vector<std::vector<float>> result;
+    for (const auto& s : set) { result.emplace_back(s.begin(), s.end()); }
+    return result;
+  }
+
+  /// Index of the nearest neighbour of query 'q' in the set (excluding itself), with the given distance
+  template<typename V, typename Fun>
+  size_t nn1(std::vector<V> const& set, size_t q, Fun&& dist) {
+    size_t best_idx = 0;
+    auto bsf = std::numeric_limits<typename V::value_type>::infinity();
+    for (size_t i = 0; i<set.size(); ++i) {
+      if (i==q) { continue; }
+      const auto d = dist(set[q], set[i], bsf);
+      if (d<bsf) {
+        bsf = d;
+        best_idx = i;
+      }
+    }
+    return best_idx;
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// Single precision (see TEMPO_FLOAT32) must give the same results as double precision, up to rounding.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Univariate float vs double", "[float][univariate]") {
+  mock::Mocker mocker(0);
+  const auto dset = mocker.vec_rs_randvec(nbitems);
+  const auto fset = to_float(dset);
+  const size_t w = 5;
+
+  SECTION("directa") {
+    for (const double e : {0.5, 1.0, 2.0}) {
+      for (size_t i = 0; i<nbitems - 1; ++i) {
+        const auto& d1 = dset[i];
+        const auto& d2 = dset[i + 1];
+        const auto& f1 = fset[i];
+        const auto& f2 = fset[i + 1];
+        if (d1.size()!=d2.size()) { continue; }
+        const double vd = univariate::directa<double>(d1.data(), d1.size(), d2.data(), d2.size(), e, PINF);
+        const float vf = univariate::directa<float>(f1.data(), f1.size(), f2.data(), f2.size(), (float)e, PINFf);
+        REQUIRE(vd==Catch::Approx(vf).epsilon(fepsilon));
+      }
+    }
+  }
+
+  SECTION("dtw, adtw, erp, msm, twe") {
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& d1 = dset[i];
+      const auto& d2 = dset[i + 1];
+      const auto& f1 = fset[i];
+      const auto& f2 = fset[i + 1];
+      const size_t ww = std::max<size_t>(w, std::max(d1.size(), d2.size()) - std::min(d1.size(), d2.size()));
+      {
+        const double vd = univariate::dtw<double>(d1.data(), d1.size(), d2.data(), d2.size(), 2.0, ww, PINF);
+        const float vf = univariate::dtw<float>(f1.data(), f1.size(), f2.data(), f2.size(), 2.0f, ww, PINFf);
+        REQUIRE(vd==Catch::Approx(vf).epsilon(fepsilon));
+      }
+      {
+        const double vd = univariate::adtw<double>(d1.data(), d1.size(), d2.data(), d2.size(), 2.0, 0.5, PINF);
+        const float vf = univariate::adtw<float>(f1.data(), f1.size(), f2.data(), f2.size(), 2.0f, 0.5f, PINFf);
+        REQUIRE(vd==Catch::Approx(vf).epsilon(fepsilon));
+      }
+      {
+        const double vd = univariate::erp<double>(d1.data(), d1.size(), d2.data(), d2.size(), 2.0, 0.1, ww, PINF);
+        const float vf = univariate::erp<float>(f1.data(), f1.size(), f2.data(), f2.size(), 2.0f, 0.1f, ww, PINFf);
+        REQUIRE(vd==Catch::Approx(vf).epsilon(fepsilon));
+      }
+      {
+        const double vd = univariate::msm<double>(d1.data(), d1.size(), d2.data(), d2.size(), 0.5, PINF);
+        const float vf = univariate::msm<float>(f1.data(), f1.size(), f2.data(), f2.size(), 0.5f, PINFf);
+        REQUIRE(vd==Catch::Approx(vf).epsilon(fepsilon));
+      }
+      {
+        const double vd = univariate::twe<double>(d1.data(), d1.size(), d2.data(), d2.size(), 0.001, 0.01, PINF);
+        const float vf = univariate::twe<float>(f1.data(), f1.size(), f2.data(), f2.size(), 0.001f, 0.01f, PINFf);
+        REQUIRE(vd==Catch::Approx(vf).epsilon(fepsilon));
+      }
+    }
+  }
+
+  SECTION("NN1 dtw agreement") {
+    // Near ties may be broken differently: only require a large agreement
+    size_t nb_agree = 0;
+    for (size_t q = 0; q<nbitems; ++q) {
+      const size_t id = nn1(dset, q, [](auto const& a, auto const& b, double bsf) {
+        const size_t ww = std::max(a.size(), b.size()) - std::min(a.size(), b.size()) + 5;
+        return univariate::dtw<double>(a.data(), a.size(), b.data(), b.size(), 2.0, ww, bsf);
+      });
+      const size_t ifl = nn1(fset, q, [](auto const& a, auto const& b, float bsf) {
+        const size_t ww = std::max(a.size(), b.size()) - std::min(a.size(), b.size()) + 5;
+        return univariate::dtw<float>(a.data(), a.size(), b.data(), b.size(), 2.0f, ww, bsf);
+      });
+      if (id==ifl) { ++nb_agree; }
+    }
+    REQUIRE((double)nb_agree/(double)nbitems>=0.98);
+  }
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "utils.hpp"
+#include "cost_functions.hpp"
+#include "quantized.hpp"
 #include <armadillo>
 #include <vector>
 
@@ -31,6 +33,57 @@ namespace tempo::distance::univariate {
     F cutoff
   );
 
+  /// DTW as above, the lines (data1) having the cumulative lower bound 'cb' of length1+1 values, e.g. from
+  /// lb_Keogh_cumulative with data1 as query: each line is pruned against the cutoff minus the bound of the next lines,
+  /// as in the UCR suite. Same result as dtw.
+  template<typename F>
+  F dtw_cb(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    F cfe,
+    size_t window,
+    F cutoff,
+    F const *cb
+  );
+
+  /// DTW with cost function cfe, warping window length, and EAP cutoff, also setting 'max_deviation' to the max
+  /// deviation from the diagonal of the warping path: the result is the same for any window in [max_deviation, window]
+  /// (see warping_cache.hpp). max_deviation is meaningless if the result is +INF.
+  template<typename F>
+  F dtw_wr(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    F cfe,
+    size_t window,
+    F cutoff,
+    size_t& max_deviation
+  );
+
+  /// DTW computed by anti-diagonals, each one split across 'nb_threads' threads (see core/elastic/dtw_wavefront.hpp).
+  /// Same result as dtw. The threads synchronise after each anti-diagonal: only for very long series.
+  /// Note: dtw already uses the single threaded wavefront kernel for long series when possible.
+  template<typename F>
+  F dtw_wavefront(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    F cfe,
+    size_t window,
+    F cutoff,
+    size_t nb_threads
+  );
+
+  /// Soft-DTW with cost function cfe, smoothing parameter gamma (DTW if gamma<=0) and warping window length.
+  /// Use window=NO_WINDOW to use unconstrained soft-DTW.
+  /// No cutoff: soft-DTW may be negative (see core/elastic/softdtw.hpp).
+  template<typename F>
+  F softdtw(
+    F const *data1, size_t length1,
+    F const *data2, size_t length2,
+    F cfe,
+    F gamma,
+    size_t window
+  );
+
   /// WDTW with cost function cfe, weights and EAP cutoff.
   template<typename F>
   F wdtw(F const *data1, size_t length1,
@@ -59,6 +112,20 @@ namespace tempo::distance::univariate {
   template<typename F>
   std::vector<F> wdtw_weights(F g, size_t length, F wmax=1);
 
+  /// Mirrored copy, of size 2*length-1, of 'length' WDTW weights, for wdtw_mirrored with center = length-1
+  template<typename F>
+  std::vector<F> wdtw_mirror_weights(F const *weights, size_t length);
+
+  /// WDTW with cost function cfe, mirrored weights (see wdtw_mirror_weights) and EAP cutoff.
+  /// Same result as wdtw, without computing |i-j| for each cell. 'center' must be at least the longest length minus 1.
+  template<typename F>
+  F wdtw_mirrored(F const *data1, size_t length1,
+                  F const *data2, size_t length2,
+                  F cfe,
+                  F const *mirrored_weights, size_t center,
+                  F cutoff
+  );
+
   /// ERP with cost function cfe, gap value, warping window, and EAP cutoff.
   /// Use window=NO_WINDOW to use unconstrained ERP.
   template<typename F>
@@ -70,8 +137,23 @@ namespace tempo::distance::univariate {
         F cutoff
   );
 
+  /// Costs between the points of a series of size length and the gap value of ERP, for the cost function cfe:
+  /// gaps[i] = |series[i] - gap_value|^cfe. Computed once per series and gap value for the ERP version below.
+  template<typename F>
+  void erp_gap_costs(F const *series, size_t length, F cfe, F gap_value, F *gaps);
+
+  /// ERP with cost function cfe, warping window, and EAP cutoff, with the gap costs of the series (see erp_gap_costs),
+  /// for the same cfe and a same gap value. Same result as erp.
+  template<typename F>
+  F erp(F const *data1, F const *gaps1, size_t length1,
+        F const *data2, F const *gaps2, size_t length2,
+        F cfe,
+        size_t window,
+        F cutoff
+  );
+
   /// LCSS with epsilon, warping window, and EAP cutoff.
-  /// Use window=NO_WINDOW to use unconstrained LCSS.
+  /// Use window=NO_WINDOW to use unconstrained LCSS. Computed 64 columns at a time (see core::lcss_bitparallel).
   template<typename F>
   F lcss(F const *data1, size_t length1,
          F const *data2, size_t length2,
@@ -97,6 +179,250 @@ namespace tempo::distance::univariate {
         F cutoff
   );
 
+  /// First differences of a series of size length: diff[i] = series[i] - series[i-1], and diff[0] = 0.
+  /// Computed once per series (e.g. per train exemplar) for the MSM and TWE versions below.
+  template<typename F>
+  void first_differences(F const *series, size_t length, F *diff);
+
+  /// MSM with cost and EAP cutoff, with the first differences of the series. Same result as msm.
+  template<typename F>
+  F msm(F const *data1, F const *diff1, size_t length1,
+        F const *data2, F const *diff2, size_t length2,
+        F cost,
+        F cutoff
+  );
+
+  /// TWE with stiffness (nu) and penalty (lambda) parameters, and EAP cutoff, with the first differences of the
+  /// series. Same result as twe.
+  template<typename F>
+  F twe(F const *data1, F const *diff1, size_t length1,
+        F const *data2, F const *diff2, size_t length2,
+        F nu,
+        F lambda,
+        F cutoff
+  );
+
+  // --- --- --- Compile time cost function
+  // Same as above, with the kind of cost function 'c' for the cfe given at compile time (see CFE and to_cfe).
+  // The cfe must match 'c'. The versions above dispatch to these ones.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  template<CFE c, typename F>
+  F adtw(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, F penalty, F cutoff);
+
+  template<CFE c, typename F>
+  F dtw(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, size_t window, F cutoff);
+
+  template<CFE c, typename F>
+  F wdtw(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, F const *weights, F cutoff);
+
+  template<CFE c, typename F>
+  F wdtw_mirrored(F const *data1, size_t length1, F const *data2, size_t length2,
+                  F cfe, F const *mirrored_weights, size_t center, F cutoff);
+
+  template<CFE c, typename F>
+  F erp(F const *data1, size_t length1, F const *data2, size_t length2,
+        F cfe, F gap_value, size_t window, F cutoff);
+
+  template<CFE c, typename F>
+  F erp(F const *data1, F const *gaps1, size_t length1, F const *data2, F const *gaps2, size_t length2,
+        F cfe, size_t window, F cutoff);
+
+  // --- --- --- Equal length
+  // Same results as the above for two series of the same length (e.g. all the series of a dataset without variable
+  // length, see DatasetHeader::variable_length), with the equal length kernels: no window check nor completion of the
+  // initial cutoff, no overflow checks on the window bounds of each line (see core::dtw_equal_length).
+  // Series of different lengths fall back on the general versions.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Also prunes the cells out of the window of the alignments <= cutoff (see core::adtw_equal_length)
+  template<CFE c, typename F>
+  F adtw_equal_length(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, F penalty, F cutoff);
+
+  /// Series up to 512 use a stack buffer, of the smallest bucket 64/128/256/512 holding them
+  /// (see core::dtw_fixed_length)
+  template<CFE c, typename F>
+  F dtw_equal_length(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, size_t window, F cutoff);
+
+  template<typename F>
+  F lcss_equal_length(F const *data1, size_t length1, F const *data2, size_t length2, F epsilon, size_t window,
+                      F cutoff);
+
+  // --- --- --- Row cost kernels
+  // Same results as the above, with a row cost stage (see core/elastic/row_costs.simd.hpp): the costs of a line
+  // within the window are computed together in a buffer, vectorised in double for the cfe 0.5, 1 and 2, before the
+  // recurrence runs over the line, instead of one cell at a time in the dependency chain of the recurrence.
+  // The costs of the cells pruned by the recurrence are computed too, and the costs computed in the recurrence already
+  // overlap with its dependency chain: the row cost kernels are slower than the versions above, which remain the
+  // default (see set_row_costs, and the row cost benchmarks in univariate.bench.cpp).
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  template<CFE c, typename F>
+  F adtw_rowcost(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, F penalty, F cutoff);
+
+  /// Always on the row (or band) kernels: no wavefront kernel, no autotuned choice (see autotune)
+  template<CFE c, typename F>
+  F dtw_rowcost(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, size_t window, F cutoff);
+
+  template<CFE c, typename F>
+  F wdtw_rowcost(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, F const *weights, F cutoff);
+
+  template<CFE c, typename F>
+  F erp_rowcost(F const *data1, size_t length1, F const *data2, size_t length2, F cfe, F gap_value, size_t window,
+                F cutoff);
+
+  template<CFE c, typename F>
+  F erp_rowcost(F const *data1, F const *gaps1, size_t length1, F const *data2, F const *gaps2, size_t length2,
+                F cfe, size_t window, F cutoff);
+
+  /// Select the row cost kernels in the *_for functions below (not by default): DTW, ADTW, WDTW (not the mirrored
+  /// weights) and ERP.
+  /// Must not run concurrently with the *_for functions; the functions already selected are not affected.
+  void set_row_costs(bool enabled);
+
+  /// True if the *_for functions select the row cost kernels
+  bool row_costs();
+
+  // --- --- --- Lane parallel
+  // One query against several candidates of the same length, computed together in SIMD lanes when possible.
+  // Only for double with the cfe 0.5, 1 or 2: else, the candidates are computed one after the other.
+  // The results are the ones of dtw and adtw to the last bit: lanes and one by one evaluations can be mixed (e.g. in
+  // nearest neighbour searches comparing ties exactly).
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Number of candidates computed together by dtw_lanes and adtw_lanes for the cfe (at least 1)
+  template<typename F>
+  size_t nb_lanes(F cfe);
+
+  /// DTW between a query and 'nb' candidates (nb <= nb_lanes(cfe)) of size 'length', with a per candidate cutoff.
+  /// results[k] is the DTW between candidates[k] and the query, or +INF if above cutoffs[k].
+  template<typename F>
+  void dtw_lanes(F const *query, F const *const *candidates, size_t nb, size_t length,
+                 F cfe, size_t window, F const *cutoffs, F *results);
+
+  /// ADTW version of dtw_lanes
+  template<typename F>
+  void adtw_lanes(F const *query, F const *const *candidates, size_t nb, size_t length,
+                  F cfe, F penalty, F const *cutoffs, F *results);
+
+  // --- --- --- Quantized series
+  // The first series is quantized (see quantized::QView), its 16 bits codes being decoded as they are read:
+  // same result as the distance on the dequantized series (see quantized::dequantize), reading half the data (or a
+  // quarter for double) of the first series.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// DTW between a quantized series and a series
+  template<typename F>
+  F dtw(quantized::QView<F> const& q1, F const *data2, size_t length2, F cfe, size_t window, F cutoff);
+
+  /// ADTW between a quantized series and a series
+  template<typename F>
+  F adtw(quantized::QView<F> const& q1, F const *data2, size_t length2, F cfe, F penalty, F cutoff);
+
+  // --- --- --- Derived series
+  // The second series is given raw, its first derivative being computed in the cost function as it is read (see
+  // derivative_at): same result as the distance with the derived series (see transform::univariate::derive), without
+  // storing it, trading a few operations per cell for memory.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// DTW between a series and the first derivative of 'raw2'
+  template<typename F>
+  F dtw_derived(F const *data1, size_t length1, F const *raw2, size_t length2, F cfe, size_t window, F cutoff);
+
+  /// ADTW between a series and the first derivative of 'raw2'
+  template<typename F>
+  F adtw_derived(F const *data1, size_t length1, F const *raw2, size_t length2, F cfe, F penalty, F cutoff);
+
+  /// LCSS between a series and the first derivative of 'raw2'
+  template<typename F>
+  F lcss_derived(F const *data1, size_t length1, F const *raw2, size_t length2, F epsilon, size_t window, F cutoff);
+
+  /// Pointers on the above distances. Select them once for a cfe with the *_for functions,
+  /// e.g. when creating a distance object, instead of dispatching on the cfe for every call.
+  template<typename F>
+  using ADTWFun = F (*)(F const *, size_t, F const *, size_t, F cfe, F penalty, F cutoff);
+
+  template<typename F>
+  using DTWFun = F (*)(F const *, size_t, F const *, size_t, F cfe, size_t window, F cutoff);
+
+  template<typename F>
+  using WDTWFun = F (*)(F const *, size_t, F const *, size_t, F cfe, F const *weights, F cutoff);
+
+  template<typename F>
+  using WDTWMirroredFun = F (*)(F const *, size_t, F const *, size_t, F cfe, F const *mirrored_weights, size_t center,
+                                F cutoff);
+
+  template<typename F>
+  using ERPFun = F (*)(F const *, size_t, F const *, size_t, F cfe, F gap_value, size_t window, F cutoff);
+
+  template<typename F>
+  using ERPGapsFun = F (*)(F const *, F const *, size_t, F const *, F const *, size_t, F cfe, size_t window, F cutoff);
+
+  template<typename F>
+  inline ADTWFun<F> adtw_for(F cfe) {
+    if (row_costs()) {
+      return with_cfe(cfe, [](auto c) -> ADTWFun<F> { return &adtw_rowcost<decltype(c)::value, F>; });
+    }
+    return with_cfe(cfe, [](auto c) -> ADTWFun<F> { return &adtw<decltype(c)::value, F>; });
+  }
+
+  template<typename F>
+  inline DTWFun<F> dtw_for(F cfe) {
+    if (row_costs()) {
+      return with_cfe(cfe, [](auto c) -> DTWFun<F> { return &dtw_rowcost<decltype(c)::value, F>; });
+    }
+    return with_cfe(cfe, [](auto c) -> DTWFun<F> { return &dtw<decltype(c)::value, F>; });
+  }
+
+  /// Equal length versions when 'equal_length' is set (see adtw_equal_length), else the general ones.
+  /// The row cost kernels (see set_row_costs) have no equal length versions.
+  template<typename F>
+  inline ADTWFun<F> adtw_for(F cfe, bool equal_length) {
+    if (!equal_length||row_costs()) { return adtw_for(cfe); }
+    return with_cfe(cfe, [](auto c) -> ADTWFun<F> { return &adtw_equal_length<decltype(c)::value, F>; });
+  }
+
+  template<typename F>
+  inline DTWFun<F> dtw_for(F cfe, bool equal_length) {
+    if (!equal_length||row_costs()) { return dtw_for(cfe); }
+    return with_cfe(cfe, [](auto c) -> DTWFun<F> { return &dtw_equal_length<decltype(c)::value, F>; });
+  }
+
+  template<typename F>
+  using LCSSFun = F (*)(F const *, size_t, F const *, size_t, F epsilon, size_t window, F cutoff);
+
+  template<typename F>
+  inline LCSSFun<F> lcss_for(bool equal_length) { return equal_length ? &lcss_equal_length<F> : &lcss<F>; }
+
+  template<typename F>
+  inline WDTWFun<F> wdtw_for(F cfe) {
+    if (row_costs()) {
+      return with_cfe(cfe, [](auto c) -> WDTWFun<F> { return &wdtw_rowcost<decltype(c)::value, F>; });
+    }
+    return with_cfe(cfe, [](auto c) -> WDTWFun<F> { return &wdtw<decltype(c)::value, F>; });
+  }
+
+  template<typename F>
+  inline WDTWMirroredFun<F> wdtw_mirrored_for(F cfe) {
+    return with_cfe(cfe, [](auto c) -> WDTWMirroredFun<F> { return &wdtw_mirrored<decltype(c)::value, F>; });
+  }
+
+  template<typename F>
+  inline ERPFun<F> erp_for(F cfe) {
+    if (row_costs()) {
+      return with_cfe(cfe, [](auto c) -> ERPFun<F> { return &erp_rowcost<decltype(c)::value, F>; });
+    }
+    return with_cfe(cfe, [](auto c) -> ERPFun<F> { return &erp<decltype(c)::value, F>; });
+  }
+
+  template<typename F>
+  inline ERPGapsFun<F> erp_gaps_for(F cfe) {
+    if (row_costs()) {
+      return with_cfe(cfe, [](auto c) -> ERPGapsFun<F> { return &erp_rowcost<decltype(c)::value, F>; });
+    }
+    return with_cfe(cfe, [](auto c) -> ERPGapsFun<F> { return &erp<decltype(c)::value, F>; });
+  }
+
 
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -194,6 +520,11 @@ namespace tempo::distance::univariate {
   template<typename F>
   F lb_Keogh(F const *query, size_t lquery, std::vector<F> const& upper, std::vector<F> const& lower, F cfe, F cutoff);
 
+  /// LB Keogh also filling its cumulative bound 'cb', of query_length+1 values (see core::lb_Keogh_cumulative),
+  /// for dtw_cb with the query as first series. No early abandoning.
+  template<typename F>
+  F lb_Keogh_cumulative(F const *query, size_t query_length, F const *upper, F const *lower, F cfe, F *cb);
+
   //
 
   /// LB Keogh 2 ways done 'jointly' - for same length series,
@@ -282,6 +613,61 @@ namespace tempo::distance::univariate {
     F cfe, size_t w, F cutoff
   );
 
+  //
+
+  /// LB Improved for a query and a candidate series with its envelopes (see core::lb_Improved).
+  /// Only use for same length series, with a cfe of at least 1: for a smaller cfe, LB Keogh.
+  template<typename F>
+  F lb_Improved(F const *query, size_t length, F const *candidate, F const *upper, F const *lower,
+                F cfe, size_t w, F cutoff);
+
+  /// LB Petitjean for a query and a candidate series, with their envelopes (see core::lb_Petitjean).
+  /// At least LB Improved. Only use for same length series, with a cfe of at least 1: for a smaller cfe, LB Keogh.
+  template<typename F>
+  F lb_Petitjean(F const *query, size_t length, F const *query_upper, F const *query_lower,
+                 F const *candidate, F const *upper, F const *lower,
+                 F cfe, size_t w, F cutoff);
+
+  //
+
+  /// Window of the ADTW alignments of cost at most 'cutoff' with the 'penalty' (see core::adtw_lb_window):
+  /// LB Keogh with envelopes computed at this window (or a larger one) is a lower bound of ADTW.
+  /// Same length series only, length-1 without penalty or cutoff.
+  template<typename F>
+  size_t adtw_lb_window(size_t length, F penalty, F cutoff);
+
+  /// LB Keogh for ADTW (see core::lb_adtw_Keogh), the envelopes of the candidate being computed at the window
+  /// adtw_lb_window(length, penalty, cutoff). Only use for same length series. Tunable cost function cfe.
+  template<typename F>
+  F lb_ADTW(F const *query, F const *candidate, size_t length, F cfe, F penalty, F cutoff);
+
+  //
+
+  /// LCSS lower bound for a query and a candidate represented by its envelopes for the window of the LCSS
+  /// (see core::lb_lcss): bound on the number of matches. Only use for same length series.
+  template<typename F>
+  F lb_LCSS(F const *query, size_t length, F const *upper, F const *lower, F epsilon, F cutoff);
+
+  //
+
+  /// ERP lower bound for a query and a candidate represented by its envelopes for the window of ERP
+  /// (see core::lb_erp). Only use for same length series. Tunable cost function cfe, also used with the gap value.
+  template<typename F>
+  F lb_ERP(F const *query, size_t length, F const *upper, F const *lower, F cfe, F gv, F cutoff);
+
+  /// LB_ERP of Chen and Ng (see core::lb_erp_sums), only valid for the cost function exponent 1. Any lengths.
+  template<typename F>
+  F lb_ERP_sums(F const *series1, size_t length1, F const *series2, size_t length2, F gv, F cutoff);
+
+  /// MSM lower bound from the range of the candidate (see core::lb_msm). Any lengths.
+  template<typename F>
+  F lb_MSM(F const *query, size_t length1, F const *candidate, size_t length2, F cost, F cutoff);
+
+  /// TWE lower bound (see core::lb_twe), the envelopes of the candidate being computed at the window
+  /// core::twe_lb_window(length, nu, cutoff). Only use for same length series.
+  template<typename F>
+  F lb_TWE(F const *query, F const *candidate, size_t length, F nu, F lambda, F cutoff);
+
 
 
 
@@ -340,5 +726,16 @@ namespace tempo::distance::univariate {
   template<typename F>
   F sbd(arma::Row<F> const& A, arma::Row<F> const& B);
 
+  /// Number of values of the SBD spectrum of a series of length at most 'max_length'
+  size_t sbd_spectrum_size(size_t max_length);
+
+  /// SBD spectrum of a series of length at most 'max_length', written in 'out' (sbd_spectrum_size(max_length) values)
+  template<typename F>
+  void sbd_spectrum(F const *A, size_t lA, size_t max_length, F *out);
+
+  /// SBD from the SBD spectra of two series, computed with the same maximal length, of 'size' values each
+  template<typename F>
+  F sbd_spectra(F const *SA, F const *SB, size_t size);
+
 
 } // End of namespace tempo::distance::univariate
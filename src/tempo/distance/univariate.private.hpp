@@ -2,20 +2,31 @@
 
 #include "utils.hpp"
 #include "cost_functions.hpp"
+#include "quantized.hpp"
+#include "stats.hpp"
+#include "autotune.hpp"
 // --- --- --- Elastic distances --- --- ---
 #include "core/elastic/adtw.hpp"
 #include "core/elastic/dtw.hpp"
+#include "core/elastic/dtw.simd.hpp"
+#include "core/elastic/dtw_wavefront.hpp"
+#include "core/elastic/dtw_wavefront.simd.hpp"
+#include "core/elastic/softdtw.hpp"
 #include "core/elastic/wdtw.hpp"
+#include "core/elastic/row_costs.simd.hpp"
 #include "core/elastic/erp.hpp"
 #include "core/elastic/lcss.hpp"
 #include "core/elastic/msm.hpp"
 #include "core/elastic/twe.hpp"
 // --- --- --- DTW Lower Bound --- --- ---
 #include "core/elastic/dtw_lb_keogh.hpp"
+#include "core/elastic/dtw_lb_keogh.simd.hpp"
 #include "core/elastic/dtw_lb_enhanced.hpp"
 #include "core/elastic/dtw_lb_webb.hpp"
+#include "core/elastic/dtw_lb_improved.hpp"
 // --- ------ Lock step distances --- --- ---
 #include "core/lockstep/direct.hpp"
+#include "core/lockstep/direct.simd.hpp"
 #include "core/lockstep/lockstep.univariate.hpp"
 // --- ------ Sliding distances --- --- ---
 #include "core/sliding/cross_correlation.univariate.hpp"
@@ -29,6 +40,35 @@ namespace tempo::distance::univariate {
     // Hide shorthand in local anonymous namespace to avoid polluting the file including this one
     namespace tdc = tempo::distance::core;
     namespace tdcu = tempo::distance::core::univariate;
+
+    /// Per-thread reusable buffer for the elastic distances.
+    /// The core functions 'assign' into the buffer: it only grows up to the longest series seen by the thread,
+    /// after which the computation is allocation free.
+    /// Distances needing another buffer next to the one of the core function use another 'slot'.
+    template<typename T, size_t slot = 0>
+    inline std::vector<T>& thread_buffer() {
+      thread_local std::vector<T> buffer;
+      return buffer;
+    }
+
+    /// Row cost stage (see core::RowCosts) of the cost function of kind c between the lines of dat1 and the columns
+    /// of dat2, of length len2, within the window w. Vectorised in double for the cfe 0.5, 1 and 2.
+    template<CFE c, typename F>
+    auto row_cost_stage(F const *dat1, F const *dat2, size_t len2, F cfe, size_t w) {
+      std::vector<F>& buffer = thread_buffer<F, 4>();
+      buffer.resize(len2);
+      [[maybe_unused]] const auto isa = tdc::simd::detected_isa();
+      const auto fill = [=](size_t i, size_t start, size_t stop, F *out) {
+        if constexpr (std::is_same_v<F, double>&&(c==CFE::AD1||c==CFE::AD2||c==CFE::SQRT)) {
+          constexpr auto e = (c==CFE::AD1) ? tdc::simd::CFE::AD1
+                                           : (c==CFE::AD2) ? tdc::simd::CFE::AD2 : tdc::simd::CFE::SQRT;
+          tdc::simd::row_costs<e>(isa, dat1[i], dat2, start, stop, out);
+        } else {
+          for (size_t j = start; j<stop; ++j) { out[j - start] = adc<c, F>(dat1[i], dat2[j], cfe); }
+        }
+      };
+      return tdc::RowCosts<F, decltype(fill)>(fill, buffer.data(), len2, w);
+    }
   }
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -36,6 +76,31 @@ namespace tempo::distance::univariate {
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<CFE c, typename F>
+  F adtw(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    F cfe,
+    F penalty,
+    F cutoff
+  ) {
+    const auto cfun = stats::counted(idx_adc<c, F, F const *>(cfe)(dat1, dat2));
+    return stats::call(len1, len2, cutoff, tdc::adtw<F>(len1, len2, cfun, penalty, cutoff, thread_buffer<F>()));
+  }
+
+  template<CFE c, typename F>
+  F adtw_equal_length(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    F cfe,
+    F penalty,
+    F cutoff
+  ) {
+    if (len1!=len2) { return adtw<c, F>(dat1, len1, dat2, len2, cfe, penalty, cutoff); }
+    const auto cfun = stats::counted(idx_adc<c, F, F const *>(cfe)(dat1, dat2));
+    return stats::call(len1, len2, cutoff, tdc::adtw_equal_length<F>(len1, cfun, penalty, cutoff, thread_buffer<F>()));
+  }
+
   template<typename F>
   F adtw(
     F const *dat1, size_t len1,
@@ -44,18 +109,43 @@ namespace tempo::distance::univariate {
     F penalty,
     F cutoff
   ) {
-    if (cfe==1.0) {
-      return tdc::adtw<F>(len1, len2, idx_ad1<F, F const *>(dat1, dat2), penalty, cutoff);
-    } else if (cfe==2.0) {
-      return tdc::adtw<F>(len1, len2, idx_ad2<F, F const *>(dat1, dat2), penalty, cutoff);
-    } else if (cfe==0.5) {
-      return tdc::adtw<F>(len1, len2, idx_ad_sqrt<F, F const *>(dat1, dat2), penalty, cutoff);
-    } else {
-      return tdc::adtw<F>(len1, len2, idx_ade<F, F const *>(cfe)(dat1, dat2), penalty, cutoff);
-    }
+    return with_cfe(cfe, [&](auto c) {
+      return adtw<decltype(c)::value, F>(dat1, len1, dat2, len2, cfe, penalty, cutoff);
+    });
   }
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<CFE c, typename F>
+  F dtw(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff
+  ) {
+    // Kernel tuned for this length and window, if any (see autotune). By default, long series use the wavefront
+    // kernel, vectorised along the anti-diagonals, unless the window is small enough for the band kernel of core::dtw
+    // (see BAND_MAX_WINDOW)
+    using autotune::DTWKernel;
+    const size_t len = std::min(len1, len2);
+    const DTWKernel kernel = autotune::dtw_kernel<c>(len, w);
+    if constexpr (std::is_same_v<F, double>&&(c==CFE::AD1||c==CFE::AD2||c==CFE::SQRT)) {
+      const bool wavefront = kernel==DTWKernel::WAVEFRONT
+        ||(kernel==DTWKernel::DEFAULT&&len>=tdc::simd::WAVEFRONT_MIN_LENGTH&&w>tdc::BAND_MAX_WINDOW);
+      if (wavefront&&tdc::simd::detected_isa()!=tdc::simd::ISA::SCALAR) {
+        constexpr auto e = (c==CFE::AD1) ? tdc::simd::CFE::AD1
+                                         : (c==CFE::AD2) ? tdc::simd::CFE::AD2 : tdc::simd::CFE::SQRT;
+        return stats::call(len1, len2, cutoff,
+                           tdc::simd::dtw_wavefront(dat1, len1, dat2, len2, e, w, cutoff, thread_buffer<F>()));
+      }
+    }
+    const auto cfun = stats::counted(idx_adc<c, F, F const *>(cfe)(dat1, dat2));
+    if (kernel==DTWKernel::ROW) {
+      return stats::call(len1, len2, cutoff, tdc::dtw<F, false>(len1, len2, cfun, w, cutoff, thread_buffer<F>()));
+    }
+    return stats::call(len1, len2, cutoff, tdc::dtw<F>(len1, len2, cfun, w, cutoff, thread_buffer<F>()));
+  }
+
   template<typename F>
   F dtw(
     F const *const dat1, size_t len1,
@@ -64,33 +154,262 @@ namespace tempo::distance::univariate {
     size_t w,
     F cutoff
   ) {
-    if (cfe==1.0) {
-      return tdc::dtw<F>(len1, len2, idx_ad1<F, F const *>(dat1, dat2), w, cutoff);
-    } else if (cfe==2.0) {
-      return tdc::dtw<F>(len1, len2, idx_ad2<F, F const *>(dat1, dat2), w, cutoff);
-    } else if (cfe==0.5) {
-      return tdc::dtw<F>(len1, len2, idx_ad_sqrt<F, F const *>(dat1, dat2), w, cutoff);
-    } else {
-      return tdc::dtw<F>(len1, len2, idx_ade<F, F const *>(cfe)(dat1, dat2), w, cutoff);
+    return with_cfe(cfe, [&](auto c) {
+      return dtw<decltype(c)::value, F>(dat1, len1, dat2, len2, cfe, w, cutoff);
+    });
+  }
+
+  template<CFE c, typename F>
+  F dtw_cb(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff,
+    F const *cb
+  ) {
+    // The wavefront kernel goes by anti-diagonals: no use of the bound of the lines
+    using autotune::DTWKernel;
+    const size_t len = std::min(len1, len2);
+    const DTWKernel kernel = autotune::dtw_kernel<c>(len, w);
+    if constexpr (std::is_same_v<F, double>&&(c==CFE::AD1||c==CFE::AD2||c==CFE::SQRT)) {
+      const bool wavefront = kernel==DTWKernel::WAVEFRONT
+        ||(kernel==DTWKernel::DEFAULT&&len>=tdc::simd::WAVEFRONT_MIN_LENGTH&&w>tdc::BAND_MAX_WINDOW);
+      if (wavefront&&tdc::simd::detected_isa()!=tdc::simd::ISA::SCALAR) {
+        return dtw<c, F>(dat1, len1, dat2, len2, cfe, w, cutoff);
+      }
+    }
+    const auto cfun = stats::counted(idx_adc<c, F, F const *>(cfe)(dat1, dat2));
+    if (kernel==DTWKernel::ROW) {
+      return stats::call(len1, len2, cutoff, tdc::dtw<F, false>(len1, len2, cfun, w, cutoff, thread_buffer<F>(), cb));
+    }
+    return stats::call(len1, len2, cutoff, tdc::dtw<F>(len1, len2, cfun, w, cutoff, thread_buffer<F>(), cb));
+  }
+
+  template<typename F>
+  F dtw_cb(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff,
+    F const *cb
+  ) {
+    return with_cfe(cfe, [&](auto c) {
+      return dtw_cb<decltype(c)::value, F>(dat1, len1, dat2, len2, cfe, w, cutoff, cb);
+    });
+  }
+
+  template<CFE c, typename F>
+  F dtw_equal_length(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff
+  ) {
+    if (len1!=len2) { return dtw<c, F>(dat1, len1, dat2, len2, cfe, w, cutoff); }
+    // The wavefront kernel (by default, for the long series) is in dtw
+    using autotune::DTWKernel;
+    const DTWKernel kernel = autotune::dtw_kernel<c>(len1, w);
+    if (kernel==DTWKernel::WAVEFRONT||(kernel==DTWKernel::DEFAULT&&len1>=tdc::simd::WAVEFRONT_MIN_LENGTH)) {
+      return dtw<c, F>(dat1, len1, dat2, len2, cfe, w, cutoff);
+    }
+    const auto cfun = stats::counted(idx_adc<c, F, F const *>(cfe)(dat1, dat2));
+    // The ROW kernel skips the band kernel of the small windows
+    const bool band = kernel!=DTWKernel::ROW;
+    // Short series: stack buffer of the smallest length bucket holding them
+    const auto fixed = [&]<size_t N>() {
+      return stats::call(len1, len2, cutoff, band ? tdc::dtw_fixed_length<F, N>(len1, cfun, w, cutoff)
+                                                  : tdc::dtw_fixed_length<F, N, false>(len1, cfun, w, cutoff));
+    };
+    if (len1<=64) { return fixed.template operator()<64>(); }
+    if (len1<=128) { return fixed.template operator()<128>(); }
+    if (len1<=256) { return fixed.template operator()<256>(); }
+    if (len1<=512) { return fixed.template operator()<512>(); }
+    if (!band) {
+      return stats::call(len1, len2, cutoff,
+                         tdc::dtw_equal_length<F, false>(len1, cfun, w, cutoff, thread_buffer<F>()));
+    }
+    return stats::call(len1, len2, cutoff, tdc::dtw_equal_length<F>(len1, cfun, w, cutoff, thread_buffer<F>()));
+  }
+
+  template<typename F>
+  F dtw_wr(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff,
+    size_t& max_deviation
+  ) {
+    return with_cfe(cfe, [&](auto c) {
+      const auto cfun = stats::counted(idx_adc<decltype(c)::value, F, F const *>(cfe)(dat1, dat2));
+      const auto wr = tdc::WR::dtw<F>(len1, len2, cfun, w, cutoff, thread_buffer<F>(), thread_buffer<size_t>());
+      max_deviation = wr.max_deviation;
+      return stats::call(len1, len2, cutoff, wr.cost);
+    });
+  }
+
+  template<typename F>
+  F dtw_wavefront(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff,
+    size_t nb_threads
+  ) {
+    if constexpr (std::is_same_v<F, double>) {
+      if (tdc::simd::CFE e; tdc::simd::to_cfe(cfe, e)) {
+        return stats::call(len1, len2, cutoff, tdc::simd::dtw_wavefront(dat1, len1, dat2, len2, e, w, cutoff,
+                                                                        thread_buffer<F>(), nb_threads));
+      }
     }
+    // Cells counted by the wavefront driver (see core::internal::wavefront)
+    return with_cfe(cfe, [&](auto c) {
+      const auto cfun = idx_adc<decltype(c)::value, F, F const *>(cfe)(dat1, dat2);
+      return stats::call(len1, len2, cutoff,
+                         tdc::dtw_wavefront<F>(len1, len2, cfun, w, cutoff, thread_buffer<F>(), nb_threads));
+    });
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<CFE c, typename F>
+  F dtw_rowcost(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff
+  ) {
+    auto costs = row_cost_stage<c, F>(dat1, dat2, len2, cfe, w);
+    const auto cfun = stats::counted(costs.cfun());
+    return stats::call(len1, len2, cutoff, tdc::dtw<F>(len1, len2, cfun, w, cutoff, thread_buffer<F>()));
+  }
+
+  template<CFE c, typename F>
+  F adtw_rowcost(
+    F const *dat1, size_t len1,
+    F const *dat2, size_t len2,
+    F cfe,
+    F penalty,
+    F cutoff
+  ) {
+    auto costs = row_cost_stage<c, F>(dat1, dat2, len2, cfe, utils::NO_WINDOW);
+    const auto cfun = stats::counted(costs.cfun());
+    return stats::call(len1, len2, cutoff, tdc::adtw<F>(len1, len2, cfun, penalty, cutoff, thread_buffer<F>()));
   }
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   template<typename F>
+  F softdtw(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    F gamma,
+    size_t w
+  ) {
+    return with_cfe(cfe, [&](auto c) {
+      const auto cfun = idx_adc<decltype(c)::value, F, F const *>(cfe)(dat1, dat2);
+      return stats::call(len1, len2, utils::PINF<F>, tdc::softdtw<F>(len1, len2, cfun, gamma, w, thread_buffer<F>()));
+    });
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<CFE c, typename F>
   F wdtw(F const *dat1, size_t len1,
          F const *dat2, size_t len2,
          F cfe,
          F const *weights,
          F cutoff
   ) {
-    if (cfe==1.0) {
-      return tdc::wdtw<F>(len1, len2, idx_ad1<F, F const *>(dat1, dat2), weights, cutoff);
-    } else if (cfe==2.0) {
-      return tdc::wdtw<F>(len1, len2, idx_ad2<F, F const *>(dat1, dat2), weights, cutoff);
-    } else if (cfe==0.5) {
-      return tdc::wdtw<F>(len1, len2, idx_ad_sqrt<F, F const *>(dat1, dat2), weights, cutoff);
-    } else {
-      return tdc::wdtw<F>(len1, len2, idx_ade<F, F const *>(cfe)(dat1, dat2), weights, cutoff);
+    const auto cfun = stats::counted(idx_adc<c, F, F const *>(cfe)(dat1, dat2));
+    return stats::call(len1, len2, cutoff, tdc::wdtw<F>(len1, len2, cfun, weights, cutoff, thread_buffer<F>()));
+  }
+
+  template<typename F>
+  F wdtw(F const *dat1, size_t len1,
+         F const *dat2, size_t len2,
+         F cfe,
+         F const *weights,
+         F cutoff
+  ) {
+    return with_cfe(cfe, [&](auto c) {
+      return wdtw<decltype(c)::value, F>(dat1, len1, dat2, len2, cfe, weights, cutoff);
+    });
+  }
+
+  template<CFE c, typename F>
+  F wdtw_rowcost(F const *dat1, size_t len1,
+                 F const *dat2, size_t len2,
+                 F cfe,
+                 F const *weights,
+                 F cutoff
+  ) {
+    auto costs = row_cost_stage<c, F>(dat1, dat2, len2, cfe, utils::NO_WINDOW);
+    const auto cfun = stats::counted(costs.cfun());
+    return stats::call(len1, len2, cutoff, tdc::wdtw<F>(len1, len2, cfun, weights, cutoff, thread_buffer<F>()));
+  }
+
+  template<CFE c, typename F>
+  F wdtw_mirrored(F const *dat1, size_t len1,
+                  F const *dat2, size_t len2,
+                  F cfe,
+                  F const *mirrored, size_t center,
+                  F cutoff
+  ) {
+    const auto cfun = stats::counted(idx_adc<c, F, F const *>(cfe)(dat1, dat2));
+    return stats::call(len1, len2, cutoff,
+                       tdc::wdtw_mirrored<F>(len1, len2, cfun, mirrored, center, cutoff, thread_buffer<F>()));
+  }
+
+  template<typename F>
+  F wdtw_mirrored(F const *dat1, size_t len1,
+                  F const *dat2, size_t len2,
+                  F cfe,
+                  F const *mirrored, size_t center,
+                  F cutoff
+  ) {
+    return with_cfe(cfe, [&](auto c) {
+      return wdtw_mirrored<decltype(c)::value, F>(dat1, len1, dat2, len2, cfe, mirrored, center, cutoff);
+    });
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<typename F>
+  size_t nb_lanes(F cfe) {
+    if constexpr (std::is_same_v<F, double>) {
+      if (tdc::simd::CFE e; tdc::simd::to_cfe(cfe, e)) { return tdc::simd::nb_lanes(); }
+    }
+    return 1;
+  }
+
+  template<typename F>
+  void dtw_lanes(F const *query, F const *const *candidates, size_t nb, size_t length,
+                 F cfe, size_t w, F const *cutoffs, F *results) {
+    if constexpr (std::is_same_v<F, double>) {
+      if (tdc::simd::CFE e; tdc::simd::to_cfe(cfe, e)) {
+        tdc::simd::dtw_lanes(query, candidates, nb, length, e, w, cutoffs, results, thread_buffer<F>());
+        for (size_t k = 0; k<nb; ++k) { stats::call(length, length, cutoffs[k], results[k]); }
+        return;
+      }
+    }
+    for (size_t k = 0; k<nb; ++k) { results[k] = dtw<F>(candidates[k], length, query, length, cfe, w, cutoffs[k]); }
+  }
+
+  template<typename F>
+  void adtw_lanes(F const *query, F const *const *candidates, size_t nb, size_t length,
+                  F cfe, F penalty, F const *cutoffs, F *results) {
+    if constexpr (std::is_same_v<F, double>) {
+      if (tdc::simd::CFE e; tdc::simd::to_cfe(cfe, e)) {
+        tdc::simd::adtw_lanes(query, candidates, nb, length, e, penalty, cutoffs, results, thread_buffer<F>());
+        for (size_t k = 0; k<nb; ++k) { stats::call(length, length, cutoffs[k], results[k]); }
+        return;
+      }
+    }
+    for (size_t k = 0; k<nb; ++k) {
+      results[k] = adtw<F>(candidates[k], length, query, length, cfe, penalty, cutoffs[k]);
     }
   }
 
@@ -112,8 +431,88 @@ namespace tempo::distance::univariate {
     return weights;
   }
 
+  template<typename F>
+  std::vector<F> wdtw_mirror_weights(F const *weights, size_t length) {
+    std::vector<F> mirrored(length==0 ? 0 : 2*length - 1);
+    tdc::wdtw_mirror_weights(weights, length, mirrored.data());
+    return mirrored;
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   template<typename F>
+  F dtw(quantized::QView<F> const& q1, F const *const dat2, size_t len2, F cfe, size_t w, F cutoff) {
+    return quantized::with_format(q1.format, [&](auto q) {
+      const quantized::QValues<decltype(q)::value, F> dat1(q1);
+      return with_cfe(cfe, [&](auto c) {
+        const auto cfun = stats::counted([&](size_t i, size_t j) {
+          return adc<decltype(c)::value, F>(dat1[i], dat2[j], cfe);
+        });
+        return stats::call(q1.length, len2, cutoff, tdc::dtw<F>(q1.length, len2, cfun, w, cutoff, thread_buffer<F>()));
+      });
+    });
+  }
+
+  template<typename F>
+  F adtw(quantized::QView<F> const& q1, F const *const dat2, size_t len2, F cfe, F penalty, F cutoff) {
+    return quantized::with_format(q1.format, [&](auto q) {
+      const quantized::QValues<decltype(q)::value, F> dat1(q1);
+      return with_cfe(cfe, [&](auto c) {
+        const auto cfun = stats::counted([&](size_t i, size_t j) {
+          return adc<decltype(c)::value, F>(dat1[i], dat2[j], cfe);
+        });
+        return stats::call(q1.length, len2, cutoff,
+                           tdc::adtw<F>(q1.length, len2, cfun, penalty, cutoff, thread_buffer<F>()));
+      });
+    });
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<typename F>
+  F dtw_derived(F const *const dat1, size_t len1, F const *const raw2, size_t len2, F cfe, size_t w, F cutoff) {
+    const DerivedValues<F> dat2{raw2, len2};
+    return with_cfe(cfe, [&](auto c) {
+      const auto cfun = stats::counted([&](size_t i, size_t j) {
+        return adc<decltype(c)::value, F>(dat1[i], dat2[j], cfe);
+      });
+      return stats::call(len1, len2, cutoff, tdc::dtw<F>(len1, len2, cfun, w, cutoff, thread_buffer<F>()));
+    });
+  }
+
+  template<typename F>
+  F adtw_derived(F const *const dat1, size_t len1, F const *const raw2, size_t len2, F cfe, F penalty, F cutoff) {
+    const DerivedValues<F> dat2{raw2, len2};
+    return with_cfe(cfe, [&](auto c) {
+      const auto cfun = stats::counted([&](size_t i, size_t j) {
+        return adc<decltype(c)::value, F>(dat1[i], dat2[j], cfe);
+      });
+      return stats::call(len1, len2, cutoff, tdc::adtw<F>(len1, len2, cfun, penalty, cutoff, thread_buffer<F>()));
+    });
+  }
+
+  template<typename F>
+  F lcss_derived(F const *const dat1, size_t len1, F const *const raw2, size_t len2, F e, size_t w, F cutoff) {
+    const DerivedValues<F> dat2{raw2, len2};
+    const auto cfun = stats::counted([&](size_t i, size_t j) { return ad1<F>(dat1[i], dat2[j])<e; });
+    return stats::call(len1, len2, cutoff,
+                       tdc::lcss_bitparallel<F>(len1, len2, cfun, w, cutoff, thread_buffer<uint64_t>()));
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<CFE c, typename F>
+  F erp(
+    F const *const dat1, F const *const gaps1, size_t len1,
+    F const *const dat2, F const *const gaps2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff
+  ) {
+    const auto gvf1 = [gaps1](size_t i) { return gaps1[i]; };
+    const auto gvf2 = [gaps2](size_t j) { return gaps2[j]; };
+    const auto cfun = stats::counted(idx_adc<c, F, F const *>(cfe)(dat1, dat2));
+    return stats::call(len1, len2, cutoff, tdc::erp<F>(len1, len2, gvf1, gvf2, cfun, w, cutoff, thread_buffer<F>()));
+  }
+
+  template<CFE c, typename F>
   F erp(
     F const *const dat1, size_t len1,
     F const *const dat2, size_t len2,
@@ -122,19 +521,79 @@ namespace tempo::distance::univariate {
     size_t w,
     F cutoff
   ) {
-    if (cfe==1.0) {
-      constexpr auto gvf = tdcu::idx_gvad1<F, F const *>;
-      return tdc::erp<F>(len1, len2, gvf(dat1, gv), gvf(dat2, gv), idx_ad1<F, F const *>(dat1, dat2), w, cutoff);
-    } else if (cfe==2.0) {
-      constexpr auto gvf = tdcu::idx_gvad2<F, F const *>;
-      return tdc::erp<F>(len1, len2, gvf(dat1, gv), gvf(dat2, gv), idx_ad2<F, F const *>(dat1, dat2), w, cutoff);
-    } else if (cfe==0.5) {
-      constexpr auto gvf = tdcu::idx_gvad_sqrt<F, F const *>;
-      return tdc::erp<F>(len1, len2, gvf(dat1, gv), gvf(dat2, gv), idx_ad_sqrt<F, F const *>(dat1, dat2), w, cutoff);
-    } else {
-      auto gve = tdcu::idx_gvade<F, F const *>(cfe);
-      return tdc::erp<F>(len1, len2, gve(dat1, gv), gve(dat2, gv), idx_ade<F, F const *>(cfe)(dat1, dat2), w, cutoff);
-    }
+    // Gap value cost functions: cost between a point and the gap value.
+    // Computed once per point before the recurrence, which reads them for every cell of its lines and columns.
+    std::vector<F>& gaps = thread_buffer<F, 1>();
+    gaps.resize(len1 + len2);
+    for (size_t i{0}; i<len1; ++i) { gaps[i] = adc<c, F>(dat1[i], gv, cfe); }
+    for (size_t j{0}; j<len2; ++j) { gaps[len1 + j] = adc<c, F>(dat2[j], gv, cfe); }
+    return erp<c, F>(dat1, gaps.data(), len1, dat2, gaps.data() + len1, len2, cfe, w, cutoff);
+  }
+
+  template<CFE c, typename F>
+  F erp_rowcost(
+    F const *const dat1, F const *const gaps1, size_t len1,
+    F const *const dat2, F const *const gaps2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff
+  ) {
+    const auto gvf1 = [gaps1](size_t i) { return gaps1[i]; };
+    const auto gvf2 = [gaps2](size_t j) { return gaps2[j]; };
+    auto costs = row_cost_stage<c, F>(dat1, dat2, len2, cfe, w);
+    const auto cfun = stats::counted(costs.cfun());
+    return stats::call(len1, len2, cutoff, tdc::erp<F>(len1, len2, gvf1, gvf2, cfun, w, cutoff, thread_buffer<F>()));
+  }
+
+  template<CFE c, typename F>
+  F erp_rowcost(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    F gv,
+    size_t w,
+    F cutoff
+  ) {
+    // Gap value costs as in erp
+    std::vector<F>& gaps = thread_buffer<F, 1>();
+    gaps.resize(len1 + len2);
+    for (size_t i{0}; i<len1; ++i) { gaps[i] = adc<c, F>(dat1[i], gv, cfe); }
+    for (size_t j{0}; j<len2; ++j) { gaps[len1 + j] = adc<c, F>(dat2[j], gv, cfe); }
+    return erp_rowcost<c, F>(dat1, gaps.data(), len1, dat2, gaps.data() + len1, len2, cfe, w, cutoff);
+  }
+
+  template<typename F>
+  F erp(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F cfe,
+    F gv,
+    size_t w,
+    F cutoff
+  ) {
+    return with_cfe(cfe, [&](auto c) {
+      return erp<decltype(c)::value, F>(dat1, len1, dat2, len2, cfe, gv, w, cutoff);
+    });
+  }
+
+  template<typename F>
+  void erp_gap_costs(F const *series, size_t length, F cfe, F gap_value, F *gaps) {
+    with_cfe(cfe, [&](auto c) {
+      for (size_t i{0}; i<length; ++i) { gaps[i] = adc<decltype(c)::value, F>(series[i], gap_value, cfe); }
+    });
+  }
+
+  template<typename F>
+  F erp(
+    F const *const dat1, F const *const gaps1, size_t len1,
+    F const *const dat2, F const *const gaps2, size_t len2,
+    F cfe,
+    size_t w,
+    F cutoff
+  ) {
+    return with_cfe(cfe, [&](auto c) {
+      return erp<decltype(c)::value, F>(dat1, gaps1, len1, dat2, gaps2, len2, cfe, w, cutoff);
+    });
   }
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -146,7 +605,23 @@ namespace tempo::distance::univariate {
     size_t w,
     F cutoff
   ) {
-    return tdc::lcss<F>(len1, len2, tdcu::idx_simdiff<F, F const *>(e)(dat1, dat2), w, cutoff);
+    const auto cfun = stats::counted(tdcu::idx_simdiff<F, F const *>(e)(dat1, dat2));
+    return stats::call(len1, len2, cutoff,
+                       tdc::lcss_bitparallel<F>(len1, len2, cfun, w, cutoff, thread_buffer<uint64_t>()));
+  }
+
+  template<typename F>
+  F lcss_equal_length(
+    F const *const dat1, size_t len1,
+    F const *const dat2, size_t len2,
+    F e,
+    size_t w,
+    F cutoff
+  ) {
+    if (len1!=len2) { return lcss<F>(dat1, len1, dat2, len2, e, w, cutoff); }
+    const auto cfun = stats::counted(tdcu::idx_simdiff<F, F const *>(e)(dat1, dat2));
+    return stats::call(len1, len2, cutoff,
+                       tdc::lcss_bitparallel<F, true>(len1, len2, cfun, w, cutoff, thread_buffer<uint64_t>()));
   }
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -159,8 +634,11 @@ namespace tempo::distance::univariate {
     constexpr auto cfli = tdcu::idx_msm_lines<F, F const *>;
     constexpr auto cfco = tdcu::idx_msm_cols<F, F const *>;
     constexpr auto cfdi = tdcu::idx_msm_diag<F, F const *>;
-    return tdc::msm<F>(length1, length2, cfli(data1, data2, cost), cfco(data1, data2, cost), cfdi(data1, data2), cutoff
-    );
+    // One diagonal cost per cell: count the cells with it
+    const auto cfun = stats::counted(cfdi(data1, data2));
+    return stats::call(length1, length2, cutoff, tdc::msm<F>(
+      length1, length2, cfli(data1, data2, cost), cfco(data1, data2, cost), cfun, cutoff, thread_buffer<F>()
+    ));
   }
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -173,9 +651,48 @@ namespace tempo::distance::univariate {
   ) {
     constexpr auto cfwarp = tdcu::idx_twe_warp<F, F const *>;
     constexpr auto cfmatch = tdcu::idx_twe_match<F, F const *>;
-    return tdc::twe<F>(
-      length1, length2, cfwarp(data1, nu, lambda), cfwarp(data2, nu, lambda), cfmatch(data1, data2, nu), cutoff
-    );
+    // One match cost per cell: count the cells with it
+    const auto cfun = stats::counted(cfmatch(data1, data2, nu));
+    return stats::call(length1, length2, cutoff, tdc::twe<F>(
+      length1, length2, cfwarp(data1, nu, lambda), cfwarp(data2, nu, lambda), cfun, cutoff, thread_buffer<F>()
+    ));
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  template<typename F>
+  void first_differences(F const *series, size_t length, F *diff) {
+    tempo::distance::utils::first_differences(series, length, diff);
+  }
+
+  template<typename F>
+  F msm(F const *data1, F const *diff1, size_t length1,
+        F const *data2, F const *diff2, size_t length2,
+        F cost,
+        F cutoff
+  ) {
+    constexpr auto cfli = tdcu::idx_msm_lines_diff<F, F const *>;
+    constexpr auto cfco = tdcu::idx_msm_cols_diff<F, F const *>;
+    constexpr auto cfdi = tdcu::idx_msm_diag<F, F const *>;
+    const auto cfun = stats::counted(cfdi(data1, data2));
+    return stats::call(length1, length2, cutoff, tdc::msm<F>(
+      length1, length2, cfli(data1, diff1, data2, cost), cfco(data1, data2, diff2, cost), cfun, cutoff,
+      thread_buffer<F>()
+    ));
+  }
+
+  template<typename F>
+  F twe(F const *data1, F const *diff1, size_t length1,
+        F const *data2, F const *diff2, size_t length2,
+        F nu,
+        F lambda,
+        F cutoff
+  ) {
+    constexpr auto cfwarp = tdcu::idx_twe_warp_diff<F, F const *>;
+    constexpr auto cfmatch = tdcu::idx_twe_match<F, F const *>;
+    const auto cfun = stats::counted(cfmatch(data1, data2, nu));
+    return stats::call(length1, length2, cutoff, tdc::twe<F>(
+      length1, length2, cfwarp(diff1, nu, lambda), cfwarp(diff2, nu, lambda), cfun, cutoff, thread_buffer<F>()
+    ));
   }
 
 
@@ -240,6 +757,12 @@ namespace tempo::distance::univariate {
 
   template<typename F>
   F lb_Keogh(F const *query, size_t query_length, F const *upper, F const *lower, F cfe, F cutoff) {
+    // Vectorized kernels with runtime dispatch for specialised cost functions
+    if constexpr (std::is_same_v<F, double>) {
+      if (tdc::simd::CFE e; tdc::simd::to_cfe(cfe, e)) {
+        return tdc::simd::lb_Keogh(query, query_length, upper, lower, e, cutoff);
+      }
+    }
     if (cfe==1.0) {
       constexpr utils::CFun<F> auto cf = ad1<F>;
       return tdcu::lb_Keogh(query, query_length, upper, lower, cf, cutoff);
@@ -260,6 +783,23 @@ namespace tempo::distance::univariate {
     return lb_Keogh(query, lquery, upper.data(), lower.data(), cfe, cutoff);
   }
 
+  template<typename F>
+  F lb_Keogh_cumulative(F const *query, size_t query_length, F const *upper, F const *lower, F cfe, F *cb) {
+    if (cfe==1.0) {
+      constexpr utils::CFun<F> auto cf = ad1<F>;
+      return tdcu::lb_Keogh_cumulative(query, query_length, upper, lower, cf, cb);
+    } else if (cfe==2.0) {
+      constexpr utils::CFun<F> auto cf = ad2<F>;
+      return tdcu::lb_Keogh_cumulative(query, query_length, upper, lower, cf, cb);
+    } else if (cfe==0.5) {
+      constexpr utils::CFun<F> auto cf = ad_sqrt<F>;
+      return tdcu::lb_Keogh_cumulative(query, query_length, upper, lower, cf, cb);
+    } else {
+      utils::CFun<F> auto cf = ade<F>(cfe);
+      return tdcu::lb_Keogh_cumulative(query, query_length, upper, lower, cf, cb);
+    }
+  }
+
   //
 
   template<typename F>
@@ -425,6 +965,103 @@ namespace tempo::distance::univariate {
     );
   }
 
+  //
+
+  template<typename F>
+  F lb_Improved(F const *query, size_t length, F const *candidate, F const *upper, F const *lower,
+                F cfe, size_t w, F cutoff) {
+    // Not a lower bound for the cost functions below 1 (not superadditive)
+    if (cfe<1) { return lb_Keogh(query, length, upper, lower, cfe, cutoff); }
+    auto& buffer = thread_buffer<F, 1>();
+    buffer.resize(3*length);
+    if (cfe==1.0) {
+      constexpr utils::CFun<F> auto cf = ad1<F>;
+      return tdcu::lb_Improved(query, length, candidate, upper, lower, cf, w, cutoff, buffer.data());
+    } else if (cfe==2.0) {
+      constexpr utils::CFun<F> auto cf = ad2<F>;
+      return tdcu::lb_Improved(query, length, candidate, upper, lower, cf, w, cutoff, buffer.data());
+    } else {
+      utils::CFun<F> auto cf = ade<F>(cfe);
+      return tdcu::lb_Improved(query, length, candidate, upper, lower, cf, w, cutoff, buffer.data());
+    }
+  }
+
+  template<typename F>
+  F lb_Petitjean(F const *query, size_t length, F const *query_upper, F const *query_lower,
+                 F const *candidate, F const *upper, F const *lower,
+                 F cfe, size_t w, F cutoff) {
+    // Not a lower bound for the cost functions below 1 (not superadditive)
+    if (cfe<1) { return lb_Keogh(query, length, upper, lower, cfe, cutoff); }
+    auto& buffer = thread_buffer<F, 1>();
+    buffer.resize(3*length);
+    if (cfe==1.0) {
+      constexpr utils::CFun<F> auto cf = ad1<F>;
+      return tdcu::lb_Petitjean(query, length, query_upper, query_lower, candidate, upper, lower, cf, w, cutoff,
+                                buffer.data());
+    } else if (cfe==2.0) {
+      constexpr utils::CFun<F> auto cf = ad2<F>;
+      return tdcu::lb_Petitjean(query, length, query_upper, query_lower, candidate, upper, lower, cf, w, cutoff,
+                                buffer.data());
+    } else {
+      utils::CFun<F> auto cf = ade<F>(cfe);
+      return tdcu::lb_Petitjean(query, length, query_upper, query_lower, candidate, upper, lower, cf, w, cutoff,
+                                buffer.data());
+    }
+  }
+
+  //
+
+  template<typename F>
+  size_t adtw_lb_window(size_t length, F penalty, F cutoff) { return tdc::adtw_lb_window(length, penalty, cutoff); }
+
+  template<typename F>
+  F lb_ADTW(F const *query, F const *candidate, size_t length, F cfe, F penalty, F cutoff) {
+    if (length==0) { return 0; }
+    if (std::isnan(cutoff)) { cutoff = utils::PINF<F>; }
+    auto& upper = thread_buffer<F, 2>();
+    auto& lower = thread_buffer<F, 3>();
+    get_keogh_envelopes(candidate, length, upper, lower, tdc::adtw_lb_window(length, penalty, cutoff));
+    return lb_Keogh(query, length, upper, lower, cfe, cutoff);
+  }
+
+  //
+
+  template<typename F>
+  F lb_LCSS(F const *query, size_t length, F const *upper, F const *lower, F epsilon, F cutoff) {
+    return tdc::lb_lcss(query, length, upper, lower, epsilon, cutoff);
+  }
+
+  //
+
+  template<typename F>
+  F lb_ERP(F const *query, size_t length, F const *upper, F const *lower, F cfe, F gv, F cutoff) {
+    return with_cfe(cfe, [&](auto c) {
+      const auto cfun = [cfe](F a, F b) { return adc<decltype(c)::value, F>(a, b, cfe); };
+      return tdc::lb_erp(query, length, upper, lower, cfun, gv, cutoff);
+    });
+  }
+
+  template<typename F>
+  F lb_ERP_sums(F const *series1, size_t length1, F const *series2, size_t length2, F gv, F cutoff) {
+    return tdc::lb_erp_sums(series1, length1, series2, length2, gv, cutoff);
+  }
+
+  template<typename F>
+  F lb_MSM(F const *query, size_t length1, F const *candidate, size_t length2, F cost, F cutoff) {
+    return tdc::lb_msm(query, length1, candidate, length2, cost, cutoff);
+  }
+
+  template<typename F>
+  F lb_TWE(F const *query, F const *candidate, size_t length, F nu, F lambda, F cutoff) {
+    if (length==0) { return 0; }
+    if (std::isnan(cutoff)) { cutoff = utils::PINF<F>; }
+    const size_t w = tdc::twe_lb_window(length, nu, cutoff);
+    auto& upper = thread_buffer<F, 2>();
+    auto& lower = thread_buffer<F, 3>();
+    get_keogh_envelopes(candidate, length, upper, lower, w);
+    return tdc::lb_twe(query, length, upper.data(), lower.data(), w, nu, lambda, cutoff);
+  }
+
 
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
@@ -434,6 +1071,12 @@ namespace tempo::distance::univariate {
   /// Direct alignment with cost function cfe, and early abandoning cutoff.
   template<typename F>
   F directa(F const *dat1, size_t len1, F const *dat2, size_t len2, F cfe, F cutoff) {
+    // Vectorized kernels with runtime dispatch for specialised cost functions
+    if constexpr (std::is_same_v<F, double>) {
+      if (tdc::simd::CFE e; tdc::simd::to_cfe(cfe, e)) {
+        return tdc::simd::directa(dat1, len1, dat2, len2, e, cutoff);
+      }
+    }
     if (cfe==1.0) {
       return tdc::directa<F>(len1, len2, idx_ad1<F, F const *>(dat1, dat2), cutoff);
     } else if (cfe==2.0) {
@@ -498,5 +1141,17 @@ namespace tempo::distance::univariate {
     return tdcu::sbd(A, lA, B, lB);
   }
 
+  template<typename F>
+  void sbd_spectrum(F const *A, size_t lA, size_t max_length, F *out) {
+    const arma::Row<F> ra(const_cast<F *>(A), lA, false, true);
+    tdcu::sbd_spectrum<F>(ra, max_length, out);
+  }
+
+  // Pointwise products and one inverse FFT: the FFT of the series are in their spectra
+  template<typename F>
+  F sbd_spectra(F const *SA, F const *SB, size_t size) {
+    return tdcu::sbd_spectra(SA, SB, size);
+  }
+
 
 } // End of namespace tempo::distance::univariate
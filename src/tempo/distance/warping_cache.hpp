@@ -0,0 +1,120 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <optional>
+
+namespace tempo::distance {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Window validity cache
+  // A DTW computed at the window W, with the cost c and the max deviation md of its warping path from the diagonal
+  // (see univariate::dtw_wr), tells us about the DTW at other windows w:
+  //  - if md <= w <= W, the DTW is c: the warping path is within w, and no better path exists within W.
+  //  - if w <= W, the DTW is at least c: any cutoff below c leads to +INF.
+  // In the same way, a DTW early abandoned at W with the cutoff C is also early abandoned for w <= W and cutoffs <= C.
+  // Windows above the length of the series are all equivalent: a DTW without window is valid for all w >= md.
+  // Only the other cases (w > W, or md > w) require a new computation.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Cache of windowed DTW results, one per pair of series identified by a 'Key', answering the DTW computations
+   *  at other windows when possible (see above). Thread safe.
+   *  The DTW must not depend on anything else than the key, the window and the cutoff (e.g. one cache per cost
+   *  function exponent).
+   */
+  template<typename F, typename Key>
+  class WarpingCache {
+
+    struct Entry {
+      F cost;               // +INF if early abandoned
+      size_t max_deviation; // Meaningless if early abandoned
+      size_t window;
+      F cutoff;             // Cutoff of the computation, +INF if none
+    };
+
+    std::mutex mtx;
+    std::map<Key, Entry> entries;
+    size_t nb_hits{0};
+    size_t nb_misses{0};
+
+    /// Cutoff as used by 'dtw': +INF or NaN do not abandon.
+    static F effective_cutoff(F cutoff) { return std::isnan(cutoff) ? utils::PINF<F> : cutoff; }
+
+  public:
+
+    /** Result at 'window' with 'cutoff' if the cache can answer it, i.e. the value 'dtw' would return:
+     *  the DTW if below or equal to the cutoff, else +INF.
+     * @param length  Length of the longest series of the pair, capping the window
+     */
+    std::optional<F> find(Key const& key, size_t length, size_t window, F cutoff) {
+      window = std::min(window, length);
+      cutoff = effective_cutoff(cutoff);
+      std::lock_guard lock(mtx);
+      auto it = entries.find(key);
+      if (it!=entries.end()) {
+        const Entry& e = it->second;
+        if (std::isinf(e.cost)) {
+          if (window<=e.window&&cutoff<=e.cutoff) {
+            ++nb_hits;
+            return {utils::PINF<F>};
+          }
+        } else if (e.max_deviation<=window&&window<=e.window) {
+          ++nb_hits;
+          return {e.cost<=cutoff ? e.cost : utils::PINF<F>};
+        } else if (window<=e.window&&cutoff<e.cost) {
+          ++nb_hits;
+          return {utils::PINF<F>};
+        }
+      }
+      ++nb_misses;
+      return {};
+    }
+
+    /// Record the result of a DTW computed at 'window' with 'cutoff' (see find).
+    /// A known cost is never replaced by an early abandoned one.
+    void store(Key const& key, size_t length, size_t window, F cutoff, F cost, size_t max_deviation) {
+      const Entry e{cost, max_deviation, std::min(window, length), effective_cutoff(cutoff)};
+      std::lock_guard lock(mtx);
+      auto [it, inserted] = entries.try_emplace(key, e);
+      if (!inserted) {
+        Entry& old = it->second;
+        if (!std::isinf(cost)||(std::isinf(old.cost)&&e.window>=old.window&&e.cutoff>=old.cutoff)) { old = e; }
+      }
+    }
+
+    /** DTW at 'window' with 'cutoff', from the cache, or computed by 'compute' and stored.
+     * @param compute   compute(window, cutoff, max_deviation&) -> F, e.g. a call to univariate::dtw_wr
+     */
+    template<typename Fun>
+    F get(Key const& key, size_t length, size_t window, F cutoff, Fun&& compute) {
+      if (auto r = find(key, length, window, cutoff)) { return r.value(); }
+      size_t max_deviation = utils::NO_WINDOW;
+      const F cost = compute(window, cutoff, max_deviation);
+      store(key, length, window, cutoff, cost, max_deviation);
+      return cost;
+    }
+
+    /// Number of results answered by the cache
+    size_t hits() {
+      std::lock_guard lock(mtx);
+      return nb_hits;
+    }
+
+    /// Number of results not answered by the cache
+    size_t misses() {
+      std::lock_guard lock(mtx);
+      return nb_misses;
+    }
+
+    /// Remove all the results
+    void clear() {
+      std::lock_guard lock(mtx);
+      entries.clear();
+    }
+  };
+
+} // End of namespace tempo::distance
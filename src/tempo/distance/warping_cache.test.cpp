@@ -0,0 +1,46 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "warping_cache.hpp"
+#include "univariate.hpp"
+
+#include <mock/mockseries.hpp>
+#include <utility>
+#include <vector>
+
+using namespace tempo::distance;
+
+constexpr size_t nbitems = 100;
+constexpr double PINF = utils::PINF<double>;
+
+TEST_CASE("Warping cache", "[dtw][univariate]") {
+  mock::Mocker mocker(0);
+  const auto dset = mocker.vec_rs_randvec(nbitems);
+  const double cfe = 2.0;
+
+  // Same results as DTW over a sweep of windows, in decreasing or increasing order, with or without cutoff
+  for (const bool decreasing : {true, false}) {
+    WarpingCache<double, std::pair<size_t, size_t>> cache;
+    for (size_t i = 0; i<nbitems - 1; ++i) {
+      const auto& s1 = dset[i];
+      const auto& s2 = dset[i + 1];
+      const size_t length = std::max(s1.size(), s2.size());
+      const auto compute = [&](size_t w, double cutoff, size_t& md) {
+        return univariate::dtw_wr<double>(s1.data(), s1.size(), s2.data(), s2.size(), cfe, w, cutoff, md);
+      };
+      for (size_t k = 0; k<=length; ++k) {
+        const size_t w = decreasing ? length - k : k;
+        const double v = univariate::dtw<double>(s1.data(), s1.size(), s2.data(), s2.size(), cfe, w, PINF);
+        REQUIRE(cache.get({i, i + 1}, length, w, PINF, compute)==v);
+        // Cutoffs around the result
+        if (!std::isinf(v)) {
+          REQUIRE(cache.get({i, i + 1}, length, w, v*0.9, compute)==PINF);
+          REQUIRE(cache.get({i, i + 1}, length, w, v*1.1, compute)==v);
+        }
+      }
+      REQUIRE(cache.get({i, i + 1}, length, utils::NO_WINDOW, PINF, compute)
+              ==univariate::dtw<double>(s1.data(), s1.size(), s2.data(), s2.size(), cfe, utils::NO_WINDOW, PINF));
+    }
+    // Most of the windows are answered by the cache
+    REQUIRE(cache.hits()>cache.misses());
+  }
+}
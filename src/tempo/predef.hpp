@@ -39,6 +39,8 @@
 // JSONCPP
 #include <nlohmann/json.hpp>
 
+#include <tempo/utils/utils/xoshiro.hpp>
+
 namespace tempo {
 
   using LabelType = std::string;
@@ -47,9 +49,22 @@ namespace tempo {
   using EncodedLabelType = size_t;
   using EL = EncodedLabelType;
 
+  /// Floating point type used for the series and the distances.
+  /// Single precision halves the memory used by the series; enable it with the CMake option TEMPO_FLOAT32.
+  #if defined(TEMPO_FLOAT32)
+  using FloatType = float;
+  #else
   using FloatType = double;
+  #endif
   using F = FloatType;
 
+  /// Pseudo random number generator of the trees, the classifiers and the tie breaks.
+  /// The small state xoshiro256** (see utils::Xoshiro256ss) makes seeding and forking states cheap; enable it with the
+  /// CMake option TEMPO_PRNG_XOSHIRO. The random streams differ: so do the forests trained with a same seed.
+  #if defined(TEMPO_PRNG_XOSHIRO)
+  using PRNG = utils::Xoshiro256ss;
+  #else
   using PRNG = std::mt19937_64;
+  #endif
 
 } // End of namespace tempo
\ No newline at end of file
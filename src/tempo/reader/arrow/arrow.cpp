@@ -0,0 +1,620 @@
+#include "arrow.hpp"
+
+#include <tempo/utils/utils/mapped_file.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+namespace tempo::reader::arrow {
+
+  namespace {
+
+    [[noreturn]] void invalid(std::string const& what) { throw std::runtime_error("Invalid Arrow IPC file: " + what); }
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Flatbuffers, the encoding of the Arrow IPC metadata, read with bounds checks
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    /// Little endian scalar at 'pos' in [data, data+size[
+    template<typename T>
+    T read_at(uint8_t const *data, size_t size, size_t pos) {
+      if (pos>size||size - pos<sizeof(T)) { invalid("metadata out of bounds"); }
+      T v;
+      std::memcpy(&v, data + pos, sizeof(T));
+      return v;
+    }
+
+    /// Table of a flatbuffer: fields by id, through the vtable of the table
+    struct Table {
+      uint8_t const *data{nullptr};
+      size_t size{0};
+      size_t pos{0};
+      size_t vtable{0};
+      size_t vtable_size{0};
+
+      Table(uint8_t const *data, size_t size, size_t pos) : data(data), size(size), pos(pos) {
+        const auto vt = (int64_t)pos - read_at<int32_t>(data, size, pos);
+        if (vt<0||(size_t)vt>size) { invalid("vtable out of bounds"); }
+        vtable = (size_t)vt;
+        vtable_size = read_at<uint16_t>(data, size, vtable);
+      }
+
+      /// Root table of the flatbuffer [data, data+size[
+      static Table root(uint8_t const *data, size_t size) { return {data, size, read_at<uint32_t>(data, size, 0)}; }
+
+      /// Position of the field 'id', 0 if absent
+      size_t field(size_t id) const {
+        const size_t entry = 4 + 2*id;
+        if (entry + 2>vtable_size) { return 0; }
+        const auto offset = read_at<uint16_t>(data, size, vtable + entry);
+        return offset==0 ? 0 : pos + offset;
+      }
+
+      bool has(size_t id) const { return field(id)!=0; }
+
+      /// Scalar field 'id', 'def' if absent
+      template<typename T>
+      T scalar(size_t id, T def) const {
+        const size_t p = field(id);
+        return p==0 ? def : read_at<T>(data, size, p);
+      }
+
+      /// Position of the table, vector or string referenced by the field 'id', 0 if absent
+      size_t indirect(size_t id) const {
+        const size_t p = field(id);
+        return p==0 ? 0 : p + read_at<uint32_t>(data, size, p);
+      }
+
+      std::optional<Table> table(size_t id) const {
+        const size_t p = indirect(id);
+        if (p==0) { return {}; }
+        return {Table(data, size, p)};
+      }
+
+      std::string string(size_t id) const {
+        const size_t p = indirect(id);
+        if (p==0) { return {}; }
+        const auto length = read_at<uint32_t>(data, size, p);
+        if (size - p - 4<length) { invalid("string out of bounds"); }
+        return {(char const *)data + p + 4, length};
+      }
+
+      /// Position of the first element and number of elements of the vector field 'id' (0 elements if absent)
+      std::pair<size_t, size_t> vector(size_t id, size_t element_size) const {
+        const size_t p = indirect(id);
+        if (p==0) { return {0, 0}; }
+        const auto length = read_at<uint32_t>(data, size, p);
+        if ((size - p - 4)/element_size<length) { invalid("vector out of bounds"); }
+        return {p + 4, length};
+      }
+
+      /// Tables of the vector field 'id'
+      std::vector<Table> tables(size_t id) const {
+        const auto [start, n] = vector(id, 4);
+        std::vector<Table> result;
+        result.reserve(n);
+        for (size_t i = 0; i<n; ++i) {
+          const size_t p = start + 4*i;
+          result.emplace_back(data, size, p + read_at<uint32_t>(data, size, p));
+        }
+        return result;
+      }
+    };
+
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+    // Arrow format (see Schema.fbs and Message.fbs of the Arrow specification)
+    // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+    namespace type {
+      constexpr uint8_t Null = 1;
+      constexpr uint8_t Int = 2;
+      constexpr uint8_t FloatingPoint = 3;
+      constexpr uint8_t Binary = 4;
+      constexpr uint8_t Utf8 = 5;
+      constexpr uint8_t Bool = 6;
+      constexpr uint8_t Decimal = 7;
+      constexpr uint8_t Date = 8;
+      constexpr uint8_t Time = 9;
+      constexpr uint8_t Timestamp = 10;
+      constexpr uint8_t Interval = 11;
+      constexpr uint8_t List = 12;
+      constexpr uint8_t Struct = 13;
+      constexpr uint8_t Union = 14;
+      constexpr uint8_t FixedSizeBinary = 15;
+      constexpr uint8_t FixedSizeList = 16;
+      constexpr uint8_t Map = 17;
+      constexpr uint8_t Duration = 18;
+      constexpr uint8_t LargeBinary = 19;
+      constexpr uint8_t LargeUtf8 = 20;
+      constexpr uint8_t LargeList = 21;
+      constexpr uint8_t RunEndEncoded = 22;
+    }
+
+    namespace message {
+      constexpr uint8_t Schema = 1;
+      constexpr uint8_t DictionaryBatch = 2;
+      constexpr uint8_t RecordBatch = 3;
+    }
+
+    namespace precision {
+      constexpr int16_t Single = 1;
+      constexpr int16_t Double = 2;
+    }
+
+    /// Field of the schema, with the position of its node and of its first buffer in the record batches
+    struct Field {
+      std::string name;
+      uint8_t type_id{0};
+      std::optional<Table> type;
+      std::optional<int64_t> dictionary_id;
+      std::optional<Table> index_type;
+      std::vector<Field> children;
+      size_t node{0};
+      size_t buffer{0};
+    };
+
+    /// Number of buffers of a field in a record batch, its children apart
+    size_t nb_buffers(Field const& f) {
+      if (f.dictionary_id) { return 2; }
+      switch (f.type_id) {
+      case type::Null:
+      case type::RunEndEncoded: return 0;
+      case type::Struct:
+      case type::FixedSizeList: return 1;
+      case type::Union: return f.type && f.type->scalar<int16_t>(0, 0)==1 ? 2 : 1; // Dense, else Sparse
+      case type::Int:
+      case type::FloatingPoint:
+      case type::Bool:
+      case type::Decimal:
+      case type::Date:
+      case type::Time:
+      case type::Timestamp:
+      case type::Interval:
+      case type::List:
+      case type::FixedSizeBinary:
+      case type::Map:
+      case type::Duration:
+      case type::LargeList: return 2;
+      case type::Binary:
+      case type::Utf8:
+      case type::LargeBinary:
+      case type::LargeUtf8: return 3;
+      default: throw std::runtime_error("Unsupported Arrow type in column '" + f.name + "'");
+      }
+    }
+
+    /// Parse a field and its children, numbering their nodes and buffers in depth first order from 'node' and 'buffer'
+    Field parse_field(Table const& t, size_t& node, size_t& buffer) {
+      Field f;
+      f.name = t.string(0);
+      f.type_id = t.scalar<uint8_t>(2, 0);
+      f.type = t.table(3);
+      if (auto d = t.table(4)) {
+        f.dictionary_id = d->scalar<int64_t>(0, 0);
+        f.index_type = d->table(1);
+      }
+      f.node = node++;
+      f.buffer = buffer;
+      buffer += nb_buffers(f);
+      // The children of a dictionary encoded field belong to its dictionary batches, not to the record batches
+      size_t dnode = 1;
+      size_t dbuffer = 0;
+      for (Table const& c : t.tables(5)) {
+        if (f.dictionary_id) { f.children.push_back(parse_field(c, dnode, dbuffer)); }
+        else { f.children.push_back(parse_field(c, node, buffer)); }
+      }
+      return f;
+    }
+
+    /// Record batch: nodes (length and null count of each field) and buffers in the body of its message
+    struct Batch {
+      size_t length{0};
+      std::vector<std::pair<int64_t, int64_t>> nodes;
+      std::vector<std::pair<int64_t, int64_t>> buffers;
+      uint8_t const *body{nullptr};
+      size_t body_size{0};
+
+      Batch(Table const& t, uint8_t const *body, size_t body_size) : body(body), body_size(body_size) {
+        if (t.has(3)) {
+          throw std::runtime_error("Compressed Arrow IPC files are not supported: write them uncompressed");
+        }
+        const auto l = t.scalar<int64_t>(0, 0);
+        if (l<0) { invalid("negative batch length"); }
+        length = (size_t)l;
+        const auto [ns, nn] = t.vector(1, 16);
+        for (size_t i = 0; i<nn; ++i) {
+          const size_t p = ns + 16*i;
+          nodes.emplace_back(read_at<int64_t>(t.data, t.size, p), read_at<int64_t>(t.data, t.size, p + 8));
+          if (nodes.back().first<0||nodes.back().second<0) { invalid("negative node length"); }
+        }
+        const auto [bs, bn] = t.vector(2, 16);
+        for (size_t i = 0; i<bn; ++i) {
+          const size_t p = bs + 16*i;
+          buffers.emplace_back(read_at<int64_t>(t.data, t.size, p), read_at<int64_t>(t.data, t.size, p + 8));
+        }
+      }
+
+      /// Number of values of the node 'i'
+      size_t node_length(size_t i) const {
+        if (i>=nodes.size()) { invalid("missing node"); }
+        return (size_t)nodes[i].first;
+      }
+
+      /// Number of null values of the node 'i'
+      size_t null_count(size_t i) const {
+        if (i>=nodes.size()) { invalid("missing node"); }
+        return (size_t)nodes[i].second;
+      }
+
+      /// Buffer 'i', of at least 'min_size' bytes (nullptr if empty)
+      uint8_t const *buffer(size_t i, size_t min_size) const {
+        if (i>=buffers.size()) { invalid("missing buffer"); }
+        const auto [offset, size] = buffers[i];
+        if (offset<0||size<0||(size_t)offset>body_size||body_size - (size_t)offset<(size_t)size) {
+          invalid("buffer out of the message body");
+        }
+        if ((size_t)size<min_size) { invalid("buffer too small for its values"); }
+        return size==0 ? nullptr : body + offset;
+      }
+
+      /// Validity bitmap of the node 'node', whose first buffer is 'buffer': nullptr without null value
+      uint8_t const *validity(size_t node, size_t buffer) const {
+        if (null_count(node)==0) { return nullptr; }
+        return this->buffer(buffer, (node_length(node) + 7)/8);
+      }
+    };
+
+    bool is_valid(uint8_t const *bitmap, size_t i) { return bitmap==nullptr||((bitmap[i/8] >> (i%8)) & 1)!=0; }
+
+    /// Integer 'i' of a buffer of integers of 'bits' bits, sign extended if signed
+    uint64_t integer_at(uint8_t const *data, size_t i, int32_t bits, bool is_signed) {
+      uint64_t u = 0;
+      std::memcpy(&u, data + i*(size_t)(bits/8), (size_t)(bits/8));
+      if (is_signed&&bits<64&&((u >> (bits - 1)) & 1)!=0) { u |= ~uint64_t{0} << bits; }
+      return u;
+    }
+
+    /// Bits and signedness of an integer type, the default index type of the dictionaries (int32) if absent
+    std::pair<int32_t, bool> integer_type(std::optional<Table> const& t, std::string const& name) {
+      if (!t) { return {32, true}; }
+      const auto bits = t->scalar<int32_t>(0, 0);
+      if (bits!=8&&bits!=16&&bits!=32&&bits!=64) {
+        invalid("integer column '" + name + "' of " + std::to_string(bits) + " bits");
+      }
+      return {bits, t->scalar<uint8_t>(1, 0)!=0};
+    }
+
+    /// Values of a column of strings or integers, at the node 'node' and first buffer 'buffer' of 'batch'
+    std::vector<std::optional<std::string>>
+    read_strings(Field const& f, Batch const& batch, size_t node, size_t buffer) {
+      const size_t n = batch.node_length(node);
+      uint8_t const *valid = batch.validity(node, buffer);
+      std::vector<std::optional<std::string>> result(n);
+      if (n==0) { return result; }
+      auto read_offsets = [&]<typename O>(O) {
+        auto const *offsets = reinterpret_cast<O const *>(batch.buffer(buffer + 1, (n + 1)*sizeof(O)));
+        O last;
+        std::memcpy(&last, offsets + n, sizeof(O));
+        auto const *chars = (char const *)batch.buffer(buffer + 2, last<0 ? 0 : (size_t)last);
+        for (size_t i = 0; i<n; ++i) {
+          if (!is_valid(valid, i)) { continue; }
+          O start, stop;
+          std::memcpy(&start, offsets + i, sizeof(O));
+          std::memcpy(&stop, offsets + i + 1, sizeof(O));
+          if (start<0||stop<start||stop>last) { invalid("column '" + f.name + "' with invalid offsets"); }
+          result[i] = std::string(chars + start, chars + stop);
+        }
+      };
+      switch (f.type_id) {
+      case type::Utf8:
+      case type::Binary: read_offsets(int32_t{}); break;
+      case type::LargeUtf8:
+      case type::LargeBinary: read_offsets(int64_t{}); break;
+      case type::Int: {
+        const auto [bits, is_signed] = integer_type(f.type, f.name);
+        uint8_t const *data = batch.buffer(buffer + 1, n*(size_t)(bits/8));
+        for (size_t i = 0; i<n; ++i) {
+          if (!is_valid(valid, i)) { continue; }
+          const uint64_t u = integer_at(data, i, bits, is_signed);
+          result[i] = is_signed ? std::to_string((int64_t)u) : std::to_string(u);
+        }
+        break;
+      }
+      default: throw std::runtime_error("Arrow column '" + f.name + "' is not a column of strings or integers");
+      }
+      return result;
+    }
+
+    /// Shape of the series column: lists of values, or lists of points (fixed size lists of 'ndim' values)
+    struct SeriesShape {
+      Field const *list{nullptr};
+      Field const *points{nullptr};
+      Field const *values{nullptr};
+      size_t ndim{1};
+      size_t list_size{0};
+      bool single{false};
+    };
+
+    SeriesShape series_shape(Field const& f) {
+      const std::string error = "Arrow column '" + f.name + "' is not a column of lists of floating point values";
+      SeriesShape shape;
+      shape.list = &f;
+      if (f.dictionary_id||f.children.size()!=1) { throw std::runtime_error(error); }
+      if (f.type_id==type::FixedSizeList) {
+        const auto s = f.type ? f.type->scalar<int32_t>(0, 0) : 0;
+        if (s<=0) { throw std::runtime_error(error); }
+        shape.list_size = (size_t)s;
+      } else if (f.type_id!=type::List&&f.type_id!=type::LargeList) { throw std::runtime_error(error); }
+      Field const& c = f.children[0];
+      if (c.type_id==type::FixedSizeList&&c.children.size()==1&&!c.dictionary_id) {
+        const auto d = c.type ? c.type->scalar<int32_t>(0, 0) : 0;
+        if (d<=0) { throw std::runtime_error(error); }
+        shape.points = &c;
+        shape.ndim = (size_t)d;
+        shape.values = &c.children[0];
+      } else { shape.values = &c; }
+      if (shape.values->type_id!=type::FloatingPoint||shape.values->dictionary_id) { throw std::runtime_error(error); }
+      const auto p = shape.values->type ? shape.values->type->scalar<int16_t>(0, 0) : 0;
+      if (p!=precision::Single&&p!=precision::Double) {
+        throw std::runtime_error("Arrow column '" + f.name + "': half precision values are not supported");
+      }
+      shape.single = p==precision::Single;
+      return shape;
+    }
+
+    /// Values of the series column in a record batch, and the series it holds (start and length, in points)
+    struct SeriesValues {
+      uint8_t const *data{nullptr};
+      uint8_t const *valid_values{nullptr};
+      uint8_t const *valid_points{nullptr};
+      /// Values of the type of F, all valid: the series can view them
+      bool viewable{false};
+      std::vector<std::pair<size_t, size_t>> rows;
+    };
+
+    SeriesValues series_values(SeriesShape const& shape, Batch const& batch) {
+      Field const& list = *shape.list;
+      const std::string name = "Arrow column '" + list.name + "'";
+      SeriesValues sv;
+      const size_t n = batch.node_length(list.node);
+      uint8_t const *valid = batch.validity(list.node, list.buffer);
+      const size_t nb_values = batch.node_length(shape.values->node);
+      const size_t nb_items = shape.points ? batch.node_length(shape.points->node) : nb_values;
+      if (shape.points&&nb_values/shape.ndim<nb_items) { invalid(name + " with too few values for its points"); }
+      // Rows
+      auto add_row = [&](size_t i, int64_t start, int64_t stop) {
+        if (!is_valid(valid, i)) { throw std::runtime_error(name + ": null series"); }
+        if (start<0||stop<=start||(size_t)stop>nb_items) {
+          if (start>=0&&stop==start) { throw std::runtime_error(name + ": empty series"); }
+          invalid(name + " with invalid offsets");
+        }
+        sv.rows.emplace_back((size_t)start, (size_t)(stop - start));
+      };
+      auto list_offsets = [&]<typename O>(O) {
+        auto const *offsets = reinterpret_cast<O const *>(batch.buffer(list.buffer + 1, (n + 1)*sizeof(O)));
+        for (size_t i = 0; i<n; ++i) {
+          O start, stop;
+          std::memcpy(&start, offsets + i, sizeof(O));
+          std::memcpy(&stop, offsets + i + 1, sizeof(O));
+          add_row(i, start, stop);
+        }
+      };
+      if (n>0) {
+        if (list.type_id==type::List) { list_offsets(int32_t{}); }
+        else if (list.type_id==type::LargeList) { list_offsets(int64_t{}); }
+        else {
+          for (size_t i = 0; i<n; ++i) { add_row(i, (int64_t)(i*shape.list_size), (int64_t)((i + 1)*shape.list_size)); }
+        }
+      }
+      // Values
+      const size_t width = shape.single ? sizeof(float) : sizeof(double);
+      if (shape.points) { sv.valid_points = batch.validity(shape.points->node, shape.points->buffer); }
+      sv.valid_values = batch.validity(shape.values->node, shape.values->buffer);
+      sv.data = batch.buffer(shape.values->buffer + 1, nb_values*width);
+      sv.viewable = shape.single==std::is_same_v<F, float>&&sv.valid_points==nullptr&&sv.valid_values==nullptr
+        &&(uintptr_t)sv.data%alignof(F)==0;
+      return sv;
+    }
+
+    /// Value 'k' of the values of 'sv', as F, NaN if it is null or in a null point
+    F value_at(SeriesValues const& sv, SeriesShape const& shape, size_t k) {
+      if (!is_valid(sv.valid_values, k)||!is_valid(sv.valid_points, k/shape.ndim)) {
+        return std::numeric_limits<F>::quiet_NaN();
+      }
+      if (shape.single) {
+        float v;
+        std::memcpy(&v, sv.data + k*sizeof(float), sizeof(float));
+        return (F)v;
+      }
+      double v;
+      std::memcpy(&v, sv.data + k*sizeof(double), sizeof(double));
+      return (F)v;
+    }
+
+  } // End of anonymous namespace
+
+  std::variant<std::string, ArrowData> read_arrow(
+    std::filesystem::path const& path,
+    ArrowColumns const& columns,
+    size_t nb_threads
+  ) {
+    try {
+      auto file = std::make_shared<utils::MappedFile>(path);
+      auto const *const base = reinterpret_cast<uint8_t const *>(file->data());
+      const size_t size = file->size();
+
+      // --- --- --- Messages: after the magic in the file format, up to its footer; from the start in the stream format
+      size_t pos = 0;
+      size_t end = size;
+      if (size>=4&&std::memcmp(base, "FEA1", 4)==0) {
+        return {"Feather V1 files are not supported: write Feather V2 (Arrow IPC) files"};
+      }
+      if (size>=8&&std::memcmp(base, "ARROW1", 6)==0) {
+        if (size<18||std::memcmp(base + size - 6, "ARROW1", 6)!=0) { invalid("truncated file"); }
+        const auto footer_size = read_at<int32_t>(base, size, size - 10);
+        if (footer_size<0||(size_t)footer_size>size - 18) { invalid("footer out of bounds"); }
+        pos = 8;
+        end = size - 10 - (size_t)footer_size;
+      }
+
+      std::optional<std::vector<Field>> fields;
+      Field const *series_field = nullptr;
+      Field const *label_field = nullptr;
+      std::vector<std::optional<std::string>> dictionary;
+      std::vector<Batch> batches;
+      while (end - pos>=4) {
+        // Encapsulated message: continuation marker (absent before Arrow 0.15), metadata size, metadata, body
+        size_t meta = pos + 4;
+        uint32_t meta_size = read_at<uint32_t>(base, end, pos);
+        if (meta_size==0xFFFFFFFFu) {
+          meta_size = read_at<uint32_t>(base, end, pos + 4);
+          meta = pos + 8;
+        }
+        if (meta_size==0) { break; } // End of stream
+        if (end - meta<meta_size) { invalid("truncated message"); }
+        const Table msg = Table::root(base + meta, meta_size);
+        const auto body_size = msg.scalar<int64_t>(3, 0);
+        uint8_t const *body = base + meta + meta_size;
+        if (body_size<0||end - meta - meta_size<(size_t)body_size) { invalid("truncated message body"); }
+        pos = meta + meta_size + (size_t)body_size;
+        const auto header = msg.table(2);
+        if (!header) { invalid("message without header"); }
+
+        switch (msg.scalar<uint8_t>(1, 0)) {
+        case message::Schema: {
+          if (fields) { invalid("several schemas"); }
+          if (header->scalar<int16_t>(0, 0)!=0) { return {"Big endian Arrow IPC files are not supported"}; }
+          fields = std::vector<Field>{};
+          size_t node = 0;
+          size_t buffer = 0;
+          for (Table const& t : header->tables(1)) { fields->push_back(parse_field(t, node, buffer)); }
+          for (Field const& f : *fields) {
+            if (f.name==columns.series) { series_field = &f; }
+            if (columns.label&&f.name==columns.label.value()) { label_field = &f; }
+          }
+          if (series_field==nullptr) { return {"No column '" + columns.series + "' in " + path.string()}; }
+          if (columns.label&&label_field==nullptr) {
+            return {"No column '" + columns.label.value() + "' in " + path.string()};
+          }
+          break;
+        }
+        case message::DictionaryBatch: {
+          if (!fields) { invalid("dictionary before the schema"); }
+          const auto data = header->table(1);
+          if (!data) { invalid("dictionary batch without data"); }
+          if (label_field==nullptr||label_field->dictionary_id!=header->scalar<int64_t>(0, 0)) { break; }
+          // The dictionary is a batch of one column, of the value type of the field
+          Field values = *label_field;
+          values.dictionary_id.reset();
+          values.node = 0;
+          values.buffer = 0;
+          auto strings = read_strings(values, Batch(*data, body, (size_t)body_size), 0, 0);
+          if (header->scalar<uint8_t>(2, 0)==0) { dictionary.clear(); } // Not a delta
+          dictionary.insert(dictionary.end(), strings.begin(), strings.end());
+          break;
+        }
+        case message::RecordBatch: {
+          if (!fields) { invalid("record batch before the schema"); }
+          batches.emplace_back(*header, body, (size_t)body_size);
+          break;
+        }
+        default: break; // Tensors are not part of a table
+        }
+      }
+      if (!fields) { invalid("no schema"); }
+
+      // --- --- --- Rows and labels of each batch
+      const SeriesShape shape = series_shape(*series_field);
+      const size_t ndim = shape.ndim;
+      ArrowData data;
+      data.nb_dimensions = ndim;
+      std::vector<SeriesValues> values;
+      for (Batch const& batch : batches) {
+        values.push_back(series_values(shape, batch));
+        if (values.back().rows.size()!=batch.length) { invalid("series column without the length of its batch"); }
+        if (label_field==nullptr) {
+          data.labels.resize(data.labels.size() + batch.length);
+        } else if (!label_field->dictionary_id) {
+          auto labels = read_strings(*label_field, batch, label_field->node, label_field->buffer);
+          if (labels.size()!=batch.length) { invalid("label column without the length of its batch"); }
+          data.labels.insert(data.labels.end(), labels.begin(), labels.end());
+        } else {
+          const auto [bits, is_signed] = integer_type(label_field->index_type, label_field->name);
+          const size_t n = batch.node_length(label_field->node);
+          if (n!=batch.length) { invalid("label column without the length of its batch"); }
+          uint8_t const *valid = batch.validity(label_field->node, label_field->buffer);
+          uint8_t const *indices = batch.buffer(label_field->buffer + 1, n*(size_t)(bits/8));
+          for (size_t i = 0; i<n; ++i) {
+            if (!is_valid(valid, i)) {
+              data.labels.emplace_back();
+              continue;
+            }
+            const uint64_t index = integer_at(indices, i, bits, is_signed);
+            if ((is_signed&&(int64_t)index<0)||index>=dictionary.size()) { invalid("dictionary index out of bounds"); }
+            data.labels.push_back(dictionary[index]);
+          }
+        }
+      }
+
+      // --- --- --- Series: views over the mapping, or converted in one slab
+      struct Row {
+        size_t batch;
+        size_t start;
+        size_t length;
+        size_t slab_offset;
+      };
+      std::vector<Row> rows;
+      size_t slab_size = 0;
+      for (size_t b = 0; b<values.size(); ++b) {
+        for (auto const& [start, length] : values[b].rows) {
+          rows.push_back({b, start, length, slab_size});
+          if (!values[b].viewable) { slab_size += length*ndim; }
+        }
+      }
+      if (rows.empty()) { return {"No series in " + path.string()}; }
+      std::optional<SeriesSlab> slab;
+      if (slab_size>0) { slab.emplace(slab_size); }
+      auto const mapping = utils::make_capsule<std::shared_ptr<utils::MappedFile>>(file);
+      auto row_data = [&](Row const& r) -> F const * {
+        SeriesValues const& sv = values[r.batch];
+        if (sv.viewable) { return reinterpret_cast<F const *>(sv.data) + r.start*ndim; }
+        return slab->data + r.slab_offset;
+      };
+
+      // Convert and search the missing values concurrently
+      std::vector<char> missing(rows.size());
+      utils::ParTasks().execute((int)std::max<size_t>(nb_threads, 1), [&](size_t i) {
+        Row const& r = rows[i];
+        SeriesValues const& sv = values[r.batch];
+        if (!sv.viewable) {
+          F *out = slab->data + r.slab_offset;
+          for (size_t k = 0; k<r.length*ndim; ++k) { out[k] = value_at(sv, shape, r.start*ndim + k); }
+        }
+        F const *d = row_data(r);
+        missing[i] = std::any_of(d, d + r.length*ndim, [](F x) { return std::isnan(x); });
+      }, 0, rows.size());
+
+      data.length_min = std::numeric_limits<size_t>::max();
+      data.series.reserve(rows.size());
+      for (size_t i = 0; i<rows.size(); ++i) {
+        Row const& r = rows[i];
+        const bool view = values[r.batch].viewable;
+        data.series.push_back(TSeries::mk_view(view ? mapping : slab->capsule, row_data(r), ndim, r.length,
+                                               data.labels[i], {missing[i]!=0}));
+        if (missing[i]) { data.series_with_missing.push_back(i); }
+        if (view) { ++data.nb_views; }
+        data.length_min = std::min(data.length_min, r.length);
+        data.length_max = std::max(data.length_max, r.length);
+      }
+      return {std::move(data)};
+    } catch (std::exception const& e) {
+      return {std::string(e.what())};
+    }
+  }
+
+} // End of namespace tempo::reader::arrow
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <tempo/utils/utils.hpp>
+#include <tempo/dataset/tseries.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace tempo::reader::arrow {
+
+  /** Columns of an Arrow IPC file (file format, ".arrow"/".feather", or stream format, ".arrows") read as a split.
+   *  'series' names a column of lists of floating point values, one univariate series per row, or of lists of fixed
+   *  size lists of floating point values, one multivariate series per row, its points being the inner lists:
+   *    list<double>, large_list<double>, fixed_size_list<double, length>,
+   *    list<fixed_size_list<double, nb_dimensions>>, ... (float values too)
+   *  'label', if any, names a column of strings, integers or dictionary encoded strings (e.g. pandas categories);
+   *  a null label is an unlabelled series.
+   */
+  struct ArrowColumns {
+    std::string series{"series"};
+    std::optional<std::string> label{"label"};
+  };
+
+  /// Data read by 'read_arrow'
+  struct ArrowData {
+
+    /// Series, in row order, with their label and missing flag
+    std::vector<TSeries> series;
+
+    /// Label of each series, in row order
+    std::vector<std::optional<std::string>> labels;
+
+    /// Indexes of the series containing NaN or null values, in increasing order
+    std::vector<size_t> series_with_missing;
+
+    size_t nb_dimensions{1};
+
+    size_t length_min{0};
+
+    size_t length_max{0};
+
+    /// Number of series viewing the mapping of the file, the other ones being converted in a slab
+    size_t nb_views{0};
+  };
+
+  /** Read the columns 'columns' of the Arrow IPC file 'path', without parsing any text.
+   *  The file is memory mapped. The series whose values have the type of tempo::F and no null value are views over
+   *  the mapping, the capsule keeping it alive; the other ones (e.g. float values with F = double) are converted in
+   *  one slab (see SeriesSlab), the null values becoming NaN. The missing values are searched with 'nb_threads'
+   *  threads.
+   *  Only uncompressed, little endian files are read. Return an error message on failure.
+   */
+  std::variant<std::string, ArrowData> read_arrow(
+    std::filesystem::path const& path,
+    ArrowColumns const& columns,
+    size_t nb_threads = 1
+  );
+
+} // End of namespace tempo::reader::arrow
@@ -0,0 +1,205 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "arrow.hpp"
+
+#include <tempo/writer/arrow/arrow.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace tempo;
+using namespace tempo::reader::arrow;
+
+namespace {
+
+  /// Fixture of this name, written by fixtures/gen_fixtures.py
+  std::filesystem::path fixture(std::string const& name) {
+    return std::filesystem::path(TEMPO_ARROW_FIXTURES)/(name + ".arrow");
+  }
+
+  /// Data read from 'path', failing the test on error
+  ArrowData read(std::filesystem::path const& path, ArrowColumns const& columns = {}, size_t nb_threads = 1) {
+    auto result = read_arrow(path, columns, nb_threads);
+    if (result.index()==0) { FAIL(std::get<0>(result)); }
+    return std::move(std::get<1>(result));
+  }
+
+  /// Error reading 'path', failing the test if it is read
+  std::string error(std::filesystem::path const& path, ArrowColumns const& columns = {}) {
+    auto result = read_arrow(path, columns);
+    REQUIRE(result.index()==0);
+    return std::get<0>(result);
+  }
+
+  /// Values of a series, NaN included
+  std::vector<F> values(TSeries const& s) { return {s.data(), s.data() + s.size()}; }
+
+  /// Number of views expected for series of double values without null: all of them in double precision
+  size_t views_of_doubles(size_t n) { return std::is_same_v<F, double> ? n : 0; }
+
+  /// Write 'bytes' at 'path'
+  void write_bytes(std::filesystem::path const& path, std::vector<char> const& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), (std::streamsize)bytes.size());
+  }
+
+  std::vector<char> read_bytes(std::filesystem::path const& path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// The fixtures hold a few series per column type; the invalid files are errors, never reads out of the file.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Arrow reader fixtures", "[arrow]") {
+
+  SECTION("Univariate series, string labels") {
+    for (const size_t nbt : {1, 3}) {
+      const ArrowData d = read(fixture("univariate"), {}, nbt);
+      REQUIRE(d.series.size()==3);
+      REQUIRE(d.nb_dimensions==1);
+      REQUIRE(d.length_min==2);
+      REQUIRE(d.length_max==4);
+      REQUIRE(d.labels==std::vector<std::optional<std::string>>{"a", "b", std::nullopt});
+      REQUIRE(values(d.series[0])==std::vector<F>{1, 2, 3});
+      REQUIRE(values(d.series[1])==std::vector<F>{4, 5});
+      REQUIRE(values(d.series[2])==std::vector<F>{6, 7, 8, 9});
+      REQUIRE(d.series_with_missing.empty());
+      REQUIRE(d.nb_views==views_of_doubles(3));
+    }
+    // Without label column
+    const ArrowData d = read(fixture("univariate"), {"series", std::nullopt});
+    REQUIRE(d.labels==std::vector<std::optional<std::string>>(3));
+  }
+
+  SECTION("Multivariate series (fixed size list points), integer labels") {
+    const ArrowData d = read(fixture("multivariate"));
+    REQUIRE(d.series.size()==2);
+    REQUIRE(d.nb_dimensions==2);
+    REQUIRE(d.series[0].nb_dimensions()==2);
+    REQUIRE(d.series[0].length()==2);
+    REQUIRE(d.series[1].length()==3);
+    REQUIRE(d.labels==std::vector<std::optional<std::string>>{"3", "-1"});
+    // Points in order, one column of the series per point
+    REQUIRE(values(d.series[0])==std::vector<F>{1, 2, 3, 4});
+    REQUIRE(values(d.series[1])==std::vector<F>{5, 6, 7, 8, 9, 10});
+    REQUIRE(d.nb_views==views_of_doubles(2));
+  }
+
+  SECTION("Dictionary encoded labels") {
+    // A null index, and a delta dictionary adding a label before the second batch
+    const ArrowData d = read(fixture("dictionary"));
+    REQUIRE(d.series.size()==4);
+    REQUIRE(d.labels==std::vector<std::optional<std::string>>{"dog", std::nullopt, "cat", "eel"});
+    REQUIRE(values(d.series[3])==std::vector<F>{5, 6});
+  }
+
+  SECTION("Null values become NaN") {
+    // Float values with a null value and a null point: converted in a slab
+    const ArrowData d = read(fixture("nulls"), {"x", "y"}, 2);
+    REQUIRE(d.series.size()==3);
+    REQUIRE(d.labels==std::vector<std::optional<std::string>>{"p", "q", "r"});
+    REQUIRE(d.nb_views==0);
+    REQUIRE(d.series_with_missing==std::vector<size_t>{0, 1});
+    REQUIRE(d.series[0].missing());
+    REQUIRE(d.series[1].missing());
+    REQUIRE_FALSE(d.series[2].missing());
+    const std::vector<F> s0 = values(d.series[0]);
+    REQUIRE((s0[0]==1&&s0[1]==2&&std::isnan(s0[2])&&std::isnan(s0[3])));
+    const std::vector<F> s1 = values(d.series[1]);
+    REQUIRE((s1[0]==5&&std::isnan(s1[1])));
+    REQUIRE(values(d.series[2])==std::vector<F>{7, 8});
+  }
+
+  SECTION("Missing columns") {
+    REQUIRE(error(fixture("univariate"), {"values", std::nullopt}).find("No column 'values'")!=std::string::npos);
+    REQUIRE(error(fixture("univariate"), {"series", "class"}).find("No column 'class'")!=std::string::npos);
+    // The labels are not series
+    REQUIRE(error(fixture("univariate"), {"label", std::nullopt}).find("not a column of lists")!=std::string::npos);
+  }
+}
+
+TEST_CASE("Arrow reader invalid files", "[arrow]") {
+  const std::filesystem::path path = std::filesystem::temp_directory_path()/"arrow_test_invalid.arrow";
+
+  SECTION("Out of bounds") {
+    REQUIRE(error(fixture("bad_buffer")).find("buffer out of the message body")!=std::string::npos);
+    REQUIRE(error(fixture("bad_dictionary_index")).find("dictionary index out of bounds")!=std::string::npos);
+    // Footer larger than the file
+    std::vector<char> bytes = read_bytes(fixture("univariate"));
+    const auto footer_size = (int32_t)bytes.size();
+    std::memcpy(bytes.data() + bytes.size() - 10, &footer_size, sizeof(footer_size));
+    write_bytes(path, bytes);
+    REQUIRE(error(path).find("footer out of bounds")!=std::string::npos);
+  }
+
+  SECTION("Truncated") {
+    const std::vector<char> bytes = read_bytes(fixture("dictionary"));
+    const size_t nb_series = read(fixture("dictionary")).series.size();
+    // Any prefix of the file: without its trailing magic
+    for (size_t size = 0; size<bytes.size(); size += 7) {
+      write_bytes(path, std::vector<char>(bytes.begin(), bytes.begin() + (long)size));
+      error(path);
+    }
+    // The messages cut before the end of the last batch (followed by the end of stream marker), the footer kept:
+    // an error, or fewer series when cut between two messages
+    int32_t footer_size;
+    std::memcpy(&footer_size, bytes.data() + bytes.size() - 10, sizeof(footer_size));
+    const size_t footer = bytes.size() - 10 - (size_t)footer_size;
+    const auto cut_at = [&](size_t cut) {
+      std::vector<char> truncated(bytes.begin(), bytes.begin() + (long)cut);
+      truncated.insert(truncated.end(), bytes.begin() + (long)footer, bytes.end());
+      write_bytes(path, truncated);
+      return read_arrow(path, {});
+    };
+    for (size_t cut = 8; cut<footer - 8; cut += 4) {
+      const auto result = cut_at(cut);
+      REQUIRE((result.index()==0||std::get<1>(result).series.size()<nb_series));
+    }
+    // In the body of the last batch, before the end of stream marker
+    const auto result = cut_at(footer - 8 - 4);
+    REQUIRE(result.index()==0);
+    REQUIRE(std::get<0>(result).find("truncated message body")!=std::string::npos);
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Arrow writer to reader round trip", "[arrow]") {
+  namespace wa = tempo::writer::arrow;
+  constexpr size_t length = 5;
+  const std::filesystem::path path = std::filesystem::temp_directory_path()/"arrow_test_round_trip.arrow";
+  // Two batches of series of the same length, row major, with their labels
+  const std::vector<double> first{0.5, 1, -2, 3.25, 4, 5, 6, 7, 8, 9.5};
+  const std::vector<std::string> first_labels{"x", "y"};
+  const std::vector<double> second{-1, -2, -3, -4, -5};
+  const std::vector<std::string> second_labels{"z"};
+  {
+    std::ofstream out(path, std::ios::binary);
+    wa::IPCWriter writer(out, {{"series", wa::Column::Type::FLOAT64_LIST, length}, {"label", wa::Column::Type::UTF8}});
+    writer.write(2, {{first.data()}, {nullptr, &first_labels}});
+    writer.write(1, {{second.data()}, {nullptr, &second_labels}});
+    writer.close();
+  }
+  const ArrowData d = read(path);
+  REQUIRE(d.series.size()==3);
+  REQUIRE(d.length_min==length);
+  REQUIRE(d.length_max==length);
+  REQUIRE(d.labels==std::vector<std::optional<std::string>>{"x", "y", "z"});
+  REQUIRE(values(d.series[0])==std::vector<F>(first.begin(), first.begin() + length));
+  REQUIRE(values(d.series[1])==std::vector<F>(first.begin() + length, first.end()));
+  REQUIRE(values(d.series[2])==std::vector<F>(second.begin(), second.end()));
+  REQUIRE(d.nb_views==views_of_doubles(3));
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,263 @@
+"""Arrow IPC fixtures of the Arrow reader tests (see arrow.test.cpp), written with the standard library only.
+
+The files follow the Arrow columnar format specification (Schema.fbs, Message.fbs and File.fbs): flatbuffer metadata,
+buffers padded to 8 bytes, little endian. Run from this directory: python3 gen_fixtures.py
+"""
+import struct
+
+# --- --- --- Flatbuffers
+# An object is ('table', [(id, kind, value)]), ('string', str), ('tables', [table]) or ('structs', bytes, count).
+# Scalar kinds: 'u8', 'bool', 'i16', 'i32', 'i64'; 'ref' references an object. The referenced objects follow their
+# referrer, the offsets pointing forward.
+
+SCALARS = {'u8': '<B', 'bool': '<B', 'i16': '<h', 'i32': '<i', 'i64': '<q'}
+
+
+def pad(b, alignment=8):
+    return b + b'\0' * ((-len(b)) % alignment)
+
+
+class Builder:
+    def __init__(self):
+        self.buf = bytearray(8)
+
+    def align(self, alignment):
+        self.buf += b'\0' * ((-len(self.buf)) % alignment)
+
+    def put(self, o):
+        kind = o[0]
+        if kind == 'string':
+            self.align(4)
+            p = len(self.buf)
+            s = o[1].encode()
+            self.buf += struct.pack('<I', len(s)) + s + b'\0'
+            return p
+        if kind == 'tables':
+            self.align(4)
+            p = len(self.buf)
+            self.buf += struct.pack('<I', len(o[1]))
+            slots = []
+            for _ in o[1]:
+                slots.append(len(self.buf))
+                self.buf += b'\0' * 4
+            for slot, t in zip(slots, o[1]):
+                struct.pack_into('<I', self.buf, slot, self.put(t) - slot)
+            return p
+        if kind == 'structs':
+            # Elements on 8 bytes, after the length
+            self.align(8)
+            self.buf += b'\0' * 4
+            p = len(self.buf)
+            self.buf += struct.pack('<I', o[2]) + o[1]
+            return p
+        return self.table(o[1])
+
+    def table(self, fields):
+        nb_ids = max((f[0] for f in fields), default=-1) + 1
+        layout = []
+        size = 4
+        for _, kind, _ in fields:
+            s = 4 if kind == 'ref' else struct.calcsize(SCALARS[kind])
+            size += (-size) % s
+            layout.append(size)
+            size += s
+        size += (-size) % 4
+        vtable = [0] * nb_ids
+        for (fid, _, _), offset in zip(fields, layout):
+            vtable[fid] = offset
+        self.align(2)
+        vt = len(self.buf)
+        self.buf += struct.pack('<HH', 4 + 2 * nb_ids, size) + b''.join(struct.pack('<H', x) for x in vtable)
+        self.align(8)
+        p = len(self.buf)
+        self.buf += b'\0' * size
+        struct.pack_into('<i', self.buf, p, p - vt)
+        refs = []
+        for (_, kind, value), offset in zip(fields, layout):
+            if kind == 'ref':
+                refs.append((p + offset, value))
+            else:
+                struct.pack_into(SCALARS[kind], self.buf, p + offset, value)
+        for slot, o in refs:
+            struct.pack_into('<I', self.buf, slot, self.put(o) - slot)
+        return p
+
+
+def flatbuffer(root):
+    b = Builder()
+    struct.pack_into('<I', b.buf, 0, b.put(root))
+    b.align(8)
+    return bytes(b.buf)
+
+
+# --- --- --- Arrow schema and messages
+
+INT, FLOATING_POINT, UTF8, LIST, FIXED_SIZE_LIST = 2, 3, 5, 12, 16
+SCHEMA, DICTIONARY_BATCH, RECORD_BATCH = 1, 2, 3
+DOUBLE = ('table', [(0, 'i16', 2)])
+SINGLE = ('table', [(0, 'i16', 1)])
+EMPTY = ('table', [])
+
+
+def integer(bits, signed=True):
+    return ('table', [(0, 'i32', bits), (1, 'bool', 1 if signed else 0)])
+
+
+def fixed_size(n):
+    return ('table', [(0, 'i32', n)])
+
+
+def field(name, type_id, type_table, children=(), dictionary=None):
+    fields = [(0, 'ref', ('string', name)), (1, 'bool', 1), (2, 'u8', type_id), (3, 'ref', type_table),
+              (5, 'ref', ('tables', list(children)))]
+    if dictionary is not None:
+        fields.append((4, 'ref', dictionary))
+    return ('table', fields)
+
+
+def dictionary_encoding(did, index_type):
+    return ('table', [(0, 'i64', did), (1, 'ref', index_type)])
+
+
+def schema(fields):
+    return ('table', [(0, 'i16', 0), (1, 'ref', ('tables', fields))])
+
+
+def message(header_type, header, body_size):
+    return flatbuffer(('table', [(0, 'i16', 4), (1, 'u8', header_type), (2, 'ref', header), (3, 'i64', body_size)]))
+
+
+def record_batch(length, nodes, buffers, buffer_sizes=None):
+    """Record batch table and its body. 'nodes': (length, null count) per field; 'buffers': their bytes, whose
+    declared sizes are 'buffer_sizes' if given"""
+    body = b''
+    descriptors = b''
+    for i, b in enumerate(buffers):
+        size = len(b) if buffer_sizes is None else buffer_sizes[i]
+        descriptors += struct.pack('<qq', len(body), size)
+        body += pad(b)
+    node_bytes = b''.join(struct.pack('<qq', n, nulls) for n, nulls in nodes)
+    t = ('table', [(0, 'i64', length), (1, 'ref', ('structs', node_bytes, len(nodes))),
+                   (2, 'ref', ('structs', descriptors, len(buffers)))])
+    return t, body
+
+
+def encapsulated(metadata, body):
+    return struct.pack('<Ii', 0xFFFFFFFF, len(metadata)) + metadata + body
+
+
+def write_file(path, fields, dictionaries, batches):
+    """File format: magic, schema, the dictionaries (id, delta, batch), the record batches, end of stream, footer"""
+    out = b'ARROW1\0\0'
+    out += encapsulated(message(SCHEMA, schema(fields), 0), b'')
+    for did, delta, (t, body) in dictionaries:
+        header = ('table', [(0, 'i64', did), (1, 'ref', t), (2, 'bool', 1 if delta else 0)])
+        out += encapsulated(message(DICTIONARY_BATCH, header, len(body)), body)
+    blocks = b''
+    for t, body in batches:
+        metadata = message(RECORD_BATCH, t, len(body))
+        blocks += struct.pack('<qiiq', len(out), 8 + len(metadata), 0, len(body))
+        out += encapsulated(metadata, body)
+    out += struct.pack('<Ii', 0xFFFFFFFF, 0)
+    footer = flatbuffer(('table', [(0, 'i16', 4), (1, 'ref', schema(fields)), (2, 'ref', ('structs', b'', 0)),
+                                   (3, 'ref', ('structs', blocks, len(batches)))]))
+    out += footer + struct.pack('<i', len(footer)) + b'ARROW1'
+    with open(path, 'wb') as f:
+        f.write(out)
+
+
+# --- --- --- Buffers
+
+def validity(valid):
+    v = 0
+    for i, x in enumerate(valid):
+        if x:
+            v |= 1 << i
+    return v.to_bytes((len(valid) + 7) // 8, 'little')
+
+
+def offsets(lengths):
+    o = [0]
+    for n in lengths:
+        o.append(o[-1] + n)
+    return struct.pack('<%di' % len(o), *o)
+
+
+def doubles(values):
+    return struct.pack('<%dd' % len(values), *values)
+
+
+def floats(values):
+    return struct.pack('<%df' % len(values), *[0 if v is None else v for v in values])
+
+
+def strings(values):
+    chars = ''.join(v or '' for v in values).encode()
+    return offsets([len(v or '') for v in values]), chars
+
+
+def list_of_doubles_batch(series, labels):
+    """Batch of a list<double> column and a utf8 column, the None labels being null"""
+    values = [v for s in series for v in s]
+    label_offsets, label_chars = strings(labels)
+    nb_null = sum(1 for l in labels if l is None)
+    return record_batch(len(series), [(len(series), 0), (len(values), 0), (len(labels), nb_null)],
+                        [b'', offsets([len(s) for s in series]), b'', doubles(values),
+                         validity([l is not None for l in labels]) if nb_null else b'', label_offsets, label_chars])
+
+
+SERIES = field('series', LIST, EMPTY, [field('item', FLOATING_POINT, DOUBLE)])
+
+# Univariate: list<double> series, utf8 labels, two batches, the last label null
+write_file('univariate.arrow', [SERIES, field('label', UTF8, EMPTY)], [], [
+    list_of_doubles_batch([[1, 2, 3], [4, 5]], ['a', 'b']),
+    list_of_doubles_batch([[6, 7, 8, 9]], [None]),
+])
+
+# Multivariate: list<fixed_size_list<double, 2>> series, int32 labels
+points = [[1, 2, 3, 4], [5, 6, 7, 8, 9, 10]]
+values = [v for s in points for v in s]
+write_file('multivariate.arrow', [
+    field('series', LIST, EMPTY,
+          [field('point', FIXED_SIZE_LIST, fixed_size(2), [field('v', FLOATING_POINT, DOUBLE)])]),
+    field('label', INT, integer(32)),
+], [], [record_batch(2, [(2, 0), (5, 0), (10, 0), (2, 0)],
+                     [b'', offsets([2, 3]), b'', b'', doubles(values), b'', struct.pack('<2i', 3, -1)])])
+
+# Dictionary encoded labels: dictionary<utf8, int8>, a null index, a delta dictionary before the second batch
+DICTIONARY_LABEL = field('label', UTF8, EMPTY, [], dictionary_encoding(0, integer(8)))
+
+
+def dictionary(words):
+    o, chars = strings(words)
+    return record_batch(len(words), [(len(words), 0)], [b'', o, chars])
+
+
+def dictionary_batch(series, indices, buffer_sizes=None):
+    values = [v for s in series for v in s]
+    nb_null = sum(1 for i in indices if i is None)
+    buffers = [b'', offsets([len(s) for s in series]), b'', doubles(values),
+               validity([i is not None for i in indices]) if nb_null else b'',
+               struct.pack('<%db' % len(indices), *[0 if i is None else i for i in indices])]
+    nodes = [(len(series), 0), (len(values), 0), (len(indices), nb_null)]
+    return record_batch(len(series), nodes, buffers, buffer_sizes)
+
+
+write_file('dictionary.arrow', [SERIES, DICTIONARY_LABEL],
+           [(0, False, dictionary(['cat', 'dog'])), (0, True, dictionary(['eel']))],
+           [dictionary_batch([[1], [2, 3], [4]], [1, None, 0]), dictionary_batch([[5, 6]], [2])])
+
+# Null values: list<fixed_size_list<float, 2>> column 'x', a null value and a null point, utf8 column 'y'
+x = field('x', LIST, EMPTY, [field('pt', FIXED_SIZE_LIST, fixed_size(2), [field('v', FLOATING_POINT, SINGLE)])])
+values = [1, 2, 3, 4, 5, None, 7, 8]
+y_offsets, y_chars = strings(['p', 'q', 'r'])
+write_file('nulls.arrow', [field('y', UTF8, EMPTY), x], [], [record_batch(
+    3, [(3, 0), (3, 0), (4, 1), (8, 1)],
+    [b'', y_offsets, y_chars, b'', offsets([2, 1, 1]), validity([1, 0, 1, 1]),
+     validity([v is not None for v in values]), floats(values)])])
+
+# Out of bounds: a label buffer declared past the end of the body; a dictionary index past the dictionary
+write_file('bad_buffer.arrow', [SERIES, DICTIONARY_LABEL], [(0, False, dictionary(['cat']))],
+           [dictionary_batch([[1, 2]], [0], [0, 8, 0, 16, 0, 4096])])
+write_file('bad_dictionary_index.arrow', [SERIES, DICTIONARY_LABEL], [(0, False, dictionary(['cat']))],
+           [dictionary_batch([[1, 2]], [1])])
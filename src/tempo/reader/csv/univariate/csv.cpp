@@ -10,4 +10,10 @@ namespace tempo::reader::univariate {
   using F = double;
   template Result<F> read_csv<F>(std::istream&, LabelEncoder const&, CSVReaderParam const&);
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Float implementation
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  using Ff = float;
+  template Result<Ff> read_csv<Ff>(std::istream&, LabelEncoder const&, CSVReaderParam const&);
+
 } // End of namespace tempo::reader
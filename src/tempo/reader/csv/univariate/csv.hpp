@@ -3,7 +3,9 @@
 #include <tempo/utils/utils.hpp>
 #include <tempo/utils/label_encoder.hpp>
 #include <tempo/reader/reader_result.hpp>
+#include <tempo/dataset/tseries.hpp>
 
+#include <filesystem>
 #include <istream>
 #include <set>
 
@@ -25,5 +27,43 @@ namespace tempo::reader::univariate {
   template<std::floating_point F>
   Result<F> read_csv(std::istream& input, LabelEncoder const& other, CSVReaderParam const& params);
 
+  /// Data read by 'read_csv_mapped': as ReaderData, with the series already built, viewing one slab
+  struct SlabReaderData {
+
+    /// Univariate series, in order, with their label and missing flag (see SeriesSlab)
+    std::vector<TSeries> series;
+
+    /// Optionally, if series have labels, the labels (matching series by index)
+    std::optional<std::vector<std::string>> labels;
+
+    /// Label Encoder
+    LabelEncoder encoder;
+
+    /// Indexes of the series containing NaN, in increasing order
+    std::vector<size_t> series_with_nan;
+
+    /// Smallest length read
+    size_t length_min{};
+
+    /// Largest length read
+    size_t length_max{};
+
+    /// Number of bytes read
+    size_t nb_bytes{};
+  };
+
+  /** Read a csv file as 'read_csv', without building the whole document in memory.
+   *  The file is memory mapped, split at line boundaries into chunks parsed by 'nb_threads' threads, and the values
+   *  are parsed directly in one slab: a first pass finds the fields of the rows, a second one converts them.
+   *  Fields may be quoted, but a quoted field can not span several lines. Lines made of blanks are skipped as the
+   *  empty lines.
+   */
+  std::variant<std::string, SlabReaderData> read_csv_mapped(
+    std::filesystem::path const& path,
+    LabelEncoder const& other,
+    CSVReaderParam const& params,
+    size_t nb_threads
+  );
+
 } // End of namespace tempo::reader
 
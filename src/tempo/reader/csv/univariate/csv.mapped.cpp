@@ -0,0 +1,167 @@
+#include "csv.hpp"
+
+#include <tempo/utils/readingtools.hpp>
+#include <tempo/utils/utils/mapped_file.hpp>
+
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+namespace tempo::reader::univariate {
+
+  namespace {
+
+    /// Trim the blanks (excluding newline, absent from the lines) of both ends
+    std::string_view trim_view(std::string_view sv) {
+      while (!sv.empty()&&is_white(sv.front())) { sv.remove_prefix(1); }
+      while (!sv.empty()&&is_white(sv.back())) { sv.remove_suffix(1); }
+      return sv;
+    }
+
+    /// Next line of [begin, end[, without its end of line; 'begin' is moved after it
+    std::string_view next_line(char const *& begin, char const *end) {
+      auto *nl = static_cast<char const *>(std::memchr(begin, '\n', end - begin));
+      std::string_view line(begin, (nl==nullptr ? end : nl) - begin);
+      begin = nl==nullptr ? end : nl + 1;
+      return line;
+    }
+
+    /// Empty lines and comment lines are skipped
+    bool is_skipped(std::string_view line, CSVReaderParam const& params) {
+      line = trim_view(line);
+      return line.empty()||params.comment_skip.contains(line.front());
+    }
+
+    /// Call 'fun' on each field of the line, trimmed, the separators in double quotes being part of their field.
+    /// Return the number of fields.
+    template<typename Fun>
+    size_t for_each_field(std::string_view line, char sep, Fun&& fun) {
+      size_t nb_fields = 0;
+      size_t start = 0;
+      bool quoted = false;
+      for (size_t i = 0; i<=line.size(); ++i) {
+        if (i==line.size()||(!quoted&&line[i]==sep)) {
+          fun(trim_view(line.substr(start, i - start)));
+          ++nb_fields;
+          start = i + 1;
+        } else if (line[i]=='"') { quoted = !quoted; }
+      }
+      return nb_fields;
+    }
+
+    /// Value of a field: strip the enclosing double quotes, unescaping the double quotes inside
+    std::string unquote(std::string_view field) {
+      if (field.size()<2||field.front()!='"'||field.back()!='"') { return std::string(field); }
+      std::string result;
+      field = field.substr(1, field.size() - 2);
+      for (size_t i = 0; i<field.size(); ++i) {
+        result.push_back(field[i]);
+        if (field[i]=='"'&&i + 1<field.size()&&field[i + 1]=='"') { ++i; }
+      }
+      return result;
+    }
+
+    /// A row found by the first pass
+    struct Row {
+      std::string_view line;
+      size_t nb_fields;
+    };
+
+  } // End of anonymous namespace
+
+  std::variant<std::string, SlabReaderData> read_csv_mapped(
+    std::filesystem::path const& path,
+    LabelEncoder const& other,
+    CSVReaderParam const& params,
+    size_t nb_threads
+  ) {
+    std::unique_ptr<utils::MappedFile> file;
+    try { file = std::make_unique<utils::MappedFile>(path); }
+    catch (std::exception const& e) { return {e.what()}; }
+    nb_threads = std::max<size_t>(nb_threads, 1);
+    const bool has_label = params.label_position!=NONE;
+
+    // --- --- --- Skip the header line
+    char const *begin = file->data();
+    char const *const end = begin + file->size();
+    if (params.has_header) {
+      while (begin<end&&is_skipped(next_line(begin, end), params)) {}
+    }
+
+    // --- --- --- First pass: rows and their number of fields, per chunk
+    const std::vector<char const *> bounds = line_chunks(begin, end, nb_threads);
+    const size_t nb_chunks = bounds.size() - 1;
+    std::vector<std::vector<Row>> chunk_rows(nb_chunks);
+    utils::ParTasks().execute((int)nb_threads, [&](size_t k) {
+      char const *p = bounds[k];
+      while (p<bounds[k + 1]) {
+        std::string_view line = next_line(p, bounds[k + 1]);
+        if (is_skipped(line, params)) { continue; }
+        chunk_rows[k].push_back({line, for_each_field(line, params.field_sep, [](std::string_view) {})});
+      }
+    }, 0, nb_chunks);
+
+    // Offsets of the rows, and of their values in the slab
+    std::vector<size_t> row_offsets(nb_chunks + 1, 0);
+    for (size_t k = 0; k<nb_chunks; ++k) { row_offsets[k + 1] = row_offsets[k] + chunk_rows[k].size(); }
+    const size_t nb_rows = row_offsets.back();
+    std::vector<size_t> value_offsets(nb_rows + 1, 0);
+    SlabReaderData r;
+    r.length_min = std::numeric_limits<size_t>::max();
+    for (size_t k = 0; k<nb_chunks; ++k) {
+      for (size_t i = 0; i<chunk_rows[k].size(); ++i) {
+        const size_t length = chunk_rows[k][i].nb_fields - (has_label ? 1 : 0);
+        const size_t row = row_offsets[k] + i;
+        value_offsets[row + 1] = value_offsets[row] + length;
+        r.length_min = std::min(r.length_min, length);
+        r.length_max = std::max(r.length_max, length);
+      }
+    }
+
+    // --- --- --- Second pass: convert the fields, directly in the slab
+    const SeriesSlab slab(value_offsets.back());
+    std::vector<std::string> labels(has_label ? nb_rows : 0);
+    std::vector<char> missing(nb_rows, 0);
+    utils::ParTasks().execute((int)nb_threads, [&](size_t k) {
+      for (size_t i = 0; i<chunk_rows[k].size(); ++i) {
+        const Row& rinfo = chunk_rows[k][i];
+        const size_t row = row_offsets[k] + i;
+        F *out = slab.data + value_offsets[row];
+        const size_t label_field = params.label_position==FIRST ? 0 : rinfo.nb_fields - 1;
+        size_t field = 0;
+        for_each_field(rinfo.line, params.field_sep, [&](std::string_view str) {
+          if (has_label&&field==label_field) { labels[row] = unquote(str); }
+          else {
+            // As 'read_csv': a field that can not be converted is a missing value
+            std::optional<double> od = (!str.empty()&&str.front()=='"') ? as_double(unquote(str)) : as_double(str);
+            if (od) { *out = (F)od.value(); }
+            else {
+              *out = std::numeric_limits<F>::quiet_NaN();
+              missing[row] = 1;
+            }
+            ++out;
+          }
+          ++field;
+        });
+      }
+    }, 0, nb_chunks);
+
+    // --- --- --- Series, viewing the slab
+    r.series.reserve(nb_rows);
+    for (size_t row = 0; row<nb_rows; ++row) {
+      if (missing[row]) { r.series_with_nan.push_back(row); }
+      std::optional<std::string> label = has_label ? std::optional<std::string>(labels[row]) : std::nullopt;
+      r.series.push_back(TSeries::mk_view(slab.capsule, slab.data + value_offsets[row], 1,
+                                          value_offsets[row + 1] - value_offsets[row], std::move(label),
+                                          {missing[row]!=0}));
+    }
+    if (nb_rows==0) { r.length_min = 0; }
+    if (has_label) {
+      r.encoder = LabelEncoder(other, labels);
+      r.labels = std::move(labels);
+    } else { r.encoder = other; }
+    r.nb_bytes = file->size();
+    return {std::move(r)};
+  }
+
+} // End of namespace tempo::reader::univariate
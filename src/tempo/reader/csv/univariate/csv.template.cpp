@@ -85,7 +85,7 @@ namespace tempo::reader::univariate {
       length_max = std::max(length_max, row_length);
 
       // Extract label and data
-      std::vector<double> data(row.size() - 1);
+      SData data(row.size() - 1);
       std::optional<std::string> label = std::nullopt;
       bool flag = false;
 
@@ -1,68 +1,132 @@
 #include "dts.reader.hpp"
 
+#include <tempo/transform/pipeline.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <stdexcept>
+
 namespace tempo::reader::dataset {
 
-  Result load(std::variant<ts_ucr, csv> config) {
+  namespace {
+
+    /// Paths of the splits of a configuration, and how to read one
+    struct Splits {
+      std::filesystem::path train_path;
+      std::filesystem::path test_path;
+      std::function<std::variant<std::string, DTS>(std::filesystem::path const&, std::string const&)> load_split;
+    };
+
+    Splits resolve(Config const& config, size_t nb_threads) {
+      Splits splits;
+      if (config.index()==0) {
+        ts_ucr conf = std::get<0>(config);
+        std::filesystem::path dataset_path = conf.ucr_dir/conf.name;
+        splits.train_path = dataset_path/(conf.name + "_TRAIN.ts");
+        splits.test_path = dataset_path/(conf.name + "_TEST.ts");
+        splits.load_split = [nb_threads](std::filesystem::path const& path, std::string const& split_name) {
+          return load_udataset_ts(path, split_name, {}, nb_threads);
+        };
+      } else if (config.index()==1) {
+        csv conf = std::get<1>(config);
+        splits.train_path = conf.path_to_train;
+        splits.test_path = conf.path_to_test;
+        splits.load_split = [conf, nb_threads](std::filesystem::path const& path, std::string const& split_name) {
+          return load_udataset_csv(path, conf.dataset_name, split_name, {}, conf.csv_skip_header,
+                                   conf.csv_separator, {'%', '@'}, nb_threads);
+        };
+      } else if (config.index()==2) {
+        bin conf = std::get<2>(config);
+        splits.train_path = conf.path_to_train;
+        splits.test_path = conf.path_to_test;
+        splits.load_split = [nb_threads](std::filesystem::path const& path, std::string const&) {
+          return load_dataset_bin(path, nb_threads);
+        };
+      } else if (config.index()==3) {
+        arrow_ipc conf = std::get<3>(config);
+        splits.train_path = conf.path_to_train;
+        splits.test_path = conf.path_to_test;
+        splits.load_split = [conf, nb_threads](std::filesystem::path const& path, std::string const& split_name) {
+          return load_dataset_arrow(path, conf.dataset_name, split_name, conf.columns, {}, nb_threads);
+        };
+      } else { tempo::utils::should_not_happen(); }
+      return splits;
+    }
+
+  } // End of anonymous namespace
+
+  Result load(Config config, size_t nb_threads) {
 
     // Helper function to make an error
     auto make_error = [](std::string msg) -> Result {
       return Result(std::in_place_index<0>, "Error: " + std::move(msg));
     };
 
-    // Helper load CSV
-    auto load_csv = [](csv& conf, std::filesystem::path csvpath, std::string const& split_name) {
-      return load_udataset_csv(csvpath, conf.dataset_name, split_name, {}, conf.csv_skip_header,
-                               conf.csv_separator);
+    const Splits splits = resolve(config, nb_threads);
+    std::filesystem::path const& train_path = splits.train_path;
+    std::filesystem::path const& test_path = splits.test_path;
+
+    // Read a split, timing it
+    auto timed_load = [&splits](std::filesystem::path const& path, std::string const& split_name) {
+      auto start = utils::now();
+      auto variant = splits.load_split(path, split_name);
+      return std::pair{std::move(variant), utils::now() - start};
     };
 
+    // --- --- --- Read both splits concurrently: the test split in its own thread, the train split in this one.
+    // The splits do not share their label encoder, so the reads are independent.
     TrainTest result;
     {
       auto start = utils::now();
-      if (config.index()==0) {
-        ts_ucr conf = std::get<0>(config);
-        std::filesystem::path dataset_path = conf.ucr_dir/conf.name;
-        // --- --- --- Read train
-        {
-          std::filesystem::path train_path = dataset_path/(conf.name + "_TRAIN.ts");
-          auto variant_train = load_udataset_ts(train_path, "train");
-          if (variant_train.index()==1) { result.train_dataset = std::get<1>(variant_train); }
-          else { return make_error("train set '" + train_path.string() + "': " + std::get<0>(variant_train)); }
-        }
-        // --- --- --- Read test
-        {
-          std::filesystem::path test_path = dataset_path/(conf.name + "_TEST.ts");
-          auto variant_test = load_udataset_ts(test_path, "test");
-          if (variant_test.index()==1) { result.test_dataset = std::get<1>(variant_test); }
-          else { return make_error("test set '" + test_path.string() + "': " + std::get<0>(variant_test)); }
-        }
-      } else if (config.index()==1) {
-        csv conf = std::get<1>(config);
-        // --- --- --- Read train
-        {
-          auto variant_train = load_csv(conf, conf.path_to_train, "train");
-          if (variant_train.index()==1) { result.train_dataset = std::get<1>(variant_train); }
-          else { return make_error("train set '" + conf.path_to_train.string() + "': " + std::get<0>(variant_train)); }
-        }
-        // --- --- --- Read test
-        {
-          auto variant_test = load_csv(conf, conf.path_to_test, "test");
-          if (variant_test.index()==1) { result.test_dataset = std::get<1>(variant_test); }
-          else { return make_error("test set '" + conf.path_to_test.string() + "': " + std::get<0>(variant_test)); }
-        }
-      } else { tempo::utils::should_not_happen(); }
+      auto future_test = std::async(std::launch::async, timed_load, std::cref(test_path), std::string("test"));
+      auto [variant_train, train_time] = timed_load(train_path, "train");
+      auto [variant_test, test_time] = future_test.get();
       result.load_time = utils::now() - start;
+      result.train_load_time = train_time;
+      result.test_load_time = test_time;
+
+      if (variant_train.index()==1) { result.train_dataset = std::get<1>(std::move(variant_train)); }
+      else { return make_error("train set '" + train_path.string() + "': " + std::get<0>(variant_train)); }
+      if (variant_test.index()==1) { result.test_dataset = std::get<1>(std::move(variant_test)); }
+      else { return make_error("test set '" + test_path.string() + "': " + std::get<0>(variant_test)); }
+    }
+
+    // --- --- --- Bytes read
+    for (const auto& path : {train_path, test_path}) {
+      std::error_code ec;
+      const auto size = std::filesystem::file_size(path, ec);
+      if (!ec) { result.load_bytes += size; }
     }
 
     return {result};
   }
 
-  std::vector<std::string> sanity_check(TrainTest const& train_test) {
-    DatasetHeader const& train_header = train_test.train_dataset.header();
-    DatasetHeader const& test_header = train_test.test_dataset.header();
-    auto [train_bcm, train_bcm_remains] = train_test.train_dataset.get_BCM();
+  std::variant<std::string, DTS> load_train(Config const& config, size_t nb_threads) {
+    Splits splits = resolve(config, nb_threads);
+    auto variant_train = splits.load_split(splits.train_path, "train");
+    if (variant_train.index()==0) {
+      return {"Error: train set '" + splits.train_path.string() + "': " + std::get<0>(variant_train)};
+    }
+    return variant_train;
+  }
+
+  std::variant<std::string, DTS> load_test(Config const& config, size_t nb_threads) {
+    Splits splits = resolve(config, nb_threads);
+    auto variant_test = splits.load_split(splits.test_path, "test");
+    if (variant_test.index()==0) {
+      return {"Error: test set '" + splits.test_path.string() + "': " + std::get<0>(variant_test)};
+    }
+    return variant_test;
+  }
+
+  std::filesystem::path test_path(Config const& config) { return resolve(config, 1).test_path; }
+
+  std::vector<std::string> sanity_check(DTS const& train_dataset) {
+    DatasetHeader const& train_header = train_dataset.header();
     std::vector<std::string> errors = {};
 
-    if (!train_bcm_remains.empty()) {
+    if (train_header.nb_unlabelled()>0) {
       errors.emplace_back("Could not take the By Class Map for all train exemplar (exemplar without label)");
     }
 
@@ -74,6 +138,102 @@ namespace tempo::reader::dataset {
       errors.emplace_back("Train set: missing data");
     }
 
+    return errors;
+  }
+
+  Resamples::Resamples(std::shared_ptr<TrainTest const> const& data) {
+    DTS const& train = data->train_dataset;
+    DTS const& test = data->test_dataset;
+    const utils::Capsule capsule = utils::make_capsule<std::shared_ptr<TrainTest const>>(data);
+    TSData tsdata;
+    tsdata.problem_name = train.get_dataset_name();
+    tsdata.nb_dimensions = train.header().nb_dimensions();
+    for (DTS const *split : {&train, &test}) {
+      for (size_t i = 0; i<split->size(); ++i) {
+        TSeries const& s = (*split)[i];
+        if (!s.label()) { throw std::invalid_argument("Resampling a dataset with unlabelled series"); }
+        if (s.missing()) { tsdata.series_with_missing_values.push_back(tsdata.series.size()); }
+        tsdata.shortest_length = std::min(tsdata.shortest_length, s.length());
+        tsdata.longest_length = std::max(tsdata.longest_length, s.length());
+        tsdata.labels.insert(s.label().value());
+        tsdata.series.push_back(
+          TSeries::mk_view(capsule, s.data(), s.nb_dimensions(), s.length(), s.label(), {s.missing()})
+        );
+      }
+    }
+    _nb_train = train.size();
+    // Same encoding as the original train split
+    DTS all = tsdata_to_dts(std::move(tsdata), "merged", train.header().label_encoder());
+    for (size_t i = 0; i<_nb_train; ++i) { train_per_class[all.label(i).value()]++; }
+    transforms.emplace("default", std::move(all));
+  }
+
+  void Resamples::add_transform(std::string const& name, DTS dts) {
+    if (dts.size()!=merged().size()) {
+      throw std::invalid_argument("Transform " + name + " does not have the size of the merged dataset");
+    }
+    transforms.insert_or_assign(name, std::move(dts));
+  }
+
+  Resamples::Fold Resamples::fold(size_t f) const {
+    std::vector<size_t> train_idx;
+    std::vector<size_t> test_idx;
+    if (f==0) {
+      train_idx = IndexSet(_nb_train).vector();
+      test_idx = IndexSet(_nb_train, merged().size() - _nb_train).vector();
+    } else {
+      PRNG prng(f);
+      auto [bcm, _] = merged().get_BCM();
+      train_idx = bcm.stratified_draw(train_per_class, prng).to_IndexSet().vector();
+      // Complement, in increasing order
+      auto it = train_idx.begin();
+      for (size_t i = 0; i<merged().size(); ++i) {
+        if (it!=train_idx.end()&&*it==i) { ++it; } else { test_idx.push_back(i); }
+      }
+    }
+    const IndexSet train_is(std::move(train_idx));
+    const IndexSet test_is(std::move(test_idx));
+    Fold result;
+    for (auto const& [name, dts] : transforms) {
+      result.train.emplace(name, DTS(dts, "train", train_is));
+      result.test.emplace(name, DTS(dts, "test", test_is));
+    }
+    return result;
+  }
+
+  DTS resample(DTS const& dts, size_t length, LabelEncoder const& encoder, size_t nb_threads) {
+    auto resampled = transform::transform_resample(dts, length, nb_threads);
+    DTS const& rdts = resampled.begin()->second;
+    // The new series view the slab of the transform, kept alive by the new dataset
+    const utils::Capsule capsule = utils::make_capsule<DTS>(rdts);
+    TSData tsdata;
+    tsdata.problem_name = dts.get_dataset_name();
+    tsdata.nb_dimensions = dts.header().nb_dimensions();
+    tsdata.shortest_length = length;
+    tsdata.longest_length = length;
+    tsdata.series.reserve(rdts.size());
+    for (size_t i = 0; i<rdts.size(); ++i) {
+      TSeries const& s = rdts[i];
+      if (s.label()) { tsdata.labels.insert(s.label().value()); }
+      tsdata.series.push_back(TSeries::mk_view(capsule, s.data(), s.nb_dimensions(), s.length(), s.label(), {false}));
+    }
+    return tsdata_to_dts(std::move(tsdata), dts.get_split_name(), encoder);
+  }
+
+  TrainTest resample(TrainTest const& train_test, size_t length, size_t nb_threads) {
+    DTS const& train = train_test.train_dataset;
+    if (length==0) { length = train.header().length_max(); }
+    LabelEncoder const& encoder = train.header().label_encoder();
+    TrainTest result = train_test;
+    result.train_dataset = resample(train, length, encoder, nb_threads);
+    result.test_dataset = resample(train_test.test_dataset, length, encoder, nb_threads);
+    return result;
+  }
+
+  std::vector<std::string> sanity_check_test(DTS const& test_dataset) {
+    DatasetHeader const& test_header = test_dataset.header();
+    std::vector<std::string> errors = {};
+
     if (test_header.variable_length()) {
       errors.emplace_back("Test set: variable length");
     }
@@ -85,4 +245,10 @@ namespace tempo::reader::dataset {
     return errors;
   }
 
+  std::vector<std::string> sanity_check(TrainTest const& train_test) {
+    std::vector<std::string> errors = sanity_check(train_test.train_dataset);
+    for (std::string& e : sanity_check_test(train_test.test_dataset)) { errors.push_back(std::move(e)); }
+    return errors;
+  }
+
 } // End of namespace tempo::reader
\ No newline at end of file
@@ -23,24 +23,114 @@ namespace tempo::reader::dataset {
     std::string name;
   };
 
+  /// Configuration to read a train/test dataset from two files in the binary dataset format (see writer::bin)
+  struct bin {
+    std::filesystem::path path_to_train{};
+    std::filesystem::path path_to_test{};
+  };
+
+  /// Configuration to read a train/test dataset from two Arrow IPC files (see load_dataset_arrow)
+  struct arrow_ipc {
+    std::filesystem::path path_to_train{};
+    std::filesystem::path path_to_test{};
+    std::string dataset_name;
+    tempo::reader::arrow::ArrowColumns columns;
+  };
+
+  /// Configuration of a train/test dataset
+  using Config = std::variant<ts_ucr, csv, bin, arrow_ipc>;
+
   /// Result when successfully reading a dataset
   struct TrainTest {
     DTS train_dataset;
     DTS test_dataset;
     tempo::utils::duration_t load_time;
+    /// Time spent reading each split: the splits are read concurrently, so their sum may exceed 'load_time'
+    tempo::utils::duration_t train_load_time;
+    tempo::utils::duration_t test_load_time;
+    /// Size of the files read, in bytes: with 'load_time', the load throughput
+    size_t load_bytes{0};
   };
 
   /// Result of loading a train/test dataset. On failure, return a string, else, return a TrainTest
   using Result = std::variant<std::string, TrainTest>;
 
   /// Load a train/test dataset from a configuration
-  Result load(std::variant<ts_ucr, csv> config);
+  /// The train and test splits are read concurrently.
+  /// TS and CSV files are parsed, compressed binary files decoded, and Arrow IPC files scanned, with 'nb_threads'
+  /// threads (see load_udataset_ts, load_udataset_csv, load_dataset_bin and load_dataset_arrow)
+  Result load(Config config, size_t nb_threads = 1);
+
+  /// Load the train split only, e.g. when the test split is read by blocks (see TSBlockReader)
+  std::variant<std::string, DTS> load_train(Config const& config, size_t nb_threads = 1);
+
+  /// Load the test split only, e.g. on a thread of its own while training on the train split (see load_train)
+  std::variant<std::string, DTS> load_test(Config const& config, size_t nb_threads = 1);
+
+  /// Path of the test file of a configuration
+  std::filesystem::path test_path(Config const& config);
 
-  /// Basic check on the dataset
+  /** In-process resamples of a train/test dataset, without rewriting any file.
+   *  The train series, then the test series, are merged (viewed, not copied) into a single dataset. The transforms
+   *  are computed once on the merged dataset (see add_transform) and shared by all the folds, which only view it.
+   *  Fold 0 is the original split. The other folds are stratified draws seeded by the fold number, with as many
+   *  train series per class as the original train split (see ByClassMap::stratified_draw); the test split gets the
+   *  other series.
+   */
+  class Resamples {
+  public:
+
+    /// Splits of a fold, by transform name ("default" for the series themselves)
+    struct Fold {
+      std::map<std::string, DTS> train;
+      std::map<std::string, DTS> test;
+    };
+
+    /// Merge the splits of 'data', kept alive by the merged dataset.
+    /// Throws std::invalid_argument if a test series has no label (it could not be drawn into a train split).
+    explicit Resamples(std::shared_ptr<TrainTest const> const& data);
+
+    /// The merged dataset
+    DTS const& merged() const { return transforms.at("default"); }
+
+    /// Number of series of the original train split, first in 'merged'
+    size_t nb_train() const { return _nb_train; }
+
+    /// Add a transform computed on 'merged()' (e.g. with transform::transform_all), shared by the folds.
+    /// Throws std::invalid_argument if 'dts' does not have the size of the merged dataset.
+    void add_transform(std::string const& name, DTS dts);
+
+    /// Train and test splits of fold 'f', for all the transforms
+    Fold fold(size_t f) const;
+
+  private:
+    std::map<std::string, DTS> transforms;
+    size_t _nb_train;
+    std::map<EL, size_t> train_per_class;
+  };
+
+  /** Resample the series of a split to 'length' values per dimension, with their missing values filled (see
+   *  transform::transform_resample), as a new split of equal length series without missing value, with exact headers.
+   *  The labels are encoded with 'encoder' (e.g. the one of the train split when resampling the test split).
+   *  Throws std::invalid_argument on a length below 2.
+   */
+  DTS resample(DTS const& dts, size_t length, LabelEncoder const& encoder, size_t nb_threads = 1);
+
+  /// Resample both splits (see above) to 'length', or to the longest train length if 0, with the train label encoder.
+  /// Lets the datasets of variable length or with missing values pass the sanity checks.
+  TrainTest resample(TrainTest const& train_test, size_t length, size_t nb_threads = 1);
+
+  /// Basic check on the dataset, from the properties recorded by the headers while reading (no scan of the series)
   /// Return a vector of messages, each one being an error:
   /// * "Could not take the By Class Map for all train exemplar (exemplar without label)"
   /// * "Train set: variable length or missing data"
   /// * "Test set: variable length or missing data"
   std::vector<std::string> sanity_check(TrainTest const& train_test);
 
+  /// Checks of sanity_check on the train split only
+  std::vector<std::string> sanity_check(DTS const& train_dataset);
+
+  /// Checks of sanity_check on the test split only
+  std::vector<std::string> sanity_check_test(DTS const& test_dataset);
+
 } // End of namespace tempo::reader
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "reader.hpp"
+
+#include <tempo/writer/bin/bin.hpp>
+#include <tempo/writer/ts/ts.hpp>
+
+#include <mock/mockseries.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Benchmarks of the dataset readers and writers: TS, CSV (univariate only) and the binary format (plain and
+// compressed), on mock datasets of several series lengths and numbers of dimensions.
+// The readers read files written once in a temporary directory (hot in the page cache): they measure the parsing,
+// not the disk. The writers write in memory.
+// Besides the timings of Catch2, each benchmark prints its throughput, in MB/s (of the file) and series/s, measured
+// over a few runs: run with e.g. 'libtempo-bench "[io]" --reporter JSON::out=io.json' to track them over time.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+using namespace tempo;
+
+namespace {
+
+  constexpr size_t nbseries = 512;
+  constexpr size_t nbruns = 5;
+  const std::vector<size_t> lengths{64, 512, 2048};
+  const std::vector<size_t> dimensions{1, 4};
+
+  /// Mock split of 'nbseries' series of 'length' points and 'ndim' dimensions, with values in [0, 2[ and 4 classes.
+  /// Same split for the same parameters.
+  DTS make_split(size_t length, size_t ndim) {
+    mock::Mocker mocker(0);
+    mocker._fixl = length;
+    mocker._dim = ndim;
+    reader::TSData tsdata;
+    tsdata.problem_name = {"bench"};
+    tsdata.nb_dimensions = ndim;
+    tsdata.shortest_length = length;
+    tsdata.longest_length = length;
+    const auto values = mocker.vec_randvec(nbseries);
+    for (size_t i = 0; i<nbseries; ++i) {
+      const std::string label = "c" + std::to_string(i%4);
+      std::vector<F> v(values[i].begin(), values[i].end());
+      tsdata.series.push_back(TSeries::mk_from_rowmajor(std::move(v), ndim, {label}, {false}));
+    }
+    return reader::tsdata_to_dts(std::move(tsdata), "bench");
+  }
+
+  /// Univariate split in the CSV format of load_udataset_csv, the label first
+  std::string to_csv(DTS const& split) {
+    std::ostringstream out;
+    out.precision(17);
+    for (size_t i = 0; i<split.size(); ++i) {
+      TSeries const& ts = split[i];
+      out << ts.label().value();
+      for (size_t j = 0; j<ts.length(); ++j) { out << ',' << ts[j]; }
+      out << '\n';
+    }
+    return out.str();
+  }
+
+  /// Temporary file of a benchmark, written with 'content'
+  std::filesystem::path write_file(std::string const& name, std::string const& content) {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path()/"tempo-io-bench";
+    std::filesystem::create_directories(dir);
+    const std::filesystem::path path = dir/name;
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+    return path;
+  }
+
+  /// Name of a benchmark made of its parameters
+  std::string bench_name(std::string const& what, size_t length, size_t ndim, size_t nb_bytes) {
+    return what + " length=" + std::to_string(length) + " ndim=" + std::to_string(ndim) + " series="
+           + std::to_string(nbseries) + " MB=" + std::to_string((double)nb_bytes/1e6);
+  }
+
+  /// Benchmark 'fun', processing 'nb_bytes' bytes of a file, and print its throughput.
+  /// 'fun' returns a size (e.g. of the split read), checked against 'expected' to catch a failing reader.
+  void bench_io(std::string const& name, size_t nb_bytes, size_t expected, std::function<size_t()> const& fun) {
+    REQUIRE(fun()==expected);
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r<nbruns; ++r) { fun(); }
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/nbruns;
+    std::cout << name << ": " << (double)nb_bytes/1e6/s << " MB/s, " << (double)nbseries/s << " series/s"
+              << std::endl;
+    BENCHMARK(name) { return fun(); };
+  }
+
+  /// Size of a read split, or 0 on error
+  size_t split_size(std::variant<std::string, DTS> const& result) {
+    return result.index()==1 ? std::get<1>(result).size() : 0;
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Readers
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Benchmark TS reader", "[bench][io][ts]") {
+  for (size_t length : lengths) {
+    for (size_t ndim : dimensions) {
+      const DTS split = make_split(length, ndim);
+      std::ostringstream out;
+      REQUIRE_FALSE(tempo::univariate::writer::write(split, "bench", out).has_value());
+      const std::string content = out.str();
+      const auto path = write_file("bench_" + std::to_string(length) + "_" + std::to_string(ndim) + ".ts", content);
+      for (size_t nbt : {1, 4}) {
+        bench_io(bench_name("read ts threads=" + std::to_string(nbt), length, ndim, content.size()),
+                 content.size(), nbseries,
+                 [&]() { return split_size(reader::load_udataset_ts(path, "bench", {}, nbt)); });
+      }
+    }
+  }
+}
+
+TEST_CASE("Benchmark CSV reader", "[bench][io][csv]") {
+  for (size_t length : lengths) {
+    const DTS split = make_split(length, 1);
+    const std::string content = to_csv(split);
+    const auto path = write_file("bench_" + std::to_string(length) + ".csv", content);
+    for (size_t nbt : {1, 4}) {
+      bench_io(bench_name("read csv threads=" + std::to_string(nbt), length, 1, content.size()),
+               content.size(), nbseries,
+               [&]() {
+                 return split_size(reader::load_udataset_csv(path, "bench", "bench", {}, false, ',', {'%', '@'}, nbt));
+               });
+    }
+  }
+}
+
+TEST_CASE("Benchmark binary reader", "[bench][io][bin]") {
+  // The plain format is memory mapped (nothing is parsed but the header): the series are summed to read them
+  for (size_t length : lengths) {
+    for (size_t ndim : dimensions) {
+      const DTS split = make_split(length, ndim);
+      for (bool compressed : {false, true}) {
+        std::ostringstream out;
+        std::optional<size_t> block;
+        if (compressed) { block = {writer::bin::block_values}; }
+        REQUIRE_FALSE(writer::bin::write(split, out, block).has_value());
+        const std::string content = out.str();
+        const std::string variant = compressed ? "compressed" : "plain";
+        const auto path = write_file("bench_" + std::to_string(length) + "_" + std::to_string(ndim) + "_" + variant
+                                     + ".bin", content);
+        bench_io(bench_name("read bin " + variant, length, ndim, content.size()), content.size(), nbseries, [&]() {
+          auto result = reader::load_dataset_bin(path, 1);
+          if (result.index()!=1) { return size_t(0); }
+          DTS const& dts = std::get<1>(result);
+          F sum = 0;
+          for (size_t i = 0; i<dts.size(); ++i) {
+            F const *values = dts[i].data();
+            for (size_t k = 0; k<dts[i].size(); ++k) { sum += values[k]; }
+          }
+          return sum>=0 ? dts.size() : 0;
+        });
+      }
+    }
+  }
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Writers
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Benchmark TS writer", "[bench][io][ts]") {
+  for (size_t length : lengths) {
+    for (size_t ndim : dimensions) {
+      const DTS split = make_split(length, ndim);
+      for (size_t nbt : {1, 4}) {
+        const auto write = [&]() {
+          std::ostringstream out;
+          tempo::univariate::writer::write(split, "bench", out, nbt);
+          return out.str().size();
+        };
+        const size_t nb_bytes = write();
+        bench_io(bench_name("write ts threads=" + std::to_string(nbt), length, ndim, nb_bytes), nb_bytes, nb_bytes,
+                 write);
+      }
+    }
+  }
+}
+
+TEST_CASE("Benchmark binary writer", "[bench][io][bin]") {
+  for (size_t length : lengths) {
+    for (size_t ndim : dimensions) {
+      const DTS split = make_split(length, ndim);
+      for (bool compressed : {false, true}) {
+        std::optional<size_t> block;
+        if (compressed) { block = {writer::bin::block_values}; }
+        for (size_t nbt : {1, 4}) {
+          const auto write = [&]() {
+            std::ostringstream out;
+            writer::bin::write(split, out, block, nbt);
+            return out.str().size();
+          };
+          const size_t nb_bytes = write();
+          const std::string what = std::string("write bin ") + (compressed ? "compressed" : "plain") + " threads="
+                                   + std::to_string(nbt);
+          bench_io(bench_name(what, length, ndim, nb_bytes), nb_bytes, nb_bytes, write);
+        }
+      }
+    }
+  }
+}
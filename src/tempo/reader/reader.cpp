@@ -4,61 +4,291 @@
 #include "csv/univariate/csv.hpp"
 #include "ts/ts.hpp"
 
+#include <tempo/utils/utils/mapped_file.hpp>
+#include <tempo/writer/bin/bin.hpp>
+
+#include <cstring>
+
 
 namespace tempo::reader {
 
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
-  /// Read a TS file - univariate only
+  /// Read a TS file - univariate or multivariate (all the dimensions of a series have the same length)
   /// Can use an existing label encoder.
-  /// TODO: fix reader for multivariate, it is broken
   std::variant<std::string, DTS> load_udataset_ts(
     std::filesystem::path const& path,
     std::string const& split_name,
-    LabelEncoder const& encoder
+    LabelEncoder const& encoder,
+    size_t nb_threads
   ) {
     if( !(std::filesystem::exists(path) && std::filesystem::is_regular_file(path)) ){
       return {"Could not read file " + path.string()};
     }
 
-    std::variant<std::string, TSData> vts = load_tsdata(path);
+    std::variant<std::string, TSData> vts = load_tsdata_mapped(path, nb_threads);
 
     if (vts.index()==1) {
-      TSData tsdata = std::move(std::get<1>(vts));
+      return {tsdata_to_dts(std::move(std::get<1>(vts)), split_name, encoder)};
+    } else {
+      return {std::get<0>(vts)};
+    }
+  }
 
-      // Build label vector
-      std::vector<std::optional<std::string>> vlabels;
-      vlabels.reserve(tsdata.series.size());
-      for (const auto& ts : tsdata.series) { vlabels.emplace_back(ts.label()); }
+  DTS tsdata_to_dts(TSData&& tsdata, std::string const& split_name, LabelEncoder const& encoder) {
+    // Build label vector
+    std::vector<std::optional<std::string>> vlabels;
+    vlabels.reserve(tsdata.series.size());
+    for (const auto& ts : tsdata.series) { vlabels.emplace_back(ts.label()); }
+
+    // Build Header
+    std::shared_ptr<DatasetHeader> header = std::make_shared<DatasetHeader>(
+      tsdata.problem_name.value_or("Anonymous"),
+      tsdata.shortest_length,
+      tsdata.longest_length,
+      tsdata.nb_dimensions,
+      std::move(vlabels),
+      std::move(tsdata.series_with_missing_values),
+      encoder
+    );
+
+    // Build Transform (raw data, "default")
+    std::shared_ptr<DatasetTransform<TSeries>> rawd = std::make_shared<DatasetTransform<TSeries>>(
+      std::move(header),
+      "default",
+      std::move(tsdata.series)
+    );
+
+    // Build and return the split
+    return DataSplit<TSeries>(split_name, std::move(rawd));
+  }
+
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  std::variant<std::string, DTS> load_dataset_bin(std::filesystem::path const& path, size_t nb_threads) {
+    namespace wb = tempo::writer::bin;
+    if (!(std::filesystem::exists(path)&&std::filesystem::is_regular_file(path))) {
+      return {"Could not read file " + path.string()};
+    }
+
+    try {
+      auto file = std::make_shared<utils::MappedFile>(path);
+      char const *const base = file->data();
+      const size_t size = file->size();
+      size_t pos = 0;
+      auto read_u64 = [&]() {
+        if (size - pos<sizeof(uint64_t)) { throw std::runtime_error("Truncated binary dataset"); }
+        uint64_t v;
+        std::memcpy(&v, base + pos, sizeof(v));
+        pos += sizeof(v);
+        return v;
+      };
+
+      // --- --- --- Fixed size part
+      if (size<sizeof(wb::magic)||std::memcmp(base, wb::magic, sizeof(wb::magic))!=0) {
+        return {"Not a binary dataset: " + path.string()};
+      }
+      pos = sizeof(wb::magic);
+      const uint64_t version = read_u64();
+      if (version!=wb::version&&version!=wb::version_compressed&&version!=wb::version_appendable) {
+        return {"Unsupported binary dataset version"};
+      }
+      if (read_u64()!=sizeof(F)) { return {"Binary dataset written with another floating point type"}; }
+      const bool appendable = version==wb::version_appendable;
+      if (appendable) {
+        // Header and series in the footer
+        pos = read_u64();
+        if (pos>size) { throw std::runtime_error("Truncated binary dataset"); }
+      }
+      const uint64_t header_size = read_u64();
+      if (size - pos<header_size) { throw std::runtime_error("Truncated binary dataset"); }
+      const nlohmann::json jv = nlohmann::json::parse(base + pos, base + pos + header_size);
+      pos += header_size;
+
+      const auto n = jv.at("size").get<size_t>();
+      const auto ndim = jv.at("dimension").get<size_t>();
+      if (ndim==0) { return {"Binary dataset without dimension"}; }
+      const auto index_to_label = jv.at("index_to_label").get<std::vector<L>>();
+      const auto lengths = jv.at("length").get<std::vector<size_t>>();
+      if (lengths.size()!=2) { return {"Binary dataset with an invalid length entry"}; }
+
+      // --- --- --- Per series
+      std::vector<std::optional<L>> labels;
+      labels.reserve(n);
+      std::vector<size_t> missing;
+      std::vector<bool> is_missing(n);
+      std::vector<uint64_t> starts;
+      std::vector<uint64_t> counts;
+      for (size_t i = 0; i<n; ++i) {
+        const uint64_t el = read_u64();
+        if (el==(uint64_t)-1) { labels.emplace_back(std::nullopt); }
+        else if (el<index_to_label.size()) { labels.emplace_back(index_to_label[el]); }
+        else { return {"Binary dataset with an invalid label"}; }
+        is_missing[i] = read_u64()!=0;
+        if (is_missing[i]) { missing.push_back(i); }
+        // Appendable variant: start and number of values of the series, from the start of the file
+        if (appendable) {
+          starts.push_back(read_u64());
+          counts.push_back(read_u64());
+        }
+      }
+      std::vector<uint64_t> offsets(n + 1);
+      if (!appendable) {
+        for (auto& o : offsets) { o = read_u64(); }
+        for (size_t i = 0; i<n; ++i) {
+          if (offsets[i + 1]<offsets[i]) { return {"Binary dataset with invalid offsets"}; }
+          starts.push_back(offsets[i]);
+          counts.push_back(offsets[i + 1] - offsets[i]);
+        }
+      }
+
+      // --- --- --- Data array: viewing the mapping, or decoded in a slab
+      F const *data = nullptr;
+      utils::Capsule capsule;
+      if (appendable) {
+        data = reinterpret_cast<F const *>(base);
+        for (size_t i = 0; i<n; ++i) {
+          if (starts[i]>size/sizeof(F)||size/sizeof(F) - starts[i]<counts[i]) {
+            throw std::runtime_error("Truncated binary dataset");
+          }
+        }
+        capsule = utils::make_capsule<std::shared_ptr<utils::MappedFile>>(file);
+      } else if (version==wb::version) {
+        pos += (wb::alignment - pos%wb::alignment)%wb::alignment;
+        if (pos>size||(size - pos)/sizeof(F)<offsets.back()) { throw std::runtime_error("Truncated binary dataset"); }
+        data = reinterpret_cast<F const *>(base + pos);
+        capsule = utils::make_capsule<std::shared_ptr<utils::MappedFile>>(file);
+      } else {
+        const uint64_t bv = read_u64();
+        const uint64_t nb_blocks = read_u64();
+        if (bv==0||nb_blocks!=(offsets.back() + bv - 1)/bv) { return {"Binary dataset with invalid blocks"}; }
+        std::vector<uint64_t> block_offsets(nb_blocks + 1);
+        for (auto& o : block_offsets) { o = read_u64(); }
+        if (size - pos<block_offsets.back()) { throw std::runtime_error("Truncated binary dataset"); }
+        const auto *blocks = reinterpret_cast<uint8_t const *>(base + pos);
+        const SeriesSlab slab(offsets.back());
+        std::vector<std::string> errors(nb_blocks);
+        utils::ParTasks().execute((int)std::max<size_t>(nb_threads, 1), [&](size_t b) {
+          try {
+            if (block_offsets[b + 1]<block_offsets[b]) { throw std::runtime_error("Invalid compressed block"); }
+            const size_t start = b*bv;
+            wb::codec::decode(blocks + block_offsets[b], block_offsets[b + 1] - block_offsets[b], slab.data + start,
+                              std::min<size_t>(bv, offsets.back() - start));
+          } catch (std::exception const& e) { errors[b] = e.what(); }
+        }, 0, nb_blocks);
+        for (auto const& e : errors) { if (!e.empty()) { return {"Binary dataset: " + e}; }}
+        data = slab.data;
+        capsule = slab.capsule;
+      }
+
+      // Keep the label encoding: labels are added one by one, in index order
+      LabelEncoder encoder;
+      for (L const& l : index_to_label) { encoder = LabelEncoder(std::move(encoder), std::vector<L>{l}); }
 
-      // Build Header
       std::shared_ptr<DatasetHeader> header = std::make_shared<DatasetHeader>(
-        tsdata.problem_name.value_or("Anonymous"),
-        tsdata.shortest_length,
-        tsdata.longest_length,
-        tsdata.nb_dimensions,
-        std::move(vlabels),
-        std::move(tsdata.series_with_missing_values),
+        jv.at("name").get<std::string>(),
+        lengths[0],
+        lengths[1],
+        ndim,
+        std::move(labels),
+        std::move(missing),
         std::move(encoder)
       );
 
-      // Build Transform (raw data, "default")
+      // --- --- --- Series, viewing the data array
+      std::vector<TSeries> series;
+      series.reserve(n);
+      for (size_t i = 0; i<n; ++i) {
+        const uint64_t nb_values = counts[i];
+        if (nb_values%ndim!=0) { return {"Binary dataset with invalid offsets"}; }
+        series.push_back(TSeries::mk_view(capsule, data + starts[i], ndim, nb_values/ndim,
+                                          header->original_label(i), {is_missing[i]}));
+      }
+
       std::shared_ptr<DatasetTransform<TSeries>> rawd = std::make_shared<DatasetTransform<TSeries>>(
         std::move(header),
-        "default",
-        std::move(tsdata.series)
+        jv.value("transform", std::string("default")),
+        std::move(series)
       );
+      return {DataSplit<TSeries>(jv.value("split", std::string("default")), std::move(rawd))};
+    } catch (std::exception& e) {
+      return {e.what()};
+    }
+  }
 
-      // Build and return the split
-      return {DataSplit<TSeries>(std::move(split_name), std::move(rawd))};
+  std::variant<std::string, DTS> load_dataset_bin_transform(
+    DTS const& base,
+    std::filesystem::path const& path,
+    std::string const& transform_name,
+    size_t nb_threads
+  ) {
+    std::variant<std::string, DTS> vloaded = load_dataset_bin(path, nb_threads);
+    if (vloaded.index()==0) { return vloaded; }
+    DTS const& loaded = std::get<1>(vloaded);
 
-    } else {
-      return {std::get<0>(vts)};
+    // The series must match the ones of the base split (the labels and missing flags are taken from the base)
+    DatasetTransform<TSeries> const& base_transform = base.transform();
+    if (loaded.size()!=base_transform.size()) {
+      return {"Transform " + path.string() + " does not have the size of its base split"};
     }
+    // The views keep the loaded split, and so the mapping, alive
+    utils::Capsule capsule = utils::make_capsule<DTS>(loaded);
+    std::vector<TSeries> series;
+    series.reserve(loaded.size());
+    for (size_t i = 0; i<loaded.size(); ++i) {
+      TSeries const& b = base_transform[i];
+      TSeries const& s = loaded[i];
+      if (s.length()!=b.length()||s.nb_dimensions()!=b.nb_dimensions()) {
+        return {"Transform " + path.string() + ": series " + std::to_string(i) + " does not match its base series"};
+      }
+      series.push_back(TSeries::mk_view(capsule, s.data(), s.nb_dimensions(), s.length(), b.label(),
+                                        {b.missing()}));
+    }
+    auto transform = std::make_shared<DatasetTransform<TSeries>>(base_transform, transform_name, std::move(series));
+    return {DataSplit<TSeries>(base, std::move(transform))};
   }
 
 
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  std::variant<std::string, DTS> load_dataset_arrow(
+    std::filesystem::path const& path,
+    std::string const& dataset_name,
+    std::string const& split_name,
+    arrow::ArrowColumns const& columns,
+    LabelEncoder const& encoder,
+    size_t nb_threads
+  ) {
+    if (!(std::filesystem::exists(path)&&std::filesystem::is_regular_file(path))) {
+      return {"Could not read file " + path.string()};
+    }
+
+    std::variant<std::string, arrow::ArrowData> result = arrow::read_arrow(path, columns, nb_threads);
+    if (result.index()==0) { return {std::get<0>(result)}; }
+    arrow::ArrowData& data = std::get<1>(result);
+
+    std::shared_ptr<DatasetHeader> header = std::make_shared<DatasetHeader>(
+      dataset_name,
+      data.length_min,
+      data.length_max,
+      data.nb_dimensions,
+      std::move(data.labels),
+      std::move(data.series_with_missing),
+      encoder
+    );
+
+    std::shared_ptr<DatasetTransform<TSeries>> rawd = std::make_shared<DatasetTransform<TSeries>>(
+      std::move(header),
+      "default",
+      std::move(data.series)
+    );
+    return {DataSplit<TSeries>(split_name, std::move(rawd))};
+  }
+
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
 
@@ -69,7 +299,8 @@ namespace tempo::reader {
     LabelEncoder const& encoder,
     bool csvheader,
     char csvsep,
-    std::set<char> csvcomment
+    std::set<char> csvcomment,
+    size_t nb_threads
   ) {
 
     if( !(std::filesystem::exists(path) && std::filesystem::is_regular_file(path)) ){
@@ -84,40 +315,18 @@ namespace tempo::reader {
 
     try {
 
-      // Open the file and read
-      std::ifstream input(path, std::ios::binary);
-      Result<F> csv_result = read_csv<F>(input, encoder, params);
+      // Map the file and read, directly in one slab
+      std::variant<std::string, SlabReaderData> csv_result = read_csv_mapped(path, encoder, params, nb_threads);
 
       // Check error
       if (csv_result.index()==0) { return {std::get<0>(csv_result)}; }
 
-      tempo::reader::ReaderData<F> csvdata = std::get<1>(std::move(csv_result));
+      SlabReaderData csvdata = std::get<1>(std::move(csv_result));
 
       // Build vector of optional labels for the DatasetHeader
       std::vector<std::optional<std::string>> vlabels;
       vlabels.reserve(csvdata.series.size());
-
-      // Build vector of index of series with missing data for the DatasetHeader
-      std::vector<size_t> series_with_missing_values;
-
-      // Build vector of TSeries for the dataset transform & dataset
-      std::vector<TSeries> series;
-      series.reserve(csvdata.series.size());
-
-      for (size_t i = 0; i<csvdata.series.size(); ++i) {
-        // --- --- --- Label
-        if (csvdata.labels) {
-          vlabels.emplace_back(csvdata.labels.value()[i]);
-        } else {
-          vlabels.emplace_back(std::nullopt);
-        }
-        // --- --- --- Missing
-        bool missing = csvdata.series_with_nan.contains(i);
-        if (missing) { series_with_missing_values.push_back(i); }
-        // --- --- --- Build the series
-        std::vector<F> data = std::move(csvdata.series[i]);
-        series.push_back(TSeries::mk_from_rowmajor(std::move(data), nb_var, vlabels.back(), {missing}));
-      }
+      for (const auto& s : csvdata.series) { vlabels.emplace_back(s.label()); }
 
       // Build Header
       std::shared_ptr<DatasetHeader> header = std::make_shared<DatasetHeader>(
@@ -126,7 +335,7 @@ namespace tempo::reader {
         csvdata.length_max,
         nb_var,
         std::move(vlabels),
-        std::move(series_with_missing_values),
+        std::move(csvdata.series_with_nan),
         std::move(csvdata.encoder)
       );
 
@@ -134,7 +343,7 @@ namespace tempo::reader {
       std::shared_ptr<DatasetTransform<TSeries>> rawd = std::make_shared<DatasetTransform<TSeries>>(
         std::move(header),
         "default",
-        std::move(series)
+        std::move(csvdata.series)
       );
 
       // Build and return the split
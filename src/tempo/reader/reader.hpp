@@ -5,23 +5,57 @@
 #include <tempo/dataset/dts.hpp>
 
 #include "ts/ts.hpp"
+#include "arrow/arrow.hpp"
 
 /**
  * Give access to readers
  */
 namespace tempo::reader {
 
-  /// Read a TS file - univariate only
+  /// Read a TS file - univariate or multivariate (all the dimensions of a series have the same length)
   /// Can use an existing label encoder.
-  /// TODO: fix reader for multivariate, it is broken
+  /// The file is memory mapped, and its data parsed with 'nb_threads' threads (see TSReader::read_mapped).
   std::variant<std::string, DTS> load_udataset_ts(
     std::filesystem::path const& path,
     std::string const& split_name,
-    LabelEncoder const& encoder = {}
+    LabelEncoder const& encoder = {},
+    size_t nb_threads = 1
+  );
+
+  /// Build a split from the series of a TS file (see TSReader and TSBlockReader), with an existing label encoder
+  DTS tsdata_to_dts(TSData&& tsdata, std::string const& split_name, LabelEncoder const& encoder = {});
+
+  /// Read a file in the binary dataset format (see writer::bin::write), keeping its split name and label encoding.
+  /// The file is memory mapped: the series are views over the mapping, and nothing is parsed but the JSON header.
+  /// The series of the compressed variant are decoded in memory by 'nb_threads' threads.
+  /// The series of the appendable variant (see writer::bin::append) are viewed in their chunks, in index order.
+  std::variant<std::string, DTS> load_dataset_bin(std::filesystem::path const& path, size_t nb_threads = 1);
+
+  /// Read a transform of 'base' written in the binary dataset format (see writer::bin::transform_path), as a split
+  /// sharing the header of 'base'. The series are views over the mapping: a transform is not recomputed, and is
+  /// paged in from the disk as it is accessed.
+  std::variant<std::string, DTS> load_dataset_bin_transform(
+    DTS const& base,
+    std::filesystem::path const& path,
+    std::string const& transform_name,
+    size_t nb_threads = 1
+  );
+
+  /// Read columns of an Arrow IPC file (see arrow::read_arrow), e.g. exported from Parquet files, without any text
+  /// round trip. The series are views over the mapping of the file when their values have the type of tempo::F.
+  /// Can use an existing label encoder.
+  std::variant<std::string, DTS> load_dataset_arrow(
+    std::filesystem::path const& path,
+    std::string const& dataset_name,
+    std::string const& split_name,
+    arrow::ArrowColumns const& columns = {},
+    LabelEncoder const& encoder = {},
+    size_t nb_threads = 1
   );
 
   /// Read a csv file - univariate series
   /// Can use an existing label encoder.
+  /// The file is memory mapped, and its data parsed with 'nb_threads' threads (see univariate::read_csv_mapped).
   std::variant<std::string, DTS> load_udataset_csv(
     std::filesystem::path const& path,
     std::string const& dataset_name,
@@ -29,7 +63,8 @@ namespace tempo::reader {
     LabelEncoder const& encoder = {},
     bool csvheader = false,
     char csvsep = ',',
-    std::set<char> csvcomment = {'%', '@'}
+    std::set<char> csvcomment = {'%', '@'},
+    size_t nb_threads = 1
   );
 
 } // End of namespace tempo::reader
\ No newline at end of file
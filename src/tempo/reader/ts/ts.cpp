@@ -1,5 +1,9 @@
 #include "ts.hpp"
 #include <tempo/utils/readingtools.hpp>
+#include <tempo/utils/utils/mapped_file.hpp>
+
+#include <cstring>
+#include <string_view>
 
 namespace tempo::reader {
 
@@ -191,7 +195,7 @@ namespace tempo::reader {
         // Data directive
       case DirectiveCode::dir_data: {
         skip_line(input);
-        state = (&TSReader::read_data);
+        state = header_only ? nullptr : (&TSReader::read_data);
         return {};
       }
 
@@ -336,6 +340,7 @@ namespace tempo::reader {
             // Missing value? If so, also record the index of the series
             if (buffer=="?") {
               series.push_back(std::numeric_limits<F>::quiet_NaN());
+              has_missing = true;
               size_t missing_index = dataset.size();
               if (missing.empty()||missing.back()!=missing_index) {
                 missing.push_back(missing_index);
@@ -357,6 +362,11 @@ namespace tempo::reader {
               // After reading the first dimension, record the length_
               if (cur_dim==0) { length = series.size(); }
               cur_dim++;
+              // All the dimensions must have the same length
+              if (series.size()!=cur_dim*length) {
+                return {"Error reading the data: dimension "s + std::to_string(cur_dim) + " of length " +
+                  std::to_string(series.size() - (cur_dim - 1)*length) + " vs " + std::to_string(length)};
+              }
               // Length check
               if (has_equallength&&length!=expected_length) {
                 return {"Error reading the data: non matching expected_length "s +
@@ -368,8 +378,9 @@ namespace tempo::reader {
             // Mark the end of the current series: check the dimension, no label
             if (c=='\n'||c==EOF) {
               if (has_labels) { return {"Error reading the data: missing get_label"}; }
-              else if (series.size()!=cur_dim*length) {
-                return {"Error reading the data: non matching dimension"};
+              else if (cur_dim!=ndim) {
+                return {"Error reading the data: non matching dimension "s +
+                  std::to_string(cur_dim) + " vs " + std::to_string(ndim)};
               }
               // Ok, store the series in the dataset
               dataset.push_back(TSeries::mk_from_rowmajor(std::move(series), ndim, {}, {has_missing}));
@@ -395,4 +406,312 @@ namespace tempo::reader {
     return reader.read();
   }
 
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Memory mapped reading
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  namespace {
+
+    /// Read only stream buffer over a memory range, knowing its position
+    struct MemoryBuf : std::streambuf {
+      MemoryBuf(char const *data, size_t size) {
+        char *p = const_cast<char *>(data);
+        setg(p, p, p + size);
+      }
+
+      size_t position() const { return gptr() - eback(); }
+    };
+
+    /// Trim the whitespaces (excluding newline, absent from the lines) of both ends
+    std::string_view trim_view(std::string_view sv) {
+      while (!sv.empty()&&is_white(sv.front())) { sv.remove_prefix(1); }
+      while (!sv.empty()&&is_white(sv.back())) { sv.remove_suffix(1); }
+      return sv;
+    }
+
+    /// Series parsed in a chunk: its values are row major, from 'start' in the values of the chunk
+    struct ParsedSeries {
+      size_t start;
+      size_t length;
+      std::optional<std::string> label;
+      bool missing;
+    };
+
+    /// Lines of the data section parsed by one task
+    struct Chunk {
+      std::vector<F> values{};
+      std::vector<ParsedSeries> series{};
+      size_t shortest_length{std::numeric_limits<size_t>::max()};
+      size_t longest_length{0};
+      /// Blank line read (only accepted at the end of the data section)
+      bool blank{false};
+      std::optional<std::string> error{};
+    };
+
+    /// Parsing constants, from the header and the first line
+    struct Layout {
+      bool has_labels;
+      bool has_equallength;
+      size_t ndim;
+      size_t expected_length;
+    };
+
+    using namespace std::string_literals;
+
+    /// Parse one (non blank) line as 'read_data_' does, appending the series to the chunk
+    std::optional<std::string> parse_line(std::string_view line, Layout const& layout, Chunk& chunk) {
+      const size_t start = chunk.values.size();
+      size_t length{0};
+      size_t cur_dim{0};
+      bool has_missing{false};
+      size_t pos = 0;
+      while (true) {
+        // --- Label
+        if (layout.has_labels&&cur_dim==layout.ndim) {
+          std::string_view rest = line.substr(pos);
+          if (rest.find_first_of(",:")!=std::string_view::npos) {
+            return {"Error while reading the data: the class should be the last item on the row."};
+          }
+          chunk.series.push_back({start, length, {std::string(trim_view(rest))}, has_missing});
+          break;
+        }
+        // --- Value
+        const size_t delim_pos = line.find_first_of(",:", pos);
+        const bool at_end = delim_pos==std::string_view::npos;
+        std::string_view token = trim_view(line.substr(pos, at_end ? std::string_view::npos : delim_pos - pos));
+        if (token.empty()) { return {"Error reading @data"}; }
+        if (token=="?") {
+          chunk.values.push_back(std::numeric_limits<F>::quiet_NaN());
+          has_missing = true;
+        } else {
+          auto od = as_double(token);
+          if (!od.has_value()) {
+            return {"Error reading '" + std::string(token)
+                      + "': only supporting floating values (read as double) and missing values"};
+          }
+          chunk.values.push_back((F)od.value());
+        }
+        // --- Delimiter
+        if (!at_end&&line[delim_pos]==',') {
+          pos = delim_pos + 1;
+          continue;
+        }
+        // End of a dimension
+        if (cur_dim==0) { length = chunk.values.size() - start; }
+        cur_dim++;
+        const size_t size = chunk.values.size() - start;
+        if (size!=cur_dim*length) {
+          return {"Error reading the data: dimension "s + std::to_string(cur_dim) + " of length " +
+            std::to_string(size - (cur_dim - 1)*length) + " vs " + std::to_string(length)};
+        }
+        if (layout.has_equallength&&length!=layout.expected_length) {
+          return {"Error reading the data: non matching expected_length "s +
+            std::to_string(layout.expected_length) + " vs " + std::to_string(length)};
+        }
+        if (!at_end) {
+          pos = delim_pos + 1;
+          continue;
+        }
+        // End of the series
+        if (layout.has_labels) { return {"Error reading the data: missing get_label"}; }
+        else if (cur_dim!=layout.ndim) {
+          return {"Error reading the data: non matching dimension "s +
+            std::to_string(cur_dim) + " vs " + std::to_string(layout.ndim)};
+        }
+        chunk.series.push_back({start, length, {}, has_missing});
+        break;
+      }
+      chunk.shortest_length = std::min(chunk.shortest_length, length);
+      chunk.longest_length = std::max(chunk.longest_length, length);
+      return {};
+    }
+
+    /// Parse the lines of [begin, end[, stopping after 'max_series' series.
+    /// Return the position after the last line read.
+    char const *parse_chunk(char const *begin, char const *end, Layout const& layout, Chunk& chunk,
+                            size_t max_series = std::numeric_limits<size_t>::max()) {
+      while (begin<end&&chunk.series.size()<max_series) {
+        auto *nl = static_cast<char const *>(std::memchr(begin, '\n', end - begin));
+        char const *line_end = nl==nullptr ? end : nl;
+        std::string_view line(begin, line_end - begin);
+        begin = nl==nullptr ? end : nl + 1;
+        if (!line.empty()&&line.back()=='\r') { line.remove_suffix(1); }
+        if (trim_view(line).empty()) {
+          chunk.blank = true;
+          continue;
+        }
+        if (chunk.blank) {
+          chunk.error = {"Error reading @data"};
+          return begin;
+        }
+        chunk.error = parse_line(line, layout, chunk);
+        if (chunk.error) { return begin; }
+      }
+      return begin;
+    }
+
+    /// Dimensions and length, from the first line of the data section [begin, end[ (see read_data)
+    std::variant<std::string, Layout> read_layout(TSData& data, char const *begin, char const *end) {
+      auto *nl = static_cast<char const *>(std::memchr(begin, '\n', end - begin));
+      const std::string_view first_line(begin, (nl==nullptr ? end : nl) - begin);
+      const bool has_labels = data.has_labels();
+      data.nb_dimensions = std::count(first_line.begin(), first_line.end(), ':') + (has_labels ? 0 : 1);
+      if (data.nb_dimensions==0) {
+        return {"Initialisation: Error reading the data: no dimension could be read"};
+      } else if (data.univariate.has_value()&&data.univariate.value()&&data.nb_dimensions!=1) {
+        return {"Initialisation: Error reading the data: the dataset is not univariate."};
+      }
+      const std::string_view first_band = first_line.substr(0, first_line.find(':'));
+      const size_t length1st = std::count(first_band.begin(), first_band.end(), ',') + 1;
+      if (data.has_equallength()&&data.serieslength.has_value()&&data.serieslength.value()!=length1st) {
+        return {"Initialisation: Error reading the data: non matching length_ "s +
+          std::to_string(data.serieslength.value()) + " vs " + std::to_string(length1st)};
+      }
+      return {Layout{has_labels, data.has_equallength(), data.nb_dimensions, length1st}};
+    }
+
+    /// Check the chunks in order, and append their series to 'data', in one slab.
+    /// 'blank' tells if a blank line was read before the chunks, and is updated.
+    std::optional<std::string> gather_chunks(std::vector<Chunk>& chunks, TSData& data, bool& blank,
+                                             size_t nb_threads) {
+      const size_t nb_chunks = chunks.size();
+      std::vector<size_t> value_offsets(nb_chunks + 1, 0);
+      for (size_t k = 0; k<nb_chunks; ++k) {
+        Chunk const& chunk = chunks[k];
+        if (blank&&!chunk.series.empty()) { return {"Error reading @data"}; }
+        if (chunk.error) { return {chunk.error.value()}; }
+        blank = blank||chunk.blank;
+        value_offsets[k + 1] = value_offsets[k] + chunk.values.size();
+        data.shortest_length = std::min(data.shortest_length, chunk.shortest_length);
+        data.longest_length = std::max(data.longest_length, chunk.longest_length);
+      }
+      const SeriesSlab slab(value_offsets.back());
+      F *buffer = slab.data;
+
+      // Row major values of the chunks to column major series in the buffer
+      const size_t ndim = data.nb_dimensions;
+      utils::ParTasks().execute((int)nb_threads, [&](size_t k) {
+        Chunk& chunk = chunks[k];
+        for (const auto& ps : chunk.series) {
+          F const *src = chunk.values.data() + ps.start;
+          F *dst = buffer + value_offsets[k] + ps.start;
+          for (size_t d = 0; d<ndim; ++d) {
+            for (size_t t = 0; t<ps.length; ++t) { dst[t*ndim + d] = src[d*ps.length + t]; }
+          }
+        }
+        chunk.values = {};
+      }, 0, nb_chunks);
+
+      // Series, viewing the buffer
+      auto& dataset = data.series;
+      for (size_t k = 0; k<nb_chunks; ++k) {
+        for (auto& ps : chunks[k].series) {
+          if (ps.missing) { data.series_with_missing_values.push_back(dataset.size()); }
+          dataset.push_back(TSeries::mk_view(slab.capsule, buffer + value_offsets[k] + ps.start, ndim, ps.length,
+                                             std::move(ps.label), {ps.missing}));
+        }
+      }
+      return {};
+    }
+
+  } // End of anonymous namespace
+
+  std::variant<std::string, TSData> TSReader::read_mapped_header(char const *data, size_t size, size_t& position) {
+    MemoryBuf buf(data, size);
+    std::istream in(&buf);
+    TSReader reader(in);
+    reader.header_only = true;
+    std::variant<std::string, TSData> result = reader.read();
+    position = buf.position();
+    return result;
+  }
+
+  std::variant<std::string, TSData> TSReader::read_mapped(const std::filesystem::path& path, size_t nb_threads) {
+    std::shared_ptr<utils::MappedFile> file;
+    try { file = std::make_shared<utils::MappedFile>(path); }
+    catch (std::exception const& e) { return {e.what()}; }
+
+    // --- --- --- Header, up to the start of the data section
+    size_t position{};
+    std::variant<std::string, TSData> result = read_mapped_header(file->data(), file->size(), position);
+    if (result.index()==0) { return result; }
+    TSData& data = std::get<1>(result);
+    char const *const begin = file->data() + position;
+    char const *const end = file->data() + file->size();
+
+    // --- --- --- Dimensions and length, from the first line
+    std::variant<std::string, Layout> vlayout = read_layout(data, begin, end);
+    if (vlayout.index()==0) { return {std::get<0>(vlayout)}; }
+    const Layout layout = std::get<1>(vlayout);
+
+    // --- --- --- Split the data section at line boundaries
+    nb_threads = std::max<size_t>(nb_threads, 1);
+    const std::vector<char const *> bounds = line_chunks(begin, end, nb_threads);
+    const size_t nb_chunks = bounds.size() - 1;
+
+    // --- --- --- Parse the chunks
+    std::vector<Chunk> chunks(nb_chunks);
+    utils::ParTasks().execute((int)nb_threads, [&](size_t k) {
+      parse_chunk(bounds[k], bounds[k + 1], layout, chunks[k]);
+    }, 0, nb_chunks);
+
+    // --- --- --- Check the chunks in order, and place them in one buffer
+    bool blank = false;
+    std::optional<std::string> error = gather_chunks(chunks, data, blank, nb_threads);
+    if (error) { return {error.value()}; }
+
+    return result;
+  }
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Reading by blocks
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  std::variant<std::string, TSBlockReader> TSBlockReader::open(const std::filesystem::path& path) {
+    TSBlockReader reader;
+    try { reader.file = std::make_shared<utils::MappedFile>(path); }
+    catch (std::exception const& e) { return {e.what()}; }
+
+    // --- --- --- Header, and layout of the data section
+    size_t position{};
+    std::variant<std::string, TSData> vheader =
+      TSReader::read_mapped_header(reader.file->data(), reader.file->size(), position);
+    if (vheader.index()==0) { return {std::get<0>(vheader)}; }
+    reader.hdr = std::make_shared<TSData>(std::get<1>(std::move(vheader)));
+    reader.pos = reader.file->data() + position;
+    reader.end = reader.file->data() + reader.file->size();
+    std::variant<std::string, Layout> vlayout = read_layout(*reader.hdr, reader.pos, reader.end);
+    if (vlayout.index()==0) { return {std::get<0>(vlayout)}; }
+    const Layout layout = std::get<1>(vlayout);
+    reader.has_labels = layout.has_labels;
+    reader.has_equallength = layout.has_equallength;
+    reader.expected_length = layout.expected_length;
+    return {std::move(reader)};
+  }
+
+  std::variant<std::string, TSData> TSBlockReader::next(size_t max_series) {
+    TSData block;
+    block.problem_name = hdr->problem_name;
+    block.timestamps = hdr->timestamps;
+    block.missing = hdr->missing;
+    block.univariate = hdr->univariate;
+    block.equallength = hdr->equallength;
+    block.targetlabel = hdr->targetlabel;
+    block.serieslength = hdr->serieslength;
+    block.labels = hdr->labels;
+    block.nb_dimensions = hdr->nb_dimensions;
+
+    const Layout layout{has_labels, has_equallength, hdr->nb_dimensions, expected_length};
+    std::vector<Chunk> chunks(1);
+    chunks[0].blank = blank;
+    pos = parse_chunk(pos, end, layout, chunks[0], std::max<size_t>(max_series, 1));
+    blank = chunks[0].blank;
+    // The lines after a blank line were checked while parsing
+    bool checked = false;
+    std::optional<std::string> error = gather_chunks(chunks, block, checked, 1);
+    if (error) { return {error.value()}; }
+    return {std::move(block)};
+  }
+
 } // End of namespace tempo::reader
\ No newline at end of file
@@ -2,16 +2,17 @@
 
 #include <tempo/utils/utils.hpp>
 #include <tempo/dataset/tseries.hpp>
+#include <tempo/utils/utils/mapped_file.hpp>
 
 namespace tempo::reader {
 
   /** Structure obtained after reading a TS file
-   *  With FloatType = double
+   *  With FloatType = tempo::F (double, or float with TEMPO_FLOAT32)
    *       LabelType = std::string
    */
   class TSData : private tempo::utils::Uncopyable {
   public:
-    using FloatType = double;
+    using FloatType = F;
     using LabelType = std::string;
 
     // --- --- --- --- --- --- --- --- --- --- -- --- --- --- --- -- --- --- --- --- -- --- --- --- --- -- --- --- ---
@@ -65,6 +66,8 @@ namespace tempo::reader {
 
   };
 
+  class TSBlockReader;
+
   /** Allow to read an input stream into a TSData structure.
    *  Reads values as double and labels as std::string
    */
@@ -78,7 +81,16 @@ namespace tempo::reader {
      */
     static std::variant<std::string, TSData> read(std::istream& input);
 
+    /** Read a TS file through a memory mapping (see utils::MappedFile).
+     *  The header is read as by 'read'. The data section is split at line boundaries in chunks parsed concurrently
+     *  by 'nb_threads' threads, and all the series are views in one slab (see SeriesSlab).
+     *  Reads the same data as 'read', except that blank lines are accepted at the end of the data section.
+     */
+    static std::variant<std::string, TSData> read_mapped(const std::filesystem::path& path, size_t nb_threads);
+
   private:
+    friend class TSBlockReader;
+
     // --- --- --- Private constructor
     explicit TSReader(std::istream& input)
       : input(input), state(nullptr) {}
@@ -97,6 +109,8 @@ namespace tempo::reader {
     TSData data;
     // Length of the first series
     size_t length1st{};
+    // Stop after the '@data' directive, leaving the input at the start of the data section (see read_mapped)
+    bool header_only{false};
 
     // --- --- --- Header's directives parsing tools
     // Directive witch code: used to simulate a switch on string through a map
@@ -158,6 +172,47 @@ namespace tempo::reader {
 
     // Working method for read_data
     Result read_data_(std::istream& in);
+
+    // Read the header of a file in memory (see header_only): 'position' is set at the start of the data section
+    static std::variant<std::string, TSData> read_mapped_header(char const *data, size_t size, size_t& position);
+  };
+
+  /** Read the series of a TS file by blocks, through a memory mapping (see TSReader::read_mapped).
+   *  Only the block being read is parsed: reading a file block after block uses a bounded amount of memory, whatever
+   *  the size of the file. The blocks read the same data as 'TSReader::read_mapped' would, in order.
+   */
+  class TSBlockReader {
+  public:
+
+    /// Open a TS file and read its header. Return an error message on failure.
+    static std::variant<std::string, TSBlockReader> open(const std::filesystem::path& path);
+
+    /// Header of the file, with its dimensions (the series are read by 'next')
+    TSData const& header() const { return *hdr; }
+
+    /// Read the next 'max_series' series (or less at the end of the file) in a TSData with the header of the file.
+    /// The series of a block view one slab (see SeriesSlab), and the indexes of its series with missing values are
+    /// relative to the block. Return a block without series once the end of the file is reached, or an error message.
+    std::variant<std::string, TSData> next(size_t max_series);
+
+    /// Check if the end of the file is reached
+    bool done() const { return pos==end; }
+
+  private:
+    TSBlockReader() = default;
+
+    std::shared_ptr<utils::MappedFile> file;
+    std::shared_ptr<TSData> hdr;
+    char const *pos{nullptr};
+    char const *end{nullptr};
+
+    // Layout of the data section, from the first line (see TSReader::read_data)
+    bool has_labels{false};
+    bool has_equallength{false};
+    size_t expected_length{0};
+
+    // A blank line was read: no series can follow
+    bool blank{false};
   };
 
   /// Helper for TS file format and path
@@ -167,5 +222,11 @@ namespace tempo::reader {
     return tempo::reader::TSReader::read(istream_);
   }
 
+  /// Helper for TS file format and path, reading the data with 'nb_threads' threads (see TSReader::read_mapped)
+  inline std::variant<std::string, TSData>
+  load_tsdata_mapped(const std::filesystem::path& path, size_t nb_threads) {
+    return tempo::reader::TSReader::read_mapped(path, nb_threads);
+  }
+
 } // end of namespace tempo::reader
 
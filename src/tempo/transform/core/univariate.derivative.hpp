@@ -5,6 +5,13 @@
 
 namespace tempo::transform::core::univariate {
 
+  /// Derivative at the index i of a series, with 0 < i < length-1 (see derive).
+  /// Allows to update a derivative in place of recomputing it, e.g. over a sliding window.
+  template<std::floating_point F, std::random_access_iterator Input>
+  inline F derive_at(Input const& series, size_t i) {
+    return ((series[i] - series[i - 1]) + ((series[i + 1] - series[i - 1])/2.0))/2.0;
+  }
+
   /** Computation of a series derivative according to "Derivative Dynamic Time Warping" by Keogh & Pazzani
    * @tparam T            Input series, must be in
    * @param series        Pointer to the series's data
@@ -15,9 +22,7 @@ namespace tempo::transform::core::univariate {
   template<std::floating_point F, std::random_access_iterator Input, std::output_iterator<F> Output>
   void derive(Input const& series, size_t length, Output& out) {
     if (length>2) {
-      for (size_t i{1}; i<length - 1; ++i) {
-        out[i] = ((series[i] - series[i - 1]) + ((series[i + 1] - series[i - 1])/2.0))/2.0;
-      }
+      for (size_t i{1}; i<length - 1; ++i) { out[i] = derive_at<F>(series, i); }
       out[0] = out[1];
       out[length - 1] = out[length - 2];
     } else {
@@ -25,4 +30,37 @@ namespace tempo::transform::core::univariate {
     }
   }
 
+  /** Derivative of a series with its values 'stride' apart (e.g. a dimension of a column major multivariate series),
+   *  written with the same stride, as 'derive'. Stride 1 uses 'derive', a loop over contiguous values which the
+   *  compiler can vectorise.
+   */
+  template<std::floating_point F>
+  void derive_strided(F const *series, size_t length, size_t stride, F *out) {
+    if (stride==1) { derive<F>(series, length, out); }
+    else if (length>2) {
+      for (size_t i{1}; i<length - 1; ++i) {
+        const F prev = series[(i - 1)*stride];
+        out[i*stride] = ((series[i*stride] - prev) + ((series[(i + 1)*stride] - prev)/2.0))/2.0;
+      }
+      out[0] = out[stride];
+      out[(length - 1)*stride] = out[(length - 2)*stride];
+    } else {
+      for (size_t i{0}; i<length; ++i) { out[i*stride] = series[i*stride]; }
+    }
+  }
+
+  /** Derivatives of degree 1 to 'nb_degrees' of a series in one pass, each degree derived from the previous one while
+   *  it is still in cache: outs[d-1] receives the derivative of degree d, with the same results as 'derive' applied
+   *  d times. Values are 'stride' apart, both in the series and in the outputs (see derive_strided).
+   *  Warning: the outputs must not overlap the series, nor each other.
+   */
+  template<std::floating_point F>
+  void derive_chain(F const *series, size_t length, size_t stride, F *const *outs, size_t nb_degrees) {
+    F const *previous = series;
+    for (size_t d{0}; d<nb_degrees; ++d) {
+      derive_strided<F>(previous, length, stride, outs[d]);
+      previous = outs[d];
+    }
+  }
+
 }
\ No newline at end of file
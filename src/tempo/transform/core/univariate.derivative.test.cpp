@@ -85,4 +85,39 @@ TEST_CASE("Univariate Derivative", "[transform][univariate][derivative]") {
 
   }
 
-}
\ No newline at end of file
+}
+
+TEST_CASE("Univariate Derivative Chain", "[transform][univariate][derivative]") {
+  mock::Mocker mocker;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t length = mocker._fixl;
+  constexpr size_t nb_degrees = 3;
+
+  for (const auto& s : fset) {
+    // Reference: derivatives of 'derive' applied in chain
+    std::vector<std::vector<F>> expected(nb_degrees, std::vector<F>(length));
+    ref::derive(s.data(), length, expected[0].data(), 1);
+    ref::derive(s.data(), length, expected[1].data(), 2);
+    ref::derive(s.data(), length, expected[2].data(), 3);
+
+    // Contiguous
+    std::vector<std::vector<F>> d(nb_degrees, std::vector<F>(length));
+    F *outs[nb_degrees] = {d[0].data(), d[1].data(), d[2].data()};
+    derive_chain<F>(s.data(), length, 1, outs, nb_degrees);
+    for (size_t k = 0; k<nb_degrees; ++k) { REQUIRE(d[k]==expected[k]); }
+
+    // Strided: the series as the second dimension of a 2 dimensions column major series
+    constexpr size_t stride = 2;
+    std::vector<F> mv(stride*length, 0);
+    for (size_t i = 0; i<length; ++i) { mv[i*stride + 1] = s[i]; }
+    std::vector<std::vector<F>> dmv(nb_degrees, std::vector<F>(stride*length, -1));
+    F *mv_outs[nb_degrees] = {dmv[0].data() + 1, dmv[1].data() + 1, dmv[2].data() + 1};
+    derive_chain<F>(mv.data() + 1, length, stride, mv_outs, nb_degrees);
+    for (size_t k = 0; k<nb_degrees; ++k) {
+      for (size_t i = 0; i<length; ++i) {
+        REQUIRE(dmv[k][i*stride + 1]==expected[k][i]);
+        REQUIRE(dmv[k][i*stride]==-1); // Other dimension untouched
+      }
+    }
+  }
+}
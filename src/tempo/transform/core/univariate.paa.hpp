@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+
+namespace tempo::transform::core::univariate {
+
+  /// Length of the PAA of a series of length 'length' by segments of 'factor' values (see paa): ceil(length/factor)
+  inline size_t paa_length(size_t length, size_t factor) {
+    return factor==0 ? length : (length + factor - 1)/factor;
+  }
+
+  /** Piecewise Aggregate Approximation (Keogh et al.): mean of each segment of 'factor' consecutive values.
+   *  The last segment is shorter if 'factor' does not divide 'length'. Factors 0 and 1 copy the series.
+   * @param series        Input series, with its values 'stride' apart (e.g. a dimension of a column major
+   *                      multivariate series)
+   * @param length        Length of the series
+   * @param factor        Number of values per segment
+   * @param out           Where to write the PAA, with the same stride. Must be able to store paa_length(length, factor)
+   *                      values.
+   * @param stride        Distance between two values of the series, and of the output
+   * Warning: series and out should not overlap (i.e. no in-place PAA)
+   */
+  template<std::floating_point F>
+  void paa(F const *series, size_t length, size_t factor, F *out, size_t stride = 1) {
+    if (factor<=1) {
+      for (size_t i{0}; i<length; ++i) { out[i*stride] = series[i*stride]; }
+      return;
+    }
+    for (size_t s{0}, start{0}; start<length; ++s, start += factor) {
+      const size_t stop = std::min(length, start + factor);
+      F sum{0};
+      for (size_t i{start}; i<stop; ++i) { sum += series[i*stride]; }
+      out[s*stride] = sum/(F)(stop - start);
+    }
+  }
+
+}
@@ -0,0 +1,72 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "univariate.paa.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <cmath>
+#include <vector>
+
+using F = double;
+constexpr size_t nbitems = 500;
+using namespace tempo::transform::core::univariate;
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Reference
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+namespace ref {
+
+  std::vector<F> paa(std::vector<F> const& series, size_t factor) {
+    std::vector<F> result;
+    for (size_t start = 0; start<series.size(); start += factor) {
+      F sum = 0;
+      size_t n = 0;
+      for (size_t i = start; i<series.size()&&i<start + factor; ++i, ++n) { sum += series[i]; }
+      result.push_back(sum/(F)n);
+    }
+    return result;
+  }
+
+} // End of namespace ref
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+TEST_CASE("Univariate PAA", "[transform][univariate][paa]") {
+  mock::Mocker mocker;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t length = mocker._fixl;
+
+  REQUIRE(paa_length(25, 4)==7);
+  REQUIRE(paa_length(24, 4)==6);
+  REQUIRE(paa_length(25, 1)==25);
+  REQUIRE(paa_length(0, 4)==0);
+
+  for (const auto& s : fset) {
+    // Factor 1: copy
+    std::vector<F> copy(length);
+    paa<F>(s.data(), length, 1, copy.data());
+    REQUIRE(copy==s);
+
+    for (size_t factor : {2, 4, 8, 25, 30}) {
+      const std::vector<F> expected = ref::paa(s, factor);
+      REQUIRE(expected.size()==paa_length(length, factor));
+
+      // Contiguous
+      std::vector<F> out(paa_length(length, factor));
+      paa<F>(s.data(), length, factor, out.data());
+      for (size_t i = 0; i<out.size(); ++i) { REQUIRE(std::abs(out[i] - expected[i])<1e-12); }
+
+      // Strided: the series as the second dimension of a 2 dimensions column major series
+      constexpr size_t stride = 2;
+      std::vector<F> mv(stride*length, 0);
+      for (size_t i = 0; i<length; ++i) { mv[i*stride + 1] = s[i]; }
+      std::vector<F> mv_out(stride*out.size(), -1);
+      paa<F>(mv.data() + 1, length, factor, mv_out.data() + 1, stride);
+      for (size_t i = 0; i<out.size(); ++i) {
+        REQUIRE(mv_out[i*stride + 1]==out[i]);
+        REQUIRE(mv_out[i*stride]==-1); // Other dimension untouched
+      }
+    }
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+
+namespace tempo::transform::core::univariate {
+
+  /** Fill the missing values (NaN) of a series in place, by linear interpolation between the closest present values.
+   *  Leading and trailing missing values take the value of the closest present one; a series without any present
+   *  value is filled with 0.
+   * @param series        Series, with its values 'stride' apart (e.g. a dimension of a column major multivariate series)
+   * @param length        Length of the series
+   * @param stride        Distance between two values of the series
+   */
+  template<std::floating_point F>
+  void fill_missing(F *series, size_t length, size_t stride = 1) {
+    // Index of the last present value seen, 'length' if none yet
+    size_t last{length};
+    for (size_t i{0}; i<length; ++i) {
+      if (std::isnan(series[i*stride])) { continue; }
+      if (last==length) {
+        for (size_t j{0}; j<i; ++j) { series[j*stride] = series[i*stride]; }
+      } else if (i>last + 1) {
+        const F a = series[last*stride];
+        const F b = series[i*stride];
+        const F span = (F)(i - last);
+        for (size_t j{last + 1}; j<i; ++j) { series[j*stride] = a + (b - a)*((F)(j - last)/span); }
+      }
+      last = i;
+    }
+    const F fill = last==length ? F(0) : series[last*stride];
+    for (size_t j{last==length ? 0 : last + 1}; j<length; ++j) { series[j*stride] = fill; }
+  }
+
+  /** Uniform scaling of a series to 'new_length' values, by linear interpolation: the value k of the output is the
+   *  series at position k*(length-1)/(new_length-1), so that the first and last values are kept.
+   *  A series of length 1 is repeated; an empty series gives 0s. The series must not have missing values
+   *  (see fill_missing).
+   * @param series        Input series, with its values 'in_stride' apart
+   * @param length        Length of the series
+   * @param new_length    Length of the output
+   * @param out           Where to write the output, with its values 'out_stride' apart
+   * Warning: series and out should not overlap (i.e. no in-place resampling)
+   */
+  template<std::floating_point F>
+  void resample(F const *series, size_t length, size_t new_length, F *out, size_t in_stride = 1,
+                size_t out_stride = 1) {
+    if (length==0||length==1) {
+      const F v = length==0 ? F(0) : series[0];
+      for (size_t k{0}; k<new_length; ++k) { out[k*out_stride] = v; }
+      return;
+    }
+    if (new_length<=1) {
+      if (new_length==1) { out[0] = series[0]; }
+      return;
+    }
+    const F ratio = (F)(length - 1)/(F)(new_length - 1);
+    for (size_t k{0}; k<new_length; ++k) {
+      const F x = (F)k*ratio;
+      size_t i = (size_t)x;
+      if (i>=length - 1) { i = length - 2; }
+      const F t = x - (F)i;
+      const F a = series[i*in_stride];
+      const F b = series[(i + 1)*in_stride];
+      out[k*out_stride] = a + (b - a)*t;
+    }
+    // Exactly the last value, whatever the rounding of the positions
+    out[(new_length - 1)*out_stride] = series[(length - 1)*in_stride];
+  }
+
+}
@@ -0,0 +1,98 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "univariate.resample.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using F = double;
+constexpr size_t nbitems = 500;
+using namespace tempo::transform::core::univariate;
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Reference
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+namespace ref {
+
+  /// Linear interpolation of the series at position x, with 0 <= x <= size-1
+  F at(std::vector<F> const& series, F x) {
+    const size_t i = std::min((size_t)std::floor(x), series.size() - 1);
+    if (i==series.size() - 1) { return series[i]; }
+    return series[i]*(1 - (x - (F)i)) + series[i + 1]*(x - (F)i);
+  }
+
+} // End of namespace ref
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+TEST_CASE("Univariate resample", "[transform][univariate][resample]") {
+  mock::Mocker mocker;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t length = mocker._fixl;
+
+  // Degenerate lengths
+  {
+    const std::vector<F> one{3.5};
+    std::vector<F> out(4, -1);
+    resample<F>(one.data(), 1, 4, out.data());
+    REQUIRE(out==std::vector<F>(4, 3.5));
+    resample<F>(one.data(), 0, 4, out.data());
+    REQUIRE(out==std::vector<F>(4, 0));
+  }
+
+  for (const auto& s : fset) {
+    // Same length: copy
+    std::vector<F> copy(length);
+    resample<F>(s.data(), length, length, copy.data());
+    for (size_t i = 0; i<length; ++i) { REQUIRE(std::abs(copy[i] - s[i])<1e-12); }
+
+    for (size_t new_length : {2, 7, 13, 40, 97}) {
+      std::vector<F> out(new_length);
+      resample<F>(s.data(), length, new_length, out.data());
+      REQUIRE(out.front()==s.front());
+      REQUIRE(out.back()==s.back());
+      const F ratio = (F)(length - 1)/(F)(new_length - 1);
+      for (size_t k = 0; k<new_length; ++k) { REQUIRE(std::abs(out[k] - ref::at(s, (F)k*ratio))<1e-9); }
+
+      // Strided: as the second dimension of 2 dimensions column major series
+      constexpr size_t stride = 2;
+      std::vector<F> mv(stride*length, 0);
+      for (size_t i = 0; i<length; ++i) { mv[i*stride + 1] = s[i]; }
+      std::vector<F> mv_out(stride*new_length, -1);
+      resample<F>(mv.data() + 1, length, new_length, mv_out.data() + 1, stride, stride);
+      for (size_t k = 0; k<new_length; ++k) {
+        REQUIRE(mv_out[k*stride + 1]==out[k]);
+        REQUIRE(mv_out[k*stride]==-1); // Other dimension untouched
+      }
+    }
+  }
+}
+
+TEST_CASE("Univariate fill missing", "[transform][univariate][resample]") {
+  constexpr F nan = std::numeric_limits<F>::quiet_NaN();
+
+  std::vector<F> s{nan, nan, 1, nan, nan, 4, 5, nan};
+  fill_missing<F>(s.data(), s.size());
+  REQUIRE((s==std::vector<F>{1, 1, 1, 2, 3, 4, 5, 5}));
+
+  std::vector<F> none{nan, nan, nan};
+  fill_missing<F>(none.data(), none.size());
+  REQUIRE((none==std::vector<F>{0, 0, 0}));
+
+  // Strided, and series without missing values unchanged
+  std::vector<F> mv{7, nan, 8, 0, 9, 2};
+  fill_missing<F>(mv.data(), 3, 2);
+  fill_missing<F>(mv.data() + 1, 3, 2);
+  REQUIRE((mv==std::vector<F>{7, 0, 8, 0, 9, 2}));
+
+  mock::Mocker mocker;
+  for (auto s2 : mocker.vec_randvec(nbitems)) {
+    const auto copy = s2;
+    fill_missing<F>(s2.data(), s2.size());
+    REQUIRE(s2==copy);
+  }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+
+namespace tempo::transform::core::univariate {
+
+  /// Number of sliding windows of length 'window' over a series of length 'length' (0 if the series is shorter)
+  inline size_t nb_windows(size_t length, size_t window) {
+    return (window==0||length<window) ? 0 : length - window + 1;
+  }
+
+  /** Fourier coefficients of all the sliding windows of a series, for the Symbolic Fourier Approximation (SFA,
+   *  Schäfer and Högqvist, 2012). Computed with the Momentary Fourier Transform: each window is updated from the
+   *  previous one in O(nb_values), instead of O(window*nb_values) for a direct DFT.
+   *  With 'norm', each window is z-normalised: its mean (the coefficient 0) is dropped, and the other coefficients are
+   *  divided by the standard deviation of the window (unchanged for constant windows).
+   * @param series      Input series
+   * @param length      Length of the series
+   * @param window      Length of the windows
+   * @param nb_values   Number of real values per window (even): the real and imaginary parts of the nb_values/2 first
+   *                    coefficients, starting at 1 with 'norm', else at 0
+   * @param norm        z-normalise the windows
+   * @param out         nb_windows(length, window)*nb_values values, window after window
+   */
+  template<std::floating_point F>
+  void sfa_dft(F const *series, size_t length, size_t window, size_t nb_values, bool norm, F *out) {
+    const size_t nbw = nb_windows(length, window);
+    if (nbw==0) { return; }
+    const size_t nb_coefs = nb_values/2;
+    const size_t first = norm ? 1 : 0;
+    // Twiddle factors e^{2i.pi.k/window} of the coefficients, and their values on the first window (direct DFT)
+    std::vector<F> tw_re(nb_coefs), tw_im(nb_coefs), re(nb_coefs, 0), im(nb_coefs, 0);
+    for (size_t c = 0; c<nb_coefs; ++c) {
+      const F a = 2*std::numbers::pi_v<F>*(F)(c + first)/(F)window;
+      tw_re[c] = std::cos(a);
+      tw_im[c] = std::sin(a);
+      for (size_t t = 0; t<window; ++t) {
+        const F b = -a*(F)t;
+        re[c] += series[t]*std::cos(b);
+        im[c] += series[t]*std::sin(b);
+      }
+    }
+    F sum = 0;
+    F sumsq = 0;
+    for (size_t t = 0; t<window; ++t) {
+      sum += series[t];
+      sumsq += series[t]*series[t];
+    }
+    for (size_t w = 0; w<nbw; ++w) {
+      F scale = 1;
+      if (norm) {
+        const F mean = sum/(F)window;
+        const F var = sumsq/(F)window - mean*mean;
+        if (var>0) { scale = 1/std::sqrt(var); }
+      }
+      F *o = out + w*nb_values;
+      for (size_t c = 0; c<nb_coefs; ++c) {
+        o[2*c] = re[c]*scale;
+        o[2*c + 1] = im[c]*scale;
+      }
+      if (w + 1==nbw) { break; }
+      // Slide by one: X_k <- (X_k - x_w + x_{w+window}).e^{2i.pi.k/window}
+      const F delta = series[w + window] - series[w];
+      sum += delta;
+      sumsq += series[w + window]*series[w + window] - series[w]*series[w];
+      for (size_t c = 0; c<nb_coefs; ++c) {
+        const F r = re[c] + delta;
+        const F i = im[c];
+        re[c] = r*tw_re[c] - i*tw_im[c];
+        im[c] = r*tw_im[c] + i*tw_re[c];
+      }
+    }
+  }
+
+  /** Multiple Coefficient Binning of SFA: equi-depth breakpoints of each of the 'nb_values' values of the windows,
+   *  learned from 'values' (sfa_dft output of the train series, concatenated). The value v of index j falls in the
+   *  bin (symbol) s if bins[j*(alphabet-1) + s - 1] <= v < bins[j*(alphabet-1) + s].
+   * @return nb_values*(alphabet-1) breakpoints
+   */
+  template<std::floating_point F>
+  std::vector<F> sfa_bins(std::vector<F> const& values, size_t nb_values, size_t alphabet) {
+    const size_t nb_rows = nb_values==0 ? 0 : values.size()/nb_values;
+    std::vector<F> bins(nb_values*(alphabet - 1), 0);
+    if (nb_rows==0) { return bins; }
+    std::vector<F> column(nb_rows);
+    for (size_t j = 0; j<nb_values; ++j) {
+      for (size_t r = 0; r<nb_rows; ++r) { column[r] = values[r*nb_values + j]; }
+      std::sort(column.begin(), column.end());
+      for (size_t s = 1; s<alphabet; ++s) { bins[j*(alphabet - 1) + s - 1] = column[(s*nb_rows)/alphabet]; }
+    }
+    return bins;
+  }
+
+  /// SFA word of one window: the symbols of its 'nb_values' values (see sfa_bins), 'bits' bits each, packed with the
+  /// first value in the highest bits. nb_values*bits must be at most 32.
+  template<std::floating_point F>
+  uint32_t sfa_word(F const *values, size_t nb_values, F const *bins, size_t alphabet, size_t bits) {
+    uint32_t word = 0;
+    for (size_t j = 0; j<nb_values; ++j) {
+      F const *b = bins + j*(alphabet - 1);
+      const auto symbol = (uint32_t)(std::upper_bound(b, b + alphabet - 1, values[j]) - b);
+      word = (word << bits) | symbol;
+    }
+    return word;
+  }
+
+}
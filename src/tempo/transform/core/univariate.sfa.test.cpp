@@ -0,0 +1,101 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "univariate.sfa.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+using F = double;
+constexpr size_t nbitems = 100;
+using namespace tempo::transform::core::univariate;
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Reference
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+namespace ref {
+
+  /// Direct DFT of each window, z-normalised with 'norm'
+  std::vector<F> sfa_dft(std::vector<F> const& series, size_t window, size_t nb_values, bool norm) {
+    std::vector<F> result;
+    for (size_t w = 0; w + window<=series.size(); ++w) {
+      std::vector<F> x(series.begin() + (long)w, series.begin() + (long)(w + window));
+      if (norm) {
+        F mean = 0;
+        for (F v : x) { mean += v; }
+        mean /= (F)window;
+        F var = 0;
+        for (F v : x) { var += (v - mean)*(v - mean); }
+        var /= (F)window;
+        for (F& v : x) { v = var>0 ? (v - mean)/std::sqrt(var) : v - mean; }
+      }
+      for (size_t c = 0; c<nb_values/2; ++c) {
+        const size_t k = c + (norm ? 1 : 0);
+        F re = 0;
+        F im = 0;
+        for (size_t t = 0; t<window; ++t) {
+          const F a = -2*std::numbers::pi_v<F>*(F)(k*t)/(F)window;
+          re += x[t]*std::cos(a);
+          im += x[t]*std::sin(a);
+        }
+        result.push_back(re);
+        result.push_back(im);
+      }
+    }
+    return result;
+  }
+
+} // End of namespace ref
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+TEST_CASE("Univariate SFA", "[transform][univariate][sfa]") {
+  mock::Mocker mocker;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t length = mocker._fixl;
+
+  REQUIRE(nb_windows(20, 5)==16);
+  REQUIRE(nb_windows(4, 5)==0);
+
+  SECTION("Momentary Fourier Transform == direct DFT") {
+    for (const auto& s : fset) {
+      for (size_t window : {size_t(3), size_t(10), length}) {
+        for (bool norm : {false, true}) {
+          const std::vector<F> expected = ref::sfa_dft(s, window, 8, norm);
+          std::vector<F> values(nb_windows(length, window)*8);
+          sfa_dft<F>(s.data(), length, window, 8, norm, values.data());
+          REQUIRE(values.size()==expected.size());
+          for (size_t i = 0; i<values.size(); ++i) { REQUIRE(values[i]==Catch::Approx(expected[i]).margin(1e-6)); }
+        }
+      }
+    }
+  }
+
+  SECTION("Equi-depth bins and words") {
+    std::vector<F> values;
+    for (const auto& s : fset) {
+      const size_t nbw = nb_windows(length, 10);
+      const size_t offset = values.size();
+      values.resize(offset + nbw*4);
+      sfa_dft<F>(s.data(), length, 10, 4, true, values.data() + offset);
+    }
+    const std::vector<F> bins = sfa_bins(values, 4, 4);
+    REQUIRE(bins.size()==4*3);
+    // Sorted breakpoints, each symbol drawn by about a quarter of the windows
+    std::vector<size_t> counts(4, 0);
+    const size_t nb_rows = values.size()/4;
+    for (size_t j = 0; j<4; ++j) {
+      REQUIRE(std::is_sorted(bins.begin() + (long)(j*3), bins.begin() + (long)(j*3 + 3)));
+    }
+    for (size_t r = 0; r<nb_rows; ++r) {
+      const uint32_t word = sfa_word(values.data() + r*4, 4, bins.data(), 4, 2);
+      REQUIRE(word<256);
+      counts[word >> 6]++;
+    }
+    for (size_t c : counts) { REQUIRE(std::abs((double)c - (double)nb_rows/4)<=(double)nb_rows/20 + 1); }
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+#include <numbers>
+
+namespace tempo::transform::core::univariate {
+
+  /** Autocorrelation function (ACF) of a series, for the lags 1 to nb_lags, as in the RISE classifier (Lines et al.,
+   *  2018): out[l-1] = sum_t (s[t]-m)(s[t+l]-m) / ((length-l)*var), with m and var the mean and (biased) variance of
+   *  the series. Constant series have an ACF of 0. Lags at or above 'length' get 0.
+   */
+  template<std::floating_point F>
+  void acf(F const *series, size_t length, size_t nb_lags, F *out) {
+    F mean = 0;
+    for (size_t t = 0; t<length; ++t) { mean += series[t]; }
+    mean = length==0 ? 0 : mean/(F)length;
+    F var = 0;
+    for (size_t t = 0; t<length; ++t) { var += (series[t] - mean)*(series[t] - mean); }
+    var = length==0 ? 0 : var/(F)length;
+    for (size_t l = 1; l<=nb_lags; ++l) {
+      if (l>=length||!(var>0)) {
+        out[l - 1] = 0;
+        continue;
+      }
+      F sum = 0;
+      for (size_t t = 0; t + l<length; ++t) { sum += (series[t] - mean)*(series[t + l] - mean); }
+      out[l - 1] = sum/((F)(length - l)*var);
+    }
+  }
+
+  /** Power spectrum of a series: squared magnitude of its Fourier coefficients 0 to nb_coefs-1, as in the RISE
+   *  classifier. Direct DFT, the twiddle factors of a coefficient being computed by recurrence.
+   */
+  template<std::floating_point F>
+  void power_spectrum(F const *series, size_t length, size_t nb_coefs, F *out) {
+    for (size_t k = 0; k<nb_coefs; ++k) {
+      const F a = -2*std::numbers::pi_v<F>*(F)k/(F)length;
+      const F step_re = std::cos(a);
+      const F step_im = std::sin(a);
+      F tw_re = 1;
+      F tw_im = 0;
+      F re = 0;
+      F im = 0;
+      for (size_t t = 0; t<length; ++t) {
+        re += series[t]*tw_re;
+        im += series[t]*tw_im;
+        const F r = tw_re*step_re - tw_im*step_im;
+        tw_im = tw_re*step_im + tw_im*step_re;
+        tw_re = r;
+      }
+      out[k] = re*re + im*im;
+    }
+  }
+
+}
@@ -0,0 +1,74 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "univariate.spectral.hpp"
+
+#include <mock/mockseries.hpp>
+
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+using F = double;
+constexpr size_t nbitems = 100;
+using namespace tempo::transform::core::univariate;
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Reference
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+namespace ref {
+
+  std::vector<F> power_spectrum(std::vector<F> const& series, size_t nb_coefs) {
+    std::vector<F> result;
+    const size_t n = series.size();
+    for (size_t k = 0; k<nb_coefs; ++k) {
+      F re = 0;
+      F im = 0;
+      for (size_t t = 0; t<n; ++t) {
+        const F a = -2*std::numbers::pi_v<F>*(F)(k*t)/(F)n;
+        re += series[t]*std::cos(a);
+        im += series[t]*std::sin(a);
+      }
+      result.push_back(re*re + im*im);
+    }
+    return result;
+  }
+
+} // End of namespace ref
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+TEST_CASE("Univariate spectral features", "[transform][univariate][spectral]") {
+  mock::Mocker mocker;
+  const auto fset = mocker.vec_randvec(nbitems);
+  const size_t length = mocker._fixl;
+
+  SECTION("Power spectrum") {
+    for (const auto& s : fset) {
+      const std::vector<F> expected = ref::power_spectrum(s, length/2);
+      std::vector<F> ps(length/2);
+      power_spectrum<F>(s.data(), length, length/2, ps.data());
+      for (size_t k = 0; k<ps.size(); ++k) { REQUIRE(ps[k]==Catch::Approx(expected[k]).margin(1e-6)); }
+    }
+  }
+
+  SECTION("ACF") {
+    // Periodic series: ACF close to 1 at the period, to -1 at half the period
+    std::vector<F> periodic(400);
+    for (size_t t = 0; t<periodic.size(); ++t) { periodic[t] = std::sin(2*std::numbers::pi_v<F>*(F)t/20); }
+    std::vector<F> out(20);
+    acf<F>(periodic.data(), periodic.size(), 20, out.data());
+    REQUIRE(out[19]==Catch::Approx(1).margin(0.01));
+    REQUIRE(out[9]==Catch::Approx(-1).margin(0.01));
+    // Constant series
+    std::vector<F> constant(50, 3.0);
+    acf<F>(constant.data(), constant.size(), 5, out.data());
+    for (size_t l = 0; l<5; ++l) { REQUIRE(out[l]==0); }
+    // Bounded
+    for (const auto& s : fset) {
+      acf<F>(s.data(), length, 10, out.data());
+      for (size_t l = 0; l<10; ++l) { REQUIRE(std::abs(out[l])<=1.5); }
+    }
+  }
+}
@@ -0,0 +1,270 @@
+#include "pipeline.hpp"
+
+#include "univariate.hpp"
+#include "core/univariate.derivative.hpp"
+#include "core/univariate.paa.hpp"
+#include "core/univariate.resample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <set>
+#include <stdexcept>
+
+namespace tempo::transform {
+
+  namespace {
+
+    /** Transform the series of 'dts' into one slab per name, calling 'task(start, stop, offsets, buffers)' on
+     *  'nb_tasks_per_block' tasks per block [start, stop[ of series, in parallel. The series i of the transform k
+     *  has the length out_length(k, source series), and is written at buffers[k] + offsets[k][i].
+     *  The series keep the missing value flag of their source, unless 'filled' (the task replaced the missing values).
+     */
+    template<typename Task, typename OutLength>
+    std::map<std::string, DTS> transform_slabs(DTS const& dts, std::vector<std::string> const& names,
+                                               size_t nb_tasks_per_block, Task&& task, size_t nb_threads,
+                                               OutLength&& out_length, bool filled = false) {
+      DatasetTransform<TSeries> const& source = dts.transform();
+      const size_t nb_series = source.size();
+
+      // --- Offset of each series in the buffers
+      std::vector<std::vector<size_t>> offsets(names.size(), std::vector<size_t>(nb_series + 1, 0));
+      for (size_t k = 0; k<names.size(); ++k) {
+        for (size_t i = 0; i<nb_series; ++i) {
+          offsets[k][i + 1] = offsets[k][i] + out_length(k, source[i])*source[i].nb_dimensions();
+        }
+      }
+
+      // --- One slab per transform
+      std::vector<SeriesSlab> slabs;
+      std::vector<F *> buffers;
+      for (size_t k = 0; k<names.size(); ++k) {
+        slabs.emplace_back(offsets[k].back());
+        buffers.push_back(slabs.back().data);
+      }
+
+      // --- Transform by blocks of series
+      constexpr size_t BLOCK_SIZE = 64;
+      const size_t nb_blocks = (nb_series + BLOCK_SIZE - 1)/BLOCK_SIZE;
+      auto block_task = [&](size_t task_idx) {
+        const size_t start = (task_idx%nb_blocks)*BLOCK_SIZE;
+        const size_t stop = std::min(nb_series, start + BLOCK_SIZE);
+        task(task_idx/nb_blocks, start, stop, source, offsets, buffers);
+      };
+      utils::ParTasks().execute((int)nb_threads, block_task, 0, nb_tasks_per_block*nb_blocks);
+
+      // --- Build the series viewing the buffers, and the splits
+      std::map<std::string, DTS> result;
+      for (size_t k = 0; k<names.size(); ++k) {
+        std::vector<TSeries> storage;
+        storage.reserve(nb_series);
+        for (size_t i = 0; i<nb_series; ++i) {
+          TSeries const& like = source[i];
+          storage.push_back(TSeries::mk_view(slabs[k].capsule, slabs[k].data + offsets[k][i], like.nb_dimensions(),
+                                             out_length(k, like), like.label(), {!filled&&like.missing()}));
+        }
+        auto transform = std::make_shared<DatasetTransform<TSeries>>(source, names[k], std::move(storage));
+        result.emplace(names[k], DTS(dts, std::move(transform)));
+      }
+      return result;
+    }
+
+    /// Output length of the shape keeping transforms
+    size_t same_length(size_t /* k */, TSeries const& in) { return in.length(); }
+
+    /// Z-normalisation of a series with its values 'stride' apart, written with the same stride.
+    /// Sample standard deviation, as univariate::zscore; constant series are copied unchanged.
+    void zscore_strided(F const *series, size_t length, size_t stride, F *out) {
+      F sum = 0;
+      for (size_t i = 0; i<length; ++i) { sum += series[i*stride]; }
+      const F mean = length==0 ? 0 : sum/(F)length;
+      F sumsq = 0;
+      for (size_t i = 0; i<length; ++i) {
+        const F d = series[i*stride] - mean;
+        sumsq += d*d;
+      }
+      const F sd = length<2 ? 0 : std::sqrt(sumsq/(F)(length - 1));
+      if (sd==0) { for (size_t i = 0; i<length; ++i) { out[i*stride] = series[i*stride]; }}
+      else { for (size_t i = 0; i<length; ++i) { out[i*stride] = (series[i*stride] - mean)/sd; }}
+    }
+
+    /// Degree of 'name' if it is "<prefix><n>" with n>0
+    std::optional<size_t> degree_of(std::string const& name, std::string const& prefix) {
+      if (!name.starts_with(prefix)) { return {}; }
+      const std::string deg = name.substr(prefix.size());
+      if (deg.empty()||deg.size()>9||!std::all_of(deg.begin(), deg.end(), [](char c) { return '0'<=c&&c<='9'; })) {
+        return {};
+      }
+      const size_t n = std::stoul(deg);
+      if (n==0) { return {}; }
+      return n;
+    }
+
+  } // End of anonymous namespace
+
+  std::map<std::string, DTS> transform_all(DTS const& dts, NamedKernels const& kernels, size_t nb_threads) {
+    std::vector<std::string> names;
+    for (auto const& [name, _] : kernels) { names.push_back(name); }
+    // All the transforms at once: one task per transform and block
+    auto task = [&](size_t k, size_t start, size_t stop, DatasetTransform<TSeries> const& source,
+                    std::vector<std::vector<size_t>> const& offsets, std::vector<F *> const& buffers) {
+      ShapeKernel const& kernel = kernels[k].second;
+      for (size_t i = start; i<stop; ++i) { kernel(source[i], buffers[k] + offsets[k][i]); }
+    };
+    return transform_slabs(dts, names, kernels.size(), task, nb_threads, same_length);
+  }
+
+  std::map<std::string, DTS> transform_fused(DTS const& dts, std::vector<std::string> const& names,
+                                             FusedKernel const& kernel, size_t nb_threads) {
+    // One task per block, writing all the transforms of its series
+    auto task = [&](size_t /* k */, size_t start, size_t stop, DatasetTransform<TSeries> const& source,
+                    std::vector<std::vector<size_t>> const& offsets, std::vector<F *> const& buffers) {
+      std::vector<F *> out(buffers.size());
+      for (size_t i = start; i<stop; ++i) {
+        for (size_t k = 0; k<buffers.size(); ++k) { out[k] = buffers[k] + offsets[k][i]; }
+        kernel(source[i], out.data());
+      }
+    };
+    return transform_slabs(dts, names, 1, task, nb_threads, same_length);
+  }
+
+  std::map<std::string, DTS> transform_paa(DTS const& dts, std::vector<size_t> const& factors, size_t nb_threads) {
+    std::vector<std::string> names;
+    for (size_t f : factors) {
+      if (f<2) { throw std::invalid_argument("PAA factor must be at least 2, got " + std::to_string(f)); }
+      names.push_back("paa" + std::to_string(f));
+      if (std::count(names.begin(), names.end(), names.back())>1) {
+        throw std::invalid_argument("Repeated PAA factor " + std::to_string(f));
+      }
+    }
+    // One task per factor and block, each dimension (a row of the column major matrix) reduced separately
+    auto task = [&](size_t k, size_t start, size_t stop, DatasetTransform<TSeries> const& source,
+                    std::vector<std::vector<size_t>> const& offsets, std::vector<F *> const& buffers) {
+      for (size_t i = start; i<stop; ++i) {
+        TSeries const& in = source[i];
+        const size_t ndim = in.nb_dimensions();
+        for (size_t d = 0; d<ndim; ++d) {
+          core::univariate::paa<F>(in.data() + d, in.length(), factors[k], buffers[k] + offsets[k][i] + d, ndim);
+        }
+      }
+    };
+    auto paa_length = [&](size_t k, TSeries const& in) {
+      return core::univariate::paa_length(in.length(), factors[k]);
+    };
+    return transform_slabs(dts, names, factors.size(), task, nb_threads, paa_length);
+  }
+
+  std::optional<size_t> paa_factor(std::string const& name) {
+    auto f = degree_of(name, "paa");
+    if (!f||*f<2) { return {}; }
+    return f;
+  }
+
+  std::map<std::string, DTS> transform_resample(DTS const& dts, size_t length, size_t nb_threads) {
+    if (length<2) { throw std::invalid_argument("Resampling length must be at least 2, got " + std::to_string(length)); }
+    const std::vector<std::string> names{"resample" + std::to_string(length)};
+    // One task per block. Each dimension is filled in a copy, then scaled into the output.
+    auto task = [&](size_t /* k */, size_t start, size_t stop, DatasetTransform<TSeries> const& source,
+                    std::vector<std::vector<size_t>> const& offsets, std::vector<F *> const& buffers) {
+      std::vector<F> dim;
+      for (size_t i = start; i<stop; ++i) {
+        TSeries const& in = source[i];
+        const size_t ndim = in.nb_dimensions();
+        const size_t l = in.length();
+        F *out = buffers[0] + offsets[0][i];
+        for (size_t d = 0; d<ndim; ++d) {
+          F const *values = in.data() + d;
+          size_t stride = ndim;
+          if (in.missing()) {
+            dim.resize(l);
+            for (size_t c = 0; c<l; ++c) { dim[c] = values[c*ndim]; }
+            core::univariate::fill_missing<F>(dim.data(), l);
+            values = dim.data();
+            stride = 1;
+          }
+          core::univariate::resample<F>(values, l, length, out + d, stride, ndim);
+        }
+      }
+    };
+    auto out_length = [length](size_t /* k */, TSeries const& /* in */) { return length; };
+    return transform_slabs(dts, names, 1, task, nb_threads, out_length, true);
+  }
+
+  ShapeKernel derivative_kernel(size_t degree) {
+    return [degree](TSeries const& in, F *out) {
+      const size_t l = in.length();
+      const size_t ndim = in.nb_dimensions();
+      if (ndim==1) {
+        univariate::derive(in.data(), l, out, degree);
+      } else {
+        // Derive each dimension (a row of the column major matrix), then interleave in the output
+        arma::Row<F> row(l);
+        arma::Row<F> d(l);
+        for (size_t k = 0; k<ndim; ++k) {
+          row = in.matrix().row(k);
+          univariate::derive(row.memptr(), l, d.memptr(), degree);
+          for (size_t c = 0; c<l; ++c) { out[c*ndim + k] = d[c]; }
+        }
+      }
+    };
+  }
+
+  FusedKernel derived_kernel(std::vector<std::string> const& names) {
+    // Output position of each step, if requested: raw_out[d-1] for the derivative of degree d of the series,
+    // z_out[d] for the derivative of degree d of the z-normalised series (d=0 for the z-normalised series)
+    std::vector<std::optional<size_t>> raw_out;
+    std::vector<std::optional<size_t>> z_out;
+    std::set<std::string> seen;
+    for (size_t k = 0; k<names.size(); ++k) {
+      std::string const& name = names[k];
+      if (!seen.insert(name).second) { throw std::invalid_argument("Repeated derived transform " + name); }
+      if (name=="zscore") {
+        if (z_out.empty()) { z_out.resize(1); }
+        z_out[0] = k;
+      } else if (auto zd = degree_of(name, "zscore_derivative"); zd) {
+        if (z_out.size()<=*zd) { z_out.resize(*zd + 1); }
+        z_out[*zd] = k;
+      } else if (auto d = degree_of(name, "derivative"); d) {
+        if (raw_out.size()<*d) { raw_out.resize(*d); }
+        raw_out[*d - 1] = k;
+      } else {
+        throw std::invalid_argument("Unknown derived transform " + name);
+      }
+    }
+    const size_t nb_scratch = (size_t)std::count(raw_out.begin(), raw_out.end(), std::nullopt)
+                              + (size_t)std::count(z_out.begin(), z_out.end(), std::nullopt);
+
+    return [raw_out, z_out, nb_scratch](TSeries const& in, F *const *out) {
+      const size_t l = in.length();
+      const size_t ndim = in.nb_dimensions();
+      // Steps without output are written in a per thread scratch buffer, with the layout of the series
+      thread_local std::vector<F> scratch;
+      thread_local std::vector<F *> raw;
+      thread_local std::vector<F *> z;
+      scratch.resize(nb_scratch*in.size());
+      size_t next_scratch = 0;
+      auto step = [&](std::optional<size_t> const& o) {
+        return o ? out[*o] : scratch.data() + (next_scratch++)*in.size();
+      };
+      raw.clear();
+      for (auto const& o : raw_out) { raw.push_back(step(o)); }
+      z.clear();
+      for (auto const& o : z_out) { z.push_back(step(o)); }
+      // Per dimension: a row of the column major matrix, values 'ndim' apart
+      std::vector<F *> dim_outs(std::max(raw.size(), z.size()));
+      for (size_t k = 0; k<ndim; ++k) {
+        F const *series = in.data() + k;
+        if (!raw.empty()) {
+          for (size_t d = 0; d<raw.size(); ++d) { dim_outs[d] = raw[d] + k; }
+          core::univariate::derive_chain<F>(series, l, ndim, dim_outs.data(), raw.size());
+        }
+        if (!z.empty()) {
+          zscore_strided(series, l, ndim, z[0] + k);
+          for (size_t d = 1; d<z.size(); ++d) { dim_outs[d - 1] = z[d] + k; }
+          core::univariate::derive_chain<F>(z[0] + k, l, ndim, dim_outs.data(), z.size() - 1);
+        }
+      }
+    };
+  }
+
+} // End of namespace tempo::transform
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <tempo/dataset/dts.hpp>
+
+namespace tempo::transform {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Transform pipeline stage
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Series transform keeping the shape of the series (same number of dimensions and length):
+  /// write the transform of 'in' in 'out', in column major order (in.size() values, see TSeries).
+  using ShapeKernel = std::function<void(TSeries const& in, F *out)>;
+
+  /// Named transforms, see transform_all
+  using NamedKernels = std::vector<std::pair<std::string, ShapeKernel>>;
+
+  /** Compute several named transforms of a split in one pass.
+   *  Each transform is written in a single slab, viewed by its series (see SeriesSlab),
+   *  instead of one allocation per series. The series are transformed in parallel, by blocks.
+   *  As with DatasetTransform::map, all the series of the split's transform are transformed.
+   *  The statistics of the new series are only computed if requested (see TSeries).
+   * @param dts         Input split
+   * @param kernels     Named transforms to compute
+   * @param nb_threads  Number of threads
+   * @return Per name, the split over its new transform, with the same name and index set as 'dts'
+   */
+  std::map<std::string, DTS> transform_all(DTS const& dts, NamedKernels const& kernels, size_t nb_threads);
+
+  /// Kernel computing the n-th derivative (see univariate::derive).
+  /// Multivariate series are derived per dimension.
+  ShapeKernel derivative_kernel(size_t degree);
+
+  /// Series transform producing several shape keeping transforms at once, e.g. sharing intermediate results:
+  /// write the k-th transform of 'in' in out[k] (in.size() values each, in column major order, see TSeries).
+  using FusedKernel = std::function<void(TSeries const& in, F *const *out)>;
+
+  /** Compute the transforms 'names' of a split with one fused kernel, in one pass over the series.
+   *  As transform_all (one slab per transform, series transformed in parallel by blocks), 'kernel' writing the
+   *  transform names[k] in its k-th output.
+   */
+  std::map<std::string, DTS> transform_fused(DTS const& dts, std::vector<std::string> const& names,
+                                             FusedKernel const& kernel, size_t nb_threads);
+
+  /** Fused kernel of derived representations (see transform_fused), computed per series and per dimension:
+   *  * "derivative<n>": n-th derivative (n>0), as derivative_kernel
+   *  * "zscore": z-normalised series (unchanged if constant), as univariate::zscore
+   *  * "zscore_derivative<n>": n-th derivative of the z-normalised series
+   *  Each derivative is derived from the previous degree, computed once even if not requested
+   *  (see core::univariate::derive_chain). Throws std::invalid_argument on unknown or repeated names.
+   */
+  FusedKernel derived_kernel(std::vector<std::string> const& names);
+
+  /** Compute the PAA (see core::univariate::paa) of a split for each factor of 'factors' (at least 2), in one pass,
+   *  as transform_all. Each dimension is reduced separately: the series of "paa<f>" have ceil(length/f) values per
+   *  dimension. The splits keep the header of 'dts', hence its lengths, not the reduced ones.
+   *  Throws std::invalid_argument on factors below 2 or repeated.
+   * @return Per name "paa<f>", the split over its new transform, with the same name and index set as 'dts'
+   */
+  std::map<std::string, DTS> transform_paa(DTS const& dts, std::vector<size_t> const& factors, size_t nb_threads);
+
+  /// Factor of a PAA transform name "paa<f>" (see transform_paa), nothing if 'name' is not one
+  std::optional<size_t> paa_factor(std::string const& name);
+
+  /** Resample each series of a split to 'length' (at least 2) values per dimension, in parallel, as transform_all.
+   *  The missing values of a dimension are first filled by linear interpolation (see core::univariate::fill_missing),
+   *  then the dimension is uniformly scaled (see core::univariate::resample): the series of "resample<length>" have
+   *  the same length and no missing value, and can be compared with the equal length kernels of the distances.
+   *  The split keeps the header of 'dts', hence its lengths and missing value records (see
+   *  reader::dataset::resample to rebuild them). Throws std::invalid_argument on a length below 2.
+   * @return Under the name "resample<length>", the split over its new transform, with the same name and index set
+   */
+  std::map<std::string, DTS> transform_resample(DTS const& dts, size_t length, size_t nb_threads);
+
+} // End of namespace tempo::transform
@@ -16,17 +16,35 @@ namespace tempo::transform::univariate {
 
   TSeries derive(TSeries const& ts){
     const size_t l = ts.length();
-    std::vector<F> d(l);
-    double* data = d.data();
-    tempo::transform::univariate::derive(ts.data(), l, data);
+    const size_t ndim = ts.nb_dimensions();
+    std::vector<F> d(l*ndim);
+    F* data = d.data();
+    if (ndim==1) {
+      tempo::transform::univariate::derive(ts.data(), l, data);
+    } else {
+      // Multivariate: derive each dimension independently (a dimension is a row of the column major matrix)
+      for (size_t k = 0; k<ndim; ++k) {
+        const arma::Row<F> row = ts.matrix().row(k);
+        tempo::transform::univariate::derive(row.memptr(), l, data + k*l);
+      }
+    }
     return TSeries::mk_from_rowmajor(ts, std::move(d));
   }
 
   TSeries derive(TSeries const& ts, size_t degree){
     const size_t l = ts.length();
-    std::vector<F> d(l);
-    double* data = d.data();
-    tempo::transform::univariate::derive(ts.data(), l, data, degree);
+    const size_t ndim = ts.nb_dimensions();
+    std::vector<F> d(l*ndim);
+    F* data = d.data();
+    if (ndim==1) {
+      tempo::transform::univariate::derive(ts.data(), l, data, degree);
+    } else {
+      // Multivariate: derive each dimension independently, see above
+      for (size_t k = 0; k<ndim; ++k) {
+        const arma::Row<F> row = ts.matrix().row(k);
+        tempo::transform::univariate::derive(row.memptr(), l, data + k*l, degree);
+      }
+    }
     return TSeries::mk_from_rowmajor(ts, std::move(d));
   }
 
@@ -36,7 +54,7 @@ namespace tempo::transform::univariate {
     const size_t l = ts.length();
     const F stddev = ts.stddev()[0];
     std::vector<F> d(l);
-    double* data = d.data();
+    F* data = d.data();
     tempo::transform::univariate::noise(ts.data(), l, stddev, delta, prng, data);
     return TSeries::mk_from_rowmajor(ts, std::move(d));
   }
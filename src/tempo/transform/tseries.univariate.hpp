@@ -6,7 +6,7 @@ namespace tempo::transform::univariate {
 
   // --- --- --- Derivative
 
-  /// Derivative, as defined in DDTW, for univariate TSeries
+  /// Derivative, as defined in DDTW. Multivariate TSeries are derived per dimension.
   TSeries derive(TSeries const& ts);
 
   /// n-th derivative
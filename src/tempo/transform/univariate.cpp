@@ -44,17 +44,43 @@ namespace tempo::transform::univariate {
   template arma::Row<F> zscore(arma::Row<F> const& A);
 
 
-
-
-
-  /*
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
-  // Float implementation
+  // Float & Mersenne Twister implementation
   // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
   using Ff = float;
 
+  // --- --- --- Derivative
+
   template void derive<Ff>(Ff const* data, size_t length, Ff* output);
+  template void derive<Ff>(Ff const* data, size_t length, Ff* output, size_t degree);
+
+  // --- --- --- Noise
+
+  template void noise<Ff, PRNG>(Ff const* data, size_t length, Ff stddev, Ff delta, PRNG& prng, Ff* output);
+
+  // --- --- --- Normalisation
+
+  template void minmax<Ff>(Ff const* data, size_t length, Ff* output, Ff rmin, Ff rmax);
+
+  template void percentile_minmax(Ff const *data, size_t length, Ff *output, size_t p, Ff range_min, Ff range_max);
+
+  template void meannorm(Ff const *data, size_t length, Ff *output);
+
+  template void unitlength(Ff const *data, size_t length, Ff *output);
+
+  template void zscore(Ff const *data, size_t length, Ff *output);
+
+  // --- --- --- --- --- --- Extra: Armadillo Row Vector
+
+  template arma::Row<Ff> minmax(arma::Row<Ff> const& A, Ff range_min, Ff range_max);
+
+  template arma::Row<Ff> percentile_minmax(arma::Row<Ff> const& A, size_t p, Ff range_min, Ff range_max);
+
+  template arma::Row<Ff> meannorm(arma::Row<Ff> const& A);
+
+  template arma::Row<Ff> unitlength(arma::Row<Ff> const& A);
+
+  template arma::Row<Ff> zscore(arma::Row<Ff> const& A);
 
-  */
 
 } // End of namespace tempo::transform::univariate
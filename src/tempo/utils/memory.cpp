@@ -0,0 +1,286 @@
+#include "utils/memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tempo::utils::memory {
+
+  size_t peak_rss_kib() {
+#if defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss/1024; // Bytes on macOS
+#elif defined(__unix__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss;
+#else
+    return 0;
+#endif
+  }
+
+  bool reset_peak_rss() {
+#if defined(__linux__)
+    std::ofstream out("/proc/self/clear_refs");
+    out << "5";
+    out.flush();
+    return (bool)out;
+#else
+    return false;
+#endif
+  }
+
+  size_t peak_rss_since_reset_kib() {
+#if defined(__linux__)
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.starts_with("VmHWM:")) { return std::strtoull(line.c_str() + 6, nullptr, 10); }
+    }
+#endif
+    return 0;
+  }
+
+  namespace {
+    /// Online NUMA nodes, read once from sysfs (format "0-3,5")
+    std::vector<size_t> const& online_nodes() {
+      static const std::vector<size_t> nodes = []() {
+        std::vector<size_t> result;
+#if defined(__linux__)
+        std::ifstream in("/sys/devices/system/node/online");
+        std::string range;
+        while (std::getline(in, range, ',')) {
+          std::istringstream iss(range);
+          size_t first;
+          size_t last;
+          char dash;
+          if (!(iss >> first)) { continue; }
+          if (!(iss >> dash >> last)) { last = first; }
+          for (size_t n = first; n<=last; ++n) { result.push_back(n); }
+        }
+#endif
+        return result;
+      }();
+      return nodes;
+    }
+  }
+
+  size_t nb_numa_nodes() { return std::max<size_t>(1, online_nodes().size()); }
+
+  bool interleave(void const *data, size_t nb_bytes) {
+#if defined(__linux__) && defined(SYS_mbind)
+    std::vector<size_t> const& nodes = online_nodes();
+    if (nodes.size()<2||nb_bytes==0) { return false; }
+    // Node mask, as an array of unsigned long
+    constexpr size_t bits = 8*sizeof(unsigned long);
+    std::vector<unsigned long> mask(nodes.back()/bits + 1, 0);
+    for (size_t n : nodes) { mask[n/bits] |= 1UL << (n%bits); }
+    // Whole pages
+    const auto page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    const uintptr_t start = (uintptr_t)data/page*page;
+    const uintptr_t stop = ((uintptr_t)data + nb_bytes + page - 1)/page*page;
+    constexpr int mpol_interleave = 3;  // MPOL_INTERLEAVE
+    constexpr unsigned mpol_mf_move = 2; // MPOL_MF_MOVE
+    return syscall(SYS_mbind, start, stop - start, mpol_interleave, mask.data(), mask.size()*bits + 1,
+                   mpol_mf_move)==0;
+#else
+    (void)data;
+    (void)nb_bytes;
+    return false;
+#endif
+  }
+
+  char const *to_string(HugePages mode) {
+    switch (mode) {
+      case HugePages::TRANSPARENT: return "thp";
+      case HugePages::EXPLICIT: return "hugetlb";
+      default: return "off";
+    }
+  }
+
+  std::optional<HugePages> parse_huge_pages(std::string_view name) {
+    for (HugePages m : {HugePages::OFF, HugePages::TRANSPARENT, HugePages::EXPLICIT}) {
+      if (name==to_string(m)) { return m; }
+    }
+    return {};
+  }
+
+  namespace {
+    constinit std::atomic<HugePages> huge_pages_mode{HugePages::OFF};
+
+    /// Buffers mapped by allocate_large, with their mapped length: the others come from operator new
+    std::mutex mapped_mtx;
+    std::unordered_map<void *, size_t> mapped;
+
+#if defined(__linux__)
+    /// Anonymous mapping of 'length' bytes (a multiple of huge_page_size) on huge pages, or nullptr
+    void *map_huge(size_t length, HugePages mode) {
+      if (mode==HugePages::EXPLICIT) {
+        void *p = mmap(nullptr, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (p!=MAP_FAILED) { return p; }
+      }
+      // Map one more huge page, then unmap the ends: the mapping then starts on a huge page boundary
+      const size_t over = length + huge_page_size;
+      void *q = mmap(nullptr, over, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+      if (q==MAP_FAILED) { return nullptr; }
+      const auto start = (uintptr_t)q;
+      const uintptr_t aligned = (start + huge_page_size - 1)/huge_page_size*huge_page_size;
+      if (aligned>start) { munmap(q, aligned - start); }
+      if (start + over>aligned + length) { munmap((void *)(aligned + length), start + over - aligned - length); }
+#if defined(MADV_HUGEPAGE)
+      madvise((void *)aligned, length, MADV_HUGEPAGE);
+#endif
+      return (void *)aligned;
+    }
+#endif
+  }
+
+  void set_huge_pages(HugePages mode) { huge_pages_mode.store(mode, std::memory_order_relaxed); }
+
+  HugePages huge_pages() { return huge_pages_mode.load(std::memory_order_relaxed); }
+
+  void *allocate_large(size_t nb_bytes, size_t alignment) {
+#if defined(__linux__)
+    const HugePages mode = huge_pages();
+    if (mode!=HugePages::OFF&&nb_bytes>=huge_page_size&&alignment<=huge_page_size) {
+      const size_t length = (nb_bytes + huge_page_size - 1)/huge_page_size*huge_page_size;
+      if (void *p = map_huge(length, mode); p!=nullptr) {
+        std::lock_guard lock(mapped_mtx);
+        mapped.emplace(p, length);
+        return p;
+      }
+    }
+#endif
+    return ::operator new(nb_bytes, std::align_val_t(alignment));
+  }
+
+  void deallocate_large(void *p, size_t nb_bytes, size_t alignment) noexcept {
+#if defined(__linux__)
+    if (nb_bytes>=huge_page_size) {
+      std::unique_lock lock(mapped_mtx);
+      if (auto it = mapped.find(p); it!=mapped.end()) {
+        const size_t length = it->second;
+        mapped.erase(it);
+        lock.unlock();
+        munmap(p, length);
+        return;
+      }
+    }
+#endif
+    ::operator delete(p, std::align_val_t(alignment));
+  }
+
+  DTLBMisses::DTLBMisses() {
+#if defined(__linux__) && defined(SYS_perf_event_open)
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB|(PERF_COUNT_HW_CACHE_OP_READ << 8)|(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    std::error_code ec;
+    for (auto const& task : std::filesystem::directory_iterator("/proc/self/task", ec)) {
+      const auto tid = (pid_t)std::stol(task.path().filename().string());
+      const int fd = (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+      if (fd<0) {
+        // All the threads or none
+        for (int f : fds) { close(f); }
+        fds.clear();
+        return;
+      }
+      fds.push_back(fd);
+    }
+    for (int fd : fds) { ioctl(fd, PERF_EVENT_IOC_RESET, 0); }
+#endif
+  }
+
+  DTLBMisses::~DTLBMisses() {
+#if defined(__linux__)
+    for (int fd : fds) { close(fd); }
+#endif
+  }
+
+  std::optional<uint64_t> DTLBMisses::read() const {
+    if (fds.empty()) { return {}; }
+    uint64_t total = 0;
+#if defined(__linux__)
+    for (int fd : fds) {
+      uint64_t value = 0;
+      if (::read(fd, &value, sizeof(value))!=(ssize_t)sizeof(value)) { return {}; }
+      total += value;
+    }
+#endif
+    return total;
+  }
+
+  namespace {
+    // Constant initialised: usable by the allocations made before main
+    constinit std::atomic<uint64_t> nb_allocations{0};
+    constinit std::atomic<uint64_t> nb_bytes{0};
+  }
+
+  Allocations allocations() {
+    return {nb_allocations.load(std::memory_order_relaxed), nb_bytes.load(std::memory_order_relaxed)};
+  }
+
+#ifdef TEMPO_COUNT_ALLOCATIONS
+  namespace {
+    void *counted_alloc(std::size_t size, std::size_t alignment) {
+      nb_allocations.fetch_add(1, std::memory_order_relaxed);
+      nb_bytes.fetch_add(size, std::memory_order_relaxed);
+      if (size==0) { size = 1; }
+      void *p;
+      if (alignment<=__STDCPP_DEFAULT_NEW_ALIGNMENT__) { p = std::malloc(size); }
+      else { p = std::aligned_alloc(alignment, (size + alignment - 1)/alignment*alignment); }
+      if (p==nullptr) { throw std::bad_alloc(); }
+      return p;
+    }
+  }
+#endif
+
+} // End of namespace tempo::utils::memory
+
+#ifdef TEMPO_COUNT_ALLOCATIONS
+// --- --- --- --- --- ---
+// Counting replacements of the global operator new/delete.
+// The other forms (arrays, nothrow) are defined by the standard library in terms of these ones.
+// --- --- --- --- --- ---
+
+void *operator new(std::size_t size) {
+  return tempo::utils::memory::counted_alloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return tempo::utils::memory::counted_alloc(size, (std::size_t)alignment);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#endif
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <istream>
 #include <sstream>
 #include <limits>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace tempo::reader {
@@ -156,4 +159,33 @@ namespace tempo::reader {
     }
   }
 
+  /** Convert a string into a double as 'as_double', reading plain numbers with std::from_chars.
+   *  Anything from_chars does not fully read (e.g. a leading '+') goes through 'as_double'. */
+  inline std::optional<double> as_double(std::string_view str) {
+    double d{};
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), d);
+    if (ec==std::errc()&&end==str.data() + str.size()) { return {d}; }
+    return as_double(std::string(str));
+  }
+
+  // --- --- ---
+  // --- --- --- memory
+  // --- --- ---
+
+  /** Split [begin, end[ at line boundaries into chunks parsed by 'nb_threads' threads:
+   *  a few chunks per thread, of at least 1MB (and at least one chunk).
+   *  Return the bounds of the chunks, the k-th being [bounds[k], bounds[k+1][. */
+  inline std::vector<char const *> line_chunks(char const *begin, char const *end, size_t nb_threads) {
+    const auto size = (size_t)(end - begin);
+    const size_t nb_chunks = std::max<size_t>(1, std::min(std::max<size_t>(nb_threads, 1)*4, size/(1 << 20)));
+    std::vector<char const *> bounds{begin};
+    for (size_t k = 1; k<nb_chunks; ++k) {
+      char const *p = std::max(bounds.back(), begin + size*k/nb_chunks);
+      auto *nl = static_cast<char const *>(std::memchr(p, '\n', end - p));
+      bounds.push_back(nl==nullptr ? end : nl + 1);
+    }
+    bounds.push_back(end);
+    return bounds;
+  }
+
 } // End of namespace tempo::reader
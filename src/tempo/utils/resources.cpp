@@ -0,0 +1,179 @@
+#include "utils/resources.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#endif
+
+namespace tempo::utils::resources {
+
+  namespace {
+
+    /// Root of the cgroup hierarchy
+    const std::string cgroup_root{"/sys/fs/cgroup"};
+
+    /// First line of a file, empty if it can not be read
+    std::string read_line(std::string const& path) {
+      std::ifstream in(path);
+      std::string line;
+      std::getline(in, line);
+      return line;
+    }
+
+    /// Candidate directories of the cgroup v2 of the process: its own path (from /proc/self/cgroup), then the root,
+    /// which is the cgroup of the process in a container with its own cgroup namespace
+    std::vector<std::string> cgroup_v2_dirs() {
+      std::vector<std::string> dirs;
+      std::ifstream in("/proc/self/cgroup");
+      std::string line;
+      while (std::getline(in, line)) {
+        if (line.starts_with("0::")) {
+          const std::string path = line.substr(3);
+          if (!path.empty()&&path!="/") { dirs.push_back(cgroup_root + path); }
+        }
+      }
+      dirs.push_back(cgroup_root);
+      return dirs;
+    }
+
+    /// Unsigned number, if 'text' holds one
+    std::optional<size_t> parse_size(std::string const& text) {
+      try { return {(size_t)std::stoull(text)}; } catch (std::exception const&) { return {}; }
+    }
+
+    /// Limits above this are the "no limit" of cgroup v1 (a page aligned LONG_MAX)
+    constexpr size_t v1_unlimited = size_t(1) << 60;
+
+    std::mutex budget_mutex;
+    std::optional<MemoryBudget> current_budget;
+    std::atomic<size_t> slab_total{0};
+
+  } // End of anonymous namespace
+
+  std::optional<double> cgroup_cpu_quota() {
+#if defined(__linux__)
+    // cgroup v2: "<quota> <period>" or "max <period>"
+    for (std::string const& dir : cgroup_v2_dirs()) {
+      const std::string line = read_line(dir + "/cpu.max");
+      if (line.empty()) { continue; }
+      if (line.starts_with("max")) { return {}; }
+      const size_t space = line.find(' ');
+      auto quota = parse_size(line.substr(0, space));
+      auto period = space==std::string::npos ? std::optional<size_t>{100000} : parse_size(line.substr(space + 1));
+      if (quota&&period&&period.value()>0) { return {(double)quota.value()/(double)period.value()}; }
+    }
+    // cgroup v1: a quota of -1 is no limit
+    for (std::string const& dir : {cgroup_root + "/cpu,cpuacct", cgroup_root + "/cpu"}) {
+      const std::string quota = read_line(dir + "/cpu.cfs_quota_us");
+      if (quota.empty()||quota.starts_with("-")) { continue; }
+      auto q = parse_size(quota);
+      auto p = parse_size(read_line(dir + "/cpu.cfs_period_us"));
+      if (q&&p&&p.value()>0) { return {(double)q.value()/(double)p.value()}; }
+    }
+#endif
+    return {};
+  }
+
+  size_t available_cpus() {
+    static const size_t cpus = []() {
+      size_t n = std::thread::hardware_concurrency();
+#if defined(__linux__)
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      if (sched_getaffinity(0, sizeof(set), &set)==0) { n = (size_t)CPU_COUNT(&set); }
+#endif
+      if (auto quota = cgroup_cpu_quota()) { n = std::min(n, (size_t)std::ceil(quota.value())); }
+      return std::max<size_t>(n, 1);
+    }();
+    return cpus;
+  }
+
+  std::optional<size_t> cgroup_memory_limit() {
+#if defined(__linux__)
+    for (std::string const& dir : cgroup_v2_dirs()) {
+      const std::string line = read_line(dir + "/memory.max");
+      if (line.empty()) { continue; }
+      if (line.starts_with("max")) { return {}; }
+      if (auto v = parse_size(line)) { return v; }
+    }
+    if (auto v = parse_size(read_line(cgroup_root + "/memory/memory.limit_in_bytes"))) {
+      if (v.value()<v1_unlimited) { return v; }
+    }
+#endif
+    return {};
+  }
+
+  size_t physical_memory() {
+#if defined(__linux__)
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (pages>0&&page_size>0) { return (size_t)pages*(size_t)page_size; }
+#elif defined(__APPLE__)
+    uint64_t bytes = 0;
+    size_t len = sizeof(bytes);
+    if (sysctlbyname("hw.memsize", &bytes, &len, nullptr, 0)==0) { return (size_t)bytes; }
+#endif
+    return 0;
+  }
+
+  std::optional<size_t> memory_limit() {
+    std::optional<size_t> limit = cgroup_memory_limit();
+    const size_t physical = physical_memory();
+    if (physical>0) { limit = std::min(limit.value_or(physical), physical); }
+    return limit;
+  }
+
+  MemoryBudget MemoryBudget::unlimited() {
+    constexpr size_t max = std::numeric_limits<size_t>::max();
+    return {max, max, max};
+  }
+
+  MemoryBudget MemoryBudget::of(size_t limit_bytes) {
+    const size_t usable = limit_bytes/4*3;
+    return {usable/100*60, usable/100*25, usable/100*15};
+  }
+
+  MemoryBudget budget() {
+    std::lock_guard lock(budget_mutex);
+    if (!current_budget) {
+      auto limit = memory_limit();
+      current_budget = limit ? MemoryBudget::of(limit.value()) : MemoryBudget::unlimited();
+    }
+    return current_budget.value();
+  }
+
+  void set_budget(MemoryBudget b) {
+    std::lock_guard lock(budget_mutex);
+    current_budget = b;
+  }
+
+  size_t slab_bytes() { return slab_total.load(std::memory_order_relaxed); }
+
+  SlabCharge::SlabCharge(size_t bytes) : bytes(bytes) {
+    const size_t max = budget().dataset_slabs;
+    const size_t before = slab_total.fetch_add(bytes, std::memory_order_relaxed);
+    if (before + bytes>max||before + bytes<before) {
+      slab_total.fetch_sub(bytes, std::memory_order_relaxed);
+      throw std::runtime_error("Memory budget of the dataset slabs exceeded: " + std::to_string(bytes) +
+                               " bytes requested, " + std::to_string(before) + " held, budget of " +
+                               std::to_string(max) + " bytes");
+    }
+  }
+
+  SlabCharge::~SlabCharge() { slab_total.fetch_sub(bytes, std::memory_order_relaxed); }
+
+} // End of namespace tempo::utils::resources
@@ -0,0 +1,94 @@
+#include "utils/usage.hpp"
+
+#include <algorithm>
+#include <ctime>
+
+namespace tempo::utils::usage {
+
+  namespace {
+
+    int64_t clock_ns(clockid_t clock) {
+      timespec ts{};
+      if (clock_gettime(clock, &ts)!=0) { return 0; }
+      return (int64_t)ts.tv_sec*1'000'000'000 + (int64_t)ts.tv_nsec;
+    }
+
+    nlohmann::json thread_json(ThreadUsage const& t) {
+      nlohmann::json j;
+      j["nb_tasks"] = t.nb_tasks;
+      j["busy_ns"] = t.busy_ns;
+      j["cpu_ns"] = t.cpu_ns;
+      j["idle_ns"] = t.idle_ns;
+      return j;
+    }
+
+  } // End of anonymous namespace
+
+  int64_t process_cpu_ns() { return clock_ns(CLOCK_PROCESS_CPUTIME_ID); }
+
+  int64_t thread_cpu_ns() { return clock_ns(CLOCK_THREAD_CPUTIME_ID); }
+
+  double PhaseUsage::parallel_efficiency() const {
+    if (wall_ns<=0) { return 0; }
+    return (double)process_cpu_ns/((double)wall_ns*(double)std::max<size_t>(nb_threads, 1));
+  }
+
+  nlohmann::json PhaseUsage::to_json() const {
+    nlohmann::json j;
+    j["wall_ns"] = wall_ns;
+    j["process_cpu_ns"] = process_cpu_ns;
+    j["nb_threads"] = nb_threads;
+    j["parallel_efficiency"] = parallel_efficiency();
+    size_t nb_tasks = helpers.nb_tasks;
+    int64_t busy_ns = helpers.busy_ns;
+    nlohmann::json jw = nlohmann::json::array();
+    for (const auto& [index, t] : workers) {
+      nlohmann::json jt = thread_json(t);
+      jt["worker"] = index;
+      jw.push_back(std::move(jt));
+      nb_tasks += t.nb_tasks;
+      busy_ns += t.busy_ns;
+    }
+    j["nb_tasks"] = nb_tasks;
+    j["busy_ns"] = busy_ns;
+    // Thread time of the phase not spent in a task
+    j["idle_ns"] = std::max<int64_t>(0, wall_ns*(int64_t)nb_threads - busy_ns);
+    j["workers"] = std::move(jw);
+    j["helpers"] = thread_json(helpers);
+    return j;
+  }
+
+  Phase::Phase(size_t nb_threads, ThreadPool const& pool) :
+    pool(pool),
+    nb_threads(std::max<size_t>(nb_threads, 1)),
+    wall_start(std::chrono::steady_clock::now()),
+    cpu_start(process_cpu_ns()),
+    activity_start(pool.activity()) {}
+
+  PhaseUsage Phase::stop() const {
+    const std::vector<ThreadPool::Activity> activity = pool.activity();
+    PhaseUsage u;
+    u.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - wall_start
+    ).count();
+    u.process_cpu_ns = process_cpu_ns() - cpu_start;
+    u.nb_threads = nb_threads;
+    const auto diff = [&](size_t i) {
+      ThreadUsage t;
+      t.nb_tasks = activity[i].nb_tasks - activity_start[i].nb_tasks;
+      t.busy_ns = activity[i].busy_ns - activity_start[i].busy_ns;
+      t.cpu_ns = activity[i].cpu_ns - activity_start[i].cpu_ns;
+      t.idle_ns = std::max<int64_t>(0, u.wall_ns - t.busy_ns);
+      return t;
+    };
+    // The last entry is the one of the helpers
+    for (size_t i = 0; i + 1<activity.size(); ++i) {
+      ThreadUsage t = diff(i);
+      if (t.nb_tasks>0) { u.workers.emplace_back(i, t); }
+    }
+    u.helpers = diff(activity.size() - 1);
+    u.helpers.idle_ns = 0;
+    return u;
+  }
+
+} // End of namespace tempo::utils::usage
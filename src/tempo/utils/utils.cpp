@@ -1,5 +1,15 @@
 #include "utils.hpp"
+#include "utils/resources.hpp"
+#include "utils/spinpool.hpp"
+#include "utils/usage.hpp"
 
+#include <ctime>
+#include <fstream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 
 // --- --- --- --- --- ---
@@ -71,6 +81,370 @@ namespace tempo::utils {
 }
 
 
+// --- --- --- --- --- ---
+// --- Thread pool
+// --- --- --- --- --- ---
+namespace tempo::utils {
+
+  thread_local ThreadPool *ThreadPool::tl_pool = nullptr;
+  thread_local size_t ThreadPool::tl_index = 0;
+  thread_local size_t ThreadPool::tl_depth = 0;
+
+  ThreadPool::ThreadPool(size_t nb_workers) {
+    nb_workers = std::max<size_t>(1, nb_workers);
+    queues.reserve(nb_workers);
+    for (size_t i = 0; i<nb_workers; ++i) { queues.push_back(std::make_unique<WorkerQueue>()); }
+    threads.reserve(nb_workers);
+    for (size_t i = 0; i<nb_workers; ++i) { threads.emplace_back([this, i]() { worker_loop(i); }); }
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard lock(sleep_mtx);
+      stopping = true;
+    }
+    sleep_cv.notify_all();
+    for (auto& thread : threads) { thread.join(); }
+  }
+
+  ThreadPool& ThreadPool::global() {
+    static ThreadPool pool(resources::available_cpus());
+    return pool;
+  }
+
+  namespace {
+
+    /// Pin the thread i of 'threads' to the (first_cpu + i)-th CPU the process may run on, in turn
+    bool pin_threads(std::vector<std::thread>& threads, size_t first_cpu) {
+#if defined(__linux__)
+      cpu_set_t available;
+      CPU_ZERO(&available);
+      if (sched_getaffinity(0, sizeof(available), &available)!=0) { return false; }
+      std::vector<int> cpus;
+      for (int c = 0; c<CPU_SETSIZE; ++c) { if (CPU_ISSET(c, &available)) { cpus.push_back(c); }}
+      if (cpus.empty()) { return false; }
+      bool ok = true;
+      for (size_t i = 0; i<threads.size(); ++i) {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpus[(first_cpu + i)%cpus.size()], &one);
+        ok = pthread_setaffinity_np(threads[i].native_handle(), sizeof(one), &one)==0&&ok;
+      }
+      return ok;
+#else
+      (void)threads;
+      (void)first_cpu;
+      return false;
+#endif
+    }
+
+    /// Hint the CPU that the thread is spinning
+    inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__)
+      asm volatile("yield");
+#endif
+    }
+
+  } // End of anonymous namespace
+
+  bool ThreadPool::pin_workers() { return pin_threads(threads, 0); }
+
+  void ThreadPool::submit(task_t task) {
+    WorkerQueue& q = (tl_pool==this) ? *queues[tl_index] : injection;
+    {
+      std::lock_guard lock(q.mtx);
+      q.tasks.push_back(std::move(task));
+    }
+    nb_pending.fetch_add(1);
+    // Lock/unlock so a thread between its predicate check and its wait cannot miss the notification
+    { std::lock_guard lock(sleep_mtx); }
+    sleep_cv.notify_one();
+  }
+
+  bool ThreadPool::try_pop(task_t& task) {
+    const bool is_worker = (tl_pool==this);
+    // Own queue, LIFO: most recent tasks are the most likely to be hot in cache
+    if (is_worker) {
+      WorkerQueue& q = *queues[tl_index];
+      std::lock_guard lock(q.mtx);
+      if (!q.tasks.empty()) {
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+      }
+    }
+    // Injection queue, FIFO
+    {
+      std::lock_guard lock(injection.mtx);
+      if (!injection.tasks.empty()) {
+        task = std::move(injection.tasks.front());
+        injection.tasks.pop_front();
+        return true;
+      }
+    }
+    // Steal from the other workers, FIFO: oldest tasks are usually the biggest ones
+    const size_t nbq = queues.size();
+    const size_t start = is_worker ? tl_index + 1 : 0;
+    for (size_t k = 0; k<nbq; ++k) {
+      WorkerQueue& q = *queues[(start + k)%nbq];
+      std::lock_guard lock(q.mtx);
+      if (!q.tasks.empty()) {
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ThreadPool::run_one() {
+    task_t task;
+    if (!try_pop(task)) { return false; }
+    nb_pending.fetch_sub(1);
+    // Account the outermost task only: the nested ones run within its time
+    const bool is_worker = (tl_pool==this);
+    WorkerQueue& q = is_worker ? *queues[tl_index] : injection;
+    const bool outermost = tl_depth==0;
+    const auto start = std::chrono::steady_clock::now();
+    const int64_t cpu_start = (outermost&&!is_worker) ? usage::thread_cpu_ns() : 0;
+    ++tl_depth;
+    try { task(); }
+    catch (...) {
+      --tl_depth;
+      throw;
+    }
+    --tl_depth;
+    q.nb_tasks.fetch_add(1, std::memory_order_relaxed);
+    if (outermost) {
+      const auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+      q.busy_ns.fetch_add(busy.count(), std::memory_order_relaxed);
+      if (!is_worker) { q.helpers_cpu_ns.fetch_add(usage::thread_cpu_ns() - cpu_start, std::memory_order_relaxed); }
+    }
+    return true;
+  }
+
+  std::vector<ThreadPool::Activity> ThreadPool::activity() const {
+    std::vector<Activity> result;
+    result.reserve(queues.size() + 1);
+    for (size_t i = 0; i<queues.size(); ++i) {
+      Activity a;
+      a.nb_tasks = queues[i]->nb_tasks.load(std::memory_order_relaxed);
+      a.busy_ns = queues[i]->busy_ns.load(std::memory_order_relaxed);
+#if defined(__linux__)
+      clockid_t cid;
+      timespec ts{};
+      if (pthread_getcpuclockid(const_cast<std::thread&>(threads[i]).native_handle(), &cid)==0
+          &&clock_gettime(cid, &ts)==0) {
+        a.cpu_ns = (int64_t)ts.tv_sec*1'000'000'000 + (int64_t)ts.tv_nsec;
+      }
+#endif
+      result.push_back(a);
+    }
+    Activity helpers;
+    helpers.nb_tasks = injection.nb_tasks.load(std::memory_order_relaxed);
+    helpers.busy_ns = injection.busy_ns.load(std::memory_order_relaxed);
+    helpers.cpu_ns = injection.helpers_cpu_ns.load(std::memory_order_relaxed);
+    result.push_back(helpers);
+    return result;
+  }
+
+  void ThreadPool::wait_for_work(std::function<bool()> const& done) {
+    std::unique_lock lock(sleep_mtx);
+    sleep_cv.wait(lock, [&]() { return nb_pending.load()>0||stopping||done(); });
+  }
+
+  void ThreadPool::notify_all() {
+    { std::lock_guard lock(sleep_mtx); }
+    sleep_cv.notify_all();
+  }
+
+  void ThreadPool::worker_loop(size_t index) {
+    tl_pool = this;
+    tl_index = index;
+    for (;;) {
+      if (run_one()) { continue; }
+      std::unique_lock lock(sleep_mtx);
+      sleep_cv.wait(lock, [this]() { return nb_pending.load()>0||stopping; });
+      if (stopping&&nb_pending.load()==0) { return; }
+    }
+  }
+
+  // --- --- --- Task group
+
+  void TaskGroup::run(ThreadPool::task_t task) {
+    nb_remaining.fetch_add(1);
+    pool.submit([this, task = std::move(task)]() {
+      try { task(); }
+      catch (...) {
+        std::lock_guard lock(error_mtx);
+        if (!error) { error = std::current_exception(); }
+      }
+      // Do not access 'this' after the decrement: the group may be destroyed as soon as it reaches 0
+      ThreadPool& p = pool;
+      if (nb_remaining.fetch_sub(1)==1) { p.notify_all(); }
+    });
+  }
+
+  void TaskGroup::wait_noexcept() {
+    while (nb_remaining.load()>0) {
+      if (!pool.run_one()) { pool.wait_for_work([this]() { return nb_remaining.load()==0; }); }
+    }
+  }
+
+  void TaskGroup::wait() {
+    wait_noexcept();
+    std::lock_guard lock(error_mtx);
+    if (error) {
+      std::exception_ptr e = error;
+      error = nullptr;
+      std::rethrow_exception(e);
+    }
+  }
+
+  // --- --- --- Spinning pool
+
+  SpinPool::SpinPool(size_t nb_workers, std::chrono::nanoseconds spin) : spin(spin) {
+    const size_t n = std::max<size_t>(nb_workers, 1);
+    threads.reserve(n - 1);
+    for (size_t i = 1; i<n; ++i) { threads.emplace_back([this, i]() { worker_loop(i); }); }
+  }
+
+  SpinPool::~SpinPool() {
+    stopping.store(true, std::memory_order_release);
+    epoch.fetch_add(1, std::memory_order_release);
+    epoch.notify_all();
+    for (auto& thread : threads) { thread.join(); }
+  }
+
+  bool SpinPool::pin_workers() { return pin_threads(threads, 1); }
+
+  void SpinPool::run_job(size_t index) {
+    try { (*job)(index); }
+    catch (...) {
+      std::lock_guard lock(error_mtx);
+      if (!error) { error = std::current_exception(); }
+    }
+  }
+
+  void SpinPool::run(job_t const& j) {
+    std::lock_guard lock(run_mtx);
+    job = &j;
+    nb_running.store(threads.size(), std::memory_order_relaxed);
+    // Released with the epoch: a worker seeing the new epoch sees the job. Waking the blocked workers only costs a
+    // system call if some are blocked.
+    epoch.fetch_add(1, std::memory_order_release);
+    epoch.notify_all();
+    run_job(0);
+    // Wait for the other workers: spin, then yield (e.g. more workers than CPUs, a worker being preempted)
+    const auto deadline = std::chrono::steady_clock::now() + spin;
+    bool spinning = true;
+    for (size_t k = 1; nb_running.load(std::memory_order_acquire)>0; ++k) {
+      if (spinning) {
+        cpu_relax();
+        spinning = k%256!=0||std::chrono::steady_clock::now()<=deadline;
+      } else { std::this_thread::yield(); }
+    }
+    job = nullptr;
+    std::lock_guard elock(error_mtx);
+    if (error) {
+      std::exception_ptr e = error;
+      error = nullptr;
+      std::rethrow_exception(e);
+    }
+  }
+
+  void SpinPool::worker_loop(size_t index) {
+    uint64_t seen = 0;
+    for (;;) {
+      // Spin on the epoch, checking the clock every few rounds, then block until it changes
+      const auto deadline = std::chrono::steady_clock::now() + spin;
+      uint64_t e = epoch.load(std::memory_order_acquire);
+      for (size_t k = 1; e==seen; ++k) {
+        cpu_relax();
+        if (k%256==0&&std::chrono::steady_clock::now()>deadline) { epoch.wait(seen, std::memory_order_acquire); }
+        e = epoch.load(std::memory_order_acquire);
+      }
+      seen = e;
+      if (stopping.load(std::memory_order_acquire)) { return; }
+      run_job(index);
+      nb_running.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+}
+
+
+// --- --- --- --- --- ---
+// --- Tracer
+// --- --- --- --- --- ---
+namespace tempo::utils {
+
+  Tracer& Tracer::global() {
+    static Tracer tracer;
+    return tracer;
+  }
+
+  void Tracer::enable() {
+    std::lock_guard lock(mtx);
+    buffers.clear();
+    generation.fetch_add(1, std::memory_order_relaxed);
+    origin = std::chrono::steady_clock::now();
+    enabled_flag.store(true, std::memory_order_relaxed);
+  }
+
+  Tracer::Buffer& Tracer::thread_buffer() {
+    thread_local std::shared_ptr<Buffer> buffer;
+    thread_local uint64_t buffer_generation = 0;
+    static std::atomic<uint64_t> next_tid{1};
+    thread_local const uint64_t tid = next_tid.fetch_add(1, std::memory_order_relaxed);
+    if (!buffer||buffer_generation!=generation.load(std::memory_order_relaxed)) {
+      std::lock_guard lock(mtx);
+      buffer = std::make_shared<Buffer>(Buffer{tid, {}});
+      buffer_generation = generation.load(std::memory_order_relaxed);
+      buffers.push_back(buffer);
+    }
+    return *buffer;
+  }
+
+  void Tracer::record(char const *name, char const *category, char const *arg_name, int64_t arg,
+                      std::chrono::steady_clock::time_point start) {
+    using namespace std::chrono;
+    const auto end = steady_clock::now();
+    thread_buffer().events.push_back(Event{
+      name, category, arg_name, arg,
+      duration_cast<microseconds>(start - origin).count(),
+      duration_cast<microseconds>(end - start).count()
+    });
+  }
+
+  void Tracer::write(std::ostream& out) const {
+    std::lock_guard lock(mtx);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (auto const& buffer : buffers) {
+      for (Event const& e : buffer->events) {
+        if (!first) { out << ",\n"; }
+        first = false;
+        out << R"({"name":")" << e.name << R"(","cat":")" << e.category << R"(","ph":"X","pid":1,"tid":)"
+            << buffer->tid << R"(,"ts":)" << e.start_us << R"(,"dur":)" << e.duration_us;
+        if (e.arg_name!=nullptr) { out << R"(,"args":{")" << e.arg_name << "\":" << e.arg << "}"; }
+        out << "}";
+      }
+    }
+    out << "]}\n";
+  }
+
+  void Tracer::write(std::filesystem::path const& path) const {
+    std::ofstream out(path);
+    write(out);
+    if (!out) { throw std::runtime_error("Could not write the trace " + path.string()); }
+  }
+
+}
+
+
 // --- --- --- --- --- ---
 // --- ParTasks
 // --- --- --- --- --- ---
@@ -79,37 +453,47 @@ namespace tempo::utils {
   /// Non thread safe! Add all the task before calling "execute"
   void ParTasks::push_task(task_t func) { tasklist.push(std::move(func)); }
 
-  /// Blocking call
-  void ParTasks::execute(int nbthreads) {
-    if (nbthreads<=1) {
-      while (!tasklist.empty()) {
-        auto task = std::move(tasklist.front());
-        tasklist.pop();
-        task();
-      }
-    } else {
-      threads.reserve(nbthreads);
-      for (int i = 0; i<nbthreads; ++i) { threads.emplace_back([this]() { run_thread(); }); }
-      // Wait for all threads to stop
-      for (auto& thread : threads) { thread.join(); }
-      threads.clear();
+  std::vector<ParTasks::task_t> ParTasks::take_tasks() {
+    std::vector<task_t> tasks;
+    tasks.reserve(tasklist.size());
+    while (!tasklist.empty()) {
+      tasks.push_back(std::move(tasklist.front()));
+      tasklist.pop();
     }
+    return tasks;
+  }
+
+  void ParTasks::run_concurrently(size_t nb_runners, std::function<void()> const& runner) {
+    TaskGroup group;
+    for (size_t i = 0; i<nb_runners; ++i) { group.run(runner); }
+    group.wait();
   }
 
+  /// Blocking call
+  void ParTasks::execute(int nbthreads) { execute(nbthreads, 1); }
+
   /// Blocking call
   void ParTasks::execute(int nbthreads, int nbtask) {
+    std::vector<task_t> tasks = take_tasks();
     if (nbthreads<=1) {
-      while (!tasklist.empty()) {
-        auto task = std::move(tasklist.front());
-        tasklist.pop();
+      for (auto& task : tasks) {
+        const TraceScope trace("task", "partasks");
         task();
       }
     } else {
-      threads.reserve(nbthreads);
-      for (int i = 0; i<nbthreads; ++i) { threads.emplace_back([this, nbtask]() { run_thread(nbtask); }); }
-      // Wait for all threads to stop
-      for (auto& thread : threads) { thread.join(); }
-      threads.clear();
+      // Runners take 'nbtask' tasks at a time
+      const size_t chunk = std::max(nbtask, 1);
+      const size_t nb_chunks = (tasks.size() + chunk - 1)/chunk;
+      std::atomic<size_t> next{0};
+      run_concurrently(std::min<size_t>(nbthreads, nb_chunks), [&]() {
+        for (size_t c = next.fetch_add(1); c<nb_chunks; c = next.fetch_add(1)) {
+          const size_t stop = std::min(tasks.size(), (c + 1)*chunk);
+          for (size_t i = c*chunk; i<stop; ++i) {
+            const TraceScope trace("task", "partasks");
+            tasks[i]();
+          }
+        }
+      });
     }
   }
 
@@ -120,19 +504,28 @@ namespace tempo::utils {
       auto ntask = tgenerator();
       while (ntask.has_value()) {
         auto task = ntask.value();
-        task();
+        {
+          const TraceScope trace("task", "partasks");
+          task();
+        }
         ntask = tgenerator();
       }
     }
       // --- --- --- Multi thread
     else {
-      threads.reserve(nbthread);
-      for (int i = 0; i<nbthread; ++i) {
-        threads.emplace_back([this, &tgenerator]() { run_thread_generator(tgenerator); });
-      }
-      // Wait for all threads to stop
-      for (auto& thread : threads) { thread.join(); }
-      threads.clear();
+      // The generator is not thread safe: call it under lock
+      run_concurrently(nbthread, [&]() {
+        for (;;) {
+          std::optional<task_t> ntask;
+          {
+            std::lock_guard lock(mtx);
+            ntask = tgenerator();
+          }
+          if (!ntask.has_value()) { return; }
+          const TraceScope trace("task", "partasks");
+          ntask.value()();
+        }
+      });
     }
   }
 
@@ -141,87 +534,22 @@ namespace tempo::utils {
     // --- --- --- 1 thread
     if (nbthread<=1) {
       for (size_t i = start; i<stop; i += step) {
+        const TraceScope trace("task", "partasks", "i", (int64_t)i);
         itask(i);
       }
     }
       // --- --- --- Multi thread
     else {
-      threads.reserve(nbthread);
-      itask_idx = start;
-      for (int i = 0; i<nbthread; ++i) {
-        threads.emplace_back([this, &itask, stop, step]() { run_thread_itask(itask, stop, step); });
-      }
-      // Wait for all threads to stop
-      for (auto& thread : threads) { thread.join(); }
-      threads.clear();
-    }
-  }
-
-
-
-
-  // --- --- ---  Private
-
-  void ParTasks::run_thread() {
-    mtx.lock();
-    while (!tasklist.empty()) {
-      auto task = std::move(tasklist.front());
-      tasklist.pop();
-      mtx.unlock();
-      task();
-      mtx.lock();
-    }
-    mtx.unlock();
-  }
-
-  void ParTasks::run_thread(size_t nbtask) {
-    if (nbtask<=1) { run_thread(); }
-    else {
-      std::vector<task_t> tasks;
-      tasks.reserve(nbtask);
-      mtx.lock();
-      while (!tasklist.empty()) {
-        while (!tasklist.empty()&&tasks.size()<nbtask) {
-          tasks.emplace_back(std::move(tasklist.front()));
-          tasklist.pop();
+      // Lock free distribution of the indexes
+      const size_t nb_items = (stop>start) ? (stop - start + step - 1)/step : 0;
+      std::atomic<size_t> next{0};
+      run_concurrently(std::min<size_t>(nbthread, nb_items), [&]() {
+        for (size_t k = next.fetch_add(1); k<nb_items; k = next.fetch_add(1)) {
+          const TraceScope trace("task", "partasks", "i", (int64_t)(start + k*step));
+          itask(start + k*step);
         }
-        mtx.unlock();
-        for (auto& t : tasks) { t(); }
-        tasks.clear();
-        mtx.lock();
-      }
-      mtx.unlock();
-    }
-  }
-
-  void ParTasks::run_thread_generator(taskgen_t& tgenerator) {
-    mtx.lock();
-    auto ntask = tgenerator();
-    mtx.unlock();
-    while (ntask.has_value()) {
-      auto task = ntask.value();
-      task();
-      {
-        std::lock_guard lg(mtx);
-        ntask = tgenerator();
-      }
-    }
-  }
-
-  void ParTasks::run_thread_itask(itask_t& itask, size_t stop, size_t step) {
-    // Lock block to compare/get/increment shared itask_idx
-    mtx.lock();
-    while (itask_idx<stop) {
-      size_t myidx = itask_idx;
-      itask_idx += step;
-      mtx.unlock();
-      // Execute the task
-      itask(myidx);
-      // Lock block re-start
-      mtx.lock();
+      });
     }
-    // Lock block re-end
-    mtx.unlock();
   }
 
 }
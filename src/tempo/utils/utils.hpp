@@ -5,6 +5,9 @@
 #include "concepts.hpp"
 #include "utils/uncopyable.hpp"
 #include "utils/stats.hpp"
+#include "utils/threadpool.hpp"
+#include "utils/trace.hpp"
+#include "utils/memory.hpp"
 
 namespace tempo::utils {
 
@@ -198,7 +201,8 @@ namespace tempo::utils {
   /// Tasks must be prepared (with push_task) before being executed.
   /// The 'execute' method waits for all task to be completed.
   /// If the number of thread required is <= 1, the current thread is used.
-  /// Else, the requested number of threads are spawned, and the current thread waits for their completion.
+  /// Else, the tasks are executed by at most the requested number of threads from the shared ThreadPool::global(),
+  /// the current thread helping while it waits. ParTasks can be used from within a task (nested parallelism).
   class ParTasks {
 
   public:
@@ -208,9 +212,7 @@ namespace tempo::utils {
 
   private:
     std::mutex mtx;
-    std::vector<std::thread> threads;
     std::queue<task_t> tasklist;
-    size_t itask_idx;
 
   public:
 
@@ -239,13 +241,11 @@ namespace tempo::utils {
 
   private:
 
-    void run_thread();
+    /// Run 'runner' 'nb_runners' times concurrently in the shared pool, and wait for completion
+    static void run_concurrently(size_t nb_runners, std::function<void()> const& runner);
 
-    void run_thread(size_t nbtask);
-
-    void run_thread_generator(taskgen_t& tgenerator);
-
-    void run_thread_itask(itask_t& itask, size_t stop, size_t step);
+    /// Move the tasks out of the task list
+    std::vector<task_t> take_tasks();
 
   };
 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "memory.hpp"
+
+#include <cstddef>
+#include <new>
+
+namespace tempo::utils {
+
+  /** Allocator returning memory aligned on 'Align' bytes, e.g. for std::vector<T, AlignedAllocator<T, 64>>
+   *  whose data starts on a cache line.
+   */
+  template<typename T, size_t Align>
+  struct AlignedAllocator {
+    static_assert(Align>=alignof(T)&&(Align&(Align - 1))==0, "Alignment must be a power of 2, at least alignof(T)");
+
+    using value_type = T;
+
+    template<typename U>
+    struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() noexcept = default;
+
+    template<typename U>
+    explicit AlignedAllocator(AlignedAllocator<U, Align> const&) noexcept {}
+
+    T *allocate(size_t n) { return static_cast<T *>(::operator new(n*sizeof(T), std::align_val_t(Align))); }
+
+    void deallocate(T *p, size_t) noexcept { ::operator delete(p, std::align_val_t(Align)); }
+
+    template<typename U>
+    bool operator ==(AlignedAllocator<U, Align> const&) const noexcept { return true; }
+  };
+
+  /** As AlignedAllocator, the buffers of at least memory::huge_page_size bytes being allocated on huge pages
+   *  according to memory::huge_pages (see memory::allocate_large), e.g. for the slabs of the series.
+   */
+  template<typename T, size_t Align>
+  struct HugePageAllocator {
+    static_assert(Align>=alignof(T)&&(Align&(Align - 1))==0, "Alignment must be a power of 2, at least alignof(T)");
+
+    using value_type = T;
+
+    template<typename U>
+    struct rebind { using other = HugePageAllocator<U, Align>; };
+
+    HugePageAllocator() noexcept = default;
+
+    template<typename U>
+    explicit HugePageAllocator(HugePageAllocator<U, Align> const&) noexcept {}
+
+    T *allocate(size_t n) { return static_cast<T *>(memory::allocate_large(n*sizeof(T), Align)); }
+
+    void deallocate(T *p, size_t n) noexcept { memory::deallocate_large(p, n*sizeof(T), Align); }
+
+    template<typename U>
+    bool operator ==(HugePageAllocator<U, Align> const&) const noexcept { return true; }
+  };
+
+} // End of namespace tempo::utils
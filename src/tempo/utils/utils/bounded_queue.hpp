@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+#include "uncopyable.hpp"
+
+namespace tempo::utils {
+
+  /** FIFO queue of bounded capacity, connecting the stages of a pipeline running in different threads.
+   *  'push' blocks while the queue is full, and 'pop' while it is empty: a fast stage waits for the slow one instead
+   *  of accumulating items, bounding the memory used by the pipeline.
+   *  Once closed, 'push' fails, and 'pop' returns the remaining items, then nothing.
+   */
+  template<typename T>
+  class BoundedQueue : private Uncopyable {
+
+    mutable std::mutex mtx;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed{false};
+
+  public:
+
+    /// Queue of at most 'capacity' items (at least 1)
+    explicit BoundedQueue(size_t capacity) : capacity(capacity==0 ? 1 : capacity) {}
+
+    /// Push an item, waiting for room. Return false (the item being dropped) if the queue is closed.
+    bool push(T item) {
+      std::unique_lock lock(mtx);
+      not_full.wait(lock, [this]() { return closed||items.size()<capacity; });
+      if (closed) { return false; }
+      items.push_back(std::move(item));
+      lock.unlock();
+      not_empty.notify_one();
+      return true;
+    }
+
+    /// Pop an item, waiting for one. Return nothing if the queue is closed and empty.
+    std::optional<T> pop() {
+      std::unique_lock lock(mtx);
+      not_empty.wait(lock, [this]() { return closed||!items.empty(); });
+      if (items.empty()) { return {}; }
+      std::optional<T> item(std::move(items.front()));
+      items.pop_front();
+      lock.unlock();
+      not_full.notify_one();
+      return item;
+    }
+
+    /// Pop an item, waiting for one until 'deadline'. Return nothing if the deadline passed or if the queue is closed
+    /// and empty, e.g. to gather the items arriving within a time window.
+    std::optional<T> pop_until(std::chrono::steady_clock::time_point deadline) {
+      std::unique_lock lock(mtx);
+      not_empty.wait_until(lock, deadline, [this]() { return closed||!items.empty(); });
+      if (items.empty()) { return {}; }
+      std::optional<T> item(std::move(items.front()));
+      items.pop_front();
+      lock.unlock();
+      not_full.notify_one();
+      return item;
+    }
+
+    /// Number of items waiting, e.g. to report the depth of a stage
+    size_t size() const {
+      std::lock_guard lock(mtx);
+      return items.size();
+    }
+
+    /// Close the queue, waking up the waiting threads. Does nothing if already closed.
+    void close() {
+      {
+        std::lock_guard lock(mtx);
+        closed = true;
+      }
+      not_full.notify_all();
+      not_empty.notify_all();
+    }
+  };
+
+} // End of namespace tempo::utils
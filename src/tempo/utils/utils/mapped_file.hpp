@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TEMPO_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+#include "uncopyable.hpp"
+
+namespace tempo::utils {
+
+  /// Expected access to a range of mapped memory (see advise)
+  enum class Advice { NORMAL, SEQUENTIAL, RANDOM, WILLNEED, DONTNEED };
+
+  /** Tell the kernel how the memory in [begin, begin+size[ will be accessed, e.g. to page in a part of a mapped file
+   *  before reading it (WILLNEED), or to read ahead while scanning it (SEQUENTIAL).
+   *  Only a hint: does nothing without mmap support, and failures are ignored.
+   *  The range is extended to page boundaries.
+   */
+  inline void advise(void const *begin, size_t size, Advice advice) {
+    #if defined(TEMPO_HAS_MMAP)
+    if (size==0) { return; }
+    static const auto page = (uintptr_t)::sysconf(_SC_PAGESIZE);
+    const uintptr_t start = (uintptr_t)begin/page*page;
+    const uintptr_t stop = (uintptr_t)begin + size;
+    int flag = MADV_NORMAL;
+    switch (advice) {
+    case Advice::NORMAL: flag = MADV_NORMAL; break;
+    case Advice::SEQUENTIAL: flag = MADV_SEQUENTIAL; break;
+    case Advice::RANDOM: flag = MADV_RANDOM; break;
+    case Advice::WILLNEED: flag = MADV_WILLNEED; break;
+    case Advice::DONTNEED: flag = MADV_DONTNEED; break;
+    }
+    ::madvise((void *)start, stop - start, flag);
+    #else
+    (void)begin;
+    (void)size;
+    (void)advice;
+    #endif
+  }
+
+  /** Read only, shared memory mapping of a whole file.
+   *  Pages are shared between all the processes mapping the same file, and are only loaded when accessed.
+   *  The mapping start is page aligned. Throw std::runtime_error if the file cannot be mapped.
+   *  Without mmap support (non POSIX platform), the file is read in memory instead.
+   */
+  class MappedFile : private Uncopyable {
+
+    char const *_data{nullptr};
+    size_t _size{0};
+    #if !defined(TEMPO_HAS_MMAP)
+    std::string _buffer;
+    #endif
+
+  public:
+
+    explicit MappedFile(std::filesystem::path const& path) {
+      const std::string p = path.string();
+      #if defined(TEMPO_HAS_MMAP)
+      const int fd = ::open(p.c_str(), O_RDONLY);
+      if (fd<0) { throw std::runtime_error("Cannot open " + p); }
+      struct stat st{};
+      if (::fstat(fd, &st)!=0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat " + p);
+      }
+      _size = (size_t)st.st_size;
+      if (_size>0) {
+        void *addr = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr==MAP_FAILED) {
+          ::close(fd);
+          throw std::runtime_error("Cannot map " + p);
+        }
+        _data = static_cast<char const *>(addr);
+      }
+      // The mapping stays valid after closing the file descriptor
+      ::close(fd);
+      #else
+      std::ifstream in(path, std::ios::binary);
+      if (!in) { throw std::runtime_error("Cannot open " + p); }
+      _buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+      _data = _buffer.data();
+      _size = _buffer.size();
+      #endif
+    }
+
+    ~MappedFile() {
+      #if defined(TEMPO_HAS_MMAP)
+      if (_data!=nullptr) { ::munmap(const_cast<char *>(_data), _size); }
+      #endif
+    }
+
+    /// Start of the mapping
+    char const *data() const { return _data; }
+
+    /// Size of the mapping in bytes
+    size_t size() const { return _size; }
+
+    /// Advise the kernel about the access to the whole mapping (see utils::advise)
+    void advise(Advice advice) const { utils::advise(_data, _size, advice); }
+  };
+
+  /** Read write, shared memory mapping of a whole file, e.g. to write a result larger than the memory: the written
+   *  pages are flushed to the file by the kernel, and can be evicted. Throw std::runtime_error if the file cannot be
+   *  mapped. Without mmap support, the file is read in memory, and written back by sync and on destruction.
+   */
+  class WritableMappedFile : private Uncopyable {
+
+    std::filesystem::path _path;
+    char *_data{nullptr};
+    size_t _size{0};
+    #if !defined(TEMPO_HAS_MMAP)
+    std::string _buffer;
+    #endif
+
+    void map(bool create, size_t size) {
+      const std::string p = _path.string();
+      #if defined(TEMPO_HAS_MMAP)
+      const int fd = create ? ::open(p.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644) : ::open(p.c_str(), O_RDWR);
+      if (fd<0) { throw std::runtime_error("Cannot open " + p); }
+      if (create) {
+        if (::ftruncate(fd, (off_t)size)!=0) {
+          ::close(fd);
+          throw std::runtime_error("Cannot resize " + p);
+        }
+      } else {
+        struct stat st{};
+        if (::fstat(fd, &st)!=0) {
+          ::close(fd);
+          throw std::runtime_error("Cannot stat " + p);
+        }
+        size = (size_t)st.st_size;
+      }
+      _size = size;
+      if (_size>0) {
+        void *addr = ::mmap(nullptr, _size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr==MAP_FAILED) {
+          ::close(fd);
+          throw std::runtime_error("Cannot map " + p);
+        }
+        _data = static_cast<char *>(addr);
+      }
+      ::close(fd);
+      #else
+      if (create) { _buffer.assign(size, '\0'); }
+      else {
+        std::ifstream in(_path, std::ios::binary);
+        if (!in) { throw std::runtime_error("Cannot open " + p); }
+        _buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+      }
+      _data = _buffer.data();
+      _size = _buffer.size();
+      #endif
+    }
+
+  public:
+
+    /// Create (or truncate) the file 'path' with 'size' bytes set to 0, and map it
+    WritableMappedFile(std::filesystem::path const& path, size_t size) : _path(path) { map(true, size); }
+
+    /// Map the existing file 'path'
+    explicit WritableMappedFile(std::filesystem::path const& path) : _path(path) { map(false, 0); }
+
+    ~WritableMappedFile() {
+      #if defined(TEMPO_HAS_MMAP)
+      if (_data!=nullptr) { ::munmap(_data, _size); }
+      #else
+      try { sync(); } catch (...) {}
+      #endif
+    }
+
+    /// Start of the mapping
+    char *data() const { return _data; }
+
+    /// Size of the mapping in bytes
+    size_t size() const { return _size; }
+
+    /// Write the modified pages to the file, waiting for the writes
+    void sync() const {
+      #if defined(TEMPO_HAS_MMAP)
+      if (_data!=nullptr&&::msync(_data, _size, MS_SYNC)!=0) {
+        throw std::runtime_error("Cannot sync " + _path.string());
+      }
+      #else
+      std::ofstream out(_path, std::ios::binary|std::ios::trunc);
+      out.write(_buffer.data(), (std::streamsize)_buffer.size());
+      if (!out) { throw std::runtime_error("Cannot write " + _path.string()); }
+      #endif
+    }
+
+    /// Advise the kernel about the access to the whole mapping (see utils::advise)
+    void advise(Advice advice) const { utils::advise(_data, _size, advice); }
+  };
+
+} // End of namespace tempo::utils
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace tempo::utils::memory {
+
+  /// Peak resident set size of the process so far, in KiB (0 if unknown on this platform)
+  size_t peak_rss_kib();
+
+  /// Reset the peak resident set size to the current one (Linux only, see /proc/self/clear_refs), to measure the
+  /// peak of a phase with peak_rss_since_reset_kib. Return false if the kernel does not allow it.
+  bool reset_peak_rss();
+
+  /// Peak resident set size since the last reset_peak_rss (or since the start of the process), in KiB
+  /// (VmHWM, Linux only: 0 elsewhere)
+  size_t peak_rss_since_reset_kib();
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // NUMA placement (Linux only, through the kernel interface: no dependency on libnuma)
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Number of online NUMA nodes (1 if unknown on this platform)
+  size_t nb_numa_nodes();
+
+  /// Interleave the pages of [data, data+nb_bytes[ over the online NUMA nodes, moving the pages already in memory.
+  /// The range is extended to whole pages. By default, a page lives on the node of the thread touching it first:
+  /// data prepared by one thread is then read by all the threads from one node. Interleaving spreads the traffic.
+  /// Return false if nothing was done (one node, unsupported platform, or refused by the kernel).
+  bool interleave(void const *data, size_t nb_bytes);
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Huge pages (Linux only). The large buffers read at random, e.g. the slabs of the series (see SeriesSlab), are
+  // allocated by allocate_large: with huge pages, a TLB entry covers 2MB instead of 4KB, and the random accesses of
+  // the splitters to many series miss the TLB less often. Elsewhere, or for small buffers, plain aligned new.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// OFF: plain allocation. TRANSPARENT: 2MB aligned mapping advised for transparent huge pages (madvise).
+  /// EXPLICIT: mapping on the reserved huge pages (MAP_HUGETLB, see /proc/sys/vm/nr_hugepages), else as TRANSPARENT.
+  enum class HugePages { OFF, TRANSPARENT, EXPLICIT };
+
+  /// Name of a mode: "off", "thp" or "hugetlb"
+  char const *to_string(HugePages mode);
+
+  /// Mode of a name given by to_string
+  std::optional<HugePages> parse_huge_pages(std::string_view name);
+
+  /// Mode of the next allocations, OFF by default. Set it before reading the data.
+  void set_huge_pages(HugePages mode);
+
+  HugePages huge_pages();
+
+  /// Size of a huge page, and minimum size of the buffers allocated on huge pages
+  constexpr size_t huge_page_size = size_t(1) << 21;
+
+  /// Allocate 'nb_bytes' aligned on 'alignment' (a power of 2), on huge pages according to the mode.
+  /// Throw std::bad_alloc on failure.
+  void *allocate_large(size_t nb_bytes, size_t alignment);
+
+  /// Free a buffer given by allocate_large, with the same 'nb_bytes' and 'alignment'
+  void deallocate_large(void *p, size_t nb_bytes, size_t alignment) noexcept;
+
+  /** Count of the data TLB read misses of the threads of the process existing at construction, in user space
+   *  (Linux perf events). Threads started later are not counted: create the thread pool first. Not available
+   *  elsewhere, or when refused by the kernel (see /proc/sys/kernel/perf_event_paranoid).
+   */
+  class DTLBMisses {
+    std::vector<int> fds;
+
+  public:
+    DTLBMisses();
+
+    ~DTLBMisses();
+
+    DTLBMisses(DTLBMisses const&) = delete;
+
+    DTLBMisses& operator =(DTLBMisses const&) = delete;
+
+    /// Misses since construction (summed over the threads), if available
+    std::optional<uint64_t> read() const;
+  };
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Allocation counting, compiled only with TEMPO_COUNT_ALLOCATIONS (CMake option of the same name).
+  // The global operator new/delete are then replaced by counting ones (see memory.cpp), for all the threads.
+  // Without it, nothing is replaced, and 'allocations' always returns zeros.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+#ifdef TEMPO_COUNT_ALLOCATIONS
+  constexpr bool counting = true;
+#else
+  constexpr bool counting = false;
+#endif
+
+  /// Allocations made through the global operator new since the start of the process
+  struct Allocations {
+    uint64_t count{0};  ///< Number of allocations
+    uint64_t bytes{0};  ///< Bytes requested
+
+    Allocations operator-(Allocations const& other) const { return {count - other.count, bytes - other.bytes}; }
+  };
+
+  /// Allocations so far, by all the threads. Take the difference of two calls to count the allocations of a phase.
+  Allocations allocations();
+
+} // End of namespace tempo::utils::memory
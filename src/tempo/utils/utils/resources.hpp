@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+namespace tempo::utils::resources {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Resource governor. In a container, std::thread::hardware_concurrency and the physical memory are the ones of the
+  // host: the limits of the container are its cgroup CPU quota and memory limit (Linux, cgroup v2 or v1), and the
+  // CPUs the process may run on (sched_getaffinity). Elsewhere, the limits are the ones of the machine.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// CPU quota of the cgroup of the process, in CPUs (e.g. 2.5 for "250000 100000"), if any
+  std::optional<double> cgroup_cpu_quota();
+
+  /// Number of threads to use by default: the CPUs the process may run on, bounded by the rounded up CPU quota of its
+  /// cgroup. At least 1. Read once.
+  size_t available_cpus();
+
+  /// Memory limit of the cgroup of the process, in bytes, if any
+  std::optional<size_t> cgroup_memory_limit();
+
+  /// Physical memory of the machine, in bytes (0 if unknown on this platform)
+  size_t physical_memory();
+
+  /// Memory available to the process: the smallest of the cgroup limit and of the physical memory, if known
+  std::optional<size_t> memory_limit();
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Memory budget
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /** Bytes the process may use for its large consumers, shared by all their instances:
+   *  - the slabs holding the values of the series (see SeriesSlab): allocations beyond it throw;
+   *  - the envelope caches (see TSChief::EnvelopesCache), bounding their default capacity;
+   *  - the distance memos (see TSChief::DistanceMemo), bounding their number of entries.
+   */
+  struct MemoryBudget {
+    size_t dataset_slabs;
+    size_t envelope_caches;
+    size_t distance_caches;
+
+    /// No limit
+    static MemoryBudget unlimited();
+
+    /// Budget of a memory limit: a quarter is left to the rest of the process (trees, tables, buffers), the other
+    /// three quarters being shared by the dataset slabs (60%), the envelope caches (25%) and the distance memos (15%)
+    static MemoryBudget of(size_t limit_bytes);
+  };
+
+  /// Current budget: by default, the budget of memory_limit (unlimited if unknown)
+  MemoryBudget budget();
+
+  /// Replace the budget, e.g. with MemoryBudget::of a limit given on the command line. Set it before reading the data.
+  void set_budget(MemoryBudget b);
+
+  /// Bytes held by the dataset slabs
+  size_t slab_bytes();
+
+  /** Charge of a dataset slab on the budget, released on destruction.
+   *  Throws std::runtime_error if the slabs would exceed the budget, before the allocation is attempted.
+   */
+  class SlabCharge {
+    size_t bytes;
+
+  public:
+    explicit SlabCharge(size_t bytes);
+
+    ~SlabCharge();
+
+    SlabCharge(SlabCharge const&) = delete;
+
+    SlabCharge& operator =(SlabCharge const&) = delete;
+  };
+
+} // End of namespace tempo::utils::resources
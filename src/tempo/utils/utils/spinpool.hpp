@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "uncopyable.hpp"
+
+namespace tempo::utils {
+
+  /** Persistent pool of workers for latency bound work: one small job at a time, run by all the workers at once.
+   *  Where ThreadPool queues tasks and puts its idle workers to sleep, the workers of a SpinPool spin on a shared
+   *  epoch for a while after each job: dispatching a job to spinning workers costs a few cache line transfers
+   *  instead of a wake up per thread. Past the spin duration, the workers block (C++20 atomic wait), not burning
+   *  a core while nothing comes.
+   *  The calling thread is the worker 0: a pool of N workers starts N-1 threads.
+   */
+  class SpinPool : private Uncopyable {
+  public:
+    /// Job run by each worker, given its index in [0, size()[
+    using job_t = std::function<void(size_t worker)>;
+
+  private:
+    std::vector<std::thread> threads;
+    std::chrono::nanoseconds spin;
+
+    /// Incremented to publish a job (or the stop), on its own cache line as the workers spin on it
+    alignas(64) std::atomic<uint64_t> epoch{0};
+    /// Spawned workers still running the current job
+    alignas(64) std::atomic<size_t> nb_running{0};
+    alignas(64) job_t const *job{nullptr};
+    std::atomic<bool> stopping{false};
+
+    /// One job at a time
+    std::mutex run_mtx;
+    std::mutex error_mtx;
+    std::exception_ptr error{};
+
+    void worker_loop(size_t index);
+
+    /// Run the current job as the worker 'index', keeping its first exception
+    void run_job(size_t index);
+
+  public:
+
+    /// Pool of 'nb_workers' workers (at least 1) spinning up to 'spin' waiting for a job
+    explicit SpinPool(size_t nb_workers, std::chrono::nanoseconds spin = std::chrono::microseconds(50));
+
+    /// Stop and join the workers
+    ~SpinPool();
+
+    /// Number of workers, the calling thread included
+    size_t size() const { return threads.size() + 1; }
+
+    /// Pin the spawned worker i to the i-th CPU the process may run on (in turn if there are more workers than
+    /// CPUs), leaving the CPU 0 of the list to the calling thread (see ThreadPool::pin_workers). Linux only: return
+    /// false elsewhere or on failure.
+    bool pin_workers();
+
+    /// Run 'job' once per worker, the calling thread running the worker 0, and return once all the workers are
+    /// done. The first exception thrown by the job is rethrown. Concurrent calls are run one after the other.
+    void run(job_t const& job);
+  };
+
+} // End of namespace tempo::utils
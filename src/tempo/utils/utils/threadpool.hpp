@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "uncopyable.hpp"
+
+namespace tempo::utils {
+
+  /** Persistent work stealing thread pool.
+   *  Each worker owns a deque: it pushes and pops its own tasks at the back, while idle workers steal from the front.
+   *  Tasks submitted from outside the pool go through a shared injection queue.
+   *  Tasks can submit tasks (nested parallelism): use a TaskGroup to wait for them.
+   *  A thread waiting on a TaskGroup executes pending tasks instead of blocking, so nested waits cannot deadlock.
+   */
+  class ThreadPool : private Uncopyable {
+  public:
+    using task_t = std::function<void()>;
+
+    /// Tasks run by a thread, the wall time spent in them (outermost tasks only when nested), and its CPU time
+    struct Activity {
+      size_t nb_tasks{0};
+      int64_t busy_ns{0};
+      int64_t cpu_ns{0};
+    };
+
+  private:
+
+    struct WorkerQueue {
+      std::mutex mtx;
+      std::deque<task_t> tasks;
+      /// Activity of the thread owning the queue: the worker, or the helpers for the injection queue
+      std::atomic<size_t> nb_tasks{0};
+      std::atomic<int64_t> busy_ns{0};
+      std::atomic<int64_t> helpers_cpu_ns{0};
+    };
+
+    /// One queue per worker - never resized after construction
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+
+    /// Tasks submitted from outside the pool
+    WorkerQueue injection;
+
+    /// Sleep management
+    std::mutex sleep_mtx;
+    std::condition_variable sleep_cv;
+    std::atomic<size_t> nb_pending{0};
+    bool stopping{false};
+
+    /// Index of the worker running on this thread in 'queues', if the thread belongs to a pool
+    static thread_local ThreadPool *tl_pool;
+    static thread_local size_t tl_index;
+    /// Tasks running on this thread, nested ones included
+    static thread_local size_t tl_depth;
+
+    void worker_loop(size_t index);
+
+    /// Try to pop a task: own queue (back), then injection queue, then steal from other workers (front)
+    bool try_pop(task_t& task);
+
+  public:
+
+    /// Create a pool of 'nb_workers' threads (at least 1)
+    explicit ThreadPool(size_t nb_workers);
+
+    /// Wait for the pending tasks, then join the workers
+    ~ThreadPool();
+
+    /// Number of worker threads
+    size_t size() const { return queues.size(); }
+
+    /// Shared pool, with one worker per hardware thread, created on first use
+    static ThreadPool& global();
+
+    /// Pin the worker i to the i-th CPU the process may run on (in turn if there are more workers than CPUs),
+    /// so that the workers stay on the NUMA node of their data. Linux only: return false elsewhere or on failure.
+    bool pin_workers();
+
+    /// Submit a task. Prefer TaskGroup::run to be able to wait for the task's completion.
+    void submit(task_t task);
+
+    /// Run one pending task on the current thread. Return false if no task was available.
+    bool run_one();
+
+    /// Block until a task is submitted or 'done' returns true (checked when notified).
+    void wait_for_work(std::function<bool()> const& done);
+
+    /// Wake up all threads blocked in wait_for_work, e.g. to re-check their 'done' predicate.
+    void notify_all();
+
+    /** Activity since the creation of the pool of each worker, followed by the one of the threads outside of the pool
+     *  running its tasks while they wait (see TaskGroup::wait), counted together as the "helpers" (see usage::Phase).
+     *  The CPU time of a worker is the one of its thread, looking for work included (Linux only, 0 elsewhere); the
+     *  one of the helpers is measured around their tasks.
+     */
+    std::vector<Activity> activity() const;
+  };
+
+  /** Group of tasks submitted to a ThreadPool, that can be waited for.
+   *  The first exception thrown by a task is rethrown by 'wait'.
+   */
+  class TaskGroup : private Uncopyable {
+    ThreadPool& pool;
+    std::atomic<size_t> nb_remaining{0};
+    std::mutex error_mtx;
+    std::exception_ptr error{};
+
+  public:
+
+    explicit TaskGroup(ThreadPool& pool = ThreadPool::global()) : pool(pool) {}
+
+    /// Wait before destruction: tasks reference the group
+    ~TaskGroup() { wait_noexcept(); }
+
+    /// Submit a task in the group
+    void run(ThreadPool::task_t task);
+
+    /// Wait for all the tasks of the group, executing pending tasks (from any group) in the meantime.
+    void wait();
+
+  private:
+    void wait_noexcept();
+  };
+
+} // End of namespace tempo::utils
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace tempo::utils {
+
+  /** Process wide tracer of scoped events (trees, nodes, tasks...), written in the Chrome Trace Event format,
+   *  readable by chrome://tracing or https://ui.perfetto.dev.
+   *  Disabled by default: a disabled 'TraceScope' costs one relaxed atomic load.
+   *  When enabled, each thread records its events in its own buffer, without locking (the buffer of a thread is
+   *  registered once, under lock, at its first event). Write the trace once the traced work is done.
+   */
+  class Tracer {
+  public:
+
+    /// Complete event: name and category must be string literals (or outlive the tracer).
+    /// 'arg_name'/'arg' is an optional integer argument (e.g. a tree index), ignored if 'arg_name' is null.
+    struct Event {
+      char const *name;
+      char const *category;
+      char const *arg_name;
+      int64_t arg;
+      int64_t start_us;
+      int64_t duration_us;
+    };
+
+    /// The process wide tracer
+    static Tracer& global();
+
+    /// Start recording events, reset the origin of the time stamps, and forget the previous events.
+    /// Must not be called while events are recorded.
+    void enable();
+
+    /// Stop recording events
+    void disable() { enabled_flag.store(false, std::memory_order_relaxed); }
+
+    bool enabled() const { return enabled_flag.load(std::memory_order_relaxed); }
+
+    /// Record an event started at 'start' and ending now, on the calling thread
+    void record(char const *name, char const *category, char const *arg_name, int64_t arg,
+                std::chrono::steady_clock::time_point start);
+
+    /// Write the recorded events as a Chrome Trace Event JSON object.
+    /// Must not be called while events are recorded.
+    void write(std::ostream& out) const;
+
+    /// Write the events in the file 'path'. Throw std::runtime_error if the file can not be written.
+    void write(std::filesystem::path const& path) const;
+
+  private:
+
+    struct Buffer {
+      uint64_t tid;
+      std::vector<Event> events;
+    };
+
+    std::atomic<bool> enabled_flag{false};
+    std::chrono::steady_clock::time_point origin{};
+
+    mutable std::mutex mtx;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    /// Incremented by 'enable' (under lock): a thread registers a new buffer when its buffer is from a previous
+    /// generation. Atomic as it is read without lock by the threads recording events.
+    std::atomic<uint64_t> generation{0};
+
+    /// Buffer of the calling thread, registered at its first call (per generation)
+    Buffer& thread_buffer();
+  };
+
+  /// Record an event for the lifetime of the scope, if the global tracer is enabled
+  class TraceScope {
+    char const *name;
+    char const *category;
+    char const *arg_name;
+    int64_t arg;
+    bool active;
+    std::chrono::steady_clock::time_point start{};
+
+  public:
+    explicit TraceScope(char const *name, char const *category = "tempo", char const *arg_name = nullptr,
+                        int64_t arg = 0) :
+      name(name), category(category), arg_name(arg_name), arg(arg), active(Tracer::global().enabled()) {
+      if (active) { start = std::chrono::steady_clock::now(); }
+    }
+
+    ~TraceScope() { if (active) { Tracer::global().record(name, category, arg_name, arg, start); }}
+
+    TraceScope(TraceScope const&) = delete;
+    TraceScope& operator=(TraceScope const&) = delete;
+  };
+
+} // End of namespace tempo::utils
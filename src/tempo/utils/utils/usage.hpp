@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "threadpool.hpp"
+
+namespace tempo::utils::usage {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // CPU time versus wall time of the phases of a computation (e.g. a training), per thread of the pool running it.
+  // With the wall time only, a slow phase does not tell why. With the CPU time and the task counts:
+  //  - idle workers (busy time well below the wall time) point to too few tasks, or stragglers: a few long tasks
+  //    finishing after the others (e.g. the last trees of a training);
+  //  - busy workers with less CPU time than busy time wait inside their tasks: lock contention, page faults, or
+  //    oversubscription (more runnable threads than cores, the workers being preempted);
+  //  - workers with more CPU time than busy time spend it outside of the tasks, looking for work.
+  // The parallel efficiency of a phase is its process CPU time over its wall time times its number of threads.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// CPU time consumed by the process so far, all its threads included
+  int64_t process_cpu_ns();
+
+  /// CPU time consumed by the calling thread so far
+  int64_t thread_cpu_ns();
+
+  /// Activity of a thread during a phase (see ThreadPool::Activity), and its idle time: wall time not in a task
+  /// (0 for the helpers, not dedicated to the pool)
+  struct ThreadUsage {
+    size_t nb_tasks{0};
+    int64_t busy_ns{0};
+    int64_t cpu_ns{0};
+    int64_t idle_ns{0};
+  };
+
+  /// Usage of a phase (see Phase)
+  struct PhaseUsage {
+    int64_t wall_ns{0};
+    int64_t process_cpu_ns{0};
+    /// Threads the phase was given
+    size_t nb_threads{1};
+    /// Workers of the pool that ran tasks of the phase, by worker index
+    std::vector<std::pair<size_t, ThreadUsage>> workers;
+    /// Threads outside of the pool that ran its tasks while waiting for them (e.g. the thread starting the phase)
+    ThreadUsage helpers;
+
+    /// Process CPU time / (wall time * number of threads)
+    double parallel_efficiency() const;
+
+    nlohmann::json to_json() const;
+  };
+
+  /** Record the usage of a phase, from construction to 'stop'. The tasks of other computations running in the same
+   *  pool at the same time are counted too.
+   */
+  class Phase {
+  public:
+
+    /// Start the phase, run with 'nb_threads' threads of 'pool'
+    explicit Phase(size_t nb_threads, ThreadPool const& pool = ThreadPool::global());
+
+    /// Usage since the start of the phase
+    PhaseUsage stop() const;
+
+  private:
+    ThreadPool const& pool;
+    size_t nb_threads;
+    std::chrono::steady_clock::time_point wall_start;
+    int64_t cpu_start;
+    std::vector<ThreadPool::Activity> activity_start;
+  };
+
+} // End of namespace tempo::utils::usage
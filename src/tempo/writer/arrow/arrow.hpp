@@ -0,0 +1,472 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace tempo::writer::arrow {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Arrow IPC file format, as read by pyarrow.ipc.open_file, pandas.read_feather, polars.read_ipc, ...:
+  //  - magic "ARROW1" (padded to 8 bytes), then an encapsulated schema message
+  //  - one encapsulated record batch message per call to IPCWriter::write: flatbuffer metadata, then the body, the
+  //    buffers of the columns, each padded to 8 bytes
+  //  - end of stream marker, footer (schema and position of the record batches), its size, magic "ARROW1"
+  // The metadata are flatbuffers (see Schema.fbs and Message.fbs of the Arrow specification), built front to back
+  // by internal::FBObject. Columns without null value, buffers in the native (little endian) byte order.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  namespace internal {
+
+    /** Flatbuffer object: a table, a string, a vector of tables or a vector of structs.
+     *  Serialized after the objects referencing it: all the offsets point forward, as flatbuffers require.
+     */
+    struct FBObject {
+      enum class Kind { TABLE, STRING, TABLES, STRUCTS };
+      Kind kind{Kind::TABLE};
+      /// TABLE: scalar fields (id, size in bytes, value) and reference fields (id, object)
+      std::vector<uint16_t> scalar_ids;
+      std::vector<uint8_t> scalar_sizes;
+      std::vector<uint64_t> scalar_values;
+      std::vector<uint16_t> ref_ids;
+      std::vector<FBObject> refs;
+      /// STRING: the characters; STRUCTS: the 'nb_structs' elements, of 8 bytes aligned members
+      std::string bytes;
+      size_t nb_structs{0};
+      /// TABLES: the tables
+      std::vector<FBObject> tables;
+
+      FBObject& scalar(uint16_t id, uint8_t size, uint64_t value) {
+        scalar_ids.push_back(id);
+        scalar_sizes.push_back(size);
+        scalar_values.push_back(value);
+        return *this;
+      }
+
+      FBObject& ref(uint16_t id, FBObject object) {
+        ref_ids.push_back(id);
+        refs.push_back(std::move(object));
+        return *this;
+      }
+
+      static FBObject string(std::string s) {
+        FBObject o;
+        o.kind = Kind::STRING;
+        o.bytes = std::move(s);
+        return o;
+      }
+
+      static FBObject vector_of_tables(std::vector<FBObject> tables) {
+        FBObject o;
+        o.kind = Kind::TABLES;
+        o.tables = std::move(tables);
+        return o;
+      }
+
+      /// Vector of 'nb' structs of 8 bytes aligned members, stored in 'bytes'
+      static FBObject vector_of_structs(std::string bytes, size_t nb) {
+        FBObject o;
+        o.kind = Kind::STRUCTS;
+        o.bytes = std::move(bytes);
+        o.nb_structs = nb;
+        return o;
+      }
+    };
+
+    inline void align(std::string& buf, size_t alignment) {
+      buf.resize((buf.size() + alignment - 1)/alignment*alignment, '\0');
+    }
+
+    template<typename T>
+    void put(std::string& buf, size_t pos, T v) { std::memcpy(buf.data() + pos, &v, sizeof(T)); }
+
+    template<typename T>
+    void append(std::string& buf, T v) { buf.append(reinterpret_cast<char const *>(&v), sizeof(T)); }
+
+    /// Append 'o' to 'buf', each scalar aligned on its size; return the position of the object
+    inline size_t serialize(FBObject const& o, std::string& buf) {
+      using Kind = FBObject::Kind;
+      switch (o.kind) {
+      case Kind::STRING: {
+        align(buf, 4);
+        const size_t p = buf.size();
+        append<uint32_t>(buf, (uint32_t)o.bytes.size());
+        buf += o.bytes;
+        buf.push_back('\0');
+        return p;
+      }
+      case Kind::STRUCTS: {
+        // The elements after the length, on 8 bytes
+        align(buf, 8);
+        buf.append(4, '\0');
+        const size_t p = buf.size();
+        append<uint32_t>(buf, (uint32_t)o.nb_structs);
+        buf += o.bytes;
+        return p;
+      }
+      case Kind::TABLES: {
+        align(buf, 4);
+        const size_t p = buf.size();
+        append<uint32_t>(buf, (uint32_t)o.tables.size());
+        const size_t slots = buf.size();
+        buf.append(4*o.tables.size(), '\0');
+        for (size_t i = 0; i<o.tables.size(); ++i) {
+          const size_t slot = slots + 4*i;
+          const size_t t = serialize(o.tables[i], buf);
+          put<uint32_t>(buf, slot, (uint32_t)(t - slot));
+        }
+        return p;
+      }
+      case Kind::TABLE: {
+        // Layout of the fields after the offset to the vtable, each aligned on its size
+        size_t nb_ids = 0;
+        for (auto id : o.scalar_ids) { nb_ids = std::max<size_t>(nb_ids, id + 1); }
+        for (auto id : o.ref_ids) { nb_ids = std::max<size_t>(nb_ids, id + 1); }
+        std::vector<uint16_t> vtable(nb_ids, 0);
+        size_t size = 4;
+        auto place = [&](uint16_t id, size_t bytes) {
+          size = (size + bytes - 1)/bytes*bytes;
+          vtable[id] = (uint16_t)size;
+          size += bytes;
+        };
+        for (size_t i = 0; i<o.scalar_ids.size(); ++i) { place(o.scalar_ids[i], o.scalar_sizes[i]); }
+        for (auto id : o.ref_ids) { place(id, 4); }
+        size = (size + 3)/4*4;
+        // Vtable, then the table on 8 bytes
+        align(buf, 2);
+        const size_t vt = buf.size();
+        append<uint16_t>(buf, (uint16_t)(4 + 2*nb_ids));
+        append<uint16_t>(buf, (uint16_t)size);
+        for (auto offset : vtable) { append<uint16_t>(buf, offset); }
+        align(buf, 8);
+        const size_t p = buf.size();
+        buf.append(size, '\0');
+        put<int32_t>(buf, p, (int32_t)(p - vt));
+        for (size_t i = 0; i<o.scalar_ids.size(); ++i) {
+          const uint64_t v = o.scalar_values[i];
+          const size_t at = p + vtable[o.scalar_ids[i]];
+          switch (o.scalar_sizes[i]) {
+          case 1: put<uint8_t>(buf, at, (uint8_t)v); break;
+          case 2: put<uint16_t>(buf, at, (uint16_t)v); break;
+          case 4: put<uint32_t>(buf, at, (uint32_t)v); break;
+          default: put<uint64_t>(buf, at, v); break;
+          }
+        }
+        for (size_t i = 0; i<o.refs.size(); ++i) {
+          const size_t slot = p + vtable[o.ref_ids[i]];
+          const size_t r = serialize(o.refs[i], buf);
+          put<uint32_t>(buf, slot, (uint32_t)(r - slot));
+        }
+        return p;
+      }
+      }
+      return 0;
+    }
+
+    /// Flatbuffer with 'root' as root table, padded to 8 bytes
+    inline std::string flatbuffer(FBObject const& root) {
+      std::string buf(8, '\0');
+      put<uint32_t>(buf, 0, (uint32_t)serialize(root, buf));
+      align(buf, 8);
+      return buf;
+    }
+
+    /// Arrow metadata version V5
+    inline constexpr uint64_t metadata_version = 4;
+
+    /// Message of type 'header_type' with its 'header' table and a body of 'body_size' bytes
+    inline std::string message(uint8_t header_type, FBObject header, size_t body_size) {
+      FBObject m;
+      m.scalar(0, 2, metadata_version).scalar(1, 1, header_type).scalar(3, 8, body_size).ref(2, std::move(header));
+      return flatbuffer(m);
+    }
+
+  } // End of namespace internal
+
+  /// Column of an IPCWriter
+  struct Column {
+    enum class Type {
+      FLOAT64,
+      UINT64,
+      /// Strings (utf8)
+      UTF8,
+      /// Lists of 'list_size' uint32 values (fixed_size_list<uint32, list_size>)
+      UINT32_LIST,
+      /// Lists of 'list_size' float64 values (fixed_size_list<double, list_size>), e.g. series of the same length
+      FLOAT64_LIST,
+    };
+    std::string name;
+    Type type;
+    size_t list_size{0};
+  };
+
+  /// Values of a column for a record batch: 'values' for the numeric types, row major for the lists (not copied),
+  /// else 'strings'
+  struct ColumnData {
+    void const *values{nullptr};
+    std::vector<std::string> const *strings{nullptr};
+  };
+
+  /** Write a table in the Arrow IPC file format on 'out', by record batches (see above).
+   *  The values of a batch are written as they are, without conversion nor copy but for the string offsets.
+   *  Throws std::runtime_error on a big endian host, or if 'out' fails.
+   */
+  class IPCWriter {
+    std::ostream& out;
+    std::vector<Column> columns;
+    internal::FBObject schema;
+    size_t position{0};
+    /// Per record batch: offset in the file, size of the encapsulated metadata, size of the body
+    std::vector<std::tuple<size_t, size_t, size_t>> blocks;
+    bool closed{false};
+
+    void write_bytes(void const *data, size_t size) {
+      out.write(static_cast<char const *>(data), (std::streamsize)size);
+      position += size;
+    }
+
+    void pad_to(size_t alignment) {
+      static const char zeros[8]{};
+      write_bytes(zeros, (alignment - position%alignment)%alignment);
+    }
+
+    /// Encapsulated message: continuation marker, size of the metadata, metadata (padded to 8 bytes)
+    void write_message(std::string const& metadata) {
+      const uint32_t marker = 0xFFFFFFFFu;
+      const auto size = (int32_t)metadata.size();
+      write_bytes(&marker, 4);
+      write_bytes(&size, 4);
+      write_bytes(metadata.data(), metadata.size());
+    }
+
+    static internal::FBObject make_field(std::string name, uint8_t type_id, internal::FBObject type,
+                                         std::vector<internal::FBObject> children = {}) {
+      internal::FBObject f;
+      f.scalar(1, 1, 0).scalar(2, 1, type_id);
+      f.ref(0, internal::FBObject::string(std::move(name)));
+      f.ref(3, std::move(type));
+      f.ref(5, internal::FBObject::vector_of_tables(std::move(children)));
+      return f;
+    }
+
+    static internal::FBObject make_schema(std::vector<Column> const& columns) {
+      using internal::FBObject;
+      constexpr uint8_t Int = 2, FloatingPoint = 3, Utf8 = 5, FixedSizeList = 16;
+      std::vector<FBObject> fields;
+      for (Column const& c : columns) {
+        switch (c.type) {
+        case Column::Type::FLOAT64: fields.push_back(make_field(c.name, FloatingPoint, FBObject().scalar(0, 2, 2)));
+          break;
+        case Column::Type::UINT64: {
+          fields.push_back(make_field(c.name, Int, FBObject().scalar(0, 4, 64).scalar(1, 1, 0)));
+          break;
+        }
+        case Column::Type::UTF8: fields.push_back(make_field(c.name, Utf8, FBObject())); break;
+        case Column::Type::UINT32_LIST: {
+          FBObject item = make_field("item", Int, FBObject().scalar(0, 4, 32).scalar(1, 1, 0));
+          fields.push_back(make_field(c.name, FixedSizeList, FBObject().scalar(0, 4, c.list_size), {std::move(item)}));
+          break;
+        }
+        case Column::Type::FLOAT64_LIST: {
+          FBObject item = make_field("item", FloatingPoint, FBObject().scalar(0, 2, 2));
+          fields.push_back(make_field(c.name, FixedSizeList, FBObject().scalar(0, 4, c.list_size), {std::move(item)}));
+          break;
+        }
+        }
+      }
+      FBObject s;
+      s.scalar(0, 2, 0).ref(1, FBObject::vector_of_tables(std::move(fields)));
+      return s;
+    }
+
+  public:
+
+    IPCWriter(std::ostream& out, std::vector<Column> columns) : out(out), columns(std::move(columns)) {
+      if constexpr (std::endian::native!=std::endian::little) {
+        throw std::runtime_error("The Arrow IPC writer needs a little endian host");
+      }
+      schema = make_schema(this->columns);
+      write_bytes("ARROW1\0\0", 8);
+      write_message(internal::message(1, schema, 0));
+      if (!out) { throw std::runtime_error("Error while writing the Arrow schema"); }
+    }
+
+    IPCWriter(IPCWriter const&) = delete;
+
+    IPCWriter& operator =(IPCWriter const&) = delete;
+
+    /// Write a record batch of 'nb_rows' rows, with the values of each column, in the order of the columns
+    void write(size_t nb_rows, std::vector<ColumnData> const& data) {
+      if (closed) { throw std::logic_error("Arrow IPC writer already closed"); }
+      if (data.size()!=columns.size()) { throw std::invalid_argument("Arrow record batch without all its columns"); }
+      // Buffers of the body, and their field nodes, in the order of the schema
+      std::vector<std::pair<void const *, size_t>> buffers;
+      std::vector<std::pair<uint64_t, uint64_t>> nodes;
+      std::vector<std::vector<int32_t>> offsets;
+      std::vector<std::string> chars;
+      offsets.reserve(columns.size());
+      chars.reserve(columns.size());
+      for (size_t c = 0; c<columns.size(); ++c) {
+        nodes.emplace_back(nb_rows, 0);
+        buffers.emplace_back(nullptr, 0); // Validity: no null value
+        switch (columns[c].type) {
+        case Column::Type::FLOAT64:
+        case Column::Type::UINT64: buffers.emplace_back(data[c].values, nb_rows*8); break;
+        case Column::Type::UTF8: {
+          auto const& strings = *data[c].strings;
+          if (strings.size()!=nb_rows) { throw std::invalid_argument("Arrow string column of another length"); }
+          std::vector<int32_t>& o = offsets.emplace_back();
+          std::string& s = chars.emplace_back();
+          o.push_back(0);
+          for (auto const& str : strings) {
+            s += str;
+            o.push_back((int32_t)s.size());
+          }
+          buffers.emplace_back(o.data(), o.size()*4);
+          buffers.emplace_back(s.data(), s.size());
+          break;
+        }
+        case Column::Type::UINT32_LIST:
+        case Column::Type::FLOAT64_LIST: {
+          const size_t nb_values = nb_rows*columns[c].list_size;
+          nodes.emplace_back(nb_values, 0);
+          buffers.emplace_back(nullptr, 0);
+          buffers.emplace_back(data[c].values, nb_values*(columns[c].type==Column::Type::UINT32_LIST ? 4 : 8));
+          break;
+        }
+        }
+      }
+      // Metadata
+      std::string node_bytes;
+      for (auto const& [length, nulls] : nodes) {
+        internal::append<int64_t>(node_bytes, (int64_t)length);
+        internal::append<int64_t>(node_bytes, (int64_t)nulls);
+      }
+      std::string buffer_bytes;
+      size_t body_size = 0;
+      for (auto const& [ptr, size] : buffers) {
+        internal::append<int64_t>(buffer_bytes, (int64_t)body_size);
+        internal::append<int64_t>(buffer_bytes, (int64_t)size);
+        body_size += (size + 7)/8*8;
+      }
+      internal::FBObject batch;
+      batch.scalar(0, 8, nb_rows);
+      batch.ref(1, internal::FBObject::vector_of_structs(std::move(node_bytes), nodes.size()));
+      batch.ref(2, internal::FBObject::vector_of_structs(std::move(buffer_bytes), buffers.size()));
+      const std::string metadata = internal::message(3, std::move(batch), body_size);
+      // Message
+      const size_t offset = position;
+      write_message(metadata);
+      for (auto const& [ptr, size] : buffers) {
+        if (size>0) { write_bytes(ptr, size); }
+        pad_to(8);
+      }
+      blocks.emplace_back(offset, 8 + metadata.size(), body_size);
+      if (!out) { throw std::runtime_error("Error while writing an Arrow record batch"); }
+    }
+
+    /// Write the end of the file; nothing can be written after
+    void close() {
+      if (closed) { return; }
+      closed = true;
+      const uint32_t eos[2]{0xFFFFFFFFu, 0};
+      write_bytes(eos, 8);
+      std::string block_bytes;
+      for (auto const& [offset, metadata_size, body_size] : blocks) {
+        internal::append<int64_t>(block_bytes, (int64_t)offset);
+        internal::append<int32_t>(block_bytes, (int32_t)metadata_size);
+        internal::append<int32_t>(block_bytes, 0);
+        internal::append<int64_t>(block_bytes, (int64_t)body_size);
+      }
+      internal::FBObject footer;
+      footer.scalar(0, 2, internal::metadata_version);
+      footer.ref(1, schema);
+      footer.ref(2, internal::FBObject::vector_of_structs({}, 0));
+      footer.ref(3, internal::FBObject::vector_of_structs(std::move(block_bytes), blocks.size()));
+      const std::string f = internal::flatbuffer(footer);
+      const auto size = (int32_t)f.size();
+      write_bytes(f.data(), f.size());
+      write_bytes(&size, 4);
+      write_bytes("ARROW1", 6);
+      out.flush();
+      if (!out) { throw std::runtime_error("Error while writing the Arrow footer"); }
+    }
+
+    /// Number of record batches written
+    size_t nb_batches() const { return blocks.size(); }
+  };
+
+  /** Predictions in the Arrow IPC file format, one record batch per call to 'write', with the columns:
+   *  - "index": index of the test series
+   *  - one float64 column per class, named by its label: the probabilities
+   *  - "weight": weight of the prediction (see classifier::ResultN)
+   *  - "predicted": label of the most probable class, the first one in encoding order on ties
+   *  - "leaf_ids", if 'nb_trees'>0: leaf reached in each tree, as a list of 'nb_trees' uint32 (see Forest::LeafIDs)
+   *  The probabilities and weights are written as they are (e.g. the columns of an arma::mat), without any copy.
+   */
+  class PredictionWriter {
+    std::vector<std::string> class_labels;
+    size_t nb_trees;
+    IPCWriter writer;
+
+    static std::vector<Column> make_columns(std::vector<std::string> const& labels, size_t nb_trees) {
+      std::vector<Column> columns;
+      columns.push_back({"index", Column::Type::UINT64});
+      for (auto const& l : labels) { columns.push_back({l, Column::Type::FLOAT64}); }
+      columns.push_back({"weight", Column::Type::FLOAT64});
+      columns.push_back({"predicted", Column::Type::UTF8});
+      if (nb_trees>0) { columns.push_back({"leaf_ids", Column::Type::UINT32_LIST, nb_trees}); }
+      return columns;
+    }
+
+  public:
+
+    PredictionWriter(std::ostream& out, std::vector<std::string> class_labels, size_t nb_trees = 0) :
+      class_labels(std::move(class_labels)),
+      nb_trees(nb_trees),
+      writer(out, make_columns(this->class_labels, nb_trees)) {}
+
+    /// Whether the leaf IDs are written
+    bool with_leaf_ids() const { return nb_trees>0; }
+
+    size_t get_nb_trees() const { return nb_trees; }
+
+    /** Write the rows of the test series [first_index, first_index + nb_rows[.
+     * @param probabilities Column major nb_rows x nb_classes matrix (e.g. ResultN::probabilities.memptr())
+     * @param weights       nb_rows weights
+     * @param leaf_ids      Row major nb_rows x nb_trees leaf IDs (e.g. Forest::LeafIDs::ids), if with_leaf_ids()
+     */
+    void write(size_t first_index, size_t nb_rows, double const *probabilities, double const *weights,
+               uint32_t const *leaf_ids = nullptr) {
+      if (with_leaf_ids()&&leaf_ids==nullptr&&nb_rows>0) { throw std::invalid_argument("Missing leaf IDs"); }
+      const size_t nb_classes = class_labels.size();
+      std::vector<uint64_t> indexes(nb_rows);
+      std::vector<std::string> predicted(nb_rows);
+      for (size_t r = 0; r<nb_rows; ++r) {
+        indexes[r] = first_index + r;
+        size_t best = 0;
+        for (size_t c = 1; c<nb_classes; ++c) {
+          if (probabilities[c*nb_rows + r]>probabilities[best*nb_rows + r]) { best = c; }
+        }
+        if (nb_classes>0) { predicted[r] = class_labels[best]; }
+      }
+      std::vector<ColumnData> data;
+      data.push_back({indexes.data()});
+      for (size_t c = 0; c<nb_classes; ++c) { data.push_back({probabilities + c*nb_rows}); }
+      data.push_back({weights});
+      data.push_back({nullptr, &predicted});
+      if (with_leaf_ids()) { data.push_back({leaf_ids}); }
+      writer.write(nb_rows, data);
+    }
+
+    /// Write the end of the file (see IPCWriter::close)
+    void close() { writer.close(); }
+  };
+
+} // End of namespace tempo::writer::arrow
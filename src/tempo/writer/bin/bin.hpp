@@ -0,0 +1,323 @@
+#pragma once
+
+#include <tempo/dataset/dts.hpp>
+
+#include "codec.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tempo::writer::bin {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Binary dataset format
+  // All the integers are 64 bits, in the native byte order:
+  //  - magic (8 bytes), version, sizeof(F)
+  //  - size of the JSON header, then the JSON header (see DatasetHeader::to_json; also "split" and "transform")
+  //  - per series: encoded label (-1 without label), missing flag
+  //  - per series + 1: start of the series in the data array, in number of F
+  //  - padding up to a multiple of 'alignment', then the data array: the series in order, each column major
+  // A file mapped in memory can be used as is: the series are views over the data array
+  // (see reader::load_dataset_bin).
+  // The compressed variant (version_compressed) replaces the padding and the data array by:
+  //  - number of values per block, number of blocks
+  //  - per block + 1: start of the block, in bytes after this table
+  //  - the blocks: the data array, cut in blocks of values encoded independently (see codec.hpp)
+  // Its blocks are decoded concurrently when loading, in memory.
+  // The appendable variant (version_appendable) takes new series without rewriting the existing ones (see append):
+  //  - magic (8 bytes), version, sizeof(F), position of the footer in bytes
+  //  - the chunks of data, each starting at a multiple of 'alignment': the series of a write or of an append, in
+  //    order, each column major
+  //  - the footer: size of the JSON header, the JSON header, then per series: encoded label (-1 without label),
+  //    missing flag, start of the series from the start of the file and number of values, in number of F
+  // An append writes its chunk and a new footer after the current footer, then updates the position of the footer:
+  // until then, the file holds the previous series. The existing series keep their index.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  inline constexpr char magic[8] = {'T', 'E', 'M', 'P', 'O', 'D', 'T', 'S'};
+
+  inline constexpr uint64_t version = 1;
+
+  inline constexpr uint64_t version_compressed = 2;
+
+  inline constexpr uint64_t version_appendable = 3;
+
+  /// Default number of values per block of the compressed variant
+  inline constexpr uint64_t block_values = 1 << 16;
+
+  /// Alignment of the data array in the file (and in memory, the mappings being page aligned)
+  inline constexpr uint64_t alignment = 64;
+
+  /// Path of the file holding a transform of the split written at 'path', e.g. X_TRAIN.derivative1.bin
+  /// for X_TRAIN.bin (see reader::load_dataset_bin_transform)
+  inline std::filesystem::path transform_path(std::filesystem::path path, std::string const& transform_name) {
+    const std::string extension = path.extension().string();
+    return path.replace_extension("." + transform_name + extension);
+  }
+
+  namespace internal {
+    inline void write_u64(std::ostream& out, uint64_t v) { out.write((char const *)&v, sizeof(v)); }
+
+    inline uint64_t read_u64(std::istream& in) {
+      uint64_t v;
+      if (!in.read((char *)&v, sizeof(v))) { throw std::runtime_error("Truncated binary dataset"); }
+      return v;
+    }
+
+    /// Position of the footer in the fixed size part of the appendable variant
+    inline constexpr uint64_t footer_field = sizeof(magic) + 2*sizeof(uint64_t);
+
+    /// Start of the data of the appendable variant, after its fixed size part
+    inline constexpr uint64_t appendable_data = ((footer_field + sizeof(uint64_t) + alignment - 1)/alignment)*alignment;
+
+    /// Series of the footer of the appendable variant
+    struct FooterEntry {
+      uint64_t label;
+      uint64_t missing;
+      uint64_t start;
+      uint64_t nb_values;
+    };
+
+    /// JSON header of a split in 'jv'. Return an error message if a series does not have the dimension of the header.
+    inline std::optional<std::string> header_json(tempo::DTS const& split, nlohmann::json& jv) {
+      const size_t n = split.size();
+      const size_t ndim = split.header().nb_dimensions();
+      jv = split.header().to_json();
+      size_t length_min = n==0 ? 0 : std::numeric_limits<size_t>::max();
+      size_t length_max = 0;
+      bool has_missing = false;
+      for (size_t i = 0; i<n; ++i) {
+        if (split[i].nb_dimensions()!=ndim) { return {"Can't write a series of another dimension than the header's"}; }
+        length_min = std::min(length_min, split[i].length());
+        length_max = std::max(length_max, split[i].length());
+        has_missing = has_missing||split[i].missing();
+      }
+      jv["size"] = (int)n;
+      jv["length"] = utils::to_json(std::vector<int>{(int)length_min, (int)length_max});
+      jv["has_missing_value"] = has_missing;
+      jv["split"] = split.get_split_name();
+      jv["transform"] = split.get_transform_name();
+      return {};
+    }
+
+    /// Write the padding up to a multiple of 'alignment' from 'position', and the series of 'split' in order.
+    /// Add their footer entries, starting at 'position' after the padding, with the label encoding 'encode'.
+    template<typename Encode>
+    uint64_t write_chunk(tempo::DTS const& split, std::ostream& out, uint64_t position, Encode&& encode,
+                         std::vector<FooterEntry>& entries) {
+      const std::string padding((alignment - position%alignment)%alignment, '\0');
+      out.write(padding.data(), (std::streamsize)padding.size());
+      position += padding.size();
+      const size_t ndim = split.header().nb_dimensions();
+      for (size_t i = 0; i<split.size(); ++i) {
+        const uint64_t nb_values = split[i].length()*ndim;
+        entries.push_back({encode(i), split[i].missing() ? 1u : 0u, position/sizeof(F), nb_values});
+        out.write((char const *)split[i].data(), (std::streamsize)(nb_values*sizeof(F)));
+        position += nb_values*sizeof(F);
+      }
+      return position;
+    }
+
+    inline void write_footer(std::ostream& out, nlohmann::json const& jv, std::vector<FooterEntry> const& entries) {
+      const std::string header = jv.dump();
+      write_u64(out, header.size());
+      out.write(header.data(), (std::streamsize)header.size());
+      for (FooterEntry const& e : entries) {
+        write_u64(out, e.label);
+        write_u64(out, e.missing);
+        write_u64(out, e.start);
+        write_u64(out, e.nb_values);
+      }
+    }
+  }
+
+  /// Write a split in the binary format, at the start of the stream (e.g. a new file).
+  /// Return an error message on failure. The labels keep their encoding, the dataset name is taken from the header.
+  /// With 'compress_block', write the compressed variant, with blocks of that number of values, encoded by
+  /// 'nb_threads' threads.
+  inline std::optional<std::string> write(tempo::DTS const& split, std::ostream& out,
+                                          std::optional<size_t> compress_block = {}, size_t nb_threads = 1) {
+    using internal::write_u64;
+    const size_t n = split.size();
+    const size_t ndim = split.header().nb_dimensions();
+
+    // --- Header, for the series of the split
+    nlohmann::json jv;
+    if (auto error = internal::header_json(split, jv)) { return error; }
+    if (compress_block) { jv["compression"] = "xor-shuffle-zrle"; }
+    const std::string header = jv.dump();
+
+    // --- Fixed size part
+    out.write(magic, sizeof(magic));
+    write_u64(out, compress_block ? version_compressed : version);
+    write_u64(out, sizeof(F));
+    write_u64(out, header.size());
+    out.write(header.data(), (std::streamsize)header.size());
+
+    // --- Per series, written at once
+    std::vector<uint64_t> table;
+    table.reserve(3*n + 1);
+    for (size_t i = 0; i<n; ++i) {
+      const std::optional<size_t> ol = split.label(i);
+      table.push_back(ol ? (uint64_t)ol.value() : (uint64_t)-1);
+      table.push_back(split[i].missing() ? 1 : 0);
+    }
+    uint64_t offset = 0;
+    for (size_t i = 0; i<n; ++i) {
+      table.push_back(offset);
+      offset += split[i].length()*ndim;
+    }
+    table.push_back(offset);
+    out.write((char const *)table.data(), (std::streamsize)(table.size()*sizeof(uint64_t)));
+
+    // --- Compressed data array
+    if (compress_block) {
+      const size_t bv = std::max<size_t>(compress_block.value(), 1);
+      std::vector<F> values;
+      values.reserve(offset);
+      for (size_t i = 0; i<n; ++i) {
+        values.insert(values.end(), split[i].data(), split[i].data() + split[i].length()*ndim);
+      }
+      // The blocks are independent: encode them concurrently, then write them in order
+      const size_t nb_blocks = (values.size() + bv - 1)/bv;
+      std::vector<std::vector<uint8_t>> blocks(nb_blocks);
+      utils::ParTasks p;
+      p.execute((int)nb_threads, [&](size_t b) {
+        const size_t start = b*bv;
+        codec::encode(values.data() + start, std::min(bv, values.size() - start), blocks[b]);
+      }, 0, nb_blocks);
+      std::vector<uint64_t> block_offsets{bv, nb_blocks, 0};
+      for (auto const& block : blocks) { block_offsets.push_back(block_offsets.back() + block.size()); }
+      out.write((char const *)block_offsets.data(), (std::streamsize)(block_offsets.size()*sizeof(uint64_t)));
+      for (auto const& block : blocks) { out.write((char const *)block.data(), (std::streamsize)block.size()); }
+      if (!out) { return {"Error while writing the binary dataset"}; }
+      return {};
+    }
+
+    // --- Data array
+    const uint64_t position = sizeof(magic) + 3*sizeof(uint64_t) + header.size() + (3*n + 1)*sizeof(uint64_t);
+    const std::string padding((alignment - position%alignment)%alignment, '\0');
+    out.write(padding.data(), (std::streamsize)padding.size());
+    for (size_t i = 0; i<n; ++i) {
+      out.write((char const *)split[i].data(), (std::streamsize)(split[i].length()*ndim*sizeof(F)));
+    }
+
+    if (!out) { return {"Error while writing the binary dataset"}; }
+    return {};
+  }
+
+
+  /// Write a split in the appendable variant, at the start of the stream (e.g. a new file), see 'write'.
+  inline std::optional<std::string> write_appendable(tempo::DTS const& split, std::ostream& out) {
+    using internal::write_u64;
+    nlohmann::json jv;
+    if (auto error = internal::header_json(split, jv)) { return error; }
+    // The footer follows the data: its position is known before writing it
+    uint64_t footer = internal::appendable_data;
+    for (size_t i = 0; i<split.size(); ++i) { footer += split[i].length()*split.header().nb_dimensions()*sizeof(F); }
+    out.write(magic, sizeof(magic));
+    write_u64(out, version_appendable);
+    write_u64(out, sizeof(F));
+    write_u64(out, footer);
+    std::vector<internal::FooterEntry> entries;
+    const auto encode = [&split](size_t i) {
+      const std::optional<size_t> ol = split.label(i);
+      return ol ? (uint64_t)ol.value() : (uint64_t)-1;
+    };
+    internal::write_chunk(split, out, internal::footer_field + sizeof(uint64_t), encode, entries);
+    internal::write_footer(out, jv, entries);
+    if (!out) { return {"Error while writing the binary dataset"}; }
+    return {};
+  }
+
+  /** Append the series of 'split' to the file 'path' in the appendable variant (see write_appendable), created if it
+   *  does not exist. Only the new series and the footer are written: O(new data) plus the footer, O(number of series).
+   *  The series must have the dimension and the transform of the file. Their labels are encoded with the encoding
+   *  of the file, extended with their new labels: the existing series keep their index and their encoded label,
+   *  the new ones follow them. Return an error message on failure.
+   *  For the transforms saved along a split (see transform_path), append the same series to each of their files.
+   */
+  inline std::optional<std::string> append(tempo::DTS const& split, std::filesystem::path const& path) {
+    using internal::read_u64;
+    using internal::write_u64;
+    if (!std::filesystem::exists(path)) {
+      std::ofstream out(path, std::ios::binary);
+      if (!out) { return {"Cannot open " + path.string()}; }
+      return write_appendable(split, out);
+    }
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file) { return {"Cannot open " + path.string()}; }
+    try {
+      // --- Current footer
+      char m[sizeof(magic)];
+      if (!file.read(m, sizeof(m))||!std::equal(m, m + sizeof(m), magic)) {
+        return {"Not a binary dataset: " + path.string()};
+      }
+      if (read_u64(file)!=version_appendable) { return {"Can only append to the appendable binary dataset variant"}; }
+      if (read_u64(file)!=sizeof(F)) { return {"Binary dataset written with another floating point type"}; }
+      const uint64_t footer = read_u64(file);
+      file.seekg((std::streamoff)footer);
+      std::string header(read_u64(file), '\0');
+      if (!file.read(header.data(), (std::streamsize)header.size())) {
+        throw std::runtime_error("Truncated binary dataset");
+      }
+      nlohmann::json jv = nlohmann::json::parse(header);
+      const auto n = jv.at("size").get<size_t>();
+      std::vector<internal::FooterEntry> entries(n);
+      for (auto& e : entries) { e = {read_u64(file), read_u64(file), read_u64(file), read_u64(file)}; }
+
+      // --- Compatibility, and encoding of the new labels
+      nlohmann::json js;
+      if (auto error = internal::header_json(split, js)) { return error; }
+      if (jv.at("dimension").get<size_t>()!=split.header().nb_dimensions()) {
+        return {"Can't append series of another dimension than the binary dataset's"};
+      }
+      if (jv.value("transform", std::string("default"))!=split.get_transform_name()) {
+        return {"Can't append series of another transform than the binary dataset's"};
+      }
+      auto index_to_label = jv.at("index_to_label").get<std::vector<L>>();
+      std::map<L, uint64_t> label_to_index;
+      for (size_t i = 0; i<index_to_label.size(); ++i) { label_to_index.emplace(index_to_label[i], i); }
+      const auto encode = [&](size_t i) {
+        const std::optional<L>& ol = split.header().original_label(i);
+        if (!ol) { return (uint64_t)-1; }
+        auto [it, inserted] = label_to_index.try_emplace(ol.value(), index_to_label.size());
+        if (inserted) { index_to_label.push_back(ol.value()); }
+        return it->second;
+      };
+
+      // --- New chunk and footer after the current footer, then point to the new footer
+      file.seekp(0, std::ios::end);
+      const auto end = (uint64_t)file.tellp();
+      const uint64_t new_footer = internal::write_chunk(split, file, end, encode, entries);
+      const auto lengths = jv.at("length").get<std::vector<size_t>>();
+      const auto new_lengths = js.at("length").get<std::vector<size_t>>();
+      if (lengths.size()!=2) { return {"Binary dataset with an invalid length entry"}; }
+      if (n>0&&split.size()>0) {
+        jv["length"] = utils::to_json(std::vector<int>{
+          (int)std::min(lengths[0], new_lengths[0]), (int)std::max(lengths[1], new_lengths[1])});
+      } else if (n==0) { jv["length"] = js.at("length"); }
+      jv["size"] = (int)entries.size();
+      jv["has_missing_value"] = jv.value("has_missing_value", false)||js.at("has_missing_value").get<bool>();
+      jv["index_to_label"] = utils::to_json(index_to_label);
+      internal::write_footer(file, jv, entries);
+      file.flush();
+      file.seekp((std::streamoff)internal::footer_field);
+      write_u64(file, new_footer);
+      file.flush();
+      if (!file) { return {"Error while appending to the binary dataset"}; }
+      return {};
+    } catch (std::exception const& e) {
+      return {e.what()};
+    }
+  }
+
+}
@@ -0,0 +1,131 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "bin.hpp"
+
+#include <tempo/reader/reader.hpp>
+
+#include <mock/mockseries.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace tempo;
+namespace wb = tempo::writer::bin;
+
+namespace {
+
+  constexpr size_t nbseries = 40;
+  constexpr size_t ndim = 2;
+
+  /// Split of series of 2 dimensions and of various lengths, of 3 classes, the last one unlabelled and one with a
+  /// missing value
+  DTS mk_dts() {
+    mock::Mocker<F> mocker(0);
+    std::vector<TSeries> series;
+    std::vector<std::optional<std::string>> labels;
+    std::vector<size_t> missing;
+    size_t minl = std::numeric_limits<size_t>::max();
+    size_t maxl = 0;
+    for (size_t i = 0; i<nbseries; ++i) {
+      const size_t length = 10 + i%7;
+      minl = std::min(minl, length);
+      maxl = std::max(maxl, length);
+      std::vector<F> v = mocker.randvec(length*ndim, -5, 5);
+      if (i==3) {
+        v[1] = std::numeric_limits<F>::quiet_NaN();
+        missing.push_back(i);
+      }
+      labels.emplace_back(i + 1==nbseries ? std::nullopt : std::optional<std::string>(std::to_string(i%3)));
+      series.push_back(TSeries::mk_from_rowmajor(std::move(v), ndim, labels.back(), {i==3}));
+    }
+    auto header = std::make_shared<DatasetHeader>("mock", minl, maxl, ndim, std::move(labels), std::move(missing));
+    auto transform = std::make_shared<DatasetTransform<TSeries>>(header, "default", std::move(series));
+    return DTS("train", transform);
+  }
+
+  /// Write 'split' at 'path', compressed with blocks of 'block' values
+  void write_compressed(DTS const& split, std::filesystem::path const& path, size_t block, size_t nb_threads) {
+    std::ofstream out(path, std::ios::binary);
+    REQUIRE_FALSE(wb::write(split, out, block, nb_threads).has_value());
+  }
+
+  /// Same series, labels, missing flags and bits of the values
+  void require_same(DTS const& expected, DTS const& loaded) {
+    REQUIRE(loaded.size()==expected.size());
+    REQUIRE(loaded.get_split_name()==expected.get_split_name());
+    REQUIRE(loaded.header().label_encoder().index_to_label()==expected.header().label_encoder().index_to_label());
+    for (size_t i = 0; i<expected.size(); ++i) {
+      TSeries const& e = expected[i];
+      TSeries const& l = loaded[i];
+      REQUIRE(loaded.label(i)==expected.label(i));
+      REQUIRE(l.missing()==e.missing());
+      REQUIRE(l.nb_dimensions()==e.nb_dimensions());
+      REQUIRE(l.length()==e.length());
+      REQUIRE(std::memcmp(l.data(), e.data(), e.size()*sizeof(F))==0);
+    }
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// A split written in the compressed variant loads back as written, whatever its blocks and threads; a corrupted
+// block is an error.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Binary dataset compressed variant", "[bin][codec]") {
+  const DTS split = mk_dts();
+  size_t nb_values = 0;
+  for (size_t i = 0; i<split.size(); ++i) { nb_values += split[i].size(); }
+  const std::filesystem::path path = std::filesystem::temp_directory_path()/"bin_test_compressed.bin";
+
+  SECTION("Write and load") {
+    // One block, exactly or not, blocks not dividing the number of values, one value per block
+    for (const size_t block : {(size_t)wb::block_values, nb_values, nb_values - 1, (size_t)100, (size_t)7, (size_t)1}) {
+      for (const size_t nbt : {1, 3}) {
+        write_compressed(split, path, block, nbt);
+        auto loaded = reader::load_dataset_bin(path, nbt);
+        REQUIRE(loaded.index()==1);
+        require_same(split, std::get<1>(loaded));
+      }
+    }
+  }
+
+  SECTION("Corrupted block") {
+    constexpr size_t block = 100;
+    REQUIRE(nb_values%block!=0);
+    write_compressed(split, path, block, 1);
+    std::vector<char> bytes;
+    {
+      std::ifstream in(path, std::ios::binary);
+      bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // Block table, after the fixed size part, the JSON header and the per series table (see bin.hpp)
+    uint64_t header_size;
+    std::memcpy(&header_size, bytes.data() + sizeof(wb::magic) + 2*sizeof(uint64_t), sizeof(uint64_t));
+    const size_t table = sizeof(wb::magic) + 3*sizeof(uint64_t) + header_size + (3*nbseries + 1)*sizeof(uint64_t);
+    const size_t nb_blocks = (nb_values + block - 1)/block;
+    std::vector<uint64_t> offsets(nb_blocks + 1);
+    std::memcpy(offsets.data(), bytes.data() + table + 2*sizeof(uint64_t), offsets.size()*sizeof(uint64_t));
+    const size_t blocks = table + (nb_blocks + 3)*sizeof(uint64_t);
+    REQUIRE(blocks + offsets.back()==bytes.size());
+    // The last block only made of runs of 128 zero bytes: more bytes than its values, at least 2 control bytes
+    // encoding them
+    std::memset(bytes.data() + blocks + offsets[nb_blocks - 1], 0xFF, offsets[nb_blocks] - offsets[nb_blocks - 1]);
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out.write(bytes.data(), (std::streamsize)bytes.size());
+    }
+    auto loaded = reader::load_dataset_bin(path, 2);
+    REQUIRE(loaded.index()==0);
+    REQUIRE(std::get<0>(loaded).find("Invalid compressed block")!=std::string::npos);
+  }
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <tempo/utils/utils.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace tempo::writer::bin::codec {
+
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+  // Floating point block codec
+  // A block of values is encoded in three steps, each one undone in reverse order by 'decode':
+  //  - XOR delta: each value is replaced by the XOR of its bits with the bits of the previous value.
+  //    Consecutive values of a series usually share their sign, exponent and high mantissa bits: their XOR has
+  //    zero high bytes.
+  //  - Byte shuffle: the k-th bytes of all the values are stored together, so that the zero bytes form long runs.
+  //  - Zero run length encoding of the shuffled bytes: a control byte c < 128 is followed by c+1 literal bytes,
+  //    a control byte c >= 128 stands for c-127 zero bytes.
+  // Blocks are independent: they can be decoded concurrently.
+  // --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+  /// Unsigned integer with the size of F
+  using Bits = std::conditional_t<sizeof(F)==8, uint64_t, uint32_t>;
+  static_assert(sizeof(Bits)==sizeof(F));
+
+  /// Append the encoding of values[0..n[ to 'out'
+  inline void encode(F const *values, size_t n, std::vector<uint8_t>& out) {
+    constexpr size_t W = sizeof(F);
+    // --- XOR delta and byte shuffle
+    std::vector<uint8_t> shuffled(n*W);
+    Bits previous = 0;
+    for (size_t i = 0; i<n; ++i) {
+      Bits bits;
+      std::memcpy(&bits, values + i, W);
+      const Bits x = bits ^ previous;
+      previous = bits;
+      for (size_t b = 0; b<W; ++b) { shuffled[b*n + i] = (uint8_t)(x >> (8*b)); }
+    }
+    // --- Zero run length encoding
+    size_t i = 0;
+    while (i<shuffled.size()) {
+      if (shuffled[i]==0) {
+        size_t run = 1;
+        while (run<128&&i + run<shuffled.size()&&shuffled[i + run]==0) { ++run; }
+        out.push_back((uint8_t)(127 + run));
+        i += run;
+      } else {
+        // Literals, up to the next pair of zero bytes (a single zero is cheaper as a literal)
+        size_t run = 1;
+        while (run<128&&i + run<shuffled.size()&&
+          !(shuffled[i + run]==0&&(i + run + 1==shuffled.size()||shuffled[i + run + 1]==0))) { ++run; }
+        out.push_back((uint8_t)(run - 1));
+        out.insert(out.end(), shuffled.begin() + (long)i, shuffled.begin() + (long)(i + run));
+        i += run;
+      }
+    }
+  }
+
+  /// Decode the 'size' bytes at 'in' into values[0..n[, the encoding of n values.
+  /// Throws std::runtime_error if the bytes are not such an encoding.
+  inline void decode(uint8_t const *in, size_t size, F *values, size_t n) {
+    constexpr size_t W = sizeof(F);
+    // --- Zero run length decoding
+    std::vector<uint8_t> shuffled(n*W);
+    size_t pos = 0;
+    size_t i = 0;
+    while (pos<size) {
+      const uint8_t c = in[pos++];
+      if (c>=128) {
+        const size_t run = c - 127;
+        if (i + run>shuffled.size()) { throw std::runtime_error("Invalid compressed block"); }
+        std::memset(shuffled.data() + i, 0, run);
+        i += run;
+      } else {
+        const size_t run = (size_t)c + 1;
+        if (i + run>shuffled.size()||pos + run>size) { throw std::runtime_error("Invalid compressed block"); }
+        std::memcpy(shuffled.data() + i, in + pos, run);
+        i += run;
+        pos += run;
+      }
+    }
+    if (i!=shuffled.size()) { throw std::runtime_error("Invalid compressed block"); }
+    // --- Byte unshuffle and XOR delta
+    Bits previous = 0;
+    for (size_t k = 0; k<n; ++k) {
+      Bits x = 0;
+      for (size_t b = 0; b<W; ++b) { x |= (Bits)shuffled[b*n + k] << (8*b); }
+      previous ^= x;
+      std::memcpy(values + k, &previous, W);
+    }
+  }
+
+} // End of namespace tempo::writer::bin::codec
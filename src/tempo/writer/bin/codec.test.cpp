@@ -0,0 +1,127 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "codec.hpp"
+
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace tempo;
+namespace codec = tempo::writer::bin::codec;
+
+namespace {
+
+  /// Values decoded from the encoding of 'values', also checking that the encoding is not larger than 'max_size'
+  std::vector<F> round_trip(std::vector<F> const& values, size_t max_size = std::numeric_limits<size_t>::max()) {
+    std::vector<uint8_t> encoded;
+    codec::encode(values.data(), values.size(), encoded);
+    REQUIRE(encoded.size()<=max_size);
+    std::vector<F> decoded(values.size());
+    codec::decode(encoded.data(), encoded.size(), decoded.data(), decoded.size());
+    return decoded;
+  }
+
+  /// Same bits: also compares NaN and signed zeros
+  bool same_bits(std::vector<F> const& a, std::vector<F> const& b) {
+    return a.size()==b.size()&&std::memcmp(a.data(), b.data(), a.size()*sizeof(F))==0;
+  }
+
+  /// Values with random bits, without zero byte: all literals
+  std::vector<F> random_bits(size_t n, std::mt19937_64& prng) {
+    std::vector<F> values(n);
+    for (F& v : values) {
+      codec::Bits bits = 0;
+      for (size_t b = 0; b<sizeof(F); ++b) { bits |= (codec::Bits)(1 + prng()%255) << (8*b); }
+      std::memcpy(&v, &bits, sizeof(F));
+    }
+    return values;
+  }
+
+}
+
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+// Testing
+// A block decodes to the bits it was encoded from, whatever the runs of literal and zero bytes.
+// --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---
+
+TEST_CASE("Binary codec round trip", "[bin][codec]") {
+  std::mt19937_64 prng(42);
+
+  SECTION("Random values") {
+    std::normal_distribution<F> normal(0, 10);
+    for (const size_t n : {0, 1, 2, 127, 128, 129, 1000}) {
+      std::vector<F> values(n);
+      for (F& v : values) { v = normal(prng); }
+      REQUIRE(same_bits(round_trip(values), values));
+    }
+  }
+
+  SECTION("Special values") {
+    const std::vector<F> values{0, -0.0, 1, -1, std::numeric_limits<F>::quiet_NaN(), std::numeric_limits<F>::infinity(),
+                                -std::numeric_limits<F>::infinity(), std::numeric_limits<F>::denorm_min(),
+                                std::numeric_limits<F>::max(), std::numeric_limits<F>::lowest(), 0, 0};
+    REQUIRE(same_bits(round_trip(values), values));
+  }
+
+  SECTION("Runs of zero bytes") {
+    // One control byte per run of 128 zero bytes
+    const std::vector<F> zeros(1000, 0);
+    REQUIRE(same_bits(round_trip(zeros, (1000*sizeof(F) + 127)/128), zeros));
+    // Repeated values: zero XOR deltas after the first value
+    const std::vector<F> repeated(1000, (F)3.25);
+    REQUIRE(same_bits(round_trip(repeated), repeated));
+    // Zero runs of all the lengths around the maximum, between literals
+    for (const size_t run : {1, 2, 15, 16, 17, 127, 128, 129, 255, 256, 257}) {
+      std::vector<F> values = random_bits(3, prng);
+      values.insert(values.end(), run, 0);
+      for (F v : random_bits(3, prng)) { values.push_back(v); }
+      REQUIRE(same_bits(round_trip(values), values));
+    }
+  }
+
+  SECTION("Runs of literals longer than 128 bytes") {
+    for (const size_t n : {16, 17, 100, 333}) {
+      const std::vector<F> values = random_bits(n, prng);
+      // At most one control byte per 128 literals
+      const size_t nb_bytes = n*sizeof(F);
+      REQUIRE(same_bits(round_trip(values, nb_bytes + (nb_bytes + 127)/128), values));
+    }
+  }
+}
+
+TEST_CASE("Binary codec corrupted block", "[bin][codec]") {
+  std::mt19937_64 prng(42);
+  const std::vector<F> values = random_bits(100, prng);
+  std::vector<uint8_t> encoded;
+  codec::encode(values.data(), values.size(), encoded);
+  std::vector<F> decoded(values.size());
+
+  SECTION("Truncated") {
+    REQUIRE_THROWS_AS(codec::decode(encoded.data(), encoded.size() - 1, decoded.data(), decoded.size()),
+                      std::runtime_error);
+    REQUIRE_THROWS_AS(codec::decode(encoded.data(), 0, decoded.data(), decoded.size()), std::runtime_error);
+  }
+
+  SECTION("Too many values") {
+    // A zero run past the end of the block
+    std::vector<uint8_t> longer = encoded;
+    longer.push_back(255);
+    REQUIRE_THROWS_AS(codec::decode(longer.data(), longer.size(), decoded.data(), decoded.size()),
+                      std::runtime_error);
+    // The encoding of fewer values
+    REQUIRE_THROWS_AS(codec::decode(encoded.data(), encoded.size(), decoded.data(), decoded.size() - 1),
+                      std::runtime_error);
+  }
+
+  SECTION("Corrupted control byte") {
+    // The last run of literals, shorter than 128 bytes, now reads past the end of the block
+    size_t last = 0;
+    for (size_t pos = 0; pos<encoded.size(); pos += encoded[pos]<128 ? encoded[pos] + 2 : 1) { last = pos; }
+    REQUIRE(encoded[last]<127);
+    std::vector<uint8_t> corrupted = encoded;
+    corrupted[last] = 127;
+    REQUIRE_THROWS_AS(codec::decode(corrupted.data(), corrupted.size(), decoded.data(), decoded.size()),
+                      std::runtime_error);
+  }
+}
@@ -2,85 +2,164 @@
 
 #include <tempo/dataset/dts.hpp>
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace tempo::univariate::writer {
 
+  /// Number of series formatted together, by one thread, before being written
+  inline constexpr size_t chunk_series = 64;
+
+  /// Size of the buffer of the file stream opened by 'write_file'
+  inline constexpr size_t file_buffer_size = 1 << 20;
+
+  namespace internal {
+
+    /// Append 'v' to 'buffer', in its shortest representation reading back to 'v' ("?" for a missing value)
+    inline void append_value(std::string& buffer, F v) {
+      if (std::isnan(v)) {
+        buffer.push_back('?');
+        return;
+      }
+      char chars[32];
+      const auto result = std::to_chars(chars, chars + sizeof(chars), v);
+      buffer.append(chars, result.ptr);
+    }
+
+    /// Append the data lines of the series [start, stop[ of 'split' to 'buffer'
+    inline void append_series(std::string& buffer, tempo::DTS const& split, size_t start, size_t stop) {
+      const size_t ndim = split.header().nb_dimensions();
+      for (size_t i = start; i<stop; ++i) {
+        const auto& ts = split[i];
+        F const *values = ts.data();
+        // One dimension after the other, separated by ':' (the values of a point are contiguous)
+        for (size_t d = 0; d<ndim; ++d) {
+          if (d>0) { buffer.push_back(':'); }
+          append_value(buffer, values[d]);
+          for (size_t j = 1; j<ts.length(); ++j) {
+            buffer.push_back(',');
+            append_value(buffer, values[j*ndim + d]);
+          }
+        }
+        // Label if we have one
+        if (ts.label()) {
+          buffer.push_back(':');
+          buffer.append(ts.label().value());
+        }
+        buffer.push_back('\n');
+      }
+    }
+
+  } // End of namespace internal
+
+  /// Write a split in the TS format. Return an error message on failure.
+  /// The values are written in their shortest round trip representation (std::to_chars), the missing ones as "?".
+  /// The data lines are formatted in memory by chunks of 'chunk_series' series, 'nb_threads' chunks concurrently,
+  /// and written in order with one call per chunk: 'out' is never flushed.
   inline std::optional<std::string> write(
-      tempo::DTS const& split,
-      std::string const& problem_name,
-      std::ostream& out){
+    tempo::DTS const& split,
+    std::string const& problem_name,
+    std::ostream& out,
+    size_t nb_threads = 1) {
 
-    if(split.size() == 0){ return {"Can't write empty split"}; }
+    if (split.size()==0) { return {"Can't write empty split"}; }
 
     const auto now = std::chrono::system_clock::now();
     const auto now_time = std::chrono::system_clock::to_time_t(now);
 
-    out << "# File produced by the tempo TS writer" << std::endl;
-    out << "# " << std::ctime(&now_time) << std::endl;
+    std::string header;
+    header += "# File produced by the tempo TS writer\n";
+    header += "# " + std::string(std::ctime(&now_time)) + "\n";
 
-    out << "@problemname " << problem_name << std::endl;
-    out << "@timestamps false" << std::endl;
-    out << "@univariate true" << std::endl;
-    out << "@targetlabel false" << std::endl;
+    header += "@problemname " + problem_name + "\n";
+    header += "@timestamps false\n";
+    const size_t ndim = split.header().nb_dimensions();
+    header += std::string("@univariate ") + (ndim==1 ? "true" : "false") + "\n";
+    header += "@targetlabel false\n";
 
     // Check for missing values
     bool has_missing = false;
-    for(size_t i=0; i<split.size(); ++i){
-      if(split[i].missing()){
+    for (size_t i = 0; i<split.size(); ++i) {
+      if (split[i].missing()) {
         has_missing = true;
         break;
       }
     }
 
-    out << "@missing " << ( has_missing?"true":"false" ) << std::endl;
+    header += std::string("@missing ") + (has_missing ? "true" : "false") + "\n";
 
     // Check for equal length
     const size_t length0 = split[0].length();
     bool equal_length = true;
-    for(size_t i=1; i<split.size(); ++i){
-      if(split[i].length() != length0){
+    for (size_t i = 1; i<split.size(); ++i) {
+      if (split[i].length()!=length0) {
         equal_length = false;
         break;
       }
     }
 
-    out << "@equallength " << ( equal_length?"true":"false" ) << std::endl;
-    if(equal_length){
-      out << "@serieslength " << length0 << std::endl;
-    }
-
+    header += std::string("@equallength ") + (equal_length ? "true" : "false") + "\n";
+    if (equal_length) { header += "@serieslength " + std::to_string(length0) + "\n"; }
 
     // Dataset labels
     const auto& vec_labels = split.header().label_encoder().index_to_label();
-    if(vec_labels.empty()){
-      out << "@classlabel false" << std::endl;
+    if (vec_labels.empty()) {
+      header += "@classlabel false\n";
     } else {
-      out << "@classlabel true";
-      for(const auto& l:vec_labels){ out << " " << l; }
-      out << std::endl;
+      header += "@classlabel true";
+      for (const auto& l : vec_labels) { header += " " + l; }
+      header += "\n";
     }
 
     // Data section
-    out << "@data" << std::endl;
-    out.precision(17);
-
-    for(size_t i=0; i<split.size(); ++i){
-      const auto& ts = split[i];
-      // Univariate data
-      out << ts[0];
-      for(size_t j=1; j<ts.length(); ++j){ out << "," << ts[j]; }
-      // Label if we have one
-      if(ts.label()){ out << ":" << ts.label().value(); }
-      out << std::endl;
+    header += "@data\n";
+    out.write(header.data(), (std::streamsize)header.size());
+
+    // Waves of chunks: at most one chunk per thread is held in memory
+    const size_t nbt = std::max<size_t>(nb_threads, 1);
+    const size_t nb_chunks = (split.size() + chunk_series - 1)/chunk_series;
+    std::vector<std::string> buffers(std::min(nbt, nb_chunks));
+    for (size_t wave = 0; wave<nb_chunks; wave += buffers.size()) {
+      const size_t wave_end = std::min(nb_chunks, wave + buffers.size());
+      utils::ParTasks p;
+      p.execute((int)nbt, [&](size_t c) {
+        std::string& buffer = buffers[c - wave];
+        buffer.clear();
+        internal::append_series(buffer, split, c*chunk_series, std::min(split.size(), (c + 1)*chunk_series));
+      }, wave, wave_end);
+      for (size_t c = wave; c<wave_end; ++c) {
+        out.write(buffers[c - wave].data(), (std::streamsize)buffers[c - wave].size());
+      }
     }
 
-
-
+    if (!out) { return {"Error while writing the TS dataset"}; }
     return {};
+  }
 
+  /// Write a split in the TS format in a new file at 'path', through a buffer of 'file_buffer_size' bytes (see write)
+  inline std::optional<std::string> write_file(
+    tempo::DTS const& split,
+    std::string const& problem_name,
+    std::filesystem::path const& path,
+    size_t nb_threads = 1) {
+    std::vector<char> buffer(file_buffer_size);
+    std::ofstream out;
+    out.rdbuf()->pubsetbuf(buffer.data(), (std::streamsize)buffer.size());
+    out.open(path, std::ios::binary);
+    if (!out) { return {"Can't open " + path.string()}; }
+    auto error = write(split, problem_name, out, nb_threads);
+    out.close();
+    if (!error && !out) { return {"Error while writing " + path.string()}; }
+    return error;
   }
 
-}
\ No newline at end of file
+}
@@ -124,6 +124,37 @@ namespace mock {
       return set;
     }
 
+    /** Generate 'nbclasses' class prototypes of _fixl size: random walks with steps in [-1, 1[, per dimension */
+    [[nodiscard]] vector<vector<FloatType>> class_prototypes(size_t nbclasses) {
+      std::uniform_real_distribution<FloatType> udist{-1, 1};
+      vector<vector<FloatType>> prototypes;
+      for (size_t c = 0; c<nbclasses; ++c) {
+        std::vector<FloatType> v(_fixl*_dim);
+        for (size_t d = 0; d<_dim; ++d) {
+          FloatType x = 0;
+          for (size_t j = 0; j<_fixl; ++j) {
+            x += udist(_prng);
+            v[j*_dim + d] = x;
+          }
+        }
+        prototypes.push_back(std::move(v));
+      }
+      return prototypes;
+    }
+
+    /** Generate a series of the class of 'prototype' (see class_prototypes): the prototype cyclically shifted in time
+     * by up to a tenth of its length, with a noise in [-noise, noise] added to each value. */
+    [[nodiscard]] std::vector<FloatType> class_randvec(std::vector<FloatType> const& prototype, FloatType noise) {
+      const size_t length = prototype.size()/_dim;
+      const size_t shift = get_size(0, length/10);
+      std::uniform_real_distribution<FloatType> udist{-noise, noise};
+      std::vector<FloatType> v(prototype.size());
+      for (size_t j = 0; j<length; ++j) {
+        for (size_t d = 0; d<_dim; ++d) { v[j*_dim + d] = prototype[((j + shift)%length)*_dim + d] + udist(_prng); }
+      }
+      return v;
+    }
+
   };
 
 